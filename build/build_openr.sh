@@ -254,25 +254,6 @@ install_re2() {
 }
 
 
-install_libnl() {
-  pushd .
-  if [[ ! -e "libnl" ]]; then
-    git clone https://github.com/thom311/libnl
-    cd libnl
-    git fetch origin
-    git checkout libnl3_2_25
-    git apply ../../fix-route-obj-attr-list.patch
-    cd ..
-  fi
-  cd libnl
-  ./autogen.sh
-  ./configure
-  make
-  sudo make install
-  sudo ldconfig
-  popd
-}
-
 install_krb5() {
   pushd .
   if [[ ! -e "krb5" ]]; then
@@ -359,7 +340,6 @@ install_fizz
 install_wangle
 install_libsodium
 install_libzmq
-install_libnl
 install_krb5
 install_fbthrift
 install_fbzmq
@@ -7,8 +7,10 @@
 
 #include <syslog.h>
 #include <fstream>
+#include <future>
 #include <stdexcept>
 
+#include <fb303/ServiceData.h>
 #include <fbzmq/async/StopEventLoopSignalHandler.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
@@ -17,6 +19,7 @@
 #include <folly/IPAddress.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
+#include <folly/String.h>
 #include <folly/gen/Base.h>
 #include <folly/gen/String.h>
 #include <folly/init/Init.h>
@@ -34,6 +37,10 @@
 #include <openr/common/BuildInfo.h>
 #include <openr/common/Constants.h>
 #include <openr/common/Flags.h>
+#include <openr/common/CpuProfiler.h>
+#include <openr/common/MemoryAccounting.h>
+#include <openr/common/RouteStore.h>
+#include <openr/common/ThreadPlacement.h>
 #include <openr/common/ThriftUtil.h>
 #include <openr/common/Util.h>
 #include <openr/config-store/PersistentStore.h>
@@ -60,12 +67,17 @@ using namespace folly::gen;
 using apache::thrift::concurrency::ThreadManager;
 using openr::messaging::ReplicateQueue;
 
+namespace fb303 = facebook::fb303;
+
 namespace {
 //
 // Local constants
 //
 
 const std::string inet6Path = "/proc/net/if_inet6";
+
+// placement of module threads by module name, from FLAGS_thread_placement
+std::unordered_map<std::string, ThreadPlacement> threadPlacements;
 } // namespace
 
 // Disable background jemalloc background thread => new jemalloc-5 feature
@@ -120,6 +132,31 @@ submitCounters(const ZmqEventLoop& eventLoop, ZmqMonitorClient& monitorClient) {
   monitorClient.setCounters(prepareSubmitCounters(std::move(counters)));
 }
 
+/**
+ * Export stats of an inter-module queue since last export via fb303, e.g.
+ * messaging.route_updates.depth
+ */
+template <typename T>
+void
+exportQueueStats(ReplicateQueue<T>& queue) {
+  const auto stats = queue.getStats();
+  const auto prefix = folly::sformat("messaging.{}.", queue.getName());
+  fb303::fbData->setCounter(prefix + "depth", stats.size);
+  fb303::fbData->setCounter(prefix + "max_depth", stats.maxSize);
+  fb303::fbData->addStatValue(
+      prefix + "enqueued", stats.numWrites, fb303::SUM);
+  fb303::fbData->addStatValue(prefix + "dropped", stats.numDropped, fb303::SUM);
+  fb303::fbData->addStatValue(prefix + "merged", stats.numMerged, fb303::SUM);
+  fb303::fbData->setCounter(
+      prefix + "latency_us.avg",
+      stats.numReads ? stats.sumLatencyUs / stats.numReads : 0);
+  fb303::fbData->setCounter(
+      prefix + "latency_us.p50", stats.getLatencyPercentileUs(50));
+  fb303::fbData->setCounter(
+      prefix + "latency_us.p99", stats.getLatencyPercentileUs(99));
+  fb303::fbData->setCounter(prefix + "latency_us.max", stats.maxLatencyUs);
+}
+
 /**
  * Start an EventBase in a thread, maintain order of thread creation and
  * returns raw pointer of Derived class.
@@ -141,11 +178,29 @@ startEventBase(
   allThreads.emplace_back(std::thread([evb = evb.get(), name]() noexcept {
     LOG(INFO) << "Starting " << name << " thread ...";
     folly::setThreadName(name);
+    if (FLAGS_memory_accounting) {
+      MemoryAccounting::bindThreadToModule(name);
+    }
+    if (FLAGS_enable_cpu_profiler) {
+      CpuProfiler::registerThread(name);
+    }
+    auto placementIt = threadPlacements.find(name);
+    if (placementIt != threadPlacements.end()) {
+      placementIt->second.apply(name);
+    }
     evb->run();
+    if (FLAGS_enable_cpu_profiler) {
+      CpuProfiler::unregisterThread();
+    }
     LOG(INFO) << name << " thread got stopped.";
   }));
   evb->waitUntilRunning();
 
+  // Time module is up since start of the process, e.g. startup.kvstore_ready_ms
+  auto counterName = folly::sformat("startup.{}_ready_ms", name);
+  folly::toLowerAscii(counterName);
+  fb303::fbData->setCounter(counterName, getProcessUptime().count());
+
   // Add to watchdog
   if (watchdog) {
     watchdog->addEvb(evb.get(), name);
@@ -203,12 +258,24 @@ main(int argc, char** argv) {
   // Sanity check for IPv6 global environment
   checkIsIpv6Enabled();
 
+  try {
+    threadPlacements = ThreadPlacement::parse(FLAGS_thread_placement);
+  } catch (std::invalid_argument const& e) {
+    LOG(FATAL) << "Invalid --thread_placement: " << e.what();
+  }
+
   // Sanity check for prefix forwarding type and algorithm
   if (FLAGS_prefix_algo_type_ksp2_ed_ecmp) {
     CHECK(FLAGS_prefix_fwd_type_mpls)
         << "Forwarding type must be set to SR_MPLS for KSP2_ED_ECMP";
   }
 
+  // Fib can only call into a handler of its own process
+  if (FLAGS_enable_fib_in_process_agent) {
+    CHECK(FLAGS_enable_netlink_fib_handler)
+        << "enable_fib_in_process_agent requires enable_netlink_fib_handler";
+  }
+
   // Sanity checks on Segment Routing labels
   const int32_t maxLabel = Constants::kMaxSrLabel;
   CHECK(Constants::kSrGlobalRange.first > 0);
@@ -224,6 +291,9 @@ main(int argc, char** argv) {
       (Constants::kSrGlobalRange.first > Constants::kSrLocalRange.second))
       << "Overlapping global/local segment routing label space.";
 
+  CHECK_LE(0, FLAGS_prefix_key_bucket_size)
+      << "prefix_key_bucket_size must not be negative";
+
   // Prepare IP-TOS value from flag and do sanity checks
   std::optional<int> maybeIpTos{0};
   if (FLAGS_ip_tos != 0) {
@@ -242,13 +312,28 @@ main(int argc, char** argv) {
   folly::setThreadName("openr");
 
   // Queue for inter-module communication
-  ReplicateQueue<openr::thrift::RouteDatabaseDelta> routeUpdatesQueue;
-  ReplicateQueue<openr::thrift::InterfaceDatabase> interfaceUpdatesQueue;
-  ReplicateQueue<openr::thrift::SparkNeighborEvent> neighborUpdatesQueue;
-  ReplicateQueue<openr::thrift::PrefixUpdateRequest> prefixUpdatesQueue;
-  ReplicateQueue<openr::thrift::Publication> kvStoreUpdatesQueue;
-  ReplicateQueue<openr::thrift::PeerUpdateRequest> peerUpdatesQueue;
-  ReplicateQueue<openr::thrift::RouteDatabaseDelta> staticRoutesUpdateQueue;
+  ReplicateQueue<openr::thrift::RouteDatabaseDelta> routeUpdatesQueue{
+      "route_updates"};
+  ReplicateQueue<openr::thrift::InterfaceDatabase> interfaceUpdatesQueue{
+      "interface_updates"};
+  ReplicateQueue<openr::thrift::SparkNeighborEvents> neighborUpdatesQueue{
+      "neighbor_updates"};
+  ReplicateQueue<openr::thrift::PrefixUpdateRequest> prefixUpdatesQueue{
+      "prefix_updates"};
+  ReplicateQueue<openr::KvStorePublication> kvStoreUpdatesQueue{
+      "kvstore_updates"};
+  ReplicateQueue<openr::thrift::PeerUpdateRequest> peerUpdatesQueue{
+      "peer_updates"};
+  ReplicateQueue<openr::thrift::RouteDatabaseDelta> staticRoutesUpdateQueue{
+      "static_routes_updates"};
+  // link/addr events of the in-process PlatformPublisher, if there is one
+  ReplicateQueue<openr::PlatformEvents> platformEventsQueue{"platform_events"};
+  // route updates programmed by Fib, streamed to OpenrCtrl subscribers
+  ReplicateQueue<openr::thrift::RouteDatabaseDelta> fibUpdatesQueue{
+      "fib_updates"};
+
+  // Routes sent from Decision to Fib, shared by both
+  RouteStore routeStore;
 
   // structures to organize our modules
   std::vector<std::thread> allThreads;
@@ -266,7 +351,9 @@ main(int argc, char** argv) {
             FLAGS_node_name,
             std::chrono::seconds(FLAGS_watchdog_interval_s),
             std::chrono::seconds(FLAGS_watchdog_threshold_s),
-            FLAGS_memory_limit_mb));
+            FLAGS_memory_limit_mb,
+            std::chrono::milliseconds(
+                FLAGS_watchdog_slow_callback_threshold_ms)));
   }
 
   // Create ThreadManager for thrift services
@@ -276,6 +363,7 @@ main(int argc, char** argv) {
   std::unique_ptr<fbzmq::ZmqEventLoop> nlProtocolSocketEventLoop{nullptr};
   std::shared_ptr<openr::fbnl::NetlinkSocket> nlSocket{nullptr};
   std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlProtocolSocket{nullptr};
+  std::shared_ptr<NetlinkFibHandler> netlinkFibHandler{nullptr};
   std::unique_ptr<apache::thrift::ThriftServer> netlinkFibServer{nullptr};
   std::unique_ptr<apache::thrift::ThriftServer> netlinkSystemServer{nullptr};
   std::unique_ptr<std::thread> netlinkFibServerThread{nullptr};
@@ -288,15 +376,24 @@ main(int argc, char** argv) {
     thriftThreadMgr->setNamePrefix("ThriftCpuPool");
     thriftThreadMgr->start();
 
-    // Create event publisher to handle event subscription
+    // ATTN: intentionally set evl capacity to be 1e5 instead of default 1e2
+    nlEventLoop = std::make_unique<fbzmq::ZmqEventLoop>(1e5);
+
+    // Create event publisher to handle event subscription, coalescing events
+    // in the event loop of NetlinkSocket
     eventPublisher = std::make_unique<PlatformPublisher>(
-        context, PlatformPublisherUrl{FLAGS_platform_pub_url});
+        context,
+        PlatformPublisherUrl{FLAGS_platform_pub_url},
+        nlEventLoop.get(),
+        &platformEventsQueue);
 
     // Create Netlink Protocol object in a new thread
     // ATTN: intentionally set evl capacity to be 1e5 instead of default 1e2
     nlProtocolSocketEventLoop = std::make_unique<fbzmq::ZmqEventLoop>(1e5);
     nlProtocolSocket = std::make_unique<openr::fbnl::NetlinkProtocolSocket>(
-        nlProtocolSocketEventLoop.get());
+        nlProtocolSocketEventLoop.get(),
+        FLAGS_netlink_min_iov_msg,
+        FLAGS_netlink_max_iov_msg);
     auto nlProtocolSocketThread = std::thread([&]() {
       LOG(INFO) << "Starting NetlinkProtolSocketEvl thread ...";
       folly::setThreadName("NetlinkProtolSocketEvl");
@@ -307,8 +404,6 @@ main(int argc, char** argv) {
     nlProtocolSocketEventLoop->waitUntilRunning();
     allThreads.emplace_back(std::move(nlProtocolSocketThread));
 
-    // ATTN: intentionally set evl capacity to be 1e5 instead of default 1e2
-    nlEventLoop = std::make_unique<fbzmq::ZmqEventLoop>(1e5);
     nlSocket = std::make_shared<openr::fbnl::NetlinkSocket>(
         nlEventLoop.get(), eventPublisher.get(), std::move(nlProtocolSocket));
     // Subscribe selected network events
@@ -334,12 +429,14 @@ main(int argc, char** argv) {
       netlinkFibServer->setCpp2WorkerThreadName("FibTWorker");
       netlinkFibServer->setPort(FLAGS_fib_handler_port);
 
+      // shared with Fib if it programs routes in-process
+      netlinkFibHandler = std::make_shared<NetlinkFibHandler>(
+          nlEventLoop.get(), nlSocket, FLAGS_enable_netlink_nexthop_objects);
+
       netlinkFibServerThread = std::make_unique<std::thread>(
-          [&netlinkFibServer, &nlEventLoop, nlSocket]() {
+          [&netlinkFibServer, netlinkFibHandler]() {
             folly::setThreadName("FibService");
-            auto fibHandler = std::make_shared<NetlinkFibHandler>(
-                nlEventLoop.get(), nlSocket);
-            netlinkFibServer->setInterface(std::move(fibHandler));
+            netlinkFibServer->setInterface(netlinkFibHandler);
 
             LOG(INFO) << "Starting NetlinkFib server...";
             netlinkFibServer->serve();
@@ -378,6 +475,15 @@ main(int argc, char** argv) {
   ZmqMonitorClient monitorClient(context, monitorSubmitUrl);
   auto monitorTimer = fbzmq::ZmqTimeout::make(&mainEventLoop, [&]() noexcept {
     submitCounters(mainEventLoop, monitorClient);
+    exportQueueStats(routeUpdatesQueue);
+    exportQueueStats(interfaceUpdatesQueue);
+    exportQueueStats(neighborUpdatesQueue);
+    exportQueueStats(prefixUpdatesQueue);
+    exportQueueStats(kvStoreUpdatesQueue);
+    exportQueueStats(peerUpdatesQueue);
+    exportQueueStats(staticRoutesUpdateQueue);
+    exportQueueStats(platformEventsQueue);
+    exportQueueStats(fibUpdatesQueue);
   });
   monitorTimer->scheduleTimeout(Constants::kMonitorSubmitInterval, true);
 
@@ -404,14 +510,19 @@ main(int argc, char** argv) {
   });
   ctrlEvb.waitUntilRunning();
 
-  // Start config-store URL
-  auto configStore = startEventBase(
-      allThreads,
-      orderedEvbs,
-      watchdog,
-      "ConfigStore",
-      std::make_unique<PersistentStore>(
-          FLAGS_node_name, FLAGS_config_store_filepath, context));
+  // Create config-store. Loading it from disk doesn't depend on any other
+  // module, it runs concurrently with setting up the modules up to KvStore,
+  // which restores its snapshots meanwhile
+  auto configStoreFuture = std::async(std::launch::async, [&context]() {
+    folly::setThreadName("ConfigStoreInit");
+    return std::make_unique<PersistentStore>(
+        FLAGS_node_name,
+        FLAGS_config_store_filepath,
+        context,
+        false /* dryrun */,
+        true /* periodicallySaveToDisk */,
+        FLAGS_config_store_fsync);
+  });
 
   // Start monitor Module
   // for each log message it receives, we want to add the openr domain
@@ -453,12 +564,68 @@ main(int argc, char** argv) {
     kvFilters = KvStoreFilters(keyPrefixList, originatorIds);
   }
 
+  KvStoreOptions kvstoreOptions;
+  kvstoreOptions.enableBucketSync = FLAGS_kvstore_enable_bucket_sync;
+  kvstoreOptions.enableOriginatorSync = FLAGS_kvstore_enable_originator_sync;
+  kvstoreOptions.ttlExpirySlack =
+      std::chrono::milliseconds(FLAGS_kvstore_ttl_expiry_slack_ms);
+  kvstoreOptions.floodBatchDelay =
+      std::chrono::milliseconds(FLAGS_kvstore_flood_batch_ms);
+  kvstoreOptions.floodBatchBytes = FLAGS_kvstore_flood_batch_bytes;
+  kvstoreOptions.peerSendQueueBytes = FLAGS_kvstore_peer_send_queue_bytes;
+  kvstoreOptions.enableCompactTtlUpdates =
+      FLAGS_kvstore_enable_compact_ttl_updates;
+  kvstoreOptions.valueCompressionMinBytes =
+      FLAGS_kvstore_value_compression_min_bytes;
+  kvstoreOptions.enableAreaThreads = FLAGS_kvstore_enable_area_threads;
+  kvstoreOptions.snapshotDir = FLAGS_kvstore_snapshot_dir;
+  folly::split(
+      ",",
+      FLAGS_kvstore_priority_flood_key_markers,
+      kvstoreOptions.priorityFloodKeyMarkers,
+      true /* ignore empty */);
+
+  auto& kvstoreBudgets = kvstoreOptions.budgets;
+  kvstoreBudgets.maxKeys = std::max<int64_t>(FLAGS_kvstore_max_keys, 0);
+  kvstoreBudgets.maxBytes = std::max<int64_t>(FLAGS_kvstore_max_bytes, 0);
+  kvstoreBudgets.maxKeysPerOriginator =
+      std::max<int64_t>(FLAGS_kvstore_max_keys_per_originator, 0);
+  kvstoreBudgets.maxBytesPerOriginator =
+      std::max<int64_t>(FLAGS_kvstore_max_bytes_per_originator, 0);
+  kvstoreBudgets.maxUpdatesPerOriginatorPerSec =
+      FLAGS_kvstore_max_updates_per_originator_per_sec;
+  kvstoreBudgets.maxUpdateBurstPerOriginator =
+      FLAGS_kvstore_max_update_burst_per_originator;
+  folly::split(
+      ",",
+      FLAGS_kvstore_budget_exempt_key_markers,
+      kvstoreBudgets.exemptKeyMarkers,
+      true /* ignore empty */);
+
   KvStoreFloodRate kvstoreRate(std::make_pair(
       FLAGS_kvstore_flood_msg_per_sec, FLAGS_kvstore_flood_msg_burst_size));
   if (FLAGS_kvstore_flood_msg_per_sec <= 0 ||
       FLAGS_kvstore_flood_msg_burst_size <= 0) {
     kvstoreRate = std::nullopt;
   }
+  CHECK_LT(0, FLAGS_kvstore_flood_batch_bytes)
+      << "kvstore_flood_batch_bytes must be positive";
+  CHECK_LT(0, FLAGS_kvstore_peer_send_queue_bytes)
+      << "kvstore_peer_send_queue_bytes must be positive";
+
+  CHECK(apache::thrift::TEnumTraits<openr::thrift::CompressionType>::findValue(
+      FLAGS_kvstore_value_compression.c_str(),
+      &kvstoreOptions.valueCompression))
+      << "Unknown KvStore value compression: "
+      << FLAGS_kvstore_value_compression;
+
+  CHECK(apache::thrift::TEnumTraits<openr::thrift::PeerTransport>::findValue(
+      FLAGS_kvstore_peer_transport.c_str(), &kvstoreOptions.peerTransport))
+      << "Unknown KvStore peer transport: " << FLAGS_kvstore_peer_transport;
+
+  CHECK(apache::thrift::TEnumTraits<openr::thrift::HashVersion>::findValue(
+      FLAGS_kvstore_hash_version.c_str(), &kvstoreOptions.hashVersion))
+      << "Unknown KvStore hash version: " << FLAGS_kvstore_hash_version;
 
   std::unordered_set<std::string> areas{
       openr::thrift::KvStore_constants::kDefaultArea()};
@@ -469,32 +636,68 @@ main(int argc, char** argv) {
     areas = nodeAreas;
   }
 
-  // Start KVStore
-  auto kvStore = startEventBase(
+  // summary ranges of areas, as <prefix>@<area>
+  openr::AreaSummaries areaSummaries;
+  auto summaryList = folly::gen::split(FLAGS_area_summary_prefixes, ",") |
+      folly::gen::eachTo<std::string>() | folly::gen::as<std::vector>();
+  for (auto const& summary : summaryList) {
+    const auto pos = summary.rfind('@');
+    try {
+      if (pos == std::string::npos) {
+        throw std::invalid_argument("missing @<area>");
+      }
+      areaSummaries[summary.substr(pos + 1)].emplace_back(
+          toIpPrefix(summary.substr(0, pos)));
+    } catch (std::exception const& e) {
+      LOG(FATAL) << "Invalid --area_summary_prefixes entry " << summary << ": "
+                 << e.what();
+    }
+  }
+
+  // Decision subscribes before KvStore starts, so that it gets the key-values
+  // KvStore restores from its snapshot. So does PrefixManager, if it
+  // originates summaries
+  auto decisionKvStoreUpdatesReader = kvStoreUpdatesQueue.getReader();
+  std::optional<messaging::RQueue<openr::KvStorePublication>>
+      prefixManagerKvStoreUpdatesReader;
+  if (not areaSummaries.empty()) {
+    prefixManagerKvStoreUpdatesReader = kvStoreUpdatesQueue.getReader();
+  }
+
+  // Create KvStore while config-store loads
+  auto kvStoreModule = std::make_unique<KvStore>(
+      context,
+      FLAGS_node_name,
+      kvStoreUpdatesQueue,
+      peerUpdatesQueue.getReader(),
+      KvStoreGlobalCmdUrl{folly::sformat(
+          "tcp://{}:{}", FLAGS_listen_addr, FLAGS_kvstore_rep_port)},
+      monitorSubmitUrl,
+      maybeIpTos,
+      std::chrono::seconds(FLAGS_kvstore_sync_interval_s),
+      Constants::kMonitorSubmitInterval,
+      std::unordered_map<std::string, openr::thrift::PeerSpec>{},
+      std::move(kvFilters),
+      FLAGS_kvstore_zmq_hwm,
+      kvstoreRate,
+      std::chrono::milliseconds(FLAGS_kvstore_ttl_decrement_ms),
+      FLAGS_enable_flood_optimization,
+      FLAGS_is_flood_root,
+      FLAGS_use_flood_optimization,
+      areas,
+      std::move(kvstoreOptions));
+
+  // Start config-store, ahead of PrefixManager and LinkMonitor using it
+  auto configStore = startEventBase(
       allThreads,
       orderedEvbs,
       watchdog,
-      "KvStore",
-      std::make_unique<KvStore>(
-          context,
-          FLAGS_node_name,
-          kvStoreUpdatesQueue,
-          peerUpdatesQueue.getReader(),
-          KvStoreGlobalCmdUrl{folly::sformat(
-              "tcp://{}:{}", FLAGS_listen_addr, FLAGS_kvstore_rep_port)},
-          monitorSubmitUrl,
-          maybeIpTos,
-          std::chrono::seconds(FLAGS_kvstore_sync_interval_s),
-          Constants::kMonitorSubmitInterval,
-          std::unordered_map<std::string, openr::thrift::PeerSpec>{},
-          std::move(kvFilters),
-          FLAGS_kvstore_zmq_hwm,
-          kvstoreRate,
-          std::chrono::milliseconds(FLAGS_kvstore_ttl_decrement_ms),
-          FLAGS_enable_flood_optimization,
-          FLAGS_is_flood_root,
-          FLAGS_use_flood_optimization,
-          areas));
+      "ConfigStore",
+      configStoreFuture.get());
+
+  // Start KVStore
+  auto kvStore = startEventBase(
+      allThreads, orderedEvbs, watchdog, "KvStore", std::move(kvStoreModule));
 
   auto prefixManager = startEventBase(
       allThreads,
@@ -511,7 +714,13 @@ main(int argc, char** argv) {
           FLAGS_enable_perf_measurement,
           kvHoldTime,
           std::chrono::milliseconds(FLAGS_kvstore_key_ttl_ms),
-          areas));
+          areas,
+          Constants::kPrefixMgrPersistDebounce,
+          Constants::kPrefixMgrPersistMaxDelay,
+          FLAGS_enable_compact_lsdb_encoding,
+          areaSummaries,
+          std::move(prefixManagerKvStoreUpdatesReader),
+          FLAGS_prefix_key_bucket_size));
 
   // Prefix Allocator to automatically allocate prefixes for nodes
   if (FLAGS_enable_prefix_alloc) {
@@ -549,42 +758,70 @@ main(int argc, char** argv) {
             Constants::kPrefixAllocatorSyncInterval,
             configStore,
             context,
-            FLAGS_system_agent_port));
+            FLAGS_system_agent_port,
+            FLAGS_async_loopback_addr));
   }
 
-  // Create Spark instance for neighbor discovery
-  auto spark = startEventBase(
-      allThreads,
-      orderedEvbs,
-      watchdog,
-      "Spark",
-      std::make_unique<Spark>(
-          FLAGS_domain, // My domain
-          FLAGS_node_name, // myNodeName
-          static_cast<uint16_t>(FLAGS_spark_mcast_port),
-          std::chrono::seconds(FLAGS_spark_hold_time_s),
-          std::chrono::seconds(FLAGS_spark_keepalive_time_s),
-          std::chrono::milliseconds(FLAGS_spark_fastinit_keepalive_time_ms),
-          std::chrono::seconds(FLAGS_spark2_hello_time_s),
-          std::chrono::milliseconds(FLAGS_spark2_hello_fastinit_time_ms),
-          std::chrono::milliseconds(FLAGS_spark2_handshake_time_ms),
-          std::chrono::seconds(FLAGS_spark2_heartbeat_time_s),
-          std::chrono::seconds(FLAGS_spark2_negotiate_hold_time_s),
-          std::chrono::seconds(FLAGS_spark2_heartbeat_hold_time_s),
-          maybeIpTos,
-          FLAGS_enable_v4,
-          interfaceUpdatesQueue.getReader(),
-          neighborUpdatesQueue,
-          KvStoreCmdPort{static_cast<uint16_t>(FLAGS_kvstore_rep_port)},
-          OpenrCtrlThriftPort{static_cast<uint16_t>(FLAGS_openr_ctrl_port)},
-          std::make_pair(
-              Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
-          context,
-          std::make_shared<IoProvider>(),
-          FLAGS_enable_flood_optimization,
-          FLAGS_enable_spark2,
-          FLAGS_spark2_increase_hello_interval,
-          areas));
+  // Create Spark instances for neighbor discovery. The workers split the
+  // interfaces among them and share adjacency labels.
+  CHECK_GT(FLAGS_spark_num_workers, 0) << "Need at least one Spark worker";
+  auto sparkLabels = std::make_shared<folly::Synchronized<std::set<int32_t>>>();
+  for (int i = 0; i < FLAGS_spark_num_workers; ++i) {
+    SparkWorkerInfo workerInfo;
+    workerInfo.workerId = i;
+    workerInfo.numWorkers = FLAGS_spark_num_workers;
+    workerInfo.allocatedLabels = sparkLabels;
+    std::optional<LivenessConfig> livenessConfig;
+    if (FLAGS_spark_liveness_offload) {
+      livenessConfig = LivenessConfig{
+          static_cast<uint16_t>(FLAGS_spark_liveness_port + i),
+          std::chrono::milliseconds(FLAGS_spark_liveness_tx_interval_ms),
+          std::chrono::milliseconds(FLAGS_spark_liveness_hold_time_ms),
+          FLAGS_spark_liveness_thread_priority};
+    }
+    std::optional<AdaptiveHeartbeatConfig> adaptiveHeartbeatConfig;
+    if (FLAGS_spark2_heartbeat_stable_time_s > 0) {
+      CHECK_GE(FLAGS_spark2_heartbeat_max_pps, 0);
+      adaptiveHeartbeatConfig = AdaptiveHeartbeatConfig{
+          std::chrono::seconds(FLAGS_spark2_heartbeat_stable_time_s),
+          static_cast<uint32_t>(FLAGS_spark2_heartbeat_max_pps)};
+    }
+    startEventBase(
+        allThreads,
+        orderedEvbs,
+        watchdog,
+        i ? folly::sformat("Spark{}", i) : std::string("Spark"),
+        std::make_unique<Spark>(
+            FLAGS_domain, // My domain
+            FLAGS_node_name, // myNodeName
+            static_cast<uint16_t>(FLAGS_spark_mcast_port),
+            std::chrono::seconds(FLAGS_spark_hold_time_s),
+            std::chrono::seconds(FLAGS_spark_keepalive_time_s),
+            std::chrono::milliseconds(FLAGS_spark_fastinit_keepalive_time_ms),
+            std::chrono::seconds(FLAGS_spark2_hello_time_s),
+            std::chrono::milliseconds(FLAGS_spark2_hello_fastinit_time_ms),
+            std::chrono::milliseconds(FLAGS_spark2_handshake_time_ms),
+            std::chrono::seconds(FLAGS_spark2_heartbeat_time_s),
+            std::chrono::seconds(FLAGS_spark2_negotiate_hold_time_s),
+            std::chrono::seconds(FLAGS_spark2_heartbeat_hold_time_s),
+            maybeIpTos,
+            FLAGS_enable_v4,
+            interfaceUpdatesQueue.getReader(),
+            neighborUpdatesQueue,
+            KvStoreCmdPort{static_cast<uint16_t>(FLAGS_kvstore_rep_port)},
+            OpenrCtrlThriftPort{static_cast<uint16_t>(FLAGS_openr_ctrl_port)},
+            std::make_pair(
+                Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
+            context,
+            std::make_shared<IoProvider>(),
+            FLAGS_enable_flood_optimization,
+            FLAGS_enable_spark2,
+            FLAGS_spark2_increase_hello_interval,
+            areas,
+            std::move(workerInfo),
+            std::move(livenessConfig),
+            std::move(adaptiveHeartbeatConfig)));
+  }
 
   // Static list of prefixes to announce into the network as long as OpenR is
   // running.
@@ -670,6 +907,20 @@ main(int argc, char** argv) {
     LOG(FATAL) << "Regex compile failed";
   }
 
+  std::optional<MetricDampenerConfig> rttMetricDampening;
+  if (FLAGS_rtt_metric_dampening) {
+    rttMetricDampening = MetricDampenerConfig();
+    rttMetricDampening->penaltyPerChange = FLAGS_rtt_metric_dampening_penalty;
+    rttMetricDampening->suppressThreshold =
+        FLAGS_rtt_metric_dampening_suppress_threshold;
+    rttMetricDampening->reuseThreshold =
+        FLAGS_rtt_metric_dampening_reuse_threshold;
+    rttMetricDampening->halfLife =
+        std::chrono::seconds(FLAGS_rtt_metric_dampening_half_life_s);
+    rttMetricDampening->minRelativeChange =
+        FLAGS_rtt_metric_min_change_pct / 100.0;
+  }
+
   // Create link monitor instance.
   auto linkMonitor = startEventBase(
       allThreads,
@@ -704,7 +955,13 @@ main(int argc, char** argv) {
           std::chrono::milliseconds(FLAGS_link_flap_initial_backoff_ms),
           std::chrono::milliseconds(FLAGS_link_flap_max_backoff_ms),
           std::chrono::milliseconds(FLAGS_kvstore_key_ttl_ms),
-          areas));
+          areas,
+          FLAGS_per_adjacency_keys,
+          rttMetricDampening,
+          FLAGS_enable_compact_lsdb_encoding,
+          // events of an out-of-process agent come through platform_pub_url
+          eventPublisher ? std::make_optional(platformEventsQueue.getReader())
+                         : std::nullopt));
 
   // Wait for the above two threads to start and run before running
   // SPF in Decision module.  This is to make sure the Decision module
@@ -733,10 +990,14 @@ main(int argc, char** argv) {
           std::chrono::milliseconds(FLAGS_decision_debounce_min_ms),
           std::chrono::milliseconds(FLAGS_decision_debounce_max_ms),
           decisionGRWindow,
-          kvStoreUpdatesQueue.getReader(),
+          std::move(decisionKvStoreUpdatesReader),
           staticRoutesUpdateQueue.getReader(),
           routeUpdatesQueue,
-          context));
+          context,
+          std::max(0, FLAGS_decision_spf_threads),
+          std::max(0, FLAGS_decision_trace_spans),
+          std::max(0, FLAGS_decision_remote_lfa_spf_runs),
+          &routeStore));
 
   // FIB ordering works only in single area configuration
   // verify 'default area' is configured and it's the only one configured
@@ -744,6 +1005,56 @@ main(int argc, char** argv) {
     CHECK_EQ(areas.count(openr::thrift::KvStore_constants::kDefaultArea()), 1);
     CHECK_EQ(areas.size(), 1);
   }
+  CHECK_GE(FLAGS_fib_sync_chunk_size, 0)
+      << "fib_sync_chunk_size must not be negative";
+  FibOptions fibOptions;
+  fibOptions.syncChunkSize = FLAGS_fib_sync_chunk_size;
+  fibOptions.enableNextHopGroups = FLAGS_enable_fib_nexthop_groups;
+  fibOptions.gracefulRestart = FLAGS_enable_fib_graceful_restart;
+  fibOptions.routeStore = &routeStore;
+  fibOptions.fibHandler =
+      FLAGS_enable_fib_in_process_agent ? netlinkFibHandler : nullptr;
+  fibOptions.fibUpdatesQueue = &fibUpdatesQueue;
+
+  // Prefixes whose routes Fib programs first
+  {
+    std::vector<std::string> prefixes;
+    folly::split(
+        ",", FLAGS_fib_critical_prefixes, prefixes, true /* ignore empty */);
+    for (auto const& prefix : prefixes) {
+      auto network = folly::IPAddress::tryCreateNetwork(prefix);
+      if (network.hasError()) {
+        LOG(FATAL) << "Invalid critical prefix of Fib: " << prefix;
+      }
+      fibOptions.criticalPrefixes.emplace_back(network.value());
+    }
+  }
+
+  // Download policy of Fib, routes it programs
+  {
+    std::vector<std::string> prefixes;
+    folly::split(
+        ",", FLAGS_fib_download_prefixes, prefixes, true /* ignore empty */);
+    for (auto const& prefix : prefixes) {
+      auto network = folly::IPAddress::tryCreateNetwork(prefix);
+      if (network.hasError()) {
+        LOG(FATAL) << "Invalid download prefix of Fib: " << prefix;
+      }
+      fibOptions.downloadPrefixes.emplace_back(network.value());
+    }
+    std::vector<std::string> types;
+    folly::split(
+        ",", FLAGS_fib_download_prefix_types, types, true /* ignore empty */);
+    for (auto const& type : types) {
+      openr::thrift::PrefixType prefixType;
+      if (not apache::thrift::TEnumTraits<openr::thrift::PrefixType>::
+              findValue(type.c_str(), &prefixType)) {
+        LOG(FATAL) << "Invalid download prefix type of Fib: " << type;
+      }
+      fibOptions.downloadPrefixTypes.emplace_back(prefixType);
+    }
+  }
+
   // Define and start Fib Module
   auto fib = startEventBase(
       allThreads,
@@ -762,7 +1073,11 @@ main(int argc, char** argv) {
           interfaceUpdatesQueue.getReader(),
           monitorSubmitUrl,
           kvStore,
-          context));
+          context,
+          std::move(fibOptions)));
+
+  fb303::fbData->setCounter(
+      "startup.modules_ready_ms", getProcessUptime().count());
 
   // Start OpenrCtrl thrift server
   apache::thrift::ThriftServer thriftCtrlServer;
@@ -821,7 +1136,9 @@ main(int argc, char** argv) {
         configStore,
         prefixManager,
         monitorSubmitUrl,
-        context);
+        context,
+        std::chrono::milliseconds(FLAGS_ctrl_counters_cache_ms),
+        fibUpdatesQueue.getReader());
   });
 
   CHECK(ctrlHandler);
@@ -861,6 +1178,8 @@ main(int argc, char** argv) {
   prefixUpdatesQueue.close();
   kvStoreUpdatesQueue.close();
   staticRoutesUpdateQueue.close();
+  platformEventsQueue.close();
+  fibUpdatesQueue.close();
 
   thriftCtrlServer.stop();
   ctrlHandler.reset();
@@ -892,6 +1211,7 @@ main(int argc, char** argv) {
     netlinkFibServerThread->join();
     netlinkFibServerThread.reset();
     netlinkFibServer.reset();
+    netlinkFibHandler.reset();
   }
   if (netlinkSystemServer) {
     CHECK(netlinkSystemServerThread);
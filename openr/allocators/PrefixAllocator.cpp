@@ -10,6 +10,7 @@
 #include <exception>
 
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Conv.h>
 #include <folly/Format.h>
 #include <folly/Random.h>
 #include <folly/ScopeGuard.h>
@@ -49,7 +50,8 @@ PrefixAllocator::PrefixAllocator(
     std::chrono::milliseconds syncInterval,
     PersistentStore* configStore,
     fbzmq::Context& zmqContext,
-    int32_t systemServicePort)
+    int32_t systemServicePort,
+    bool asyncAddrProgramming)
     : myNodeName_(myNodeName),
       allocPrefixMarker_(allocPrefixMarker),
       setLoopbackAddress_(setLoopbackAddress),
@@ -61,14 +63,31 @@ PrefixAllocator::PrefixAllocator(
       configStore_(configStore),
       prefixUpdatesQueue_(prefixUpdatesQueue),
       zmqMonitorClient_(zmqContext, monitorSubmitUrl),
-      systemServicePort_(systemServicePort) {
+      systemServicePort_(systemServicePort),
+      asyncAddrProgramming_(asyncAddrProgramming) {
   // check non-empty module ptr
   CHECK(configStore_);
   CHECK(kvStore_);
 
-  // Create KvStore client
-  kvStoreClient_ =
-      std::make_unique<KvStoreClientInternal>(this, myNodeName_, kvStore_);
+  // Create KvStore client, receiving updates of allocation keys only
+  kvStoreClient_ = std::make_unique<KvStoreClientInternal>(
+      this,
+      myNodeName_,
+      kvStore_,
+      60000ms /* checkPersistKeyPeriod */,
+      0ms /* setKeysBatchWindow */,
+      std::vector<std::string>{
+          allocPrefixMarker_,
+          Constants::kSeedPrefixAllocParamKey.str(),
+          Constants::kStaticPrefixAllocParamKey.str()});
+
+  // Keep track of claimed prefix indices from publications
+  kvStoreClient_->setKvCallback(
+      [this](
+          std::string const& key,
+          std::optional<thrift::Value> value) noexcept {
+        processAllocPrefixUpdate(key, value);
+      });
 
   // Let the magic begin. Start allocation as per allocMode
   std::visit(*this, allocMode);
@@ -239,6 +258,26 @@ PrefixAllocator::getMyPrefixIndex() {
   return std::move(future).get();
 }
 
+std::unordered_map<uint32_t, uint32_t>
+PrefixAllocator::getE2eAllocIndex() {
+  folly::Promise<std::unordered_map<uint32_t, uint32_t>> promise;
+  auto future = promise.getFuture();
+  runInEventBaseThread([this, promise = std::move(promise)]() mutable {
+    promise.setValue(e2eAllocIndex_);
+  });
+  return std::move(future).get();
+}
+
+std::unordered_map<uint32_t, std::string>
+PrefixAllocator::getAllocIndexOwners() {
+  folly::Promise<std::unordered_map<uint32_t, std::string>> promise;
+  auto future = promise.getFuture();
+  runInEventBaseThread([this, promise = std::move(promise)]() mutable {
+    promise.setValue(allocIndexOwners_);
+  });
+  return std::move(future).get();
+}
+
 folly::Expected<PrefixAllocatorParams, fbzmq::Error>
 PrefixAllocator::parseParamsStr(const std::string& paramStr) noexcept {
   // Parse string to get seed-prefix and alloc-prefix-length
@@ -338,53 +377,154 @@ PrefixAllocator::processAllocParamUpdate(thrift::Value const& value) {
 
 bool
 PrefixAllocator::checkE2eAllocIndex(uint32_t index) {
-  return (e2eAllocIndex_.second.find(index) != e2eAllocIndex_.second.end());
+  return e2eAllocIndex_.count(index) != 0;
+}
+
+void
+PrefixAllocator::addE2eAllocIndex(thrift::IpPrefix const& prefix) {
+  if (!allocParams_.has_value()) {
+    return;
+  }
+  const auto pfix = toIPNetwork(prefix);
+  const auto index = bitStrValue(
+      pfix.first, allocParams_->first.second, allocParams_->second - 1);
+  ++e2eAllocIndex_[index];
+}
+
+void
+PrefixAllocator::removeE2eAllocIndex(thrift::IpPrefix const& prefix) {
+  if (!allocParams_.has_value()) {
+    return;
+  }
+  const auto pfix = toIPNetwork(prefix);
+  const auto index = bitStrValue(
+      pfix.first, allocParams_->first.second, allocParams_->second - 1);
+  auto it = e2eAllocIndex_.find(index);
+  if (it != e2eAllocIndex_.end() and --it->second == 0) {
+    e2eAllocIndex_.erase(it);
+  }
+}
+
+void
+PrefixAllocator::rebuildE2eAllocIndex() {
+  e2eAllocIndex_.clear();
+  try {
+    for (auto const& kv : e2eNodePrefixes_) {
+      addE2eAllocIndex(kv.second);
+    }
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Error computing static prefix allocation index. Error: "
+               << folly::exceptionStr(e);
+  }
 }
 
 void
 PrefixAllocator::processNetworkAllocationsUpdate(
     thrift::Value const& e2eValue) {
   CHECK(e2eValue.value.has_value());
-  if (!allocParams_.has_value()) {
+  /* skip if same version */
+  if (e2eAllocVersion_ == e2eValue.version) {
     return;
   }
-  uint32_t allocPrefixLen = allocParams_->second;
-  uint32_t prefixLen = allocParams_->first.second;
 
   thrift::StaticAllocation staticAlloc;
   try {
     staticAlloc = fbzmq::util::readThriftObjStr<thrift::StaticAllocation>(
         *e2eValue.value, serializer_);
-    /* skip if same version */
-    if (e2eAllocIndex_.first == e2eValue.version) {
-      return;
-    }
-    LOG(INFO) << folly::sformat(
-        "Updating prefix index from {}",
-        Constants::kStaticPrefixAllocParamKey.toString());
-    e2eAllocIndex_.second.clear();
-    e2eAllocIndex_.first = e2eValue.version;
-    // extract prefix index from e2e network allocations
-    for (auto const& ip : staticAlloc.nodePrefixes) {
-      const auto pfix = toIPNetwork(ip.second);
-      auto index = bitStrValue(pfix.first, prefixLen, allocPrefixLen - 1);
-      e2eAllocIndex_.second.emplace(index);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Error parsing static prefix allocation value. Error: "
+               << folly::exceptionStr(e);
+    return;
+  }
+  LOG(INFO) << folly::sformat(
+      "Updating prefix index from {}",
+      Constants::kStaticPrefixAllocParamKey.toString());
+  e2eAllocVersion_ = e2eValue.version;
+
+  // apply changed node prefixes only. Prefixes are kept even without params,
+  // indices get computed once params are known
+  try {
+    for (auto it = e2eNodePrefixes_.begin(); it != e2eNodePrefixes_.end();) {
+      if (staticAlloc.nodePrefixes.count(it->first)) {
+        ++it;
+        continue;
+      }
+      removeE2eAllocIndex(it->second);
+      it = e2eNodePrefixes_.erase(it);
     }
-    // collision after the update, restart allocation process
-    if (myPrefixIndex_.has_value() &&
-        e2eAllocIndex_.second.find(myPrefixIndex_.value()) !=
-            e2eAllocIndex_.second.end()) {
-      LOG(INFO) << folly::sformat(
-          "Index {} exits in {}, restarting prefix allocator",
-          myPrefixIndex_.value(),
-          Constants::kStaticPrefixAllocParamKey.toString());
-      startAllocation(allocParams_, false);
+    for (auto const& kv : staticAlloc.nodePrefixes) {
+      auto it = e2eNodePrefixes_.find(kv.first);
+      if (it == e2eNodePrefixes_.end()) {
+        it = e2eNodePrefixes_.emplace(kv.first, kv.second).first;
+      } else if (it->second == kv.second) {
+        continue;
+      } else {
+        removeE2eAllocIndex(it->second);
+        it->second = kv.second;
+      }
+      addE2eAllocIndex(it->second);
     }
   } catch (std::exception const& e) {
-    LOG(ERROR) << "Error parsing static prefix allocation value. Error: "
+    LOG(ERROR) << "Error processing static prefix allocation value. Error: "
                << folly::exceptionStr(e);
+    // start over with next update
+    e2eAllocVersion_ = -1;
+    e2eNodePrefixes_.clear();
+    e2eAllocIndex_.clear();
+    return;
+  }
+
+  // collision after the update, restart allocation process
+  if (myPrefixIndex_.has_value() && checkE2eAllocIndex(*myPrefixIndex_)) {
+    LOG(INFO) << folly::sformat(
+        "Index {} exits in {}, restarting prefix allocator",
+        myPrefixIndex_.value(),
+        Constants::kStaticPrefixAllocParamKey.toString());
+    startAllocation(allocParams_, false);
+  }
+}
+
+void
+PrefixAllocator::processAllocPrefixUpdate(
+    std::string const& key, std::optional<thrift::Value> const& value) {
+  if (not folly::StringPiece(key).startsWith(allocPrefixMarker_)) {
+    return;
+  }
+
+  if (not value.has_value()) {
+    // expired, index is encoded in the key
+    const auto maybeIndex = folly::tryTo<uint32_t>(
+        folly::StringPiece(key).subpiece(allocPrefixMarker_.size()));
+    if (maybeIndex.hasValue()) {
+      allocIndexOwners_.erase(*maybeIndex);
+    }
+    return;
+  }
+
+  if (not value->value.has_value() or
+      value->value->size() != sizeof(uint32_t)) {
     return;
   }
+  const auto index = details::binaryToPrimitive<uint32_t>(*value->value);
+  allocIndexOwners_[index] = value->originatorId;
+}
+
+void
+PrefixAllocator::syncAllocIndexOwners() {
+  if (allocIndexOwnersSynced_) {
+    return;
+  }
+  const auto maybeKeyMap =
+      kvStoreClient_->dumpAllWithPrefix(allocPrefixMarker_, area_);
+  if (not maybeKeyMap.has_value()) {
+    LOG(ERROR) << "Failed to dump keys with prefix: " << allocPrefixMarker_
+               << " from KvStore, area: " << area_;
+    return;
+  }
+  for (auto const& kv : *maybeKeyMap) {
+    processAllocPrefixUpdate(kv.first, kv.second);
+  }
+  allocIndexOwnersSynced_ = true;
 }
 
 uint32_t
@@ -516,11 +656,17 @@ PrefixAllocator::startAllocation(
     applyMyPrefixIndex(std::nullopt); // Clear local state
   }
   CHECK(!myPrefixIndex_.has_value());
+  const bool paramsChanged = allocParams_ != allocParams;
   allocParams_ = allocParams;
+  if (paramsChanged) {
+    // indices depend on params, no need to re-read the allocation
+    rebuildE2eAllocIndex();
+  }
 
   if (!allocParams_.has_value()) {
     return;
   }
+  syncAllocIndexOwners();
 
   // create range allocator to get unique prefixes
   rangeAllocator_ = std::make_unique<RangeAllocator<uint32_t>>(
@@ -539,7 +685,9 @@ PrefixAllocator::startAllocation(
         return checkE2eAllocIndex(allocIndex);
       },
       Constants::kRangeAllocTtl,
-      area_);
+      area_,
+      1 /* claim batch size */,
+      &allocIndexOwners_);
 
   // start range allocation
   LOG(INFO) << "Starting prefix allocation with seed prefix: "
@@ -606,6 +754,10 @@ PrefixAllocator::applyMyPrefix() {
   if (!applyState_.first) {
     return;
   }
+  if (asyncAddrProgramming_) {
+    applyMyPrefixAsync();
+    return;
+  }
   try {
     if (applyState_.second) {
       updateMyPrefix(*applyState_.second);
@@ -627,12 +779,79 @@ PrefixAllocator::applyMyPrefix() {
   }
 }
 
+void
+PrefixAllocator::applyMyPrefixAsync() {
+  // applied once more when the one in flight is done
+  if (applyInFlight_) {
+    return;
+  }
+  applyInFlight_ = true;
+  applyState_.first = false;
+
+  const auto prefix = applyState_.second;
+  if (prefix) {
+    announceMyPrefix(*prefix);
+  } else {
+    withdrawMyPrefixAnnouncement();
+  }
+
+  programLoopbackAddrsAsync(prefix).thenTry(
+      [this, prefix](folly::Try<folly::Unit>&& result) {
+        applyInFlight_ = false;
+        if (result.hasException()) {
+          asyncClient_.reset();
+          applyState_.first = true;
+          LOG(ERROR) << "Apply prefix failed, will retry in "
+                     << Constants::kPrefixAllocatorRetryInterval.count()
+                     << " ms address: "
+                     << (prefix.has_value()
+                             ? folly::IPAddress::networkToString(*prefix)
+                             : "none")
+                     << ". " << result.exception().what();
+          scheduleTimeout(
+              Constants::kPrefixAllocatorRetryInterval, [this]() noexcept {
+                applyMyPrefix();
+              });
+          return;
+        }
+        // prefix may have changed while in flight
+        applyMyPrefix();
+      });
+}
+
 void
 PrefixAllocator::updateMyPrefix(folly::CIDRNetwork prefix) {
   CHECK(allocParams_.has_value()) << "Alloc parameters are not set.";
+  announceMyPrefix(prefix);
+
+  if (not setLoopbackAddress_) {
+    return;
+  }
+
+  // existing global prefixes
+  std::vector<folly::CIDRNetwork> oldPrefixes;
+  getIfacePrefixes(loopbackIfaceName_, prefix.first.family(), oldPrefixes);
+
+  auto delta = getLoopbackAddrsDelta(
+      prefix, oldPrefixes, allocParams_->first, overrideGlobalAddress_);
+  if (delta.toAdd.empty() and delta.toDelete.empty()) {
+    LOG(INFO) << "Prefix not changed";
+    return;
+  }
+
+  // Do add first, because in Linux deleting the only IP will cause if down.
+  if (not delta.toAdd.empty()) {
+    addIfaceAddrs(loopbackIfaceName_, delta.toAdd);
+  }
+  if (not delta.toDelete.empty()) {
+    delIfaceAddrs(loopbackIfaceName_, delta.toDelete);
+  }
+}
+
+void
+PrefixAllocator::announceMyPrefix(folly::CIDRNetwork const& prefix) {
   // replace previously allocated prefix with newly allocated one in
   // PrefixManager
-
   auto prefixEntry = openr::thrift::PrefixEntry();
   prefixEntry.prefix = toIpPrefix(prefix);
   prefixEntry.type = openr::thrift::PrefixType::PREFIX_ALLOCATOR;
@@ -650,63 +869,39 @@ PrefixAllocator::updateMyPrefix(folly::CIDRNetwork prefix) {
   request.type = openr::thrift::PrefixType::PREFIX_ALLOCATOR;
   request.prefixes = {prefixEntry};
   prefixUpdatesQueue_.push(std::move(request));
+}
 
-  // existing global prefixes
-  std::vector<folly::CIDRNetwork> oldPrefixes;
-  getIfacePrefixes(loopbackIfaceName_, prefix.first.family(), oldPrefixes);
-
-  // desired global prefixes
-  auto loopbackPrefix = createLoopbackPrefix(prefix);
-  std::vector<folly::CIDRNetwork> toSyncPrefixes{loopbackPrefix};
-
-  // get a list of prefixes need to be deleted
-  std::vector<folly::CIDRNetwork> toDeletePrefixes;
-  std::set_difference(
-      oldPrefixes.begin(),
-      oldPrefixes.end(),
-      toSyncPrefixes.begin(),
-      toSyncPrefixes.end(),
-      std::inserter(toDeletePrefixes, toDeletePrefixes.begin()));
-
-  if (toDeletePrefixes.empty() && !oldPrefixes.empty()) {
-    LOG(INFO) << "Prefix not changed";
-    return;
-  }
-
-  // delete unwanted global prefixes
-  for (const auto& toDeletePrefix : toDeletePrefixes) {
-    bool needToDelete = false;
-    if (toDeletePrefix.first.inSubnet(
-            allocParams_->first.first, allocParams_->first.second)) {
-      // delete existing prefix in the subnet as seedPrefix
-      needToDelete = true;
-    } else if (overrideGlobalAddress_ and !toDeletePrefix.first.isLinkLocal()) {
-      // delete non-link-local addresses
-      needToDelete = true;
-    }
-
-    if (!needToDelete or !setLoopbackAddress_) {
-      toSyncPrefixes.emplace_back(toDeletePrefix);
+PrefixAllocator::LoopbackAddrsDelta
+PrefixAllocator::getLoopbackAddrsDelta(
+    folly::CIDRNetwork const& prefix,
+    std::vector<folly::CIDRNetwork> const& oldPrefixes,
+    folly::CIDRNetwork const& seedPrefix,
+    bool overrideGlobalAddress) {
+  LoopbackAddrsDelta delta;
+  const auto loopbackPrefix = createLoopbackPrefix(prefix);
+  bool isAssigned{false};
+  for (const auto& oldPrefix : oldPrefixes) {
+    if (oldPrefix == loopbackPrefix) {
+      isAssigned = true;
       continue;
     }
-
-    LOG(INFO) << "Will delete address "
-              << folly::IPAddress::networkToString(toDeletePrefix)
-              << " on interface " << loopbackIfaceName_;
+    // delete existing prefix in the subnet as seedPrefix, and with
+    // overrideGlobalAddress all non-link-local addresses
+    if (oldPrefix.first.inSubnet(seedPrefix.first, seedPrefix.second) or
+        (overrideGlobalAddress and !oldPrefix.first.isLinkLocal())) {
+      LOG(INFO) << "Will delete address "
+                << folly::IPAddress::networkToString(oldPrefix)
+                << " from loopback interface";
+      delta.toDelete.emplace_back(oldPrefix);
+    }
   }
-
-  // Assign new address to loopback
-  if (setLoopbackAddress_) {
+  if (not isAssigned) {
     LOG(INFO) << "Assigning address: "
               << folly::IPAddress::networkToString(loopbackPrefix)
-              << " on interface " << loopbackIfaceName_;
-    toSyncPrefixes.emplace_back(loopbackPrefix);
-    syncIfaceAddrs(
-        loopbackIfaceName_,
-        prefix.first.family(),
-        RT_SCOPE_UNIVERSE,
-        toSyncPrefixes);
+              << " on loopback interface";
+    delta.toAdd.emplace_back(loopbackPrefix);
   }
+  return delta;
 }
 
 void
@@ -718,14 +913,21 @@ PrefixAllocator::withdrawMyPrefix() {
 
     if (overrideGlobalAddress_) {
       std::vector<folly::CIDRNetwork> addrs;
-      const auto& prefix = allocParams_->first;
-      syncIfaceAddrs(
-          loopbackIfaceName_, prefix.first.family(), RT_SCOPE_UNIVERSE, addrs);
+      getIfacePrefixes(
+          loopbackIfaceName_, allocParams_->first.first.family(), addrs);
+      if (not addrs.empty()) {
+        delIfaceAddrs(loopbackIfaceName_, addrs);
+      }
     } else {
-      delIfaceAddr(loopbackIfaceName_, allocParams_->first);
+      delIfaceAddrs(loopbackIfaceName_, {allocParams_->first});
     }
   }
 
+  withdrawMyPrefixAnnouncement();
+}
+
+void
+PrefixAllocator::withdrawMyPrefixAnnouncement() {
   // withdraw prefix via prefixMgrClient
   thrift::PrefixUpdateRequest request;
   request.cmd = thrift::PrefixUpdateCommand::WITHDRAW_PREFIXES_BY_TYPE;
@@ -748,10 +950,8 @@ PrefixAllocator::getIfacePrefixes(
 }
 
 void
-PrefixAllocator::syncIfaceAddrs(
+PrefixAllocator::addIfaceAddrs(
     const std::string& ifName,
-    int family,
-    int scope,
     const std::vector<folly::CIDRNetwork>& prefixes) {
   createThriftClient(evb_, socket_, client_, systemServicePort_);
 
@@ -760,31 +960,106 @@ PrefixAllocator::syncIfaceAddrs(
     addrs.emplace_back(toIpPrefix(prefix));
   }
   try {
-    client_->sync_syncIfaceAddresses(ifName, family, scope, addrs);
+    client_->sync_addIfaceAddresses(ifName, addrs);
   } catch (const std::exception& ex) {
     client_.reset();
-    LOG(ERROR) << "PrefixAllocator sync IfAddress failed";
+    LOG(ERROR) << "PrefixAllocator add IfAddress failed";
     throw;
   }
 }
 
 void
-PrefixAllocator::delIfaceAddr(
-    const std::string& ifName, const folly::CIDRNetwork& prefix) {
+PrefixAllocator::delIfaceAddrs(
+    const std::string& ifName,
+    const std::vector<folly::CIDRNetwork>& prefixes) {
   createThriftClient(evb_, socket_, client_, systemServicePort_);
 
   std::vector<thrift::IpPrefix> addrs;
-  addrs.emplace_back(toIpPrefix(prefix));
+  for (const auto& prefix : prefixes) {
+    addrs.emplace_back(toIpPrefix(prefix));
+  }
   try {
     client_->sync_removeIfaceAddresses(ifName, addrs);
   } catch (const std::exception& ex) {
     client_.reset();
-    LOG(ERROR) << "PrefixAllocator del IfAddress failed: "
-               << folly::IPAddress::networkToString(prefix);
+    LOG(ERROR) << "PrefixAllocator del IfAddress failed";
     throw;
   }
 }
 
+folly::Future<folly::Unit>
+PrefixAllocator::programLoopbackAddrsAsync(
+    std::optional<folly::CIDRNetwork> prefix) {
+  if (not setLoopbackAddress_ or not allocParams_.has_value()) {
+    return folly::makeFuture();
+  }
+  if (not prefix and not overrideGlobalAddress_) {
+    LoopbackAddrsDelta delta;
+    delta.toDelete.emplace_back(allocParams_->first);
+    return programIfaceAddrsAsync(std::move(delta));
+  }
+
+  const auto family = prefix ? prefix->first.family()
+                             : allocParams_->first.first.family();
+  createThriftClient(*getEvb(), asyncSocket_, asyncClient_, systemServicePort_);
+  return asyncClient_
+      ->semifuture_getIfaceAddresses(
+          loopbackIfaceName_, family, RT_SCOPE_UNIVERSE)
+      .via(getEvb())
+      .thenValue([this, prefix](std::vector<thrift::IpPrefix>&& addrs) {
+        std::vector<folly::CIDRNetwork> oldPrefixes;
+        for (const auto& addr : addrs) {
+          oldPrefixes.emplace_back(toIPNetwork(addr));
+        }
+        if (prefix) {
+          return programIfaceAddrsAsync(getLoopbackAddrsDelta(
+              *prefix,
+              oldPrefixes,
+              allocParams_->first,
+              overrideGlobalAddress_));
+        }
+        // flush all global addresses
+        LoopbackAddrsDelta delta;
+        delta.toDelete = std::move(oldPrefixes);
+        return programIfaceAddrsAsync(std::move(delta));
+      });
+}
+
+folly::Future<folly::Unit>
+PrefixAllocator::programIfaceAddrsAsync(LoopbackAddrsDelta delta) {
+  if (delta.toAdd.empty() and delta.toDelete.empty()) {
+    LOG(INFO) << "Prefix not changed";
+    return folly::makeFuture();
+  }
+  auto toThrift = [](std::vector<folly::CIDRNetwork> const& prefixes) {
+    std::vector<thrift::IpPrefix> addrs;
+    for (const auto& prefix : prefixes) {
+      addrs.emplace_back(toIpPrefix(prefix));
+    }
+    return addrs;
+  };
+
+  // Do add first, because in Linux deleting the only IP will cause if down.
+  createThriftClient(*getEvb(), asyncSocket_, asyncClient_, systemServicePort_);
+  auto added = delta.toAdd.empty()
+      ? folly::makeFuture()
+      : asyncClient_
+            ->semifuture_addIfaceAddresses(
+                loopbackIfaceName_, toThrift(delta.toAdd))
+            .via(getEvb());
+  if (delta.toDelete.empty()) {
+    return added;
+  }
+  return std::move(added).thenValue(
+      [this, toDelete = toThrift(delta.toDelete)](folly::Unit) {
+        createThriftClient(
+            *getEvb(), asyncSocket_, asyncClient_, systemServicePort_);
+        return asyncClient_
+            ->semifuture_removeIfaceAddresses(loopbackIfaceName_, toDelete)
+            .via(getEvb());
+      });
+}
+
 void
 PrefixAllocator::logPrefixEvent(
     std::string event,
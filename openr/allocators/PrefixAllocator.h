@@ -9,12 +9,15 @@
 
 #include <chrono>
 #include <functional>
+#include <map>
 #include <string>
+#include <unordered_map>
 
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <folly/IPAddress.h>
 #include <folly/Optional.h>
+#include <folly/futures/Future.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/EventBase.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
@@ -81,7 +84,9 @@ class PrefixAllocator : public OpenrEventBase {
       std::chrono::milliseconds syncInterval,
       PersistentStore* configStore,
       fbzmq::Context& zmqContext,
-      int32_t systemServicePort);
+      int32_t systemServicePort,
+      // program loopback addresses without blocking the allocator thread
+      bool asyncAddrProgramming = false);
 
   PrefixAllocator(PrefixAllocator const&) = delete;
   PrefixAllocator& operator=(PrefixAllocator const&) = delete;
@@ -97,6 +102,12 @@ class PrefixAllocator : public OpenrEventBase {
   // Thread safe API for testing only
   std::optional<uint32_t> getMyPrefixIndex();
 
+  // Thread safe API for testing only, alloc indices of
+  // e2e-network-allocation with their number of nodes, and claimed alloc
+  // indices with their owners
+  std::unordered_map<uint32_t, uint32_t> getE2eAllocIndex();
+  std::unordered_map<uint32_t, std::string> getAllocIndexOwners();
+
   // Static function to parse string representation of allocation params to
   // strong types.
   static folly::Expected<PrefixAllocatorParams, fbzmq::Error> parseParamsStr(
@@ -106,6 +117,21 @@ class PrefixAllocator : public OpenrEventBase {
   static uint32_t getPrefixCount(
       PrefixAllocatorParams const& allocParams) noexcept;
 
+  // changes of loopback addresses, additions get programmed first
+  struct LoopbackAddrsDelta {
+    std::vector<folly::CIDRNetwork> toAdd;
+    std::vector<folly::CIDRNetwork> toDelete;
+  };
+
+  // Static function to get changes of loopback addresses to assign prefix,
+  // allocated from seedPrefix, given existing ones. With
+  // overrideGlobalAddress all other global addresses get deleted too
+  static LoopbackAddrsDelta getLoopbackAddrsDelta(
+      folly::CIDRNetwork const& prefix,
+      std::vector<folly::CIDRNetwork> const& oldPrefixes,
+      folly::CIDRNetwork const& seedPrefix,
+      bool overrideGlobalAddress);
+
  private:
   //
   // Private methods
@@ -117,12 +143,28 @@ class PrefixAllocator : public OpenrEventBase {
   //  Function to process allocation param update from kvstore
   void processAllocParamUpdate(thrift::Value const& value);
 
-  // calculate and save alloc index obtained from e2e-network-allocation
+  // calculate and save alloc index obtained from e2e-network-allocation,
+  // applying only changed node prefixes
   void processNetworkAllocationsUpdate(thrift::Value const& value);
 
   // check if index is already in use by e2e-network-allocations
   bool checkE2eAllocIndex(uint32_t index);
 
+  // add/remove index of e2e-network-allocation prefix for current params
+  void addE2eAllocIndex(thrift::IpPrefix const& prefix);
+  void removeE2eAllocIndex(thrift::IpPrefix const& prefix);
+
+  // recompute indices of e2e-network-allocation prefixes on params change
+  void rebuildE2eAllocIndex();
+
+  // update index of claimed prefix indices from a publication of
+  // allocation key
+  void processAllocPrefixUpdate(
+      std::string const& key, std::optional<thrift::Value> const& value);
+
+  // seed index of claimed prefix indices from KvStore, one time only
+  void syncAllocIndexOwners();
+
   // get my existing prefix index from kvstore if it's present
   std::optional<uint32_t> loadPrefixIndexFromKvStore();
 
@@ -146,12 +188,25 @@ class PrefixAllocator : public OpenrEventBase {
   void applyMyPrefixIndex(std::optional<uint32_t> prefixIndex);
   void applyMyPrefix();
 
+  // apply prefix with requests to system service in flight while the
+  // allocator goes on, at most one at a time
+  void applyMyPrefixAsync();
+
   // update prefix
   void updateMyPrefix(folly::CIDRNetwork prefix);
 
   // withdraw prefix
   void withdrawMyPrefix();
 
+  // announce or withdraw prefix to PrefixManager
+  void announceMyPrefix(folly::CIDRNetwork const& prefix);
+  void withdrawMyPrefixAnnouncement();
+
+  // program loopback addresses of prefix, or flush them if not set
+  folly::Future<folly::Unit> programLoopbackAddrsAsync(
+      std::optional<folly::CIDRNetwork> prefix);
+  folly::Future<folly::Unit> programIfaceAddrsAsync(LoopbackAddrsDelta delta);
+
   void logPrefixEvent(
       std::string event,
       std::optional<uint32_t> oldPrefix,
@@ -159,14 +214,13 @@ class PrefixAllocator : public OpenrEventBase {
       std::optional<PrefixAllocatorParams> const& oldParams = std::nullopt,
       std::optional<PrefixAllocatorParams> const& newParams = std::nullopt);
 
-  void syncIfaceAddrs(
+  void addIfaceAddrs(
       const std::string& ifName,
-      int family,
-      int scope,
       const std::vector<folly::CIDRNetwork>& prefixes);
 
-  void delIfaceAddr(
-      const std::string& ifName, const folly::CIDRNetwork& prefix);
+  void delIfaceAddrs(
+      const std::string& ifName,
+      const std::vector<folly::CIDRNetwork>& prefixes);
 
   void getIfacePrefixes(
       const std::string& iface,
@@ -240,6 +294,15 @@ class PrefixAllocator : public OpenrEventBase {
   std::shared_ptr<folly::AsyncSocket> socket_{nullptr};
   std::unique_ptr<thrift::SystemServiceAsyncClient> client_{nullptr};
 
+  // Thriftclient for system service on my event base, for asynchronous
+  // requests
+  const bool asyncAddrProgramming_{false};
+  std::shared_ptr<folly::AsyncSocket> asyncSocket_{nullptr};
+  std::unique_ptr<thrift::SystemServiceAsyncClient> asyncClient_{nullptr};
+
+  // asynchronous apply of prefix in flight
+  bool applyInFlight_{false};
+
   // AsyncTimeout for initialization
   std::unique_ptr<folly::AsyncTimeout> initTimer_;
 
@@ -251,8 +314,19 @@ class PrefixAllocator : public OpenrEventBase {
    */
   std::pair<bool, std::optional<folly::CIDRNetwork>> applyState_;
 
-  // save alloc index from e2e-network-alllocation <value version, indices set>
-  std::pair<int64_t, std::unordered_set<uint32_t>> e2eAllocIndex_{-1, {}};
+  // version of last processed e2e-network-allocation
+  int64_t e2eAllocVersion_{-1};
+
+  // node prefixes of e2e-network-allocation, kept to apply updates as delta
+  std::map<std::string, thrift::IpPrefix> e2eNodePrefixes_;
+
+  // alloc index from e2e-network-allocation => number of nodes using it
+  std::unordered_map<uint32_t, uint32_t> e2eAllocIndex_;
+
+  // claimed prefix index => originator of the allocation key, maintained
+  // from publications and shared with range allocator
+  std::unordered_map<uint32_t, std::string> allocIndexOwners_;
+  bool allocIndexOwnersSynced_{false};
 
   // areas
   const std::string area_{openr::thrift::KvStore_constants::kDefaultArea()};
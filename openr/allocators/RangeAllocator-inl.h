@@ -46,7 +46,9 @@ RangeAllocator<T>::RangeAllocator(
     const bool overrideOwner /* = true */,
     const std::function<bool(T)> checkValueInUseCb,
     const std::chrono::milliseconds rangeAllocTtl,
-    const std::string& area)
+    const std::string& area,
+    const uint32_t claimBatchSize,
+    const std::unordered_map<T, std::string>* valueOwners)
     : nodeName_(nodeName),
       keyPrefix_(keyPrefix),
       kvStoreClient_(kvStoreClient),
@@ -56,13 +58,16 @@ RangeAllocator<T>::RangeAllocator(
       backoff_(minBackoffDur, maxBackoffDur),
       checkValueInUseCb_(std::move(checkValueInUseCb)),
       rangeAllocTtl_(rangeAllocTtl),
-      area_(area) {
+      area_(area),
+      claimBatchSize_(claimBatchSize),
+      valueOwners_(valueOwners) {
+  CHECK_GE(claimBatchSize_, 1) << "Must claim at least one value at once";
   timeout_ =
       fbzmq::ZmqTimeout::make(eventBase_->getEvb(), [this]() mutable noexcept {
-        CHECK(allocateValue_.has_value());
-        auto allocateValue = allocateValue_.value();
-        allocateValue_.reset();
-        tryAllocate(allocateValue);
+        CHECK(not allocateValues_.empty());
+        auto allocateValues = std::move(allocateValues_);
+        allocateValues_.clear();
+        tryAllocate(allocateValues);
       });
 }
 
@@ -72,9 +77,11 @@ RangeAllocator<T>::~RangeAllocator() {
   // We need to cancel any pending timeout
   if (timeout_) {
     timeout_.reset();
-    allocateValue_.reset();
+    allocateValues_.clear();
   }
 
+  releaseRequestedValues();
+
   // Unsubscribe from KvStoreClientInternal if we have been to
   if (myValue_) {
     const auto myKey = createKey(*myValue_);
@@ -98,7 +105,7 @@ RangeAllocator<T>::startAllocator(
 
   allocRange_ = allocRange;
   CHECK_LE(allocRange_.first, allocRange_.second) << "Invalid range.";
-  T initValue;
+  T initValue{allocRange_.first};
   if (maybeInitValue.has_value()) {
     initValue = maybeInitValue.value();
     // maybeInitValue may be outside of allocation range, e.g., initial dump
@@ -114,15 +121,18 @@ RangeAllocator<T>::startAllocator(
                  << ", ussing upper bound instead";
       initValue = allocRange_.second;
     }
-  } else {
-    initValue = allocRange_.first;
   }
   allocRangeSize_ = allocRange_.second - allocRange_.first + 1;
 
   // Subscribe to changes in KvStore
   VLOG(2) << "RangeAllocator: Created. Scheduling first tryAllocate. "
           << "Node: " << nodeName_ << ", Prefix: " << keyPrefix_;
-  allocateValue_ = initValue;
+  if (maybeInitValue.has_value()) {
+    allocateValues_ = {initValue};
+  } else {
+    // no preference, start with values known to be free
+    allocateValues_ = pickFreeValues(allocRange_.first);
+  }
   timeout_->scheduleTimeout(backoff_.getTimeRemainingUntilRetry());
 }
 
@@ -151,23 +161,52 @@ RangeAllocator<T>::getValueFromKvStore() const {
   CHECK(maybeKeyMap.has_value())
       << "Failed to dump keys with prefix: " << keyPrefix_
       << " from kvstore in area: " << area_;
+  std::optional<T> maybeVal;
   for (const auto& kv : *maybeKeyMap) {
     if (kv.second.originatorId == nodeName_) {
       const auto val = details::binaryToPrimitive<T>(kv.second.value.value());
       CHECK_EQ(kv.first, createKey(val));
-      return val;
+      // released claims of a batch linger till they expire, prefer the
+      // allocated value over them
+      if (myValue_ == val) {
+        return val;
+      }
+      maybeVal = val;
     }
   }
-  return std::nullopt;
+  return maybeVal;
 }
 
 template <typename T>
 void
-RangeAllocator<T>::tryAllocate(const T newVal) noexcept {
+RangeAllocator<T>::tryAllocate(const std::vector<T>& newVals) noexcept {
   // Sanity check. We should not have any previously allocated value.
   CHECK(!myValue_.has_value())
       << "We have previously allocated value " << myValue_.value();
+  CHECK(myRequestedValues_.empty());
+  CHECK(not newVals.empty());
+
+  for (const auto newVal : newVals) {
+    if (not tryClaim(newVal)) {
+      continue;
+    }
+    if (myValue_) {
+      // we own it already, no need to claim the rest
+      break;
+    }
+  }
+
+  if (myValue_) {
+    releaseRequestedValues();
+  } else if (myRequestedValues_.empty()) {
+    // none of them can be owned
+    scheduleAllocate(newVals.front());
+  }
+}
 
+template <typename T>
+bool
+RangeAllocator<T>::tryClaim(const T newVal) noexcept {
   VLOG(1) << "RangeAllocator " << nodeName_ << ": trying to allocate "
           << newVal;
 
@@ -194,19 +233,17 @@ RangeAllocator<T>::tryAllocate(const T newVal) noexcept {
   if (!shouldOwnOther && !shouldOwnMine) {
     VLOG(1) << "RangeAllocator: failed to allocate " << newVal << " bcoz of "
             << maybeThriftVal->originatorId;
-    scheduleAllocate(newVal);
-    return;
+    return false;
   }
   // check if prefix index is already in use
   if (checkValueInUseCb_ and checkValueInUseCb_(newVal)) {
     VLOG(1) << "RangeAllocator: failed to allocate " << newVal
             << " as value already exists";
-    scheduleAllocate(newVal);
-    return;
+    return false;
   }
 
   if (shouldOwnOther) {
-    myRequestedValue_ = newVal;
+    myRequestedValues_.emplace(newVal);
     // Either no one owns it or owner has lower originator ID
     // Set new value in KvStore
     auto ttlVersion = maybeThriftVal ? maybeThriftVal->ttlVersion + 1 : 0;
@@ -248,6 +285,19 @@ RangeAllocator<T>::tryAllocate(const T newVal) noexcept {
       },
       false,
       area_);
+  return true;
+}
+
+template <typename T>
+void
+RangeAllocator<T>::releaseRequestedValues() noexcept {
+  for (const auto val : myRequestedValues_) {
+    VLOG(2) << "RangeAllocator " << nodeName_ << ": releasing claim of " << val;
+    const auto key = createKey(val);
+    kvStoreClient_->unsubscribeKey(key);
+    kvStoreClient_->unsetKey(key, area_);
+  }
+  myRequestedValues_.clear();
 }
 
 template <typename T>
@@ -256,46 +306,74 @@ RangeAllocator<T>::scheduleAllocate(const T seedVal) noexcept {
   // Apply exponential backoff
   backoff_.reportError();
 
+  // Schedule timeout to allocate new values
+  allocateValues_ = pickFreeValues(seedVal);
+  timeout_->scheduleTimeout(backoff_.getTimeRemainingUntilRetry());
+}
+
+template <typename T>
+std::vector<T>
+RangeAllocator<T>::pickFreeValues(const T seedVal) const noexcept {
   // Use random value selection logic based on seedVal
   std::mt19937_64 gen(seedVal + folly::Random::rand64());
   std::uniform_int_distribution<T> dist(allocRange_.first, allocRange_.second);
-  auto newVal = dist(gen);
 
-  const auto maybeKeyMap = kvStoreClient_->dumpAllWithPrefix(keyPrefix_, area_);
-  CHECK(maybeKeyMap.has_value())
-      << "Failed to dump keys with prefix: " << keyPrefix_
-      << " from kvstore in area: " << area_;
-  const auto valOwners =
-      folly::gen::from(*maybeKeyMap) |
-      folly::gen::map([](std::pair<std::string, thrift::Value> const& kv) {
-        return std::make_pair(
-            details::binaryToPrimitive<T>(kv.second.value.value()),
-            kv.second.originatorId);
-      }) |
-      folly::gen::as<
-          std::unordered_map<T /* value */, std::string /* owner */>>();
-
-  // look for a value I can own
-  T i;
-  for (i = 0; i < allocRangeSize_; ++i) {
-    const auto it = valOwners.find(newVal);
-    // not owned yet or owned by higher originator if override is allowed
-    if (it == valOwners.end() or (overrideOwner_ and nodeName_ >= it->second)) {
-      if (!checkValueInUseCb_ or !checkValueInUseCb_(newVal)) {
-        // found
-        break;
-      }
+  // mark values I can't own: owned by higher originator or owned at all if
+  // override isn't allowed
+  std::vector<bool> unavailable(allocRangeSize_, false);
+  T numUnavailable = 0;
+  auto markOwned = [&](const T val, const std::string& owner) {
+    if (val < allocRange_.first or val > allocRange_.second) {
+      return;
+    }
+    if (overrideOwner_ and nodeName_ >= owner) {
+      return;
+    }
+    if (not unavailable[val - allocRange_.first]) {
+      unavailable[val - allocRange_.first] = true;
+      ++numUnavailable;
+    }
+  };
+  if (valueOwners_) {
+    for (const auto& kv : *valueOwners_) {
+      markOwned(kv.first, kv.second);
+    }
+  } else {
+    // from a single dump
+    const auto maybeKeyMap =
+        kvStoreClient_->dumpAllWithPrefix(keyPrefix_, area_);
+    CHECK(maybeKeyMap.has_value())
+        << "Failed to dump keys with prefix: " << keyPrefix_
+        << " from kvstore in area: " << area_;
+    for (const auto& kv : *maybeKeyMap) {
+      markOwned(
+          details::binaryToPrimitive<T>(kv.second.value.value()),
+          kv.second.originatorId);
     }
-    // try next
-    newVal = (newVal < allocRange_.second) ? (newVal + 1) : allocRange_.first;
   }
-  if (i == allocRangeSize_) {
-    LOG(ERROR) << "All values are owned by higher originatorIds";
+
+  // pick free values, each scanning from its own random start
+  std::vector<T> newVals;
+  while (newVals.size() < claimBatchSize_ and
+         numUnavailable < allocRangeSize_) {
+    auto offset = dist(gen) - allocRange_.first;
+    while (unavailable[offset]) {
+      offset = (offset + 1 < allocRangeSize_) ? (offset + 1) : 0;
+    }
+    const T newVal = allocRange_.first + offset;
+    unavailable[offset] = true;
+    ++numUnavailable;
+    // check in use lazily, only for the candidates
+    if (!checkValueInUseCb_ or !checkValueInUseCb_(newVal)) {
+      newVals.emplace_back(newVal);
+    }
   }
 
-  // Schedule timeout to allocate new value
-  allocateValue_ = newVal;
-  timeout_->scheduleTimeout(backoff_.getTimeRemainingUntilRetry());
+  if (newVals.empty()) {
+    LOG(ERROR) << "All values are owned by higher originatorIds";
+    newVals.emplace_back(dist(gen));
+  }
+  return newVals;
 }
 
 template <typename T>
@@ -309,8 +387,8 @@ RangeAllocator<T>::keyValUpdated(
   // no timeout being scheduled
   CHECK(!timeout_->isScheduled());
   // only subscribed to requested/allocated value change
-  CHECK(myRequestedValue_ or myValue_);
-  CHECK_EQ(myValue_ ? *myValue_ : *myRequestedValue_, val);
+  CHECK(myValue_ == val or myRequestedValues_.count(val))
+      << "Unexpected value " << val;
 
   // this occurs when I submit a key to kvstore owned by a lower id1
   // before my id or even higher id overrides it, an intermediate id2
@@ -324,7 +402,10 @@ RangeAllocator<T>::keyValUpdated(
     VLOG(3) << "RangeAllocator " << nodeName_ << ": Won " << val;
     // Our own advertisement got echoed back
     // Let the application know of newly allocated value
+    myRequestedValues_.erase(val);
     myValue_ = val;
+    // Give up on the rest of claims
+    releaseRequestedValues();
     callback_(myValue_);
 
     // Clear backoff
@@ -342,12 +423,15 @@ RangeAllocator<T>::keyValUpdated(
       callback_(std::nullopt);
       myValue_.reset();
     }
+    myRequestedValues_.erase(val);
 
     // Unsubscribe to update of lost value
     kvStoreClient_->unsubscribeKey(key);
     kvStoreClient_->unsetKey(key, area_);
-    // Schedule allocation for new value
-    scheduleAllocate(val);
+    // Schedule allocation for new values once all claims are lost
+    if (myRequestedValues_.empty()) {
+      scheduleAllocate(val);
+    }
   }
 }
 
@@ -10,6 +10,9 @@
 #include <chrono>
 #include <random>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <fbzmq/async/ZmqTimeout.h>
 #include <folly/Format.h>
@@ -36,7 +39,8 @@ class RangeAllocator {
    * bus.
    *
    * Idea:
-   * - Generate a random value to be claimed
+   * - Pick a random value to be claimed among the free ones, known from a
+   *   bitmap of values claimed in KvStore
    * - Try electing it via KvStore. Higher originatorId wins.
    * - If we fail we should try again with another random number
    * - To ease up re-tries we use ExponentialBackoff
@@ -46,6 +50,12 @@ class RangeAllocator {
    * owner with a lower ID knowingly. In some applications like Terragraph, we
    * don't want this to occur so existing allocated values are not stolen by
    * higher priority allocator instances joining later
+   * claimBatchSize: number of free values claimed at once. The first one won
+   * is kept, the others are released and expire from KvStore after
+   * rangeAllocTtl. Cuts down rounds of retries in densely used ranges
+   * valueOwners: optional index of claimed values to their owners, kept up to
+   * date by the caller from KvStore publications. Used to pick free values
+   * instead of dumping all keys from KvStore on every retry
    */
   RangeAllocator(
       const std::string& nodeName,
@@ -58,7 +68,9 @@ class RangeAllocator {
       const bool overrideOwner = true,
       const std::function<bool(T)> checkValueInUseCb = nullptr,
       const std::chrono::milliseconds rangeAllocTtl = Constants::kRangeAllocTtl,
-      const std::string& area = thrift::KvStore_constants::kDefaultArea());
+      const std::string& area = thrift::KvStore_constants::kDefaultArea(),
+      const uint32_t claimBatchSize = 1,
+      const std::unordered_map<T, std::string>* valueOwners = nullptr);
 
   /**
    * user must call this to start allocation
@@ -100,17 +112,33 @@ class RangeAllocator {
   void start(const std::optional<T> maybeInitValue);
 
   /**
-   * Invoked asynchronously to allocate a new value. On success callback
+   * Invoked asynchronously to allocate one of new values. On success callback
    * will be executed.
    */
-  void tryAllocate(const T newVal) noexcept;
+  void tryAllocate(const std::vector<T>& newVals) noexcept;
 
   /**
-   * Schedule allocation of a new value. A new random value will be chosen
+   * Claim new value via KvStore, or take it right away if we own it already.
+   * Returns false if it can't be owned
+   */
+  bool tryClaim(const T newVal) noexcept;
+
+  // Release values claimed but not allocated
+  void releaseRequestedValues() noexcept;
+
+  /**
+   * Schedule allocation of a new value. New random values will be chosen
    * based on the seed value.
    */
   void scheduleAllocate(const T seedVal) noexcept;
 
+  /**
+   * Pick up to claimBatchSize_ random values we can own, based on a bitmap of
+   * values claimed in KvStore. Returns the random seeded value if there is
+   * none
+   */
+  std::vector<T> pickFreeValues(const T seedVal) const noexcept;
+
   /* Invoked whenever there is an update for our currently allocated value
    */
   void keyValUpdated(
@@ -158,14 +186,14 @@ class RangeAllocator {
   // Currently allocated value
   std::optional<T> myValue_;
 
-  // Currently requested value
-  std::optional<T> myRequestedValue_;
+  // Currently requested values
+  std::unordered_set<T> myRequestedValues_;
 
   // Exponential backoff to avoid frequent allocation retries
   ExponentialBackoff<std::chrono::milliseconds> backoff_;
 
-  // Scheduled timeout token
-  std::optional<int64_t> allocateValue_{std::nullopt};
+  // Values to allocate on scheduled timeout
+  std::vector<T> allocateValues_;
   std::unique_ptr<fbzmq::ZmqTimeout> timeout_;
 
   // if allocator has started
@@ -179,6 +207,12 @@ class RangeAllocator {
 
   // area ID
   const std::string area_{};
+
+  // number of values claimed at once
+  const uint32_t claimBatchSize_{1};
+
+  // index of claimed values to owners maintained by the caller, if any
+  const std::unordered_map<T, std::string>* valueOwners_{nullptr};
 };
 
 } // namespace openr
@@ -18,10 +18,59 @@ MockSystemServiceHandler::getIfaceAddresses(
     int16_t family,
     int16_t) {
   _return.clear();
+  {
+    auto mockIfaceAddrs = mockIfaceAddrs_.rlock();
+    auto it = mockIfaceAddrs->find(*iface);
+    if (it != mockIfaceAddrs->end()) {
+      for (const auto& prefix : it->second) {
+        if (prefix.first.family() == family) {
+          _return.emplace_back(toIpPrefix(prefix));
+        }
+      }
+      return;
+    }
+  }
   auto prefixes = getIfacePrefixes(*iface, family);
   for (const auto& prefix : prefixes) {
     _return.emplace_back(toIpPrefix(prefix));
   }
 }
 
+void
+MockSystemServiceHandler::addIfaceAddresses(
+    std::unique_ptr<std::string> iface,
+    std::unique_ptr<std::vector<::openr::thrift::IpPrefix>> addrs) {
+  auto mockIfaceAddrs = mockIfaceAddrs_.wlock();
+  auto& ifaceAddrs = (*mockIfaceAddrs)[*iface];
+  for (const auto& addr : *addrs) {
+    ifaceAddrs.emplace(toIPNetwork(addr));
+  }
+}
+
+void
+MockSystemServiceHandler::removeIfaceAddresses(
+    std::unique_ptr<std::string> iface,
+    std::unique_ptr<std::vector<::openr::thrift::IpPrefix>> addrs) {
+  // addresses not assigned count as removed
+  auto mockIfaceAddrs = mockIfaceAddrs_.wlock();
+  auto& ifaceAddrs = (*mockIfaceAddrs)[*iface];
+  for (const auto& addr : *addrs) {
+    ifaceAddrs.erase(toIPNetwork(addr));
+  }
+}
+
+std::set<folly::CIDRNetwork>
+MockSystemServiceHandler::getMockIfaceAddrs(std::string const& iface) {
+  auto mockIfaceAddrs = mockIfaceAddrs_.rlock();
+  auto it = mockIfaceAddrs->find(iface);
+  return it == mockIfaceAddrs->end() ? std::set<folly::CIDRNetwork>{}
+                                     : it->second;
+}
+
+void
+MockSystemServiceHandler::setMockIfaceAddrs(
+    std::string const& iface, std::set<folly::CIDRNetwork> addrs) {
+  (*mockIfaceAddrs_.wlock())[iface] = std::move(addrs);
+}
+
 } // namespace openr
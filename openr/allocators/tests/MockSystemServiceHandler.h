@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include <set>
+#include <unordered_map>
+
+#include <folly/Synchronized.h>
+
 #include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/SystemService.h>
 
@@ -22,6 +27,25 @@ class MockSystemServiceHandler final : public thrift::SystemServiceSvIf {
       std::unique_ptr<std::string> iface,
       int16_t family,
       int16_t scope) override;
+
+  void addIfaceAddresses(
+      std::unique_ptr<std::string> iface,
+      std::unique_ptr<std::vector<::openr::thrift::IpPrefix>> addrs) override;
+
+  void removeIfaceAddresses(
+      std::unique_ptr<std::string> iface,
+      std::unique_ptr<std::vector<::openr::thrift::IpPrefix>> addrs) override;
+
+  // Thread safe API for testing only. Addresses of interfaces kept by the
+  // mock, others are read from the system
+  std::set<folly::CIDRNetwork> getMockIfaceAddrs(std::string const& iface);
+  void setMockIfaceAddrs(
+      std::string const& iface, std::set<folly::CIDRNetwork> addrs);
+
+ private:
+  folly::Synchronized<
+      std::unordered_map<std::string, std::set<folly::CIDRNetwork>>>
+      mockIfaceAddrs_;
 };
 
 } // namespace openr
@@ -45,6 +45,9 @@ const AllocPrefixMarker kAllocPrefixMarker{"allocprefix:"};
 // length of allocated prefix
 const int kAllocPrefixLen = 128;
 
+// loopback interface, its addresses are kept by the mock system service
+const std::string kLoopbackIfaceName{"lo-test"};
+
 class PrefixAllocatorFixture : public ::testing::TestWithParam<bool> {
  public:
   void
@@ -79,6 +82,10 @@ class PrefixAllocatorFixture : public ::testing::TestWithParam<bool> {
     // Erase previous configs (if any)
     configStore_->erase("prefix-allocator-config").get();
     configStore_->erase("prefix-manager-config").get();
+    for (const auto& kv : thrift::_PrefixType_VALUES_TO_NAMES) {
+      configStore_->erase(folly::sformat("prefix-manager-config:{}", kv.second))
+          .get();
+    }
 
     mockServiceHandler_ = std::make_shared<MockSystemServiceHandler>();
     server_ = std::make_shared<apache::thrift::ThriftServer>();
@@ -98,7 +105,8 @@ class PrefixAllocatorFixture : public ::testing::TestWithParam<bool> {
   }
 
   void
-  createPrefixAllocator() {
+  createPrefixAllocator(
+      bool setLoopbackAddress = false, bool asyncAddrProgramming = false) {
     prefixAllocator_ = make_unique<PrefixAllocator>(
         myNodeName_,
         kvStoreWrapper_->getKvStore(),
@@ -107,15 +115,16 @@ class PrefixAllocatorFixture : public ::testing::TestWithParam<bool> {
         kAllocPrefixMarker,
         GetParam() ? PrefixAllocatorMode(PrefixAllocatorModeStatic())
                    : PrefixAllocatorMode(PrefixAllocatorModeSeeded()),
-        false /* set loopback addr */,
+        setLoopbackAddress,
         false /* override global address */,
-        "" /* loopback interface name */,
+        setLoopbackAddress ? kLoopbackIfaceName : "",
         false /* prefix fwd type MPLS */,
         false /* prefix fwd algo KSP2_ED_ECMP */,
         kSyncInterval,
         configStore_.get(),
         zmqContext_,
-        port_);
+        port_,
+        asyncAddrProgramming);
     threads_.emplace_back([&]() noexcept { prefixAllocator_->run(); });
     prefixAllocator_->waitUntilRunning();
   }
@@ -992,6 +1001,238 @@ TEST_P(PrefixAllocatorFixture, StaticAllocation) {
   LOG(INFO) << "Step-5: Received withdraw for allocated prefix from KvStore.";
 }
 
+/**
+ * Tests that e2e-network-allocation updates get applied as delta, with alloc
+ * indices shared by several nodes counted per node
+ */
+TEST_P(PrefixAllocatorFixture, NetworkAllocationsDelta) {
+  // e2e-network-allocation only reserves indices in seeded mode
+  if (GetParam()) {
+    return;
+  }
+
+  // indices are computed for the seed prefix, wait for it to be in use
+  auto res = kvStoreClient_->setKey(
+      Constants::kSeedPrefixAllocParamKey.toString(),
+      "face:b00c:d00d::/61,64");
+  EXPECT_TRUE(res.has_value());
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (not prefixAllocator_->getMyPrefixIndex().has_value()) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+        << "no prefix index elected";
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  auto setNodePrefixes =
+      [&](std::map<std::string, std::string> const& nodePrefixes,
+          uint32_t version) {
+        thrift::StaticAllocation staticAlloc;
+        for (auto const& kv : nodePrefixes) {
+          staticAlloc.nodePrefixes[kv.first] = toIpPrefix(kv.second);
+        }
+        auto res = kvStoreClient_->setKey(
+            Constants::kStaticPrefixAllocParamKey.toString(),
+            fbzmq::util::writeThriftObjStr(staticAlloc, serializer),
+            version);
+        EXPECT_TRUE(res.has_value());
+      };
+  auto waitForE2eAllocIndex =
+      [&](std::unordered_map<uint32_t, uint32_t> const& expected) {
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (prefixAllocator_->getE2eAllocIndex() != expected) {
+          ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+              << "e2e alloc indices not updated";
+          /* sleep override */
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+      };
+
+  // index 2 is taken by two nodes
+  setNodePrefixes(
+      {{"node1", "face:b00c:d00d:1::/64"},
+       {"node2", "face:b00c:d00d:2::/64"},
+       {"node3", "face:b00c:d00d:2::/64"}},
+      1);
+  waitForE2eAllocIndex({{1, 1}, {2, 2}});
+
+  // withdrawing one of the duplicates keeps the index reserved by the other,
+  // moving node1 releases its old index
+  setNodePrefixes(
+      {{"node1", "face:b00c:d00d:3::/64"}, {"node3", "face:b00c:d00d:2::/64"}},
+      2);
+  waitForE2eAllocIndex({{2, 1}, {3, 1}});
+
+  // node added
+  setNodePrefixes(
+      {{"node1", "face:b00c:d00d:3::/64"},
+       {"node3", "face:b00c:d00d:2::/64"},
+       {"node4", "face:b00c:d00d:3::/64"}},
+      3);
+  waitForE2eAllocIndex({{2, 1}, {3, 2}});
+
+  // all withdrawn
+  setNodePrefixes({}, 4);
+  waitForE2eAllocIndex({});
+}
+
+/**
+ * Tests that claims of other nodes are tracked from publications and keep
+ * being fed to the range allocator after the alloc params change
+ */
+TEST_P(PrefixAllocatorFixture, AllocIndexOwners) {
+  if (GetParam()) {
+    return;
+  }
+
+  auto res = kvStoreClient_->setKey(
+      Constants::kSeedPrefixAllocParamKey.toString(),
+      "face:b00c:d00d::/61,64",
+      1);
+  EXPECT_TRUE(res.has_value());
+  std::optional<uint32_t> myIndex;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (not(myIndex = prefixAllocator_->getMyPrefixIndex()).has_value()) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+        << "no prefix index elected";
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  auto const& marker = static_cast<std::string const&>(kAllocPrefixMarker);
+  auto claimIndex =
+      [&](uint32_t index, std::string const& owner, int64_t ttl) {
+        kvStoreWrapper_->setKey(
+            folly::sformat("{}{}", marker, index),
+            createThriftValue(
+                1, owner, details::primitiveToBinary(index), ttl));
+      };
+  auto waitForOwners =
+      [&](std::unordered_map<uint32_t, std::string> const& expected) {
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (prefixAllocator_->getAllocIndexOwners() != expected) {
+          ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+              << "alloc index owners not updated";
+          /* sleep override */
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+      };
+
+  // other nodes claim all of the 8 indices but mine and one
+  const uint32_t freeIndex = (*myIndex + 1) % 8;
+  std::unordered_map<uint32_t, std::string> owners{{*myIndex, myNodeName_}};
+  for (uint32_t index = 0; index < 8; ++index) {
+    if (index == *myIndex or index == freeIndex) {
+      continue;
+    }
+    owners[index] = folly::sformat("other-node-{}", index);
+    claimIndex(index, owners[index], Constants::kTtlInfinity);
+  }
+  waitForOwners(owners);
+
+  // expired claims are dropped
+  auto withExpiring = owners;
+  withExpiring[freeIndex] = "other-node-expiring";
+  claimIndex(freeIndex, withExpiring[freeIndex], 500);
+  waitForOwners(withExpiring);
+  waitForOwners(owners);
+
+  // change of params restarts allocation, which must keep away from the
+  // claims of others
+  res = kvStoreClient_->setKey(
+      Constants::kSeedPrefixAllocParamKey.toString(),
+      "face:b00c:d00e::/61,64",
+      2);
+  EXPECT_TRUE(res.has_value());
+  const auto newSeedPrefix =
+      folly::IPAddress::createNetwork("face:b00c:d00e::/61");
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (true) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+        << "no prefix allocated from new seed prefix";
+    auto value = kvStoreWrapper_->getKey(
+        folly::sformat("{}{}", Constants::kPrefixDbMarker, myNodeName_));
+    if (value.has_value() and value->value.has_value()) {
+      auto prefixDb = fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
+          *value->value, serializer);
+      if (not prefixDb.prefixEntries.empty() and
+          toIPNetwork(prefixDb.prefixEntries.at(0).prefix)
+              .first.inSubnet(newSeedPrefix.first, newSeedPrefix.second)) {
+        break;
+      }
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  const auto newIndex = prefixAllocator_->getMyPrefixIndex();
+  ASSERT_TRUE(newIndex.has_value());
+  EXPECT_TRUE(*newIndex == *myIndex or *newIndex == freeIndex)
+      << "index " << *newIndex << " is claimed by another node";
+  for (auto const& kv : prefixAllocator_->getAllocIndexOwners()) {
+    if (kv.first != *myIndex and kv.first != *newIndex) {
+      ASSERT_EQ(1, owners.count(kv.first));
+      EXPECT_EQ(owners.at(kv.first), kv.second);
+    }
+  }
+}
+
+/**
+ * Tests that loopback addresses get programmed through the system service
+ * without blocking the allocator, as with --async_loopback_addr
+ */
+TEST_P(PrefixAllocatorFixture, AsyncLoopbackAddrs) {
+  if (GetParam()) {
+    return;
+  }
+
+  // restart allocator programming loopback addresses
+  prefixAllocator_->stop();
+  prefixAllocator_->waitUntilStopped();
+  createPrefixAllocator(true /* set loopback addr */, true /* async */);
+
+  // stale address of seed prefix gets replaced, other global ones stay
+  const auto staleAddr =
+      folly::IPAddress::createNetwork("face:b00c:d00d:7::1/128");
+  const auto globalAddr = folly::IPAddress::createNetwork("fc00::1/128");
+  mockServiceHandler_->setMockIfaceAddrs(
+      kLoopbackIfaceName, {staleAddr, globalAddr});
+
+  auto waitForLoopbackAddr = [&](std::string const& seedPrefixStr,
+                                 uint32_t version) {
+    auto res = kvStoreClient_->setKey(
+        Constants::kSeedPrefixAllocParamKey.toString(),
+        folly::sformat("{},64", seedPrefixStr),
+        version);
+    EXPECT_TRUE(res.has_value());
+    const auto seedPrefix = folly::IPAddress::createNetwork(seedPrefixStr);
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (true) {
+      ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+          << "loopback address not programmed";
+      auto index = prefixAllocator_->getMyPrefixIndex();
+      if (index.has_value()) {
+        const auto loopbackAddr = createLoopbackPrefix(
+            getNthPrefix(seedPrefix, 64, *index));
+        auto addrs = mockServiceHandler_->getMockIfaceAddrs(kLoopbackIfaceName);
+        if (addrs.count(loopbackAddr) and not addrs.count(staleAddr)) {
+          EXPECT_EQ(1, addrs.count(globalAddr));
+          break;
+        }
+      }
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+
+  waitForLoopbackAddr("face:b00c:d00d::/61", 1);
+
+  // change of params programs address of the new prefix
+  waitForLoopbackAddr("face:b00c:d00e::/61", 2);
+}
+
 INSTANTIATE_TEST_CASE_P(FixtureTest, PrefixAllocatorFixture, ::testing::Bool());
 
 TEST(PrefixAllocator, getPrefixCount) {
@@ -1017,6 +1258,55 @@ TEST(PrefixAllocator, getPrefixCount) {
   }
 }
 
+TEST(PrefixAllocator, getLoopbackAddrsDelta) {
+  using Prefixes = std::vector<folly::CIDRNetwork>;
+  const auto seedPrefix = folly::IPAddress::createNetwork("face:b00c::/56");
+  const auto prefix = folly::IPAddress::createNetwork("face:b00c:0:1::/64");
+  const auto loopbackPrefix =
+      folly::IPAddress::createNetwork("face:b00c:0:1::1/128");
+  // previous allocation from seed prefix, other global and link local one
+  const auto seedAddr = folly::IPAddress::createNetwork("face:b00c:0:2::1/128");
+  const auto globalAddr = folly::IPAddress::createNetwork("fc00::1/128");
+  const auto linkLocalAddr = folly::IPAddress::createNetwork("fe80::1/128");
+
+  // nothing assigned yet
+  for (bool overrideGlobalAddress : {false, true}) {
+    auto delta = PrefixAllocator::getLoopbackAddrsDelta(
+        prefix, {}, seedPrefix, overrideGlobalAddress);
+    EXPECT_EQ(Prefixes{loopbackPrefix}, delta.toAdd);
+    EXPECT_EQ(Prefixes{}, delta.toDelete);
+  }
+
+  // addresses of seed prefix get replaced, other ones only with
+  // overrideGlobalAddress while link local ones stay
+  {
+    auto delta = PrefixAllocator::getLoopbackAddrsDelta(
+        prefix, {seedAddr, globalAddr, linkLocalAddr}, seedPrefix, false);
+    EXPECT_EQ(Prefixes{loopbackPrefix}, delta.toAdd);
+    EXPECT_EQ(Prefixes{seedAddr}, delta.toDelete);
+  }
+  {
+    auto delta = PrefixAllocator::getLoopbackAddrsDelta(
+        prefix, {seedAddr, globalAddr, linkLocalAddr}, seedPrefix, true);
+    EXPECT_EQ(Prefixes{loopbackPrefix}, delta.toAdd);
+    EXPECT_EQ((Prefixes{seedAddr, globalAddr}), delta.toDelete);
+  }
+
+  // already assigned, doesn't get programmed again
+  {
+    auto delta = PrefixAllocator::getLoopbackAddrsDelta(
+        prefix, {globalAddr, loopbackPrefix}, seedPrefix, false);
+    EXPECT_EQ(Prefixes{}, delta.toAdd);
+    EXPECT_EQ(Prefixes{}, delta.toDelete);
+  }
+  {
+    auto delta = PrefixAllocator::getLoopbackAddrsDelta(
+        prefix, {loopbackPrefix, globalAddr, linkLocalAddr}, seedPrefix, true);
+    EXPECT_EQ(Prefixes{}, delta.toAdd);
+    EXPECT_EQ(Prefixes{globalAddr}, delta.toDelete);
+  }
+}
+
 TEST(PrefixAllocator, parseParamsStr) {
   // Missing subnet specification in seed-prefix
   {
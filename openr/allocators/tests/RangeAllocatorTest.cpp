@@ -110,7 +110,8 @@ class RangeAllocatorFixture : public ::testing::TestWithParam<bool> {
       const std::optional<std::vector<T>> maybeInitVals,
       std::function<void(int /* client id */, std::optional<T>)> callback,
       const std::chrono::milliseconds rangeAllocTtl =
-          Constants::kRangeAllocTtl) {
+          Constants::kRangeAllocTtl,
+      const uint32_t claimBatchSize = 1) {
     // sanity check
     if (maybeInitVals) {
       CHECK_EQ(clients.size(), maybeInitVals->size());
@@ -129,7 +130,9 @@ class RangeAllocatorFixture : public ::testing::TestWithParam<bool> {
           100ms /* max backoff */,
           overrideOwner /* override allowed */,
           nullptr,
-          rangeAllocTtl);
+          rangeAllocTtl,
+          thrift::KvStore_constants::kDefaultArea(),
+          claimBatchSize);
       // start allocator
       allocator->startAllocator(
           allocRange,
@@ -269,6 +272,61 @@ TEST_P(RangeAllocatorFixture, NoSeed) {
   }
 }
 
+/**
+ * Run all allocators with no seed, claiming several values at once. Each one
+ * should keep a single distinct value and release the rest of its claims.
+ */
+TEST_P(RangeAllocatorFixture, BatchClaim) {
+  const uint64_t start = 61;
+  const uint64_t end = start + kNumClients * 10;
+
+  folly::Baton waitBaton;
+  std::map<int /* client id */, uint64_t /* allocated value */> allocation;
+  auto allocators = createAllocators<uint64_t>(
+      {start, end},
+      std::nullopt,
+      [&](int clientId, std::optional<uint64_t> newVal) {
+        if (newVal) {
+          ASSERT_GE(newVal.value(), start);
+          ASSERT_LE(newVal.value(), end);
+          allocation[clientId] = newVal.value();
+        } else {
+          allocation.erase(clientId);
+        }
+
+        if (allocation.size() != kNumClients) {
+          return;
+        }
+        const auto allocatedVals = from(allocation) |
+            map([](std::pair<int, uint64_t> const& kv) { return kv.second; }) |
+            as<std::set<uint64_t>>();
+        if (allocatedVals.size() == kNumClients) {
+          LOG(INFO) << "We got everything, stopping OpenrEventBase.";
+          waitBaton.post();
+        }
+      },
+      Constants::kRangeAllocTtl,
+      4 /* claim batch size */);
+
+  // Start the event loop and wait until it is finished execution.
+  evbThread = std::thread([&]() { evb.run(); });
+  evb.waitUntilRunning();
+
+  // Synchronization primitive
+  waitBaton.wait();
+
+  for (size_t i = 0; i < allocators.size(); ++i) {
+    const auto maybeVal = allocators[i]->getValueFromKvStore();
+    ASSERT_TRUE(maybeVal.has_value());
+    ASSERT_NE(allocation.end(), allocation.find(i));
+    EXPECT_EQ(allocation[i], *maybeVal);
+  }
+
+  for (auto& allocator : allocators) {
+    allocator.reset();
+  }
+}
+
 /**
  * Run allocators with no seed but the range doesn't have enough allocation
  * space. In this case allocators with higher IDs will succeed and other
@@ -10,6 +10,7 @@
 namespace openr {
 
 constexpr double Constants::kRttChangeThreashold;
+constexpr double Constants::kTtlRefreshJitter;
 constexpr folly::StringPiece Constants::kAdjDbMarker;
 constexpr folly::StringPiece Constants::kErrorResponse;
 constexpr folly::StringPiece Constants::kEventLogCategory;
@@ -19,6 +20,7 @@ constexpr folly::StringPiece Constants::kNodeLabelRangePrefix;
 constexpr folly::StringPiece Constants::kOpenrCtrlSessionContext;
 constexpr folly::StringPiece Constants::kPlatformHost;
 constexpr folly::StringPiece Constants::kPrefixAllocMarker;
+constexpr folly::StringPiece Constants::kPrefixBucketKeyMarker;
 constexpr folly::StringPiece Constants::kPrefixDbMarker;
 constexpr folly::StringPiece Constants::kPrefixNameSeparator;
 constexpr folly::StringPiece Constants::kSeedPrefixAllocLenSeparator;
@@ -53,6 +55,7 @@ constexpr std::chrono::milliseconds Constants::kLinkImmediateTimeout;
 constexpr std::chrono::milliseconds Constants::kLinkThrottleTimeout;
 constexpr std::chrono::milliseconds Constants::kMaxBackoff;
 constexpr std::chrono::milliseconds Constants::kMaxTtlUpdateInterval;
+constexpr std::chrono::milliseconds Constants::kTtlRefreshTick;
 constexpr std::chrono::milliseconds Constants::kPersistentStoreInitialBackoff;
 constexpr std::chrono::milliseconds Constants::kPersistentStoreMaxBackoff;
 constexpr std::chrono::milliseconds Constants::kPlatformConnTimeout;
@@ -81,11 +84,26 @@ constexpr std::chrono::seconds Constants::kPlatformThriftIdleTimeout;
 constexpr std::chrono::seconds Constants::kStoreSyncInterval;
 constexpr std::chrono::seconds Constants::kStoreFullSyncResponseTimeout;
 constexpr int32_t Constants::kMaxFullSyncPendingCountThreshold;
+constexpr size_t Constants::kKvStoreSyncBuckets;
+constexpr size_t Constants::kFloodBatchMaxBytes;
+constexpr size_t Constants::kValueCompressionMinBytes;
+constexpr size_t Constants::kThriftPeerMaxPendingRequests;
+constexpr size_t Constants::kPeerSendQueueMaxBytes;
+constexpr std::chrono::milliseconds Constants::kPeerSendQueueInitialBackoff;
+constexpr std::chrono::milliseconds Constants::kPeerSendQueueMaxBackoff;
+constexpr size_t Constants::kPrefixMgrMaxPrefixBuckets;
+constexpr size_t Constants::kTtlRefreshesPerTick;
 constexpr std::pair<int32_t, int32_t> Constants::kSrGlobalRange;
 constexpr std::pair<int32_t, int32_t> Constants::kSrLocalRange;
 constexpr uint16_t Constants::kPerfBufferSize;
+constexpr uint16_t Constants::kFibProgrammingStatsBufferSize;
 constexpr uint32_t Constants::kMaxAllowedPps;
 constexpr uint64_t Constants::kOverloadNodeMetric;
+constexpr size_t Constants::kDecisionSpfResultCacheSize;
+constexpr std::chrono::milliseconds Constants::kDecisionRouteBuildSlice;
+constexpr std::chrono::milliseconds Constants::kDecisionSpfPollInterval;
+constexpr size_t Constants::kDecisionRouteBuildChunkSize;
+constexpr size_t Constants::kDecisionTraceSpans;
 constexpr uint8_t Constants::kAqRouteProtoId;
 
 } // namespace openr
@@ -79,6 +79,8 @@ class Constants {
   static constexpr std::chrono::milliseconds kPersistentStoreInitialBackoff{
       100};
   static constexpr std::chrono::milliseconds kPersistentStoreMaxBackoff{5000};
+  // writes within this window are committed to disk together
+  static constexpr std::chrono::milliseconds kPersistentStoreCommitWindow{5};
 
   //
   // KvStore specific
@@ -93,6 +95,19 @@ class Constants {
   // kStoreFullSyncResponseTimeout to send the next sync request
   static constexpr int32_t kMaxFullSyncPendingCountThreshold{32};
 
+  // Number of buckets the key space is hashed into for bucket hash based
+  // full sync. Must be the same on all nodes of an area
+  static constexpr size_t kKvStoreSyncBuckets{1024};
+
+  // Seed of the SpookyHashV2 hashes of sync buckets and their entries. Part
+  // of the protocol, nodes with different seeds never agree on buckets
+  static constexpr uint64_t kKvStoreSyncBucketSeed{0};
+
+  // Max number of key-values of a full-sync response merged at once. Bigger
+  // responses get merged in slices, letting other events of the area run in
+  // between
+  static constexpr size_t kKvStoreSyncMergeSliceKeys{10000};
+
   //
   // PrefixAllocator specific
 
@@ -122,6 +137,24 @@ class Constants {
   // overloaded note metric value
   static constexpr uint64_t kOverloadNodeMetric{1ull << 32};
 
+  // number of SPF results kept for computing routes of other nodes, e.g. when
+  // polled through getDecisionRouteDb()
+  static constexpr size_t kDecisionSpfResultCacheSize{128};
+
+  // time Decision spends building routes before yielding to other events.
+  // Large route builds are resumed over several event loop iterations
+  static constexpr std::chrono::milliseconds kDecisionRouteBuildSlice{10};
+
+  // how often Decision checks on SPF of an area running on the SPF threads
+  static constexpr std::chrono::milliseconds kDecisionSpfPollInterval{1};
+
+  // prefixes per task of route builds spread over the Decision SPF threads.
+  // Fewer than two chunks of prefixes are built inline
+  static constexpr size_t kDecisionRouteBuildChunkSize{1024};
+
+  // spans of route computation stages Decision keeps for debugging
+  static constexpr size_t kDecisionTraceSpans{16384};
+
   //
   // Spark specific
   //
@@ -156,9 +189,19 @@ class Constants {
   // time interval to sync between Open/R and Platform
   static constexpr std::chrono::seconds kPlatformSyncInterval{60};
 
+  // time interval to sync all links from Platform and advertise all
+  // interfaces, as a consistency check of the incremental updates in between
+  static constexpr std::chrono::seconds kPlatformFullSyncInterval{600};
+
+  // route update batches Fib keeps in flight to the switch agent
+  static constexpr size_t kFibMaxPendingRouteBatches{4};
+
   // time interval for keep alive check between fib and switch agent
   static constexpr std::chrono::milliseconds kKeepAliveCheckInterval{1000};
 
+  // time the switch agent holds longPollAliveSince calls of fib
+  static constexpr std::chrono::milliseconds kPlatformLongPollTimeout{30000};
+
   // Timeout duration for which if a client connection has no activity, then it
   // will be dropped. We keep it 3 * kPlatformSyncInterval so that thrift
   // connection between OpenR and platform service remains up forever under
@@ -182,6 +225,33 @@ class Constants {
   // Kvstore timer for flooding pending publication
   static constexpr std::chrono::milliseconds kFloodPendingPublication{100};
 
+  // Max size of key-values flooded in one publication when flooding buffered
+  // updates
+  static constexpr size_t kFloodBatchMaxBytes{1024 * 1024};
+
+  // Smallest KvStore value compressed when sent to peers accepting
+  // compression
+  static constexpr size_t kValueCompressionMinBytes{4096};
+
+  // Number of key-values merged recently KvStore remembers, to drop copies of
+  // the same flood received from other peers before merging them
+  static constexpr size_t kRecentKeyValsCacheSize{8192};
+
+  // Interval of saving KvStore snapshots to disk, if enabled
+  static constexpr std::chrono::seconds kKvStoreSnapshotInterval{60};
+
+  // Max requests in flight to a KvStore peer over THRIFT transport, further
+  // updates wait and get merged
+  static constexpr size_t kThriftPeerMaxPendingRequests{16};
+
+  // Max size of key-values queued for a KvStore peer over ZMQ transport
+  // whose socket is full. Beyond it the peer gets full-synced instead
+  static constexpr size_t kPeerSendQueueMaxBytes{16 * 1024 * 1024};
+
+  // Backoff of retrying to send queued key-values to a KvStore peer
+  static constexpr std::chrono::milliseconds kPeerSendQueueInitialBackoff{8};
+  static constexpr std::chrono::milliseconds kPeerSendQueueMaxBackoff{1024};
+
   // KvStore database TTLs
   static constexpr std::chrono::milliseconds kKvStoreDbTtl{5min};
 
@@ -213,6 +283,12 @@ class Constants {
 
   // max interval to update TTL for each key in kvstore w/ finite TTL
   static constexpr std::chrono::milliseconds kMaxTtlUpdateInterval{2h};
+  // TTL of keys is refreshed every quarter of the TTL, shortened by a random
+  // fraction up to the jitter so keys set together don't stay in lockstep
+  static constexpr double kTtlRefreshJitter{0.25};
+  // TTL refreshes of a client are sent on ticks, at most so many per tick
+  static constexpr std::chrono::milliseconds kTtlRefreshTick{50};
+  static constexpr size_t kTtlRefreshesPerTick{256};
   // TTL infinity, never expires
   // int version
   static constexpr int64_t kTtlInfinity{INT32_MIN};
@@ -228,11 +304,24 @@ class Constants {
 
   // buffer size to keep latest perf log
   static constexpr uint16_t kPerfBufferSize{10};
+  // buffer size to keep latest route programming stats of Fib
+  static constexpr uint16_t kFibProgrammingStatsBufferSize{1000};
   static constexpr std::chrono::seconds kConvergenceMaxDuration{3s};
+  // upper bound on distinct perf event stages Fib keeps histograms of
+  static constexpr uint16_t kMaxPerfStageHistograms{64};
 
   // hold time for longPoll requests in openrCtrl thrift server
   static constexpr std::chrono::milliseconds kLongPollReqHoldTime{20000};
 
+  // admission of expensive read-only requests of openrCtrl thrift server to
+  // its low priority lane: requests in flight and queued in the lane, in
+  // flight per API, and threads with their nice value materializing responses
+  static constexpr size_t kCtrlLowPriorityMaxInFlight{4};
+  static constexpr size_t kCtrlLowPriorityMaxQueued{32};
+  static constexpr size_t kCtrlLowPriorityApiMaxInFlight{2};
+  static constexpr size_t kCtrlLowPriorityThreads{2};
+  static constexpr int kCtrlLowPriorityThreadPriority{10};
+
   //
   // Prefix manager specific
   //
@@ -240,6 +329,16 @@ class Constants {
   // the time we hold on to announce to KvStore
   static constexpr std::chrono::milliseconds kPrefixMgrKvThrottleTimeout{250};
 
+  // prefix db changes are persisted once there were no changes for the
+  // debounce time, but no later than the max delay after the first one
+  static constexpr std::chrono::milliseconds kPrefixMgrPersistDebounce{1000};
+  static constexpr std::chrono::milliseconds kPrefixMgrPersistMaxDelay{10000};
+
+  // prefixes of a node advertised in hash buckets are in keys marked with
+  // this, the number of buckets is a power of two up to the max
+  static constexpr folly::StringPiece kPrefixBucketKeyMarker{"bucket"};
+  static constexpr size_t kPrefixMgrMaxPrefixBuckets{1024};
+
   // OpenR ports
 
   // Openr Ctrl thrift server port
@@ -275,6 +374,18 @@ class Constants {
   // Threshold time in secs to crash after reaching critical memory
   static constexpr std::chrono::seconds kMemoryThresholdTime{600};
 
+  // Interval of watchdog probes measuring event base lag
+  static constexpr std::chrono::milliseconds kEvbLagProbeInterval{500};
+
+  // Bounds of CPU profiles taken through the ctrl API
+  static constexpr std::chrono::seconds kCpuProfileMaxDuration{30};
+  static constexpr std::chrono::seconds kCpuProfileMinInterval{60};
+  static constexpr uint32_t kCpuProfileMaxFrequencyHz{1000};
+  static constexpr size_t kCpuProfileMaxSamples{20000};
+
+  // Number of slow event base callbacks kept, see SlowCallbackDetector
+  static constexpr size_t kSlowCallbacksCapacity{256};
+
   static const std::list<std::string>&
   getNextProtocolsForThriftServers() {
     static const std::list<std::string> result{
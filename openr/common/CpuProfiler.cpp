@@ -0,0 +1,272 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CpuProfiler.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Demangle.h>
+#include <folly/Format.h>
+#include <folly/ScopeGuard.h>
+#include <folly/experimental/symbolizer/StackTrace.h>
+#include <folly/experimental/symbolizer/Symbolizer.h>
+#include <glog/logging.h>
+
+#include <openr/common/Constants.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace openr {
+
+namespace {
+
+// frames of the signal handler on top of each sampled stack
+constexpr size_t kHandlerFrames{2};
+// deepest stack recorded, outermost frames beyond it are cut
+constexpr size_t kMaxFrames{32};
+
+struct Sample {
+  // index of the sampled thread in the profile
+  size_t thread{0};
+  size_t numFrames{0};
+  uintptr_t frames[kMaxFrames];
+};
+
+struct ProfiledThread {
+  std::string module;
+  pid_t tid{0};
+  pthread_t handle;
+};
+
+struct ProfilerState {
+  // guards all but the members used by the signal handler
+  std::mutex mutex;
+  std::vector<ProfiledThread> threads;
+  bool running{false};
+  std::optional<std::chrono::steady_clock::time_point> lastProfileEnd;
+
+  // used by the signal handler, samples get written while active
+  std::atomic<bool> active{false};
+  std::atomic<int> numHandlersRunning{0};
+  std::atomic<size_t> numSamples{0};
+  std::vector<Sample> samples;
+};
+
+ProfilerState&
+getState() {
+  static ProfilerState state;
+  return state;
+}
+
+// runs on the sampled thread, only async-signal-safe calls allowed
+void
+onProfSignal(int /* signo */, siginfo_t* info, void* /* context */) {
+  const auto savedErrno = errno;
+  auto& state = getState();
+  state.numHandlersRunning.fetch_add(1);
+  if (state.active.load()) {
+    const auto index = state.numSamples.fetch_add(1);
+    if (index < state.samples.size()) {
+      auto& sample = state.samples[index];
+      sample.thread = info->si_value.sival_int;
+      const auto numFrames =
+          folly::symbolizer::getStackTraceSafe(sample.frames, kMaxFrames);
+      sample.numFrames = numFrames > 0 ? numFrames : 0;
+    }
+  }
+  state.numHandlersRunning.fetch_sub(1);
+  errno = savedErrno;
+}
+
+bool
+installSignalHandler() {
+  struct sigaction action {};
+  action.sa_sigaction = onProfSignal;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  return sigaction(SIGPROF, &action, nullptr) == 0;
+}
+
+} // namespace
+
+void
+CpuProfiler::registerThread(std::string const& module) noexcept {
+  // the first unwind initializes the unwinder, which is not safe to do in
+  // the signal handler
+  uintptr_t frames[kMaxFrames];
+  folly::symbolizer::getStackTraceSafe(frames, kMaxFrames);
+
+  auto& state = getState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.threads.push_back(
+      {module, static_cast<pid_t>(::syscall(SYS_gettid)), ::pthread_self()});
+}
+
+void
+CpuProfiler::unregisterThread() noexcept {
+  const auto tid = static_cast<pid_t>(::syscall(SYS_gettid));
+  auto& state = getState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.threads.erase(
+      std::remove_if(
+          state.threads.begin(),
+          state.threads.end(),
+          [tid](ProfiledThread const& thread) { return thread.tid == tid; }),
+      state.threads.end());
+}
+
+folly::Expected<std::string, std::string>
+CpuProfiler::profile(
+    std::chrono::milliseconds duration, uint32_t frequencyHz) noexcept {
+  if (duration.count() <= 0 or duration > Constants::kCpuProfileMaxDuration) {
+    return folly::makeUnexpected(folly::sformat(
+        "Duration must be positive and at most {}s",
+        Constants::kCpuProfileMaxDuration.count()));
+  }
+  if (frequencyHz == 0 or frequencyHz > Constants::kCpuProfileMaxFrequencyHz) {
+    return folly::makeUnexpected(folly::sformat(
+        "Frequency must be positive and at most {}Hz",
+        Constants::kCpuProfileMaxFrequencyHz));
+  }
+  static const bool handlerInstalled = installSignalHandler();
+  if (not handlerInstalled) {
+    return folly::makeUnexpected(
+        std::string{"Failed to install SIGPROF handler"});
+  }
+
+  auto& state = getState();
+  std::vector<ProfiledThread> threads;
+  std::vector<timer_t> timers;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.threads.empty()) {
+      return folly::makeUnexpected(std::string{
+          "No threads to profile, is Open/R running with "
+          "--enable_cpu_profiler?"});
+    }
+    if (state.running) {
+      return folly::makeUnexpected(std::string{"A profile is running"});
+    }
+    if (state.lastProfileEnd.has_value() and
+        std::chrono::steady_clock::now() - *state.lastProfileEnd <
+            Constants::kCpuProfileMinInterval) {
+      return folly::makeUnexpected(folly::sformat(
+          "At most one profile every {}s",
+          Constants::kCpuProfileMinInterval.count()));
+    }
+    state.running = true;
+    threads = state.threads;
+
+    state.samples.assign(Constants::kCpuProfileMaxSamples, Sample{});
+    state.numSamples = 0;
+    state.active = true;
+
+    // timers are armed while holding the lock, so that threads can't exit
+    // in between
+    const int64_t intervalNs = 1000000000L / frequencyHz;
+    for (size_t i = 0; i < threads.size(); ++i) {
+      clockid_t clock;
+      if (::pthread_getcpuclockid(threads[i].handle, &clock) != 0) {
+        LOG(WARNING) << "No CPU clock of thread " << threads[i].tid << " of "
+                     << threads[i].module;
+        continue;
+      }
+      struct sigevent event {};
+      event.sigev_notify = SIGEV_THREAD_ID;
+      event.sigev_signo = SIGPROF;
+      event.sigev_notify_thread_id = threads[i].tid;
+      event.sigev_value.sival_int = static_cast<int>(i);
+      timer_t timer;
+      if (::timer_create(clock, &event, &timer) != 0) {
+        LOG(WARNING) << "Failed to create profiling timer of thread "
+                     << threads[i].tid << " of " << threads[i].module;
+        continue;
+      }
+      struct itimerspec spec {};
+      spec.it_interval.tv_sec = intervalNs / 1000000000L;
+      spec.it_interval.tv_nsec = intervalNs % 1000000000L;
+      spec.it_value = spec.it_interval;
+      ::timer_settime(timer, 0, &spec, nullptr);
+      timers.emplace_back(timer);
+    }
+  }
+  SCOPE_EXIT {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.running = false;
+    state.lastProfileEnd = std::chrono::steady_clock::now();
+    std::vector<Sample>().swap(state.samples);
+  };
+
+  /* sleep override */
+  std::this_thread::sleep_for(duration);
+
+  // no more samples once no handler runs
+  for (auto& timer : timers) {
+    ::timer_delete(timer);
+  }
+  state.active = false;
+  while (state.numHandlersRunning.load()) {
+    std::this_thread::yield();
+  }
+
+  const auto numTaken = state.numSamples.load();
+  const auto numSamples = std::min(numTaken, state.samples.size());
+  if (numTaken > numSamples) {
+    LOG(WARNING) << "CPU profile dropped " << numTaken - numSamples
+                 << " samples above limit of " << numSamples;
+  }
+
+  // fold stacks, outermost frame first
+  folly::symbolizer::Symbolizer symbolizer;
+  std::unordered_map<uintptr_t, std::string> frameNames;
+  std::map<std::string, size_t> stackCounts;
+  for (size_t i = 0; i < numSamples; ++i) {
+    auto const& sample = state.samples[i];
+    std::string stack = threads.at(sample.thread).module;
+    for (size_t frame = sample.numFrames; frame > kHandlerFrames; --frame) {
+      const auto address = sample.frames[frame - 1];
+      auto it = frameNames.find(address);
+      if (it == frameNames.end()) {
+        folly::symbolizer::SymbolizedFrame symbolizedFrame;
+        symbolizer.symbolize(address, symbolizedFrame);
+        it = frameNames
+                 .emplace(
+                     address,
+                     symbolizedFrame.found and symbolizedFrame.name
+                         ? folly::demangle(symbolizedFrame.name).toStdString()
+                         : folly::sformat("{:#x}", address))
+                 .first;
+      }
+      stack.append(";").append(it->second);
+    }
+    ++stackCounts[stack];
+  }
+
+  std::string folded;
+  for (auto const& [stack, count] : stackCounts) {
+    folded.append(folly::sformat("{} {}\n", stack, count));
+  }
+  return folded;
+}
+
+} // namespace openr
@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <folly/Expected.h>
+
+namespace openr {
+
+/**
+ * In-process sampling CPU profiler of module threads. Threads register with
+ * the name of their module. A profile arms a timer on the CPU clock of each
+ * registered thread, which sends SIGPROF to the thread. The signal handler
+ * records the stack of the thread, stacks get symbolized once the profile
+ * is done.
+ *
+ * Profiles are folded stacks, one line per distinct stack with the number of
+ * samples of it, "<module>;<outermost frame>;...;<innermost frame> <count>",
+ * as taken by flamegraph.pl and pprof.
+ *
+ * Overhead is bounded: one profile runs at a time and at most once every
+ * kCpuProfileMinInterval, for at most kCpuProfileMaxDuration, sampling at
+ * most kCpuProfileMaxFrequencyHz per thread and keeping at most
+ * kCpuProfileMaxSamples samples.
+ */
+class CpuProfiler {
+ public:
+  // Profile calling thread as thread of module, until it unregisters
+  static void registerThread(std::string const& module) noexcept;
+  static void unregisterThread() noexcept;
+
+  // Profile registered threads for duration, blocks until done. Returns
+  // folded stacks, or an error why no profile can be taken now
+  static folly::Expected<std::string, std::string> profile(
+      std::chrono::milliseconds duration, uint32_t frequencyHz) noexcept;
+};
+
+} // namespace openr
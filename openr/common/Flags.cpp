@@ -22,6 +22,13 @@ DEFINE_string(
     areas,
     openr::thrift::KvStore_constants::kDefaultArea(),
     "Comma separated list of areas name specified as string");
+DEFINE_string(
+    area_summary_prefixes,
+    "",
+    "Comma separated list of summary ranges of areas as <prefix>@<area>, e.g. "
+    "10.1.0.0/16@area1. At the border of an area, a range is advertised into "
+    "the other areas while prefixes of the area within it exist, and this "
+    "node's prefixes within it are advertised into the area only");
 DEFINE_int32(
     monitor_pub_port,
     openr::Constants::kMonitorPubPort,
@@ -56,6 +63,11 @@ DEFINE_string(
     config_store_filepath,
     "/tmp/aq_persistent_config_store.bin",
     "File name where to persist OpenR's internal state across restarts");
+DEFINE_bool(
+    config_store_fsync,
+    false,
+    "If set, writes of config store are flushed to disk with fsync before "
+    "their requests complete");
 DEFINE_bool(
     assume_drained,
     false,
@@ -81,6 +93,26 @@ DEFINE_bool(enable_prefix_alloc, false, "Enable automatic prefix allocation");
 DEFINE_int32(alloc_prefix_len, 128, "Allocated prefix length");
 DEFINE_bool(static_prefix_alloc, false, "Perform static prefix allocation");
 DEFINE_bool(per_prefix_keys, false, "Create per IP prefix keys in Kvstore");
+DEFINE_int32(
+    prefix_key_bucket_size,
+    0,
+    "Advertise the prefixes of this node in hash buckets of about this many "
+    "prefixes, one key per bucket, in place of the single prefix db key. "
+    "The number of buckets follows the number of prefixes. Zero disables, "
+    "per prefix keys take precedence. Decision of all nodes must understand "
+    "them before enabling");
+DEFINE_bool(
+    per_adjacency_keys,
+    false,
+    "Create per adjacency keys in KvStore, next to the adjacency db key which "
+    "then carries no adjacencies. A change of one adjacency floods its key "
+    "only. Decision of all nodes must understand them before enabling");
+DEFINE_bool(
+    enable_compact_lsdb_encoding,
+    false,
+    "Advertise adjacency and prefix databases in the compact encoding, which "
+    "is smaller and faster to decode than thrift serialized ones. All nodes "
+    "must be able to decode them before enabling");
 DEFINE_bool(
     set_loopback_address,
     false,
@@ -91,6 +123,12 @@ DEFINE_bool(
     "If enabled then all global addresses assigned on loopback will be flushed "
     "whenever OpenR elects new prefix for node. Only effective when prefix "
     "allocator is turned on and set_loopback_address is also turned on");
+DEFINE_bool(
+    async_loopback_addr,
+    false,
+    "If enabled then prefix allocator programs loopback addresses without "
+    "waiting for the system service, and keeps processing allocation updates "
+    "meanwhile. Only effective when set_loopback_address is also turned on");
 DEFINE_string(
     iface_regex_include,
     "",
@@ -121,6 +159,11 @@ DEFINE_bool(
     enable_rtt_metric,
     true,
     "Use dynamically learned RTT for interface metric values.");
+DEFINE_bool(
+    rtt_metric_dampening,
+    false,
+    "Dampen changes of RTT based metrics before advertising them, see "
+    "rtt_metric_dampening_* flags");
 DEFINE_bool(
     enable_v4,
     false,
@@ -132,6 +175,41 @@ DEFINE_bool(
     enable_ordered_fib_programming,
     false,
     "Enable ordered fib programming per RFC 6976");
+DEFINE_int32(
+    fib_sync_chunk_size,
+    0,
+    "Full sync of routes with the switch agent in chunks of this many routes, "
+    "interleaved with route updates. Requires chunked sync support of the "
+    "agent. 0 to sync all routes in a single call");
+DEFINE_bool(
+    enable_fib_nexthop_groups,
+    false,
+    "Program unicast route updates with next-hop groups shared by routes. "
+    "Requires next-hop group support of the switch agent");
+DEFINE_bool(
+    enable_fib_graceful_restart,
+    false,
+    "Keep routes the switch agent has programmed for Open/R across restarts "
+    "of Open/R. They get reconciled with the first routes of Decision by "
+    "route updates instead of replaced with a full sync");
+DEFINE_string(
+    fib_critical_prefixes,
+    "",
+    "Comma separated list of prefixes whose route updates, along with those "
+    "of default routes and node labels, Fib programs ahead of the others, "
+    "e.g. loopback and infrastructure prefixes");
+DEFINE_string(
+    fib_download_prefixes,
+    "",
+    "Comma separated list of prefixes. If set, along with "
+    "fib_download_prefix_types, Fib programs only default routes and unicast "
+    "routes within these or of these types. Others are kept and shown by the "
+    "route APIs, but suppressed");
+DEFINE_string(
+    fib_download_prefix_types,
+    "",
+    "Comma separated list of prefix types, e.g. BGP, whose unicast routes Fib "
+    "programs. See fib_download_prefixes");
 DEFINE_bool(
     enable_bgp_route_programming,
     true,
@@ -160,6 +238,11 @@ DEFINE_int32(
     spark_fastinit_keepalive_time_ms,
     100,
     "Fast initial keep alive time (in milliseconds)");
+DEFINE_int32(
+    spark_num_workers,
+    1,
+    "Number of Spark workers, each with a thread and socket of its own. "
+    "Interfaces are spread over the workers by ifIndex.");
 DEFINE_string(
     spark_report_url, "inproc://spark_server_report", "Spark Report URL");
 DEFINE_string(spark_cmd_url, "inproc://spark_server_cmd", "Spark Cmd URL");
@@ -190,10 +273,67 @@ DEFINE_int32(
     5,
     "How long (in seconds) to keep neighbor adjacency without receiving "
     "any heartbeat packet in stable state.");
+DEFINE_int32(
+    spark2_heartbeat_stable_time_s,
+    0,
+    "If positive, interfaces whose adjacencies didn't change for this long "
+    "(in seconds) back off their heartbeats, up to a third of the heartbeat "
+    "hold time negotiated with their neighbors. 0 sends heartbeats at a fixed "
+    "interval.");
+DEFINE_int32(
+    spark2_heartbeat_max_pps,
+    0,
+    "Max heartbeats per second of a Spark worker over all its interfaces, "
+    "met by backing off heartbeats within their hold times. Applies with "
+    "spark2_heartbeat_stable_time_s only, 0 for no limit.");
+DEFINE_bool(
+    spark_liveness_offload,
+    false,
+    "If set, liveness of Spark2 adjacencies is also checked by a dedicated "
+    "thread exchanging unicast heartbeats at a sub-second interval.");
+DEFINE_int32(
+    spark_liveness_port,
+    6667,
+    "UDP port of the liveness monitor. Spark worker N uses this port + N.");
+DEFINE_int32(
+    spark_liveness_tx_interval_ms,
+    100,
+    "Interval (in milliseconds) between liveness heartbeats.");
+DEFINE_int32(
+    spark_liveness_hold_time_ms,
+    300,
+    "How long (in milliseconds) to keep an adjacency without receiving "
+    "any liveness heartbeat. Must be at least 3 times the tx interval.");
+DEFINE_int32(
+    spark_liveness_thread_priority,
+    0,
+    "SCHED_FIFO priority of the liveness monitor thread, 0 keeps the "
+    "default scheduling policy.");
 DEFINE_bool(
     enable_netlink_fib_handler,
     false,
     "If set, netlink fib handler will be started for route programming.");
+DEFINE_bool(
+    enable_fib_in_process_agent,
+    false,
+    "Program routes through the netlink fib handler of this process directly "
+    "instead of over thrift on fib_handler_port. The handler keeps serving "
+    "on the port for other clients. Requires enable_netlink_fib_handler.");
+DEFINE_bool(
+    enable_netlink_nexthop_objects,
+    false,
+    "Back next-hop groups of the netlink fib handler with kernel nexthop "
+    "objects, so that updating a group moves all of its routes at once. "
+    "Requires Linux 5.3 or newer");
+DEFINE_int32(
+    netlink_min_iov_msg,
+    50,
+    "Smallest window of netlink messages in flight to the kernel. The window "
+    "grows while acks come back fast and shrinks on ENOBUFS or timeouts");
+DEFINE_int32(
+    netlink_max_iov_msg,
+    2000,
+    "Largest window of netlink messages in flight to the kernel");
 DEFINE_bool(
     enable_netlink_system_handler,
     true,
@@ -215,6 +355,27 @@ DEFINE_int32(
     link_flap_max_backoff_ms,
     60000,
     "Max backoff to dampen link flaps (in millseconds)");
+DEFINE_int32(
+    rtt_metric_dampening_penalty,
+    1000,
+    "Penalty of a RTT based metric change of an adjacency");
+DEFINE_int32(
+    rtt_metric_dampening_suppress_threshold,
+    2000,
+    "Penalty at which RTT based metric changes of an adjacency get suppressed");
+DEFINE_int32(
+    rtt_metric_dampening_reuse_threshold,
+    750,
+    "Penalty below which suppressed RTT based metric changes get advertised");
+DEFINE_int32(
+    rtt_metric_dampening_half_life_s,
+    60,
+    "Time for the penalty of RTT based metric changes to decay by half");
+DEFINE_int32(
+    rtt_metric_min_change_pct,
+    10,
+    "Ignore RTT based metric changes smaller than this percentage of the "
+    "advertised metric when dampening");
 DEFINE_bool(
     enable_perf_measurement,
     true,
@@ -229,6 +390,22 @@ DEFINE_int32(
     250,
     "Decision debounce time to update spf in frequent adj db update "
     "(in milliseconds)");
+DEFINE_int32(
+    decision_spf_threads,
+    0,
+    "Number of threads Decision runs SPF computations of all areas and large "
+    "route builds on. Set to 0 to use one thread per hardware core.");
+DEFINE_int32(
+    decision_remote_lfa_spf_runs,
+    0,
+    "Number of SPF runs from remote nodes per topology change Decision spends "
+    "on finding remote LFA (RFC 7490) tunnels, by node label, for prefixes "
+    "without LFA. Requires enable_lfa. Set to 0 to disable remote LFA.");
+DEFINE_int32(
+    decision_trace_spans,
+    openr::Constants::kDecisionTraceSpans,
+    "Number of latest route computation spans Decision keeps for the "
+    "getDecisionTraceSpans API. Set to 0 to disable tracing.");
 DEFINE_bool(
     enable_watchdog,
     true,
@@ -236,6 +413,11 @@ DEFINE_bool(
     "openr thread, if unhealthy thread is detected, force crash openr");
 DEFINE_int32(watchdog_interval_s, 20, "Watchdog thread healthcheck interval");
 DEFINE_int32(watchdog_threshold_s, 300, "Watchdog thread aliveness threshold");
+DEFINE_int32(
+    watchdog_slow_callback_threshold_ms,
+    100,
+    "Event base callbacks and fiber tasks of modules running longer get "
+    "recorded by the watchdog, see getSlowCallbacks()");
 DEFINE_bool(
     enable_segment_routing, false, "Flag to disable/enable segment routing");
 DEFINE_bool(set_leaf_node, false, "Flag to enable/disable node as a leaf node");
@@ -250,6 +432,22 @@ DEFINE_string(
     "Only keys with originator ID matching any of the originator ID will "
     "be added to kvstore.");
 DEFINE_int32(memory_limit_mb, 300, "Memory limit in MB");
+DEFINE_bool(
+    memory_accounting,
+    false,
+    "Account memory per module with a jemalloc arena for the threads of each "
+    "module. No-op without jemalloc");
+DEFINE_string(
+    thread_placement,
+    "",
+    "CPU affinity and scheduling of module threads, e.g. "
+    "'Spark:cpus=0-1:fifo=10;Watchdog:fifo=5;Decision:cpus=2-7:nice=5'. "
+    "Options are cpus=<list>, numa=<node>, fifo=<priority> and nice=<value>");
+DEFINE_bool(
+    enable_cpu_profiler,
+    false,
+    "Allow CPU profiles of module threads through the ctrl API, sampled with "
+    "SIGPROF");
 DEFINE_int32(
     kvstore_zmq_hwm,
     openr::Constants::kHighWaterMark,
@@ -274,6 +472,118 @@ DEFINE_int32(
     kvstore_ttl_decrement_ms,
     openr::Constants::kTtlDecrement.count(),
     "Amount of time to decrement TTL when flooding updates");
+DEFINE_bool(
+    kvstore_enable_bucket_sync,
+    false,
+    "Full-sync with peers by exchanging hashes of key buckets instead of "
+    "hashes of all keys. Only keys of differing buckets get sent. Must be "
+    "supported by all nodes of an area");
+DEFINE_bool(
+    kvstore_enable_originator_sync,
+    false,
+    "Full-sync with peers by exchanging hashes of the keys of every "
+    "originator. Only keys of differing originators get sent, taking "
+    "precedence over kvstore_enable_bucket_sync. Must be supported by all "
+    "nodes of an area");
+DEFINE_int32(
+    kvstore_ttl_expiry_slack_ms,
+    0,
+    "Expire KvStore keys expiring within this long of each other together, "
+    "up to this long late, and publish them at once. 0 expires every key on "
+    "time");
+DEFINE_int32(
+    kvstore_flood_batch_ms,
+    0,
+    "Hold flooded KvStore updates for up to this long and flood them in "
+    "batches. 0 disables batching");
+DEFINE_int32(
+    kvstore_flood_batch_bytes,
+    openr::Constants::kFloodBatchMaxBytes,
+    "Max size of key-values in a batch of flooded KvStore updates, a batch is "
+    "flooded right away once it reaches it");
+DEFINE_int32(
+    kvstore_peer_send_queue_bytes,
+    openr::Constants::kPeerSendQueueMaxBytes,
+    "Max size of KvStore updates queued for a peer whose socket is full. The "
+    "peer gets full-synced instead once they exceed it");
+DEFINE_bool(
+    kvstore_enable_compact_ttl_updates,
+    false,
+    "Flood TTL refreshes of keys as compact TTL updates, matched by value hash "
+    "instead of carrying the originator. Must be supported by all nodes of an "
+    "area");
+DEFINE_string(
+    kvstore_value_compression,
+    "NONE",
+    "Compress KvStore values sent to peers which can decompress them with this "
+    "codec, one of NONE, ZSTD or LZ4");
+DEFINE_int32(
+    kvstore_value_compression_min_bytes,
+    openr::Constants::kValueCompressionMinBytes,
+    "Only compress KvStore values of at least this size");
+DEFINE_string(
+    kvstore_peer_transport,
+    "ZMQ",
+    "Transport KvStore talks to peers over, ZMQ or THRIFT. THRIFT uses the "
+    "OpenrCtrl thrift server of peers and falls back to ZMQ for peers without "
+    "a known thrift server address");
+DEFINE_string(
+    kvstore_hash_version,
+    "V1",
+    "Hash of KvStore values, and how values of same version and originator "
+    "are ordered. V1 (boost hash_combine, ordered by bytes) or V2 "
+    "(SpookyHashV2, ordered by size and hash first). All nodes of a network "
+    "must use the same version");
+DEFINE_bool(
+    kvstore_enable_area_threads,
+    false,
+    "Run each KvStore area on a thread of its own instead of all areas on the "
+    "KvStore thread");
+DEFINE_string(
+    kvstore_snapshot_dir,
+    "",
+    "Directory KvStore periodically saves the key-values of its areas to, and "
+    "restores them from on start before syncing with peers. Disabled if "
+    "empty");
+DEFINE_string(
+    kvstore_priority_flood_key_markers,
+    "adj:,allocprefix:",
+    "Comma separated key markers, e.g. adj:, of KvStore keys flooded right "
+    "away, bypassing flood batching and rate limiting");
+DEFINE_int64(
+    kvstore_max_keys,
+    0,
+    "Max number of keys of a KvStore area, new keys beyond it are rejected. "
+    "0 for no limit");
+DEFINE_int64(
+    kvstore_max_bytes,
+    0,
+    "Max bytes of keys and values of a KvStore area, updates beyond it are "
+    "rejected. 0 for no limit");
+DEFINE_int64(
+    kvstore_max_keys_per_originator,
+    100000,
+    "Max number of keys of an originator in a KvStore area. 0 for no limit");
+DEFINE_int64(
+    kvstore_max_bytes_per_originator,
+    256 * 1024 * 1024,
+    "Max bytes of keys and values of an originator in a KvStore area. 0 for "
+    "no limit");
+DEFINE_double(
+    kvstore_max_updates_per_originator_per_sec,
+    1000,
+    "Max rate of value updates of an originator merged into a KvStore area, "
+    "full-sync responses are not rate limited. 0 for no limit");
+DEFINE_double(
+    kvstore_max_update_burst_per_originator,
+    10000,
+    "Burst of value updates of an originator above "
+    "kvstore_max_updates_per_originator_per_sec");
+DEFINE_string(
+    kvstore_budget_exempt_key_markers,
+    "adj:,prefix:",
+    "Comma separated key markers of KvStore keys always admitted, whatever "
+    "the KvStore budgets");
 DEFINE_bool(
     enable_secure_thrift_server,
     false,
@@ -310,6 +620,11 @@ DEFINE_string(
     "A comma separated list of strings. Strings are x509 common names to "
     "accept SSL connections from. If an empty string is provided, the server "
     "will accept connections from any authenticated peer.");
+DEFINE_int32(
+    ctrl_counters_cache_ms,
+    1000,
+    "Counter requests of OpenrCtrl thrift server are served from a snapshot "
+    "of at most this age. 0 takes a fresh snapshot on every request");
 DEFINE_bool(enable_flood_optimization, false, "Enable flooding optimization");
 DEFINE_bool(is_flood_root, false, "set myself as flooding root or not");
 // TODO this option will be deprecated in near future, this is just for safely
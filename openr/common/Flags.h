@@ -17,6 +17,7 @@ DECLARE_int32(kvstore_rep_port);
 DECLARE_bool(enable_plugin);
 
 DECLARE_string(areas);
+DECLARE_string(area_summary_prefixes);
 
 DECLARE_int32(monitor_pub_port);
 DECLARE_int32(monitor_rep_port);
@@ -28,6 +29,7 @@ DECLARE_string(platform_pub_url);
 DECLARE_string(domain);
 DECLARE_string(listen_addr);
 DECLARE_string(config_store_filepath);
+DECLARE_bool(config_store_fsync);
 DECLARE_bool(assume_drained);
 DECLARE_string(node_name);
 DECLARE_bool(dryrun);
@@ -39,9 +41,13 @@ DECLARE_bool(enable_prefix_alloc);
 DECLARE_int32(alloc_prefix_len);
 DECLARE_bool(static_prefix_alloc);
 DECLARE_bool(per_prefix_keys);
+DECLARE_int32(prefix_key_bucket_size);
+DECLARE_bool(per_adjacency_keys);
+DECLARE_bool(enable_compact_lsdb_encoding);
 
 DECLARE_bool(set_loopback_address);
 DECLARE_bool(override_loopback_addr);
+DECLARE_bool(async_loopback_addr);
 
 DECLARE_string(iface_regex_include);
 DECLARE_string(iface_regex_exclude);
@@ -52,9 +58,16 @@ DECLARE_string(cert_file_path);
 DECLARE_bool(enable_encryption);
 DECLARE_bool(enable_fib_service_waiting);
 DECLARE_bool(enable_rtt_metric);
+DECLARE_bool(rtt_metric_dampening);
 DECLARE_bool(enable_v4);
 DECLARE_bool(enable_lfa);
 DECLARE_bool(enable_ordered_fib_programming);
+DECLARE_int32(fib_sync_chunk_size);
+DECLARE_bool(enable_fib_nexthop_groups);
+DECLARE_bool(enable_fib_graceful_restart);
+DECLARE_string(fib_critical_prefixes);
+DECLARE_string(fib_download_prefixes);
+DECLARE_string(fib_download_prefix_types);
 DECLARE_bool(enable_bgp_route_programming);
 DECLARE_bool(bgp_use_igp_metric);
 
@@ -63,11 +76,16 @@ DECLARE_int32(decision_graceful_restart_window_s);
 DECLARE_int32(spark_hold_time_s);
 DECLARE_int32(spark_keepalive_time_s);
 DECLARE_int32(spark_fastinit_keepalive_time_ms);
+DECLARE_int32(spark_num_workers);
 
 DECLARE_string(spark_report_url);
 DECLARE_string(spark_cmd_url);
 
 DECLARE_bool(enable_netlink_fib_handler);
+DECLARE_bool(enable_fib_in_process_agent);
+DECLARE_bool(enable_netlink_nexthop_objects);
+DECLARE_int32(netlink_min_iov_msg);
+DECLARE_int32(netlink_max_iov_msg);
 DECLARE_bool(enable_netlink_system_handler);
 
 DECLARE_int32(ip_tos);
@@ -75,15 +93,24 @@ DECLARE_int32(zmq_context_threads);
 
 DECLARE_int32(link_flap_initial_backoff_ms);
 DECLARE_int32(link_flap_max_backoff_ms);
+DECLARE_int32(rtt_metric_dampening_penalty);
+DECLARE_int32(rtt_metric_dampening_suppress_threshold);
+DECLARE_int32(rtt_metric_dampening_reuse_threshold);
+DECLARE_int32(rtt_metric_dampening_half_life_s);
+DECLARE_int32(rtt_metric_min_change_pct);
 
 DECLARE_bool(enable_perf_measurement);
 
 DECLARE_int32(decision_debounce_min_ms);
 DECLARE_int32(decision_debounce_max_ms);
+DECLARE_int32(decision_spf_threads);
+DECLARE_int32(decision_remote_lfa_spf_runs);
+DECLARE_int32(decision_trace_spans);
 
 DECLARE_bool(enable_watchdog);
 DECLARE_int32(watchdog_interval_s);
 DECLARE_int32(watchdog_threshold_s);
+DECLARE_int32(watchdog_slow_callback_threshold_ms);
 
 DECLARE_bool(enable_segment_routing);
 DECLARE_bool(set_leaf_node);
@@ -92,6 +119,9 @@ DECLARE_string(key_prefix_filters);
 DECLARE_string(key_originator_id_filters);
 
 DECLARE_int32(memory_limit_mb);
+DECLARE_bool(memory_accounting);
+DECLARE_string(thread_placement);
+DECLARE_bool(enable_cpu_profiler);
 
 DECLARE_int32(kvstore_zmq_hwm);
 DECLARE_int32(kvstore_flood_msg_per_sec);
@@ -99,6 +129,27 @@ DECLARE_int32(kvstore_flood_msg_burst_size);
 DECLARE_int32(kvstore_key_ttl_ms);
 DECLARE_int32(kvstore_sync_interval_s);
 DECLARE_int32(kvstore_ttl_decrement_ms);
+DECLARE_bool(kvstore_enable_bucket_sync);
+DECLARE_bool(kvstore_enable_originator_sync);
+DECLARE_int32(kvstore_ttl_expiry_slack_ms);
+DECLARE_int32(kvstore_flood_batch_ms);
+DECLARE_int32(kvstore_flood_batch_bytes);
+DECLARE_int32(kvstore_peer_send_queue_bytes);
+DECLARE_bool(kvstore_enable_compact_ttl_updates);
+DECLARE_string(kvstore_value_compression);
+DECLARE_int32(kvstore_value_compression_min_bytes);
+DECLARE_string(kvstore_peer_transport);
+DECLARE_string(kvstore_hash_version);
+DECLARE_bool(kvstore_enable_area_threads);
+DECLARE_string(kvstore_snapshot_dir);
+DECLARE_string(kvstore_priority_flood_key_markers);
+DECLARE_int64(kvstore_max_keys);
+DECLARE_int64(kvstore_max_bytes);
+DECLARE_int64(kvstore_max_keys_per_originator);
+DECLARE_int64(kvstore_max_bytes_per_originator);
+DECLARE_double(kvstore_max_updates_per_originator_per_sec);
+DECLARE_double(kvstore_max_update_burst_per_originator);
+DECLARE_string(kvstore_budget_exempt_key_markers);
 
 DECLARE_bool(enable_secure_thrift_server);
 DECLARE_string(x509_cert_path);
@@ -107,6 +158,7 @@ DECLARE_string(x509_ca_path);
 DECLARE_string(tls_ticket_seed_path);
 DECLARE_string(tls_ecc_curve_name);
 DECLARE_string(tls_acceptable_peers);
+DECLARE_int32(ctrl_counters_cache_ms);
 
 DECLARE_bool(enable_flood_optimization);
 DECLARE_bool(is_flood_root);
@@ -120,6 +172,13 @@ DECLARE_int32(spark2_heartbeat_time_s);
 DECLARE_int32(spark2_handshake_time_ms);
 DECLARE_int32(spark2_negotiate_hold_time_s);
 DECLARE_int32(spark2_heartbeat_hold_time_s);
+DECLARE_int32(spark2_heartbeat_stable_time_s);
+DECLARE_int32(spark2_heartbeat_max_pps);
+DECLARE_bool(spark_liveness_offload);
+DECLARE_int32(spark_liveness_port);
+DECLARE_int32(spark_liveness_tx_interval_ms);
+DECLARE_int32(spark_liveness_hold_time_ms);
+DECLARE_int32(spark_liveness_thread_priority);
 
 DECLARE_bool(prefix_fwd_type_mpls);
 DECLARE_bool(prefix_algo_type_ksp2_ed_ecmp);
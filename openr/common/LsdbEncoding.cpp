@@ -0,0 +1,510 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "LsdbEncoding.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/Varint.h>
+
+namespace openr {
+
+namespace {
+
+void
+appendVarint(std::string& out, uint64_t value) {
+  uint8_t buf[folly::kMaxVarintLength64];
+  const auto len = folly::encodeVarint(value, buf);
+  out.append(reinterpret_cast<const char*>(buf), len);
+}
+
+// flags of AdjacencyDatabase
+constexpr uint64_t kAdjDbOverloaded{1 << 0};
+constexpr uint64_t kAdjDbPerfEvents{1 << 1};
+constexpr uint64_t kAdjDbArea{1 << 2};
+
+// flags of Adjacency
+constexpr uint64_t kAdjOverloaded{1 << 0};
+constexpr uint64_t kAdjMetricDampening{1 << 1};
+constexpr uint64_t kAdjMetricSuppressed{1 << 2};
+
+// flags of PrefixDatabase
+constexpr uint64_t kPrefixDbDeletePrefix{1 << 0};
+constexpr uint64_t kPrefixDbPerfEvents{1 << 1};
+constexpr uint64_t kPrefixDbPerPrefixKey{1 << 2};
+constexpr uint64_t kPrefixDbPerPrefixKeySet{1 << 3};
+
+// flags of PrefixEntry
+constexpr uint64_t kPrefixEphemeral{1 << 0};
+constexpr uint64_t kPrefixEphemeralSet{1 << 1};
+constexpr uint64_t kPrefixMv{1 << 2};
+constexpr uint64_t kPrefixMinNexthop{1 << 3};
+
+// flags of MetricEntity
+constexpr uint64_t kMetricTieBreaker{1 << 0};
+
+/**
+ * Writes the body of a value while collecting its strings, the string table
+ * goes in front of the body once done
+ */
+class Encoder {
+ public:
+  void
+  writeVarint(uint64_t value) {
+    appendVarint(body_, value);
+  }
+
+  void
+  writeInt(int64_t value) {
+    writeVarint(folly::encodeZigZag(value));
+  }
+
+  void
+  writeDouble(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+      body_.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+    }
+  }
+
+  void
+  writeString(std::string const& value) {
+    writeVarint(getIndex(value));
+  }
+
+  // zero if not set, else index plus one
+  template <typename OptionalString>
+  void
+  writeOptionalString(OptionalString const& value) {
+    writeVarint(value.has_value() ? getIndex(value.value()) + 1 : 0);
+  }
+
+  std::string
+  finish() {
+    std::string value;
+    value.push_back(static_cast<char>(kLsdbEncodingMagic));
+    value.push_back(static_cast<char>(kLsdbEncodingVersion));
+    appendVarint(value, strings_.size());
+    for (auto const& str : strings_) {
+      appendVarint(value, str.size());
+      value.append(str.data(), str.size());
+    }
+    value.append(body_);
+    return value;
+  }
+
+ private:
+  uint64_t
+  getIndex(std::string const& value) {
+    // strings outlive the encoder, they belong to the encoded database
+    const auto it = indices_.emplace(value, strings_.size());
+    if (it.second) {
+      strings_.emplace_back(value);
+    }
+    return it.first->second;
+  }
+
+  std::string body_;
+  std::vector<std::string_view> strings_;
+  std::unordered_map<std::string_view, uint64_t> indices_;
+};
+
+/**
+ * Reads the string table on construction, then the fields of the body in the
+ * order they were written. Throws on reading past the end of the value
+ */
+class Decoder {
+ public:
+  explicit Decoder(folly::StringPiece value) : value_(value) {
+    if (not isCompactLsdbValue(value_)) {
+      throw std::runtime_error("Not a compact lsdb value");
+    }
+    const uint8_t version = value_[1];
+    if (version != kLsdbEncodingVersion) {
+      throw std::runtime_error(
+          folly::sformat("Unknown compact lsdb value version {}", version));
+    }
+    value_.advance(2);
+
+    const auto numStrings = readVarint();
+    if (numStrings > value_.size()) {
+      throw std::runtime_error("Malformed compact lsdb string table");
+    }
+    strings_.reserve(numStrings);
+    for (uint64_t i = 0; i < numStrings; ++i) {
+      const auto len = readVarint();
+      if (len > value_.size()) {
+        throw std::runtime_error("Malformed compact lsdb string table");
+      }
+      strings_.emplace_back(value_.data(), len);
+      value_.advance(len);
+    }
+  }
+
+  uint64_t
+  readVarint() {
+    uint64_t value{0};
+    for (size_t shift = 0; shift < 64; shift += 7) {
+      if (value_.empty()) {
+        throw std::runtime_error("Truncated compact lsdb value");
+      }
+      const uint8_t byte = value_.front();
+      value_.advance(1);
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (not(byte & 0x80)) {
+        return value;
+      }
+    }
+    throw std::runtime_error("Malformed varint in compact lsdb value");
+  }
+
+  int64_t
+  readInt() {
+    return folly::decodeZigZag(readVarint());
+  }
+
+  double
+  readDouble() {
+    if (value_.size() < sizeof(uint64_t)) {
+      throw std::runtime_error("Truncated compact lsdb value");
+    }
+    uint64_t bits{0};
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+      bits |= static_cast<uint64_t>(static_cast<uint8_t>(value_[i])) << (8 * i);
+    }
+    value_.advance(sizeof(bits));
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  std::string
+  readString() {
+    return getString(readVarint());
+  }
+
+  template <typename OptionalString>
+  void
+  readOptionalString(OptionalString& value) {
+    const auto index = readVarint();
+    if (index) {
+      value = getString(index - 1);
+    }
+  }
+
+  // number of elements of a list, each takes at least a byte
+  size_t
+  readSize() {
+    const auto size = readVarint();
+    if (size > value_.size()) {
+      throw std::runtime_error("Malformed list size in compact lsdb value");
+    }
+    return size;
+  }
+
+  void
+  finish() const {
+    if (not value_.empty()) {
+      throw std::runtime_error("Trailing bytes in compact lsdb value");
+    }
+  }
+
+ private:
+  std::string
+  getString(uint64_t index) const {
+    if (index >= strings_.size()) {
+      throw std::runtime_error("Malformed string index in compact lsdb value");
+    }
+    return strings_[index].str();
+  }
+
+  folly::StringPiece value_;
+  std::vector<folly::StringPiece> strings_;
+};
+
+void
+encodeBinaryAddress(Encoder& encoder, thrift::BinaryAddress const& addr) {
+  encoder.writeString(addr.addr);
+  encoder.writeOptionalString(addr.ifName);
+}
+
+thrift::BinaryAddress
+decodeBinaryAddress(Decoder& decoder) {
+  thrift::BinaryAddress addr;
+  addr.addr = decoder.readString();
+  decoder.readOptionalString(addr.ifName);
+  return addr;
+}
+
+void
+encodePerfEvents(Encoder& encoder, thrift::PerfEvents const& perfEvents) {
+  encoder.writeVarint(perfEvents.events.size());
+  for (auto const& event : perfEvents.events) {
+    encoder.writeString(event.nodeName);
+    encoder.writeString(event.eventDescr);
+    encoder.writeInt(event.unixTs);
+  }
+}
+
+thrift::PerfEvents
+decodePerfEvents(Decoder& decoder) {
+  thrift::PerfEvents perfEvents;
+  const auto numEvents = decoder.readSize();
+  perfEvents.events.reserve(numEvents);
+  for (size_t i = 0; i < numEvents; ++i) {
+    thrift::PerfEvent event;
+    event.nodeName = decoder.readString();
+    event.eventDescr = decoder.readString();
+    event.unixTs = decoder.readInt();
+    perfEvents.events.emplace_back(std::move(event));
+  }
+  return perfEvents;
+}
+
+void
+encodeAdjacency(Encoder& encoder, thrift::Adjacency const& adj) {
+  uint64_t flags{0};
+  flags |= adj.isOverloaded ? kAdjOverloaded : 0;
+  if (adj.metricDampening.has_value()) {
+    flags |= kAdjMetricDampening;
+    flags |= adj.metricDampening->isSuppressed ? kAdjMetricSuppressed : 0;
+  }
+  encoder.writeVarint(flags);
+  encoder.writeString(adj.otherNodeName);
+  encoder.writeString(adj.ifName);
+  encoder.writeString(adj.otherIfName);
+  encodeBinaryAddress(encoder, adj.nextHopV6);
+  encodeBinaryAddress(encoder, adj.nextHopV4);
+  encoder.writeInt(adj.metric);
+  encoder.writeInt(adj.adjLabel);
+  encoder.writeInt(adj.rtt);
+  encoder.writeInt(adj.timestamp);
+  encoder.writeInt(adj.weight);
+  if (adj.metricDampening.has_value()) {
+    encoder.writeInt(adj.metricDampening->measuredMetric);
+    encoder.writeDouble(adj.metricDampening->penalty);
+    encoder.writeInt(adj.metricDampening->reuseDelayMs);
+  }
+}
+
+thrift::Adjacency
+decodeAdjacency(Decoder& decoder) {
+  thrift::Adjacency adj;
+  const auto flags = decoder.readVarint();
+  adj.isOverloaded = flags & kAdjOverloaded;
+  adj.otherNodeName = decoder.readString();
+  adj.ifName = decoder.readString();
+  adj.otherIfName = decoder.readString();
+  adj.nextHopV6 = decodeBinaryAddress(decoder);
+  adj.nextHopV4 = decodeBinaryAddress(decoder);
+  adj.metric = decoder.readInt();
+  adj.adjLabel = decoder.readInt();
+  adj.rtt = decoder.readInt();
+  adj.timestamp = decoder.readInt();
+  adj.weight = decoder.readInt();
+  if (flags & kAdjMetricDampening) {
+    thrift::AdjacencyMetricDampening metricDampening;
+    metricDampening.isSuppressed = flags & kAdjMetricSuppressed;
+    metricDampening.measuredMetric = decoder.readInt();
+    metricDampening.penalty = decoder.readDouble();
+    metricDampening.reuseDelayMs = decoder.readInt();
+    adj.metricDampening = std::move(metricDampening);
+  }
+  return adj;
+}
+
+void
+encodeMetricVector(Encoder& encoder, thrift::MetricVector const& mv) {
+  encoder.writeInt(mv.version);
+  encoder.writeVarint(mv.metrics.size());
+  for (auto const& entity : mv.metrics) {
+    encoder.writeVarint(entity.isBestPathTieBreaker ? kMetricTieBreaker : 0);
+    encoder.writeInt(entity.type);
+    encoder.writeInt(entity.priority);
+    encoder.writeInt(static_cast<int64_t>(entity.op));
+    encoder.writeVarint(entity.metric.size());
+    for (auto const& metric : entity.metric) {
+      encoder.writeInt(metric);
+    }
+  }
+}
+
+thrift::MetricVector
+decodeMetricVector(Decoder& decoder) {
+  thrift::MetricVector mv;
+  mv.version = decoder.readInt();
+  const auto numMetrics = decoder.readSize();
+  mv.metrics.reserve(numMetrics);
+  for (size_t i = 0; i < numMetrics; ++i) {
+    thrift::MetricEntity entity;
+    entity.isBestPathTieBreaker = decoder.readVarint() & kMetricTieBreaker;
+    entity.type = decoder.readInt();
+    entity.priority = decoder.readInt();
+    entity.op = static_cast<thrift::CompareType>(decoder.readInt());
+    const auto numValues = decoder.readSize();
+    entity.metric.reserve(numValues);
+    for (size_t j = 0; j < numValues; ++j) {
+      entity.metric.emplace_back(decoder.readInt());
+    }
+    mv.metrics.emplace_back(std::move(entity));
+  }
+  return mv;
+}
+
+void
+encodePrefixEntry(Encoder& encoder, thrift::PrefixEntry const& entry) {
+  uint64_t flags{0};
+  if (entry.ephemeral.has_value()) {
+    flags |= kPrefixEphemeralSet;
+    flags |= entry.ephemeral.value() ? kPrefixEphemeral : 0;
+  }
+  flags |= entry.mv.has_value() ? kPrefixMv : 0;
+  flags |= entry.minNexthop.has_value() ? kPrefixMinNexthop : 0;
+  encoder.writeVarint(flags);
+  encodeBinaryAddress(encoder, entry.prefix.prefixAddress);
+  encoder.writeInt(entry.prefix.prefixLength);
+  encoder.writeInt(static_cast<int64_t>(entry.type));
+  encoder.writeString(entry.data);
+  encoder.writeInt(static_cast<int64_t>(entry.forwardingType));
+  encoder.writeInt(static_cast<int64_t>(entry.forwardingAlgorithm));
+  if (entry.mv.has_value()) {
+    encodeMetricVector(encoder, entry.mv.value());
+  }
+  if (entry.minNexthop.has_value()) {
+    encoder.writeInt(entry.minNexthop.value());
+  }
+}
+
+thrift::PrefixEntry
+decodePrefixEntry(Decoder& decoder) {
+  thrift::PrefixEntry entry;
+  const auto flags = decoder.readVarint();
+  entry.prefix.prefixAddress = decodeBinaryAddress(decoder);
+  entry.prefix.prefixLength = decoder.readInt();
+  entry.type = static_cast<thrift::PrefixType>(decoder.readInt());
+  entry.data = decoder.readString();
+  entry.forwardingType =
+      static_cast<thrift::PrefixForwardingType>(decoder.readInt());
+  entry.forwardingAlgorithm =
+      static_cast<thrift::PrefixForwardingAlgorithm>(decoder.readInt());
+  if (flags & kPrefixEphemeralSet) {
+    entry.ephemeral = static_cast<bool>(flags & kPrefixEphemeral);
+  }
+  if (flags & kPrefixMv) {
+    entry.mv = decodeMetricVector(decoder);
+  }
+  if (flags & kPrefixMinNexthop) {
+    entry.minNexthop = decoder.readInt();
+  }
+  return entry;
+}
+
+} // namespace
+
+bool
+isCompactLsdbValue(folly::StringPiece value) {
+  return value.size() >= 2 and
+      static_cast<uint8_t>(value.front()) == kLsdbEncodingMagic;
+}
+
+std::string
+encodeCompactLsdbValue(thrift::AdjacencyDatabase const& adjDb) {
+  Encoder encoder;
+  uint64_t flags{0};
+  flags |= adjDb.isOverloaded ? kAdjDbOverloaded : 0;
+  flags |= adjDb.perfEvents.has_value() ? kAdjDbPerfEvents : 0;
+  flags |= adjDb.area.has_value() ? kAdjDbArea : 0;
+  encoder.writeVarint(flags);
+  encoder.writeString(adjDb.thisNodeName);
+  encoder.writeInt(adjDb.nodeLabel);
+  if (adjDb.area.has_value()) {
+    encoder.writeString(adjDb.area.value());
+  }
+  if (adjDb.perfEvents.has_value()) {
+    encodePerfEvents(encoder, adjDb.perfEvents.value());
+  }
+  encoder.writeVarint(adjDb.adjacencies.size());
+  for (auto const& adj : adjDb.adjacencies) {
+    encodeAdjacency(encoder, adj);
+  }
+  return encoder.finish();
+}
+
+std::string
+encodeCompactLsdbValue(thrift::PrefixDatabase const& prefixDb) {
+  Encoder encoder;
+  uint64_t flags{0};
+  flags |= prefixDb.deletePrefix ? kPrefixDbDeletePrefix : 0;
+  flags |= prefixDb.perfEvents.has_value() ? kPrefixDbPerfEvents : 0;
+  if (prefixDb.perPrefixKey.has_value()) {
+    flags |= kPrefixDbPerPrefixKeySet;
+    flags |= prefixDb.perPrefixKey.value() ? kPrefixDbPerPrefixKey : 0;
+  }
+  encoder.writeVarint(flags);
+  encoder.writeString(prefixDb.thisNodeName);
+  if (prefixDb.perfEvents.has_value()) {
+    encodePerfEvents(encoder, prefixDb.perfEvents.value());
+  }
+  encoder.writeVarint(prefixDb.prefixEntries.size());
+  for (auto const& entry : prefixDb.prefixEntries) {
+    encodePrefixEntry(encoder, entry);
+  }
+  return encoder.finish();
+}
+
+void
+decodeCompactLsdbValue(
+    folly::StringPiece value, thrift::AdjacencyDatabase& adjDb) {
+  Decoder decoder(value);
+  adjDb = thrift::AdjacencyDatabase{};
+  const auto flags = decoder.readVarint();
+  adjDb.isOverloaded = flags & kAdjDbOverloaded;
+  adjDb.thisNodeName = decoder.readString();
+  adjDb.nodeLabel = decoder.readInt();
+  if (flags & kAdjDbArea) {
+    adjDb.area = decoder.readString();
+  }
+  if (flags & kAdjDbPerfEvents) {
+    adjDb.perfEvents = decodePerfEvents(decoder);
+  }
+  const auto numAdjacencies = decoder.readSize();
+  adjDb.adjacencies.reserve(numAdjacencies);
+  for (size_t i = 0; i < numAdjacencies; ++i) {
+    adjDb.adjacencies.emplace_back(decodeAdjacency(decoder));
+  }
+  decoder.finish();
+}
+
+void
+decodeCompactLsdbValue(
+    folly::StringPiece value, thrift::PrefixDatabase& prefixDb) {
+  Decoder decoder(value);
+  prefixDb = thrift::PrefixDatabase{};
+  const auto flags = decoder.readVarint();
+  prefixDb.deletePrefix = flags & kPrefixDbDeletePrefix;
+  if (flags & kPrefixDbPerPrefixKeySet) {
+    prefixDb.perPrefixKey = static_cast<bool>(flags & kPrefixDbPerPrefixKey);
+  }
+  prefixDb.thisNodeName = decoder.readString();
+  if (flags & kPrefixDbPerfEvents) {
+    prefixDb.perfEvents = decodePerfEvents(decoder);
+  }
+  const auto numEntries = decoder.readSize();
+  prefixDb.prefixEntries.reserve(numEntries);
+  for (size_t i = 0; i < numEntries; ++i) {
+    prefixDb.prefixEntries.emplace_back(decodePrefixEntry(decoder));
+  }
+  decoder.finish();
+}
+
+} // namespace openr
@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/Range.h>
+
+#include <openr/if/gen-cpp2/Lsdb_types.h>
+
+namespace openr {
+
+/**
+ * Compact encoding of the adjacency and prefix databases advertised in
+ * KvStore. Node names, interface names and addresses repeat across the
+ * adjacencies and prefixes of a value, hence each distinct string and binary
+ * is written once into a string table at the start of the value and fields
+ * refer to it by index. Integers are zigzag varints, booleans and the
+ * presence of optional fields are packed into flags.
+ *
+ * Values start with kLsdbEncodingMagic, which no thrift protocol starts a
+ * struct with, followed by the version of the encoding. Readers tell compact
+ * values from thrift serialized ones by that and decode either, writers only
+ * write compact values once enabled, i.e. once every node of the network
+ * can decode them. Changes of the schema of the databases must bump
+ * kLsdbEncodingVersion.
+ */
+
+constexpr uint8_t kLsdbEncodingMagic{0xF0};
+constexpr uint8_t kLsdbEncodingVersion{1};
+
+// true if value is compactly encoded, of any version
+bool isCompactLsdbValue(folly::StringPiece value);
+
+std::string encodeCompactLsdbValue(thrift::AdjacencyDatabase const& adjDb);
+std::string encodeCompactLsdbValue(thrift::PrefixDatabase const& prefixDb);
+
+// throws std::runtime_error on malformed values and unknown versions
+void decodeCompactLsdbValue(
+    folly::StringPiece value, thrift::AdjacencyDatabase& adjDb);
+void decodeCompactLsdbValue(
+    folly::StringPiece value, thrift::PrefixDatabase& prefixDb);
+
+// write database as KvStore value, compact if set else serialized
+template <typename ThriftType, typename Serializer>
+std::string
+writeLsdbValue(ThriftType const& obj, Serializer& serializer, bool compact) {
+  if (compact) {
+    return encodeCompactLsdbValue(obj);
+  }
+  return fbzmq::util::writeThriftObjStr(obj, serializer);
+}
+
+// read database from KvStore value of either encoding, throws on malformed
+// values
+template <typename ThriftType, typename Serializer>
+ThriftType
+readLsdbValue(std::string const& value, Serializer& serializer) {
+  if (isCompactLsdbValue(value)) {
+    ThriftType obj;
+    decodeCompactLsdbValue(value, obj);
+    return obj;
+  }
+  return fbzmq::util::readThriftObjStr<ThriftType>(value, serializer);
+}
+
+} // namespace openr
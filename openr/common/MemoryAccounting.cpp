@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MemoryAccounting.h"
+
+#include <folly/Format.h>
+#include <folly/Synchronized.h>
+#include <folly/memory/Malloc.h>
+#include <folly/memory/MallctlHelper.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// arena index by module
+folly::Synchronized<std::map<std::string, unsigned>>&
+getModuleArenas() {
+  static folly::Synchronized<std::map<std::string, unsigned>> arenas;
+  return arenas;
+}
+
+} // namespace
+
+bool
+MemoryAccounting::bindThreadToModule(std::string const& module) noexcept {
+  if (not folly::usingJEMalloc()) {
+    return false;
+  }
+  try {
+    unsigned arena{0};
+    {
+      auto arenas = getModuleArenas().wlock();
+      auto it = arenas->find(module);
+      if (it == arenas->end()) {
+        folly::mallctlRead("arenas.create", &arena);
+        it = arenas->emplace(module, arena).first;
+        LOG(INFO) << "Created jemalloc arena " << arena << " for " << module;
+      }
+      arena = it->second;
+    }
+    folly::mallctlWrite("thread.arena", arena);
+    return true;
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to bind thread to arena of " << module << ": "
+               << e.what();
+    return false;
+  }
+}
+
+std::map<std::string, int64_t>
+MemoryAccounting::getAllocatedBytes() noexcept {
+  std::map<std::string, int64_t> allocated;
+  if (not folly::usingJEMalloc()) {
+    return allocated;
+  }
+  const auto arenas = getModuleArenas().copy();
+  try {
+    // stats are a snapshot as of the last epoch, refresh them
+    uint64_t epoch{1};
+    folly::mallctlWrite("epoch", epoch);
+    for (auto const& kv : arenas) {
+      size_t small{0};
+      size_t large{0};
+      folly::mallctlRead(
+          folly::sformat("stats.arenas.{}.small.allocated", kv.second).c_str(),
+          &small);
+      folly::mallctlRead(
+          folly::sformat("stats.arenas.{}.large.allocated", kv.second).c_str(),
+          &large);
+      allocated.emplace(kv.first, static_cast<int64_t>(small + large));
+    }
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to read jemalloc arena stats: " << e.what();
+  }
+  return allocated;
+}
+
+} // namespace openr
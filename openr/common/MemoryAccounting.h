@@ -0,0 +1,34 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace openr {
+
+/**
+ * Memory accounting per module through dedicated jemalloc arenas. Threads of
+ * a module get bound to the arena of the module, allocations they make are
+ * accounted to it, wherever they get freed. Threads not bound allocate from
+ * the default arenas and aren't reported.
+ *
+ * All of it is a no-op when Open/R doesn't run with jemalloc.
+ */
+class MemoryAccounting {
+ public:
+  // Bind calling thread to the arena of module, creating it on first use.
+  // Returns false if arenas are not supported
+  static bool bindThreadToModule(std::string const& module) noexcept;
+
+  // Bytes allocated by each module with an arena, empty without jemalloc
+  static std::map<std::string, int64_t> getAllocatedBytes() noexcept;
+};
+
+} // namespace openr
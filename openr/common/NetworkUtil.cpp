@@ -82,3 +82,47 @@ hash<openr::thrift::UnicastRoute>::operator()(
 }
 
 } // namespace std
+
+namespace openr {
+
+IpPrefixKey::IpPrefixKey(thrift::IpPrefix const& prefix) {
+  auto const& addr = prefix.prefixAddress.addr;
+  const auto length = static_cast<size_t>(prefix.prefixLength);
+  if (prefix.prefixLength >= 0 and
+      addr.size() == folly::IPAddressV4::byteCount() and
+      length <= folly::IPAddressV4::bitCount()) {
+    lengthAndFamily_ = kV4Length + 1 + length;
+  } else if (
+      prefix.prefixLength >= 0 and
+      addr.size() == folly::IPAddressV6::byteCount() and
+      length <= folly::IPAddressV6::bitCount()) {
+    lengthAndFamily_ = length;
+  } else {
+    throw std::invalid_argument(folly::sformat(
+        "Invalid prefix of {} address bytes and length {}",
+        addr.size(),
+        prefix.prefixLength));
+  }
+  std::memcpy(addr_.data(), addr.data(), addr.size());
+}
+
+thrift::IpPrefix
+IpPrefixKey::toThrift() const {
+  thrift::IpPrefix prefix;
+  prefix.prefixAddress.addr.assign(
+      reinterpret_cast<const char*>(addr_.data()), addrSize());
+  prefix.prefixLength = prefixLength();
+  return prefix;
+}
+
+folly::IPAddress
+IpPrefixKey::toIPAddress() const {
+  if (isV4()) {
+    folly::ByteArray4 v4;
+    std::memcpy(v4.data(), addr_.data(), v4.size());
+    return folly::IPAddress(folly::IPAddressV4(v4));
+  }
+  return folly::IPAddress(folly::IPAddressV6(addr_));
+}
+
+} // namespace openr
@@ -7,8 +7,14 @@
 
 #pragma once
 
+#include <array>
+#include <cstring>
+#include <optional>
+
+#include <folly/Conv.h>
 #include <folly/Format.h>
 #include <folly/IPAddress.h>
+#include <folly/hash/Hash.h>
 #include <thrift/lib/cpp/util/EnumUtils.h>
 #include <thrift/lib/cpp2/Thrift.h>
 
@@ -63,6 +69,91 @@ struct hash<openr::thrift::UnicastRoute> {
 
 namespace openr {
 
+/**
+ * Fixed size key of an IP prefix, to index prefixes with. Unlike
+ * thrift::IpPrefix it is 17 bytes of POD, the address bytes and the prefix
+ * length, hence it is copied, hashed and compared without touching the heap.
+ * Keys are converted from and to thrift::IpPrefix at API boundaries. The
+ * interface name a thrift::IpPrefix may carry is not part of the key.
+ *
+ * Keys order like the thrift::IpPrefix they are created from, by address
+ * bytes and then by prefix length.
+ */
+class IpPrefixKey {
+ public:
+  IpPrefixKey() = default;
+
+  // throws std::invalid_argument unless the address has 4 or 16 bytes and
+  // the prefix length fits it. Address bytes are taken as they are, unmasked
+  explicit IpPrefixKey(thrift::IpPrefix const& prefix);
+
+  bool
+  isV4() const {
+    return lengthAndFamily_ > kV4Length;
+  }
+
+  uint8_t
+  prefixLength() const {
+    return isV4() ? lengthAndFamily_ - kV4Length - 1 : lengthAndFamily_;
+  }
+
+  thrift::IpPrefix toThrift() const;
+
+  // address bytes as they are, without strings or the heap
+  folly::IPAddress toIPAddress() const;
+
+  size_t
+  hash() const {
+    uint64_t upper, lower;
+    std::memcpy(&upper, addr_.data(), sizeof(upper));
+    std::memcpy(&lower, addr_.data() + sizeof(upper), sizeof(lower));
+    return folly::hash::hash_128_to_64(upper ^ lengthAndFamily_, lower);
+  }
+
+  bool
+  operator==(IpPrefixKey const& other) const {
+    return lengthAndFamily_ == other.lengthAndFamily_ and
+        addr_ == other.addr_;
+  }
+
+  bool
+  operator!=(IpPrefixKey const& other) const {
+    return not(*this == other);
+  }
+
+  bool
+  operator<(IpPrefixKey const& other) const {
+    const auto cmp = std::memcmp(
+        addr_.data(),
+        other.addr_.data(),
+        std::min(addrSize(), other.addrSize()));
+    if (cmp != 0) {
+      return cmp < 0;
+    }
+    if (addrSize() != other.addrSize()) {
+      return addrSize() < other.addrSize();
+    }
+    return prefixLength() < other.prefixLength();
+  }
+
+ private:
+  // prefix lengths of v4 prefixes are stored above the longest v6 one
+  static constexpr uint8_t kV4Length{128};
+
+  size_t
+  addrSize() const {
+    return isV4() ? folly::IPAddressV4::byteCount()
+                  : folly::IPAddressV6::byteCount();
+  }
+
+  // address bytes, those of v4 addresses first and the rest zero
+  std::array<uint8_t, 16> addr_{};
+  // prefix length of v6 prefixes, kV4Length + 1 + prefix length of v4 ones
+  uint8_t lengthAndFamily_{0};
+};
+
+static_assert(sizeof(IpPrefixKey) == 17, "IpPrefixKey is not packed");
+
 template <class IPAddressVx>
 thrift::BinaryAddress
 toBinaryAddressImpl(const IPAddressVx& addr) {
@@ -105,10 +196,50 @@ toIPAddress(const thrift::BinaryAddress& addr) {
       addr.addr.size()));
 }
 
+/**
+ * Conversions for hot loops. Addresses are copied into the fixed size byte
+ * arrays of folly::IPAddressV4/V6, neither through strings nor on the heap,
+ * and malformed input yields no result instead of throwing.
+ */
+inline std::optional<folly::IPAddress>
+tryToIPAddress(const thrift::BinaryAddress& addr) noexcept {
+  auto const& bytes = addr.addr;
+  if (bytes.size() == folly::IPAddressV4::byteCount()) {
+    folly::ByteArray4 v4;
+    std::memcpy(v4.data(), bytes.data(), v4.size());
+    return folly::IPAddress(folly::IPAddressV4(v4));
+  }
+  if (bytes.size() == folly::IPAddressV6::byteCount()) {
+    folly::ByteArray16 v6;
+    std::memcpy(v6.data(), bytes.data(), v6.size());
+    return folly::IPAddress(folly::IPAddressV6(v6));
+  }
+  return std::nullopt;
+}
+
+inline std::optional<folly::CIDRNetwork>
+tryToIPNetwork(
+    const thrift::IpPrefix& prefix, bool applyMask = true) noexcept {
+  const auto addr = tryToIPAddress(prefix.prefixAddress);
+  if (not addr.has_value() or prefix.prefixLength < 0 or
+      static_cast<size_t>(prefix.prefixLength) > addr->bitCount()) {
+    return std::nullopt;
+  }
+  const uint8_t length = prefix.prefixLength;
+  return folly::CIDRNetwork(applyMask ? addr->mask(length) : *addr, length);
+}
+
+// throws folly::IPAddressFormatException on malformed prefixes
 inline folly::CIDRNetwork
 toIPNetwork(const thrift::IpPrefix& prefix, bool applyMask = true) {
-  return folly::IPAddress::createNetwork(
-      toIPAddress(prefix.prefixAddress).str(), prefix.prefixLength, applyMask);
+  auto network = tryToIPNetwork(prefix, applyMask);
+  if (not network.has_value()) {
+    throw folly::IPAddressFormatException(folly::sformat(
+        "Invalid prefix of {} address bytes and length {}",
+        prefix.prefixAddress.addr.size(),
+        prefix.prefixLength));
+  }
+  return std::move(network).value();
 }
 
 inline thrift::IpPrefix
@@ -129,8 +260,18 @@ toString(const thrift::BinaryAddress& addr) {
 
 inline std::string
 toString(const thrift::IpPrefix& ipPrefix) {
-  return folly::sformat(
-      "{}/{}", toString(ipPrefix.prefixAddress), ipPrefix.prefixLength);
+  auto result = toString(ipPrefix.prefixAddress);
+  result.push_back('/');
+  folly::toAppend(ipPrefix.prefixLength, &result);
+  return result;
+}
+
+inline std::string
+toString(const IpPrefixKey& prefix) {
+  auto result = prefix.toIPAddress().str();
+  result.push_back('/');
+  folly::toAppend(static_cast<int>(prefix.prefixLength()), &result);
+  return result;
 }
 
 inline std::string
@@ -165,3 +306,18 @@ toString(const thrift::UnicastRoute& route) {
 }
 
 } // namespace openr
+
+namespace std {
+
+/**
+ * Make IpPrefixKey hashable
+ */
+template <>
+struct hash<openr::IpPrefixKey> {
+  size_t
+  operator()(openr::IpPrefixKey const& prefix) const {
+    return prefix.hash();
+  }
+};
+
+} // namespace std
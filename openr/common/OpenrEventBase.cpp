@@ -8,6 +8,9 @@
 #include "openr/common/OpenrEventBase.h"
 
 #include <folly/fibers/FiberManagerMap.h>
+#if FOLLY_HAS_COROUTINES
+#include <folly/experimental/coro/WithCancellation.h>
+#endif
 
 namespace openr {
 
@@ -129,6 +132,25 @@ OpenrEventBase::OpenrEventBase()
 
 OpenrEventBase::~OpenrEventBase() {}
 
+#if FOLLY_HAS_COROUTINES
+void
+OpenrEventBase::addCoroTask(folly::coro::Task<void>&& task) {
+  coroTaskFutures_.emplace_back(
+      folly::coro::co_withCancellation(
+          cancellationSource_.getToken(), std::move(task))
+          .scheduleOn(&evb_)
+          .start());
+}
+#endif
+
+void
+OpenrEventBase::setExecutionObservers(
+    folly::ExecutionObserver* evbObserver,
+    folly::ExecutionObserver* fiberObserver) {
+  evb_.setExecutionObserver(evbObserver);
+  fiberManager_.setObserver(fiberObserver);
+}
+
 void
 OpenrEventBase::run() {
   evb_.loopForever();
@@ -139,6 +161,15 @@ OpenrEventBase::stop() {
   for (auto& future : fiberTaskFutures_) {
     future.wait();
   }
+#if FOLLY_HAS_COROUTINES
+  cancellationSource_.requestCancellation();
+  for (auto& future : coroTaskFutures_) {
+    future.wait();
+  }
+  coroTaskFutures_.clear();
+  // fresh source for tasks added before the event base runs again
+  cancellationSource_ = folly::CancellationSource();
+#endif
   evb_.terminateLoopSoon();
 }
 
@@ -8,12 +8,19 @@
 #pragma once
 
 #include <csignal>
+#include <type_traits>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/zmq/Socket.h>
+#include <folly/experimental/ExecutionObserver.h>
 #include <folly/fibers/FiberManager.h>
 #include <folly/io/async/AsyncSignalHandler.h>
 #include <folly/io/async/EventHandler.h>
+#if FOLLY_HAS_COROUTINES
+#include <folly/CancellationToken.h>
+#include <folly/experimental/coro/Invoke.h>
+#include <folly/experimental/coro/Task.h>
+#endif
 
 namespace openr {
 
@@ -60,6 +67,40 @@ class OpenrEventBase {
     return fiberManager_.addTaskFuture(std::move(func));
   }
 
+#if FOLLY_HAS_COROUTINES
+  /**
+   * Add a coroutine task, run on the event base. Task gets the cancellation
+   * token of the event base, cancellation is requested and all tasks are
+   * awaited in `stop()`. Tasks co_await queues with `getCoro()`, timers with
+   * `folly::coro::sleep()` and other modules with `co_runInEventBaseThread()`,
+   * all of them complete with OperationCancelled once cancelled.
+   */
+  void addCoroTask(folly::coro::Task<void>&& task);
+
+  /**
+   * Run func in the event base thread and resume the awaiting coroutine on
+   * its own executor with the result, or exception, of func. Unlike
+   * runInEventBaseThread() with a promise there is no future core allocated
+   * and no hop to yet another executor to consume the result.
+   */
+  template <typename F>
+  auto
+  co_runInEventBaseThread(F func)
+      -> folly::coro::Task<std::invoke_result_t<F&>> {
+    using T = std::invoke_result_t<F&>;
+    co_return co_await folly::coro::co_invoke(
+        [func = std::move(func)]() mutable -> folly::coro::Task<T> {
+          co_return func();
+        })
+        .scheduleOn(&evb_);
+  }
+
+  folly::CancellationToken
+  getCancellationToken() const {
+    return cancellationSource_.getToken();
+  }
+#endif
+
   /**
    * EventBase API aliases
    */
@@ -68,6 +109,16 @@ class OpenrEventBase {
     evb_.runInEventBaseThread(std::move(callback));
   }
 
+  /**
+   * Set observers of handlers and timeouts run by the event base and of
+   * fiber tasks run by its fiber manager, nullptr to reset them. Must be
+   * called in the event base thread, observers must outlive the event base
+   * or be reset.
+   */
+  void setExecutionObservers(
+      folly::ExecutionObserver* evbObserver,
+      folly::ExecutionObserver* fiberObserver);
+
   /**
    * Get latest timestamp of health check timer
    */
@@ -148,6 +199,12 @@ class OpenrEventBase {
   folly::fibers::FiberManager& fiberManager_;
   std::vector<folly::Future<folly::Unit>> fiberTaskFutures_;
 
+#if FOLLY_HAS_COROUTINES
+  // Coroutine tasks driven by evb_, cancelled and awaited in stop()
+  folly::CancellationSource cancellationSource_;
+  std::vector<folly::SemiFuture<folly::Unit>> coroTaskFutures_;
+#endif
+
   // Data structure to hold fd and their handlers
   std::unordered_map<int /* fd */, ZmqEventHandler> fdHandlers_;
 
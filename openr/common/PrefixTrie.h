@@ -0,0 +1,236 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <folly/IPAddress.h>
+
+namespace openr {
+
+/**
+ * Path-compressed binary trie of IP prefixes, for longest prefix match in
+ * O(address length) instead of a scan over all prefixes. Nodes only exist
+ * where prefixes are or where two of them branch, so a trie of N prefixes has
+ * less than 2N nodes. Inserts and erases update it incrementally. V4 and V6
+ * prefixes are kept apart, a V4 network never matches a V6 prefix.
+ *
+ * Not thread-safe.
+ */
+template <typename T>
+class PrefixTrie {
+ public:
+  /**
+   * Insert value for prefix, replacing the old one if any. Host bits of the
+   * prefix address are ignored.
+   * @return true if prefix was new
+   */
+  bool
+  insert(const folly::CIDRNetwork& prefix, T value) {
+    const auto key = toKey(prefix.first, prefix.second);
+    const uint8_t len = prefix.second;
+    auto* link = &getRoot(prefix.first);
+    while (true) {
+      auto& node = *link;
+      if (not node) {
+        node = std::make_unique<Node>(key, len);
+        node->value = std::move(value);
+        ++size_;
+        return true;
+      }
+
+      const auto common =
+          commonLength(node->key, key, std::min(node->len, len));
+      if (common == node->len) {
+        if (common == len) {
+          const bool isNew = not node->value.has_value();
+          node->value = std::move(value);
+          size_ += isNew ? 1 : 0;
+          return isNew;
+        }
+        link = &node->children[getBit(key, node->len)];
+        continue;
+      }
+
+      // prefix branches off within node, put a node in between
+      auto parent = std::make_unique<Node>(maskKey(key, common), common);
+      parent->children[getBit(node->key, common)] = std::move(node);
+      if (common == len) {
+        parent->value = std::move(value);
+      } else {
+        auto leaf = std::make_unique<Node>(key, len);
+        leaf->value = std::move(value);
+        parent->children[getBit(key, common)] = std::move(leaf);
+      }
+      node = std::move(parent);
+      ++size_;
+      return true;
+    }
+  }
+
+  /**
+   * Erase prefix and drop nodes no longer needed
+   * @return false if prefix was not there
+   */
+  bool
+  erase(const folly::CIDRNetwork& prefix) {
+    const auto key = toKey(prefix.first, prefix.second);
+    const uint8_t len = prefix.second;
+
+    // links from the root down to the node of prefix
+    std::vector<std::unique_ptr<Node>*> links{&getRoot(prefix.first)};
+    while (true) {
+      auto& node = *links.back();
+      if (not node or node->len > len or
+          commonLength(node->key, key, node->len) < node->len) {
+        return false;
+      }
+      if (node->len == len) {
+        break;
+      }
+      links.emplace_back(&node->children[getBit(key, node->len)]);
+    }
+
+    auto* link = links.back();
+    if (not(*link)->value.has_value()) {
+      return false;
+    }
+    (*link)->value.reset();
+    --size_;
+
+    // collapse the node if it doesn't branch, then its parent, which may be a
+    // branching node without value which just lost one of its children
+    for (auto it = links.rbegin(); it != links.rend(); ++it) {
+      auto& node = **it;
+      if (node->value.has_value() or
+          (node->children[0] and node->children[1])) {
+        break;
+      }
+      auto child = std::move(node->children[node->children[0] ? 0 : 1]);
+      node = std::move(child);
+    }
+    return true;
+  }
+
+  /**
+   * Value of the longest prefix containing network, i.e. the longest one of
+   * at most the length of network which matches it. Bits of the network
+   * address beyond its length are ignored.
+   * @return nullptr if there is none
+   */
+  const T*
+  longestMatch(const folly::CIDRNetwork& network) const {
+    const auto key = toKey(network.first, network.second);
+    const uint8_t len = network.second;
+    const T* match{nullptr};
+    const auto* node = (network.first.isV4() ? v4Root_ : v6Root_).get();
+    while (node and node->len <= len and
+           commonLength(node->key, key, node->len) == node->len) {
+      if (node->value.has_value()) {
+        match = &node->value.value();
+      }
+      if (node->len == len) {
+        break;
+      }
+      node = node->children[getBit(key, node->len)].get();
+    }
+    return match;
+  }
+
+  size_t
+  size() const {
+    return size_;
+  }
+
+  bool
+  empty() const {
+    return size_ == 0;
+  }
+
+  void
+  clear() {
+    v4Root_.reset();
+    v6Root_.reset();
+    size_ = 0;
+  }
+
+ private:
+  // address bits, left aligned, V4 addresses in the upper 32 bits of hi
+  struct Key {
+    uint64_t hi{0};
+    uint64_t lo{0};
+  };
+
+  struct Node {
+    Node(const Key& key, uint8_t len) : key(key), len(len) {}
+
+    // prefix of node, bits beyond len are zero
+    Key key;
+    uint8_t len{0};
+    // set if the prefix of node got inserted, otherwise node only branches
+    std::optional<T> value;
+    // by the bit after len
+    std::unique_ptr<Node> children[2];
+  };
+
+  static Key
+  toKey(const folly::IPAddress& addr, uint8_t len) {
+    Key key;
+    const auto* bytes = addr.bytes();
+    for (size_t i = 0; i < addr.byteCount(); ++i) {
+      auto& word = i < 8 ? key.hi : key.lo;
+      word |= static_cast<uint64_t>(bytes[i]) << (56 - 8 * (i % 8));
+    }
+    return maskKey(key, len);
+  }
+
+  static uint64_t
+  getMask(uint8_t len) {
+    return len == 0 ? 0 : (len >= 64 ? ~0ULL : ~0ULL << (64 - len));
+  }
+
+  static Key
+  maskKey(const Key& key, uint8_t len) {
+    return {key.hi & getMask(len), key.lo & getMask(len > 64 ? len - 64 : 0)};
+  }
+
+  static int
+  getBit(const Key& key, uint8_t pos) {
+    return pos < 64 ? (key.hi >> (63 - pos)) & 1 : (key.lo >> (127 - pos)) & 1;
+  }
+
+  // number of leading bits a and b agree on, at most maxLen
+  static uint8_t
+  commonLength(const Key& a, const Key& b, uint8_t maxLen) {
+    uint8_t common;
+    if (a.hi != b.hi) {
+      common = __builtin_clzll(a.hi ^ b.hi);
+    } else if (a.lo != b.lo) {
+      common = 64 + __builtin_clzll(a.lo ^ b.lo);
+    } else {
+      common = 128;
+    }
+    return std::min(common, maxLen);
+  }
+
+  std::unique_ptr<Node>&
+  getRoot(const folly::IPAddress& addr) {
+    return addr.isV4() ? v4Root_ : v6Root_;
+  }
+
+  std::unique_ptr<Node> v4Root_;
+  std::unique_ptr<Node> v6Root_;
+  size_t size_{0};
+};
+
+} // namespace openr
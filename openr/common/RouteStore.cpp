@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RouteStore.h"
+
+namespace openr {
+
+void
+RouteStore::update(
+    std::vector<std::shared_ptr<const thrift::UnicastRoute>> const&
+        unicastRoutesToUpdate,
+    std::vector<thrift::IpPrefix> const& unicastRoutesToDelete,
+    std::vector<std::shared_ptr<const thrift::MplsRoute>> const&
+        mplsRoutesToUpdate,
+    std::vector<int32_t> const& mplsRoutesToDelete) {
+  if (unicastRoutesToUpdate.size() or unicastRoutesToDelete.size()) {
+    auto routes = unicastRoutes_.wlock();
+    for (auto const& route : unicastRoutesToUpdate) {
+      (*routes)[route->dest] = route;
+    }
+    for (auto const& prefix : unicastRoutesToDelete) {
+      routes->erase(prefix);
+    }
+  }
+  if (mplsRoutesToUpdate.size() or mplsRoutesToDelete.size()) {
+    auto routes = mplsRoutes_.wlock();
+    for (auto const& route : mplsRoutesToUpdate) {
+      (*routes)[route->topLabel] = route;
+    }
+    for (auto const& label : mplsRoutesToDelete) {
+      routes->erase(label);
+    }
+  }
+}
+
+std::shared_ptr<const thrift::UnicastRoute>
+RouteStore::share(thrift::UnicastRoute const& route) const {
+  {
+    auto routes = unicastRoutes_.rlock();
+    auto const it = routes->find(route.dest);
+    if (it != routes->end() and *it->second == route) {
+      return it->second;
+    }
+  }
+  return std::make_shared<const thrift::UnicastRoute>(route);
+}
+
+std::shared_ptr<const thrift::MplsRoute>
+RouteStore::share(thrift::MplsRoute const& route) const {
+  {
+    auto routes = mplsRoutes_.rlock();
+    auto const it = routes->find(route.topLabel);
+    if (it != routes->end() and *it->second == route) {
+      return it->second;
+    }
+  }
+  return std::make_shared<const thrift::MplsRoute>(route);
+}
+
+size_t
+RouteStore::getNumUnicastRoutes() const {
+  return unicastRoutes_.rlock()->size();
+}
+
+size_t
+RouteStore::getNumMplsRoutes() const {
+  return mplsRoutes_.rlock()->size();
+}
+
+} // namespace openr
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Synchronized.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/if/gen-cpp2/Network_types.h>
+
+namespace openr {
+
+/**
+ * Routes Decision last sent to Fib, shared by both modules instead of each
+ * keeping its own copy of the route table. Decision updates the store with
+ * the routes of a delta before pushing it, Fib takes the routes of deltas it
+ * processes from the store. Entries are immutable and replaced on change,
+ * they get shared with the routes computed by Decision and with Fib route db
+ * snapshots as well.
+ *
+ * The store may be ahead of the delta Fib processes, so entries are handed
+ * out only if equal to the route of the delta.
+ */
+class RouteStore {
+ public:
+  void update(
+      std::vector<std::shared_ptr<const thrift::UnicastRoute>> const&
+          unicastRoutesToUpdate,
+      std::vector<thrift::IpPrefix> const& unicastRoutesToDelete,
+      std::vector<std::shared_ptr<const thrift::MplsRoute>> const&
+          mplsRoutesToUpdate,
+      std::vector<int32_t> const& mplsRoutesToDelete);
+
+  // entry equal to route, or a new one if there is none
+  std::shared_ptr<const thrift::UnicastRoute> share(
+      thrift::UnicastRoute const& route) const;
+  std::shared_ptr<const thrift::MplsRoute> share(
+      thrift::MplsRoute const& route) const;
+
+  size_t getNumUnicastRoutes() const;
+  size_t getNumMplsRoutes() const;
+
+ private:
+  folly::Synchronized<std::unordered_map<
+      thrift::IpPrefix,
+      std::shared_ptr<const thrift::UnicastRoute>>>
+      unicastRoutes_;
+  folly::Synchronized<
+      std::unordered_map<int32_t, std::shared_ptr<const thrift::MplsRoute>>>
+      mplsRoutes_;
+};
+
+} // namespace openr
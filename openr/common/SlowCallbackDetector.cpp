@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SlowCallbackDetector.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <fb303/ServiceData.h>
+#include <folly/chrono/Hardware.h>
+
+#include <openr/common/Constants.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+namespace {
+
+// TSC ticks per microsecond, measured once against the steady clock. On
+// platforms without TSC ticks are steady clock nanoseconds
+double
+getTicksPerUs() {
+  static const double ticksPerUs = []() {
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto startTicks = folly::hardware_timestamp();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const auto ticks = folly::hardware_timestamp() - startTicks;
+    const auto elapsedUs =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count();
+    return static_cast<double>(ticks) / std::max<int64_t>(elapsedUs, 1);
+  }();
+  return ticksPerUs;
+}
+
+TraceBuffer&
+getBuffer() {
+  static TraceBuffer buffer(Constants::kSlowCallbacksCapacity);
+  return buffer;
+}
+
+} // namespace
+
+SlowCallbackDetector::SlowCallbackDetector(
+    std::string module, std::chrono::milliseconds threshold)
+    : module_(std::move(module)),
+      counterKey_("evb.slow_callbacks." + module_),
+      thresholdTicks_(
+          std::chrono::duration_cast<std::chrono::microseconds>(threshold)
+              .count() *
+          getTicksPerUs()) {
+  fb303::fbData->addStatExportType(counterKey_, fb303::COUNT);
+}
+
+void
+SlowCallbackDetector::starting(const char* kind, uintptr_t id) noexcept {
+  if (depth_++ > 0) {
+    return;
+  }
+  kind_ = kind;
+  id_ = id;
+  startTicks_ = folly::hardware_timestamp();
+}
+
+void
+SlowCallbackDetector::stopped() noexcept {
+  if (depth_ == 0 or --depth_ > 0) {
+    return;
+  }
+  const uint64_t ticks = folly::hardware_timestamp() - startTicks_;
+  if (ticks > maxTicks_.load(std::memory_order_relaxed)) {
+    maxTicks_.store(ticks, std::memory_order_relaxed);
+  }
+  if (ticks <= thresholdTicks_) {
+    return;
+  }
+
+  const auto end = TraceBuffer::Clock::now();
+  const auto duration = std::chrono::microseconds(
+      static_cast<int64_t>(ticks / getTicksPerUs()));
+  getBuffer().record(kind_, module_, end - duration, end, id_);
+  fb303::fbData->addStatValue(counterKey_, 1, fb303::COUNT);
+}
+
+std::chrono::microseconds
+SlowCallbackDetector::getAndResetMax() {
+  return std::chrono::microseconds(
+      static_cast<int64_t>(maxTicks_.exchange(0) / getTicksPerUs()));
+}
+
+TraceBuffer const&
+SlowCallbackDetector::getSlowCallbacks() {
+  return getBuffer();
+}
+
+} // namespace openr
@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <folly/experimental/ExecutionObserver.h>
+
+#include <openr/common/TraceBuffer.h>
+
+namespace openr {
+
+/**
+ * Times every handler and timeout run by an event base and every run of a
+ * fiber task of its fiber manager, as their execution observer. Callbacks
+ * taking longer than threshold are recorded into a process-wide ring of
+ * spans, named after the kind of callback ("handler" or "fiber") with the
+ * module as detail and the callback id as argument, and counted in
+ * evb.slow_callbacks.<module>.
+ *
+ * Callbacks are timed with two reads of the TSC, which are converted to time
+ * only for slow callbacks. Fibers may run from within a handler, only the
+ * outermost callback is timed then.
+ *
+ * Observers are called on the thread of the event base, the longest callback
+ * and the ring may be read from any thread.
+ */
+class SlowCallbackDetector {
+ public:
+  SlowCallbackDetector(std::string module, std::chrono::milliseconds threshold);
+
+  // non-copyable, observers refer to the detector
+  SlowCallbackDetector(SlowCallbackDetector const&) = delete;
+  SlowCallbackDetector& operator=(SlowCallbackDetector const&) = delete;
+
+  // observers to set on the event base and on its fiber manager
+  folly::ExecutionObserver*
+  getHandlerObserver() {
+    return &handlerObserver_;
+  }
+
+  folly::ExecutionObserver*
+  getFiberObserver() {
+    return &fiberObserver_;
+  }
+
+  // longest callback since last call
+  std::chrono::microseconds getAndResetMax();
+
+  // slow callbacks of all detectors of the process
+  static TraceBuffer const& getSlowCallbacks();
+
+ private:
+  class Observer final : public folly::ExecutionObserver {
+   public:
+    Observer(SlowCallbackDetector& detector, const char* kind)
+        : detector_(detector), kind_(kind) {}
+
+    void
+    starting(uintptr_t id) noexcept override {
+      detector_.starting(kind_, id);
+    }
+
+    void
+    stopped(uintptr_t /* id */) noexcept override {
+      detector_.stopped();
+    }
+
+    void
+    runnable(uintptr_t /* id */) noexcept override {}
+
+   private:
+    SlowCallbackDetector& detector_;
+    const char* const kind_;
+  };
+
+  void starting(const char* kind, uintptr_t id) noexcept;
+  void stopped() noexcept;
+
+  const std::string module_;
+  const std::string counterKey_;
+  const uint64_t thresholdTicks_{0};
+
+  Observer handlerObserver_{*this, "handler"};
+  Observer fiberObserver_{*this, "fiber"};
+
+  // nesting depth of callbacks, and kind, id and start of the outermost one
+  uint32_t depth_{0};
+  const char* kind_{nullptr};
+  uintptr_t id_{0};
+  uint64_t startTicks_{0};
+
+  std::atomic<uint64_t> maxTicks_{0};
+};
+
+} // namespace openr
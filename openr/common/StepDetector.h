@@ -7,14 +7,114 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <functional>
 #include <stdexcept>
 
 #include <folly/stats/BucketedTimeSeries.h>
+#include <glog/logging.h>
 
 namespace openr {
 
+/*
+ * Sliding windows averaging the time series of StepDetector. A window is
+ * constructed from the sample period and its size in samples, and provides
+ *   bool addValue(TimeType now, const ValueType& val);
+ *   double avg() const;
+ *   uint64_t count() const;
+ */
+
+// Exact average over the last wndSize sample periods, kept in a bucket per
+// sample period
+template <typename ValueType, typename TimeType>
+class TimeSeriesStepWindow {
+ public:
+  TimeSeriesStepWindow(TimeType samplePeriod, size_t wndSize)
+      : timeSeries_(wndSize, samplePeriod * wndSize) {}
+
+  bool
+  addValue(TimeType now, const ValueType& val) {
+    return timeSeries_.addValue(now, val);
+  }
+
+  double
+  avg() const {
+    return timeSeries_.avg();
+  }
+
+  uint64_t
+  count() const {
+    return timeSeries_.count();
+  }
+
+ private:
+  folly::BucketedTimeSeries<ValueType, folly::LegacyStatsClock<TimeType>>
+      timeSeries_;
+};
+
+// Exponentially weighted moving average, in constant space and without any
+// allocation. Weights decay with the time since the latest sample, such that
+// samples older than the window have a weight of e^-kDecay in total. Samples
+// closer than a sample period weigh as much as one a period apart. Tracks
+// steps like TimeSeriesStepWindow, with a longer tail
+template <typename ValueType, typename TimeType>
+class EwmaStepWindow {
+ public:
+  EwmaStepWindow(TimeType samplePeriod, size_t wndSize)
+      : samplePeriod_(samplePeriod),
+        windowDuration_(samplePeriod * wndSize),
+        periodWeight_(
+            1 - std::exp(-kDecay / static_cast<double>(wndSize))) {}
+
+  bool
+  addValue(TimeType now, const ValueType& val) {
+    if (count_ == 0) {
+      avg_ = static_cast<double>(val);
+      latestTime_ = now;
+      ++count_;
+      return true;
+    }
+    // like a time series, reject samples older than the window
+    if (now < latestTime_ - windowDuration_) {
+      return false;
+    }
+    const auto elapsed = now - latestTime_;
+    const double weight = elapsed > samplePeriod_
+        ? 1 -
+            std::exp(-kDecay * static_cast<double>(elapsed.count()) /
+                     static_cast<double>(windowDuration_.count()))
+        : periodWeight_;
+    latestTime_ = std::max(latestTime_, now);
+    avg_ += weight * (static_cast<double>(val) - avg_);
+    ++count_;
+    return true;
+  }
+
+  double
+  avg() const {
+    return avg_;
+  }
+
+  uint64_t
+  count() const {
+    return count_;
+  }
+
+ private:
+  static constexpr double kDecay{3.0};
+
+  TimeType samplePeriod_{0};
+  TimeType windowDuration_{0};
+  // weight of a sample a sample period after the latest one
+  double periodWeight_{0};
+
+  double avg_{0};
+  uint64_t count_{0};
+  TimeType latestTime_{0};
+};
+
 /*
  * This class detects abrupt changes, i.e., steps, in the mean level of a time
  * series or signal. Often, the step is small and the time series is corrupted
@@ -32,8 +132,13 @@ namespace openr {
  * to catch this case.
  * Notes: we assume the underlying time series is stable for longer than slow
  * sliding window between steps.
+ * Windows are TimeSeriesStepWindow by default, EwmaStepWindow saves the memory
+ * and bucket bookkeeping of the time series, e.g. with many detectors.
  */
-template <typename ValueType, typename TimeType>
+template <
+    typename ValueType,
+    typename TimeType,
+    typename Window = TimeSeriesStepWindow<ValueType, TimeType>>
 class StepDetector {
  public:
   StepDetector(
@@ -52,8 +157,8 @@ class StepDetector {
       // callback when step is detected
       std::function<void(const ValueType&)> stepCb)
       : slowWndSize_(slowWndSize),
-        fastSlideWindow_(fastWndSize, samplePeriod * fastWndSize),
-        slowSlideWindow_(slowWndSize, samplePeriod * slowWndSize),
+        fastSlideWindow_(samplePeriod, fastWndSize),
+        slowSlideWindow_(samplePeriod, slowWndSize),
         loThreshold_(loThreshold),
         hiThreshold_(hiThreshold),
         absThreshold_(absThreshold),
@@ -129,12 +234,10 @@ class StepDetector {
   size_t slowWndSize_{0};
 
   // fast sliding window
-  folly::BucketedTimeSeries<ValueType, folly::LegacyStatsClock<TimeType>>
-      fastSlideWindow_;
+  Window fastSlideWindow_;
 
-  // slow sliding window size
-  folly::BucketedTimeSeries<ValueType, folly::LegacyStatsClock<TimeType>>
-      slowSlideWindow_;
+  // slow sliding window
+  Window slowSlideWindow_;
 
   // lower threshold, in percentage
   const uint8_t loThreshold_{0};
@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ThreadPlacement.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+#include <stdexcept>
+
+#include <fb303/ServiceData.h>
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/String.h>
+#include <glog/logging.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+namespace {
+
+int
+toInt(folly::StringPiece value, folly::StringPiece what) {
+  auto res = folly::tryTo<int>(folly::trimWhitespace(value));
+  if (res.hasError()) {
+    throw std::invalid_argument(
+        folly::sformat("Invalid {} in thread placement: '{}'", what, value));
+  }
+  return res.value();
+}
+
+// CPUs of NUMA node as listed by the kernel, empty if it is unknown
+std::vector<int>
+getNumaNodeCpus(int node) {
+  std::string cpuList;
+  const auto path =
+      folly::sformat("/sys/devices/system/node/node{}/cpulist", node);
+  if (not folly::readFile(path.c_str(), cpuList)) {
+    return {};
+  }
+  try {
+    return ThreadPlacement::parseCpuList(
+        folly::trimWhitespace(cpuList).str());
+  } catch (std::invalid_argument const& e) {
+    LOG(ERROR) << "Can't parse " << path << ": " << e.what();
+    return {};
+  }
+}
+
+} // namespace
+
+std::unordered_map<std::string, ThreadPlacement>
+ThreadPlacement::parse(std::string const& spec) {
+  std::unordered_map<std::string, ThreadPlacement> placements;
+  std::vector<folly::StringPiece> entries;
+  folly::split(';', spec, entries, true /* ignoreEmpty */);
+  for (auto const& entry : entries) {
+    std::vector<folly::StringPiece> fields;
+    folly::split(':', entry, fields);
+    const auto module = folly::trimWhitespace(fields.at(0)).str();
+    if (module.empty() or fields.size() < 2) {
+      throw std::invalid_argument(folly::sformat(
+          "Thread placement '{}' must be <module>:<option>...", entry));
+    }
+
+    ThreadPlacement placement;
+    for (size_t i = 1; i < fields.size(); ++i) {
+      folly::StringPiece key;
+      folly::StringPiece value;
+      if (not folly::split('=', fields[i], key, value)) {
+        throw std::invalid_argument(folly::sformat(
+            "Thread placement option '{}' must be <key>=<value>", fields[i]));
+      }
+      key = folly::trimWhitespace(key);
+      if (key == "cpus") {
+        placement.cpus = parseCpuList(value.str());
+      } else if (key == "numa") {
+        placement.numaNode = toInt(value, "NUMA node");
+      } else if (key == "fifo") {
+        placement.fifoPriority = toInt(value, "SCHED_FIFO priority");
+      } else if (key == "nice") {
+        placement.nice = toInt(value, "nice value");
+      } else {
+        throw std::invalid_argument(
+            folly::sformat("Unknown thread placement option '{}'", key));
+      }
+    }
+    if (placement.fifoPriority.has_value() and placement.nice.has_value()) {
+      throw std::invalid_argument(folly::sformat(
+          "Thread placement of {} can't have both fifo and nice", module));
+    }
+    placements[module] = std::move(placement);
+  }
+  return placements;
+}
+
+std::vector<int>
+ThreadPlacement::parseCpuList(std::string const& cpuList) {
+  std::vector<int> cpus;
+  std::vector<folly::StringPiece> ranges;
+  folly::split(',', cpuList, ranges, true /* ignoreEmpty */);
+  for (auto const& range : ranges) {
+    folly::StringPiece first;
+    folly::StringPiece last;
+    int from{0};
+    int to{0};
+    if (folly::split('-', range, first, last)) {
+      from = toInt(first, "CPU range");
+      to = toInt(last, "CPU range");
+    } else {
+      from = to = toInt(range, "CPU");
+    }
+    if (from < 0 or from > to or to >= CPU_SETSIZE) {
+      throw std::invalid_argument(
+          folly::sformat("Invalid CPU range in thread placement: '{}'", range));
+    }
+    for (int cpu = from; cpu <= to; ++cpu) {
+      cpus.emplace_back(cpu);
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+bool
+ThreadPlacement::apply(std::string const& module) const noexcept {
+  bool ok{true};
+
+  // CPUs to run on, restricted to those of the NUMA node if any. Memory gets
+  // allocated on the node by first touch from these CPUs.
+  auto allowedCpus = cpus;
+  if (numaNode.has_value()) {
+    const auto nodeCpus = getNumaNodeCpus(*numaNode);
+    if (nodeCpus.empty()) {
+      LOG(ERROR) << "Unknown NUMA node " << *numaNode << " for " << module;
+      ok = false;
+    } else if (allowedCpus.empty()) {
+      allowedCpus = nodeCpus;
+    } else {
+      std::vector<int> both;
+      std::set_intersection(
+          allowedCpus.begin(),
+          allowedCpus.end(),
+          nodeCpus.begin(),
+          nodeCpus.end(),
+          std::back_inserter(both));
+      allowedCpus = std::move(both);
+      if (allowedCpus.empty()) {
+        LOG(ERROR) << "None of the CPUs of " << module << " is on NUMA node "
+                   << *numaNode;
+        ok = false;
+      }
+    }
+  }
+  if (not allowedCpus.empty()) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto cpu : allowedCpus) {
+      CPU_SET(cpu, &cpuSet);
+    }
+    const auto rc =
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (rc != 0) {
+      LOG(ERROR) << "Failed to set CPU affinity of " << module << ": "
+                 << folly::errnoStr(rc);
+      ok = false;
+    }
+  }
+
+  if (fifoPriority.has_value()) {
+    sched_param param{};
+    param.sched_priority = *fifoPriority;
+    const auto rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0) {
+      LOG(ERROR) << "Failed to set SCHED_FIFO priority " << *fifoPriority
+                 << " of " << module << ": " << folly::errnoStr(rc);
+      ok = false;
+    }
+  }
+  const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+  if (nice.has_value() and setpriority(PRIO_PROCESS, tid, *nice) != 0) {
+    LOG(ERROR) << "Failed to set nice value " << *nice << " of " << module
+               << ": " << folly::errnoStr(errno);
+    ok = false;
+  }
+
+  // report the effective placement, read back from the kernel
+  const auto prefix = folly::sformat("thread_placement.{}", module);
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0) {
+    fb303::fbData->setCounter(prefix + ".cpus", CPU_COUNT(&cpuSet));
+  }
+  fb303::fbData->setCounter(prefix + ".numa_node", numaNode.value_or(-1));
+  int policy{SCHED_OTHER};
+  sched_param param{};
+  if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+    const bool isFifo = policy == SCHED_FIFO;
+    fb303::fbData->setCounter(prefix + ".sched_fifo", isFifo ? 1 : 0);
+    const auto priority =
+        isFifo ? param.sched_priority : getpriority(PRIO_PROCESS, tid);
+    fb303::fbData->setCounter(prefix + ".priority", priority);
+  }
+
+  LOG(INFO) << "Applied thread placement of " << module << " on "
+            << CPU_COUNT(&cpuSet) << " CPUs" << (ok ? "" : " with errors");
+  return ok;
+}
+
+} // namespace openr
@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace openr {
+
+/**
+ * Placement of the thread of a module: CPUs it may run on, NUMA node whose
+ * CPUs it may run on, and its scheduling, SCHED_FIFO priority or nice value
+ * of SCHED_OTHER. Unset fields keep what the thread inherited.
+ */
+struct ThreadPlacement {
+  std::vector<int> cpus;
+  std::optional<int> numaNode;
+  std::optional<int> fifoPriority;
+  std::optional<int> nice;
+
+  /**
+   * Parse placements by module from spec of form
+   *   <module>:<option>[:<option>...][;<module>:...]
+   * with options cpus=<list>, e.g. cpus=0-1,6, numa=<node>, fifo=<priority>
+   * and nice=<value>. E.g.
+   *   Spark:cpus=0-1:fifo=10;Watchdog:fifo=5;Decision:cpus=2-7:nice=5
+   * Throws std::invalid_argument for malformed spec.
+   */
+  static std::unordered_map<std::string, ThreadPlacement> parse(
+      std::string const& spec);
+
+  // parse list of CPUs and CPU ranges, e.g. "0-3,6"
+  static std::vector<int> parseCpuList(std::string const& cpuList);
+
+  /**
+   * Apply placement to calling thread. Failures, e.g. SCHED_FIFO without
+   * CAP_SYS_NICE, are logged and the rest still gets applied. Effective
+   * placement is exported as counters thread_placement.<module>.cpus,
+   * .numa_node, .sched_fifo and .priority. Returns false on any failure.
+   */
+  bool apply(std::string const& module) const noexcept;
+};
+
+} // namespace openr
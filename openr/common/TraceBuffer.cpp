@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TraceBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <folly/lang/Bits.h>
+#include <folly/system/ThreadId.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+constexpr size_t TraceBuffer::kMaxDetailSize;
+
+TraceBuffer::TraceBuffer(size_t capacity)
+    : mask_(folly::nextPowTwo(capacity) - 1),
+      slots_(std::make_unique<Slot[]>(mask_ + 1)) {
+  CHECK_GT(capacity, 0) << "TraceBuffer needs room for at least one span";
+}
+
+void
+TraceBuffer::record(
+    const char* name,
+    folly::StringPiece detail,
+    Clock::time_point start,
+    Clock::time_point end,
+    int64_t arg) noexcept {
+  const uint64_t seqNum = next_.fetch_add(1, std::memory_order_relaxed);
+  auto& slot = slots_[seqNum & mask_];
+
+  std::array<uint64_t, kMaxDetailSize / sizeof(uint64_t)> words{};
+  const size_t detailSize = std::min(detail.size(), kMaxDetailSize);
+  std::memcpy(words.data(), detail.data(), detailSize);
+
+  // claim the slot. It is only taken by another writer if that one lags a
+  // full ring behind, the span is dropped then rather than torn
+  uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+  if (seq % 2 or seq > 2 * seqNum or
+      not slot.seq.compare_exchange_strong(
+          seq, 2 * seqNum + 1, std::memory_order_relaxed)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.startNs.store(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          start.time_since_epoch())
+          .count(),
+      std::memory_order_relaxed);
+  slot.durationNs.store(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count(),
+      std::memory_order_relaxed);
+  slot.threadId.store(folly::getOSThreadID(), std::memory_order_relaxed);
+  slot.arg.store(arg, std::memory_order_relaxed);
+  slot.detailSize.store(detailSize, std::memory_order_relaxed);
+  for (size_t i = 0; i < words.size(); ++i) {
+    slot.detail[i].store(words[i], std::memory_order_relaxed);
+  }
+  slot.seq.store(2 * seqNum + 2, std::memory_order_release);
+}
+
+std::vector<TraceBuffer::Span>
+TraceBuffer::getSpans() const {
+  std::vector<Span> spans;
+  spans.reserve(getCapacity());
+  for (size_t i = 0; i <= mask_; ++i) {
+    auto const& slot = slots_[i];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq == 0 or seq % 2) {
+      // never written or being written
+      continue;
+    }
+
+    const char* name = slot.name.load(std::memory_order_relaxed);
+    const auto startNs = slot.startNs.load(std::memory_order_relaxed);
+    const auto durationNs = slot.durationNs.load(std::memory_order_relaxed);
+    const auto threadId = slot.threadId.load(std::memory_order_relaxed);
+    const auto arg = slot.arg.load(std::memory_order_relaxed);
+    const size_t detailSize = std::min<uint64_t>(
+        slot.detailSize.load(std::memory_order_relaxed), kMaxDetailSize);
+    std::array<uint64_t, kMaxDetailSize / sizeof(uint64_t)> words;
+    for (size_t w = 0; w < words.size(); ++w) {
+      words[w] = slot.detail[w].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq or name == nullptr) {
+      // overwritten while reading
+      continue;
+    }
+
+    Span span;
+    span.seqNum = seq / 2 - 1;
+    span.name = name;
+    span.detail.assign(reinterpret_cast<const char*>(words.data()), detailSize);
+    span.start = Clock::time_point(std::chrono::nanoseconds(startNs));
+    span.duration = std::chrono::nanoseconds(durationNs);
+    span.threadId = threadId;
+    span.arg = arg;
+    spans.emplace_back(std::move(span));
+  }
+  std::sort(spans.begin(), spans.end(), [](auto const& lhs, auto const& rhs) {
+    return lhs.seqNum < rhs.seqNum;
+  });
+  return spans;
+}
+
+uint64_t
+TraceBuffer::getDroppedCount() const {
+  const uint64_t recorded = next_.load(std::memory_order_relaxed);
+  return recorded > getCapacity() ? recorded - getCapacity() : 0;
+}
+
+} // namespace openr
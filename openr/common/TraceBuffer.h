@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace openr {
+
+/**
+ * Fixed size ring of timed spans, cheap enough to be written from hot paths
+ * of any thread. Writers claim a slot with a single atomic increment and never
+ * block, once the ring is full the oldest spans get overwritten. Every slot is
+ * guarded by a sequence number, so readers skip slots that are being written
+ * rather than waiting for them.
+ */
+class TraceBuffer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // longest detail kept with a span, longer ones get truncated
+  static constexpr size_t kMaxDetailSize{24};
+
+  struct Span {
+    // position in the sequence of all spans recorded
+    uint64_t seqNum{0};
+    std::string name;
+    std::string detail;
+    Clock::time_point start;
+    std::chrono::nanoseconds duration{0};
+    uint64_t threadId{0};
+    // span specific value, e.g. number of items processed
+    int64_t arg{0};
+  };
+
+  // capacity gets rounded up to a power of two
+  explicit TraceBuffer(size_t capacity);
+
+  /**
+   * Record a span. name must be a string literal or otherwise outlive the
+   * buffer, it is stored as a pointer.
+   */
+  void record(
+      const char* name,
+      folly::StringPiece detail,
+      Clock::time_point start,
+      Clock::time_point end,
+      int64_t arg = 0) noexcept;
+
+  // spans currently held, oldest first
+  std::vector<Span> getSpans() const;
+
+  // number of spans recorded beyond capacity, so at least that many got
+  // overwritten
+  uint64_t getDroppedCount() const;
+
+  size_t
+  getCapacity() const {
+    return mask_ + 1;
+  }
+
+ private:
+  // all fields are atomics so that a read racing with a write is detected by
+  // the sequence number check instead of being undefined behavior
+  struct Slot {
+    // 0 if never written, odd while being written, 2 * (seqNum + 1) after
+    std::atomic<uint64_t> seq{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> startNs{0};
+    std::atomic<int64_t> durationNs{0};
+    std::atomic<uint64_t> threadId{0};
+    std::atomic<int64_t> arg{0};
+    std::atomic<uint64_t> detailSize{0};
+    std::array<std::atomic<uint64_t>, kMaxDetailSize / sizeof(uint64_t)>
+        detail{};
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> next_{0};
+};
+
+/**
+ * Records a span from construction to destruction into buffer. No-op if
+ * buffer is null. detail must outlive the scope.
+ */
+class TraceScope {
+ public:
+  TraceScope(
+      TraceBuffer* buffer, const char* name, folly::StringPiece detail = {})
+      : buffer_(buffer),
+        name_(name),
+        detail_(detail),
+        start_(buffer ? TraceBuffer::Clock::now()
+                      : TraceBuffer::Clock::time_point{}) {}
+
+  ~TraceScope() {
+    if (buffer_) {
+      buffer_->record(name_, detail_, start_, TraceBuffer::Clock::now(), arg_);
+    }
+  }
+
+  void
+  setArg(int64_t arg) {
+    arg_ = arg;
+  }
+
+ private:
+  // no-copy
+  TraceScope(TraceScope const&) = delete;
+  TraceScope& operator=(TraceScope const&) = delete;
+
+  TraceBuffer* const buffer_{nullptr};
+  const char* const name_{nullptr};
+  const folly::StringPiece detail_;
+  const TraceBuffer::Clock::time_point start_;
+  int64_t arg_{0};
+};
+
+} // namespace openr
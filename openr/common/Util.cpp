@@ -14,8 +14,23 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+
+#include <folly/hash/SpookyHashV2.h>
+
 namespace openr {
 
+namespace {
+// initialized with the statics of the binary, as the process gets loaded
+const auto kProcessStartTime = std::chrono::steady_clock::now();
+} // namespace
+
+std::chrono::milliseconds
+getProcessUptime() noexcept {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - kProcessStartTime);
+}
+
 // create RE2 set for the list of key prefixes
 KeyPrefix::KeyPrefix(std::vector<std::string> const& keyPrefixList) {
   if (keyPrefixList.empty()) {
@@ -451,10 +466,47 @@ getDurationBetweenPerfEvents(
   return std::chrono::milliseconds(second - first);
 }
 
+std::vector<std::pair<std::string, std::chrono::milliseconds>>
+getPerfEventsStageDurations(const thrift::PerfEvents& perfEvents) noexcept {
+  std::vector<std::pair<std::string, std::chrono::milliseconds>> stages;
+  const auto& events = perfEvents.events;
+  for (size_t i = 1; i < events.size(); ++i) {
+    const auto durationMs = events[i].unixTs - events[i - 1].unixTs;
+    if (durationMs < 0) {
+      continue;
+    }
+    stages.emplace_back(
+        folly::sformat(
+            "{}.{}", events[i - 1].eventDescr, events[i].eventDescr),
+        std::chrono::milliseconds(durationMs));
+  }
+  return stages;
+}
+
 template <class T>
 int64_t
 generateHashImpl(
-    const int64_t version, const std::string& originatorId, const T& value) {
+    const int64_t version,
+    const std::string& originatorId,
+    const T& value,
+    thrift::HashVersion hashVersion) {
+  if (hashVersion == thrift::HashVersion::V2) {
+    // sizes keep the fields apart, e.g. originator "ab" with value "c" from
+    // originator "a" with value "bc"
+    const uint64_t originatorIdSize = originatorId.size();
+    folly::hash::SpookyHashV2 spooky;
+    spooky.Init(0, 0);
+    spooky.Update(&version, sizeof(version));
+    spooky.Update(&originatorIdSize, sizeof(originatorIdSize));
+    spooky.Update(originatorId.data(), originatorId.size());
+    if (value.has_value()) {
+      spooky.Update(value.value().data(), value.value().size());
+    }
+    uint64_t hash1{0}, hash2{0};
+    spooky.Final(&hash1, &hash2);
+    return static_cast<int64_t>(hash1);
+  }
+
   size_t seed = 0;
   boost::hash_combine(seed, version);
   boost::hash_combine(seed, originatorId);
@@ -468,16 +520,18 @@ int64_t
 generateHash(
     const int64_t version,
     const std::string& originatorId,
-    const std::optional<std::string>& value) {
-  return generateHashImpl(version, originatorId, value);
+    const std::optional<std::string>& value,
+    thrift::HashVersion hashVersion) {
+  return generateHashImpl(version, originatorId, value, hashVersion);
 }
 
 int64_t
 generateHash(
     const int64_t version,
     const std::string& originatorId,
-    const apache::thrift::optional_field_ref<const std::string&> value) {
-  return generateHashImpl(version, originatorId, value);
+    const apache::thrift::optional_field_ref<const std::string&> value,
+    thrift::HashVersion hashVersion) {
+  return generateHashImpl(version, originatorId, value, hashVersion);
 }
 
 std::string
@@ -547,71 +601,83 @@ getBestNextHopsMpls(std::vector<thrift::NextHopThrift> const& allNextHops) {
   return bestNextHops;
 }
 
+namespace {
+
+/**
+ * Diff routes keyed by getKey in one pass over both lists using a hash index
+ * of the old routes. Routes in both are deep compared only for the same key.
+ * Routes to update follow the order of newRoutes, keys to delete the order of
+ * oldRoutes.
+ */
+template <typename Route, typename GetKey>
+void
+diffRoutes(
+    const std::vector<Route>& newRoutes,
+    const std::vector<Route>& oldRoutes,
+    GetKey getKey,
+    std::vector<Route>& routesToUpdate,
+    std::vector<std::decay_t<std::invoke_result_t<GetKey, const Route&>>>&
+        keysToDelete) {
+  using Key = std::decay_t<std::invoke_result_t<GetKey, const Route&>>;
+  std::unordered_map<Key, const Route*> oldRoutesByKey;
+  oldRoutesByKey.reserve(oldRoutes.size());
+  for (const auto& route : oldRoutes) {
+    oldRoutesByKey.emplace(getKey(route), &route);
+  }
+
+  for (const auto& route : newRoutes) {
+    auto it = oldRoutesByKey.find(getKey(route));
+    if (it == oldRoutesByKey.end()) {
+      routesToUpdate.emplace_back(route);
+      continue;
+    }
+    if (not(*it->second == route)) {
+      routesToUpdate.emplace_back(route);
+    }
+    oldRoutesByKey.erase(it);
+  }
+
+  // whatever is left of the old routes is gone
+  for (const auto& route : oldRoutes) {
+    if (oldRoutesByKey.empty()) {
+      break;
+    }
+    auto it = oldRoutesByKey.find(getKey(route));
+    if (it != oldRoutesByKey.end()) {
+      keysToDelete.emplace_back(it->first);
+      oldRoutesByKey.erase(it);
+    }
+  }
+}
+
+} // namespace
+
 thrift::RouteDatabaseDelta
 findDeltaRoutes(
     const thrift::RouteDatabase& newRouteDb,
     const thrift::RouteDatabase& oldRouteDb) {
   DCHECK(newRouteDb.thisNodeName == oldRouteDb.thisNodeName);
 
-  // Find unicast routes to be added/updated or removed
-  std::vector<thrift::UnicastRoute> unicastRoutesToUpdate;
-  std::set_difference(
-      newRouteDb.unicastRoutes.begin(),
-      newRouteDb.unicastRoutes.end(),
-      oldRouteDb.unicastRoutes.begin(),
-      oldRouteDb.unicastRoutes.end(),
-      std::inserter(unicastRoutesToUpdate, unicastRoutesToUpdate.begin()));
-  std::vector<thrift::UnicastRoute> unicastRoutesToDelete;
-  std::set_difference(
-      oldRouteDb.unicastRoutes.begin(),
-      oldRouteDb.unicastRoutes.end(),
-      newRouteDb.unicastRoutes.begin(),
-      newRouteDb.unicastRoutes.end(),
-      std::inserter(unicastRoutesToDelete, unicastRoutesToDelete.begin()));
-
-  // Find mpls routes to be added/updated or removed
-  std::vector<thrift::MplsRoute> mplsRoutesToUpdate;
-  std::set_difference(
-      newRouteDb.mplsRoutes.begin(),
-      newRouteDb.mplsRoutes.end(),
-      oldRouteDb.mplsRoutes.begin(),
-      oldRouteDb.mplsRoutes.end(),
-      std::inserter(mplsRoutesToUpdate, mplsRoutesToUpdate.begin()));
-  std::vector<thrift::MplsRoute> mplsRoutesToDelete;
-  std::set_difference(
-      oldRouteDb.mplsRoutes.begin(),
-      oldRouteDb.mplsRoutes.end(),
-      newRouteDb.mplsRoutes.begin(),
-      newRouteDb.mplsRoutes.end(),
-      std::inserter(mplsRoutesToDelete, mplsRoutesToDelete.begin()));
-
-  // Find entry of prefix to be removed
-  std::set<thrift::IpPrefix> prefixesToRemove;
-  for (const auto& route : unicastRoutesToDelete) {
-    prefixesToRemove.emplace(route.dest);
-  }
-  for (const auto& route : unicastRoutesToUpdate) {
-    prefixesToRemove.erase(route.dest);
-  }
-
-  // Find labels to be removed
-  std::set<int32_t> labelsToRemove;
-  for (const auto& route : mplsRoutesToDelete) {
-    labelsToRemove.emplace(route.topLabel);
-  }
-  for (const auto& route : mplsRoutesToUpdate) {
-    labelsToRemove.erase(route.topLabel);
-  }
-
-  // Build routes to be programmed.
   thrift::RouteDatabaseDelta routeDbDelta;
   routeDbDelta.thisNodeName = newRouteDb.thisNodeName;
-  routeDbDelta.unicastRoutesToUpdate = std::move(unicastRoutesToUpdate);
-  routeDbDelta.unicastRoutesToDelete = {prefixesToRemove.begin(),
-                                        prefixesToRemove.end()};
-  routeDbDelta.mplsRoutesToUpdate = std::move(mplsRoutesToUpdate);
-  routeDbDelta.mplsRoutesToDelete = {labelsToRemove.begin(),
-                                     labelsToRemove.end()};
+
+  // Find unicast routes to be added/updated or removed, by prefix
+  diffRoutes(
+      newRouteDb.unicastRoutes,
+      oldRouteDb.unicastRoutes,
+      [](const thrift::UnicastRoute& route) -> const thrift::IpPrefix& {
+        return route.dest;
+      },
+      routeDbDelta.unicastRoutesToUpdate,
+      routeDbDelta.unicastRoutesToDelete);
+
+  // Find mpls routes to be added/updated or removed, by top label
+  diffRoutes(
+      newRouteDb.mplsRoutes,
+      oldRouteDb.mplsRoutes,
+      [](const thrift::MplsRoute& route) { return route.topLabel; },
+      routeDbDelta.mplsRoutesToUpdate,
+      routeDbDelta.mplsRoutesToDelete);
 
   return routeDbDelta;
 }
@@ -1019,11 +1085,86 @@ getNodeNameFromKey(const std::string& key) {
   return split[1];
 }
 
+std::string
+createPerAdjacencyKey(
+    const std::string& adjacencyDbMarker,
+    const std::string& nodeName,
+    const std::string& ifName,
+    const std::string& otherNodeName) {
+  return folly::to<std::string>(
+      adjacencyDbMarker,
+      nodeName,
+      Constants::kPrefixNameSeparator.toString(),
+      ifName,
+      Constants::kPrefixNameSeparator.toString(),
+      otherNodeName);
+}
+
+bool
+isPerAdjacencyKey(const std::string& key) {
+  // "adj:<nodeName>" has a single separator
+  return std::count(
+             key.begin(),
+             key.end(),
+             Constants::kPrefixNameSeparator.front()) > 1;
+}
+
+std::string
+createPrefixBucketKey(
+    const std::string& prefixDbMarker,
+    const std::string& nodeName,
+    size_t bucket) {
+  return folly::to<std::string>(
+      prefixDbMarker,
+      nodeName,
+      Constants::kPrefixNameSeparator.toString(),
+      Constants::kPrefixBucketKeyMarker.toString(),
+      Constants::kPrefixNameSeparator.toString(),
+      bucket);
+}
+
+bool
+isPrefixBucketKey(const std::string& key) {
+  // node names have no separator
+  return key.find(folly::to<std::string>(
+             Constants::kPrefixNameSeparator.toString(),
+             Constants::kPrefixBucketKeyMarker.toString(),
+             Constants::kPrefixNameSeparator.toString())) !=
+      std::string::npos;
+}
+
 std::string
 createPeerSyncId(const std::string& node, const std::string& area) {
   return folly::to<std::string>(node, area, "::TCP::SYNC");
 };
 
+thrift::TraceSpans
+toThriftTraceSpans(TraceBuffer const& buffer) {
+  const auto unixOffset =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch()) -
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          TraceBuffer::Clock::now().time_since_epoch());
+  thrift::TraceSpans traceSpans;
+  for (auto& span : buffer.getSpans()) {
+    thrift::TraceSpan traceSpan;
+    traceSpan.seqNum = span.seqNum;
+    traceSpan.name = std::move(span.name);
+    traceSpan.detail = std::move(span.detail);
+    traceSpan.startTimeUs =
+        (std::chrono::duration_cast<std::chrono::microseconds>(
+             span.start.time_since_epoch()) +
+         unixOffset)
+            .count();
+    traceSpan.durationNs = span.duration.count();
+    traceSpan.threadId = span.threadId;
+    traceSpan.arg = span.arg;
+    traceSpans.spans.emplace_back(std::move(traceSpan));
+  }
+  traceSpans.droppedSpans = buffer.getDroppedCount();
+  return traceSpans;
+}
+
 namespace MetricVectorUtils {
 
 std::optional<const openr::thrift::MetricEntity>
@@ -1113,16 +1254,19 @@ sortMetricVector(thrift::MetricVector const& mv) {
       });
 }
 
+namespace {
+
 CompareResult
-compareMetrics(
-    std::vector<int64_t> const& l,
-    std::vector<int64_t> const& r,
+compareMetricRanges(
+    int64_t const* lBegin,
+    int64_t const* lEnd,
+    int64_t const* rBegin,
+    int64_t const* rEnd,
     bool tieBreaker) {
-  if (l.size() != r.size()) {
+  if (lEnd - lBegin != rEnd - rBegin) {
     return CompareResult::ERROR;
   }
-  for (auto lIter = l.begin(), rIter = r.begin(); lIter != l.end();
-       ++lIter, ++rIter) {
+  for (auto lIter = lBegin, rIter = rBegin; lIter != lEnd; ++lIter, ++rIter) {
     if (*lIter > *rIter) {
       return tieBreaker ? CompareResult::TIE_WINNER : CompareResult::WINNER;
     } else if (*lIter < *rIter) {
@@ -1133,18 +1277,34 @@ compareMetrics(
 }
 
 CompareResult
-resultForLoner(thrift::MetricEntity const& entity) {
-  if (thrift::CompareType::WIN_IF_PRESENT == entity.op) {
-    return entity.isBestPathTieBreaker ? CompareResult::TIE_WINNER
-                                       : CompareResult::WINNER;
-  } else if (thrift::CompareType::WIN_IF_NOT_PRESENT == entity.op) {
-    return entity.isBestPathTieBreaker ? CompareResult::TIE_LOOSER
-                                       : CompareResult::LOOSER;
+resultForLoner(thrift::CompareType op, bool isBestPathTieBreaker) {
+  if (thrift::CompareType::WIN_IF_PRESENT == op) {
+    return isBestPathTieBreaker ? CompareResult::TIE_WINNER
+                                : CompareResult::WINNER;
+  } else if (thrift::CompareType::WIN_IF_NOT_PRESENT == op) {
+    return isBestPathTieBreaker ? CompareResult::TIE_LOOSER
+                                : CompareResult::LOOSER;
   }
   // IGNORE_IF_NOT_PRESENT
   return CompareResult::TIE;
 }
 
+} // namespace
+
+CompareResult
+compareMetrics(
+    std::vector<int64_t> const& l,
+    std::vector<int64_t> const& r,
+    bool tieBreaker) {
+  return compareMetricRanges(
+      l.data(), l.data() + l.size(), r.data(), r.data() + r.size(), tieBreaker);
+}
+
+CompareResult
+resultForLoner(thrift::MetricEntity const& entity) {
+  return resultForLoner(entity.op, entity.isBestPathTieBreaker);
+}
+
 void
 maybeUpdate(CompareResult& target, CompareResult update) {
   if (isDecisive(update) || CompareResult::TIE == target) {
@@ -1201,6 +1361,113 @@ compareMetricVectors(
   return result;
 }
 
+NormalizedMetricVector
+normalizeMetricVector(thrift::MetricVector const& mv) {
+  NormalizedMetricVector normalized;
+  normalized.version = mv.version;
+  normalized.entities.reserve(mv.metrics.size());
+  std::vector<thrift::MetricEntity const*> entities;
+  entities.reserve(mv.metrics.size());
+  for (auto const& entity : mv.metrics) {
+    entities.emplace_back(&entity);
+  }
+  std::stable_sort(
+      entities.begin(),
+      entities.end(),
+      [](thrift::MetricEntity const* l, thrift::MetricEntity const* r) {
+        return l->priority > r->priority;
+      });
+  for (auto const* entity : entities) {
+    addMetricEntity(normalized, *entity);
+  }
+  return normalized;
+}
+
+void
+addMetricEntity(
+    NormalizedMetricVector& mv, thrift::MetricEntity const& entity) {
+  NormalizedMetricVector::Entity normalized;
+  normalized.type = entity.type;
+  normalized.priority = entity.priority;
+  normalized.op = entity.op;
+  normalized.isBestPathTieBreaker = entity.isBestPathTieBreaker;
+  normalized.metricBegin = mv.metrics.size();
+  mv.metrics.insert(
+      mv.metrics.end(), entity.metric.begin(), entity.metric.end());
+  normalized.metricEnd = mv.metrics.size();
+
+  auto pos = std::upper_bound(
+      mv.entities.begin(),
+      mv.entities.end(),
+      normalized.priority,
+      [](int64_t priority, NormalizedMetricVector::Entity const& other) {
+        return priority > other.priority;
+      });
+  mv.entities.insert(pos, normalized);
+}
+
+CompareResult
+compareMetricVectors(
+    NormalizedMetricVector const& l, NormalizedMetricVector const& r) {
+  CompareResult result = CompareResult::TIE;
+
+  if (l.version != r.version) {
+    return CompareResult::ERROR;
+  }
+
+  auto metricsOf = [](NormalizedMetricVector const& mv,
+                      NormalizedMetricVector::Entity const& entity) {
+    return std::make_pair(
+        mv.metrics.data() + entity.metricBegin,
+        mv.metrics.data() + entity.metricEnd);
+  };
+
+  auto lIter = l.entities.begin();
+  auto rIter = r.entities.begin();
+  while (!isDecisive(result) &&
+         (lIter != l.entities.end() && rIter != r.entities.end())) {
+    if (lIter->type == rIter->type) {
+      if (lIter->isBestPathTieBreaker != rIter->isBestPathTieBreaker) {
+        maybeUpdate(result, CompareResult::ERROR);
+      } else {
+        auto const lMetrics = metricsOf(l, *lIter);
+        auto const rMetrics = metricsOf(r, *rIter);
+        maybeUpdate(
+            result,
+            compareMetricRanges(
+                lMetrics.first,
+                lMetrics.second,
+                rMetrics.first,
+                rMetrics.second,
+                lIter->isBestPathTieBreaker));
+      }
+      ++lIter;
+      ++rIter;
+    } else if (lIter->priority > rIter->priority) {
+      maybeUpdate(
+          result, resultForLoner(lIter->op, lIter->isBestPathTieBreaker));
+      ++lIter;
+    } else if (lIter->priority < rIter->priority) {
+      maybeUpdate(
+          result, !resultForLoner(rIter->op, rIter->isBestPathTieBreaker));
+      ++rIter;
+    } else {
+      // priorities are the same but types are different
+      maybeUpdate(result, CompareResult::ERROR);
+    }
+  }
+  while (!isDecisive(result) && lIter != l.entities.end()) {
+    maybeUpdate(result, resultForLoner(lIter->op, lIter->isBestPathTieBreaker));
+    ++lIter;
+  }
+  while (!isDecisive(result) && rIter != r.entities.end()) {
+    maybeUpdate(
+        result, !resultForLoner(rIter->op, rIter->isBestPathTieBreaker));
+    ++rIter;
+  }
+  return result;
+}
+
 } // namespace MetricVectorUtils
 
 } // namespace openr
@@ -27,7 +27,9 @@
 #include <openr/common/BuildInfo.h>
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
+#include <openr/common/TraceBuffer.h>
 #include <openr/common/Types.h>
+#include <openr/if/gen-cpp2/Decision_types.h>
 #include <openr/if/gen-cpp2/AllocPrefix_types.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
 #include <openr/if/gen-cpp2/KvStore_constants.h>
@@ -206,6 +208,11 @@ getUnixTimeStampMs() noexcept {
       .count();
 }
 
+/**
+ * Time since the process got loaded, for timings of startup phases
+ */
+std::chrono::milliseconds getProcessUptime() noexcept;
+
 /**
  * Add a perf event
  */
@@ -232,6 +239,13 @@ getDurationBetweenPerfEvents(
     const std::string& firstName,
     const std::string& secondName) noexcept;
 
+/**
+ * Durations between consecutive perf events, keyed by stage name
+ * "<first-event>.<second-event>". Stages going back in time are skipped
+ */
+std::vector<std::pair<std::string, std::chrono::milliseconds>>
+getPerfEventsStageDurations(const thrift::PerfEvents& perfEvents) noexcept;
+
 /**
  * Generate hash for each keyval pair
  * as a abstract of version number, originator and values
@@ -239,12 +253,14 @@ getDurationBetweenPerfEvents(
 int64_t generateHash(
     const int64_t version,
     const std::string& originatorId,
-    const std::optional<std::string>& value);
+    const std::optional<std::string>& value,
+    thrift::HashVersion hashVersion = thrift::HashVersion::V1);
 
 int64_t generateHash(
     const int64_t version,
     const std::string& originatorId,
-    const apache::thrift::optional_field_ref<const std::string&> value);
+    const apache::thrift::optional_field_ref<const std::string&> value,
+    thrift::HashVersion hashVersion = thrift::HashVersion::V1);
 
 /**
  * TO BE DEPRECATED SOON: Backward compatible with empty remoteIfName
@@ -270,7 +286,9 @@ std::vector<thrift::NextHopThrift> getBestNextHopsMpls(
     std::vector<thrift::NextHopThrift> const& nextHops);
 
 /**
- * Find delta between two route databases
+ * Find delta between two route databases, by prefix and label. Route lists
+ * don't need to be sorted, it takes a single pass over each with a hash index
+ * of the old routes and deep compares routes of the same prefix/label only.
  */
 thrift::RouteDatabaseDelta findDeltaRoutes(
     const thrift::RouteDatabase& newRouteDb,
@@ -510,8 +528,33 @@ std::vector<thrift::MplsRoute> createMplsRoutesWithBestNextHopsMap(
 
 std::string getNodeNameFromKey(const std::string& key);
 
+// key of a single adjacency advertised on its own, next to the adjacency db key
+// of the node, "<marker><nodeName>:<ifName>:<otherNodeName>"
+std::string createPerAdjacencyKey(
+    const std::string& adjacencyDbMarker,
+    const std::string& nodeName,
+    const std::string& ifName,
+    const std::string& otherNodeName);
+
+// true for keys made by createPerAdjacencyKey(), false for adjacency db keys
+bool isPerAdjacencyKey(const std::string& key);
+
+// key of a bucket of the prefixes of a node, advertised in place of the prefix
+// db key of the node, "<marker><nodeName>:bucket:<bucket>"
+std::string createPrefixBucketKey(
+    const std::string& prefixDbMarker,
+    const std::string& nodeName,
+    size_t bucket);
+
+// true for keys made by createPrefixBucketKey()
+bool isPrefixBucketKey(const std::string& key);
+
 std::string createPeerSyncId(const std::string& node, const std::string& area);
 
+// spans of buffer as thrift, oldest first. Span start is steady clock time,
+// converted to unix time
+thrift::TraceSpans toThriftTraceSpans(TraceBuffer const& buffer);
+
 namespace MetricVectorUtils {
 
 enum class CompareResult { WINNER, TIE_WINNER, TIE, TIE_LOOSER, LOOSER, ERROR };
@@ -546,6 +589,36 @@ void maybeUpdate(CompareResult& target, CompareResult update);
 
 CompareResult compareMetricVectors(
     thrift::MetricVector const& l, thrift::MetricVector const& r);
+
+// MetricVector prepared for repeated comparisons. Entities are kept in
+// decreasing order of priority and the metrics of all entities are stored
+// back to back, hence comparing neither sorts nor allocates
+struct NormalizedMetricVector {
+  struct Entity {
+    int64_t type{0};
+    int64_t priority{0};
+    thrift::CompareType op{thrift::CompareType::WIN_IF_PRESENT};
+    bool isBestPathTieBreaker{false};
+    // metrics of the entity are metrics[metricBegin, metricEnd)
+    uint32_t metricBegin{0};
+    uint32_t metricEnd{0};
+  };
+
+  int64_t version{0};
+  std::vector<Entity> entities;
+  std::vector<int64_t> metrics;
+};
+
+NormalizedMetricVector normalizeMetricVector(thrift::MetricVector const& mv);
+
+// add entity to a normalized metric vector, after the entities of the same
+// or higher priority
+void addMetricEntity(
+    NormalizedMetricVector& mv, thrift::MetricEntity const& entity);
+
+// same result as comparing the original metric vectors
+CompareResult compareMetricVectors(
+    NormalizedMetricVector const& l, NormalizedMetricVector const& r);
 } // namespace MetricVectorUtils
 
 } // namespace openr
@@ -0,0 +1,42 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "WheelTimeout.h"
+
+#include <glog/logging.h>
+
+namespace openr {
+
+WheelTimeout::WheelTimeout(folly::HHWheelTimer* wheel, TimeoutCallback callback)
+    : wheel_(wheel), callback_(std::move(callback)) {
+  CHECK(wheel_) << "Got null HHWheelTimer";
+  CHECK(callback_) << "Got empty timeout callback";
+}
+
+std::unique_ptr<WheelTimeout>
+WheelTimeout::make(folly::HHWheelTimer* wheel, TimeoutCallback callback) {
+  return std::make_unique<WheelTimeout>(wheel, std::move(callback));
+}
+
+void
+WheelTimeout::scheduleTimeout(
+    std::chrono::milliseconds timeout, bool isPeriodic) {
+  period_ = isPeriodic ? timeout : std::chrono::milliseconds(0);
+  // the wheel cancels a pending timeout before scheduling it again
+  wheel_->scheduleTimeout(this, timeout);
+}
+
+void
+WheelTimeout::timeoutExpired() noexcept {
+  // reschedule first, the callback may cancel or reschedule the timeout
+  if (period_.count() > 0) {
+    wheel_->scheduleTimeout(this, period_);
+  }
+  callback_();
+}
+
+} // namespace openr
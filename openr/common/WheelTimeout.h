@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include <folly/io/async/HHWheelTimer.h>
+
+namespace openr {
+
+/**
+ * Timeout on a folly::HHWheelTimer, with the API of fbzmq::ZmqTimeout. Meant
+ * for many timeouts that get rescheduled all the time, e.g. per-neighbor hold
+ * timers. Scheduling and cancelling take constant time and all timeouts
+ * expiring within a tick of the wheel fire together, from a single event loop
+ * timer. Expiry is rounded up to the tick of the wheel.
+ *
+ * The wheel must outlive its timeouts. Not thread-safe, only to be used from
+ * the event loop of the wheel.
+ */
+class WheelTimeout : public folly::HHWheelTimer::Callback {
+ public:
+  using TimeoutCallback = std::function<void(void)>;
+
+  WheelTimeout(folly::HHWheelTimer* wheel, TimeoutCallback callback);
+
+  static std::unique_ptr<WheelTimeout> make(
+      folly::HHWheelTimer* wheel, TimeoutCallback callback);
+
+  /**
+   * (Re)schedule the timeout, a pending one gets cancelled first. A periodic
+   * timeout gets scheduled again each time it expires, until cancelled.
+   */
+  void scheduleTimeout(
+      std::chrono::milliseconds timeout, bool isPeriodic = false);
+
+  // cancelTimeout() and isScheduled() come from folly::HHWheelTimer::Callback
+
+ private:
+  void timeoutExpired() noexcept override;
+
+  folly::HHWheelTimer* const wheel_{nullptr};
+  const TimeoutCallback callback_;
+
+  // period of a periodic timeout, 0 otherwise
+  std::chrono::milliseconds period_{0};
+};
+
+} // namespace openr
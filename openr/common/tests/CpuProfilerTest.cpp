@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/CpuProfiler.h>
+
+namespace openr {
+
+namespace {
+
+// keeps the CPU busy, so that its CPU clock advances and gets sampled
+void
+spin(std::atomic<bool> const& stop) {
+  volatile uint64_t counter{0};
+  while (not stop.load()) {
+    ++counter;
+  }
+}
+
+} // namespace
+
+/**
+ * Profiles need registered threads, a valid duration and frequency. A busy
+ * thread gets sampled, tagged with its module, and further profiles are
+ * rate-limited
+ */
+TEST(CpuProfiler, Profile) {
+  // nothing to profile yet
+  auto profile = CpuProfiler::profile(std::chrono::milliseconds(100), 100);
+  ASSERT_TRUE(profile.hasError());
+
+  std::atomic<bool> registered{false};
+  std::atomic<bool> stop{false};
+  std::thread thread([&]() {
+    CpuProfiler::registerThread("TestModule");
+    registered = true;
+    spin(stop);
+    CpuProfiler::unregisterThread();
+  });
+  while (not registered.load()) {
+    std::this_thread::yield();
+  }
+
+  // out of bounds
+  EXPECT_TRUE(CpuProfiler::profile(std::chrono::milliseconds(0), 100)
+                  .hasError());
+  EXPECT_TRUE(CpuProfiler::profile(std::chrono::hours(1), 100).hasError());
+  EXPECT_TRUE(
+      CpuProfiler::profile(std::chrono::milliseconds(100), 0).hasError());
+  EXPECT_TRUE(
+      CpuProfiler::profile(std::chrono::milliseconds(100), 100000).hasError());
+
+  profile = CpuProfiler::profile(std::chrono::milliseconds(500), 100);
+  ASSERT_TRUE(profile.hasValue()) << profile.error();
+  EXPECT_NE(std::string::npos, profile->find("TestModule;"));
+  LOG(INFO) << "Profile:\n" << profile.value();
+
+  // rate-limited
+  EXPECT_TRUE(CpuProfiler::profile(std::chrono::milliseconds(100), 100)
+                  .hasError());
+
+  stop = true;
+  thread.join();
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
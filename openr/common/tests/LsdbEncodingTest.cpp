@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/init/Init.h>
+#include <gtest/gtest.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/common/LsdbEncoding.h>
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+
+namespace openr {
+
+namespace {
+
+thrift::AdjacencyDatabase
+createTestAdjDb(size_t numAdjacencies) {
+  std::vector<thrift::Adjacency> adjs;
+  for (size_t i = 0; i < numAdjacencies; ++i) {
+    adjs.emplace_back(createThriftAdjacency(
+        folly::sformat("node-{}", i % 4),
+        folly::sformat("po{}", i),
+        "fe80::1",
+        "10.0.0.1",
+        10 + i,
+        50000 + i,
+        i % 2,
+        100 * i,
+        1500000000 + i,
+        1,
+        folly::sformat("po{}", i + 100)));
+    adjs.back().nextHopV6.ifName = adjs.back().ifName;
+  }
+  thrift::AdjacencyMetricDampening metricDampening;
+  metricDampening.measuredMetric = 12;
+  metricDampening.penalty = 1.5;
+  metricDampening.isSuppressed = true;
+  metricDampening.reuseDelayMs = -1;
+  adjs.front().metricDampening = metricDampening;
+
+  auto adjDb = createAdjDb("node-0", adjs, 1, true);
+  adjDb.perfEvents = thrift::PerfEvents{};
+  addPerfEvent(adjDb.perfEvents.value(), "node-0", "ADJ_DB_UPDATED");
+  return adjDb;
+}
+
+thrift::PrefixDatabase
+createTestPrefixDb(size_t numPrefixes) {
+  std::vector<thrift::PrefixEntry> entries;
+  for (size_t i = 0; i < numPrefixes; ++i) {
+    entries.emplace_back(createPrefixEntry(
+        toIpPrefix(folly::sformat("fc00:{:x}::/64", i)),
+        thrift::PrefixType::BGP,
+        "data",
+        thrift::PrefixForwardingType::SR_MPLS,
+        thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP));
+  }
+  thrift::MetricVector mv;
+  mv.version = 1;
+  mv.metrics.emplace_back(createMetricEntity(
+      int64_t(thrift::MetricEntityType::LOCAL_PREFERENCE),
+      100,
+      thrift::CompareType::WIN_IF_PRESENT,
+      true,
+      {-1, 0, 200}));
+  entries.front().mv = mv;
+  entries.front().ephemeral = false;
+  entries.front().minNexthop = 2;
+
+  auto prefixDb = createPrefixDb("node-0", entries);
+  prefixDb.perPrefixKey = true;
+  return prefixDb;
+}
+
+} // namespace
+
+TEST(LsdbEncoding, AdjacencyDatabaseRoundTrip) {
+  apache::thrift::CompactSerializer serializer;
+  const auto adjDb = createTestAdjDb(32);
+
+  const auto compact = writeLsdbValue(adjDb, serializer, true);
+  EXPECT_TRUE(isCompactLsdbValue(compact));
+  EXPECT_EQ(
+      adjDb, readLsdbValue<thrift::AdjacencyDatabase>(compact, serializer));
+
+  // smaller than serialized, thanks to the string table
+  const auto serialized = writeLsdbValue(adjDb, serializer, false);
+  EXPECT_FALSE(isCompactLsdbValue(serialized));
+  EXPECT_LT(compact.size(), serialized.size());
+  EXPECT_EQ(
+      adjDb, readLsdbValue<thrift::AdjacencyDatabase>(serialized, serializer));
+
+  // defaults and unset optionals
+  thrift::AdjacencyDatabase emptyAdjDb;
+  EXPECT_EQ(
+      emptyAdjDb,
+      readLsdbValue<thrift::AdjacencyDatabase>(
+          writeLsdbValue(emptyAdjDb, serializer, true), serializer));
+}
+
+TEST(LsdbEncoding, PrefixDatabaseRoundTrip) {
+  apache::thrift::CompactSerializer serializer;
+  const auto prefixDb = createTestPrefixDb(32);
+
+  const auto compact = writeLsdbValue(prefixDb, serializer, true);
+  EXPECT_TRUE(isCompactLsdbValue(compact));
+  EXPECT_EQ(
+      prefixDb, readLsdbValue<thrift::PrefixDatabase>(compact, serializer));
+
+  const auto serialized = writeLsdbValue(prefixDb, serializer, false);
+  EXPECT_LT(compact.size(), serialized.size());
+  EXPECT_EQ(
+      prefixDb, readLsdbValue<thrift::PrefixDatabase>(serialized, serializer));
+
+  thrift::PrefixDatabase deletedPrefixDb;
+  deletedPrefixDb.thisNodeName = "node-0";
+  deletedPrefixDb.deletePrefix = true;
+  EXPECT_EQ(
+      deletedPrefixDb,
+      readLsdbValue<thrift::PrefixDatabase>(
+          writeLsdbValue(deletedPrefixDb, serializer, true), serializer));
+}
+
+TEST(LsdbEncoding, Malformed) {
+  const auto compact = encodeCompactLsdbValue(createTestAdjDb(4));
+  thrift::AdjacencyDatabase adjDb;
+
+  // every truncation is detected
+  for (size_t len = 0; len < compact.size(); ++len) {
+    EXPECT_THROW(
+        decodeCompactLsdbValue(
+            folly::StringPiece(compact.data(), len), adjDb),
+        std::runtime_error);
+  }
+
+  // trailing bytes
+  EXPECT_THROW(
+      decodeCompactLsdbValue(compact + "x", adjDb), std::runtime_error);
+
+  // unknown version
+  auto unknownVersion = compact;
+  unknownVersion[1] = kLsdbEncodingVersion + 1;
+  EXPECT_THROW(
+      decodeCompactLsdbValue(unknownVersion, adjDb), std::runtime_error);
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
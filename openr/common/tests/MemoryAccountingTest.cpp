@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/init/Init.h>
+#include <folly/memory/Malloc.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/MemoryAccounting.h>
+
+namespace openr {
+
+/**
+ * Allocations of threads bound to a module are accounted to it, only when
+ * running with jemalloc
+ */
+TEST(MemoryAccounting, BindAndAccount) {
+  std::vector<std::unique_ptr<char[]>> blocks;
+  bool bound{false};
+  std::thread([&]() {
+    bound = MemoryAccounting::bindThreadToModule("TestModule");
+    for (int i = 0; i < 16; ++i) {
+      blocks.emplace_back(std::make_unique<char[]>(1 << 20));
+    }
+  }).join();
+
+  auto allocated = MemoryAccounting::getAllocatedBytes();
+  if (not folly::usingJEMalloc()) {
+    EXPECT_FALSE(bound);
+    EXPECT_TRUE(allocated.empty());
+    return;
+  }
+  EXPECT_TRUE(bound);
+  ASSERT_EQ(1, allocated.count("TestModule"));
+  EXPECT_LE(16 << 20, allocated.at("TestModule"));
+
+  // freed from another thread, still accounted to the module arena
+  blocks.clear();
+  allocated = MemoryAccounting::getAllocatedBytes();
+  EXPECT_GT(16 << 20, allocated.at("TestModule"));
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
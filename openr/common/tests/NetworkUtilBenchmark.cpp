@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/NetworkUtil.h>
+
+namespace openr {
+
+namespace {
+
+// `numPrefixes` distinct v4 or v6 prefixes, of lengths 24 and 64
+std::vector<thrift::IpPrefix>
+createPrefixes(bool isV4, size_t numPrefixes) {
+  std::vector<thrift::IpPrefix> prefixes;
+  prefixes.reserve(numPrefixes);
+  for (size_t i = 0; i < numPrefixes; ++i) {
+    prefixes.emplace_back(toIpPrefix(
+        isV4 ? folly::sformat("10.{}.{}.0/24", (i >> 8) & 0xff, i & 0xff)
+             : folly::sformat("fc00:{:x}:{:x}::/64", i >> 16, i & 0xffff)));
+  }
+  return prefixes;
+}
+
+} // namespace
+
+/**
+ * Conversion of thrift prefixes to networks, through the string of the
+ * address as before or from its bytes. Time is reported per prefix.
+ */
+static void
+BM_ToIPNetwork(uint32_t iters, bool fromBytes, bool isV4) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto prefixes = createPrefixes(isV4, 1024);
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto const& prefix = prefixes[i % prefixes.size()];
+    if (fromBytes) {
+      folly::doNotOptimizeAway(toIPNetwork(prefix));
+    } else {
+      folly::doNotOptimizeAway(folly::IPAddress::createNetwork(
+          toIPAddress(prefix.prefixAddress).str(), prefix.prefixLength));
+    }
+  }
+  suspender.rehire(); // Stop measuring time again
+}
+
+/**
+ * Formatting of thrift prefixes, with folly::sformat as before or by
+ * appending to the string of the address. Time is reported per prefix.
+ */
+static void
+BM_ToStringIpPrefix(uint32_t iters, bool append, bool isV4) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto prefixes = createPrefixes(isV4, 1024);
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto const& prefix = prefixes[i % prefixes.size()];
+    if (append) {
+      folly::doNotOptimizeAway(toString(prefix));
+    } else {
+      folly::doNotOptimizeAway(folly::sformat(
+          "{}/{}", toString(prefix.prefixAddress), prefix.prefixLength));
+    }
+  }
+  suspender.rehire(); // Stop measuring time again
+}
+
+/**
+ * Formatting of prefix keys, through a thrift prefix as before or from the
+ * bytes of the key. Time is reported per prefix.
+ */
+static void
+BM_ToStringIpPrefixKey(uint32_t iters, bool fromBytes, bool isV4) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<IpPrefixKey> keys;
+  for (auto const& prefix : createPrefixes(isV4, 1024)) {
+    keys.emplace_back(prefix);
+  }
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto const& key = keys[i % keys.size()];
+    if (fromBytes) {
+      folly::doNotOptimizeAway(toString(key));
+    } else {
+      folly::doNotOptimizeAway(toString(key.toThrift()));
+    }
+  }
+  suspender.rehire(); // Stop measuring time again
+}
+
+// The parameters are the new conversion or not and v4 prefixes or v6 ones
+BENCHMARK_NAMED_PARAM(BM_ToIPNetwork, string_v4, false, true);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_ToIPNetwork, bytes_v4, true, true);
+BENCHMARK_NAMED_PARAM(BM_ToIPNetwork, string_v6, false, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_ToIPNetwork, bytes_v6, true, false);
+BENCHMARK_NAMED_PARAM(BM_ToStringIpPrefix, sformat_v4, false, true);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_ToStringIpPrefix, append_v4, true, true);
+BENCHMARK_NAMED_PARAM(BM_ToStringIpPrefix, sformat_v6, false, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_ToStringIpPrefix, append_v6, true, false);
+BENCHMARK_NAMED_PARAM(BM_ToStringIpPrefixKey, thrift_v4, false, true);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_ToStringIpPrefixKey, bytes_v4, true, true);
+BENCHMARK_NAMED_PARAM(BM_ToStringIpPrefixKey, thrift_v6, false, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_ToStringIpPrefixKey, bytes_v6, true, false);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -12,6 +12,10 @@
 #include <folly/futures/Promise.h>
 #include <folly/init/Init.h>
 #include <folly/synchronization/Baton.h>
+#if FOLLY_HAS_COROUTINES
+#include <folly/executors/ManualExecutor.h>
+#include <folly/experimental/coro/Sleep.h>
+#endif
 #include <gtest/gtest.h>
 
 #include <openr/common/OpenrEventBase.h>
@@ -73,6 +77,63 @@ TEST(OpenrEventBaseTest, FiberTest) {
   EXPECT_TRUE(f.hasValue());
 }
 
+#if FOLLY_HAS_COROUTINES
+TEST(OpenrEventBaseTest, CoroTaskCancellation) {
+  OpenrEventBase evb;
+  bool cancelled{false};
+  folly::Baton sleepingBaton;
+  evb.addCoroTask(
+      [&]() -> folly::coro::Task<void> {
+        sleepingBaton.post();
+        try {
+          co_await folly::coro::sleep(std::chrono::hours(1));
+        } catch (folly::OperationCancelled const&) {
+          cancelled = true;
+        }
+      }());
+
+  std::thread evbThread([&]() { evb.run(); });
+  evb.waitUntilRunning();
+  sleepingBaton.wait();
+
+  // stop() cancels the task rather than waiting for the timer
+  evb.stop();
+  evb.waitUntilStopped();
+  evbThread.join();
+  EXPECT_TRUE(cancelled);
+}
+
+TEST(OpenrEventBaseTest, CoroRunInEventBaseThread) {
+  OpenrEventBase evb;
+  std::thread evbThread([&]() { evb.run(); });
+  evb.waitUntilRunning();
+
+  // result and exception of func are returned to the awaiting coroutine,
+  // which gets resumed on its own executor
+  folly::ManualExecutor executor;
+  auto sf = folly::coro::co_invoke([&]() -> folly::coro::Task<int> {
+              auto inEvb = co_await evb.co_runInEventBaseThread(
+                  [&]() { return evb.getEvb()->isInEventBaseThread(); });
+              EXPECT_TRUE(inEvb);
+              EXPECT_FALSE(evb.getEvb()->isInEventBaseThread());
+              EXPECT_THROW(
+                  co_await evb.co_runInEventBaseThread(
+                      []() -> int { throw std::runtime_error("error"); }),
+                  std::runtime_error);
+              co_await evb.co_runInEventBaseThread([]() {});
+              co_return co_await evb.co_runInEventBaseThread(
+                  []() { return 42; });
+            })
+                .scheduleOn(&executor)
+                .start();
+  EXPECT_EQ(42, std::move(sf).via(&executor).getVia(&executor));
+
+  evb.stop();
+  evb.waitUntilStopped();
+  evbThread.join();
+}
+#endif
+
 TEST(OpenrEventBaseTest, RunnableApi) {
   OpenrEventBase evb;
 
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <array>
+#include <map>
+#include <random>
+#include <string>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/PrefixTrie.h>
+
+using namespace openr;
+
+namespace {
+
+folly::CIDRNetwork
+toNetwork(const std::string& prefix) {
+  return folly::IPAddress::createNetwork(prefix, -1, false);
+}
+
+// value of longest match, empty string if none
+std::string
+getMatch(const PrefixTrie<std::string>& trie, const std::string& network) {
+  const auto* match = trie.longestMatch(toNetwork(network));
+  return match ? *match : "";
+}
+
+} // namespace
+
+TEST(PrefixTrieTest, LongestMatch) {
+  PrefixTrie<std::string> trie;
+  for (auto const& prefix :
+       {"192.168.0.0/16",
+        "192.168.0.0/20",
+        "192.168.0.0/24",
+        "192.168.20.16/28",
+        "fc00::/7",
+        "fc00:cafe::/32"}) {
+    EXPECT_TRUE(trie.insert(toNetwork(prefix), prefix));
+  }
+  EXPECT_EQ(6, trie.size());
+
+  EXPECT_EQ("192.168.20.16/28", getMatch(trie, "192.168.20.19"));
+  EXPECT_EQ("192.168.20.16/28", getMatch(trie, "192.168.20.16/28"));
+  EXPECT_EQ("192.168.0.0/24", getMatch(trie, "192.168.0.0"));
+  EXPECT_EQ("", getMatch(trie, "192.168.0.0/14"));
+  EXPECT_EQ("192.168.0.0/16", getMatch(trie, "192.168.0.0/18"));
+  EXPECT_EQ("192.168.0.0/20", getMatch(trie, "192.168.0.0/22"));
+  EXPECT_EQ("192.168.0.0/24", getMatch(trie, "192.168.0.0/26"));
+  EXPECT_EQ("", getMatch(trie, "10.0.0.1"));
+
+  EXPECT_EQ("fc00:cafe::/32", getMatch(trie, "fc00:cafe::1"));
+  EXPECT_EQ("fc00::/7", getMatch(trie, "fd00::1"));
+  EXPECT_EQ("", getMatch(trie, "fe80::1"));
+
+  // V4 and V6 are apart, address bits alone would match fc00::/7 otherwise
+  EXPECT_EQ("", getMatch(trie, "252.0.0.1"));
+
+  // default route matches anything of its family
+  EXPECT_TRUE(trie.insert(toNetwork("0.0.0.0/0"), "0.0.0.0/0"));
+  EXPECT_EQ("0.0.0.0/0", getMatch(trie, "10.0.0.1"));
+  EXPECT_EQ("", getMatch(trie, "fe80::1"));
+
+  // replace
+  EXPECT_FALSE(trie.insert(toNetwork("192.168.0.0/16"), "replaced"));
+  EXPECT_EQ("replaced", getMatch(trie, "192.168.128.1"));
+  EXPECT_EQ(7, trie.size());
+}
+
+TEST(PrefixTrieTest, Erase) {
+  PrefixTrie<std::string> trie;
+  EXPECT_FALSE(trie.erase(toNetwork("10.0.0.0/8")));
+
+  trie.insert(toNetwork("10.0.0.0/8"), "10.0.0.0/8");
+  trie.insert(toNetwork("10.1.0.0/16"), "10.1.0.0/16");
+  trie.insert(toNetwork("10.2.0.0/16"), "10.2.0.0/16");
+
+  // branching node between the /16s has no value
+  EXPECT_FALSE(trie.erase(toNetwork("10.0.0.0/14")));
+  EXPECT_FALSE(trie.erase(toNetwork("10.1.0.0/24")));
+  EXPECT_EQ(3, trie.size());
+
+  EXPECT_TRUE(trie.erase(toNetwork("10.0.0.0/8")));
+  EXPECT_FALSE(trie.erase(toNetwork("10.0.0.0/8")));
+  EXPECT_EQ("", getMatch(trie, "10.3.0.1"));
+  EXPECT_EQ("10.1.0.0/16", getMatch(trie, "10.1.0.1"));
+
+  EXPECT_TRUE(trie.erase(toNetwork("10.1.0.0/16")));
+  EXPECT_EQ("", getMatch(trie, "10.1.0.1"));
+  EXPECT_EQ("10.2.0.0/16", getMatch(trie, "10.2.0.1"));
+
+  EXPECT_TRUE(trie.erase(toNetwork("10.2.0.0/16")));
+  EXPECT_TRUE(trie.empty());
+  EXPECT_EQ("", getMatch(trie, "10.2.0.1"));
+}
+
+// random prefixes inserted and erased, matches compared with a linear scan
+TEST(PrefixTrieTest, Random) {
+  std::mt19937 gen(1);
+  PrefixTrie<std::string> trie;
+  std::map<std::string, folly::CIDRNetwork> prefixes;
+
+  // few distinct leading bits, so that prefixes nest and branch a lot
+  auto getRandomNetwork = [&gen](bool isV4) {
+    const auto len = gen() % (isV4 ? 33 : 129);
+    if (isV4) {
+      const auto addr = folly::IPAddressV4::fromLongHBO(gen() & 0xf0f0ffff);
+      return folly::IPAddress::createNetwork(
+          folly::sformat("{}/{}", addr.str(), len), -1, true);
+    }
+    std::array<uint8_t, 16> bytes{};
+    bytes[0] = 0xfc | (gen() & 1);
+    for (size_t i = 1; i < bytes.size(); ++i) {
+      bytes[i] = gen() & (i < 4 ? 0x3 : 0xff);
+    }
+    return folly::IPAddress::createNetwork(
+        folly::sformat("{}/{}", folly::IPAddressV6(bytes).str(), len),
+        -1,
+        true);
+  };
+
+  for (int i = 0; i < 10000; ++i) {
+    const auto network = getRandomNetwork(gen() & 1);
+    const auto name = folly::IPAddress::networkToString(network);
+    if (gen() % 3 == 0) {
+      EXPECT_EQ(prefixes.erase(name) == 1, trie.erase(network));
+    } else {
+      EXPECT_EQ(
+          prefixes.emplace(name, network).second, trie.insert(network, name));
+    }
+    ASSERT_EQ(prefixes.size(), trie.size());
+
+    const auto query = getRandomNetwork(gen() & 1);
+    std::string expected;
+    int expectedLen = -1;
+    for (auto const& kv : prefixes) {
+      auto const& prefix = kv.second;
+      if (prefix.first.family() == query.first.family() and
+          prefix.second <= query.second and
+          prefix.second > expectedLen and
+          query.first.mask(prefix.second) == prefix.first) {
+        expected = kv.first;
+        expectedLen = prefix.second;
+      }
+    }
+    const auto* match = trie.longestMatch(query);
+    ASSERT_EQ(expected, match ? *match : "")
+        << folly::IPAddress::networkToString(query);
+  }
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/RouteStore.h>
+#include <openr/common/Util.h>
+
+using namespace openr;
+
+namespace {
+
+const auto prefix1 = toIpPrefix("10.1.0.0/16");
+const auto prefix2 = toIpPrefix("10.2.0.0/16");
+const auto nh1 = createNextHop(toBinaryAddress("fe80::1"), "iface1");
+const auto nh2 = createNextHop(toBinaryAddress("fe80::2"), "iface2");
+
+} // namespace
+
+TEST(RouteStoreTest, ShareUnicastRoutes) {
+  RouteStore store;
+  auto route1 = std::make_shared<const thrift::UnicastRoute>(
+      createUnicastRoute(prefix1, {nh1}));
+  auto route2 = std::make_shared<const thrift::UnicastRoute>(
+      createUnicastRoute(prefix2, {nh1, nh2}));
+  store.update({route1, route2}, {}, {}, {});
+  EXPECT_EQ(2, store.getNumUnicastRoutes());
+
+  // equal routes are the stored instance
+  EXPECT_EQ(route1, store.share(createUnicastRoute(prefix1, {nh1})));
+  EXPECT_EQ(route2, store.share(createUnicastRoute(prefix2, {nh1, nh2})));
+
+  // store ahead of the route, e.g. of an older delta
+  auto const older = createUnicastRoute(prefix1, {nh2});
+  auto shared = store.share(older);
+  EXPECT_NE(route1, shared);
+  EXPECT_EQ(older, *shared);
+
+  store.update({}, {prefix1}, {}, {});
+  EXPECT_EQ(1, store.getNumUnicastRoutes());
+  shared = store.share(createUnicastRoute(prefix1, {nh1}));
+  EXPECT_NE(route1, shared);
+  EXPECT_EQ(*route1, *shared);
+}
+
+TEST(RouteStoreTest, ShareMplsRoutes) {
+  RouteStore store;
+  auto route = std::make_shared<const thrift::MplsRoute>(
+      createMplsRoute(100, {nh1}));
+  store.update({}, {}, {route}, {});
+  EXPECT_EQ(1, store.getNumMplsRoutes());
+  EXPECT_EQ(route, store.share(createMplsRoute(100, {nh1})));
+  EXPECT_NE(route, store.share(createMplsRoute(100, {nh2})));
+
+  store.update({}, {}, {}, {100});
+  EXPECT_EQ(0, store.getNumMplsRoutes());
+  EXPECT_NE(route, store.share(createMplsRoute(100, {nh1})));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <thread>
+
+#include <folly/init/Init.h>
+#include <folly/synchronization/Baton.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/OpenrEventBase.h>
+#include <openr/common/SlowCallbackDetector.h>
+
+namespace openr {
+
+/**
+ * Handlers and fiber tasks running longer than the threshold get recorded
+ * with their kind and module, short ones don't
+ */
+TEST(SlowCallbackDetector, SlowCallbacks) {
+  OpenrEventBase evb;
+  std::thread evbThread([&evb]() { evb.run(); });
+  evb.waitUntilRunning();
+
+  SlowCallbackDetector detector("TestModule", std::chrono::milliseconds(20));
+  evb.getEvb()->runInEventBaseThreadAndWait([&]() {
+    evb.setExecutionObservers(
+        detector.getHandlerObserver(), detector.getFiberObserver());
+  });
+
+  // slow handler, fast handler
+  evb.getEvb()->runInEventBaseThreadAndWait(
+      []() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+  evb.getEvb()->runInEventBaseThreadAndWait([]() {});
+  EXPECT_LE(std::chrono::milliseconds(45), detector.getAndResetMax());
+
+  // slow fiber task
+  folly::Baton<> baton;
+  evb.getEvb()->runInEventBaseThread([&]() {
+    evb.addFiberTask([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      baton.post();
+    });
+  });
+  baton.wait();
+  evb.getEvb()->runInEventBaseThreadAndWait([&]() {
+    evb.setExecutionObservers(nullptr, nullptr);
+  });
+
+  auto const spans = SlowCallbackDetector::getSlowCallbacks().getSpans();
+  ASSERT_EQ(2, spans.size());
+  EXPECT_EQ("handler", spans[0].name);
+  EXPECT_EQ("fiber", spans[1].name);
+  for (auto const& span : spans) {
+    EXPECT_EQ("TestModule", span.detail);
+    EXPECT_LE(std::chrono::milliseconds(45), span.duration);
+  }
+
+  evb.stop();
+  evbThread.join();
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
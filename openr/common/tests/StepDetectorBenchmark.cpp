@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Random.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+
+#include <openr/common/StepDetector.h>
+
+namespace openr {
+
+namespace {
+
+// detector of Spark neighbors, as configured by Spark
+template <typename Window>
+using RttStepDetector =
+    StepDetector<int64_t, std::chrono::milliseconds, Window>;
+
+using TimeSeriesWindow =
+    TimeSeriesStepWindow<int64_t, std::chrono::milliseconds>;
+using EwmaWindow = EwmaStepWindow<int64_t, std::chrono::milliseconds>;
+
+const std::chrono::milliseconds kSamplePeriod{1000};
+
+template <typename Window>
+std::unique_ptr<RttStepDetector<Window>>
+createDetector() {
+  return std::make_unique<RttStepDetector<Window>>(
+      kSamplePeriod /* sampling period */,
+      10 /* fast window size */,
+      60 /* slow window size */,
+      2 /* lower threshold */,
+      5 /* upper threshold */,
+      500 /* absolute threshold */,
+      [](const int64_t&) {} /* callback function */);
+}
+
+template <typename Window>
+void
+createDetectors(uint32_t iters, size_t numDetectors) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<std::unique_ptr<RttStepDetector<Window>>> detectors;
+  detectors.reserve(numDetectors);
+
+  for (uint32_t i = 0; i < iters; i += numDetectors) {
+    suspender.dismiss(); // Start measuring benchmark time
+    for (size_t j = 0; j < numDetectors; ++j) {
+      detectors.emplace_back(createDetector<Window>());
+    }
+    detectors.clear();
+    suspender.rehire(); // Stop measuring time again
+  }
+}
+
+template <typename Window>
+void
+addValues(uint32_t iters, size_t numDetectors) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<std::unique_ptr<RttStepDetector<Window>>> detectors;
+  for (size_t i = 0; i < numDetectors; ++i) {
+    detectors.emplace_back(createDetector<Window>());
+  }
+  std::vector<int64_t> samples;
+  for (size_t i = 0; i < 1024; ++i) {
+    samples.emplace_back(1000 + folly::Random::rand32(100));
+  }
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; ++i) {
+    const auto now = kSamplePeriod * (1 + i / numDetectors);
+    detectors[i % numDetectors]->addValue(now, samples[i % samples.size()]);
+  }
+  suspender.rehire(); // Stop measuring time again
+}
+
+} // namespace
+
+/**
+ * Creation and destruction of the step detectors of `numDetectors`
+ * neighbors, with windows of time series or exponential averages. Time is
+ * reported per detector.
+ */
+static void
+BM_StepDetectorCreate(uint32_t iters, bool useEwma, size_t numDetectors) {
+  if (useEwma) {
+    createDetectors<EwmaWindow>(iters, numDetectors);
+  } else {
+    createDetectors<TimeSeriesWindow>(iters, numDetectors);
+  }
+}
+
+/**
+ * RTT samples of `numDetectors` neighbors, a sample period apart on each
+ * neighbor and about 1000us with noise. Time is reported per sample.
+ */
+static void
+BM_StepDetectorAddValue(uint32_t iters, bool useEwma, size_t numDetectors) {
+  if (useEwma) {
+    addValues<EwmaWindow>(iters, numDetectors);
+  } else {
+    addValues<TimeSeriesWindow>(iters, numDetectors);
+  }
+}
+
+// The parameters are exponential averages or not and number of neighbors
+BENCHMARK_NAMED_PARAM(BM_StepDetectorCreate, ts_1000, false, 1000);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_StepDetectorCreate, ewma_1000, true, 1000);
+BENCHMARK_NAMED_PARAM(BM_StepDetectorAddValue, ts_1, false, 1);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_StepDetectorAddValue, ewma_1, true, 1);
+BENCHMARK_NAMED_PARAM(BM_StepDetectorAddValue, ts_1000, false, 1000);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_StepDetectorAddValue, ewma_1000, true, 1000);
+BENCHMARK_NAMED_PARAM(BM_StepDetectorAddValue, ts_10000, false, 10000);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_StepDetectorAddValue, ewma_10000, true, 10000);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  // time series keep their buckets on the heap in addition
+  LOG(INFO) << "Detector size: time series "
+            << sizeof(openr::RttStepDetector<openr::TimeSeriesWindow>)
+            << " bytes, ewma "
+            << sizeof(openr::RttStepDetector<openr::EwmaWindow>) << " bytes";
+  folly::runBenchmarks();
+  return 0;
+}
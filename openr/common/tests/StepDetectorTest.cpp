@@ -27,16 +27,18 @@ genGaussianSamples(double mean, double stddev, size_t numOfSamples) {
   }
   return res;
 }
-} // namespace
+
+using TimeSeriesWindow =
+    openr::TimeSeriesStepWindow<double, std::chrono::seconds>;
+using EwmaWindow = openr::EwmaStepWindow<double, std::chrono::seconds>;
 
 // time series consists of large jumps
-TEST(StepDetectorTest, LargeStep) {
+template <typename Window>
+void
+testLargeStep(double delta) {
   uint32_t changeCount = 0;
   uint32_t timeStamp = 0;
   double expectedAvg = 0.0;
-  // sampled mean can still be more than delta away from population mean
-  // but the probability is so small we regard it would not happen in testing
-  double delta = 1.0;
 
   auto stepCb = [&](const double& avg) {
     ++changeCount;
@@ -45,7 +47,7 @@ TEST(StepDetectorTest, LargeStep) {
     EXPECT_LE(avg, expectedAvg + delta);
   };
 
-  openr::StepDetector<double, std::chrono::seconds> stepDetector(
+  openr::StepDetector<double, std::chrono::seconds, Window> stepDetector(
       std::chrono::seconds(1) /* sampling period */,
       10 /* small window size */,
       30 /* large window size */,
@@ -96,13 +98,12 @@ TEST(StepDetectorTest, LargeStep) {
 }
 
 // time series consists of gradual small changes
-TEST(StepDetectorTest, SlowBoiling) {
+template <typename Window>
+void
+testSlowBoiling(double delta) {
   uint32_t changeCount = 0;
   uint32_t timeStamp = 0;
   double expectedAvg = 0.0;
-  // sampled mean can still be more than delta away from population mean
-  // but the probability is so small we regard it would not happen in testing
-  double delta = 1.0;
 
   auto stepCb = [&](const double& avg) {
     ++changeCount;
@@ -111,7 +112,7 @@ TEST(StepDetectorTest, SlowBoiling) {
     EXPECT_LE(avg, expectedAvg + delta);
   };
 
-  openr::StepDetector<double, std::chrono::seconds> stepDetector(
+  openr::StepDetector<double, std::chrono::seconds, Window> stepDetector(
       std::chrono::seconds(1) /* sampling period */,
       10 /* small window size */,
       30 /* large window size */,
@@ -160,6 +161,50 @@ TEST(StepDetectorTest, SlowBoiling) {
     EXPECT_EQ(1, changeCount);
   }
 }
+} // namespace
+
+// sampled mean can still be more than delta away from population mean
+// but the probability is so small we regard it would not happen in testing.
+// Exponential averages trail steps a bit longer, hence are further away
+TEST(StepDetectorTest, LargeStep) {
+  testLargeStep<TimeSeriesWindow>(1.0);
+}
+
+TEST(StepDetectorTest, SlowBoiling) {
+  testSlowBoiling<TimeSeriesWindow>(1.0);
+}
+
+TEST(StepDetectorTest, EwmaLargeStep) {
+  testLargeStep<EwmaWindow>(1.5);
+}
+
+TEST(StepDetectorTest, EwmaSlowBoiling) {
+  testSlowBoiling<EwmaWindow>(2.0);
+}
+
+TEST(StepDetectorTest, EwmaWindow) {
+  EwmaWindow window(std::chrono::seconds(1), 10);
+  EXPECT_EQ(0, window.count());
+
+  // first sample initializes the average
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(100), 10));
+  EXPECT_EQ(10, window.avg());
+
+  // samples of the same period weigh like one a period apart
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(100), 20));
+  EXPECT_GT(window.avg(), 10);
+  EXPECT_LT(window.avg(), 15);
+  EXPECT_EQ(2, window.count());
+
+  // samples older than the window are rejected
+  EXPECT_FALSE(window.addValue(std::chrono::seconds(89), 1000));
+  EXPECT_LT(window.avg(), 15);
+  EXPECT_EQ(2, window.count());
+
+  // past samples are mostly forgotten after a gap of a few windows
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(200), 100));
+  EXPECT_NEAR(100, window.avg(), 0.01);
+}
 
 int
 main(int argc, char* argv[]) {
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <sched.h>
+
+#include <thread>
+
+#include <fb303/ServiceData.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/ThreadPlacement.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+TEST(ThreadPlacementTest, ParseCpuList) {
+  EXPECT_EQ(
+      std::vector<int>({0, 1, 2, 3, 6}),
+      ThreadPlacement::parseCpuList("0-3,6"));
+  EXPECT_EQ(std::vector<int>({1, 2}), ThreadPlacement::parseCpuList("2,1,2"));
+  EXPECT_TRUE(ThreadPlacement::parseCpuList("").empty());
+  EXPECT_THROW(ThreadPlacement::parseCpuList("3-1"), std::invalid_argument);
+  EXPECT_THROW(ThreadPlacement::parseCpuList("a"), std::invalid_argument);
+  EXPECT_THROW(ThreadPlacement::parseCpuList("-1"), std::invalid_argument);
+}
+
+TEST(ThreadPlacementTest, Parse) {
+  EXPECT_TRUE(ThreadPlacement::parse("").empty());
+
+  auto placements = ThreadPlacement::parse(
+      "Spark:cpus=0-1:fifo=10;Decision:cpus=2-7,9:nice=5;Fib:numa=0;");
+  ASSERT_EQ(3, placements.size());
+
+  auto const& spark = placements.at("Spark");
+  EXPECT_EQ(std::vector<int>({0, 1}), spark.cpus);
+  EXPECT_EQ(10, spark.fifoPriority);
+  EXPECT_FALSE(spark.nice.has_value());
+  EXPECT_FALSE(spark.numaNode.has_value());
+
+  auto const& decision = placements.at("Decision");
+  EXPECT_EQ(std::vector<int>({2, 3, 4, 5, 6, 7, 9}), decision.cpus);
+  EXPECT_EQ(5, decision.nice);
+  EXPECT_FALSE(decision.fifoPriority.has_value());
+
+  auto const& fib = placements.at("Fib");
+  EXPECT_TRUE(fib.cpus.empty());
+  EXPECT_EQ(0, fib.numaNode);
+
+  // malformed specs
+  EXPECT_THROW(ThreadPlacement::parse("Spark"), std::invalid_argument);
+  EXPECT_THROW(ThreadPlacement::parse(":cpus=0"), std::invalid_argument);
+  EXPECT_THROW(ThreadPlacement::parse("Spark:cpus"), std::invalid_argument);
+  EXPECT_THROW(ThreadPlacement::parse("Spark:foo=1"), std::invalid_argument);
+  EXPECT_THROW(
+      ThreadPlacement::parse("Spark:fifo=1:nice=1"), std::invalid_argument);
+}
+
+TEST(ThreadPlacementTest, ApplyAffinity) {
+  // pin to a CPU the test may run on
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpuSet), &cpuSet));
+  int cpu{0};
+  while (not CPU_ISSET(cpu, &cpuSet)) {
+    ++cpu;
+  }
+
+  ThreadPlacement placement;
+  placement.cpus = {cpu};
+  std::thread thread([&]() {
+    EXPECT_TRUE(placement.apply("Test"));
+    EXPECT_EQ(cpu, sched_getcpu());
+  });
+  thread.join();
+
+  EXPECT_EQ(1, fb303::fbData->getCounter("thread_placement.Test.cpus"));
+  EXPECT_EQ(-1, fb303::fbData->getCounter("thread_placement.Test.numa_node"));
+  EXPECT_EQ(0, fb303::fbData->getCounter("thread_placement.Test.sched_fifo"));
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
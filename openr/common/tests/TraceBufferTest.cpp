@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/TraceBuffer.h>
+
+using namespace openr;
+
+namespace {
+
+const auto kStart = TraceBuffer::Clock::time_point(std::chrono::seconds(100));
+
+} // namespace
+
+TEST(TraceBufferTest, RecordSpans) {
+  TraceBuffer buffer(6);
+  EXPECT_EQ(8, buffer.getCapacity());
+  EXPECT_TRUE(buffer.getSpans().empty());
+
+  buffer.record("spf", "node-1", kStart, kStart + std::chrono::microseconds(5));
+  buffer.record("ksp2", "", kStart, kStart, 42);
+
+  auto const spans = buffer.getSpans();
+  ASSERT_EQ(2, spans.size());
+  EXPECT_EQ(0, spans[0].seqNum);
+  EXPECT_EQ("spf", spans[0].name);
+  EXPECT_EQ("node-1", spans[0].detail);
+  EXPECT_EQ(kStart, spans[0].start);
+  EXPECT_EQ(std::chrono::microseconds(5), spans[0].duration);
+  EXPECT_EQ(0, spans[0].arg);
+  EXPECT_EQ(1, spans[1].seqNum);
+  EXPECT_EQ("ksp2", spans[1].name);
+  EXPECT_EQ("", spans[1].detail);
+  EXPECT_EQ(42, spans[1].arg);
+  EXPECT_EQ(spans[0].threadId, spans[1].threadId);
+  EXPECT_EQ(0, buffer.getDroppedCount());
+}
+
+TEST(TraceBufferTest, TruncateDetail) {
+  TraceBuffer buffer(1);
+  const std::string detail(TraceBuffer::kMaxDetailSize + 10, 'x');
+  buffer.record("spf", detail, kStart, kStart);
+  auto const spans = buffer.getSpans();
+  ASSERT_EQ(1, spans.size());
+  EXPECT_EQ(detail.substr(0, TraceBuffer::kMaxDetailSize), spans[0].detail);
+}
+
+TEST(TraceBufferTest, OverwriteOldest) {
+  TraceBuffer buffer(4);
+  for (int64_t i = 0; i < 10; ++i) {
+    buffer.record("span", "", kStart, kStart, i);
+  }
+  auto const spans = buffer.getSpans();
+  ASSERT_EQ(4, spans.size());
+  for (size_t i = 0; i < spans.size(); ++i) {
+    EXPECT_EQ(6 + i, spans[i].seqNum);
+    EXPECT_EQ(6 + i, spans[i].arg);
+  }
+  EXPECT_EQ(6, buffer.getDroppedCount());
+}
+
+TEST(TraceBufferTest, TraceScope) {
+  TraceBuffer buffer(4);
+  {
+    TraceScope scope(&buffer, "scope", "detail");
+    scope.setArg(7);
+  }
+  {
+    // no buffer, nothing to record to
+    TraceScope scope(nullptr, "ignored");
+  }
+  auto const spans = buffer.getSpans();
+  ASSERT_EQ(1, spans.size());
+  EXPECT_EQ("scope", spans[0].name);
+  EXPECT_EQ("detail", spans[0].detail);
+  EXPECT_EQ(7, spans[0].arg);
+  EXPECT_LE(std::chrono::nanoseconds(0), spans[0].duration);
+}
+
+// spans read while other threads write are never torn
+TEST(TraceBufferTest, ConcurrentWriters) {
+  TraceBuffer buffer(64);
+  const int kThreads = 4;
+  const int64_t kSpans = 20000;
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kThreads; ++t) {
+    writers.emplace_back([&buffer, t, kSpans]() {
+      const std::string detail = "writer-" + std::to_string(t);
+      for (int64_t i = 0; i < kSpans; ++i) {
+        buffer.record(
+            "span", detail, kStart, kStart + std::chrono::nanoseconds(t), t);
+      }
+    });
+  }
+  for (int i = 0; i < 100; ++i) {
+    for (auto const& span : buffer.getSpans()) {
+      EXPECT_EQ("span", span.name);
+      EXPECT_EQ("writer-" + std::to_string(span.arg), span.detail);
+      EXPECT_EQ(std::chrono::nanoseconds(span.arg), span.duration);
+    }
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  EXPECT_EQ(64, buffer.getSpans().size());
+  EXPECT_EQ(kThreads * kSpans - 64, buffer.getDroppedCount());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -125,6 +125,95 @@ TEST(UtilTest, NetworkUtilTest) {
   EXPECT_EQ("", toString(empty));
 }
 
+TEST(UtilTest, IpPrefixKeyTest) {
+  const std::vector<std::string> prefixes{
+      "0.0.0.0/0",
+      "10.0.0.0/8",
+      "10.0.0.0/24",
+      "10.0.0.1/32",
+      "::/0",
+      "::ffff:10.0.0.0/104",
+      "fc00::/64",
+      "fc00::1/128"};
+  std::set<thrift::IpPrefix> thriftPrefixes;
+  std::set<IpPrefixKey> keys;
+  std::unordered_set<IpPrefixKey> hashedKeys;
+  for (auto const& prefixStr : prefixes) {
+    const auto prefix = toIpPrefix(prefixStr);
+    const IpPrefixKey key(prefix);
+    EXPECT_EQ(prefix, key.toThrift());
+    EXPECT_EQ(toString(prefix), toString(key));
+    EXPECT_EQ(toIPAddress(prefix.prefixAddress), key.toIPAddress());
+    EXPECT_EQ(prefix.prefixLength, key.prefixLength());
+    EXPECT_EQ(
+        prefix.prefixAddress.addr.size() == folly::IPAddressV4::byteCount(),
+        key.isV4());
+    thriftPrefixes.emplace(prefix);
+    keys.emplace(key);
+    hashedKeys.emplace(key);
+  }
+  EXPECT_EQ(prefixes.size(), hashedKeys.size());
+
+  // keys order like thrift prefixes
+  std::vector<thrift::IpPrefix> keyPrefixes;
+  for (auto const& key : keys) {
+    keyPrefixes.emplace_back(key.toThrift());
+  }
+  EXPECT_EQ(
+      std::vector<thrift::IpPrefix>(
+          thriftPrefixes.begin(), thriftPrefixes.end()),
+      keyPrefixes);
+
+  // host bits are kept
+  const auto unmasked = toIpPrefix("10.0.0.1/8");
+  EXPECT_NE(IpPrefixKey(toIpPrefix("10.0.0.0/8")), IpPrefixKey(unmasked));
+  EXPECT_EQ(unmasked, IpPrefixKey(unmasked).toThrift());
+
+  // interface names are not part of the key
+  auto withIfName = toIpPrefix("fc00::/64");
+  withIfName.prefixAddress.ifName = "eth0";
+  EXPECT_EQ(IpPrefixKey(toIpPrefix("fc00::/64")), IpPrefixKey(withIfName));
+
+  // invalid address sizes and prefix lengths
+  thrift::IpPrefix invalid;
+  EXPECT_THROW(IpPrefixKey{invalid}, std::invalid_argument);
+  invalid = toIpPrefix("10.0.0.0/8");
+  invalid.prefixLength = 33;
+  EXPECT_THROW(IpPrefixKey{invalid}, std::invalid_argument);
+  invalid = toIpPrefix("fc00::/64");
+  invalid.prefixLength = -1;
+  EXPECT_THROW(IpPrefixKey{invalid}, std::invalid_argument);
+}
+
+TEST(UtilTest, IPNetworkTest) {
+  for (auto const& prefixStr :
+       {"0.0.0.0/0", "10.1.2.3/8", "10.1.2.3/32", "::/0", "fc00::1/64"}) {
+    const auto network = folly::IPAddress::createNetwork(prefixStr);
+    const auto unmasked = folly::IPAddress::createNetwork(prefixStr, -1, false);
+    const auto prefix = toIpPrefix(unmasked);
+    EXPECT_EQ(network, toIPNetwork(prefix));
+    EXPECT_EQ(unmasked, toIPNetwork(prefix, false));
+    EXPECT_EQ(network, tryToIPNetwork(prefix));
+    EXPECT_EQ(unmasked.first, tryToIPAddress(prefix.prefixAddress));
+    EXPECT_EQ(prefixStr, toString(prefix));
+  }
+
+  // malformed addresses and prefix lengths give no result, or throw
+  thrift::IpPrefix invalid;
+  EXPECT_EQ(std::nullopt, tryToIPAddress(invalid.prefixAddress));
+  EXPECT_EQ(std::nullopt, tryToIPNetwork(invalid));
+  EXPECT_THROW(toIPNetwork(invalid), folly::IPAddressFormatException);
+  invalid = toIpPrefix("10.0.0.0/8");
+  invalid.prefixLength = 33;
+  EXPECT_EQ(std::nullopt, tryToIPNetwork(invalid));
+  EXPECT_THROW(toIPNetwork(invalid), folly::IPAddressFormatException);
+  invalid = toIpPrefix("fc00::/64");
+  invalid.prefixLength = -1;
+  EXPECT_EQ(std::nullopt, tryToIPNetwork(invalid));
+  invalid.prefixAddress.addr.resize(5);
+  EXPECT_EQ(std::nullopt, tryToIPAddress(invalid.prefixAddress));
+}
+
 TEST(UtilTest, PrefixKeyTest) {
   std::vector<PrefixKeyEntry> strToItems;
 
@@ -283,6 +372,24 @@ TEST(UtilTest, GetNodeNameFromKeyTest) {
   }
 }
 
+TEST(UtilTest, PerAdjacencyKey) {
+  const auto key = createPerAdjacencyKey("adj:", "node1", "eth0", "node2");
+  EXPECT_EQ("adj:node1:eth0:node2", key);
+  EXPECT_TRUE(isPerAdjacencyKey(key));
+  EXPECT_EQ("node1", getNodeNameFromKey(key));
+  EXPECT_FALSE(isPerAdjacencyKey("adj:node1"));
+}
+
+TEST(UtilTest, PrefixBucketKey) {
+  const auto key = createPrefixBucketKey("prefix:", "node1", 7);
+  EXPECT_EQ("prefix:node1:bucket:7", key);
+  EXPECT_TRUE(isPrefixBucketKey(key));
+  EXPECT_EQ("node1", getNodeNameFromKey(key));
+  EXPECT_FALSE(PrefixKey::fromStr(key).hasValue());
+  EXPECT_FALSE(isPrefixBucketKey("prefix:node1"));
+  EXPECT_FALSE(isPrefixBucketKey("prefix:node1:0:[10.0.0.0/8]"));
+}
+
 // test getNthPrefix()
 TEST(UtilTest, getNthPrefix) {
   // v6 allocation parameters
@@ -590,6 +697,32 @@ TEST(UtilTest, getDurationBetweenPerfEventsTest) {
   }
 }
 
+TEST(UtilTest, getPerfEventsStageDurationsTest) {
+  {
+    thrift::PerfEvents perfEvents;
+    EXPECT_TRUE(getPerfEventsStageDurations(perfEvents).empty());
+  }
+
+  {
+    thrift::PerfEvents perfEvents;
+    perfEvents.events.emplace_back(
+        apache::thrift::FRAGILE, "node1", "LINK_UP", 100);
+    perfEvents.events.emplace_back(
+        apache::thrift::FRAGILE, "node1", "DECISION_RECVD", 200);
+    // clock of node2 is behind
+    perfEvents.events.emplace_back(
+        apache::thrift::FRAGILE, "node2", "KVSTORE_RECVD", 150);
+    perfEvents.events.emplace_back(
+        apache::thrift::FRAGILE, "node2", "SPF_CALCULATE", 450);
+    const auto stages = getPerfEventsStageDurations(perfEvents);
+    ASSERT_EQ(2, stages.size());
+    EXPECT_EQ("LINK_UP.DECISION_RECVD", stages.at(0).first);
+    EXPECT_EQ(100, stages.at(0).second.count());
+    EXPECT_EQ("KVSTORE_RECVD.SPF_CALCULATE", stages.at(1).first);
+    EXPECT_EQ(300, stages.at(1).second.count());
+  }
+}
+
 TEST(UtilTest, getBestNextHopsUnicast) {
   auto bestNextHops = getBestNextHopsUnicast({path1_2_1, path1_2_2});
   EXPECT_EQ(bestNextHops.size(), 1);
@@ -715,6 +848,47 @@ TEST(UtilTest, findDeltaRoutes) {
   EXPECT_EQ(res3.mplsRoutesToDelete.at(0), 2);
 }
 
+/**
+ * Unchanged routes are skipped whatever the order of the routes, changed ones
+ * are reported in order of the new route database
+ */
+TEST(UtilTest, findDeltaRoutesUnsorted) {
+  thrift::RouteDatabase oldRouteDb;
+  oldRouteDb.thisNodeName = "node-1";
+  oldRouteDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix3, {path1_3_1}));
+  oldRouteDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix2, {path1_2_1}));
+  oldRouteDb.mplsRoutes.emplace_back(createMplsRoute(3, {path1_3_1_swap}));
+  oldRouteDb.mplsRoutes.emplace_back(createMplsRoute(2, {path1_2_1_swap}));
+
+  thrift::RouteDatabase newRouteDb;
+  newRouteDb.thisNodeName = "node-1";
+  newRouteDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix2, {path1_2_1}));
+  newRouteDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix1, {path1_2_2}));
+  newRouteDb.mplsRoutes.emplace_back(
+      createMplsRoute(2, {path1_2_1_swap, path1_2_2_swap}));
+  newRouteDb.mplsRoutes.emplace_back(createMplsRoute(1, {path1_2_2_swap}));
+
+  const auto res = findDeltaRoutes(newRouteDb, oldRouteDb);
+  EXPECT_EQ(
+      std::vector<thrift::UnicastRoute>({newRouteDb.unicastRoutes.at(1)}),
+      res.unicastRoutesToUpdate);
+  EXPECT_EQ(
+      std::vector<thrift::IpPrefix>({prefix3}), res.unicastRoutesToDelete);
+  EXPECT_EQ(newRouteDb.mplsRoutes, res.mplsRoutesToUpdate);
+  EXPECT_EQ(std::vector<int32_t>({3}), res.mplsRoutesToDelete);
+
+  // nothing changed
+  const auto res2 = findDeltaRoutes(newRouteDb, newRouteDb);
+  EXPECT_TRUE(res2.unicastRoutesToUpdate.empty());
+  EXPECT_TRUE(res2.unicastRoutesToDelete.empty());
+  EXPECT_TRUE(res2.mplsRoutesToUpdate.empty());
+  EXPECT_TRUE(res2.mplsRoutesToDelete.empty());
+}
+
 TEST(UtilTest, MplsLabelValidate) {
   EXPECT_TRUE(isMplsLabelValid(0));
   EXPECT_TRUE(isMplsLabelValid(1132));
@@ -966,6 +1140,75 @@ TEST(MetricVectorUtilsTest, compareMetricVectors) {
   EXPECT_EQ(CompareResult::TIE_LOOSER, compareMetricVectors(r, l));
 }
 
+TEST(MetricVectorUtilsTest, normalizeMetricVector) {
+  thrift::MetricVector mv;
+  mv.version = 2;
+  mv.metrics = {
+      createMetricEntity(
+          1, 10, thrift::CompareType::WIN_IF_PRESENT, false, {1, 2}),
+      createMetricEntity(
+          2, 30, thrift::CompareType::WIN_IF_NOT_PRESENT, true, {3}),
+      createMetricEntity(
+          3, 20, thrift::CompareType::IGNORE_IF_NOT_PRESENT, false, {})};
+
+  auto normalized = normalizeMetricVector(mv);
+  EXPECT_EQ(2, normalized.version);
+  ASSERT_EQ(3, normalized.entities.size());
+  EXPECT_EQ(2, normalized.entities[0].type);
+  EXPECT_EQ(3, normalized.entities[1].type);
+  EXPECT_EQ(1, normalized.entities[2].type);
+  EXPECT_TRUE(normalized.entities[0].isBestPathTieBreaker);
+  EXPECT_EQ(
+      thrift::CompareType::WIN_IF_NOT_PRESENT, normalized.entities[0].op);
+  auto const& entity = normalized.entities[2];
+  EXPECT_EQ(
+      (std::vector<int64_t>{1, 2}),
+      std::vector<int64_t>(
+          normalized.metrics.begin() + entity.metricBegin,
+          normalized.metrics.begin() + entity.metricEnd));
+
+  // added entity goes to its priority
+  addMetricEntity(
+      normalized,
+      createMetricEntity(
+          4, 25, thrift::CompareType::WIN_IF_PRESENT, false, {4}));
+  ASSERT_EQ(4, normalized.entities.size());
+  EXPECT_EQ(4, normalized.entities[1].type);
+}
+
+TEST(MetricVectorUtilsTest, compareNormalizedMetricVectors) {
+  // normalized comparisons must agree with comparing the metric vectors
+  auto randomMetricVector = []() {
+    thrift::MetricVector mv;
+    // distinct priorities, listed out of order
+    for (int64_t type = 0; type < 4; ++type) {
+      if (folly::Random::oneIn(3)) {
+        continue;
+      }
+      mv.metrics.emplace_back(createMetricEntity(
+          type,
+          (type * 7) % 4,
+          static_cast<thrift::CompareType>(folly::Random::rand32(3)),
+          folly::Random::oneIn(4),
+          {folly::Random::rand32(3), folly::Random::rand32(2)}));
+    }
+    return mv;
+  };
+
+  for (int i = 0; i < 1000; ++i) {
+    auto l = randomMetricVector();
+    auto r = randomMetricVector();
+    auto const normalizedL = normalizeMetricVector(l);
+    auto const normalizedR = normalizeMetricVector(r);
+    EXPECT_EQ(
+        compareMetricVectors(l, r),
+        compareMetricVectors(normalizedL, normalizedR));
+    EXPECT_EQ(
+        compareMetricVectors(r, l),
+        compareMetricVectors(normalizedR, normalizedL));
+  }
+}
+
 TEST(UtilTest, FunctionExecutionTime) {
   LOG_FN_EXECUTION_TIME;
 }
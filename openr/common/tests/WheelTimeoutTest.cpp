@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <folly/io/async/EventBase.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/WheelTimeout.h>
+
+using namespace openr;
+
+namespace {
+
+const std::chrono::milliseconds kTick{10};
+
+} // namespace
+
+TEST(WheelTimeoutTest, ScheduleAndCancel) {
+  folly::EventBase evb;
+  auto wheel = folly::HHWheelTimer::newTimer(&evb, kTick);
+
+  int count1{0};
+  int count2{0};
+  auto timeout1 = WheelTimeout::make(wheel.get(), [&]() noexcept {
+    ++count1;
+    evb.terminateLoopSoon();
+  });
+  auto timeout2 = WheelTimeout::make(wheel.get(), [&]() noexcept { ++count2; });
+  EXPECT_FALSE(timeout1->isScheduled());
+
+  // rescheduling pushes expiry out, cancelled timeouts never fire
+  timeout1->scheduleTimeout(std::chrono::milliseconds(10));
+  timeout1->scheduleTimeout(std::chrono::milliseconds(50));
+  timeout2->scheduleTimeout(std::chrono::milliseconds(20));
+  EXPECT_TRUE(timeout1->isScheduled());
+  timeout2->cancelTimeout();
+  EXPECT_FALSE(timeout2->isScheduled());
+
+  const auto start = std::chrono::steady_clock::now();
+  evb.loopForever();
+  EXPECT_LE(
+      std::chrono::milliseconds(50), std::chrono::steady_clock::now() - start);
+  EXPECT_EQ(1, count1);
+  EXPECT_EQ(0, count2);
+  EXPECT_FALSE(timeout1->isScheduled());
+}
+
+TEST(WheelTimeoutTest, Periodic) {
+  folly::EventBase evb;
+  auto wheel = folly::HHWheelTimer::newTimer(&evb, kTick);
+
+  int count{0};
+  std::unique_ptr<WheelTimeout> timeout;
+  timeout = WheelTimeout::make(wheel.get(), [&]() noexcept {
+    if (++count == 3) {
+      timeout->cancelTimeout();
+      evb.terminateLoopSoon();
+    }
+  });
+  timeout->scheduleTimeout(std::chrono::milliseconds(10), true /* periodic */);
+
+  evb.loopForever();
+  EXPECT_EQ(3, count);
+  EXPECT_FALSE(timeout->isScheduled());
+
+  // scheduled once, a previous period is forgotten
+  count = 0;
+  timeout->scheduleTimeout(std::chrono::milliseconds(10));
+  evb.loop();
+  EXPECT_EQ(1, count);
+  EXPECT_FALSE(timeout->isScheduled());
+}
+
+// timeouts may get destroyed from any callback of the same tick
+TEST(WheelTimeoutTest, DestroyOnExpiry) {
+  folly::EventBase evb;
+  auto wheel = folly::HHWheelTimer::newTimer(&evb, kTick);
+
+  int count{0};
+  std::vector<std::unique_ptr<WheelTimeout>> timeouts;
+  for (int i = 0; i < 10; ++i) {
+    timeouts.emplace_back(WheelTimeout::make(wheel.get(), [&]() noexcept {
+      ++count;
+      timeouts.clear();
+    }));
+    timeouts.back()->scheduleTimeout(std::chrono::milliseconds(10));
+  }
+
+  evb.loop();
+  EXPECT_EQ(1, count);
+  EXPECT_EQ(0, wheel->count());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -8,17 +8,28 @@
 #include "PersistentStore.h"
 
 #include <chrono>
+#include <cstdio>
+#include <stdexcept>
 
+#include <fb303/ServiceData.h>
 #include <folly/FileUtil.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/io/IOBuf.h>
+#include <folly/system/MemoryMapping.h>
 
 #include <openr/common/Util.h>
 
+namespace fb303 = facebook::fb303;
+
 using std::exception;
 
 namespace {
 
-static const long kDbFlushRatio = 10000;
+// The log on disk is compacted once it is this many times the size of the
+// database encoded as checkpoint ...
+static const uint64_t kCompactionRatio = 4;
+// ... and at least this large
+static const uint64_t kCompactionMinBytes = 1 << 20;
 
 } // anonymous namespace
 
@@ -29,8 +40,19 @@ PersistentStore::PersistentStore(
     const std::string& storageFilePath,
     fbzmq::Context& context,
     bool dryrun,
-    bool periodicallySaveToDisk)
-    : storageFilePath_(storageFilePath), dryrun_(dryrun) {
+    bool periodicallySaveToDisk,
+    bool fsyncOnCommit)
+    : storageFilePath_(storageFilePath),
+      compactionFilePath_(storageFilePath + ".compaction"),
+      dryrun_(dryrun),
+      fsyncOnCommit_(fsyncOnCommit) {
+  if (not dryrun_) {
+    compactionExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        1,
+        std::make_shared<folly::NamedThreadFactory>(
+            "PersistentStoreCompaction"));
+  }
+
   if (periodicallySaveToDisk) {
     // Create timer and backoff mechanism only if backoff is requested
     saveDbTimerBackoff_ =
@@ -59,7 +81,12 @@ PersistentStore::PersistentStore(
 }
 
 PersistentStore::~PersistentStore() {
-  saveDatabaseToDisk();
+  maybeFinishCompaction(true /* wait */);
+  const bool saved = saveDatabaseToDisk();
+  // complete requests not committed yet, their objects are in the database
+  for (auto& callback : commitCallbacks_) {
+    callback(saved);
+  }
 }
 
 folly::SemiFuture<folly::Unit>
@@ -75,11 +102,22 @@ PersistentStore::store(std::string key, std::string value) {
     SYSLOG(INFO) << "Store key: " << key << ", value: " << value
                  << " to config-store";
     // Override previous value if any
+    auto it = database_.keyVals.find(key);
+    if (it != database_.keyVals.end()) {
+      liveBytes_ -= getEncodedSize(key, it->second);
+    }
+    liveBytes_ += getEncodedSize(key, value);
     database_.keyVals[key] = value;
     auto pObject = toPersistentObject(ActionType::ADD, key, value);
     pObjects_.emplace_back(std::move(pObject));
+    commitCallbacks_.emplace_back([p = std::move(p)](bool committed) mutable {
+      if (committed) {
+        p.setValue();
+      } else {
+        p.setException(std::runtime_error("Failed to commit to disk"));
+      }
+    });
     maybeSaveObjectToDisk();
-    p.setValue();
   });
   return sf;
 }
@@ -91,11 +129,22 @@ PersistentStore::erase(std::string key) {
   runInEventBaseThread(
       [this, p = std::move(p), key = std::move(key)]() mutable noexcept {
         SYSLOG(INFO) << "Erase key: " << key << " from config-store";
-        if (database_.keyVals.erase(key) > 0) {
+        auto it = database_.keyVals.find(key);
+        if (it != database_.keyVals.end()) {
+          liveBytes_ -= getEncodedSize(key, it->second);
+          database_.keyVals.erase(it);
           auto pObject = toPersistentObject(ActionType::DEL, key, "");
           pObjects_.emplace_back(std::move(pObject));
+          commitCallbacks_.emplace_back(
+              [p = std::move(p)](bool committed) mutable {
+                if (committed) {
+                  p.setValue(true);
+                } else {
+                  p.setException(
+                      std::runtime_error("Failed to commit to disk"));
+                }
+              });
           maybeSaveObjectToDisk();
-          p.setValue(true);
         } else {
           LOG(WARNING) << "Key: " << key << " doesn't exist";
           p.setValue(false);
@@ -127,102 +176,210 @@ PersistentStore::maybeSaveObjectToDisk() noexcept {
     // Block the response till file is saved
     savePersistentObjectToDisk();
   } else if (not saveDbTimer_->isScheduled()) {
-    saveDbTimer_->scheduleTimeout(
-        saveDbTimerBackoff_->getTimeRemainingUntilRetry());
+    // gather writes within the commit window into one
+    saveDbTimer_->scheduleTimeout(std::max(
+        Constants::kPersistentStoreCommitWindow,
+        saveDbTimerBackoff_->getTimeRemainingUntilRetry()));
   }
 }
 
 bool
 PersistentStore::savePersistentObjectToDisk() noexcept {
+  if (pObjects_.empty()) {
+    return true;
+  }
+
+  bool committed{true};
   if (not dryrun_) {
-    // Write PersistentObject to ioBuf
-    std::vector<PersistentObject> newObjects;
-    newObjects = std::move(pObjects_);
-
-    auto queue = folly::IOBufQueue(folly::IOBufQueue::cacheChainLength());
-
-    for (auto& pObject : newObjects) {
-      auto buf = encodePersistentObject(pObject);
-      if (buf.hasError()) {
-        LOG(ERROR) << "Failed to encode PersistentObject to ioBuf. Error: "
-                   << folly::exceptionStr(buf.error());
-        return false;
-      }
-      queue.append(std::move(**buf));
-    }
+    committed = appendObjectsToDisk(pObjects_);
+  } else {
+    VLOG(1) << "Skipping writing to disk in dryrun mode";
+  }
+  if (not committed and saveDbTimerBackoff_) {
+    // keep objects and requests for the retry
+    return false;
+  }
 
-    // Append IoBuf to disk
-    auto ioBuf = queue.move();
-    auto success = writeIoBufToDisk(ioBuf, WriteType::APPEND);
-    if (success.hasError()) {
-      LOG(ERROR) << "Failed to write PersistentObject to file '"
-                 << storageFilePath_
-                 << "'. Error: " << folly::exceptionStr(success.error());
+  fb303::fbData->addStatValue(
+      "config_store.commit_batch_size", pObjects_.size(), fb303::AVG);
+  pObjects_.clear();
+  auto callbacks = std::move(commitCallbacks_);
+  commitCallbacks_.clear();
+  for (auto& callback : callbacks) {
+    callback(committed);
+  }
+  if (committed) {
+    numOfWritesToDisk_++;
+  }
+  return committed;
+}
+
+bool
+PersistentStore::appendObjectsToDisk(
+    const std::vector<PersistentObject>& pObjects) noexcept {
+  // Write PersistentObject to ioBuf
+  auto queue = folly::IOBufQueue(folly::IOBufQueue::cacheChainLength());
+  for (auto& pObject : pObjects) {
+    auto buf = encodePersistentObject(pObject);
+    if (buf.hasError()) {
+      LOG(ERROR) << "Failed to encode PersistentObject to ioBuf. Error: "
+                 << folly::exceptionStr(buf.error());
       return false;
     }
+    queue.append(std::move(**buf));
+  }
 
-    numOfNewWritesToDisk_++;
+  // Switch to the checkpoint of compaction if it is done by now, so that
+  // objects are appended to it
+  maybeFinishCompaction(false /* wait */);
 
-    // Write the whole database to disk periodically
-    if (numOfNewWritesToDisk_ >= kDbFlushRatio) {
-      numOfNewWritesToDisk_ = 0;
-      const auto startTs = std::chrono::steady_clock::now();
-      if (not saveDatabaseToDisk()) {
-        return false;
-      }
-      LOG(INFO) << "Updated database on disk. Took "
-                << std::chrono::duration_cast<std::chrono::milliseconds>(
-                       std::chrono::steady_clock::now() - startTs)
-                       .count()
-                << "ms";
-    }
-  } else {
-    VLOG(1) << "Skipping writing to disk in dryrun mode";
+  // Append IoBuf to disk
+  auto ioBuf = queue.move();
+  const auto numBytes = ioBuf->computeChainDataLength();
+  auto tail = compaction_.has_value() ? ioBuf->clone() : nullptr;
+  auto success = writeIoBufToDisk(ioBuf, WriteType::APPEND);
+  if (success.hasError()) {
+    LOG(ERROR) << "Failed to write PersistentObject to file '"
+               << storageFilePath_
+               << "'. Error: " << folly::exceptionStr(success.error());
+    return false;
   }
-  numOfWritesToDisk_++;
+  logBytes_ += numBytes;
+  numOfBytesWrittenToDisk_ += numBytes;
 
+  // Objects need to make it to the checkpoint of compaction in progress
+  if (tail) {
+    compactionTail_.append(std::move(tail));
+  } else {
+    maybeStartCompaction();
+  }
   return true;
 }
 
+void
+PersistentStore::maybeStartCompaction() noexcept {
+  if (not compactionExecutor_ or compaction_.has_value() or
+      logBytes_ < kCompactionMinBytes or
+      logBytes_ < kCompactionRatio * liveBytes_) {
+    return;
+  }
+
+  VLOG(1) << "Compacting log of " << logBytes_ << " bytes, database is "
+          << liveBytes_ << " bytes";
+  compaction_ = folly::via(
+      compactionExecutor_.get(),
+      [database = database_, filePath = compactionFilePath_]()
+          -> folly::Expected<uint64_t, std::string> {
+        auto ioBuf = encodeDatabase(database);
+        if (ioBuf.hasError()) {
+          return folly::makeUnexpected(ioBuf.error());
+        }
+        const auto numBytes = (*ioBuf)->computeChainDataLength();
+        auto success = writeIoBufToFile(
+            filePath, *ioBuf, WriteType::WRITE, false /* synced anyway */);
+        if (success.hasError()) {
+          return folly::makeUnexpected(success.error());
+        }
+        return numBytes;
+      });
+}
+
+void
+PersistentStore::maybeFinishCompaction(bool wait) noexcept {
+  if (not compaction_.has_value() or
+      (not wait and not compaction_->isReady())) {
+    return;
+  }
+
+  compaction_->wait();
+  auto result = std::move(compaction_->result());
+  compaction_.reset();
+  auto tail = compactionTail_.move();
+  if (result.hasException() or result->hasError()) {
+    LOG(ERROR) << "Failed to compact file '" << storageFilePath_ << "'. Error: "
+               << (result.hasException()
+                       ? result.exception().what().toStdString()
+                       : result->error());
+    return;
+  }
+
+  uint64_t numBytes = result->value();
+  if (tail) {
+    numBytes += tail->computeChainDataLength();
+    auto success = writeIoBufToFile(
+        compactionFilePath_, tail, WriteType::APPEND, fsyncOnCommit_);
+    if (success.hasError()) {
+      LOG(ERROR) << "Failed to write PersistentObject to file '"
+                 << compactionFilePath_
+                 << "'. Error: " << folly::exceptionStr(success.error());
+      return;
+    }
+  }
+  if (::rename(compactionFilePath_.c_str(), storageFilePath_.c_str()) != 0) {
+    LOG(ERROR) << "Failed to rename '" << compactionFilePath_ << "' to '"
+               << storageFilePath_ << "'. Error (" << errno
+               << "): " << folly::errnoStr(errno);
+    return;
+  }
+
+  LOG(INFO) << "Compacted log of " << logBytes_ << " bytes to " << numBytes
+            << " bytes";
+  logBytes_ = numBytes;
+  numOfBytesWrittenToDisk_ += numBytes;
+  numOfCompactions_++;
+}
+
 bool
 PersistentStore::saveDatabaseToDisk() noexcept {
-  std::unique_ptr<folly::IOBuf> ioBuf;
-  // If database is empty, write 'kTlvFormatMarker' to disk and return
-  if (database_.keyVals.size() == 0) {
-    ioBuf = folly::IOBuf::copyBuffer(
-        kTlvFormatMarker.data(), kTlvFormatMarker.size());
-  } else {
-    // Append kTlvFormatMarker to queue
-    auto queue = folly::IOBufQueue(folly::IOBufQueue::cacheChainLength());
-    queue.append(kTlvFormatMarker.data(), kTlvFormatMarker.size());
-
-    // Encode database_ and append to queue
-    for (auto& keyPair : database_.keyVals) {
-      PersistentObject pObject;
-      pObject =
-          toPersistentObject(ActionType::ADD, keyPair.first, keyPair.second);
-
-      auto buf = encodePersistentObject(pObject);
-      if (buf.hasError()) {
-        LOG(ERROR) << "Failed to encode PersistentObject to ioBuf. Error:  "
-                   << folly::exceptionStr(buf.error());
-        return false;
-      }
-      queue.append(std::move(*buf));
-    }
-    // Write queue to disk
-    ioBuf = queue.move();
+  auto ioBuf = encodeDatabase(database_);
+  if (ioBuf.hasError()) {
+    LOG(ERROR) << "Failed to encode PersistentObject to ioBuf. Error:  "
+               << folly::exceptionStr(ioBuf.error());
+    return false;
   }
 
-  auto success = writeIoBufToDisk(ioBuf, WriteType::WRITE);
+  const auto numBytes = (*ioBuf)->computeChainDataLength();
+  auto success = writeIoBufToDisk(*ioBuf, WriteType::WRITE);
   if (success.hasError()) {
     LOG(ERROR) << "Failed to write database to file '" << storageFilePath_
                << "'. Error: " << folly::exceptionStr(success.error());
     return false;
   }
+  logBytes_ = numBytes;
+  numOfBytesWrittenToDisk_ += numBytes;
   return true;
 }
 
+folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
+PersistentStore::encodeDatabase(
+    const thrift::StoreDatabase& database) noexcept {
+  // Append kTlvFormatMarker to queue
+  auto queue = folly::IOBufQueue(folly::IOBufQueue::cacheChainLength());
+  queue.append(kTlvFormatMarker.data(), kTlvFormatMarker.size());
+
+  // Encode database and append to queue
+  for (auto& keyPair : database.keyVals) {
+    PersistentObject pObject;
+    pObject.type = ActionType::ADD;
+    pObject.key = keyPair.first;
+    pObject.data = keyPair.second;
+
+    auto buf = encodePersistentObject(pObject);
+    if (buf.hasError()) {
+      return folly::makeUnexpected(buf.error());
+    }
+    queue.append(std::move(*buf));
+  }
+  return queue.move();
+}
+
+uint64_t
+PersistentStore::getEncodedSize(
+    const std::string& key, const std::string& value) noexcept {
+  return sizeof(uint8_t) + sizeof(uint32_t) + key.size() + sizeof(uint32_t) +
+      value.size();
+}
+
 bool
 PersistentStore::loadDatabaseFromDisk() noexcept {
   // Check if file exists
@@ -232,16 +389,19 @@ PersistentStore::loadDatabaseFromDisk() noexcept {
     return true;
   }
 
-  // Read data from file
-  std::string fileData{""};
-  if (not folly::readFile(storageFilePath_.c_str(), fileData)) {
+  // Map file to memory, avoids copying the whole of it before decoding
+  std::unique_ptr<folly::MemoryMapping> mapping;
+  try {
+    mapping = std::make_unique<folly::MemoryMapping>(storageFilePath_.c_str());
+  } catch (std::exception const& e) {
     LOG(ERROR) << "Failed to read file contents from '" << storageFilePath_
-               << "'. Error (" << errno << "): " << folly::errnoStr(errno);
+               << "'. Error: " << folly::exceptionStr(e);
     return false;
   }
+  logBytes_ = mapping->range().size();
 
   // Create IoBuf and cursor for loading data from disk
-  auto ioBuf = folly::IOBuf::wrapBuffer(fileData.c_str(), fileData.size());
+  auto ioBuf = folly::IOBuf::wrapBuffer(mapping->range());
   folly::io::Cursor cursor(ioBuf.get());
 
   // Read 'kTlvFormatMarker' from ioBuf
@@ -255,15 +415,19 @@ PersistentStore::loadDatabaseFromDisk() noexcept {
                  << "'. Error: " << folly::exceptionStr(oldSuccess.error());
       return false;
     }
-    return true;
+  } else {
+    // Load TlvFormat
+    auto tlvSuccess = loadDatabaseTlvFormat(ioBuf);
+    if (tlvSuccess.hasError()) {
+      LOG(ERROR) << "Failed to read Tlv-format file contents from '"
+                 << storageFilePath_
+                 << "'. Error: " << folly::exceptionStr(tlvSuccess.error());
+      return false;
+    }
   }
-  // Load TlvFormat
-  auto tlvSuccess = loadDatabaseTlvFormat(ioBuf);
-  if (tlvSuccess.hasError()) {
-    LOG(ERROR) << "Failed to read Tlv-format file contents from '"
-               << storageFilePath_
-               << "'. Error: " << folly::exceptionStr(tlvSuccess.error());
-    return false;
+  liveBytes_ = kTlvFormatMarker.size();
+  for (const auto& keyPair : database_.keyVals) {
+    liveBytes_ += getEncodedSize(keyPair.first, keyPair.second);
   }
   return true;
 }
@@ -324,25 +488,45 @@ PersistentStore::loadDatabaseTlvFormat(
   return folly::Unit();
 }
 
-// Write over or append IoBuf to disk atomically
 folly::Expected<folly::Unit, std::string>
 PersistentStore::writeIoBufToDisk(
     const std::unique_ptr<folly::IOBuf>& ioBuf, WriteType writeType) noexcept {
+  return writeIoBufToFile(storageFilePath_, ioBuf, writeType, fsyncOnCommit_);
+}
+
+// Write over or append IoBuf to disk atomically
+folly::Expected<folly::Unit, std::string>
+PersistentStore::writeIoBufToFile(
+    const std::string& filePath,
+    const std::unique_ptr<folly::IOBuf>& ioBuf,
+    WriteType writeType,
+    bool fsync) noexcept {
   std::string fileData("");
   try {
     ioBuf->coalesce();
     fileData = ioBuf->moveToFbString().toStdString();
 
     if (writeType == WriteType::WRITE) {
-      // Write over
-      folly::writeFileAtomic(storageFilePath_, fileData, 0666);
+      // Write over, temporary file is synced before it replaces the file
+      folly::writeFileAtomic(filePath, fileData, 0666);
     } else {
-      // Append to file
-      folly::writeFile(
-          fileData,
-          storageFilePath_.c_str(),
-          O_WRONLY | O_APPEND | O_CREAT,
-          0666);
+      // Append to file, and flush it to disk if asked to
+      const int fd = folly::openNoInt(
+          filePath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+      if (fd < 0) {
+        return folly::makeUnexpected<std::string>(
+            folly::sformat("Failed to open file: {}", folly::errnoStr(errno)));
+      }
+      const bool written =
+          folly::writeFull(fd, fileData.data(), fileData.size()) ==
+              static_cast<ssize_t>(fileData.size()) and
+          (not fsync or folly::fsyncNoInt(fd) == 0);
+      const int error = errno;
+      folly::closeNoInt(fd);
+      if (not written) {
+        return folly::makeUnexpected<std::string>(folly::sformat(
+            "Failed to write file: {}", folly::errnoStr(error)));
+      }
     }
   } catch (std::exception const& e) {
     return folly::makeUnexpected<std::string>(
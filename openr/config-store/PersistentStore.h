@@ -8,11 +8,14 @@
 #pragma once
 
 #include <chrono>
+#include <optional>
 #include <string>
 
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
+#include <folly/io/IOBufQueue.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Constants.h>
@@ -46,6 +49,17 @@ struct PersistentObject {
  * `storageFilePath`: Describe the path of file in file system where data will
  * be stored/retrieved from (in binary format).
  *
+ * The file is a log: a checkpoint of the database followed by the objects
+ * added/deleted since, which are appended on each write. Once the log grows
+ * large compared to the database it is compacted on a background thread into
+ * a new checkpoint, while writes keep being appended to the old log. Objects
+ * written meanwhile are appended to the new checkpoint before it replaces the
+ * old log. On startup the file is memory mapped and replayed.
+ *
+ * Writes are group committed: objects of stores and erases within
+ * kPersistentStoreCommitWindow are appended to disk at once, optionally
+ * followed by fsync, and their futures are completed together afterwards.
+ *
  * You can interact with this module via ZMQ-Socket APIs described in
  * PersistentStore.thrift file via `REP` socket.
  *
@@ -57,7 +71,9 @@ class PersistentStore : public OpenrEventBase {
       const std::string& storageFilePath,
       fbzmq::Context& context,
       bool dryrun = false,
-      bool periodicallySaveToDisk = true);
+      bool periodicallySaveToDisk = true,
+      // fsync file after each commit
+      bool fsyncOnCommit = false);
 
   // Destructor will try to save DB to disk before destroying the object
   ~PersistentStore() override;
@@ -67,6 +83,16 @@ class PersistentStore : public OpenrEventBase {
     return numOfWritesToDisk_;
   }
 
+  uint64_t
+  getNumOfCompactions() const {
+    return numOfCompactions_;
+  }
+
+  uint64_t
+  getNumOfBytesWrittenToDisk() const {
+    return numOfBytesWrittenToDisk_;
+  }
+
   /**
    * Encode/Decode a PersistentObject, this can be private method, but for unit
    * test, we make it public
@@ -134,13 +160,43 @@ class PersistentStore : public OpenrEventBase {
   // Wrapper function to save persistent object to disk immediately or later
   void maybeSaveObjectToDisk() noexcept;
 
-  // Function to save Persistent Object to local disk.
+  // Function to save Persistent Object to local disk, and complete requests
+  // waiting for them. On failure they are kept to be retried if saving
+  // periodically
   bool savePersistentObjectToDisk() noexcept;
 
+  // Append objects to the log on disk
+  bool appendObjectsToDisk(
+      const std::vector<PersistentObject>& pObjects) noexcept;
+
   // Write IoBuf ro local disk
   folly::Expected<folly::Unit, std::string> writeIoBufToDisk(
       const std::unique_ptr<folly::IOBuf>& ioBuf, WriteType writeType) noexcept;
 
+  // Write IoBuf to file at filePath
+  static folly::Expected<folly::Unit, std::string> writeIoBufToFile(
+      const std::string& filePath,
+      const std::unique_ptr<folly::IOBuf>& ioBuf,
+      WriteType writeType,
+      bool fsync) noexcept;
+
+  // Encode database as checkpoint, i.e. kTlvFormatMarker followed by an ADD
+  // object for each key
+  static folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
+  encodeDatabase(const thrift::StoreDatabase& database) noexcept;
+
+  // Size of an encoded ADD object of key-value
+  static uint64_t getEncodedSize(
+      const std::string& key, const std::string& value) noexcept;
+
+  // Start background compaction of the log on disk if it grew large enough
+  // compared to the database
+  void maybeStartCompaction() noexcept;
+
+  // Replace the log by the checkpoint of finished compaction, with objects
+  // written since appended. Waits for compaction in progress if `wait` is set
+  void maybeFinishCompaction(bool wait) noexcept;
+
   // Function to create a PersistentObject.
   PersistentObject toPersistentObject(
       const ActionType type, const std::string& key, const std::string& data);
@@ -148,16 +204,39 @@ class PersistentStore : public OpenrEventBase {
   // Keeps track of number of writes of Database to disk
   std::atomic<std::uint64_t> numOfWritesToDisk_{0};
 
-  // Keeps track of number of writes of PersistentObject to disk
-  std::atomic<std::uint64_t> numOfNewWritesToDisk_{0};
+  // Keeps track of number of compactions of the log on disk
+  std::atomic<std::uint64_t> numOfCompactions_{0};
+
+  // Keeps track of bytes written to disk, for log appends, compactions and
+  // full writes of database
+  std::atomic<std::uint64_t> numOfBytesWrittenToDisk_{0};
 
   // Location on disk where data will be synced up. A file will be created
   // if doesn't exists.
   const std::string storageFilePath_;
 
+  // Location of the checkpoint being written by compaction
+  const std::string compactionFilePath_;
+
+  // Size of the log on disk, and of the database encoded as checkpoint
+  uint64_t logBytes_{0};
+  uint64_t liveBytes_{kTlvFormatMarker.size()};
+
+  // Thread to compact the log on, and the compaction in progress if any.
+  // Compaction results in the size of the checkpoint written
+  std::unique_ptr<folly::CPUThreadPoolExecutor> compactionExecutor_;
+  std::optional<folly::Future<folly::Expected<uint64_t, std::string>>>
+      compaction_;
+
+  // Objects written since the snapshot of the compaction in progress
+  folly::IOBufQueue compactionTail_{folly::IOBufQueue::cacheChainLength()};
+
   // Dryrun to avoid disk writes in UTs
   bool dryrun_{false};
 
+  // fsync file after each commit
+  const bool fsyncOnCommit_{false};
+
   // Timer for saving database to disk
   std::unique_ptr<fbzmq::ZmqTimeout> saveDbTimer_;
   std::unique_ptr<ExponentialBackoff<std::chrono::milliseconds>>
@@ -172,6 +251,10 @@ class PersistentStore : public OpenrEventBase {
 
   // Define a persistent object
   std::vector<PersistentObject> pObjects_;
+
+  // Requests waiting for pObjects_ to be committed, called with whether
+  // they were
+  std::vector<folly::Function<void(bool)>> commitCallbacks_;
 };
 
 } // namespace openr
@@ -5,15 +5,24 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
 #include <folly/Benchmark.h>
 #include <folly/Random.h>
+#include <folly/futures/Future.h>
 #include <folly/init/Init.h>
 #include <openr/config-store/PersistentStoreWrapper.h>
+#include <openr/tests/BenchmarkUtils.h>
 
 namespace {
 // kIterations <= n: change this to 10 singce n starts from 10,
 // n is in BENCHMARK_PARAM(BM_PersistentStoreWrite, n)
 uint32_t kIterations = 10;
+
+// size of database for benchmarking startup
+const size_t kStartupDbSize{100 * 1024 * 1024};
 } // namespace
 
 namespace openr {
@@ -159,6 +168,121 @@ BM_PersistentStoreCreateDestroy(uint32_t iters, size_t numOfStringKeys) {
   }
 }
 
+/**
+ * Return the percentile of samples, 0 if there are none
+ */
+uint64_t
+getPercentile(std::vector<uint64_t> samples, double percentile) {
+  if (samples.empty()) {
+    return 0;
+  }
+  const size_t index = std::min(
+      samples.size() - 1, static_cast<size_t>(samples.size() * percentile));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
+}
+
+/**
+ * Benchmark for a mix of requests with values of realistic size, e.g. prefix
+ * dbs or allocation state
+ * 1. Write keys with values of valueSize to store
+ * 2. Store, load and erase random keys, 6:3:1
+ * 3. Erase keys
+ * Reports p99 latency of stores and the write amplification, i.e. bytes
+ * written to disk per byte of key-values stored, in percent
+ */
+static void
+BM_PersistentStoreMixed(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numOfStringKeys,
+    size_t valueSize) {
+  auto suspender = folly::BenchmarkSuspender();
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+  auto store = std::make_unique<PersistentStoreWrapper>(context, tid);
+  store->run();
+
+  auto stringKeys = constructRandomVector(numOfStringKeys);
+  const std::string value(valueSize, 'v');
+  for (const auto& key : stringKeys) {
+    (*store)->store(key, value).get();
+  }
+
+  const auto bytesWrittenBefore = (*store)->getNumOfBytesWrittenToDisk();
+  uint64_t bytesStored{0};
+  std::vector<uint64_t> storeLatencies;
+  storeLatencies.reserve(iters);
+  for (uint32_t i = 0; i < iters; i++) {
+    const auto& key = stringKeys[folly::Random::rand32(stringKeys.size())];
+    const auto op = folly::Random::rand32(10);
+    suspender.dismiss(); // Start measuring benchmark time
+    if (op < 6) {
+      const auto startTs = std::chrono::steady_clock::now();
+      (*store)->store(key, value).get();
+      storeLatencies.emplace_back(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - startTs)
+              .count());
+      bytesStored += key.size() + value.size();
+    } else if (op < 9) {
+      (*store)->load(key).get();
+    } else {
+      (*store)->erase(key).get();
+    }
+    suspender.rehire(); // Stop measuring time again
+  }
+
+  counters["p99_store_us"] = getPercentile(storeLatencies, 0.99);
+  counters["write_amplification_pct"] = bytesStored
+      ? ((*store)->getNumOfBytesWrittenToDisk() - bytesWrittenBefore) * 100 /
+          bytesStored
+      : 0;
+
+  // Erase the keys and stop store before exiting
+  eraseKeyFromStore(stringKeys, *store);
+}
+
+/**
+ * Benchmark for startup of a store loading a large database from disk
+ * 1. Write kStartupDbSize of values of valueSize to store
+ * 2. Destroy store, which saves the database to disk
+ * 3. Create store, loading the database. Only this is measured
+ */
+static void
+BM_PersistentStoreStartup(
+    folly::UserCounters& counters, uint32_t iters, size_t valueSize) {
+  auto suspender = folly::BenchmarkSuspender();
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+  auto store = std::make_unique<PersistentStoreWrapper>(context, tid + 2);
+  store->run();
+  const auto nodeName = store->nodeName;
+  const auto filePath = store->filePath;
+
+  // Requests are not waited for one by one, they get committed in batches
+  auto stringKeys = constructRandomVector(kStartupDbSize / valueSize);
+  const std::string value(valueSize, 'v');
+  std::vector<folly::SemiFuture<folly::Unit>> futures;
+  for (const auto& key : stringKeys) {
+    futures.emplace_back((*store)->store(key, value));
+  }
+  folly::collectAllSemiFuture(std::move(futures)).get();
+  store.reset();
+
+  for (uint32_t i = 0; i < iters; i++) {
+    suspender.dismiss(); // Start measuring benchmark time
+    auto store1 =
+        std::make_unique<PersistentStore>(nodeName, filePath, context);
+    suspender.rehire(); // Stop measuring time again
+  }
+  counters["db_mb"] = kStartupDbSize / (1024 * 1024);
+
+  std::remove(filePath.c_str());
+}
+
 // The parameter is the number of keys already written to store
 // before benchmarking the time.
 BENCHMARK_PARAM(BM_PersistentStoreWrite, 10);
@@ -176,6 +300,23 @@ BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 100);
 BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 1000);
 BENCHMARK_PARAM(BM_PersistentStoreCreateDestroy, 10000);
 
+// The parameters are the number of keys and the size of their values
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PersistentStoreMixed, counters, 100_1KB, 100, 1024);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PersistentStoreMixed, counters, 100_100KB, 100, 100 * 1024);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PersistentStoreMixed, counters, 10_1MB, 10, 1024 * 1024);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PersistentStoreMixed, counters, 4_10MB, 4, 10 * 1024 * 1024);
+
+// The parameter is the size of values making up the database
+BENCHMARK_COUNTERS_NAME_PARAM(BM_PersistentStoreStartup, counters, 1KB, 1024);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PersistentStoreStartup, counters, 1MB, 1024 * 1024);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_PersistentStoreStartup, counters, 10MB, 10 * 1024 * 1024);
+
 } // namespace openr
 
 int
@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cstdio>
 #include <thread>
 #include <utility>
 
@@ -218,6 +219,81 @@ TEST(PersistentStoreTest, BulkStoreLoad) {
   }
 }
 
+TEST(PersistentStoreTest, GroupCommitTest) {
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+  PersistentStoreWrapper store(context, tid);
+  store.run();
+
+  //
+  // Burst of writes is committed at once, all requests complete after it
+  //
+  const int numWrites{100};
+  std::vector<folly::SemiFuture<folly::Unit>> futures;
+  for (int index = 0; index < numWrites; index++) {
+    futures.emplace_back(store->store(
+        folly::sformat("key-{}", index), folly::sformat("val-{}", index)));
+  }
+  futures.emplace_back(store->erase("key-0").deferValue([](bool erased) {
+    EXPECT_TRUE(erased);
+  }));
+  for (auto& result : folly::collectAllSemiFuture(std::move(futures)).get()) {
+    EXPECT_TRUE(result.hasValue());
+  }
+  EXPECT_LE(1, store->getNumOfDbWritesToDisk());
+  EXPECT_GT(numWrites, store->getNumOfDbWritesToDisk());
+
+  EXPECT_FALSE(store->load("key-0").get().has_value());
+  EXPECT_EQ("val-1", store->load("key-1").get());
+}
+
+TEST(PersistentStoreTest, CompactionTest) {
+  fbzmq::Context context;
+  const auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const auto filePath =
+      folly::sformat("/tmp/aq_persistent_store_compaction_test_{}", tid);
+  std::remove(filePath.c_str());
+
+  // Store writing every object to disk right away
+  auto store = std::make_unique<PersistentStore>(
+      "1",
+      filePath,
+      context,
+      false /* dryrun */,
+      false /* periodicallySaveToDisk */);
+  std::thread storeThread([&]() noexcept { store->run(); });
+  store->waitUntilRunning();
+
+  thrift::StoreDatabase database;
+  database.keyVals["key-static"] = "static";
+  store->store("key-static", "static").get();
+
+  //
+  // Overwriting a key grows the log until it gets compacted
+  //
+  const int numWrites{3000};
+  const size_t valueSize{1024};
+  for (int index = 0; index < numWrites; index++) {
+    const std::string value(valueSize, 'a' + index % 26);
+    database.keyVals["key"] = value;
+    store->store("key", value).get();
+  }
+  EXPECT_LE(1, store->getNumOfCompactions());
+
+  // Log on disk is a checkpoint plus objects written since
+  std::string fileData;
+  ASSERT_TRUE(folly::readFile(filePath.c_str(), fileData));
+  EXPECT_GT(numWrites * valueSize / 2, fileData.size());
+  EXPECT_EQ(database, loadDatabaseFromDisk(filePath));
+
+  store->stop();
+  storeThread.join();
+  store.reset();
+  EXPECT_EQ(database, loadDatabaseFromDisk(filePath));
+  std::remove(filePath.c_str());
+}
+
 } // namespace openr
 
 int
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "AdmissionController.h"
+
+#include <fb303/ServiceData.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/executors/thread_factory/PriorityThreadFactory.h>
+#include <glog/logging.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+AdmissionController::AdmissionController(
+    size_t maxInFlight,
+    size_t maxQueued,
+    size_t apiMaxInFlight,
+    std::unordered_map<std::string, size_t> apiLimits,
+    size_t numThreads,
+    int threadPriority)
+    : maxInFlight_(maxInFlight),
+      maxQueued_(maxQueued),
+      apiMaxInFlight_(apiMaxInFlight),
+      apiLimits_(std::move(apiLimits)),
+      executor_(std::make_unique<folly::CPUThreadPoolExecutor>(
+          numThreads,
+          std::make_shared<folly::PriorityThreadFactory>(
+              std::make_shared<folly::NamedThreadFactory>("CtrlLowPriority"),
+              threadPriority))) {
+  CHECK_GT(maxInFlight_, 0);
+  CHECK_GT(apiMaxInFlight_, 0);
+}
+
+size_t
+AdmissionController::getNumInFlight() {
+  return state_.rlock()->numInFlight;
+}
+
+size_t
+AdmissionController::getNumQueued() {
+  return state_.rlock()->queue.size();
+}
+
+bool
+AdmissionController::canStart(
+    State const& state, std::string const& api) const {
+  if (state.numInFlight >= maxInFlight_) {
+    return false;
+  }
+  auto limitIt = apiLimits_.find(api);
+  const auto limit =
+      limitIt != apiLimits_.end() ? limitIt->second : apiMaxInFlight_;
+  auto it = state.apiInFlight.find(api);
+  return it == state.apiInFlight.end() or it->second < limit;
+}
+
+void
+AdmissionController::admit(
+    std::string const& api, folly::Function<void(bool)>&& start) {
+  bool startNow{false};
+  bool rejected{false};
+  state_.withWLock([&](auto& state) {
+    if (canStart(state, api)) {
+      ++state.numInFlight;
+      ++state.apiInFlight[api];
+      startNow = true;
+    } else if (state.queue.size() < maxQueued_) {
+      state.queue.emplace_back(api, std::move(start));
+      fb303::fbData->addStatValue(
+          "ctrl.admission." + api + ".queued", 1, fb303::SUM);
+    } else {
+      rejected = true;
+      fb303::fbData->addStatValue(
+          "ctrl.admission." + api + ".rejected", 1, fb303::SUM);
+    }
+    updateCounters(state);
+  });
+
+  // run outside of the lock, as completion may release right away
+  if (startNow) {
+    start(true);
+  } else if (rejected) {
+    LOG(WARNING) << "Rejected request of " << api
+                 << ", too many in progress";
+    start(false);
+  }
+}
+
+void
+AdmissionController::release(std::string const& api) {
+  folly::Function<void(bool)> next;
+  state_.withWLock([&](auto& state) {
+    --state.numInFlight;
+    if (--state.apiInFlight.at(api) == 0) {
+      state.apiInFlight.erase(api);
+    }
+    // first queued one which can start, other APIs may pass one at its limit
+    for (auto it = state.queue.begin(); it != state.queue.end(); ++it) {
+      if (canStart(state, it->first)) {
+        ++state.numInFlight;
+        ++state.apiInFlight[it->first];
+        next = std::move(it->second);
+        state.queue.erase(it);
+        break;
+      }
+    }
+    updateCounters(state);
+  });
+
+  if (next) {
+    next(true);
+  }
+}
+
+void
+AdmissionController::updateCounters(State const& state) const {
+  fb303::fbData->setCounter("ctrl.admission.in_flight", state.numInFlight);
+  fb303::fbData->setCounter("ctrl.admission.queue_size", state.queue.size());
+}
+
+} // namespace openr
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include <folly/Function.h>
+#include <folly/Synchronized.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
+
+#include <openr/if/gen-cpp2/OpenrCtrl_types.h>
+
+namespace openr {
+
+/**
+ * Admission of expensive read-only requests of the ctrl server, e.g. full
+ * KvStore dumps or routes computed for other nodes, to a low priority lane.
+ * So that scripts can't hold up convergence work on the module event bases
+ * with any number of them in flight.
+ *
+ * - Requests run once both the lane and their API are below their limit of
+ *   requests in flight. Otherwise they are queued, in order of arrival, and
+ *   rejected with OpenrError once the queue is full.
+ * - Responses get materialized on the low priority threads of the lane
+ *   rather than on the thrift CPU pool, see OpenrCtrlHandler::materializeView
+ *
+ * Counters ctrl.admission.<api>.queued/rejected count queued and rejected
+ * requests, ctrl.admission.in_flight/queue_size report the state of the lane.
+ */
+class AdmissionController {
+ public:
+  /**
+   * @param maxInFlight       Requests in flight in the lane
+   * @param maxQueued         Requests waiting for admission in the lane
+   * @param apiMaxInFlight    Requests in flight of an API
+   * @param apiLimits         Limits of APIs other than apiMaxInFlight
+   * @param numThreads        Threads materializing responses
+   * @param threadPriority    Nice value of the threads
+   */
+  AdmissionController(
+      size_t maxInFlight,
+      size_t maxQueued,
+      size_t apiMaxInFlight,
+      std::unordered_map<std::string, size_t> apiLimits,
+      size_t numThreads,
+      int threadPriority);
+
+  /**
+   * Run request of api once admitted. fn returns the SemiFuture of the
+   * response, it is called on admission and driven by the lane threads.
+   */
+  template <typename Fn>
+  auto
+  run(std::string const& api, Fn&& fn) -> std::invoke_result_t<Fn> {
+    using T = typename std::invoke_result_t<Fn>::value_type;
+    folly::Promise<T> p;
+    auto sf = p.getSemiFuture();
+    admit(
+        api,
+        [this, api, fn = std::forward<Fn>(fn), p = std::move(p)](
+            bool admitted) mutable {
+          if (not admitted) {
+            p.setException(thrift::OpenrError(
+                "Too many requests of " + api + " in progress, retry later"));
+            return;
+          }
+          folly::makeSemiFutureWith(std::move(fn))
+              .via(executor_.get())
+              .thenTry([this, api, p = std::move(p)](
+                           folly::Try<T>&& result) mutable {
+                // release first, so the slot is free once response is seen
+                release(api);
+                p.setTry(std::move(result));
+              });
+        });
+    return sf;
+  }
+
+  size_t getNumInFlight();
+  size_t getNumQueued();
+
+ private:
+  // start is called with true once admitted, or false if rejected
+  void admit(std::string const& api, folly::Function<void(bool)>&& start);
+
+  // request of api done, start next admissible one in queue
+  void release(std::string const& api);
+
+  struct State {
+    size_t numInFlight{0};
+    std::unordered_map<std::string, size_t> apiInFlight;
+    // queued requests in order of arrival, by api
+    std::deque<std::pair<std::string, folly::Function<void(bool)>>> queue;
+  };
+
+  bool canStart(State const& state, std::string const& api) const;
+
+  void updateCounters(State const& state) const;
+
+  const size_t maxInFlight_{0};
+  const size_t maxQueued_{0};
+  const size_t apiMaxInFlight_{0};
+  const std::unordered_map<std::string, size_t> apiLimits_;
+
+  folly::Synchronized<State> state_;
+
+  // declared last to be destroyed first, its remaining tasks release state_
+  std::unique_ptr<folly::CPUThreadPoolExecutor> executor_;
+};
+
+} // namespace openr
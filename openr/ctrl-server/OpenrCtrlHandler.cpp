@@ -10,11 +10,16 @@
 #include <re2/re2.h>
 
 #include <folly/ExceptionString.h>
+#include <folly/Format.h>
+#include <folly/String.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/io/async/ssl/OpenSSLUtils.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/CpuProfiler.h>
+#include <openr/common/MemoryAccounting.h>
+#include <openr/common/SlowCallbackDetector.h>
 #include <openr/common/Util.h>
 #include <openr/config-store/PersistentStore.h>
 #include <openr/decision/Decision.h>
@@ -26,6 +31,108 @@
 
 namespace openr {
 
+namespace {
+
+// Counter snapshots retained as base of delta requests
+const size_t kMaxCountersSnapshots{16};
+
+// Compiled regexes cached, cache is flushed once full
+const size_t kMaxCachedRegexes{64};
+
+// Key dump served from a view of KvStore, only filtered by key prefixes and
+// originator IDs
+bool
+isPlainKeyDump(thrift::KeyDumpParams const& params) {
+  return not params.keyValHashes.has_value() and
+      not params.keyValBucketHashes.has_value() and
+      not params.keyValOriginatorHashes.has_value() and
+      not params.acceptCompression.has_value() and
+      not params.maxKeys.has_value();
+}
+
+std::unique_ptr<thrift::Publication>
+toPublication(std::shared_ptr<const KvStoreView> view) {
+  return std::make_unique<thrift::Publication>(view->toPublication());
+}
+
+/**
+ * Keys of publication matching the filters and areas, std::nullopt if there
+ * are none. Expired keys carry no originator, they are matched on key prefixes
+ * only and all of them are kept when filtering on originators only.
+ */
+std::optional<thrift::Publication>
+filterPublication(
+    thrift::Publication const& publication,
+    KvStoreFilters const* filters,
+    std::set<std::string> const& areas) {
+  if (not areas.empty()) {
+    const auto& area = publication.area.has_value()
+        ? publication.area.value()
+        : thrift::KvStore_constants::kDefaultArea();
+    if (not areas.count(area)) {
+      return std::nullopt;
+    }
+  }
+  if (not filters) {
+    return publication;
+  }
+
+  thrift::Publication filtered;
+  filtered.area = publication.area;
+  filtered.floodRootId = publication.floodRootId;
+  filtered.nodeIds = publication.nodeIds;
+  for (auto const& kv : publication.keyVals) {
+    if (filters->keyMatch(kv.first, kv.second)) {
+      filtered.keyVals.emplace(kv);
+    }
+  }
+  const bool matchAllExpired = filters->getKeyPrefixes().empty();
+  for (auto const& key : publication.expiredKeys) {
+    if (matchAllExpired or filters->keyMatch(key, std::string{})) {
+      filtered.expiredKeys.emplace_back(key);
+    }
+  }
+  if (filtered.keyVals.empty() and filtered.expiredKeys.empty()) {
+    return std::nullopt;
+  }
+  return filtered;
+}
+
+/**
+ * Changed keys of publication without their values, std::nullopt if there
+ * are none. Values without value are TTL refreshes, they are left out.
+ */
+std::optional<thrift::Publication>
+toMetadataPublication(thrift::Publication const& publication) {
+  thrift::Publication metadata;
+  metadata.area = publication.area;
+  metadata.floodRootId = publication.floodRootId;
+  metadata.nodeIds = publication.nodeIds;
+  metadata.expiredKeys = publication.expiredKeys;
+  for (auto const& kv : publication.keyVals) {
+    auto const& value = kv.second;
+    if (not value.value.has_value()) {
+      continue;
+    }
+    thrift::Value meta;
+    meta.version = value.version;
+    meta.originatorId = value.originatorId;
+    meta.ttl = value.ttl;
+    meta.ttlVersion = value.ttlVersion;
+    // KvStore publishes values with their hash
+    meta.hash = value.hash.has_value()
+        ? value.hash.value()
+        : generateHash(value.version, value.originatorId, value.value);
+    metadata.keyVals.emplace(kv.first, std::move(meta));
+  }
+  if (metadata.keyVals.empty() and metadata.expiredKeys.empty()) {
+    return std::nullopt;
+  }
+  return metadata;
+}
+
+} // namespace
+
 OpenrCtrlHandler::OpenrCtrlHandler(
     const std::string& nodeName,
     const std::unordered_set<std::string>& acceptablePeerCommonNames,
@@ -37,7 +144,10 @@ OpenrCtrlHandler::OpenrCtrlHandler(
     PersistentStore* configStore,
     PrefixManager* prefixManager,
     MonitorSubmitUrl const& monitorSubmitUrl,
-    fbzmq::Context& context)
+    fbzmq::Context& context,
+    std::chrono::milliseconds countersCacheTtl,
+    std::optional<messaging::RQueue<thrift::RouteDatabaseDelta>>
+        fibUpdatesReader)
     : facebook::fb303::BaseService("openr"),
       nodeName_(nodeName),
       acceptablePeerCommonNames_(acceptablePeerCommonNames),
@@ -46,7 +156,15 @@ OpenrCtrlHandler::OpenrCtrlHandler(
       kvStore_(kvStore),
       linkMonitor_(linkMonitor),
       configStore_(configStore),
-      prefixManager_(prefixManager) {
+      prefixManager_(prefixManager),
+      lowPriorityLane_(
+          Constants::kCtrlLowPriorityMaxInFlight,
+          Constants::kCtrlLowPriorityMaxQueued,
+          Constants::kCtrlLowPriorityApiMaxInFlight,
+          {{"getRouteDbComputed", 1}},
+          Constants::kCtrlLowPriorityThreads,
+          Constants::kCtrlLowPriorityThreadPriority),
+      countersCacheTtl_(countersCacheTtl) {
   // Create monitor client
   zmqMonitorClient_ =
       std::make_unique<fbzmq::ZmqMonitorClient>(context, monitorSubmitUrl);
@@ -66,68 +184,100 @@ OpenrCtrlHandler::OpenrCtrlHandler(
           break;
         }
 
-        SYNCHRONIZED(kvStorePublishers_) {
-          for (auto& kv : kvStorePublishers_) {
-            kv.second.next(maybePublication.value());
-          }
-        }
+        auto const& publication = *maybePublication.value();
+        publishKvStoreUpdates(publication);
 
-        bool isAdjChanged = false;
-        // check if any of KeyVal has 'adj' update
-        for (auto& kv : maybePublication.value().keyVals) {
-          auto& key = kv.first;
-          auto& val = kv.second;
-          // check if we have any value update.
-          // Ttl refreshing won't update any value.
-          if (!val.value.has_value()) {
-            continue;
-          }
+        processLongPollReqs(publication);
+      }
+    });
+  }
 
-          // "adj:*" key has changed. Update local collection
-          if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
-            VLOG(3) << "Adj key: " << key << " change received";
-            isAdjChanged = true;
-            break;
+  // Add fiber task to receive route updates from Fib
+  if (fibUpdatesReader.has_value()) {
+    fibTaskFuture_ = ctrlEvb->addFiberTaskFuture(
+        [q = std::move(*fibUpdatesReader), this]() mutable noexcept {
+          LOG(INFO) << "Starting Fib updates processing fiber";
+          while (true) {
+            auto maybeDelta = q.get(); // perform read
+            VLOG(2) << "Received route updates from Fib";
+            if (maybeDelta.hasError()) {
+              LOG(INFO) << "Terminating Fib updates processing fiber";
+              break;
+            }
+            publishFibUpdates(maybeDelta.value());
           }
-        }
+        });
+  }
+}
 
-        if (isAdjChanged) {
-          // thrift::Publication contains "adj:*" key change.
-          // Clean ALL pending promises
-          longPollReqs_.withWLock([&](auto& longPollReqs) {
-            for (auto& kv : longPollReqs) {
-              auto& p = kv.second.first;
-              p.setValue(true);
-            }
-            longPollReqs.clear();
-          });
-        } else {
-          longPollReqs_.withWLock([&](auto& longPollReqs) {
-            auto now = getUnixTimeStampMs();
-            std::vector<int64_t> reqsToClean;
-            for (auto& kv : longPollReqs) {
-              auto& clientId = kv.first;
-              auto& req = kv.second;
-
-              auto& p = req.first;
-              auto& timeStamp = req.second;
-              if (now - timeStamp >= Constants::kLongPollReqHoldTime.count()) {
-                LOG(INFO) << "Elapsed time: " << now - timeStamp
-                          << " is over hold limit: "
-                          << Constants::kLongPollReqHoldTime.count();
-                reqsToClean.emplace_back(clientId);
-                p.setValue(false);
-              }
-            }
+void
+OpenrCtrlHandler::processLongPollReqs(thrift::Publication const& publication) {
+  bool isAdjChanged = false;
+  // check if any of KeyVal has 'adj' update
+  for (auto& kv : publication.keyVals) {
+    auto& key = kv.first;
+    auto& val = kv.second;
+    // check if we have any value update.
+    // Ttl refreshing won't update any value.
+    if (!val.value.has_value()) {
+      continue;
+    }
 
-            // cleanup expired requests since no ADJ change observed
-            for (auto& clientId : reqsToClean) {
-              longPollReqs.erase(clientId);
-            }
-          });
-        }
+    // "adj:*" key has changed. Update local collection
+    if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
+      VLOG(3) << "Adj key: " << key << " change received";
+      isAdjChanged = true;
+      break;
+    }
+  }
+  // expired "adj:*" key is a change as well
+  for (auto& key : publication.expiredKeys) {
+    if (isAdjChanged) {
+      break;
+    }
+    if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
+      VLOG(3) << "Adj key: " << key << " expiry received";
+      isAdjChanged = true;
+    }
+  }
+
+  // Take fulfilled requests out and set their promises after releasing the
+  // lock, as continuations may run inline
+  std::vector<LongPollReq> adjChangedReqs;
+  std::vector<LongPollReq> expiredReqs;
+  longPollReqs_.withWLock([&](auto& longPollReqs) {
+    if (isAdjChanged) {
+      // thrift::Publication contains "adj:*" key change of whichever area.
+      // Clean ALL pending promises
+      adjChangedReqs.reserve(longPollReqs.size());
+      for (auto& kv : longPollReqs) {
+        adjChangedReqs.emplace_back(std::move(kv.second));
       }
-    });
+      longPollReqs.clear();
+      return;
+    }
+
+    // cleanup expired requests since no ADJ change observed. Requests are
+    // ordered by Id, hence by timestamp, stop at the first one within limit
+    auto now = getUnixTimeStampMs();
+    while (not longPollReqs.empty()) {
+      auto& timeStamp = longPollReqs.begin()->second.second;
+      if (now - timeStamp < Constants::kLongPollReqHoldTime.count()) {
+        break;
+      }
+      LOG(INFO) << "Elapsed time: " << now - timeStamp
+                << " is over hold limit: "
+                << Constants::kLongPollReqHoldTime.count();
+      expiredReqs.emplace_back(std::move(longPollReqs.begin()->second));
+      longPollReqs.erase(longPollReqs.begin());
+    }
+  });
+
+  for (auto& req : adjChangedReqs) {
+    req.first.setValue(true);
+  }
+  for (auto& req : expiredReqs) {
+    req.first.setValue(false);
   }
 }
 
@@ -140,9 +290,18 @@ OpenrCtrlHandler::~OpenrCtrlHandler() {
   // with publisher returns. Since we acquire lock within `onComplete` callback,
   // we will run into the deadlock if `complete()` is invoked within
   // SYNCHRONIZED block
+  std::vector<std::shared_ptr<KvStoreSubscriber>> subscribers;
   SYNCHRONIZED(kvStorePublishers_) {
     for (auto& kv : kvStorePublishers_) {
-      publishers.emplace_back(std::move(kv.second));
+      subscribers.emplace_back(kv.second);
+    }
+  }
+  // Take publishers out so that fan-out in progress won't use them any more
+  for (auto& subscriber : subscribers) {
+    auto publisher = subscriber->publisher.wlock();
+    if (publisher->has_value()) {
+      publishers.emplace_back(std::move(publisher->value()));
+      publisher->reset();
     }
   }
   LOG(INFO) << "Terminating " << publishers.size()
@@ -151,11 +310,30 @@ OpenrCtrlHandler::~OpenrCtrlHandler() {
     std::move(publisher).complete();
   }
 
+  // same for Fib publishers, completed outside of the lock
+  std::vector<apache::thrift::ServerStreamPublisher<thrift::RouteDatabaseDelta>>
+      fibPublishers;
+  SYNCHRONIZED(fibPublishers_) {
+    for (auto& kv : fibPublishers_) {
+      fibPublishers.emplace_back(std::move(kv.second));
+    }
+    fibPublishers_.clear();
+  }
+  LOG(INFO) << "Terminating " << fibPublishers.size()
+            << " active Fib stream(s).";
+  for (auto& publisher : fibPublishers) {
+    std::move(publisher).complete();
+  }
+
   LOG(INFO) << "Cleanup all pending request(s).";
   longPollReqs_.withWLock([&](auto& longPollReqs) { longPollReqs.clear(); });
 
   LOG(INFO) << "Waiting for termination of kvStoreUpdatesQueue.";
   taskFuture_.wait();
+  if (fibTaskFuture_.valid()) {
+    LOG(INFO) << "Waiting for termination of fibUpdatesQueue.";
+    fibTaskFuture_.wait();
+  }
 }
 
 void
@@ -220,30 +398,81 @@ OpenrCtrlHandler::semifuture_getEventLogs() {
 }
 
 void
-OpenrCtrlHandler::getCounters(std::map<std::string, int64_t>& _return) {
-  BaseService::getCounters(_return);
+OpenrCtrlHandler::collectCounters(std::map<std::string, int64_t>& counters) {
+  BaseService::getCounters(counters);
   for (auto const& kv : zmqMonitorClient_->dumpCounters()) {
-    _return.emplace(kv.first, static_cast<int64_t>(kv.second.value));
+    counters.emplace(kv.first, static_cast<int64_t>(kv.second.value));
   }
 }
 
+OpenrCtrlHandler::CountersSnapshot
+OpenrCtrlHandler::getCountersSnapshot() {
+  const auto now = std::chrono::steady_clock::now();
+  {
+    auto snapshots = countersSnapshots_.rlock();
+    if (not snapshots->empty() and
+        now - snapshots->back().createTime < countersCacheTtl_) {
+      return snapshots->back();
+    }
+  }
+
+  // Collect outside of the lock, concurrent requests may both collect but
+  // won't block each other
+  auto counters = std::make_shared<std::map<std::string, int64_t>>();
+  collectCounters(*counters);
+
+  auto snapshots = countersSnapshots_.wlock();
+  CountersSnapshot snapshot;
+  snapshot.token = snapshots->empty() ? 1 : snapshots->back().token + 1;
+  snapshot.createTime = now;
+  snapshot.counters = std::move(counters);
+  snapshots->emplace_back(snapshot);
+  while (snapshots->size() > kMaxCountersSnapshots) {
+    snapshots->pop_front();
+  }
+  return snapshot;
+}
+
+std::shared_ptr<const re2::RE2>
+OpenrCtrlHandler::getCompiledRegex(std::string const& regex) {
+  {
+    auto regexCache = regexCache_.rlock();
+    auto it = regexCache->find(regex);
+    if (it != regexCache->end()) {
+      return it->second;
+    }
+  }
+
+  auto compiledRegex = std::make_shared<const re2::RE2>(regex);
+  auto regexCache = regexCache_.wlock();
+  if (regexCache->size() >= kMaxCachedRegexes) {
+    regexCache->clear();
+  }
+  regexCache->emplace(regex, compiledRegex);
+  return compiledRegex;
+}
+
+void
+OpenrCtrlHandler::getCounters(std::map<std::string, int64_t>& _return) {
+  _return = *getCountersSnapshot().counters;
+}
+
 void
 OpenrCtrlHandler::getRegexCounters(
     std::map<std::string, int64_t>& _return,
     std::unique_ptr<std::string> regex) {
   // Compile regex
-  re2::RE2 compiledRegex(*regex);
-  if (not compiledRegex.ok()) {
+  auto compiledRegex = getCompiledRegex(*regex);
+  if (not compiledRegex->ok()) {
     return;
   }
 
   // Get all counters
-  std::map<std::string, int64_t> counters;
-  getCounters(counters);
+  auto counters = getCountersSnapshot().counters;
 
   // Filter counters
-  for (auto const& kv : counters) {
-    if (RE2::PartialMatch(kv.first, compiledRegex)) {
+  for (auto const& kv : *counters) {
+    if (RE2::PartialMatch(kv.first, *compiledRegex)) {
       _return.emplace(kv);
     }
   }
@@ -254,18 +483,54 @@ OpenrCtrlHandler::getSelectedCounters(
     std::map<std::string, int64_t>& _return,
     std::unique_ptr<std::vector<std::string>> keys) {
   // Get all counters
-  std::map<std::string, int64_t> counters;
-  getCounters(counters);
+  auto counters = getCountersSnapshot().counters;
 
   // Filter counters
   for (auto const& key : *keys) {
-    auto it = counters.find(key);
-    if (it != counters.end()) {
+    auto it = counters->find(key);
+    if (it != counters->end()) {
       _return.emplace(*it);
     }
   }
 }
 
+void
+OpenrCtrlHandler::getCountersDelta(
+    thrift::CountersDelta& _return, int64_t token) {
+  auto snapshot = getCountersSnapshot();
+  _return.token = snapshot.token;
+
+  std::shared_ptr<const std::map<std::string, int64_t>> baseCounters;
+  if (token != 0) {
+    auto snapshots = countersSnapshots_.rlock();
+    for (auto const& base : *snapshots) {
+      if (base.token == token) {
+        baseCounters = base.counters;
+        break;
+      }
+    }
+  }
+
+  if (not baseCounters) {
+    _return.isFullDump = true;
+    _return.counters = *snapshot.counters;
+    return;
+  }
+
+  // Both maps are sorted by name, walk them in step
+  _return.isFullDump = false;
+  auto baseIt = baseCounters->begin();
+  for (auto const& kv : *snapshot.counters) {
+    while (baseIt != baseCounters->end() and baseIt->first < kv.first) {
+      ++baseIt;
+    }
+    if (baseIt == baseCounters->end() or baseIt->first != kv.first or
+        baseIt->second != kv.second) {
+      _return.counters.emplace_hint(_return.counters.end(), kv);
+    }
+  }
+}
+
 int64_t
 OpenrCtrlHandler::getCounter(std::unique_ptr<std::string> key) {
   auto counter = zmqMonitorClient_->getCounter(*key);
@@ -275,6 +540,31 @@ OpenrCtrlHandler::getCounter(std::unique_ptr<std::string> key) {
   return 0;
 }
 
+void
+OpenrCtrlHandler::getMemoryUsageByModule(
+    std::map<std::string, int64_t>& _return) {
+  _return = MemoryAccounting::getAllocatedBytes();
+}
+
+void
+OpenrCtrlHandler::getCpuProfile(
+    std::string& _return, int32_t durationMs, int32_t frequencyHz) {
+  if (frequencyHz <= 0) {
+    throw thrift::OpenrError("Frequency must be positive");
+  }
+  auto profile = CpuProfiler::profile(
+      std::chrono::milliseconds(durationMs), frequencyHz);
+  if (profile.hasError()) {
+    throw thrift::OpenrError(profile.error());
+  }
+  _return = std::move(profile).value();
+}
+
+void
+OpenrCtrlHandler::getSlowCallbacks(thrift::TraceSpans& _return) {
+  _return = toThriftTraceSpans(SlowCallbackDetector::getSlowCallbacks());
+}
+
 void
 OpenrCtrlHandler::getMyNodeName(std::string& _return) {
   _return = std::string(nodeName_);
@@ -327,6 +617,40 @@ OpenrCtrlHandler::semifuture_syncPrefixesByType(
       .defer([](folly::Try<bool>&&) { return folly::Unit(); });
 }
 
+folly::SemiFuture<folly::Unit>
+OpenrCtrlHandler::semifuture_beginSyncPrefixesByType(
+    thrift::PrefixType prefixType) {
+  CHECK(prefixManager_);
+  return prefixManager_->beginSyncPrefixesByType(prefixType);
+}
+
+folly::SemiFuture<folly::Unit>
+OpenrCtrlHandler::semifuture_addSyncPrefixesByType(
+    thrift::PrefixType prefixType,
+    std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixes) {
+  CHECK(prefixManager_);
+  return prefixManager_->addSyncPrefixesByType(prefixType, std::move(*prefixes))
+      .defer([](folly::Try<bool>&& result) {
+        if (result.hasException()) {
+          throw thrift::OpenrError(result.exception().what().toStdString());
+        }
+        return folly::Unit();
+      });
+}
+
+folly::SemiFuture<folly::Unit>
+OpenrCtrlHandler::semifuture_commitSyncPrefixesByType(
+    thrift::PrefixType prefixType) {
+  CHECK(prefixManager_);
+  return prefixManager_->commitSyncPrefixesByType(prefixType).defer(
+      [](folly::Try<bool>&& result) {
+        if (result.hasException()) {
+          throw thrift::OpenrError(result.exception().what().toStdString());
+        }
+        return folly::Unit();
+      });
+}
+
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
 OpenrCtrlHandler::semifuture_getPrefixes() {
   CHECK(prefixManager_);
@@ -345,7 +669,9 @@ OpenrCtrlHandler::semifuture_getPrefixesByType(thrift::PrefixType prefixType) {
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 OpenrCtrlHandler::semifuture_getRouteDb() {
   CHECK(fib_);
-  return fib_->getRouteDb();
+  return lowPriorityLane_.run("getRouteDb", [this]() {
+    return fib_->getRouteDb();
+  });
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::UnicastRoute>>>
@@ -359,13 +685,17 @@ folly::SemiFuture<std::unique_ptr<std::vector<thrift::UnicastRoute>>>
 OpenrCtrlHandler::semifuture_getUnicastRoutes() {
   folly::Promise<std::unique_ptr<std::vector<thrift::UnicastRoute>>> p;
   CHECK(fib_);
-  return fib_->getUnicastRoutes({});
+  return lowPriorityLane_.run("getRouteDb", [this]() {
+    return fib_->getUnicastRoutes({});
+  });
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::MplsRoute>>>
 OpenrCtrlHandler::semifuture_getMplsRoutes() {
   CHECK(fib_);
-  return fib_->getMplsRoutes({});
+  return lowPriorityLane_.run("getRouteDb", [this]() {
+    return fib_->getMplsRoutes({});
+  });
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::MplsRoute>>>
@@ -388,19 +718,36 @@ folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 OpenrCtrlHandler::semifuture_getRouteDbComputed(
     std::unique_ptr<std::string> nodeName) {
   CHECK(decision_);
-  return decision_->getDecisionRouteDb(*nodeName);
+  // routes of other nodes are computed on request
+  if (nodeName->empty() or *nodeName == nodeName_) {
+    return decision_->getDecisionRouteDb(*nodeName);
+  }
+  return lowPriorityLane_.run(
+      "getRouteDbComputed", [this, nodeName = std::move(*nodeName)]() {
+        return decision_->getDecisionRouteDb(nodeName);
+      });
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::AdjDbs>>
 OpenrCtrlHandler::semifuture_getDecisionAdjacencyDbs() {
   CHECK(decision_);
-  return decision_->getDecisionAdjacencyDbs();
+  return lowPriorityLane_.run("getDecisionAdjacencyDbs", [this]() {
+    return decision_->getDecisionAdjacencyDbs();
+  });
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
 OpenrCtrlHandler::semifuture_getDecisionPrefixDbs() {
   CHECK(decision_);
-  return decision_->getDecisionPrefixDbs();
+  return lowPriorityLane_.run("getDecisionPrefixDbs", [this]() {
+    return decision_->getDecisionPrefixDbs();
+  });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::TraceSpans>>
+OpenrCtrlHandler::semifuture_getDecisionTraceSpans() {
+  CHECK(decision_);
+  return decision_->getDecisionTraceSpans();
 }
 
 //
@@ -437,6 +784,13 @@ folly::SemiFuture<std::unique_ptr<thrift::Publication>>
 OpenrCtrlHandler::semifuture_getKvStoreKeyValsFiltered(
     std::unique_ptr<thrift::KeyDumpParams> filter) {
   CHECK(kvStore_);
+  if (isPlainKeyDump(*filter)) {
+    return lowPriorityLane_.run(
+        "getKvStoreKeyValsFiltered", [this, filter = std::move(*filter)]() {
+          return materializeView(
+              kvStore_->dumpKvStoreKeysView(filter), toPublication);
+        });
+  }
   return kvStore_->dumpKvStoreKeys(std::move(*filter));
 }
 
@@ -445,6 +799,14 @@ OpenrCtrlHandler::semifuture_getKvStoreKeyValsFilteredArea(
     std::unique_ptr<thrift::KeyDumpParams> filter,
     std::unique_ptr<std::string> area) {
   CHECK(kvStore_);
+  if (isPlainKeyDump(*filter)) {
+    return lowPriorityLane_.run(
+        "getKvStoreKeyValsFiltered",
+        [this, filter = std::move(*filter), area = std::move(*area)]() {
+          return materializeView(
+              kvStore_->dumpKvStoreKeysView(filter, area), toPublication);
+        });
+  }
   return kvStore_->dumpKvStoreKeys(std::move(*filter), std::move(*area));
 }
 
@@ -520,8 +882,8 @@ OpenrCtrlHandler::semifuture_longPollKvStoreAdj(
     // Store req for future processing when there is publication
     // from KvStore.
     VLOG(3) << "No adj change detected. Store req as pending request";
-    longPollReqs_.withWLock([&](auto& longPollReq) {
-      longPollReq.emplace(requestId, std::make_pair(std::move(p), timeStamp));
+    longPollReqs_.withWLock([&](auto& longPollReqs) {
+      longPollReqs.emplace(requestId, std::make_pair(std::move(p), timeStamp));
     });
   }
   return sf;
@@ -565,8 +927,98 @@ OpenrCtrlHandler::semifuture_getKvStorePeersArea(
   return kvStore_->getKvStorePeers(std::move(*area));
 }
 
+OpenrCtrlHandler::KvStoreSubscriber::KvStoreSubscriber(
+    apache::thrift::ServerStreamPublisher<thrift::Publication>&& publisher,
+    std::optional<thrift::KeyDumpParams> const& filter,
+    std::set<std::string> const& areas,
+    bool metadataOnly)
+    : publisher(std::move(publisher)),
+      areas(areas),
+      metadataOnly(metadataOnly) {
+  if (filter.has_value()) {
+    std::vector<std::string> keyPrefixList;
+    folly::split(",", filter->prefix, keyPrefixList, true);
+    filters.emplace(keyPrefixList, filter->originatorIds);
+    filterKey = folly::sformat(
+        "{}|{}",
+        folly::join(",", keyPrefixList),
+        folly::join(",", filter->originatorIds));
+  }
+  filterKey += "|" + folly::join(",", areas);
+  if (metadataOnly) {
+    filterKey += "|metadata";
+  }
+}
+
+void
+OpenrCtrlHandler::publishKvStoreUpdates(
+    thrift::Publication const& publication) {
+  std::vector<std::shared_ptr<KvStoreSubscriber>> subscribers;
+  SYNCHRONIZED(kvStorePublishers_) {
+    subscribers.reserve(kvStorePublishers_.size());
+    for (auto& kv : kvStorePublishers_) {
+      subscribers.emplace_back(kv.second);
+    }
+  }
+
+  // Filtered publication per distinct filter, std::nullopt if nothing matches
+  std::unordered_map<std::string, std::optional<thrift::Publication>>
+      filteredPublications;
+  for (auto& subscriber : subscribers) {
+    thrift::Publication const* toSend = &publication;
+    if (subscriber->filters.has_value() or not subscriber->areas.empty() or
+        subscriber->metadataOnly) {
+      auto it = filteredPublications.find(subscriber->filterKey);
+      if (it == filteredPublications.end()) {
+        auto filtered = filterPublication(
+            publication,
+            subscriber->filters.has_value() ? &subscriber->filters.value()
+                                            : nullptr,
+            subscriber->areas);
+        if (subscriber->metadataOnly and filtered.has_value()) {
+          filtered = toMetadataPublication(filtered.value());
+        }
+        it = filteredPublications
+                 .emplace(subscriber->filterKey, std::move(filtered))
+                 .first;
+      }
+      if (not it->second.has_value()) {
+        continue;
+      }
+      toSend = &it->second.value();
+    }
+
+    auto publisher = subscriber->publisher.wlock();
+    if (publisher->has_value()) {
+      publisher->value().next(*toSend);
+    }
+  }
+}
+
 apache::thrift::ServerStream<thrift::Publication>
 OpenrCtrlHandler::subscribeKvStore() {
+  return subscribeKvStoreImpl(std::nullopt, {});
+}
+
+apache::thrift::ServerStream<thrift::Publication>
+OpenrCtrlHandler::subscribeKvStoreFilter(
+    std::unique_ptr<thrift::KeyDumpParams> filter,
+    std::unique_ptr<std::set<std::string>> areas) {
+  return subscribeKvStoreImpl(*filter, *areas);
+}
+
+apache::thrift::ServerStream<thrift::Publication>
+OpenrCtrlHandler::subscribeKvStoreMetadata(
+    std::unique_ptr<thrift::KeyDumpParams> filter,
+    std::unique_ptr<std::set<std::string>> areas) {
+  return subscribeKvStoreImpl(*filter, *areas, true /* metadataOnly */);
+}
+
+apache::thrift::ServerStream<thrift::Publication>
+OpenrCtrlHandler::subscribeKvStoreImpl(
+    std::optional<thrift::KeyDumpParams> const& filter,
+    std::set<std::string> const& areas,
+    bool metadataOnly) {
   // Get new client-ID (monotonically increasing)
   auto clientToken = publisherToken_++;
 
@@ -586,9 +1038,11 @@ OpenrCtrlHandler::subscribeKvStore() {
 
   SYNCHRONIZED(kvStorePublishers_) {
     assert(kvStorePublishers_.count(clientToken) == 0);
-    LOG(INFO) << "KvStore snoop stream-" << clientToken << " started.";
-    kvStorePublishers_.emplace(
-        clientToken, std::move(streamAndPublisher.second));
+    auto subscriber = std::make_shared<KvStoreSubscriber>(
+        std::move(streamAndPublisher.second), filter, areas, metadataOnly);
+    LOG(INFO) << "KvStore snoop stream-" << clientToken
+              << " started with filter: " << subscriber->filterKey;
+    kvStorePublishers_.emplace(clientToken, std::move(subscriber));
   }
   return std::move(streamAndPublisher.first);
 }
@@ -610,6 +1064,56 @@ OpenrCtrlHandler::semifuture_subscribeAndGetKvStore() {
           });
 }
 
+void
+OpenrCtrlHandler::publishFibUpdates(thrift::RouteDatabaseDelta const& delta) {
+  SYNCHRONIZED(fibPublishers_) {
+    for (auto& kv : fibPublishers_) {
+      kv.second.next(delta);
+    }
+  }
+}
+
+apache::thrift::ServerStream<thrift::RouteDatabaseDelta>
+OpenrCtrlHandler::subscribeFib() {
+  if (not fibTaskFuture_.valid()) {
+    throw thrift::OpenrError("Fib route updates are not published");
+  }
+  // Get new client-ID (monotonically increasing)
+  auto clientToken = publisherToken_++;
+
+  auto streamAndPublisher =
+      apache::thrift::ServerStream<thrift::RouteDatabaseDelta>::createPublisher(
+          [this, clientToken]() {
+            // already taken out if completed by the destructor
+            fibPublishers_.wlock()->erase(clientToken);
+            LOG(INFO) << "Fib stream-" << clientToken << " ended.";
+          });
+
+  SYNCHRONIZED(fibPublishers_) {
+    assert(fibPublishers_.count(clientToken) == 0);
+    LOG(INFO) << "Fib stream-" << clientToken << " started.";
+    fibPublishers_.emplace(clientToken, std::move(streamAndPublisher.second));
+  }
+  return std::move(streamAndPublisher.first);
+}
+
+folly::SemiFuture<apache::thrift::ResponseAndServerStream<
+    thrift::RouteDatabase,
+    thrift::RouteDatabaseDelta>>
+OpenrCtrlHandler::semifuture_subscribeAndGetFib() {
+  // subscribe first, deltas programmed meanwhile are in snapshot and stream
+  auto stream = subscribeFib();
+  return semifuture_getRouteDb().defer(
+      [stream = std::move(stream)](
+          folly::Try<std::unique_ptr<thrift::RouteDatabase>>&& db) mutable {
+        db.throwIfFailed();
+        return apache::thrift::ResponseAndServerStream<
+            thrift::RouteDatabase,
+            thrift::RouteDatabaseDelta>{std::move(*db.value()),
+                                        std::move(stream)};
+      });
+}
+
 //
 // LinkMonitor APIs
 //
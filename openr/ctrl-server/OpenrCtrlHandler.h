@@ -10,8 +10,10 @@
 #include <fb303/BaseService.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <re2/re2.h>
 #include <openr/common/Types.h>
 #include <openr/config-store/PersistentStore.h>
+#include <openr/ctrl-server/AdmissionController.h>
 #include <openr/decision/Decision.h>
 #include <openr/fib/Fib.h>
 #include <openr/if/gen-cpp2/OpenrCtrlCpp.h>
@@ -26,6 +28,12 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   /**
    * NOTE: If acceptablePeerCommonNames is empty then check for peerName is
    *       skipped
+   *
+   * Counters are served from a snapshot taken at most `countersCacheTtl`
+   * before, 0 takes a fresh snapshot on each request
+   *
+   * Route updates published by Fib are read from `fibUpdatesReader` and sent
+   * to its subscribers, Fib can't be subscribed without
    */
   OpenrCtrlHandler(
       const std::string& nodeName,
@@ -38,7 +46,11 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       PersistentStore* configStore,
       PrefixManager* prefixManager,
       MonitorSubmitUrl const& monitorSubmitUrl,
-      fbzmq::Context& context);
+      fbzmq::Context& context,
+      std::chrono::milliseconds countersCacheTtl =
+          std::chrono::milliseconds(0),
+      std::optional<messaging::RQueue<thrift::RouteDatabaseDelta>>
+          fibUpdatesReader = std::nullopt);
 
   ~OpenrCtrlHandler() override;
 
@@ -57,6 +69,22 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       std::unique_ptr<std::vector<std::string>> keys) override;
   int64_t getCounter(std::unique_ptr<std::string> key) override;
 
+  // Counters changed or added since the snapshot identified by `token`, all
+  // of them if token is 0 or the snapshot isn't retained any more
+  void getCountersDelta(
+      thrift::CountersDelta& _return, int64_t token) override;
+
+  // Bytes allocated by each module with its own memory arena
+  void getMemoryUsageByModule(
+      std::map<std::string, int64_t>& _return) override;
+
+  // Time-bounded CPU profile of module threads, as folded stacks
+  void getCpuProfile(
+      std::string& _return, int32_t durationMs, int32_t frequencyHz) override;
+
+  // Callbacks of module event bases which ran longer than the threshold
+  void getSlowCallbacks(thrift::TraceSpans& _return) override;
+
   // Openr Node Name
   void getMyNodeName(std::string& _return) override;
 
@@ -80,6 +108,16 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<folly::Unit> semifuture_withdrawPrefixesByType(
       thrift::PrefixType prefixType) override;
 
+  folly::SemiFuture<folly::Unit> semifuture_beginSyncPrefixesByType(
+      thrift::PrefixType prefixType) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_addSyncPrefixesByType(
+      thrift::PrefixType prefixType,
+      std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixes) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_commitSyncPrefixesByType(
+      thrift::PrefixType prefixType) override;
+
   folly::SemiFuture<folly::Unit> semifuture_syncPrefixesByType(
       thrift::PrefixType prefixType,
       std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixes) override;
@@ -128,6 +166,9 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
   semifuture_getDecisionPrefixDbs() override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::TraceSpans>>
+  semifuture_getDecisionTraceSpans() override;
+
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
   semifuture_getRouteDbComputed(std::unique_ptr<std::string> nodeName) override;
 
@@ -189,11 +230,31 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   // immediately create and return the stream handler
   apache::thrift::ServerStream<thrift::Publication> subscribeKvStore() override;
 
+  // Stream of KvStore updates filtered on server side, publications with no
+  // matching keys are not sent at all
+  apache::thrift::ServerStream<thrift::Publication> subscribeKvStoreFilter(
+      std::unique_ptr<thrift::KeyDumpParams> filter,
+      std::unique_ptr<std::set<std::string>> areas) override;
+
+  // Stream of changed keys filtered on server side, without values
+  apache::thrift::ServerStream<thrift::Publication> subscribeKvStoreMetadata(
+      std::unique_ptr<thrift::KeyDumpParams> filter,
+      std::unique_ptr<std::set<std::string>> areas) override;
+
   folly::SemiFuture<apache::thrift::ResponseAndServerStream<
       thrift::Publication,
       thrift::Publication>>
   semifuture_subscribeAndGetKvStore() override;
 
+  // Stream of route updates of Fib
+  apache::thrift::ServerStream<thrift::RouteDatabaseDelta> subscribeFib()
+      override;
+
+  folly::SemiFuture<apache::thrift::ResponseAndServerStream<
+      thrift::RouteDatabase,
+      thrift::RouteDatabaseDelta>>
+  semifuture_subscribeAndGetFib() override;
+
   // Long poll support
   folly::SemiFuture<bool> semifuture_longPollKvStoreAdj(
       std::unique_ptr<thrift::KeyVals> snapshot) override;
@@ -256,9 +317,14 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
     return kvStorePublishers_.wlock()->size();
   }
 
+  inline size_t
+  getNumFibPublishers() {
+    return fibPublishers_.wlock()->size();
+  }
+
   inline size_t
   getNumPendingLongPollReqs() {
-    return longPollReqs_->size();
+    return longPollReqs_.rlock()->size();
   }
 
   //
@@ -275,6 +341,38 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   const std::string nodeName_;
   const std::unordered_set<std::string> acceptablePeerCommonNames_;
 
+  /**
+   * Response materialized from an immutable view handed over by a module.
+   * Only the view is taken on the event base of the module, `materialize`
+   * runs deferred on the executor consuming the returned future. For thrift
+   * handlers that is the thrift CPU pool, which serializes the response too.
+   */
+  template <typename View, typename Fn>
+  static auto
+  materializeView(folly::SemiFuture<View>&& view, Fn materialize) {
+    return std::move(view).deferValue(
+        [materialize = std::move(materialize)](View&& v) mutable {
+          return materialize(std::move(v));
+        });
+  }
+
+  // Snapshot of all counters
+  struct CountersSnapshot {
+    // monotonically increasing, identifies snapshot for delta requests
+    int64_t token{0};
+    std::chrono::steady_clock::time_point createTime;
+    std::shared_ptr<const std::map<std::string, int64_t>> counters;
+  };
+
+  // Collect counters of fb303 and ZmqMonitor
+  void collectCounters(std::map<std::string, int64_t>& counters);
+
+  // Latest snapshot if it is within countersCacheTtl_, new one otherwise
+  CountersSnapshot getCountersSnapshot();
+
+  // Compiled regex from cache, compiled and cached if not there
+  std::shared_ptr<const re2::RE2> getCompiledRegex(std::string const& regex);
+
   // Pointers to Open/R modules
   Decision* decision_{nullptr};
   Fib* fib_{nullptr};
@@ -286,22 +384,87 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   // client to interact with monitor
   std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
 
+  // low priority lane of expensive read-only requests
+  AdmissionController lowPriorityLane_;
+
+  // Recent counter snapshots, latest one at back. Older ones are retained as
+  // base of delta requests
+  const std::chrono::milliseconds countersCacheTtl_;
+  folly::Synchronized<std::deque<CountersSnapshot>> countersSnapshots_;
+
+  // Compiled regexes of counter requests, invalid ones included
+  folly::Synchronized<
+      std::unordered_map<std::string, std::shared_ptr<const re2::RE2>>>
+      regexCache_;
+
+  // Active kvstore snoop publisher along with its filters. Publisher is
+  // reset to std::nullopt once it is completed
+  struct KvStoreSubscriber {
+    KvStoreSubscriber(
+        apache::thrift::ServerStreamPublisher<thrift::Publication>&& publisher,
+        std::optional<thrift::KeyDumpParams> const& filter,
+        std::set<std::string> const& areas,
+        bool metadataOnly);
+
+    folly::Synchronized<std::optional<
+        apache::thrift::ServerStreamPublisher<thrift::Publication>>>
+        publisher;
+
+    // key prefix and originator filters, std::nullopt matches all keys
+    std::optional<KvStoreFilters> filters;
+
+    // areas to match, empty set matches all areas
+    const std::set<std::string> areas;
+
+    // send changed keys without values, see subscribeKvStoreMetadata
+    const bool metadataOnly{false};
+
+    // identical for subscribers with equal filters, they share the filtered
+    // publication
+    std::string filterKey;
+  };
+
+  apache::thrift::ServerStream<thrift::Publication> subscribeKvStoreImpl(
+      std::optional<thrift::KeyDumpParams> const& filter,
+      std::set<std::string> const& areas,
+      bool metadataOnly = false);
+
+  // Send publication to all subscribers. Filtering and sending is done outside
+  // of the lock on subscribers, which is only held to take their snapshot
+  void publishKvStoreUpdates(thrift::Publication const& publication);
+
   // Active kvstore snoop publishers
   std::atomic<int64_t> publisherToken_{0};
+  folly::Synchronized<
+      std::unordered_map<int64_t, std::shared_ptr<KvStoreSubscriber>>>
+      kvStorePublishers_;
+
+  // Active Fib route update publishers
   folly::Synchronized<std::unordered_map<
       int64_t,
-      apache::thrift::ServerStreamPublisher<thrift::Publication>>>
-      kvStorePublishers_;
+      apache::thrift::ServerStreamPublisher<thrift::RouteDatabaseDelta>>>
+      fibPublishers_;
+
+  // Send route update to all Fib subscribers
+  void publishFibUpdates(thrift::RouteDatabaseDelta const& delta);
 
-  // pending longPoll requests from clients, which consists of
+  // Fulfil all pending longPoll requests if the publication changes "adj:"
+  // keys of any area, and expire requests held over kLongPollReqHoldTime
+  void processLongPollReqs(thrift::Publication const& publication);
+
+  // pending longPoll request from client, which consists of
   // 1). promise; 2). timestamp when req received on server
+  using LongPollReq = std::pair<folly::Promise<bool>, int64_t>;
+
+  // pending longPoll requests indexed by request-ID. IDs are monotonically
+  // increasing, so oldest requests come first. Requests are not per area,
+  // clients watch the adjacencies of all of them
   std::atomic<int64_t> pendingRequestId_{0};
-  folly::Synchronized<
-      std::unordered_map<int64_t, std::pair<folly::Promise<bool>, int64_t>>>
-      longPollReqs_;
+  folly::Synchronized<std::map<int64_t, LongPollReq>> longPollReqs_;
 
   // fiber task future hold
   folly::Future<folly::Unit> taskFuture_;
+  folly::Future<folly::Unit> fibTaskFuture_;
 
 }; // class OpenrCtrlHandler
 } // namespace openr
@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <stdexcept>
+#include <vector>
+
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/ctrl-server/AdmissionController.h>
+
+namespace openr {
+
+namespace {
+
+// request whose response is set by the test through the returned promise
+folly::SemiFuture<int>
+runPending(
+    AdmissionController& lane,
+    std::string const& api,
+    std::vector<folly::Promise<int>>& promises) {
+  return lane.run(api, [&promises]() {
+    promises.emplace_back();
+    return promises.back().getSemiFuture();
+  });
+}
+
+} // namespace
+
+/**
+ * Requests in flight are bounded per lane and per API, others get queued and
+ * start once one completes
+ */
+TEST(AdmissionController, QueueAndRelease) {
+  AdmissionController lane(2, 4, 1, {{"big", 2}}, 1, 0);
+  std::vector<folly::Promise<int>> promises;
+  promises.reserve(8);
+
+  auto f1 = runPending(lane, "small", promises);
+  auto f2 = runPending(lane, "small", promises);
+  auto f3 = runPending(lane, "big", promises);
+  EXPECT_EQ(2, lane.getNumInFlight());
+  EXPECT_EQ(2, lane.getNumQueued());
+  EXPECT_EQ(2, promises.size());
+
+  // "small" is at its limit, queued "big" passes it
+  promises.at(0).setValue(1);
+  EXPECT_EQ(1, std::move(f1).get());
+  EXPECT_EQ(2, lane.getNumInFlight());
+  EXPECT_EQ(1, lane.getNumQueued());
+  EXPECT_EQ(3, promises.size());
+
+  promises.at(2).setValue(3);
+  EXPECT_EQ(3, std::move(f3).get());
+  EXPECT_EQ(1, lane.getNumInFlight());
+  EXPECT_EQ(1, lane.getNumQueued());
+
+  promises.at(1).setValue(2);
+  EXPECT_EQ(2, std::move(f2).get());
+  EXPECT_EQ(1, lane.getNumInFlight());
+  EXPECT_EQ(0, lane.getNumQueued());
+}
+
+/**
+ * Requests are rejected once the queue is full, exceptions are propagated
+ * and release their slot
+ */
+TEST(AdmissionController, RejectAndException) {
+  AdmissionController lane(1, 1, 1, {}, 1, 0);
+  std::vector<folly::Promise<int>> promises;
+  promises.reserve(4);
+
+  auto f1 = runPending(lane, "api", promises);
+  auto f2 = runPending(lane, "api", promises);
+  auto f3 = runPending(lane, "api", promises);
+  EXPECT_THROW(std::move(f3).get(), thrift::OpenrError);
+  EXPECT_EQ(1, lane.getNumQueued());
+
+  promises.at(0).setException(std::runtime_error("failed"));
+  EXPECT_THROW(std::move(f1).get(), std::runtime_error);
+  EXPECT_EQ(1, lane.getNumInFlight());
+  EXPECT_EQ(0, lane.getNumQueued());
+
+  promises.at(1).setValue(2);
+  EXPECT_EQ(2, std::move(f2).get());
+
+  // throwing fn releases its slot as well
+  auto f4 = lane.run("api", []() -> folly::SemiFuture<int> {
+    throw std::runtime_error("failed");
+  });
+  EXPECT_THROW(std::move(f4).get(), std::runtime_error);
+  EXPECT_EQ(0, lane.getNumInFlight());
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -5,11 +5,14 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <thread>
 
+#include <fb303/ServiceData.h>
 #include <fbzmq/service/monitor/ZmqMonitor.h>
 #include <fbzmq/zmq/Context.h>
+#include <folly/Format.h>
 #include <folly/init/Init.h>
 #include <glog/logging.h>
 #include <gmock/gmock.h>
@@ -84,6 +87,8 @@ class OpenrCtrlFixture : public ::testing::Test {
     decisionThread_ = std::thread([&]() { decision->run(); });
 
     // Create Fib module
+    FibOptions fibOptions;
+    fibOptions.fibUpdatesQueue = &fibUpdatesQueue_;
     fib = std::make_shared<Fib>(
         nodeName,
         -1, /* thrift port */
@@ -96,7 +101,8 @@ class OpenrCtrlFixture : public ::testing::Test {
         interfaceUpdatesQueue_.getReader(),
         MonitorSubmitUrl{"inproc://monitor-sub"},
         kvStoreWrapper->getKvStore(),
-        context_);
+        context_,
+        fibOptions);
     fibThread_ = std::thread([&]() { fib->run(); });
 
     // Create PrefixManager module
@@ -171,7 +177,8 @@ class OpenrCtrlFixture : public ::testing::Test {
         persistentStore.get() /* configStore */,
         prefixManager.get() /* prefixManager */,
         monitorSubmitUrl_,
-        context_);
+        context_,
+        fibUpdatesQueue_.getReader());
     openrThriftServerWrapper_->run();
 
     // initialize openrCtrlClient talking to server
@@ -190,6 +197,7 @@ class OpenrCtrlFixture : public ::testing::Test {
     peerUpdatesQueue_.close();
     neighborUpdatesQueue_.close();
     prefixUpdatesQueue_.close();
+    fibUpdatesQueue_.close();
     kvStoreWrapper->closeQueue();
 
     openrThriftServerWrapper_->stop();
@@ -233,6 +241,12 @@ class OpenrCtrlFixture : public ::testing::Test {
     return prefixEntry;
   }
 
+  // route updates as if sent by Decision
+  void
+  pushRouteUpdates(thrift::RouteDatabaseDelta delta) {
+    routeUpdatesQueue_.push(std::move(delta));
+  }
+
  private:
   const MonitorSubmitUrl monitorSubmitUrl_{"inproc://monitor-submit-url"};
   const PlatformPublisherUrl platformPubUrl_{"inproc://platform-pub-url"};
@@ -240,10 +254,11 @@ class OpenrCtrlFixture : public ::testing::Test {
   messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue_;
   messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue_;
   messaging::ReplicateQueue<thrift::PeerUpdateRequest> peerUpdatesQueue_;
-  messaging::ReplicateQueue<thrift::SparkNeighborEvent> neighborUpdatesQueue_;
+  messaging::ReplicateQueue<thrift::SparkNeighborEvents> neighborUpdatesQueue_;
   messaging::ReplicateQueue<thrift::PrefixUpdateRequest> prefixUpdatesQueue_;
   messaging::ReplicateQueue<thrift::RouteDatabaseDelta>
       staticRoutesUpdatesQueue_;
+  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> fibUpdatesQueue_;
 
   fbzmq::Context context_;
   folly::EventBase evb_;
@@ -280,6 +295,39 @@ TEST_F(OpenrCtrlFixture, getMyNodeName) {
   EXPECT_EQ(nodeName, res);
 }
 
+TEST_F(OpenrCtrlFixture, CountersApis) {
+  facebook::fb303::fbData->setCounter("ctrl.test.counter1", 1);
+  facebook::fb303::fbData->setCounter("ctrl.test.counter2", 2);
+
+  {
+    std::map<std::string, int64_t> counters;
+    openrCtrlThriftClient_->sync_getRegexCounters(counters, "ctrl\\.test\\.");
+    EXPECT_EQ(2, counters.size());
+    EXPECT_EQ(1, counters.at("ctrl.test.counter1"));
+    EXPECT_EQ(2, counters.at("ctrl.test.counter2"));
+  }
+
+  thrift::CountersDelta delta;
+  openrCtrlThriftClient_->sync_getCountersDelta(delta, 0);
+  EXPECT_TRUE(delta.isFullDump);
+  EXPECT_EQ(1, delta.counters.at("ctrl.test.counter1"));
+  EXPECT_EQ(2, delta.counters.at("ctrl.test.counter2"));
+
+  // Only changed counter is returned with token of previous request
+  facebook::fb303::fbData->setCounter("ctrl.test.counter2", 3);
+  const auto token = delta.token;
+  openrCtrlThriftClient_->sync_getCountersDelta(delta, token);
+  EXPECT_FALSE(delta.isFullDump);
+  EXPECT_LT(token, delta.token);
+  EXPECT_EQ(0, delta.counters.count("ctrl.test.counter1"));
+  EXPECT_EQ(3, delta.counters.at("ctrl.test.counter2"));
+
+  // Unknown token gets all counters
+  openrCtrlThriftClient_->sync_getCountersDelta(delta, token + 1000);
+  EXPECT_TRUE(delta.isFullDump);
+  EXPECT_EQ(1, delta.counters.at("ctrl.test.counter1"));
+}
+
 TEST_F(OpenrCtrlFixture, PrefixManagerApis) {
   {
     std::vector<thrift::PrefixEntry> prefixes{
@@ -379,6 +427,112 @@ TEST_F(OpenrCtrlFixture, RouteApis) {
   }
 }
 
+/**
+ * Route updates programmed by Fib are streamed to subscribers, after the
+ * route database for subscribeAndGetFib
+ */
+TEST_F(OpenrCtrlFixture, FibStreamApis) {
+  auto handler = openrThriftServerWrapper_->getOpenrCtrlHandler();
+  const auto prefix1 = toIpPrefix("10.1.0.0/16");
+  const auto prefix2 = toIpPrefix("10.2.0.0/16");
+  const auto nextHop =
+      createNextHop(toBinaryAddress(folly::IPAddress("fe80::1")), "po1", 1);
+  // NOTE: Decision may publish route updates of its own
+  auto hasRoute = [](thrift::RouteDatabaseDelta const& delta,
+                     thrift::IpPrefix const& prefix) {
+    for (auto const& route : delta.unicastRoutesToUpdate) {
+      if (route.dest == prefix) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  //
+  // Subscribe API
+  //
+
+  {
+    std::atomic<int> received{0};
+    auto subscription =
+        handler->subscribeFib().toClientStream().subscribeExTry(
+            folly::getEventBase(), [&](auto&& t) {
+              if (!t.hasValue() or not hasRoute(*t, prefix1)) {
+                return;
+              }
+              EXPECT_EQ(nodeName, t->thisNodeName);
+              received++;
+            });
+    EXPECT_EQ(1, handler->getNumFibPublishers());
+
+    thrift::RouteDatabaseDelta delta;
+    delta.thisNodeName = nodeName;
+    delta.unicastRoutesToUpdate.emplace_back(
+        createUnicastRoute(prefix1, {nextHop}));
+    pushRouteUpdates(std::move(delta));
+    while (received < 1) {
+      std::this_thread::yield();
+    }
+
+    // Cancel subscription
+    subscription.cancel();
+    std::move(subscription).detach();
+
+    // Wait until publisher is destroyed
+    while (handler->getNumFibPublishers() != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  //
+  // Subscribe and Get API
+  //
+
+  {
+    std::atomic<int> received{0};
+    auto responseAndSubscription =
+        handler->semifuture_subscribeAndGetFib().get();
+    auto const& routeDb = responseAndSubscription.response;
+    EXPECT_EQ(nodeName, routeDb.thisNodeName);
+    EXPECT_TRUE(std::any_of(
+        routeDb.unicastRoutes.begin(),
+        routeDb.unicastRoutes.end(),
+        [&](auto const& route) { return route.dest == prefix1; }));
+
+    auto subscription =
+        std::move(responseAndSubscription.stream)
+            .toClientStream()
+            .subscribeExTry(folly::getEventBase(), [&](auto&& t) {
+              // replicated updates of the snapshot may come first
+              if (!t.hasValue() or not hasRoute(*t, prefix2)) {
+                return;
+              }
+              auto const& deleted = t->unicastRoutesToDelete;
+              EXPECT_NE(
+                  deleted.end(),
+                  std::find(deleted.begin(), deleted.end(), prefix1));
+              received++;
+            });
+    EXPECT_EQ(1, handler->getNumFibPublishers());
+
+    thrift::RouteDatabaseDelta delta;
+    delta.thisNodeName = nodeName;
+    delta.unicastRoutesToDelete.emplace_back(prefix1);
+    delta.unicastRoutesToUpdate.emplace_back(
+        createUnicastRoute(prefix2, {nextHop}));
+    pushRouteUpdates(std::move(delta));
+    while (received < 1) {
+      std::this_thread::yield();
+    }
+
+    subscription.cancel();
+    std::move(subscription).detach();
+    while (handler->getNumFibPublishers() != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
 TEST_F(OpenrCtrlFixture, PerfApis) {
   thrift::PerfDatabase db;
   openrCtrlThriftClient_->sync_getPerfDb(db);
@@ -735,6 +889,172 @@ TEST_F(OpenrCtrlFixture, KvStoreApis) {
       std::this_thread::yield();
     }
   }
+
+  //
+  // Subscribe API with filter
+  //
+
+  {
+    std::atomic<int> received{0};
+    const std::string key{"filter-key"};
+    auto handler = openrThriftServerWrapper_->getOpenrCtrlHandler();
+    thrift::KeyDumpParams filter;
+    filter.prefix = "filter-";
+    auto subscription =
+        handler
+            ->subscribeKvStoreFilter(
+                std::make_unique<thrift::KeyDumpParams>(filter),
+                std::make_unique<std::set<std::string>>(
+                    std::set<std::string>{"pod"}))
+            .toClientStream()
+            .subscribeExTry(folly::getEventBase(), [&received, key](auto&& t) {
+              if (!t.hasValue()) {
+                return;
+              }
+              // Only matching keys of "pod" area are streamed
+              auto& pub = *t;
+              EXPECT_EQ("pod", pub.area.value());
+              EXPECT_EQ(1, pub.keyVals.size());
+              ASSERT_EQ(1, pub.keyVals.count(key));
+              EXPECT_EQ(received + 2, pub.keyVals.at(key).version);
+              received++;
+            });
+    EXPECT_EQ(1, handler->getNumKvStorePublishers());
+    kvStoreWrapper->setKey(
+        key, createThriftValue(1, "node1", std::string("value1")));
+    kvStoreWrapper->setKey(
+        "snoop-key",
+        createThriftValue(9, "node1", std::string("value1")),
+        std::nullopt,
+        "pod");
+    kvStoreWrapper->setKey(
+        key,
+        createThriftValue(2, "node1", std::string("value1")),
+        std::nullopt,
+        "pod");
+    kvStoreWrapper->setKey(
+        key,
+        createThriftValue(3, "node1", std::string("value1")),
+        std::nullopt,
+        "pod");
+
+    // Check we should receive-2 updates
+    while (received < 2) {
+      std::this_thread::yield();
+    }
+
+    // Cancel subscription
+    subscription.cancel();
+    std::move(subscription).detach();
+
+    // Wait until publisher is destroyed
+    while (handler->getNumKvStorePublishers() != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  //
+  // Subscribe API with metadata only
+  //
+
+  {
+    std::atomic<int> received{0};
+    const std::string key{"meta-key"};
+    auto handler = openrThriftServerWrapper_->getOpenrCtrlHandler();
+    thrift::KeyDumpParams filter;
+    filter.prefix = "meta-";
+    auto subscription =
+        handler
+            ->subscribeKvStoreMetadata(
+                std::make_unique<thrift::KeyDumpParams>(filter),
+                std::make_unique<std::set<std::string>>())
+            .toClientStream()
+            .subscribeExTry(folly::getEventBase(), [&received, key](auto&& t) {
+              if (!t.hasValue()) {
+                return;
+              }
+              // Changes come without value, but with its hash
+              auto& pub = *t;
+              ASSERT_EQ(1, pub.keyVals.count(key));
+              auto const& meta = pub.keyVals.at(key);
+              EXPECT_FALSE(meta.value.has_value());
+              EXPECT_TRUE(meta.hash.has_value());
+              EXPECT_EQ("node1", meta.originatorId);
+              EXPECT_EQ(received + 1, meta.version);
+              received++;
+            });
+    EXPECT_EQ(1, handler->getNumKvStorePublishers());
+    kvStoreWrapper->setKey(
+        key, createThriftValue(1, "node1", std::string("value1")));
+    kvStoreWrapper->setKey(
+        key, createThriftValue(2, "node1", std::string("value2")));
+
+    while (received < 2) {
+      std::this_thread::yield();
+    }
+
+    // value is fetched on demand
+    thrift::Publication pub;
+    openrCtrlThriftClient_->sync_getKvStoreKeyVals(
+        pub, std::vector<std::string>{key});
+    ASSERT_EQ(1, pub.keyVals.count(key));
+    EXPECT_EQ("value2", pub.keyVals.at(key).value.value());
+
+    subscription.cancel();
+    std::move(subscription).detach();
+    while (handler->getNumKvStorePublishers() != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+TEST_F(OpenrCtrlFixture, LongPollAdjOfOtherArea) {
+  // long polls compare their snapshot with the default area, but must be
+  // woken by adjacency changes of any area
+  auto handler = openrThriftServerWrapper_->getOpenrCtrlHandler();
+  const std::string adjKey = folly::sformat("adj:{}", nodeName);
+
+  // take the snapshot once LinkMonitor advertised its adjacencies, so that
+  // only the changes below differ from it
+  thrift::KeyVals snapshot;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (snapshot.count(adjKey) == 0) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+        << "adjacencies of " << nodeName << " not advertised";
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    thrift::KeyDumpParams params;
+    params.prefix = Constants::kAdjDbMarker;
+    snapshot = handler
+                   ->semifuture_getKvStoreKeyValsFiltered(
+                       std::make_unique<thrift::KeyDumpParams>(params))
+                   .get()
+                   ->keyVals;
+  }
+
+  auto longPoll = handler->semifuture_longPollKvStoreAdj(
+      std::make_unique<thrift::KeyVals>(snapshot));
+  EXPECT_EQ(1, handler->getNumPendingLongPollReqs());
+
+  // other keys of another area don't change adjacencies
+  kvStoreWrapper->setKey(
+      "key1",
+      createThriftValue(1, "node1", std::string("value1")),
+      std::nullopt,
+      "pod");
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(longPoll.isReady());
+  EXPECT_EQ(1, handler->getNumPendingLongPollReqs());
+
+  kvStoreWrapper->setKey(
+      "adj:node1",
+      createThriftValue(1, "node1", std::string("value1")),
+      std::nullopt,
+      "pod");
+  EXPECT_TRUE(std::move(longPoll).get(std::chrono::seconds(10)));
+  EXPECT_EQ(0, handler->getNumPendingLongPollReqs());
 }
 
 TEST_F(OpenrCtrlFixture, LinkMonitorApis) {
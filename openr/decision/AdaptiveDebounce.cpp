@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "AdaptiveDebounce.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// weight of a new sample in moving averages
+constexpr double kEwmaWeight{0.25};
+
+void
+addSample(std::optional<double>& average, double sample) {
+  average = average.has_value()
+      ? (1 - kEwmaWeight) * average.value() + kEwmaWeight * sample
+      : sample;
+}
+
+std::chrono::milliseconds
+toDuration(const std::optional<double>& averageMs) {
+  return std::chrono::milliseconds(
+      static_cast<int64_t>(averageMs.value_or(0)));
+}
+
+} // namespace
+
+AdaptiveDebounce::AdaptiveDebounce(
+    std::chrono::milliseconds minDebounce,
+    std::chrono::milliseconds maxDebounce)
+    : minDebounce_(minDebounce), maxDebounce_(maxDebounce) {
+  CHECK(minDebounce >= std::chrono::milliseconds(0))
+      << "Debounce must not be negative";
+  CHECK(minDebounce <= maxDebounce)
+      << "Max debounce must not be less than min debounce";
+}
+
+std::optional<std::chrono::milliseconds>
+AdaptiveDebounce::reportUpdate(Clock::time_point now) {
+  const bool quiet =
+      not lastUpdate_.has_value() or now - lastUpdate_.value() >= maxDebounce_;
+  if (quiet) {
+    avgGapMs_ = std::nullopt;
+  } else {
+    addSample(
+        avgGapMs_,
+        std::chrono::duration<double, std::milli>(now - lastUpdate_.value())
+            .count());
+  }
+  lastUpdate_ = now;
+  ++pendingCount_;
+
+  auto window = minDebounce_;
+  if (not quiet) {
+    window = std::max(
+        {minDebounce_,
+         2 * getAverageGap(),
+         std::min(getAverageRunTime(), maxDebounce_)});
+  }
+  Clock::time_point deadline = now + window;
+  if (firstPending_.has_value()) {
+    // windows only get extended, up to maxDebounce since the first update
+    deadline = std::min(
+        std::max(deadline, deadline_), firstPending_.value() + maxDebounce_);
+    if (deadline == deadline_) {
+      return std::nullopt;
+    }
+  } else {
+    firstPending_ = now;
+  }
+  deadline_ = deadline;
+  return std::max(
+      std::chrono::milliseconds(0),
+      std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now));
+}
+
+void
+AdaptiveDebounce::reportRun(std::chrono::milliseconds runTime) {
+  addSample(avgRunMs_, runTime.count());
+  firstPending_ = std::nullopt;
+  pendingCount_ = 0;
+}
+
+std::chrono::milliseconds
+AdaptiveDebounce::getPendingDuration(Clock::time_point now) const {
+  if (not firstPending_.has_value()) {
+    return std::chrono::milliseconds(0);
+  }
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      now - firstPending_.value());
+}
+
+std::chrono::milliseconds
+AdaptiveDebounce::getAverageGap() const {
+  return toDuration(avgGapMs_);
+}
+
+std::chrono::milliseconds
+AdaptiveDebounce::getAverageRunTime() const {
+  return toDuration(avgRunMs_);
+}
+
+} // namespace openr
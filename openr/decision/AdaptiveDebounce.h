@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace openr {
+
+/**
+ * Debounce of route computation driven by the observed churn, rather than by
+ * plain exponential backoff.
+ *
+ * - An isolated update, arriving after at least maxDebounce without updates,
+ *   is processed after minDebounce.
+ * - While updates keep arriving, the window gets extended to twice the
+ *   average gap between updates from the latest one, so that a storm is
+ *   coalesced until it calms down. The window is also at least as long as an
+ *   average run of route computation, which bounds the share of time spent
+ *   computing routes to about half during storms.
+ * - No update is held for longer than maxDebounce.
+ */
+class AdaptiveDebounce {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @param minDebounce   Time to wait for more updates after an isolated one
+   * @param maxDebounce   Maximum time any update is held. Also the period
+   *                      without updates after which churn is considered over
+   */
+  AdaptiveDebounce(
+      std::chrono::milliseconds minDebounce,
+      std::chrono::milliseconds maxDebounce);
+
+  /**
+   * Report arrival of an update. Returns the time from now after which
+   * pending updates should be processed, if it has moved. Otherwise the
+   * previously returned time still holds.
+   */
+  std::optional<std::chrono::milliseconds> reportUpdate(
+      Clock::time_point now = Clock::now());
+
+  /**
+   * Report that pending updates got processed, which took runTime. Starts a
+   * new window.
+   */
+  void reportRun(std::chrono::milliseconds runTime);
+
+  // number of updates reported since the last run
+  uint32_t
+  getPendingCount() const {
+    return pendingCount_;
+  }
+
+  // time since the first update pending, zero if there is none
+  std::chrono::milliseconds getPendingDuration(
+      Clock::time_point now = Clock::now()) const;
+
+  // moving averages of gaps between updates during churn and of run times
+  std::chrono::milliseconds getAverageGap() const;
+  std::chrono::milliseconds getAverageRunTime() const;
+
+ private:
+  const std::chrono::milliseconds minDebounce_;
+  const std::chrono::milliseconds maxDebounce_;
+
+  std::optional<Clock::time_point> lastUpdate_;
+  std::optional<Clock::time_point> firstPending_;
+  Clock::time_point deadline_;
+  uint32_t pendingCount_{0};
+
+  // exponentially weighted moving averages in milliseconds. avgGapMs_ is
+  // reset once churn is over
+  std::optional<double> avgGapMs_;
+  std::optional<double> avgRunMs_;
+};
+
+} // namespace openr
@@ -7,9 +7,15 @@
 
 #include "Decision.h"
 
+#include <algorithm>
 #include <chrono>
+#include <functional>
+#include <mutex>
+#include <queue>
 #include <set>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <unordered_set>
 
 #include <fb303/ServiceData.h>
@@ -20,6 +26,11 @@
 #include <folly/Memory.h>
 #include <folly/Optional.h>
 #include <folly/String.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/InlineExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
 #if FOLLY_USE_SYMBOLIZER
 #include <folly/experimental/exception_tracer/ExceptionTracer.h>
@@ -27,10 +38,13 @@
 #include <gflags/gflags.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/LsdbEncoding.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
+#include <openr/decision/DijkstraQueue.h>
 #include <openr/decision/LinkState.h>
 #include <openr/decision/PrefixState.h>
+#include <openr/if/gen-cpp2/KvStore_constants.h>
 
 using namespace std;
 
@@ -49,7 +63,7 @@ using SpfResult = unordered_map<
 // atleast one. Second attribute describe the link that is followed from
 // associated node (first attribute)
 // Path is described in reverse. Last index is the next immediate node.
-using Path = std::vector<std::pair<std::string, std::shared_ptr<openr::Link>>>;
+using Path = std::vector<std::pair<std::string, openr::Link*>>;
 
 namespace {
 
@@ -84,75 +98,461 @@ pathAInPathB(const Path& a, const Path& b) {
   return false;
 }
 
-// Classes needed for running Dijkstra
-class DijkstraQNode {
- public:
-  DijkstraQNode(const std::string& n, Metric d) : nodeName(n), distance(d) {}
-  const std::string nodeName;
-  Metric distance{0};
-  std::unordered_set<std::string> nextHops;
+using NodeId = openr::LinkState::NodeId;
+using CsrGraph = openr::LinkState::CsrGraph;
+
+constexpr size_t kBitsPerWord{64};
+constexpr size_t kNoBit{std::numeric_limits<size_t>::max()};
+constexpr Metric kInfMetric{std::numeric_limits<Metric>::max()};
+
+// priority queue of <distance, node> used for Dijkstra runs by default. Link
+// metrics are non-negative integers, so the monotone radix heap applies. SPF
+// routines take the queue as template parameter, see DijkstraQueue.h
+using DijkstraQ = openr::RadixHeapQueue<Metric, NodeId>;
+
+// Integer indexed result of a SPF run from a single source over the CsrGraph.
+// Retained across runs for incremental SPF
+struct SpfState {
+  // LinkState version this state reflects
+  uint64_t version{0};
+  NodeId srcId{0};
+  // every next-hop is a neighbor of the source. Each of them is assigned a bit
+  // so that next-hop sets can be merged word by word
+  std::vector<NodeId> nhBitToNode;
+  std::vector<size_t> nodeToNhBit;
+  size_t nhWords{0};
+  // indexed by NodeId, kInfMetric for unreachable nodes
+  std::vector<Metric> distances;
+  // next-hop bitset of node `id` are words [id * nhWords, (id + 1) * nhWords)
+  std::vector<uint64_t> nextHops;
+
+  uint64_t*
+  nextHopsOf(NodeId nodeId) {
+    return nextHops.data() + nodeId * nhWords;
+  }
+
+  void
+  resetNextHops(NodeId nodeId) {
+    std::fill(nextHopsOf(nodeId), nextHopsOf(nodeId) + nhWords, 0);
+  }
+
+  // merge next-hops that `fromNode` offers to its neighbor `toNode`, return
+  // true if next-hops of `toNode` have changed
+  bool
+  mergeNextHops(NodeId fromNode, NodeId toNode) {
+    uint64_t* toNextHops = nextHopsOf(toNode);
+    if (fromNode == srcId) {
+      // toNode is directly connected to the source
+      const auto bit = nodeToNhBit.at(toNode);
+      CHECK_NE(kNoBit, bit);
+      const uint64_t mask = 1ULL << (bit % kBitsPerWord);
+      const bool changed = not(toNextHops[bit / kBitsPerWord] & mask);
+      toNextHops[bit / kBitsPerWord] |= mask;
+      return changed;
+    }
+    bool changed = false;
+    const uint64_t* fromNextHops = nextHopsOf(fromNode);
+    for (size_t w = 0; w < nhWords; ++w) {
+      changed |= (fromNextHops[w] & ~toNextHops[w]) != 0;
+      toNextHops[w] |= fromNextHops[w];
+    }
+    return changed;
+  }
 };
 
-class DijkstraQ {
- private:
-  std::vector<std::shared_ptr<DijkstraQNode>> heap_;
-  std::unordered_map<std::string, std::shared_ptr<DijkstraQNode>> nameToNode_;
+// nodes which can be used for transit traffic from the source
+bool
+isTransitNode(const CsrGraph& graph, const SpfState& state, NodeId nodeId) {
+  return nodeId == state.srcId or not graph.overloaded[nodeId];
+}
+
+// run Dijkstra from srcId over the graph and store the result in state
+template <typename Queue = DijkstraQ>
+void
+runFullSpf(
+    const CsrGraph& graph,
+    NodeId srcId,
+    bool useLinkMetric,
+    const openr::LinkState::LinkSet& linksToIgnore,
+    SpfState& state) {
+  const size_t numNodes = graph.numNodes();
+
+  state.srcId = srcId;
+  state.nhBitToNode.clear();
+  state.nodeToNhBit.assign(numNodes, kNoBit);
+  for (auto i = graph.offsets[srcId]; i < graph.offsets[srcId + 1]; ++i) {
+    auto const otherNode = graph.edges[i].otherNode;
+    if (state.nodeToNhBit[otherNode] == kNoBit) {
+      state.nodeToNhBit[otherNode] = state.nhBitToNode.size();
+      state.nhBitToNode.emplace_back(otherNode);
+    }
+  }
+  state.nhWords = (state.nhBitToNode.size() + kBitsPerWord - 1) / kBitsPerWord;
+  state.distances.assign(numNodes, kInfMetric);
+  state.nextHops.assign(numNodes * state.nhWords, 0);
+
+  std::vector<bool> settled(numNodes, false);
+  Queue q;
+  state.distances[srcId] = 0;
+  q.push(0, srcId);
+
+  uint64_t loop = 0;
+  while (not q.empty()) {
+    const auto [nodeMetric, nodeId] = q.top();
+    q.pop();
+    if (settled[nodeId]) {
+      continue;
+    }
+    // we've found this node's shortest paths
+    settled[nodeId] = true;
+    ++loop;
+
+    if (not isTransitNode(graph, state, nodeId)) {
+      // no transit traffic through this node. we've recorded the nexthops to
+      // this node, but will not consider any of it's adjancecies as offering
+      // lower cost paths towards further away nodes. This effectively drains
+      // traffic away from this node
+      continue;
+    }
 
-  struct {
-    bool
-    operator()(
-        std::shared_ptr<DijkstraQNode> a,
-        std::shared_ptr<DijkstraQNode> b) const {
-      if (a->distance != b->distance) {
-        return a->distance > b->distance;
+    // we have the shortest path nexthops for nodeId. Use these nextHops for
+    // any node that is connected to nodeId that doesn't already have a lower
+    // cost path from source
+    //
+    // this is the "relax" step in the Dijkstra Algorithm pseudocode in CLRS
+    for (auto i = graph.offsets[nodeId]; i < graph.offsets[nodeId + 1]; ++i) {
+      auto const& edge = graph.edges[i];
+      if (settled[edge.otherNode] or
+          (not linksToIgnore.empty() and linksToIgnore.count(edge.link))) {
+        continue;
       }
-      return a->nodeName > b->nodeName;
+      const Metric metric = nodeMetric + (useLinkMetric ? edge.metric : 1);
+      auto& otherMetric = state.distances[edge.otherNode];
+      if (otherMetric < metric) {
+        continue;
+      }
+      // nodeId is either along an alternate shortest path towards otherNode
+      // or is along a new shorter path. In either case, otherNode should use
+      // nodeId's nextHops until it finds some shorter path
+      if (otherMetric > metric) {
+        // if this is strictly better, forget about any other nexthops
+        otherMetric = metric;
+        state.resetNextHops(edge.otherNode);
+        q.push(metric, edge.otherNode);
+      }
+      state.mergeNextHops(nodeId, edge.otherNode);
     }
-  } DijkstraQNodeGreater;
+  }
+  VLOG(3) << "Dijkstra loop count: " << loop;
+}
 
- public:
-  void
-  insertNode(const std::string& nodeName, Metric d) {
-    heap_.push_back(std::make_shared<DijkstraQNode>(nodeName, d));
-    nameToNode_[nodeName] = heap_.back();
-    std::push_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
+//
+// Repair the shortest path tree in `state` after a single link change.
+// Returns false if the change can not be applied incrementally, in which case
+// state is left untouched.
+//
+// 1. All nodes which had at least one shortest path over the changed link are
+//    marked affected (descendants in the shortest path DAG) and recomputed by
+//    running Dijkstra among them, seeded from their unaffected neighbors.
+// 2. Improvements (link up or metric decrease) are propagated from the link
+//    ends and the recomputed nodes until no more distance decreases or
+//    next-hop additions happen.
+//
+template <typename Queue = DijkstraQ>
+bool
+runIncrementalSpf(
+    const openr::LinkState& linkState,
+    const openr::LinkState::LinkChange& change,
+    SpfState& state) {
+  auto const& graph = linkState.getCsrGraph();
+  auto const& link = *change.link;
+  const size_t numNodes = state.distances.size();
+  const auto maybeId1 = linkState.getNodeId(link.firstNodeName());
+  const auto maybeId2 = linkState.getNodeId(link.secondNodeName());
+  if (numNodes != graph.numNodes() or not maybeId1.has_value() or
+      not maybeId2.has_value()) {
+    return false;
+  }
+  const NodeId id1 = maybeId1.value(), id2 = maybeId2.value();
+  // new adjacency of the source needs a next-hop bit we don't have
+  if ((id1 == state.srcId and state.nodeToNhBit[id2] == kNoBit) or
+      (id2 == state.srcId and state.nodeToNhBit[id1] == kNoBit)) {
+    return false;
   }
 
-  std::shared_ptr<DijkstraQNode>
-  get(const std::string& nodeName) {
-    if (nameToNode_.count(nodeName)) {
-      return nameToNode_.at(nodeName);
+  auto& distances = state.distances;
+
+  // Step-1 find affected nodes, based on the metric prior to the change
+  std::vector<bool> affected(numNodes, false);
+  std::vector<NodeId> affectedNodes;
+  auto maybeMarkAffected = [&](
+      NodeId fromNode, NodeId toNode, Metric metric) {
+    if (toNode != state.srcId and not affected[toNode] and
+        distances[fromNode] != kInfMetric and
+        isTransitNode(graph, state, fromNode) and
+        distances[fromNode] + metric == distances[toNode]) {
+      affected[toNode] = true;
+      affectedNodes.emplace_back(toNode);
     }
-    return nullptr;
+  };
+  if (change.oldMetric1.has_value()) {
+    maybeMarkAffected(id1, id2, change.oldMetric1.value());
+  }
+  if (change.oldMetric2.has_value()) {
+    maybeMarkAffected(id2, id1, change.oldMetric2.value());
+  }
+  for (size_t i = 0; i < affectedNodes.size(); ++i) {
+    const NodeId nodeId = affectedNodes[i];
+    for (auto j = graph.offsets[nodeId]; j < graph.offsets[nodeId + 1]; ++j) {
+      auto const& edge = graph.edges[j];
+      // the changed link has been accounted for above
+      if (*edge.link == link) {
+        continue;
+      }
+      maybeMarkAffected(nodeId, edge.otherNode, edge.metric);
+    }
+  }
+  VLOG(3) << "Incremental SPF: " << affectedNodes.size() << " affected nodes";
+
+  // Step-2 recompute affected nodes from their unaffected neighbors
+  Queue q;
+  for (auto const nodeId : affectedNodes) {
+    distances[nodeId] = kInfMetric;
+    state.resetNextHops(nodeId);
+  }
+  // relax fromNode -> toNode, returns true if distance or next-hops changed
+  auto relax = [&](NodeId fromNode, NodeId toNode, Metric metric) {
+    if (metric < distances[toNode]) {
+      distances[toNode] = metric;
+      state.resetNextHops(toNode);
+      state.mergeNextHops(fromNode, toNode);
+      return true;
+    }
+    return metric == distances[toNode] and
+        state.mergeNextHops(fromNode, toNode);
+  };
+  for (auto const nodeId : affectedNodes) {
+    for (auto j = graph.offsets[nodeId]; j < graph.offsets[nodeId + 1]; ++j) {
+      auto const& edge = graph.edges[j];
+      const NodeId otherNode = edge.otherNode;
+      if (affected[otherNode] or distances[otherNode] == kInfMetric or
+          not isTransitNode(graph, state, otherNode)) {
+        continue;
+      }
+      const Metric metric = distances[otherNode] +
+          edge.link->getMetricFromNode(linkState.getNodeName(otherNode));
+      if (relax(otherNode, nodeId, metric)) {
+        q.push(distances[nodeId], nodeId);
+      }
+    }
+  }
+  std::vector<bool> settled(numNodes, false);
+  while (not q.empty()) {
+    const auto [nodeMetric, nodeId] = q.top();
+    q.pop();
+    if (settled[nodeId] or nodeMetric != distances[nodeId]) {
+      continue;
+    }
+    settled[nodeId] = true;
+    if (not isTransitNode(graph, state, nodeId)) {
+      continue;
+    }
+    for (auto j = graph.offsets[nodeId]; j < graph.offsets[nodeId + 1]; ++j) {
+      auto const& edge = graph.edges[j];
+      if (not affected[edge.otherNode] or settled[edge.otherNode]) {
+        continue;
+      }
+      if (relax(nodeId, edge.otherNode, nodeMetric + edge.metric)) {
+        q.push(distances[edge.otherNode], edge.otherNode);
+      }
+    }
+  }
+
+  // Step-3 propagate improvements from the link ends and recomputed nodes.
+  // Seeds may be closer than nodes settled above, start over with a new queue
+  q = Queue();
+  for (auto const nodeId : affectedNodes) {
+    if (distances[nodeId] != kInfMetric) {
+      q.push(distances[nodeId], nodeId);
+    }
+  }
+  for (auto const nodeId : {id1, id2}) {
+    if (distances[nodeId] != kInfMetric) {
+      q.push(distances[nodeId], nodeId);
+    }
+  }
+  while (not q.empty()) {
+    const auto [nodeMetric, nodeId] = q.top();
+    q.pop();
+    if (nodeMetric != distances[nodeId] or
+        not isTransitNode(graph, state, nodeId)) {
+      continue;
+    }
+    for (auto j = graph.offsets[nodeId]; j < graph.offsets[nodeId + 1]; ++j) {
+      auto const& edge = graph.edges[j];
+      if (edge.otherNode == state.srcId) {
+        continue;
+      }
+      if (relax(nodeId, edge.otherNode, nodeMetric + edge.metric)) {
+        q.push(distances[edge.otherNode], edge.otherNode);
+      }
+    }
+  }
+  return true;
+}
+
+// Per node inputs of unicast route computation besides SPF results. Routes to
+// prefixes of a node need rebuilding once any of these changes
+struct NodeRouteAttrs {
+  bool overloaded{false};
+  int32_t nodeLabel{0};
+  std::optional<openr::thrift::BinaryAddress> loopbackV4;
+  std::optional<openr::thrift::BinaryAddress> loopbackV6;
+
+  bool
+  operator==(const NodeRouteAttrs& other) const {
+    return overloaded == other.overloaded and nodeLabel == other.nodeLabel and
+        loopbackV4 == other.loopbackV4 and loopbackV6 == other.loopbackV6;
+  }
+
+  bool
+  operator!=(const NodeRouteAttrs& other) const {
+    return not(*this == other);
+  }
+};
+
+// Attributes of a link of the local node used for unicast next-hops. Every
+// route may go over any of them
+struct LocalLinkAttrs {
+  std::string otherNodeName;
+  std::string iface;
+  openr::thrift::BinaryAddress nhV4;
+  openr::thrift::BinaryAddress nhV6;
+  Metric metric{0};
+  bool isUp{false};
+
+  bool
+  operator==(const LocalLinkAttrs& other) const {
+    return otherNodeName == other.otherNodeName and iface == other.iface and
+        nhV4 == other.nhV4 and nhV6 == other.nhV6 and metric == other.metric and
+        isUp == other.isUp;
+  }
+};
+
+// route database out of a route build, empty one if nodeName is unknown
+openr::thrift::RouteDatabase
+toRouteDb(
+    const std::string& nodeName,
+    std::optional<openr::thrift::RouteDatabase> maybeRouteDb) {
+  if (maybeRouteDb.has_value()) {
+    return std::move(maybeRouteDb.value());
   }
+  openr::thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = nodeName;
+  return routeDb;
+}
 
-  std::shared_ptr<DijkstraQNode>
-  extractMin() {
-    if (heap_.empty()) {
+// add next hops of another area to a merged route, skipping known ones
+void
+mergeNextHops(
+    std::vector<openr::thrift::NextHopThrift>& merged,
+    const std::vector<openr::thrift::NextHopThrift>& nextHops) {
+  for (auto const& nextHop : nextHops) {
+    if (std::find(merged.begin(), merged.end(), nextHop) == merged.end()) {
+      merged.emplace_back(nextHop);
+    }
+  }
+}
+
+// merge route databases of a node computed by several areas. Routes to the
+// same destination get the union of next hops, other attributes come from
+// the first area announcing it
+openr::thrift::RouteDatabase
+mergeRouteDbs(
+    const std::string& nodeName,
+    std::vector<openr::thrift::RouteDatabase> routeDbs) {
+  if (routeDbs.size() == 1) {
+    return std::move(routeDbs.front());
+  }
+  openr::thrift::RouteDatabase merged;
+  merged.thisNodeName = nodeName;
+  std::unordered_map<openr::thrift::IpPrefix, size_t> unicastIndex;
+  std::unordered_map<int32_t, size_t> mplsIndex;
+  for (auto& routeDb : routeDbs) {
+    for (auto& route : routeDb.unicastRoutes) {
+      auto const it =
+          unicastIndex.emplace(route.dest, merged.unicastRoutes.size());
+      if (it.second) {
+        merged.unicastRoutes.emplace_back(std::move(route));
+      } else {
+        mergeNextHops(
+            merged.unicastRoutes[it.first->second].nextHops, route.nextHops);
+      }
+    }
+    for (auto& route : routeDb.mplsRoutes) {
+      auto const it =
+          mplsIndex.emplace(route.topLabel, merged.mplsRoutes.size());
+      if (it.second) {
+        merged.mplsRoutes.emplace_back(std::move(route));
+      } else {
+        mergeNextHops(
+            merged.mplsRoutes[it.first->second].nextHops, route.nextHops);
+      }
+    }
+  }
+  return merged;
+}
+
+// LRU cache of SPF results per source node, shared across threads. Entries
+// all belong to one topology generation, they are flushed once results of a
+// newer generation get added
+class SpfResultCache {
+ public:
+  explicit SpfResultCache(size_t capacity)
+      : entries_(folly::in_place, capacity) {}
+
+  std::shared_ptr<const SpfResult>
+  get(uint64_t generation, const std::string& nodeName) {
+    auto entries = entries_.wlock();
+    if (generation != entries->generation) {
       return nullptr;
     }
-    auto min = heap_.at(0);
-    CHECK(nameToNode_.erase(min->nodeName));
-    std::pop_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
-    heap_.pop_back();
-    return min;
+    auto it = entries->results.find(nodeName);
+    return it == entries->results.end() ? nullptr : it->second;
+  }
+
+  bool
+  contains(uint64_t generation, const std::string& nodeName) const {
+    auto entries = entries_.rlock();
+    return generation == entries->generation and
+        entries->results.exists(nodeName);
   }
 
   void
-  decreaseKey(const std::string& nodeName, Metric d) {
-    if (nameToNode_.count(nodeName)) {
-      if (nameToNode_.at(nodeName)->distance < d) {
-        throw std::invalid_argument(std::to_string(d));
-      }
-      nameToNode_.at(nodeName)->distance = d;
-      // this is a bit slow but is rarely called in our application. In fact,
-      // in networks where the metric is hop count, this will never be called
-      // and the Dijkstra run is no different than BFS
-      std::make_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
-    } else {
-      throw std::invalid_argument(nodeName);
+  set(uint64_t generation,
+      const std::string& nodeName,
+      std::shared_ptr<const SpfResult> result) {
+    auto entries = entries_.wlock();
+    if (generation < entries->generation) {
+      return;
     }
+    if (generation > entries->generation) {
+      entries->generation = generation;
+      entries->results.clear();
+    }
+    entries->results.set(nodeName, std::move(result));
   }
+
+ private:
+  struct Entries {
+    explicit Entries(size_t capacity) : results(capacity) {}
+
+    uint64_t generation{0};
+    folly::EvictingCacheMap<std::string, std::shared_ptr<const SpfResult>>
+        results;
+  };
+
+  folly::Synchronized<Entries> entries_;
 };
 
 } // anonymous namespace
@@ -170,13 +570,17 @@ class SpfSolver::SpfSolverImpl {
       bool computeLfaPaths,
       bool enableOrderedFib,
       bool bgpDryRun,
-      bool bgpUseIgpMetric)
-      : myNodeName_(myNodeName),
+      bool bgpUseIgpMetric,
+      std::shared_ptr<folly::CPUThreadPoolExecutor> spfExecutor,
+      size_t remoteLfaSpfRuns)
+      : spfExecutor_(std::move(spfExecutor)),
+        myNodeName_(myNodeName),
         enableV4_(enableV4),
         computeLfaPaths_(computeLfaPaths),
         enableOrderedFib_(enableOrderedFib),
         bgpDryRun_(bgpDryRun),
-        bgpUseIgpMetric_(bgpUseIgpMetric) {
+        bgpUseIgpMetric_(bgpUseIgpMetric),
+        remoteLfaSpfRuns_(computeLfaPaths ? remoteLfaSpfRuns : 0) {
     // Initialize stat keys
     fb303::fbData->addStatExportType("decision.adj_db_update", fb303::COUNT);
     fb303::fbData->addStatExportType(
@@ -190,7 +594,13 @@ class SpfSolver::SpfSolverImpl {
     fb303::fbData->addStatExportType("decision.path_build_ms", fb303::AVG);
     fb303::fbData->addStatExportType("decision.path_build_runs", fb303::COUNT);
     fb303::fbData->addStatExportType("decision.prefix_db_update", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.remote_lfa_routes", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.remote_lfa_spf_runs", fb303::COUNT);
     fb303::fbData->addStatExportType("decision.route_build_ms", fb303::AVG);
+    fb303::fbData->addStatExportType(
+        "decision.route_build_prefixes", fb303::AVG);
     fb303::fbData->addStatExportType("decision.route_build_runs", fb303::COUNT);
     fb303::fbData->addStatExportType(
         "decision.skipped_mpls_route", fb303::COUNT);
@@ -198,15 +608,42 @@ class SpfSolver::SpfSolverImpl {
         "decision.skipped_unicast_route", fb303::COUNT);
     fb303::fbData->addStatExportType("decision.spf_ms", fb303::AVG);
     fb303::fbData->addStatExportType("decision.spf_runs", fb303::COUNT);
+    fb303::fbData->addStatExportType("decision.ispf_runs", fb303::COUNT);
+    fb303::fbData->addStatExportType("decision.ksp2_cache_hits", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.ksp2_cache_misses", fb303::COUNT);
+    fb303::fbData->addStatExportType("decision.full_spf_runs", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.spf_result_cache_hits", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.spf_result_cache_misses", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.route_build_slices", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.route_build_abandoned", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.bgp_best_path_cache_hits", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.bgp_best_path_cache_misses", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.next_hops_cache_hits", fb303::COUNT);
+    fb303::fbData->addStatExportType(
+        "decision.next_hops_cache_misses", fb303::COUNT);
   }
 
-  ~SpfSolverImpl() = default;
+  ~SpfSolverImpl() {
+    // runs in flight refer to our link state and SPF states
+    waitSpfRuns();
+  }
 
   std::pair<
       bool /* topology has changed*/,
       bool /* route attributes has changed (nexthop addr, node/adj label */>
   updateAdjacencyDatabase(thrift::AdjacencyDatabase const& newAdjacencyDb);
 
+  std::pair<bool, bool> updateAdjacencyDatabases(
+      std::vector<thrift::AdjacencyDatabase> const& newAdjacencyDbs);
+
   bool hasHolds() const;
 
   // returns true if the AdjacencyDatabase existed
@@ -217,7 +654,7 @@ class SpfSolver::SpfSolverImpl {
       thrift::AdjacencyDatabase> const&
   getAdjacencyDatabases();
 
-  thrift::StaticRoutes const& getStaticRoutes();
+  thrift::StaticRoutes const& getStaticRoutes() const;
 
   // returns true if the prefixDb changed
   bool updatePrefixDatabase(const thrift::PrefixDatabase& prefixDb);
@@ -230,16 +667,49 @@ class SpfSolver::SpfSolverImpl {
   std::optional<thrift::RouteDatabase> buildRouteDb(
       const std::string& myNodeName);
 
+  bool startRouteBuild(bool computePaths);
+  std::optional<thrift::RouteDatabase> continueRouteBuild(
+      std::optional<std::chrono::milliseconds> timeBudget);
+
+  bool
+  hasRouteBuild() const {
+    return routeBuild_.has_value();
+  }
+
+  bool
+  hasSpfRunsInProgress() const {
+    return spfRuns_.has_value() and not spfRunsReady();
+  }
+
+  thrift::RouteDatabaseDelta getUnicastRoutesDelta();
+
+  SpfSolverSnapshot getSnapshot();
+
+  std::optional<thrift::RouteDatabase> buildRouteDbFromSnapshot(
+      SpfSolverSnapshot const& snapshot, const std::string& nodeName) const;
+
   bool decrementHolds();
 
+  std::unordered_map<std::string, int64_t> getCounters() const;
+
   void updateGlobalCounters();
 
+  std::unordered_map<
+      IpPrefixKey,
+      std::shared_ptr<const thrift::UnicastRoute>> const&
+  getUnicastRoutes() const {
+    return unicastRoutes_;
+  }
+
+  void
+  setTraceBuffer(std::shared_ptr<TraceBuffer> traceBuffer) {
+    traceBuffer_ = std::move(traceBuffer);
+  }
+
   std::optional<thrift::RouteDatabaseDelta> processStaticRouteUpdates();
 
   void pushRoutesDeltaUpdates(thrift::RouteDatabaseDelta& staticRoutesDelta);
 
-  bool staticRoutesUpdated();
-
   static std::pair<Metric, std::unordered_set<std::string>> getMinCostNodes(
       const SpfResult& spfResult, const std::set<std::string>& dstNodes);
 
@@ -255,6 +725,24 @@ class SpfSolver::SpfSolverImpl {
       bool useLinkMetric,
       const LinkState::LinkSet& linksToIgnore = {});
 
+  // same as runSpf(nodeName, true) for srcId but incrementally repairs the
+  // given state of the previous run if only a single link has changed since.
+  // Only reads linkState_ (csr graph must be built already) so it is safe to
+  // call concurrently for distinct states
+  SpfResult runSpfIncremental(NodeId srcId, SpfState& state) const;
+
+  // translate integer indexed SPF result back to node names
+  SpfResult toSpfResult(const SpfState& state) const;
+
+  // SPF result of nodeName from spfResultCache_ if we are built from a
+  // snapshot, nullptr otherwise
+  std::shared_ptr<const SpfResult> getCachedSpfResult(
+      const std::string& nodeName);
+
+  // add SPF result of nodeName to spfResultCache_ if we are built from a
+  // snapshot
+  void cacheSpfResult(const std::string& nodeName, const SpfResult& result);
+
   // Trace all edge disjoint paths from source to destination node.
   // srcNodeDistances => map indicating distances of each node from source
   // Returns list of paths.
@@ -266,6 +754,111 @@ class SpfSolver::SpfSolverImpl {
       const SpfResult& srcNodeDistances,
       const LinkState::LinkSet& linksToIgnore = {});
 
+  // Compute the unicast route for a single prefix. KSP2_ED_ECMP prefixes are
+  // only collected into prefixToPerformKsp, their paths are computed in one
+  // go by buildKsp2Routes()
+  std::optional<thrift::UnicastRoute> buildUnicastRoute(
+      std::string const& myNodeName,
+      thrift::IpPrefix const& prefix,
+      std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+      std::unordered_map<thrift::IpPrefix, BestPathCalResult>&
+          prefixToPerformKsp);
+
+  // Compute routes of KSP2_ED_ECMP prefixes collected by buildUnicastRoute()
+  std::unordered_map<thrift::IpPrefix, std::optional<thrift::UnicastRoute>>
+  buildKsp2Routes(
+      std::string const& myNodeName,
+      std::unordered_map<thrift::IpPrefix, BestPathCalResult> const&
+          prefixToPerformKsp);
+
+  // run SPF for myNodeName and, if LFA is enabled, for its neighbors.
+  // Returns false if myNodeName is not part of the topology
+  bool updateSpfResults(const std::string& myNodeName);
+
+  // SPF runs of updateSpfResults(), results are taken by finishSpfRuns()
+  struct SpfRuns {
+    std::string myNodeName;
+    std::chrono::steady_clock::time_point startTime;
+    // results at hand without running SPF, e.g. from spfResultCache_
+    std::unordered_map<std::string /* source nodeName */, SpfResult> results;
+    std::vector<folly::Future<std::pair<std::string, SpfResult>>> runs;
+  };
+
+  // start the SPF runs of updateSpfResults() on executor. They only read
+  // link state and their SPF states, which must be left alone until
+  // finishSpfRuns(). Returns std::nullopt if myNodeName is not part of the
+  // topology
+  std::optional<SpfRuns> startSpfRuns(
+      const std::string& myNodeName, folly::Executor* executor);
+
+  // wait for runs and replace spfResults_ with their results
+  void finishSpfRuns(SpfRuns runs);
+
+  // true once all SPF runs of spfRuns_ completed
+  bool spfRunsReady() const;
+
+  // finish spfRuns_ of the route build in progress, if any. Called before
+  // anything the runs read gets modified
+  void waitSpfRuns();
+
+  // add MPLS routes of myNodeName to routeDb
+  void buildMplsRoutes(
+      const std::string& myNodeName, thrift::RouteDatabase& routeDb);
+
+  // MPLS route of the node label of adjDb from myNodeName, if it has one
+  std::optional<thrift::MplsRoute> buildNodeLabelRoute(
+      const std::string& myNodeName, const thrift::AdjacencyDatabase& adjDb);
+
+  // add MPLS routes of adjacency labels of myNodeName to routeDb
+  void buildAdjLabelRoutes(
+      const std::string& myNodeName, thrift::RouteDatabase& routeDb);
+
+  // bring nodeLabelRoutes_ up to date for the nodes of routeBuild_ and add
+  // MPLS routes of myNodeName_ to routeDb
+  void updateMplsRoutes(thrift::RouteDatabase& routeDb);
+
+  // Start bringing unicastRoutes_ up to date for myNodeName_. Only prefixes
+  // whose announcements or announcing nodes' SPF results and attributes
+  // changed since the previous run are rebuilt, unless a change affects all
+  // routes
+  void startUnicastRoutesUpdate();
+
+  // rebuild prefixes of routeBuild_ until deadline, if any. Returns true
+  // once unicastRoutes_ are up to date
+  bool continueUnicastRoutesUpdate(
+      std::optional<std::chrono::steady_clock::time_point> deadline);
+
+  // rebuild prefixes [begin, end) of routeBuild_. Large ranges get split into
+  // chunks built on spfExecutor_, their routes are recorded in prefix order
+  void buildUnicastRoutes(size_t begin, size_t end);
+
+  // drop the route build in progress, its prefixes are rebuilt by the next
+  // one. Called when inputs of the build change
+  void abandonRouteBuild();
+
+  // Record the new route of prefix (nullopt if it has none) in unicastRoutes_
+  // and in the pending delta
+  void updateUnicastRoute(
+      IpPrefixKey const& prefix, std::optional<thrift::UnicastRoute> route);
+
+  // next hops from myNodeName towards the closest of dstNodeNames, see
+  // getNextHopsWithMetric() and getNextHopsThrift(). nextHops is empty if
+  // none of dstNodeNames is reachable
+  struct NextHops {
+    Metric minMetric{0};
+    std::unordered_map<std::pair<std::string, std::string>, Metric>
+        nextHopNodes;
+    std::vector<thrift::NextHopThrift> nextHops;
+  };
+
+  // NextHops of prefixes announced by dstNodeNames. Prefixes of the same
+  // nodes share them, memoized per route build of myNodeName_
+  std::shared_ptr<const NextHops> getNextHops(
+      const std::string& myNodeName,
+      const std::set<std::string>& dstNodeNames,
+      bool isV4,
+      bool perDestination);
+
   std::optional<thrift::UnicastRoute> createOpenRRoute(
       std::string const& myNodeName,
       thrift::IpPrefix const& prefix,
@@ -284,6 +877,13 @@ class SpfSolver::SpfSolverImpl {
       std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
       bool const isV4);
 
+  // best path selection among the announcers of a bgp route, memoized by
+  // findDstNodesForBgpRoute()
+  BestPathCalResult selectBgpBestPath(
+      thrift::IpPrefix const& prefix,
+      std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+      SpfResult const& mySpfResult);
+
   BestPathCalResult getBestAnnouncingNodes(
       std::string const& myNodeName,
       thrift::IpPrefix const& prefix,
@@ -300,12 +900,16 @@ class SpfSolver::SpfSolverImpl {
   BestPathCalResult maybeFilterDrainedNodes(BestPathCalResult&& result) const;
 
   // given curNode and the dst nodes, find 2spf paths from curNode to each
-  // dstNode
+  // dstNode. Paths are cached across runs, see ksp2Paths_
   std::unordered_map<std::string, std::vector<std::pair<Path, Metric>>>
   createOpenRKsp2EdRouteForNodes(
       std::string const& myNodeName,
       std::unordered_set<std::string> const& nodes);
 
+  // drop cached ksp2Paths_ that link state changes since the last call may
+  // have altered
+  void invalidateKsp2Paths(std::string const& myNodeName);
+
   // Given prefixes and the nodes who announce it, get the kspf routes.
   std::optional<thrift::UnicastRoute> selectKsp2Routes(
       const thrift::IpPrefix& prefix,
@@ -346,11 +950,61 @@ class SpfSolver::SpfSolverImpl {
   Metric findMinDistToNeighbor(
       const std::string& myNodeName, const std::string& neighborName) const;
 
+  // Backup next hops of myNodeName_ towards dstNodeNames tunneling to a remote
+  // LFA (RFC 7490) node by its node label, if all nextHopNodes are the same
+  // neighbor. That is the remote node closest to us whose path from another
+  // neighbor, and whose own path to the destination, don't go through us.
+  // Fib holds them next to the shortest next hops, for repair on link down
+  std::vector<thrift::NextHopThrift> getRemoteLfaNextHops(
+      const std::set<std::string>& dstNodeNames,
+      bool isV4,
+      std::unordered_map<std::pair<std::string, std::string>, Metric> const&
+          nextHopNodes);
+
+  // find remote LFA candidates of myNodeName_ if link state changed since
+  void updateRemoteLfaCandidates();
+
+  // SPF result of remote LFA candidate nodeName, nullptr once remote SPF runs
+  // of this link state version are used up
+  SpfResult const* getRemoteSpfResult(const std::string& nodeName);
+
   // returns the hop count from myNodeName_ to nodeName
   Metric getMyHopsToNode(const std::string& nodeName);
   // returns the hop count of the furthest node connected to nodeName
   Metric getMaxHopsToNode(const std::string& nodeName);
 
+  // drop cached hop counts if links came up or went away since they were
+  // computed. Metric changes leave hop counts as they are
+  void validateHopCounts();
+
+  // hop counts of ordered FIB holds, computed on demand and valid as of link
+  // state version hopCountsVersion_
+  std::optional<uint64_t> hopCountsVersion_;
+  std::optional<SpfResult> myHopCounts_;
+  std::unordered_map<std::string /* nodeName */, Metric> maxHopCounts_;
+
+  // remote LFA candidates of myNodeName_: nodes whose shortest paths from one
+  // of our neighbors don't go through us (extended P-space), by ascending
+  // distance over the neighbor. SPF results from them are run on demand, all
+  // as of link state version remoteLfaVersion_
+  struct RemoteLfaCandidate {
+    std::string neighborName;
+    std::string nodeName;
+    Metric linkMetric{0};
+    Metric metric{0};
+  };
+  std::optional<uint64_t> remoteLfaVersion_;
+  std::vector<RemoteLfaCandidate> remoteLfaCandidates_;
+  std::unordered_map<std::string /* nodeName */, SpfResult> remoteSpfResults_;
+
+  // prefixes of unicastRoutes_ that looked for remote LFA next hops. Those
+  // depend on distances from remote nodes, hence on the whole topology
+  std::unordered_set<IpPrefixKey> remoteLfaPrefixes_;
+
+  // guards remoteSpfResults_ and remoteLfaPrefixes_ while routes get built in
+  // parallel. Candidates are brought up to date before
+  std::mutex remoteLfaMutex_;
+
   LinkState linkState_;
 
   PrefixState prefixState_;
@@ -368,6 +1022,107 @@ class SpfSolver::SpfSolverImpl {
           pair<Metric, unordered_set<string /* nextHopNodeName */>>>>
       spfResults_;
 
+  // integer indexed SPF results of the last runSpfIncremental() per source
+  std::unordered_map<std::string /* source nodeName */, SpfState> spfStates_;
+
+  // link state version spfResults_ were computed at by the last
+  // buildPaths(myNodeName_), if they are still in place
+  std::optional<uint64_t> spfResultsVersion_;
+
+  // SPF results offered to and computed by buildRouteDbFromSnapshot()
+  std::shared_ptr<SpfResultCache> spfResultCache_{
+      std::make_shared<SpfResultCache>(Constants::kDecisionSpfResultCacheSize)};
+
+  // set on solvers built by buildRouteDbFromSnapshot() to the generation of
+  // their snapshot. Their SPF results go through spfResultCache_
+  std::optional<uint64_t> snapshotGeneration_;
+
+  // route build of myNodeName_ in progress, see startRouteBuild()
+  struct RouteBuild {
+    std::chrono::steady_clock::time_point startTime;
+    // routes get built once SPF runs of spfRuns_ are done
+    bool awaitingSpf{false};
+    // prefixes to rebuild, prefixes[0, next) are done
+    std::vector<IpPrefixKey> prefixes;
+    size_t next{0};
+    std::unordered_map<thrift::IpPrefix, BestPathCalResult> prefixToPerformKsp;
+    // route inputs to commit once the build completes
+    std::unordered_map<std::string, NodeRouteAttrs> nodeAttrs;
+    std::vector<LocalLinkAttrs> localLinks;
+    // nodes whose node label routes to rebuild, all of them if set
+    std::unordered_set<std::string> labelNodes;
+    bool rebuildAllLabels{false};
+    // next hops by destination nodes, isV4 and perDestination, see
+    // getNextHops(). Guarded as routes get built in parallel
+    std::mutex nextHopsMutex;
+    std::map<
+        std::tuple<std::set<std::string>, bool, bool>,
+        std::shared_ptr<const NextHops>>
+        nextHops;
+  };
+  std::optional<RouteBuild> routeBuild_;
+
+  // SPF runs of routeBuild_ in flight on spfExecutor_
+  std::optional<SpfRuns> spfRuns_;
+
+  // prefixes of abandoned route builds. Some of them may have been rebuilt
+  // from inputs that are already outdated, so the next build includes them
+  std::unordered_set<IpPrefixKey> abandonedRoutePrefixes_;
+
+  // unicast routes of myNodeName_ as of the last buildRouteDb(myNodeName_).
+  // Immutable, replaced on change, they get shared with the routes sent
+  std::unordered_map<
+      IpPrefixKey,
+      std::shared_ptr<const thrift::UnicastRoute>>
+      unicastRoutes_;
+
+  // node label routes of myNodeName_ as of the last buildRouteDb(myNodeName_),
+  // by node of the label. Rebuilt only for nodes whose SPF results or
+  // attributes changed, like unicastRoutes_
+  std::unordered_map<std::string /* nodeName */, thrift::MplsRoute>
+      nodeLabelRoutes_;
+
+  // changes to unicastRoutes_ not yet handed out by getUnicastRoutesDelta()
+  std::unordered_map<IpPrefixKey, thrift::UnicastRoute> unicastRoutesToUpdate_;
+  std::set<IpPrefixKey> unicastRoutesToDelete_;
+
+  // inputs unicastRoutes_ were last built from. unicastRoutes_ is empty and
+  // gets fully built on the next run while routeInputsValid_ is false
+  bool routeInputsValid_{false};
+  std::unordered_map<std::string /* source nodeName */, SpfResult>
+      routeSpfResults_;
+  std::unordered_map<std::string /* nodeName */, NodeRouteAttrs>
+      routeNodeAttrs_;
+  std::vector<LocalLinkAttrs> routeLocalLinks_;
+  uint64_t routeLinkStateVersion_{0};
+
+  // best paths of bgp prefixes from myNodeName_, as of the distances to their
+  // announcers (in iteration order of the prefix entries, nullopt if
+  // unreachable). Dropped when entries of the prefix change
+  struct BgpBestPath {
+    std::vector<std::optional<Metric>> announcerMetrics;
+    BestPathCalResult result;
+  };
+  std::unordered_map<IpPrefixKey, BgpBestPath> bgpBestPaths_;
+  std::mutex bgpBestPathsMutex_;
+
+  // prefixes of unicastRoutes_ computed with KSP2_ED_ECMP. Their paths depend
+  // on the whole topology
+  std::unordered_set<IpPrefixKey> ksp2Prefixes_;
+
+  // KSP2_ED_ECMP paths from ksp2PathsSource_ to each destination node, as of
+  // link state version ksp2PathsVersion_
+  std::string ksp2PathsSource_;
+  uint64_t ksp2PathsVersion_{0};
+  std::unordered_map<
+      std::string /* dstNodeName */,
+      std::vector<std::pair<Path, Metric>>>
+      ksp2Paths_;
+
+  // bounded pool running per-neighbor SPFs for LFA computation and chunks of
+  // route builds in parallel, shared by solvers. nullptr to run them inline
+  const std::shared_ptr<folly::CPUThreadPoolExecutor> spfExecutor_;
+
   const std::string myNodeName_;
 
   // is v4 enabled. If yes then Decision will forward v4 prefixes with v4
@@ -382,6 +1137,13 @@ class SpfSolver::SpfSolverImpl {
 
   // Use IGP metric in metric vector comparision
   const bool bgpUseIgpMetric_{false};
+
+  // remote SPF runs per link state version for remote LFA, 0 if disabled. It
+  // builds on LFA, which provides SPF results of our neighbors
+  const size_t remoteLfaSpfRuns_{0};
+
+  // spans of route computation stages go here, if set
+  std::shared_ptr<TraceBuffer> traceBuffer_;
 };
 
 std::pair<
@@ -389,6 +1151,9 @@ std::pair<
     bool /* route attributes has changed (nexthop addr, node/adj label */>
 SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
     thrift::AdjacencyDatabase const& newAdjacencyDb) {
+  waitSpfRuns();
+  TraceScope span(
+      traceBuffer_.get(), "linkstate_update", newAdjacencyDb.thisNodeName);
   LinkStateMetric holdUpTtl = 0, holdDownTtl = 0;
   if (enableOrderedFib_) {
     holdUpTtl = getMyHopsToNode(newAdjacencyDb.thisNodeName);
@@ -397,14 +1162,50 @@ SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
   fb303::fbData->addStatValue("decision.adj_db_update", 1, fb303::COUNT);
   auto rc = linkState_.updateAdjacencyDatabase(
       newAdjacencyDb, holdUpTtl, holdDownTtl);
+  if (rc.first or rc.second) {
+    abandonRouteBuild();
+  }
   // temporary hack needed to keep UTs happy
   rc.second = rc.second && myNodeName_ == newAdjacencyDb.thisNodeName;
   return rc;
 }
 
-bool
-SpfSolver::SpfSolverImpl::staticRoutesUpdated() {
-  return staticRoutesUpdates_.size() > 0;
+std::pair<bool, bool>
+SpfSolver::SpfSolverImpl::updateAdjacencyDatabases(
+    std::vector<thrift::AdjacencyDatabase> const& newAdjacencyDbs) {
+  waitSpfRuns();
+  TraceScope span(traceBuffer_.get(), "linkstate_update");
+  span.setArg(newAdjacencyDbs.size());
+  // hold TTLs are all as of the topology before the batch, hop counts are
+  // computed once for it
+  std::vector<LinkState::AdjacencyDbUpdate> updates;
+  updates.reserve(newAdjacencyDbs.size());
+  for (auto const& newAdjacencyDb : newAdjacencyDbs) {
+    LinkStateMetric holdUpTtl = 0, holdDownTtl = 0;
+    if (enableOrderedFib_) {
+      holdUpTtl = getMyHopsToNode(newAdjacencyDb.thisNodeName);
+      holdDownTtl = getMaxHopsToNode(newAdjacencyDb.thisNodeName) - holdUpTtl;
+    }
+    updates.emplace_back(
+        LinkState::AdjacencyDbUpdate{newAdjacencyDb, holdUpTtl, holdDownTtl});
+  }
+  fb303::fbData->addStatValue(
+      "decision.adj_db_update", newAdjacencyDbs.size(), fb303::COUNT);
+
+  std::pair<bool, bool> rc{false, false};
+  bool changed = false;
+  auto const nodeRcs = linkState_.updateAdjacencyDatabases(updates);
+  for (size_t i = 0; i < nodeRcs.size(); ++i) {
+    rc.first |= nodeRcs[i].first;
+    // route attributes only matter for ourselves, as for single updates
+    rc.second |= nodeRcs[i].second and
+        newAdjacencyDbs[i].thisNodeName == myNodeName_;
+    changed |= nodeRcs[i].first or nodeRcs[i].second;
+  }
+  if (changed) {
+    abandonRouteBuild();
+  }
+  return rc;
 }
 
 void
@@ -423,30 +1224,86 @@ SpfSolver::SpfSolverImpl::getMyHopsToNode(const std::string& nodeName) {
   if (myNodeName_ == nodeName) {
     return 0;
   }
-  auto spfResult = runSpf(myNodeName_, false);
-  if (spfResult.count(nodeName)) {
-    return spfResult.at(nodeName).first;
+  validateHopCounts();
+  if (not myHopCounts_.has_value()) {
+    myHopCounts_ = runSpf(myNodeName_, false);
+  }
+  auto const it = myHopCounts_->find(nodeName);
+  if (it != myHopCounts_->end()) {
+    return it->second.first;
   }
   return getMaxHopsToNode(nodeName);
 }
 
 Metric
 SpfSolver::SpfSolverImpl::getMaxHopsToNode(const std::string& nodeName) {
+  validateHopCounts();
+  auto const it = maxHopCounts_.find(nodeName);
+  if (it != maxHopCounts_.end()) {
+    return it->second;
+  }
   Metric max = 0;
   for (auto const& pathsFromNode : runSpf(nodeName, false)) {
     max = std::max(max, pathsFromNode.second.first);
   }
+  maxHopCounts_.emplace(nodeName, max);
   return max;
 }
 
+void
+SpfSolver::SpfSolverImpl::validateHopCounts() {
+  auto const version = linkState_.getVersion();
+  if (hopCountsVersion_ == version) {
+    return;
+  }
+
+  bool valid = false;
+  if (hopCountsVersion_.has_value()) {
+    auto const maybeChanges =
+        linkState_.getLinkChangesSince(hopCountsVersion_.value());
+    valid = maybeChanges.has_value() and
+        std::all_of(
+                maybeChanges->begin(),
+                maybeChanges->end(),
+                [this](auto const& change) {
+                  // find current state of the link, it may have been removed
+                  auto const& link = change.link;
+                  bool isUp = false;
+                  for (auto const& l :
+                       linkState_.linksFromNode(link->firstNodeName())) {
+                    if (*l == *link) {
+                      isUp = l->isUp();
+                      break;
+                    }
+                  }
+                  return isUp == change.oldMetric1.has_value();
+                });
+  }
+  if (not valid) {
+    myHopCounts_.reset();
+    maxHopCounts_.clear();
+  }
+  hopCountsVersion_ = version;
+}
+
 bool
 SpfSolver::SpfSolverImpl::decrementHolds() {
-  return linkState_.decrementHolds();
+  waitSpfRuns();
+  if (not linkState_.decrementHolds()) {
+    return false;
+  }
+  abandonRouteBuild();
+  return true;
 }
 
 bool
 SpfSolver::SpfSolverImpl::deleteAdjacencyDatabase(const std::string& nodeName) {
-  return linkState_.deleteAdjacencyDatabase(nodeName);
+  waitSpfRuns();
+  if (not linkState_.deleteAdjacencyDatabase(nodeName)) {
+    return false;
+  }
+  abandonRouteBuild();
+  return true;
 }
 
 std::unordered_map<std::string /* nodeName */, thrift::AdjacencyDatabase> const&
@@ -455,7 +1312,7 @@ SpfSolver::SpfSolverImpl::getAdjacencyDatabases() {
 }
 
 thrift::StaticRoutes const&
-SpfSolver::SpfSolverImpl::getStaticRoutes() {
+SpfSolver::SpfSolverImpl::getStaticRoutes() const {
   return staticRoutes_;
 }
 
@@ -465,7 +1322,15 @@ SpfSolver::SpfSolverImpl::updatePrefixDatabase(
   auto const& nodeName = prefixDb.thisNodeName;
   VLOG(1) << "Updating prefix database for node " << nodeName;
   fb303::fbData->addStatValue("decision.prefix_db_update", 1, fb303::COUNT);
-  return prefixState_.updatePrefixDatabase(prefixDb);
+  auto const changedPrefixes = prefixState_.updatePrefixDatabase(prefixDb);
+  if (changedPrefixes.empty()) {
+    return false;
+  }
+  abandonRouteBuild();
+  for (auto const& prefix : changedPrefixes) {
+    bgpBestPaths_.erase(prefix);
+  }
+  return true;
 }
 
 std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
@@ -475,6 +1340,10 @@ SpfSolver::SpfSolverImpl::getPrefixDatabases() {
 
 /**
  * Compute shortest-path routes from perspective of nodeName;
+ *
+ * Dijkstra runs over the integer indexed CSR view of the link state. Node
+ * distances live in flat arrays and next-hop sets are kept as bitsets over the
+ * neighbors of the source node. Names are resolved only once the run is over.
  */
 unordered_map<
     string /* otherNodeName */,
@@ -483,80 +1352,176 @@ SpfSolver::SpfSolverImpl::runSpf(
     const std::string& thisNodeName,
     bool useLinkMetric,
     const LinkState::LinkSet& linksToIgnore) {
+  TraceScope span(traceBuffer_.get(), "spf", thisNodeName);
   unordered_map<string, pair<Metric, unordered_set<string>>> result;
 
   fb303::fbData->addStatValue("decision.spf_runs", 1, fb303::COUNT);
   const auto startTime = std::chrono::steady_clock::now();
 
-  DijkstraQ q;
-  q.insertNode(thisNodeName, 0);
-  uint64_t loop = 0;
-  for (auto node = q.extractMin(); node; node = q.extractMin()) {
-    ++loop;
-    // we've found this node's shortest paths. record it
-    auto emplaceRc = result.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(node->nodeName),
-        std::forward_as_tuple(node->distance, std::move(node->nextHops)));
-    CHECK(emplaceRc.second);
-
-    auto& recordedNodeName = emplaceRc.first->first;
-    auto& recordedNodeMetric = emplaceRc.first->second.first;
-    auto& recordedNodeNextHops = emplaceRc.first->second.second;
-
-    if (linkState_.isNodeOverloaded(recordedNodeName) &&
-        recordedNodeName != thisNodeName) {
-      // no transit traffic through this node. we've recorded the nexthops to
-      // this node, but will not consider any of it's adjancecies as offering
-      // lower cost paths towards further away nodes. This effectively drains
-      // traffic away from this node
-      continue;
-    }
-    // we have the shortest path nexthops for recordedNodeName. Use these
-    // nextHops for any node that is connected to recordedNodeName that doesn't
-    // already have a lower cost path from thisNodeName
-    //
-    // this is the "relax" step in the Dijkstra Algorithm pseudocode in CLRS
-    for (const auto& link : linkState_.linksFromNode(recordedNodeName)) {
-      auto otherNodeName = link->getOtherNodeName(recordedNodeName);
-      if (!link->isUp() or result.count(otherNodeName) or
-          linksToIgnore.count(link)) {
-        continue;
-      }
-      auto metric =
-          useLinkMetric ? link->getMetricFromNode(recordedNodeName) : 1;
-      auto otherNode = q.get(otherNodeName);
-      if (!otherNode) {
-        q.insertNode(otherNodeName, recordedNodeMetric + metric);
-        otherNode = q.get(otherNodeName);
-      }
-      if (otherNode->distance >= recordedNodeMetric + metric) {
-        // recordedNodeName is either along an alternate shortest path towards
-        // otherNodeName or is along a new shorter path. In either case,
-        // otherNodeName should use recordedNodeName's nextHops until it finds
-        // some shorter path
-        if (otherNode->distance > recordedNodeMetric + metric) {
-          // if this is strictly better, forget about any other nexthops
-          otherNode->nextHops.clear();
-          q.decreaseKey(otherNode->nodeName, recordedNodeMetric + metric);
-        }
-        otherNode->nextHops.insert(
-            recordedNodeNextHops.begin(), recordedNodeNextHops.end());
-      }
-      if (otherNode->nextHops.empty()) {
-        // this node is directly connected to the source
-        otherNode->nextHops.emplace(otherNode->nodeName);
+  auto const maybeSrcId = linkState_.getNodeId(thisNodeName);
+  if (not maybeSrcId.has_value()) {
+    // node has never been part of the graph, only path is the one to itself
+    result[thisNodeName].first = 0;
+    return result;
+  }
+
+  SpfState state;
+  runFullSpf(
+      linkState_.getCsrGraph(),
+      maybeSrcId.value(),
+      useLinkMetric,
+      linksToIgnore,
+      state);
+  result = toSpfResult(state);
+
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  LOG(INFO) << "SPF elapsed time: " << deltaTime.count() << "ms.";
+  fb303::fbData->addStatValue("decision.spf_ms", deltaTime.count(), fb303::AVG);
+  return result;
+}
+
+SpfResult
+SpfSolver::SpfSolverImpl::runSpfIncremental(
+    NodeId srcId, SpfState& state) const {
+  // arg is set for incremental runs
+  TraceScope span(traceBuffer_.get(), "spf", linkState_.getNodeName(srcId));
+  fb303::fbData->addStatValue("decision.spf_runs", 1, fb303::COUNT);
+  const auto startTime = std::chrono::steady_clock::now();
+
+  bool repaired = false;
+  if (not state.distances.empty()) {
+    auto const maybeChanges = linkState_.getLinkChangesSince(state.version);
+    if (maybeChanges.has_value()) {
+      auto const& changes = maybeChanges.value();
+      // multiple changes of the same link (e.g. a flap) collapse into one,
+      // with the metrics prior to the very first change
+      const bool singleLink = std::all_of(
+          changes.begin(), changes.end(), [&changes](auto const& change) {
+            return *change.link == *changes.front().link;
+          });
+      if (changes.empty()) {
+        repaired = true;
+      } else if (singleLink) {
+        repaired = runIncrementalSpf(linkState_, changes.front(), state);
       }
     }
   }
-  VLOG(3) << "Dijkstra loop count: " << loop;
+
+  if (repaired) {
+    span.setArg(1);
+    fb303::fbData->addStatValue("decision.ispf_runs", 1, fb303::COUNT);
+  } else {
+    fb303::fbData->addStatValue("decision.full_spf_runs", 1, fb303::COUNT);
+    runFullSpf(linkState_.getCsrGraph(), srcId, true, {}, state);
+  }
+  state.version = linkState_.getVersion();
+  auto result = toSpfResult(state);
+
   auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::steady_clock::now() - startTime);
-  LOG(INFO) << "SPF elapsed time: " << deltaTime.count() << "ms.";
+  LOG(INFO) << (repaired ? "Incremental" : "Full")
+            << " SPF elapsed time: " << deltaTime.count() << "ms.";
   fb303::fbData->addStatValue("decision.spf_ms", deltaTime.count(), fb303::AVG);
   return result;
 }
 
+SpfResult
+SpfSolver::SpfSolverImpl::toSpfResult(const SpfState& state) const {
+  SpfResult result;
+  for (NodeId nodeId = 0; nodeId < state.distances.size(); ++nodeId) {
+    if (state.distances[nodeId] == kInfMetric) {
+      continue;
+    }
+    auto& nodeResult = result[linkState_.getNodeName(nodeId)];
+    nodeResult.first = state.distances[nodeId];
+    const uint64_t* nodeNextHops =
+        state.nextHops.data() + nodeId * state.nhWords;
+    for (size_t w = 0; w < state.nhWords; ++w) {
+      for (uint64_t word = nodeNextHops[w]; word; word &= word - 1) {
+        const size_t bit = w * kBitsPerWord + __builtin_ctzll(word);
+        nodeResult.second.emplace(
+            linkState_.getNodeName(state.nhBitToNode[bit]));
+      }
+    }
+  }
+  return result;
+}
+
+std::shared_ptr<const SpfResult>
+SpfSolver::SpfSolverImpl::getCachedSpfResult(const std::string& nodeName) {
+  if (not snapshotGeneration_.has_value()) {
+    return nullptr;
+  }
+  auto result = spfResultCache_->get(snapshotGeneration_.value(), nodeName);
+  fb303::fbData->addStatValue(
+      result ? "decision.spf_result_cache_hits"
+             : "decision.spf_result_cache_misses",
+      1,
+      fb303::COUNT);
+  return result;
+}
+
+void
+SpfSolver::SpfSolverImpl::cacheSpfResult(
+    const std::string& nodeName, const SpfResult& result) {
+  if (snapshotGeneration_.has_value()) {
+    spfResultCache_->set(
+        snapshotGeneration_.value(),
+        nodeName,
+        std::make_shared<const SpfResult>(result));
+  }
+}
+
+SpfSolverSnapshot
+SpfSolver::SpfSolverImpl::getSnapshot() {
+  SpfSolverSnapshot snapshot;
+  snapshot.generation = linkState_.getVersion();
+  snapshot.adjacencyDbs = linkState_.getAdjacencyDatabasesSnapshot();
+  snapshot.prefixDbs = prefixState_.getPrefixDatabasesSnapshot();
+
+  // share results of our last route build, once per generation. Snapshots
+  // carry no ordered FIB holds, results computed under holds don't apply to
+  // them and would linger in the cache once the holds expire
+  if (spfResultsVersion_ == snapshot.generation and
+      not linkState_.hasHolds()) {
+    for (auto const& kv : spfResults_) {
+      if (not spfResultCache_->contains(snapshot.generation, kv.first)) {
+        spfResultCache_->set(
+            snapshot.generation,
+            kv.first,
+            std::make_shared<const SpfResult>(kv.second));
+      }
+    }
+  }
+  return snapshot;
+}
+
+std::optional<thrift::RouteDatabase>
+SpfSolver::SpfSolverImpl::buildRouteDbFromSnapshot(
+    SpfSolverSnapshot const& snapshot, const std::string& nodeName) const {
+  // only immutable members of ours are accessed below
+  SpfSolverImpl solver(
+      myNodeName_,
+      enableV4_,
+      computeLfaPaths_,
+      false /* enableOrderedFib */,
+      bgpDryRun_,
+      bgpUseIgpMetric_,
+      spfExecutor_,
+      remoteLfaSpfRuns_);
+  solver.spfResultCache_ = spfResultCache_;
+  solver.snapshotGeneration_ = snapshot.generation;
+  // bypass update counters, these are not updates we received
+  for (auto const& kv : *snapshot.adjacencyDbs) {
+    solver.linkState_.updateAdjacencyDatabase(kv.second, 0, 0);
+  }
+  for (auto const& kv : *snapshot.prefixDbs) {
+    solver.prefixState_.updatePrefixDatabase(kv.second);
+  }
+  return solver.buildPaths(nodeName);
+}
+
 std::vector<Path>
 SpfSolver::SpfSolverImpl::traceEdgeDisjointPaths(
     const std::string& srcNodeName,
@@ -646,15 +1611,63 @@ SpfSolver::SpfSolverImpl::traceEdgeDisjointPaths(
 
 std::optional<thrift::RouteDatabase>
 SpfSolver::SpfSolverImpl::buildPaths(const std::string& myNodeName) {
+  abandonRouteBuild();
+  if (not updateSpfResults(myNodeName)) {
+    return std::nullopt;
+  }
+  return buildRouteDb(myNodeName);
+} // buildPaths
+
+bool
+SpfSolver::SpfSolverImpl::updateSpfResults(const std::string& myNodeName) {
+  folly::Executor* executor = spfExecutor_
+      ? static_cast<folly::Executor*>(spfExecutor_.get())
+      : &folly::InlineExecutor::instance();
+  auto spfRuns = startSpfRuns(myNodeName, executor);
+  if (not spfRuns.has_value()) {
+    return false;
+  }
+  finishSpfRuns(std::move(spfRuns.value()));
+  return true;
+}
+
+std::optional<SpfSolver::SpfSolverImpl::SpfRuns>
+SpfSolver::SpfSolverImpl::startSpfRuns(
+    const std::string& myNodeName, folly::Executor* executor) {
   if (!linkState_.hasNode(myNodeName)) {
     return std::nullopt;
   }
 
-  auto const& startTime = std::chrono::steady_clock::now();
   fb303::fbData->addStatValue("decision.path_build_runs", 1, fb303::COUNT);
-
-  spfResults_.clear();
-  spfResults_[myNodeName] = runSpf(myNodeName, true);
+  SpfRuns spfRuns;
+  spfRuns.myNodeName = myNodeName;
+  spfRuns.startTime = std::chrono::steady_clock::now();
+
+  // build the csr graph upfront, the SPF runs below only read link state
+  linkState_.getCsrGraph();
+  auto startSpfRun = [this, &spfRuns, executor](const std::string& nodeName) {
+    if (auto cached = getCachedSpfResult(nodeName)) {
+      spfRuns.results.emplace(nodeName, *cached);
+      return;
+    }
+    auto const maybeSrcId = linkState_.getNodeId(nodeName);
+    if (not maybeSrcId.has_value()) {
+      // node has never been part of the graph, nothing to run
+      spfStates_.erase(nodeName);
+      auto result = runSpf(nodeName, true);
+      cacheSpfResult(nodeName, result);
+      spfRuns.results.emplace(nodeName, std::move(result));
+      return;
+    }
+    // states are created here so that workers never modify spfStates_ itself
+    auto& state = spfStates_[nodeName];
+    spfRuns.runs.emplace_back(folly::via(
+        executor, [this, nodeName, srcId = maybeSrcId.value(), &state]() {
+          return std::make_pair(nodeName, runSpfIncremental(srcId, state));
+        }));
+  };
+
+  startSpfRun(myNodeName);
   if (computeLfaPaths_) {
     // avoid duplicate iterations over a neighbor which can happen due to
     // multiple adjacencies to it
@@ -665,18 +1678,58 @@ SpfSolver::SpfSolverImpl::buildPaths(const std::string& myNodeName) {
       if (!visitedAdjNodes.insert(otherNodeName).second || !link->isUp()) {
         continue;
       }
-      spfResults_[otherNodeName] = runSpf(otherNodeName, true);
+      startSpfRun(otherNodeName);
+    }
+  }
+  return spfRuns;
+}
+
+void
+SpfSolver::SpfSolverImpl::finishSpfRuns(SpfRuns spfRuns) {
+  spfResults_ = std::move(spfRuns.results);
+  for (auto& spfRun : folly::collectAll(spfRuns.runs).get()) {
+    auto& nodeAndResult = spfRun.value();
+    cacheSpfResult(nodeAndResult.first, nodeAndResult.second);
+    spfResults_[nodeAndResult.first] = std::move(nodeAndResult.second);
+  }
+
+  spfResultsVersion_ = std::nullopt;
+  if (spfRuns.myNodeName == myNodeName_) {
+    spfResultsVersion_ = linkState_.getVersion();
+    // forget about sources we are no longer computing SPF for
+    for (auto it = spfStates_.begin(); it != spfStates_.end();) {
+      if (spfResults_.count(it->first)) {
+        ++it;
+      } else {
+        it = spfStates_.erase(it);
+      }
     }
   }
 
   auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::steady_clock::now() - startTime);
+      std::chrono::steady_clock::now() - spfRuns.startTime);
   LOG(INFO) << "Decision::buildPaths took " << deltaTime.count() << "ms.";
   fb303::fbData->addStatValue(
       "decision.path_build_ms", deltaTime.count(), fb303::AVG);
+}
 
-  return buildRouteDb(myNodeName);
-} // buildPaths
+bool
+SpfSolver::SpfSolverImpl::spfRunsReady() const {
+  return std::all_of(
+      spfRuns_->runs.begin(), spfRuns_->runs.end(), [](auto const& spfRun) {
+        return spfRun.isReady();
+      });
+}
+
+void
+SpfSolver::SpfSolverImpl::waitSpfRuns() {
+  if (not spfRuns_.has_value()) {
+    return;
+  }
+  auto spfRuns = std::move(spfRuns_.value());
+  spfRuns_.reset();
+  finishSpfRuns(std::move(spfRuns));
+}
 
 std::optional<thrift::RouteDatabase>
 SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
@@ -685,6 +1738,11 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
     return std::nullopt;
   }
 
+  if (myNodeName == myNodeName_) {
+    CHECK(startRouteBuild(false));
+    return continueRouteBuild(std::nullopt);
+  }
+
   const auto startTime = std::chrono::steady_clock::now();
   fb303::fbData->addStatValue("decision.route_build_runs", 1, fb303::COUNT);
 
@@ -695,190 +1753,633 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
   // Create unicastRoutes - IP and IP2MPLS routes
   //
   std::unordered_map<thrift::IpPrefix, BestPathCalResult> prefixToPerformKsp;
+  for (const auto& kv : prefixState_.prefixes()) {
+    auto route = buildUnicastRoute(
+        myNodeName, kv.first.toThrift(), kv.second, prefixToPerformKsp);
+    if (route.has_value()) {
+      routeDb.unicastRoutes.emplace_back(std::move(route.value()));
+    }
+  }
+  for (auto& kv : buildKsp2Routes(myNodeName, prefixToPerformKsp)) {
+    if (kv.second.has_value()) {
+      routeDb.unicastRoutes.emplace_back(std::move(kv.second.value()));
+    }
+  }
+
+  buildMplsRoutes(myNodeName, routeDb);
+
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  LOG(INFO) << "Decision::buildRouteDb took " << deltaTime.count() << "ms.";
+  fb303::fbData->addStatValue(
+      "decision.route_build_ms", deltaTime.count(), fb303::AVG);
+  return routeDb;
+} // buildRouteDb
+
+bool
+SpfSolver::SpfSolverImpl::startRouteBuild(bool computePaths) {
+  abandonRouteBuild();
+  if (computePaths and spfExecutor_) {
+    // SPF runs on the pool, continueRouteBuild() picks up their results
+    spfRuns_ = startSpfRuns(myNodeName_, spfExecutor_.get());
+    if (not spfRuns_.has_value()) {
+      return false;
+    }
+  } else {
+    if (computePaths and not updateSpfResults(myNodeName_)) {
+      return false;
+    }
+    if (not linkState_.hasNode(myNodeName_) or
+        spfResults_.count(myNodeName_) == 0) {
+      return false;
+    }
+  }
+
+  fb303::fbData->addStatValue("decision.route_build_runs", 1, fb303::COUNT);
+  routeBuild_.emplace();
+  routeBuild_->startTime = std::chrono::steady_clock::now();
+  routeBuild_->awaitingSpf = spfRuns_.has_value();
+  if (not routeBuild_->awaitingSpf) {
+    startUnicastRoutesUpdate();
+  }
+  return true;
+}
+
+std::optional<thrift::RouteDatabase>
+SpfSolver::SpfSolverImpl::continueRouteBuild(
+    std::optional<std::chrono::milliseconds> timeBudget) {
+  CHECK(routeBuild_.has_value()) << "No route build in progress";
+
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  if (timeBudget.has_value()) {
+    deadline = std::chrono::steady_clock::now() + timeBudget.value();
+  }
+  if (routeBuild_->awaitingSpf) {
+    if (deadline.has_value() and hasSpfRunsInProgress()) {
+      return std::nullopt;
+    }
+    waitSpfRuns();
+    routeBuild_->awaitingSpf = false;
+    startUnicastRoutesUpdate();
+  }
+  fb303::fbData->addStatValue("decision.route_build_slices", 1, fb303::COUNT);
+  if (not continueUnicastRoutesUpdate(deadline)) {
+    return std::nullopt;
+  }
+
+  thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = myNodeName_;
+  routeDb.unicastRoutes.reserve(unicastRoutes_.size());
+  for (auto const& kv : unicastRoutes_) {
+    routeDb.unicastRoutes.emplace_back(*kv.second);
+  }
+  updateMplsRoutes(routeDb);
+
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - routeBuild_->startTime);
+  LOG(INFO) << "Decision::buildRouteDb took " << deltaTime.count() << "ms.";
+  fb303::fbData->addStatValue(
+      "decision.route_build_ms", deltaTime.count(), fb303::AVG);
+  routeBuild_.reset();
+  return routeDb;
+}
+
+void
+SpfSolver::SpfSolverImpl::abandonRouteBuild() {
+  waitSpfRuns();
+  if (not routeBuild_.has_value()) {
+    return;
+  }
+  fb303::fbData->addStatValue(
+      "decision.route_build_abandoned", 1, fb303::COUNT);
+  abandonedRoutePrefixes_.insert(
+      routeBuild_->prefixes.begin(), routeBuild_->prefixes.end());
+  routeBuild_.reset();
+}
+
+void
+SpfSolver::SpfSolverImpl::buildMplsRoutes(
+    const std::string& myNodeName, thrift::RouteDatabase& routeDb) {
+  //
+  // Create MPLS routes for all nodeLabel
+  //
+  for (const auto& kv : linkState_.getAdjacencyDatabases()) {
+    auto route = buildNodeLabelRoute(myNodeName, kv.second);
+    if (route.has_value()) {
+      routeDb.mplsRoutes.emplace_back(std::move(route.value()));
+    }
+  }
+
+  buildAdjLabelRoutes(myNodeName, routeDb);
+}
+
+void
+SpfSolver::SpfSolverImpl::updateMplsRoutes(thrift::RouteDatabase& routeDb) {
+  auto& build = routeBuild_.value();
+  auto const& adjDbs = linkState_.getAdjacencyDatabases();
+  size_t numBuilt = 0;
+  auto updateNode = [&](const std::string& nodeName) {
+    ++numBuilt;
+    std::optional<thrift::MplsRoute> route;
+    auto const adjDbIt = adjDbs.find(nodeName);
+    if (adjDbIt != adjDbs.end()) {
+      route = buildNodeLabelRoute(myNodeName_, adjDbIt->second);
+    }
+    if (route.has_value()) {
+      nodeLabelRoutes_[nodeName] = std::move(route.value());
+    } else {
+      nodeLabelRoutes_.erase(nodeName);
+    }
+  };
+  if (build.rebuildAllLabels) {
+    nodeLabelRoutes_.clear();
+    for (auto const& kv : adjDbs) {
+      updateNode(kv.first);
+    }
+  } else {
+    for (auto const& nodeName : build.labelNodes) {
+      updateNode(nodeName);
+    }
+  }
+  fb303::fbData->addStatValue(
+      "decision.label_route_build_nodes", numBuilt, fb303::AVG);
+
+  routeDb.mplsRoutes.reserve(nodeLabelRoutes_.size());
+  for (auto const& kv : nodeLabelRoutes_) {
+    routeDb.mplsRoutes.emplace_back(kv.second);
+  }
+  // only as many as we have adjacencies, always rebuilt
+  buildAdjLabelRoutes(myNodeName_, routeDb);
+}
+
+std::optional<thrift::MplsRoute>
+SpfSolver::SpfSolverImpl::buildNodeLabelRoute(
+    const std::string& myNodeName, const thrift::AdjacencyDatabase& adjDb) {
+  const auto topLabel = adjDb.nodeLabel;
+  // Top label is not set => Non-SR mode
+  if (topLabel == 0) {
+    return std::nullopt;
+  }
+  // If mpls label is not valid then ignore it
+  if (not isMplsLabelValid(topLabel)) {
+    LOG(ERROR) << "Ignoring invalid node label " << topLabel << " of node "
+               << adjDb.thisNodeName;
+    fb303::fbData->addStatValue("decision.skipped_mpls_route", 1, fb303::COUNT);
+    return std::nullopt;
+  }
+
+  // Install POP_AND_LOOKUP for next layer
+  if (adjDb.thisNodeName == myNodeName) {
+    thrift::NextHopThrift nh;
+    nh.address = toBinaryAddress(folly::IPAddressV6("::"));
+    nh.mplsAction = createMplsAction(thrift::MplsActionCode::POP_AND_LOOKUP);
+    return createMplsRoute(topLabel, {std::move(nh)});
+  }
+
+  // Get best nexthop towards the node
+  auto metricNhs =
+      getNextHopsWithMetric(myNodeName, {adjDb.thisNodeName}, false);
+  if (metricNhs.second.empty()) {
+    LOG(WARNING) << "No route to nodeLabel " << std::to_string(topLabel)
+                 << " of node " << adjDb.thisNodeName;
+    fb303::fbData->addStatValue("decision.no_route_to_label", 1, fb303::COUNT);
+    return std::nullopt;
+  }
+
+  // Create nexthops with appropriate MplsAction (PHP and SWAP). Note that all
+  // nexthops are valid for routing without loops. Fib is responsible for
+  // installing these routes by making sure it programs least cost nexthops
+  // first and of same action type (based on HW limitations)
+  auto nextHopsThrift = getNextHopsThrift(
+      myNodeName,
+      {adjDb.thisNodeName},
+      false,
+      false,
+      metricNhs.first,
+      metricNhs.second,
+      topLabel);
+  return createMplsRoute(topLabel, std::move(nextHopsThrift));
+}
+
+void
+SpfSolver::SpfSolverImpl::buildAdjLabelRoutes(
+    const std::string& myNodeName, thrift::RouteDatabase& routeDb) {
+  //
+  // Create MPLS routes for all of our adjacencies
+  //
+  for (const auto& link : linkState_.linksFromNode(myNodeName)) {
+    const auto topLabel = link->getAdjLabelFromNode(myNodeName);
+    // Top label is not set => Non-SR mode
+    if (topLabel == 0) {
+      continue;
+    }
+    // If mpls label is not valid then ignore it
+    if (not isMplsLabelValid(topLabel)) {
+      LOG(ERROR) << "Ignoring invalid adjacency label " << topLabel
+                 << " of link " << link->directionalToString(myNodeName);
+      fb303::fbData->addStatValue(
+          "decision.skipped_mpls_route", 1, fb303::COUNT);
+      continue;
+    }
+
+    auto nh = createNextHop(
+        link->getNhV6FromNode(myNodeName),
+        link->getIfaceFromNode(myNodeName),
+        link->getMetricFromNode(myNodeName),
+        createMplsAction(thrift::MplsActionCode::PHP));
+    routeDb.mplsRoutes.emplace_back(createMplsRoute(topLabel, {std::move(nh)}));
+  }
+}
+
+std::optional<thrift::UnicastRoute>
+SpfSolver::SpfSolverImpl::buildUnicastRoute(
+    std::string const& myNodeName,
+    thrift::IpPrefix const& prefix,
+    std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+    std::unordered_map<thrift::IpPrefix, BestPathCalResult>&
+        prefixToPerformKsp) {
+  bool hasBGP = false, hasNonBGP = false, missingMv = false;
+  bool hasSpEcmp = false, hasKsp2EdEcmp = false;
+  for (auto const& npKv : nodePrefixes) {
+    bool isBGP = npKv.second.type == thrift::PrefixType::BGP;
+    hasBGP |= isBGP;
+    hasNonBGP |= !isBGP;
+    if (isBGP and not npKv.second.mv.has_value()) {
+      missingMv = true;
+      LOG(ERROR) << "Prefix entry for prefix " << toString(npKv.second.prefix)
+                 << " advertised by " << npKv.first
+                 << " is of type BGP but does not contain a metric vector.";
+    }
+    hasSpEcmp |= npKv.second.forwardingAlgorithm ==
+        thrift::PrefixForwardingAlgorithm::SP_ECMP;
+    hasKsp2EdEcmp |= npKv.second.forwardingAlgorithm ==
+        thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP;
+  }
+
+  // skip adding route for BGP prefixes that have issues
+  if (hasBGP) {
+    if (hasNonBGP) {
+      LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
+                 << " which is advertised with BGP and non-BGP type.";
+      fb303::fbData->addStatValue(
+          "decision.skipped_unicast_route", 1, fb303::COUNT);
+      return std::nullopt;
+    }
+    if (missingMv) {
+      LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
+                 << " at least one advertiser is missing its metric vector.";
+      fb303::fbData->addStatValue(
+          "decision.skipped_unicast_route", 1, fb303::COUNT);
+      return std::nullopt;
+    }
+  }
+
+  // skip adding route for prefixes advertised by this node
+  if (nodePrefixes.count(myNodeName) and not hasBGP) {
+    return std::nullopt;
+  }
+
+  // Check for enabledV4_
+  auto prefixStr = prefix.prefixAddress.addr;
+  bool isV4Prefix = prefixStr.size() == folly::IPAddressV4::byteCount();
+  if (isV4Prefix && !enableV4_) {
+    LOG(WARNING) << "Received v4 prefix while v4 is not enabled.";
+    fb303::fbData->addStatValue(
+        "decision.skipped_unicast_route", 1, fb303::COUNT);
+    return std::nullopt;
+  }
+
+  const auto forwardingAlgorithm = hasKsp2EdEcmp and not hasSpEcmp
+      ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
+      : thrift::PrefixForwardingAlgorithm::SP_ECMP;
+
+  if (forwardingAlgorithm == thrift::PrefixForwardingAlgorithm::SP_ECMP) {
+    return hasBGP
+        ? createBGPRoute(myNodeName, prefix, nodePrefixes, isV4Prefix)
+        : createOpenRRoute(myNodeName, prefix, nodePrefixes, isV4Prefix);
+  }
+
+  const auto nodes = getBestAnnouncingNodes(
+      myNodeName, prefix, nodePrefixes, isV4Prefix, hasBGP, true);
+  if (nodes.success && nodes.nodes.size() != 0) {
+    prefixToPerformKsp[prefix] = nodes;
+  }
+  return std::nullopt;
+}
+
+std::unordered_map<thrift::IpPrefix, std::optional<thrift::UnicastRoute>>
+SpfSolver::SpfSolverImpl::buildKsp2Routes(
+    std::string const& myNodeName,
+    std::unordered_map<thrift::IpPrefix, BestPathCalResult> const&
+        prefixToPerformKsp) {
+  TraceScope span(traceBuffer_.get(), "ksp2");
+  span.setArg(prefixToPerformKsp.size());
+  std::unordered_set<std::string> nodesForKsp;
+  for (const auto& kv : prefixToPerformKsp) {
+    for (const auto& node : kv.second.nodes) {
+      nodesForKsp.insert(node);
+    }
+  }
+
+  auto routeToNodes = createOpenRKsp2EdRouteForNodes(myNodeName, nodesForKsp);
+
+  std::unordered_map<thrift::IpPrefix, std::optional<thrift::UnicastRoute>>
+      routes;
+  for (const auto& kv : prefixToPerformKsp) {
+    routes.emplace(
+        kv.first,
+        selectKsp2Routes(
+            kv.first,
+            myNodeName,
+            kv.second,
+            routeToNodes,
+            prefixState_.prefixes().at(IpPrefixKey(kv.first))));
+  }
+  return routes;
+}
+
+void
+SpfSolver::SpfSolverImpl::startUnicastRoutesUpdate() {
+  // Snapshot route inputs other than prefixes and SPF results
+  std::unordered_map<std::string, NodeRouteAttrs> nodeAttrs;
+  for (auto const& kv : linkState_.getAdjacencyDatabases()) {
+    auto& attrs = nodeAttrs[kv.first];
+    attrs.overloaded = linkState_.isNodeOverloaded(kv.first);
+    attrs.nodeLabel = kv.second.nodeLabel;
+  }
+  for (auto const& kv : prefixState_.getNodeHostLoopbacksV4()) {
+    nodeAttrs[kv.first].loopbackV4 = kv.second;
+  }
+  for (auto const& kv : prefixState_.getNodeHostLoopbacksV6()) {
+    nodeAttrs[kv.first].loopbackV6 = kv.second;
+  }
 
-  std::unordered_set<std::string> nodesForKsp;
+  std::vector<LocalLinkAttrs> localLinks;
+  for (auto const& link : linkState_.linksFromNode(myNodeName_)) {
+    localLinks.emplace_back(LocalLinkAttrs{link->getOtherNodeName(myNodeName_),
+                                           link->getIfaceFromNode(myNodeName_),
+                                           link->getNhV4FromNode(myNodeName_),
+                                           link->getNhV6FromNode(myNodeName_),
+                                           link->getMetricFromNode(myNodeName_),
+                                           link->isUp()});
+  }
+  std::sort(
+      localLinks.begin(), localLinks.end(), [](auto const& a, auto const& b) {
+        return std::tie(a.otherNodeName, a.iface) <
+            std::tie(b.otherNodeName, b.iface);
+      });
 
-  for (const auto& kv : prefixState_.prefixes()) {
-    const auto& prefix = kv.first;
-    const auto& nodePrefixes = kv.second;
-
-    bool hasBGP = false, hasNonBGP = false, missingMv = false;
-    bool hasSpEcmp = false, hasKsp2EdEcmp = false;
-    for (auto const& npKv : nodePrefixes) {
-      bool isBGP = npKv.second.type == thrift::PrefixType::BGP;
-      hasBGP |= isBGP;
-      hasNonBGP |= !isBGP;
-      if (isBGP and not npKv.second.mv.has_value()) {
-        missingMv = true;
-        LOG(ERROR) << "Prefix entry for prefix " << toString(npKv.second.prefix)
-                   << " advertised by " << npKv.first
-                   << " is of type BGP but does not contain a metric vector.";
-      }
-      hasSpEcmp |= npKv.second.forwardingAlgorithm ==
-          thrift::PrefixForwardingAlgorithm::SP_ECMP;
-      hasKsp2EdEcmp |= npKv.second.forwardingAlgorithm ==
-          thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP;
-    }
-
-    // skip adding route for BGP prefixes that have issues
-    if (hasBGP) {
-      if (hasNonBGP) {
-        LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
-                   << " which is advertised with BGP and non-BGP type.";
-        fb303::fbData->addStatValue(
-            "decision.skipped_unicast_route", 1, fb303::COUNT);
-        continue;
+  // Changes to our own links or to any distance towards us (used for LFA)
+  // affect every route
+  bool rebuildAll = not routeInputsValid_ or localLinks != routeLocalLinks_ or
+      spfResults_.size() != routeSpfResults_.size();
+
+  // Find nodes whose routes may have changed
+  std::unordered_set<std::string> changedNodes;
+  auto markChanged = [&changedNodes, &rebuildAll, this](const auto& nodeName) {
+    if (nodeName == myNodeName_) {
+      rebuildAll = true;
+    }
+    changedNodes.emplace(nodeName);
+  };
+  for (auto const& kv : spfResults_) {
+    if (rebuildAll) {
+      break;
+    }
+    auto const oldIt = routeSpfResults_.find(kv.first);
+    if (oldIt == routeSpfResults_.end()) {
+      rebuildAll = true;
+      break;
+    }
+    auto const& newResult = kv.second;
+    auto const& oldResult = oldIt->second;
+    for (auto const& nodeKv : newResult) {
+      auto const it = oldResult.find(nodeKv.first);
+      if (it == oldResult.end() or it->second != nodeKv.second) {
+        markChanged(nodeKv.first);
       }
-      if (missingMv) {
-        LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
-                   << " at least one advertiser is missing its metric vector.";
-        fb303::fbData->addStatValue(
-            "decision.skipped_unicast_route", 1, fb303::COUNT);
-        continue;
+    }
+    for (auto const& nodeKv : oldResult) {
+      if (not newResult.count(nodeKv.first)) {
+        markChanged(nodeKv.first);
       }
     }
-
-    // skip adding route for prefixes advertised by this node
-    if (nodePrefixes.count(myNodeName) and not hasBGP) {
-      continue;
+  }
+  if (not rebuildAll) {
+    for (auto const& kv : nodeAttrs) {
+      auto const it = routeNodeAttrs_.find(kv.first);
+      if (it == routeNodeAttrs_.end() or it->second != kv.second) {
+        changedNodes.emplace(kv.first);
+      }
+    }
+    for (auto const& kv : routeNodeAttrs_) {
+      if (not nodeAttrs.count(kv.first)) {
+        changedNodes.emplace(kv.first);
+      }
     }
+  }
 
-    // Check for enabledV4_
-    auto prefixStr = prefix.prefixAddress.addr;
-    bool isV4Prefix = prefixStr.size() == folly::IPAddressV4::byteCount();
-    if (isV4Prefix && !enableV4_) {
-      LOG(WARNING) << "Received v4 prefix while v4 is not enabled.";
-      fb303::fbData->addStatValue(
-          "decision.skipped_unicast_route", 1, fb303::COUNT);
-      continue;
+  std::unordered_set<IpPrefixKey> prefixesToBuild;
+  if (rebuildAll) {
+    for (auto const& kv : unicastRoutes_) {
+      prefixesToBuild.emplace(kv.first);
+    }
+    for (auto const& kv : prefixState_.prefixes()) {
+      prefixesToBuild.emplace(kv.first);
+    }
+  } else {
+    prefixesToBuild = prefixState_.getChangedPrefixes();
+    auto const& nodeToPrefixes = prefixState_.getNodeToPrefixes();
+    for (auto const& nodeName : changedNodes) {
+      auto const it = nodeToPrefixes.find(nodeName);
+      if (it != nodeToPrefixes.end()) {
+        prefixesToBuild.insert(it->second.begin(), it->second.end());
+      }
     }
+    // KSP2_ED_ECMP paths aren't confined to shortest paths, any topology
+    // change may alter them
+    if (not changedNodes.empty() or
+        routeLinkStateVersion_ != linkState_.getVersion()) {
+      prefixesToBuild.insert(ksp2Prefixes_.begin(), ksp2Prefixes_.end());
+    }
+    // so are remote LFA paths
+    if (routeLinkStateVersion_ != linkState_.getVersion()) {
+      prefixesToBuild.insert(
+          remoteLfaPrefixes_.begin(), remoteLfaPrefixes_.end());
+    }
+  }
 
-    const auto forwardingAlgorithm = hasKsp2EdEcmp and not hasSpEcmp
-        ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
-        : thrift::PrefixForwardingAlgorithm::SP_ECMP;
+  // routes of abandoned builds may be based on outdated inputs
+  prefixesToBuild.insert(
+      abandonedRoutePrefixes_.begin(), abandonedRoutePrefixes_.end());
+  abandonedRoutePrefixes_.clear();
 
-    if (forwardingAlgorithm == thrift::PrefixForwardingAlgorithm::SP_ECMP) {
-      auto route = hasBGP
-          ? createBGPRoute(myNodeName, prefix, nodePrefixes, isV4Prefix)
-          : createOpenRRoute(myNodeName, prefix, nodePrefixes, isV4Prefix);
-      if (route.has_value()) {
-        routeDb.unicastRoutes.emplace_back(std::move(route.value()));
-      }
-    } else {
-      const auto nodes = getBestAnnouncingNodes(
-          myNodeName, prefix, nodePrefixes, isV4Prefix, hasBGP, true);
-      if (nodes.success && nodes.nodes.size() != 0) {
-        prefixToPerformKsp[prefix] = nodes;
-        for (const auto& node : nodes.nodes) {
-          nodesForKsp.insert(node);
-        }
+  VLOG(1) << "Decision: rebuilding routes of " << prefixesToBuild.size()
+          << " prefixes, " << (rebuildAll ? "all" : "partial") << " update.";
+  fb303::fbData->addStatValue(
+      "decision.route_build_prefixes", prefixesToBuild.size(), fb303::AVG);
+
+  auto& build = routeBuild_.value();
+  build.prefixes.assign(prefixesToBuild.begin(), prefixesToBuild.end());
+  build.nodeAttrs = std::move(nodeAttrs);
+  build.localLinks = std::move(localLinks);
+  // node label routes depend on the same inputs of their node only
+  build.rebuildAllLabels = rebuildAll;
+  if (not rebuildAll) {
+    build.labelNodes = std::move(changedNodes);
+  }
+}
+
+bool
+SpfSolver::SpfSolverImpl::continueUnicastRoutesUpdate(
+    std::optional<std::chrono::steady_clock::time_point> deadline) {
+  auto& build = routeBuild_.value();
+  // prefixes built between deadline checks, enough for a chunk per thread
+  // when building in parallel
+  const size_t numThreads = spfExecutor_ ? spfExecutor_->numThreads() : 1;
+  const size_t batchSize = numThreads > 1
+      ? numThreads * Constants::kDecisionRouteBuildChunkSize
+      : 1;
+  {
+    // best path selection and route creation of the prefixes in this slice
+    TraceScope span(traceBuffer_.get(), "best_path");
+    // every slice makes progress
+    for (size_t built = 0; build.next < build.prefixes.size();) {
+      if (built > 0 and deadline.has_value() and
+          std::chrono::steady_clock::now() >= deadline.value()) {
+        return false;
       }
+      const auto begin = build.next;
+      const auto end = std::min(begin + batchSize, build.prefixes.size());
+      buildUnicastRoutes(begin, end);
+      build.next = end;
+      built += end - begin;
+      span.setArg(built);
     }
-  } // for prefixState_.prefixes()
+  }
+  for (auto& kv : buildKsp2Routes(myNodeName_, build.prefixToPerformKsp)) {
+    const IpPrefixKey prefix(kv.first);
+    ksp2Prefixes_.emplace(prefix);
+    updateUnicastRoute(prefix, std::move(kv.second));
+  }
 
-  auto routeToNodes = createOpenRKsp2EdRouteForNodes(myNodeName, nodesForKsp);
+  prefixState_.clearChangedPrefixes();
+  routeInputsValid_ = true;
+  routeSpfResults_ = spfResults_;
+  routeNodeAttrs_ = std::move(build.nodeAttrs);
+  routeLocalLinks_ = std::move(build.localLinks);
+  routeLinkStateVersion_ = linkState_.getVersion();
+  return true;
+}
 
-  for (const auto& kv : prefixToPerformKsp) {
-    auto unicastRoute = selectKsp2Routes(
-        kv.first,
-        myNodeName,
-        kv.second,
-        routeToNodes,
-        prefixState_.prefixes().at(kv.first));
-    if (unicastRoute.has_value()) {
-      routeDb.unicastRoutes.emplace_back(std::move(unicastRoute.value()));
-    }
+void
+SpfSolver::SpfSolverImpl::buildUnicastRoutes(size_t begin, size_t end) {
+  auto& build = routeBuild_.value();
+  auto const& prefixes = prefixState_.prefixes();
+  for (size_t i = begin; i < end; ++i) {
+    ksp2Prefixes_.erase(build.prefixes[i]);
+    remoteLfaPrefixes_.erase(build.prefixes[i]);
   }
 
-  //
-  // Create MPLS routes for all nodeLabel
-  //
-  for (const auto& kv : linkState_.getAdjacencyDatabases()) {
-    const auto& adjDb = kv.second;
-    const auto topLabel = adjDb.nodeLabel;
-    // Top label is not set => Non-SR mode
-    if (topLabel == 0) {
-      continue;
+  // routes of a chunk of prefixes, nullopt for prefixes without one
+  struct ChunkRoutes {
+    std::vector<std::optional<thrift::UnicastRoute>> routes;
+    std::unordered_map<thrift::IpPrefix, BestPathCalResult> prefixToPerformKsp;
+  };
+  // only reads SPF results and route inputs, besides the guarded caches
+  auto buildChunk = [this, &build, &prefixes](size_t from, size_t to) {
+    ChunkRoutes chunk;
+    chunk.routes.reserve(to - from);
+    for (size_t i = from; i < to; ++i) {
+      auto const& prefix = build.prefixes[i];
+      auto const it = prefixes.find(prefix);
+      if (it == prefixes.end()) {
+        chunk.routes.emplace_back(std::nullopt);
+        continue;
+      }
+      chunk.routes.emplace_back(buildUnicastRoute(
+          myNodeName_,
+          prefix.toThrift(),
+          it->second,
+          chunk.prefixToPerformKsp));
     }
-    // If mpls label is not valid then ignore it
-    if (not isMplsLabelValid(topLabel)) {
-      LOG(ERROR) << "Ignoring invalid node label " << topLabel << " of node "
-                 << adjDb.thisNodeName;
-      fb303::fbData->addStatValue(
-          "decision.skipped_mpls_route", 1, fb303::COUNT);
-      continue;
+    return chunk;
+  };
+
+  const auto chunkSize = Constants::kDecisionRouteBuildChunkSize;
+  std::vector<ChunkRoutes> chunks;
+  if (not spfExecutor_ or spfExecutor_->numThreads() < 2 or
+      end - begin < 2 * chunkSize) {
+    chunks.emplace_back(buildChunk(begin, end));
+  } else {
+    // lazily computed state the chunks would otherwise race on
+    if (remoteLfaSpfRuns_) {
+      linkState_.getCsrGraph();
+      updateRemoteLfaCandidates();
     }
-
-    // Install POP_AND_LOOKUP for next layer
-    if (adjDb.thisNodeName == myNodeName) {
-      thrift::NextHopThrift nh;
-      nh.address = toBinaryAddress(folly::IPAddressV6("::"));
-      nh.mplsAction = createMplsAction(thrift::MplsActionCode::POP_AND_LOOKUP);
-      routeDb.mplsRoutes.emplace_back(
-          createMplsRoute(topLabel, {std::move(nh)}));
-      continue;
+    std::vector<folly::Future<ChunkRoutes>> chunkBuilds;
+    for (size_t from = begin; from < end; from += chunkSize) {
+      const auto to = std::min(from + chunkSize, end);
+      chunkBuilds.emplace_back(folly::via(
+          spfExecutor_.get(),
+          [&buildChunk, from, to]() { return buildChunk(from, to); }));
     }
-
-    // Get best nexthop towards the node
-    auto metricNhs =
-        getNextHopsWithMetric(myNodeName, {adjDb.thisNodeName}, false);
-    if (metricNhs.second.empty()) {
-      LOG(WARNING) << "No route to nodeLabel " << std::to_string(topLabel)
-                   << " of node " << adjDb.thisNodeName;
-      fb303::fbData->addStatValue(
-          "decision.no_route_to_label", 1, fb303::COUNT);
-      continue;
+    for (auto& chunkBuild : folly::collectAll(chunkBuilds).get()) {
+      chunks.emplace_back(std::move(chunkBuild.value()));
     }
-
-    // Create nexthops with appropriate MplsAction (PHP and SWAP). Note that all
-    // nexthops are valid for routing without loops. Fib is responsible for
-    // installing these routes by making sure it programs least cost nexthops
-    // first and of same action type (based on HW limitations)
-    auto nextHopsThrift = getNextHopsThrift(
-        myNodeName,
-        {adjDb.thisNodeName},
-        false,
-        false,
-        metricNhs.first,
-        metricNhs.second,
-        topLabel);
-    routeDb.mplsRoutes.emplace_back(
-        createMplsRoute(topLabel, std::move(nextHopsThrift)));
   }
 
-  //
-  // Create MPLS routes for all of our adjacencies
-  //
-  for (const auto& link : linkState_.linksFromNode(myNodeName)) {
-    const auto topLabel = link->getAdjLabelFromNode(myNodeName);
-    // Top label is not set => Non-SR mode
-    if (topLabel == 0) {
-      continue;
-    }
-    // If mpls label is not valid then ignore it
-    if (not isMplsLabelValid(topLabel)) {
-      LOG(ERROR) << "Ignoring invalid adjacency label " << topLabel
-                 << " of link " << link->directionalToString(myNodeName);
-      fb303::fbData->addStatValue(
-          "decision.skipped_mpls_route", 1, fb303::COUNT);
-      continue;
+  auto i = begin;
+  for (auto& chunk : chunks) {
+    for (auto& route : chunk.routes) {
+      auto const& prefix = build.prefixes[i++];
+      // KSP2_ED_ECMP routes get built once all prefixes are done
+      if (chunk.prefixToPerformKsp.empty() or
+          not chunk.prefixToPerformKsp.count(prefix.toThrift())) {
+        updateUnicastRoute(prefix, std::move(route));
+      }
     }
+    build.prefixToPerformKsp.merge(chunk.prefixToPerformKsp);
+  }
+}
 
-    auto nh = createNextHop(
-        link->getNhV6FromNode(myNodeName),
-        link->getIfaceFromNode(myNodeName),
-        link->getMetricFromNode(myNodeName),
-        createMplsAction(thrift::MplsActionCode::PHP));
-    routeDb.mplsRoutes.emplace_back(createMplsRoute(topLabel, {std::move(nh)}));
+void
+SpfSolver::SpfSolverImpl::updateUnicastRoute(
+    IpPrefixKey const& prefix, std::optional<thrift::UnicastRoute> route) {
+  auto const it = unicastRoutes_.find(prefix);
+  if (not route.has_value()) {
+    if (it != unicastRoutes_.end()) {
+      unicastRoutes_.erase(it);
+      unicastRoutesToUpdate_.erase(prefix);
+      unicastRoutesToDelete_.emplace(prefix);
+    }
+    return;
+  }
+  if (it != unicastRoutes_.end() and *it->second == route.value()) {
+    return;
   }
+  unicastRoutesToDelete_.erase(prefix);
+  unicastRoutesToUpdate_[prefix] = route.value();
+  unicastRoutes_[prefix] =
+      std::make_shared<const thrift::UnicastRoute>(std::move(route.value()));
+}
 
-  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::steady_clock::now() - startTime);
-  LOG(INFO) << "Decision::buildRouteDb took " << deltaTime.count() << "ms.";
-  fb303::fbData->addStatValue(
-      "decision.route_build_ms", deltaTime.count(), fb303::AVG);
-  return routeDb;
-} // buildRouteDb
+thrift::RouteDatabaseDelta
+SpfSolver::SpfSolverImpl::getUnicastRoutesDelta() {
+  thrift::RouteDatabaseDelta delta;
+  delta.thisNodeName = myNodeName_;
+  delta.unicastRoutesToUpdate.reserve(unicastRoutesToUpdate_.size());
+  for (auto& kv : unicastRoutesToUpdate_) {
+    delta.unicastRoutesToUpdate.emplace_back(std::move(kv.second));
+  }
+  delta.unicastRoutesToDelete.reserve(unicastRoutesToDelete_.size());
+  for (auto const& prefix : unicastRoutesToDelete_) {
+    delta.unicastRoutesToDelete.emplace_back(prefix.toThrift());
+  }
+  unicastRoutesToUpdate_.clear();
+  unicastRoutesToDelete_.clear();
+  return delta;
+}
 
 BestPathCalResult
 SpfSolver::SpfSolverImpl::getBestAnnouncingNodes(
@@ -966,6 +2467,53 @@ SpfSolver::SpfSolverImpl::maybeFilterDrainedNodes(
   return filtered.nodes.empty() ? result : filtered;
 }
 
+std::shared_ptr<const SpfSolver::SpfSolverImpl::NextHops>
+SpfSolver::SpfSolverImpl::getNextHops(
+    const std::string& myNodeName,
+    const std::set<std::string>& dstNodeNames,
+    bool isV4,
+    bool perDestination) {
+  auto computeNextHops = [&]() {
+    auto nhs = std::make_shared<NextHops>();
+    std::tie(nhs->minMetric, nhs->nextHopNodes) =
+        getNextHopsWithMetric(myNodeName, dstNodeNames, perDestination);
+    if (not nhs->nextHopNodes.empty()) {
+      // Convert list of neighbor nodes to nexthops (considering adjacencies)
+      nhs->nextHops = getNextHopsThrift(
+          myNodeName,
+          dstNodeNames,
+          isV4,
+          perDestination,
+          nhs->minMetric,
+          nhs->nextHopNodes,
+          std::nullopt);
+    }
+    return std::shared_ptr<const NextHops>(std::move(nhs));
+  };
+  if (myNodeName != myNodeName_ or not routeBuild_.has_value()) {
+    return computeNextHops();
+  }
+
+  auto& build = routeBuild_.value();
+  auto key = std::make_tuple(dstNodeNames, isV4, perDestination);
+  {
+    std::lock_guard<std::mutex> lock(build.nextHopsMutex);
+    auto it = build.nextHops.find(key);
+    if (it != build.nextHops.end()) {
+      fb303::fbData->addStatValue(
+          "decision.next_hops_cache_hits", 1, fb303::COUNT);
+      return it->second;
+    }
+  }
+  fb303::fbData->addStatValue(
+      "decision.next_hops_cache_misses", 1, fb303::COUNT);
+
+  auto nhs = computeNextHops();
+  std::lock_guard<std::mutex> lock(build.nextHopsMutex);
+  build.nextHops.emplace(std::move(key), nhs);
+  return nhs;
+}
+
 std::optional<thrift::UnicastRoute>
 SpfSolver::SpfSolverImpl::createOpenRRoute(
     std::string const& myNodeName,
@@ -984,26 +2532,28 @@ SpfSolver::SpfSolverImpl::createOpenRRoute(
   const bool perDestination = getPrefixForwardingType(nodePrefixes) ==
       thrift::PrefixForwardingType::SR_MPLS;
 
-  const auto metricNhs =
-      getNextHopsWithMetric(myNodeName, prefixNodes, perDestination);
-  if (metricNhs.second.empty()) {
+  const auto nhs =
+      getNextHops(myNodeName, prefixNodes, isV4, perDestination);
+  if (nhs->nextHopNodes.empty()) {
     LOG(WARNING) << "No route to prefix " << toString(prefix)
                  << ", advertised by: " << folly::join(", ", prefixNodes);
     fb303::fbData->addStatValue("decision.no_route_to_prefix", 1, fb303::COUNT);
     return std::nullopt;
   }
 
-  // Convert list of neighbor nodes to nexthops (considering adjacencies)
-  return createUnicastRoute(
-      prefix,
-      getNextHopsThrift(
-          myNodeName,
-          prefixNodes,
-          isV4,
-          perDestination,
-          metricNhs.first,
-          metricNhs.second,
-          std::nullopt));
+  auto nextHops = nhs->nextHops;
+  if (remoteLfaSpfRuns_ and not perDestination and
+      myNodeName == myNodeName_) {
+    {
+      std::lock_guard<std::mutex> lock(remoteLfaMutex_);
+      remoteLfaPrefixes_.emplace(IpPrefixKey(prefix));
+    }
+    for (auto& nextHop :
+         getRemoteLfaNextHops(prefixNodes, isV4, nhs->nextHopNodes)) {
+      nextHops.emplace_back(std::move(nextHop));
+    }
+  }
+  return createUnicastRoute(prefix, std::move(nextHops));
 }
 
 BestPathCalResult
@@ -1012,8 +2562,52 @@ SpfSolver::SpfSolverImpl::findDstNodesForBgpRoute(
     thrift::IpPrefix const& prefix,
     std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
     bool const isV4) {
-  BestPathCalResult ret;
   const auto& mySpfResult = spfResults_.at(myNodeName);
+  if (myNodeName != myNodeName_) {
+    return selectBgpBestPath(prefix, nodePrefixes, mySpfResult);
+  }
+
+  // The winner only depends on entries of the prefix and on distances to
+  // their announcers, reuse it while both are unchanged
+  std::vector<std::optional<Metric>> announcerMetrics;
+  announcerMetrics.reserve(nodePrefixes.size());
+  for (auto const& kv : nodePrefixes) {
+    auto it = mySpfResult.find(kv.first);
+    if (it == mySpfResult.end()) {
+      announcerMetrics.emplace_back(std::nullopt);
+    } else {
+      announcerMetrics.emplace_back(bgpUseIgpMetric_ ? it->second.first : 0);
+    }
+  }
+  const IpPrefixKey prefixKey(prefix);
+  {
+    std::lock_guard<std::mutex> lock(bgpBestPathsMutex_);
+    auto cached = bgpBestPaths_.find(prefixKey);
+    if (cached != bgpBestPaths_.end() and
+        cached->second.announcerMetrics == announcerMetrics) {
+      fb303::fbData->addStatValue(
+          "decision.bgp_best_path_cache_hits", 1, fb303::COUNT);
+      return cached->second.result;
+    }
+  }
+  fb303::fbData->addStatValue(
+      "decision.bgp_best_path_cache_misses", 1, fb303::COUNT);
+
+  auto ret = selectBgpBestPath(prefix, nodePrefixes, mySpfResult);
+  std::lock_guard<std::mutex> lock(bgpBestPathsMutex_);
+  auto& bestPath = bgpBestPaths_[prefixKey];
+  bestPath.announcerMetrics = std::move(announcerMetrics);
+  bestPath.result = ret;
+  return ret;
+}
+
+BestPathCalResult
+SpfSolver::SpfSolverImpl::selectBgpBestPath(
+    thrift::IpPrefix const& prefix,
+    std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+    SpfResult const& mySpfResult) {
+  BestPathCalResult ret;
+  const IpPrefixKey prefixKey(prefix);
   for (auto const& kv : nodePrefixes) {
     auto const& nodeName = kv.first;
     auto const& prefixEntry = kv.second;
@@ -1037,9 +2631,14 @@ SpfSolver::SpfSolverImpl::findDstNodesForBgpRoute(
       continue;
     }
 
-    // Copy is intentional - As we will need to augment metric vector with
-    // IGP_COST
-    thrift::MetricVector metricVector = prefixEntry.mv.value();
+    // Metric vectors are normalized by prefixState_ when announced
+    auto const* normalizedMv =
+        prefixState_.getNormalizedMetricVector(prefixKey, nodeName);
+    CHECK(normalizedMv) << "No normalized metric vector for prefix "
+                        << toString(prefix) << " from node " << nodeName;
+
+    // Copy only if we need to augment metric vector with IGP_COST
+    std::optional<MetricVectorUtils::NormalizedMetricVector> withIgpCost;
 
     // Associate IGP_COST to prefixEntry
     if (bgpUseIgpMetric_) {
@@ -1048,16 +2647,22 @@ SpfSolver::SpfSolverImpl::findDstNodesForBgpRoute(
           *(ret.bestIgpMetric) > igpMetric) {
         ret.bestIgpMetric = igpMetric;
       }
-      metricVector.metrics.emplace_back(MetricVectorUtils::createMetricEntity(
-          static_cast<int64_t>(thrift::MetricEntityType::OPENR_IGP_COST),
-          static_cast<int64_t>(thrift::MetricEntityPriority::OPENR_IGP_COST),
-          thrift::CompareType::WIN_IF_NOT_PRESENT,
-          false, /* isBestPathTieBreaker */
-          /* lowest metric wins */
-          {-1 * igpMetric}));
+      withIgpCost = *normalizedMv;
+      MetricVectorUtils::addMetricEntity(
+          *withIgpCost,
+          MetricVectorUtils::createMetricEntity(
+              static_cast<int64_t>(thrift::MetricEntityType::OPENR_IGP_COST),
+              static_cast<int64_t>(
+                  thrift::MetricEntityPriority::OPENR_IGP_COST),
+              thrift::CompareType::WIN_IF_NOT_PRESENT,
+              false, /* isBestPathTieBreaker */
+              /* lowest metric wins */
+              {-1 * igpMetric}));
       VLOG(2) << "Attaching IGP metric of " << igpMetric << " to prefix "
               << toString(prefix) << " for node " << nodeName;
     }
+    auto const& metricVector =
+        withIgpCost.has_value() ? *withIgpCost : *normalizedMv;
 
     switch (ret.bestVector.has_value()
                 ? MetricVectorUtils::compareMetricVectors(
@@ -1067,7 +2672,7 @@ SpfSolver::SpfSolverImpl::findDstNodesForBgpRoute(
       ret.nodes.clear();
       FOLLY_FALLTHROUGH;
     case MetricVectorUtils::CompareResult::TIE_WINNER:
-      ret.bestVector = std::move(metricVector);
+      ret.bestVector = metricVector;
       ret.bestData = &(prefixEntry.data);
       ret.bestNode = nodeName;
       FOLLY_FALLTHROUGH;
@@ -1129,22 +2734,12 @@ SpfSolver::SpfSolverImpl::createBGPRoute(
     return std::nullopt;
   }
 
-  const auto nextHopsWithMetric =
-      getNextHopsWithMetric(myNodeName, dstInfo.nodes, false);
-
-  auto allNextHops = getNextHopsThrift(
-      myNodeName,
-      dstInfo.nodes,
-      isV4,
-      false,
-      nextHopsWithMetric.first,
-      nextHopsWithMetric.second,
-      std::nullopt);
+  const auto nhs = getNextHops(myNodeName, dstInfo.nodes, isV4, false);
 
   return thrift::UnicastRoute{FRAGILE,
                               prefix,
                               thrift::AdminDistance::EBGP,
-                              std::move(allNextHops),
+                              nhs->nextHops,
                               thrift::PrefixType::BGP,
                               *(dstInfo.bestData),
                               bgpDryRun_, /* doNotInstall */
@@ -1326,8 +2921,20 @@ SpfSolver::SpfSolverImpl::createOpenRKsp2EdRouteForNodes(
   std::unordered_map<std::string, std::vector<std::pair<Path, Metric>>>
       pathsToNodes;
 
+  invalidateKsp2Paths(myNodeName);
+
   // Prepare list of possible destination nodes
   for (const auto& node : nodes) {
+    auto const cachedIt = ksp2Paths_.find(node);
+    if (cachedIt != ksp2Paths_.end()) {
+      fb303::fbData->addStatValue("decision.ksp2_cache_hits", 1, fb303::COUNT);
+      if (not cachedIt->second.empty()) {
+        pathsToNodes[node] = cachedIt->second;
+      }
+      continue;
+    }
+    fb303::fbData->addStatValue("decision.ksp2_cache_misses", 1, fb303::COUNT);
+
     std::set<std::string> dstNodeNames;
     dstNodeNames.emplace(node);
 
@@ -1367,10 +2974,75 @@ SpfSolver::SpfSolverImpl::createOpenRKsp2EdRouteForNodes(
         }
       }
     }
+
+    auto const it = pathsToNodes.find(node);
+    ksp2Paths_[node] = it != pathsToNodes.end()
+        ? it->second
+        : std::vector<std::pair<Path, Metric>>{};
   }
   return pathsToNodes;
 }
 
+void
+SpfSolver::SpfSolverImpl::invalidateKsp2Paths(std::string const& myNodeName) {
+  auto const maybeChanges = linkState_.getLinkChangesSince(ksp2PathsVersion_);
+  const bool sameSource = myNodeName == ksp2PathsSource_;
+  ksp2PathsSource_ = myNodeName;
+  ksp2PathsVersion_ = linkState_.getVersion();
+  if (not sameSource or not maybeChanges.has_value()) {
+    ksp2Paths_.clear();
+    return;
+  }
+
+  for (auto const& change : maybeChanges.value()) {
+    auto const& link = change.link;
+    // find current state of the link, it may have been removed since
+    Link* curLink{nullptr};
+    for (auto const& l : linkState_.linksFromNode(link->firstNodeName())) {
+      if (*l == *link) {
+        curLink = l;
+        break;
+      }
+    }
+    const bool isUp = curLink and curLink->isUp();
+    if (not change.oldMetric1.has_value()) {
+      if (isUp) {
+        // a new link may provide a shorter path to any destination
+        ksp2Paths_.clear();
+        return;
+      }
+      continue;
+    }
+    if (isUp and
+        (curLink->getMetricFromNode(link->firstNodeName()) <
+             change.oldMetric1.value() or
+         curLink->getMetricFromNode(link->secondNodeName()) <
+             change.oldMetric2.value())) {
+      // link got cheaper, it may provide a shorter path to any destination
+      ksp2Paths_.clear();
+      return;
+    }
+
+    // link became more expensive or went away, only paths over it change
+    for (auto it = ksp2Paths_.begin(); it != ksp2Paths_.end();) {
+      const bool usesLink = std::any_of(
+          it->second.begin(), it->second.end(), [&link](auto const& path) {
+            return std::any_of(
+                path.first.begin(),
+                path.first.end(),
+                [&link](auto const& nodeLink) {
+                  return *nodeLink.second == *link;
+                });
+          });
+      if (usesLink) {
+        it = ksp2Paths_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
 std::pair<Metric, std::unordered_set<std::string>>
 SpfSolver::SpfSolverImpl::getMinCostNodes(
     const SpfResult& spfResult, const std::set<std::string>& dstNodeNames) {
@@ -1562,8 +3234,167 @@ SpfSolver::SpfSolverImpl::findMinDistToNeighbor(
   return min;
 }
 
+std::vector<thrift::NextHopThrift>
+SpfSolver::SpfSolverImpl::getRemoteLfaNextHops(
+    const std::set<std::string>& dstNodeNames,
+    bool isV4,
+    std::unordered_map<std::pair<std::string, std::string>, Metric> const&
+        nextHopNodes) {
+  // next hops over another neighbor, shortest or LFA, protect already
+  std::string primaryName;
+  for (auto const& kv : nextHopNodes) {
+    if (primaryName.empty()) {
+      primaryName = kv.first.first;
+    } else if (kv.first.first != primaryName) {
+      return {};
+    }
+  }
+
+  updateRemoteLfaCandidates();
+  auto const& shortestPathsFromHere = spfResults_.at(myNodeName_);
+  RemoteLfaCandidate const* best{nullptr};
+  Metric bestMetric = std::numeric_limits<Metric>::max();
+  for (auto const& candidate : remoteLfaCandidates_) {
+    // candidates are sorted, none of the rest can do better
+    if (candidate.metric >= bestMetric) {
+      break;
+    }
+    if (candidate.neighborName == primaryName) {
+      continue;
+    }
+    auto const* shortestPathsFromNode =
+        getRemoteSpfResult(candidate.nodeName);
+    if (not shortestPathsFromNode) {
+      break;
+    }
+    auto const toHereIt = shortestPathsFromNode->find(myNodeName_);
+    if (toHereIt == shortestPathsFromNode->end()) {
+      continue;
+    }
+    for (auto const& dstNode : dstNodeNames) {
+      auto const fromHereIt = shortestPathsFromHere.find(dstNode);
+      auto const fromNodeIt = shortestPathsFromNode->find(dstNode);
+      if (fromHereIt == shortestPathsFromHere.end() or
+          fromNodeIt == shortestPathsFromNode->end()) {
+        continue;
+      }
+      // path of the node to the destination must not go through us (Q-space)
+      if (fromNodeIt->second.first >=
+          toHereIt->second.first + fromHereIt->second.first) {
+        continue;
+      }
+      const auto metric = candidate.metric + fromNodeIt->second.first;
+      if (metric < bestMetric) {
+        best = &candidate;
+        bestMetric = metric;
+      }
+    }
+  }
+  if (not best) {
+    return {};
+  }
+
+  // tunnel to the node over the shortest links to the neighbor
+  const auto nodeLabel =
+      linkState_.getAdjacencyDatabases().at(best->nodeName).nodeLabel;
+  std::vector<thrift::NextHopThrift> nextHops;
+  for (const auto& link : linkState_.linksFromNode(myNodeName_)) {
+    if (not link->isUp() or
+        link->getOtherNodeName(myNodeName_) != best->neighborName or
+        link->getMetricFromNode(myNodeName_) != best->linkMetric) {
+      continue;
+    }
+    nextHops.emplace_back(createNextHop(
+        isV4 ? link->getNhV4FromNode(myNodeName_)
+             : link->getNhV6FromNode(myNodeName_),
+        link->getIfaceFromNode(myNodeName_),
+        bestMetric,
+        createMplsAction(
+            thrift::MplsActionCode::PUSH,
+            std::nullopt,
+            std::vector<int32_t>{nodeLabel})));
+  }
+  fb303::fbData->addStatValue("decision.remote_lfa_routes", 1, fb303::COUNT);
+  return nextHops;
+}
+
 void
-SpfSolver::SpfSolverImpl::updateGlobalCounters() {
+SpfSolver::SpfSolverImpl::updateRemoteLfaCandidates() {
+  if (remoteLfaVersion_ == linkState_.getVersion()) {
+    return;
+  }
+  remoteLfaVersion_ = linkState_.getVersion();
+  remoteLfaCandidates_.clear();
+  remoteSpfResults_.clear();
+
+  auto const& shortestPathsFromHere = spfResults_.at(myNodeName_);
+  auto const& adjDbs = linkState_.getAdjacencyDatabases();
+  for (auto const& kv : spfResults_) {
+    auto const& neighborName = kv.first;
+    auto const& shortestPathsFromNeighbor = kv.second;
+    auto const toHereIt = shortestPathsFromNeighbor.find(myNodeName_);
+    if (neighborName == myNodeName_ or
+        toHereIt == shortestPathsFromNeighbor.end()) {
+      continue;
+    }
+    const auto linkMetric = findMinDistToNeighbor(myNodeName_, neighborName);
+    if (linkMetric == std::numeric_limits<Metric>::max()) {
+      continue;
+    }
+    for (auto const& nodeKv : shortestPathsFromNeighbor) {
+      auto const& nodeName = nodeKv.first;
+      if (nodeName == myNodeName_ or nodeName == neighborName) {
+        continue;
+      }
+      auto const fromHereIt = shortestPathsFromHere.find(nodeName);
+      if (fromHereIt == shortestPathsFromHere.end()) {
+        continue;
+      }
+      // path of the neighbor to the node must not go through us (P-space)
+      if (nodeKv.second.first >=
+          toHereIt->second.first + fromHereIt->second.first) {
+        continue;
+      }
+      // tunnels need the node label of the node
+      auto const adjDbIt = adjDbs.find(nodeName);
+      if (adjDbIt == adjDbs.end() or adjDbIt->second.nodeLabel == 0 or
+          not isMplsLabelValid(adjDbIt->second.nodeLabel)) {
+        continue;
+      }
+      remoteLfaCandidates_.emplace_back(RemoteLfaCandidate{
+          neighborName,
+          nodeName,
+          linkMetric,
+          linkMetric + nodeKv.second.first});
+    }
+  }
+  std::sort(
+      remoteLfaCandidates_.begin(),
+      remoteLfaCandidates_.end(),
+      [](auto const& a, auto const& b) {
+        return std::tie(a.metric, a.nodeName, a.neighborName) <
+            std::tie(b.metric, b.nodeName, b.neighborName);
+      });
+}
+
+SpfResult const*
+SpfSolver::SpfSolverImpl::getRemoteSpfResult(const std::string& nodeName) {
+  std::lock_guard<std::mutex> lock(remoteLfaMutex_);
+  auto it = remoteSpfResults_.find(nodeName);
+  if (it != remoteSpfResults_.end()) {
+    return &it->second;
+  }
+  if (remoteSpfResults_.size() >= remoteLfaSpfRuns_) {
+    return nullptr;
+  }
+  fb303::fbData->addStatValue(
+      "decision.remote_lfa_spf_runs", 1, fb303::COUNT);
+  it = remoteSpfResults_.emplace(nodeName, runSpf(nodeName, true)).first;
+  return &it->second;
+}
+
+std::unordered_map<std::string, int64_t>
+SpfSolver::SpfSolverImpl::getCounters() const {
   size_t numPartialAdjacencies{0};
   for (auto const& kv : linkState_.getAdjacencyDatabases()) {
     const auto& adjDb = kv.second;
@@ -1577,23 +3408,26 @@ SpfSolver::SpfSolverImpl::updateGlobalCounters() {
     }
   }
 
-  // Add custom counters
-  fb303::fbData->setCounter(
-      "decision.num_partial_adjacencies", numPartialAdjacencies);
-  fb303::fbData->setCounter(
-      "decision.num_complete_adjacencies", linkState_.numLinks());
+  std::unordered_map<std::string, int64_t> counters;
+  counters["decision.num_partial_adjacencies"] = numPartialAdjacencies;
+  counters["decision.num_complete_adjacencies"] = linkState_.numLinks();
   // When node has no adjacencies then linkState reports 0
-  fb303::fbData->setCounter(
-      "decision.num_nodes",
-      std::max(linkState_.numNodes(), static_cast<size_t>(1ul)));
-  fb303::fbData->setCounter(
-      "decision.num_prefixes", prefixState_.prefixes().size());
-  fb303::fbData->setCounter(
-      "decision.num_nodes_v4_loopbacks",
-      prefixState_.getNodeHostLoopbacksV4().size());
-  fb303::fbData->setCounter(
-      "decision.num_nodes_v6_loopbacks",
-      prefixState_.getNodeHostLoopbacksV6().size());
+  counters["decision.num_nodes"] =
+      std::max(linkState_.numNodes(), static_cast<size_t>(1ul));
+  counters["decision.num_prefixes"] = prefixState_.prefixes().size();
+  counters["decision.num_nodes_v4_loopbacks"] =
+      prefixState_.getNodeHostLoopbacksV4().size();
+  counters["decision.num_nodes_v6_loopbacks"] =
+      prefixState_.getNodeHostLoopbacksV6().size();
+  return counters;
+}
+
+void
+SpfSolver::SpfSolverImpl::updateGlobalCounters() {
+  // Add custom counters
+  for (auto const& kv : getCounters()) {
+    fb303::fbData->setCounter(kv.first, kv.second);
+  }
 }
 
 //
@@ -1606,14 +3440,18 @@ SpfSolver::SpfSolver(
     bool computeLfaPaths,
     bool enableOrderedFib,
     bool bgpDryRun,
-    bool bgpUseIgpMetric)
+    bool bgpUseIgpMetric,
+    std::shared_ptr<folly::CPUThreadPoolExecutor> spfExecutor,
+    size_t remoteLfaSpfRuns)
     : impl_(new SpfSolver::SpfSolverImpl(
           myNodeName,
           enableV4,
           computeLfaPaths,
           enableOrderedFib,
           bgpDryRun,
-          bgpUseIgpMetric)) {}
+          bgpUseIgpMetric,
+          std::move(spfExecutor),
+          remoteLfaSpfRuns)) {}
 
 SpfSolver::~SpfSolver() {}
 
@@ -1626,9 +3464,10 @@ SpfSolver::updateAdjacencyDatabase(
   return impl_->updateAdjacencyDatabase(newAdjacencyDb);
 }
 
-bool
-SpfSolver::staticRoutesUpdated() {
-  return impl_->staticRoutesUpdated();
+std::pair<bool, bool>
+SpfSolver::updateAdjacencyDatabases(
+    std::vector<thrift::AdjacencyDatabase> const& newAdjacencyDbs) {
+  return impl_->updateAdjacencyDatabases(newAdjacencyDbs);
 }
 
 void
@@ -1653,7 +3492,7 @@ SpfSolver::getAdjacencyDatabases() {
 }
 
 thrift::StaticRoutes const&
-SpfSolver::getStaticRoutes() {
+SpfSolver::getStaticRoutes() const {
   return impl_->getStaticRoutes();
 }
 
@@ -1678,6 +3517,42 @@ SpfSolver::buildRouteDb(const std::string& myNodeName) {
   return impl_->buildRouteDb(myNodeName);
 }
 
+bool
+SpfSolver::startRouteBuild(bool computePaths) {
+  return impl_->startRouteBuild(computePaths);
+}
+
+std::optional<thrift::RouteDatabase>
+SpfSolver::continueRouteBuild(std::chrono::milliseconds timeBudget) {
+  return impl_->continueRouteBuild(timeBudget);
+}
+
+bool
+SpfSolver::hasRouteBuild() const {
+  return impl_->hasRouteBuild();
+}
+
+bool
+SpfSolver::hasSpfRunsInProgress() const {
+  return impl_->hasSpfRunsInProgress();
+}
+
+thrift::RouteDatabaseDelta
+SpfSolver::getUnicastRoutesDelta() {
+  return impl_->getUnicastRoutesDelta();
+}
+
+SpfSolverSnapshot
+SpfSolver::getSnapshot() {
+  return impl_->getSnapshot();
+}
+
+std::optional<thrift::RouteDatabase>
+SpfSolver::buildRouteDbFromSnapshot(
+    SpfSolverSnapshot const& snapshot, const std::string& nodeName) const {
+  return impl_->buildRouteDbFromSnapshot(snapshot, nodeName);
+}
+
 std::optional<thrift::RouteDatabaseDelta>
 SpfSolver::processStaticRouteUpdates() {
   return impl_->processStaticRouteUpdates();
@@ -1688,11 +3563,28 @@ SpfSolver::decrementHolds() {
   return impl_->decrementHolds();
 }
 
+std::unordered_map<std::string, int64_t>
+SpfSolver::getCounters() const {
+  return impl_->getCounters();
+}
+
 void
 SpfSolver::updateGlobalCounters() {
   return impl_->updateGlobalCounters();
 }
 
+std::unordered_map<
+    IpPrefixKey,
+    std::shared_ptr<const thrift::UnicastRoute>> const&
+SpfSolver::getUnicastRoutes() const {
+  return impl_->getUnicastRoutes();
+}
+
+void
+SpfSolver::setTraceBuffer(std::shared_ptr<TraceBuffer> traceBuffer) {
+  impl_->setTraceBuffer(std::move(traceBuffer));
+}
+
 //
 // Decision class implementation
 //
@@ -1709,35 +3601,72 @@ Decision::Decision(
     std::chrono::milliseconds debounceMinDur,
     std::chrono::milliseconds debounceMaxDur,
     std::optional<std::chrono::seconds> gracefulRestartDuration,
-    messaging::RQueue<thrift::Publication> kvStoreUpdatesQueue,
+    messaging::RQueue<KvStorePublication> kvStoreUpdatesQueue,
     messaging::RQueue<thrift::RouteDatabaseDelta> staticRoutesUpdateQueue,
     messaging::ReplicateQueue<thrift::RouteDatabaseDelta>& routeUpdatesQueue,
-    fbzmq::Context& zmqContext)
-    : processUpdatesBackoff_(debounceMinDur, debounceMaxDur),
-      myNodeName_(myNodeName),
+    fbzmq::Context& zmqContext,
+    size_t spfThreads,
+    size_t traceSpans,
+    size_t remoteLfaSpfRuns,
+    RouteStore* routeStore)
+    : myNodeName_(myNodeName),
       adjacencyDbMarker_(adjacencyDbMarker),
       prefixDbMarker_(prefixDbMarker),
-      routeUpdatesQueue_(routeUpdatesQueue) {
-  routeDb_.thisNodeName = myNodeName_;
-  processUpdatesTimer_ = folly::AsyncTimeout::make(
-      *getEvb(), [this]() noexcept { processPendingUpdates(); });
-  spfSolver_ = std::make_unique<SpfSolver>(
-      myNodeName,
-      enableV4,
-      computeLfaPaths,
-      enableOrderedFib,
-      bgpDryRun,
-      bgpUseIgpMetric);
+      enableV4_(enableV4),
+      computeLfaPaths_(computeLfaPaths),
+      enableOrderedFib_(enableOrderedFib),
+      bgpDryRun_(bgpDryRun),
+      bgpUseIgpMetric_(bgpUseIgpMetric),
+      remoteLfaSpfRuns_(remoteLfaSpfRuns),
+      debounceMinDur_(debounceMinDur),
+      debounceMaxDur_(debounceMaxDur),
+      routeStore_(routeStore),
+      routeUpdatesQueue_(routeUpdatesQueue),
+      traceBuffer_(
+          traceSpans ? std::make_shared<TraceBuffer>(traceSpans) : nullptr) {
+  // debounce decisions: time updates waited and how many got coalesced
+  fb303::fbData->addHistogram(
+      "decision.debounce_wait_ms",
+      std::max<int64_t>(1, debounceMaxDur.count() / 20),
+      0,
+      debounceMaxDur.count());
+  fb303::fbData->exportHistogramPercentile(
+      "decision.debounce_wait_ms", 50, 95, 99);
+  fb303::fbData->addHistogram("decision.debounce_updates", 5, 0, 500);
+  fb303::fbData->exportHistogramPercentile(
+      "decision.debounce_updates", 50, 95, 99);
+  fb303::fbData->addStatExportType("decision.num_areas", fb303::AVG);
+  if (spfThreads == 0) {
+    spfThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  spfExecutor_ = std::make_shared<folly::CPUThreadPoolExecutor>(
+      spfThreads, std::make_shared<folly::NamedThreadFactory>("DecisionSpf"));
+  routeDbExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+      1, std::make_shared<folly::NamedThreadFactory>("DecisionRouteDb"));
+  getArea(thrift::KvStore_constants::kDefaultArea());
 
   coldStartTimer_ = folly::AsyncTimeout::make(
       *getEvb(), [this]() noexcept { coldStartUpdate(); });
+  staticRoutesTimer_ = folly::AsyncTimeout::make(
+      *getEvb(), [this]() noexcept { processStaticRouteUpdates(); });
   if (gracefulRestartDuration.has_value()) {
     coldStartTimer_->scheduleTimeout(gracefulRestartDuration.value());
   }
 
   // Schedule periodic timer for counter submission
   counterUpdateTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
-    spfSolver_->updateGlobalCounters();
+    // counters of all areas add up
+    std::unordered_map<std::string, int64_t> counters;
+    for (auto const& kv : areas_) {
+      for (auto const& counter : kv.second->spfSolver->getCounters()) {
+        counters[counter.first] += counter.second;
+      }
+    }
+    for (auto const& counter : counters) {
+      fb303::fbData->setCounter(counter.first, counter.second);
+    }
+    fb303::fbData->addStatValue(
+        "decision.num_areas", areas_.size(), fb303::AVG);
     // Schedule next counters update
     counterUpdateTimer_->scheduleTimeout(Constants::kMonitorSubmitInterval);
   });
@@ -1748,7 +3677,11 @@ Decision::Decision(
     orderedFibTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
       LOG(INFO) << "Decrementing Holds";
       decrementOrderedFibHolds();
-      if (spfSolver_->hasHolds()) {
+      bool hasHolds{false};
+      for (auto const& kv : areas_) {
+        hasHolds |= kv.second->spfSolver->hasHolds();
+      }
+      if (hasHolds) {
         auto timeout = getMaxFib();
         LOG(INFO) << "Scheduling next hold decrement in " << timeout.count()
                   << "ms";
@@ -1768,10 +3701,17 @@ Decision::Decision(
         break;
       }
 
+      // publications of each area go to its own pipeline
+      auto const& thriftPub = *maybeThriftPub.value();
+      auto& area = getArea(
+          thriftPub.area.has_value()
+              ? thriftPub.area.value()
+              : thrift::KvStore_constants::kDefaultArea());
+
       // Apply publication and update stored update status
       ProcessPublicationResult res; // default initialized to false
       try {
-        res = processPublication(maybeThriftPub.value());
+        res = processPublication(area, thriftPub);
       } catch (const std::exception& e) {
 #if FOLLY_USE_SYMBOLIZER
         // collect stack strace then fail the process
@@ -1783,17 +3723,12 @@ Decision::Decision(
         LOG(FATAL) << "Exception occured in Decision::processPublication - "
                    << folly::exceptionStr(e);
       }
-      processUpdatesStatus_.adjChanged |= res.adjChanged;
-      processUpdatesStatus_.prefixesChanged |= res.prefixesChanged;
-      // compute routes with exponential backoff timer if needed
-      if (res.adjChanged || res.prefixesChanged) {
-        if (!processUpdatesBackoff_.atMaxBackoff()) {
-          processUpdatesBackoff_.reportError();
-          processUpdatesTimer_->scheduleTimeout(
-              processUpdatesBackoff_.getTimeRemainingUntilRetry());
-        } else {
-          CHECK(processUpdatesTimer_->isScheduled());
-        }
+      area.processUpdatesStatus.adjChanged |= res.adjChanged;
+      area.processUpdatesStatus.prefixesChanged |= res.prefixesChanged;
+      // compute routes with debounce if needed
+      if (res.adjChanged || res.prefixesChanged ||
+          !area.pendingKeyVals.empty()) {
+        scheduleProcessUpdates(area);
       }
     }
   });
@@ -1809,35 +3744,88 @@ Decision::Decision(
             LOG(INFO) << "Terminating prefix manager update processing fiber";
             break;
           }
-          // Apply publication and update stored update status
-          pushRoutesDeltaUpdates(maybeThriftPub.value());
-          if (!processUpdatesBackoff_.atMaxBackoff()) {
-            processUpdatesBackoff_.reportError();
-            processUpdatesTimer_->scheduleTimeout(
-                processUpdatesBackoff_.getTimeRemainingUntilRetry());
-          } else {
-            CHECK(processUpdatesTimer_->isScheduled());
+          // Static routes are kept by the default area, buffer them for the
+          // debounce. They don't trigger any route computation
+          auto& area = getArea(thrift::KvStore_constants::kDefaultArea());
+          area.spfSolver->pushRoutesDeltaUpdates(maybeThriftPub.value());
+          if (not staticRoutesTimer_->isScheduled()) {
+            staticRoutesTimer_->scheduleTimeout(debounceMinDur_);
           }
         }
       });
 }
 
+Decision::Area&
+Decision::getArea(const std::string& areaName) {
+  auto& area = areas_[areaName];
+  if (area) {
+    return *area;
+  }
+
+  VLOG(1) << "Decision: starting route computation for area " << areaName;
+  area = std::make_unique<Area>(areaName, debounceMinDur_, debounceMaxDur_);
+  area->spfSolver = std::make_unique<SpfSolver>(
+      myNodeName_,
+      enableV4_,
+      computeLfaPaths_,
+      enableOrderedFib_,
+      bgpDryRun_,
+      bgpUseIgpMetric_,
+      spfExecutor_,
+      remoteLfaSpfRuns_);
+  area->spfSolver->setTraceBuffer(traceBuffer_);
+  // areas are never destroyed before Decision, so are their timers
+  auto* areaPtr = area.get();
+  area->processUpdatesTimer = folly::AsyncTimeout::make(
+      *getEvb(),
+      [this, areaPtr]() noexcept { processPendingUpdates(*areaPtr); });
+  area->routeBuildTimer = folly::AsyncTimeout::make(
+      *getEvb(), [this, areaPtr]() noexcept { continueRouteBuild(*areaPtr); });
+  publishSnapshot(*area);
+  return *area;
+}
+
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 Decision::getDecisionRouteDb(std::string nodeName) {
   folly::Promise<std::unique_ptr<thrift::RouteDatabase>> p;
   auto sf = p.getSemiFuture();
   runInEventBaseThread([p = std::move(p), nodeName, this]() mutable {
-    thrift::RouteDatabase routeDb;
-    if (nodeName.empty()) {
-      nodeName = myNodeName_;
+    if (nodeName.empty() or nodeName == myNodeName_) {
+      // our routes as of the last route update, rebuilding them here would
+      // abandon route builds in progress
+      auto routeDb = std::make_unique<thrift::RouteDatabase>();
+      routeDb->thisNodeName = myNodeName_;
+      routeDb->unicastRoutes.reserve(unicastRoutes_.size());
+      for (auto const& kv : unicastRoutes_) {
+        routeDb->unicastRoutes.emplace_back(*kv.second);
+      }
+      routeDb->mplsRoutes.reserve(computedMplsRoutes_.size());
+      for (auto const& kv : computedMplsRoutes_) {
+        routeDb->mplsRoutes.emplace_back(kv.second);
+      }
+      p.setValue(std::move(routeDb));
+      return;
     }
-    auto maybeRouteDb = spfSolver_->buildPaths(nodeName);
-    if (maybeRouteDb.has_value()) {
-      routeDb = std::move(maybeRouteDb.value());
-    } else {
-      routeDb.thisNodeName = nodeName;
+    // routes of other nodes are computed from snapshots, so that they do
+    // not hold up processing of updates
+    std::vector<std::pair<SpfSolver const*, SpfSolverSnapshot>> snapshots;
+    for (auto const& kv : areas_) {
+      snapshots.emplace_back(
+          kv.second->spfSolver.get(), kv.second->spfSolver->getSnapshot());
     }
-    p.setValue(std::make_unique<thrift::RouteDatabase>(std::move(routeDb)));
+    routeDbExecutor_->add([p = std::move(p),
+                           nodeName = std::move(nodeName),
+                           snapshots = std::move(snapshots)]() mutable {
+      std::vector<thrift::RouteDatabase> routeDbs;
+      for (auto const& solverAndSnapshot : snapshots) {
+        routeDbs.emplace_back(toRouteDb(
+            nodeName,
+            solverAndSnapshot.first->buildRouteDbFromSnapshot(
+                solverAndSnapshot.second, nodeName)));
+      }
+      p.setValue(std::make_unique<thrift::RouteDatabase>(
+          mergeRouteDbs(nodeName, std::move(routeDbs))));
+    });
   });
   return sf;
 }
@@ -1847,7 +3835,8 @@ Decision::getDecisionStaticRoutes() {
   folly::Promise<std::unique_ptr<thrift::StaticRoutes>> p;
   auto sf = p.getSemiFuture();
   runInEventBaseThread([p = std::move(p), this]() mutable {
-    auto staticRoutes = spfSolver_->getStaticRoutes();
+    auto staticRoutes = getArea(thrift::KvStore_constants::kDefaultArea())
+                            .spfSolver->getStaticRoutes();
     p.setValue(std::make_unique<thrift::StaticRoutes>(std::move(staticRoutes)));
   });
   return sf;
@@ -1855,74 +3844,187 @@ Decision::getDecisionStaticRoutes() {
 
 folly::SemiFuture<std::unique_ptr<thrift::AdjDbs>>
 Decision::getDecisionAdjacencyDbs() {
-  folly::Promise<std::unique_ptr<thrift::AdjDbs>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread([p = std::move(p), this]() mutable {
-    auto adjDbs = spfSolver_->getAdjacencyDatabases();
-    p.setValue(std::make_unique<thrift::AdjDbs>(std::move(adjDbs)));
+  // served from the published snapshots, without a trip to the event base.
+  // Databases of a node in several areas are reported for the first one
+  auto adjDbs = std::make_unique<thrift::AdjDbs>();
+  publishedSnapshots_.withRLock([&](auto const& snapshots) {
+    for (auto const& kv : snapshots) {
+      adjDbs->insert(
+          kv.second.adjacencyDbs->begin(), kv.second.adjacencyDbs->end());
+    }
   });
-  return sf;
+  return folly::makeSemiFuture(std::move(adjDbs));
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
 Decision::getDecisionPrefixDbs() {
-  folly::Promise<std::unique_ptr<thrift::PrefixDbs>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread([p = std::move(p), this]() mutable {
-    auto prefixDbs = spfSolver_->getPrefixDatabases();
-    p.setValue(std::make_unique<thrift::PrefixDbs>(std::move(prefixDbs)));
+  auto prefixDbs = std::make_unique<thrift::PrefixDbs>();
+  publishedSnapshots_.withRLock([&](auto const& snapshots) {
+    for (auto const& kv : snapshots) {
+      prefixDbs->insert(
+          kv.second.prefixDbs->begin(), kv.second.prefixDbs->end());
+    }
+  });
+  return folly::makeSemiFuture(std::move(prefixDbs));
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::TraceSpans>>
+Decision::getDecisionTraceSpans() {
+  // the buffer is read without a trip to the event base
+  if (not traceBuffer_) {
+    return folly::makeSemiFuture(std::make_unique<thrift::TraceSpans>());
+  }
+  return folly::makeSemiFuture(std::make_unique<thrift::TraceSpans>(
+      toThriftTraceSpans(*traceBuffer_)));
+}
+
+void
+Decision::publishSnapshot(Area& area) {
+  auto snapshot = area.spfSolver->getSnapshot();
+  publishedSnapshots_.withWLock([&](auto& published) {
+    published[area.name] = std::move(snapshot);
   });
-  return sf;
 }
 
 thrift::PrefixDatabase
 Decision::updateNodePrefixDatabase(
-    const std::string& key, const thrift::PrefixDatabase& prefixDb) {
+    Area& area,
+    const std::string& key,
+    const thrift::PrefixDatabase& prefixDb) {
   auto const& nodeName = prefixDb.thisNodeName;
+  auto& perPrefixPrefixEntries = area.perPrefixPrefixEntries;
+  auto& fullDbPrefixEntries = area.fullDbPrefixEntries;
+  auto& bucketPrefixEntries = area.bucketPrefixEntries;
 
   auto prefixKey = PrefixKey::fromStr(key);
   if (prefixKey.hasValue()) {
     // per prefix key
     if (prefixDb.deletePrefix) {
-      perPrefixPrefixEntries_[nodeName].erase(prefixKey.value().getIpPrefix());
+      perPrefixPrefixEntries[nodeName].erase(prefixKey.value().getIpPrefix());
     } else {
       if (prefixDb.prefixEntries.empty()) {
         LOG(ERROR) << "Received no entries for prefix db";
       } else {
         LOG_IF(ERROR, prefixDb.prefixEntries.size() > 1)
             << "Received more than one prefix, only the first prefix is processed";
-        perPrefixPrefixEntries_[nodeName][prefixKey.value().getIpPrefix()] =
+        perPrefixPrefixEntries[nodeName][prefixKey.value().getIpPrefix()] =
             prefixDb.prefixEntries[0];
       }
     }
+  } else if (isPrefixBucketKey(key)) {
+    // a bucket key carries all prefixes of its bucket, withdrawn buckets
+    // come with no entry before they expire
+    auto& nodeBuckets = bucketPrefixEntries[nodeName];
+    if (prefixDb.deletePrefix) {
+      nodeBuckets.erase(key);
+    } else {
+      auto& entries = nodeBuckets[key];
+      entries.clear();
+      for (auto const& entry : prefixDb.prefixEntries) {
+        entries[entry.prefix] = entry;
+      }
+    }
+    if (nodeBuckets.empty()) {
+      bucketPrefixEntries.erase(nodeName);
+    }
   } else {
-    fullDbPrefixEntries_[nodeName].clear();
+    fullDbPrefixEntries[nodeName].clear();
     for (auto const& entry : prefixDb.prefixEntries) {
-      fullDbPrefixEntries_[nodeName][entry.prefix] = entry;
+      fullDbPrefixEntries[nodeName][entry.prefix] = entry;
     }
   }
 
+  // per prefix keys override bucket keys, which override the prefix db key
   thrift::PrefixDatabase nodePrefixDb;
   nodePrefixDb.thisNodeName = nodeName;
   nodePrefixDb.perfEvents.copy_from(prefixDb.perfEvents);
-  nodePrefixDb.prefixEntries.reserve(perPrefixPrefixEntries_[nodeName].size());
-  for (auto& kv : perPrefixPrefixEntries_[nodeName]) {
+  nodePrefixDb.prefixEntries.reserve(perPrefixPrefixEntries[nodeName].size());
+  std::unordered_set<thrift::IpPrefix> bucketPrefixes;
+  for (auto& kv : perPrefixPrefixEntries[nodeName]) {
     nodePrefixDb.prefixEntries.emplace_back(kv.second);
   }
-  for (auto& kv : fullDbPrefixEntries_[nodeName]) {
-    if (not perPrefixPrefixEntries_[nodeName].count(kv.first)) {
+  auto bucketsIt = bucketPrefixEntries.find(nodeName);
+  if (bucketsIt != bucketPrefixEntries.end()) {
+    for (auto& bucket : bucketsIt->second) {
+      for (auto& kv : bucket.second) {
+        if (not perPrefixPrefixEntries[nodeName].count(kv.first) and
+            bucketPrefixes.emplace(kv.first).second) {
+          nodePrefixDb.prefixEntries.emplace_back(kv.second);
+        }
+      }
+    }
+  }
+  for (auto& kv : fullDbPrefixEntries[nodeName]) {
+    if (not perPrefixPrefixEntries[nodeName].count(kv.first) and
+        not bucketPrefixes.count(kv.first)) {
       nodePrefixDb.prefixEntries.emplace_back(kv.second);
     }
   }
   return nodePrefixDb;
 }
 
+std::optional<thrift::AdjacencyDatabase>
+Decision::updateNodeAdjacencyDatabase(
+    Area& area,
+    const std::string& key,
+    const std::optional<thrift::AdjacencyDatabase>& adjacencyDb) {
+  const auto nodeName = getNodeNameFromKey(key);
+  auto& fullAdjacencyDbs = area.fullAdjacencyDbs;
+  auto& perAdjacencyEntries = area.perAdjacencyEntries;
+
+  if (isPerAdjacencyKey(key)) {
+    // withdrawn adjacencies come with no entry before they expire
+    if (adjacencyDb.has_value() and not adjacencyDb->adjacencies.empty()) {
+      LOG_IF(ERROR, adjacencyDb->adjacencies.size() > 1)
+          << "Received more than one adjacency, only the first is processed";
+      perAdjacencyEntries[nodeName][key] = adjacencyDb->adjacencies.front();
+    } else {
+      auto it = perAdjacencyEntries.find(nodeName);
+      if (it != perAdjacencyEntries.end()) {
+        it->second.erase(key);
+        if (it->second.empty()) {
+          perAdjacencyEntries.erase(it);
+        }
+      }
+    }
+  } else if (adjacencyDb.has_value()) {
+    fullAdjacencyDbs[nodeName] = *adjacencyDb;
+  } else {
+    fullAdjacencyDbs.erase(nodeName);
+  }
+
+  auto fullIt = fullAdjacencyDbs.find(nodeName);
+  auto perAdjIt = perAdjacencyEntries.find(nodeName);
+  if (fullIt == fullAdjacencyDbs.end() and
+      perAdjIt == perAdjacencyEntries.end()) {
+    return std::nullopt;
+  }
+
+  thrift::AdjacencyDatabase nodeAdjacencyDb;
+  if (fullIt != fullAdjacencyDbs.end()) {
+    nodeAdjacencyDb = fullIt->second;
+  } else {
+    nodeAdjacencyDb.thisNodeName = nodeName;
+    nodeAdjacencyDb.area = area.name;
+  }
+  if (perAdjIt != perAdjacencyEntries.end()) {
+    nodeAdjacencyDb.adjacencies.reserve(
+        nodeAdjacencyDb.adjacencies.size() + perAdjIt->second.size());
+    for (auto const& kv : perAdjIt->second) {
+      nodeAdjacencyDb.adjacencies.emplace_back(kv.second);
+    }
+  }
+  return nodeAdjacencyDb;
+}
+
 ProcessPublicationResult
-Decision::processPublication(thrift::Publication const& thriftPub) {
+Decision::processPublication(
+    Area& area, thrift::Publication const& thriftPub) {
   ProcessPublicationResult res;
 
   // LSDB addition/update
-  // deserialize contents of every LSDB key
+  // buffer contents of every LSDB key, they get deserialized once debounce
+  // fires in processPendingKeyVals()
 
   // Nothing to process if no adj/prefix db changes
   if (thriftPub.keyVals.empty() and thriftPub.expiredKeys.empty()) {
@@ -1940,71 +4042,53 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
       continue;
     }
 
-    try {
-      if (key.find(adjacencyDbMarker_) == 0) {
-        // update adjacencyDb
-        auto adjacencyDb =
-            fbzmq::util::readThriftObjStr<thrift::AdjacencyDatabase>(
-                rawVal.value.value(), serializer_);
-        CHECK_EQ(nodeName, adjacencyDb.thisNodeName);
-        auto rc = spfSolver_->updateAdjacencyDatabase(adjacencyDb);
-        if (rc.first) {
-          res.adjChanged = true;
-          pendingAdjUpdates_.addUpdate(
-              myNodeName_, castToStd(adjacencyDb.perfEvents));
-        }
-        if (rc.second && nodeName == myNodeName_) {
-          // route attribute chanegs only matter for the local node
-          res.prefixesChanged = true;
-          pendingPrefixUpdates_.addUpdate(
-              myNodeName_, castToStd(adjacencyDb.perfEvents));
-        }
-        if (spfSolver_->hasHolds() && orderedFibTimer_ != nullptr &&
-            !orderedFibTimer_->isScheduled()) {
-          orderedFibTimer_->scheduleTimeout(getMaxFib());
-        }
-        continue;
-      }
-
-      if (key.find(prefixDbMarker_) == 0) {
-        // update prefixDb
-        auto prefixDb = fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
-            rawVal.value.value(), serializer_);
-        CHECK_EQ(nodeName, prefixDb.thisNodeName);
-        auto nodePrefixDb = updateNodePrefixDatabase(key, prefixDb);
-        if (spfSolver_->updatePrefixDatabase(nodePrefixDb)) {
-          res.prefixesChanged = true;
-          pendingPrefixUpdates_.addUpdate(
-              myNodeName_, castToStd(nodePrefixDb.perfEvents));
-        }
+    if (key.find(adjacencyDbMarker_) == 0 or key.find(prefixDbMarker_) == 0) {
+      // skip values we have already applied, e.g. version bumps which do
+      // not change the content
+      auto const appliedIt = area.appliedKeyVals.find(key);
+      if (appliedIt != area.appliedKeyVals.end() and
+          appliedIt->second == rawVal.value.value()) {
+        area.pendingKeyVals.erase(key);
+        fb303::fbData->addStatValue(
+            "decision.unchanged_key_vals", 1, fb303::COUNT);
         continue;
       }
+      area.pendingKeyVals[key] = rawVal;
+      continue;
+    }
 
-      if (key.find(Constants::kFibTimeMarker.toString()) == 0) {
-        try {
-          std::chrono::milliseconds fibTime{stoll(rawVal.value.value())};
-          fibTimes_[nodeName] = fibTime;
-        } catch (...) {
-          LOG(ERROR) << "Could not convert "
-                     << Constants::kFibTimeMarker.toString()
-                     << " value to int64";
-        }
-        continue;
+    if (key.find(Constants::kFibTimeMarker.toString()) == 0) {
+      try {
+        std::chrono::milliseconds fibTime{stoll(rawVal.value.value())};
+        fibTimes_[nodeName] = fibTime;
+      } catch (...) {
+        LOG(ERROR) << "Could not convert "
+                   << Constants::kFibTimeMarker.toString()
+                   << " value to int64";
       }
-    } catch (const std::exception& e) {
-      LOG(ERROR) << "Failed to deserialize info for key " << key
-                 << ". Exception: " << folly::exceptionStr(e);
+      continue;
     }
   }
 
   // LSDB deletion
   for (const auto& key : thriftPub.expiredKeys) {
     std::string nodeName = getNodeNameFromKey(key);
+    area.pendingKeyVals.erase(key);
+    area.appliedKeyVals.erase(key);
 
     if (key.find(adjacencyDbMarker_) == 0) {
-      if (spfSolver_->deleteAdjacencyDatabase(nodeName)) {
+      auto nodeAdjacencyDb =
+          updateNodeAdjacencyDatabase(area, key, std::nullopt);
+      bool changed = false;
+      if (nodeAdjacencyDb.has_value()) {
+        changed = area.spfSolver->updateAdjacencyDatabase(*nodeAdjacencyDb)
+                      .first;
+      } else {
+        changed = area.spfSolver->deleteAdjacencyDatabase(nodeName);
+      }
+      if (changed) {
         res.adjChanged = true;
-        pendingAdjUpdates_.addUpdate(
+        area.pendingAdjUpdates.addUpdate(
             myNodeName_, castToStd(thrift::PrefixDatabase().perfEvents));
       }
       continue;
@@ -2015,8 +4099,8 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
       thrift::PrefixDatabase deletePrefixDb;
       deletePrefixDb.thisNodeName = nodeName;
       deletePrefixDb.deletePrefix = true;
-      auto nodePrefixDb = updateNodePrefixDatabase(key, deletePrefixDb);
-      if (spfSolver_->updatePrefixDatabase(nodePrefixDb)) {
+      auto nodePrefixDb = updateNodePrefixDatabase(area, key, deletePrefixDb);
+      if (area.spfSolver->updatePrefixDatabase(nodePrefixDb)) {
         res.prefixesChanged = true;
       }
       continue;
@@ -2026,71 +4110,170 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
   return res;
 }
 
+ProcessPublicationResult
+Decision::processPendingKeyVals(Area& area) {
+  // covers applying the values as well, see linkstate_update spans
+  TraceScope span(traceBuffer_.get(), "deserialize", area.name);
+  span.setArg(area.pendingKeyVals.size());
+  ProcessPublicationResult res;
+
+  // adjacency databases are applied together once all values are read, the
+  // latest one of each node covers all of its keys
+  std::unordered_map<std::string /* nodeName */, size_t> adjacencyDbIndex;
+  std::vector<thrift::AdjacencyDatabase> adjacencyDbs;
+  for (const auto& kv : area.pendingKeyVals) {
+    const auto& key = kv.first;
+    const auto& rawVal = kv.second;
+    std::string nodeName = getNodeNameFromKey(key);
+
+    try {
+      if (key.find(adjacencyDbMarker_) == 0) {
+        // update adjacencyDb
+        auto adjacencyDb = readLsdbValue<thrift::AdjacencyDatabase>(
+            rawVal.value.value(), serializer_);
+        CHECK_EQ(nodeName, adjacencyDb.thisNodeName);
+        adjacencyDb =
+            updateNodeAdjacencyDatabase(area, key, adjacencyDb).value();
+        auto const it =
+            adjacencyDbIndex.emplace(nodeName, adjacencyDbs.size()).first;
+        if (it->second == adjacencyDbs.size()) {
+          adjacencyDbs.emplace_back(std::move(adjacencyDb));
+        } else {
+          adjacencyDbs[it->second] = std::move(adjacencyDb);
+        }
+      } else {
+        // update prefixDb
+        auto prefixDb = readLsdbValue<thrift::PrefixDatabase>(
+            rawVal.value.value(), serializer_);
+        CHECK_EQ(nodeName, prefixDb.thisNodeName);
+        auto nodePrefixDb = updateNodePrefixDatabase(area, key, prefixDb);
+        if (area.spfSolver->updatePrefixDatabase(nodePrefixDb)) {
+          res.prefixesChanged = true;
+          area.pendingPrefixUpdates.addUpdate(
+              myNodeName_, castToStd(nodePrefixDb.perfEvents));
+        }
+      }
+      area.appliedKeyVals[key] = rawVal.value.value();
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "Failed to deserialize info for key " << key
+                 << ". Exception: " << folly::exceptionStr(e);
+    }
+  }
+  area.pendingKeyVals.clear();
+
+  if (not adjacencyDbs.empty()) {
+    auto const rc = area.spfSolver->updateAdjacencyDatabases(adjacencyDbs);
+    if (rc.first) {
+      res.adjChanged = true;
+      for (auto const& adjacencyDb : adjacencyDbs) {
+        area.pendingAdjUpdates.addUpdate(
+            myNodeName_, castToStd(adjacencyDb.perfEvents));
+      }
+    }
+    auto const myIt = adjacencyDbIndex.find(myNodeName_);
+    if (rc.second and myIt != adjacencyDbIndex.end()) {
+      // route attribute changes only matter for the local node
+      res.prefixesChanged = true;
+      area.pendingPrefixUpdates.addUpdate(
+          myNodeName_, castToStd(adjacencyDbs[myIt->second].perfEvents));
+    }
+    if (area.spfSolver->hasHolds() && orderedFibTimer_ != nullptr &&
+        !orderedFibTimer_->isScheduled()) {
+      orderedFibTimer_->scheduleTimeout(getMaxFib());
+    }
+  }
+
+  return res;
+}
+
 void
 Decision::processStaticRouteUpdates() {
-  auto maybePerfEvents = pendingPrefixUpdates_.getPerfEvents();
-  pendingPrefixUpdates_.clear();
+  auto& area = getArea(thrift::KvStore_constants::kDefaultArea());
+  auto maybeStaticDelta = area.spfSolver->processStaticRouteUpdates();
+  if (not maybeStaticDelta.has_value()) {
+    LOG(WARNING) << "prefix manager updates incurred no route updates";
+    return;
+  }
+  // the overlay is part of the initial routes
   if (coldStartTimer_->isScheduled()) {
     return;
   }
 
-  if (maybePerfEvents) {
-    addPerfEvent(*maybePerfEvents, myNodeName_, "DECISION_DEBOUNCE");
+  // resolve against computed routes of the changed labels only
+  thrift::RouteDatabaseDelta routeDelta;
+  routeDelta.thisNodeName = myNodeName_;
+  for (auto const& route : maybeStaticDelta->mplsRoutesToUpdate) {
+    updateMplsRoute(route.topLabel, routeDelta);
   }
-  // update routeDb once for all updates received
-  LOG(INFO) << "Decision: updating new routeDb.";
-  auto maybeRouteDb = spfSolver_->processStaticRouteUpdates();
-
-  if (not maybeRouteDb.has_value()) {
-    LOG(WARNING) << "prefix manager updates incurred no route updates";
+  for (auto const& label : maybeStaticDelta->mplsRoutesToDelete) {
+    updateMplsRoute(label, routeDelta);
+  }
+  if (routeDelta.mplsRoutesToUpdate.empty() and
+      routeDelta.mplsRoutesToDelete.empty()) {
     return;
   }
 
-  fromStdOptional(maybeRouteDb.value().perfEvents, maybePerfEvents);
-  routeUpdatesQueue_.push(std::move(maybeRouteDb.value()));
+  LOG(INFO) << "Decision: sending " << routeDelta.mplsRoutesToUpdate.size()
+            << " static route updates and "
+            << routeDelta.mplsRoutesToDelete.size() << " deletes.";
+  updateRouteStore(routeDelta);
+  routeUpdatesQueue_.push(std::move(routeDelta));
 }
 
 void
-Decision::pushRoutesDeltaUpdates(
-    thrift::RouteDatabaseDelta& staticRoutesDelta) {
-  spfSolver_->pushRoutesDeltaUpdates(staticRoutesDelta);
+Decision::scheduleProcessUpdates(Area& area) {
+  auto const maybeTimeout = area.processUpdatesDebounce.reportUpdate();
+  if (maybeTimeout.has_value()) {
+    area.processUpdatesTimer->scheduleTimeout(maybeTimeout.value());
+  } else {
+    CHECK(area.processUpdatesTimer->isScheduled());
+  }
 }
 
 void
-Decision::processPendingUpdates() {
-  // we need to update  static route first, because there maybe routes
-  // depending on static routes.
-  bool staticRoutesUpdated{false};
-  if (spfSolver_->staticRoutesUpdated()) {
-    staticRoutesUpdated = true;
-    processStaticRouteUpdates();
-  }
-
-  if (processUpdatesStatus_.adjChanged) {
-    processPendingAdjUpdates();
-  } else if (
-      processUpdatesStatus_.prefixesChanged ||
-      staticRoutesUpdated) // if only static routes gets updated, we still need
-                           // to update routes because there maybe routes
-                           // depended on static routes.
-  {
-    processPendingPrefixUpdates();
+Decision::processPendingUpdates(Area& area) {
+  if (area.spfSolver->hasSpfRunsInProgress()) {
+    // applying updates would wait for SPF of the area, check back later
+    area.processUpdatesTimer->scheduleTimeout(
+        Constants::kDecisionSpfPollInterval);
+    return;
+  }
+  const auto startTime = std::chrono::steady_clock::now();
+  fb303::fbData->addHistogramValue(
+      "decision.debounce_wait_ms",
+      area.processUpdatesDebounce.getPendingDuration(startTime).count());
+  fb303::fbData->addHistogramValue(
+      "decision.debounce_updates",
+      area.processUpdatesDebounce.getPendingCount());
+
+  // apply the latest values of keys received since the last run
+  auto const res = processPendingKeyVals(area);
+  area.processUpdatesStatus.adjChanged |= res.adjChanged;
+  area.processUpdatesStatus.prefixesChanged |= res.prefixesChanged;
+
+  if (area.processUpdatesStatus.adjChanged) {
+    processPendingAdjUpdates(area);
+  } else if (area.processUpdatesStatus.prefixesChanged) {
+    processPendingPrefixUpdates(area);
   }
 
   // reset update status
-  processUpdatesStatus_.adjChanged = false;
-  processUpdatesStatus_.prefixesChanged = false;
-
-  // update decision debounce flag
-  processUpdatesBackoff_.reportSuccess();
+  area.processUpdatesStatus.adjChanged = false;
+  area.processUpdatesStatus.prefixesChanged = false;
+  publishSnapshot(area);
+
+  // let debounce learn about the cost of route computation
+  area.processUpdatesDebounce.reportRun(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - startTime));
 }
 
 void
-Decision::processPendingAdjUpdates() {
-  VLOG(1) << "Decision: processing " << pendingAdjUpdates_.getCount()
-          << " accumulated adjacency updates.";
+Decision::processPendingAdjUpdates(Area& area) {
+  VLOG(1) << "Decision: processing " << area.pendingAdjUpdates.getCount()
+          << " accumulated adjacency updates of area " << area.name;
 
-  if (!pendingAdjUpdates_.getCount()) {
+  if (!area.pendingAdjUpdates.getCount()) {
     LOG(ERROR) << "Decision route computation triggered without any pending "
                << "adjacency updates.";
     return;
@@ -2098,17 +4281,18 @@ Decision::processPendingAdjUpdates() {
 
   // Retrieve perf events, add debounce perf event, log information to
   // ZmqMonitor, ad and clear pending updates
-  auto maybePerfEvents = pendingAdjUpdates_.getPerfEvents();
+  auto maybePerfEvents = area.pendingAdjUpdates.getPerfEvents();
   if (maybePerfEvents) {
     addPerfEvent(*maybePerfEvents, myNodeName_, "DECISION_DEBOUNCE");
     auto const& events = maybePerfEvents->events;
     auto const& eventsCnt = events.size();
     CHECK_LE(2, eventsCnt);
     auto duration = events[eventsCnt - 1].unixTs - events[eventsCnt - 2].unixTs;
-    VLOG(1) << "Debounced " << pendingAdjUpdates_.getCount() << " events over "
-            << std::chrono::milliseconds(duration).count() << "ms.";
+    VLOG(1) << "Debounced " << area.pendingAdjUpdates.getCount()
+            << " events over " << std::chrono::milliseconds(duration).count()
+            << "ms.";
   }
-  pendingAdjUpdates_.clear();
+  area.pendingAdjUpdates.clear();
 
   if (coldStartTimer_->isScheduled()) {
     return;
@@ -2116,20 +4300,13 @@ Decision::processPendingAdjUpdates() {
 
   // run SPF once for all updates received
   LOG(INFO) << "Decision: computing new paths.";
-  auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
-  if (not maybeRouteDb.has_value()) {
-    LOG(WARNING) << "AdjacencyDb updates incurred no route updates";
-    return;
-  }
-
-  fromStdOptional(maybeRouteDb.value().perfEvents, maybePerfEvents);
-  sendRouteUpdate(maybeRouteDb.value(), "DECISION_SPF");
+  startRouteBuild(area, true, std::move(maybePerfEvents));
 }
 
 void
-Decision::processPendingPrefixUpdates() {
-  auto maybePerfEvents = pendingPrefixUpdates_.getPerfEvents();
-  pendingPrefixUpdates_.clear();
+Decision::processPendingPrefixUpdates(Area& area) {
+  auto maybePerfEvents = area.pendingPrefixUpdates.getPerfEvents();
+  area.pendingPrefixUpdates.clear();
   if (coldStartTimer_->isScheduled()) {
     return;
   }
@@ -2139,67 +4316,304 @@ Decision::processPendingPrefixUpdates() {
   }
   // update routeDb once for all updates received
   LOG(INFO) << "Decision: updating new routeDb.";
-  auto maybeRouteDb = spfSolver_->buildRouteDb(myNodeName_);
+  startRouteBuild(area, false, std::move(maybePerfEvents));
+}
+
+void
+Decision::startRouteBuild(
+    Area& area,
+    bool computePaths,
+    std::optional<thrift::PerfEvents> perfEvents) {
+  if (area.routeBuild.has_value()) {
+    // the build in progress is outdated, fold it into the new one
+    computePaths |= area.routeBuild->computePaths;
+    if (not perfEvents.has_value()) {
+      perfEvents = std::move(area.routeBuild->perfEvents);
+    }
+    area.routeBuild.reset();
+    area.routeBuildTimer->cancelTimeout();
+  }
+  if (not area.spfSolver->startRouteBuild(computePaths)) {
+    LOG(WARNING) << (computePaths ? "AdjacencyDb" : "PrefixDb")
+                 << " updates incurred no route updates";
+    return;
+  }
+  area.routeBuild = RouteBuild{computePaths, std::move(perfEvents)};
+  continueRouteBuild(area);
+}
+
+void
+Decision::continueRouteBuild(Area& area) {
+  CHECK(area.routeBuild.has_value());
+  if (not area.spfSolver->hasRouteBuild()) {
+    // inputs changed since the build started. Start over rather than
+    // finishing stale work
+    VLOG(1) << "Decision: restarting abandoned route build.";
+    if (not area.spfSolver->startRouteBuild(area.routeBuild->computePaths)) {
+      LOG(WARNING) << "Abandoned route build incurred no route updates";
+      area.routeBuild.reset();
+      return;
+    }
+  }
+
+  auto maybeRouteDb =
+      area.spfSolver->continueRouteBuild(Constants::kDecisionRouteBuildSlice);
   if (not maybeRouteDb.has_value()) {
-    LOG(WARNING) << "PrefixDb updates incurred no route updates";
+    // let other events in, resume in the next event loop iteration or once
+    // SPF of the area is likely done
+    area.routeBuildTimer->scheduleTimeout(
+        area.spfSolver->hasSpfRunsInProgress()
+            ? Constants::kDecisionSpfPollInterval
+            : std::chrono::milliseconds(0));
     return;
   }
 
-  fromStdOptional(maybeRouteDb.value().perfEvents, maybePerfEvents);
-  sendRouteUpdate(maybeRouteDb.value(), "ROUTE_UPDATE");
+  auto build = std::move(area.routeBuild.value());
+  area.routeBuild.reset();
+  std::vector<std::pair<Area*, thrift::RouteDatabase>> areaRouteDbs;
+  areaRouteDbs.emplace_back(&area, std::move(maybeRouteDb.value()));
+  sendRouteUpdate(
+      std::move(areaRouteDbs),
+      std::move(build.perfEvents),
+      build.computePaths ? "DECISION_SPF" : "ROUTE_UPDATE");
 }
 
 void
 Decision::decrementOrderedFibHolds() {
-  if (spfSolver_->decrementHolds()) {
+  std::vector<std::pair<Area*, thrift::RouteDatabase>> areaRouteDbs;
+  for (auto& kv : areas_) {
+    auto& area = *kv.second;
+    if (not area.spfSolver->decrementHolds()) {
+      continue;
+    }
     if (coldStartTimer_->isScheduled()) {
-      return;
+      continue;
     }
-    auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
+    auto maybeRouteDb = area.spfSolver->buildPaths(myNodeName_);
     if (not maybeRouteDb.has_value()) {
       LOG(INFO) << "decrementOrderedFibHolds incurred no route updates";
-      return;
+      continue;
     }
-
-    // Create empty perfEvents list. In this case we don't this route update to
-    // be inculded in the Fib time
-    maybeRouteDb.value().perfEvents = thrift::PerfEvents{};
-    sendRouteUpdate(maybeRouteDb.value(), "ORDERED_FIB_HOLDS_EXPIRED");
+    areaRouteDbs.emplace_back(&area, std::move(maybeRouteDb.value()));
+  }
+  if (areaRouteDbs.empty()) {
+    return;
   }
+
+  // Create empty perfEvents list. In this case we don't this route update to
+  // be inculded in the Fib time
+  sendRouteUpdate(
+      std::move(areaRouteDbs),
+      thrift::PerfEvents{},
+      "ORDERED_FIB_HOLDS_EXPIRED");
 }
 
 void
 Decision::coldStartUpdate() {
-  auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
-  if (not maybeRouteDb.has_value()) {
+  std::vector<std::pair<Area*, thrift::RouteDatabase>> areaRouteDbs;
+  for (auto& kv : areas_) {
+    auto& area = *kv.second;
+    // values buffered for the debounce timer must be part of the initial
+    // routes
+    auto const res = processPendingKeyVals(area);
+    area.processUpdatesStatus.adjChanged |= res.adjChanged;
+    area.processUpdatesStatus.prefixesChanged |= res.prefixesChanged;
+    publishSnapshot(area);
+
+    auto maybeRouteDb = area.spfSolver->buildPaths(myNodeName_);
+    if (maybeRouteDb.has_value()) {
+      areaRouteDbs.emplace_back(&area, std::move(maybeRouteDb.value()));
+    }
+  }
+  if (areaRouteDbs.empty()) {
     LOG(ERROR) << "SEVERE: No routes to program after cold start duration. "
                << "Sending empty route db to FIB";
-    thrift::RouteDatabase db;
-    sendRouteUpdate(db, "COLD_START_UPDATE");
-    return;
   }
   // Create empty perfEvents list. In this case we don't this route update to
   // be inculded in the Fib time
-  maybeRouteDb.value().perfEvents = thrift::PerfEvents{};
-  sendRouteUpdate(maybeRouteDb.value(), "COLD_START_UPDATE");
+  sendRouteUpdate(
+      std::move(areaRouteDbs), thrift::PerfEvents{}, "COLD_START_UPDATE");
 }
 
 void
 Decision::sendRouteUpdate(
-    thrift::RouteDatabase& db, std::string const& eventDescription) {
-  if (db.perfEvents.has_value()) {
-    addPerfEvent(db.perfEvents.value(), myNodeName_, eventDescription);
+    std::vector<std::pair<Area*, thrift::RouteDatabase>> areaRouteDbs,
+    std::optional<thrift::PerfEvents> perfEvents,
+    std::string const& eventDescription) {
+  if (perfEvents.has_value()) {
+    addPerfEvent(perfEvents.value(), myNodeName_, eventDescription);
+  }
+
+  // Take over MPLS routes of the areas and collect prefixes whose routes
+  // changed in any of them. Unicast route changes are tracked by the
+  // SpfSolvers as they rebuild only affected prefixes
+  std::optional<TraceScope> deltaSpan;
+  deltaSpan.emplace(traceBuffer_.get(), "route_delta");
+  std::set<IpPrefixKey> changedPrefixes;
+  for (auto& areaAndRouteDb : areaRouteDbs) {
+    auto& area = *areaAndRouteDb.first;
+    area.mplsRoutes = std::move(areaAndRouteDb.second.mplsRoutes);
+    auto unicastDelta = area.spfSolver->getUnicastRoutesDelta();
+    for (auto const& route : unicastDelta.unicastRoutesToUpdate) {
+      changedPrefixes.emplace(route.dest);
+    }
+    for (auto const& prefix : unicastDelta.unicastRoutesToDelete) {
+      changedPrefixes.emplace(prefix);
+    }
   }
 
-  // Find out delta to be sent to Fib
-  auto routeDelta = findDeltaRoutes(db, routeDb_);
-  routeDelta.perfEvents.copy_from(db.perfEvents);
-  routeDb_ = std::move(db);
+  // Find out delta to be sent to Fib. Routes of changed prefixes are merged
+  // over all areas and compared to the ones sent before, the comparatively
+  // few MPLS routes are all compared to the ones sent before, with the
+  // static routes on top of them
+  thrift::RouteDatabaseDelta routeDelta;
+  routeDelta.thisNodeName = myNodeName_;
+  computedMplsRoutes_ = getMergedMplsRoutes();
+  std::unordered_set<int32_t> labels;
+  for (auto const& kv : computedMplsRoutes_) {
+    labels.emplace(kv.first);
+  }
+  for (auto const& kv : mplsRoutes_) {
+    labels.emplace(kv.first);
+  }
+  for (auto const& kv : getArea(thrift::KvStore_constants::kDefaultArea())
+                            .spfSolver->getStaticRoutes()
+                            .mplsRoutes) {
+    labels.emplace(kv.first);
+  }
+  for (auto const& label : labels) {
+    updateMplsRoute(label, routeDelta);
+  }
+  for (auto const& prefix : changedPrefixes) {
+    auto route = getMergedUnicastRoute(prefix);
+    auto it = unicastRoutes_.find(prefix);
+    if (not route) {
+      if (it != unicastRoutes_.end()) {
+        unicastRoutes_.erase(it);
+        routeDelta.unicastRoutesToDelete.emplace_back(prefix.toThrift());
+      }
+      continue;
+    }
+    // unchanged routes of a single area are the same instance
+    if (it != unicastRoutes_.end() and
+        (it->second == route or *it->second == *route)) {
+      continue;
+    }
+    routeDelta.unicastRoutesToUpdate.emplace_back(*route);
+    unicastRoutes_[prefix] = std::move(route);
+  }
+  fromStdOptional(routeDelta.perfEvents, perfEvents);
+  deltaSpan->setArg(
+      routeDelta.unicastRoutesToUpdate.size() +
+      routeDelta.unicastRoutesToDelete.size() +
+      routeDelta.mplsRoutesToUpdate.size() +
+      routeDelta.mplsRoutesToDelete.size());
+  deltaSpan.reset();
 
   // publish the new route state
+  TraceScope pushSpan(traceBuffer_.get(), "route_push");
+  updateRouteStore(routeDelta);
   routeUpdatesQueue_.push(std::move(routeDelta));
 }
 
+std::shared_ptr<const thrift::UnicastRoute>
+Decision::getMergedUnicastRoute(IpPrefixKey const& prefix) const {
+  std::shared_ptr<const thrift::UnicastRoute> first;
+  std::optional<thrift::UnicastRoute> merged;
+  for (auto const& kv : areas_) {
+    auto const& routes = kv.second->spfSolver->getUnicastRoutes();
+    auto const it = routes.find(prefix);
+    if (it == routes.end()) {
+      continue;
+    }
+    if (not first) {
+      first = it->second;
+      continue;
+    }
+    if (not merged.has_value()) {
+      merged = *first;
+    }
+    mergeNextHops(merged->nextHops, it->second->nextHops);
+  }
+  if (merged.has_value()) {
+    return std::make_shared<const thrift::UnicastRoute>(
+        std::move(merged.value()));
+  }
+  return first;
+}
+
+std::unordered_map<int32_t, thrift::MplsRoute>
+Decision::getMergedMplsRoutes() const {
+  std::unordered_map<int32_t, thrift::MplsRoute> merged;
+  for (auto const& kv : areas_) {
+    for (auto const& route : kv.second->mplsRoutes) {
+      auto const it = merged.emplace(route.topLabel, route);
+      if (not it.second) {
+        mergeNextHops(it.first->second.nextHops, route.nextHops);
+      }
+    }
+  }
+  return merged;
+}
+
+std::optional<thrift::MplsRoute>
+Decision::getEffectiveMplsRoute(int32_t label) const {
+  auto const& staticRoutes =
+      areas_.at(thrift::KvStore_constants::kDefaultArea())
+          ->spfSolver->getStaticRoutes()
+          .mplsRoutes;
+  auto const staticIt = staticRoutes.find(label);
+  if (staticIt != staticRoutes.end()) {
+    return createMplsRoute(label, staticIt->second);
+  }
+  auto const it = computedMplsRoutes_.find(label);
+  if (it != computedMplsRoutes_.end()) {
+    return it->second;
+  }
+  return std::nullopt;
+}
+
+void
+Decision::updateMplsRoute(int32_t label, thrift::RouteDatabaseDelta& delta) {
+  auto route = getEffectiveMplsRoute(label);
+  auto const it = mplsRoutes_.find(label);
+  if (not route.has_value()) {
+    if (it != mplsRoutes_.end()) {
+      mplsRoutes_.erase(it);
+      delta.mplsRoutesToDelete.emplace_back(label);
+    }
+    return;
+  }
+  if (it != mplsRoutes_.end() and *it->second == route.value()) {
+    return;
+  }
+  delta.mplsRoutesToUpdate.emplace_back(route.value());
+  mplsRoutes_[label] =
+      std::make_shared<const thrift::MplsRoute>(std::move(route.value()));
+}
+
+void
+Decision::updateRouteStore(thrift::RouteDatabaseDelta const& delta) {
+  if (not routeStore_) {
+    return;
+  }
+  std::vector<std::shared_ptr<const thrift::UnicastRoute>> unicastRoutes;
+  unicastRoutes.reserve(delta.unicastRoutesToUpdate.size());
+  for (auto const& route : delta.unicastRoutesToUpdate) {
+    unicastRoutes.emplace_back(unicastRoutes_.at(IpPrefixKey(route.dest)));
+  }
+  std::vector<std::shared_ptr<const thrift::MplsRoute>> mplsRoutes;
+  mplsRoutes.reserve(delta.mplsRoutesToUpdate.size());
+  for (auto const& route : delta.mplsRoutesToUpdate) {
+    mplsRoutes.emplace_back(mplsRoutes_.at(route.topLabel));
+  }
+  routeStore_->update(
+      unicastRoutes,
+      delta.unicastRoutesToDelete,
+      mplsRoutes,
+      delta.mplsRoutesToDelete);
+}
+
 std::chrono::milliseconds
 Decision::getMaxFib() {
   std::chrono::milliseconds maxFib{1};
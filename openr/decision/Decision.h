@@ -8,6 +8,7 @@
 #pragma once
 
 #include <chrono>
+#include <map>
 #include <string>
 #include <unordered_map>
 
@@ -19,14 +20,20 @@
 #include <folly/IPAddress.h>
 #include <folly/Memory.h>
 #include <folly/String.h>
+#include <folly/Synchronized.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <thrift/lib/cpp2/Thrift.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
-#include <openr/common/ExponentialBackoff.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/RouteStore.h>
+#include <openr/common/TraceBuffer.h>
 #include <openr/common/Util.h>
+#include <openr/decision/AdaptiveDebounce.h>
+#include <openr/decision/LinkState.h>
+#include <openr/decision/PrefixState.h>
 #include <openr/if/gen-cpp2/Decision_types.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
 #include <openr/if/gen-cpp2/KvStore_types.h>
@@ -48,7 +55,19 @@ struct BestPathCalResult {
   std::set<std::string> nodes;
   std::optional<int64_t> bestIgpMetric{std::nullopt};
   std::string const* bestData{nullptr};
-  std::optional<thrift::MetricVector> bestVector{std::nullopt};
+  std::optional<MetricVectorUtils::NormalizedMetricVector> bestVector{
+      std::nullopt};
+};
+
+// Inputs of route computation captured by SpfSolver::getSnapshot(). Routes of
+// any node can be built from it off the Decision thread. Databases are
+// immutable and shared with the solver until they change, hence snapshots are
+// cheap to take and to copy
+struct SpfSolverSnapshot {
+  // topology generation (link state version) the snapshot was taken at
+  uint64_t generation{0};
+  AdjacencyDbsSnapshot adjacencyDbs;
+  PrefixDbsSnapshot prefixDbs;
 };
 
 namespace detail {
@@ -121,7 +140,14 @@ class SpfSolver {
       bool computeLfaPaths,
       bool enableOrderedFib = false,
       bool bgpDryRun = false,
-      bool bgpUseIgpMetric = false);
+      bool bgpUseIgpMetric = false,
+      // pool to run per-neighbor LFA SPF computations and large route builds
+      // on, shared with other solvers. nullptr runs them on the calling
+      // thread
+      std::shared_ptr<folly::CPUThreadPoolExecutor> spfExecutor = nullptr,
+      // SPF runs from remote nodes per topology change spent on finding remote
+      // LFA (RFC 7490) tunnels for prefixes without LFA. 0 disables them
+      size_t remoteLfaSpfRuns = 0);
   ~SpfSolver();
 
   //
@@ -135,13 +161,18 @@ class SpfSolver {
       bool /* route attributes has changed (nexthop addr, node/adj label */>
   updateAdjacencyDatabase(thrift::AdjacencyDatabase const& adjacencyDb);
 
-  bool staticRoutesUpdated();
+  // update adjacencies of several routers at once, e.g. after a full sync.
+  // Hold TTLs of ordered FIB are those of the topology before the batch.
+  // Returns whether the topology changed and whether our route attributes
+  // changed, as updateAdjacencyDatabase() does for any one of them
+  std::pair<bool, bool> updateAdjacencyDatabases(
+      std::vector<thrift::AdjacencyDatabase> const& adjacencyDbs);
 
   void pushRoutesDeltaUpdates(thrift::RouteDatabaseDelta& staticRoutesDelta);
 
   std::optional<thrift::RouteDatabaseDelta> processStaticRouteUpdates();
 
-  thrift::StaticRoutes const& getStaticRoutes();
+  thrift::StaticRoutes const& getStaticRoutes() const;
 
   bool hasHolds() const;
 
@@ -174,10 +205,58 @@ class SpfSolver {
   std::optional<thrift::RouteDatabase> buildRouteDb(
       const std::string& myNodeName);
 
+  // Route build of the local node in slices, so that the caller can handle
+  // other events in between. startRouteBuild() runs SPF first if
+  // computePaths. It returns false when buildPaths() or buildRouteDb() would
+  // return std::nullopt. continueRouteBuild() computes routes for about
+  // timeBudget and returns the route database once the build completes.
+  // With an SPF pool, SPF of the build runs on it and continueRouteBuild()
+  // returns std::nullopt right away while hasSpfRunsInProgress(). Changes of
+  // adjacency databases and hold expiry wait for these runs. Changes of
+  // adjacency or prefix databases, hold expiry, buildPaths() and
+  // buildRouteDb() of the local node abandon the build in progress, hence
+  // hasRouteBuild() turns false. Routes it already rebuilt are rebuilt again
+  // by the next build
+  bool startRouteBuild(bool computePaths);
+  std::optional<thrift::RouteDatabase> continueRouteBuild(
+      std::chrono::milliseconds timeBudget);
+  bool hasRouteBuild() const;
+  bool hasSpfRunsInProgress() const;
+
+  // Unicast route changes of the local node's route database, accumulated
+  // over buildRouteDb() runs since the previous call. Only prefixes whose
+  // announcements or announcing nodes changed are rebuilt by each run
+  thrift::RouteDatabaseDelta getUnicastRoutesDelta();
+
+  // Capture inputs of route computation. Our SPF results of the current
+  // topology generation get shared with buildRouteDbFromSnapshot(), unless
+  // ordered FIB holds applied to them
+  SpfSolverSnapshot getSnapshot();
+
+  // Build routes of nodeName from snapshot. SPF results are kept in a LRU
+  // cache across calls for the same topology generation. Does not touch any
+  // other state of this solver, so it is safe to call from any thread
+  std::optional<thrift::RouteDatabase> buildRouteDbFromSnapshot(
+      SpfSolverSnapshot const& snapshot, const std::string& nodeName) const;
+
   bool decrementHolds();
 
+  // values of the counters exported by updateGlobalCounters()
+  std::unordered_map<std::string, int64_t> getCounters() const;
+
   void updateGlobalCounters();
 
+  // unicast routes of the local node as built so far. A route build in
+  // progress updates them as it goes
+  std::unordered_map<
+      IpPrefixKey,
+      std::shared_ptr<const thrift::UnicastRoute>> const&
+  getUnicastRoutes() const;
+
+  // record spans of route computation stages into traceBuffer, nullptr to
+  // stop tracing
+  void setTraceBuffer(std::shared_ptr<TraceBuffer> traceBuffer);
+
  private:
   // no-copy
   SpfSolver(SpfSolver const&) = delete;
@@ -219,16 +298,27 @@ class Decision : public OpenrEventBase {
       std::chrono::milliseconds debounceMinDur,
       std::chrono::milliseconds debounceMaxDur,
       std::optional<std::chrono::seconds> gracefulRestartDuration,
-      messaging::RQueue<thrift::Publication> kvStoreUpdatesQueue,
+      messaging::RQueue<KvStorePublication> kvStoreUpdatesQueue,
       messaging::RQueue<thrift::RouteDatabaseDelta> staticRoutesUpdateQueue,
       messaging::ReplicateQueue<thrift::RouteDatabaseDelta>& routeUpdatesQueue,
-      fbzmq::Context& zmqContext);
+      fbzmq::Context& zmqContext,
+      // size of the SPF pool shared by all areas. 0 means one thread per
+      // hardware core
+      size_t spfThreads = 0,
+      // number of latest route computation spans kept for
+      // getDecisionTraceSpans(). 0 disables tracing
+      size_t traceSpans = Constants::kDecisionTraceSpans,
+      size_t remoteLfaSpfRuns = 0,
+      // store of the routes sent to Fib, shared with it. nullptr if Fib
+      // keeps its own copy
+      RouteStore* routeStore = nullptr);
 
   virtual ~Decision() = default;
 
   /*
    * Retrieve routeDb from specified node.
-   * If empty nodename specified, will return routeDb of its own
+   * If empty nodename specified, will return routeDb of its own, as of the
+   * last route update sent to Fib. Static routes are not part of it
    */
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>> getDecisionRouteDb(
       std::string nodeName);
@@ -246,79 +336,201 @@ class Decision : public OpenrEventBase {
    */
   folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>> getDecisionPrefixDbs();
 
+  /*
+   * Retrieve latest spans of route computation stages, oldest first.
+   */
+  folly::SemiFuture<std::unique_ptr<thrift::TraceSpans>>
+  getDecisionTraceSpans();
+
  private:
   Decision(Decision const&) = delete;
   Decision& operator=(Decision const&) = delete;
 
-  // process publication from KvStore
+  // route build in progress, see startRouteBuild()
+  struct RouteBuild {
+    bool computePaths{false};
+    std::optional<thrift::PerfEvents> perfEvents;
+  };
+
+  // LSDB and route computation of one area. Every area has its own pipeline:
+  // solver, debounce and route builds. Churn in one area does not delay
+  // route updates of another, their routes get merged when sent to Fib
+  struct Area {
+    Area(
+        std::string name,
+        std::chrono::milliseconds debounceMinDur,
+        std::chrono::milliseconds debounceMaxDur)
+        : name(std::move(name)),
+          processUpdatesDebounce(debounceMinDur, debounceMaxDur) {}
+
+    const std::string name;
+
+    // the pointer to the SPF path calculator
+    std::unique_ptr<SpfSolver> spfSolver;
+
+    /**
+     * Process received publication and populate the pendingAdjUpdates
+     * attributes which can be applied later on after a debounce timeout.
+     */
+    detail::DecisionPendingUpdates pendingAdjUpdates;
+
+    /**
+     * Process received publication and populate the pendingPrefixUpdates
+     * attributes upon receiving prefix update publication
+     */
+    detail::DecisionPendingUpdates pendingPrefixUpdates;
+
+    /**
+     * Timer to schedule pending update processing
+     * Refer to processUpdatesStatus to decide whether spf recalculation or
+     * just route rebuilding is needed.
+     * Timeout adapts to churn, see AdaptiveDebounce
+     */
+    std::unique_ptr<folly::AsyncTimeout> processUpdatesTimer;
+    AdaptiveDebounce processUpdatesDebounce;
+
+    // store update to-do status
+    ProcessPublicationResult processUpdatesStatus;
+
+    // route build in progress
+    std::optional<RouteBuild> routeBuild;
+
+    // timer to resume routeBuild in the next event loop iteration
+    std::unique_ptr<folly::AsyncTimeout> routeBuildTimer;
+
+    // MPLS routes of the last route database of this area sent to Fib
+    std::vector<thrift::MplsRoute> mplsRoutes;
+
+    // need to store all this for backward compatibility, otherwise a key
+    // update can lead to mistakenly withdrawing some prefixes
+    std::unordered_map<
+        std::string,
+        std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>
+        perPrefixPrefixEntries, fullDbPrefixEntries;
+
+    // prefix entries of the bucket keys of nodes advertising those, by key
+    std::unordered_map<
+        std::string /* node */,
+        std::unordered_map<
+            std::string /* key */,
+            std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>>
+        bucketPrefixEntries;
+
+    // adjacency dbs of the adj:<node> keys, and adjacencies of the per
+    // adjacency keys of nodes advertising those, by key
+    std::unordered_map<std::string /* node */, thrift::AdjacencyDatabase>
+        fullAdjacencyDbs;
+    std::unordered_map<
+        std::string /* node */,
+        std::unordered_map<std::string /* key */, thrift::Adjacency>>
+        perAdjacencyEntries;
+
+    // adjacency and prefix key values received since they were last
+    // applied. Only the latest value of a key within a debounce window gets
+    // deserialized
+    std::unordered_map<std::string /* key */, thrift::Value> pendingKeyVals;
+
+    // serialized contents last applied for each adjacency and prefix key.
+    // Values carrying the very same bytes are not deserialized again
+    std::unordered_map<std::string /* key */, std::string> appliedKeyVals;
+  };
+
+  // area of the given name, created on first use
+  Area& getArea(const std::string& areaName);
+
+  // process publication from KvStore. Values of adjacency and prefix keys are
+  // only buffered in pendingKeyVals, see processPendingKeyVals()
   ProcessPublicationResult processPublication(
-      thrift::Publication const& thriftPub);
-
-  // process static routes publication from prefix manager.
-  void processStaticRouteUpdates();
-
-  void pushRoutesDeltaUpdates(thrift::RouteDatabaseDelta& staticRoutesDelta);
+      Area& area, thrift::Publication const& thriftPub);
 
-  /**
-   * Process received publication and populate the pendingAdjUpdates_
-   * attributes which can be applied later on after a debounce timeout.
-   */
-  detail::DecisionPendingUpdates pendingAdjUpdates_;
+  // deserialize and apply pendingKeyVals
+  ProcessPublicationResult processPendingKeyVals(Area& area);
 
-  /**
-   * Process received publication and populate the pendingPrefixUpdates_
-   * attributes upon receiving prefix update publication
-   */
-  detail::DecisionPendingUpdates pendingPrefixUpdates_;
+  // apply static route updates to the static routes overlay and send the
+  // routes of the labels they changed to Fib, without any route computation
+  void processStaticRouteUpdates();
 
   // callback timer used on startup to publish routes after
   // gracefulRestartDuration
   std::unique_ptr<folly::AsyncTimeout> coldStartTimer_{nullptr};
 
-  /**
-   * Timer to schedule pending update processing
-   * Refer to processUpdatesStatus_ to decide whether spf recalculation or
-   * just route rebuilding is needed.
-   * Apply exponential backoff timeout to avoid churn
-   */
-  std::unique_ptr<folly::AsyncTimeout> processUpdatesTimer_;
-  ExponentialBackoff<std::chrono::milliseconds> processUpdatesBackoff_;
-
-  // store update to-do status
-  ProcessPublicationResult processUpdatesStatus_;
-
-  bool staticRoutesChanged_{false};
+  // (re)schedule processUpdatesTimer upon an update
+  void scheduleProcessUpdates(Area& area);
 
   /**
    * Caller function of processPendingAdjUpdates and processPendingPrefixUpdates
-   * Check current processUpdatesStatus_ to decide which sub function to call
+   * Check current processUpdatesStatus to decide which sub function to call
    * to further process pending updates
    * Reset timer and status afterwards.
    */
-  void processPendingUpdates();
+  void processPendingUpdates(Area& area);
 
   /**
    * Function to process pending adjacency publications.
    */
-  void processPendingAdjUpdates();
+  void processPendingAdjUpdates(Area& area);
 
   /**
    * Function to process prefix updates.
    */
-  void processPendingPrefixUpdates();
+  void processPendingPrefixUpdates(Area& area);
+
+  // Build routes of area, running SPF first if computePaths, and send them
+  // once the build completes. SPF runs on the SPF threads and routes are
+  // computed in slices of Constants::kDecisionRouteBuildSlice, so that other
+  // events and areas get handled in between. Supersedes a build in progress
+  void startRouteBuild(
+      Area& area,
+      bool computePaths,
+      std::optional<thrift::PerfEvents> perfEvents);
+
+  // compute the next slice of routeBuild, restart it if it got abandoned
+  void continueRouteBuild(Area& area);
 
   void decrementOrderedFibHolds();
 
   void coldStartUpdate();
 
+  // Send the changes of the merged route database of all areas to Fib, after
+  // the given route databases of areas got built
   void sendRouteUpdate(
-      thrift::RouteDatabase& db, std::string const& eventDescription);
+      std::vector<std::pair<Area*, thrift::RouteDatabase>> areaRouteDbs,
+      std::optional<thrift::PerfEvents> perfEvents,
+      std::string const& eventDescription);
+
+  // route to prefix merged over all areas, nullptr if none. Next hops of all
+  // areas computing a route to it are combined, the route of a single area
+  // is shared with it
+  std::shared_ptr<const thrift::UnicastRoute> getMergedUnicastRoute(
+      IpPrefixKey const& prefix) const;
+
+  // MPLS routes of all areas, merged the same way
+  std::unordered_map<int32_t, thrift::MplsRoute> getMergedMplsRoutes() const;
+
+  // MPLS route of label to program. A static route of the label takes
+  // precedence over the computed one
+  std::optional<thrift::MplsRoute> getEffectiveMplsRoute(int32_t label) const;
+
+  // bring mplsRoutes_ up to date for label, recording any change in delta
+  void updateMplsRoute(int32_t label, thrift::RouteDatabaseDelta& delta);
+
+  // publish the routes of delta, about to be sent, to routeStore_
+  void updateRouteStore(thrift::RouteDatabaseDelta const& delta);
 
   std::chrono::milliseconds getMaxFib();
 
   // node to prefix entries database for nodes advertising per prefix keys
   thrift::PrefixDatabase updateNodePrefixDatabase(
-      const std::string& key, const thrift::PrefixDatabase& prefixDb);
+      Area& area,
+      const std::string& key,
+      const thrift::PrefixDatabase& prefixDb);
+
+  // node to adjacency database for nodes advertising per adjacency keys.
+  // std::nullopt once the node has no adjacency key left
+  std::optional<thrift::AdjacencyDatabase> updateNodeAdjacencyDatabase(
+      Area& area,
+      const std::string& key,
+      const std::optional<thrift::AdjacencyDatabase>& adjacencyDb);
 
   // this node's name and the key markers
   const std::string myNodeName_;
@@ -327,13 +539,63 @@ class Decision : public OpenrEventBase {
   // the prefix we use to find the prefix db key announcements
   const std::string prefixDbMarker_;
 
-  thrift::RouteDatabase routeDb_;
+  // parameters of the SpfSolver and debounce of each area
+  const bool enableV4_{false};
+  const bool computeLfaPaths_{false};
+  const bool enableOrderedFib_{false};
+  const bool bgpDryRun_{false};
+  const bool bgpUseIgpMetric_{false};
+  const size_t remoteLfaSpfRuns_{0};
+  const std::chrono::milliseconds debounceMinDur_;
+  const std::chrono::milliseconds debounceMaxDur_;
+
+  // merged MPLS routes of all areas as of the last route build
+  std::unordered_map<int32_t, thrift::MplsRoute> computedMplsRoutes_;
+
+  // MPLS routes as last sent to Fib, static routes included
+  std::unordered_map<int32_t, std::shared_ptr<const thrift::MplsRoute>>
+      mplsRoutes_;
+
+  // debounce of static route updates, processed apart from areas
+  std::unique_ptr<folly::AsyncTimeout> staticRoutesTimer_{nullptr};
+
+  // merged unicast routes as last sent to Fib. Routes of a single area are
+  // the instances of the area, those of unchanged routes stay the same
+  std::unordered_map<
+      IpPrefixKey,
+      std::shared_ptr<const thrift::UnicastRoute>>
+      unicastRoutes_;
+
+  // see ctor
+  RouteStore* routeStore_{nullptr};
 
   // Queue to publish route changes
   messaging::ReplicateQueue<thrift::RouteDatabaseDelta>& routeUpdatesQueue_;
 
-  // the pointer to the SPF path calculator
-  std::unique_ptr<SpfSolver> spfSolver_;
+  // spans of route computation stages of all areas, nullptr if tracing is
+  // disabled. Written from the event base and SPF threads, read from any
+  // thread
+  const std::shared_ptr<TraceBuffer> traceBuffer_;
+
+  // SPF and route build pool shared by the solvers of all areas
+  std::shared_ptr<folly::CPUThreadPoolExecutor> spfExecutor_;
+
+  // areas by name. The default area always exists, it also takes care of
+  // static routes
+  std::map<std::string, std::unique_ptr<Area>> areas_;
+
+  // builds routes of other nodes for getDecisionRouteDb() off the event base.
+  // Declared after areas_ so that its queries are done before the solvers
+  // are destroyed
+  std::unique_ptr<folly::CPUThreadPoolExecutor> routeDbExecutor_;
+
+  // snapshots of the solvers of all areas as of their last processed
+  // updates. Serve reads of adjacency and prefix databases from any thread
+  folly::Synchronized<std::map<std::string /* area */, SpfSolverSnapshot>>
+      publishedSnapshots_;
+
+  // update publishedSnapshots_ after changes got applied to area
+  void publishSnapshot(Area& area);
 
   // For orderedFib prgramming, we keep track of the fib programming times
   // across the network
@@ -352,13 +614,6 @@ class Decision : public OpenrEventBase {
 
   // Timer for updating and submitting counters periodically
   std::unique_ptr<folly::AsyncTimeout> counterUpdateTimer_{nullptr};
-
-  // need to store all this for backward compatibility, otherwise a key update
-  // can lead to mistakenly withdrawing some prefixes
-  std::unordered_map<
-      std::string,
-      std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>
-      perPrefixPrefixEntries_, fullDbPrefixEntries_;
 };
 
 } // namespace openr
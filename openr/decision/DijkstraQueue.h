@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <folly/lang/Bits.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+//
+// Min-priority queues for Dijkstra runs over integer link metrics. They share
+// the interface below, so SPF routines can take the queue as a template
+// parameter:
+//
+//   empty(), push(key, value), top() and pop()
+//
+// top() returns the pair<Key, Value> with the smallest key. Entries are never
+// updated in place, instead a value is pushed again on improvement and the
+// caller skips stale entries.
+//
+
+// Binary min-heap. O(log n) push and pop
+template <typename Key, typename Value>
+class BinaryHeapQueue {
+ public:
+  using Entry = std::pair<Key, Value>;
+
+  bool
+  empty() const {
+    return heap_.empty();
+  }
+
+  void
+  push(Key key, Value value) {
+    heap_.emplace(key, value);
+  }
+
+  const Entry&
+  top() {
+    return heap_.top();
+  }
+
+  void
+  pop() {
+    heap_.pop();
+  }
+
+ private:
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap_;
+};
+
+// Radix heap (Ahuja, Mehlhorn, Orlin, Tarjan). Entries are bucketed by the
+// highest bit in which their key differs from the last popped key, and only
+// move towards lower buckets, so each entry is touched at most once per key
+// bit. This needs the queue to be monotone: pushed keys must not be smaller
+// than the last popped key, which holds for Dijkstra over non-negative
+// metrics. Unlike a Dial bucket queue, memory does not depend on the metric
+// range.
+template <typename Key, typename Value>
+class RadixHeapQueue {
+  static_assert(std::is_unsigned<Key>::value, "Key must be unsigned");
+
+ public:
+  using Entry = std::pair<Key, Value>;
+
+  bool
+  empty() const {
+    return size_ == 0;
+  }
+
+  void
+  push(Key key, Value value) {
+    DCHECK_GE(key, last_) << "keys must be monotone";
+    buckets_[bucketOf(key)].emplace_back(key, value);
+    ++size_;
+  }
+
+  const Entry&
+  top() {
+    pull();
+    return buckets_[0].back();
+  }
+
+  void
+  pop() {
+    pull();
+    buckets_[0].pop_back();
+    --size_;
+  }
+
+ private:
+  static constexpr size_t kNumBuckets{std::numeric_limits<Key>::digits + 1};
+
+  size_t
+  bucketOf(Key key) const {
+    return folly::findLastSet(key ^ last_);
+  }
+
+  // make sure bucket 0, holding entries with key equal to last_, is not empty
+  void
+  pull() {
+    DCHECK(not empty());
+    if (not buckets_[0].empty()) {
+      return;
+    }
+    size_t i = 1;
+    while (buckets_[i].empty()) {
+      ++i;
+    }
+    auto& bucket = buckets_[i];
+    last_ = bucket.front().first;
+    for (auto const& entry : bucket) {
+      last_ = std::min(last_, entry.first);
+    }
+    for (auto const& entry : bucket) {
+      buckets_[bucketOf(entry.first)].emplace_back(entry);
+    }
+    bucket.clear();
+  }
+
+  std::array<std::vector<Entry>, kNumBuckets> buckets_;
+  size_t size_{0};
+  Key last_{0};
+};
+
+} // namespace openr
@@ -9,9 +9,12 @@
 
 #include <algorithm>
 #include <functional>
+#include <iterator>
 #include <utility>
 
 #include <folly/Format.h>
+#include <folly/Synchronized.h>
+#include <folly/hash/Hash.h>
 #include <openr/common/Util.h>
 
 size_t
@@ -19,6 +22,58 @@ std::hash<openr::Link>::operator()(openr::Link const& link) const {
   return link.hash;
 }
 
+namespace {
+
+// number of recent changes retained for LinkState::getLinkChangesSince()
+const size_t kMaxChangeLogSize{64};
+
+// number of links allocated at once by LinkState
+const size_t kLinkChunkSize{256};
+
+// node and interface names of all links. Names are never dropped, hence
+// references to them stay valid for the lifetime of the process
+folly::Synchronized<std::unordered_set<std::string>>&
+getLinkNames() {
+  static folly::Synchronized<std::unordered_set<std::string>> names;
+  return names;
+}
+
+const std::string*
+internName(const std::string& name) {
+  {
+    auto names = getLinkNames().rlock();
+    auto it = names->find(name);
+    if (it != names->end()) {
+      return &*it;
+    }
+  }
+  return &*getLinkNames().wlock()->emplace(name).first;
+}
+
+using NamePair = std::pair<const std::string*, const std::string*>;
+
+// <nodeName, ifName> pairs by value of their names
+std::pair<NamePair, NamePair>
+orderNames(NamePair const& end1, NamePair const& end2) {
+  if (std::tie(*end2.first, *end2.second) <
+      std::tie(*end1.first, *end1.second)) {
+    return std::make_pair(end2, end1);
+  }
+  return std::make_pair(end1, end2);
+}
+
+// hash of the names, not of their addresses, so that it is stable across runs
+size_t
+hashNames(std::pair<NamePair, NamePair> const& names) {
+  return folly::hash::hash_combine(
+      *names.first.first,
+      *names.first.second,
+      *names.second.first,
+      *names.second.second);
+}
+
+} // namespace
+
 namespace openr {
 
 template <class T>
@@ -91,10 +146,10 @@ Link::Link(
     const openr::thrift::Adjacency& adj1,
     const std::string& nodeName2,
     const openr::thrift::Adjacency& adj2)
-    : n1_(nodeName1),
-      n2_(nodeName2),
-      if1_(adj1.ifName),
-      if2_(adj2.ifName),
+    : n1_(internName(nodeName1)),
+      n2_(internName(nodeName2)),
+      if1_(internName(adj1.ifName)),
+      if2_(internName(adj2.ifName)),
       metric1_(adj1.metric),
       metric2_(adj2.metric),
       overload1_(adj1.isOverloaded),
@@ -105,50 +160,57 @@ Link::Link(
       nhV42_(adj2.nextHopV4),
       nhV61_(adj1.nextHopV6),
       nhV62_(adj2.nextHopV6),
-      orderedNames(
-          std::minmax(std::make_pair(n1_, if1_), std::make_pair(n2_, if2_))),
-      hash(std::hash<std::pair<
-               std::pair<std::string, std::string>,
-               std::pair<std::string, std::string>>>()(orderedNames)) {}
+      orderedNames(orderNames({n1_, if1_}, {n2_, if2_})),
+      hash(hashNames(orderedNames)) {}
+
+bool
+Link::isNode1(const std::string& nodeName) const {
+  return n1_ == &nodeName or *n1_ == nodeName;
+}
+
+bool
+Link::isNode2(const std::string& nodeName) const {
+  return n2_ == &nodeName or *n2_ == nodeName;
+}
 
 const std::string&
 Link::getOtherNodeName(const std::string& nodeName) const {
-  if (n1_ == nodeName) {
-    return n2_;
+  if (isNode1(nodeName)) {
+    return *n2_;
   }
-  if (n2_ == nodeName) {
-    return n1_;
+  if (isNode2(nodeName)) {
+    return *n1_;
   }
   throw std::invalid_argument(nodeName);
 }
 
 const std::string&
 Link::firstNodeName() const {
-  return orderedNames.first.first;
+  return *orderedNames.first.first;
 }
 
 const std::string&
 Link::secondNodeName() const {
-  return orderedNames.second.first;
+  return *orderedNames.second.first;
 }
 
 const std::string&
 Link::getIfaceFromNode(const std::string& nodeName) const {
-  if (n1_ == nodeName) {
-    return if1_;
+  if (isNode1(nodeName)) {
+    return *if1_;
   }
-  if (n2_ == nodeName) {
-    return if2_;
+  if (isNode2(nodeName)) {
+    return *if2_;
   }
   throw std::invalid_argument(nodeName);
 }
 
 LinkStateMetric
 Link::getMetricFromNode(const std::string& nodeName) const {
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     return metric1_.value();
   }
-  if (n2_ == nodeName) {
+  if (isNode2(nodeName)) {
     return metric2_.value();
   }
   throw std::invalid_argument(nodeName);
@@ -156,10 +218,10 @@ Link::getMetricFromNode(const std::string& nodeName) const {
 
 int32_t
 Link::getAdjLabelFromNode(const std::string& nodeName) const {
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     return adjLabel1_;
   }
-  if (n2_ == nodeName) {
+  if (isNode2(nodeName)) {
     return adjLabel2_;
   }
   throw std::invalid_argument(nodeName);
@@ -167,10 +229,10 @@ Link::getAdjLabelFromNode(const std::string& nodeName) const {
 
 bool
 Link::getOverloadFromNode(const std::string& nodeName) const {
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     return overload1_.value();
   }
-  if (n2_ == nodeName) {
+  if (isNode2(nodeName)) {
     return overload2_.value();
   }
   throw std::invalid_argument(nodeName);
@@ -207,10 +269,10 @@ Link::hasHolds() const {
 
 const thrift::BinaryAddress&
 Link::getNhV4FromNode(const std::string& nodeName) const {
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     return nhV41_;
   }
-  if (n2_ == nodeName) {
+  if (isNode2(nodeName)) {
     return nhV42_;
   }
   throw std::invalid_argument(nodeName);
@@ -218,10 +280,10 @@ Link::getNhV4FromNode(const std::string& nodeName) const {
 
 const thrift::BinaryAddress&
 Link::getNhV6FromNode(const std::string& nodeName) const {
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     return nhV61_;
   }
-  if (n2_ == nodeName) {
+  if (isNode2(nodeName)) {
     return nhV62_;
   }
   throw std::invalid_argument(nodeName);
@@ -230,9 +292,9 @@ Link::getNhV6FromNode(const std::string& nodeName) const {
 void
 Link::setNhV4FromNode(
     const std::string& nodeName, const thrift::BinaryAddress& nhV4) {
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     nhV41_ = nhV4;
-  } else if (n2_ == nodeName) {
+  } else if (isNode2(nodeName)) {
     nhV42_ = nhV4;
   } else {
     throw std::invalid_argument(nodeName);
@@ -242,9 +304,9 @@ Link::setNhV4FromNode(
 void
 Link::setNhV6FromNode(
     const std::string& nodeName, const thrift::BinaryAddress& nhV6) {
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     nhV61_ = nhV6;
-  } else if (n2_ == nodeName) {
+  } else if (isNode2(nodeName)) {
     nhV62_ = nhV6;
   } else {
     throw std::invalid_argument(nodeName);
@@ -257,9 +319,9 @@ Link::setMetricFromNode(
     LinkStateMetric d,
     LinkStateMetric holdUpTtl,
     LinkStateMetric holdDownTtl) {
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     return metric1_.updateValue(d, holdUpTtl, holdDownTtl);
-  } else if (n2_ == nodeName) {
+  } else if (isNode2(nodeName)) {
     return metric2_.updateValue(d, holdUpTtl, holdDownTtl);
   }
   throw std::invalid_argument(nodeName);
@@ -267,9 +329,9 @@ Link::setMetricFromNode(
 
 void
 Link::setAdjLabelFromNode(const std::string& nodeName, int32_t adjLabel) {
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     adjLabel1_ = adjLabel;
-  } else if (n2_ == nodeName) {
+  } else if (isNode2(nodeName)) {
     adjLabel2_ = adjLabel;
   } else {
     throw std::invalid_argument(nodeName);
@@ -283,9 +345,9 @@ Link::setOverloadFromNode(
     LinkStateMetric holdUpTtl,
     LinkStateMetric holdDownTtl) {
   bool const wasUp = isUp();
-  if (n1_ == nodeName) {
+  if (isNode1(nodeName)) {
     overload1_.updateValue(overload, holdUpTtl, holdDownTtl);
-  } else if (n2_ == nodeName) {
+  } else if (isNode2(nodeName)) {
     overload2_.updateValue(overload, holdUpTtl, holdDownTtl);
   } else {
     throw std::invalid_argument(nodeName);
@@ -313,7 +375,7 @@ Link::operator==(const Link& other) const {
 
 std::string
 Link::toString() const {
-  return folly::sformat("{}%{} <---> {}%{}", n1_, if1_, n2_, if2_);
+  return folly::sformat("{}%{} <---> {}%{}", *n1_, *if1_, *n2_, *if2_);
 }
 
 std::string
@@ -327,35 +389,96 @@ Link::directionalToString(const std::string& fromNode) const {
 }
 
 bool
-LinkState::LinkPtrHash::operator()(const std::shared_ptr<Link>& l) const {
-  return l->hash;
+LinkState::LinkPtrLess::operator()(const Link* lhs, const Link* rhs) const {
+  return *lhs < *rhs;
 }
 
-bool
-LinkState::LinkPtrLess::operator()(
-    const std::shared_ptr<Link>& lhs, const std::shared_ptr<Link>& rhs) const {
-  return *lhs < *rhs;
+namespace {
+
+// find link equal to `link` in `links`
+LinkState::LinkList::iterator
+findLink(LinkState::LinkList& links, const Link& link) {
+  return std::find_if(links.begin(), links.end(), [&link](const Link* l) {
+    return *l == link;
+  });
 }
 
+// remove `link` from `links`, order of links is not retained
 bool
-LinkState::LinkPtrEqual::operator()(
-    const std::shared_ptr<Link>& lhs, const std::shared_ptr<Link>& rhs) const {
-  return *lhs == *rhs;
+eraseLink(LinkState::LinkList& links, const Link* link) {
+  auto it = std::find(links.begin(), links.end(), link);
+  if (it == links.end()) {
+    return false;
+  }
+  *it = links.back();
+  links.pop_back();
+  return true;
+}
+
+} // namespace
+
+LinkState::~LinkState() {
+  for (auto* link : allLinks_) {
+    link->~Link();
+  }
+  for (auto& removedLink : removedLinks_) {
+    removedLink.second->~Link();
+  }
+}
+
+Link*
+LinkState::allocateLink(Link&& link) {
+  if (freeLinkSlots_.empty()) {
+    linkChunks_.emplace_back(std::make_unique<LinkSlot[]>(kLinkChunkSize));
+    auto* chunk = linkChunks_.back().get();
+    // hand out slots in address order
+    for (size_t i = kLinkChunkSize; i > 0; --i) {
+      freeLinkSlots_.emplace_back(&chunk[i - 1]);
+    }
+  }
+  auto* slot = freeLinkSlots_.back();
+  freeLinkSlots_.pop_back();
+  return new (slot) Link(std::move(link));
 }
 
 void
-LinkState::addLink(std::shared_ptr<Link> link) {
-  CHECK(linkMap_[link->firstNodeName()].insert(link).second);
-  CHECK(linkMap_[link->secondNodeName()].insert(link).second);
-  CHECK(allLinks_.insert(link).second);
+LinkState::freeLink(Link* link) {
+  link->~Link();
+  freeLinkSlots_.emplace_back(reinterpret_cast<LinkSlot*>(link));
+}
+
+Link*
+LinkState::addLink(Link link) {
+  internNode(link.firstNodeName());
+  internNode(link.secondNodeName());
+  auto& links1 = linkMap_[link.firstNodeName()];
+  auto& links2 = linkMap_[link.secondNodeName()];
+  CHECK(findLink(links1, link) == links1.end());
+  auto* linkPtr = allocateLink(std::move(link));
+  links1.emplace_back(linkPtr);
+  links2.emplace_back(linkPtr);
+  CHECK(allLinks_.insert(linkPtr).second);
+  updateHeldLink(linkPtr);
+  recordLinkChange(linkPtr, false);
+  invalidateCsrGraph();
+  return linkPtr;
 }
 
-// throws std::out_of_range if links are not present
 void
-LinkState::removeLink(std::shared_ptr<Link> link) {
-  CHECK(linkMap_.at(link->firstNodeName()).erase(link));
-  CHECK(linkMap_.at(link->secondNodeName()).erase(link));
-  CHECK(allLinks_.erase(link));
+LinkState::removeLink(const Link& link) {
+  auto& links1 = linkMap_.at(link.firstNodeName());
+  auto& links2 = linkMap_.at(link.secondNodeName());
+  auto it = findLink(links1, link);
+  CHECK(it != links1.end());
+  auto* linkPtr = *it;
+  CHECK(eraseLink(links1, linkPtr));
+  CHECK(eraseLink(links2, linkPtr));
+  CHECK(allLinks_.erase(linkPtr));
+  heldLinks_.erase(linkPtr);
+  recordLinkChange(linkPtr, true);
+  // the change refers to the link, keep it until the change is dropped
+  removedLinks_.emplace_back(version_, linkPtr);
+  invalidateCsrGraph();
 }
 
 void
@@ -367,31 +490,41 @@ LinkState::removeNode(const std::string& nodeName) {
   }
 
   // erase ptrs to these links from other nodes
-  for (auto const& link : search->second) {
+  auto links = std::move(search->second);
+  for (auto* link : links) {
     try {
-      CHECK(linkMap_.at(link->getOtherNodeName(nodeName)).erase(link));
+      CHECK(eraseLink(linkMap_.at(link->getOtherNodeName(nodeName)), link));
       CHECK(allLinks_.erase(link));
+      heldLinks_.erase(link);
     } catch (std::out_of_range const& e) {
       LOG(FATAL) << "std::out_of_range for " << nodeName;
     }
   }
   linkMap_.erase(search);
   nodeOverloads_.erase(nodeName);
+  heldNodes_.erase(nodeName);
+  recordFullChange();
+  // retained like any removed link, though a full change does not refer to
+  // them. Consumers may still have them at hand until they notice the change
+  for (auto* link : links) {
+    removedLinks_.emplace_back(version_, link);
+  }
+  invalidateCsrGraph();
 }
 
-const LinkState::LinkSet&
+const LinkState::LinkList&
 LinkState::linksFromNode(const std::string& nodeName) const {
-  static const LinkState::LinkSet defaultEmptySet;
+  static const LinkState::LinkList defaultEmptyList;
   auto search = linkMap_.find(nodeName);
   if (search != linkMap_.end()) {
     return search->second;
   }
-  return defaultEmptySet;
+  return defaultEmptyList;
 }
 
-std::vector<std::shared_ptr<Link>>
+std::vector<Link*>
 LinkState::orderedLinksFromNode(const std::string& nodeName) {
-  std::vector<std::shared_ptr<Link>> links;
+  std::vector<Link*> links;
   if (linkMap_.count(nodeName)) {
     links.insert(
         links.begin(),
@@ -408,9 +541,21 @@ LinkState::updateNodeOverloaded(
     bool isOverloaded,
     LinkStateMetric holdUpTtl,
     LinkStateMetric holdDownTtl) {
+  invalidateCsrGraph();
   if (nodeOverloads_.count(nodeName)) {
-    return nodeOverloads_.at(nodeName).updateValue(
-        isOverloaded, holdUpTtl, holdDownTtl);
+    auto& nodeOverload = nodeOverloads_.at(nodeName);
+    const bool wasOverloaded = nodeOverload.value();
+    const bool changed =
+        nodeOverload.updateValue(isOverloaded, holdUpTtl, holdDownTtl);
+    if (nodeOverload.hasHold()) {
+      heldNodes_.insert(nodeName);
+    } else {
+      heldNodes_.erase(nodeName);
+    }
+    if (wasOverloaded != nodeOverload.value()) {
+      recordFullChange();
+    }
+    return changed;
   }
   nodeOverloads_.emplace(nodeName, HoldableValue<bool>{isOverloaded});
   // don't indicate LinkState changed if this is a new node
@@ -422,34 +567,35 @@ LinkState::isNodeOverloaded(const std::string& nodeName) const {
   return nodeOverloads_.count(nodeName) && nodeOverloads_.at(nodeName).value();
 }
 
-bool
-LinkState::decrementHolds() {
-  bool holdChange = false;
-  for (auto& link : allLinks_) {
-    holdChange |= link->decrementHolds();
-  }
-  for (auto& kv : nodeOverloads_) {
-    holdChange |= kv.second.decrementTtl();
+void
+LinkState::updateHeldLink(Link* link) {
+  if (link->hasHolds()) {
+    heldLinks_.insert(link);
+  } else {
+    heldLinks_.erase(link);
   }
-  return holdChange;
 }
 
 bool
-LinkState::hasHolds() const {
-  for (auto& link : allLinks_) {
-    if (link->hasHolds()) {
-      return true;
-    }
+LinkState::decrementHolds() {
+  bool holdChange = false;
+  for (auto it = heldLinks_.begin(); it != heldLinks_.end();) {
+    holdChange |= (*it)->decrementHolds();
+    it = (*it)->hasHolds() ? std::next(it) : heldLinks_.erase(it);
   }
-  for (auto& kv : nodeOverloads_) {
-    if (kv.second.hasHold()) {
-      return true;
-    }
+  for (auto it = heldNodes_.begin(); it != heldNodes_.end();) {
+    auto& nodeOverload = nodeOverloads_.at(*it);
+    holdChange |= nodeOverload.decrementTtl();
+    it = nodeOverload.hasHold() ? std::next(it) : heldNodes_.erase(it);
   }
-  return false;
+  if (holdChange) {
+    recordFullChange();
+    invalidateCsrGraph();
+  }
+  return holdChange;
 }
 
-std::shared_ptr<Link>
+std::optional<Link>
 LinkState::maybeMakeLink(
     const std::string& nodeName, const thrift::Adjacency& adj) const {
   // only return Link if it is bidirectional.
@@ -459,26 +605,36 @@ LinkState::maybeMakeLink(
       if (nodeName == otherAdj.otherNodeName &&
           adj.otherIfName == otherAdj.ifName &&
           adj.ifName == otherAdj.otherIfName) {
-        return std::make_shared<Link>(
-            nodeName, adj, adj.otherNodeName, otherAdj);
+        return Link(nodeName, adj, adj.otherNodeName, otherAdj);
       }
     }
   }
-  return nullptr;
+  return std::nullopt;
 }
 
-std::vector<std::shared_ptr<Link>>
+std::vector<Link>
 LinkState::getOrderedLinkSet(const thrift::AdjacencyDatabase& adjDb) const {
-  std::vector<std::shared_ptr<Link>> links;
-  links.reserve(adjDb.adjacencies.size());
+  // Link is not assignable, sort handles and move the links over in order
+  std::vector<Link> unorderedLinks;
+  unorderedLinks.reserve(adjDb.adjacencies.size());
   for (const auto& adj : adjDb.adjacencies) {
-    auto linkPtr = maybeMakeLink(adjDb.thisNodeName, adj);
-    if (nullptr != linkPtr) {
-      links.emplace_back(linkPtr);
+    auto maybeLink = maybeMakeLink(adjDb.thisNodeName, adj);
+    if (maybeLink.has_value()) {
+      unorderedLinks.emplace_back(std::move(maybeLink.value()));
     }
   }
-  links.shrink_to_fit();
-  std::sort(links.begin(), links.end(), LinkState::LinkPtrLess{});
+  std::vector<Link*> order;
+  order.reserve(unorderedLinks.size());
+  for (auto& link : unorderedLinks) {
+    order.emplace_back(&link);
+  }
+  std::sort(order.begin(), order.end(), LinkState::LinkPtrLess{});
+
+  std::vector<Link> links;
+  links.reserve(order.size());
+  for (auto* link : order) {
+    links.emplace_back(std::move(*link));
+  }
   return links;
 }
 
@@ -489,21 +645,57 @@ LinkState::updateAdjacencyDatabase(
     thrift::AdjacencyDatabase const& newAdjacencyDb,
     LinkStateMetric holdUpTtl,
     LinkStateMetric holdDownTtl) {
-  auto const& nodeName = newAdjacencyDb.thisNodeName;
-  VLOG(1) << "Updating adjacency database for node " << nodeName;
+  return updateAdjacencyDatabases(
+             {AdjacencyDbUpdate{newAdjacencyDb, holdUpTtl, holdDownTtl}})
+      .at(0);
+}
+
+std::vector<std::pair<bool, bool>>
+LinkState::updateAdjacencyDatabases(
+    std::vector<AdjacencyDbUpdate> const& updates) {
+  // link attributes may change below, hence always invalidate the snapshot
+  invalidateCsrGraph();
+  adjacencyDatabasesSnapshot_ = nullptr;
+
+  // store all databases first, links between updated nodes are then made
+  // once from whichever side comes first
+  std::vector<int32_t> priorNodeLabels;
+  priorNodeLabels.reserve(updates.size());
+  for (auto const& update : updates) {
+    auto const& nodeName = update.adjacencyDb.thisNodeName;
+    VLOG(1) << "Updating adjacency database for node " << nodeName;
+    for (auto const& adj : update.adjacencyDb.adjacencies) {
+      VLOG(3) << "  neighbor: " << adj.otherNodeName
+              << ", remoteIfName: " << getRemoteIfName(adj)
+              << ", ifName: " << adj.ifName << ", metric: " << adj.metric
+              << ", overloaded: " << adj.isOverloaded << ", rtt: " << adj.rtt;
+    }
+    internNode(nodeName);
+    // Default construct if it did not exist
+    auto& adjacencyDb = adjacencyDatabases_[nodeName];
+    priorNodeLabels.emplace_back(adjacencyDb.nodeLabel);
+    adjacencyDb = update.adjacencyDb;
+  }
 
-  for (auto const& adj : newAdjacencyDb.adjacencies) {
-    VLOG(3) << "  neighbor: " << adj.otherNodeName
-            << ", remoteIfName: " << getRemoteIfName(adj)
-            << ", ifName: " << adj.ifName << ", metric: " << adj.metric
-            << ", overloaded: " << adj.isOverloaded << ", rtt: " << adj.rtt;
+  std::vector<std::pair<bool, bool>> rcs;
+  rcs.reserve(updates.size());
+  for (size_t i = 0; i < updates.size(); ++i) {
+    rcs.emplace_back(updateNodeLinks(
+        updates[i].adjacencyDb,
+        priorNodeLabels[i],
+        updates[i].holdUpTtl,
+        updates[i].holdDownTtl));
   }
+  return rcs;
+}
 
-  // Default construct if it did not exist
-  thrift::AdjacencyDatabase priorAdjacencyDb(
-      std::move(adjacencyDatabases_[nodeName]));
-  // replace
-  adjacencyDatabases_[nodeName] = newAdjacencyDb;
+std::pair<bool, bool>
+LinkState::updateNodeLinks(
+    thrift::AdjacencyDatabase const& newAdjacencyDb,
+    int32_t priorNodeLabel,
+    LinkStateMetric holdUpTtl,
+    LinkStateMetric holdDownTtl) {
+  auto const& nodeName = newAdjacencyDb.thisNodeName;
 
   // for comparing old and new state, we order the links based on the tuple
   // <nodeName1, iface1, nodeName2, iface2>, this allows us to easily discern
@@ -521,41 +713,41 @@ LinkState::updateAdjacencyDatabase(
   bool routeAttrChanged = false;
 
   // If changed locally we will need to update POP route for local node
-  routeAttrChanged |= priorAdjacencyDb.nodeLabel != newAdjacencyDb.nodeLabel;
+  routeAttrChanged |= priorNodeLabel != newAdjacencyDb.nodeLabel;
 
   auto newIter = newLinks.begin();
   auto oldIter = oldLinks.begin();
   while (newIter != newLinks.end() || oldIter != oldLinks.end()) {
     if (newIter != newLinks.end() &&
-        (oldIter == oldLinks.end() || **newIter < **oldIter)) {
+        (oldIter == oldLinks.end() || *newIter < **oldIter)) {
       // newIter is pointing at a Link not currently present, record this as a
       // link to add and advance newIter
-      (*newIter)->setHoldUpTtl(holdUpTtl);
-      topoChanged |= (*newIter)->isUp();
+      newIter->setHoldUpTtl(holdUpTtl);
+      topoChanged |= newIter->isUp();
       // even if we are holding a change, we apply the change to our link state
       // and check for holds when running spf. this ensures we don't add the
       // same hold twice
-      addLink(*newIter);
-      VLOG(1) << "addLink " << (*newIter)->toString();
+      VLOG(1) << "addLink " << newIter->toString();
+      addLink(std::move(*newIter));
       ++newIter;
       continue;
     }
     if (oldIter != oldLinks.end() &&
-        (newIter == newLinks.end() || **oldIter < **newIter)) {
+        (newIter == newLinks.end() || **oldIter < *newIter)) {
       // oldIter is pointing at a Link that is no longer present, record this
       // as a link to remove and advance oldIter.
       // If this link was previously overloaded or had a hold up, this does not
       // change the topology.
       topoChanged |= (*oldIter)->isUp();
-      removeLink(*oldIter);
       VLOG(1) << "removeLink " << (*oldIter)->toString();
+      removeLink(**oldIter);
       ++oldIter;
       continue;
     }
     // The newIter and oldIter point to the same link. This link did not go up
     // or down. The topology may still have changed though if the link overlaod
     // or metric changed
-    auto& newLink = **newIter;
+    auto& newLink = *newIter;
     auto& oldLink = **oldIter;
 
     // change the metric on the link object we already have
@@ -566,11 +758,13 @@ LinkState::updateAdjacencyDatabase(
           newLink.directionalToString(nodeName),
           oldLink.getMetricFromNode(nodeName),
           newLink.getMetricFromNode(nodeName));
+      recordLinkChange(*oldIter, true);
       topoChanged = oldLink.setMetricFromNode(
           nodeName,
           newLink.getMetricFromNode(nodeName),
           holdUpTtl,
           holdDownTtl);
+      updateHeldLink(*oldIter);
     }
 
     if (newLink.getOverloadFromNode(nodeName) !=
@@ -580,11 +774,13 @@ LinkState::updateAdjacencyDatabase(
           newLink.directionalToString(nodeName),
           oldLink.getOverloadFromNode(nodeName),
           newLink.getOverloadFromNode(nodeName));
+      recordLinkChange(*oldIter, true);
       topoChanged = oldLink.setOverloadFromNode(
           nodeName,
           newLink.getOverloadFromNode(nodeName),
           holdUpTtl,
           holdDownTtl);
+      updateHeldLink(*oldIter);
     }
 
     // Check if adjacency label has changed
@@ -646,7 +842,135 @@ LinkState::deleteAdjacencyDatabase(const std::string& nodeName) {
   }
   removeNode(nodeName);
   adjacencyDatabases_.erase(search);
+  adjacencyDatabasesSnapshot_ = nullptr;
   return true;
 }
 
+AdjacencyDbsSnapshot
+LinkState::getAdjacencyDatabasesSnapshot() const {
+  if (not adjacencyDatabasesSnapshot_) {
+    adjacencyDatabasesSnapshot_ = std::make_shared<const std::unordered_map<
+        std::string,
+        thrift::AdjacencyDatabase>>(adjacencyDatabases_);
+  }
+  return adjacencyDatabasesSnapshot_;
+}
+
+LinkState::NodeId
+LinkState::internNode(const std::string& nodeName) {
+  auto it = nodeIds_.find(nodeName);
+  if (it != nodeIds_.end()) {
+    return it->second;
+  }
+  const NodeId id = nodeNames_.size();
+  nodeIds_.emplace(nodeName, id);
+  nodeNames_.emplace_back(nodeName);
+  return id;
+}
+
+std::optional<LinkState::NodeId>
+LinkState::getNodeId(const std::string& nodeName) const {
+  auto it = nodeIds_.find(nodeName);
+  if (it == nodeIds_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+const std::string&
+LinkState::getNodeName(NodeId nodeId) const {
+  return nodeNames_.at(nodeId);
+}
+
+void
+LinkState::recordLinkChange(Link* link, bool wasPresent) {
+  LinkChange change;
+  if (wasPresent and link->isUp()) {
+    change.oldMetric1 = link->getMetricFromNode(link->firstNodeName());
+    change.oldMetric2 = link->getMetricFromNode(link->secondNodeName());
+  }
+  change.link = link;
+  changeLog_.emplace_back(++version_, std::move(change));
+  trimChangeLog();
+}
+
+void
+LinkState::recordFullChange() {
+  changeLog_.emplace_back(++version_, std::nullopt);
+  trimChangeLog();
+}
+
+void
+LinkState::trimChangeLog() {
+  if (changeLog_.size() > kMaxChangeLogSize) {
+    changeLog_.pop_front();
+  }
+  while (not removedLinks_.empty() and
+         removedLinks_.front().first < changeLog_.front().first) {
+    freeLink(removedLinks_.front().second);
+    removedLinks_.pop_front();
+  }
+}
+
+std::optional<std::vector<LinkState::LinkChange>>
+LinkState::getLinkChangesSince(uint64_t version) const {
+  std::vector<LinkChange> changes;
+  if (version == version_) {
+    return changes;
+  }
+  // changes older than the log are lost
+  if (version > version_ or changeLog_.empty() or
+      changeLog_.front().first > version + 1) {
+    return std::nullopt;
+  }
+  for (auto const& entry : changeLog_) {
+    if (entry.first <= version) {
+      continue;
+    }
+    if (not entry.second.has_value()) {
+      return std::nullopt;
+    }
+    changes.emplace_back(entry.second.value());
+  }
+  return changes;
+}
+
+const LinkState::CsrGraph&
+LinkState::getCsrGraph() const {
+  if (csrGraphStale_) {
+    buildCsrGraph();
+    csrGraphStale_ = false;
+  }
+  return csrGraph_;
+}
+
+void
+LinkState::buildCsrGraph() const {
+  const size_t numNodes = nodeNames_.size();
+  csrGraph_.offsets.assign(numNodes + 1, 0);
+  csrGraph_.edges.clear();
+  csrGraph_.edges.reserve(2 * allLinks_.size());
+  csrGraph_.overloaded.assign(numNodes, false);
+
+  for (NodeId id = 0; id < numNodes; ++id) {
+    auto const& nodeName = nodeNames_[id];
+    csrGraph_.offsets[id] = csrGraph_.edges.size();
+    csrGraph_.overloaded[id] = isNodeOverloaded(nodeName);
+    auto search = linkMap_.find(nodeName);
+    if (search == linkMap_.end()) {
+      continue;
+    }
+    for (auto const& link : search->second) {
+      if (not link->isUp()) {
+        continue;
+      }
+      csrGraph_.edges.emplace_back(CsrGraph::Edge{
+          nodeIds_.at(link->getOtherNodeName(nodeName)),
+          link->getMetricFromNode(nodeName),
+          link});
+    }
+  }
+  csrGraph_.offsets[numNodes] = csrGraph_.edges.size();
+}
+
 } // namespace openr
@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <deque>
 #include <memory>
+#include <optional>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -20,6 +23,11 @@ namespace openr {
 
 using LinkStateMetric = uint64_t;
 
+// immutable, shareable copy of the adjacency databases of a LinkState
+using AdjacencyDbsSnapshot = std::shared_ptr<const std::unordered_map<
+    std::string /* nodeName */,
+    thrift::AdjacencyDatabase>>;
+
 // HoldableValue is the basic building block for ordered FIB programming
 // (rfc 6976)
 //
@@ -69,9 +77,15 @@ class HoldableValue {
 //
 // 3. For each unique link in the network, holds a single object that can be
 // quickly accessed and modified via the nodeName of either end of the link.
+// Links are owned by LinkState and handed out as plain Link pointers, which
+// stay valid while the link is part of the LinkState (see addLink()).
 //
 // 4. Provides useful apis to read and write link state.
 //
+// Node and interface names of links are interned process wide, links refer to
+// them and compare them by address. Their hash is computed once on
+// construction.
+//
 
 class Link {
  public:
@@ -82,16 +96,25 @@ class Link {
       const openr::thrift::Adjacency& adj2);
 
  private:
-  const std::string n1_, n2_, if1_, if2_;
+  // true if nodeName is n1_, resp. n2_. Interned names match by address
+  bool isNode1(const std::string& nodeName) const;
+  bool isNode2(const std::string& nodeName) const;
+
+  // interned names, see internName()
+  const std::string* const n1_;
+  const std::string* const n2_;
+  const std::string* const if1_;
+  const std::string* const if2_;
   HoldableValue<LinkStateMetric> metric1_{1}, metric2_{1};
   HoldableValue<bool> overload1_{false}, overload2_{false};
   int32_t adjLabel1_{0}, adjLabel2_{0};
   thrift::BinaryAddress nhV41_, nhV42_, nhV61_, nhV62_;
   LinkStateMetric holdUpTtl_{0};
 
+  // <nodeName, ifName> of both ends, in lexicographic order
   const std::pair<
-      std::pair<std::string, std::string>,
-      std::pair<std::string, std::string>>
+      std::pair<const std::string*, const std::string*>,
+      std::pair<const std::string*, const std::string*>>
       orderedNames;
 
  public:
@@ -156,28 +179,75 @@ class Link {
 
 class LinkState {
  public:
-  struct LinkPtrHash {
-    bool operator()(const std::shared_ptr<Link>& l) const;
+  using NodeId = uint32_t;
+
+  LinkState() = default;
+  ~LinkState();
+
+  // Link handles are pointers into our own storage
+  LinkState(const LinkState&) = delete;
+  LinkState& operator=(const LinkState&) = delete;
+
+  //
+  // Compact, integer indexed view of the graph used by SPF computations.
+  // Every node name is interned into a dense NodeId and the adjacencies are
+  // laid out in CSR (compressed sparse row) form, i.e. the usable links from
+  // node `id` are edges[offsets[id]] ... edges[offsets[id + 1] - 1].
+  //
+  // Only links which are up are part of the graph and metrics are resolved
+  // at build time with holds applied. The graph is rebuilt lazily on first
+  // access after any mutation of the LinkState.
+  //
+  struct CsrGraph {
+    struct Edge {
+      NodeId otherNode;
+      LinkStateMetric metric;
+      Link* link;
+    };
+
+    // size numNodes + 1
+    std::vector<size_t> offsets;
+    std::vector<Edge> edges;
+    // indexed by NodeId
+    std::vector<bool> overloaded;
+
+    size_t
+    numNodes() const {
+      return overloaded.size();
+    }
   };
 
-  struct LinkPtrLess {
-    bool operator()(
-        const std::shared_ptr<Link>& lhs,
-        const std::shared_ptr<Link>& rhs) const;
+  //
+  // Describes a single link level change of the graph. The metrics in each
+  // direction are captured as they were *before* the change, std::nullopt
+  // denoting that the link was not usable (absent, overloaded or held down).
+  // Metric of node1 is the one from link->firstNodeName(). The link stays
+  // accessible for as long as the change can be retrieved, even if it got
+  // removed meanwhile
+  //
+  struct LinkChange {
+    Link* link;
+    std::optional<LinkStateMetric> oldMetric1;
+    std::optional<LinkStateMetric> oldMetric2;
   };
 
-  struct LinkPtrEqual {
-    bool operator()(
-        const std::shared_ptr<Link>& lhs,
-        const std::shared_ptr<Link>& rhs) const;
+  struct LinkPtrLess {
+    bool operator()(const Link* lhs, const Link* rhs) const;
   };
 
-  using LinkSet =
-      std::unordered_set<std::shared_ptr<Link>, LinkPtrHash, LinkPtrEqual>;
+  // links of a LinkState are unique objects, hence compared by address
+  using LinkSet = std::unordered_set<Link*>;
+
+  // links from a node, in no particular order
+  using LinkList = std::vector<Link*>;
 
-  void addLink(std::shared_ptr<Link> link);
+  // Take over the given link and return the handle to it. The handle stays
+  // valid until the link gets removed (and for as long as the removal can be
+  // retrieved with getLinkChangesSince())
+  Link* addLink(Link link);
 
-  void removeLink(std::shared_ptr<Link> link);
+  // throws std::out_of_range if links are not present
+  void removeLink(const Link& link);
 
   void removeNode(const std::string& nodeName);
 
@@ -186,10 +256,9 @@ class LinkState {
     return 0 != adjacencyDatabases_.count(nodeName);
   }
 
-  const LinkSet& linksFromNode(const std::string& nodeName) const;
+  const LinkList& linksFromNode(const std::string& nodeName) const;
 
-  std::vector<std::shared_ptr<Link>> orderedLinksFromNode(
-      const std::string& nodeName);
+  std::vector<Link*> orderedLinksFromNode(const std::string& nodeName);
 
   bool updateNodeOverloaded(
       const std::string& nodeName,
@@ -199,9 +268,14 @@ class LinkState {
 
   bool isNodeOverloaded(const std::string& nodeName) const;
 
+  // decrement the holds of held links and nodes only. Returns true if a hold
+  // expired
   bool decrementHolds();
 
-  bool hasHolds() const;
+  bool
+  hasHolds() const {
+    return not heldLinks_.empty() or not heldNodes_.empty();
+  }
 
   size_t
   numLinks() const {
@@ -222,6 +296,20 @@ class LinkState {
       LinkStateMetric holdUpTtl,
       LinkStateMetric holdDownTtl);
 
+  // adjacency database of a node along with the hold TTLs of its changes
+  struct AdjacencyDbUpdate {
+    thrift::AdjacencyDatabase const& adjacencyDb;
+    LinkStateMetric holdUpTtl{0};
+    LinkStateMetric holdDownTtl{0};
+  };
+
+  // update adjacencies of several routers at once, e.g. after a full sync.
+  // All databases are stored before links are rebuilt, so a link between two
+  // updated nodes is made once. Returns the result of updateAdjacencyDatabase()
+  // for each of them
+  std::vector<std::pair<bool, bool>> updateAdjacencyDatabases(
+      std::vector<AdjacencyDbUpdate> const& updates);
+
   // delete a node's adjacency database
   // return true if this has caused any change in graph
   bool deleteAdjacencyDatabase(const std::string& nodeName);
@@ -234,17 +322,90 @@ class LinkState {
     return adjacencyDatabases_;
   }
 
+  // copy of getAdjacencyDatabases() which is shared, and stays valid, until
+  // the next change. The returned map may be read from any thread
+  AdjacencyDbsSnapshot getAdjacencyDatabasesSnapshot() const;
+
+  // NodeId of the given node if it has ever been part of the link state.
+  // Ids are never re-used, hence they stay valid across graph updates
+  std::optional<NodeId> getNodeId(const std::string& nodeName) const;
+
+  // reverse lookup of getNodeId(). throws std::out_of_range on unknown id
+  const std::string& getNodeName(NodeId nodeId) const;
+
+  // integer indexed snapshot of the current graph, see CsrGraph
+  const CsrGraph& getCsrGraph() const;
+
+  // monotonically increasing version, bumped on every change of the graph
+  uint64_t
+  getVersion() const {
+    return version_;
+  }
+
+  // Link changes applied after `version`, in order. Returns std::nullopt if the
+  // changes since then can not be expressed as link changes only (node
+  // overload, node removal, hold expiry) or are too old to be retained.
+  std::optional<std::vector<LinkChange>> getLinkChangesSince(
+      uint64_t version) const;
+
  private:
+  // intern node name if not already known and return its NodeId
+  NodeId internNode(const std::string& nodeName);
+
+  void
+  invalidateCsrGraph() {
+    csrGraphStale_ = true;
+  }
+
+  void buildCsrGraph() const;
+
+  // record a change in the change log. Must be called before `link` is
+  // modified, unless `wasPresent` is false
+  void recordLinkChange(Link* link, bool wasPresent);
+
+  // record a change which invalidates all consumers of the change log
+  void recordFullChange();
+
+  // drop changes beyond kMaxChangeLogSize and free links which can no longer
+  // be retrieved through them
+  void trimChangeLog();
+
+  // add link to or remove it from heldLinks_, after its holds changed
+  void updateHeldLink(Link* link);
+
   // returns Link object if the reverse adjancency is present in
-  // adjacencyDatabases_.at(adj.otherNodeName), else returns nullptr
-  std::shared_ptr<Link> maybeMakeLink(
+  // adjacencyDatabases_.at(adj.otherNodeName)
+  std::optional<Link> maybeMakeLink(
       const std::string& nodeName, const thrift::Adjacency& adj) const;
 
-  std::vector<std::shared_ptr<Link>> getOrderedLinkSet(
+  // bidirectional links of adjDb, in the order of LinkPtrLess
+  std::vector<Link> getOrderedLinkSet(
       const thrift::AdjacencyDatabase& adjDb) const;
 
+  // bring links of the node of newAdjacencyDb, already stored, in line with
+  // it. Returns the same as updateAdjacencyDatabase()
+  std::pair<bool, bool> updateNodeLinks(
+      thrift::AdjacencyDatabase const& newAdjacencyDb,
+      int32_t priorNodeLabel,
+      LinkStateMetric holdUpTtl,
+      LinkStateMetric holdDownTtl);
+
+  // Link storage. Links are constructed in place in chunks of slots, so
+  // that their addresses are stable and links are close to each other in
+  // memory. Slots of removed links are reused
+  Link* allocateLink(Link&& link);
+  void freeLink(Link* link);
+
+  using LinkSlot = std::aligned_storage_t<sizeof(Link), alignof(Link)>;
+  std::vector<std::unique_ptr<LinkSlot[]>> linkChunks_;
+  std::vector<LinkSlot*> freeLinkSlots_;
+
+  // removed links along with the version of their removal. Freed once the
+  // change got dropped from changeLog_
+  std::deque<std::pair<uint64_t, Link*>> removedLinks_;
+
   // this stores the same link object accessible from either nodeName
-  std::unordered_map<std::string /* nodeName */, LinkSet> linkMap_;
+  std::unordered_map<std::string /* nodeName */, LinkList> linkMap_;
 
   // useful for iterating over all the links
   LinkSet allLinks_;
@@ -252,10 +413,30 @@ class LinkState {
   std::unordered_map<std::string /* nodeName */, HoldableValue<bool>>
       nodeOverloads_;
 
+  // links and nodes with a hold, kept in sync with their holds so that hold
+  // processing and hasHolds() don't scan all of the links and nodes
+  LinkSet heldLinks_;
+  std::unordered_set<std::string /* nodeName */> heldNodes_;
+
   // the latest AdjacencyDatabase we've received from each node
   std::unordered_map<std::string, thrift::AdjacencyDatabase>
       adjacencyDatabases_;
 
+  // lazily copied from adjacencyDatabases_, reset on change
+  mutable AdjacencyDbsSnapshot adjacencyDatabasesSnapshot_;
+
+  // node name interning table, nodeNames_[nodeIds_[name]] == name
+  std::unordered_map<std::string, NodeId> nodeIds_;
+  std::vector<std::string> nodeNames_;
+
+  // version and log of recent changes, see getLinkChangesSince()
+  uint64_t version_{0};
+  std::deque<std::pair<uint64_t, std::optional<LinkChange>>> changeLog_;
+
+  // lazily (re)built on access, see getCsrGraph()
+  mutable CsrGraph csrGraph_;
+  mutable bool csrGraphStale_{true};
+
 }; // class LinkState
 } // namespace openr
 
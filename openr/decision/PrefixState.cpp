@@ -31,22 +31,27 @@ PrefixState::deleteLoopbackPrefix(
   }
 }
 
-bool
+std::unordered_set<IpPrefixKey>
 PrefixState::updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb) {
   auto const& nodeName = prefixDb.thisNodeName;
 
-  // Get old and new set of prefixes - NOTE explicit copy
-  const std::set<thrift::IpPrefix> oldPrefixSet = nodeToPrefixes_[nodeName];
-
-  // update the entry
-  auto& newPrefixSet = nodeToPrefixes_[nodeName];
-  newPrefixSet.clear();
+  // keys of the entries, throws before anything changes
+  std::vector<IpPrefixKey> prefixKeys;
+  prefixKeys.reserve(prefixDb.prefixEntries.size());
   for (const auto& prefixEntry : prefixDb.prefixEntries) {
-    newPrefixSet.emplace(prefixEntry.prefix);
+    prefixKeys.emplace_back(prefixEntry.prefix);
   }
 
-  // Boolean to indicate update in prefix entry
-  bool isUpdated{false};
+  // Get old and new set of prefixes
+  auto& newPrefixSet = nodeToPrefixes_[nodeName];
+  std::set<IpPrefixKey> oldPrefixSet;
+  oldPrefixSet.swap(newPrefixSet);
+
+  // update the entry
+  newPrefixSet.insert(prefixKeys.begin(), prefixKeys.end());
+
+  // Prefixes whose entry of this node got added, updated or removed
+  std::unordered_set<IpPrefixKey> changedPrefixes;
 
   // Remove old prefixes first
   for (const auto& prefix : oldPrefixSet) {
@@ -57,14 +62,17 @@ PrefixState::updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb) {
             << nodeName;
     auto& nodeList = prefixes_.at(prefix);
     nodeList.erase(nodeName);
-    isUpdated = true;
+    changedPrefixes.emplace(prefix);
     if (nodeList.empty()) {
       prefixes_.erase(prefix);
     }
-    deleteLoopbackPrefix(prefix, nodeName);
+    updateNormalizedMetricVector(prefix, nodeName, nullptr);
+    deleteLoopbackPrefix(prefix.toThrift(), nodeName);
   }
-  for (const auto& prefixEntry : prefixDb.prefixEntries) {
-    auto& nodeList = prefixes_[prefixEntry.prefix];
+  for (size_t i = 0; i < prefixKeys.size(); ++i) {
+    const auto& prefix = prefixKeys[i];
+    const auto& prefixEntry = prefixDb.prefixEntries[i];
+    auto& nodeList = prefixes_[prefix];
     auto nodePrefixIt = nodeList.find(nodeName);
 
     // Add or Update prefix
@@ -72,16 +80,19 @@ PrefixState::updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb) {
       VLOG(1) << "Prefix " << toString(prefixEntry.prefix)
               << " has been advertised by node " << nodeName;
       nodeList.emplace(nodeName, prefixEntry);
-      isUpdated = true;
     } else if (nodePrefixIt->second != prefixEntry) {
       VLOG(1) << "Prefix " << toString(prefixEntry.prefix)
               << " has been updated by node " << nodeName;
       nodeList[nodeName] = prefixEntry;
-      isUpdated = true;
     } else {
       // This prefix has no change. Skip rest of code!
       continue;
     }
+    changedPrefixes.emplace(prefix);
+    updateNormalizedMetricVector(
+        prefix,
+        nodeName,
+        prefixEntry.mv.has_value() ? &prefixEntry.mv.value() : nullptr);
 
     // Keep track of loopback addresses (v4 / v6) for each node
     if (thrift::PrefixType::LOOPBACK == prefixEntry.type) {
@@ -101,7 +112,42 @@ PrefixState::updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb) {
     nodeToPrefixes_.erase(nodeName);
   }
 
-  return isUpdated;
+  if (not changedPrefixes.empty()) {
+    prefixDatabasesSnapshot_ = nullptr;
+  }
+  changedPrefixes_.insert(changedPrefixes.begin(), changedPrefixes.end());
+  return changedPrefixes;
+}
+
+void
+PrefixState::updateNormalizedMetricVector(
+    IpPrefixKey const& prefix,
+    std::string const& nodeName,
+    thrift::MetricVector const* mv) {
+  if (mv) {
+    normalizedMetricVectors_[prefix][nodeName] =
+        MetricVectorUtils::normalizeMetricVector(*mv);
+    return;
+  }
+  auto it = normalizedMetricVectors_.find(prefix);
+  if (it == normalizedMetricVectors_.end()) {
+    return;
+  }
+  it->second.erase(nodeName);
+  if (it->second.empty()) {
+    normalizedMetricVectors_.erase(it);
+  }
+}
+
+MetricVectorUtils::NormalizedMetricVector const*
+PrefixState::getNormalizedMetricVector(
+    IpPrefixKey const& prefix, std::string const& nodeName) const {
+  auto it = normalizedMetricVectors_.find(prefix);
+  if (it == normalizedMetricVectors_.end()) {
+    return nullptr;
+  }
+  auto nodeIt = it->second.find(nodeName);
+  return nodeIt == it->second.end() ? nullptr : &nodeIt->second;
 }
 
 std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
@@ -118,6 +164,16 @@ PrefixState::getPrefixDatabases() const {
   return prefixDatabases;
 }
 
+PrefixDbsSnapshot
+PrefixState::getPrefixDatabasesSnapshot() const {
+  if (not prefixDatabasesSnapshot_) {
+    prefixDatabasesSnapshot_ = std::make_shared<
+        const std::unordered_map<std::string, thrift::PrefixDatabase>>(
+        getPrefixDatabases());
+  }
+  return prefixDatabasesSnapshot_;
+}
+
 std::vector<thrift::NextHopThrift>
 PrefixState::getLoopbackVias(
     std::unordered_set<std::string> const& nodes,
@@ -7,19 +7,28 @@
 
 #pragma once
 
+#include <memory>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/Lsdb_types.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 
 namespace openr {
+
+// immutable, shareable copy of the prefix databases of a PrefixState
+using PrefixDbsSnapshot = std::shared_ptr<const std::unordered_map<
+    std::string /* nodeName */,
+    thrift::PrefixDatabase>>;
+
 class PrefixState {
  public:
   std::unordered_map<
-      thrift::IpPrefix,
+      IpPrefixKey,
       std::unordered_map<std::string, thrift::PrefixEntry>> const&
   prefixes() const {
     return prefixes_;
@@ -29,12 +38,42 @@ class PrefixState {
   void deleteLoopbackPrefix(
       thrift::IpPrefix const& prefix, const std::string& nodename);
 
-  // returns true if the prefixDb changed
-  bool updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb);
+  // returns prefixes announced, updated or withdrawn by this update. Empty if
+  // the prefixDb did not change. Throws std::invalid_argument, without
+  // applying the update, if the prefixDb has invalid prefixes
+  std::unordered_set<IpPrefixKey> updatePrefixDatabase(
+      thrift::PrefixDatabase const& prefixDb);
 
   std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
   getPrefixDatabases() const;
 
+  // getPrefixDatabases() which is shared, and stays valid, until the next
+  // change. The returned map may be read from any thread
+  PrefixDbsSnapshot getPrefixDatabasesSnapshot() const;
+
+  // metric vector of the entry of node for prefix, normalized once when the
+  // entry is announced or updated. nullptr if the entry has no metric vector
+  MetricVectorUtils::NormalizedMetricVector const* getNormalizedMetricVector(
+      IpPrefixKey const& prefix, std::string const& nodeName) const;
+
+  // prefixes announced by each node, kept in sync with prefixes()
+  std::unordered_map<std::string, std::set<IpPrefixKey>> const&
+  getNodeToPrefixes() const {
+    return nodeToPrefixes_;
+  }
+
+  // prefixes that got announced, updated or withdrawn by any node since the
+  // last clearChangedPrefixes()
+  std::unordered_set<IpPrefixKey> const&
+  getChangedPrefixes() const {
+    return changedPrefixes_;
+  }
+
+  void
+  clearChangedPrefixes() {
+    changedPrefixes_.clear();
+  }
+
   std::vector<thrift::NextHopThrift> getLoopbackVias(
       std::unordered_set<std::string> const& nodes,
       bool const isV4,
@@ -51,14 +90,31 @@ class PrefixState {
   }
 
  private:
+  // normalize mv of the entry of node for prefix, forget it if mv is nullptr
+  void updateNormalizedMetricVector(
+      IpPrefixKey const& prefix,
+      std::string const& nodeName,
+      thrift::MetricVector const* mv);
+
   // For each prefix in the network, stores a set of nodes that advertise it
   std::unordered_map<
-      thrift::IpPrefix,
+      IpPrefixKey,
       std::unordered_map<std::string, thrift::PrefixEntry>>
       prefixes_;
-  std::unordered_map<std::string, std::set<thrift::IpPrefix>> nodeToPrefixes_;
+  // Reverse index of prefixes_, stores the set of prefixes each node advertises
+  std::unordered_map<std::string, std::set<IpPrefixKey>> nodeToPrefixes_;
+  // normalized metric vectors of the entries in prefixes_ that have one
+  std::unordered_map<
+      IpPrefixKey,
+      std::unordered_map<
+          std::string,
+          MetricVectorUtils::NormalizedMetricVector>>
+      normalizedMetricVectors_;
+  std::unordered_set<IpPrefixKey> changedPrefixes_;
   std::unordered_map<std::string, thrift::BinaryAddress> nodeHostLoopbacksV4_;
   std::unordered_map<std::string, thrift::BinaryAddress> nodeHostLoopbacksV6_;
+  // lazily built by getPrefixDatabasesSnapshot(), reset on change
+  mutable PrefixDbsSnapshot prefixDatabasesSnapshot_;
 }; // class PrefixState
 
 } // namespace openr
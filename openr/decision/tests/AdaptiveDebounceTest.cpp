@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/decision/AdaptiveDebounce.h>
+
+using namespace openr;
+using namespace std::chrono_literals;
+
+namespace {
+const std::chrono::milliseconds kMinDebounce{10};
+const std::chrono::milliseconds kMaxDebounce{500};
+} // namespace
+
+TEST(AdaptiveDebounceTest, IsolatedUpdate) {
+  AdaptiveDebounce debounce(kMinDebounce, kMaxDebounce);
+  auto now = AdaptiveDebounce::Clock::now();
+
+  EXPECT_EQ(0, debounce.getPendingCount());
+  EXPECT_EQ(0ms, debounce.getPendingDuration(now));
+
+  // isolated update gets processed after min debounce
+  EXPECT_EQ(kMinDebounce, debounce.reportUpdate(now));
+  EXPECT_EQ(1, debounce.getPendingCount());
+  EXPECT_EQ(5ms, debounce.getPendingDuration(now + 5ms));
+
+  // second half of the same event extends the window
+  EXPECT_EQ(kMinDebounce, debounce.reportUpdate(now + 1ms));
+  EXPECT_EQ(2, debounce.getPendingCount());
+
+  debounce.reportRun(2ms);
+  EXPECT_EQ(0, debounce.getPendingCount());
+  EXPECT_EQ(0ms, debounce.getPendingDuration(now + 12ms));
+  EXPECT_EQ(2ms, debounce.getAverageRunTime());
+
+  // next isolated update doesn't inherit previous churn
+  now += 2 * kMaxDebounce;
+  EXPECT_EQ(kMinDebounce, debounce.reportUpdate(now));
+  EXPECT_EQ(0ms, debounce.getAverageGap());
+}
+
+TEST(AdaptiveDebounceTest, WindowCoversRunTime) {
+  AdaptiveDebounce debounce(kMinDebounce, kMaxDebounce);
+  auto now = AdaptiveDebounce::Clock::now();
+
+  EXPECT_EQ(kMinDebounce, debounce.reportUpdate(now));
+  debounce.reportRun(100ms);
+
+  // update in the middle of churn waits for about one run
+  now += 40ms;
+  EXPECT_EQ(100ms, debounce.reportUpdate(now));
+
+  // window keeps covering a run from the latest update
+  EXPECT_EQ(100ms, debounce.reportUpdate(now + 1ms));
+  EXPECT_EQ(2, debounce.getPendingCount());
+}
+
+TEST(AdaptiveDebounceTest, StormIsCappedByMaxDebounce) {
+  AdaptiveDebounce debounce(kMinDebounce, kMaxDebounce);
+  const auto start = AdaptiveDebounce::Clock::now();
+
+  EXPECT_EQ(kMinDebounce, debounce.reportUpdate(start));
+
+  // updates every 8ms keep extending the window, but never past max debounce
+  // from the first pending update
+  std::optional<std::chrono::milliseconds> lastTimeout;
+  auto now = start;
+  for (int i = 0; i < 100; ++i) {
+    now += 8ms;
+    auto timeout = debounce.reportUpdate(now);
+    if (timeout.has_value()) {
+      lastTimeout = timeout;
+      EXPECT_GE(timeout.value(), kMinDebounce);
+      EXPECT_LE(now + timeout.value(), start + kMaxDebounce);
+    }
+  }
+  EXPECT_EQ(101, debounce.getPendingCount());
+  EXPECT_EQ(8ms, debounce.getAverageGap());
+  ASSERT_TRUE(lastTimeout.has_value());
+  EXPECT_EQ(800ms, debounce.getPendingDuration(now));
+  // deadline is past, process right away
+  EXPECT_EQ(std::nullopt, debounce.reportUpdate(now + 1ms));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
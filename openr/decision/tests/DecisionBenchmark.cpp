@@ -5,6 +5,10 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <sys/resource.h>
+#include <set>
+
+#include <fb303/ServiceData.h>
 #include <folly/Benchmark.h>
 #include <folly/IPAddress.h>
 #include <folly/IPAddressV4.h>
@@ -17,33 +21,12 @@
 #include <openr/common/Constants.h>
 #include <openr/common/Util.h>
 #include <openr/decision/Decision.h>
+#include <openr/decision/DijkstraQueue.h>
+#include <openr/tests/BenchmarkUtils.h>
 #include <openr/tests/OpenrThriftServerWrapper.h>
 #include <thrift/lib/cpp2/Thrift.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
-/**
- * Defines a benchmark that allows users to record customized counter during
- * benchmarking and passes a parameter to another one. This is common for
- * benchmarks that need a "problem size" in addition to "number of iterations".
- */
-#define BENCHMARK_COUNTERS_PARAM(name, counters, param) \
-  BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param, param)
-
-/*
- * Like BENCHMARK_COUNTERS_PARAM(), but allows a custom name to be specified for
- * each parameter, rather than using the parameter value.
- */
-#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
-  BENCHMARK_IMPL_COUNTERS(                                             \
-      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
-      FOLLY_PP_STRINGIZE(name) "(" FOLLY_PP_STRINGIZE(param_name) ")", \
-      counters,                                                        \
-      iters,                                                           \
-      unsigned,                                                        \
-      iters) {                                                         \
-    name(counters, iters, ##__VA_ARGS__);                              \
-  }
-
 namespace {
 // We have 24 SSWs per plane as of now and moving towards 36 per plane.
 const int kNumOfSswsPerPlane = 36;
@@ -157,7 +140,8 @@ class DecisionWrapper {
   // publish routeDb
   void
   sendKvPublication(const thrift::Publication& publication) {
-    kvStoreUpdatesQueue.push(publication);
+    kvStoreUpdatesQueue.push(
+        std::make_shared<const thrift::Publication>(publication));
   }
 
  private:
@@ -188,7 +172,7 @@ class DecisionWrapper {
   // ZMQ context for IO processing
   fbzmq::Context zeromqContext{};
 
-  messaging::ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue;
+  messaging::ReplicateQueue<KvStorePublication> kvStoreUpdatesQueue;
   messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue;
   messaging::ReplicateQueue<thrift::RouteDatabaseDelta> staticRoutesUpdateQueue;
   messaging::RQueue<thrift::RouteDatabaseDelta> routeUpdatesQueueReader{
@@ -787,6 +771,507 @@ BM_DecisionFabric(
   insertUserCounters(counters, iters, processTimes);
 }
 
+//
+// Benchmarks below drive SpfSolver directly, without the Decision event loop
+// and debounce, so that they only measure the computation triggered by one
+// topology or prefix event on top of a converged network
+//
+
+enum class BenchTopology {
+  // sparse mesh of a ring plus random chords, with varying link metrics
+  WAN,
+  // three tier Clos fabric of ssws, fsws and rsws, see createFabric()
+  CLOS,
+};
+
+enum class BenchEvent {
+  LINK_FLAP,
+  METRIC_CHANGE,
+  NODE_OVERLOAD,
+  PREFIX_FLAP,
+};
+
+// link between two nodes identified by their index, with the metric to use
+// in both directions
+struct BenchLink {
+  uint32_t node{0};
+  uint32_t otherNode{0};
+  int32_t metric{1};
+};
+
+std::vector<BenchLink>
+createWanLinks(const uint32_t numOfNodes) {
+  std::vector<BenchLink> links;
+  std::set<std::pair<uint32_t, uint32_t>> linked;
+  auto addLink = [&](uint32_t node, uint32_t otherNode) {
+    if (node == otherNode or
+        not linked.emplace(std::minmax(node, otherNode)).second) {
+      return;
+    }
+    links.push_back(BenchLink{
+        node, otherNode, static_cast<int32_t>(1 + folly::Random::rand32(200))});
+  };
+
+  // ring keeps the network connected, chords give an average degree of 3
+  for (uint32_t node = 0; node < numOfNodes; ++node) {
+    addLink(node, (node + 1) % numOfNodes);
+  }
+  for (uint32_t node = 0; node < numOfNodes; node += 2) {
+    addLink(node, folly::Random::rand32(numOfNodes));
+  }
+  return links;
+}
+
+std::vector<BenchLink>
+createClosLinks(const uint32_t numOfNodes, uint32_t& numOfActualNodes) {
+  const uint32_t numOfPlanes = kNumOfFswsPerPod;
+  const uint32_t numOfSsws = numOfPlanes * kNumOfSswsPerPlane;
+  CHECK_LT(numOfSsws, numOfNodes);
+  const uint32_t numOfPods =
+      (numOfNodes - numOfSsws) / (kNumOfFswsPerPod + kNumOfRswsPerPod);
+  CHECK_LT(0, numOfPods);
+
+  // nodes are numbered ssws first, then fsws and rsws of every pod
+  auto sswId = [&](uint32_t planeId, uint32_t sswIdInPlane) {
+    return planeId * kNumOfSswsPerPlane + sswIdInPlane;
+  };
+  auto fswId = [&](uint32_t podId, uint32_t fswIdInPod) {
+    return numOfSsws + podId * kNumOfFswsPerPod + fswIdInPod;
+  };
+  auto rswId = [&](uint32_t podId, uint32_t rswIdInPod) {
+    return numOfSsws + numOfPods * kNumOfFswsPerPod +
+        podId * kNumOfRswsPerPod + rswIdInPod;
+  };
+  numOfActualNodes = rswId(numOfPods, 0);
+
+  std::vector<BenchLink> links;
+  for (uint32_t podId = 0; podId < numOfPods; ++podId) {
+    for (uint32_t fswIdInPod = 0; fswIdInPod < kNumOfFswsPerPod;
+         ++fswIdInPod) {
+      // each fsw connects to all ssws of its plane
+      for (uint32_t sswIdInPlane = 0; sswIdInPlane < kNumOfSswsPerPlane;
+           ++sswIdInPlane) {
+        links.push_back(BenchLink{
+            fswId(podId, fswIdInPod), sswId(fswIdInPod, sswIdInPlane), 1});
+      }
+      // and to all rsws within its pod
+      for (uint32_t rswIdInPod = 0; rswIdInPod < kNumOfRswsPerPod;
+           ++rswIdInPod) {
+        links.push_back(
+            BenchLink{fswId(podId, fswIdInPod), rswId(podId, rswIdInPod), 1});
+      }
+    }
+  }
+  return links;
+}
+
+// Create adjacency towards otherNode
+thrift::Adjacency
+createBenchAdjacency(
+    const uint32_t node, const uint32_t otherNode, const int32_t metric) {
+  return createThriftAdjacency(
+      folly::sformat("{}", otherNode),
+      getIfName(node, otherNode),
+      folly::sformat(
+          "fe80:{}::{}", toHex(otherNode >> 16), toHex(otherNode & 0xffff)),
+      folly::sformat(
+          "10.{}.{}.{}",
+          otherNode >> 16,
+          (otherNode >> 8) & 0xff,
+          otherNode & 0xff),
+      metric,
+      100001 + otherNode /* adjacency-label */,
+      false /* overload-bit */,
+      100,
+      10000 /* timestamp */,
+      1 /* weight */,
+      getIfName(otherNode, node));
+}
+
+thrift::IpPrefix
+createBenchPrefix(const uint32_t node, const uint32_t index) {
+  return toIpPrefix(folly::sformat("fc00:{:x}:{:x}::/64", node, index));
+}
+
+//
+// Converged SpfSolver for node "0" of a generated topology
+//
+class SpfSolverBench {
+ public:
+  SpfSolverBench(
+      BenchTopology topology,
+      uint32_t numOfNodes,
+      uint32_t numOfPrefixesPerNode,
+      bool computeLfaPaths,
+      bool useKsp2)
+      : solver_(std::make_unique<SpfSolver>(
+            "0", true /* enableV4 */, computeLfaPaths)),
+        useKsp2_(useKsp2) {
+    if (topology == BenchTopology::WAN) {
+      links_ = createWanLinks(numOfNodes);
+    } else {
+      links_ = createClosLinks(numOfNodes, numOfNodes);
+    }
+    LOG(INFO) << "nodes: " << numOfNodes << ", links: " << links_.size()
+              << ", prefixes: " << numOfNodes * numOfPrefixesPerNode;
+
+    std::vector<std::vector<thrift::Adjacency>> adjs(numOfNodes);
+    for (const auto& link : links_) {
+      adjs[link.node].emplace_back(
+          createBenchAdjacency(link.node, link.otherNode, link.metric));
+      adjs[link.otherNode].emplace_back(
+          createBenchAdjacency(link.otherNode, link.node, link.metric));
+    }
+    for (uint32_t node = 0; node < numOfNodes; ++node) {
+      adjDbs_.emplace_back(createAdjDb(
+          folly::sformat("{}", node), adjs[node], node + 1 /* node label */));
+      solver_->updateAdjacencyDatabase(adjDbs_.back());
+
+      std::vector<thrift::PrefixEntry> prefixEntries;
+      for (uint32_t index = 0; index < numOfPrefixesPerNode; ++index) {
+        prefixEntries.emplace_back(
+            createBenchPrefixEntry(createBenchPrefix(node, index)));
+      }
+      prefixDbs_.emplace_back(
+          createPrefixDb(folly::sformat("{}", node), prefixEntries));
+      solver_->updatePrefixDatabase(prefixDbs_.back());
+    }
+    CHECK(solver_->buildPaths("0").has_value());
+  }
+
+  // Apply given event to the topology, or revert it if the previous event
+  // has not been reverted yet, and rebuild routes
+  void
+  processEvent(BenchEvent event) {
+    if (event == BenchEvent::PREFIX_FLAP) {
+      flapPrefix();
+      CHECK(solver_->buildRouteDb("0").has_value());
+      return;
+    }
+
+    if (not pendingRevert_.has_value()) {
+      pendingRevert_ = folly::Random::rand32(links_.size());
+      const auto& link = links_.at(*pendingRevert_);
+      auto& adjDb = adjDbs_.at(link.node);
+      savedAdjDb_ = adjDb;
+      if (event == BenchEvent::NODE_OVERLOAD) {
+        adjDb.isOverloaded = true;
+      } else {
+        auto it = std::find_if(
+            adjDb.adjacencies.begin(),
+            adjDb.adjacencies.end(),
+            [&](const thrift::Adjacency& adj) {
+              return adj.otherNodeName == folly::sformat("{}", link.otherNode);
+            });
+        CHECK(it != adjDb.adjacencies.end());
+        if (event == BenchEvent::LINK_FLAP) {
+          adjDb.adjacencies.erase(it);
+        } else {
+          it->metric *= 2;
+        }
+      }
+      solver_->updateAdjacencyDatabase(adjDb);
+    } else {
+      const auto& link = links_.at(*pendingRevert_);
+      adjDbs_.at(link.node) = savedAdjDb_;
+      solver_->updateAdjacencyDatabase(savedAdjDb_);
+      pendingRevert_ = std::nullopt;
+    }
+    CHECK(solver_->buildPaths("0").has_value());
+  }
+
+ private:
+  thrift::PrefixEntry
+  createBenchPrefixEntry(const thrift::IpPrefix& prefix) const {
+    if (not useKsp2_) {
+      return createPrefixEntry(prefix);
+    }
+    return createPrefixEntry(
+        prefix,
+        thrift::PrefixType::LOOPBACK,
+        "",
+        thrift::PrefixForwardingType::SR_MPLS,
+        thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP);
+  }
+
+  // add an extra prefix to a random node, or withdraw the last added one
+  void
+  flapPrefix() {
+    if (not pendingRevert_.has_value()) {
+      pendingRevert_ = folly::Random::rand32(prefixDbs_.size());
+      auto& prefixDb = prefixDbs_.at(*pendingRevert_);
+      prefixDb.prefixEntries.emplace_back(createBenchPrefixEntry(
+          createBenchPrefix(*pendingRevert_, 0xffff /* index */)));
+      solver_->updatePrefixDatabase(prefixDb);
+    } else {
+      auto& prefixDb = prefixDbs_.at(*pendingRevert_);
+      prefixDb.prefixEntries.pop_back();
+      solver_->updatePrefixDatabase(prefixDb);
+      pendingRevert_ = std::nullopt;
+    }
+  }
+
+  std::unique_ptr<SpfSolver> solver_;
+  const bool useKsp2_{false};
+
+  std::vector<BenchLink> links_;
+  std::vector<thrift::AdjacencyDatabase> adjDbs_;
+  std::vector<thrift::PrefixDatabase> prefixDbs_;
+
+  // link or node index of the event to revert with the next event
+  std::optional<uint32_t> pendingRevert_;
+  thrift::AdjacencyDatabase savedAdjDb_;
+};
+
+int64_t
+getSumCounter(const std::string& key) {
+  return fb303::fbData->getCounters()[key + ".sum"];
+}
+
+//
+// Run given event iters times on a converged topology. Reports the per run
+// average of SpfSolver's own timing stats and of heap allocations, along
+// with peak RSS of the whole process.
+//
+static void
+runSpfSolverBenchmark(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    BenchTopology topology,
+    uint32_t numOfNodes,
+    uint32_t numOfPrefixesPerNode,
+    BenchEvent event,
+    bool computeLfaPaths = false,
+    bool useKsp2 = false) {
+  auto suspender = folly::BenchmarkSuspender();
+  // stats are exported as averages only, also track their sums
+  fb303::fbData->addStatExportType("decision.path_build_ms", fb303::SUM);
+  fb303::fbData->addStatExportType("decision.route_build_ms", fb303::SUM);
+
+  SpfSolverBench bench(
+      topology, numOfNodes, numOfPrefixesPerNode, computeLfaPaths, useKsp2);
+
+  const auto spfMs = getSumCounter("decision.path_build_ms");
+  const auto routeBuildMs = getSumCounter("decision.route_build_ms");
+  const auto allocs = getNumHeapAllocs();
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (uint32_t i = 0; i < iters; i++) {
+    bench.processEvent(event);
+  }
+
+  suspender.rehire(); // Stop measuring time again
+  const auto runs = iters == 0 ? 1 : iters;
+  counters["spf_ms"] =
+      (getSumCounter("decision.path_build_ms") - spfMs) / runs;
+  counters["route_build_ms"] =
+      (getSumCounter("decision.route_build_ms") - routeBuildMs) / runs;
+  counters["allocs"] = (getNumHeapAllocs() - allocs) / runs;
+
+  struct rusage usage;
+  CHECK_EQ(0, getrusage(RUSAGE_SELF, &usage));
+  counters["peak_rss_kb"] = usage.ru_maxrss;
+}
+
+//
+// Memory held by a LinkState of the given topology, along with the number of
+// allocations needed to build it. Adjacency databases to feed it are created
+// beforehand and not accounted for
+//
+static void
+BM_LinkStateMemory(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    BenchTopology topology,
+    uint32_t numOfNodes) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto links = topology == BenchTopology::WAN
+      ? createWanLinks(numOfNodes)
+      : createClosLinks(numOfNodes, numOfNodes);
+  std::vector<std::vector<thrift::Adjacency>> adjs(numOfNodes);
+  for (const auto& link : links) {
+    adjs[link.node].emplace_back(
+        createBenchAdjacency(link.node, link.otherNode, link.metric));
+    adjs[link.otherNode].emplace_back(
+        createBenchAdjacency(link.otherNode, link.node, link.metric));
+  }
+  std::vector<thrift::AdjacencyDatabase> adjDbs;
+  for (uint32_t node = 0; node < numOfNodes; ++node) {
+    adjDbs.emplace_back(createAdjDb(
+        folly::sformat("{}", node), adjs[node], node + 1 /* node label */));
+  }
+  adjs.clear();
+
+  int64_t bytes{0};
+  uint64_t allocs{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    const auto bytesBefore = getNumLiveHeapBytes();
+    const auto allocsBefore = getNumHeapAllocs();
+    suspender.dismiss();
+    auto linkState = std::make_unique<LinkState>();
+    for (const auto& adjDb : adjDbs) {
+      linkState->updateAdjacencyDatabase(adjDb, 0, 0);
+    }
+    // the graph used by SPF is part of the state
+    linkState->getCsrGraph();
+    suspender.rehire();
+    CHECK_EQ(links.size(), linkState->numLinks());
+    bytes = getNumLiveHeapBytes() - bytesBefore;
+    allocs = getNumHeapAllocs() - allocsBefore;
+  }
+  counters["links"] = links.size();
+  counters["bytes_per_link"] = bytes / std::max<size_t>(1, links.size());
+  counters["total_kb"] = bytes / 1024;
+  counters["allocs"] = allocs;
+}
+
+static void
+BM_SpfSolverLinkFlap(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    BenchTopology topology,
+    uint32_t numOfNodes,
+    uint32_t numOfPrefixesPerNode) {
+  runSpfSolverBenchmark(
+      counters,
+      iters,
+      topology,
+      numOfNodes,
+      numOfPrefixesPerNode,
+      BenchEvent::LINK_FLAP);
+}
+
+static void
+BM_SpfSolverMetricChange(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    BenchTopology topology,
+    uint32_t numOfNodes,
+    uint32_t numOfPrefixesPerNode) {
+  runSpfSolverBenchmark(
+      counters,
+      iters,
+      topology,
+      numOfNodes,
+      numOfPrefixesPerNode,
+      BenchEvent::METRIC_CHANGE);
+}
+
+static void
+BM_SpfSolverNodeOverload(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    BenchTopology topology,
+    uint32_t numOfNodes,
+    uint32_t numOfPrefixesPerNode) {
+  runSpfSolverBenchmark(
+      counters,
+      iters,
+      topology,
+      numOfNodes,
+      numOfPrefixesPerNode,
+      BenchEvent::NODE_OVERLOAD);
+}
+
+static void
+BM_SpfSolverPrefixFlap(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    BenchTopology topology,
+    uint32_t numOfNodes,
+    uint32_t numOfPrefixesPerNode) {
+  runSpfSolverBenchmark(
+      counters,
+      iters,
+      topology,
+      numOfNodes,
+      numOfPrefixesPerNode,
+      BenchEvent::PREFIX_FLAP);
+}
+
+static void
+BM_SpfSolverLfaLinkFlap(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    BenchTopology topology,
+    uint32_t numOfNodes,
+    uint32_t numOfPrefixesPerNode) {
+  runSpfSolverBenchmark(
+      counters,
+      iters,
+      topology,
+      numOfNodes,
+      numOfPrefixesPerNode,
+      BenchEvent::LINK_FLAP,
+      true /* computeLfaPaths */);
+}
+
+static void
+BM_SpfSolverKsp2LinkFlap(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    BenchTopology topology,
+    uint32_t numOfNodes,
+    uint32_t numOfPrefixesPerNode) {
+  runSpfSolverBenchmark(
+      counters,
+      iters,
+      topology,
+      numOfNodes,
+      numOfPrefixesPerNode,
+      BenchEvent::LINK_FLAP,
+      false /* computeLfaPaths */,
+      true /* useKsp2 */);
+}
+
+//
+// Dijkstra over a WAN topology with the given priority queue, to compare
+// queue implementations available to SPF routines
+//
+template <typename Queue>
+void
+runDijkstraBenchmark(uint32_t iters, uint32_t numOfNodes) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<std::vector<std::pair<uint32_t, uint64_t>>> graph(numOfNodes);
+  for (const auto& link : createWanLinks(numOfNodes)) {
+    graph[link.node].emplace_back(link.otherNode, link.metric);
+    graph[link.otherNode].emplace_back(link.node, link.metric);
+  }
+  std::vector<uint64_t> distances;
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (uint32_t i = 0; i < iters; i++) {
+    distances.assign(numOfNodes, std::numeric_limits<uint64_t>::max());
+    Queue q;
+    distances[0] = 0;
+    q.push(0, 0);
+    while (not q.empty()) {
+      const auto [metric, node] = q.top();
+      q.pop();
+      if (metric != distances[node]) {
+        continue;
+      }
+      for (const auto& [otherNode, linkMetric] : graph[node]) {
+        if (metric + linkMetric < distances[otherNode]) {
+          distances[otherNode] = metric + linkMetric;
+          q.push(distances[otherNode], otherNode);
+        }
+      }
+    }
+    folly::doNotOptimizeAway(distances);
+  }
+}
+
+static void
+BM_DijkstraBinaryHeap(uint32_t iters, uint32_t numOfNodes) {
+  runDijkstraBenchmark<BinaryHeapQueue<uint64_t, uint32_t>>(iters, numOfNodes);
+}
+
+static void
+BM_DijkstraRadixHeap(uint32_t iters, uint32_t numOfNodes) {
+  runDijkstraBenchmark<RadixHeapQueue<uint64_t, uint32_t>>(iters, numOfNodes);
+}
+
 // The integer parameter is the number of nodes in grid topology
 BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 10);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 100);
@@ -803,6 +1288,66 @@ BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 344);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 1000);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 5000);
 
+// The integer parameter is the number of nodes in WAN topology. Radix heap is
+// the queue used by Decision, binary heap is kept as baseline
+BENCHMARK_PARAM(BM_DijkstraBinaryHeap, 1000);
+BENCHMARK_RELATIVE_PARAM(BM_DijkstraRadixHeap, 1000);
+BENCHMARK_PARAM(BM_DijkstraBinaryHeap, 20000);
+BENCHMARK_RELATIVE_PARAM(BM_DijkstraRadixHeap, 20000);
+
+// Parameters are the topology, number of nodes and prefixes per node. Clos
+// topologies are sized to the nearest number of complete pods.
+#define BENCHMARK_SPF_SOLVER(name)                                         \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                           \
+      name, counters, WAN_1000x100, BenchTopology::WAN, 1000, 100);        \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                           \
+      name, counters, WAN_10000x100, BenchTopology::WAN, 10000, 100);      \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                           \
+      name, counters, CLOS_5000x20, BenchTopology::CLOS, 5000, 20);        \
+  BENCHMARK_COUNTERS_NAME_PARAM(                                           \
+      name, counters, CLOS_20000x50, BenchTopology::CLOS, 20000, 50)
+
+// Parameters are the topology and number of nodes
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_LinkStateMemory, counters, WAN_20000, BenchTopology::WAN, 20000);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_LinkStateMemory, counters, CLOS_20000, BenchTopology::CLOS, 20000);
+
+BENCHMARK_SPF_SOLVER(BM_SpfSolverLinkFlap);
+BENCHMARK_SPF_SOLVER(BM_SpfSolverMetricChange);
+BENCHMARK_SPF_SOLVER(BM_SpfSolverNodeOverload);
+BENCHMARK_SPF_SOLVER(BM_SpfSolverPrefixFlap);
+
+// LFA and KSP2 cost grows with the number of neighbors and destinations
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverLfaLinkFlap,
+    counters,
+    WAN_1000x100,
+    BenchTopology::WAN,
+    1000,
+    100);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverLfaLinkFlap,
+    counters,
+    CLOS_5000x20,
+    BenchTopology::CLOS,
+    5000,
+    20);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverKsp2LinkFlap,
+    counters,
+    WAN_1000x10,
+    BenchTopology::WAN,
+    1000,
+    10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverKsp2LinkFlap,
+    counters,
+    CLOS_5000x2,
+    BenchTopology::CLOS,
+    5000,
+    2);
+
 } // namespace openr
 
 int
@@ -412,6 +412,679 @@ TEST(SpfSolver, Counters) {
       fb303::fbData->getCounters().at("decision.num_partial_adjacencies"), 0);
 }
 
+//
+// Verify that single link changes are applied with incremental SPF and that
+// the resulting routes match the ones computed from scratch
+//
+TEST(SpfSolver, IncrementalSpf) {
+  fb303::fbData->resetAllData();
+
+  // Square topology 1 - 2 - 4 - 3 - 1. With LFA enabled, SPF is computed from
+  // node 1 as well as from its neighbors 2 and 3
+  std::vector<thrift::AdjacencyDatabase> adjDbs = {
+      createAdjDb("1", {adj12, adj13}, 1),
+      createAdjDb("2", {adj21, adj24}, 2),
+      createAdjDb("3", {adj31, adj34}, 3),
+      createAdjDb("4", {adj42, adj43}, 4)};
+  auto createSpfSolver = [&adjDbs]() {
+    auto spfSolver = std::make_unique<SpfSolver>(
+        "1" /* nodeName */,
+        false /* enableV4 */,
+        true /* computeLfaPaths */);
+    for (auto const& adjDb : adjDbs) {
+      spfSolver->updateAdjacencyDatabase(adjDb);
+    }
+    for (auto const& prefixDb : {prefixDb1, prefixDb2, prefixDb3, prefixDb4}) {
+      spfSolver->updatePrefixDatabase(prefixDb);
+    }
+    return spfSolver;
+  };
+
+  auto spfSolver = createSpfSolver();
+  auto routeMap = getRouteMap(*spfSolver, {"1"});
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(3, counters["decision.full_spf_runs.count"]);
+  EXPECT_EQ(0, counters["decision.ispf_runs.count"]);
+
+  // metric change on link 1 -> 2
+  adjDbs[0] = createAdjDb(
+      "1",
+      {createAdjacency(
+           "2", "1/2", "2/1", "fe80::2", "192.168.0.2", 30, 100002),
+       adj13},
+      1);
+  spfSolver->updateAdjacencyDatabase(adjDbs[0]);
+  routeMap = getRouteMap(*spfSolver, {"1"});
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(3, counters["decision.full_spf_runs.count"]);
+  EXPECT_EQ(3, counters["decision.ispf_runs.count"]);
+  EXPECT_EQ(routeMap, getRouteMap(*createSpfSolver(), {"1"}));
+
+  // link 2 - 4 goes down
+  adjDbs[1] = createAdjDb("2", {adj21}, 2);
+  spfSolver->updateAdjacencyDatabase(adjDbs[1]);
+  routeMap = getRouteMap(*spfSolver, {"1"});
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(6, counters["decision.full_spf_runs.count"]);
+  EXPECT_EQ(6, counters["decision.ispf_runs.count"]);
+  EXPECT_EQ(routeMap, getRouteMap(*createSpfSolver(), {"1"}));
+
+  // link 2 - 4 comes back up
+  adjDbs[1] = createAdjDb("2", {adj21, adj24}, 2);
+  spfSolver->updateAdjacencyDatabase(adjDbs[1]);
+  routeMap = getRouteMap(*spfSolver, {"1"});
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(9, counters["decision.full_spf_runs.count"]);
+  EXPECT_EQ(9, counters["decision.ispf_runs.count"]);
+  EXPECT_EQ(routeMap, getRouteMap(*createSpfSolver(), {"1"}));
+
+  // multiple links change at once, fall back to full SPF
+  adjDbs[3] = createAdjDb(
+      "4",
+      {createAdjacency(
+           "2", "4/2", "2/4", "fe80::2", "192.168.0.2", 20, 100002),
+       createAdjacency(
+           "3", "4/3", "3/4", "fe80::3", "192.168.0.3", 20, 100003)},
+      4);
+  spfSolver->updateAdjacencyDatabase(adjDbs[3]);
+  routeMap = getRouteMap(*spfSolver, {"1"});
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(15, counters["decision.full_spf_runs.count"]);
+  EXPECT_EQ(9, counters["decision.ispf_runs.count"]);
+  EXPECT_EQ(routeMap, getRouteMap(*createSpfSolver(), {"1"}));
+}
+
+//
+// Verify remote LFA next hops on ring 1 - 2 - 3 - 4 - 5 - 6 - 1. Node 3 is
+// reached over 2 only and 6 is no LFA for it, but node 5 is reached from 6
+// and reaches 3 without going through 1
+//
+TEST(SpfSolver, RemoteLfa) {
+  fb303::fbData->resetAllData();
+
+  auto ringAdj = [](int node, int otherNode) {
+    return createAdjacency(
+        std::to_string(otherNode),
+        folly::sformat("{}/{}", node, otherNode),
+        folly::sformat("{}/{}", otherNode, node),
+        folly::sformat("fe80::{}", otherNode),
+        folly::sformat("192.168.0.{}", otherNode),
+        10,
+        100000 + otherNode);
+  };
+  auto createSpfSolver = [&ringAdj](size_t remoteLfaSpfRuns) {
+    auto spfSolver = std::make_unique<SpfSolver>(
+        "1" /* nodeName */,
+        false /* enableV4 */,
+        true /* computeLfaPaths */,
+        false /* enableOrderedFib */,
+        false /* bgpDryRun */,
+        false /* bgpUseIgpMetric */,
+        nullptr /* spfExecutor */,
+        remoteLfaSpfRuns);
+    for (int node = 1; node <= 6; ++node) {
+      spfSolver->updateAdjacencyDatabase(createAdjDb(
+          std::to_string(node),
+          {ringAdj(node, node % 6 + 1), ringAdj(node, (node + 4) % 6 + 1)},
+          node));
+    }
+    spfSolver->updatePrefixDatabase(prefixDb3);
+    return spfSolver;
+  };
+  const std::pair<std::string, std::string> routeKey{"1", toString(addr3)};
+  const auto primaryNextHop = createNextHopFromAdj(ringAdj(1, 2), false, 20);
+
+  // disabled, shortest next hop only
+  auto routeMap = getRouteMap(*createSpfSolver(0), {"1"});
+  EXPECT_EQ(NextHops({primaryNextHop}), routeMap.at(routeKey));
+
+  // tunnel to 5 over 6 as backup
+  routeMap = getRouteMap(*createSpfSolver(16), {"1"});
+  EXPECT_EQ(
+      NextHops(
+          {primaryNextHop,
+           createNextHopFromAdj(
+               ringAdj(1, 6),
+               false,
+               40,
+               createMplsAction(
+                   thrift::MplsActionCode::PUSH,
+                   std::nullopt,
+                   std::vector<int32_t>{5}))}),
+      routeMap.at(routeKey));
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(1, counters["decision.remote_lfa_routes.count"]);
+  // from 5 and 4, the rest can't beat 5
+  EXPECT_EQ(2, counters["decision.remote_lfa_spf_runs.count"]);
+
+  // Fib programs the shortest next hop only
+  EXPECT_EQ(
+      std::vector<thrift::NextHopThrift>({primaryNextHop}),
+      getBestNextHopsUnicast(std::vector<thrift::NextHopThrift>(
+          routeMap.at(routeKey).begin(), routeMap.at(routeKey).end())));
+}
+
+//
+// Verify that route builds only report routes of affected prefixes and that
+// the resulting routes match the ones computed from scratch
+//
+TEST(SpfSolver, IncrementalRouteBuild) {
+  // Square topology 1 - 2 - 4 - 3 - 1
+  std::vector<thrift::AdjacencyDatabase> adjDbs = {
+      createAdjDb("1", {adj12, adj13}, 1),
+      createAdjDb("2", {adj21, adj24}, 2),
+      createAdjDb("3", {adj31, adj34}, 3),
+      createAdjDb("4", {adj42, adj43}, 4)};
+  std::vector<thrift::PrefixDatabase> prefixDbs = {
+      prefixDb1, prefixDb2, prefixDb3, prefixDb4};
+  auto createSpfSolver = [&adjDbs, &prefixDbs]() {
+    auto spfSolver = std::make_unique<SpfSolver>(
+        "1" /* nodeName */,
+        false /* enableV4 */,
+        false /* computeLfaPaths */);
+    for (auto const& adjDb : adjDbs) {
+      spfSolver->updateAdjacencyDatabase(adjDb);
+    }
+    for (auto const& prefixDb : prefixDbs) {
+      spfSolver->updatePrefixDatabase(prefixDb);
+    }
+    return spfSolver;
+  };
+
+  auto spfSolver = createSpfSolver();
+  auto routeMap = getRouteMap(*spfSolver, {"1"});
+  auto delta = spfSolver->getUnicastRoutesDelta();
+  EXPECT_EQ(3, delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, delta.unicastRoutesToDelete.size());
+
+  // nothing changed, nothing to report
+  spfSolver->buildRouteDb("1");
+  delta = spfSolver->getUnicastRoutesDelta();
+  EXPECT_EQ(0, delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, delta.unicastRoutesToDelete.size());
+
+  // node 4 announces an additional prefix
+  prefixDbs[3] = createPrefixDb(
+      "4", {createPrefixEntry(addr4), createPrefixEntry(addr5)});
+  spfSolver->updatePrefixDatabase(prefixDbs[3]);
+  auto routeDb = spfSolver->buildRouteDb("1");
+  ASSERT_TRUE(routeDb.has_value());
+  EXPECT_EQ(4, routeDb->unicastRoutes.size());
+  delta = spfSolver->getUnicastRoutesDelta();
+  ASSERT_EQ(1, delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr5, delta.unicastRoutesToUpdate.at(0).dest);
+  EXPECT_EQ(0, delta.unicastRoutesToDelete.size());
+  EXPECT_EQ(
+      getRouteMap(*spfSolver, {"1"}), getRouteMap(*createSpfSolver(), {"1"}));
+  spfSolver->getUnicastRoutesDelta();
+
+  // node 3 withdraws its prefix
+  prefixDbs[2] = createPrefixDb("3", {});
+  spfSolver->updatePrefixDatabase(prefixDbs[2]);
+  spfSolver->buildRouteDb("1");
+  delta = spfSolver->getUnicastRoutesDelta();
+  EXPECT_EQ(0, delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(std::vector<thrift::IpPrefix>{addr3}, delta.unicastRoutesToDelete);
+
+  // link 2 - 4 goes down, only routes towards node 4 change
+  adjDbs[1] = createAdjDb("2", {adj21}, 2);
+  spfSolver->updateAdjacencyDatabase(adjDbs[1]);
+  spfSolver->buildPaths("1");
+  delta = spfSolver->getUnicastRoutesDelta();
+  EXPECT_EQ(2, delta.unicastRoutesToUpdate.size());
+  for (auto const& route : delta.unicastRoutesToUpdate) {
+    EXPECT_TRUE(route.dest == addr4 or route.dest == addr5);
+  }
+  EXPECT_EQ(0, delta.unicastRoutesToDelete.size());
+  EXPECT_EQ(
+      getRouteMap(*spfSolver, {"1"}), getRouteMap(*createSpfSolver(), {"1"}));
+
+  // node 3 changes its node label, only its label route changes
+  adjDbs[2] = createAdjDb("3", {adj31, adj34}, 33);
+  spfSolver->updateAdjacencyDatabase(adjDbs[2]);
+  routeDb = spfSolver->buildRouteDb("1");
+  ASSERT_TRUE(routeDb.has_value());
+  std::set<int32_t> labels;
+  for (auto const& route : routeDb->mplsRoutes) {
+    labels.emplace(route.topLabel);
+  }
+  EXPECT_EQ(1, labels.count(33));
+  EXPECT_EQ(0, labels.count(3));
+  delta = spfSolver->getUnicastRoutesDelta();
+  EXPECT_EQ(0, delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(
+      getRouteMap(*spfSolver, {"1"}), getRouteMap(*createSpfSolver(), {"1"}));
+}
+
+//
+// Verify that route builds can be computed in slices, and that changes of
+// their inputs abandon them
+//
+TEST(SpfSolver, SlicedRouteBuild) {
+  std::vector<thrift::AdjacencyDatabase> adjDbs = {
+      createAdjDb("1", {adj12, adj13}, 1),
+      createAdjDb("2", {adj21, adj24}, 2),
+      createAdjDb("3", {adj31, adj34}, 3),
+      createAdjDb("4", {adj42, adj43}, 4)};
+  std::vector<thrift::PrefixDatabase> prefixDbs = {
+      prefixDb1, prefixDb2, prefixDb3, prefixDb4};
+  auto createSpfSolver = [&adjDbs, &prefixDbs]() {
+    auto spfSolver = std::make_unique<SpfSolver>(
+        "1" /* nodeName */,
+        false /* enableV4 */,
+        false /* computeLfaPaths */);
+    for (auto const& adjDb : adjDbs) {
+      spfSolver->updateAdjacencyDatabase(adjDb);
+    }
+    for (auto const& prefixDb : prefixDbs) {
+      spfSolver->updatePrefixDatabase(prefixDb);
+    }
+    return spfSolver;
+  };
+  const std::chrono::milliseconds noBudget{0};
+
+  // unknown node, nothing to build
+  EXPECT_FALSE(SpfSolver("5", false, false).startRouteBuild(true));
+
+  // every slice builds at least one prefix
+  auto spfSolver = createSpfSolver();
+  ASSERT_TRUE(spfSolver->startRouteBuild(true));
+  EXPECT_FALSE(spfSolver->continueRouteBuild(noBudget).has_value());
+  EXPECT_TRUE(spfSolver->hasRouteBuild());
+
+  // node 4 announces an additional prefix, the build is outdated
+  prefixDbs[3] = createPrefixDb(
+      "4", {createPrefixEntry(addr4), createPrefixEntry(addr5)});
+  spfSolver->updatePrefixDatabase(prefixDbs[3]);
+  EXPECT_FALSE(spfSolver->hasRouteBuild());
+
+  // a restarted build completes with the same routes as a full build
+  ASSERT_TRUE(spfSolver->startRouteBuild(false));
+  std::optional<thrift::RouteDatabase> routeDb;
+  size_t numSlices = 0;
+  while (not routeDb.has_value()) {
+    ASSERT_TRUE(spfSolver->hasRouteBuild());
+    routeDb = spfSolver->continueRouteBuild(noBudget);
+    ++numSlices;
+  }
+  EXPECT_LT(1, numSlices);
+  EXPECT_FALSE(spfSolver->hasRouteBuild());
+  EXPECT_EQ(4, routeDb->unicastRoutes.size());
+  auto delta = spfSolver->getUnicastRoutesDelta();
+  EXPECT_EQ(4, delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(
+      getRouteMap(*spfSolver, {"1"}), getRouteMap(*createSpfSolver(), {"1"}));
+
+  // a full build abandons the build in progress
+  adjDbs[1] = createAdjDb("2", {adj21}, 2);
+  spfSolver->updateAdjacencyDatabase(adjDbs[1]);
+  ASSERT_TRUE(spfSolver->startRouteBuild(true));
+  EXPECT_TRUE(spfSolver->hasRouteBuild());
+  ASSERT_TRUE(spfSolver->buildPaths("1").has_value());
+  EXPECT_FALSE(spfSolver->hasRouteBuild());
+  EXPECT_EQ(
+      getRouteMap(*spfSolver, {"1"}), getRouteMap(*createSpfSolver(), {"1"}));
+}
+
+//
+// Verify that SPF of route builds runs on the SPF pool, and that changes of
+// inputs wait for it
+//
+TEST(SpfSolver, RouteBuildSpfOnPool) {
+  std::vector<thrift::AdjacencyDatabase> adjDbs = {
+      createAdjDb("1", {adj12, adj13}, 1),
+      createAdjDb("2", {adj21, adj24}, 2),
+      createAdjDb("3", {adj31, adj34}, 3),
+      createAdjDb("4", {adj42, adj43}, 4)};
+  std::vector<thrift::PrefixDatabase> prefixDbs = {
+      prefixDb1, prefixDb2, prefixDb3, prefixDb4};
+  auto spfExecutor = std::make_shared<folly::CPUThreadPoolExecutor>(2);
+  auto createSpfSolver = [&adjDbs, &prefixDbs](auto spfExecutor) {
+    auto spfSolver = std::make_unique<SpfSolver>(
+        "1" /* nodeName */,
+        false /* enableV4 */,
+        true /* computeLfaPaths */,
+        false /* enableOrderedFib */,
+        false /* bgpDryRun */,
+        false /* bgpUseIgpMetric */,
+        std::move(spfExecutor));
+    for (auto const& adjDb : adjDbs) {
+      spfSolver->updateAdjacencyDatabase(adjDb);
+    }
+    for (auto const& prefixDb : prefixDbs) {
+      spfSolver->updatePrefixDatabase(prefixDb);
+    }
+    return spfSolver;
+  };
+  auto buildRoutes = [](SpfSolver& spfSolver) {
+    std::optional<thrift::RouteDatabase> routeDb;
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (not routeDb.has_value() and spfSolver.hasRouteBuild() and
+           std::chrono::steady_clock::now() < deadline) {
+      routeDb = spfSolver.continueRouteBuild(std::chrono::milliseconds(1));
+    }
+    return routeDb;
+  };
+
+  // routes are the same as of SPF on the calling thread
+  auto spfSolver = createSpfSolver(spfExecutor);
+  ASSERT_TRUE(spfSolver->startRouteBuild(true));
+  auto routeDb = buildRoutes(*spfSolver);
+  ASSERT_TRUE(routeDb.has_value());
+  EXPECT_FALSE(spfSolver->hasSpfRunsInProgress());
+  EXPECT_EQ(4, routeDb->unicastRoutes.size());
+  EXPECT_EQ(
+      getRouteMap(*spfSolver, {"1"}),
+      getRouteMap(*createSpfSolver(nullptr), {"1"}));
+
+  // link 2 - 4 goes down while SPF may still be running, the update waits
+  // for it and abandons the build
+  ASSERT_TRUE(spfSolver->startRouteBuild(true));
+  adjDbs[1] = createAdjDb("2", {adj21}, 2);
+  spfSolver->updateAdjacencyDatabase(adjDbs[1]);
+  EXPECT_FALSE(spfSolver->hasSpfRunsInProgress());
+  EXPECT_FALSE(spfSolver->hasRouteBuild());
+  ASSERT_TRUE(spfSolver->startRouteBuild(true));
+  ASSERT_TRUE(buildRoutes(*spfSolver).has_value());
+  EXPECT_EQ(
+      getRouteMap(*spfSolver, {"1"}),
+      getRouteMap(*createSpfSolver(nullptr), {"1"}));
+
+  // solvers get destroyed with SPF in flight
+  ASSERT_TRUE(spfSolver->startRouteBuild(true));
+  spfSolver.reset();
+}
+
+//
+// Verify that KSP2_ED_ECMP paths are reused across route builds as long as
+// the topology does not change them
+//
+TEST(SpfSolver, Ksp2PathCache) {
+  fb303::fbData->resetAllData();
+
+  // Square topology 1 - 2 - 4 - 3 - 1
+  std::vector<thrift::AdjacencyDatabase> adjDbs = {
+      createAdjDb("1", {adj12, adj13}, 1),
+      createAdjDb("2", {adj21, adj24}, 2),
+      createAdjDb("3", {adj31, adj34}, 3),
+      createAdjDb("4", {adj42, adj43}, 4)};
+  std::vector<thrift::PrefixDatabase> prefixDbs = {
+      getPrefixDbWithKspfAlgo(prefixDb1),
+      getPrefixDbWithKspfAlgo(prefixDb2),
+      getPrefixDbWithKspfAlgo(prefixDb3),
+      getPrefixDbWithKspfAlgo(prefixDb4)};
+  auto createSpfSolver = [&adjDbs, &prefixDbs]() {
+    auto spfSolver = std::make_unique<SpfSolver>(
+        "1" /* nodeName */,
+        false /* enableV4 */,
+        false /* computeLfaPaths */);
+    for (auto const& adjDb : adjDbs) {
+      spfSolver->updateAdjacencyDatabase(adjDb);
+    }
+    for (auto const& prefixDb : prefixDbs) {
+      spfSolver->updatePrefixDatabase(prefixDb);
+    }
+    return spfSolver;
+  };
+
+  auto getCounter = [](const std::string& name) {
+    return fb303::fbData->getCounters()[name];
+  };
+
+  auto spfSolver = createSpfSolver();
+  getRouteMap(*spfSolver, {"1"});
+  EXPECT_EQ(3, getCounter("decision.ksp2_cache_misses.count"));
+  EXPECT_EQ(0, getCounter("decision.ksp2_cache_hits.count"));
+
+  // prefix only update, paths towards node 4 are reused
+  auto prefixEntry5 = createPrefixEntry(addr5, thrift::PrefixType::BREEZE);
+  prefixDbs[3].prefixEntries.emplace_back(
+      getPrefixDbWithKspfAlgo(createPrefixDb("4", {prefixEntry5}))
+          .prefixEntries.at(0));
+  spfSolver->updatePrefixDatabase(prefixDbs[3]);
+  auto routeMap = getRouteMap(*spfSolver, {"1"});
+  EXPECT_EQ(3, getCounter("decision.ksp2_cache_misses.count"));
+  EXPECT_EQ(1, getCounter("decision.ksp2_cache_hits.count"));
+  EXPECT_EQ(routeMap, getRouteMap(*createSpfSolver(), {"1"}));
+
+  // metric increase on link 2 - 4 invalidates paths over it, which are all
+  // of them in this topology
+  auto misses = getCounter("decision.ksp2_cache_misses.count");
+  adjDbs[1] = createAdjDb(
+      "2",
+      {adj21,
+       createAdjacency(
+           "4", "2/4", "4/2", "fe80::4", "192.168.0.4", 30, 100004)},
+      2);
+  spfSolver->updateAdjacencyDatabase(adjDbs[1]);
+  routeMap = getRouteMap(*spfSolver, {"1"});
+  EXPECT_EQ(misses + 3, getCounter("decision.ksp2_cache_misses.count"));
+  EXPECT_EQ(routeMap, getRouteMap(*createSpfSolver(), {"1"}));
+
+  // overloading an unrelated node drops all paths
+  misses = getCounter("decision.ksp2_cache_misses.count");
+  adjDbs.emplace_back(createAdjDb("5", {}, 5));
+  spfSolver->updateAdjacencyDatabase(adjDbs.back());
+  adjDbs.back().isOverloaded = true;
+  spfSolver->updateAdjacencyDatabase(adjDbs.back());
+  routeMap = getRouteMap(*spfSolver, {"1"});
+  EXPECT_EQ(misses + 3, getCounter("decision.ksp2_cache_misses.count"));
+  EXPECT_EQ(routeMap, getRouteMap(*createSpfSolver(), {"1"}));
+
+  // metric decrease drops all paths
+  misses = getCounter("decision.ksp2_cache_misses.count");
+  adjDbs[1] = createAdjDb("2", {adj21, adj24}, 2);
+  spfSolver->updateAdjacencyDatabase(adjDbs[1]);
+  routeMap = getRouteMap(*spfSolver, {"1"});
+  EXPECT_EQ(misses + 3, getCounter("decision.ksp2_cache_misses.count"));
+  EXPECT_EQ(routeMap, getRouteMap(*createSpfSolver(), {"1"}));
+}
+
+TEST(SpfSolver, RouteDbFromSnapshot) {
+  fb303::fbData->resetAllData();
+
+  // Square topology 1 - 2 - 4 - 3 - 1
+  std::vector<thrift::AdjacencyDatabase> adjDbs = {
+      createAdjDb("1", {adj12, adj13}, 1),
+      createAdjDb("2", {adj21, adj24}, 2),
+      createAdjDb("3", {adj31, adj34}, 3),
+      createAdjDb("4", {adj42, adj43}, 4)};
+  std::vector<thrift::PrefixDatabase> prefixDbs = {
+      prefixDb1, prefixDb2, prefixDb3, prefixDb4};
+  auto createSpfSolver = [&adjDbs, &prefixDbs]() {
+    auto spfSolver = std::make_unique<SpfSolver>(
+        "1" /* nodeName */,
+        false /* enableV4 */,
+        true /* computeLfaPaths */);
+    for (auto const& adjDb : adjDbs) {
+      spfSolver->updateAdjacencyDatabase(adjDb);
+    }
+    for (auto const& prefixDb : prefixDbs) {
+      spfSolver->updatePrefixDatabase(prefixDb);
+    }
+    return spfSolver;
+  };
+  auto getCounter = [](std::string const& key) {
+    return fb303::fbData->getCounters()[key];
+  };
+  auto getSnapshotRouteMap = [](SpfSolver& spfSolver, string const& node) {
+    RouteMap routeMap;
+    auto routeDb =
+        spfSolver.buildRouteDbFromSnapshot(spfSolver.getSnapshot(), node);
+    EXPECT_TRUE(routeDb.has_value());
+    if (routeDb.has_value()) {
+      fillRouteMap(node, routeMap, routeDb.value());
+    }
+    return routeMap;
+  };
+
+  auto spfSolver = createSpfSolver();
+  getRouteMap(*spfSolver, {"1"});
+  auto const ownRoutes = spfSolver->getUnicastRoutesDelta();
+
+  // SPF results from 1 and 2 are shared by our own route build, 4 is computed
+  EXPECT_EQ(
+      getSnapshotRouteMap(*spfSolver, "2"),
+      getRouteMap(*createSpfSolver(), {"2"}));
+  EXPECT_EQ(2, getCounter("decision.spf_result_cache_hits.count"));
+  EXPECT_EQ(1, getCounter("decision.spf_result_cache_misses.count"));
+
+  // all results are cached now
+  getSnapshotRouteMap(*spfSolver, "2");
+  EXPECT_EQ(5, getCounter("decision.spf_result_cache_hits.count"));
+  EXPECT_EQ(1, getCounter("decision.spf_result_cache_misses.count"));
+
+  // unknown node
+  EXPECT_FALSE(
+      spfSolver->buildRouteDbFromSnapshot(spfSolver->getSnapshot(), "5")
+          .has_value());
+
+  // our own routes are left alone
+  auto delta = spfSolver->getUnicastRoutesDelta();
+  EXPECT_EQ(0, delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, delta.unicastRoutesToDelete.size());
+  EXPECT_EQ(3, ownRoutes.unicastRoutesToUpdate.size());
+
+  // link 2 - 4 goes down, cached results are of an older generation
+  adjDbs[1] = createAdjDb("2", {adj21}, 2);
+  spfSolver->updateAdjacencyDatabase(adjDbs[1]);
+  EXPECT_EQ(
+      getSnapshotRouteMap(*spfSolver, "2"),
+      getRouteMap(*createSpfSolver(), {"2"}));
+  EXPECT_EQ(5, getCounter("decision.spf_result_cache_hits.count"));
+  EXPECT_EQ(3, getCounter("decision.spf_result_cache_misses.count"));
+
+  // with ordered FIB, node 2 getting overloaded is held by our own route
+  // build while snapshots are hold-free. Results under holds aren't shared
+  adjDbs[1] = createAdjDb("2", {adj21, adj24}, 2);
+  auto orderedSolver = std::make_unique<SpfSolver>(
+      "1" /* nodeName */,
+      false /* enableV4 */,
+      true /* computeLfaPaths */,
+      true /* enableOrderedFib */);
+  for (auto const& adjDb : adjDbs) {
+    orderedSolver->updateAdjacencyDatabase(adjDb);
+  }
+  for (auto const& prefixDb : prefixDbs) {
+    orderedSolver->updatePrefixDatabase(prefixDb);
+  }
+  EXPECT_FALSE(orderedSolver->hasHolds());
+  adjDbs[1] = createAdjDb("2", {adj21, adj24}, 2, true /* overloaded */);
+  orderedSolver->updateAdjacencyDatabase(adjDbs[1]);
+  EXPECT_TRUE(orderedSolver->hasHolds());
+  auto const heldRouteMap = getRouteMap(*orderedSolver, {"1"});
+  auto const routeMap = getRouteMap(*createSpfSolver(), {"1"});
+  EXPECT_NE(heldRouteMap, routeMap);
+  EXPECT_EQ(getSnapshotRouteMap(*orderedSolver, "1"), routeMap);
+  EXPECT_EQ(5, getCounter("decision.spf_result_cache_hits.count"));
+}
+
+//
+// Hop counts of ordered FIB holds are cached across metric changes, and
+// computed again once links came up or went away, or once the changes since
+// can't be told anymore
+//
+TEST(SpfSolver, HopCountCache) {
+  fb303::fbData->resetAllData();
+  auto getSpfRuns = []() {
+    return fb303::fbData->getCounters()["decision.spf_runs.count"];
+  };
+
+  // Square topology 1 - 2 - 4 - 3 - 1
+  std::vector<thrift::AdjacencyDatabase> adjDbs = {
+      createAdjDb("1", {adj12, adj13}, 1),
+      createAdjDb("2", {adj21, adj24}, 2),
+      createAdjDb("3", {adj31, adj34}, 3),
+      createAdjDb("4", {adj42, adj43}, 4)};
+  auto& adjDb1 = adjDbs[0];
+  auto& adjDb2 = adjDbs[1];
+  auto& adjDb3 = adjDbs[2];
+  SpfSolver spfSolver(
+      "1" /* nodeName */,
+      false /* enableV4 */,
+      false /* computeLfaPaths */,
+      true /* enableOrderedFib */);
+  // steps until all holds are gone, i.e. the longest hold TTL
+  auto getHoldSteps = [&spfSolver]() {
+    size_t steps = 0;
+    while (spfSolver.hasHolds() and steps < 100) {
+      spfSolver.decrementHolds();
+      ++steps;
+    }
+    return steps;
+  };
+  for (auto const& adjDb : adjDbs) {
+    spfSolver.updateAdjacencyDatabase(adjDb);
+  }
+  getHoldSteps();
+
+  //
+  // metric changes, lowering metrics is held for our hops to node 3. Hop
+  // counts of the first one are used for the second
+  //
+  adjDb3.adjacencies[1].metric = 5;
+  spfSolver.updateAdjacencyDatabase(adjDb3);
+  auto spfRuns = getSpfRuns();
+  adjDb3.adjacencies[0].metric = 5;
+  spfSolver.updateAdjacencyDatabase(adjDb3);
+  EXPECT_EQ(spfRuns, getSpfRuns());
+  EXPECT_EQ(1, getHoldSteps());
+
+  //
+  // link 1 - 3 goes down, node 3 is 3 hops away now. Hop counts from us and
+  // from node 3 are computed again
+  //
+  spfSolver.updateAdjacencyDatabase(adjDb3);
+  adjDb1.adjacencies = {adj12};
+  spfSolver.updateAdjacencyDatabase(adjDb1);
+  spfRuns = getSpfRuns();
+  adjDb3.adjacencies[1].metric = 4;
+  spfSolver.updateAdjacencyDatabase(adjDb3);
+  EXPECT_EQ(spfRuns + 2, getSpfRuns());
+  EXPECT_EQ(3, getHoldSteps());
+
+  //
+  // link 1 - 3 comes back up, as it's our own it isn't held
+  //
+  spfSolver.updateAdjacencyDatabase(adjDb3);
+  adjDb1.adjacencies = {adj12, adj13};
+  spfSolver.updateAdjacencyDatabase(adjDb1);
+  spfRuns = getSpfRuns();
+  adjDb3.adjacencies[1].metric = 3;
+  spfSolver.updateAdjacencyDatabase(adjDb3);
+  EXPECT_EQ(spfRuns + 2, getSpfRuns());
+  EXPECT_EQ(1, getHoldSteps());
+
+  //
+  // metric changes in batches, hop counts are computed once before each.
+  // Changes fit into the change log at first. Unchanged databases of node 3
+  // have hop counts from it computed ahead of the changes
+  //
+  auto flapMetric = [&adjDb2](int32_t first, int32_t last) {
+    std::vector<thrift::AdjacencyDatabase> batch;
+    for (int32_t metric = first; metric <= last; ++metric) {
+      adjDb2.adjacencies[1].metric = metric;
+      batch.emplace_back(adjDb2);
+    }
+    return batch;
+  };
+  spfSolver.updateAdjacencyDatabase(adjDb3);
+  spfSolver.updateAdjacencyDatabases(flapMetric(11, 20));
+  spfRuns = getSpfRuns();
+  adjDb3.adjacencies[1].metric = 2;
+  spfSolver.updateAdjacencyDatabase(adjDb3);
+  EXPECT_EQ(spfRuns, getSpfRuns());
+
+  // more metric changes than the change log holds
+  spfSolver.updateAdjacencyDatabases(flapMetric(21, 120));
+  spfRuns = getSpfRuns();
+  adjDb3.adjacencies[0].metric = 4;
+  spfSolver.updateAdjacencyDatabase(adjDb3);
+  EXPECT_EQ(spfRuns + 2, getSpfRuns());
+  EXPECT_EQ(1, getHoldSteps());
+}
+
 //
 // Create a broken topology where R1 and R2 connect no one
 // Expect no routes coming out of the spfSolver
@@ -3710,6 +4383,94 @@ TEST(GridTopology, StressTest) {
   spfSolver.buildPaths("523");
 }
 
+// LFA routes must not depend on how many threads neighbor SPFs run on
+TEST(GridTopology, ParallelLfaSpf) {
+  const int n = 6;
+  vector<string> allNodes;
+  for (int i = 0; i < n * n; ++i) {
+    allNodes.push_back(folly::sformat("{}", i));
+  }
+
+  std::string nodeName("1");
+  SpfSolver serialSolver(
+      nodeName,
+      false /* enableV4 */,
+      true /* computeLfaPaths */,
+      false /* enableOrderedFib */,
+      false /* bgpDryRun */,
+      false /* bgpUseIgpMetric */,
+      nullptr /* spfExecutor */);
+  SpfSolver parallelSolver(
+      nodeName,
+      false /* enableV4 */,
+      true /* computeLfaPaths */,
+      false /* enableOrderedFib */,
+      false /* bgpDryRun */,
+      false /* bgpUseIgpMetric */,
+      std::make_shared<folly::CPUThreadPoolExecutor>(4));
+  createGrid(serialSolver, n);
+  createGrid(parallelSolver, n);
+
+  auto serialRouteMap = getRouteMap(serialSolver, allNodes);
+  auto parallelRouteMap = getRouteMap(parallelSolver, allNodes);
+  EXPECT_EQ(2 * n * n * n * n + 3 * n * n - 4 * n, serialRouteMap.size());
+  EXPECT_EQ(serialRouteMap, parallelRouteMap);
+}
+
+TEST(GridTopology, ParallelRouteBuild) {
+  const int n = 4;
+  const int prefixesPerNode = 400;
+  std::string nodeName("1");
+  SpfSolver serialSolver(
+      nodeName,
+      false /* enableV4 */,
+      false /* computeLfaPaths */,
+      false /* enableOrderedFib */,
+      false /* bgpDryRun */,
+      false /* bgpUseIgpMetric */,
+      nullptr /* spfExecutor */);
+  SpfSolver parallelSolver(
+      nodeName,
+      false /* enableV4 */,
+      false /* computeLfaPaths */,
+      false /* enableOrderedFib */,
+      false /* bgpDryRun */,
+      false /* bgpUseIgpMetric */,
+      std::make_shared<folly::CPUThreadPoolExecutor>(4));
+  createGrid(serialSolver, n);
+  createGrid(parallelSolver, n);
+
+  // enough prefixes for several chunks per thread
+  for (int node = 0; node < n * n; ++node) {
+    std::vector<thrift::PrefixEntry> prefixEntries;
+    for (int i = 0; i < prefixesPerNode; ++i) {
+      prefixEntries.emplace_back(createPrefixEntry(
+          toIpPrefix(folly::sformat("fc00:{}:{}::/64", node, i))));
+    }
+    auto const prefixDb =
+        createPrefixDb(folly::sformat("{}", node), prefixEntries);
+    serialSolver.updatePrefixDatabase(prefixDb);
+    parallelSolver.updatePrefixDatabase(prefixDb);
+  }
+
+  auto getCounter = [](const std::string& name) {
+    return fb303::fbData->getCounters()[name];
+  };
+  const auto hits = getCounter("decision.next_hops_cache_hits.count");
+  const auto misses = getCounter("decision.next_hops_cache_misses.count");
+  auto serialRouteMap = getRouteMap(serialSolver, {nodeName});
+  // next hops are computed once per announcing node
+  EXPECT_EQ(
+      misses + n * n - 1, getCounter("decision.next_hops_cache_misses.count"));
+  EXPECT_EQ(
+      hits + (n * n - 1) * (prefixesPerNode - 1),
+      getCounter("decision.next_hops_cache_hits.count"));
+
+  auto parallelRouteMap = getRouteMap(parallelSolver, {nodeName});
+  EXPECT_LE((n * n - 1) * prefixesPerNode, serialRouteMap.size());
+  EXPECT_EQ(serialRouteMap, parallelRouteMap);
+}
+
 //
 // Start the decision thread and simulate KvStore communications
 // Expect proper RouteDatabase publications to appear
@@ -3785,7 +4546,8 @@ class DecisionTestFixture : public ::testing::Test {
   // publish routeDb
   void
   sendKvPublication(const thrift::Publication& publication) {
-    kvStoreUpdatesQueue.push(publication);
+    kvStoreUpdatesQueue.push(
+        std::make_shared<const thrift::Publication>(publication));
   }
 
   void
@@ -3854,6 +4616,26 @@ class DecisionTestFixture : public ::testing::Test {
     return keyVal;
   }
 
+  // per adjacency keys of node, an empty adjacency withdraws its key
+  std::unordered_map<std::string, thrift::Value>
+  createPerAdjacencyKeyValue(
+      const string& node,
+      int64_t version,
+      const vector<thrift::Adjacency>& adjs,
+      bool withdraw = false) {
+    std::unordered_map<std::string, thrift::Value> keyVal{};
+    for (const auto& adj : adjs) {
+      const auto key =
+          createPerAdjacencyKey("adj:", node, adj.ifName, adj.otherNodeName);
+      keyVal[key] = createAdjValue(
+          node,
+          version,
+          withdraw ? vector<thrift::Adjacency>{}
+                   : vector<thrift::Adjacency>{adj});
+    }
+    return keyVal;
+  }
+
   /**
    * Check whether two RouteDatabaseDeltas to be equal
    */
@@ -3885,7 +4667,7 @@ class DecisionTestFixture : public ::testing::Test {
   // ZMQ context for IO processing
   fbzmq::Context zeromqContext{};
 
-  messaging::ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue;
+  messaging::ReplicateQueue<KvStorePublication> kvStoreUpdatesQueue;
   messaging::ReplicateQueue<thrift::RouteDatabaseDelta> staticRoutesUpdateQueue;
   messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue;
   messaging::RQueue<thrift::RouteDatabaseDelta> routeUpdatesQueueReader{
@@ -3929,6 +4711,14 @@ TEST_F(DecisionTestFixture, BasicOperations) {
   auto routeDelta = findDeltaRoutes(routeDb, routeDbBefore);
   EXPECT_TRUE(checkEqualRoutesDelta(routeDbDelta, routeDelta));
 
+  // our routes are served as sent, without computing them again
+  auto const pathBuildRuns =
+      fb303::fbData->getCounters()["decision.path_build_runs.count"];
+  dumpRouteDb({"1"});
+  EXPECT_EQ(
+      pathBuildRuns,
+      fb303::fbData->getCounters()["decision.path_build_runs.count"]);
+
   RouteMap routeMap;
   fillRouteMap("1", routeMap, routeDb);
 
@@ -4021,6 +4811,7 @@ TEST_F(DecisionTestFixture, BasicOperations) {
 
   // construct new static mpls route add
   thrift::RouteDatabaseDelta input;
+  input.thisNodeName = "1";
   thrift::NextHopThrift nh, nh1, nh2;
   nh.address = toBinaryAddress(folly::IPAddressV6("::1"));
   nh1.address = toBinaryAddress(folly::IPAddressV6("::2"));
@@ -4033,9 +4824,8 @@ TEST_F(DecisionTestFixture, BasicOperations) {
 
   // update 32011 and make sure only that is updated
   sendStaticRoutesUpdate(input);
+  // sent on its own, without any route computation
   auto routesDelta = routeUpdatesQueueReader.get().value();
-  // consume an empty routes update because of reachability change.
-  routeUpdatesQueueReader.get().value();
   routesDelta.perfEvents_ref().reset();
   EXPECT_EQ(routesDelta, input);
 
@@ -4044,8 +4834,6 @@ TEST_F(DecisionTestFixture, BasicOperations) {
   input.mplsRoutesToUpdate = {route};
   sendStaticRoutesUpdate(input);
   routesDelta = routeUpdatesQueueReader.get().value();
-  // consume an empty routes update because of reachability change.
-  routeUpdatesQueueReader.get().value();
   routesDelta.perfEvents_ref().reset();
   EXPECT_EQ(routesDelta, input);
 
@@ -4068,8 +4856,6 @@ TEST_F(DecisionTestFixture, BasicOperations) {
   sendStaticRoutesUpdate(input);
 
   routesDelta = routeUpdatesQueueReader.get().value();
-  // consume an empty routes update because of reachability change.
-  routeUpdatesQueueReader.get().value();
   routesDelta.perfEvents_ref().reset();
   EXPECT_EQ(routesDelta.mplsRoutesToDelete[0], 32011);
   EXPECT_EQ(routesDelta.mplsRoutesToUpdate.size(), 0);
@@ -4091,8 +4877,6 @@ TEST_F(DecisionTestFixture, BasicOperations) {
   sendStaticRoutesUpdate(input);
 
   routesDelta = routeUpdatesQueueReader.get().value();
-  // consume an empty routes update because of reachability change.
-  routeUpdatesQueueReader.get().value();
   routesDelta.perfEvents_ref().reset();
   EXPECT_EQ(routesDelta, input);
 
@@ -4100,6 +4884,9 @@ TEST_F(DecisionTestFixture, BasicOperations) {
   EXPECT_EQ(staticRoutes.size(), 1);
   EXPECT_THAT(
       staticRoutes[32012], testing::UnorderedElementsAreArray({nh, nh1}));
+
+  // static routes never triggered route computation
+  EXPECT_EQ(0, routeUpdatesQueueReader.size());
 }
 
 // The following topology is used:
@@ -4446,6 +5233,70 @@ TEST_F(DecisionTestFixture, NoSpfOnDuplicatePublication) {
   EXPECT_EQ(1, counters["decision.path_build_runs.count"]);
 }
 
+//
+// Values whose contents are already applied must not be deserialized again
+// and only the latest value of a key within a debounce window is applied
+//
+TEST_F(DecisionTestFixture, LazyKeyValDeserialization) {
+  fb303::fbData->resetAllData();
+  sendKvPublication(createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      std::string("")));
+  auto routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(1, counters["decision.path_build_runs.count"]);
+  EXPECT_EQ(0, counters["decision.unchanged_key_vals.count"]);
+
+  // version bump without content change
+  sendKvPublication(createThriftPublication(
+      {{"adj:2", createAdjValue("2", 2, {adj21})},
+       {"prefix:2", createPrefixValue("2", 2, {addr2})}},
+      {},
+      {},
+      {},
+      std::string("")));
+
+  // wait for debounce to expire
+  /* sleep override */
+  std::this_thread::sleep_for(2 * debounceTimeoutMax);
+
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(1, counters["decision.path_build_runs.count"]);
+  EXPECT_EQ(2, counters["decision.unchanged_key_vals.count"]);
+
+  // new prefix immediately withdrawn within the same debounce window
+  sendKvPublication(createThriftPublication(
+      {{"prefix:2", createPrefixValue("2", 3, {addr2, addr3})}},
+      {},
+      {},
+      {},
+      std::string("")));
+  sendKvPublication(createThriftPublication(
+      {{"prefix:2", createPrefixValue("2", 4, {addr2})}},
+      {},
+      {},
+      {},
+      std::string("")));
+
+  /* sleep override */
+  std::this_thread::sleep_for(2 * debounceTimeoutMax);
+
+  counters = fb303::fbData->getCounters();
+  EXPECT_EQ(1, counters["decision.path_build_runs.count"]);
+  EXPECT_EQ(3, counters["decision.unchanged_key_vals.count"]);
+
+  auto routeDb = dumpRouteDb({"1"})["1"];
+  EXPECT_EQ(1, routeDb.unicastRoutes.size());
+}
+
 /**
  * Loop-alternate path testing. Topology is described as follows
  *          10
@@ -4985,6 +5836,196 @@ TEST_F(DecisionTestFixture, PerPrefixKeyExpiry) {
   EXPECT_EQ(addr5, routeDbDelta.unicastRoutesToDelete.at(0));
 }
 
+// Node 2 advertises its prefixes in bucket keys, each carrying all prefixes
+// of its bucket
+TEST_F(DecisionTestFixture, PrefixBucketKeys) {
+  const auto bucket0 = createPrefixBucketKey("prefix:", "2", 0);
+  const auto bucket1 = createPrefixBucketKey("prefix:", "2", 1);
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {bucket0, createPrefixValue("2", 1, {addr2, addr5})},
+       {bucket1, createPrefixValue("2", 1, {addr6})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(3, routeDbDelta.unicastRoutesToUpdate.size());
+
+  // update of a bucket replaces its prefixes only
+  publication = createThriftPublication(
+      {{bucket0, createPrefixValue("2", 2, {addr2})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToUpdate.size());
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToDelete.size());
+  EXPECT_EQ(addr5, routeDbDelta.unicastRoutesToDelete.at(0));
+
+  // expired bucket
+  publication =
+      createThriftPublication({}, {bucket1}, {}, {}, std::string(""));
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToUpdate.size());
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToDelete.size());
+  EXPECT_EQ(addr6, routeDbDelta.unicastRoutesToDelete.at(0));
+  EXPECT_EQ(1, dumpRouteDb({"1"})["1"].unicastRoutes.size());
+}
+
+// Node 1 advertises per adjacency keys, its adjacency db key carries none:
+//
+//   2 --- 1 --- 3
+//
+TEST_F(DecisionTestFixture, PerAdjacencyKeys) {
+  auto keyVals = createPerAdjacencyKeyValue("1", 1, {adj12, adj13});
+  keyVals["adj:1"] = createAdjValue("1", 1, {});
+  keyVals["adj:2"] = createAdjValue("2", 1, {adj21});
+  keyVals["adj:3"] = createAdjValue("3", 1, {adj31});
+  keyVals["prefix:2"] = createPrefixValue("2", 1, {addr2});
+  keyVals["prefix:3"] = createPrefixValue("3", 1, {addr3});
+  sendKvPublication(
+      createThriftPublication(keyVals, {}, {}, {}, std::string("")));
+  auto routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(2, routeDbDelta.unicastRoutesToUpdate.size());
+
+  RouteMap routeMap;
+  fillRouteMap("1", routeMap, dumpRouteDb({"1"})["1"]);
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr2))],
+      NextHops({createNextHopFromAdj(adj12, false, 10)}));
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr3))],
+      NextHops({createNextHopFromAdj(adj13, false, 10)}));
+
+  // withdrawn adjacency to 3, its key carries none until it expires
+  sendKvPublication(createThriftPublication(
+      createPerAdjacencyKeyValue("1", 2, {adj13}, true /* withdraw */),
+      {},
+      {},
+      {},
+      std::string("")));
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToUpdate.size());
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToDelete.size());
+  EXPECT_EQ(addr3, routeDbDelta.unicastRoutesToDelete.at(0));
+
+  // expired adjacency to 2, node 1 is left without adjacencies
+  sendKvPublication(createThriftPublication(
+      {},
+      {createPerAdjacencyKey("adj:", "1", adj12.ifName, adj12.otherNodeName)},
+      {},
+      {},
+      std::string("")));
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToDelete.size());
+  EXPECT_EQ(addr2, routeDbDelta.unicastRoutesToDelete.at(0));
+}
+
+// Routes computed in different areas get merged. Node 1 reaches anycast
+// prefix addr2 via node 2 in area A and via node 3 in area B:
+//
+//   2 ---A--- 1 ---B--- 3
+//
+TEST_F(DecisionTestFixture, MultipleAreas) {
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      {},
+      std::string("A"));
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToDelete.size());
+
+  publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj13})},
+       {"adj:3", createAdjValue("3", 1, {adj31})},
+       {"prefix:3", createPrefixValue("3", 1, {addr2, addr3})}},
+      {},
+      {},
+      {},
+      {},
+      std::string("B"));
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  EXPECT_EQ(2, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToDelete.size());
+
+  auto routeDb = dumpRouteDb({"1"})["1"];
+  EXPECT_EQ(2, routeDb.unicastRoutes.size());
+  RouteMap routeMap;
+  fillRouteMap("1", routeMap, routeDb);
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr2))],
+      NextHops({createNextHopFromAdj(adj12, false, 10),
+                createNextHopFromAdj(adj13, false, 10)}));
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr3))],
+      NextHops({createNextHopFromAdj(adj13, false, 10)}));
+
+  // withdrawing addr2 in area A keeps the route of area B
+  publication =
+      createThriftPublication({}, {"prefix:2"}, {}, {}, {}, std::string("A"));
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb("1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToDelete.size());
+  EXPECT_EQ(addr2, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+  EXPECT_EQ(
+      NextHops(
+          routeDbDelta.unicastRoutesToUpdate.at(0).nextHops.begin(),
+          routeDbDelta.unicastRoutesToUpdate.at(0).nextHops.end()),
+      NextHops({createNextHopFromAdj(adj13, false, 10)}));
+}
+
+// Stages of route computation leave spans in the trace buffer
+TEST_F(DecisionTestFixture, TraceSpans) {
+  auto publication = createThriftPublication(
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      std::string(""));
+  sendKvPublication(publication);
+  recvMyRouteDb("1", serializer);
+
+  auto traceSpans = decision->getDecisionTraceSpans().get();
+  ASSERT_TRUE(traceSpans);
+  EXPECT_EQ(0, traceSpans->droppedSpans);
+  std::map<std::string, std::vector<thrift::TraceSpan>> spansByName;
+  for (auto const& span : traceSpans->spans) {
+    spansByName[span.name].emplace_back(span);
+  }
+  ASSERT_EQ(1, spansByName.count("deserialize"));
+  EXPECT_EQ(3, spansByName.at("deserialize").front().arg);
+  EXPECT_EQ(2, spansByName["linkstate_update"].size());
+  auto const& spfSpans = spansByName["spf"];
+  EXPECT_TRUE(
+      std::any_of(spfSpans.begin(), spfSpans.end(), [](auto const& span) {
+        return span.detail == "1";
+      }));
+  EXPECT_FALSE(spansByName["best_path"].empty());
+  EXPECT_EQ(1, spansByName["route_delta"].size());
+  EXPECT_EQ(1, spansByName["route_push"].size());
+
+  for (size_t i = 1; i < traceSpans->spans.size(); ++i) {
+    EXPECT_LT(traceSpans->spans[i - 1].seqNum, traceSpans->spans[i].seqNum);
+  }
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -5,11 +5,18 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include <folly/Format.h>
+#include <folly/Random.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
+#include <openr/decision/DijkstraQueue.h>
 #include <openr/decision/LinkState.h>
 
 TEST(HoldableValueTest, BasicOperation) {
@@ -145,15 +152,17 @@ TEST(LinkStateTest, BasicOperation) {
   auto adj32 =
       openr::createAdjacency(n3, "if3", "if3", "fe80::2", "10.0.0.2", 1, 1, 1);
 
-  auto l1 = std::make_shared<openr::Link>(n1, adj12, n2, adj21);
-  auto l2 = std::make_shared<openr::Link>(n2, adj23, n3, adj32);
-  auto l3 = std::make_shared<openr::Link>(n3, adj31, n1, adj13);
+  openr::Link link1(n1, adj12, n2, adj21);
+  openr::Link link2(n2, adj23, n3, adj32);
+  openr::Link link3(n3, adj31, n1, adj13);
 
   openr::LinkState state;
 
-  state.addLink(l1);
-  state.addLink(l2);
-  state.addLink(l3);
+  auto* l1 = state.addLink(link1);
+  auto* l2 = state.addLink(link2);
+  auto* l3 = state.addLink(link3);
+  EXPECT_EQ(link1, *l1);
+  EXPECT_EQ(3, state.numLinks());
   EXPECT_THAT(
       state.linksFromNode("node1"), testing::UnorderedElementsAre(l1, l3));
   EXPECT_THAT(
@@ -169,7 +178,7 @@ TEST(LinkStateTest, BasicOperation) {
   EXPECT_TRUE(state.updateNodeOverloaded("node1", false, 0, 0));
   EXPECT_FALSE(state.isNodeOverloaded("node1"));
 
-  state.removeLink(l1);
+  state.removeLink(link1);
   EXPECT_THAT(state.linksFromNode("node1"), testing::UnorderedElementsAre(l3));
   EXPECT_THAT(state.linksFromNode("node2"), testing::UnorderedElementsAre(l2));
   EXPECT_THAT(
@@ -179,7 +188,290 @@ TEST(LinkStateTest, BasicOperation) {
   EXPECT_THAT(state.linksFromNode("node1"), testing::IsEmpty());
   EXPECT_THAT(state.linksFromNode("node2"), testing::UnorderedElementsAre(l2));
   EXPECT_THAT(state.linksFromNode("node3"), testing::UnorderedElementsAre(l2));
-  EXPECT_THROW(state.removeLink(l1), std::out_of_range);
+  EXPECT_THROW(state.removeLink(link1), std::out_of_range);
+}
+
+TEST(LinkStateTest, LinkHandles) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  openr::LinkState state;
+  auto adj12 =
+      openr::createAdjacency(n2, "if1", "if2", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj21 =
+      openr::createAdjacency(n1, "if2", "if1", "fe80::1", "10.0.0.1", 1, 1, 1);
+  auto* link = state.addLink(openr::Link(n1, adj12, n2, adj21));
+  const auto version = state.getVersion();
+
+  // removed link stays accessible through the change log
+  state.removeLink(*link);
+  EXPECT_EQ(0, state.numLinks());
+  auto changes = state.getLinkChangesSince(version);
+  ASSERT_TRUE(changes.has_value());
+  ASSERT_EQ(1, changes->size());
+  EXPECT_EQ(link, changes->front().link);
+  EXPECT_EQ(n2, changes->front().link->getOtherNodeName(n1));
+
+  // many more links, the change log does not cover the removal anymore
+  for (int i = 0; i < 1000; ++i) {
+    auto const if1 = folly::sformat("if1_{}", i);
+    auto const if2 = folly::sformat("if2_{}", i);
+    auto* l = state.addLink(openr::Link(
+        n1,
+        openr::createAdjacency(n2, if1, if2, "fe80::2", "10.0.0.2", 1, 1, 1),
+        n2,
+        openr::createAdjacency(n1, if2, if1, "fe80::1", "10.0.0.1", 1, 1, 1)));
+    EXPECT_EQ(if1, l->getIfaceFromNode(n1));
+  }
+  EXPECT_FALSE(state.getLinkChangesSince(version).has_value());
+  EXPECT_EQ(1000, state.numLinks());
+  EXPECT_EQ(1000, state.linksFromNode(n1).size());
+  EXPECT_EQ(1000, state.linksFromNode(n2).size());
+  for (auto* l : state.linksFromNode(n2)) {
+    EXPECT_EQ(n1, l->getOtherNodeName(n2));
+  }
+}
+
+TEST(LinkStateTest, AdjacencyDatabasesSnapshot) {
+  std::string n1 = "node1";
+  auto adj12 =
+      openr::createAdjacency(n1, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  std::string n2 = "node2";
+  auto adj21 =
+      openr::createAdjacency(n2, "if1", "if2", "fe80::1", "10.0.0.1", 1, 1, 1);
+
+  openr::LinkState state;
+  auto const emptySnapshot = state.getAdjacencyDatabasesSnapshot();
+  ASSERT_NE(nullptr, emptySnapshot);
+  EXPECT_TRUE(emptySnapshot->empty());
+
+  state.updateAdjacencyDatabase(openr::createAdjDb(n1, {adj12}, 1), 0, 0);
+  state.updateAdjacencyDatabase(openr::createAdjDb(n2, {adj21}, 2), 0, 0);
+  auto const snapshot = state.getAdjacencyDatabasesSnapshot();
+  EXPECT_EQ(state.getAdjacencyDatabases(), *snapshot);
+  // shared until the next change
+  EXPECT_EQ(snapshot, state.getAdjacencyDatabasesSnapshot());
+  // earlier snapshots are unaffected by changes
+  EXPECT_TRUE(emptySnapshot->empty());
+
+  EXPECT_TRUE(state.deleteAdjacencyDatabase(n2));
+  auto const deletedSnapshot = state.getAdjacencyDatabasesSnapshot();
+  EXPECT_NE(snapshot, deletedSnapshot);
+  EXPECT_EQ(1, deletedSnapshot->count(n1));
+  EXPECT_EQ(0, deletedSnapshot->count(n2));
+  EXPECT_EQ(1, snapshot->count(n2));
+}
+
+TEST(LinkStateTest, UpdateAdjacencyDatabases) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  std::string n3 = "node3";
+  auto adj12 =
+      openr::createAdjacency(n2, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj13 =
+      openr::createAdjacency(n3, "if3", "if1", "fe80::3", "10.0.0.3", 1, 2, 1);
+  auto adj21 =
+      openr::createAdjacency(n1, "if1", "if2", "fe80::1", "10.0.0.1", 1, 1, 1);
+  auto adj31 =
+      openr::createAdjacency(n1, "if1", "if3", "fe80::1", "10.0.0.1", 1, 3, 1);
+  auto const adjDb1 = openr::createAdjDb(n1, {adj12, adj13}, 1);
+  auto const adjDb2 = openr::createAdjDb(n2, {adj21}, 2);
+  auto const adjDb3 = openr::createAdjDb(n3, {adj31}, 3);
+
+  openr::LinkState serialState;
+  serialState.updateAdjacencyDatabase(adjDb1, 0, 0);
+  serialState.updateAdjacencyDatabase(adjDb2, 0, 0);
+  serialState.updateAdjacencyDatabase(adjDb3, 0, 0);
+
+  // links between nodes of the batch are made regardless of their order
+  openr::LinkState bulkState;
+  auto rcs = bulkState.updateAdjacencyDatabases(
+      {{adjDb1, 0, 0}, {adjDb2, 0, 0}, {adjDb3, 0, 0}});
+  ASSERT_EQ(3, rcs.size());
+  EXPECT_TRUE(rcs[0].first);
+  EXPECT_EQ(
+      serialState.getAdjacencyDatabases(), bulkState.getAdjacencyDatabases());
+  EXPECT_EQ(2, bulkState.numLinks());
+  for (auto const& node : {n1, n2, n3}) {
+    EXPECT_EQ(
+        serialState.linksFromNode(node).size(),
+        bulkState.linksFromNode(node).size());
+  }
+
+  // unchanged databases change nothing, node label changes route attributes
+  rcs = bulkState.updateAdjacencyDatabases(
+      {{adjDb1, 0, 0}, {openr::createAdjDb(n2, {adj21}, 20), 0, 0}});
+  ASSERT_EQ(2, rcs.size());
+  EXPECT_FALSE(rcs[0].first);
+  EXPECT_FALSE(rcs[0].second);
+  EXPECT_FALSE(rcs[1].first);
+  EXPECT_TRUE(rcs[1].second);
+
+  // links of both sides go down together
+  rcs = bulkState.updateAdjacencyDatabases(
+      {{openr::createAdjDb(n1, {adj12}, 1), 0, 0},
+       {openr::createAdjDb(n3, {}, 3), 0, 0}});
+  EXPECT_TRUE(rcs[0].first);
+  EXPECT_EQ(1, bulkState.numLinks());
+}
+
+TEST(LinkStateTest, Holds) {
+  std::string n1 = "node1";
+  std::string n2 = "node2";
+  auto adj12 =
+      openr::createAdjacency(n2, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj21 =
+      openr::createAdjacency(n1, "if1", "if2", "fe80::1", "10.0.0.1", 1, 1, 1);
+
+  openr::LinkState state;
+  state.updateAdjacencyDatabase(openr::createAdjDb(n1, {adj12}, 1), 0, 0);
+  EXPECT_FALSE(state.hasHolds());
+  EXPECT_FALSE(state.decrementHolds());
+
+  // new link held up for two ticks
+  state.updateAdjacencyDatabase(openr::createAdjDb(n2, {adj21}, 2), 2, 0);
+  EXPECT_TRUE(state.hasHolds());
+  EXPECT_FALSE(state.decrementHolds());
+  EXPECT_TRUE(state.hasHolds());
+  EXPECT_TRUE(state.decrementHolds());
+  EXPECT_FALSE(state.hasHolds());
+  EXPECT_FALSE(state.decrementHolds());
+
+  // holds of removed links are dropped along with them
+  adj12.metric = 5;
+  state.updateAdjacencyDatabase(openr::createAdjDb(n1, {adj12}, 1), 1, 1);
+  EXPECT_TRUE(state.hasHolds());
+  EXPECT_TRUE(state.deleteAdjacencyDatabase(n2));
+  EXPECT_FALSE(state.hasHolds());
+
+  // node overload held for one tick
+  state.updateAdjacencyDatabase(
+      openr::createAdjDb(n1, {adj12}, 1, true), 1, 1);
+  EXPECT_TRUE(state.hasHolds());
+  EXPECT_FALSE(state.isNodeOverloaded(n1));
+  EXPECT_TRUE(state.decrementHolds());
+  EXPECT_FALSE(state.hasHolds());
+  EXPECT_TRUE(state.isNodeOverloaded(n1));
+}
+
+TEST(LinkStateTest, CsrGraph) {
+  std::string n1 = "node1";
+  auto adj12 =
+      openr::createAdjacency(n1, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj13 =
+      openr::createAdjacency(n1, "if3", "if1", "fe80::3", "10.0.0.3", 5, 1, 1);
+  std::string n2 = "node2";
+  auto adj21 =
+      openr::createAdjacency(n2, "if1", "if2", "fe80::1", "10.0.0.1", 2, 1, 1);
+  std::string n3 = "node3";
+  auto adj31 =
+      openr::createAdjacency(n3, "if1", "if3", "fe80::1", "10.0.0.1", 3, 1, 1);
+
+  openr::Link link1(n1, adj12, n2, adj21);
+  openr::Link link2(n3, adj31, n1, adj13);
+
+  openr::LinkState state;
+  EXPECT_FALSE(state.getNodeId(n1).has_value());
+  EXPECT_EQ(0, state.getCsrGraph().numNodes());
+
+  auto* l1 = state.addLink(link1);
+  auto* l2 = state.addLink(link2);
+  ASSERT_TRUE(state.getNodeId(n1).has_value());
+  ASSERT_TRUE(state.getNodeId(n2).has_value());
+  ASSERT_TRUE(state.getNodeId(n3).has_value());
+  const auto id1 = state.getNodeId(n1).value();
+  const auto id2 = state.getNodeId(n2).value();
+  const auto id3 = state.getNodeId(n3).value();
+  EXPECT_EQ(n1, state.getNodeName(id1));
+  EXPECT_EQ(n2, state.getNodeName(id2));
+  EXPECT_EQ(n3, state.getNodeName(id3));
+  EXPECT_THROW(state.getNodeName(3), std::out_of_range);
+
+  auto const& graph = state.getCsrGraph();
+  ASSERT_EQ(3, graph.numNodes());
+  ASSERT_EQ(4, graph.edges.size());
+  EXPECT_EQ(2, graph.offsets[id1 + 1] - graph.offsets[id1]);
+  EXPECT_EQ(1, graph.offsets[id2 + 1] - graph.offsets[id2]);
+  EXPECT_EQ(1, graph.offsets[id3 + 1] - graph.offsets[id3]);
+  auto const& edge21 = graph.edges[graph.offsets[id2]];
+  EXPECT_EQ(id1, edge21.otherNode);
+  EXPECT_EQ(2, edge21.metric);
+  EXPECT_EQ(l1, edge21.link);
+  auto const& edge31 = graph.edges[graph.offsets[id3]];
+  EXPECT_EQ(id1, edge31.otherNode);
+  EXPECT_EQ(3, edge31.metric);
+  EXPECT_EQ(l2, edge31.link);
+
+  // graph is rebuilt after link removal, ids are retained
+  state.removeLink(link2);
+  auto const& graph2 = state.getCsrGraph();
+  ASSERT_EQ(3, graph2.numNodes());
+  EXPECT_EQ(2, graph2.edges.size());
+  EXPECT_EQ(0, graph2.offsets[id3 + 1] - graph2.offsets[id3]);
+  EXPECT_EQ(id3, state.getNodeId(n3).value());
+
+  // overloaded nodes are flagged
+  state.updateNodeOverloaded(n2, true, 0, 0);
+  EXPECT_TRUE(state.getCsrGraph().overloaded[id2]);
+  EXPECT_FALSE(state.getCsrGraph().overloaded[id1]);
+}
+
+// Dijkstra like monotone workload: every pop pushes a few keys no smaller
+// than the popped one. Returns keys in pop order
+template <typename Queue>
+std::vector<uint64_t>
+runMonotoneQueue(uint32_t seed) {
+  std::mt19937 gen(seed);
+  Queue q;
+  std::vector<uint64_t> popped;
+  q.push(0, 0);
+  q.push(0, 1);
+  uint32_t numPushes = 2;
+  while (not q.empty()) {
+    const auto [key, value] = q.top();
+    q.pop();
+    popped.emplace_back(key);
+    for (int i = 0; numPushes < 10000 and i < 3; ++i, ++numPushes) {
+      // mix of ties, small and very large metric increments
+      const uint64_t delta = folly::Random::rand32(4, gen) == 0
+          ? folly::Random::rand64(gen) >> 16
+          : folly::Random::rand32(10, gen);
+      q.push(key + delta, value + 1);
+    }
+  }
+  return popped;
+}
+
+TEST(DijkstraQueueTest, MonotonePopOrder) {
+  for (uint32_t seed = 0; seed < 10; ++seed) {
+    auto const binary =
+        runMonotoneQueue<openr::BinaryHeapQueue<uint64_t, uint32_t>>(seed);
+    auto const radix =
+        runMonotoneQueue<openr::RadixHeapQueue<uint64_t, uint32_t>>(seed);
+    EXPECT_EQ(10000, binary.size());
+    EXPECT_TRUE(std::is_sorted(binary.begin(), binary.end()));
+    EXPECT_EQ(binary, radix);
+  }
+}
+
+TEST(DijkstraQueueTest, RadixHeapTies) {
+  openr::RadixHeapQueue<uint64_t, uint32_t> q;
+  EXPECT_TRUE(q.empty());
+  q.push(5, 1);
+  q.push(3, 2);
+  q.push(5, 3);
+  EXPECT_EQ((std::make_pair<uint64_t, uint32_t>(3, 2)), q.top());
+  q.pop();
+  // same key as the last popped one
+  q.push(3, 4);
+  EXPECT_EQ((std::make_pair<uint64_t, uint32_t>(3, 4)), q.top());
+  q.pop();
+  std::set<uint32_t> values;
+  while (not q.empty()) {
+    EXPECT_EQ(5, q.top().first);
+    values.emplace(q.top().second);
+    q.pop();
+  }
+  EXPECT_EQ((std::set<uint32_t>{1, 3}), values);
 }
 
 int
@@ -32,7 +32,7 @@ class PrefixStateTestFixture : public ::testing::Test {
     for (size_t i = 0; i < numNodes; ++i) {
       std::string nodeName = std::to_string(i);
       prefixDbs_[nodeName] = createPrefixDbForNode(nodeName, i);
-      EXPECT_TRUE(state_.updatePrefixDatabase(prefixDbs_[nodeName]));
+      EXPECT_FALSE(state_.updatePrefixDatabase(prefixDbs_[nodeName]).empty());
     }
   }
 
@@ -53,30 +53,30 @@ class PrefixStateTestFixture : public ::testing::Test {
 TEST_F(PrefixStateTestFixture, basicOperation) {
   EXPECT_EQ(state_.getPrefixDatabases(), prefixDbs_);
   auto const dbEntry = *prefixDbs_.begin();
-  EXPECT_FALSE(state_.updatePrefixDatabase(dbEntry.second));
+  EXPECT_TRUE(state_.updatePrefixDatabase(dbEntry.second).empty());
 
   auto prefixDb1Updated = dbEntry.second;
   prefixDb1Updated.prefixEntries.at(0).type = thrift::PrefixType::BREEZE;
-  EXPECT_TRUE(state_.updatePrefixDatabase(prefixDb1Updated));
-  EXPECT_FALSE(state_.updatePrefixDatabase(prefixDb1Updated));
+  EXPECT_FALSE(state_.updatePrefixDatabase(prefixDb1Updated).empty());
+  EXPECT_TRUE(state_.updatePrefixDatabase(prefixDb1Updated).empty());
   EXPECT_EQ(prefixDb1Updated, state_.getPrefixDatabases().at(dbEntry.first));
 
   prefixDb1Updated.prefixEntries.at(0).forwardingType =
       thrift::PrefixForwardingType::SR_MPLS;
-  EXPECT_TRUE(state_.updatePrefixDatabase(prefixDb1Updated));
-  EXPECT_FALSE(state_.updatePrefixDatabase(prefixDb1Updated));
+  EXPECT_FALSE(state_.updatePrefixDatabase(prefixDb1Updated).empty());
+  EXPECT_TRUE(state_.updatePrefixDatabase(prefixDb1Updated).empty());
   EXPECT_EQ(prefixDb1Updated, state_.getPrefixDatabases().at(dbEntry.first));
 
   thrift::PrefixDatabase emptyPrefixDb;
   emptyPrefixDb.thisNodeName = dbEntry.first;
-  EXPECT_TRUE(state_.updatePrefixDatabase(emptyPrefixDb));
+  EXPECT_FALSE(state_.updatePrefixDatabase(emptyPrefixDb).empty());
   auto modifiedPrefixDbs = prefixDbs_;
   modifiedPrefixDbs.erase(dbEntry.first);
   EXPECT_NE(prefixDbs_, modifiedPrefixDbs);
   EXPECT_EQ(state_.getPrefixDatabases(), modifiedPrefixDbs);
   emptyPrefixDb.thisNodeName = dbEntry.first;
-  EXPECT_FALSE(state_.updatePrefixDatabase(emptyPrefixDb));
-  EXPECT_TRUE(state_.updatePrefixDatabase(dbEntry.second));
+  EXPECT_TRUE(state_.updatePrefixDatabase(emptyPrefixDb).empty());
+  EXPECT_FALSE(state_.updatePrefixDatabase(dbEntry.second).empty());
 }
 
 class GetLoopbackViasTest : public PrefixStateTestFixture,
@@ -125,6 +125,67 @@ TEST_P(GetLoopbackViasTest, basicOperation) {
   EXPECT_EQ(loopbacks2.size(), 0);
 }
 
+TEST_F(PrefixStateTestFixture, changedPrefixes) {
+  auto const prefix0 = getAddrFromSeed(0, false);
+  auto const prefix0V4 = getAddrFromSeed(0, true);
+  auto const prefix2 = getAddrFromSeed(2, false);
+  EXPECT_EQ(4, state_.getChangedPrefixes().size());
+  state_.clearChangedPrefixes();
+  EXPECT_TRUE(state_.getChangedPrefixes().empty());
+
+  // node 0 updates one prefix, withdraws another and announces a new one
+  auto prefixDb = createPrefixDb(
+      "0",
+      {createPrefixEntry(prefix0, thrift::PrefixType::BREEZE),
+       createPrefixEntry(prefix2)});
+  const std::unordered_set<IpPrefixKey> expected{
+      IpPrefixKey(prefix0), IpPrefixKey(prefix0V4), IpPrefixKey(prefix2)};
+  EXPECT_EQ(expected, state_.updatePrefixDatabase(prefixDb));
+  EXPECT_EQ(expected, state_.getChangedPrefixes());
+  EXPECT_EQ(
+      (std::set<IpPrefixKey>{IpPrefixKey(prefix0), IpPrefixKey(prefix2)}),
+      state_.getNodeToPrefixes().at("0"));
+
+  // withdrawal of all prefixes removes the node from the reverse index
+  thrift::PrefixDatabase emptyPrefixDb;
+  emptyPrefixDb.thisNodeName = "0";
+  EXPECT_EQ(
+      (std::unordered_set<IpPrefixKey>{
+          IpPrefixKey(prefix0), IpPrefixKey(prefix2)}),
+      state_.updatePrefixDatabase(emptyPrefixDb));
+  EXPECT_EQ(0, state_.getNodeToPrefixes().count("0"));
+  EXPECT_EQ(1, state_.getNodeToPrefixes().count("1"));
+  EXPECT_EQ(0, state_.prefixes().count(IpPrefixKey(prefix2)));
+}
+
+TEST_F(PrefixStateTestFixture, invalidPrefix) {
+  // rejected as a whole, the entries before the invalid one don't apply
+  auto prefixDb = createPrefixDb(
+      "0",
+      {createPrefixEntry(getAddrFromSeed(2, false)),
+       createPrefixEntry(thrift::IpPrefix{})});
+  EXPECT_THROW(state_.updatePrefixDatabase(prefixDb), std::invalid_argument);
+  EXPECT_EQ(prefixDbs_, state_.getPrefixDatabases());
+}
+
+TEST_F(PrefixStateTestFixture, prefixDatabasesSnapshot) {
+  auto const snapshot = state_.getPrefixDatabasesSnapshot();
+  EXPECT_EQ(prefixDbs_, *snapshot);
+
+  // shared until the next change, unchanged updates do not count
+  EXPECT_TRUE(state_.updatePrefixDatabase(prefixDbs_.at("0")).empty());
+  EXPECT_EQ(snapshot, state_.getPrefixDatabasesSnapshot());
+
+  thrift::PrefixDatabase emptyPrefixDb;
+  emptyPrefixDb.thisNodeName = "0";
+  EXPECT_FALSE(state_.updatePrefixDatabase(emptyPrefixDb).empty());
+  auto const updatedSnapshot = state_.getPrefixDatabasesSnapshot();
+  EXPECT_NE(snapshot, updatedSnapshot);
+  EXPECT_EQ(0, updatedSnapshot->count("0"));
+  // earlier snapshots are unaffected by changes
+  EXPECT_EQ(prefixDbs_, *snapshot);
+}
+
 INSTANTIATE_TEST_CASE_P(
     LoopbackViasInstance, GetLoopbackViasTest, ::testing::Bool());
 
@@ -139,7 +200,7 @@ TEST_F(PrefixStateTestFixture, getNodeHostLoopbacksV4) {
 
   thrift::PrefixDatabase emptyPrefixDb;
   emptyPrefixDb.thisNodeName = "0";
-  EXPECT_TRUE(state_.updatePrefixDatabase(emptyPrefixDb));
+  EXPECT_FALSE(state_.updatePrefixDatabase(emptyPrefixDb).empty());
   EXPECT_THAT(
       state_.getNodeHostLoopbacksV4(), testing::UnorderedElementsAre(pair2));
 }
@@ -155,7 +216,7 @@ TEST_F(PrefixStateTestFixture, getNodeHostLoopbacksV6) {
 
   thrift::PrefixDatabase emptyPrefixDb;
   emptyPrefixDb.thisNodeName = "0";
-  EXPECT_TRUE(state_.updatePrefixDatabase(emptyPrefixDb));
+  EXPECT_FALSE(state_.updatePrefixDatabase(emptyPrefixDb).empty());
   EXPECT_THAT(
       state_.getNodeHostLoopbacksV6(), testing::UnorderedElementsAre(pair2));
 }
@@ -7,6 +7,8 @@
 
 #include "openr/dual/Dual.h"
 
+#include <algorithm>
+
 namespace openr {
 
 void
@@ -64,14 +66,18 @@ DualStateMachine::processEvent(DualEvent event, bool fc) {
 Dual::Dual(
     const std::string& nodeId,
     const std::string& rootId,
-    const std::unordered_map<std::string, int64_t>& localDistance,
+    const std::vector<std::string>& neighborNames,
+    const std::vector<std::optional<int64_t>>& localDistances,
     std::function<void(
         const std::optional<std::string>& oldNh,
         const std::optional<std::string>& newNh)> nexthopChangeCb)
     : nodeId(nodeId),
       rootId(rootId),
-      localDistances_(localDistance),
+      neighborNames_(neighborNames),
+      localDistances_(localDistances),
       nexthopCb_(std::move(nexthopChangeCb)) {
+  neighborInfos_.resize(localDistances_.size());
+  counters_.resize(localDistances_.size());
   // set distance to 0 if I'm the root, otherwise default to inf
   if (rootId == nodeId) {
     info_.distance = 0;
@@ -81,24 +87,75 @@ Dual::Dual(
   }
 }
 
+void
+Dual::ensureNeighbor(NeighborId neighbor) {
+  CHECK_LT(neighbor, neighborNames_.size());
+  if (neighbor < localDistances_.size()) {
+    return;
+  }
+  localDistances_.resize(neighbor + 1);
+  neighborInfos_.resize(neighbor + 1);
+  counters_.resize(neighbor + 1);
+}
+
+thrift::DualPerRootCounters&
+Dual::getNeighborCounters(NeighborId neighbor) {
+  auto& counters = counters_[neighbor];
+  if (not counters.has_value()) {
+    counters = thrift::DualPerRootCounters();
+  }
+  return *counters;
+}
+
+void
+Dual::setNexthop(std::optional<NeighborId> nexthop) {
+  std::optional<std::string> newNh{std::nullopt};
+  if (nexthop.has_value()) {
+    newNh = neighborNames_[*nexthop];
+  }
+  nexthopId_ = nexthop;
+  if (info_.nexthop != newNh) {
+    if (nexthopCb_) {
+      nexthopCb_(info_.nexthop, newNh);
+    }
+    info_.nexthop = std::move(newNh);
+  }
+}
+
+void
+Dual::addMessage(
+    NeighborId neighbor,
+    thrift::DualMessageType type,
+    int64_t distance,
+    DualMessagesToSend& msgsToSend) {
+  thrift::DualMessage msg;
+  msg.dstId = rootId;
+  msg.distance = distance;
+  msg.type = type;
+  msgsToSend.at(neighbor).messages.emplace_back(std::move(msg));
+}
+
 int64_t
-Dual::getMinDistance() {
+Dual::getMinDistance() const {
   if (nodeId == rootId) {
     // I'm the root
     return 0;
   }
   int64_t dmin = std::numeric_limits<int64_t>::max();
-  for (const auto& kv : localDistances_) {
-    const auto& ld = kv.second;
-    const auto& rd = info_.neighborInfos[kv.first].reportDistance;
-    dmin = std::min(dmin, addDistances(ld, rd));
+  for (NeighborId nb = 0; nb < localDistances_.size(); ++nb) {
+    if (localDistances_[nb].has_value()) {
+      dmin = std::min(dmin, getDistanceVia(nb));
+    }
   }
   return dmin;
 }
 
 bool
-Dual::routeAffected() {
-  if (localDistances_.size() == 0) {
+Dual::routeAffected() const {
+  if (std::none_of(
+          localDistances_.begin(), localDistances_.end(), [](const auto& ld) {
+            return ld.has_value();
+          })) {
     // no neighbor
     return false;
   }
@@ -121,46 +178,41 @@ Dual::routeAffected() {
     return false;
   }
 
-  std::unordered_set<std::string> nexthops;
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    const auto& ld = kv.second;
-    const auto& rd = info_.neighborInfos[neighbor].reportDistance;
-    int64_t d = addDistances(ld, rd);
-    if (d == dmin) {
-      nexthops.emplace(neighbor);
-    }
-  }
-
   // nexthop MUST has value, if it's none, it will be handled in
   // above "distance changed" or "no valid route found" cases
-  CHECK(info_.nexthop.has_value());
-  if (nexthops.count(*info_.nexthop) == 0) {
+  CHECK(nexthopId_.has_value());
+  if (getDistanceVia(*nexthopId_) != dmin) {
     // nextHop changed
-    auto oldnh = info_.nexthop.has_value() ? *info_.nexthop : "none";
-    VLOG(2) << rootId << "::" << nodeId << ": nexthop changed " << oldnh
-            << " -> " << folly::join(",", nexthops);
+    if (VLOG_IS_ON(2)) {
+      std::vector<std::string> nexthops;
+      for (NeighborId nb = 0; nb < localDistances_.size(); ++nb) {
+        if (localDistances_[nb].has_value() and getDistanceVia(nb) == dmin) {
+          nexthops.emplace_back(neighborNames_[nb]);
+        }
+      }
+      VLOG(2) << rootId << "::" << nodeId << ": nexthop changed "
+              << *info_.nexthop << " -> " << folly::join(",", nexthops);
+    }
     return true;
   }
   return false;
 }
 
 bool
-Dual::meetFeasibleCondition(std::string& nexthop, int64_t& distance) {
+Dual::meetFeasibleCondition(NeighborId& nexthop, int64_t& distance) const {
   int64_t dmin = getMinDistance();
   // find feasible nexthop according to SNC(source node condition)
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    const auto& ld = kv.second;
-    if (ld == std::numeric_limits<int64_t>::max()) {
+  for (NeighborId nb = 0; nb < localDistances_.size(); ++nb) {
+    if (not localDistances_[nb].has_value() or
+        *localDistances_[nb] == std::numeric_limits<int64_t>::max()) {
       // skip down neighbor
       continue;
     }
-    const auto& rd = info_.neighborInfos[neighbor].reportDistance;
-    if (rd < info_.feasibleDistance and addDistances(ld, rd) == dmin) {
-      VLOG(2) << rootId << "::" << nodeId << ": meet FC: " << neighbor << ", "
-              << rd << ", " << dmin;
-      nexthop = neighbor;
+    const auto& rd = neighborInfos_[nb].reportDistance;
+    if (rd < info_.feasibleDistance and getDistanceVia(nb) == dmin) {
+      VLOG(2) << rootId << "::" << nodeId << ": meet FC: "
+              << neighborNames_[nb] << ", " << rd << ", " << dmin;
+      nexthop = nb;
       distance = dmin;
       return true;
     }
@@ -169,38 +221,31 @@ Dual::meetFeasibleCondition(std::string& nexthop, int64_t& distance) {
 }
 
 void
-Dual::floodUpdates(
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
-  thrift::DualMessage msg;
-  msg.dstId = rootId;
-  msg.distance = info_.reportDistance;
-  msg.type = thrift::DualMessageType::UPDATE;
-
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    if (kv.second == std::numeric_limits<int64_t>::max()) {
+Dual::floodUpdates(DualMessagesToSend& msgsToSend) {
+  for (NeighborId nb = 0; nb < localDistances_.size(); ++nb) {
+    if (not neighborUp(nb)) {
       // skip down neighbor
       continue;
     }
-    msgsToSend[neighbor].messages.emplace_back(msg);
-    counters_[neighbor].updateSent++;
-    counters_[neighbor].totalSent++;
+    addMessage(
+        nb,
+        thrift::DualMessageType::UPDATE,
+        info_.reportDistance,
+        msgsToSend);
+    auto& counters = getNeighborCounters(nb);
+    counters.updateSent++;
+    counters.totalSent++;
   }
 }
 
 void
 Dual::localComputation(
-    const std::string& newNexthop,
+    NeighborId newNexthop,
     int64_t newDistance,
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+    DualMessagesToSend& msgsToSend) {
   bool sameRd = newDistance == info_.reportDistance;
   // perform local update
-  if (info_.nexthop != newNexthop) {
-    if (nexthopCb_) {
-      nexthopCb_(info_.nexthop, newNexthop);
-    }
-    info_.nexthop = newNexthop;
-  }
+  setNexthop(newNexthop);
   info_.distance = newDistance;
   info_.reportDistance = newDistance;
   info_.feasibleDistance = newDistance;
@@ -211,35 +256,28 @@ Dual::localComputation(
 }
 
 bool
-Dual::diffusingComputation(
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+Dual::diffusingComputation(DualMessagesToSend& msgsToSend) {
   // maintain current nexthop, update other fields
-  auto ld = localDistances_[*info_.nexthop];
-  auto rd = info_.neighborInfos[*info_.nexthop].reportDistance;
-  int64_t newDistance = addDistances(ld, rd);
+  CHECK(nexthopId_.has_value());
+  int64_t newDistance = getDistanceVia(*nexthopId_);
   info_.distance = newDistance;
   info_.reportDistance = newDistance;
   info_.feasibleDistance = newDistance;
 
   // send out diffusing queries
   bool success = false;
-
-  thrift::DualMessage msg;
-  msg.dstId = rootId;
-  msg.distance = info_.reportDistance;
-  msg.type = thrift::DualMessageType::QUERY;
-
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    if (kv.second == std::numeric_limits<int64_t>::max()) {
+  for (NeighborId nb = 0; nb < localDistances_.size(); ++nb) {
+    if (not neighborUp(nb)) {
       // skip down neighbor
       continue;
     }
 
-    msgsToSend[neighbor].messages.emplace_back(msg);
-    counters_[neighbor].querySent++;
-    counters_[neighbor].totalSent++;
-    info_.neighborInfos[neighbor].expectReply = true;
+    addMessage(
+        nb, thrift::DualMessageType::QUERY, info_.reportDistance, msgsToSend);
+    auto& counters = getNeighborCounters(nb);
+    counters.querySent++;
+    counters.totalSent++;
+    neighborInfos_[nb].expectReply = true;
     success = true;
   }
   return success;
@@ -247,9 +285,7 @@ Dual::diffusingComputation(
 
 void
 Dual::tryLocalOrDiffusing(
-    const DualEvent& event,
-    bool needReply,
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+    const DualEvent& event, bool needReply, DualMessagesToSend& msgsToSend) {
   auto affected = routeAffected();
   if (not affected) {
     if (needReply) {
@@ -258,7 +294,7 @@ Dual::tryLocalOrDiffusing(
     return;
   }
 
-  std::string newNexthop;
+  NeighborId newNexthop{0};
   int64_t newDistance;
   bool fc = meetFeasibleCondition(newNexthop, newDistance);
   if (not info_.nexthop.has_value()) {
@@ -282,12 +318,9 @@ Dual::tryLocalOrDiffusing(
     if (success) {
       info_.sm.processEvent(event, false);
     }
-    if (info_.nexthop.has_value() and not neighborUp(*info_.nexthop)) {
+    if (nexthopId_.has_value() and not neighborUp(*nexthopId_)) {
       // current successor is down
-      if (nexthopCb_) {
-        nexthopCb_(info_.nexthop, std::nullopt);
-      }
-      info_.nexthop = std::nullopt;
+      setNexthop(std::nullopt);
     }
   }
 }
@@ -295,7 +328,7 @@ Dual::tryLocalOrDiffusing(
 std::string
 Dual::getStatusString() const noexcept {
   std::vector<std::string> counterStrs;
-  for (const auto& kv : counters_) {
+  for (const auto& kv : getCounters()) {
     const auto& neighbor = kv.first;
     const auto& counters = kv.second;
     counterStrs.emplace_back(folly::sformat(
@@ -320,14 +353,20 @@ Dual::getStatusString() const noexcept {
 
 std::map<std::string, thrift::DualPerRootCounters>
 Dual::getCounters() const noexcept {
-  return counters_;
+  std::map<std::string, thrift::DualPerRootCounters> counters;
+  for (NeighborId nb = 0; nb < counters_.size(); ++nb) {
+    if (counters_[nb].has_value()) {
+      counters.emplace(neighborNames_[nb], *counters_[nb]);
+    }
+  }
+  return counters;
 }
 
 void
-Dual::clearCounters(const std::string& neighbor) noexcept {
-  if (counters_.count(neighbor) == 0) {
+Dual::clearCounters(NeighborId neighbor) noexcept {
+  if (not counters_[neighbor].has_value()) {
     LOG(WARNING) << "clearCounters called on non-existing neighbor "
-                 << neighbor;
+                 << neighborNames_[neighbor];
     return;
   }
   counters_[neighbor] = thrift::DualPerRootCounters();
@@ -357,11 +396,9 @@ Dual::children() const noexcept {
 }
 
 bool
-Dual::neighborUp(const std::string& neighbor) {
-  if (localDistances_.count(neighbor) == 0) {
-    return false;
-  }
-  return localDistances_.at(neighbor) != std::numeric_limits<int64_t>::max();
+Dual::neighborUp(NeighborId neighbor) const {
+  return localDistances_[neighbor].has_value() and
+      *localDistances_[neighbor] != std::numeric_limits<int64_t>::max();
 }
 
 const Dual::RouteInfo&
@@ -400,39 +437,35 @@ Dual::addDistances(int64_t d1, int64_t d2) {
 
 void
 Dual::peerUp(
-    const std::string& neighbor,
-    int64_t cost,
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
-  LOG(INFO) << rootId << "::" << nodeId << ": LINK UP event from (" << neighbor
-            << ", " << cost << ")";
+    NeighborId neighbor, int64_t cost, DualMessagesToSend& msgsToSend) {
+  ensureNeighbor(neighbor);
+  LOG(INFO) << rootId << "::" << nodeId << ": LINK UP event from ("
+            << neighborNames_[neighbor] << ", " << cost << ")";
 
   // reset parent, if I chose this neighbor as parent before, but I didn't
   // receive peer-down event(non-graceful shutdown), reset nexthop and distance
   // as-if we received peer-down event before.
-  if (info_.nexthop.has_value() and *info_.nexthop == neighbor) {
-    if (nexthopCb_) {
-      nexthopCb_(info_.nexthop, std::nullopt);
-    }
-    info_.nexthop = std::nullopt;
+  if (isNexthop(neighbor)) {
+    setNexthop(std::nullopt);
     info_.distance = std::numeric_limits<int64_t>::max();
   }
 
   // update local-distance
   localDistances_[neighbor] = cost;
-  info_.neighborInfos.emplace(neighbor, NeighborInfo());
+  auto& neighborInfo = neighborInfos_[neighbor];
 
   if (info_.sm.state == DualState::PASSIVE) {
     // passive
     tryLocalOrDiffusing(DualEvent::OTHERS, false, msgsToSend);
   } else {
     // active
-    if (info_.neighborInfos[neighbor].expectReply) {
+    if (neighborInfo.expectReply) {
       // I expected a reply from this neighbor before and it just came up
       // this is equivlent to receiving a reply
 
       thrift::DualMessage msg;
       msg.dstId = rootId;
-      msg.distance = info_.neighborInfos[neighbor].reportDistance;
+      msg.distance = neighborInfo.reportDistance;
       msg.type = thrift::DualMessageType::REPLY;
       processReply(neighbor, msg, msgsToSend);
     }
@@ -441,43 +474,41 @@ Dual::peerUp(
   // send neighbor all route-table entries whose report-distance is valid
   // NOTE: here we might already send neighbor a update from tryLocalOrDiffusing
   // (2nd update will just be ignored by our neighbor)
-
-  thrift::DualMessage msg;
-  msg.dstId = rootId;
-  msg.distance = info_.reportDistance;
-  msg.type = thrift::DualMessageType::UPDATE;
-  msgsToSend[neighbor].messages.emplace_back(std::move(msg));
-  counters_[neighbor].updateSent++;
-  counters_[neighbor].totalSent++;
-
-  if (info_.neighborInfos[neighbor].needToReply) {
-    info_.neighborInfos.at(neighbor).needToReply = false;
-
-    thrift::DualMessage reply;
-    reply.dstId = rootId;
-    reply.distance = info_.reportDistance;
-    reply.type = thrift::DualMessageType::REPLY;
-    msgsToSend[neighbor].messages.emplace_back(std::move(reply));
-    counters_[neighbor].replySent++;
-    counters_[neighbor].totalSent++;
+  addMessage(
+      neighbor,
+      thrift::DualMessageType::UPDATE,
+      info_.reportDistance,
+      msgsToSend);
+  auto& counters = getNeighborCounters(neighbor);
+  counters.updateSent++;
+  counters.totalSent++;
+
+  if (neighborInfo.needToReply) {
+    neighborInfo.needToReply = false;
+    addMessage(
+        neighbor,
+        thrift::DualMessageType::REPLY,
+        info_.reportDistance,
+        msgsToSend);
+    counters.replySent++;
+    counters.totalSent++;
   }
 }
 
 void
-Dual::peerDown(
-    const std::string& neighbor,
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+Dual::peerDown(NeighborId neighbor, DualMessagesToSend& msgsToSend) {
+  ensureNeighbor(neighbor);
   LOG(INFO) << rootId << "::" << nodeId << ": LINK DOWN event from "
-            << neighbor;
+            << neighborNames_[neighbor];
   // clear counters
   clearCounters(neighbor);
 
   // remove child
-  removeChild(neighbor);
+  removeChild(neighborNames_[neighbor]);
 
   // update local-distance and report-distance
   localDistances_[neighbor] = std::numeric_limits<int64_t>::max();
-  info_.neighborInfos[neighbor].reportDistance =
+  neighborInfos_[neighbor].reportDistance =
       std::numeric_limits<int64_t>::max();
   DualEvent event = DualEvent::INCREASE_D;
 
@@ -487,7 +518,7 @@ Dual::peerDown(
   } else {
     // active
     info_.sm.processEvent(event);
-    if (info_.neighborInfos[neighbor].expectReply) {
+    if (neighborInfos_[neighbor].expectReply) {
       // expecting a reply from this neighbor, but it goes down
       // equivlent to receing a reply from this guy with max-distance.
 
@@ -502,13 +533,13 @@ Dual::peerDown(
 
 void
 Dual::peerCostChange(
-    const std::string& neighbor,
-    int64_t cost,
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+    NeighborId neighbor, int64_t cost, DualMessagesToSend& msgsToSend) {
+  ensureNeighbor(neighbor);
   LOG(INFO) << rootId << "::" << nodeId << ": LINK COST event from ("
-            << neighbor << ", " << cost << ")";
-  DualEvent event = cost > localDistances_[neighbor] ? DualEvent::INCREASE_D
-                                                     : DualEvent::OTHERS;
+            << neighborNames_[neighbor] << ", " << cost << ")";
+  DualEvent event = cost > localDistances_[neighbor].value_or(0)
+      ? DualEvent::INCREASE_D
+      : DualEvent::OTHERS;
   // update local-distance
   localDistances_[neighbor] = cost;
 
@@ -518,9 +549,8 @@ Dual::peerCostChange(
   } else {
     // active
     // only update d while leaving rd, fd as-is
-    if (info_.nexthop.has_value() and *info_.nexthop == neighbor) {
-      info_.distance = addDistances(
-          cost, info_.neighborInfos[*info_.nexthop].reportDistance);
+    if (isNexthop(neighbor)) {
+      info_.distance = getDistanceVia(neighbor);
     }
     info_.sm.processEvent(event);
   }
@@ -528,23 +558,25 @@ Dual::peerCostChange(
 
 void
 Dual::processUpdate(
-    const std::string& neighbor,
+    NeighborId neighbor,
     const thrift::DualMessage& update,
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+    DualMessagesToSend& msgsToSend) {
+  ensureNeighbor(neighbor);
   CHECK(update.type == thrift::DualMessageType::UPDATE);
   CHECK_EQ(update.dstId, rootId) << "received update dst-id: " << update.dstId
                                  << " != my-root-id: " << rootId;
 
   const auto& rd = update.distance;
-  VLOG(2) << rootId << "::" << nodeId << ": received UPDATE from (" << neighbor
-          << ", " << rd << ")";
-  counters_[neighbor].updateRecv++;
-  counters_[neighbor].totalRecv++;
+  VLOG(2) << rootId << "::" << nodeId << ": received UPDATE from ("
+          << neighborNames_[neighbor] << ", " << rd << ")";
+  auto& counters = getNeighborCounters(neighbor);
+  counters.updateRecv++;
+  counters.totalRecv++;
 
   // update report-distance
-  info_.neighborInfos[neighbor].reportDistance = rd;
+  neighborInfos_[neighbor].reportDistance = rd;
 
-  if (localDistances_.count(neighbor) == 0) {
+  if (not localDistances_[neighbor].has_value()) {
     // received UPDATE before having local info_ (LINK-UP), done here
     return;
   }
@@ -555,19 +587,18 @@ Dual::processUpdate(
   } else {
     // active
     // only update d while leaving rd, fd as-is
-    if (info_.nexthop.has_value() and *info_.nexthop == neighbor) {
-      info_.distance = addDistances(localDistances_[*info_.nexthop], rd);
+    if (isNexthop(neighbor)) {
+      info_.distance = getDistanceVia(neighbor);
     }
     info_.sm.processEvent(DualEvent::OTHERS);
   }
 }
 
 void
-Dual::sendReply(
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+Dual::sendReply(DualMessagesToSend& msgsToSend) {
   CHECK_GT(info_.cornet.size(), 0) << "send reply called on empty cornet";
 
-  std::string dstNode = info_.cornet.top();
+  NeighborId dstNode = info_.cornet.top();
   info_.cornet.pop();
 
   if (not neighborUp(dstNode)) {
@@ -578,40 +609,42 @@ Dual::sendReply(
     // 2. link is up on the other end, I received a query, but I haven't
     //    received a neighbor-up event yet. set pending-reply = true so when
     //    link is up on my end, I can send out reply.
-    info_.neighborInfos[dstNode].needToReply = true;
+    neighborInfos_[dstNode].needToReply = true;
     return;
   }
 
-  thrift::DualMessage msg;
-  msg.dstId = rootId;
-  msg.distance = info_.reportDistance;
-  msg.type = thrift::DualMessageType::REPLY;
-
-  msgsToSend[dstNode].messages.emplace_back(std::move(msg));
-  counters_[dstNode].replySent++;
-  counters_[dstNode].totalSent++;
+  addMessage(
+      dstNode,
+      thrift::DualMessageType::REPLY,
+      info_.reportDistance,
+      msgsToSend);
+  auto& counters = getNeighborCounters(dstNode);
+  counters.replySent++;
+  counters.totalSent++;
 }
 
 void
 Dual::processQuery(
-    const std::string& neighbor,
+    NeighborId neighbor,
     const thrift::DualMessage& query,
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+    DualMessagesToSend& msgsToSend) {
+  ensureNeighbor(neighbor);
   CHECK(query.type == thrift::DualMessageType::QUERY);
   CHECK_EQ(query.dstId, rootId) << "received query dst-id: " << query.dstId
                                 << " != my-root-id: " << rootId;
 
   const auto& rd = query.distance;
-  VLOG(2) << rootId << "::" << nodeId << ": received QUERY from (" << neighbor
-          << ", " << rd << ")";
-  counters_[neighbor].queryRecv++;
-  counters_[neighbor].totalRecv++;
+  VLOG(2) << rootId << "::" << nodeId << ": received QUERY from ("
+          << neighborNames_[neighbor] << ", " << rd << ")";
+  auto& counters = getNeighborCounters(neighbor);
+  counters.queryRecv++;
+  counters.totalRecv++;
 
   // update report-distance
-  info_.neighborInfos[neighbor].reportDistance = rd;
+  neighborInfos_[neighbor].reportDistance = rd;
   info_.cornet.emplace(neighbor);
   DualEvent event = DualEvent::OTHERS;
-  if (info_.nexthop.has_value() and *info_.nexthop == neighbor) {
+  if (isNexthop(neighbor)) {
     event = DualEvent::QUERY_FROM_SUCCESSOR;
   }
 
@@ -620,10 +653,8 @@ Dual::processQuery(
     tryLocalOrDiffusing(event, true /* need reply */, msgsToSend);
   } else {
     // active
-    if (info_.nexthop.has_value() and *info_.nexthop == neighbor) {
-      info_.distance = addDistances(
-          localDistances_[*info_.nexthop],
-          info_.neighborInfos[*info_.nexthop].reportDistance);
+    if (isNexthop(neighbor)) {
+      info_.distance = getDistanceVia(neighbor);
     }
     info_.sm.processEvent(event);
     sendReply(msgsToSend);
@@ -632,40 +663,41 @@ Dual::processQuery(
 
 void
 Dual::processReply(
-    const std::string& neighbor,
+    NeighborId neighbor,
     const thrift::DualMessage& reply,
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+    DualMessagesToSend& msgsToSend) {
+  ensureNeighbor(neighbor);
   CHECK(reply.type == thrift::DualMessageType::REPLY);
   CHECK_EQ(reply.dstId, rootId) << "received reply dst-id: " << reply.dstId
                                 << " != my-root-id: " << rootId;
 
   const auto& reportDistance = reply.distance;
-  VLOG(2) << rootId << "::" << nodeId << ": received REPLY from (" << neighbor
-          << ", " << reportDistance << ")";
-  counters_[neighbor].replyRecv++;
-  counters_[neighbor].totalRecv++;
-
-  if (not info_.neighborInfos[neighbor].expectReply) {
+  VLOG(2) << rootId << "::" << nodeId << ": received REPLY from ("
+          << neighborNames_[neighbor] << ", " << reportDistance << ")";
+  auto& counters = getNeighborCounters(neighbor);
+  counters.replyRecv++;
+  counters.totalRecv++;
+
+  auto& neighborInfo = neighborInfos_[neighbor];
+  if (not neighborInfo.expectReply) {
     // received a reply when I don't expect to receive a reply from it
     // this is OK, this can happen when I detect link-down event before I
     // receive the reply, just ignore it.
-    VLOG(2) << rootId << "::" << nodeId << " recv REPLY from " << neighbor
+    VLOG(2) << rootId << "::" << nodeId << " recv REPLY from "
+            << neighborNames_[neighbor]
             << " while I dont expect a reply, ignore it";
     return;
   }
 
   // active
   // update report-distance and expect-reply flag
-  info_.neighborInfos[neighbor].reportDistance = reportDistance;
-  info_.neighborInfos[neighbor].expectReply = false;
+  neighborInfo.reportDistance = reportDistance;
+  neighborInfo.expectReply = false;
 
-  bool lastReply = true;
-  for (const auto& kv : info_.neighborInfos) {
-    if (kv.second.expectReply) {
-      lastReply = false;
-      break;
-    }
-  }
+  bool lastReply = std::none_of(
+      neighborInfos_.begin(), neighborInfos_.end(), [](const auto& info) {
+        return info.expectReply;
+      });
   if (not lastReply) {
     return;
   }
@@ -677,12 +709,12 @@ Dual::processReply(
 
   int64_t d;
   int64_t dmin = std::numeric_limits<int64_t>::max();
-  std::optional<std::string> newNh{std::nullopt};
-  for (const auto& kv : localDistances_) {
-    const auto& nb = kv.first;
-    const auto& ld = kv.second;
-    const auto& rd = info_.neighborInfos[nb].reportDistance;
-    d = addDistances(ld, rd);
+  std::optional<NeighborId> newNh{std::nullopt};
+  for (NeighborId nb = 0; nb < localDistances_.size(); ++nb) {
+    if (not localDistances_[nb].has_value()) {
+      continue;
+    }
+    d = getDistanceVia(nb);
     if (d < dmin) {
       dmin = d;
       newNh = nb;
@@ -692,12 +724,7 @@ Dual::processReply(
   info_.distance = dmin;
   info_.reportDistance = dmin;
   info_.feasibleDistance = dmin;
-  if (info_.nexthop != newNh) {
-    if (nexthopCb_) {
-      nexthopCb_(info_.nexthop, newNh);
-    }
-    info_.nexthop = newNh;
-  }
+  setNexthop(newNh);
   if (not sameRd) {
     floodUpdates(msgsToSend);
   }
@@ -720,15 +747,27 @@ DualNode::DualNode(const std::string& nodeId, bool isRoot)
   }
 }
 
+NeighborId
+DualNode::getNeighborId(const std::string& neighbor) {
+  auto [it, inserted] = neighborIds_.emplace(neighbor, neighborNames_.size());
+  if (inserted) {
+    neighborNames_.emplace_back(neighbor);
+    localDistances_.emplace_back(std::nullopt);
+    counters_.emplace_back(std::nullopt);
+  }
+  return it->second;
+}
+
 void
 DualNode::peerUp(const std::string& neighbor, int64_t cost) {
+  const auto neighborId = getNeighborId(neighbor);
   // update local-distance
-  localDistances_[neighbor] = cost;
+  localDistances_[neighborId] = cost;
 
-  std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
+  DualMessagesToSend msgsToSend(neighborNames_.size());
 
   for (auto& kv : duals_) {
-    kv.second.peerUp(neighbor, cost, msgsToSend);
+    kv.second.peerUp(neighborId, cost, msgsToSend);
   }
 
   sendAllDualMessages(msgsToSend);
@@ -736,15 +775,16 @@ DualNode::peerUp(const std::string& neighbor, int64_t cost) {
 
 void
 DualNode::peerDown(const std::string& neighbor) {
+  const auto neighborId = getNeighborId(neighbor);
   // update local-distance
-  localDistances_[neighbor] = std::numeric_limits<int64_t>::max();
+  localDistances_[neighborId] = std::numeric_limits<int64_t>::max();
   // clear counters
   clearCounters(neighbor);
 
-  std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
+  DualMessagesToSend msgsToSend(neighborNames_.size());
 
   for (auto& kv : duals_) {
-    kv.second.peerDown(neighbor, msgsToSend);
+    kv.second.peerDown(neighborId, msgsToSend);
   }
 
   sendAllDualMessages(msgsToSend);
@@ -752,13 +792,14 @@ DualNode::peerDown(const std::string& neighbor) {
 
 void
 DualNode::peerCostChange(const std::string& neighbor, int64_t cost) {
+  const auto neighborId = getNeighborId(neighbor);
   // update local-distance
-  localDistances_[neighbor] = cost;
+  localDistances_[neighborId] = cost;
 
-  std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
+  DualMessagesToSend msgsToSend(neighborNames_.size());
 
   for (auto& kv : duals_) {
-    kv.second.peerCostChange(neighbor, cost, msgsToSend);
+    kv.second.peerCostChange(neighborId, cost, msgsToSend);
   }
 
   sendAllDualMessages(msgsToSend);
@@ -817,11 +858,33 @@ DualNode::getSptPeers(const std::optional<std::string>& rootId) const noexcept {
 
 void
 DualNode::processDualMessages(const thrift::DualMessages& messages) {
-  std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
-  const auto& neighbor = messages.srcId;
+  getNeighborId(messages.srcId);
+  DualMessagesToSend msgsToSend(neighborNames_.size());
+  processDualMessagesFrom(messages, msgsToSend);
+  sendAllDualMessages(msgsToSend);
+}
+
+void
+DualNode::processDualMessages(const std::vector<thrift::DualMessages>& batch) {
+  // intern all senders first, msgsToSend covers all neighbors
+  for (const auto& messages : batch) {
+    getNeighborId(messages.srcId);
+  }
+  DualMessagesToSend msgsToSend(neighborNames_.size());
+  for (const auto& messages : batch) {
+    processDualMessagesFrom(messages, msgsToSend);
+  }
+  sendAllDualMessages(msgsToSend);
+}
+
+void
+DualNode::processDualMessagesFrom(
+    const thrift::DualMessages& messages, DualMessagesToSend& msgsToSend) {
+  const auto neighbor = getNeighborId(messages.srcId);
 
-  counters_[neighbor].pktRecv++;
-  counters_[neighbor].msgRecv += messages.messages.size();
+  auto& counters = getNeighborCounters(neighbor);
+  counters.pktRecv++;
+  counters.msgRecv += messages.messages.size();
 
   for (const auto& msg : messages.messages) {
     const auto& rootId = msg.dstId;
@@ -846,8 +909,6 @@ DualNode::processDualMessages(const thrift::DualMessages& messages) {
     }
     }
   }
-
-  sendAllDualMessages(msgsToSend);
 }
 
 std::optional<Dual::RouteInfo>
@@ -879,9 +940,12 @@ DualNode::getStatusString(const std::string& rootId) const noexcept {
 std::pair<std::string, std::unordered_map<std::string, std::string>>
 DualNode::getStatusStrings() const noexcept {
   std::vector<std::string> strs;
-  for (const auto& kv : counters_) {
-    const auto& neighbor = kv.first;
-    const auto& counters = kv.second;
+  for (NeighborId nb = 0; nb < counters_.size(); ++nb) {
+    if (not counters_[nb].has_value()) {
+      continue;
+    }
+    const auto& neighbor = neighborNames_[nb];
+    const auto& counters = *counters_[nb];
     strs.emplace_back(folly::sformat(
         "{}: pkt ({}, {}), msg ({}, {})",
         neighbor,
@@ -902,16 +966,22 @@ DualNode::getStatusStrings() const noexcept {
 
 bool
 DualNode::neighborUp(const std::string& neighbor) const noexcept {
-  if (localDistances_.count(neighbor) == 0) {
+  auto it = neighborIds_.find(neighbor);
+  if (it == neighborIds_.end()) {
     return false;
   }
-  return localDistances_.at(neighbor) != std::numeric_limits<int64_t>::max();
+  const auto& ld = localDistances_[it->second];
+  return ld.has_value() and *ld != std::numeric_limits<int64_t>::max();
 }
 
 thrift::DualCounters
 DualNode::getCounters() const noexcept {
   thrift::DualCounters counters;
-  counters.neighborCounters = counters_;
+  for (NeighborId nb = 0; nb < counters_.size(); ++nb) {
+    if (counters_[nb].has_value()) {
+      counters.neighborCounters.emplace(neighborNames_[nb], *counters_[nb]);
+    }
+  }
   for (const auto& kv : duals_) {
     counters.rootCounters.emplace(kv.first, kv.second.getCounters());
   }
@@ -920,33 +990,80 @@ DualNode::getCounters() const noexcept {
 
 void
 DualNode::clearCounters(const std::string& neighbor) noexcept {
-  if (counters_.count(neighbor) == 0) {
+  auto it = neighborIds_.find(neighbor);
+  if (it == neighborIds_.end() or not counters_[it->second].has_value()) {
     LOG(WARNING) << "clearCounters called on non-existing neighbor "
                  << neighbor;
     return;
   }
-  counters_[neighbor] = thrift::DualPerNeighborCounters();
+  counters_[it->second] = thrift::DualPerNeighborCounters();
+}
+
+size_t
+DualNode::dedupUpdates(thrift::DualMessages& msgs) {
+  auto& messages = msgs.messages;
+  if (messages.size() < 2) {
+    return 0;
+  }
+
+  // walk backwards, roots whose next message is an UPDATE
+  std::unordered_set<std::string> updateFollows;
+  std::vector<bool> superseded(messages.size(), false);
+  size_t numSuperseded{0};
+  for (size_t i = messages.size(); i-- > 0;) {
+    const auto& msg = messages[i];
+    if (msg.type != thrift::DualMessageType::UPDATE) {
+      updateFollows.erase(msg.dstId);
+      continue;
+    }
+    if (not updateFollows.emplace(msg.dstId).second) {
+      superseded[i] = true;
+      ++numSuperseded;
+    }
+  }
+  if (numSuperseded == 0) {
+    return 0;
+  }
+
+  size_t j = 0;
+  for (size_t i = 0; i < messages.size(); ++i) {
+    if (not superseded[i]) {
+      if (i != j) {
+        messages[j] = std::move(messages[i]);
+      }
+      ++j;
+    }
+  }
+  messages.resize(j);
+  return numSuperseded;
 }
 
 void
-DualNode::sendAllDualMessages(
-    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
-  for (auto& kv : msgsToSend) {
-    const auto& neighbor = kv.first;
-    auto& msgs = kv.second;
+DualNode::sendAllDualMessages(DualMessagesToSend& msgsToSend) {
+  for (NeighborId nb = 0; nb < msgsToSend.size(); ++nb) {
+    const auto& neighbor = neighborNames_[nb];
+    auto& msgs = msgsToSend[nb];
     if (msgs.messages.empty()) {
       // ignore empty messages
       continue;
     }
 
+    // receiver only needs the latest report-distance of a root
+    const auto numSuperseded = dedupUpdates(msgs);
+    if (numSuperseded > 0) {
+      VLOG(2) << nodeId << ": dropped " << numSuperseded
+              << " superseded updates to " << neighbor;
+    }
+
     // set srcId = myNodeId
     msgs.srcId = nodeId;
     if (not sendDualMessages(neighbor, msgs)) {
-      LOG(ERROR) << "failed to send dual messages to " << kv.first;
+      LOG(ERROR) << "failed to send dual messages to " << neighbor;
       continue;
     }
-    counters_[neighbor].pktSent++;
-    counters_[neighbor].msgSent += msgs.messages.size();
+    auto& counters = getNeighborCounters(nb);
+    counters.pktSent++;
+    counters.msgSent += msgs.messages.size();
   }
 }
 
@@ -961,7 +1078,18 @@ DualNode::addDual(const std::string& rootId) {
                        const std::optional<std::string>& newNh) {
     processNexthopChange(rootId, oldNh, newNh);
   };
-  duals_.emplace(rootId, Dual(nodeId, rootId, localDistances_, nexthopCb));
+  duals_.emplace(
+      rootId,
+      Dual(nodeId, rootId, neighborNames_, localDistances_, nexthopCb));
+}
+
+thrift::DualPerNeighborCounters&
+DualNode::getNeighborCounters(NeighborId neighbor) {
+  auto& counters = counters_[neighbor];
+  if (not counters.has_value()) {
+    counters = thrift::DualPerNeighborCounters();
+  }
+  return *counters;
 }
 
 } // namespace openr
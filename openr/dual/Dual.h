@@ -9,8 +9,12 @@
 
 #include <functional>
 #include <limits>
+#include <map>
+#include <optional>
 #include <stack>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <folly/Format.h>
 
@@ -57,71 +61,77 @@ struct DualStateMachine {
   void processEvent(DualEvent event, bool fc = true);
 };
 
+// dense index of a neighbor, interned by DualNode and shared by all its roots
+using NeighborId = size_t;
+
+// dual-messages to send out, indexed by NeighborId
+using DualMessagesToSend = std::vector<thrift::DualMessages>;
+
 /**
  * DUAL (Diffusing Update Algorithm) Node
  * details refer to: https://www.cs.cornell.edu/people/egs/615/lunes93.pdf
  * This Module using DUAL to calculate shortest route towards destination root
  * This module is used internally to support multi-root, Users should use
  * class Dual directly.
+ *
+ * Neighbors are referred to by NeighborId, per neighbor state is kept in
+ * arrays indexed by it. neighborNames maps them back to node-ids, it is
+ * owned by DualNode and outlives its Duals.
  */
 class Dual {
  public:
   // constructor
-  // takes nodeId, rootId, current local-distances
+  // takes nodeId, rootId, names of interned neighbors and current
+  // local-distances indexed by NeighborId, none if neighbor is not up yet
   Dual(
       const std::string& nodeId,
       const std::string& rootId,
-      const std::unordered_map<std::string, int64_t>& localDistance,
+      const std::vector<std::string>& neighborNames,
+      const std::vector<std::optional<int64_t>>& localDistances,
       std::function<void(
           const std::optional<std::string>& oldNh,
           const std::optional<std::string>& newNh)> nexthopChangeCb);
 
   // peer up event
   // input: (neighbor-id, link-metric)
-  // output: map<neighbor-id: dual-messages-to-send>
+  // output: dual-messages-to-send per neighbor
   void peerUp(
-      const std::string& neighbor,
-      int64_t cost,
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+      NeighborId neighbor, int64_t cost, DualMessagesToSend& msgsToSend);
 
   // peer down event
   // input: (neighbor-id)
-  // output: map<neighbor-id: dual-messages-to-send>
-  void peerDown(
-      const std::string& neighbor,
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+  // output: dual-messages-to-send per neighbor
+  void peerDown(NeighborId neighbor, DualMessagesToSend& msgsToSend);
 
   // peer cost change event
   // input: (neighbor-id, new-link-metric)
-  // output: map<neighbor-id: dual-messages-to-send>
+  // output: dual-messages-to-send per neighbor
   void peerCostChange(
-      const std::string& neighbor,
-      int64_t cost,
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+      NeighborId neighbor, int64_t cost, DualMessagesToSend& msgsToSend);
 
   // process a DUAL update message
   // input: (neighbor-id, a update dual-message)
-  // output: map<neighbor-id: dual-messages-to-send>
+  // output: dual-messages-to-send per neighbor
   void processUpdate(
-      const std::string& neighbor,
+      NeighborId neighbor,
       const thrift::DualMessage& update,
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+      DualMessagesToSend& msgsToSend);
 
   // process a DUAL query message
   // input: (neighbor-id, a query dual-message)
-  // output: map<neighbor-id: dual-messages-to-send>
+  // output: dual-messages-to-send per neighbor
   void processQuery(
-      const std::string& neighbor,
+      NeighborId neighbor,
       const thrift::DualMessage& query,
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+      DualMessagesToSend& msgsToSend);
 
   // process a DUAL reply message
   // input: (neighbor-id, a reply dual-message)
-  // output: map<neighbor-id: dual-messages-to-send>
+  // output: dual-messages-to-send per neighbor
   void processReply(
-      const std::string& neighbor,
+      NeighborId neighbor,
       const thrift::DualMessage& reply,
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+      DualMessagesToSend& msgsToSend);
 
   // Neighbor information per destination
   struct NeighborInfo {
@@ -148,10 +158,8 @@ class Dual {
     std::optional<std::string> nexthop{std::nullopt};
     // state machine
     DualStateMachine sm;
-    // neighbor exchanged information <report-distance, expect-reply-flag>
-    std::unordered_map<std::string, NeighborInfo> neighborInfos;
     // diffusing: track received query
-    std::stack<std::string> cornet{};
+    std::stack<NeighborId> cornet{};
 
     // dump route info into human-friendly string mainly for logging or
     // debugging
@@ -228,60 +236,93 @@ class Dual {
 
  private:
   // get minimum distance towards root
-  int64_t getMinDistance();
+  int64_t getMinDistance() const;
 
   // check if my route-to-root is affected
-  bool routeAffected();
+  bool routeAffected() const;
 
   // check if meet the feasible condition or not according to SNC (source node
   // condition)
   // if we can find a neighbor whose report-distance < my-feasible-distance
   // AND local-distance + report-distance == current minimum-distance
   // return true, otherwise return false
-  bool meetFeasibleCondition(std::string& nexthop, int64_t& distance);
+  bool meetFeasibleCondition(NeighborId& nexthop, int64_t& distance) const;
 
   // flood updates to all my neighbor
-  void floodUpdates(
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+  void floodUpdates(DualMessagesToSend& msgsToSend);
 
   // perform a local computation
   void localComputation(
-      const std::string& newNexthop,
+      NeighborId newNexthop,
       int64_t newDistance,
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+      DualMessagesToSend& msgsToSend);
 
   // start diffuing computation (when not meet feasible condition)
-  bool diffusingComputation(
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+  bool diffusingComputation(DualMessagesToSend& msgsToSend);
 
   // perform local or diffusing computation depends on if FC is met
   // if needReply: send reply back
   void tryLocalOrDiffusing(
-      const DualEvent& event,
-      bool needReply,
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+      const DualEvent& event, bool needReply, DualMessagesToSend& msgsToSend);
 
   // helper to add two distances
   static int64_t addDistances(int64_t d1, int64_t d2);
 
   // send a reply back
-  void sendReply(
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+  void sendReply(DualMessagesToSend& msgsToSend);
+
+  // add a dual-message of my root to send to neighbor
+  void addMessage(
+      NeighborId neighbor,
+      thrift::DualMessageType type,
+      int64_t distance,
+      DualMessagesToSend& msgsToSend);
 
   // check if a neighbor is up or not
-  bool neighborUp(const std::string& neighbor);
+  bool neighborUp(NeighborId neighbor) const;
+
+  // check if neighbor is my current nexthop
+  bool
+  isNexthop(NeighborId neighbor) const {
+    return nexthopId_.has_value() and *nexthopId_ == neighbor;
+  }
+
+  // set nexthop, notify nexthopCb_ if it changed
+  void setNexthop(std::optional<NeighborId> nexthop);
+
+  // local-distance plus report-distance of neighbor
+  int64_t
+  getDistanceVia(NeighborId neighbor) const {
+    return addDistances(
+        *localDistances_[neighbor], neighborInfos_[neighbor].reportDistance);
+  }
+
+  // grow per neighbor arrays to cover neighbor
+  void ensureNeighbor(NeighborId neighbor);
+
+  // counters of neighbor, created if they don't exist yet
+  thrift::DualPerRootCounters& getNeighborCounters(NeighborId neighbor);
 
   // clear counters to zero for a given neighbor
-  void clearCounters(const std::string& neighbor) noexcept;
+  void clearCounters(NeighborId neighbor) noexcept;
 
   // route-info towards root
   RouteInfo info_;
 
-  // local neighbor distances
-  std::unordered_map<std::string, int64_t> localDistances_;
+  // index of info_.nexthop, none if invalid or I'm the root
+  std::optional<NeighborId> nexthopId_;
+
+  // node-ids of neighbors, owned by DualNode
+  const std::vector<std::string>& neighborNames_;
 
-  // dual messages counters map<neighbor: dual-counters>
-  std::map<std::string, thrift::DualPerRootCounters> counters_;
+  // local neighbor distances, none until neighbor is up
+  std::vector<std::optional<int64_t>> localDistances_;
+
+  // neighbor exchanged information <report-distance, expect-reply-flag>
+  std::vector<NeighborInfo> neighborInfos_;
+
+  // dual messages counters, none if nothing exchanged with neighbor yet
+  std::vector<std::optional<thrift::DualPerRootCounters>> counters_;
 
   // callback when nexthop changed
   const std::function<void(
@@ -319,6 +360,10 @@ class DualNode {
 
   virtual ~DualNode() = default;
 
+  // Duals refer to neighborNames_
+  DualNode(DualNode const&) = delete;
+  DualNode& operator=(DualNode const&) = delete;
+
   // subclass needs to implement this method to perform actual I/O operation
   // return true on success, otherwise false
   virtual bool sendDualMessages(
@@ -344,6 +389,10 @@ class DualNode {
   // process dual messages
   void processDualMessages(const thrift::DualMessages& messages);
 
+  // process dual messages received from any neighbors in one go, messages to
+  // send out are coalesced into one packet per neighbor across all roots
+  void processDualMessages(const std::vector<thrift::DualMessages>& batch);
+
   // check if a given root-id is discovered or not
   bool hasDual(const std::string& rootId);
 
@@ -384,6 +433,10 @@ class DualNode {
   // get dual related counters
   thrift::DualCounters getCounters() const noexcept;
 
+  // drop UPDATEs superseded by a later UPDATE of the same root, with no other
+  // message of the root in between. Return number of dropped messages
+  static size_t dedupUpdates(thrift::DualMessages& msgs);
+
   // myRootId
   const std::string nodeId;
 
@@ -391,9 +444,18 @@ class DualNode {
   const bool isRoot{false};
 
  private:
+  // get NeighborId of neighbor, intern it if it is new
+  NeighborId getNeighborId(const std::string& neighbor);
+
+  // counters of neighbor, created if they don't exist yet
+  thrift::DualPerNeighborCounters& getNeighborCounters(NeighborId neighbor);
+
+  // process dual messages of a neighbor, add messages to send to msgsToSend
+  void processDualMessagesFrom(
+      const thrift::DualMessages& messages, DualMessagesToSend& msgsToSend);
+
   // send out dual messages for a given <neighbor: dual-messages>
-  void sendAllDualMessages(
-      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+  void sendAllDualMessages(DualMessagesToSend& msgsToSend);
 
   // add Dual for a given root-id if not exist yet
   void addDual(const std::string& rootId);
@@ -401,14 +463,19 @@ class DualNode {
   // clear counters to zero for a given neighbor
   void clearCounters(const std::string& neighbor) noexcept;
 
-  // local distances map<neighbor: distance>
-  std::unordered_map<std::string, int64_t> localDistances_;
+  // interned neighbors, map<neighbor: NeighborId> and names by NeighborId.
+  // neighbors are never removed, down ones keep an infinite local-distance
+  std::unordered_map<std::string, NeighborId> neighborIds_;
+  std::vector<std::string> neighborNames_;
+
+  // local distances by NeighborId, none until neighbor is up
+  std::vector<std::optional<int64_t>> localDistances_;
 
   // map<root-id: Dual-object>
   std::map<std::string, Dual> duals_;
 
-  // map<neighbor-id: counters>
-  std::unordered_map<std::string, thrift::DualPerNeighborCounters> counters_;
+  // counters by NeighborId, none if nothing exchanged with neighbor yet
+  std::vector<std::optional<thrift::DualPerNeighborCounters>> counters_;
 };
 
 } // namespace openr
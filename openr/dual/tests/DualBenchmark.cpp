@@ -0,0 +1,400 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <memory>
+#include <queue>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+
+#include <openr/dual/Dual.h>
+#include <openr/tests/BenchmarkUtils.h>
+
+namespace openr {
+
+namespace {
+
+// simulated time for messages to cross a link
+const uint64_t kLinkLatency{1};
+
+// metric of all links
+const int64_t kLinkCost{1};
+
+class DualSimulator;
+
+// DualNode whose messages are delivered by the simulator
+class SimDualNode final : public DualNode {
+ public:
+  SimDualNode(const std::string& nodeId, bool isRoot, DualSimulator& sim)
+      : DualNode(nodeId, isRoot), sim_(sim) {}
+
+  bool sendDualMessages(
+      const std::string& neighbor,
+      const thrift::DualMessages& msgs) noexcept override;
+
+  void
+  processNexthopChange(
+      const std::string& /* rootId */,
+      const std::optional<std::string>& /* oldNh */,
+      const std::optional<std::string>& /* newNh */) noexcept override {}
+
+ private:
+  DualSimulator& sim_;
+};
+
+/**
+ * Discrete event simulator of DualNodes on a single thread. Messages are
+ * delivered in order of simulated time, one link latency after they were
+ * sent, and dropped if the link went down meanwhile. Time only advances
+ * with message delivery, so convergence time is the length of the longest
+ * chain of messages triggered by an event.
+ */
+class DualSimulator {
+ public:
+  void
+  addNode(const std::string& nodeId, bool isRoot) {
+    nodes_.emplace(
+        nodeId, std::make_unique<SimDualNode>(nodeId, isRoot, *this));
+  }
+
+  void
+  linkUp(const std::string& a, const std::string& b) {
+    links_.emplace(makeLink(a, b));
+    nodes_.at(a)->peerUp(b, kLinkCost);
+    nodes_.at(b)->peerUp(a, kLinkCost);
+  }
+
+  void
+  linkDown(const std::string& a, const std::string& b) {
+    links_.erase(makeLink(a, b));
+    nodes_.at(a)->peerDown(b);
+    nodes_.at(b)->peerDown(a);
+  }
+
+  void
+  send(
+      const std::string& src,
+      const std::string& dst,
+      const thrift::DualMessages& msgs) {
+    ++numPkts;
+    numMsgs += msgs.messages.size();
+    events_.push(Event{now_ + kLinkLatency, seq_++, src, dst, msgs});
+  }
+
+  // deliver messages till none is in flight, return time it took
+  uint64_t
+  run() {
+    const auto start = now_;
+    while (not events_.empty()) {
+      auto event = events_.top();
+      events_.pop();
+      now_ = event.time;
+      if (links_.count(makeLink(event.src, event.dst)) == 0) {
+        // link went down while message was in flight
+        continue;
+      }
+      nodes_.at(event.dst)->processDualMessages(event.msgs);
+    }
+    return now_ - start;
+  }
+
+  // all nodes converged for all discovered roots
+  bool
+  allPassive() const {
+    for (const auto& kv : nodes_) {
+      for (const auto& dual : kv.second->getDuals()) {
+        if (dual.second.getInfo().sm.state != DualState::PASSIVE) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  size_t numPkts{0};
+  size_t numMsgs{0};
+
+ private:
+  struct Event {
+    uint64_t time{0};
+    // order of sending, keeps delivery on a link in order
+    uint64_t seq{0};
+    std::string src;
+    std::string dst;
+    thrift::DualMessages msgs;
+
+    bool
+    operator>(const Event& other) const {
+      return std::tie(time, seq) > std::tie(other.time, other.seq);
+    }
+  };
+
+  static std::pair<std::string, std::string>
+  makeLink(const std::string& a, const std::string& b) {
+    return a < b ? std::make_pair(a, b) : std::make_pair(b, a);
+  }
+
+  std::unordered_map<std::string, std::unique_ptr<SimDualNode>> nodes_;
+  std::set<std::pair<std::string, std::string>> links_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  uint64_t now_{0};
+  uint64_t seq_{0};
+};
+
+bool
+SimDualNode::sendDualMessages(
+    const std::string& neighbor, const thrift::DualMessages& msgs) noexcept {
+  sim_.send(nodeId, neighbor, msgs);
+  return true;
+}
+
+enum class BenchTopology {
+  RING,
+  MESH,
+  CLOS,
+};
+
+enum class BenchEvent {
+  LINK_FLAP,
+  ROOT_FLAP,
+};
+
+struct Topology {
+  std::vector<std::string> nodes;
+  std::vector<std::string> roots;
+  std::vector<std::pair<std::string, std::string>> links;
+  // link to flap, for LINK_FLAP
+  std::pair<std::string, std::string> flapLink;
+};
+
+std::string
+nodeName(const std::string& prefix, size_t i) {
+  return folly::sformat("{}-{}", prefix, i);
+}
+
+// ring of `size` nodes, roots at opposite sides
+Topology
+createRing(size_t size) {
+  CHECK_GE(size, 4);
+  Topology topo;
+  for (size_t i = 0; i < size; ++i) {
+    topo.nodes.emplace_back(nodeName("node", i));
+  }
+  for (size_t i = 0; i < size; ++i) {
+    topo.links.emplace_back(topo.nodes[i], topo.nodes[(i + 1) % size]);
+  }
+  topo.roots = {topo.nodes[0], topo.nodes[size / 2]};
+  topo.flapLink = topo.links[size / 4];
+  return topo;
+}
+
+// full mesh of `size` nodes
+Topology
+createMesh(size_t size) {
+  CHECK_GE(size, 4);
+  Topology topo;
+  for (size_t i = 0; i < size; ++i) {
+    topo.nodes.emplace_back(nodeName("node", i));
+  }
+  for (size_t i = 0; i < size; ++i) {
+    for (size_t j = i + 1; j < size; ++j) {
+      topo.links.emplace_back(topo.nodes[i], topo.nodes[j]);
+    }
+  }
+  topo.roots = {topo.nodes[0], topo.nodes[1]};
+  topo.flapLink = std::make_pair(topo.nodes[0], topo.nodes[size - 1]);
+  return topo;
+}
+
+// 3-tier Clos of `numPods` pods. Four planes with four spines each, one fsw
+// per plane in each pod connected to all spines of its plane and all rsws of
+// its pod. Roots are the first spine of the first two planes
+Topology
+createClos(size_t numPods) {
+  const size_t kNumPlanes{4};
+  const size_t kSpinesPerPlane{4};
+  const size_t kRswsPerPod{16};
+
+  Topology topo;
+  for (size_t i = 0; i < kNumPlanes * kSpinesPerPlane; ++i) {
+    topo.nodes.emplace_back(nodeName("ssw", i));
+  }
+  for (size_t pod = 0; pod < numPods; ++pod) {
+    for (size_t plane = 0; plane < kNumPlanes; ++plane) {
+      const auto fsw = nodeName("fsw", pod * kNumPlanes + plane);
+      topo.nodes.emplace_back(fsw);
+      for (size_t s = 0; s < kSpinesPerPlane; ++s) {
+        topo.links.emplace_back(
+            fsw, nodeName("ssw", plane * kSpinesPerPlane + s));
+      }
+      for (size_t r = 0; r < kRswsPerPod; ++r) {
+        topo.links.emplace_back(fsw, nodeName("rsw", pod * kRswsPerPod + r));
+      }
+    }
+    for (size_t r = 0; r < kRswsPerPod; ++r) {
+      topo.nodes.emplace_back(nodeName("rsw", pod * kRswsPerPod + r));
+    }
+  }
+  topo.roots = {nodeName("ssw", 0), nodeName("ssw", kSpinesPerPlane)};
+  // uplink of first fsw towards a root
+  topo.flapLink = topo.links.front();
+  return topo;
+}
+
+Topology
+createTopology(BenchTopology topology, size_t size) {
+  switch (topology) {
+  case BenchTopology::RING:
+    return createRing(size);
+  case BenchTopology::MESH:
+    return createMesh(size);
+  case BenchTopology::CLOS:
+    return createClos(size);
+  }
+  LOG(FATAL) << "unknown topology";
+}
+
+} // namespace
+
+/**
+ * Cost of DUAL flood topology convergence after topology events
+ * 1. Create topology, bring up all links and let DUAL converge
+ * 2. Per iteration, flap a link or fail the first root (all its links go
+ *    down) and recover it. Run the simulator to convergence after each half
+ * Reported per event (half an iteration): messages and packets exchanged,
+ * simulated convergence time in link latencies. Benchmark time is the CPU of
+ * all nodes processing an event.
+ */
+static void
+BM_DualConvergence(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    BenchTopology topology,
+    size_t size,
+    BenchEvent event) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto topo = createTopology(topology, size);
+  std::set<std::string> roots(topo.roots.begin(), topo.roots.end());
+
+  DualSimulator sim;
+  for (const auto& node : topo.nodes) {
+    sim.addNode(node, roots.count(node) != 0);
+  }
+  for (const auto& link : topo.links) {
+    sim.linkUp(link.first, link.second);
+  }
+  sim.run();
+  CHECK(sim.allPassive());
+
+  // links of the failed root
+  std::vector<std::pair<std::string, std::string>> eventLinks{topo.flapLink};
+  if (event == BenchEvent::ROOT_FLAP) {
+    eventLinks.clear();
+    for (const auto& link : topo.links) {
+      if (link.first == topo.roots.front() or
+          link.second == topo.roots.front()) {
+        eventLinks.emplace_back(link);
+      }
+    }
+  }
+
+  sim.numPkts = 0;
+  sim.numMsgs = 0;
+  uint64_t convergenceTime{0};
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (const auto& link : eventLinks) {
+      sim.linkDown(link.first, link.second);
+    }
+    convergenceTime += sim.run();
+    for (const auto& link : eventLinks) {
+      sim.linkUp(link.first, link.second);
+    }
+    convergenceTime += sim.run();
+  }
+
+  suspender.rehire(); // Stop measuring time again
+  CHECK(sim.allPassive());
+  const auto numEvents = iters == 0 ? 1 : 2 * iters;
+  counters["nodes"] = topo.nodes.size();
+  counters["links"] = topo.links.size();
+  counters["msgs"] = sim.numMsgs / numEvents;
+  counters["pkts"] = sim.numPkts / numEvents;
+  counters["convergence_time"] = convergenceTime / numEvents;
+}
+
+// Parameters are the topology, its size (nodes for ring and mesh, pods for
+// Clos) and the event
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DualConvergence,
+    counters,
+    RING_1000_LINK_FLAP,
+    BenchTopology::RING,
+    1000,
+    BenchEvent::LINK_FLAP);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DualConvergence,
+    counters,
+    RING_1000_ROOT_FLAP,
+    BenchTopology::RING,
+    1000,
+    BenchEvent::ROOT_FLAP);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DualConvergence,
+    counters,
+    MESH_64_LINK_FLAP,
+    BenchTopology::MESH,
+    64,
+    BenchEvent::LINK_FLAP);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DualConvergence,
+    counters,
+    MESH_64_ROOT_FLAP,
+    BenchTopology::MESH,
+    64,
+    BenchEvent::ROOT_FLAP);
+// 16 spines + 50 pods * 20 switches
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DualConvergence,
+    counters,
+    CLOS_1016_LINK_FLAP,
+    BenchTopology::CLOS,
+    50,
+    BenchEvent::LINK_FLAP);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DualConvergence,
+    counters,
+    CLOS_1016_ROOT_FLAP,
+    BenchTopology::CLOS,
+    50,
+    BenchEvent::ROOT_FLAP);
+// 16 spines + 200 pods * 20 switches
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DualConvergence,
+    counters,
+    CLOS_4016_ROOT_FLAP,
+    BenchTopology::CLOS,
+    200,
+    BenchEvent::ROOT_FLAP);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -222,6 +222,42 @@ TEST(Dual, StateMachine) {
   EXPECT_EQ(sm.state, DualState::ACTIVE3);
 }
 
+// Superseded updates of a root are dropped unless other messages of the root
+// are in between
+TEST(Dual, DedupUpdates) {
+  auto makeMsg = [](const std::string& root,
+                    int64_t distance,
+                    thrift::DualMessageType type) {
+    thrift::DualMessage msg;
+    msg.dstId = root;
+    msg.distance = distance;
+    msg.type = type;
+    return msg;
+  };
+
+  thrift::DualMessages msgs;
+  msgs.messages = {
+      makeMsg("r1", 1, thrift::DualMessageType::UPDATE),
+      makeMsg("r2", 1, thrift::DualMessageType::UPDATE),
+      makeMsg("r1", 2, thrift::DualMessageType::UPDATE),
+      makeMsg("r2", 2, thrift::DualMessageType::QUERY),
+      makeMsg("r2", 3, thrift::DualMessageType::UPDATE),
+      makeMsg("r1", 3, thrift::DualMessageType::UPDATE),
+  };
+  EXPECT_EQ(2, DualNode::dedupUpdates(msgs));
+  ASSERT_EQ(4, msgs.messages.size());
+  EXPECT_EQ("r2", msgs.messages[0].dstId);
+  EXPECT_EQ(1, msgs.messages[0].distance);
+  EXPECT_EQ(thrift::DualMessageType::QUERY, msgs.messages[1].type);
+  EXPECT_EQ("r2", msgs.messages[2].dstId);
+  EXPECT_EQ(3, msgs.messages[2].distance);
+  EXPECT_EQ("r1", msgs.messages[3].dstId);
+  EXPECT_EQ(3, msgs.messages[3].distance);
+
+  EXPECT_EQ(0, DualNode::dedupUpdates(msgs));
+  EXPECT_EQ(4, msgs.messages.size());
+}
+
 // Dual Implementation Test Node
 class DualTestNode final : public DualNode {
  public:
@@ -1023,6 +1059,157 @@ TEST_P(DualFixture, GridTest) {
   EXPECT_TRUE(multiFailureTest(flap));
 }
 
+class DualInternFixture : public DualBaseFixture {
+ protected:
+  // sptRootId of node (blocking call)
+  std::optional<std::string>
+  getSptRootId(const std::string& node) {
+    std::optional<std::string> rootId;
+    evb->runInEventBaseThreadAndWait(
+        [&]() { rootId = nodes.at(node)->getSptRootId(); });
+    return rootId;
+  }
+
+  // expect node to reach rootId via nexthop at distance
+  void
+  expectRoute(
+      const std::string& node,
+      const std::string& rootId,
+      const std::optional<std::string>& nexthop,
+      int64_t distance) {
+    std::optional<Dual::RouteInfo> info;
+    evb->runInEventBaseThreadAndWait(
+        [&]() { info = nodes.at(node)->getInfo(rootId); });
+    ASSERT_TRUE(info.has_value()) << node << " has no root " << rootId;
+    EXPECT_EQ(nexthop, info->nexthop) << node << " -> " << rootId;
+    EXPECT_EQ(distance, info->distance) << node << " -> " << rootId;
+  }
+};
+
+/**
+ * Neighbors are interned once and keep their NeighborId when they go down.
+ * Bring neighbors down and back up with another cost, and add new neighbors
+ * after roots have been discovered, so Duals size their per-neighbor state
+ * to neighbors interned after them.
+ *
+ *  n0(root) --- n1 --- n2
+ *               |      |
+ *               n3 ----+   (added later)
+ */
+TEST_F(DualInternFixture, NeighborReuseAfterInterning) {
+  const auto kInf = std::numeric_limits<int64_t>::max();
+  addNode("n0", true);
+  addNode("n1", false);
+  addNode("n2", false);
+  addLink("n0", "n1", 1);
+  addLink("n1", "n2", 1);
+
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  ASSERT_TRUE(validate());
+  expectRoute("n2", "n0", "n1", 2);
+
+  // n2 loses its only neighbor
+  peerDown("n1", "n2");
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  ASSERT_TRUE(validate());
+  expectRoute("n2", "n0", std::nullopt, kInf);
+
+  // n3 is interned by n1 and n2 after they discovered root n0
+  addNode("n3", false);
+  addLink("n1", "n3", 1);
+  addLink("n3", "n2", 1);
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  ASSERT_TRUE(validate());
+  expectRoute("n3", "n0", "n1", 2);
+  expectRoute("n2", "n0", "n3", 3);
+
+  // n1 and n2 come back as neighbors under their old NeighborIds, with a
+  // higher cost than the path via n3
+  for (auto& edge : edges) {
+    if (edge.name1 == "n1" and edge.name2 == "n2") {
+      edge.weight = 5;
+    }
+  }
+  peerUp("n1", "n2", 5);
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  ASSERT_TRUE(validate());
+  expectRoute("n2", "n0", "n3", 3);
+
+  // losing n3 moves n2 back to the reused neighbor n1
+  nodeDown("n3");
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  ASSERT_TRUE(validate());
+  expectRoute("n2", "n0", "n1", 6);
+
+  nodeUp("n3");
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  ASSERT_TRUE(validate());
+  expectRoute("n2", "n0", "n3", 3);
+}
+
+/**
+ * Every root has its own Dual sharing the interned neighbors of a node.
+ * Routes towards one root must not be disturbed by events of another one.
+ *
+ *  n0(root) -1- n1 -1- n2(root)
+ *   |                   |
+ *   4 ------- n3 ------ 1
+ */
+TEST_F(DualInternFixture, MultipleRoots) {
+  const auto kInf = std::numeric_limits<int64_t>::max();
+  addNode("n0", true);
+  addNode("n1", false);
+  addNode("n2", true);
+  addNode("n3", false);
+  addLink("n0", "n1", 1);
+  addLink("n1", "n2", 1);
+  addLink("n2", "n3", 1);
+  addLink("n3", "n0", 4);
+
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  ASSERT_TRUE(validate());
+  expectRoute("n0", "n0", "n0", 0);
+  expectRoute("n2", "n2", "n2", 0);
+  expectRoute("n1", "n0", "n0", 1);
+  expectRoute("n1", "n2", "n2", 1);
+  expectRoute("n3", "n0", "n2", 3);
+  expectRoute("n3", "n2", "n2", 1);
+  expectRoute("n0", "n2", "n1", 2);
+  expectRoute("n2", "n0", "n1", 2);
+
+  EXPECT_EQ("n0", getSptRootId("n3"));
+
+  // root n0 goes away, routes towards n2 stay as they are
+  nodeDown("n0");
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  ASSERT_TRUE(validate());
+  expectRoute("n1", "n0", std::nullopt, kInf);
+  expectRoute("n3", "n0", std::nullopt, kInf);
+  expectRoute("n1", "n2", "n2", 1);
+  expectRoute("n3", "n2", "n2", 1);
+  EXPECT_EQ("n2", getSptRootId("n3"));
+
+  // a link failure only reroutes towards the root it is on the path of
+  peerDown("n2", "n3");
+  nodeUp("n0");
+  /* sleep override */
+  std::this_thread::sleep_for(syncms);
+  ASSERT_TRUE(validate());
+  expectRoute("n3", "n0", "n0", 4);
+  expectRoute("n3", "n2", "n0", 6);
+  expectRoute("n1", "n0", "n0", 1);
+  expectRoute("n1", "n2", "n2", 1);
+  EXPECT_EQ("n0", getSptRootId("n3"));
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
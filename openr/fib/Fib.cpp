@@ -11,7 +11,10 @@
 #include <fbzmq/service/if/gen-cpp2/Monitor_types.h>
 #include <fbzmq/service/logging/LogSample.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Format.h>
 #include <folly/MapUtil.h>
+#include <folly/futures/Future.h>
+#include <thrift/lib/cpp/TApplicationException.h>
 #include <thrift/lib/cpp/protocol/TProtocolTypes.h>
 #include <thrift/lib/cpp/transport/THeader.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
@@ -19,11 +22,44 @@
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
+#include <openr/fib/InProcessFibClient.h>
 
 namespace fb303 = facebook::fb303;
 
 namespace openr {
 
+namespace {
+
+// add key to, or remove it from, the index entries of the interfaces of
+// nextHops
+template <typename Key>
+void
+updateInterfaceIndex(
+    std::unordered_map<std::string, std::unordered_set<Key>>& index,
+    Key const& key,
+    std::vector<thrift::NextHopThrift> const& nextHops,
+    bool add) {
+  for (auto const& nextHop : nextHops) {
+    auto const ifName = nextHop.address.ifName_ref();
+    if (not ifName.has_value()) {
+      continue;
+    }
+    if (add) {
+      index[*ifName].emplace(key);
+      continue;
+    }
+    auto const it = index.find(*ifName);
+    if (it != index.end()) {
+      it->second.erase(key);
+      if (it->second.empty()) {
+        index.erase(it);
+      }
+    }
+  }
+}
+
+} // namespace
+
 Fib::Fib(
     std::string myNodeName,
     int32_t thriftPort,
@@ -36,20 +72,48 @@ Fib::Fib(
     messaging::RQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue,
     const MonitorSubmitUrl& monitorSubmitUrl,
     KvStore* kvStore,
-    fbzmq::Context& zmqContext)
+    fbzmq::Context& zmqContext,
+    FibOptions options)
     : myNodeName_(std::move(myNodeName)),
       thriftPort_(thriftPort),
+      fibHandler_(std::move(options.fibHandler)),
       dryrun_(dryrun),
       enableSegmentRouting_(enableSegmentRouting),
       enableOrderedFib_(enableOrderedFib),
       coldStartDuration_(coldStartDuration),
+      hasDownloadPolicy_(
+          not options.downloadPrefixes.empty() or
+          not options.downloadPrefixTypes.empty()),
+      downloadPrefixTypes_(
+          options.downloadPrefixTypes.begin(),
+          options.downloadPrefixTypes.end()),
+      routeStore_(options.routeStore),
+      fibUpdatesQueue_(options.fibUpdatesQueue),
+      syncChunkSize_(options.syncChunkSize),
+      enableNextHopGroups_(options.enableNextHopGroups),
       kvStore_(kvStore),
       expBackoff_(
-          std::chrono::milliseconds(8), std::chrono::milliseconds(4096)) {
+          std::chrono::milliseconds(8), std::chrono::milliseconds(4096)),
+      retryBackoff_(
+          std::chrono::milliseconds(8), std::chrono::milliseconds(4096)),
+      keepAliveBackoff_(
+          std::chrono::milliseconds(8), Constants::kKeepAliveCheckInterval) {
   syncRoutesTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
+    // route updates in flight could be applied after the full sync, wait for
+    // them. The last one to complete schedules the sync again
+    if (numPendingRouteBatches_ or chunkedSync_) {
+      LOG(INFO) << "Delaying full sync until " << numPendingRouteBatches_
+                << " route update batches complete";
+      return;
+    }
     if (routeState_.hasRoutesFromDecision) {
-      if (syncRouteDb()) {
-        hasSyncedFib_ = true;
+      if (adoptedRoutes_) {
+        reconcileAdoptedRoutes();
+      } else if (syncChunkSize_ and not dryrun_) {
+        // completes asynchronously, failures schedule it again
+        startChunkedSync();
+      } else if (syncRouteDb()) {
+        setFibSynced();
         expBackoff_.reportSuccess();
       } else {
         // Apply exponential backoff and schedule next run
@@ -62,6 +126,16 @@ Fib::Fib(
         "fib.require_routedb_sync", syncRoutesTimer_->isScheduled());
   });
 
+  retryFailedRoutesTimer_ = folly::AsyncTimeout::make(
+      *getEvb(), [this]() noexcept { retryFailedRoutes(); });
+
+  for (auto const& prefix : options.criticalPrefixes) {
+    criticalPrefixes_.insert(prefix, true);
+  }
+  for (auto const& prefix : options.downloadPrefixes) {
+    downloadPrefixes_.insert(prefix, true);
+  }
+
   if (enableOrderedFib_) {
     // check non-empty module ptr
     CHECK(kvStore_);
@@ -74,20 +148,13 @@ Fib::Fib(
     syncRoutesTimer_->scheduleTimeout(coldStartDuration_);
   }
 
-  keepAliveTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
-    // Make thrift calls to do real programming
-    try {
-      keepAliveCheck();
-    } catch (const std::exception& e) {
-      fb303::fbData->addStatValue(
-          "fib.thrift.failure.keepalive", 1, fb303::COUNT);
-      client_.reset();
-      LOG(ERROR) << "Failed to make thrift call to Switch Agent. Error: "
-                 << folly::exceptionStr(e);
-    }
-    // schedule periodically
-    keepAliveTimer_->scheduleTimeout(Constants::kKeepAliveCheckInterval);
-  });
+  keepAliveTimer_ = folly::AsyncTimeout::make(
+      *getEvb(), [this]() noexcept { watchAgent(); });
+
+  // Before the first health check, which would take the agent for restarted
+  if (options.gracefulRestart and not dryrun_) {
+    runInEventBaseThread([this]() { adoptAgentRoutes(); });
+  }
 
   // Only schedule health checker in non dry run mode
   if (not dryrun_) {
@@ -105,7 +172,26 @@ Fib::Fib(
       }
 
       CHECK_EQ(myNodeName_, maybeThriftObj.value().thisNodeName);
-      processRouteUpdates(std::move(maybeThriftObj).value());
+      auto routeDelta = std::move(maybeThriftObj).value();
+
+      // Deltas sent by Decision meanwhile get programmed at once, instead of
+      // programming intermediate states one after the other
+      size_t numMerged = 0;
+      while (q.size()) {
+        auto maybeLater = q.get();
+        if (maybeLater.hasError()) {
+          break;
+        }
+        CHECK_EQ(myNodeName_, maybeLater.value().thisNodeName);
+        mergeRouteDbDelta(routeDelta, std::move(maybeLater).value());
+        ++numMerged;
+      }
+      if (numMerged) {
+        VLOG(1) << "Merged " << numMerged << " more route updates";
+        fb303::fbData->addStatValue(
+            "fib.coalesced_route_deltas", numMerged, fb303::SUM);
+      }
+      processRouteUpdates(std::move(routeDelta));
     }
   });
 
@@ -132,6 +218,7 @@ Fib::Fib(
   fb303::fbData->addStatExportType(
       "fib.local_route_program_time_ms", fb303::AVG);
   fb303::fbData->addStatExportType("fib.num_of_route_updates", fb303::SUM);
+  fb303::fbData->addStatExportType("fib.coalesced_route_updates", fb303::SUM);
   fb303::fbData->addStatExportType("fib.process_interface_db", fb303::COUNT);
   fb303::fbData->addStatExportType("fib.process_route_db", fb303::COUNT);
   fb303::fbData->addStatExportType("fib.sync_fib_calls", fb303::COUNT);
@@ -140,6 +227,27 @@ Fib::Fib(
   fb303::fbData->addStatExportType(
       "fib.thrift.failure.keepalive", fb303::COUNT);
   fb303::fbData->addStatExportType("fib.thrift.failure.sync_fib", fb303::COUNT);
+  fb303::fbData->addStatExportType("fib.route_failures", fb303::SUM);
+  fb303::fbData->addStatExportType("fib.suppressed_route_updates", fb303::SUM);
+
+  // route programming by the agent: latency, size and rate of batches with
+  // unicast and MPLS routes, duration and retries of full syncs
+  for (auto const& type : {"unicast", "mpls"}) {
+    const auto programMs =
+        folly::sformat("fib.route_batch_program_ms.{}", type);
+    const auto size = folly::sformat("fib.route_batch_size.{}", type);
+    const auto rate = folly::sformat("fib.route_batch_routes_per_sec.{}", type);
+    fb303::fbData->addHistogram(programMs, 10, 0, 5000);
+    fb303::fbData->exportHistogramPercentile(programMs, 50, 99, 100);
+    fb303::fbData->addHistogram(size, 100, 0, 50000);
+    fb303::fbData->exportHistogramPercentile(size, 50, 99, 100);
+    fb303::fbData->addHistogram(rate, 1000, 0, 500000);
+    fb303::fbData->exportHistogramPercentile(rate, 50, 99, 100);
+  }
+  fb303::fbData->addHistogram("fib.sync_fib_ms", 100, 0, 60000);
+  fb303::fbData->exportHistogramPercentile("fib.sync_fib_ms", 50, 99, 100);
+  fb303::fbData->addHistogram("fib.sync_fib_retries", 1, 0, 20);
+  fb303::fbData->exportHistogramPercentile("fib.sync_fib_retries", 50, 99, 100);
 }
 
 std::optional<thrift::IpPrefix>
@@ -154,11 +262,12 @@ Fib::longestPrefixMatch(
 
   // longest prefix matching
   for (const auto& route : unicastRoutes) {
-    const auto& dbIP = toIPAddress(route.first.prefixAddress);
     const auto& dbMask = route.first.prefixLength;
-
-    if (maxMask < dbMask && inputMask >= dbMask &&
-        inputIP.mask(dbMask) == dbIP) {
+    if (maxMask >= dbMask or inputMask < dbMask) {
+      continue;
+    }
+    const auto dbIP = tryToIPAddress(route.first.prefixAddress);
+    if (dbIP.has_value() and inputIP.mask(dbMask) == *dbIP) {
       maxMask = dbMask;
       matchedPrefix = route.first;
     }
@@ -166,26 +275,120 @@ Fib::longestPrefixMatch(
   return matchedPrefix;
 }
 
-folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
-Fib::getRouteDb() {
-  folly::Promise<std::unique_ptr<thrift::RouteDatabase>> p;
+void
+Fib::mergeRouteDbDelta(
+    thrift::RouteDatabaseDelta& delta, thrift::RouteDatabaseDelta&& later) {
+  auto& laterUnicastRoutes = later.unicastRoutesToUpdate;
+  laterUnicastRoutes.erase(
+      std::remove_if(
+          laterUnicastRoutes.begin(),
+          laterUnicastRoutes.end(),
+          [](thrift::UnicastRoute const& route) { return route.doNotInstall; }),
+      laterUnicastRoutes.end());
+
+  // prefixes and labels of later, earlier updates and deletes of them go
+  std::unordered_set<thrift::IpPrefix> prefixes(
+      later.unicastRoutesToDelete.begin(), later.unicastRoutesToDelete.end());
+  for (auto const& route : laterUnicastRoutes) {
+    prefixes.emplace(route.dest);
+  }
+  std::unordered_set<int32_t> labels(
+      later.mplsRoutesToDelete.begin(), later.mplsRoutesToDelete.end());
+  for (auto const& route : later.mplsRoutesToUpdate) {
+    labels.emplace(route.topLabel);
+  }
+
+  auto eraseIf = [](auto& vec, auto&& pred) {
+    vec.erase(std::remove_if(vec.begin(), vec.end(), pred), vec.end());
+  };
+  eraseIf(delta.unicastRoutesToUpdate, [&](thrift::UnicastRoute const& r) {
+    return prefixes.count(r.dest);
+  });
+  eraseIf(delta.unicastRoutesToDelete, [&](thrift::IpPrefix const& prefix) {
+    return prefixes.count(prefix);
+  });
+  eraseIf(delta.mplsRoutesToUpdate, [&](thrift::MplsRoute const& r) {
+    return labels.count(r.topLabel);
+  });
+  eraseIf(delta.mplsRoutesToDelete, [&](int32_t label) {
+    return labels.count(label);
+  });
+
+  auto append = [](auto& vec, auto&& other) {
+    vec.insert(
+        vec.end(),
+        std::make_move_iterator(other.begin()),
+        std::make_move_iterator(other.end()));
+  };
+  append(delta.unicastRoutesToUpdate, std::move(laterUnicastRoutes));
+  append(delta.unicastRoutesToDelete, std::move(later.unicastRoutesToDelete));
+  append(delta.mplsRoutesToUpdate, std::move(later.mplsRoutesToUpdate));
+  append(delta.mplsRoutesToDelete, std::move(later.mplsRoutesToDelete));
+  if (later.perfEvents.has_value()) {
+    delta.perfEvents = std::move(later.perfEvents);
+  }
+}
+
+folly::SemiFuture<std::shared_ptr<const Fib::RouteDbSnapshot>>
+Fib::getRouteDbSnapshot() {
+  folly::Promise<std::shared_ptr<const RouteDbSnapshot>> p;
   auto sf = p.getSemiFuture();
   runInEventBaseThread([p = std::move(p), this]() mutable {
-    thrift::RouteDatabase routeDb;
-    routeDb.thisNodeName = myNodeName_;
-    for (const auto& route : routeState_.unicastRoutes) {
-      routeDb.unicastRoutes.emplace_back(route.second);
-    }
-    for (const auto& route : routeState_.mplsRoutes) {
-      routeDb.mplsRoutes.emplace_back(route.second);
+    if (not routeDbSnapshot_) {
+      auto routeDb = std::make_shared<RouteDbSnapshot>();
+      routeDb->unicastRoutes.reserve(
+          routeState_.unicastRoutes.size() +
+          routeState_.suppressedUnicastRoutes.size());
+      for (const auto& route : routeState_.unicastRoutes) {
+        routeDb->unicastRoutes.emplace_back(route.second);
+      }
+      for (const auto& route : routeState_.suppressedUnicastRoutes) {
+        routeDb->unicastRoutes.emplace_back(route.second);
+      }
+      routeDb->mplsRoutes.reserve(routeState_.mplsRoutes.size());
+      for (const auto& route : routeState_.mplsRoutes) {
+        routeDb->mplsRoutes.emplace_back(route.second);
+      }
+      routeDbSnapshot_ = std::move(routeDb);
     }
-    p.setValue(std::make_unique<thrift::RouteDatabase>(std::move(routeDb)));
+    p.setValue(routeDbSnapshot_);
   });
   return sf;
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
+Fib::getRouteDb() {
+  return getRouteDbSnapshot().deferValue(
+      [nodeName = myNodeName_](std::shared_ptr<const RouteDbSnapshot> snap) {
+        auto routeDb = std::make_unique<thrift::RouteDatabase>();
+        routeDb->thisNodeName = nodeName;
+        routeDb->unicastRoutes.reserve(snap->unicastRoutes.size());
+        for (const auto& route : snap->unicastRoutes) {
+          routeDb->unicastRoutes.emplace_back(*route);
+        }
+        routeDb->mplsRoutes.reserve(snap->mplsRoutes.size());
+        for (const auto& route : snap->mplsRoutes) {
+          routeDb->mplsRoutes.emplace_back(*route);
+        }
+        return routeDb;
+      });
+}
+
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::UnicastRoute>>>
 Fib::getUnicastRoutes(std::vector<std::string> prefixes) {
+  // all routes are copied from snapshot off the Fib thread
+  if (prefixes.empty()) {
+    return getRouteDbSnapshot().deferValue(
+        [](std::shared_ptr<const RouteDbSnapshot> snap) {
+          auto routes = std::make_unique<std::vector<thrift::UnicastRoute>>();
+          routes->reserve(snap->unicastRoutes.size());
+          for (const auto& route : snap->unicastRoutes) {
+            routes->emplace_back(*route);
+          }
+          return routes;
+        });
+  }
+
   folly::Promise<std::unique_ptr<std::vector<thrift::UnicastRoute>>> p;
   auto sf = p.getSemiFuture();
   runInEventBaseThread(
@@ -198,14 +401,12 @@ Fib::getUnicastRoutes(std::vector<std::string> prefixes) {
 
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::MplsRoute>>>
 Fib::getMplsRoutes(std::vector<int32_t> labels) {
-  folly::Promise<std::unique_ptr<std::vector<thrift::MplsRoute>>> p;
-  auto sf = p.getSemiFuture();
-  runInEventBaseThread(
-      [p = std::move(p), labels = std::move(labels), this]() mutable {
-        p.setValue(std::make_unique<std::vector<thrift::MplsRoute>>(
-            getMplsRoutesFiltered(std::move(labels))));
+  return getRouteDbSnapshot().deferValue(
+      [labels = std::move(labels)](
+          std::shared_ptr<const RouteDbSnapshot> snap) mutable {
+        return std::make_unique<std::vector<thrift::MplsRoute>>(
+            getMplsRoutesFiltered(*snap, std::move(labels)));
       });
-  return sf;
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::PerfDatabase>>
@@ -223,12 +424,15 @@ Fib::getUnicastRoutesFiltered(std::vector<std::string> prefixes) {
   // return and send the vector<thrift::UnicastRoute>
   std::vector<thrift::UnicastRoute> retRouteVec;
   // the matched prefix after longest prefix matching and avoid duplicates
-  std::set<thrift::IpPrefix> matchPrefixSet;
+  std::set<IpPrefixKey> matchPrefixSet;
 
   // if the params is empty, return all routes
   if (prefixes.empty()) {
     for (const auto& routes : routeState_.unicastRoutes) {
-      retRouteVec.emplace_back(routes.second);
+      retRouteVec.emplace_back(*routes.second);
+    }
+    for (const auto& routes : routeState_.suppressedUnicastRoutes) {
+      retRouteVec.emplace_back(*routes.second);
     }
     return retRouteVec;
   }
@@ -245,30 +449,36 @@ Fib::getUnicastRoutesFiltered(std::vector<std::string> prefixes) {
     const auto inputPrefix = maybePrefix.value();
 
     // do longest prefix match, add the matched prefix to the result set
-    const auto& matchedPrefix =
-        Fib::longestPrefixMatch(inputPrefix, routeState_.unicastRoutes);
-    if (matchedPrefix.has_value()) {
-      matchPrefixSet.insert(matchedPrefix.value());
+    const auto* matchedPrefix =
+        routeState_.unicastPrefixes.longestMatch(inputPrefix);
+    if (matchedPrefix) {
+      matchPrefixSet.insert(*matchedPrefix);
     }
   }
 
   // get the routes from the prefix set
   for (const auto& prefix : matchPrefixSet) {
-    retRouteVec.emplace_back(routeState_.unicastRoutes.at(prefix));
+    auto const it = routeState_.unicastRoutes.find(prefix);
+    retRouteVec.emplace_back(
+        it != routeState_.unicastRoutes.end()
+            ? *it->second
+            : *routeState_.suppressedUnicastRoutes.at(prefix));
   }
 
   return retRouteVec;
 }
 
 std::vector<thrift::MplsRoute>
-Fib::getMplsRoutesFiltered(std::vector<int32_t> labels) {
+Fib::getMplsRoutesFiltered(
+    RouteDbSnapshot const& routeDb, std::vector<int32_t> labels) {
   // return and send the vector<thrift::MplsRoute>
   std::vector<thrift::MplsRoute> retRouteVec;
 
   // if the params is empty, return all MPLS routes
   if (labels.empty()) {
-    for (const auto& routes : routeState_.mplsRoutes) {
-      retRouteVec.emplace_back(routes.second);
+    retRouteVec.reserve(routeDb.mplsRoutes.size());
+    for (const auto& route : routeDb.mplsRoutes) {
+      retRouteVec.emplace_back(*route);
     }
     return retRouteVec;
   }
@@ -280,9 +490,9 @@ Fib::getMplsRoutesFiltered(std::vector<int32_t> labels) {
   }
 
   // get the filtered MPLS routes and avoid duplicates
-  for (const auto& routes : routeState_.mplsRoutes) {
-    if (labelFilterSet.find(routes.first) != labelFilterSet.end()) {
-      retRouteVec.emplace_back(routes.second);
+  for (const auto& route : routeDb.mplsRoutes) {
+    if (labelFilterSet.find(route->topLabel) != labelFilterSet.end()) {
+      retRouteVec.emplace_back(*route);
     }
   }
 
@@ -309,27 +519,99 @@ Fib::processRouteUpdates(thrift::RouteDatabaseDelta&& routeDelta) {
     }
   }
 
-  // Add/Update unicast routes to update
-  for (const auto& route : routeDelta.unicastRoutesToUpdate) {
-    routeState_.unicastRoutes[route.dest] = route;
-    routeState_.dirtyPrefixes.erase(route.dest);
+  // routes change, snapshot is taken again on next request
+  routeDbSnapshot_.reset();
+
+  // Add/Update unicast routes to update. Routes the download policy
+  // suppresses are kept but not programmed, they get deleted if they were
+  std::vector<thrift::UnicastRoute> unicastRoutesToUpdate;
+  std::vector<thrift::IpPrefix> suppressedRoutesToDelete;
+  size_t numSuppressed = 0;
+  for (auto& route : routeDelta.unicastRoutesToUpdate) {
+    const IpPrefixKey prefix(route.dest);
+    routeState_.unicastPrefixes.insert(toIPNetwork(route.dest), prefix);
+    routeState_.dirtyPrefixes.erase(prefix);
+    if (not isDownloaded(route)) {
+      ++numSuppressed;
+      auto const it = routeState_.unicastRoutes.find(prefix);
+      if (it != routeState_.unicastRoutes.end()) {
+        updateInterfaceIndex(
+            routeState_.ifNameToPrefixes, prefix, it->second->nextHops, false);
+        routeState_.unicastRoutes.erase(it);
+        suppressedRoutesToDelete.emplace_back(route.dest);
+      }
+      routeState_.suppressedUnicastRoutes[prefix] = routeStore_
+          ? routeStore_->share(route)
+          : std::make_shared<const thrift::UnicastRoute>(route);
+      continue;
+    }
+    routeState_.suppressedUnicastRoutes.erase(prefix);
+
+    auto& entry = routeState_.unicastRoutes[prefix];
+    if (entry) {
+      updateInterfaceIndex(
+          routeState_.ifNameToPrefixes, prefix, entry->nextHops, false);
+    }
+    // shared with Decision unless the store moved on
+    entry = routeStore_ ? routeStore_->share(route)
+                        : std::make_shared<const thrift::UnicastRoute>(route);
+    updateInterfaceIndex(
+        routeState_.ifNameToPrefixes, prefix, route.nextHops, true);
+    unicastRoutesToUpdate.emplace_back(std::move(route));
+  }
+  routeDelta.unicastRoutesToUpdate = std::move(unicastRoutesToUpdate);
+  if (numSuppressed) {
+    fb303::fbData->addStatValue(
+        "fib.suppressed_route_updates", numSuppressed, fb303::SUM);
   }
 
   // Add mpls routes to update
   for (const auto& route : routeDelta.mplsRoutesToUpdate) {
-    routeState_.mplsRoutes[route.topLabel] = route;
-    routeState_.dirtyLabels.erase(route.topLabel);
+    const uint32_t topLabel = route.topLabel;
+    auto& entry = routeState_.mplsRoutes[topLabel];
+    if (entry) {
+      updateInterfaceIndex(
+          routeState_.ifNameToLabels, topLabel, entry->nextHops, false);
+    }
+    entry = routeStore_ ? routeStore_->share(route)
+                        : std::make_shared<const thrift::MplsRoute>(route);
+    updateInterfaceIndex(
+        routeState_.ifNameToLabels, topLabel, route.nextHops, true);
+    routeState_.dirtyLabels.erase(topLabel);
   }
 
-  // Delete unicast routes
-  for (const auto& dest : routeDelta.unicastRoutesToDelete) {
-    routeState_.unicastRoutes.erase(dest);
-    routeState_.dirtyPrefixes.erase(dest);
+  // Delete unicast routes, but those suppressed which were never programmed
+  std::vector<thrift::IpPrefix> unicastRoutesToDelete;
+  for (auto& dest : routeDelta.unicastRoutesToDelete) {
+    const IpPrefixKey prefix(dest);
+    routeState_.unicastPrefixes.erase(toIPNetwork(dest));
+    routeState_.dirtyPrefixes.erase(prefix);
+    if (routeState_.suppressedUnicastRoutes.erase(prefix)) {
+      continue;
+    }
+    auto const it = routeState_.unicastRoutes.find(prefix);
+    if (it != routeState_.unicastRoutes.end()) {
+      updateInterfaceIndex(
+          routeState_.ifNameToPrefixes, prefix, it->second->nextHops, false);
+      routeState_.unicastRoutes.erase(it);
+    }
+    unicastRoutesToDelete.emplace_back(std::move(dest));
   }
+  unicastRoutesToDelete.insert(
+      unicastRoutesToDelete.end(),
+      suppressedRoutesToDelete.begin(),
+      suppressedRoutesToDelete.end());
+  routeDelta.unicastRoutesToDelete = std::move(unicastRoutesToDelete);
 
   // Delete mpls routes
-  for (const auto& topLabel : routeDelta.mplsRoutesToDelete) {
-    routeState_.mplsRoutes.erase(topLabel);
+  for (const auto& label : routeDelta.mplsRoutesToDelete) {
+    const uint32_t topLabel = label;
+    auto const it = routeState_.mplsRoutes.find(topLabel);
+    if (it != routeState_.mplsRoutes.end()) {
+      updateInterfaceIndex(
+          routeState_.ifNameToLabels, topLabel, it->second->nextHops, false);
+      routeState_.mplsRoutes.erase(it);
+    }
     routeState_.dirtyLabels.erase(topLabel);
   }
 
@@ -348,11 +630,15 @@ Fib::processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb) {
   }
 
   //
-  // Update interface states
+  // Update interface states, only routes over interfaces whose state changed
+  // are affected
   //
+  std::unordered_set<IpPrefixKey> affectedPrefixes;
+  std::unordered_set<uint32_t> affectedLabels;
   for (auto const& kv : interfaceDb.interfaces) {
     const auto& ifName = kv.first;
     const auto isUp = kv.second.isUp;
+    const bool isKnown = interfaceStatusDb_.count(ifName) != 0;
     const auto wasUp = folly::get_default(interfaceStatusDb_, ifName, false);
 
     // UP -> DOWN transition
@@ -366,7 +652,23 @@ Fib::processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb) {
 
     // Update new status
     interfaceStatusDb_[ifName] = isUp;
+    if (isKnown and wasUp == isUp) {
+      continue;
+    }
+    auto const prefixesIt = routeState_.ifNameToPrefixes.find(ifName);
+    if (prefixesIt != routeState_.ifNameToPrefixes.end()) {
+      affectedPrefixes.insert(
+          prefixesIt->second.begin(), prefixesIt->second.end());
+    }
+    auto const labelsIt = routeState_.ifNameToLabels.find(ifName);
+    if (labelsIt != routeState_.ifNameToLabels.end()) {
+      affectedLabels.insert(labelsIt->second.begin(), labelsIt->second.end());
+    }
   }
+  fb303::fbData->addStatValue(
+      "fib.interface_affected_routes",
+      affectedPrefixes.size() + affectedLabels.size(),
+      fb303::AVG);
 
   thrift::RouteDatabaseDelta routeDbDelta;
   routeDbDelta.perfEvents.move_from(std::move(interfaceDb.perfEvents));
@@ -374,8 +676,8 @@ Fib::processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb) {
   //
   // Compute unicast route changes
   //
-  for (auto const& kv : routeState_.unicastRoutes) {
-    auto const& route = kv.second;
+  for (auto const& prefix : affectedPrefixes) {
+    auto const& route = *routeState_.unicastRoutes.at(prefix);
 
     // Find valid nexthops for route
     std::vector<thrift::NextHopThrift> validNextHops;
@@ -398,7 +700,7 @@ Fib::processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb) {
       VLOG(1) << "Removing prefix " << toString(route.dest)
               << " because of no valid nextHops.";
       routeDbDelta.unicastRoutesToDelete.emplace_back(route.dest);
-      routeState_.dirtyPrefixes.emplace(route.dest); // Mark prefix as dirty
+      routeState_.dirtyPrefixes.emplace(prefix); // Mark prefix as dirty
       continue; // Skip rest
     }
 
@@ -411,19 +713,19 @@ Fib::processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb) {
       newRoute.dest = route.dest;
       newRoute.nextHops = std::move(validBestNextHops);
       routeDbDelta.unicastRoutesToUpdate.emplace_back(std::move(newRoute));
-      routeState_.dirtyPrefixes.emplace(route.dest); // Mark prefix as dirty
-    } else if (routeState_.dirtyPrefixes.count(route.dest)) {
+      routeState_.dirtyPrefixes.emplace(prefix); // Mark prefix as dirty
+    } else if (routeState_.dirtyPrefixes.count(prefix)) {
       // Nexthop group restore - previously best
       routeDbDelta.unicastRoutesToUpdate.emplace_back(route);
-      routeState_.dirtyPrefixes.erase(route.dest); // Remove from dirty list
+      routeState_.dirtyPrefixes.erase(prefix); // Remove from dirty list
     }
   } // end for ... routeDb_.unicastRoutes
 
   //
   // Compute MPLS route changes
   //
-  for (const auto& kv : routeState_.mplsRoutes) {
-    const auto& route = kv.second;
+  for (auto const& label : affectedLabels) {
+    const auto& route = *routeState_.mplsRoutes.at(label);
 
     // Find valid nexthops for route
     std::vector<thrift::NextHopThrift> validNextHops;
@@ -478,6 +780,8 @@ Fib::dumpPerfDb() const {
   for (auto const& perf : perfDb_) {
     perfDb.eventInfo.emplace_back(perf);
   }
+  perfDb.routeProgrammingStats.assign(
+      programmingStats_.begin(), programmingStats_.end());
   return perfDb;
 }
 
@@ -493,6 +797,13 @@ Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
   // update flat counters here as they depend on routeState_ and its change
   updateGlobalCounters();
 
+  // publish to subscribers of Fib as well, interface deltas bear no name
+  if (fibUpdatesQueue_ and fibUpdatesQueue_->getNumReaders()) {
+    auto delta = routeDbDelta;
+    delta.thisNodeName = myNodeName_;
+    fibUpdatesQueue_->push(std::move(delta));
+  }
+
   // Only for backward compatibility
   auto const& patchedUnicastRoutesToUpdate =
       createUnicastRoutesWithBestNexthops(routeDbDelta.unicastRoutesToUpdate);
@@ -542,7 +853,8 @@ Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
     // if so, skip partial sync
     LOG(INFO) << "Pending full sync is scheduled, skip delta sync for now...";
     return;
-  } else if (routeState_.dirtyRouteDb or not hasSyncedFib_) {
+  } else if (
+      not chunkedSync_ and (routeState_.dirtyRouteDb or not hasSyncedFib_)) {
     if (hasSyncedFib_) {
       LOG(INFO) << "Previous route programming failed or, skip delta sync to "
                 << "enforce full fib sync...";
@@ -553,41 +865,780 @@ Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
     return;
   }
 
+  // Queue updates, a later one of the same prefix or label replaces the
+  // earlier one still waiting
+  size_t numCoalesced = 0;
+  for (auto const& prefix : routeDbDelta.unicastRoutesToDelete) {
+    numCoalesced += queueUnicastRoute(prefix, std::nullopt);
+  }
+  for (auto const& route : patchedUnicastRoutesToUpdate) {
+    numCoalesced += queueUnicastRoute(route.dest, route);
+  }
+  if (enableSegmentRouting_) {
+    for (auto const& topLabel : routeDbDelta.mplsRoutesToDelete) {
+      numCoalesced += queueMplsRoute(topLabel, std::nullopt);
+    }
+    for (auto const& route : mplsRoutesToUpdate) {
+      numCoalesced += queueMplsRoute(route.topLabel, route);
+    }
+  }
+  fb303::fbData->addStatValue(
+      "fib.coalesced_route_updates", numCoalesced, fb303::SUM);
+  if (routeDbDelta.perfEvents.has_value()) {
+    waitingPerfEvents_ = routeDbDelta.perfEvents.value();
+  }
+
+  sendWaitingRoutes();
+}
+
+void
+Fib::sendWaitingRoutes() {
+  if (chunkedSync_ and not chunkedSync_->begun) {
+    // sent once beginSyncFib completes, the agent would not mark them seen
+    return;
+  }
+  while (numPendingRouteBatches_ < Constants::kFibMaxPendingRouteBatches) {
+    RouteBatch batch;
+    if (not getWaitingRouteBatch(batch) and not getSyncChunk(batch)) {
+      break;
+    }
+    sendRouteBatch(std::move(batch));
+  }
+
+  if (chunkedSync_ and chunkedSync_->begun and
+      not chunkedSync_->committing and chunkedSync_->prefixes.empty() and
+      chunkedSync_->labels.empty() and chunkedSync_->numPendingChunks == 0) {
+    commitChunkedSync();
+    return;
+  }
+
+  // everything waiting is in flight already, or nothing to program
+  if (waitingUnicastRoutes_.empty() and waitingMplsRoutes_.empty() and
+      numPendingRouteBatches_ == 0 and waitingPerfEvents_.has_value()) {
+    logPerfEvents(std::exchange(waitingPerfEvents_, std::nullopt));
+  }
+}
+
+Fib::RoutePriority
+Fib::getRoutePriority(thrift::IpPrefix const& prefix) const {
+  const auto network = toIPNetwork(prefix);
+  if (network.second == 0 or criticalPrefixes_.longestMatch(network)) {
+    return RoutePriority::CRITICAL;
+  }
+  return RoutePriority::NORMAL;
+}
+
+bool
+Fib::isDownloaded(thrift::UnicastRoute const& route) const {
+  if (not hasDownloadPolicy_) {
+    return true;
+  }
+  const auto network = toIPNetwork(route.dest);
+  if (network.second == 0 or downloadPrefixes_.longestMatch(network)) {
+    return true;
+  }
+  return route.prefixType.has_value() and
+      downloadPrefixTypes_.count(route.prefixType.value());
+}
+
+Fib::RoutePriority
+Fib::getRoutePriority(int32_t label) const {
+  if (label >= Constants::kSrGlobalRange.first and
+      label <= Constants::kSrGlobalRange.second) {
+    return RoutePriority::CRITICAL;
+  }
+  return RoutePriority::NORMAL;
+}
+
+bool
+Fib::queueUnicastRoute(
+    thrift::IpPrefix const& prefix, std::optional<thrift::UnicastRoute> route) {
+  const auto priority = getRoutePriority(prefix);
+  if (priority == RoutePriority::CRITICAL) {
+    waitingCriticalPrefixes_.emplace(prefix);
+  }
+  auto& waitingSince = waitingSince_[static_cast<size_t>(priority)];
+  if (not waitingSince.has_value()) {
+    waitingSince = std::chrono::steady_clock::now();
+  }
+  // supersedes failed update, if any
+  failedUnicastRoutes_.erase(prefix);
+  auto const res = waitingUnicastRoutes_.try_emplace(prefix, std::nullopt);
+  res.first->second = std::move(route);
+  return not res.second;
+}
+
+bool
+Fib::queueMplsRoute(int32_t label, std::optional<thrift::MplsRoute> route) {
+  const auto priority = getRoutePriority(label);
+  if (priority == RoutePriority::CRITICAL) {
+    waitingCriticalLabels_.emplace(label);
+  }
+  auto& waitingSince = waitingSince_[static_cast<size_t>(priority)];
+  if (not waitingSince.has_value()) {
+    waitingSince = std::chrono::steady_clock::now();
+  }
+  failedMplsRoutes_.erase(label);
+  auto const res = waitingMplsRoutes_.try_emplace(label, std::nullopt);
+  res.first->second = std::move(route);
+  return not res.second;
+}
+
+void
+Fib::clearWaitingRoutes() {
+  waitingUnicastRoutes_.clear();
+  waitingMplsRoutes_.clear();
+  waitingCriticalPrefixes_.clear();
+  waitingCriticalLabels_.clear();
+  waitingSince_.fill(std::nullopt);
+  failedUnicastRoutes_.clear();
+  failedMplsRoutes_.clear();
+}
+
+bool
+Fib::getWaitingRouteBatch(RouteBatch& batch) {
+  auto takeUnicastRoute = [this, &batch](auto it) {
+    if (it->second.has_value()) {
+      batch.unicastRoutesToUpdate.emplace_back(std::move(it->second).value());
+    } else {
+      batch.unicastRoutesToDelete.emplace_back(it->first);
+    }
+    return waitingUnicastRoutes_.erase(it);
+  };
+  auto takeMplsRoute = [this, &batch](auto it) {
+    if (it->second.has_value()) {
+      batch.mplsRoutesToUpdate.emplace_back(std::move(it->second).value());
+    } else {
+      batch.mplsRoutesToDelete.emplace_back(it->first);
+    }
+    return waitingMplsRoutes_.erase(it);
+  };
+
+  // critical route updates go first, in batches of their own
+  for (auto it = waitingCriticalPrefixes_.begin();
+       it != waitingCriticalPrefixes_.end();) {
+    if (not inFlightPrefixes_.emplace(*it).second) {
+      ++it;
+      continue;
+    }
+    takeUnicastRoute(waitingUnicastRoutes_.find(*it));
+    it = waitingCriticalPrefixes_.erase(it);
+  }
+  for (auto it = waitingCriticalLabels_.begin();
+       it != waitingCriticalLabels_.end();) {
+    if (not inFlightLabels_.emplace(*it).second) {
+      ++it;
+      continue;
+    }
+    takeMplsRoute(waitingMplsRoutes_.find(*it));
+    it = waitingCriticalLabels_.erase(it);
+  }
+  batch.priority = RoutePriority::CRITICAL;
+  if (batch.unicastRoutesToDelete.empty() and
+      batch.unicastRoutesToUpdate.empty() and
+      batch.mplsRoutesToDelete.empty() and batch.mplsRoutesToUpdate.empty()) {
+    // waiting critical ones, if any, are in flight and skipped below
+    batch.priority = RoutePriority::NORMAL;
+    for (auto it = waitingUnicastRoutes_.begin();
+         it != waitingUnicastRoutes_.end();) {
+      if (not inFlightPrefixes_.emplace(it->first).second) {
+        ++it;
+        continue;
+      }
+      it = takeUnicastRoute(it);
+    }
+    for (auto it = waitingMplsRoutes_.begin();
+         it != waitingMplsRoutes_.end();) {
+      if (not inFlightLabels_.emplace(it->first).second) {
+        ++it;
+        continue;
+      }
+      it = takeMplsRoute(it);
+    }
+  }
+
+  // the oldest update of the class is in the batch unless some are left
+  auto& waitingSince = waitingSince_[static_cast<size_t>(batch.priority)];
+  batch.waitingSince = waitingSince;
+  const size_t numWaitingCritical =
+      waitingCriticalPrefixes_.size() + waitingCriticalLabels_.size();
+  const size_t numWaiting =
+      waitingUnicastRoutes_.size() + waitingMplsRoutes_.size();
+  const bool classDone = batch.priority == RoutePriority::CRITICAL
+      ? numWaitingCritical == 0
+      : numWaiting == numWaitingCritical;
+  if (classDone) {
+    waitingSince.reset();
+  }
+
+  bool hasUnicastRoutes = not batch.unicastRoutesToDelete.empty() or
+      not batch.unicastRoutesToUpdate.empty();
+  if (enableNextHopGroups_) {
+    // with nothing in flight the agent applied all grouped updates, groups
+    // can be rewritten and unused ones deleted
+    const bool idle = numPendingRouteBatches_ == 0;
+    if (hasUnicastRoutes or idle) {
+      batch.groupedUpdate = nextHopGroups_.update(
+          batch.unicastRoutesToUpdate, batch.unicastRoutesToDelete, idle);
+    }
+    if (idle) {
+      batch.groupedUpdate->nextHopGroupsToDelete =
+          nextHopGroups_.takeUnusedGroups();
+    }
+    hasUnicastRoutes = hasUnicastRoutes or
+        (batch.groupedUpdate and
+         not batch.groupedUpdate->nextHopGroupsToDelete.empty());
+    if (not hasUnicastRoutes) {
+      batch.groupedUpdate.reset();
+    }
+  }
+
+  if (not hasUnicastRoutes and batch.mplsRoutesToDelete.empty() and
+      batch.mplsRoutesToUpdate.empty()) {
+    batch.waitingSince.reset();
+    return false;
+  }
+  batch.perfEvents = std::exchange(waitingPerfEvents_, std::nullopt);
+  return true;
+}
+
+bool
+Fib::getSyncChunk(RouteBatch& batch) {
+  if (not chunkedSync_ or not chunkedSync_->begun) {
+    return false;
+  }
+
+  // Routes are sent as they are now, not as they were when the sync started.
+  // Those deleted since are skipped, the agent deletes them on commit. Those
+  // with updates waiting, in flight or programmed with next-hop groups since
+  // are programmed by the update, which the agent marks as seen as well
+  std::vector<thrift::UnicastRoute> unicastRoutes;
+  auto& prefixes = chunkedSync_->prefixes;
+  while (not prefixes.empty() and unicastRoutes.size() < syncChunkSize_) {
+    auto prefix = std::move(prefixes.back());
+    prefixes.pop_back();
+    auto it = routeState_.unicastRoutes.find(IpPrefixKey(prefix));
+    if (it == routeState_.unicastRoutes.end() or
+        waitingUnicastRoutes_.count(prefix) or
+        nextHopGroups_.getGroupId(prefix) or
+        not inFlightPrefixes_.emplace(prefix).second) {
+      continue;
+    }
+    unicastRoutes.emplace_back(*it->second);
+  }
+
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  auto& labels = chunkedSync_->labels;
+  while (not labels.empty() and
+         unicastRoutes.size() + mplsRoutes.size() < syncChunkSize_) {
+    const auto label = labels.back();
+    labels.pop_back();
+    auto it = routeState_.mplsRoutes.find(label);
+    if (it == routeState_.mplsRoutes.end() or
+        waitingMplsRoutes_.count(label) or
+        not inFlightLabels_.emplace(label).second) {
+      continue;
+    }
+    mplsRoutes.emplace_back(*it->second);
+  }
+
+  if (unicastRoutes.empty() and mplsRoutes.empty()) {
+    return false;
+  }
+  batch.unicastRoutesToUpdate =
+      createUnicastRoutesWithBestNexthops(unicastRoutes);
+  batch.mplsRoutesToUpdate = createMplsRoutesWithBestNextHops(mplsRoutes);
+  batch.syncId = chunkedSync_->syncId;
+  ++chunkedSync_->numPendingChunks;
+  return true;
+}
+
+void
+Fib::sendRouteBatch(RouteBatch&& batch) {
+  const auto startTime = std::chrono::steady_clock::now();
   // Make thrift calls to do real programming
+  std::vector<folly::SemiFuture<folly::Unit>> futures;
   try {
-    uint32_t numOfRouteUpdates = 0;
-    createFibClient(evb_, socket_, client_, thriftPort_);
-    if (routeDbDelta.unicastRoutesToDelete.size()) {
-      numOfRouteUpdates += routeDbDelta.unicastRoutesToDelete.size();
-      client_->sync_deleteUnicastRoutes(
-          kFibId_, routeDbDelta.unicastRoutesToDelete);
+    createAgentClient(*getEvb(), asyncSocket_, asyncClient_);
+    if (batch.syncId.has_value()) {
+      futures.emplace_back(asyncClient_->semifuture_syncFibChunk(
+          kFibId_,
+          batch.syncId.value(),
+          batch.unicastRoutesToUpdate,
+          batch.mplsRoutesToUpdate));
     }
-    if (patchedUnicastRoutesToUpdate.size()) {
-      numOfRouteUpdates += patchedUnicastRoutesToUpdate.size();
-      client_->sync_addUnicastRoutes(kFibId_, patchedUnicastRoutesToUpdate);
+    if (batch.groupedUpdate.has_value()) {
+      futures.emplace_back(asyncClient_->semifuture_updateGroupedUnicastRoutes(
+          kFibId_, batch.groupedUpdate.value()));
+    } else {
+      if (batch.unicastRoutesToDelete.size()) {
+        futures.emplace_back(asyncClient_->semifuture_deleteUnicastRoutes(
+            kFibId_, batch.unicastRoutesToDelete));
+      }
+      if (not batch.syncId and batch.unicastRoutesToUpdate.size()) {
+        futures.emplace_back(asyncClient_->semifuture_addUnicastRoutes(
+            kFibId_, batch.unicastRoutesToUpdate));
+      }
     }
-    if (enableSegmentRouting_ && routeDbDelta.mplsRoutesToDelete.size()) {
-      numOfRouteUpdates += routeDbDelta.mplsRoutesToDelete.size();
-      client_->sync_deleteMplsRoutes(kFibId_, routeDbDelta.mplsRoutesToDelete);
+    if (batch.mplsRoutesToDelete.size()) {
+      futures.emplace_back(asyncClient_->semifuture_deleteMplsRoutes(
+          kFibId_, batch.mplsRoutesToDelete));
     }
-    if (enableSegmentRouting_ && mplsRoutesToUpdate.size()) {
-      numOfRouteUpdates += mplsRoutesToUpdate.size();
-      client_->sync_addMplsRoutes(kFibId_, mplsRoutesToUpdate);
+    if (not batch.syncId and batch.mplsRoutesToUpdate.size()) {
+      futures.emplace_back(asyncClient_->semifuture_addMplsRoutes(
+          kFibId_, batch.mplsRoutesToUpdate));
     }
+  } catch (const std::exception& e) {
+    futures.emplace_back(folly::makeSemiFuture<folly::Unit>(
+        folly::exception_wrapper(std::current_exception(), e)));
+  }
+  thrift::RouteProgrammingStats stats;
+  stats.isSyncChunk = batch.syncId.has_value();
+  stats.numMplsRoutes =
+      batch.mplsRoutesToDelete.size() + batch.mplsRoutesToUpdate.size();
+  if (batch.groupedUpdate.has_value()) {
+    // routes of rewritten groups are not sent
+    stats.numUnicastRoutes = batch.groupedUpdate->unicastRoutesToUpdate.size() +
+        batch.groupedUpdate->unicastRoutesToDelete.size();
     fb303::fbData->addStatValue(
-        "fib.num_of_route_updates", numOfRouteUpdates, fb303::SUM);
-    routeState_.dirtyRouteDb = false;
-    logPerfEvents(castToStd(routeDbDelta.perfEvents));
+        "fib.num_of_next_hop_group_updates",
+        batch.groupedUpdate->nextHopGroupsToUpdate.size(),
+        fb303::SUM);
+  } else {
+    stats.numUnicastRoutes =
+        batch.unicastRoutesToDelete.size() + batch.unicastRoutesToUpdate.size();
+  }
+  fb303::fbData->addStatValue(
+      batch.syncId ? "fib.num_of_sync_chunk_routes"
+                   : "fib.num_of_route_updates",
+      stats.numUnicastRoutes + stats.numMplsRoutes,
+      fb303::SUM);
+
+  // routes of the batch are found in flight until it completes
+  auto& prefixes = batch.unicastRoutesToDelete;
+  for (auto const& route : batch.unicastRoutesToUpdate) {
+    prefixes.emplace_back(route.dest);
+  }
+  auto& labels = batch.mplsRoutesToDelete;
+  for (auto const& route : batch.mplsRoutesToUpdate) {
+    labels.emplace_back(route.topLabel);
+  }
+  ++numPendingRouteBatches_;
+  folly::collectAllSemiFuture(std::move(futures))
+      .via(getEvb())
+      .thenValue([this,
+                  client = asyncClient_.get(),
+                  alive = std::weak_ptr<bool>(alive_),
+                  prefixes = std::move(prefixes),
+                  labels = std::move(labels),
+                  unicastRoutes = std::move(batch.unicastRoutesToUpdate),
+                  mplsRoutes = std::move(batch.mplsRoutesToUpdate),
+                  syncId = batch.syncId,
+                  priority = batch.priority,
+                  waitingSince = batch.waitingSince,
+                  perfEvents = std::move(batch.perfEvents),
+                  stats = std::move(stats),
+                  startTime](
+                     std::vector<folly::Try<folly::Unit>>&& results) mutable {
+        if (not alive.lock()) {
+          return;
+        }
+        --numPendingRouteBatches_;
+        stats.durationMs =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - startTime)
+                .count();
+        stats.success = std::all_of(
+            results.begin(), results.end(), [](auto const& result) {
+              return not result.hasException();
+            });
+        if (waitingSince.has_value() and stats.success) {
+          // from the oldest update of the batch queued until programmed
+          fb303::fbData->addStatValue(
+              priority == RoutePriority::CRITICAL
+                  ? "fib.route_programming_latency_ms.critical"
+                  : "fib.route_programming_latency_ms.normal",
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - *waitingSince)
+                  .count(),
+              fb303::AVG);
+        }
+        logProgrammingStats(std::move(stats));
+        for (auto const& prefix : prefixes) {
+          inFlightPrefixes_.erase(prefix);
+        }
+        for (auto const& label : labels) {
+          inFlightLabels_.erase(label);
+        }
+        if (syncId and chunkedSync_ and chunkedSync_->syncId == *syncId) {
+          --chunkedSync_->numPendingChunks;
+        }
+        for (auto& result : results) {
+          if (result.hasException<thrift::PlatformFibUpdateError>()) {
+            addFailedRoutes(
+                *result.exception()
+                     .get_exception<thrift::PlatformFibUpdateError>(),
+                unicastRoutes,
+                mplsRoutes);
+            result = folly::Try<folly::Unit>(folly::unit);
+          }
+        }
+        onRouteBatchDone(results, client);
+        if (not routeState_.dirtyRouteDb) {
+          logPerfEvents(std::move(perfEvents));
+        }
+      });
+}
+
+void
+Fib::onRouteBatchDone(
+    std::vector<folly::Try<folly::Unit>> const& results,
+    thrift::FibServiceAsyncClient const* client) {
+  for (auto const& result : results) {
+    if (not result.hasException()) {
+      continue;
+    }
+    fb303::fbData->addStatValue(
+        "fib.thrift.failure.add_del_route", 1, fb303::COUNT);
+    LOG(ERROR) << "Failed to make thrift call to FibAgent. Error: "
+               << result.exception().what();
+    // other batches sent with the client fail as well, reset it only once
+    if (not client or asyncClient_.get() == client) {
+      asyncClient_.reset();
+      asyncSocket_.reset();
+    }
+    if (chunkedSync_) {
+      // start over, the agent aborts it on the next beginSyncFib
+      chunkedSync_.reset();
+      expBackoff_.reportError();
+      ++numSyncRetries_;
+    }
+    routeState_.dirtyRouteDb = true;
+    break;
+  }
+
+  if (routeState_.dirtyRouteDb) {
+    // Schedule future full sync of route DB, once nothing is in flight
+    clearWaitingRoutes();
+    if (numPendingRouteBatches_ == 0 and not syncRoutesTimer_->isScheduled()) {
+      syncRoutesTimer_->scheduleTimeout(
+          expBackoff_.getTimeRemainingUntilRetry());
+    }
+    return;
+  }
+
+  if (numPendingRouteBatches_ == 0) {
+    // applied by the agent, along with all groups
+    nextHopGroups_.confirmGroups();
+    if (failedUnicastRoutes_.empty() and failedMplsRoutes_.empty() and
+        not retryFailedRoutesTimer_->isScheduled()) {
+      retryBackoff_.reportSuccess();
+    }
+  }
+  if (numPendingRouteBatches_ == 0 and waitingUnicastRoutes_.empty() and
+      waitingMplsRoutes_.empty() and not chunkedSync_) {
     LOG(INFO) << "Done processing route add/update";
+  }
+  sendWaitingRoutes();
+}
+
+void
+Fib::addFailedRoutes(
+    thrift::PlatformFibUpdateError const& error,
+    std::vector<thrift::UnicastRoute>& unicastRoutes,
+    std::vector<thrift::MplsRoute>& mplsRoutes) {
+  const auto numFailed =
+      error.failedPrefixes.size() + error.failedMplsLabels.size();
+  LOG(ERROR) << "FibAgent failed to program " << numFailed
+             << " routes, retrying them. Error: " << error.message;
+  fb303::fbData->addStatValue("fib.route_failures", numFailed, fb303::SUM);
+
+  // failed routes are deletes unless updates of the batch. Ones with newer
+  // updates waiting are superseded by those
+  for (auto const& prefix : error.failedPrefixes) {
+    if (not waitingUnicastRoutes_.count(prefix)) {
+      failedUnicastRoutes_[prefix] = std::nullopt;
+    }
+  }
+  for (auto& route : unicastRoutes) {
+    auto it = failedUnicastRoutes_.find(route.dest);
+    if (it != failedUnicastRoutes_.end()) {
+      it->second = std::move(route);
+    }
+  }
+  for (auto const& label : error.failedMplsLabels) {
+    if (not waitingMplsRoutes_.count(label)) {
+      failedMplsRoutes_[label] = std::nullopt;
+    }
+  }
+  for (auto& route : mplsRoutes) {
+    auto it = failedMplsRoutes_.find(route.topLabel);
+    if (it != failedMplsRoutes_.end()) {
+      it->second = std::move(route);
+    }
+  }
+  fb303::fbData->setCounter(
+      "fib.num_failed_routes",
+      failedUnicastRoutes_.size() + failedMplsRoutes_.size());
+
+  if (not retryFailedRoutesTimer_->isScheduled()) {
+    retryBackoff_.reportError();
+    retryFailedRoutesTimer_->scheduleTimeout(
+        retryBackoff_.getTimeRemainingUntilRetry());
+  }
+}
+
+void
+Fib::retryFailedRoutes() {
+  if (failedUnicastRoutes_.empty() and failedMplsRoutes_.empty()) {
+    return;
+  }
+  LOG(INFO) << "Retrying "
+            << failedUnicastRoutes_.size() + failedMplsRoutes_.size()
+            << " failed route updates";
+  // queueing them erases them from the failed ones
+  for (auto& kv : std::exchange(failedUnicastRoutes_, {})) {
+    queueUnicastRoute(kv.first, std::move(kv.second));
+  }
+  for (auto& kv : std::exchange(failedMplsRoutes_, {})) {
+    queueMplsRoute(kv.first, std::move(kv.second));
+  }
+  fb303::fbData->setCounter("fib.num_failed_routes", 0);
+  sendWaitingRoutes();
+}
+
+void
+Fib::startChunkedSync() {
+  CHECK(not chunkedSync_);
+  CHECK_EQ(0, numPendingRouteBatches_);
+  LOG(INFO) << "Syncing latest routeDb with fib-agent with "
+            << routeState_.unicastRoutes.size() << " routes in chunks of "
+            << syncChunkSize_;
+  fb303::fbData->addStatValue("fib.sync_fib_calls", 1, fb303::COUNT);
+
+  auto& sync = chunkedSync_.emplace();
+  sync.syncId = ++latestSyncId_;
+  sync.startTime = std::chrono::steady_clock::now();
+  sync.prefixes.reserve(routeState_.unicastRoutes.size());
+  for (auto const& kv : routeState_.unicastRoutes) {
+    sync.prefixes.emplace_back(kv.second->dest);
+  }
+  if (enableSegmentRouting_) {
+    sync.labels.reserve(routeState_.mplsRoutes.size());
+    for (auto const& kv : routeState_.mplsRoutes) {
+      sync.labels.emplace_back(kv.first);
+    }
+  }
+
+  // programmed by the sync, route updates from now on get interleaved. The
+  // agent drops all next-hop groups on beginSyncFib
+  nextHopGroups_.clear();
+  clearWaitingRoutes();
+  waitingPerfEvents_.reset();
+  routeState_.dirtyPrefixes.clear();
+  routeState_.dirtyLabels.clear();
+  routeState_.dirtyRouteDb = false;
+
+  folly::SemiFuture<folly::Unit> future = folly::makeSemiFuture();
+  try {
+    createAgentClient(*getEvb(), asyncSocket_, asyncClient_);
+    future = asyncClient_->semifuture_beginSyncFib(
+        kFibId_, sync.syncId, enableSegmentRouting_);
+  } catch (const std::exception& e) {
+    future = folly::makeSemiFuture<folly::Unit>(
+        folly::exception_wrapper(std::current_exception(), e));
+  }
+
+  ++numPendingRouteBatches_;
+  std::move(future).via(getEvb()).thenTry(
+      [this,
+       client = asyncClient_.get(),
+       alive = std::weak_ptr<bool>(alive_),
+       syncId = sync.syncId](folly::Try<folly::Unit>&& result) {
+        if (not alive.lock()) {
+          return;
+        }
+        --numPendingRouteBatches_;
+        if (not result.hasException() and chunkedSync_ and
+            chunkedSync_->syncId == syncId) {
+          chunkedSync_->begun = true;
+        }
+        onRouteBatchDone({std::move(result)}, client);
+      });
+}
+
+void
+Fib::commitChunkedSync() {
+  CHECK(chunkedSync_);
+  chunkedSync_->committing = true;
+
+  folly::SemiFuture<folly::Unit> future = folly::makeSemiFuture();
+  try {
+    createAgentClient(*getEvb(), asyncSocket_, asyncClient_);
+    future = asyncClient_->semifuture_commitSyncFib(
+        kFibId_, chunkedSync_->syncId);
   } catch (const std::exception& e) {
+    future = folly::makeSemiFuture<folly::Unit>(
+        folly::exception_wrapper(std::current_exception(), e));
+  }
+
+  ++numPendingRouteBatches_;
+  std::move(future).via(getEvb()).thenTry(
+      [this,
+       client = asyncClient_.get(),
+       alive = std::weak_ptr<bool>(alive_),
+       syncId = chunkedSync_->syncId](folly::Try<folly::Unit>&& result) {
+        if (not alive.lock()) {
+          return;
+        }
+        --numPendingRouteBatches_;
+        if (not result.hasException() and chunkedSync_ and
+            chunkedSync_->syncId == syncId) {
+          thrift::RouteProgrammingStats stats;
+          stats.isFullSync = true;
+          stats.success = true;
+          stats.numUnicastRoutes = chunkedSync_->prefixes.size();
+          stats.numMplsRoutes = chunkedSync_->labels.size();
+          stats.durationMs =
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - chunkedSync_->startTime)
+                  .count();
+          logProgrammingStats(std::move(stats));
+          chunkedSync_.reset();
+          setFibSynced();
+          expBackoff_.reportSuccess();
+          LOG(INFO) << "Done syncing latest routeDb with fib-agent";
+          fb303::fbData->setCounter(
+              "fib.require_routedb_sync", syncRoutesTimer_->isScheduled());
+        }
+        onRouteBatchDone({std::move(result)}, client);
+      });
+}
+
+void
+Fib::adoptAgentRoutes() {
+  AdoptedRoutes adopted;
+  try {
+    createAgentClient(evb_, socket_, client_);
+    const int64_t aliveSince = client_->sync_aliveSince();
+    std::vector<thrift::UnicastRoute> unicastRoutes;
+    client_->sync_getRouteTableByClient(unicastRoutes, kFibId_);
+    std::vector<thrift::MplsRoute> mplsRoutes;
+    if (enableSegmentRouting_) {
+      client_->sync_getMplsRouteTableByClient(mplsRoutes, kFibId_);
+    }
+
+    for (auto& route : unicastRoutes) {
+      adopted.unicastRoutes.emplace(
+          std::move(route.dest),
+          std::set<thrift::NextHopThrift>(
+              std::make_move_iterator(route.nextHops.begin()),
+              std::make_move_iterator(route.nextHops.end())));
+    }
+    for (auto& route : mplsRoutes) {
+      adopted.mplsRoutes.emplace(
+          route.topLabel,
+          std::set<thrift::NextHopThrift>(
+              std::make_move_iterator(route.nextHops.begin()),
+              std::make_move_iterator(route.nextHops.end())));
+    }
+    // the routes are as good as the agent that has them
+    latestAliveSince_ = aliveSince;
+  } catch (std::exception const& e) {
     fb303::fbData->addStatValue(
-        "fib.thrift.failure.add_del_route", 1, fb303::COUNT);
+        "fib.thrift.failure.get_route_table", 1, fb303::COUNT);
     client_.reset();
-    routeState_.dirtyRouteDb = true;
-    syncRouteDbDebounced(); // Schedule future full sync of route DB
-    LOG(ERROR) << "Failed to make thrift call to FibAgent. Error: "
-               << folly::exceptionStr(e);
+    LOG(ERROR) << "Failed to get routes of switch agent, falling back to "
+               << "full sync. Error: " << folly::exceptionStr(e);
+    return;
+  }
+
+  LOG(INFO) << "Adopted " << adopted.unicastRoutes.size() << " unicast and "
+            << adopted.mplsRoutes.size() << " mpls routes of switch agent";
+  fb303::fbData->setCounter(
+      "fib.adopted_unicast_routes", adopted.unicastRoutes.size());
+  fb303::fbData->setCounter(
+      "fib.adopted_mpls_routes", adopted.mplsRoutes.size());
+  adoptedRoutes_ = std::move(adopted);
+}
+
+void
+Fib::reconcileAdoptedRoutes() {
+  CHECK(adoptedRoutes_);
+  auto adopted = std::move(adoptedRoutes_).value();
+  adoptedRoutes_.reset();
+
+  // Routes the agent has already are left alone, the rest gets updated and
+  // adopted routes Decision has no longer deleted
+  size_t numUnchanged = 0;
+  for (auto const& kv : routeState_.unicastRoutes) {
+    auto const& dest = kv.second->dest;
+    auto route =
+        createUnicastRoute(dest, getBestNextHopsUnicast(kv.second->nextHops));
+    auto it = adopted.unicastRoutes.find(dest);
+    if (it != adopted.unicastRoutes.end()) {
+      const bool unchanged =
+          it->second ==
+          std::set<thrift::NextHopThrift>(
+              route.nextHops.begin(), route.nextHops.end());
+      adopted.unicastRoutes.erase(it);
+      if (unchanged) {
+        ++numUnchanged;
+        continue;
+      }
+    }
+    queueUnicastRoute(dest, std::move(route));
+  }
+  for (auto const& kv : adopted.unicastRoutes) {
+    queueUnicastRoute(kv.first, std::nullopt);
+  }
+
+  if (enableSegmentRouting_) {
+    for (auto const& kv : routeState_.mplsRoutes) {
+      auto route =
+          createMplsRoute(kv.first, getBestNextHopsMpls(kv.second->nextHops));
+      auto it = adopted.mplsRoutes.find(kv.first);
+      if (it != adopted.mplsRoutes.end()) {
+        const bool unchanged =
+            it->second ==
+            std::set<thrift::NextHopThrift>(
+                route.nextHops.begin(), route.nextHops.end());
+        adopted.mplsRoutes.erase(it);
+        if (unchanged) {
+          ++numUnchanged;
+          continue;
+        }
+      }
+      queueMplsRoute(kv.first, std::move(route));
+    }
+    for (auto const& kv : adopted.mplsRoutes) {
+      queueMplsRoute(kv.first, std::nullopt);
+    }
+  }
+
+  LOG(INFO) << "Reconciling adopted routes with routes of Decision, "
+            << numUnchanged << " unchanged and "
+            << waitingUnicastRoutes_.size() + waitingMplsRoutes_.size()
+            << " to update or delete";
+  fb303::fbData->setCounter("fib.reconciled_unchanged_routes", numUnchanged);
+  fb303::fbData->setCounter(
+      "fib.reconciled_changed_routes",
+      waitingUnicastRoutes_.size() + waitingMplsRoutes_.size());
+
+  // failures of the updates enforce a full sync like those of any update
+  setFibSynced();
+  sendWaitingRoutes();
+}
+
+void
+Fib::setFibSynced() {
+  if (not hasSyncedFib_) {
+    const auto uptime = getProcessUptime();
+    LOG(INFO) << "First sync with fib-agent done " << uptime.count()
+              << "ms after start";
+    fb303::fbData->setCounter("startup.first_fib_sync_ms", uptime.count());
   }
+  hasSyncedFib_ = true;
 }
 
 bool
@@ -595,10 +1646,18 @@ Fib::syncRouteDb() {
   LOG(INFO) << "Syncing latest routeDb with fib-agent with "
             << routeState_.unicastRoutes.size() << " routes";
 
-  const auto& unicastRoutes =
-      createUnicastRoutesWithBestNextHopsMap(routeState_.unicastRoutes);
-  const auto& mplsRoutes =
-      createMplsRoutesWithBestNextHopsMap(routeState_.mplsRoutes);
+  std::vector<thrift::UnicastRoute> unicastRoutes;
+  unicastRoutes.reserve(routeState_.unicastRoutes.size());
+  for (auto const& kv : routeState_.unicastRoutes) {
+    unicastRoutes.emplace_back(createUnicastRoute(
+        kv.second->dest, getBestNextHopsUnicast(kv.second->nextHops)));
+  }
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  mplsRoutes.reserve(routeState_.mplsRoutes.size());
+  for (auto const& kv : routeState_.mplsRoutes) {
+    mplsRoutes.emplace_back(
+        createMplsRoute(kv.first, getBestNextHopsMpls(kv.second->nextHops)));
+  }
 
   // In dry run we just print the routes. No real action
   if (dryrun_) {
@@ -624,11 +1683,23 @@ Fib::syncRouteDb() {
     return true;
   }
 
+  thrift::RouteProgrammingStats stats;
+  stats.isFullSync = true;
+  stats.numUnicastRoutes = unicastRoutes.size();
+  stats.numMplsRoutes = enableSegmentRouting_ ? mplsRoutes.size() : 0;
+  const auto startTime = std::chrono::steady_clock::now();
+  auto getDurationMs = [&startTime]() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - startTime)
+        .count();
+  };
+
   try {
-    createFibClient(evb_, socket_, client_, thriftPort_);
+    createAgentClient(evb_, socket_, client_);
     fb303::fbData->addStatValue("fib.sync_fib_calls", 1, fb303::COUNT);
 
-    // Sync unicast routes
+    // Sync unicast routes, the agent drops all next-hop groups
+    nextHopGroups_.clear();
     client_->sync_syncFib(kFibId_, unicastRoutes);
     routeState_.dirtyPrefixes.clear();
 
@@ -639,12 +1710,21 @@ Fib::syncRouteDb() {
     routeState_.dirtyLabels.clear();
 
     routeState_.dirtyRouteDb = false;
+    // programmed with the full sync
+    clearWaitingRoutes();
+    waitingPerfEvents_.reset();
     LOG(INFO) << "Done syncing latest routeDb with fib-agent";
+    stats.durationMs = getDurationMs();
+    stats.success = true;
+    logProgrammingStats(std::move(stats));
     return true;
   } catch (std::exception const& e) {
     fb303::fbData->addStatValue("fib.thrift.failure.sync_fib", 1, fb303::COUNT);
     LOG(ERROR) << "Failed to sync routeDb with switch FIB agent. Error: "
                << folly::exceptionStr(e);
+    stats.durationMs = getDurationMs();
+    logProgrammingStats(std::move(stats));
+    ++numSyncRetries_;
     routeState_.dirtyRouteDb = true;
     client_.reset();
     return false;
@@ -660,21 +1740,102 @@ Fib::syncRouteDbDebounced() {
 }
 
 void
-Fib::keepAliveCheck() {
-  createFibClient(evb_, socket_, client_, thriftPort_);
-  int64_t aliveSince = client_->sync_aliveSince();
+Fib::watchAgent() {
+  const bool longPoll = agentSupportsLongPoll_;
+  auto future = folly::makeSemiFuture<int64_t>(0);
+  try {
+    createAgentClient(*getEvb(), keepAliveSocket_, keepAliveClient_);
+    if (longPoll) {
+      // the agent holds the call for kPlatformLongPollTimeout, allow it to
+      // reply late
+      apache::thrift::RpcOptions options;
+      options.setTimeout(
+          Constants::kPlatformLongPollTimeout +
+          Constants::kPlatformRoutesProcTimeout);
+      future = keepAliveClient_->semifuture_longPollAliveSince(
+          options,
+          latestAliveSince_,
+          Constants::kPlatformLongPollTimeout.count());
+    } else {
+      future = keepAliveClient_->semifuture_aliveSince();
+    }
+  } catch (std::exception const& e) {
+    future = folly::makeSemiFuture<int64_t>(
+        folly::exception_wrapper(std::current_exception(), e));
+  }
+
+  std::move(future).via(getEvb()).thenTry(
+      [this, alive = std::weak_ptr<bool>(alive_), longPoll](
+          folly::Try<int64_t>&& result) {
+        if (not alive.lock()) {
+          return;
+        }
+        if (result.hasException()) {
+          bool unknownMethod{false};
+          result.exception().with_exception(
+              [&](apache::thrift::TApplicationException const& e) {
+                unknownMethod = e.getType() ==
+                    apache::thrift::TApplicationException::UNKNOWN_METHOD;
+              });
+          if (longPoll and unknownMethod) {
+            LOG(INFO) << "Switch agent has no longPollAliveSince, polling "
+                      << "aliveSince instead";
+            agentSupportsLongPoll_ = false;
+            keepAliveTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+            return;
+          }
+          // the agent went away, or is not up yet. Reconnect soon so that
+          // the restarted agent is found right away
+          fb303::fbData->addStatValue(
+              "fib.thrift.failure.keepalive", 1, fb303::COUNT);
+          keepAliveClient_.reset();
+          keepAliveSocket_.reset();
+          LOG(ERROR) << "Failed to make thrift call to Switch Agent. Error: "
+                     << result.exception().what();
+          keepAliveBackoff_.reportError();
+          keepAliveTimer_->scheduleTimeout(
+              keepAliveBackoff_.getTimeRemainingUntilRetry());
+          return;
+        }
+        keepAliveBackoff_.reportSuccess();
+        checkAliveSince(result.value());
+        keepAliveTimer_->scheduleTimeout(
+            longPoll ? std::chrono::milliseconds(0)
+                     : Constants::kKeepAliveCheckInterval);
+      });
+}
+
+void
+Fib::checkAliveSince(int64_t aliveSince) {
   // Check if FIB has restarted or not
   if (aliveSince != latestAliveSince_) {
     LOG(WARNING) << "FibAgent seems to have restarted. "
                  << "Performing full route DB sync ...";
-    // set dirty flag
+    // set dirty flag, a chunked sync in progress has been lost with the agent
     routeState_.dirtyRouteDb = true;
+    chunkedSync_.reset();
+    adoptedRoutes_.reset();
     expBackoff_.reportSuccess();
     syncRouteDbDebounced();
   }
   latestAliveSince_ = aliveSince;
 }
 
+void
+Fib::createAgentClient(
+    folly::EventBase& evb,
+    std::shared_ptr<folly::AsyncSocket>& socket,
+    std::unique_ptr<thrift::FibServiceAsyncClient>& client) {
+  if (not fibHandler_) {
+    createFibClient(evb, socket, client, thriftPort_);
+    return;
+  }
+  // no connection to break, the client is reset on failures only
+  if (not client) {
+    client = std::make_unique<InProcessFibClient>(fibHandler_);
+  }
+}
+
 void
 Fib::createFibClient(
     folly::EventBase& evb,
@@ -721,6 +1882,8 @@ Fib::updateGlobalCounters() {
       "fib.num_unicast_routes", routeState_.unicastRoutes.size());
   fb303::fbData->setCounter(
       "fib.num_mpls_routes", routeState_.mplsRoutes.size());
+  fb303::fbData->setCounter(
+      "fib.num_suppressed_routes", routeState_.suppressedUnicastRoutes.size());
   fb303::fbData->setCounter(
       "fib.num_dirty_prefixes", routeState_.dirtyPrefixes.size());
   fb303::fbData->setCounter(
@@ -729,13 +1892,32 @@ Fib::updateGlobalCounters() {
   // Count the number of bgp routes
   int64_t bgpCounter = 0;
   for (const auto& route : routeState_.unicastRoutes) {
-    if (route.second.bestNexthop.has_value()) {
+    if (route.second->bestNexthop.has_value()) {
       bgpCounter++;
     }
   }
   fb303::fbData->setCounter("fib.num_routes.BGP", bgpCounter);
 }
 
+void
+Fib::addPerfStageHistogramValues(const thrift::PerfEvents& perfEvents) {
+  for (auto const& [stage, duration] :
+       getPerfEventsStageDurations(perfEvents)) {
+    const auto key = folly::sformat("fib.perf.{}_ms", stage);
+    if (not perfStageHistograms_.count(key)) {
+      // event names come from the network, keep the number of stages bounded
+      if (perfStageHistograms_.size() >= Constants::kMaxPerfStageHistograms) {
+        continue;
+      }
+      fb303::fbData->addHistogram(
+          key, 10, 0, Constants::kConvergenceMaxDuration.count() * 1000);
+      fb303::fbData->exportHistogramPercentile(key, 50, 99, 100);
+      perfStageHistograms_.emplace(key);
+    }
+    fb303::fbData->addHistogramValue(key, duration.count());
+  }
+}
+
 void
 Fib::logPerfEvents(std::optional<thrift::PerfEvents> perfEvents) {
   if (not perfEvents.has_value() or not perfEvents->events.size()) {
@@ -797,6 +1979,8 @@ Fib::logPerfEvents(std::optional<thrift::PerfEvents> perfEvents) {
     VLOG(2) << "  " << str;
   }
 
+  addPerfStageHistogramValues(*perfEvents);
+
   // Add new entry to perf DB and purge extra entries
   perfDb_.push_back(std::move(perfEvents).value());
   while (perfDb_.size() >= Constants::kPerfBufferSize) {
@@ -819,4 +2003,42 @@ Fib::logPerfEvents(std::optional<thrift::PerfEvents> perfEvents) {
       {sample.toJson()}));
 }
 
+void
+Fib::logProgrammingStats(thrift::RouteProgrammingStats&& stats) {
+  stats.unixTs = getUnixTimeStampMs();
+  if (stats.isFullSync) {
+    if (stats.success) {
+      stats.numRetries = numSyncRetries_;
+      numSyncRetries_ = 0;
+      fb303::fbData->addHistogramValue("fib.sync_fib_ms", stats.durationMs);
+      fb303::fbData->addHistogramValue(
+          "fib.sync_fib_retries", stats.numRetries);
+    }
+  } else if (stats.success) {
+    // unicast and MPLS routes of a batch are sent in parallel calls, the
+    // batch completes with the slowest one
+    for (auto const& kv :
+         {std::make_pair("unicast", stats.numUnicastRoutes),
+          std::make_pair("mpls", stats.numMplsRoutes)}) {
+      if (kv.second == 0) {
+        continue;
+      }
+      fb303::fbData->addHistogramValue(
+          folly::sformat("fib.route_batch_program_ms.{}", kv.first),
+          stats.durationMs);
+      fb303::fbData->addHistogramValue(
+          folly::sformat("fib.route_batch_size.{}", kv.first), kv.second);
+      fb303::fbData->addHistogramValue(
+          folly::sformat("fib.route_batch_routes_per_sec.{}", kv.first),
+          kv.second * 1000 / std::max<int64_t>(1, stats.durationMs));
+    }
+  }
+
+  // Add new entry to perf DB and purge extra entries
+  programmingStats_.emplace_back(std::move(stats));
+  while (programmingStats_.size() > Constants::kFibProgrammingStatsBufferSize) {
+    programmingStats_.pop_front();
+  }
+}
+
 } // namespace openr
@@ -7,9 +7,12 @@
 
 #pragma once
 
+#include <array>
+
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Try.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBase.h>
@@ -17,16 +20,45 @@
 
 #include <openr/common/ExponentialBackoff.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/PrefixTrie.h>
+#include <openr/common/RouteStore.h>
 #include <openr/common/Util.h>
+#include <openr/fib/NextHopGroupTable.h>
 #include <openr/if/gen-cpp2/FibService.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
 #include <openr/if/gen-cpp2/LinkMonitor_types.h>
 #include <openr/if/gen-cpp2/Platform_types.h>
 #include <openr/kvstore/KvStoreClientInternal.h>
 #include <openr/messaging/Queue.h>
+#include <openr/messaging/ReplicateQueue.h>
 
 namespace openr {
 
+/**
+ * Optional features of Fib, set by name on top of the defaults, e.g.
+ * options.gracefulRestart = true
+ */
+struct FibOptions {
+  // routes per chunk of a full sync, 0 to sync all of them at once
+  size_t syncChunkSize{0};
+  bool enableNextHopGroups{false};
+  bool gracefulRestart{false};
+  // route updates of prefixes within these are programmed first
+  std::vector<folly::CIDRNetwork> criticalPrefixes;
+  // routes sent by Decision, shared with it. nullptr to keep a copy
+  const RouteStore* routeStore{nullptr};
+  // agent in the same process, called directly instead of over thrift on
+  // thriftPort. Must implement the future_ flavor of FibService
+  std::shared_ptr<thrift::FibServiceSvIf> fibHandler;
+  // route updates get published to, as they are programmed
+  messaging::ReplicateQueue<thrift::RouteDatabaseDelta>* fibUpdatesQueue{
+      nullptr};
+  // download policy, only unicast routes of prefixes within these or of
+  // these types get programmed, along with default routes. Empty for all
+  std::vector<folly::CIDRNetwork> downloadPrefixes;
+  std::vector<thrift::PrefixType> downloadPrefixTypes;
+};
+
 /**
  * Proxy agent to program computed routes using platform dependent agent (e.g.
  * FBOSS in case of Wedge Platform).
@@ -60,7 +92,8 @@ class Fib final : public OpenrEventBase {
       messaging::RQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue,
       const MonitorSubmitUrl& monitorSubmitUrl,
       KvStore* kvStore,
-      fbzmq::Context& zmqContext);
+      fbzmq::Context& zmqContext,
+      FibOptions options = {});
 
   /**
    * Utility function to create thrift client connection to SwitchAgent. Can
@@ -74,7 +107,8 @@ class Fib final : public OpenrEventBase {
       int32_t port);
 
   /**
-   * Perform longest prefix match among all prefixes in route database.
+   * Perform longest prefix match among all prefixes in route database. Scans
+   * all of them, use a PrefixTrie for repeated lookups instead.
    * @param inputPrefix - a prefix that need to be matched
    * @param unicastRoutes - current unicast routes in RouteDatabase
    *
@@ -85,8 +119,38 @@ class Fib final : public OpenrEventBase {
       const std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute>&
           unicastRoutes);
 
+  /**
+   * Merge a later route delta into an earlier one, so that processing the
+   * result once leaves the same routes as processing both one after the
+   * other. The later route update or delete of each prefix and label replaces
+   * the earlier one, except for doNotInstall updates, which are skipped by
+   * processing anyway. Perf events of the later delta win if it has any.
+   */
+  static void mergeRouteDbDelta(
+      thrift::RouteDatabaseDelta& delta, thrift::RouteDatabaseDelta&& later);
+
+  /**
+   * Immutable snapshot of all routes received from Decision. Routes are shared
+   * with the route state of Fib, taking it copies references only.
+   */
+  struct RouteDbSnapshot {
+    std::vector<std::shared_ptr<const thrift::UnicastRoute>> unicastRoutes;
+    std::vector<std::shared_ptr<const thrift::MplsRoute>> mplsRoutes;
+  };
+
+  /**
+   * Retrieve snapshot of current routes. It is taken once after each route
+   * change and shared by all requests till the next one.
+   */
+  folly::SemiFuture<std::shared_ptr<const RouteDbSnapshot>>
+  getRouteDbSnapshot();
+
   /**
    * NOTE: DEPRECATED! Use getUnicastRoutes or getMplsRoutes.
+   *
+   * Returned routes as well as unfiltered ones of getUnicastRoutes and
+   * getMplsRoutes are copied from snapshot by the continuation, i.e. on the
+   * thread of the caller rather than on the Fib thread.
    */
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>> getRouteDb();
 
@@ -137,10 +201,10 @@ class Fib final : public OpenrEventBase {
       std::vector<std::string> prefixes);
 
   /**
-   * Retrieve mpls routes with specified filters
+   * Retrieve mpls routes of snapshot with specified filters
    */
-  std::vector<thrift::MplsRoute> getMplsRoutesFiltered(
-      std::vector<int32_t> labels);
+  static std::vector<thrift::MplsRoute> getMplsRoutesFiltered(
+      RouteDbSnapshot const& routeDb, std::vector<int32_t> labels);
 
   /**
    * Trigger add/del routes thrift calls
@@ -149,6 +213,91 @@ class Fib final : public OpenrEventBase {
    */
   void updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta);
 
+  /**
+   * Classes of route updates, programmed in this order. Critical ones are
+   * updates of default routes, of routes within criticalPrefixes and of node
+   * label routes, which the control plane depends on
+   */
+  enum class RoutePriority { CRITICAL = 0, NORMAL = 1 };
+  static constexpr size_t kNumRoutePriorities{2};
+
+  RoutePriority getRoutePriority(thrift::IpPrefix const& prefix) const;
+  RoutePriority getRoutePriority(int32_t label) const;
+
+  // whether the download policy has the route programmed, see ctor
+  bool isDownloaded(thrift::UnicastRoute const& route) const;
+
+  // queue route update of prefix or label, at most one waits per prefix and
+  // label. Returns true if it replaced the waiting one
+  bool queueUnicastRoute(
+      thrift::IpPrefix const& prefix,
+      std::optional<thrift::UnicastRoute> route);
+  bool queueMplsRoute(int32_t label, std::optional<thrift::MplsRoute> route);
+
+  void clearWaitingRoutes();
+
+  // Routes sent to the agent together
+  struct RouteBatch {
+    std::vector<thrift::IpPrefix> unicastRoutesToDelete;
+    std::vector<thrift::UnicastRoute> unicastRoutesToUpdate;
+    std::vector<int32_t> mplsRoutesToDelete;
+    std::vector<thrift::MplsRoute> mplsRoutesToUpdate;
+    // set for chunks of a chunked sync
+    std::optional<int64_t> syncId;
+    // unicast routes to update and delete, with next-hop groups, sent
+    // instead if set
+    std::optional<thrift::GroupedRouteUpdate> groupedUpdate;
+    std::optional<thrift::PerfEvents> perfEvents;
+    // class of the route updates and since when the oldest of them waited.
+    // Unset for chunks and batches of next-hop group deletes only
+    RoutePriority priority{RoutePriority::NORMAL};
+    std::optional<std::chrono::steady_clock::time_point> waitingSince;
+  };
+
+  /**
+   * Send waiting route updates and chunks of the chunked sync in progress to
+   * the agent, as long as fewer than kFibMaxPendingRouteBatches are in
+   * flight. Updates of prefixes and labels in flight wait for those to
+   * complete
+   */
+  void sendWaitingRoutes();
+
+  // fill batch with waiting route updates of the first class that has some
+  // to send, false if none can be sent
+  bool getWaitingRouteBatch(RouteBatch& batch);
+
+  // fill batch with the next chunk of the chunked sync, false if none
+  bool getSyncChunk(RouteBatch& batch);
+
+  void sendRouteBatch(RouteBatch&& batch);
+
+  /**
+   * Record route updates of a batch the agent failed to program, and retry
+   * them with increasing backoff. The rest of the batch is programmed, so
+   * unlike other failures these don't take a full sync
+   */
+  void addFailedRoutes(
+      thrift::PlatformFibUpdateError const& error,
+      std::vector<thrift::UnicastRoute>& unicastRoutes,
+      std::vector<thrift::MplsRoute>& mplsRoutes);
+  void retryFailedRoutes();
+
+  /**
+   * Handle completion of requests sent with asyncClient_, failures schedule a
+   * full sync. Failed routes reported with PlatformFibUpdateError are taken
+   * care of by addFailedRoutes before
+   */
+  void onRouteBatchDone(
+      std::vector<folly::Try<folly::Unit>> const& results,
+      thrift::FibServiceAsyncClient const* client);
+
+  /**
+   * Full sync in chunks of syncChunkSize_ routes. Chunks are sent along with
+   * route updates by sendWaitingRoutes, the last one completing commits it
+   */
+  void startChunkedSync();
+  void commitChunkedSync();
+
   /**
    * Sync the current routeDb_ with the switch agent.
    * on success no action needed
@@ -156,6 +305,25 @@ class Fib final : public OpenrEventBase {
    */
   bool syncRouteDb();
 
+  /**
+   * Graceful restart: adopt routes the agent still has programmed for Open/R
+   * from before the restart, instead of replacing all of them with a full
+   * sync. Failing to get them leaves the full sync in place
+   */
+  void adoptAgentRoutes();
+
+  /**
+   * Program the difference between routes from Decision and the adopted
+   * ones as route updates. Used instead of the first full sync
+   */
+  void reconcileAdoptedRoutes();
+
+  /**
+   * Full sync with the switch agent succeeded. Exports time of the first one
+   * since the process started as startup.first_fib_sync_ms
+   */
+  void setFibSynced();
+
   /**
    * Asynchrounsly schedules the syncRouteDb call and returns immediately. All
    * APIs should call this function to sync-routes.
@@ -163,10 +331,20 @@ class Fib final : public OpenrEventBase {
   void syncRouteDbDebounced();
 
   /**
-   * Get aliveSince from FibService, and check if Fib restarts
-   * If so, push syncFib to FibService
+   * Watch the agent for restarts with a longPollAliveSince call outstanding,
+   * so that restarts are reacted on as soon as it is back. Agents without
+   * the API are polled for aliveSince every kKeepAliveCheckInterval instead
    */
-  void keepAliveCheck();
+  void watchAgent();
+
+  // full sync if aliveSince tells the agent restarted
+  void checkAliveSince(int64_t aliveSince);
+
+  // createFibClient, or a client of fibHandler_ if the agent is in-process
+  void createAgentClient(
+      folly::EventBase& evb,
+      std::shared_ptr<folly::AsyncSocket>& socket,
+      std::unique_ptr<thrift::FibServiceAsyncClient>& client);
 
   // set flat counter/stats
   void updateGlobalCounters();
@@ -174,12 +352,43 @@ class Fib final : public OpenrEventBase {
   // log perf events
   void logPerfEvents(std::optional<thrift::PerfEvents> perfEvents);
 
+  // add durations of the stages of perf events to their histograms
+  void addPerfStageHistogramValues(const thrift::PerfEvents& perfEvents);
+
+  // export histograms of route programming and keep stats in perf DB
+  void logProgrammingStats(thrift::RouteProgrammingStats&& stats);
+
   // Prefix to available nexthop information. Also store perf information of
   // received route-db if provided.
   struct RouteState {
-    // Non modified copy of Unicast and MPLS routes received from Decision
-    std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute> unicastRoutes;
-    std::unordered_map<uint32_t, thrift::MplsRoute> mplsRoutes;
+    // Non modified copy of Unicast and MPLS routes received from Decision.
+    // Routes are immutable, they get shared with route db snapshots
+    std::unordered_map<
+        IpPrefixKey,
+        std::shared_ptr<const thrift::UnicastRoute>>
+        unicastRoutes;
+    std::unordered_map<uint32_t, std::shared_ptr<const thrift::MplsRoute>>
+        mplsRoutes;
+
+    // Unicast routes received from Decision which the download policy
+    // suppresses. Kept for the route views like getRouteDb, never programmed
+    std::unordered_map<
+        IpPrefixKey,
+        std::shared_ptr<const thrift::UnicastRoute>>
+        suppressedUnicastRoutes;
+
+    // prefixes of unicastRoutes and suppressedUnicastRoutes, for longest
+    // prefix match
+    PrefixTrie<IpPrefixKey> unicastPrefixes;
+
+    // prefixes and labels of routes with next-hops over each interface, so
+    // that interface events visit the routes over affected interfaces only
+    std::unordered_map<
+        std::string /* ifName */,
+        std::unordered_set<IpPrefixKey>>
+        ifNameToPrefixes;
+    std::unordered_map<std::string /* ifName */, std::unordered_set<uint32_t>>
+        ifNameToLabels;
 
     // indicates we've received a decision route publication and therefore have
     // routes to sync. will not synce routes with system until this is set
@@ -192,7 +401,7 @@ class Fib final : public OpenrEventBase {
     // - receiving new route for prefix or label
     // - full route sync happens
     // - interface up event happens for disabled nexthop
-    std::unordered_set<thrift::IpPrefix> dirtyPrefixes;
+    std::unordered_set<IpPrefixKey> dirtyPrefixes;
     std::unordered_set<uint32_t> dirtyLabels;
 
     // Flag to indicate the result of previous route programming attempt.
@@ -203,12 +412,25 @@ class Fib final : public OpenrEventBase {
   };
   RouteState routeState_;
 
-  // Events to capture and indicate performance of protocol convergence.
+  // Snapshot of routes of routeState_, taken on request and reset on change
+  std::shared_ptr<const RouteDbSnapshot> routeDbSnapshot_;
+
+  // Latest perf events, kept as samples. Durations of all perf events are
+  // aggregated in histograms of their stages
   std::deque<thrift::PerfEvents> perfDb_;
 
+  // Stages of perf events a histogram got added for
+  std::unordered_set<std::string> perfStageHistograms_;
+
   // Create timestamp of recently logged perf event
   int64_t recentPerfEventCreateTs_{0};
 
+  // Latest route batches and full syncs programmed by the agent
+  std::deque<thrift::RouteProgrammingStats> programmingStats_;
+
+  // full syncs failed since the last successful one
+  int32_t numSyncRetries_{0};
+
   // Interface status map
   std::unordered_map<std::string /* ifName*/, bool /* isUp */>
       interfaceStatusDb_;
@@ -219,6 +441,9 @@ class Fib final : public OpenrEventBase {
   // Switch agent thrift server port
   const int32_t thriftPort_{0};
 
+  // Switch agent in the same process, nullptr to use thriftPort_
+  const std::shared_ptr<thrift::FibServiceSvIf> fibHandler_{nullptr};
+
   // In dry run we do not make actual thrift call to manipulate routes
   bool dryrun_{true};
 
@@ -240,6 +465,74 @@ class Fib final : public OpenrEventBase {
   std::shared_ptr<folly::AsyncSocket> socket_{nullptr};
   std::unique_ptr<thrift::FibServiceAsyncClient> client_{nullptr};
 
+  // Connection to switch FIB Agent for asynchronous route updates, on the
+  // event base of Fib
+  std::shared_ptr<folly::AsyncSocket> asyncSocket_{nullptr};
+  std::unique_ptr<thrift::FibServiceAsyncClient> asyncClient_{nullptr};
+
+  // Route updates waiting to be sent, the latest one of each prefix and
+  // label. Routes to delete have no value. Cleared by full sync
+  std::unordered_map<thrift::IpPrefix, std::optional<thrift::UnicastRoute>>
+      waitingUnicastRoutes_;
+  std::unordered_map<int32_t, std::optional<thrift::MplsRoute>>
+      waitingMplsRoutes_;
+  std::optional<thrift::PerfEvents> waitingPerfEvents_;
+
+  // prefixes and labels of waiting route updates by class, but the normal
+  // ones which are the rest, and since when the oldest of each class waits
+  std::unordered_set<thrift::IpPrefix> waitingCriticalPrefixes_;
+  std::unordered_set<int32_t> waitingCriticalLabels_;
+  std::array<
+      std::optional<std::chrono::steady_clock::time_point>,
+      kNumRoutePriorities>
+      waitingSince_;
+
+  // see RoutePriority
+  PrefixTrie<bool> criticalPrefixes_;
+
+  // see isDownloaded
+  const bool hasDownloadPolicy_{false};
+  PrefixTrie<bool> downloadPrefixes_;
+  const std::unordered_set<thrift::PrefixType> downloadPrefixTypes_;
+
+  // see ctor
+  const RouteStore* routeStore_{nullptr};
+  messaging::ReplicateQueue<thrift::RouteDatabaseDelta>* fibUpdatesQueue_{
+      nullptr};
+
+  // Prefixes and labels of route update batches in flight. At most one
+  // update per prefix and label is in flight, so the agent gets them in order
+  std::unordered_set<thrift::IpPrefix> inFlightPrefixes_;
+  std::unordered_set<int32_t> inFlightLabels_;
+  size_t numPendingRouteBatches_{0};
+
+  // Routes per chunk of a full sync, 0 to sync all of them with a single
+  // syncFib and syncMplsFib call instead
+  const size_t syncChunkSize_{0};
+
+  // Chunked full sync in progress
+  struct ChunkedSync {
+    int64_t syncId{0};
+    // set once beginSyncFib completed, nothing else is sent before
+    bool begun{false};
+    bool committing{false};
+    // prefixes and labels to send, as of the start of the sync
+    std::vector<thrift::IpPrefix> prefixes;
+    std::vector<int32_t> labels;
+    size_t numPendingChunks{0};
+    std::chrono::steady_clock::time_point startTime;
+  };
+  std::optional<ChunkedSync> chunkedSync_;
+  int64_t latestSyncId_{0};
+
+  // Program unicast route updates with next-hop groups. Full syncs program
+  // routes without, and the agent drops all groups on them
+  const bool enableNextHopGroups_{false};
+  NextHopGroupTable nextHopGroups_;
+
+  // expires with Fib, callbacks of batches outliving it are skipped
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
+
   // module ptr to refer to KvStore for KvStoreClientInternal usage
   KvStore* kvStore_{nullptr};
 
@@ -248,8 +541,23 @@ class Fib final : public OpenrEventBase {
   std::unique_ptr<folly::AsyncTimeout> syncRoutesTimer_{nullptr};
   ExponentialBackoff<std::chrono::milliseconds> expBackoff_;
 
-  // periodically send alive msg to switch agent
+  // Route updates the agent failed to program, retried with backoff unless
+  // newer updates of their prefix or label are queued. Routes to delete have
+  // no value. Cleared by full sync
+  std::unordered_map<thrift::IpPrefix, std::optional<thrift::UnicastRoute>>
+      failedUnicastRoutes_;
+  std::unordered_map<int32_t, std::optional<thrift::MplsRoute>>
+      failedMplsRoutes_;
+  std::unique_ptr<folly::AsyncTimeout> retryFailedRoutesTimer_{nullptr};
+  ExponentialBackoff<std::chrono::milliseconds> retryBackoff_;
+
+  // watch the agent for restarts, see watchAgent
   std::unique_ptr<folly::AsyncTimeout> keepAliveTimer_{nullptr};
+  std::shared_ptr<folly::AsyncSocket> keepAliveSocket_{nullptr};
+  std::unique_ptr<thrift::FibServiceAsyncClient> keepAliveClient_{nullptr};
+  // false once the agent turned out not to support longPollAliveSince
+  bool agentSupportsLongPoll_{true};
+  ExponentialBackoff<std::chrono::milliseconds> keepAliveBackoff_;
 
   // client to interact with monitor
   std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
@@ -263,6 +571,15 @@ class Fib final : public OpenrEventBase {
   // moves to true after initial sync
   bool hasSyncedFib_{false};
 
+  // Routes the agent had programmed for Open/R on startup, till reconciled
+  // with the first routes from Decision. Reset if the agent restarts
+  struct AdoptedRoutes {
+    std::unordered_map<thrift::IpPrefix, std::set<thrift::NextHopThrift>>
+        unicastRoutes;
+    std::unordered_map<int32_t, std::set<thrift::NextHopThrift>> mplsRoutes;
+  };
+  std::optional<AdoptedRoutes> adoptedRoutes_;
+
   const int16_t kFibId_{static_cast<int16_t>(thrift::FibClient::OPENR)};
 };
 
@@ -0,0 +1,198 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "InProcessFibClient.h"
+
+#include <folly/futures/Future.h>
+
+#include <openr/common/Constants.h>
+
+namespace openr {
+
+namespace {
+
+// result of a handler call, failing with what the call throws and after
+// timeout if the handler does not reply
+template <typename T, typename Call>
+folly::SemiFuture<T>
+callHandler(Call&& call, std::chrono::milliseconds timeout) {
+  return folly::makeSemiFutureWith(std::forward<Call>(call)).within(timeout);
+}
+
+} // namespace
+
+InProcessFibClient::InProcessFibClient(
+    std::shared_ptr<thrift::FibServiceSvIf> handler)
+    : thrift::FibServiceAsyncClient(
+          std::shared_ptr<apache::thrift::RequestChannel>(nullptr)),
+      handler_(std::move(handler)) {
+  CHECK(handler_);
+}
+
+folly::SemiFuture<folly::Unit>
+InProcessFibClient::semifuture_addUnicastRoutes(
+    int16_t clientId, const std::vector<thrift::UnicastRoute>& routes) {
+  return callHandler<folly::Unit>(
+      [&]() {
+        return handler_->future_addUnicastRoutes(
+            clientId,
+            std::make_unique<std::vector<thrift::UnicastRoute>>(routes));
+      },
+      Constants::kPlatformRoutesProcTimeout);
+}
+
+folly::SemiFuture<folly::Unit>
+InProcessFibClient::semifuture_deleteUnicastRoutes(
+    int16_t clientId, const std::vector<thrift::IpPrefix>& prefixes) {
+  return callHandler<folly::Unit>(
+      [&]() {
+        return handler_->future_deleteUnicastRoutes(
+            clientId,
+            std::make_unique<std::vector<thrift::IpPrefix>>(prefixes));
+      },
+      Constants::kPlatformRoutesProcTimeout);
+}
+
+folly::SemiFuture<folly::Unit>
+InProcessFibClient::semifuture_addMplsRoutes(
+    int16_t clientId, const std::vector<thrift::MplsRoute>& routes) {
+  return callHandler<folly::Unit>(
+      [&]() {
+        return handler_->future_addMplsRoutes(
+            clientId, std::make_unique<std::vector<thrift::MplsRoute>>(routes));
+      },
+      Constants::kPlatformRoutesProcTimeout);
+}
+
+folly::SemiFuture<folly::Unit>
+InProcessFibClient::semifuture_deleteMplsRoutes(
+    int16_t clientId, const std::vector<int32_t>& topLabels) {
+  return callHandler<folly::Unit>(
+      [&]() {
+        return handler_->future_deleteMplsRoutes(
+            clientId, std::make_unique<std::vector<int32_t>>(topLabels));
+      },
+      Constants::kPlatformRoutesProcTimeout);
+}
+
+folly::SemiFuture<folly::Unit>
+InProcessFibClient::semifuture_updateGroupedUnicastRoutes(
+    int16_t clientId, const thrift::GroupedRouteUpdate& update) {
+  return callHandler<folly::Unit>(
+      [&]() {
+        return handler_->future_updateGroupedUnicastRoutes(
+            clientId, std::make_unique<thrift::GroupedRouteUpdate>(update));
+      },
+      Constants::kPlatformRoutesProcTimeout);
+}
+
+folly::SemiFuture<folly::Unit>
+InProcessFibClient::semifuture_beginSyncFib(
+    int16_t clientId, int64_t syncId, bool syncMpls) {
+  return callHandler<folly::Unit>(
+      [&]() {
+        return handler_->future_beginSyncFib(clientId, syncId, syncMpls);
+      },
+      Constants::kPlatformRoutesProcTimeout);
+}
+
+folly::SemiFuture<folly::Unit>
+InProcessFibClient::semifuture_syncFibChunk(
+    int16_t clientId,
+    int64_t syncId,
+    const std::vector<thrift::UnicastRoute>& routes,
+    const std::vector<thrift::MplsRoute>& mplsRoutes) {
+  return callHandler<folly::Unit>(
+      [&]() {
+        return handler_->future_syncFibChunk(
+            clientId,
+            syncId,
+            std::make_unique<std::vector<thrift::UnicastRoute>>(routes),
+            std::make_unique<std::vector<thrift::MplsRoute>>(mplsRoutes));
+      },
+      Constants::kPlatformRoutesProcTimeout);
+}
+
+folly::SemiFuture<folly::Unit>
+InProcessFibClient::semifuture_commitSyncFib(int16_t clientId, int64_t syncId) {
+  return callHandler<folly::Unit>(
+      [&]() { return handler_->future_commitSyncFib(clientId, syncId); },
+      Constants::kPlatformRoutesProcTimeout);
+}
+
+void
+InProcessFibClient::sync_syncFib(
+    int16_t clientId, const std::vector<thrift::UnicastRoute>& routes) {
+  callHandler<folly::Unit>(
+      [&]() {
+        return handler_->future_syncFib(
+            clientId,
+            std::make_unique<std::vector<thrift::UnicastRoute>>(routes));
+      },
+      Constants::kPlatformRoutesProcTimeout)
+      .get();
+}
+
+void
+InProcessFibClient::sync_syncMplsFib(
+    int16_t clientId, const std::vector<thrift::MplsRoute>& routes) {
+  callHandler<folly::Unit>(
+      [&]() {
+        return handler_->future_syncMplsFib(
+            clientId, std::make_unique<std::vector<thrift::MplsRoute>>(routes));
+      },
+      Constants::kPlatformRoutesProcTimeout)
+      .get();
+}
+
+void
+InProcessFibClient::sync_getRouteTableByClient(
+    std::vector<thrift::UnicastRoute>& routes, int16_t clientId) {
+  auto result =
+      callHandler<std::unique_ptr<std::vector<thrift::UnicastRoute>>>(
+          [&]() { return handler_->future_getRouteTableByClient(clientId); },
+          Constants::kPlatformRoutesProcTimeout)
+          .get();
+  routes = std::move(*result);
+}
+
+void
+InProcessFibClient::sync_getMplsRouteTableByClient(
+    std::vector<thrift::MplsRoute>& routes, int16_t clientId) {
+  auto result = callHandler<std::unique_ptr<std::vector<thrift::MplsRoute>>>(
+                    [&]() {
+                      return handler_->future_getMplsRouteTableByClient(
+                          clientId);
+                    },
+                    Constants::kPlatformRoutesProcTimeout)
+                    .get();
+  routes = std::move(*result);
+}
+
+int64_t
+InProcessFibClient::sync_aliveSince() {
+  return handler_->aliveSince();
+}
+
+folly::SemiFuture<int64_t>
+InProcessFibClient::semifuture_aliveSince() {
+  return folly::makeSemiFutureWith([this]() { return handler_->aliveSince(); });
+}
+
+folly::SemiFuture<int64_t>
+InProcessFibClient::semifuture_longPollAliveSince(
+    apache::thrift::RpcOptions& rpcOptions,
+    int64_t aliveSince,
+    int32_t timeoutMs) {
+  return callHandler<int64_t>(
+      [&]() {
+        return handler_->future_longPollAliveSince(aliveSince, timeoutMs);
+      },
+      rpcOptions.getTimeout());
+}
+
+} // namespace openr
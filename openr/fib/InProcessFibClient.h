@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <openr/if/gen-cpp2/FibService.h>
+#include <openr/if/gen-cpp2/Fib_types.h>
+#include <openr/if/gen-cpp2/Platform_types.h>
+
+namespace openr {
+
+/**
+ * Client of a FibService handler running in the same process, e.g. the
+ * NetlinkFibHandler. Calls of Fib are forwarded to the future_ methods of the
+ * handler, without serializing them or going through a socket. Routes are
+ * passed on as the unique_ptr arguments the handler takes, so they get copied
+ * once from the const references of the client interface.
+ *
+ * Only the methods used by Fib are forwarded, others fail for lack of a
+ * channel. Route programming calls time out like calls to a thrift agent do.
+ */
+class InProcessFibClient final : public thrift::FibServiceAsyncClient {
+ public:
+  explicit InProcessFibClient(std::shared_ptr<thrift::FibServiceSvIf> handler);
+
+  folly::SemiFuture<folly::Unit> semifuture_addUnicastRoutes(
+      int16_t clientId,
+      const std::vector<thrift::UnicastRoute>& routes) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_deleteUnicastRoutes(
+      int16_t clientId, const std::vector<thrift::IpPrefix>& prefixes) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_addMplsRoutes(
+      int16_t clientId, const std::vector<thrift::MplsRoute>& routes) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_deleteMplsRoutes(
+      int16_t clientId, const std::vector<int32_t>& topLabels) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_updateGroupedUnicastRoutes(
+      int16_t clientId, const thrift::GroupedRouteUpdate& update) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_beginSyncFib(
+      int16_t clientId, int64_t syncId, bool syncMpls) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_syncFibChunk(
+      int16_t clientId,
+      int64_t syncId,
+      const std::vector<thrift::UnicastRoute>& routes,
+      const std::vector<thrift::MplsRoute>& mplsRoutes) override;
+
+  folly::SemiFuture<folly::Unit> semifuture_commitSyncFib(
+      int16_t clientId, int64_t syncId) override;
+
+  void sync_syncFib(
+      int16_t clientId,
+      const std::vector<thrift::UnicastRoute>& routes) override;
+
+  void sync_syncMplsFib(
+      int16_t clientId, const std::vector<thrift::MplsRoute>& routes) override;
+
+  void sync_getRouteTableByClient(
+      std::vector<thrift::UnicastRoute>& routes, int16_t clientId) override;
+
+  void sync_getMplsRouteTableByClient(
+      std::vector<thrift::MplsRoute>& routes, int16_t clientId) override;
+
+  int64_t sync_aliveSince() override;
+
+  folly::SemiFuture<int64_t> semifuture_aliveSince() override;
+
+  // times out after the timeout of rpcOptions, as with a thrift agent
+  folly::SemiFuture<int64_t> semifuture_longPollAliveSince(
+      apache::thrift::RpcOptions& rpcOptions,
+      int64_t aliveSince,
+      int32_t timeoutMs) override;
+
+ private:
+  const std::shared_ptr<thrift::FibServiceSvIf> handler_;
+};
+
+} // namespace openr
@@ -0,0 +1,208 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "NextHopGroupTable.h"
+
+#include <folly/hash/Hash.h>
+
+namespace openr {
+
+thrift::GroupedRouteUpdate
+NextHopGroupTable::update(
+    const std::vector<thrift::UnicastRoute>& routesToUpdate,
+    const std::vector<thrift::IpPrefix>& routesToDelete,
+    bool rewriteGroups) {
+  thrift::GroupedRouteUpdate update;
+  // groups in update.nextHopGroupsToUpdate
+  std::unordered_set<int64_t> sentGroups;
+
+  for (auto const& prefix : routesToDelete) {
+    auto it = prefixGroups_.find(prefix);
+    if (it != prefixGroups_.end()) {
+      groups_.at(it->second).prefixes.erase(prefix);
+      prefixGroups_.erase(it);
+    }
+    update.unicastRoutesToDelete.emplace_back(prefix);
+  }
+
+  std::vector<NextHopSet> nextHopSets;
+  nextHopSets.reserve(routesToUpdate.size());
+  for (auto const& route : routesToUpdate) {
+    nextHopSets.emplace_back(route.nextHops.begin(), route.nextHops.end());
+  }
+
+  // routes moved along with their rewritten group
+  std::vector<bool> done(routesToUpdate.size(), false);
+  if (rewriteGroups) {
+    // indices of routes, by their current group
+    std::unordered_map<int64_t, std::vector<size_t>> routesByGroup;
+    for (size_t i = 0; i < routesToUpdate.size(); ++i) {
+      auto it = prefixGroups_.find(routesToUpdate[i].dest);
+      if (it != prefixGroups_.end()) {
+        routesByGroup[it->second].emplace_back(i);
+      }
+    }
+    for (auto const& kv : routesByGroup) {
+      const auto id = kv.first;
+      auto const& indices = kv.second;
+      auto const& group = groups_.at(id);
+      auto const& nextHops = nextHopSets.at(indices.front());
+      if (indices.size() != group.prefixes.size() or
+          nextHops == group.nextHops or findGroup(nextHops)) {
+        continue;
+      }
+      bool sameNextHops = true;
+      for (auto i : indices) {
+        sameNextHops = sameNextHops and nextHopSets.at(i) == nextHops;
+      }
+      if (not sameNextHops) {
+        continue;
+      }
+      setNextHops(id, nextHops);
+      update.nextHopGroupsToUpdate.emplace_back(toThrift(id));
+      sentGroups.emplace(id);
+      for (auto i : indices) {
+        done.at(i) = true;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < routesToUpdate.size(); ++i) {
+    if (done.at(i)) {
+      continue;
+    }
+    auto const& route = routesToUpdate[i];
+    auto id = findGroup(nextHopSets.at(i));
+    if (not id) {
+      id = addGroup(std::move(nextHopSets.at(i)));
+    }
+    if (unconfirmedGroups_.count(*id) and sentGroups.emplace(*id).second) {
+      update.nextHopGroupsToUpdate.emplace_back(toThrift(*id));
+    }
+    setGroup(route.dest, *id);
+
+    thrift::GroupedUnicastRoute groupedRoute;
+    groupedRoute.dest = route.dest;
+    groupedRoute.nextHopGroupId = *id;
+    update.unicastRoutesToUpdate.emplace_back(std::move(groupedRoute));
+  }
+  return update;
+}
+
+std::vector<int64_t>
+NextHopGroupTable::takeUnusedGroups() {
+  std::vector<int64_t> ids;
+  for (auto it = groups_.begin(); it != groups_.end();) {
+    if (not it->second.prefixes.empty()) {
+      ++it;
+      continue;
+    }
+    const auto id = it->first;
+    auto range = groupsByHash_.equal_range(hashNextHops(it->second.nextHops));
+    for (auto hashIt = range.first; hashIt != range.second; ++hashIt) {
+      if (hashIt->second == id) {
+        groupsByHash_.erase(hashIt);
+        break;
+      }
+    }
+    unconfirmedGroups_.erase(id);
+    ids.emplace_back(id);
+    it = groups_.erase(it);
+  }
+  return ids;
+}
+
+void
+NextHopGroupTable::confirmGroups() {
+  unconfirmedGroups_.clear();
+}
+
+void
+NextHopGroupTable::clear() {
+  groups_.clear();
+  groupsByHash_.clear();
+  prefixGroups_.clear();
+  unconfirmedGroups_.clear();
+}
+
+std::optional<int64_t>
+NextHopGroupTable::getGroupId(const thrift::IpPrefix& prefix) const {
+  auto it = prefixGroups_.find(prefix);
+  if (it == prefixGroups_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+size_t
+NextHopGroupTable::hashNextHops(const NextHopSet& nextHops) {
+  // hashes of next-hops get mixed before they are summed up, a plain sum of
+  // them collides for sets of similar next-hops
+  uint64_t hash = folly::hash::twang_mix64(nextHops.size());
+  for (auto const& nextHop : nextHops) {
+    hash +=
+        folly::hash::twang_mix64(std::hash<thrift::NextHopThrift>()(nextHop));
+  }
+  return folly::hash::twang_mix64(hash);
+}
+
+std::optional<int64_t>
+NextHopGroupTable::findGroup(const NextHopSet& nextHops) const {
+  auto range = groupsByHash_.equal_range(hashNextHops(nextHops));
+  for (auto it = range.first; it != range.second; ++it) {
+    if (groups_.at(it->second).nextHops == nextHops) {
+      return it->second;
+    }
+  }
+  return std::nullopt;
+}
+
+int64_t
+NextHopGroupTable::addGroup(NextHopSet nextHops) {
+  const auto id = nextId_++;
+  groupsByHash_.emplace(hashNextHops(nextHops), id);
+  groups_[id].nextHops = std::move(nextHops);
+  unconfirmedGroups_.emplace(id);
+  return id;
+}
+
+void
+NextHopGroupTable::setNextHops(int64_t id, NextHopSet nextHops) {
+  auto& group = groups_.at(id);
+  auto range = groupsByHash_.equal_range(hashNextHops(group.nextHops));
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == id) {
+      groupsByHash_.erase(it);
+      break;
+    }
+  }
+  groupsByHash_.emplace(hashNextHops(nextHops), id);
+  group.nextHops = std::move(nextHops);
+  unconfirmedGroups_.emplace(id);
+}
+
+void
+NextHopGroupTable::setGroup(const thrift::IpPrefix& prefix, int64_t id) {
+  // 0 if prefix had no group
+  auto& currentId = prefixGroups_[prefix];
+  if (currentId != 0 and currentId != id) {
+    groups_.at(currentId).prefixes.erase(prefix);
+  }
+  currentId = id;
+  groups_.at(id).prefixes.emplace(prefix);
+}
+
+thrift::NextHopGroup
+NextHopGroupTable::toThrift(int64_t id) const {
+  auto const& nextHops = groups_.at(id).nextHops;
+  thrift::NextHopGroup group;
+  group.id = id;
+  group.nextHops.assign(nextHops.begin(), nextHops.end());
+  return group;
+}
+
+} // namespace openr
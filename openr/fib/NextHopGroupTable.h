@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/if/gen-cpp2/Network_types.h>
+#include <openr/if/gen-cpp2/Platform_types.h>
+
+namespace openr {
+
+/**
+ * Next-hop groups of the unicast routes programmed with
+ * updateGroupedUnicastRoutes, as known to the FibAgent. Routes with the same
+ * set of next-hops share a group. When all routes of a group move to the same
+ * new next-hops, e.g. after a link went down, the group gets rewritten instead
+ * of each of its routes.
+ *
+ * Updates must be sent in the order they are made. Rewrites and deletes of
+ * groups assume that the agent applied all updates before, the caller only
+ * asks for them with nothing else in flight. Groups created by updates still
+ * in flight are sent again along with later updates using them, until
+ * confirmGroups().
+ *
+ * Not thread-safe.
+ */
+class NextHopGroupTable {
+ public:
+  /**
+   * Apply route updates and deletes to the table and turn them into a grouped
+   * update for the agent, with the groups it needs. Each prefix may be found
+   * once at most. With rewriteGroups, groups whose routes all move to the same
+   * new next-hops get rewritten, unless another group has those already.
+   * Groups left without routes are kept and reused until takeUnusedGroups().
+   */
+  thrift::GroupedRouteUpdate update(
+      const std::vector<thrift::UnicastRoute>& routesToUpdate,
+      const std::vector<thrift::IpPrefix>& routesToDelete,
+      bool rewriteGroups);
+
+  // remove groups without routes, returns their ids
+  std::vector<int64_t> takeUnusedGroups();
+
+  // all updates made so far got applied by the agent
+  void confirmGroups();
+
+  // forget all groups, the agent dropped them
+  void clear();
+
+  // group of prefix, std::nullopt if it has none
+  std::optional<int64_t> getGroupId(const thrift::IpPrefix& prefix) const;
+
+  size_t
+  getNumGroups() const {
+    return groups_.size();
+  }
+
+ private:
+  using NextHopSet = std::unordered_set<thrift::NextHopThrift>;
+
+  struct Group {
+    NextHopSet nextHops;
+    std::unordered_set<thrift::IpPrefix> prefixes;
+  };
+
+  // independent of the order of next-hops
+  static size_t hashNextHops(const NextHopSet& nextHops);
+
+  // group of nextHops, std::nullopt if there is none
+  std::optional<int64_t> findGroup(const NextHopSet& nextHops) const;
+
+  int64_t addGroup(NextHopSet nextHops);
+
+  void setNextHops(int64_t id, NextHopSet nextHops);
+
+  // move prefix into group id, out of its previous group if any
+  void setGroup(const thrift::IpPrefix& prefix, int64_t id);
+
+  // definition of group id, to send to the agent
+  thrift::NextHopGroup toThrift(int64_t id) const;
+
+  std::unordered_map<int64_t, Group> groups_;
+  std::unordered_multimap<size_t, int64_t> groupsByHash_;
+  std::unordered_map<thrift::IpPrefix, int64_t> prefixGroups_;
+
+  // created or rewritten after the last confirmGroups()
+  std::unordered_set<int64_t> unconfirmedGroups_;
+
+  // ids are never reused, not even after clear()
+  int64_t nextId_{1};
+};
+
+} // namespace openr
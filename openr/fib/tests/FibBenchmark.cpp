@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <thread>
 
 #include <fbzmq/async/StopEventLoopSignalHandler.h>
@@ -18,31 +19,9 @@
 #include <openr/fib/tests/MockNetlinkFibHandler.h>
 #include <openr/fib/tests/PrefixGenerator.h>
 #include <openr/messaging/ReplicateQueue.h>
+#include <openr/tests/BenchmarkUtils.h>
 #include <openr/tests/OpenrThriftServerWrapper.h>
 
-/**
- * Defines a benchmark that allows users to record customized counter during
- * benchmarking and passes a parameter to another one. This is common for
- * benchmarks that need a "problem size" in addition to "number of iterations".
- */
-#define BENCHMARK_COUNTERS_PARAM(name, counters, param) \
-  BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param, param)
-
-/*
- * Like BENCHMARK_COUNTERS_PARAM(), but allows a custom name to be specified for
- * each parameter, rather than using the parameter value.
- */
-#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
-  BENCHMARK_IMPL_COUNTERS(                                             \
-      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
-      FOLLY_PP_STRINGIZE(name) "(" FOLLY_PP_STRINGIZE(param_name) ")", \
-      counters,                                                        \
-      iters,                                                           \
-      unsigned,                                                        \
-      iters) {                                                         \
-    name(counters, iters, ##__VA_ARGS__);                              \
-  }
-
 namespace {
 // Virtual interface
 const std::string kVethNameY("vethTestY");
@@ -53,6 +32,19 @@ static const uint32_t kDeltaSize = 10;
 // Number of nexthops
 const uint8_t kNumOfNexthops = 128;
 
+// Virtual interface the routes of the large tables have nexthops over too
+const std::string kVethNameZ("vethTestZ");
+// Nexthops per interface of the routes in large tables
+const uint8_t kNumOfLargeTableNexthops = 4;
+// Routes programmed per delta when filling large tables
+const uint32_t kProgramChunkSize = 100000;
+// Prefix length of the routes queried by LPM
+const uint8_t kLpmPrefixLen = 64;
+// Addresses looked up per LPM query
+const uint32_t kLpmQuerySize = 10;
+// Routes of the table incremental deltas are applied to
+const uint32_t kIncrementalTableSize = 100000;
+
 } // anonymous namespace
 
 namespace openr {
@@ -164,6 +156,54 @@ class FibWrapper {
     }
   }
 
+  // route to prefix over both kVethNameY and kVethNameZ
+  thrift::UnicastRoute
+  createLargeTableRoute(thrift::IpPrefix const& prefix) {
+    auto nextHops = prefixGenerator.getRandomNextHopsUnicast(
+        kNumOfLargeTableNexthops, kVethNameY);
+    auto nextHopsZ = prefixGenerator.getRandomNextHopsUnicast(
+        kNumOfLargeTableNexthops, kVethNameZ);
+    nextHops.insert(nextHops.end(), nextHopsZ.begin(), nextHopsZ.end());
+    return createUnicastRoute(prefix, std::move(nextHops));
+  }
+
+  // program routes to numOfPrefixes random prefixes, in chunks that keep
+  // thrift calls to the mock agent reasonably sized
+  std::vector<thrift::IpPrefix>
+  programLargeTable(uint32_t numOfPrefixes, uint8_t bitMaskLen) {
+    auto prefixes =
+        prefixGenerator.ipv6PrefixGenerator(numOfPrefixes, bitMaskLen);
+    for (size_t begin = 0; begin < prefixes.size();
+         begin += kProgramChunkSize) {
+      const auto end = std::min(prefixes.size(), begin + kProgramChunkSize);
+      thrift::RouteDatabaseDelta routeDbDelta;
+      routeDbDelta.thisNodeName = "node-1";
+      for (auto i = begin; i < end; ++i) {
+        routeDbDelta.unicastRoutesToUpdate.emplace_back(
+            createLargeTableRoute(prefixes.at(i)));
+      }
+      routeUpdatesQueue.push(std::move(routeDbDelta));
+      mockFibHandler->waitForUpdateUnicastRoutes();
+    }
+    return prefixes;
+  }
+
+  void
+  pushInterfaceStatus(std::string const& ifName, bool isUp) {
+    thrift::InterfaceDatabase interfaceDb;
+    interfaceDb.thisNodeName = "node-1";
+    interfaceDb.interfaces.emplace(
+        ifName,
+        thrift::InterfaceInfo(
+            apache::thrift::FRAGILE,
+            isUp,
+            ifName == kVethNameY ? 1 : 2,
+            {} /* v4Addrs */,
+            {} /* v6LinkLocalAddrs */,
+            {} /* networks */));
+    interfaceUpdatesQueue.push(std::move(interfaceDb));
+  }
+
   int port{0};
   std::shared_ptr<ThriftServer> server;
   ScopedServerThread fibThriftThread;
@@ -262,6 +302,198 @@ BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 100);
 BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 1000);
 BENCHMARK_COUNTERS_PARAM(BM_Fib, counters, 9000);
 
+namespace {
+
+/**
+ * Latencies and allocations of some iterations of an operation
+ */
+class OperationStats {
+ public:
+  void
+  start() {
+    startTime_ = std::chrono::steady_clock::now();
+    startAllocs_ = getNumHeapAllocs();
+  }
+
+  void
+  stop() {
+    latenciesUs_.emplace_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime_)
+            .count());
+    allocs_ += getNumHeapAllocs() - startAllocs_;
+  }
+
+  // p50 and p99 of latency, and allocations per iteration, of all threads
+  void
+  report(folly::UserCounters& counters, std::string const& name) {
+    if (latenciesUs_.empty()) {
+      return;
+    }
+    std::sort(latenciesUs_.begin(), latenciesUs_.end());
+    const auto percentile = [this](double p) {
+      return latenciesUs_.at(std::min(
+          latenciesUs_.size() - 1,
+          static_cast<size_t>(p * latenciesUs_.size())));
+    };
+    counters[name + "_p50_us"] = percentile(0.5);
+    counters[name + "_p99_us"] = percentile(0.99);
+    counters[name + "_allocs"] = allocs_ / latenciesUs_.size();
+  }
+
+ private:
+  std::vector<uint64_t> latenciesUs_;
+  uint64_t allocs_{0};
+  std::chrono::steady_clock::time_point startTime_;
+  uint64_t startAllocs_{0};
+};
+
+} // namespace
+
+/**
+ * Steady state route updates: deltas of deltaSize routes, changing nexthops
+ * of existing routes, applied to a table of kIncrementalTableSize routes.
+ * Latency is from pushing the delta until the agent got it programmed.
+ */
+static void
+BM_FibIncrementalUpdate(
+    folly::UserCounters& counters, uint32_t iters, unsigned deltaSize) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto fibWrapper = std::make_unique<FibWrapper>();
+  fibWrapper->mockFibHandler->waitForSyncFib();
+  const auto prefixes =
+      fibWrapper->programLargeTable(kIncrementalTableSize, kBitMaskLen);
+
+  OperationStats stats;
+  for (uint32_t i = 0; i < iters; i++) {
+    thrift::RouteDatabaseDelta routeDbDelta;
+    routeDbDelta.thisNodeName = "node-1";
+    for (uint32_t index = 0; index < deltaSize; index++) {
+      routeDbDelta.unicastRoutesToUpdate.emplace_back(
+          fibWrapper->createLargeTableRoute(
+              prefixes.at((i * deltaSize + index) % prefixes.size())));
+    }
+
+    suspender.dismiss();
+    stats.start();
+    fibWrapper->routeUpdatesQueue.push(std::move(routeDbDelta));
+    fibWrapper->mockFibHandler->waitForUpdateUnicastRoutes();
+    stats.stop();
+    suspender.rehire();
+  }
+  stats.report(counters, "update");
+}
+
+/**
+ * Longest prefix match of kLpmQuerySize addresses against a table of
+ * numOfPrefixes routes, as done for route queries of breeze and ctrl
+ */
+static void
+BM_FibLongestPrefixMatch(
+    folly::UserCounters& counters, uint32_t iters, unsigned numOfPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto fibWrapper = std::make_unique<FibWrapper>();
+  fibWrapper->mockFibHandler->waitForSyncFib();
+  const auto prefixes =
+      fibWrapper->programLargeTable(numOfPrefixes, kLpmPrefixLen);
+
+  OperationStats stats;
+  for (uint32_t i = 0; i < iters; i++) {
+    std::vector<std::string> addresses;
+    for (uint32_t index = 0; index < kLpmQuerySize; index++) {
+      auto const& prefix =
+          prefixes.at((i * kLpmQuerySize + index) % prefixes.size());
+      addresses.emplace_back(toIPAddress(prefix.prefixAddress).str());
+    }
+
+    suspender.dismiss();
+    stats.start();
+    auto routes =
+        fibWrapper->fib->getUnicastRoutes(std::move(addresses)).get();
+    stats.stop();
+    suspender.rehire();
+    CHECK_EQ(kLpmQuerySize, routes->size());
+  }
+  stats.report(counters, "lookup");
+}
+
+/**
+ * Flap of an interface that half of the nexthops of all numOfPrefixes
+ * routes go over. Going down shrinks the nexthop group of every route,
+ * coming back up restores it.
+ */
+static void
+BM_FibInterfaceFlap(
+    folly::UserCounters& counters, uint32_t iters, unsigned numOfPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto fibWrapper = std::make_unique<FibWrapper>();
+  fibWrapper->mockFibHandler->waitForSyncFib();
+  fibWrapper->programLargeTable(numOfPrefixes, kBitMaskLen);
+  fibWrapper->pushInterfaceStatus(kVethNameY, true);
+  fibWrapper->pushInterfaceStatus(kVethNameZ, true);
+
+  OperationStats downStats;
+  OperationStats upStats;
+  for (uint32_t i = 0; i < iters; i++) {
+    suspender.dismiss();
+    downStats.start();
+    fibWrapper->pushInterfaceStatus(kVethNameY, false);
+    fibWrapper->mockFibHandler->waitForUpdateUnicastRoutes();
+    downStats.stop();
+
+    upStats.start();
+    fibWrapper->pushInterfaceStatus(kVethNameY, true);
+    fibWrapper->mockFibHandler->waitForUpdateUnicastRoutes();
+    upStats.stop();
+    suspender.rehire();
+  }
+  downStats.report(counters, "down");
+  upStats.report(counters, "up");
+}
+
+/**
+ * Full sync of numOfPrefixes routes after the agent restarted. Fib always
+ * sends its whole table in a full sync and leaves the diff to the agent, so
+ * its cost only depends on the table size, not on how much of it changed.
+ */
+static void
+BM_FibSyncRouteDb(
+    folly::UserCounters& counters, uint32_t iters, unsigned numOfPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto fibWrapper = std::make_unique<FibWrapper>();
+  fibWrapper->mockFibHandler->waitForSyncFib();
+  fibWrapper->programLargeTable(numOfPrefixes, kBitMaskLen);
+
+  OperationStats stats;
+  for (uint32_t i = 0; i < iters; i++) {
+    // aliveSince of the agent has a resolution of seconds
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    suspender.dismiss();
+    stats.start();
+    fibWrapper->mockFibHandler->restart();
+    fibWrapper->mockFibHandler->waitForSyncFib();
+    stats.stop();
+    suspender.rehire();
+  }
+  stats.report(counters, "sync");
+}
+
+// The parameter is the number of routes in a delta
+BENCHMARK_COUNTERS_PARAM(BM_FibIncrementalUpdate, counters, 1);
+BENCHMARK_COUNTERS_PARAM(BM_FibIncrementalUpdate, counters, 10);
+BENCHMARK_COUNTERS_PARAM(BM_FibIncrementalUpdate, counters, 100);
+BENCHMARK_COUNTERS_PARAM(BM_FibIncrementalUpdate, counters, 1000);
+
+// The parameter is the number of routes in fib
+BENCHMARK_COUNTERS_PARAM(BM_FibLongestPrefixMatch, counters, 10000);
+BENCHMARK_COUNTERS_PARAM(BM_FibLongestPrefixMatch, counters, 1000000);
+BENCHMARK_COUNTERS_PARAM(BM_FibInterfaceFlap, counters, 10000);
+BENCHMARK_COUNTERS_PARAM(BM_FibInterfaceFlap, counters, 500000);
+BENCHMARK_COUNTERS_PARAM(BM_FibSyncRouteDb, counters, 10000);
+BENCHMARK_COUNTERS_PARAM(BM_FibSyncRouteDb, counters, 100000);
+
 } // namespace openr
 
 int
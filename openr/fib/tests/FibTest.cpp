@@ -8,11 +8,14 @@
 #include "MockNetlinkFibHandler.h"
 
 #include <chrono>
+#include <map>
 #include <thread>
 
+#include <fb303/ServiceData.h>
 #include <fbzmq/async/StopEventLoopSignalHandler.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Format.h>
+#include <folly/MapUtil.h>
 #include <folly/Memory.h>
 #include <folly/String.h>
 #include <folly/futures/Future.h>
@@ -29,6 +32,7 @@
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 #include <thrift/lib/cpp2/util/ScopedServerThread.h>
 
+#include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/fib/Fib.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
@@ -40,6 +44,8 @@
 using namespace std;
 using namespace openr;
 
+namespace fb303 = facebook::fb303;
+
 using apache::thrift::FRAGILE;
 using apache::thrift::ThriftServer;
 using apache::thrift::util::ScopedServerThread;
@@ -195,6 +201,19 @@ class FibTestFixture : public ::testing::Test {
   void
   SetUp() override {
     mockFibHandler = std::make_shared<MockNetlinkFibHandler>();
+    // programmed by Open/R before it restarted
+    if (not agentRoutes.empty()) {
+      mockFibHandler->addUnicastRoutes(
+          kFibId,
+          std::make_unique<std::vector<thrift::UnicastRoute>>(agentRoutes));
+      mockFibHandler->waitForUpdateUnicastRoutes();
+    }
+    if (not agentMplsRoutes.empty()) {
+      mockFibHandler->addMplsRoutes(
+          kFibId,
+          std::make_unique<std::vector<thrift::MplsRoute>>(agentMplsRoutes));
+      mockFibHandler->waitForUpdateMplsRoutes();
+    }
 
     server = make_shared<ThriftServer>();
     server->setNumIOWorkerThreads(1);
@@ -217,7 +236,8 @@ class FibTestFixture : public ::testing::Test {
         interfaceUpdatesQueue.getReader(),
         MonitorSubmitUrl{"inproc://monitor-sub"},
         nullptr, /* KvStore module ptr */
-        context);
+        context,
+        fibOptions);
 
     fibThread = std::make_unique<std::thread>([this]() {
       LOG(INFO) << "Fib thread starting";
@@ -306,6 +326,15 @@ class FibTestFixture : public ::testing::Test {
     return *resp;
   }
 
+  thrift::PerfDatabase
+  getPerfDb() {
+    auto resp = openrThriftServerWrapper_->getOpenrCtrlHandler()
+                    ->semifuture_getPerfDb()
+                    .get();
+    EXPECT_TRUE(resp);
+    return std::move(*resp);
+  }
+
   int port{0};
   std::shared_ptr<ThriftServer> server;
   ScopedServerThread fibThriftThread;
@@ -323,6 +352,13 @@ class FibTestFixture : public ::testing::Test {
 
   std::shared_ptr<MockNetlinkFibHandler> mockFibHandler;
 
+  // routes the agent has before Fib starts
+  std::vector<thrift::UnicastRoute> agentRoutes;
+  std::vector<thrift::MplsRoute> agentMplsRoutes;
+
+  // options of Fib created by SetUp
+  FibOptions fibOptions;
+
  private:
   // thriftServer to talk to Fib
   std::shared_ptr<OpenrThriftServerWrapper> openrThriftServerWrapper_{nullptr};
@@ -405,6 +441,156 @@ TEST_F(FibTestFixture, processRouteDb) {
   EXPECT_TRUE(checkEqualRoutes(routeDb, getRouteDb()));
 }
 
+// route db snapshot is shared till routes change, routes unchanged in between
+// are shared across snapshots
+TEST_F(FibTestFixture, routeDbSnapshot) {
+  mockFibHandler->waitForSyncFib();
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix2, {path1_2_1, path1_2_2}));
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+
+  auto snapshot1 = fib->getRouteDbSnapshot().get();
+  ASSERT_EQ(1, snapshot1->unicastRoutes.size());
+  EXPECT_EQ(prefix2, snapshot1->unicastRoutes.at(0)->dest);
+  EXPECT_EQ(snapshot1, fib->getRouteDbSnapshot().get());
+
+  routeDbDelta.unicastRoutesToUpdate.clear();
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix3, {path1_3_1, path1_3_2}));
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+
+  auto snapshot2 = fib->getRouteDbSnapshot().get();
+  EXPECT_NE(snapshot1, snapshot2);
+  ASSERT_EQ(2, snapshot2->unicastRoutes.size());
+  for (auto const& route : snapshot2->unicastRoutes) {
+    if (route->dest == prefix2) {
+      EXPECT_EQ(snapshot1->unicastRoutes.at(0), route);
+    }
+  }
+  EXPECT_EQ(1, snapshot1->unicastRoutes.size());
+}
+
+// updates of a prefix sent in a burst, while earlier ones are in flight, get
+// coalesced and the agent ends up with the last one
+TEST_F(FibTestFixture, routeUpdateBurst) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  for (int i = 0; i < 20; ++i) {
+    routeDbDelta.unicastRoutesToUpdate.clear();
+    routeDbDelta.unicastRoutesToDelete.clear();
+    if (i % 2) {
+      routeDbDelta.unicastRoutesToDelete.emplace_back(prefix2);
+    } else {
+      routeDbDelta.unicastRoutesToUpdate.emplace_back(createUnicastRoute(
+          prefix2, {i % 4 ? path1_2_1 : path1_2_2}));
+    }
+    routeUpdatesQueue.push(routeDbDelta);
+  }
+  routeDbDelta.unicastRoutesToDelete.clear();
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix2, {path1_2_3})};
+  routeUpdatesQueue.push(routeDbDelta);
+
+  thrift::RouteDatabase routeDb;
+  routeDb.unicastRoutes = routeDbDelta.unicastRoutesToUpdate;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (true) {
+    std::vector<thrift::UnicastRoute> routes;
+    mockFibHandler->getRouteTableByClient(routes, kFibId);
+    thrift::RouteDatabase agentRouteDb;
+    agentRouteDb.unicastRoutes = routes;
+    if (checkEqualRoutes(routeDb, agentRouteDb)) {
+      break;
+    }
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+        << "agent didn't end up with the last update of the burst";
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_TRUE(checkEqualRoutes(routeDb, getRouteDb()));
+  // never more updates than sent
+  EXPECT_GE(11, mockFibHandler->getAddRoutesCount());
+  EXPECT_GE(10, mockFibHandler->getDelRoutesCount());
+}
+
+TEST_F(FibTestFixture, routeProgrammingStats) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_1}),
+      createUnicastRoute(prefix2, {path1_2_2})};
+  routeDbDelta.mplsRoutesToUpdate = {createMplsRoute(label1, {mpls_path1_2_1})};
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  mockFibHandler->waitForUpdateMplsRoutes();
+
+  // the batch completes on the Fib thread after the agent replied
+  auto perfDb = getPerfDb();
+  while (perfDb.routeProgrammingStats.size() < 2) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    perfDb = getPerfDb();
+  }
+  ASSERT_EQ(2, perfDb.routeProgrammingStats.size());
+
+  auto const& sync = perfDb.routeProgrammingStats.at(0);
+  EXPECT_TRUE(sync.isFullSync);
+  EXPECT_TRUE(sync.success);
+  EXPECT_EQ(0, sync.numRetries);
+
+  auto const& batch = perfDb.routeProgrammingStats.at(1);
+  EXPECT_FALSE(batch.isFullSync);
+  EXPECT_FALSE(batch.isSyncChunk);
+  EXPECT_TRUE(batch.success);
+  EXPECT_EQ(2, batch.numUnicastRoutes);
+  EXPECT_EQ(1, batch.numMplsRoutes);
+  EXPECT_LE(sync.unixTs, batch.unixTs);
+}
+
+// durations between perf events are aggregated in histograms per stage
+TEST_F(FibTestFixture, perfStageHistograms) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_1})};
+  thrift::PerfEvents perfEvents;
+  addPerfEvent(perfEvents, "node-1", "DECISION_RECEIVED");
+  routeDbDelta.perfEvents = perfEvents;
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+
+  auto perfDb = getPerfDb();
+  while (perfDb.eventInfo.empty()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    perfDb = getPerfDb();
+  }
+
+  const std::string key{
+      "fib.perf.DECISION_RECEIVED.OPENR_FIB_ROUTES_PROGRAMMED_ms.p50"};
+  bool found{false};
+  for (auto const& [name, value] : fb303::fbData->getCounters()) {
+    found |= name.compare(0, key.size(), key) == 0;
+  }
+  EXPECT_TRUE(found);
+}
+
 TEST_F(FibTestFixture, processInterfaceDb) {
   // Make sure fib starts with clean route database
   std::vector<thrift::UnicastRoute> routes;
@@ -578,6 +764,115 @@ TEST_F(FibTestFixture, processInterfaceDb) {
   EXPECT_EQ(mplsRoutes.size(), 2);
 }
 
+/**
+ * Routes over an interface are tracked through every route change, flaps of
+ * interfaces no route uses anymore affect nothing
+ */
+TEST_F(FibTestFixture, interfaceRouteIndex) {
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  const auto& ifA = path1_2_1.address.ifName.value();
+  const auto& ifB = path1_2_2.address.ifName.value();
+  const auto& ifC = path1_3_1.address.ifName.value();
+  auto pushInterfaceDb = [&](std::map<std::string, bool> const& ifStates) {
+    thrift::InterfaceDatabase intfDb;
+    intfDb.thisNodeName = "node-1";
+    for (auto const& [ifName, isUp] : ifStates) {
+      intfDb.interfaces.emplace(
+          ifName,
+          thrift::InterfaceInfo(
+              FRAGILE,
+              isUp,
+              0, // ifIndex
+              {}, // v4Addrs: TO BE DEPRECATED SOON
+              {}, // v6LinkLocalAddrs: TO BE DEPRECATED SOON
+              {} // networks
+              ));
+    }
+    const std::string counter{"fib.process_interface_db.count"};
+    const auto numProcessed =
+        folly::get_default(fb303::fbData->getCounters(), counter, 0);
+    interfaceUpdatesQueue.push(std::move(intfDb));
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (folly::get_default(fb303::fbData->getCounters(), counter, 0) ==
+           numProcessed) {
+      ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+          << "interface update not processed";
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+  pushInterfaceDb({{ifA, true}, {ifB, true}, {ifC, true}});
+
+  // routes over ifA
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_1}),
+      createUnicastRoute(prefix2, {path1_2_1})};
+  routeDbDelta.mplsRoutesToUpdate = {createMplsRoute(label1, {mpls_path1_2_1})};
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  mockFibHandler->waitForUpdateMplsRoutes();
+
+  // move them over to ifB, and ifC for ECMP, or delete them
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_2, path1_3_1})};
+  routeDbDelta.unicastRoutesToDelete = {prefix2};
+  routeDbDelta.mplsRoutesToUpdate = {createMplsRoute(label1, {mpls_path1_2_2})};
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  mockFibHandler->waitForDeleteUnicastRoutes();
+  mockFibHandler->waitForUpdateMplsRoutes();
+
+  std::vector<thrift::UnicastRoute> routes;
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(1, routes.size());
+  EXPECT_EQ(2, routes.at(0).nextHops.size());
+  mockFibHandler->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(1, mplsRoutes.size());
+  const auto addRoutes = mockFibHandler->getAddRoutesCount();
+  const auto delRoutes = mockFibHandler->getDelRoutesCount();
+  const auto addMplsRoutes = mockFibHandler->getAddMplsRoutesCount();
+  const auto delMplsRoutes = mockFibHandler->getDelMplsRoutesCount();
+
+  // flap of ifA changes no route
+  pushInterfaceDb({{ifA, false}});
+  pushInterfaceDb({{ifA, true}});
+  EXPECT_EQ(addRoutes, mockFibHandler->getAddRoutesCount());
+  EXPECT_EQ(delRoutes, mockFibHandler->getDelRoutesCount());
+  EXPECT_EQ(addMplsRoutes, mockFibHandler->getAddMplsRoutesCount());
+  EXPECT_EQ(delMplsRoutes, mockFibHandler->getDelMplsRoutesCount());
+
+  // ifB going down shrinks the unicast route, the label route is gone
+  pushInterfaceDb({{ifB, false}});
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  mockFibHandler->waitForDeleteMplsRoutes();
+  EXPECT_EQ(addRoutes + 1, mockFibHandler->getAddRoutesCount());
+  EXPECT_EQ(delRoutes, mockFibHandler->getDelRoutesCount());
+  EXPECT_EQ(addMplsRoutes, mockFibHandler->getAddMplsRoutesCount());
+  EXPECT_EQ(delMplsRoutes + 1, mockFibHandler->getDelMplsRoutesCount());
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(1, routes.size());
+  ASSERT_EQ(1, routes.at(0).nextHops.size());
+  EXPECT_EQ(ifC, routes.at(0).nextHops.at(0).address.ifName.value());
+  mockFibHandler->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(0, mplsRoutes.size());
+
+  // and restored once ifB is back
+  pushInterfaceDb({{ifB, true}});
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  mockFibHandler->waitForUpdateMplsRoutes();
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(1, routes.size());
+  EXPECT_EQ(2, routes.at(0).nextHops.size());
+  mockFibHandler->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(1, mplsRoutes.size());
+}
+
 TEST_F(FibTestFixture, basicAddAndDelete) {
   // Make sure fib starts with clean route database
   std::vector<thrift::UnicastRoute> routes;
@@ -749,6 +1044,351 @@ TEST_F(FibTestFixtureWaitOnDecision, WaitOnDecision) {
   EXPECT_EQ(mockFibHandler->getDelMplsRoutesCount(), 0);
 }
 
+class FibChunkedSyncTestFixture : public FibTestFixture {
+ public:
+  FibChunkedSyncTestFixture() {
+    fibOptions.syncChunkSize = 2;
+  }
+};
+
+// full sync in chunks of 2 routes removes stale routes of the agent, and
+// happens again after the agent restarts
+TEST_F(FibChunkedSyncTestFixture, chunkedSync) {
+  // left over, e.g. from a previous run
+  mockFibHandler->addUnicastRoutes(
+      kFibId,
+      std::make_unique<std::vector<thrift::UnicastRoute>>(
+          std::vector<thrift::UnicastRoute>{
+              createUnicastRoute(prefix4, {path1_2_1})}));
+  mockFibHandler->waitForUpdateUnicastRoutes();
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_1, path1_2_2}),
+      createUnicastRoute(prefix2, {path1_2_2}),
+      createUnicastRoute(prefix3, {path1_3_1})};
+  routeDbDelta.mplsRoutesToUpdate = {
+      createMplsRoute(label1, {mpls_path1_2_1, mpls_path1_2_2}),
+      createMplsRoute(label2, {mpls_path1_2_2})};
+  routeUpdatesQueue.push(routeDbDelta);
+
+  // initial sync after cold start
+  ASSERT_TRUE(mockFibHandler->waitForCommitSyncFib());
+
+  std::vector<thrift::UnicastRoute> routes;
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 3);
+  mockFibHandler->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(mplsRoutes.size(), 2);
+  EXPECT_EQ(mockFibHandler->getSyncFibChunkCount(), 3);
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 0);
+  EXPECT_EQ(mockFibHandler->getFibMplsSyncCount(), 0);
+
+  // route updates once synced
+  routeDbDelta.unicastRoutesToUpdate.clear();
+  routeDbDelta.mplsRoutesToUpdate.clear();
+  routeDbDelta.unicastRoutesToDelete = {prefix1};
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForDeleteUnicastRoutes();
+
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 2);
+
+  // Restart
+  mockFibHandler->restart();
+  ASSERT_TRUE(mockFibHandler->waitForCommitSyncFib());
+
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 2);
+  mockFibHandler->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(mplsRoutes.size(), 2);
+  EXPECT_EQ(mockFibHandler->getSyncFibChunkCount(), 2);
+  EXPECT_EQ(mockFibHandler->getCommitSyncFibCount(), 1);
+}
+
+class FibGracefulRestartTestFixture : public FibTestFixture {
+ public:
+  FibGracefulRestartTestFixture() : FibTestFixture(true) {
+    fibOptions.gracefulRestart = true;
+    agentRoutes = {
+        createUnicastRoute(prefix1, {path1_2_1, path1_2_3}),
+        createUnicastRoute(prefix2, {path1_2_1}),
+        createUnicastRoute(prefix4, {path1_2_1})};
+    agentMplsRoutes = {createMplsRoute(label1, {mpls_path1_2_1})};
+  }
+};
+
+// routes of the agent from before the restart are reconciled with those of
+// Decision by route updates, instead of being replaced with a full sync
+TEST_F(FibGracefulRestartTestFixture, adoptAgentRoutes) {
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_1, path1_2_3}),
+      createUnicastRoute(prefix2, {path1_3_1}),
+      createUnicastRoute(prefix3, {path1_3_1})};
+  routeDbDelta.mplsRoutesToUpdate = {
+      createMplsRoute(label1, {mpls_path1_2_1}),
+      createMplsRoute(label2, {mpls_path1_2_1})};
+  routeUpdatesQueue.push(routeDbDelta);
+
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  mockFibHandler->waitForDeleteUnicastRoutes();
+  mockFibHandler->waitForUpdateMplsRoutes();
+
+  // prefix2 and prefix3 updated, stale prefix4 deleted, label2 added
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 0);
+  EXPECT_EQ(mockFibHandler->getFibMplsSyncCount(), 0);
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), agentRoutes.size() + 2);
+  EXPECT_EQ(mockFibHandler->getDelRoutesCount(), 1);
+  EXPECT_EQ(
+      mockFibHandler->getAddMplsRoutesCount(), agentMplsRoutes.size() + 1);
+  EXPECT_EQ(mockFibHandler->getDelMplsRoutesCount(), 0);
+
+  std::vector<thrift::UnicastRoute> routes;
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  thrift::RouteDatabase routeDb;
+  routeDb.unicastRoutes = routeDbDelta.unicastRoutesToUpdate;
+  thrift::RouteDatabase agentRouteDb;
+  agentRouteDb.unicastRoutes = routes;
+  EXPECT_TRUE(checkEqualRoutes(routeDb, agentRouteDb));
+  mockFibHandler->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(mplsRoutes.size(), 2);
+
+  // updates once reconciled
+  routeDbDelta.unicastRoutesToUpdate.clear();
+  routeDbDelta.mplsRoutesToUpdate.clear();
+  routeDbDelta.unicastRoutesToDelete = {prefix1};
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForDeleteUnicastRoutes();
+
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 2);
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 0);
+}
+
+class FibNextHopGroupsTestFixture : public FibTestFixture {
+ public:
+  FibNextHopGroupsTestFixture() {
+    fibOptions.enableNextHopGroups = true;
+  }
+
+  thrift::InterfaceDatabase
+  createInterfaceDb(bool isUp) {
+    thrift::InterfaceDatabase intfDb;
+    intfDb.thisNodeName = "node-1";
+    intfDb.interfaces[path1_2_1.address.ifName.value()].isUp = true;
+    intfDb.interfaces[path1_2_3.address.ifName.value()].isUp = isUp;
+    return intfDb;
+  }
+};
+
+// routes sharing next-hops move to new ones with a single group update
+TEST_F(FibNextHopGroupsTestFixture, nextHopGroups) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  interfaceUpdatesQueue.push(createInterfaceDb(true));
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  for (auto const& prefix : {prefix1, prefix2, prefix3, prefix4}) {
+    routeDbDelta.unicastRoutesToUpdate.emplace_back(
+        createUnicastRoute(prefix, {path1_2_1, path1_2_3}));
+  }
+  routeUpdatesQueue.push(routeDbDelta);
+  ASSERT_TRUE(mockFibHandler->waitForUpdateGroupedUnicastRoutes());
+
+  EXPECT_EQ(mockFibHandler->getGroupedRoutesCount(), 4);
+  EXPECT_EQ(mockFibHandler->getNextHopGroupUpdatesCount(), 1);
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 0);
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(routes.size(), 4);
+  for (auto const& route : routes) {
+    EXPECT_EQ(route.nextHops.size(), 2);
+  }
+
+  // groups get rewritten with nothing in flight, wait for Fib to log the
+  // programming of the grouped update once it got the response
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (true) {
+    const auto perfDb = getPerfDb();
+    if (not perfDb.routeProgrammingStats.empty() and
+        perfDb.routeProgrammingStats.back().numUnicastRoutes == 4) {
+      break;
+    }
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+        << "Fib didn't get the response to the grouped update";
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // link down, all routes move to the remaining next-hop
+  interfaceUpdatesQueue.push(createInterfaceDb(false));
+  ASSERT_TRUE(mockFibHandler->waitForUpdateGroupedUnicastRoutes());
+
+  EXPECT_EQ(mockFibHandler->getGroupedRoutesCount(), 4);
+  EXPECT_EQ(mockFibHandler->getNextHopGroupUpdatesCount(), 2);
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(routes.size(), 4);
+  for (auto const& route : routes) {
+    ASSERT_EQ(route.nextHops.size(), 1);
+    EXPECT_EQ(
+        route.nextHops.at(0).address.ifName.value(),
+        path1_2_1.address.ifName.value());
+  }
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 0);
+}
+
+class FibCriticalPrefixesTestFixture : public FibTestFixture {
+ public:
+  FibCriticalPrefixesTestFixture() {
+    fibOptions.criticalPrefixes = {toIPNetwork(prefix1)};
+  }
+};
+
+// updates of critical prefixes and node labels go in a batch of their own
+TEST_F(FibCriticalPrefixesTestFixture, criticalRoutesFirst) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  const int32_t nodeLabel = Constants::kSrGlobalRange.first;
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix2, {path1_2_1}),
+      createUnicastRoute(prefix1, {path1_2_1}),
+      createUnicastRoute(prefix3, {path1_2_2})};
+  routeDbDelta.mplsRoutesToUpdate = {
+      createMplsRoute(label1, {mpls_path1_2_1}),
+      createMplsRoute(nodeLabel, {mpls_path1_2_1})};
+  routeUpdatesQueue.push(routeDbDelta);
+
+  // the batches complete on the Fib thread after the agent replied
+  auto perfDb = getPerfDb();
+  while (perfDb.routeProgrammingStats.size() < 3) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    perfDb = getPerfDb();
+  }
+  ASSERT_EQ(3, perfDb.routeProgrammingStats.size());
+  std::set<std::pair<int64_t, int64_t>> batches;
+  for (size_t i = 1; i < perfDb.routeProgrammingStats.size(); ++i) {
+    auto const& batch = perfDb.routeProgrammingStats.at(i);
+    EXPECT_TRUE(batch.success);
+    batches.emplace(batch.numUnicastRoutes, batch.numMplsRoutes);
+  }
+  // prefix1 and the node label first, the rest after
+  EXPECT_EQ(
+      (std::set<std::pair<int64_t, int64_t>>{{1, 1}, {2, 1}}), batches);
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(3, routes.size());
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  mockFibHandler->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(2, mplsRoutes.size());
+
+  auto counters = fb303::fbData->getCounters();
+  EXPECT_EQ(1, counters.count("fib.route_programming_latency_ms.critical.avg"));
+  EXPECT_EQ(1, counters.count("fib.route_programming_latency_ms.normal.avg"));
+}
+
+class FibDownloadPolicyTestFixture : public FibTestFixture {
+ public:
+  FibDownloadPolicyTestFixture() {
+    fibOptions.downloadPrefixes = {toIPNetwork(prefix1)};
+    fibOptions.downloadPrefixTypes = {thrift::PrefixType::BGP};
+  }
+};
+
+// only routes within download prefixes or of download types are programmed,
+// route APIs show all of them
+TEST_F(FibDownloadPolicyTestFixture, suppressRoutes) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+
+  auto bgpRoute = createUnicastRoute(prefix3, {path1_2_2});
+  bgpRoute.prefixType = thrift::PrefixType::BGP;
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_1}),
+      createUnicastRoute(prefix2, {path1_2_1}),
+      bgpRoute};
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(2, routes.size());
+  EXPECT_EQ(3, getRouteDb().unicastRoutes.size());
+  EXPECT_EQ(1, getUnicastRoutesFiltered(
+                   std::make_unique<std::vector<std::string>>(
+                       std::vector<std::string>{toString(prefix2)}))
+                   .size());
+  EXPECT_EQ(1, fb303::fbData->getCounters().at("fib.num_suppressed_routes"));
+
+  // prefix3 is no BGP route any more and gets deleted, suppressed prefix2
+  // was never programmed
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix3, {path1_2_2})};
+  routeDbDelta.unicastRoutesToDelete = {prefix2};
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForDeleteUnicastRoutes();
+
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(1, routes.size());
+  EXPECT_EQ(prefix1, routes.at(0).dest);
+  EXPECT_EQ(1, mockFibHandler->getDelRoutesCount());
+  EXPECT_EQ(2, getRouteDb().unicastRoutes.size());
+}
+
+// routes the agent fails to program are retried on their own, without a full
+// sync of the others
+TEST_F(FibTestFixture, retryFailedRoutes) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->waitForSyncMplsFib();
+  const auto numSyncs = mockFibHandler->getFibSyncCount();
+
+  mockFibHandler->setFailingPrefixes({toIPNetwork(prefix2)});
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_1}),
+      createUnicastRoute(prefix2, {path1_2_2})};
+  routeUpdatesQueue.push(routeDbDelta);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(1, routes.size());
+  EXPECT_EQ(prefix1, routes.at(0).dest);
+
+  // retried till the agent programs it
+  mockFibHandler->setFailingPrefixes({});
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (routes.size() < 2) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+        << "failed route didn't get retried";
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    mockFibHandler->getRouteTableByClient(routes, kFibId);
+  }
+  EXPECT_EQ(numSyncs, mockFibHandler->getFibSyncCount());
+  EXPECT_EQ(2, mockFibHandler->getAddRoutesCount());
+  EXPECT_LE(1, fb303::fbData->getCounters().at("fib.route_failures.sum"));
+}
+
 TEST_F(FibTestFixture, getMslpRoutesFilteredTest) {
   // Make sure fib starts with clean route database
   std::vector<thrift::UnicastRoute> routes;
@@ -897,6 +1537,20 @@ TEST_F(FibTestFixture, getUnicastRoutesFilteredTest) {
   const auto& notFoundResp =
       getUnicastRoutesFiltered(std::move(notFoundFilter));
   EXPECT_EQ(notFoundResp.size(), 0);
+
+  // deleted prefix2 no longer matches
+  thrift::RouteDatabaseDelta deleteDb;
+  deleteDb.thisNodeName = "node-1";
+  deleteDb.unicastRoutesToDelete.emplace_back(prefix2);
+  routeUpdatesQueue.push(deleteDb);
+  mockFibHandler->waitForDeleteUnicastRoutes();
+  auto deletedFilter = std::unique_ptr<std::vector<std::string>>(
+      new std::vector<std::string>({"192.168.0.0", "192.168.20.19"}));
+  thrift::RouteDatabase deletedDb;
+  deletedDb.unicastRoutes = getUnicastRoutesFiltered(std::move(deletedFilter));
+  thrift::RouteDatabase expectedDeletedDb;
+  expectedDeletedDb.unicastRoutes.emplace_back(route1);
+  EXPECT_TRUE(checkEqualRoutes(expectedDeletedDb, deletedDb));
 }
 
 TEST_F(FibTestFixture, longestPrefixMatchTest) {
@@ -960,6 +1614,50 @@ TEST_F(FibTestFixture, longestPrefixMatchTest) {
   EXPECT_EQ(result7.value(), dbPrefix3);
 }
 
+TEST(FibTest, mergeRouteDbDelta) {
+  thrift::RouteDatabaseDelta delta;
+  delta.thisNodeName = "node-1";
+  delta.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix1, {path1_2_1}),
+      createUnicastRoute(prefix2, {path1_2_1}),
+      createUnicastRoute(prefix3, {path1_2_1})};
+  delta.unicastRoutesToDelete = {prefix4};
+  delta.mplsRoutesToUpdate = {createMplsRoute(label1, {mpls_path1_2_1})};
+  delta.mplsRoutesToDelete = {label2};
+
+  thrift::RouteDatabaseDelta later;
+  later.thisNodeName = "node-1";
+  auto doNotInstallRoute = createUnicastRoute(prefix3, {path1_2_3});
+  doNotInstallRoute.doNotInstall = true;
+  later.unicastRoutesToUpdate = {
+      createUnicastRoute(prefix2, {path1_2_2}),
+      createUnicastRoute(prefix4, {path1_2_2}),
+      doNotInstallRoute};
+  later.unicastRoutesToDelete = {prefix1};
+  later.mplsRoutesToUpdate = {createMplsRoute(label2, {mpls_path1_2_2})};
+  later.mplsRoutesToDelete = {label1};
+  later.perfEvents = thrift::PerfEvents();
+
+  Fib::mergeRouteDbDelta(delta, std::move(later));
+
+  // later ones replace earlier updates and deletes, doNotInstall is skipped
+  std::unordered_map<thrift::IpPrefix, thrift::UnicastRoute> unicastRoutes;
+  for (auto const& route : delta.unicastRoutesToUpdate) {
+    EXPECT_TRUE(unicastRoutes.emplace(route.dest, route).second);
+  }
+  EXPECT_EQ(3, unicastRoutes.size());
+  EXPECT_EQ(path1_2_1, unicastRoutes.at(prefix3).nextHops.at(0));
+  EXPECT_EQ(path1_2_2, unicastRoutes.at(prefix2).nextHops.at(0));
+  EXPECT_EQ(path1_2_2, unicastRoutes.at(prefix4).nextHops.at(0));
+  EXPECT_EQ(
+      std::vector<thrift::IpPrefix>{prefix1}, delta.unicastRoutesToDelete);
+
+  ASSERT_EQ(1, delta.mplsRoutesToUpdate.size());
+  EXPECT_EQ(label2, delta.mplsRoutesToUpdate.at(0).topLabel);
+  EXPECT_EQ(std::vector<int32_t>{label1}, delta.mplsRoutesToDelete);
+  EXPECT_TRUE(delta.perfEvents.has_value());
+}
+
 TEST_F(FibTestFixture, doNotInstall) {
   // Make sure fib starts with clean route database
   std::vector<thrift::UnicastRoute> routes;
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <folly/futures/Future.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/fib/InProcessFibClient.h>
+
+using namespace openr;
+
+namespace {
+
+const int16_t kClientId{786};
+
+const auto prefix1 = toIpPrefix("10.1.1.0/24");
+const auto prefix2 = toIpPrefix("10.2.2.0/24");
+
+const auto nextHop1 = createNextHop(
+    toBinaryAddress(folly::IPAddress("fe80::1")), std::string("iface1"), 1);
+
+// agent implementing the future_ flavor, as NetlinkFibHandler does
+class TestFibHandler final : public thrift::FibServiceSvIf {
+ public:
+  folly::Future<folly::Unit>
+  future_addUnicastRoutes(
+      int16_t clientId,
+      std::unique_ptr<std::vector<thrift::UnicastRoute>> routes) override {
+    for (auto& route : *routes) {
+      routes_[clientId].emplace_back(std::move(route));
+    }
+    return folly::makeFuture();
+  }
+
+  folly::Future<folly::Unit>
+  future_syncFib(
+      int16_t /* clientId */,
+      std::unique_ptr<std::vector<thrift::UnicastRoute>> routes) override {
+    thrift::PlatformFibUpdateError error;
+    for (auto const& route : *routes) {
+      error.failedPrefixes.emplace_back(route.dest);
+    }
+    return folly::makeFuture<folly::Unit>(std::move(error));
+  }
+
+  folly::Future<std::unique_ptr<std::vector<thrift::UnicastRoute>>>
+  future_getRouteTableByClient(int16_t clientId) override {
+    return folly::makeFuture(
+        std::make_unique<std::vector<thrift::UnicastRoute>>(routes_[clientId]));
+  }
+
+  int64_t
+  aliveSince() override {
+    return 42;
+  }
+
+  // never replies
+  folly::Future<int64_t>
+  future_longPollAliveSince(
+      int64_t /* aliveSince */, int32_t /* timeoutMs */) override {
+    return longPollPromise_.getFuture();
+  }
+
+ private:
+  std::unordered_map<int16_t, std::vector<thrift::UnicastRoute>> routes_;
+  folly::Promise<int64_t> longPollPromise_;
+};
+
+} // namespace
+
+TEST(InProcessFibClientTest, ForwardsToHandler) {
+  InProcessFibClient client(std::make_shared<TestFibHandler>());
+
+  client
+      .semifuture_addUnicastRoutes(
+          kClientId,
+          {createUnicastRoute(prefix1, {nextHop1}),
+           createUnicastRoute(prefix2, {nextHop1})})
+      .get();
+
+  std::vector<thrift::UnicastRoute> routes;
+  client.sync_getRouteTableByClient(routes, kClientId);
+  ASSERT_EQ(2, routes.size());
+  EXPECT_EQ(prefix1, routes.at(0).dest);
+  EXPECT_EQ(prefix2, routes.at(1).dest);
+
+  client.sync_getRouteTableByClient(routes, kClientId + 1);
+  EXPECT_TRUE(routes.empty());
+
+  EXPECT_EQ(42, client.sync_aliveSince());
+  EXPECT_EQ(42, client.semifuture_aliveSince().get());
+}
+
+TEST(InProcessFibClientTest, Errors) {
+  InProcessFibClient client(std::make_shared<TestFibHandler>());
+
+  // errors of the agent are passed on as they are
+  try {
+    client.sync_syncFib(kClientId, {createUnicastRoute(prefix1, {nextHop1})});
+    FAIL() << "syncFib succeeded";
+  } catch (thrift::PlatformFibUpdateError const& error) {
+    ASSERT_EQ(1, error.failedPrefixes.size());
+    EXPECT_EQ(prefix1, error.failedPrefixes.at(0));
+  }
+
+  // calls time out like those of a thrift client
+  apache::thrift::RpcOptions options;
+  options.setTimeout(std::chrono::milliseconds(10));
+  auto result =
+      client.semifuture_longPollAliveSince(options, 42, 1000).getTry();
+  EXPECT_TRUE(result.hasException<folly::FutureTimeout>());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -51,7 +51,7 @@ MockNetlinkFibHandler::addUnicastRoute(
         }) |
         as<std::unordered_set<std::pair<std::string, folly::IPAddress>>>();
 
-    unicastRouteDb_.emplace(prefix, newNextHops);
+    unicastRouteDb_[prefix] = std::move(newNextHops);
   }
 }
 
@@ -70,6 +70,18 @@ MockNetlinkFibHandler::deleteUnicastRoute(
 void
 MockNetlinkFibHandler::addUnicastRoutes(
     int16_t, std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> routes) {
+  thrift::PlatformFibUpdateError fibError;
+  SYNCHRONIZED(failingPrefixes_) {
+    auto const it = std::remove_if(
+        routes->begin(), routes->end(), [&](thrift::UnicastRoute const& route) {
+          if (not failingPrefixes_.count(toIPNetwork(route.dest))) {
+            return false;
+          }
+          fibError.failedPrefixes.emplace_back(route.dest);
+          return true;
+        });
+    routes->erase(it, routes->end());
+  }
   SYNCHRONIZED(unicastRouteDb_) {
     for (auto const& route : *routes) {
       auto prefix = std::make_pair(
@@ -82,11 +94,28 @@ MockNetlinkFibHandler::addUnicastRoutes(
           }) |
           as<std::unordered_set<std::pair<std::string, folly::IPAddress>>>();
 
-      unicastRouteDb_.emplace(prefix, newNextHops);
+      // add or update, like the real agent
+      unicastRouteDb_[prefix] = std::move(newNextHops);
+    }
+  }
+  SYNCHRONIZED(chunkedSync_) {
+    if (chunkedSync_.has_value()) {
+      for (auto const& route : *routes) {
+        chunkedSync_->prefixes.emplace(toIPNetwork(route.dest));
+      }
+    }
+  }
+  SYNCHRONIZED(nextHopGroups_) {
+    for (auto const& route : *routes) {
+      nextHopGroups_.groupIds.erase(toIPNetwork(route.dest));
     }
   }
   addRoutesCount_ += routes->size();
   updateUnicastRoutesBaton_.post();
+  if (fibError.failedPrefixes.size()) {
+    fibError.message = "Failing prefixes";
+    throw fibError;
+  }
 }
 
 void
@@ -100,6 +129,18 @@ MockNetlinkFibHandler::deleteUnicastRoutes(
       unicastRouteDb_.erase(myPrefix);
     }
   }
+  SYNCHRONIZED(chunkedSync_) {
+    if (chunkedSync_.has_value()) {
+      for (auto const& prefix : *prefixes) {
+        chunkedSync_->prefixes.erase(toIPNetwork(prefix));
+      }
+    }
+  }
+  SYNCHRONIZED(nextHopGroups_) {
+    for (auto const& prefix : *prefixes) {
+      nextHopGroups_.groupIds.erase(toIPNetwork(prefix));
+    }
+  }
   delRoutesCount_ += prefixes->size();
   deleteUnicastRoutesBaton_.post();
 }
@@ -107,6 +148,9 @@ MockNetlinkFibHandler::deleteUnicastRoutes(
 void
 MockNetlinkFibHandler::syncFib(
     int16_t, std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> routes) {
+  SYNCHRONIZED(nextHopGroups_) {
+    nextHopGroups_ = NextHopGroups();
+  }
   SYNCHRONIZED(unicastRouteDb_) {
     VLOG(3) << "MockNetlinkFibHandler: Sync Fib.... " << (*routes).size()
             << " entries";
@@ -137,6 +181,13 @@ MockNetlinkFibHandler::addMplsRoutes(
       mplsRouteDb_[route.topLabel] = std::move(route.nextHops);
     }
   }
+  SYNCHRONIZED(chunkedSync_) {
+    if (chunkedSync_.has_value()) {
+      for (auto const& route : *routes) {
+        chunkedSync_->labels.emplace(route.topLabel);
+      }
+    }
+  }
   addMplsRoutesCount_ += routes->size();
   updateMplsRoutesBaton_.post();
 }
@@ -149,6 +200,13 @@ MockNetlinkFibHandler::deleteMplsRoutes(
       mplsRouteDb_.erase(label);
     }
   }
+  SYNCHRONIZED(chunkedSync_) {
+    if (chunkedSync_.has_value()) {
+      for (auto const& label : *labels) {
+        chunkedSync_->labels.erase(label);
+      }
+    }
+  }
   delMplsRoutesCount_ += labels->size();
   deleteMplsRoutesBaton_.post();
 }
@@ -166,6 +224,149 @@ MockNetlinkFibHandler::syncMplsFib(
   syncMplsFibBaton_.post();
 }
 
+void
+MockNetlinkFibHandler::beginSyncFib(int16_t, int64_t syncId, bool syncMpls) {
+  SYNCHRONIZED(nextHopGroups_) {
+    nextHopGroups_ = NextHopGroups();
+  }
+  SYNCHRONIZED(chunkedSync_) {
+    chunkedSync_ = ChunkedSync();
+    chunkedSync_->syncId = syncId;
+    chunkedSync_->syncMpls = syncMpls;
+  }
+}
+
+void
+MockNetlinkFibHandler::syncFibChunk(
+    int16_t,
+    int64_t syncId,
+    std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> routes,
+    std::unique_ptr<std::vector<openr::thrift::MplsRoute>> mplsRoutes) {
+  SYNCHRONIZED(chunkedSync_) {
+    if (not chunkedSync_.has_value() or chunkedSync_->syncId != syncId) {
+      thrift::PlatformError error;
+      error.message = folly::sformat("No FIB sync {} in progress", syncId);
+      throw error;
+    }
+    for (auto const& route : *routes) {
+      chunkedSync_->prefixes.emplace(toIPNetwork(route.dest));
+    }
+    for (auto const& route : *mplsRoutes) {
+      chunkedSync_->labels.emplace(route.topLabel);
+    }
+  }
+  SYNCHRONIZED(unicastRouteDb_) {
+    for (auto const& route : *routes) {
+      unicastRouteDb_[toIPNetwork(route.dest)] =
+          from(route.nextHops) | mapped([](const thrift::NextHopThrift& nh) {
+            return std::make_pair(
+                nh.address.ifName.value(), toIPAddress(nh.address));
+          }) |
+          as<std::unordered_set<std::pair<std::string, folly::IPAddress>>>();
+    }
+  }
+  SYNCHRONIZED(mplsRouteDb_) {
+    for (auto& route : *mplsRoutes) {
+      mplsRouteDb_[route.topLabel] = std::move(route.nextHops);
+    }
+  }
+  syncFibChunkCount_++;
+}
+
+void
+MockNetlinkFibHandler::commitSyncFib(int16_t, int64_t syncId) {
+  std::optional<ChunkedSync> sync;
+  SYNCHRONIZED(chunkedSync_) {
+    if (not chunkedSync_.has_value() or chunkedSync_->syncId != syncId) {
+      thrift::PlatformError error;
+      error.message = folly::sformat("No FIB sync {} in progress", syncId);
+      throw error;
+    }
+    sync = std::exchange(chunkedSync_, std::nullopt);
+  }
+  SYNCHRONIZED(unicastRouteDb_) {
+    for (auto it = unicastRouteDb_.begin(); it != unicastRouteDb_.end();) {
+      it = sync->prefixes.count(it->first) ? std::next(it)
+                                           : unicastRouteDb_.erase(it);
+    }
+  }
+  if (sync->syncMpls) {
+    SYNCHRONIZED(mplsRouteDb_) {
+      for (auto it = mplsRouteDb_.begin(); it != mplsRouteDb_.end();) {
+        it = sync->labels.count(it->first) ? std::next(it)
+                                           : mplsRouteDb_.erase(it);
+      }
+    }
+  }
+  commitSyncFibCount_++;
+  commitSyncFibBaton_.post();
+}
+
+void
+MockNetlinkFibHandler::updateGroupedUnicastRoutes(
+    int16_t, std::unique_ptr<openr::thrift::GroupedRouteUpdate> update) {
+  auto toNextHops = [](std::vector<thrift::NextHopThrift> const& nextHops) {
+    return from(nextHops) | mapped([](const thrift::NextHopThrift& nh) {
+             return std::make_pair(
+                 nh.address.ifName.value(), toIPAddress(nh.address));
+           }) |
+        as<std::unordered_set<std::pair<std::string, folly::IPAddress>>>();
+  };
+
+  SYNCHRONIZED(nextHopGroups_) {
+    SYNCHRONIZED(unicastRouteDb_) {
+      for (auto const& group : update->nextHopGroupsToUpdate) {
+        nextHopGroups_.nextHops[group.id] = group.nextHops;
+        for (auto const& kv : nextHopGroups_.groupIds) {
+          if (kv.second == group.id) {
+            unicastRouteDb_[kv.first] = toNextHops(group.nextHops);
+          }
+        }
+      }
+      for (auto const& route : update->unicastRoutesToUpdate) {
+        auto it = nextHopGroups_.nextHops.find(route.nextHopGroupId);
+        if (it == nextHopGroups_.nextHops.end()) {
+          thrift::PlatformError error;
+          error.message = folly::sformat(
+              "Unknown next-hop group {}", route.nextHopGroupId);
+          throw error;
+        }
+        const auto prefix = toIPNetwork(route.dest);
+        nextHopGroups_.groupIds[prefix] = route.nextHopGroupId;
+        unicastRouteDb_[prefix] = toNextHops(it->second);
+      }
+      for (auto const& prefix : update->unicastRoutesToDelete) {
+        nextHopGroups_.groupIds.erase(toIPNetwork(prefix));
+        unicastRouteDb_.erase(toIPNetwork(prefix));
+      }
+    }
+    for (auto const id : update->nextHopGroupsToDelete) {
+      for (auto const& kv : nextHopGroups_.groupIds) {
+        if (kv.second == id) {
+          thrift::PlatformError error;
+          error.message =
+              folly::sformat("Next-hop group {} is still in use", id);
+          throw error;
+        }
+      }
+      nextHopGroups_.nextHops.erase(id);
+    }
+  }
+  SYNCHRONIZED(chunkedSync_) {
+    if (chunkedSync_.has_value()) {
+      for (auto const& route : update->unicastRoutesToUpdate) {
+        chunkedSync_->prefixes.emplace(toIPNetwork(route.dest));
+      }
+      for (auto const& prefix : update->unicastRoutesToDelete) {
+        chunkedSync_->prefixes.erase(toIPNetwork(prefix));
+      }
+    }
+  }
+  groupedRoutesCount_ += update->unicastRoutesToUpdate.size();
+  nextHopGroupUpdatesCount_ += update->nextHopGroupsToUpdate.size();
+  updateGroupedUnicastRoutesBaton_.post();
+}
+
 int64_t
 MockNetlinkFibHandler::aliveSince() {
   int64_t res = 0;
@@ -175,6 +376,19 @@ MockNetlinkFibHandler::aliveSince() {
   return res;
 }
 
+void
+MockNetlinkFibHandler::async_tm_longPollAliveSince(
+    std::unique_ptr<apache::thrift::HandlerCallback<int64_t>> callback,
+    int64_t aliveSince,
+    int32_t /* timeoutMs */) {
+  const auto startTime = *startTime_.rlock();
+  if (aliveSince != startTime) {
+    callback->result(startTime);
+    return;
+  }
+  aliveSincePolls_->emplace_back(std::move(callback));
+}
+
 void
 MockNetlinkFibHandler::getRouteTableByClient(
     std::vector<openr::thrift::UnicastRoute>& routes, int16_t) {
@@ -255,8 +469,32 @@ MockNetlinkFibHandler::waitForSyncMplsFib() {
   syncMplsFibBaton_.reset();
 }
 
+bool
+MockNetlinkFibHandler::waitForCommitSyncFib(std::chrono::milliseconds timeout) {
+  if (not commitSyncFibBaton_.try_wait_for(timeout)) {
+    return false;
+  }
+  commitSyncFibBaton_.reset();
+  return true;
+}
+
+bool
+MockNetlinkFibHandler::waitForUpdateGroupedUnicastRoutes(
+    std::chrono::milliseconds timeout) {
+  if (not updateGroupedUnicastRoutesBaton_.try_wait_for(timeout)) {
+    return false;
+  }
+  updateGroupedUnicastRoutesBaton_.reset();
+  return true;
+}
+
 void
 MockNetlinkFibHandler::stop() {
+  // reply while the server still runs
+  const auto startTime = *startTime_.rlock();
+  for (auto& callback : std::exchange(*aliveSincePolls_.wlock(), {})) {
+    callback->result(startTime);
+  }
   SYNCHRONIZED(unicastRouteDb_) {
     unicastRouteDb_.clear();
   }
@@ -266,6 +504,10 @@ MockNetlinkFibHandler::stop() {
   fibMplsSyncCount_ = 0;
   addMplsRoutesCount_ = 0;
   delMplsRoutesCount_ = 0;
+  syncFibChunkCount_ = 0;
+  commitSyncFibCount_ = 0;
+  groupedRoutesCount_ = 0;
+  nextHopGroupUpdatesCount_ = 0;
 }
 
 void
@@ -274,11 +516,21 @@ MockNetlinkFibHandler::restart() {
   LOG(INFO) << "Restarting fib agent";
   unicastRouteDb_->clear();
   mplsRouteDb_->clear();
+  chunkedSync_->reset();
+  SYNCHRONIZED(nextHopGroups_) {
+    nextHopGroups_ = NextHopGroups();
+  }
 
+  int64_t startTime{0};
   SYNCHRONIZED(startTime_) {
     startTime_ = std::chrono::duration_cast<std::chrono::seconds>(
                      std::chrono::system_clock::now().time_since_epoch())
                      .count();
+    startTime = startTime_;
+  }
+  // clients waiting on the long-poll learn about it right away
+  for (auto& callback : std::exchange(*aliveSincePolls_.wlock(), {})) {
+    callback->result(startTime);
   }
   fibSyncCount_ = 0;
   addRoutesCount_ = 0;
@@ -286,6 +538,10 @@ MockNetlinkFibHandler::restart() {
   fibMplsSyncCount_ = 0;
   addMplsRoutesCount_ = 0;
   delMplsRoutesCount_ = 0;
+  syncFibChunkCount_ = 0;
+  commitSyncFibCount_ = 0;
+  groupedRoutesCount_ = 0;
+  nextHopGroupUpdatesCount_ = 0;
 }
 
 } // namespace openr
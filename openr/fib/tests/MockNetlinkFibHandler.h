@@ -11,8 +11,10 @@
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <folly/futures/Future.h>
 #include <folly/io/async/AsyncSocket.h>
@@ -76,6 +78,21 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
       int16_t clientId,
       std::unique_ptr<std::vector<openr::thrift::MplsRoute>> routes) override;
 
+  void beginSyncFib(int16_t clientId, int64_t syncId, bool syncMpls) override;
+
+  void syncFibChunk(
+      int16_t clientId,
+      int64_t syncId,
+      std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> routes,
+      std::unique_ptr<std::vector<openr::thrift::MplsRoute>> mplsRoutes)
+      override;
+
+  void commitSyncFib(int16_t clientId, int64_t syncId) override;
+
+  void updateGroupedUnicastRoutes(
+      int16_t clientId,
+      std::unique_ptr<openr::thrift::GroupedRouteUpdate> update) override;
+
   // Wait for adding/deleting routes to complete
   void waitForUpdateUnicastRoutes();
   void waitForDeleteUnicastRoutes();
@@ -83,9 +100,22 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   void waitForUpdateMplsRoutes();
   void waitForDeleteMplsRoutes();
   void waitForSyncMplsFib();
+  // false if no full sync in chunks got committed within timeout
+  bool waitForCommitSyncFib(
+      std::chrono::milliseconds timeout = std::chrono::seconds(10));
+  // false if no grouped route update got programmed within timeout
+  bool waitForUpdateGroupedUnicastRoutes(
+      std::chrono::milliseconds timeout = std::chrono::seconds(10));
 
   int64_t aliveSince() override;
 
+  // replies on restart only, calls outstanding for timeoutMs time out on the
+  // client instead
+  void async_tm_longPollAliveSince(
+      std::unique_ptr<apache::thrift::HandlerCallback<int64_t>> callback,
+      int64_t aliveSince,
+      int32_t timeoutMs) override;
+
   void getRouteTableByClient(
       std::vector<openr::thrift::UnicastRoute>& routes,
       int16_t clientId) override;
@@ -119,6 +149,29 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   getDelMplsRoutesCount() {
     return delMplsRoutesCount_;
   }
+  size_t
+  getSyncFibChunkCount() {
+    return syncFibChunkCount_;
+  }
+  size_t
+  getCommitSyncFibCount() {
+    return commitSyncFibCount_;
+  }
+  size_t
+  getGroupedRoutesCount() {
+    return groupedRoutesCount_;
+  }
+  size_t
+  getNextHopGroupUpdatesCount() {
+    return nextHopGroupUpdatesCount_;
+  }
+
+  // fail adds of routes of prefixes with PlatformFibUpdateError, the other
+  // routes of the batch get programmed
+  void
+  setFailingPrefixes(std::unordered_set<folly::CIDRNetwork> prefixes) {
+    failingPrefixes_ = std::move(prefixes);
+  }
 
   void stop();
 
@@ -136,6 +189,31 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
       std::unordered_map<int32_t, std::vector<thrift::NextHopThrift>>>
       mplsRouteDb_;
 
+  // Chunked sync in progress
+  struct ChunkedSync {
+    int64_t syncId{0};
+    bool syncMpls{false};
+    // programmed by the sync or added since it began, kept on commit
+    std::unordered_set<folly::CIDRNetwork> prefixes;
+    std::unordered_set<int32_t> labels;
+  };
+  folly::Synchronized<std::optional<ChunkedSync>> chunkedSync_;
+
+  // Next-hop groups, and the prefixes using them
+  struct NextHopGroups {
+    std::unordered_map<int64_t, std::vector<thrift::NextHopThrift>> nextHops;
+    std::unordered_map<folly::CIDRNetwork, int64_t> groupIds;
+  };
+  folly::Synchronized<NextHopGroups> nextHopGroups_;
+
+  // outstanding longPollAliveSince calls
+  folly::Synchronized<
+      std::vector<std::unique_ptr<apache::thrift::HandlerCallback<int64_t>>>>
+      aliveSincePolls_;
+
+  // see setFailingPrefixes
+  folly::Synchronized<std::unordered_set<folly::CIDRNetwork>> failingPrefixes_;
+
   // Stats
   std::atomic<size_t> fibSyncCount_{0};
   std::atomic<size_t> addRoutesCount_{0};
@@ -143,6 +221,10 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   std::atomic<size_t> fibMplsSyncCount_{0};
   std::atomic<size_t> addMplsRoutesCount_{0};
   std::atomic<size_t> delMplsRoutesCount_{0};
+  std::atomic<size_t> syncFibChunkCount_{0};
+  std::atomic<size_t> commitSyncFibCount_{0};
+  std::atomic<size_t> groupedRoutesCount_{0};
+  std::atomic<size_t> nextHopGroupUpdatesCount_{0};
 
   // A baton for synchronization
   folly::Baton<> updateUnicastRoutesBaton_;
@@ -151,6 +233,8 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   folly::Baton<> updateMplsRoutesBaton_;
   folly::Baton<> deleteMplsRoutesBaton_;
   folly::Baton<> syncMplsFibBaton_;
+  folly::Baton<> commitSyncFibBaton_;
+  folly::Baton<> updateGroupedUnicastRoutesBaton_;
 };
 
 } // namespace openr
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/fib/NextHopGroupTable.h>
+
+using namespace openr;
+
+namespace {
+
+const auto prefix1 = toIpPrefix("10.1.1.0/24");
+const auto prefix2 = toIpPrefix("10.2.2.0/24");
+const auto prefix3 = toIpPrefix("10.3.3.0/24");
+
+const auto nextHop1 = createNextHop(
+    toBinaryAddress(folly::IPAddress("fe80::1")), std::string("iface1"), 1);
+const auto nextHop2 = createNextHop(
+    toBinaryAddress(folly::IPAddress("fe80::2")), std::string("iface2"), 1);
+
+} // namespace
+
+TEST(NextHopGroupTableTest, SharedGroups) {
+  NextHopGroupTable table;
+
+  // same next-hops in any order share a group
+  auto update = table.update(
+      {createUnicastRoute(prefix1, {nextHop1, nextHop2}),
+       createUnicastRoute(prefix2, {nextHop2, nextHop1}),
+       createUnicastRoute(prefix3, {nextHop1})},
+      {},
+      false);
+  EXPECT_EQ(2, table.getNumGroups());
+  ASSERT_EQ(2, update.nextHopGroupsToUpdate.size());
+  ASSERT_EQ(3, update.unicastRoutesToUpdate.size());
+  EXPECT_EQ(table.getGroupId(prefix1), table.getGroupId(prefix2));
+  EXPECT_NE(table.getGroupId(prefix1), table.getGroupId(prefix3));
+
+  // unconfirmed groups are sent again with routes using them
+  update = table.update({createUnicastRoute(prefix3, {nextHop1})}, {}, false);
+  EXPECT_EQ(1, update.nextHopGroupsToUpdate.size());
+  table.confirmGroups();
+  update = table.update({createUnicastRoute(prefix3, {nextHop1})}, {}, false);
+  EXPECT_EQ(0, update.nextHopGroupsToUpdate.size());
+  EXPECT_EQ(1, update.unicastRoutesToUpdate.size());
+
+  // group of prefix3 unused after the delete, kept until taken
+  const auto id3 = table.getGroupId(prefix3).value();
+  update = table.update({}, {prefix3}, false);
+  EXPECT_EQ(
+      std::vector<thrift::IpPrefix>{prefix3}, update.unicastRoutesToDelete);
+  EXPECT_FALSE(table.getGroupId(prefix3).has_value());
+  EXPECT_EQ(2, table.getNumGroups());
+  EXPECT_EQ(std::vector<int64_t>{id3}, table.takeUnusedGroups());
+  EXPECT_EQ(1, table.getNumGroups());
+  EXPECT_TRUE(table.takeUnusedGroups().empty());
+}
+
+TEST(NextHopGroupTableTest, RewriteGroups) {
+  NextHopGroupTable table;
+  table.update(
+      {createUnicastRoute(prefix1, {nextHop1, nextHop2}),
+       createUnicastRoute(prefix2, {nextHop1, nextHop2})},
+      {},
+      true);
+  table.confirmGroups();
+  const auto id = table.getGroupId(prefix1).value();
+
+  // all routes of the group move to the same next-hops, only it is sent
+  auto update = table.update(
+      {createUnicastRoute(prefix1, {nextHop1}),
+       createUnicastRoute(prefix2, {nextHop1})},
+      {},
+      true);
+  ASSERT_EQ(1, update.nextHopGroupsToUpdate.size());
+  EXPECT_EQ(id, update.nextHopGroupsToUpdate.at(0).id);
+  EXPECT_EQ(
+      std::vector<thrift::NextHopThrift>{nextHop1},
+      update.nextHopGroupsToUpdate.at(0).nextHops);
+  EXPECT_TRUE(update.unicastRoutesToUpdate.empty());
+  EXPECT_EQ(id, table.getGroupId(prefix2));
+  table.confirmGroups();
+
+  // only some routes move, they get a new group
+  update = table.update({createUnicastRoute(prefix1, {nextHop2})}, {}, true);
+  ASSERT_EQ(1, update.nextHopGroupsToUpdate.size());
+  EXPECT_NE(id, update.nextHopGroupsToUpdate.at(0).id);
+  ASSERT_EQ(1, update.unicastRoutesToUpdate.size());
+  EXPECT_EQ(
+      update.nextHopGroupsToUpdate.at(0).id,
+      update.unicastRoutesToUpdate.at(0).nextHopGroupId);
+  EXPECT_EQ(2, table.getNumGroups());
+  table.confirmGroups();
+
+  // next-hops of another group, the route joins it instead of a rewrite
+  update = table.update({createUnicastRoute(prefix2, {nextHop2})}, {}, true);
+  EXPECT_TRUE(update.nextHopGroupsToUpdate.empty());
+  ASSERT_EQ(1, update.unicastRoutesToUpdate.size());
+  EXPECT_EQ(table.getGroupId(prefix1), table.getGroupId(prefix2));
+  EXPECT_EQ(std::vector<int64_t>{id}, table.takeUnusedGroups());
+
+  // without rewrites routes get moved one by one
+  update = table.update(
+      {createUnicastRoute(prefix1, {nextHop1}),
+       createUnicastRoute(prefix2, {nextHop1})},
+      {},
+      false);
+  EXPECT_EQ(1, update.nextHopGroupsToUpdate.size());
+  EXPECT_EQ(2, update.unicastRoutesToUpdate.size());
+
+  table.clear();
+  EXPECT_EQ(0, table.getNumGroups());
+  EXPECT_FALSE(table.getGroupId(prefix1).has_value());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
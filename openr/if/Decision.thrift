@@ -22,3 +22,30 @@ typedef map<string, Lsdb.AdjacencyDatabase>
 typedef map<string, Lsdb.PrefixDatabase>
   (cpp.type = "std::unordered_map<std::string, openr::thrift::PrefixDatabase>")
   PrefixDbs
+
+/**
+ * Timed span of Decision route computation, e.g. SPF for one root node. Spans
+ * are recorded into a ring buffer, see getDecisionTraceSpans()
+ */
+struct TraceSpan {
+  // position in the sequence of all spans recorded
+  1: i64 seqNum
+  // stage of route computation
+  2: string name
+  // stage specific detail, e.g. SPF root node or area. Truncated if long
+  3: string detail
+  // unix time in microseconds
+  4: i64 startTimeUs
+  5: i64 durationNs
+  // OS thread recording the span
+  6: i64 threadId
+  // stage specific value, e.g. number of prefixes built
+  7: i64 arg
+}
+
+struct TraceSpans {
+  // oldest first
+  1: list<TraceSpan> spans
+  // number of spans overwritten since start of Decision
+  2: i64 droppedSpans
+}
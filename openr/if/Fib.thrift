@@ -31,8 +31,26 @@ struct RouteDatabaseDelta {
   6: optional Lsdb.PerfEvents perfEvents;
 }
 
+// Programming of a batch of routes or of a full sync by the FibAgent
+struct RouteProgrammingStats {
+  // completion time
+  1: i64 unixTs = 0
+  2: i64 durationMs = 0
+  3: i64 numUnicastRoutes = 0
+  4: i64 numMplsRoutes = 0
+  // whole full sync, counts are all routes synced
+  5: bool isFullSync = false
+  // batch is a chunk of a full sync
+  6: bool isSyncChunk = false
+  7: bool success = false
+  // failed full syncs before this one, for full syncs
+  8: i32 numRetries = 0
+}
+
 // Perf log buffer maintained by Fib
 struct PerfDatabase {
   1: string thisNodeName
   2: list<Lsdb.PerfEvents> eventInfo
+  // latest route programming, oldest first
+  3: list<RouteProgrammingStats> routeProgrammingStats
 }
@@ -16,6 +16,22 @@ include "Dual.thrift"
 
 const string kDefaultArea = "0"
 
+// codecs values can be compressed with between KvStores
+enum CompressionType {
+  NONE = 0,
+  ZSTD = 1,
+  LZ4 = 2,
+}
+
+// algorithm of Value.hash, and how values of same version and originator
+// are ordered. All KvStores of a network must use the same one
+enum HashVersion {
+  // boost::hash_combine, values ordered by their bytes
+  V1 = 0,
+  // SpookyHashV2, values ordered by size, then hash, then bytes
+  V2 = 1,
+}
+
 // a value as reported in get replies/publications
 struct Value {
   // current version of this value
@@ -37,11 +53,28 @@ struct Value {
   // should leave it empty and as will be computed by KvStore on `KEY_SET`
   // operation.
   6: optional i64 hash;
+  // codec `value` is compressed with. Only set on the wire between KvStores
+  // of peers which negotiated it, KvStore stores and publishes values
+  // uncompressed
+  7: optional CompressionType compression;
 }
 
 typedef map<string, Value>
   (cpp.type = "std::unordered_map<std::string, openr::thrift::Value>") KeyVals
 
+// Compact TTL refresh of a key. It applies only to the stored value of the
+// same version and hash, and thus needs neither originatorId nor value
+struct TtlUpdate {
+  1: i64 version;
+  2: i64 ttlVersion;
+  3: i64 ttl;
+  4: i64 hash;
+}
+
+typedef map<string, TtlUpdate>
+  (cpp.type = "std::unordered_map<std::string, openr::thrift::TtlUpdate>")
+  TtlUpdates
+
 
 enum Command {
   // NOTE: key-10 has been used in past
@@ -85,6 +118,9 @@ struct KeySetParams {
   // optional attribute to indicate timestamp when request is sent. This is
   // system timestamp in milliseconds since epoch
   7: optional i64 timestamp_ms
+
+  // TTL refreshes in compact form, in addition to keyVals
+  8: optional TtlUpdates ttlUpdates
 }
 
 // parameters for the KEY_GET command
@@ -101,16 +137,44 @@ struct KeyDumpParams {
   1: string prefix
   3: set<string> originatorIds
   2: optional KeyVals keyValHashes
+  // Alternative to keyValHashes for full-sync. Hash of every bucket of the
+  // key space, only keys of buckets which differ get sent back
+  4: optional list<i64> keyValBucketHashes
+  // codecs the requester can decompress. Values of the response may be
+  // compressed with any of them
+  5: optional list<CompressionType> acceptCompression
+  // dump a page of at most maxKeys key-values, in key order. Ignored for
+  // full-sync requests
+  6: optional i32 maxKeys
+  // continue a paged dump after this key, the lastKey of the previous page
+  7: optional string startAfterKey
+  // Alternative to keyValHashes for full-sync. Hash of the keys of every
+  // originator, only keys of originators whose hash differs get sent back
+  8: optional map<string, i64> keyValOriginatorHashes
 }
 
 // Peer's publication and command socket URLs
 // This is used in peer add requests and in
 // the dump results
+// transport KvStore talks to a peer's KvStore over
+enum PeerTransport {
+  // ROUTER sockets to cmdUrl
+  ZMQ = 0,
+  // OpenrCtrl thrift server of the peer at ctrlAddr and ctrlPort
+  THRIFT = 1,
+}
+
 struct PeerSpec {
   1: string thriftPortUrl
   2: string cmdUrl
   // support flood optimization or not
   3: bool supportFloodOptimization = 0
+  // transport to use for the peer, KvStore's default if not set
+  4: optional PeerTransport transport
+  // address and port of the peer's OpenrCtrl thrift server. THRIFT transport
+  // falls back to ZMQ without them
+  5: string ctrlAddr
+  6: i32 ctrlPort = 0
 }
 
 typedef map<string, PeerSpec>
@@ -230,4 +294,49 @@ struct Publication {
 
   // area to which this publication belogs
   7: optional string area;
+
+  // buckets which differ in response to a full-sync request with
+  // keyValBucketHashes. keyVals contains all keys of these buckets and the
+  // initiator is expected to send back its better keys of them
+  8: optional list<i32> syncBuckets;
+
+  // compact TTL refreshes of a received KEY_SET. KvStore publishes applied
+  // ones as keyVals without value, same as any other TTL update
+  9: optional TtlUpdates ttlUpdates;
+
+  // codecs the responder of a full-sync can decompress. The initiator may
+  // compress values it sends to the responder with any of them
+  10: optional list<CompressionType> acceptCompression;
+
+  // last key of a page of a paged dump, set only if more key-values follow
+  11: optional string lastKey;
+
+  // generation of the area a paged dump was taken at. It changes with every
+  // update of the area, pages of different generations may be inconsistent
+  12: optional i64 generation;
+
+  // originators which differ in response to a full-sync request with
+  // keyValOriginatorHashes. keyVals contains all keys of these originators
+  // and the initiator is expected to send back its better keys of them
+  13: optional list<string> syncOriginators;
+}
+
+// key-values of a KvStore area saved to disk, loaded on restart before the
+// first full-sync with peers
+struct KvStoreSnapshot {
+  1: string area;
+
+  // when the snapshot was taken, TTLs of keyVals are what was left of them
+  // at that time
+  2: i64 timestamp_ms;
+
+  3: KeyVals keyVals;
+}
+
+// record of a capture of KvStore publications, see KvStoreCapture.h
+struct CapturedPublication {
+  // when the publication was received
+  1: i64 timestamp_ms;
+
+  2: Publication publication;
 }
@@ -62,6 +62,10 @@ struct InterfaceDatabase {
 
   // Optional attribute to measure convergence performance
   3: optional PerfEvents perfEvents;
+
+  // if set, interfaces only holds those changed since the previous database,
+  // others stay as they are
+  4: bool isDelta = 0
 }
 
 //
@@ -69,6 +73,21 @@ struct InterfaceDatabase {
 //
 
 // describes a specific adjacency to a neighbor node
+// state of the dampening of RTT based metric changes of an adjacency
+struct AdjacencyMetricDampening {
+  // latest metric derived from RTT, the advertised one may lag behind
+  1: i32 measuredMetric
+
+  // current penalty of metric changes
+  2: double penalty
+
+  // metric changes are held back
+  3: bool isSuppressed
+
+  // time until metric changes may be advertised again if suppressed
+  4: i64 reuseDelayMs
+}
+
 struct Adjacency {
   // must match a name bound to another node
   1: string otherNodeName
@@ -103,6 +122,9 @@ struct Adjacency {
 
   // interface the originator (peer) discover this node
   11: string otherIfName = ""
+
+  // only reported by LinkMonitor for its own adjacencies, never advertised
+  12: optional AdjacencyMetricDampening metricDampening
 }
 
 // full link state information of a single router
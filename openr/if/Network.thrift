@@ -95,6 +95,7 @@ enum PrefixType {
   BGP = 3,
   PREFIX_ALLOCATOR = 4,
   BREEZE = 5,   // Prefixes injected via breeze
+  SUMMARY = 6,  // Summaries of area prefixes, originated at area borders
 
   // Placeholder Types
   TYPE_1 = 21,
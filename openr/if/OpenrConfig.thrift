@@ -75,6 +75,10 @@ struct PrefixAllocationConfig {
 
 struct AreaConfig {
   1: string area_id
+  # Summary ranges of the prefixes of the area. Nodes at the border of the
+  # area advertise a range into their other areas while prefixes of the area
+  # within it exist, and keep their own prefixes within it in the area.
+  2: list<string> summary_prefixes = []
 }
 
 struct OpenrConfig {
@@ -30,6 +30,19 @@ struct StaticRoutes {
   1: map<i32,list<Network.NextHopThrift>> mplsRoutes;
 }
 
+/**
+ * Counters changed since the snapshot of a previous request
+ */
+struct CountersDelta {
+  1: map<string, i64> counters;
+
+  // token to pass with next request to get counters changed since this one
+  2: i64 token;
+
+  // counters holds all counters, requested base snapshot is not known
+  3: bool isFullDump;
+}
+
 
 /**
  * Thrift service - exposes RPC APIs for interaction with all of Open/R's
@@ -69,6 +82,22 @@ service OpenrCtrl extends fb303_core.BaseService {
     1: Network.PrefixType prefixType,
     2: list<Lsdb.PrefixEntry> prefixes) throws (1: OpenrError error)
 
+  /**
+   * Sync prefixes by type in chunks, for large sets of prefixes. Begin the
+   * sync, add prefixes in any number of calls and commit it. Prefixes of the
+   * type left out of all chunks are withdrawn on commit. Beginning again drops
+   * the sync in progress of the type.
+   */
+  void beginSyncPrefixesByType(1: Network.PrefixType prefixType)
+    throws (1: OpenrError error)
+
+  void addSyncPrefixesByType(
+    1: Network.PrefixType prefixType,
+    2: list<Lsdb.PrefixEntry> prefixes) throws (1: OpenrError error)
+
+  void commitSyncPrefixesByType(1: Network.PrefixType prefixType)
+    throws (1: OpenrError error)
+
   /**
    * Get all prefixes being advertised
    */
@@ -158,6 +187,14 @@ service OpenrCtrl extends fb303_core.BaseService {
    */
   Decision.PrefixDbs getDecisionPrefixDbs() throws (1: OpenrError error)
 
+  /**
+   * Get latest timed spans of route computation stages, e.g. deserialization,
+   * SPF per root node, route builds and delta computation. Useful for
+   * attributing convergence latency. Served from a fixed size ring buffer,
+   * so only the most recent spans are returned
+   */
+  Decision.TraceSpans getDecisionTraceSpans() throws (1: OpenrError error)
+
   //
   // Get area feature configuration
   //
@@ -357,6 +394,36 @@ service OpenrCtrl extends fb303_core.BaseService {
    */
   list<Monitor.EventLog> getEventLogs() throws (1: OpenrError error)
 
+  /**
+   * Get counters changed or added since the request which returned `token`.
+   * Pass 0 for all counters. Removed counters are not reported.
+   */
+  CountersDelta getCountersDelta(1: i64 token)
+
+  /**
+   * Get bytes allocated by each module with its own memory arena. Empty
+   * unless memory accounting is enabled and Open/R runs with jemalloc
+   */
+  map<string, i64> getMemoryUsageByModule()
+
+  /**
+   * CPU profile of module threads, sampled frequencyHz times per second of
+   * CPU time of each thread for durationMs. Returns folded stacks, one line
+   * "<module>;<frames, outermost first> <samples>" per stack. Needs Open/R to
+   * run with --enable_cpu_profiler. Profiles are bounded in duration and
+   * frequency and rate-limited, requests beyond fail.
+   */
+  string getCpuProfile(1: i32 durationMs, 2: i32 frequencyHz)
+    throws (1: OpenrError error)
+
+  /**
+   * Event base callbacks and fiber tasks of modules which ran longer than
+   * --watchdog_slow_callback_threshold_ms, most recent ones only. Span name
+   * is the kind of callback, "handler" or "fiber", detail the module and arg
+   * the id of the callback. Needs Open/R to run with --enable_watchdog.
+   */
+  Decision.TraceSpans getSlowCallbacks()
+
   // Get Openr Node Name
   string getMyNodeName()
 }
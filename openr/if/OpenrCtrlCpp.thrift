@@ -8,6 +8,7 @@
 namespace cpp2 openr.thrift
 namespace py3 openr.thrift
 
+include "openr/if/Fib.thrift"
 include "openr/if/KvStore.thrift"
 include "openr/if/OpenrCtrl.thrift"
 
@@ -21,6 +22,27 @@ service OpenrCtrlCpp extends OpenrCtrl.OpenrCtrl {
    */
   stream<KvStore.Publication> subscribeKvStore()
 
+  /**
+   * Subscribe KvStore updates matching the key prefixes and originator IDs of
+   * `filter` in the given areas, all areas if empty. Filtering is done on
+   * server, publications without matching keys are not streamed.
+   */
+  stream<KvStore.Publication> subscribeKvStoreFilter(
+    1: KvStore.KeyDumpParams filter,
+    2: set<string> areas
+  )
+
+  /**
+   * Same as subscribeKvStoreFilter but with changes of keys only. Values come
+   * with version, originatorId, ttl and hash, but without value, which is
+   * fetched on demand with getKvStoreKeyValsFiltered. TTL refreshes are not
+   * streamed, expired keys are.
+   */
+  stream<KvStore.Publication> subscribeKvStoreMetadata(
+    1: KvStore.KeyDumpParams filter,
+    2: set<string> areas
+  )
+
   /**
    * Retrieve KvStore snapshot and as well subscribe subsequent updates. This
    * is useful for mirroring copy of KvStore on remote node for monitoring or
@@ -29,4 +51,21 @@ service OpenrCtrlCpp extends OpenrCtrl.OpenrCtrl {
    * There may be some replicated entries in stream that are also in snapshot.
    */
   KvStore.Publication, stream<KvStore.Publication> subscribeAndGetKvStore()
+
+  /**
+   * Subscribe route updates of Fib, as it programs them. Deltas carry routes
+   * from Decision, and the next-hop changes of interface events. Routes the
+   * download policy of Fib suppresses are not streamed.
+   */
+  stream<Fib.RouteDatabaseDelta> subscribeFib()
+
+  /**
+   * Retrieve route database of Fib and as well subscribe subsequent route
+   * updates. Consumers keep a copy of the routes by applying each delta to
+   * the snapshot, instead of polling and diffing full route tables. No update
+   * between snapshot and stream is lost.
+   *
+   * There may be some replicated routes in stream that are also in snapshot.
+   */
+  Fib.RouteDatabase, stream<Fib.RouteDatabaseDelta> subscribeAndGetFib()
 }
@@ -31,6 +31,16 @@ struct AddrEntry {
   3: bool isValid;
 }
 
+// coalesced events, eventData of LINK_EVENTS and ADDRESS_EVENTS. Latest
+// entry per address only, links have an entry per up/down transition
+struct LinkEntries {
+  1: list<LinkEntry> entries;
+}
+
+struct AddrEntries {
+  1: list<AddrEntry> entries;
+}
+
 struct NeighborEntry {
   1: string ifName;
   2: Network.BinaryAddress destination;
@@ -46,6 +56,18 @@ struct Link {
   5: i64 weight = 1; // used for weighted ecmp
 }
 
+/**
+ * Links changed after a sequence number of the interface DB, as returned by
+ * getLinksSince. Ask with seqNum next time to get the changes after this one.
+ */
+struct LinkDelta {
+  1: i64 seqNum;
+  // links holds all links, e.g. as the seqNum asked with was unknown
+  2: bool isFullSync;
+  // whole entries of changed links
+  3: list<Link> links;
+}
+
 /**
  * Enum to keep track of Client name to Client-ID mapping. Indicates which
  * client-ids are used and which are available to use.
@@ -88,6 +110,8 @@ enum SwitchRunState {
    LINK_EVENT = 1,
    ADDRESS_EVENT = 2,
    NEIGHBOR_EVENT = 3,
+   LINK_EVENTS = 4,
+   ADDRESS_EVENTS = 5,
  }
 
 struct PlatformEvent {
@@ -95,10 +119,40 @@ struct PlatformEvent {
   2: binary eventData;
 }
 
+// Next-hops shared by unicast routes of a client
+struct NextHopGroup {
+  1: i64 id
+  2: list<Network.NextHopThrift> nextHops
+}
+
+struct GroupedUnicastRoute {
+  1: Network.IpPrefix dest
+  2: i64 nextHopGroupId
+}
+
+// Applied in order of the fields
+struct GroupedRouteUpdate {
+  // groups to add, or to replace the next-hops of, along with all of its
+  // routes
+  1: list<NextHopGroup> nextHopGroupsToUpdate
+  2: list<GroupedUnicastRoute> unicastRoutesToUpdate
+  3: list<Network.IpPrefix> unicastRoutesToDelete
+  // groups no route refers to anymore
+  4: list<i64> nextHopGroupsToDelete
+}
+
 exception PlatformError {
   1: string message
 } ( message = "message" )
 
+// Routes of a batch route update the platform failed to program, all other
+// routes of the update are programmed. Clients can retry just these.
+exception PlatformFibUpdateError {
+  1: list<Network.IpPrefix> failedPrefixes
+  2: list<i32> failedMplsLabels
+  3: string message
+} ( message = "message" )
+
 /**
  * Thrift Service API definitions for on-box system information like links,
  * addresses and neighbors. OpenR leverages links and address information as
@@ -115,6 +169,13 @@ service SystemService {
   list<Link> getAllLinks()
     throws (1: PlatformError error)
 
+  /**
+   * Links changed after seqNum, 0 to get all. Cheaper than getAllLinks for
+   * periodic syncs as it needs no kernel dump and sends only what changed.
+   */
+  LinkDelta getLinksSince(1: i64 seqNum)
+    throws (1: PlatformError error)
+
   list<NeighborEntry> getAllNeighbors()
     throws (1: PlatformError error)
 
@@ -190,12 +251,18 @@ service FibService extends fb303_core.BaseService {
   void addUnicastRoutes(
     1: i16 clientId,
     2: list<Network.UnicastRoute> routes,
-  ) throws (1: PlatformError error)
+  ) throws (
+    1: PlatformError error,
+    2: PlatformFibUpdateError fibError,
+  )
 
   void deleteUnicastRoutes(
     1: i16 clientId,
     2: list<Network.IpPrefix> prefixes,
-  ) throws (1: PlatformError error)
+  ) throws (
+    1: PlatformError error,
+    2: PlatformFibUpdateError fibError,
+  )
 
   void syncFib(
     1: i16 clientId,
@@ -213,12 +280,18 @@ service FibService extends fb303_core.BaseService {
   void addMplsRoutes(
     1: i16 clientId,
     2: list<Network.MplsRoute> routes,
-  ) throws (1: PlatformError error)
+  ) throws (
+    1: PlatformError error,
+    2: PlatformFibUpdateError fibError,
+  )
 
   void deleteMplsRoutes(
     1: i16 clientId,
     2: list<i32> topLabels,
-  ) throws (1: PlatformError error)
+  ) throws (
+    1: PlatformError error,
+    2: PlatformFibUpdateError fibError,
+  )
 
   // Flush previous routes and install new routes without disturbing
   // traffic. Similar to syncFib API
@@ -227,11 +300,55 @@ service FibService extends fb303_core.BaseService {
     2: list<Network.MplsRoute> routes,
   ) throws (1: PlatformError error)
 
+  // Chunked alternative to syncFib and syncMplsFib for large route tables.
+  // beginSyncFib starts a sync, syncFibChunk programs part of the routes and
+  // commitSyncFib deletes all other routes of the client, MPLS ones only if
+  // syncMpls is set. Routes added with addUnicastRoutes or addMplsRoutes in
+  // between are kept, routes deleted in between are not brought back by the
+  // commit. A new beginSyncFib aborts the sync in progress, chunks and commit
+  // of unknown syncIds fail.
+  void beginSyncFib(
+    1: i16 clientId,
+    2: i64 syncId,
+    3: bool syncMpls,
+  ) throws (1: PlatformError error)
+
+  void syncFibChunk(
+    1: i16 clientId,
+    2: i64 syncId,
+    3: list<Network.UnicastRoute> routes,
+    4: list<Network.MplsRoute> mplsRoutes,
+  ) throws (1: PlatformError error)
+
+  void commitSyncFib(
+    1: i16 clientId,
+    2: i64 syncId,
+  ) throws (1: PlatformError error)
+
+  // Unicast routes referring to next-hop groups, so that routes sharing
+  // next-hops are moved to new ones by replacing their group. Routes of
+  // unknown groups and deletes of groups still in use fail. Batch APIs
+  // programming a route otherwise take it out of its group, and syncFib and
+  // beginSyncFib drop all groups of the client, keeping their routes.
+  void updateGroupedUnicastRoutes(
+    1: i16 clientId,
+    2: GroupedRouteUpdate update,
+  ) throws (1: PlatformError error)
+
   // Retrieve list of MPLS routes per client
   list<Network.MplsRoute> getMplsRouteTableByClient(
     1: i16 clientId
   ) throws (1: PlatformError error)
 
+  // Long-poll for restart of the agent, instead of polling aliveSince.
+  // Returns aliveSince of the agent once it differs from the given one, or
+  // after timeoutMs. Clients keep a call outstanding, it fails as soon as the
+  // agent goes away.
+  i64 longPollAliveSince(
+    1: i64 aliveSince,
+    2: i32 timeoutMs,
+  ) throws (1: PlatformError error)
+
   void registerForNeighborChanged()
     throws (1: PlatformError error) (thread='eb')
 
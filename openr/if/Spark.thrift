@@ -159,6 +159,15 @@ struct SparkHandshakeMsg {
 
   // area identifier
   10: string area
+
+  // version of the compact heartbeat format the sender reads, see
+  // openr/spark/CompactHeartbeat.h. Absent if it only reads SparkHeartbeatMsg
+  11: optional i32 compactHeartbeatVersion
+
+  // UDP port and hold time of the sender's liveness monitor, see
+  // openr/spark/LivenessMonitor.h. Absent if it has none
+  12: optional i32 livenessPort
+  13: optional i64 livenessHoldTime
 }
 
 //
@@ -211,6 +220,10 @@ struct SparkNeighborEvent {
   7: string area = KvStore.kDefaultArea
 }
 
+// Neighbor events Spark came up with at once, e.g. when an interface with many
+// neighbors went down. Clients apply them together.
+typedef list<SparkNeighborEvent> SparkNeighborEvents
+
 //
 // Spark result status
 //
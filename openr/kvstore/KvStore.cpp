@@ -10,14 +10,17 @@
 #include <fb303/ServiceData.h>
 #include <fbzmq/service/logging/LogSample.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/GLog.h>
 #include <folly/Random.h>
 #include <folly/String.h>
+#include <folly/hash/Hash.h>
 
 #include <openr/common/Constants.h>
 #include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/OpenrCtrl_types.h>
+#include <openr/kvstore/KvStoreCompression.h>
 
 using namespace std::chrono;
 
@@ -25,23 +28,85 @@ namespace fb303 = facebook::fb303;
 
 namespace openr {
 
+namespace {
+
+// prefixes sorted, without the ones starting with another. Every key matches
+// at most one of them, and visiting them in order visits keys in order
+std::vector<std::string>
+getDisjointPrefixes(std::vector<std::string> prefixes) {
+  std::sort(prefixes.begin(), prefixes.end());
+  std::vector<std::string> disjoint;
+  for (auto& prefix : prefixes) {
+    if (not disjoint.empty() and
+        prefix.compare(0, disjoint.back().size(), disjoint.back()) == 0) {
+      continue;
+    }
+    disjoint.emplace_back(std::move(prefix));
+  }
+  return disjoint;
+}
+
+// identifies a key-value merged before. Values without hash never match one
+// with hash, so a value can't be taken for another of the same version
+uint64_t
+getKeyValDigest(std::string const& key, thrift::Value const& value) {
+  return folly::hash::hash_combine(
+      key,
+      value.version,
+      value.originatorId,
+      value.ttlVersion,
+      value.hash.has_value() ? value.hash.value() : 0);
+}
+
+// order of two different values with same version and originator, by size,
+// then hash, and only then by their bytes. Positive if value1 is better
+int
+compareBySizeAndHash(
+    std::string const& value1,
+    int64_t hash1,
+    std::string const& value2,
+    int64_t hash2) {
+  if (value1.size() != value2.size()) {
+    return value1.size() > value2.size() ? 1 : -1;
+  }
+  if (hash1 != hash2) {
+    return hash1 > hash2 ? 1 : -1;
+  }
+  return value1.compare(value2);
+}
+
+} // namespace
+
 KvStoreFilters::KvStoreFilters(
     std::vector<std::string> const& keyPrefix,
     std::set<std::string> const& nodeIds)
     : keyPrefixList_(keyPrefix),
       originatorIds_(nodeIds),
-      keyPrefixObjList_(KeyPrefix(keyPrefixList_)) {}
+      keyPrefixObjList_(KeyPrefix(keyPrefixList_)) {
+  // prefixes are anchored at the start of keys, without any of these they
+  // match literally
+  literalKeyPrefixes_ = std::all_of(
+      keyPrefixList_.begin(), keyPrefixList_.end(), [](auto const& prefix) {
+        return prefix.find_first_of("\\.^$|?*+()[]{}") == std::string::npos;
+      });
+}
 
 bool
 KvStoreFilters::keyMatch(
     std::string const& key, thrift::Value const& value) const {
+  return keyMatch(key, value.originatorId);
+}
+
+bool
+KvStoreFilters::keyMatch(
+    std::string const& key, std::string const& originatorId) const {
   if (keyPrefixList_.empty() && originatorIds_.empty()) {
     return true;
   }
   if (!keyPrefixList_.empty() && keyPrefixObjList_.keyMatch(key)) {
     return true;
   }
-  if (!originatorIds_.empty() && originatorIds_.count(value.originatorId)) {
+  if (!originatorIds_.empty() && originatorIds_.count(originatorId)) {
     return true;
   }
   return false;
@@ -57,6 +122,15 @@ KvStoreFilters::getOrigniatorIdList() const {
   return originatorIds_;
 }
 
+std::optional<std::vector<std::string>>
+KvStoreFilters::getLiteralKeyPrefixes() const {
+  if (keyPrefixList_.empty() or not originatorIds_.empty() or
+      not literalKeyPrefixes_) {
+    return std::nullopt;
+  }
+  return keyPrefixList_;
+}
+
 std::string
 KvStoreFilters::str() const {
   std::string result{};
@@ -75,7 +149,7 @@ KvStore::KvStore(
     // initializers for immutable state
     fbzmq::Context& zmqContext,
     std::string nodeId,
-    messaging::ReplicateQueue<thrift::Publication>& kvStoreUpdatesQueue,
+    messaging::ReplicateQueue<KvStorePublication>& kvStoreUpdatesQueue,
     messaging::RQueue<thrift::PeerUpdateRequest> peerUpdateQueue,
     KvStoreGlobalCmdUrl globalCmdUrl,
     MonitorSubmitUrl monitorSubmitUrl,
@@ -91,7 +165,8 @@ KvStore::KvStore(
     bool enableFloodOptimization,
     bool isFloodRoot,
     bool useFloodOptimization,
-    const std::unordered_set<std::string>& areas)
+    const std::unordered_set<std::string>& areas,
+    KvStoreOptions options)
     : counterSubmitInterval_(counterSubmitInterval),
       kvParams_(
           nodeId,
@@ -109,14 +184,19 @@ KvStore::KvStore(
           ttlDecr,
           enableFloodOptimization,
           isFloodRoot,
-          useFloodOptimization),
+          useFloodOptimization,
+          std::move(options)),
       areas_(areas) {
   CHECK(not nodeId.empty());
   CHECK(not areas_.empty());
 
   zmqMonitorClient_ =
       std::make_shared<fbzmq::ZmqMonitorClient>(zmqContext, monitorSubmitUrl);
-  kvParams_.zmqMonitorClient = zmqMonitorClient_;
+  if (areas_.size() > 1) {
+    // keys advertised into several areas get their value stored once
+    kvParams_.valuePool = std::make_shared<KvStoreValuePool>();
+  }
+  thriftClients_ = std::make_shared<KvStoreThriftClients>(maybeIpTos);
 
   // Schedule periodic timer for counters submission
   counterUpdateTimer_ = folly::AsyncTimeout::make(
@@ -153,11 +233,23 @@ KvStore::KvStore(
 
   // create KvStoreDb instances
   for (auto const& area : areas_) {
+    OpenrEventBase* areaEvb = this;
+    auto thriftClients = thriftClients_;
+    auto zmqMonitorClient = zmqMonitorClient_;
+    if (kvParams_.enableAreaThreads) {
+      // sockets, timers and clients of the area all belong to its thread
+      auto& evb = areaEvbs_[area];
+      evb = std::make_unique<OpenrEventBase>();
+      areaEvb = evb.get();
+      thriftClients = std::make_shared<KvStoreThriftClients>(maybeIpTos);
+      zmqMonitorClient = std::make_shared<fbzmq::ZmqMonitorClient>(
+          zmqContext, monitorSubmitUrl);
+    }
     kvStoreDb_.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(area),
         std::forward_as_tuple(
-            this,
+            areaEvb,
             kvParams_,
             area,
             fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_CLIENT>(
@@ -167,23 +259,59 @@ KvStore::KvStore(
                 fbzmq::NonblockingFlag{true}),
             isFloodRoot,
             nodeId,
-            peers));
+            peers,
+            std::move(thriftClients),
+            std::move(zmqMonitorClient)));
   }
 }
 
-// static, public
+void
+KvStore::run() {
+  for (auto& kv : areaEvbs_) {
+    auto* evb = kv.second.get();
+    areaThreads_.emplace_back([evb, area = kv.first]() {
+      VLOG(1) << "KvStore thread of area " << area << " running.";
+      evb->run();
+      VLOG(1) << "KvStore thread of area " << area << " stopped.";
+    });
+    evb->waitUntilRunning();
+  }
+  OpenrEventBase::run();
+}
+
+void
+KvStore::stop() {
+  for (auto& kv : areaEvbs_) {
+    kv.second->stop();
+  }
+  for (auto& thread : areaThreads_) {
+    thread.join();
+  }
+  areaThreads_.clear();
+  OpenrEventBase::stop();
+}
+
+namespace {
+
+// merge of KvStore::mergeKeyValues(). Announced values get moved out of
+// keyVals if it is an rvalue, leaving the store's copy as only one made
+template <typename KeyVals>
 std::unordered_map<std::string, thrift::Value>
-KvStore::mergeKeyValues(
-    std::unordered_map<std::string, thrift::Value>& kvStore,
-    std::unordered_map<std::string, thrift::Value> const& keyVals,
-    std::optional<KvStoreFilters> const& filters) {
+doMergeKeyValues(
+    KvStoreMap& kvStore,
+    KeyVals&& keyVals,
+    std::optional<KvStoreFilters> const& filters,
+    KvStoreAdmission* admission,
+    bool rateLimited) {
+  constexpr bool kMoveValues = std::is_rvalue_reference_v<KeyVals&&>;
+
   // the publication to build if we update our KV store
   std::unordered_map<std::string, thrift::Value> kvUpdates;
 
   // Counters for logging
   uint32_t ttlUpdateCnt{0}, valUpdateCnt{0};
 
-  for (const auto& kv : keyVals) {
+  for (auto& kv : keyVals) {
     auto const& key = kv.first;
     auto const& value = kv.second;
 
@@ -205,9 +333,9 @@ KvStore::mergeKeyValues(
 
     // if key exist, compare values first
     // if they are the same, no need to propagate changes
-    auto kvStoreIt = kvStore.find(key);
-    if (kvStoreIt != kvStore.end()) {
-      myVersion = kvStoreIt->second.version;
+    auto* myValue = kvStore.find(key);
+    if (myValue) {
+      myVersion = myValue->version;
     } else {
       VLOG(4) << "(mergeKeyValues) key: '" << key << "' not found, adding";
     }
@@ -226,18 +354,29 @@ KvStore::mergeKeyValues(
     if (value.value.has_value()) {
       if (newVersion > myVersion) {
         // Version is newer or
-        // kvStoreIt is NULL(myVersion is set to 0)
+        // myValue is NULL(myVersion is set to 0)
         updateAllNeeded = true;
-      } else if (value.originatorId > kvStoreIt->second.originatorId) {
+      } else if (value.originatorId > kvStore.getOriginatorId(*myValue)) {
         // versions are the same but originatorId is higher
         updateAllNeeded = true;
-      } else if (value.originatorId == kvStoreIt->second.originatorId) {
+      } else if (value.originatorId == kvStore.getOriginatorId(*myValue)) {
         // This can occur after kvstore restarts or simply reconnects after
         // disconnection. We let one of the two values win if they
         // differ(higher in this case but can be lower as long as it's
         // deterministic). Otherwise, local store can have new value while
         // other stores have old value and they never sync.
-        int rc = (*value.value).compare(*kvStoreIt->second.value);
+        int rc = kvStore.getHashVersion() == thrift::HashVersion::V2
+            ? compareBySizeAndHash(
+                  *value.value,
+                  value.hash.has_value() ? value.hash.value()
+                                         : generateHash(
+                                               value.version,
+                                               value.originatorId,
+                                               value.value,
+                                               thrift::HashVersion::V2),
+                  myValue->getValue(),
+                  myValue->hash)
+            : (*value.value).compare(myValue->getValue());
         if (rc > 0) {
           // versions and orginatorIds are same but value is higher
           VLOG(3) << "Previous incarnation reflected back for key " << key;
@@ -245,7 +384,7 @@ KvStore::mergeKeyValues(
         } else if (rc == 0) {
           // versions, orginatorIds, value are all same
           // retain higher ttlVersion
-          if (value.ttlVersion > kvStoreIt->second.ttlVersion) {
+          if (value.ttlVersion > myValue->ttlVersion) {
             updateTtlNeeded = true;
           }
         }
@@ -255,10 +394,10 @@ KvStore::mergeKeyValues(
     //
     // Check updateTtl
     //
-    if (not value.value.has_value() and kvStoreIt != kvStore.end() and
-        value.version == kvStoreIt->second.version and
-        value.originatorId == kvStoreIt->second.originatorId and
-        value.ttlVersion > kvStoreIt->second.ttlVersion) {
+    if (not value.value.has_value() and myValue and
+        value.version == myValue->version and
+        value.originatorId == kvStore.getOriginatorId(*myValue) and
+        value.ttlVersion > myValue->ttlVersion) {
       updateTtlNeeded = true;
     }
 
@@ -270,16 +409,16 @@ KvStore::mergeKeyValues(
 
     VLOG(3) << "Updating key: " << key << "\n  Version: " << myVersion << " -> "
             << newVersion << "\n  Originator: "
-            << (kvStoreIt != kvStore.end() ? kvStoreIt->second.originatorId
-                                           : "null")
-            << " -> " << value.originatorId << "\n  TtlVersion: "
-            << (kvStoreIt != kvStore.end() ? kvStoreIt->second.ttlVersion : 0)
-            << " -> " << value.ttlVersion << "\n  Ttl: "
-            << (kvStoreIt != kvStore.end() ? kvStoreIt->second.ttl : 0)
+            << (myValue ? kvStore.getOriginatorId(*myValue) : "null") << " -> "
+            << value.originatorId << "\n  TtlVersion: "
+            << (myValue ? myValue->ttlVersion : 0) << " -> "
+            << value.ttlVersion << "\n  Ttl: " << (myValue ? myValue->ttl : 0)
             << " -> " << value.ttl;
 
-    // grab the new value (this will copy, intended)
-    thrift::Value newValue = value;
+    if (updateAllNeeded and admission and
+        not admission->admit(kvStore, key, value, rateLimited)) {
+      continue;
+    }
 
     if (updateAllNeeded) {
       ++valUpdateCnt;
@@ -288,38 +427,29 @@ KvStore::mergeKeyValues(
           << ", Version: " << newVersion << ", TtlVersion: " << value.ttlVersion
           << ", Ttl: " << value.ttl;
       //
-      // update everything for such key
+      // update everything for such key, the hash gets generated if the
+      // value doesn't carry it
       //
       CHECK(value.value.has_value());
-      if (kvStoreIt == kvStore.end()) {
-        // create new entry
-        std::tie(kvStoreIt, std::ignore) = kvStore.emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple(key),
-            std::forward_as_tuple(std::move(newValue)));
-      } else {
-        // update the entry in place, the old value will be destructed
-        kvStoreIt->second = std::move(newValue);
-      }
-      // update hash if it's not there
-      if (not kvStoreIt->second.hash.has_value()) {
-        kvStoreIt->second.hash =
-            generateHash(value.version, value.originatorId, value.value);
-      }
+      kvStore.set(key, value);
     } else if (updateTtlNeeded) {
       ++ttlUpdateCnt;
       //
       // update ttl,ttlVersion only
       //
-      CHECK(kvStoreIt != kvStore.end());
+      CHECK(myValue);
 
       // update TTL only, nothing else
-      kvStoreIt->second.ttl = value.ttl;
-      kvStoreIt->second.ttlVersion = value.ttlVersion;
+      myValue->ttl = value.ttl;
+      myValue->ttlVersion = value.ttlVersion;
     }
 
     // announce the update
-    kvUpdates.emplace(key, value);
+    if constexpr (kMoveValues) {
+      kvUpdates.emplace(key, std::move(kv.second));
+    } else {
+      kvUpdates.emplace(key, value);
+    }
   }
 
   VLOG(4) << "(mergeKeyValues) updating " << kvUpdates.size()
@@ -328,11 +458,111 @@ KvStore::mergeKeyValues(
   return kvUpdates;
 }
 
+} // namespace
+
+// static, public
+std::unordered_map<std::string, thrift::Value>
+KvStore::mergeKeyValues(
+    KvStoreMap& kvStore,
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    std::optional<KvStoreFilters> const& filters,
+    KvStoreAdmission* admission,
+    bool rateLimited) {
+  return doMergeKeyValues(kvStore, keyVals, filters, admission, rateLimited);
+}
+
+// static, public
+std::unordered_map<std::string, thrift::Value>
+KvStore::mergeKeyValues(
+    KvStoreMap& kvStore,
+    std::unordered_map<std::string, thrift::Value>&& keyVals,
+    std::optional<KvStoreFilters> const& filters,
+    KvStoreAdmission* admission,
+    bool rateLimited) {
+  return doMergeKeyValues(
+      kvStore, std::move(keyVals), filters, admission, rateLimited);
+}
+
+// static, public
+std::unordered_map<std::string, thrift::Value>
+KvStore::mergeKeyValues(
+    std::unordered_map<std::string, thrift::Value>& kvStore,
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    std::optional<KvStoreFilters> const& filters) {
+  // merging a key only looks at its own entry, the rest of kvStore is left
+  // out of the conversion
+  KvStoreMap store;
+  for (auto const& kv : keyVals) {
+    auto it = kvStore.find(kv.first);
+    if (it != kvStore.end()) {
+      store.set(it->first, it->second);
+    }
+  }
+  auto kvUpdates = mergeKeyValues(store, keyVals, filters);
+  // only updated entries are written back
+  for (auto const& kv : kvUpdates) {
+    kvStore[kv.first] = store.toThriftValue(*store.find(kv.first));
+  }
+  return kvUpdates;
+}
+
+// static, public
+std::unordered_map<std::string, thrift::Value>
+KvStore::mergeTtlUpdates(
+    KvStoreMap& kvStore,
+    std::unordered_map<std::string, thrift::TtlUpdate> const& ttlUpdates,
+    std::optional<KvStoreFilters> const& filters) {
+  std::unordered_map<std::string, thrift::Value> kvUpdates;
+
+  for (const auto& kv : ttlUpdates) {
+    auto const& key = kv.first;
+    auto const& ttlUpdate = kv.second;
+
+    // Check if TTL is valid. It must be infinite or positive number
+    if (ttlUpdate.ttl != Constants::kTtlInfinity && ttlUpdate.ttl <= 0) {
+      continue;
+    }
+
+    // Refresh applies to the very value we have only. Anything else is an
+    // update we missed and gets fixed up by full-sync
+    auto* myValue = kvStore.find(key);
+    if (not myValue or myValue->version != ttlUpdate.version or
+        myValue->hash != ttlUpdate.hash or
+        ttlUpdate.ttlVersion <= myValue->ttlVersion) {
+      continue;
+    }
+
+    auto const& originatorId = kvStore.getOriginatorId(*myValue);
+    if (filters.has_value() && not filters->keyMatch(key, originatorId)) {
+      continue;
+    }
+
+    // update TTL only, nothing else
+    myValue->ttl = ttlUpdate.ttl;
+    myValue->ttlVersion = ttlUpdate.ttlVersion;
+
+    // announce the update
+    thrift::Value value;
+    value.version = myValue->version;
+    value.originatorId = originatorId;
+    value.ttl = myValue->ttl;
+    value.ttlVersion = myValue->ttlVersion;
+    kvUpdates.emplace(key, std::move(value));
+  }
+
+  VLOG(4) << "(mergeTtlUpdates) updating " << kvUpdates.size() << " of "
+          << ttlUpdates.size() << " ttls";
+  return kvUpdates;
+}
+
 /**
  * Compare two values to find out which value is better
  */
 int
-KvStore::compareValues(const thrift::Value& v1, const thrift::Value& v2) {
+KvStore::compareValues(
+    const thrift::Value& v1,
+    const thrift::Value& v2,
+    thrift::HashVersion hashVersion) {
   // compare version
   if (v1.version != v2.version) {
     return v1.version > v2.version ? 1 : -1;
@@ -359,6 +589,16 @@ KvStore::compareValues(const thrift::Value& v1, const thrift::Value& v2) {
   // can't use hash, either it's missing or they are different
   // compare values
   if (v1.value.has_value() and v2.value.has_value()) {
+    if (hashVersion == thrift::HashVersion::V2) {
+      auto getHash = [](const thrift::Value& v) {
+        return v.hash.has_value()
+            ? v.hash.value()
+            : generateHash(
+                  v.version, v.originatorId, v.value, thrift::HashVersion::V2);
+      };
+      return compareBySizeAndHash(
+          *v1.value, getHash(v1), *v2.value, getHash(v2));
+    }
     return (*v1.value).compare(*v2.value);
   } else {
     // some value is missing
@@ -417,6 +657,68 @@ KvStore::processCmdSocketRequest(
     LOG(ERROR) << "Empty request received";
     return;
   }
+
+  if (not areaEvbs_.empty()) {
+    // process in the thread of area and send the reply from here, the socket
+    // belongs to the KvStore thread
+    auto request = std::move(req.back());
+    req.pop_back();
+    fb303::fbData->addStatValue(
+        "kvstore.peers.bytes_received", request.size(), fb303::SUM);
+    auto maybeThriftReq =
+        request.readThriftObj<thrift::KvStoreRequest>(serializer_);
+    if (maybeThriftReq.hasError()) {
+      LOG(ERROR) << "processRequest: failed reading thrift::processRequestMsg"
+                 << maybeThriftReq.error();
+      req.emplace_back(
+          fbzmq::Message::from(Constants::kErrorResponse.toString()).value());
+      auto sndRet = cmdSock.sendMultiple(req);
+      if (sndRet.hasError()) {
+        LOG(ERROR) << "Error sending response. " << sndRet.error();
+      }
+      return;
+    }
+    std::string area{openr::thrift::KvStore_constants::kDefaultArea()};
+    if (maybeThriftReq->area.has_value()) {
+      area = maybeThriftReq->area.value();
+    }
+    runInAreaEventBaseThread(
+        area,
+        [this,
+         &cmdSock,
+         req = std::move(req),
+         thriftReq = std::move(maybeThriftReq).value(),
+         area]() mutable {
+          folly::Expected<fbzmq::Message, fbzmq::Error> maybeReply{
+              folly::makeUnexpected(fbzmq::Error())};
+          auto it = kvStoreDb_.find(area);
+          if (it == kvStoreDb_.end()) {
+            LOG(ERROR) << "std::out_of_range for area " << area;
+          } else {
+            maybeReply = it->second.processRequestMsgHelper(thriftReq);
+          }
+          if (maybeReply.hasValue()) {
+            fb303::fbData->addStatValue(
+                "kvstore.peers.bytes_sent", maybeReply->size(), fb303::SUM);
+            req.emplace_back(std::move(maybeReply.value()));
+          } else {
+            req.emplace_back(
+                fbzmq::Message::from(Constants::kErrorResponse.toString())
+                    .value());
+          }
+          if (req.back().empty()) {
+            return;
+          }
+          runInEventBaseThread([&cmdSock, req = std::move(req)]() {
+            auto sndRet = cmdSock.sendMultiple(req);
+            if (sndRet.hasError()) {
+              LOG(ERROR) << "Error sending response. " << sndRet.error();
+            }
+          });
+        });
+    return;
+  }
+
   auto maybeReply = processRequestMsg(std::move(req.back()));
   req.pop_back();
 
@@ -474,11 +776,59 @@ KvStore::processRequestMsg(fbzmq::Message&& request) {
   return {folly::makeUnexpected(fbzmq::Error())};
 }
 
-messaging::RQueue<thrift::Publication>
+messaging::RQueue<KvStorePublication>
 KvStore::getKvStoreUpdatesReader() {
   return kvParams_.kvStoreUpdatesQueue.getReader();
 }
 
+messaging::RQueue<KvStorePublication>
+KvStore::getKvStoreUpdatesReader(std::vector<std::string> keyPrefixes) {
+  return kvParams_.kvStoreUpdatesQueue.getReader(
+      [keyPrefixes = std::move(keyPrefixes)](
+          KvStorePublication const& publication)
+          -> std::optional<KvStorePublication> {
+        auto keyMatch = [&keyPrefixes](std::string const& key) {
+          for (auto const& prefix : keyPrefixes) {
+            if (key.compare(0, prefix.size(), prefix) == 0) {
+              return true;
+            }
+          }
+          return false;
+        };
+
+        size_t numMatches{0};
+        for (auto const& kv : publication->keyVals) {
+          numMatches += keyMatch(kv.first);
+        }
+        for (auto const& key : publication->expiredKeys) {
+          numMatches += keyMatch(key);
+        }
+        if (numMatches == 0) {
+          return std::nullopt;
+        }
+        // shared as is if every key matches
+        if (numMatches ==
+            publication->keyVals.size() + publication->expiredKeys.size()) {
+          return publication;
+        }
+
+        auto filtered = std::make_shared<thrift::Publication>();
+        filtered->area = publication->area;
+        filtered->floodRootId = publication->floodRootId;
+        for (auto const& kv : publication->keyVals) {
+          if (keyMatch(kv.first)) {
+            filtered->keyVals.emplace(kv);
+          }
+        }
+        for (auto const& key : publication->expiredKeys) {
+          if (keyMatch(key)) {
+            filtered->expiredKeys.emplace_back(key);
+          }
+        }
+        return filtered;
+      });
+}
+
 void
 KvStore::processPeerUpdates(thrift::PeerUpdateRequest&& req) {
   // Req can contain peerAdd/peerDel simultaneously
@@ -495,26 +845,41 @@ KvStore::getKvStoreKeyVals(
     thrift::KeyGetParams keyGetParams, std::string area) {
   folly::Promise<std::unique_ptr<thrift::Publication>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keyGetParams = std::move(keyGetParams),
-                        area]() mutable {
-    VLOG(3) << "Get key requested for AREA: " << area;
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       keyGetParams = std::move(keyGetParams),
+       area]() mutable {
+        p.setWith([&]() { return getKeyValsInAreaThread(keyGetParams, area); });
+      });
+  return sf;
+}
 
-    if (!kvStoreDb_.count(area)) {
-      p.setException(
-          thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
-    } else {
-      fb303::fbData->addStatValue("kvstore.cmd_key_get", 1, fb303::COUNT);
+#if FOLLY_HAS_COROUTINES
+folly::coro::Task<std::unique_ptr<thrift::Publication>>
+KvStore::co_getKvStoreKeyVals(
+    thrift::KeyGetParams keyGetParams, std::string area) {
+  co_return co_await getAreaEventBase(area)->co_runInEventBaseThread(
+      [&]() { return getKeyValsInAreaThread(keyGetParams, area); });
+}
+#endif
 
-      auto& kvStoreDb = kvStoreDb_.at(area);
-      auto thriftPub = kvStoreDb.getKeyVals(keyGetParams.keys);
-      kvStoreDb.updatePublicationTtl(thriftPub);
+std::unique_ptr<thrift::Publication>
+KvStore::getKeyValsInAreaThread(
+    thrift::KeyGetParams const& keyGetParams, std::string const& area) {
+  VLOG(3) << "Get key requested for AREA: " << area;
 
-      p.setValue(std::make_unique<thrift::Publication>(std::move(thriftPub)));
-    }
-  });
-  return sf;
+  auto it = kvStoreDb_.find(area);
+  if (it == kvStoreDb_.end()) {
+    throw thrift::OpenrError(folly::sformat("Invalid area: {}", area));
+  }
+  fb303::fbData->addStatValue("kvstore.cmd_key_get", 1, fb303::COUNT);
+
+  auto& kvStoreDb = it->second;
+  auto thriftPub = kvStoreDb.getKeyVals(keyGetParams.keys);
+  kvStoreDb.updatePublicationTtl(thriftPub);
+  return std::make_unique<thrift::Publication>(std::move(thriftPub));
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::Publication>>
@@ -522,48 +887,111 @@ KvStore::dumpKvStoreKeys(
     thrift::KeyDumpParams keyDumpParams, std::string area) {
   folly::Promise<std::unique_ptr<thrift::Publication>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keyDumpParams = std::move(keyDumpParams),
-                        area]() mutable {
-    VLOG(3) << "Dump all keys requested for AREA: " << area;
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       keyDumpParams = std::move(keyDumpParams),
+       area]() mutable {
+        VLOG(3) << "Dump all keys requested for AREA: " << area;
+
+        if (!kvStoreDb_.count(area)) {
+          p.setException(
+              thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
+        } else {
+          fb303::fbData->addStatValue("kvstore.cmd_key_dump", 1, fb303::COUNT);
+
+          auto& kvStoreDb = kvStoreDb_.at(area);
+          std::vector<std::string> keyPrefixList;
+          folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
+          const auto keyPrefixMatch =
+              KvStoreFilters(keyPrefixList, keyDumpParams.originatorIds);
+          thrift::Publication thriftPub;
+          if (keyDumpParams.keyValOriginatorHashes.has_value()) {
+            thriftPub = kvStoreDb.dumpOriginatorDifference(
+                keyPrefixMatch, keyDumpParams.keyValOriginatorHashes.value());
+          } else if (keyDumpParams.keyValBucketHashes.has_value()) {
+            thriftPub = kvStoreDb.dumpBucketDifference(
+                keyPrefixMatch, keyDumpParams.keyValBucketHashes.value());
+          } else if (
+              keyDumpParams.maxKeys.has_value() and
+              not keyDumpParams.keyValHashes.has_value()) {
+            thriftPub = kvStoreDb.dumpPageWithFilters(
+                keyPrefixMatch,
+                keyDumpParams.startAfterKey.has_value()
+                    ? keyDumpParams.startAfterKey.value()
+                    : "",
+                std::max(1, keyDumpParams.maxKeys.value()));
+          } else {
+            thriftPub = kvStoreDb.dumpAllWithFilters(keyPrefixMatch);
+          }
+          if (keyDumpParams.keyValHashes.has_value()) {
+            thriftPub = kvStoreDb.dumpDifference(
+                thriftPub.keyVals, keyDumpParams.keyValHashes.value());
+          }
+          kvStoreDb.updatePublicationTtl(thriftPub);
+          // I'm the initiator, set flood-root-id
+          fromStdOptional(thriftPub.floodRootId, kvStoreDb.getSptRootId());
+
+          if (keyDumpParams.keyValHashes.has_value() and
+              keyDumpParams.prefix.empty()) {
+            // This usually comes from neighbor nodes
+            size_t numMissingKeys = 0;
+            if (thriftPub.tobeUpdatedKeys.has_value()) {
+              numMissingKeys = thriftPub.tobeUpdatedKeys->size();
+            }
+            LOG(INFO) << "Processed full-sync request with "
+                      << keyDumpParams.keyValHashes.value().size()
+                      << " keyValHashes item(s). Sending "
+                      << thriftPub.keyVals.size() << " key-vals and "
+                      << numMissingKeys << " missing keys";
+          }
 
-    if (!kvStoreDb_.count(area)) {
-      p.setException(
-          thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
-    } else {
-      fb303::fbData->addStatValue("kvstore.cmd_key_dump", 1, fb303::COUNT);
+          // full-sync of a peer using THRIFT transport, same as over ZMQ
+          if (keyDumpParams.acceptCompression.has_value()) {
+            auto const& accepted = keyDumpParams.acceptCompression.value();
+            if (std::find(
+                    accepted.begin(),
+                    accepted.end(),
+                    kvParams_.valueCompression) != accepted.end()) {
+              kvStoreDb.compressKeyVals(thriftPub.keyVals);
+            }
+            thriftPub.acceptCompression = getSupportedCompression();
+          }
+          p.setValue(
+              std::make_unique<thrift::Publication>(std::move(thriftPub)));
+        }
+      });
+  return sf;
+}
 
-      auto& kvStoreDb = kvStoreDb_.at(area);
-      std::vector<std::string> keyPrefixList;
-      folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
-      const auto keyPrefixMatch =
-          KvStoreFilters(keyPrefixList, keyDumpParams.originatorIds);
-      auto thriftPub = kvStoreDb.dumpAllWithFilters(keyPrefixMatch);
-      if (keyDumpParams.keyValHashes.has_value()) {
-        thriftPub = kvStoreDb.dumpDifference(
-            thriftPub.keyVals, keyDumpParams.keyValHashes.value());
-      }
-      kvStoreDb.updatePublicationTtl(thriftPub);
-      // I'm the initiator, set flood-root-id
-      fromStdOptional(thriftPub.floodRootId, kvStoreDb.getSptRootId());
-
-      if (keyDumpParams.keyValHashes.has_value() and
-          keyDumpParams.prefix.empty()) {
-        // This usually comes from neighbor nodes
-        size_t numMissingKeys = 0;
-        if (thriftPub.tobeUpdatedKeys.has_value()) {
-          numMissingKeys = thriftPub.tobeUpdatedKeys->size();
+folly::SemiFuture<std::shared_ptr<const KvStoreView>>
+KvStore::dumpKvStoreKeysView(
+    thrift::KeyDumpParams keyDumpParams, std::string area) {
+  folly::Promise<std::shared_ptr<const KvStoreView>> p;
+  auto sf = p.getSemiFuture();
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       keyDumpParams = std::move(keyDumpParams),
+       area]() mutable {
+        VLOG(3) << "Dump view of all keys requested for AREA: " << area;
+
+        if (!kvStoreDb_.count(area)) {
+          p.setException(
+              thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
+          return;
         }
-        LOG(INFO) << "Processed full-sync request with "
-                  << keyDumpParams.keyValHashes.value().size()
-                  << " keyValHashes item(s). Sending "
-                  << thriftPub.keyVals.size() << " key-vals and "
-                  << numMissingKeys << " missing keys";
-      }
-      p.setValue(std::make_unique<thrift::Publication>(std::move(thriftPub)));
-    }
-  });
+        fb303::fbData->addStatValue("kvstore.cmd_key_dump", 1, fb303::COUNT);
+
+        std::vector<std::string> keyPrefixList;
+        folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
+        const auto keyPrefixMatch =
+            KvStoreFilters(keyPrefixList, keyDumpParams.originatorIds);
+        p.setValue(std::make_shared<const KvStoreView>(
+            kvStoreDb_.at(area).dumpViewWithFilters(keyPrefixMatch)));
+      });
   return sf;
 }
 
@@ -572,28 +1000,31 @@ KvStore::dumpKvStoreHashes(
     thrift::KeyDumpParams keyDumpParams, std::string area) {
   folly::Promise<std::unique_ptr<thrift::Publication>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keyDumpParams = std::move(keyDumpParams),
-                        area]() mutable {
-    VLOG(3) << "Dump all hashes requested for AREA: " << area;
-
-    if (!kvStoreDb_.count(area)) {
-      p.setException(
-          thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
-    } else {
-      fb303::fbData->addStatValue("kvstore.cmd_hash_dump", 1, fb303::COUNT);
-
-      auto& kvStoreDb = kvStoreDb_.at(area);
-      std::set<std::string> originator{};
-      std::vector<std::string> keyPrefixList{};
-      folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
-      KvStoreFilters kvFilters{keyPrefixList, originator};
-      auto thriftPub = kvStoreDb.dumpHashWithFilters(kvFilters);
-      kvStoreDb.updatePublicationTtl(thriftPub);
-      p.setValue(std::make_unique<thrift::Publication>(std::move(thriftPub)));
-    }
-  });
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       keyDumpParams = std::move(keyDumpParams),
+       area]() mutable {
+        VLOG(3) << "Dump all hashes requested for AREA: " << area;
+
+        if (!kvStoreDb_.count(area)) {
+          p.setException(
+              thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
+        } else {
+          fb303::fbData->addStatValue("kvstore.cmd_hash_dump", 1, fb303::COUNT);
+
+          auto& kvStoreDb = kvStoreDb_.at(area);
+          std::set<std::string> originator{};
+          std::vector<std::string> keyPrefixList{};
+          folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
+          KvStoreFilters kvFilters{keyPrefixList, originator};
+          auto thriftPub = kvStoreDb.dumpHashWithFilters(kvFilters);
+          kvStoreDb.updatePublicationTtl(thriftPub);
+          p.setValue(
+              std::make_unique<thrift::Publication>(std::move(thriftPub)));
+        }
+      });
   return sf;
 }
 
@@ -602,48 +1033,58 @@ KvStore::setKvStoreKeyVals(
     thrift::KeySetParams keySetParams, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        keySetParams = std::move(keySetParams),
-                        area]() mutable {
-    VLOG(3) << "Set key requested for AREA: " << area;
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       keySetParams = std::move(keySetParams),
+       area]() mutable {
+        VLOG(3) << "Set key requested for AREA: " << area;
+
+        if (!kvStoreDb_.count(area)) {
+          p.setException(
+              thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
+        } else {
+          // Update statistics
+          fb303::fbData->addStatValue("kvstore.cmd_key_set", 1, fb303::COUNT);
+          if (keySetParams.timestamp_ms.has_value()) {
+            auto floodMs =
+                getUnixTimeStampMs() - keySetParams.timestamp_ms.value();
+            if (floodMs > 0) {
+              fb303::fbData->addStatValue(
+                  "kvstore.flood_duration_ms", floodMs, fb303::AVG);
+            }
+          }
 
-    if (!kvStoreDb_.count(area)) {
-      p.setException(
-          thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
-    } else {
-      // Update statistics
-      fb303::fbData->addStatValue("kvstore.cmd_key_set", 1, fb303::COUNT);
-      if (keySetParams.timestamp_ms.has_value()) {
-        auto floodMs = getUnixTimeStampMs() - keySetParams.timestamp_ms.value();
-        if (floodMs > 0) {
-          fb303::fbData->addStatValue(
-              "kvstore.flood_duration_ms", floodMs, fb303::AVG);
-        }
-      }
+          // Update hash for key-values
+          auto& kvStoreDb = kvStoreDb_.at(area);
+          kvStoreDb.dropRecentKeyVals(keySetParams);
+          kvStoreDb.decompressKeyVals(keySetParams.keyVals);
+          for (auto& kv : keySetParams.keyVals) {
+            auto& value = kv.second;
+            if (value.value.has_value()) {
+              value.hash = generateHash(
+                  value.version,
+                  value.originatorId,
+                  value.value,
+                  kvParams_.hashVersion);
+            }
+          }
 
-      // Update hash for key-values
-      auto& kvStoreDb = kvStoreDb_.at(area);
-      for (auto& kv : keySetParams.keyVals) {
-        auto& value = kv.second;
-        if (value.value.has_value()) {
-          value.hash =
-              generateHash(value.version, value.originatorId, value.value);
+          // Create publication and merge it with local KvStore
+          thrift::Publication rcvdPublication;
+          rcvdPublication.keyVals = std::move(keySetParams.keyVals);
+          rcvdPublication.nodeIds.move_from(std::move(keySetParams.nodeIds));
+          rcvdPublication.floodRootId.move_from(
+              std::move(keySetParams.floodRootId));
+          rcvdPublication.ttlUpdates.move_from(
+              std::move(keySetParams.ttlUpdates));
+          kvStoreDb.mergePublication(std::move(rcvdPublication));
+
+          // ready to return
+          p.setValue();
         }
-      }
-
-      // Create publication and merge it with local KvStore
-      thrift::Publication rcvdPublication;
-      rcvdPublication.keyVals = std::move(keySetParams.keyVals);
-      rcvdPublication.nodeIds.move_from(std::move(keySetParams.nodeIds));
-      rcvdPublication.floodRootId.move_from(
-          std::move(keySetParams.floodRootId));
-      kvStoreDb.mergePublication(rcvdPublication);
-
-      // ready to return
-      p.setValue();
-    }
-  });
+      });
   return sf;
 }
 
@@ -663,7 +1104,7 @@ folly::SemiFuture<std::unique_ptr<thrift::PeersMap>>
 KvStore::getKvStorePeers(std::string area) {
   folly::Promise<std::unique_ptr<thrift::PeersMap>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this, p = std::move(p), area]() mutable {
+  runInAreaEventBaseThread(area, [this, p = std::move(p), area]() mutable {
     VLOG(2) << "Peer dump requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
@@ -684,25 +1125,27 @@ KvStore::addUpdateKvStorePeers(
     thrift::PeerAddParams peerAddParams, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        peerAddParams = std::move(peerAddParams),
-                        area]() mutable {
-    VLOG(2) << "Peer addition requested for AREA: " << area;
-
-    if (!kvStoreDb_.count(area)) {
-      p.setException(
-          thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
-    } else if (peerAddParams.peers.empty()) {
-      p.setException(thrift::OpenrError(
-          "Empty peerNames from peer-add request, ignoring"));
-    } else {
-      fb303::fbData->addStatValue("kvstore.cmd_peer_add", 1, fb303::COUNT);
-      auto& kvStoreDb = kvStoreDb_.at(area);
-      kvStoreDb.addPeers(peerAddParams.peers);
-      p.setValue();
-    }
-  });
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       peerAddParams = std::move(peerAddParams),
+       area]() mutable {
+        VLOG(2) << "Peer addition requested for AREA: " << area;
+
+        if (!kvStoreDb_.count(area)) {
+          p.setException(
+              thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
+        } else if (peerAddParams.peers.empty()) {
+          p.setException(thrift::OpenrError(
+              "Empty peerNames from peer-add request, ignoring"));
+        } else {
+          fb303::fbData->addStatValue("kvstore.cmd_peer_add", 1, fb303::COUNT);
+          auto& kvStoreDb = kvStoreDb_.at(area);
+          kvStoreDb.addPeers(peerAddParams.peers);
+          p.setValue();
+        }
+      });
   return sf;
 }
 
@@ -711,25 +1154,27 @@ KvStore::deleteKvStorePeers(
     thrift::PeerDelParams peerDelParams, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        peerDelParams = std::move(peerDelParams),
-                        area]() mutable {
-    VLOG(2) << "Peer deletion requested for AREA: " << area;
-
-    if (!kvStoreDb_.count(area)) {
-      p.setException(
-          thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
-    } else if (peerDelParams.peerNames.empty()) {
-      p.setException(thrift::OpenrError(
-          "Empty peerNames from peer-del request, ignoring"));
-    } else {
-      fb303::fbData->addStatValue("kvstore.cmd_per_del", 1, fb303::COUNT);
-      auto& kvStoreDb = kvStoreDb_.at(area);
-      kvStoreDb.delPeers(peerDelParams.peerNames);
-      p.setValue();
-    }
-  });
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       peerDelParams = std::move(peerDelParams),
+       area]() mutable {
+        VLOG(2) << "Peer deletion requested for AREA: " << area;
+
+        if (!kvStoreDb_.count(area)) {
+          p.setException(
+              thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
+        } else if (peerDelParams.peerNames.empty()) {
+          p.setException(thrift::OpenrError(
+              "Empty peerNames from peer-del request, ignoring"));
+        } else {
+          fb303::fbData->addStatValue("kvstore.cmd_per_del", 1, fb303::COUNT);
+          auto& kvStoreDb = kvStoreDb_.at(area);
+          kvStoreDb.delPeers(peerDelParams.peerNames);
+          p.setValue();
+        }
+      });
   return sf;
 }
 
@@ -737,7 +1182,7 @@ folly::SemiFuture<std::unique_ptr<thrift::SptInfos>>
 KvStore::getSpanningTreeInfos(std::string area) {
   folly::Promise<std::unique_ptr<thrift::SptInfos>> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this, p = std::move(p), area]() mutable {
+  runInAreaEventBaseThread(area, [this, p = std::move(p), area]() mutable {
     VLOG(3) << "FLOOD_TOPO_GET command requested for AREA: " << area;
 
     if (!kvStoreDb_.count(area)) {
@@ -757,21 +1202,23 @@ KvStore::updateFloodTopologyChild(
     thrift::FloodTopoSetParams floodTopoSetParams, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        floodTopoSetParams = std::move(floodTopoSetParams),
-                        area]() mutable {
-    VLOG(2) << "FLOOD_TOPO_SET command requested for AREA: " << area;
-
-    if (!kvStoreDb_.count(area)) {
-      p.setException(
-          thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
-    } else {
-      auto& kvStoreDb = kvStoreDb_.at(area);
-      kvStoreDb.processFloodTopoSet(std::move(floodTopoSetParams));
-      p.setValue();
-    }
-  });
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       floodTopoSetParams = std::move(floodTopoSetParams),
+       area]() mutable {
+        VLOG(2) << "FLOOD_TOPO_SET command requested for AREA: " << area;
+
+        if (!kvStoreDb_.count(area)) {
+          p.setException(
+              thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
+        } else {
+          auto& kvStoreDb = kvStoreDb_.at(area);
+          kvStoreDb.processFloodTopoSet(std::move(floodTopoSetParams));
+          p.setValue();
+        }
+      });
   return sf;
 }
 
@@ -780,52 +1227,105 @@ KvStore::processKvStoreDualMessage(
     thrift::DualMessages dualMessages, std::string area) {
   folly::Promise<folly::Unit> p;
   auto sf = p.getSemiFuture();
-  runInEventBaseThread([this,
-                        p = std::move(p),
-                        dualMessages = std::move(dualMessages),
-                        area]() mutable {
-    VLOG(2) << "DUAL messages received for AREA: " << area;
-
-    if (!kvStoreDb_.count(area)) {
-      p.setException(
-          thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
-    } else if (dualMessages.messages.empty()) {
-      LOG(ERROR) << "Empty DUAL msg receved";
-      p.setValue();
-    } else {
-      fb303::fbData->addStatValue(
-          "kvstore.received_dual_messages", 1, fb303::COUNT);
+  runInAreaEventBaseThread(
+      area,
+      [this,
+       p = std::move(p),
+       dualMessages = std::move(dualMessages),
+       area]() mutable {
+        VLOG(2) << "DUAL messages received for AREA: " << area;
+
+        if (!kvStoreDb_.count(area)) {
+          p.setException(
+              thrift::OpenrError(folly::sformat("Invalid area: {}", area)));
+        } else if (dualMessages.messages.empty()) {
+          LOG(ERROR) << "Empty DUAL msg receved";
+          p.setValue();
+        } else {
+          fb303::fbData->addStatValue(
+              "kvstore.received_dual_messages", 1, fb303::COUNT);
 
-      auto& kvStoreDb = kvStoreDb_.at(area);
-      kvStoreDb.processDualMessages(std::move(dualMessages));
-      p.setValue();
-    }
-  });
+          auto& kvStoreDb = kvStoreDb_.at(area);
+          kvStoreDb.processDualMessages(std::move(dualMessages));
+          p.setValue();
+        }
+      });
   return sf;
 }
 
 void
 KvStore::updateGlobalCounters() {
-  auto allCounters = fb303::fbData->getCounters();
+  if (areaEvbs_.empty()) {
+    std::vector<std::unordered_map<std::string, int64_t>> counters;
+    for (auto& kvDb : kvStoreDb_) {
+      counters.emplace_back(kvDb.second.getCounters());
+    }
+    submitGlobalCounters(counters);
+    return;
+  }
+
+  // collect counters of areas in their threads
+  std::vector<folly::SemiFuture<std::unordered_map<std::string, int64_t>>>
+      futures;
   for (auto& kvDb : kvStoreDb_) {
-    auto kvDbCounters = kvDb.second.getCounters();
-    // add up counters for same key from all kvStoreDb instances
-    allCounters = std::accumulate(
-        kvDbCounters.begin(),
-        kvDbCounters.end(),
-        allCounters,
-        [](std::map<std::string, int64_t>& allCounters,
-           const std::pair<const std::string, int64_t>& kvDbcounter) {
-          allCounters[kvDbcounter.first] += kvDbcounter.second;
-          return allCounters;
+    folly::Promise<std::unordered_map<std::string, int64_t>> p;
+    futures.emplace_back(p.getSemiFuture());
+    runInAreaEventBaseThread(
+        kvDb.first, [p = std::move(p), &kvStoreDb = kvDb.second]() mutable {
+          p.setValue(kvStoreDb.getCounters());
         });
   }
-  for (auto counter : allCounters) {
+  folly::collectAllSemiFuture(std::move(futures))
+      .via(getEvb())
+      .thenValue([this](auto&& results) {
+        std::vector<std::unordered_map<std::string, int64_t>> counters;
+        for (auto& result : results) {
+          if (result.hasValue()) {
+            counters.emplace_back(std::move(result).value());
+          }
+        }
+        submitGlobalCounters(counters);
+      });
+}
+
+void
+KvStore::submitGlobalCounters(
+    std::vector<std::unordered_map<std::string, int64_t>> const& counters) {
+  // add up counters for same key from all kvStoreDb instances. Only these
+  // get set, rather than every counter of the process
+  std::unordered_map<std::string, int64_t> allCounters;
+  for (auto const& kvDbCounters : counters) {
+    for (auto const& [name, value] : kvDbCounters) {
+      allCounters[name] += value;
+    }
+  }
+  if (kvParams_.valuePool) {
+    const auto usage = kvParams_.valuePool->getUsage();
+    allCounters["kvstore.pooled_values"] = usage.first;
+    allCounters["kvstore.pooled_bytes"] = usage.second;
+  }
+  for (auto const& counter : allCounters) {
     fb303::fbData->setCounter(counter.first, counter.second);
   }
   counterUpdateTimer_->scheduleTimeout(counterSubmitInterval_);
 }
 
+void
+KvStore::runInAreaEventBaseThread(
+    std::string const& area, folly::EventBase::Func callback) {
+  getAreaEventBase(area)->runInEventBaseThread(std::move(callback));
+}
+
+OpenrEventBase*
+KvStore::getAreaEventBase(std::string const& area) {
+  auto it = areaEvbs_.find(area);
+  if (it == areaEvbs_.end()) {
+    // unknown areas get rejected in the KvStore thread
+    return this;
+  }
+  return it->second.get();
+}
+
 KvStoreDb::KvStoreDb(
     OpenrEventBase* evb,
     KvStoreParams& kvParams,
@@ -833,12 +1333,29 @@ KvStoreDb::KvStoreDb(
     fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_CLIENT> peersyncSock,
     bool isFloodRoot,
     const std::string& nodeId,
-    std::unordered_map<std::string, thrift::PeerSpec> peers)
+    std::unordered_map<std::string, thrift::PeerSpec> peers,
+    std::shared_ptr<KvStoreThriftClients> thriftClients,
+    std::shared_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient)
     : DualNode(nodeId, isFloodRoot),
       kvParams_(kvParams),
+      thriftClients_(std::move(thriftClients)),
+      zmqMonitorClient_(std::move(zmqMonitorClient)),
       area_(area),
       peerSyncSock_(std::move(peersyncSock)),
+      kvStore_(kvParams.hashVersion, kvParams.valuePool),
       evb_(evb) {
+  if (kvParams_.budgets.enabled()) {
+    admission_ = std::make_unique<KvStoreAdmission>(kvParams_.budgets);
+  }
+  // classes of keys for counters, priority keys first
+  auto keyClassMarkers = kvParams_.priorityFloodKeyMarkers;
+  for (auto const& marker : {Constants::kAdjDbMarker,
+                             Constants::kPrefixDbMarker,
+                             Constants::kPrefixAllocMarker}) {
+    keyClassMarkers.emplace_back(marker.str());
+  }
+  kvStore_.setKeyClasses(std::move(keyClassMarkers));
+  publicationBufferKeys_.assign(kvStore_.getKeyClassNames().size(), 0);
   if (kvParams_.floodRate.has_value()) {
     floodLimiter_ = std::make_unique<folly::BasicTokenBucket<>>(
         kvParams_.floodRate.value().first, // messages per sec
@@ -853,6 +1370,12 @@ KvStoreDb::KvStoreDb(
           floodBufferedUpdates();
         });
   }
+  if (kvParams_.floodBatchDelay.count() > 0) {
+    floodBatchTimer_ = folly::AsyncTimeout::make(
+        *evb_->getEvb(), [this]() noexcept { floodBatchedUpdates(); });
+  }
+  peerSendQueueTimer_ = folly::AsyncTimeout::make(
+      *evb_->getEvb(), [this]() noexcept { drainPeerSendQueues(); });
 
   LOG(INFO) << "Starting kvstore DB instance for node " << nodeId << " area "
             << area;
@@ -860,17 +1383,29 @@ KvStoreDb::KvStoreDb(
   // Attach socket callbacks/schedule events
   attachCallbacks();
 
+  // Hook up timer with cleanupTtlCountdown(). The actual scheduling
+  // happens within updateTtlCountdown()
+  ttlCountdownTimer_ = folly::AsyncTimeout::make(
+      *evb_->getEvb(), [this]() noexcept { cleanupTtlCountdown(); });
+
+  // Restore the area from its snapshot before there are any peers to flood
+  // it to, full-sync with them follows
+  if (not kvParams_.snapshotDir.empty()) {
+    loadSnapshot();
+    snapshotTimer_ =
+        folly::AsyncTimeout::make(*evb_->getEvb(), [this]() noexcept {
+          saveSnapshot();
+          snapshotTimer_->scheduleTimeout(Constants::kKvStoreSnapshotInterval);
+        });
+    snapshotTimer_->scheduleTimeout(Constants::kKvStoreSnapshotInterval);
+  }
+
   VLOG(2) << "Subscribing/connecting to all peers...";
 
   // Add all existing peers again. This will also ensure querying full-sync
   // from each peer.
   addPeers(peers);
 
-  // Hook up timer with cleanupTtlCountdownQueue(). The actual scheduling
-  // happens within updateTtlCountdownQueue()
-  ttlCountdownTimer_ = folly::AsyncTimeout::make(
-      *evb_->getEvb(), [this]() noexcept { cleanupTtlCountdownQueue(); });
-
   // Initialize stats keys
   fb303::fbData->addStatExportType("kvstore.cmd_hash_dump", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.cmd_key_dump", fb303::COUNT);
@@ -879,10 +1414,28 @@ KvStoreDb::KvStoreDb(
   fb303::fbData->addStatExportType("kvstore.cmd_peer_add", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.cmd_peer_dump", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.cmd_per_del", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "kvstore.compressed_bytes_saved", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "kvstore.decompression_failures", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "kvstore.dropped_recent_key_vals", fb303::SUM);
   fb303::fbData->addStatExportType("kvstore.expired_key_vals", fb303::SUM);
   fb303::fbData->addStatExportType("kvstore.flood_duration_ms", fb303::AVG);
   fb303::fbData->addStatExportType("kvstore.full_sync_duration_ms", fb303::AVG);
+  fb303::fbData->addStatExportType("kvstore.full_sync_timeouts", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.looped_publications", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "kvstore.priority_flooded_keys", fb303::SUM);
+  for (auto const& reason : {"area_keys",
+                             "area_bytes",
+                             "originator_keys",
+                             "originator_bytes",
+                             "originator_rate"}) {
+    fb303::fbData->addStatExportType(
+        folly::sformat("kvstore.admission.rejected_keys.{}", reason),
+        fb303::COUNT);
+  }
   fb303::fbData->addStatExportType("kvstore.peers.bytes_received", fb303::SUM);
   fb303::fbData->addStatExportType("kvstore.peers.bytes_received", fb303::SUM);
   fb303::fbData->addStatExportType("kvstore.peers.bytes_sent", fb303::SUM);
@@ -892,40 +1445,138 @@ KvStoreDb::KvStoreDb(
   fb303::fbData->addStatExportType(
       "kvstore.received_dual_messages", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.received_key_vals", fb303::SUM);
+  fb303::fbData->addStatExportType("kvstore.received_ttl_updates", fb303::SUM);
   fb303::fbData->addStatExportType(
       "kvstore.received_publications", fb303::COUNT);
   fb303::fbData->addStatExportType(
       "kvstore.received_redundant_publications", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.sent_key_vals", fb303::SUM);
   fb303::fbData->addStatExportType("kvstore.sent_publications", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "kvstore.snapshot_failures", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "kvstore.thrift.failed_key_sets", fb303::SUM);
+  fb303::fbData->addStatExportType(
+      "kvstore.thrift.merged_key_sets", fb303::COUNT);
+  fb303::fbData->addStatExportType(
+      "kvstore.thrift.sent_key_sets", fb303::COUNT);
   fb303::fbData->addStatExportType("kvstore.updated_key_vals", fb303::SUM);
 }
 
+KvStoreDb::~KvStoreDb() {
+  if (not kvParams_.snapshotDir.empty()) {
+    saveSnapshot();
+  }
+}
+
+std::string
+KvStoreDb::getSnapshotPath() const {
+  return folly::sformat("{}/kvstore_{}.snapshot", kvParams_.snapshotDir, area_);
+}
+
 void
-KvStoreDb::updateTtlCountdownQueue(const thrift::Publication& publication) {
+KvStoreDb::loadSnapshot() {
+  const auto path = getSnapshotPath();
+  std::string contents;
+  if (not folly::readFile(path.c_str(), contents)) {
+    LOG(INFO) << "No KvStore snapshot of area " << area_ << " at " << path;
+    return;
+  }
+
+  thrift::KvStoreSnapshot snapshot;
+  try {
+    snapshot = fbzmq::util::readThriftObjStr<thrift::KvStoreSnapshot>(
+        contents, serializer_);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to read KvStore snapshot " << path << ". "
+               << folly::exceptionStr(e);
+    fb303::fbData->addStatValue("kvstore.snapshot_failures", 1, fb303::COUNT);
+    return;
+  }
+  if (snapshot.area != area_) {
+    LOG(ERROR) << "KvStore snapshot " << path << " is of area "
+               << snapshot.area << ", ignoring it";
+    return;
+  }
+
+  // time since the snapshot counts against TTLs, keys which would have
+  // expired meanwhile are left out
+  const auto age =
+      std::max<int64_t>(0, getUnixTimeStampMs() - snapshot.timestamp_ms);
+  for (auto it = snapshot.keyVals.begin(); it != snapshot.keyVals.end();) {
+    auto& value = it->second;
+    if (value.ttl != Constants::kTtlInfinity) {
+      value.ttl -= age;
+      if (value.ttl <= Constants::kTtlThreshold.count()) {
+        it = snapshot.keyVals.erase(it);
+        continue;
+      }
+    }
+    ++it;
+  }
+
+  thrift::Publication publication;
+  publication.keyVals =
+      KvStore::mergeKeyValues(kvStore_, snapshot.keyVals, kvParams_.filters);
+  publication.area = area_;
+  LOG(INFO) << "Restored " << publication.keyVals.size()
+            << " key-values of area " << area_ << " from snapshot " << path;
+  updateTtlCountdown(publication);
+  floodPublication(std::move(publication), false /* rateLimit */);
+}
+
+void
+KvStoreDb::saveSnapshot() {
+  auto thriftPub = dumpAllWithFilters(KvStoreFilters({}, {}));
+  updatePublicationTtl(thriftPub, true);
+
+  thrift::KvStoreSnapshot snapshot;
+  snapshot.area = area_;
+  snapshot.timestamp_ms = getUnixTimeStampMs();
+  snapshot.keyVals = std::move(thriftPub.keyVals);
+
+  const auto path = getSnapshotPath();
+  try {
+    folly::writeFileAtomic(
+        path, fbzmq::util::writeThriftObjStr(snapshot, serializer_), 0666);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to write KvStore snapshot " << path << ". "
+               << folly::exceptionStr(e);
+    fb303::fbData->addStatValue("kvstore.snapshot_failures", 1, fb303::COUNT);
+  }
+}
+
+void
+KvStoreDb::updateTtlCountdown(const thrift::Publication& publication) {
   for (const auto& kv : publication.keyVals) {
     const auto& key = kv.first;
     const auto& value = kv.second;
 
-    if (value.ttl != Constants::kTtlInfinity) {
-      TtlCountdownQueueEntry queueEntry;
-      queueEntry.expiryTime = std::chrono::steady_clock::now() +
-          std::chrono::milliseconds(value.ttl);
-      queueEntry.key = key;
-      queueEntry.version = value.version;
-      queueEntry.ttlVersion = value.ttlVersion;
-      queueEntry.originatorId = value.originatorId;
-
-      if ((ttlCountdownQueue_.empty() or
-           (queueEntry.expiryTime <= ttlCountdownQueue_.top().expiryTime)) and
-          ttlCountdownTimer_) {
-        // Reschedule the shorter timeout
-        ttlCountdownTimer_->scheduleTimeout(
-            std::chrono::milliseconds(value.ttl));
-      }
+    if (value.ttl == Constants::kTtlInfinity) {
+      // key doesn't expire any more
+      ttlCountdownWheel_.cancel(key);
+      continue;
+    }
 
-      ttlCountdownQueue_.push(std::move(queueEntry));
+    TtlCountdownQueueEntry queueEntry;
+    queueEntry.expiryTime = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(value.ttl);
+    queueEntry.key = key;
+    queueEntry.version = value.version;
+    queueEntry.ttlVersion = value.ttlVersion;
+    queueEntry.originatorId = value.originatorId;
+
+    if (ttlCountdownTimer_ and
+        (not ttlCountdownTimer_->isScheduled() or
+         queueEntry.expiryTime < ttlCountdownTimerExpiry_)) {
+      // Reschedule the shorter timeout
+      ttlCountdownTimer_->scheduleTimeout(
+          std::chrono::milliseconds(value.ttl) + kvParams_.ttlExpirySlack);
+      ttlCountdownTimerExpiry_ = queueEntry.expiryTime;
     }
+
+    // replaces the count down of the previous value of key
+    ttlCountdownWheel_.schedule(std::move(queueEntry));
   }
 }
 
@@ -938,10 +1589,8 @@ KvStoreDb::getKeyVals(std::vector<std::string> const& keys) {
 
   for (auto const& key : keys) {
     // if requested key if found, respond with version and value
-    auto it = kvStore_.find(key);
-    if (it != kvStore_.end()) {
-      // copy here
-      thriftPub.keyVals[key] = it->second;
+    if (auto const* value = kvStore_.find(key)) {
+      thriftPub.keyVals[key] = kvStore_.toThriftValue(*value);
     }
   }
   return thriftPub;
@@ -954,11 +1603,102 @@ KvStoreDb::dumpAllWithFilters(KvStoreFilters const& kvFilters) const {
   thrift::Publication thriftPub;
   thriftPub.area = area_;
 
-  for (auto const& kv : kvStore_) {
-    if (not kvFilters.keyMatch(kv.first, kv.second)) {
-      continue;
+  forEachWithFilters(
+      kvFilters, [&](std::string const& key, KvStoreValue const& value) {
+        thriftPub.keyVals[key] = kvStore_.toThriftValue(value);
+      });
+  return thriftPub;
+}
+
+KvStoreView
+KvStoreDb::dumpViewWithFilters(KvStoreFilters const& kvFilters) const {
+  KvStoreView view;
+  view.area = area_;
+  view.floodRootId = getSptRootId();
+
+  const auto timeNow = std::chrono::steady_clock::now();
+  forEachWithFilters(
+      kvFilters, [&](std::string const& key, KvStoreValue const& value) {
+        auto const& originatorId = kvStore_.getOriginatorId(value);
+        auto ttl = getPublicationTtl(
+            key,
+            value.version,
+            originatorId,
+            value.ttlVersion,
+            value.ttl,
+            timeNow,
+            false /* removeAboutToExpire */);
+        if (not ttl.has_value()) {
+          return;
+        }
+        view.entries.emplace_back(KvStoreView::Entry{key, originatorId, value});
+        view.entries.back().value.ttl = *ttl;
+      });
+  return view;
+}
+
+thrift::Publication
+KvStoreView::toPublication() const {
+  thrift::Publication thriftPub;
+  thriftPub.area = area;
+  fromStdOptional(thriftPub.floodRootId, floodRootId);
+  for (auto const& entry : entries) {
+    thrift::Value value;
+    value.version = entry.value.version;
+    value.originatorId = entry.originatorId;
+    value.ttl = entry.value.ttl;
+    value.ttlVersion = entry.value.ttlVersion;
+    value.hash = entry.value.hash;
+    if (entry.value.hasValue) {
+      value.value = *entry.value.value;
+    }
+    thriftPub.keyVals.emplace(entry.key, std::move(value));
+  }
+  return thriftPub;
+}
+
+thrift::Publication
+KvStoreDb::dumpPageWithFilters(
+    KvStoreFilters const& kvFilters,
+    std::string const& startAfterKey,
+    size_t maxKeys) const {
+  thrift::Publication thriftPub;
+  thriftPub.area = area_;
+  thriftPub.generation = generation_;
+  std::string const* lastKey{nullptr};
+
+  // stops at the first entry beyond maxKeys
+  auto addToPage = [&](std::string const& key, KvStoreValue const& value) {
+    if (thriftPub.keyVals.size() >= maxKeys) {
+      return false;
+    }
+    thriftPub.keyVals[key] = kvStore_.toThriftValue(value);
+    lastKey = &key;
+    return true;
+  };
+
+  bool complete = true;
+  if (auto prefixes = kvFilters.getLiteralKeyPrefixes()) {
+    for (auto const& prefix : getDisjointPrefixes(std::move(*prefixes))) {
+      complete =
+          kvStore_.forEachWithPrefixAfter(prefix, startAfterKey, addToPage);
+      if (not complete) {
+        break;
+      }
     }
-    thriftPub.keyVals[kv.first] = kv.second;
+  } else {
+    auto matchAndAddToPage = [&](std::string const& key,
+                                 KvStoreValue const& value) {
+      if (not kvFilters.keyMatch(key, kvStore_.getOriginatorId(value))) {
+        return true;
+      }
+      return addToPage(key, value);
+    };
+    complete =
+        kvStore_.forEachWithPrefixAfter("", startAfterKey, matchAndAddToPage);
+  }
+  if (not complete and lastKey) {
+    thriftPub.lastKey = *lastKey;
   }
   return thriftPub;
 }
@@ -969,19 +1709,32 @@ thrift::Publication
 KvStoreDb::dumpHashWithFilters(KvStoreFilters const& kvFilters) const {
   thrift::Publication thriftPub;
   thriftPub.area = area_;
+  forEachWithFilters(
+      kvFilters, [&](std::string const& key, KvStoreValue const& value) {
+        thriftPub.keyVals[key] = kvStore_.toThriftHash(value);
+      });
+  return thriftPub;
+}
+
+void
+KvStoreDb::forEachWithFilters(
+    KvStoreFilters const& kvFilters,
+    folly::FunctionRef<void(std::string const&, KvStoreValue const&)> fn)
+    const {
+  if (auto prefixes = kvFilters.getLiteralKeyPrefixes()) {
+    for (auto const& prefix : getDisjointPrefixes(std::move(*prefixes))) {
+      kvStore_.forEachWithPrefix(prefix, fn);
+    }
+    return;
+  }
+
   for (auto const& kv : kvStore_) {
-    if (not kvFilters.keyMatch(kv.first, kv.second)) {
+    if (not kvFilters.keyMatch(
+            kv.first, kvStore_.getOriginatorId(kv.second))) {
       continue;
     }
-    DCHECK(kv.second.hash.has_value());
-    auto& value = thriftPub.keyVals[kv.first];
-    value.version = kv.second.version;
-    value.originatorId = kv.second.originatorId;
-    value.hash.copy_from(kv.second.hash);
-    value.ttl = kv.second.ttl;
-    value.ttlVersion = kv.second.ttlVersion;
+    fn(kv.first, kv.second);
   }
-  return thriftPub;
 }
 
 // dump the keys on which hashes differ from given keyVals
@@ -1021,7 +1774,7 @@ KvStoreDb::dumpDifference(
     // common key
     const auto& myVal = myKv->second;
     const auto& reqVal = reqKv->second;
-    int rc = KvStore::compareValues(myVal, reqVal);
+    int rc = KvStore::compareValues(myVal, reqVal, kvParams_.hashVersion);
     if (rc == 1 or rc == -2) {
       // myVal is better or unknown
       thriftPub.keyVals.emplace(key, myVal);
@@ -1035,6 +1788,90 @@ KvStoreDb::dumpDifference(
   return thriftPub;
 }
 
+// dump my keyVals of all buckets whose hash differs from the requester's.
+// Unlike dumpDifference() this can't tell which side has the better value, the
+// initiator works that out on receiving them, see getBetterKeysInBuckets()
+thrift::Publication
+KvStoreDb::dumpBucketDifference(
+    KvStoreFilters const& kvFilters,
+    std::vector<int64_t> const& reqBucketHashes) const {
+  thrift::Publication thriftPub;
+  thriftPub.area = area_;
+
+  // with a different number of buckets every bucket is considered different
+  auto const& myBucketHashes = kvStore_.getBucketHashes();
+  std::vector<int32_t> syncBuckets;
+  for (size_t bucket = 0; bucket < myBucketHashes.size(); ++bucket) {
+    if (reqBucketHashes.size() == myBucketHashes.size() and
+        reqBucketHashes[bucket] == myBucketHashes[bucket]) {
+      continue;
+    }
+    syncBuckets.emplace_back(bucket);
+  }
+
+  // only the keys of differing buckets are visited
+  for (auto const bucket : syncBuckets) {
+    kvStore_.forEachInBucket(
+        bucket, [&](std::string const& key, KvStoreValue const& value) {
+          if (kvFilters.keyMatch(key, kvStore_.getOriginatorId(value))) {
+            thriftPub.keyVals.emplace(key, kvStore_.toThriftValue(value));
+          }
+        });
+  }
+
+  LOG(INFO) << "Processed bucket full-sync request. " << syncBuckets.size()
+            << " of " << myBucketHashes.size() << " buckets differ, sending "
+            << thriftPub.keyVals.size() << " key-vals";
+  thriftPub.syncBuckets = std::move(syncBuckets);
+  return thriftPub;
+}
+
+// dump my keyVals of all originators whose hash differs from the
+// requester's. Same as dumpBucketDifference(), the initiator works out which
+// side has the better values, see getBetterKeysOfOriginators()
+thrift::Publication
+KvStoreDb::dumpOriginatorDifference(
+    KvStoreFilters const& kvFilters,
+    std::map<std::string, int64_t> const& reqOriginatorHashes) const {
+  thrift::Publication thriftPub;
+  thriftPub.area = area_;
+
+  // originators only the requester has keys of differ as well, the
+  // requester sends their keys back
+  const auto myOriginatorHashes = kvStore_.getOriginatorHashes();
+  std::unordered_set<std::string> syncOriginators;
+  for (auto const& kv : myOriginatorHashes) {
+    auto it = reqOriginatorHashes.find(kv.first);
+    if (it == reqOriginatorHashes.end() or it->second != kv.second) {
+      syncOriginators.emplace(kv.first);
+    }
+  }
+  for (auto const& kv : reqOriginatorHashes) {
+    if (myOriginatorHashes.count(kv.first) == 0) {
+      syncOriginators.emplace(kv.first);
+    }
+  }
+
+  if (not syncOriginators.empty()) {
+    for (auto const& kv : kvStore_) {
+      auto const& originatorId = kvStore_.getOriginatorId(kv.second);
+      if (syncOriginators.count(originatorId) == 0 or
+          not kvFilters.keyMatch(kv.first, originatorId)) {
+        continue;
+      }
+      thriftPub.keyVals.emplace(kv.first, kvStore_.toThriftValue(kv.second));
+    }
+  }
+
+  LOG(INFO) << "Processed originator full-sync request. "
+            << syncOriginators.size() << " of " << myOriginatorHashes.size()
+            << " originators differ, sending " << thriftPub.keyVals.size()
+            << " key-vals";
+  thriftPub.syncOriginators = std::vector<std::string>(
+      syncOriginators.begin(), syncOriginators.end());
+  return thriftPub;
+}
+
 // add new peers to subscribe to
 void
 KvStoreDb::addPeers(
@@ -1054,6 +1891,8 @@ KvStoreDb::addPeers(
       auto it = peers_.find(peerName);
       bool cmdUrlUpdated{false};
       bool isNewPeer{false};
+      const std::string oldPeerCmdId =
+          it != peers_.end() ? it->second.second : std::string{};
 
       // add dual peers for both new-peer or update-peer event
       if (supportFloodOptimization) {
@@ -1098,6 +1937,23 @@ KvStoreDb::addPeers(
             peers_.emplace(peerName, std::make_pair(newPeerSpec, newPeerCmdId));
       }
 
+      // (re)create THRIFT transport for the current spec, its socket-id may
+      // have changed as well
+      thriftPeers_.erase(oldPeerCmdId);
+      // keys queued for the old socket get there with the full-sync below
+      peerSendQueues_.erase(oldPeerCmdId);
+      if (useThriftTransport(newPeerSpec)) {
+        LOG(INFO) << "Using THRIFT transport to " << newPeerSpec.ctrlAddr
+                  << ":" << newPeerSpec.ctrlPort << " for peer " << peerName;
+        thriftPeers_[it->second.second] = std::make_unique<KvStoreThriftPeer>(
+            evb_->getEvb(),
+            *thriftClients_,
+            area_,
+            newPeerSpec.ctrlAddr,
+            newPeerSpec.ctrlPort,
+            Constants::kThriftPeerMaxPendingRequests);
+      }
+
       if (cmdUrlUpdated) {
         CHECK(newPeerCmdId == it->second.second);
         LOG(INFO) << "Connecting sync channel to " << newPeerSpec.cmdUrl
@@ -1135,9 +1991,9 @@ KvStoreDb::addPeers(
                  << "` reason: " << folly::exceptionStr(e);
     }
   }
-  if (not fullSyncTimer_->isScheduled()) {
-    fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
-  }
+  // the timer may be waiting for full-syncs in progress to time out, request
+  // right away. Peers in backoff are skipped anyway
+  fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
 
   // process dual events if any
   if (kvParams_.enableFloodOptimization) {
@@ -1153,6 +2009,12 @@ folly::Expected<size_t, fbzmq::Error>
 KvStoreDb::sendMessageToPeer(
     const std::string& peerSocketId, const thrift::KvStoreRequest& request) {
   auto msg = fbzmq::Message::fromThriftObj(request, serializer_).value();
+  return sendMessageToPeer(peerSocketId, msg);
+}
+
+folly::Expected<size_t, fbzmq::Error>
+KvStoreDb::sendMessageToPeer(
+    const std::string& peerSocketId, const fbzmq::Message& msg) {
   fb303::fbData->addStatValue(
       "kvstore.peers.bytes_sent", msg.size(), fb303::SUM);
   return peerSyncSock_.sendMultiple(
@@ -1165,8 +2027,51 @@ KvStoreDb::getCounters() {
 
   // Add some more flat counters
   counters["kvstore.num_keys"] = kvStore_.size();
+  counters["kvstore.num_bytes"] = kvStore_.getBytes();
+  counters["kvstore.num_originator_ids"] = kvStore_.getNumOriginatorIds();
   counters["kvstore.num_peers"] = peers_.size();
   counters["kvstore.pending_full_sync"] = peersToSyncWith_.size();
+  counters["kvstore.full_sync_in_progress"] = latestSentPeerSync_.size();
+  counters["kvstore.pending_sync_merges"] = pendingSyncMerges_.size();
+  for (auto const& kv : peerSyncDurations_) {
+    counters[folly::sformat(
+        "kvstore.full_sync_duration_ms.{}.{}", area_, kv.first)] =
+        kv.second.count();
+  }
+  size_t numPendingRequests{0};
+  size_t numWaitingKeySets{0};
+  for (auto const& kv : thriftPeers_) {
+    numPendingRequests += kv.second->getNumPendingRequests();
+    numWaitingKeySets += kv.second->getNumWaitingKeySets();
+  }
+  counters["kvstore.thrift.num_peers"] = thriftPeers_.size();
+  counters["kvstore.thrift.pending_requests"] = numPendingRequests;
+  counters["kvstore.thrift.waiting_key_sets"] = numWaitingKeySets;
+  size_t numQueuedKeys{0};
+  size_t numQueuedBytes{0};
+  for (auto const& kv : peerSendQueues_) {
+    numQueuedKeys += kv.second.keys.size();
+    numQueuedBytes += kv.second.bytes;
+  }
+  counters["kvstore.peer_send_queue.num_peers"] = peerSendQueues_.size();
+  counters["kvstore.peer_send_queue.num_keys"] = numQueuedKeys;
+  counters["kvstore.peer_send_queue.num_bytes"] = numQueuedBytes;
+
+  // keys stored and waiting to be flooded, by key class. Counts are
+  // maintained along with the store and the flood buffer. Classes may share
+  // a name, e.g. priority markers of adjacency keys
+  auto const& keyClassNames = kvStore_.getKeyClassNames();
+  auto const& keyClassUsage = kvStore_.getKeyClassUsage();
+  size_t numBacklogKeys{0};
+  for (size_t i = 0; i < keyClassNames.size(); ++i) {
+    auto const& name = keyClassNames[i];
+    counters["kvstore.num_keys." + name] += keyClassUsage[i].first;
+    counters["kvstore.num_bytes." + name] += keyClassUsage[i].second;
+    counters["kvstore.flood_backlog_keys." + name] +=
+        publicationBufferKeys_[i];
+    numBacklogKeys += publicationBufferKeys_[i];
+  }
+  counters["kvstore.flood_backlog_keys"] = numBacklogKeys;
   return counters;
 }
 
@@ -1196,10 +2101,12 @@ KvStoreDb::delPeers(std::vector<std::string> const& peers) {
     }
 
     peersToSyncWith_.erase(peerName);
-    auto const& peerCmdSocketId = it->second.second;
-    if (latestSentPeerSync_.count(peerCmdSocketId)) {
-      latestSentPeerSync_.erase(peerCmdSocketId);
-    }
+    releaseSptParentSync(peerName, std::nullopt);
+    latestSentPeerSync_.erase(it->second.second /* socket-id */);
+    compressionPeers_.erase(it->second.second /* socket-id */);
+    thriftPeers_.erase(it->second.second /* socket-id */);
+    peerSendQueues_.erase(it->second.second /* socket-id */);
+    peerSyncDurations_.erase(peerName);
     peers_.erase(it);
   }
 
@@ -1215,17 +2122,69 @@ KvStoreDb::delPeers(std::vector<std::string> const& peers) {
 // Get full KEY_DUMP from peersToSyncWith_
 void
 KvStoreDb::requestFullSyncFromPeers() {
+  const auto now = std::chrono::steady_clock::now();
+
   // minimal timeout for next run
   auto timeout = std::chrono::milliseconds(Constants::kMaxBackoff);
 
-  // Make requests
-  for (auto it = peersToSyncWith_.begin(); it != peersToSyncWith_.end();) {
-    auto& peerName = it->first;
-    auto& expBackoff = it->second;
+  // Give up on full-syncs without response, so that they don't hold their
+  // slot forever. Their peers get queued again
+  for (auto it = latestSentPeerSync_.begin();
+       it != latestSentPeerSync_.end();) {
+    auto const& pendingSync = it->second;
+    if (now - pendingSync.sentTime < Constants::kStoreFullSyncResponseTimeout) {
+      ++it;
+      continue;
+    }
+    LOG(WARNING) << "No full-sync response from peer " << pendingSync.peerName
+                 << " (will try again)";
+    fb303::fbData->addStatValue("kvstore.full_sync_timeouts", 1, fb303::COUNT);
+    releaseSptParentSync(pendingSync.peerName, std::nullopt);
+    if (peers_.count(pendingSync.peerName)) {
+      peersToSyncWith_.emplace(
+          pendingSync.peerName,
+          ExponentialBackoff<std::chrono::milliseconds>(
+              Constants::kInitialBackoff, Constants::kMaxBackoff));
+    }
+    it = latestSentPeerSync_.erase(it);
+  }
+
+  // Until the first full-sync completed only one is sent. It fills most of
+  // the store, the ones following it only exchange the difference then
+  const size_t maxSyncsInProgress =
+      initialSyncCompleted_ ? fullSycnReqInProgress_ : 1;
+
+  // Sync with least loaded peers first, as told by how long their last
+  // full-sync took. Peers never synced with go first
+  std::vector<std::string> peerNames;
+  peerNames.reserve(peersToSyncWith_.size());
+  for (auto const& kv : peersToSyncWith_) {
+    peerNames.emplace_back(kv.first);
+  }
+  // New spt-parents go ahead of all, they complete the flooding tree
+  std::sort(
+      peerNames.begin(),
+      peerNames.end(),
+      [this](std::string const& lhs, std::string const& rhs) {
+        const bool lhsParent = pendingSptParentSyncs_.count(lhs) != 0;
+        const bool rhsParent = pendingSptParentSyncs_.count(rhs) != 0;
+        if (lhsParent != rhsParent) {
+          return lhsParent;
+        }
+        return getLastSyncDuration(lhs) < getLastSyncDuration(rhs);
+      });
 
+  // Make requests, syncs with new spt-parents aren't held back by the limit
+  for (auto const& peerName : peerNames) {
+    if (latestSentPeerSync_.size() >= maxSyncsInProgress and
+        pendingSptParentSyncs_.count(peerName) == 0) {
+      LOG(INFO) << latestSentPeerSync_.size() << " full-sync in progress";
+      break;
+    }
+
+    auto& expBackoff = peersToSyncWith_.at(peerName);
     if (not expBackoff.canTryNow()) {
       timeout = std::min(timeout, expBackoff.getTimeRemainingUntilRetry());
-      ++it;
       continue;
     }
 
@@ -1244,10 +2203,23 @@ KvStoreDb::requestFullSyncFromPeers() {
       params.prefix = keyPrefix;
       params.originatorIds = kvParams_.filters.value().getOrigniatorIdList();
     }
-    std::set<std::string> originator{};
-    std::vector<std::string> keyPrefixList{};
-    KvStoreFilters kvFilters{keyPrefixList, originator};
-    params.keyValHashes = std::move(dumpHashWithFilters(kvFilters).keyVals);
+    if (kvParams_.enableOriginatorSync and not kvParams_.filters.has_value()) {
+      // same as bucket hashes below, originator hashes cover all keys
+      auto hashes = kvStore_.getOriginatorHashes();
+      params.keyValOriginatorHashes =
+          std::map<std::string, int64_t>(hashes.begin(), hashes.end());
+    } else if (
+        kvParams_.enableBucketSync and not kvParams_.filters.has_value()) {
+      // bucket hashes only cover the whole store, with filters the buckets
+      // of peers would never match
+      params.keyValBucketHashes = kvStore_.getBucketHashes();
+    } else {
+      std::set<std::string> originator{};
+      std::vector<std::string> keyPrefixList{};
+      KvStoreFilters kvFilters{keyPrefixList, originator};
+      params.keyValHashes = std::move(dumpHashWithFilters(kvFilters).keyVals);
+    }
+    params.acceptCompression = getSupportedCompression();
 
     dumpRequest.cmd = thrift::Command::KEY_DUMP;
     dumpRequest.keyDumpParams = params;
@@ -1255,8 +2227,21 @@ KvStoreDb::requestFullSyncFromPeers() {
 
     VLOG(1) << "Sending full-sync request to peer " << peerName << " using id "
             << peerCmdSocketId;
-    latestSentPeerSync_[peerCmdSocketId] = std::chrono::steady_clock::now();
-    auto const ret = sendMessageToPeer(peerCmdSocketId, dumpRequest);
+    folly::Expected<size_t, fbzmq::Error> ret{0};
+    auto thriftPeerIt = thriftPeers_.find(peerCmdSocketId);
+    if (thriftPeerIt != thriftPeers_.end()) {
+      auto const sent = thriftPeerIt->second->requestFullSync(
+          params,
+          [this, peerCmdSocketId](folly::Try<thrift::Publication> syncPub) {
+            processThriftSyncResponse(peerCmdSocketId, std::move(syncPub));
+          });
+      if (not sent) {
+        ret = folly::makeUnexpected(
+            fbzmq::Error(ENOTCONN, "Can not connect over THRIFT transport"));
+      }
+    } else {
+      ret = sendMessageToPeer(peerCmdSocketId, dumpRequest);
+    }
 
     if (ret.hasError()) {
       // this could be pretty common on initial connection setup
@@ -1266,37 +2251,42 @@ KvStoreDb::requestFullSyncFromPeers() {
       collectSendFailureStats(ret.error(), peerCmdSocketId);
       expBackoff.reportError(); // Apply exponential backoff
       timeout = std::min(timeout, expBackoff.getTimeRemainingUntilRetry());
-      ++it;
     } else {
-      latestSentPeerSync_.emplace(
-          peerCmdSocketId, std::chrono::steady_clock::now());
-
-      // Remove the iterator
-      it = peersToSyncWith_.erase(it);
-    }
-
-    // if pending response is above the limit wait until
-    // kStoreFullSyncResponseTimeout before sending next sync request
-    if (latestSentPeerSync_.size() >= fullSycnReqInProgress_) {
-      LOG(INFO) << fullSycnReqInProgress_ << " full-sync in progress";
-      timeout = Constants::kStoreFullSyncResponseTimeout;
-      break;
+      latestSentPeerSync_[peerCmdSocketId] =
+          PendingFullSync{peerName, std::chrono::steady_clock::now()};
+      peersToSyncWith_.erase(peerName);
     }
   } // for
 
+  // Check back once the oldest full-sync in progress times out
+  for (auto const& kv : latestSentPeerSync_) {
+    timeout = std::min(
+        timeout,
+        std::chrono::ceil<std::chrono::milliseconds>(
+            kv.second.sentTime + Constants::kStoreFullSyncResponseTimeout -
+            now));
+  }
+
   // schedule fullSyncTimer if there are pending peers to sync with or
-  // if maximum allowed pending sync count is reached. Adding a new peer
-  // will not initiate full sync request if it's already scheduled
-  if (not peersToSyncWith_.empty() ||
-      latestSentPeerSync_.size() >= fullSycnReqInProgress_) {
+  // full-syncs in progress. Adding a new peer will not initiate full sync
+  // request if it's already scheduled
+  if (not peersToSyncWith_.empty() or not latestSentPeerSync_.empty()) {
     LOG_IF(INFO, peersToSyncWith_.size())
         << peersToSyncWith_.size() << " peers still require full-sync.";
-    LOG(INFO) << "Scheduling full-sync after " << timeout.count() << "ms.";
+    timeout = std::max(timeout, std::chrono::milliseconds(0));
+    VLOG(1) << "Scheduling full-sync after " << timeout.count() << "ms.";
     // schedule next timeout
     fullSyncTimer_->scheduleTimeout(timeout);
   }
 }
 
+std::chrono::milliseconds
+KvStoreDb::getLastSyncDuration(std::string const& peerName) const {
+  auto it = peerSyncDurations_.find(peerName);
+  return it == peerSyncDurations_.end() ? std::chrono::milliseconds(0)
+                                        : it->second;
+}
+
 // dump all peers we are subscribed to
 thrift::PeersMap
 KvStoreDb::dumpPeers() {
@@ -1311,35 +2301,57 @@ KvStoreDb::dumpPeers() {
 // same so existing keys will not be updated with this TTL
 void
 KvStoreDb::updatePublicationTtl(
-    thrift::Publication& thriftPub, bool removeAboutToExpire) {
+    thrift::Publication& thriftPub, bool removeAboutToExpire) const {
   auto timeNow = std::chrono::steady_clock::now();
-  for (const auto& qE : ttlCountdownQueue_) {
-    // Find key and ensure we are taking time from right entry from queue
-    auto kv = thriftPub.keyVals.find(qE.key);
-    if (kv == thriftPub.keyVals.end() or kv->second.version != qE.version or
-        kv->second.originatorId != qE.originatorId or
-        kv->second.ttlVersion != qE.ttlVersion) {
-      continue;
-    }
-
-    // Compute timeLeft and do sanity check on it
-    auto timeLeft = duration_cast<milliseconds>(qE.expiryTime - timeNow);
-    if (timeLeft <= kvParams_.ttlDecr) {
-      thriftPub.keyVals.erase(kv);
-      continue;
-    }
-
-    // filter key from publication if time left is below ttl threshold
-    if (removeAboutToExpire and timeLeft < Constants::kTtlThreshold) {
-      thriftPub.keyVals.erase(kv);
+  for (auto kv = thriftPub.keyVals.begin(); kv != thriftPub.keyVals.end();) {
+    auto ttl = getPublicationTtl(
+        kv->first,
+        kv->second.version,
+        kv->second.originatorId,
+        kv->second.ttlVersion,
+        kv->second.ttl,
+        timeNow,
+        removeAboutToExpire);
+    if (not ttl.has_value()) {
+      kv = thriftPub.keyVals.erase(kv);
       continue;
     }
+    kv->second.ttl = *ttl;
+    ++kv;
+  }
+}
 
-    // Set the time-left and decrement it by one so that ttl decrement
-    // deterministically whenever it is exchanged between KvStores. This will
-    // avoid looping of updates between stores.
-    kv->second.ttl = timeLeft.count() - kvParams_.ttlDecr.count();
-  }
+std::optional<int64_t>
+KvStoreDb::getPublicationTtl(
+    std::string const& key,
+    int64_t version,
+    std::string const& originatorId,
+    int64_t ttlVersion,
+    int64_t ttl,
+    std::chrono::steady_clock::time_point timeNow,
+    bool removeAboutToExpire) const {
+  // Find key and ensure we are taking time from right count down entry
+  auto const* qE = ttlCountdownWheel_.find(key);
+  if (not qE or version != qE->version or originatorId != qE->originatorId or
+      ttlVersion != qE->ttlVersion) {
+    return ttl;
+  }
+
+  // Compute timeLeft and do sanity check on it
+  auto timeLeft = duration_cast<milliseconds>(qE->expiryTime - timeNow);
+  if (timeLeft <= kvParams_.ttlDecr) {
+    return std::nullopt;
+  }
+
+  // filter key from publication if time left is below ttl threshold
+  if (removeAboutToExpire and timeLeft < Constants::kTtlThreshold) {
+    return std::nullopt;
+  }
+
+  // Set the time-left and decrement it by one so that ttl decrement
+  // deterministically whenever it is exchanged between KvStores. This will
+  // avoid looping of updates between stores.
+  return timeLeft.count() - kvParams_.ttlDecr.count();
 }
 
 // process a request
@@ -1370,17 +2382,24 @@ KvStoreDb::processRequestMsgHelper(thrift::KvStoreRequest& thriftReq) {
     }
 
     auto& ketSetParamsVal = thriftReq.keySetParams.value();
-    if (ketSetParamsVal.keyVals.empty()) {
+    if (ketSetParamsVal.keyVals.empty() and
+        (not ketSetParamsVal.ttlUpdates.has_value() or
+         ketSetParamsVal.ttlUpdates->empty())) {
       LOG(ERROR) << "Malformed set request, ignoring";
       return folly::makeUnexpected(fbzmq::Error());
     }
 
     // Update hash for key-values
+    dropRecentKeyVals(ketSetParamsVal);
+    decompressKeyVals(ketSetParamsVal.keyVals);
     for (auto& kv : ketSetParamsVal.keyVals) {
       auto& value = kv.second;
       if (value.value.has_value()) {
-        value.hash =
-            generateHash(value.version, value.originatorId, value.value);
+        value.hash = generateHash(
+            value.version,
+            value.originatorId,
+            value.value,
+            kvParams_.hashVersion);
       }
     }
 
@@ -1390,7 +2409,8 @@ KvStoreDb::processRequestMsgHelper(thrift::KvStoreRequest& thriftReq) {
     rcvdPublication.nodeIds.move_from(std::move(ketSetParamsVal.nodeIds));
     rcvdPublication.floodRootId.move_from(
         std::move(ketSetParamsVal.floodRootId));
-    mergePublication(rcvdPublication);
+    rcvdPublication.ttlUpdates.move_from(std::move(ketSetParamsVal.ttlUpdates));
+    mergePublication(std::move(rcvdPublication));
 
     // respond to the client
     if (ketSetParamsVal.solicitResponse) {
@@ -1425,7 +2445,16 @@ KvStoreDb::processRequestMsgHelper(thrift::KvStoreRequest& thriftReq) {
     folly::split(",", keyDumpParamsVal.prefix, keyPrefixList, true);
     const auto keyPrefixMatch =
         KvStoreFilters(keyPrefixList, keyDumpParamsVal.originatorIds);
-    auto thriftPub = dumpAllWithFilters(keyPrefixMatch);
+    thrift::Publication thriftPub;
+    if (keyDumpParamsVal.keyValOriginatorHashes.has_value()) {
+      thriftPub = dumpOriginatorDifference(
+          keyPrefixMatch, keyDumpParamsVal.keyValOriginatorHashes.value());
+    } else if (keyDumpParamsVal.keyValBucketHashes.has_value()) {
+      thriftPub = dumpBucketDifference(
+          keyPrefixMatch, keyDumpParamsVal.keyValBucketHashes.value());
+    } else {
+      thriftPub = dumpAllWithFilters(keyPrefixMatch);
+    }
     if (keyDumpParamsVal.keyValHashes.has_value()) {
       thriftPub = dumpDifference(
           thriftPub.keyVals, keyDumpParamsVal.keyValHashes.value());
@@ -1446,6 +2475,18 @@ KvStoreDb::processRequestMsgHelper(thrift::KvStoreRequest& thriftReq) {
                 << " keyValHashes item(s). Sending " << thriftPub.keyVals.size()
                 << " key-vals and " << numMissingKeys << " missing keys";
     }
+
+    // compress the response if the requester can decompress it, and tell it
+    // what it may compress for us in turn
+    if (keyDumpParamsVal.acceptCompression.has_value()) {
+      auto const& accepted = keyDumpParamsVal.acceptCompression.value();
+      if (std::find(
+              accepted.begin(), accepted.end(), kvParams_.valueCompression) !=
+          accepted.end()) {
+        compressKeyVals(thriftPub.keyVals);
+      }
+    }
+    thriftPub.acceptCompression = getSupportedCompression();
     return fbzmq::Message::fromThriftObj(thriftPub, serializer_);
   }
   case thrift::Command::HASH_DUMP: {
@@ -1647,15 +2688,27 @@ KvStoreDb::processNexthopChange(
     // full synced. (ps: full-sync is 3-way-sync, one direction sync should be
     // good enough)
     LOG(INFO) << "dual full-sync with " << *newNh;
+    auto& pendingSync = pendingSptParentSyncs_[*newNh];
+    pendingSync.since = std::chrono::steady_clock::now();
+    auto& heldParents = pendingSync.heldParents;
+    if (oldNh.has_value() and peers_.count(*oldNh)) {
+      // keep flooding to old parent till new one is synced, along with the
+      // parents it was held for if it didn't get synced itself
+      heldParents.emplace(*oldNh);
+      auto oldIt = pendingSptParentSyncs_.find(*oldNh);
+      if (oldIt != pendingSptParentSyncs_.end()) {
+        heldParents.insert(
+            oldIt->second.heldParents.begin(), oldIt->second.heldParents.end());
+      }
+    }
+    heldParents.erase(*newNh);
     peersToSyncWith_.emplace(
         *newNh,
         ExponentialBackoff<std::chrono::milliseconds>(
             Constants::kInitialBackoff, Constants::kMaxBackoff));
 
     // initial full-sync request if peersToSyncWith_ was empty
-    if (not fullSyncTimer_->isScheduled()) {
-      fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
-    }
+    fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
   }
 
   // unset old parent if any
@@ -1716,26 +2769,158 @@ KvStoreDb::processSyncResponse() noexcept {
     return;
   }
 
-  const auto& syncPub = maybeSyncPub.value();
-  const size_t kvUpdateCnt = mergePublication(syncPub, requestId);
+  processSyncPublication(maybeSyncPub.value(), requestId);
+}
+
+void
+KvStoreDb::processThriftSyncResponse(
+    std::string const& peerCmdSocketId,
+    folly::Try<thrift::Publication>&& maybeSyncPub) {
+  if (maybeSyncPub.hasValue()) {
+    return processSyncPublication(maybeSyncPub.value(), peerCmdSocketId);
+  }
+
+  // retry with backoff, same as failing to send the request
+  auto pendingSyncIt = latestSentPeerSync_.find(peerCmdSocketId);
+  if (pendingSyncIt == latestSentPeerSync_.end()) {
+    return;
+  }
+  auto const peerName = pendingSyncIt->second.peerName;
+  latestSentPeerSync_.erase(pendingSyncIt);
+  LOG(ERROR) << "Full-sync request to peer " << peerName
+             << " failed (will try again). "
+             << maybeSyncPub.exception().what();
+  releaseSptParentSync(peerName, std::nullopt);
+  if (peers_.count(peerName)) {
+    auto it = peersToSyncWith_.emplace(
+        peerName,
+        ExponentialBackoff<std::chrono::milliseconds>(
+            Constants::kInitialBackoff, Constants::kMaxBackoff));
+    it.first->second.reportError();
+  }
+  fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+}
+
+void
+KvStoreDb::processSyncPublication(
+    thrift::Publication& syncPub, std::string const& requestId) {
+  decompressKeyVals(syncPub.keyVals);
+
+  // compress what we send to the peer from now on if it can decompress it
+  bool peerAcceptsCompression = false;
+  if (syncPub.acceptCompression.has_value()) {
+    auto const& accepted = syncPub.acceptCompression.value();
+    peerAcceptsCompression =
+        std::find(
+            accepted.begin(), accepted.end(), kvParams_.valueCompression) !=
+        accepted.end();
+  }
+  if (peerAcceptsCompression) {
+    compressionPeers_.emplace(requestId);
+  } else {
+    compressionPeers_.erase(requestId);
+  }
+
+  if (syncPub.syncBuckets.has_value()) {
+    // response to bucket sync, find out what the peer needs from us before
+    // merging its keyVals
+    syncPub.tobeUpdatedKeys =
+        getBetterKeysInBuckets(syncPub.syncBuckets.value(), syncPub.keyVals);
+  } else if (syncPub.syncOriginators.has_value()) {
+    // same for a response to originator sync
+    syncPub.tobeUpdatedKeys = getBetterKeysOfOriginators(
+        syncPub.syncOriginators.value(), syncPub.keyVals);
+  }
+
+  // big responses get merged in slices, not to hold up peers' floods and
+  // ctrl requests for the whole merge
+  if (syncPub.keyVals.size() > Constants::kKvStoreSyncMergeSliceKeys) {
+    PendingSyncMerge pendingMerge;
+    pendingMerge.numKeyVals = syncPub.keyVals.size();
+    pendingMerge.syncPub = std::move(syncPub);
+    pendingMerge.requestId = requestId;
+    pendingSyncMerges_.emplace_back(std::move(pendingMerge));
+    if (pendingSyncMerges_.size() == 1) {
+      mergeSyncSlice();
+    }
+    return;
+  }
+
+  const size_t numKeyVals = syncPub.keyVals.size();
   size_t numMissingKeys = 0;
   if (syncPub.tobeUpdatedKeys.has_value()) {
     numMissingKeys = syncPub.tobeUpdatedKeys->size();
   }
+  const size_t kvUpdateCnt = mergePublication(std::move(syncPub), requestId);
+  completeSyncPublication(requestId, numKeyVals, numMissingKeys, kvUpdateCnt);
+}
+
+void
+KvStoreDb::mergeSyncSlice() {
+  if (pendingSyncMerges_.empty()) {
+    return;
+  }
+  auto& pendingMerge = pendingSyncMerges_.front();
+  auto& syncPub = pendingMerge.syncPub;
+
+  // the last slice carries the keys to send back to the peer
+  thrift::Publication slice;
+  slice.floodRootId.copy_from(syncPub.floodRootId);
+  slice.nodeIds.copy_from(syncPub.nodeIds);
+  auto it = syncPub.keyVals.begin();
+  for (size_t i = 0; i < Constants::kKvStoreSyncMergeSliceKeys and
+       it != syncPub.keyVals.end();
+       ++i) {
+    slice.keyVals.emplace(it->first, std::move(it->second));
+    it = syncPub.keyVals.erase(it);
+  }
+  const bool isLastSlice = syncPub.keyVals.empty();
+  if (isLastSlice) {
+    slice.tobeUpdatedKeys.copy_from(syncPub.tobeUpdatedKeys);
+  }
+  pendingMerge.kvUpdateCnt +=
+      mergePublication(std::move(slice), pendingMerge.requestId);
+
+  if (not isLastSlice) {
+    syncMergeTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+    return;
+  }
+  const auto numMissingKeys = syncPub.tobeUpdatedKeys.has_value()
+      ? syncPub.tobeUpdatedKeys->size()
+      : 0;
+  auto merged = std::move(pendingMerge);
+  pendingSyncMerges_.pop_front();
+  completeSyncPublication(
+      merged.requestId, merged.numKeyVals, numMissingKeys, merged.kvUpdateCnt);
+  if (not pendingSyncMerges_.empty()) {
+    syncMergeTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+  }
+}
 
+void
+KvStoreDb::completeSyncPublication(
+    std::string const& requestId,
+    size_t numKeyVals,
+    size_t numMissingKeys,
+    size_t kvUpdateCnt) {
   LOG(INFO) << "full-sync response received from " << requestId << " with "
-            << syncPub.keyVals.size() << " key-vals and " << numMissingKeys
+            << numKeyVals << " key-vals and " << numMissingKeys
             << " missing keys. Incured " << kvUpdateCnt << " key-value updates";
 
-  if (latestSentPeerSync_.count(requestId)) {
+  auto pendingSyncIt = latestSentPeerSync_.find(requestId);
+  if (pendingSyncIt != latestSentPeerSync_.end()) {
+    auto const& peerName = pendingSyncIt->second.peerName;
     auto syncDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now() - latestSentPeerSync_.at(requestId));
+        std::chrono::steady_clock::now() - pendingSyncIt->second.sentTime);
     fb303::fbData->addStatValue(
         "kvstore.full_sync_duration_ms", syncDuration.count(), fb303::AVG);
+    peerSyncDurations_[peerName] = syncDuration;
     logSyncEvent(requestId, syncDuration);
     VLOG(1) << "It took " << syncDuration.count() << " ms to sync with "
-            << requestId;
-    latestSentPeerSync_.erase(requestId);
+            << peerName;
+    releaseSptParentSync(peerName, pendingSyncIt->second.sentTime);
+    latestSentPeerSync_.erase(pendingSyncIt);
+    initialSyncCompleted_ = true;
     // if peers to sync with is not empty then schedule one immediately
     // double the max full sync pending once a response is received, to a max
     // of kMaxFullSyncPendingCountThreshold
@@ -1748,6 +2933,23 @@ KvStoreDb::processSyncResponse() noexcept {
   }
 }
 
+void
+KvStoreDb::releaseSptParentSync(
+    std::string const& peerName,
+    std::optional<std::chrono::steady_clock::time_point> syncSentTime) {
+  auto it = pendingSptParentSyncs_.find(peerName);
+  if (it == pendingSptParentSyncs_.end()) {
+    return;
+  }
+  if (syncSentTime.has_value() and *syncSentTime < it->second.since) {
+    // sync was requested before peer became parent, wait for next one
+    return;
+  }
+  VLOG(1) << "spt-parent " << peerName << " synced, stop flooding to "
+          << it->second.heldParents.size() << " old spt-parents";
+  pendingSptParentSyncs_.erase(it);
+}
+
 // send sync request from one neighbor randomly
 void
 KvStoreDb::requestSync() {
@@ -1787,9 +2989,7 @@ KvStoreDb::requestSync() {
           Constants::kInitialBackoff, Constants::kMaxBackoff));
 
   // initial full-sync request if peersToSyncWith_ was empty
-  if (not fullSyncTimer_->isScheduled()) {
-    fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
-  }
+  fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
 }
 
 // this will poll the sockets listening to the requests
@@ -1819,6 +3019,16 @@ KvStoreDb::attachCallbacks() {
                << peerSyncHandover.error();
   }
 
+  // fail sends to peers whose queue is at the high water mark with EAGAIN,
+  // instead of dropping them silently, so that flooded keys get queued
+  const int mandatory = 1;
+  const auto peerSyncMandatory = peerSyncSock_.setSockOpt(
+      ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(int));
+  if (peerSyncMandatory.hasError()) {
+    LOG(FATAL) << "Error setting ZMQ_ROUTER_MANDATORY to " << mandatory << " "
+               << peerSyncMandatory.error();
+  }
+
   // set keep-alive to retire old flows
   const auto peerSyncKeepAlive = peerSyncSock_.setKeepAlive(
       Constants::kKeepAliveEnable,
@@ -1850,6 +3060,9 @@ KvStoreDb::attachCallbacks() {
   fullSyncTimer_ = folly::AsyncTimeout::make(
       *evb_->getEvb(), [this]() noexcept { requestFullSyncFromPeers(); });
 
+  syncMergeTimer_ = folly::AsyncTimeout::make(
+      *evb_->getEvb(), [this]() noexcept { mergeSyncSlice(); });
+
   // Define request sync timer
   requestSyncTimer_ = folly::AsyncTimeout::make(
       *evb_->getEvb(), [this]() noexcept { requestSync(); });
@@ -1859,22 +3072,16 @@ KvStoreDb::attachCallbacks() {
 }
 
 void
-KvStoreDb::cleanupTtlCountdownQueue() {
+KvStoreDb::cleanupTtlCountdown() {
   // record all expired keys
   std::vector<std::string> expiredKeys;
   auto now = std::chrono::steady_clock::now();
 
-  // Iterate through ttlCountdownQueue_ until the top expires in the future
-  while (not ttlCountdownQueue_.empty()) {
-    auto top = ttlCountdownQueue_.top();
-    if (top.expiryTime > now) {
-      // Nothing in queue worth evicting
-      break;
-    }
-    auto it = kvStore_.find(top.key);
-    if (it != kvStore_.end() and it->second.version == top.version and
-        it->second.originatorId == top.originatorId and
-        it->second.ttlVersion == top.ttlVersion) {
+  for (auto const& top : ttlCountdownWheel_.expire(now)) {
+    auto const* value = kvStore_.find(top.key);
+    if (value and value->version == top.version and
+        kvStore_.getOriginatorId(*value) == top.originatorId and
+        value->ttlVersion == top.ttlVersion) {
       expiredKeys.emplace_back(top.key);
       LOG(WARNING)
           << "Delete expired (key, version, originatorId, ttlVersion, ttl, "
@@ -1882,29 +3089,36 @@ KvStoreDb::cleanupTtlCountdownQueue() {
           << folly::sformat(
                  "({}, {}, {}, {}, {}, {}, {})",
                  top.key,
-                 it->second.version,
-                 it->second.originatorId,
-                 it->second.ttlVersion,
-                 it->second.ttl,
+                 value->version,
+                 kvStore_.getOriginatorId(*value),
+                 value->ttlVersion,
+                 value->ttl,
                  kvParams_.nodeId,
                  area_);
       logKvEvent("KEY_EXPIRE", top.key);
-      kvStore_.erase(it);
+      recentKeyVals_.erase(
+          getKeyValDigest(top.key, kvStore_.toThriftHash(*value)));
+      kvStore_.erase(top.key);
     }
-    ttlCountdownQueue_.pop();
   }
 
-  // Reschedule based on most recent timeout
-  if (not ttlCountdownQueue_.empty()) {
+  // Reschedule based on most recent timeout, keys expiring within the slack
+  // of it get expired along
+  auto nextExpiry = ttlCountdownWheel_.getNextExpiry();
+  if (nextExpiry.has_value()) {
     ttlCountdownTimer_->scheduleTimeout(
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            ttlCountdownQueue_.top().expiryTime - now));
+        std::max(
+            std::chrono::milliseconds(0),
+            std::chrono::ceil<std::chrono::milliseconds>(*nextExpiry - now)) +
+        kvParams_.ttlExpirySlack);
+    ttlCountdownTimerExpiry_ = *nextExpiry;
   }
 
   if (expiredKeys.empty()) {
     // no key expires
     return;
   }
+  ++generation_;
   fb303::fbData->addStatValue(
       "kvstore.expired_key_vals", expiredKeys.size(), fb303::SUM);
   thrift::Publication expiredKeysPub{};
@@ -1914,19 +3128,29 @@ KvStoreDb::cleanupTtlCountdownQueue() {
 
 void
 KvStoreDb::bufferPublication(thrift::Publication&& publication) {
-  fb303::fbData->addStatValue("kvstore.rate_limit_suppress", 1, fb303::COUNT);
-  fb303::fbData->addStatValue(
-      "kvstore.rate_limit_keys", publication.keyVals.size(), fb303::AVG);
   std::optional<std::string> floodRootId{std::nullopt};
   if (publication.floodRootId.has_value()) {
     floodRootId = publication.floodRootId.value();
   }
+  if (publication.keyVals.empty() and publication.expiredKeys.empty()) {
+    return;
+  }
   // update or add keys
+  auto& keys = publicationBuffer_[floodRootId];
   for (auto const& kv : publication.keyVals) {
-    publicationBuffer_[floodRootId].emplace(kv.first);
+    if (keys.emplace(kv.first).second) {
+      ++publicationBufferKeys_[kvStore_.getKeyClass(kv.first)];
+    }
+    publicationBufferBytes_ += kv.first.size();
+    if (kv.second.value.has_value()) {
+      publicationBufferBytes_ += kv.second.value->size();
+    }
   }
   for (auto const& key : publication.expiredKeys) {
-    publicationBuffer_[floodRootId].emplace(key);
+    if (keys.emplace(key).second) {
+      ++publicationBufferKeys_[kvStore_.getKeyClass(key)];
+    }
+    publicationBufferBytes_ += key.size();
   }
 }
 
@@ -1939,19 +3163,25 @@ KvStoreDb::floodBufferedUpdates() {
   // merged-publications to be sent
   std::vector<thrift::Publication> publications;
 
-  // merge publication per root-id
+  // merge publication per root-id, starting a new one whenever the size
+  // bound is reached
   for (const auto& kv : publicationBuffer_) {
     thrift::Publication publication{};
-    // convert from std::optional to std::optional
-    std::optional<std::string> floodRootId{std::nullopt};
-    if (kv.first.has_value()) {
-      floodRootId = kv.first.value();
-    }
-    fromStdOptional(publication.floodRootId, floodRootId);
+    size_t publicationBytes{0};
+    fromStdOptional(publication.floodRootId, kv.first);
     for (const auto& key : kv.second) {
-      auto kvStoreIt = kvStore_.find(key);
-      if (kvStoreIt != kvStore_.end()) {
-        publication.keyVals.emplace(make_pair(key, kvStoreIt->second));
+      // every publication takes at least one key
+      if (publicationBytes > 0 and
+          publicationBytes >= kvParams_.floodBatchBytes) {
+        publications.emplace_back(std::move(publication));
+        publication = thrift::Publication{};
+        publicationBytes = 0;
+        fromStdOptional(publication.floodRootId, kv.first);
+      }
+      publicationBytes += key.size();
+      if (auto const* value = kvStore_.find(key)) {
+        publicationBytes += value->getValue().size();
+        publication.keyVals.emplace(key, kvStore_.toThriftValue(*value));
       } else {
         publication.expiredKeys.emplace_back(key);
       }
@@ -1960,6 +3190,11 @@ KvStoreDb::floodBufferedUpdates() {
   }
 
   publicationBuffer_.clear();
+  publicationBufferBytes_ = 0;
+  std::fill(publicationBufferKeys_.begin(), publicationBufferKeys_.end(), 0);
+  if (floodBatchTimer_) {
+    floodBatchTimer_->cancelTimeout();
+  }
 
   for (auto& pub : publications) {
     // when sending out merged publication, we maintain orginal-root-id
@@ -1969,15 +3204,24 @@ KvStoreDb::floodBufferedUpdates() {
   }
 }
 
+void
+KvStoreDb::floodBatchedUpdates() {
+  if (floodLimiter_ && !floodLimiter_->consume(1)) {
+    pendingPublicationTimer_->scheduleTimeout(
+        Constants::kFloodPendingPublication);
+    return;
+  }
+  floodBufferedUpdates();
+}
+
 void
 KvStoreDb::finalizeFullSync(
     const std::vector<std::string>& keys, const std::string& senderId) {
   // build keyval to be sent
   thrift::Publication updates;
   for (const auto& key : keys) {
-    const auto& it = kvStore_.find(key);
-    if (it != kvStore_.end()) {
-      updates.keyVals.emplace(key, it->second);
+    if (auto const* value = kvStore_.find(key)) {
+      updates.keyVals.emplace(key, kvStore_.toThriftValue(*value));
     }
   }
 
@@ -1994,6 +3238,9 @@ KvStoreDb::finalizeFullSync(
   thrift::KeySetParams params;
 
   params.keyVals = std::move(updates.keyVals);
+  if (compressionPeers_.count(senderId)) {
+    compressKeyVals(params.keyVals);
+  }
   params.solicitResponse = false;
   // I'm the initiator, set flood-root-id
   fromStdOptional(params.floodRootId, DualNode::getSptRootId());
@@ -2004,6 +3251,11 @@ KvStoreDb::finalizeFullSync(
   updateRequest.area = area_;
 
   VLOG(1) << "sending finalizeFullSync back to " << senderId;
+  auto thriftPeerIt = thriftPeers_.find(senderId);
+  if (thriftPeerIt != thriftPeers_.end()) {
+    thriftPeerIt->second->sendKeySet(std::move(params));
+    return;
+  }
   auto const ret = sendMessageToPeer(senderId, updateRequest);
   if (ret.hasError()) {
     // this could fail when senderId goes offline
@@ -2013,6 +3265,56 @@ KvStoreDb::finalizeFullSync(
   }
 }
 
+// keys to send back to a peer which responded to bucket sync, the
+// counterpart of tobeUpdatedKeys in the response of a regular full-sync
+std::vector<std::string>
+KvStoreDb::getBetterKeysInBuckets(
+    std::vector<int32_t> const& buckets,
+    std::unordered_map<std::string, thrift::Value> const& keyVals) const {
+  std::vector<bool> isSynced(Constants::kKvStoreSyncBuckets, false);
+  std::unordered_map<std::string, thrift::Value> myKeyVals;
+  for (auto const bucket : buckets) {
+    if (bucket < 0 or static_cast<size_t>(bucket) >= isSynced.size() or
+        isSynced[bucket]) {
+      continue;
+    }
+    isSynced[bucket] = true;
+    kvStore_.forEachInBucket(
+        bucket, [&](std::string const& key, KvStoreValue const& value) {
+          myKeyVals.emplace(key, kvStore_.toThriftValue(value));
+        });
+  }
+
+  // keys better on my side or missing on peer side are the keyVals of the
+  // difference
+  std::vector<std::string> keys;
+  for (auto const& kv : dumpDifference(myKeyVals, keyVals).keyVals) {
+    keys.emplace_back(kv.first);
+  }
+  return keys;
+}
+
+std::vector<std::string>
+KvStoreDb::getBetterKeysOfOriginators(
+    std::vector<std::string> const& originators,
+    std::unordered_map<std::string, thrift::Value> const& keyVals) const {
+  const std::unordered_set<std::string> syncOriginators(
+      originators.begin(), originators.end());
+
+  std::unordered_map<std::string, thrift::Value> myKeyVals;
+  for (auto const& kv : kvStore_) {
+    if (syncOriginators.count(kvStore_.getOriginatorId(kv.second))) {
+      myKeyVals.emplace(kv.first, kvStore_.toThriftValue(kv.second));
+    }
+  }
+
+  std::vector<std::string> keys;
+  for (auto const& kv : dumpDifference(myKeyVals, keyVals).keyVals) {
+    keys.emplace_back(kv.first);
+  }
+  return keys;
+}
+
 std::unordered_set<std::string>
 KvStoreDb::getFloodPeers(const std::optional<std::string>& rootId) {
   auto sptPeers = DualNode::getSptPeers(rootId);
@@ -2034,6 +3336,21 @@ KvStoreDb::getFloodPeers(const std::optional<std::string>& rootId) {
       floodPeers.emplace(peer);
     }
   }
+  if (floodToAll) {
+    return floodPeers;
+  }
+
+  // old spt-parents held till the new ones are synced
+  for (const auto& kv : pendingSptParentSyncs_) {
+    if (floodPeers.count(kv.first) == 0) {
+      continue;
+    }
+    for (const auto& heldPeer : kv.second.heldParents) {
+      if (peers_.count(heldPeer)) {
+        floodPeers.emplace(heldPeer);
+      }
+    }
+  }
   return floodPeers;
 }
 
@@ -2046,11 +3363,86 @@ KvStoreDb::collectSendFailureStats(
       fb303::COUNT);
 }
 
+bool
+KvStoreDb::isPriorityFloodKey(std::string const& key) const {
+  for (auto const& marker : kvParams_.priorityFloodKeyMarkers) {
+    if (key.compare(0, marker.size(), marker) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::optional<thrift::Publication>
+KvStoreDb::takePriorityKeys(thrift::Publication& publication) const {
+  std::optional<thrift::Publication> priorityPub;
+  auto getPriorityPub = [&]() -> thrift::Publication& {
+    if (not priorityPub.has_value()) {
+      priorityPub = thrift::Publication{};
+      priorityPub->nodeIds.copy_from(publication.nodeIds);
+      priorityPub->floodRootId.copy_from(publication.floodRootId);
+      priorityPub->area.copy_from(publication.area);
+    }
+    return *priorityPub;
+  };
+  for (auto it = publication.keyVals.begin();
+       it != publication.keyVals.end();) {
+    if (isPriorityFloodKey(it->first)) {
+      getPriorityPub().keyVals.emplace(it->first, std::move(it->second));
+      it = publication.keyVals.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  auto& expiredKeys = publication.expiredKeys;
+  auto firstPriority = std::stable_partition(
+      expiredKeys.begin(), expiredKeys.end(), [this](auto const& key) {
+        return not isPriorityFloodKey(key);
+      });
+  if (firstPriority != expiredKeys.end()) {
+    getPriorityPub().expiredKeys.assign(
+        std::make_move_iterator(firstPriority),
+        std::make_move_iterator(expiredKeys.end()));
+    expiredKeys.erase(firstPriority, expiredKeys.end());
+  }
+  return priorityPub;
+}
+
 void
 KvStoreDb::floodPublication(
     thrift::Publication&& publication, bool rateLimit, bool setFloodRoot) {
+  // keys of priority classes, e.g. adjacencies, don't wait behind batched
+  // or rate limited ones
+  if (rateLimit and (floodBatchTimer_ or floodLimiter_) and
+      not kvParams_.priorityFloodKeyMarkers.empty()) {
+    if (auto priorityPub = takePriorityKeys(publication)) {
+      fb303::fbData->addStatValue(
+          "kvstore.priority_flooded_keys",
+          priorityPub->keyVals.size() + priorityPub->expiredKeys.size(),
+          fb303::SUM);
+      doFloodPublication(std::move(*priorityPub), setFloodRoot);
+      if (publication.keyVals.empty() and publication.expiredKeys.empty()) {
+        return;
+      }
+    }
+  }
+  // hold for batching if configured. Flooded once the batch is big enough
+  // or was held long enough
+  if (floodBatchTimer_ && rateLimit) {
+    bufferPublication(std::move(publication));
+    if (publicationBufferBytes_ >= kvParams_.floodBatchBytes) {
+      return floodBatchedUpdates();
+    }
+    if (not floodBatchTimer_->isScheduled()) {
+      floodBatchTimer_->scheduleTimeout(kvParams_.floodBatchDelay);
+    }
+    return;
+  }
   // rate limit if configured
   if (floodLimiter_ && rateLimit && !floodLimiter_->consume(1)) {
+    fb303::fbData->addStatValue("kvstore.rate_limit_suppress", 1, fb303::COUNT);
+    fb303::fbData->addStatValue(
+        "kvstore.rate_limit_keys", publication.keyVals.size(), fb303::AVG);
     bufferPublication(std::move(publication));
     pendingPublicationTimer_->scheduleTimeout(
         Constants::kFloodPendingPublication);
@@ -2061,6 +3453,12 @@ KvStoreDb::floodPublication(
     bufferPublication(std::move(publication));
     return floodBufferedUpdates();
   }
+  doFloodPublication(std::move(publication), setFloodRoot);
+}
+
+void
+KvStoreDb::doFloodPublication(
+    thrift::Publication&& publication, bool setFloodRoot) {
   // Update ttl on keys we are trying to advertise. Also remove keys which
   // are about to expire.
   updatePublicationTtl(publication, true);
@@ -2081,39 +3479,74 @@ KvStoreDb::floodPublication(
   }
   publication.nodeIds->emplace_back(kvParams_.nodeId);
 
-  // Flood publication on local PUB queue
-  kvParams_.kvStoreUpdatesQueue.push(publication);
-
   //
   // Create request and send only keyValue updates to all neighbors
   //
   if (publication.keyVals.empty()) {
+    // Flood publication on local PUB queue
+    kvParams_.kvStoreUpdatesQueue.push(
+        std::make_shared<const thrift::Publication>(std::move(publication)));
     return;
   }
 
-  if (setFloodRoot and not senderId.has_value()) {
-    // I'm the initiator, set flood-root-id
-    fromStdOptional(publication.floodRootId, DualNode::getSptRootId());
-  }
-
+  // subscribers get the publication itself, the request holds the one copy
+  // of values sent to peers
   thrift::KvStoreRequest floodRequest;
-  thrift::KeySetParams params;
+  floodRequest.cmd = thrift::Command::KEY_SET;
+  floodRequest.keySetParams = thrift::KeySetParams{};
+  floodRequest.area = area_;
+  auto& params = floodRequest.keySetParams.value();
 
-  params.keyVals = publication.keyVals;
+  if (kvParams_.enableCompactTtlUpdates) {
+    setFloodKeyVals(publication.keyVals, params);
+  } else {
+    params.keyVals = publication.keyVals;
+  }
   params.solicitResponse = false;
   params.nodeIds.copy_from(publication.nodeIds);
-  params.floodRootId.copy_from(publication.floodRootId);
+  if (setFloodRoot and not senderId.has_value()) {
+    // I'm the initiator, set flood-root-id
+    fromStdOptional(params.floodRootId, DualNode::getSptRootId());
+  } else {
+    params.floodRootId.copy_from(publication.floodRootId);
+  }
   params.timestamp_ms = getUnixTimeStampMs();
 
-  floodRequest.cmd = thrift::Command::KEY_SET;
-  floodRequest.keySetParams = params;
-  floodRequest.area = area_;
+  const size_t numKeyVals = publication.keyVals.size();
+
+  // Flood publication on local PUB queue
+  kvParams_.kvStoreUpdatesQueue.push(
+      std::make_shared<const thrift::Publication>(std::move(publication)));
 
   std::optional<std::string> floodRootId{std::nullopt};
   if (params.floodRootId.has_value()) {
     floodRootId = params.floodRootId.value();
   }
+
+  // serialize once for all peers
+  const auto floodMsg =
+      fbzmq::Message::fromThriftObj(floodRequest, serializer_).value();
+
   const auto& floodPeers = getFloodPeers(floodRootId);
+
+  // serialize once with compressed values for peers which can decompress
+  // them, if compressing makes any difference
+  std::optional<thrift::KvStoreRequest> compressedRequest;
+  std::optional<fbzmq::Message> compressedFloodMsg;
+  if (std::any_of(
+          floodPeers.begin(), floodPeers.end(), [this](auto const& peer) {
+            return compressionPeers_.count(peers_.at(peer).second) != 0;
+          })) {
+    compressedRequest = floodRequest;
+    if (compressKeyVals(compressedRequest->keySetParams->keyVals)) {
+      compressedFloodMsg =
+          fbzmq::Message::fromThriftObj(*compressedRequest, serializer_)
+              .value();
+    } else {
+      compressedRequest.reset();
+    }
+  }
+
   for (const auto& peer : floodPeers) {
     if (senderId.has_value() && senderId.value() == peer) {
       // Do not flood towards senderId from whom we received this publication
@@ -2125,24 +3558,294 @@ KvStoreDb::floodPublication(
 
     fb303::fbData->addStatValue("kvstore.sent_publications", 1, fb303::COUNT);
     fb303::fbData->addStatValue(
-        "kvstore.sent_key_vals", publication.keyVals.size(), fb303::SUM);
+        "kvstore.sent_key_vals", numKeyVals, fb303::SUM);
 
     // Send flood request
     auto const& peerCmdSocketId = peers_.at(peer).second;
-    auto const ret = sendMessageToPeer(peerCmdSocketId, floodRequest);
+    const bool compressed = compressedRequest.has_value() and
+        compressionPeers_.count(peerCmdSocketId);
+    auto thriftPeerIt = thriftPeers_.find(peerCmdSocketId);
+    if (thriftPeerIt != thriftPeers_.end()) {
+      thriftPeerIt->second->sendKeySet(
+          compressed ? compressedRequest->keySetParams.value() : params);
+      continue;
+    }
+    // keys queued earlier must not get overtaken by older values
+    if (peerSendQueues_.count(peerCmdSocketId)) {
+      queueKeysToPeer(peer, peerCmdSocketId, params);
+      continue;
+    }
+    auto const& msg = compressed ? compressedFloodMsg.value() : floodMsg;
+    auto const ret = sendMessageToPeer(peerCmdSocketId, msg);
     if (ret.hasError()) {
       // this could be pretty common on initial connection setup
       LOG(ERROR) << "Failed to flood publication to peer " << peer
                  << " using id " << peerCmdSocketId
                  << ", error: " << ret.error();
       collectSendFailureStats(ret.error(), peerCmdSocketId);
+      if (ret.error().errNum == EAGAIN) {
+        // socket of peer is full, send it the keys once it drains
+        queueKeysToPeer(peer, peerCmdSocketId, params);
+      }
+    }
+  }
+}
+
+void
+KvStoreDb::queueKeysToPeer(
+    std::string const& peerName,
+    std::string const& peerCmdSocketId,
+    thrift::KeySetParams const& params) {
+  auto [it, inserted] = peerSendQueues_.try_emplace(peerCmdSocketId, peerName);
+  auto& queue = it->second;
+  if (inserted) {
+    // the send just failed
+    queue.backoff.reportError();
+  }
+
+  size_t numQueuedKeys{0};
+  auto queueKey = [&](std::string const& key) {
+    if (not queue.keys.emplace(key).second) {
+      return;
+    }
+    ++numQueuedKeys;
+    queue.bytes += key.size();
+    if (auto const* value = kvStore_.find(key)) {
+      queue.bytes += value->getValue().size();
+    }
+  };
+  for (auto const& kv : params.keyVals) {
+    queueKey(kv.first);
+  }
+  if (params.ttlUpdates.has_value()) {
+    for (auto const& kv : params.ttlUpdates.value()) {
+      queueKey(kv.first);
+    }
+  }
+  fb303::fbData->addStatValue(
+      "kvstore.peer_send_queue.queued_keys", numQueuedKeys, fb303::SUM);
+
+  if (queue.bytes > kvParams_.peerSendQueueBytes) {
+    LOG(WARNING) << "Send queue of peer " << peerName << " exceeds "
+                 << kvParams_.peerSendQueueBytes
+                 << " bytes, full-syncing with it instead";
+    fb303::fbData->addStatValue(
+        "kvstore.peer_send_queue.overflows", 1, fb303::COUNT);
+    peerSendQueues_.erase(it);
+    peersToSyncWith_.emplace(
+        peerName,
+        ExponentialBackoff<std::chrono::milliseconds>(
+            Constants::kInitialBackoff, Constants::kMaxBackoff));
+    fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+    return;
+  }
+
+  if (not peerSendQueueTimer_->isScheduled()) {
+    peerSendQueueTimer_->scheduleTimeout(
+        queue.backoff.getTimeRemainingUntilRetry());
+  }
+}
+
+void
+KvStoreDb::drainPeerSendQueues() {
+  // minimal timeout for next run
+  auto timeout = Constants::kPeerSendQueueMaxBackoff;
+
+  for (auto it = peerSendQueues_.begin(); it != peerSendQueues_.end();) {
+    auto const& peerCmdSocketId = it->first;
+    auto& queue = it->second;
+    if (not queue.backoff.canTryNow()) {
+      timeout = std::min(timeout, queue.backoff.getTimeRemainingUntilRetry());
+      ++it;
+      continue;
+    }
+
+    // send key sets of up to kvParams_.floodBatchBytes of key-values until
+    // the socket is full again
+    bool drained{true};
+    bool resync{false};
+    bool sent{false};
+    while (not queue.keys.empty()) {
+      thrift::Publication updates;
+      std::vector<std::string> keys;
+      size_t updateBytes{0};
+      for (auto const& key : queue.keys) {
+        // every key set takes at least one key, or the queue never drains
+        if (not keys.empty() and updateBytes >= kvParams_.floodBatchBytes) {
+          break;
+        }
+        keys.emplace_back(key);
+        updateBytes += key.size();
+        if (auto const* value = kvStore_.find(key)) {
+          updateBytes += value->getValue().size();
+          updates.keyVals.emplace(key, kvStore_.toThriftValue(*value));
+        }
+      }
+
+      // keys that expired meanwhile expire on the peer as well
+      updatePublicationTtl(updates, true);
+      if (not updates.keyVals.empty()) {
+        thrift::KvStoreRequest updateRequest;
+        thrift::KeySetParams params;
+        params.keyVals = std::move(updates.keyVals);
+        if (compressionPeers_.count(peerCmdSocketId)) {
+          compressKeyVals(params.keyVals);
+        }
+        params.solicitResponse = false;
+        params.nodeIds = std::vector<std::string>{kvParams_.nodeId};
+        // I'm the initiator, set flood-root-id
+        fromStdOptional(params.floodRootId, DualNode::getSptRootId());
+        params.timestamp_ms = getUnixTimeStampMs();
+
+        updateRequest.cmd = thrift::Command::KEY_SET;
+        updateRequest.keySetParams = std::move(params);
+        updateRequest.area = area_;
+
+        auto const ret = sendMessageToPeer(peerCmdSocketId, updateRequest);
+        if (ret.hasError()) {
+          collectSendFailureStats(ret.error(), peerCmdSocketId);
+          if (ret.error().errNum == EAGAIN) {
+            // back off less while the peer keeps taking some
+            if (sent) {
+              queue.backoff.reportSuccess();
+            }
+            queue.backoff.reportError();
+          } else {
+            LOG(ERROR) << "Failed to send queued keys to peer "
+                       << queue.peerName << ", error: " << ret.error();
+            resync = true;
+          }
+          drained = false;
+          break;
+        }
+        sent = true;
+        fb303::fbData->addStatValue(
+            "kvstore.peer_send_queue.sent_keys", keys.size(), fb303::SUM);
+      }
+
+      for (auto const& key : keys) {
+        queue.keys.erase(key);
+      }
+      queue.bytes -= std::min(queue.bytes, updateBytes);
+    }
+
+    if (resync) {
+      // peer is unreachable, it gets the keys with the next full-sync
+      if (peers_.count(queue.peerName)) {
+        peersToSyncWith_.emplace(
+            queue.peerName,
+            ExponentialBackoff<std::chrono::milliseconds>(
+                Constants::kInitialBackoff, Constants::kMaxBackoff));
+        fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+      }
+      it = peerSendQueues_.erase(it);
+      continue;
+    }
+    if (drained) {
+      it = peerSendQueues_.erase(it);
+      continue;
+    }
+    timeout = std::min(timeout, queue.backoff.getTimeRemainingUntilRetry());
+    ++it;
+  }
+
+  if (not peerSendQueues_.empty()) {
+    peerSendQueueTimer_->scheduleTimeout(
+        std::max(timeout, std::chrono::milliseconds(0)));
+  }
+}
+
+bool
+KvStoreDb::useThriftTransport(thrift::PeerSpec const& peerSpec) const {
+  const auto transport = peerSpec.transport.has_value()
+      ? peerSpec.transport.value()
+      : kvParams_.peerTransport;
+  return transport == thrift::PeerTransport::THRIFT and
+      not peerSpec.ctrlAddr.empty() and peerSpec.ctrlPort > 0;
+}
+
+size_t
+KvStoreDb::compressKeyVals(
+    std::unordered_map<std::string, thrift::Value>& keyVals) const {
+  const auto bytesSaved = compressValues(
+      keyVals, kvParams_.valueCompression, kvParams_.valueCompressionMinBytes);
+  if (bytesSaved) {
+    fb303::fbData->addStatValue(
+        "kvstore.compressed_bytes_saved", bytesSaved, fb303::SUM);
+  }
+  return bytesSaved;
+}
+
+void
+KvStoreDb::decompressKeyVals(
+    std::unordered_map<std::string, thrift::Value>& keyVals) const {
+  const auto numFailures = decompressValues(keyVals);
+  if (numFailures) {
+    fb303::fbData->addStatValue(
+        "kvstore.decompression_failures", numFailures, fb303::COUNT);
+  }
+}
+
+size_t
+KvStoreDb::dropRecentKeyVals(thrift::KeySetParams& params) {
+  if (params.keyVals.empty()) {
+    return 0;
+  }
+
+  size_t numDropped = 0;
+  for (auto it = params.keyVals.begin(); it != params.keyVals.end();) {
+    if (recentKeyVals_.exists(getKeyValDigest(it->first, it->second))) {
+      it = params.keyVals.erase(it);
+      ++numDropped;
+    } else {
+      ++it;
+    }
+  }
+  if (not numDropped) {
+    return 0;
+  }
+
+  fb303::fbData->addStatValue(
+      "kvstore.dropped_recent_key_vals", numDropped, fb303::SUM);
+  // nothing left to merge, same as a publication which updates nothing
+  if (params.keyVals.empty() and
+      (not params.ttlUpdates.has_value() or params.ttlUpdates->empty())) {
+    fb303::fbData->addStatValue(
+        "kvstore.received_redundant_publications", 1, fb303::COUNT);
+  }
+  return numDropped;
+}
+
+void
+KvStoreDb::setFloodKeyVals(
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    thrift::KeySetParams& params) const {
+  std::unordered_map<std::string, thrift::TtlUpdate> ttlUpdates;
+  for (auto const& kv : keyVals) {
+    // TTL refreshes of what we store go by the hash of the stored value
+    auto const& value = kv.second;
+    auto const* myValue = kvStore_.find(kv.first);
+    if (value.value.has_value() or not myValue or
+        myValue->version != value.version or
+        kvStore_.getOriginatorId(*myValue) != value.originatorId) {
+      params.keyVals.emplace(kv);
+      continue;
     }
+    thrift::TtlUpdate ttlUpdate;
+    ttlUpdate.version = value.version;
+    ttlUpdate.ttlVersion = value.ttlVersion;
+    ttlUpdate.ttl = value.ttl;
+    ttlUpdate.hash = myValue->hash;
+    ttlUpdates.emplace(kv.first, std::move(ttlUpdate));
+  }
+  if (not ttlUpdates.empty()) {
+    params.ttlUpdates = std::move(ttlUpdates);
   }
 }
 
 size_t
 KvStoreDb::mergePublication(
-    const thrift::Publication& rcvdPublication,
+    thrift::Publication&& rcvdPublication,
     std::optional<std::string> senderId) {
   // Add counters
   fb303::fbData->addStatValue("kvstore.received_publications", 1, fb303::COUNT);
@@ -2152,9 +3855,12 @@ KvStoreDb::mergePublication(
   const bool needFinalizeFullSync = senderId.has_value() and
       rcvdPublication.tobeUpdatedKeys.has_value() and
       not rcvdPublication.tobeUpdatedKeys->empty();
+  const bool hasTtlUpdates = rcvdPublication.ttlUpdates.has_value() and
+      not rcvdPublication.ttlUpdates->empty();
 
   // This can happen when KvStore is emitting expired-key updates
-  if (rcvdPublication.keyVals.empty() and not needFinalizeFullSync) {
+  if (rcvdPublication.keyVals.empty() and not hasTtlUpdates and
+      not needFinalizeFullSync) {
     return 0;
   }
 
@@ -2167,16 +3873,38 @@ KvStoreDb::mergePublication(
     return 0;
   }
 
-  // Generate delta with local KvStore
+  // Generate delta with local KvStore. Full-sync responses (with senderId)
+  // bring all keys of the peer at once, they are not rate limited
   thrift::Publication deltaPublication;
   deltaPublication.keyVals = KvStore::mergeKeyValues(
-      kvStore_, rcvdPublication.keyVals, kvParams_.filters);
+      kvStore_,
+      std::move(rcvdPublication.keyVals),
+      kvParams_.filters,
+      admission_.get(),
+      not senderId.has_value());
+  if (hasTtlUpdates) {
+    fb303::fbData->addStatValue(
+        "kvstore.received_ttl_updates",
+        rcvdPublication.ttlUpdates->size(),
+        fb303::SUM);
+    auto ttlKvUpdates = KvStore::mergeTtlUpdates(
+        kvStore_, *rcvdPublication.ttlUpdates, kvParams_.filters);
+    for (auto& kv : ttlKvUpdates) {
+      deltaPublication.keyVals.emplace(kv.first, std::move(kv.second));
+    }
+  }
   deltaPublication.floodRootId.copy_from(rcvdPublication.floodRootId);
   deltaPublication.area = area_;
 
   const size_t kvUpdateCnt = deltaPublication.keyVals.size();
   fb303::fbData->addStatValue(
       "kvstore.updated_key_vals", kvUpdateCnt, fb303::SUM);
+  if (kvUpdateCnt) {
+    ++generation_;
+  }
+  for (auto const& kv : deltaPublication.keyVals) {
+    recentKeyVals_.set(getKeyValDigest(kv.first, kv.second), true);
+  }
 
   // Populate nodeIds and our nodeId_ to the end
   if (rcvdPublication.nodeIds.has_value()) {
@@ -2184,7 +3912,7 @@ KvStoreDb::mergePublication(
   }
 
   // Update ttl values of keys
-  updateTtlCountdownQueue(deltaPublication);
+  updateTtlCountdown(deltaPublication);
 
   if (not deltaPublication.keyVals.empty()) {
     // Flood change to all of our neighbors/subscribers
@@ -2217,7 +3945,7 @@ KvStoreDb::logSyncEvent(
   fbzmq::thrift::EventLog eventLog;
   eventLog.category = Constants::kEventLogCategory.toString();
   eventLog.samples = {sample.toJson()};
-  kvParams_.zmqMonitorClient->addEventLog(std::move(eventLog));
+  zmqMonitorClient_->addEventLog(std::move(eventLog));
 }
 
 void
@@ -2231,7 +3959,7 @@ KvStoreDb::logKvEvent(const std::string& event, const std::string& key) {
   fbzmq::thrift::EventLog eventLog;
   eventLog.category = Constants::kEventLogCategory.toString();
   eventLog.samples = {sample.toJson()};
-  kvParams_.zmqMonitorClient->addEventLog(std::move(eventLog));
+  zmqMonitorClient_->addEventLog(std::move(eventLog));
 }
 
 bool
@@ -8,16 +8,20 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
-#include <boost/heap/priority_queue.hpp>
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Optional.h>
 #include <folly/TokenBucket.h>
+#include <folly/container/EvictingCacheMap.h>
 #include <folly/futures/Future.h>
 #include <folly/io/IOBuf.h>
 #include <folly/io/async/AsyncTimeout.h>
@@ -32,27 +36,38 @@
 #include <openr/if/gen-cpp2/Dual_types.h>
 #include <openr/if/gen-cpp2/KvStore_constants.h>
 #include <openr/if/gen-cpp2/KvStore_types.h>
+#include <openr/kvstore/KvStoreAdmission.h>
+#include <openr/kvstore/KvStoreMap.h>
+#include <openr/kvstore/KvStoreThriftPeer.h>
+#include <openr/kvstore/TtlCountdownWheel.h>
 #include <openr/messaging/ReplicateQueue.h>
 
 namespace openr {
 
-struct TtlCountdownQueueEntry {
-  std::chrono::steady_clock::time_point expiryTime;
-  std::string key;
-  int64_t version{0};
-  int64_t ttlVersion{0};
-  std::string originatorId;
-  bool
-  operator>(TtlCountdownQueueEntry other) const {
-    return expiryTime > other.expiryTime;
-  }
-};
+// Publication as sent to local subscribers of KvStore updates. It is shared
+// read-only between all readers of the updates queue rather than copied for
+// each of them.
+using KvStorePublication = std::shared_ptr<const thrift::Publication>;
 
-using TtlCountdownQueue = boost::heap::priority_queue<
-    TtlCountdownQueueEntry,
-    // Always returns smallest first
-    boost::heap::compare<std::greater<TtlCountdownQueueEntry>>,
-    boost::heap::stable<true>>;
+/**
+ * Immutable view of a filtered dump of an area. Values are shared with the
+ * store rather than copied, the thrift publication gets materialized from
+ * the view by toPublication(), off the KvStore event base.
+ */
+struct KvStoreView {
+  struct Entry {
+    std::string key;
+    std::string originatorId;
+    // ttl as of the dump, originator ID of value is not valid out of store
+    KvStoreValue value;
+  };
+
+  thrift::Publication toPublication() const;
+
+  std::string area;
+  std::optional<std::string> floodRootId;
+  std::vector<Entry> entries;
+};
 
 // Kvstore flooding rate <messages/sec, burst size>
 using KvStoreFloodRate = std::optional<std::pair<const size_t, const size_t>>;
@@ -67,6 +82,7 @@ class KvStoreFilters {
 
   // Check if key matches the filters
   bool keyMatch(std::string const& key, thrift::Value const& value) const;
+  bool keyMatch(std::string const& key, std::string const& originatorId) const;
 
   // return comma separeated string prefix
   std::vector<std::string> getKeyPrefixes() const;
@@ -74,6 +90,11 @@ class KvStoreFilters {
   // return set of origninator IDs
   std::set<std::string> getOrigniatorIdList() const;
 
+  // key prefixes if the filters match exactly the keys starting with one of
+  // them, i.e. there are no originator IDs and none of the prefixes is a
+  // regular expression. Such filters can use the key index of KvStoreMap
+  std::optional<std::vector<std::string>> getLiteralKeyPrefixes() const;
+
   // print filters
   std::string str() const;
 
@@ -86,15 +107,62 @@ class KvStoreFilters {
 
   // keyPrefix class to create RE2 set and to match keys
   KeyPrefix keyPrefixObjList_;
+
+  // no prefix uses regular expression syntax
+  bool literalKeyPrefixes_{false};
+};
+
+// optional features and tunables of KvStore, set by name on top of the
+// defaults, e.g. options.enableBucketSync = true
+struct KvStoreOptions {
+  // full-sync by bucket hashes instead of hashes of all keys
+  bool enableBucketSync{false};
+  // full-sync by hashes of the keys of every originator, taking precedence
+  // over bucket sync. A peer which missed a few updates gets sent the keys
+  // of their originators only
+  bool enableOriginatorSync{false};
+  // keys expiring within ttlExpirySlack of the earliest expiry are expired
+  // together with it, up to ttlExpirySlack late, and published at once.
+  // Disabled with 0
+  std::chrono::milliseconds ttlExpirySlack{0};
+  // hold flooded updates for up to floodBatchDelay, or until they add up to
+  // floodBatchBytes, and flood them together. Disabled with 0 delay
+  std::chrono::milliseconds floodBatchDelay{0};
+  size_t floodBatchBytes{Constants::kFloodBatchMaxBytes};
+  // keys flooded to peers over ZMQ transport whose socket is full are queued
+  // and sent later with their values current by then. The peer gets
+  // full-synced instead once their values exceed peerSendQueueBytes
+  size_t peerSendQueueBytes{Constants::kPeerSendQueueMaxBytes};
+  // flood TTL refreshes as compact thrift::TtlUpdate
+  bool enableCompactTtlUpdates{false};
+  // compress values of at least valueCompressionMinBytes sent to peers which
+  // can decompress them. Disabled with NONE
+  thrift::CompressionType valueCompression{thrift::CompressionType::NONE};
+  size_t valueCompressionMinBytes{Constants::kValueCompressionMinBytes};
+  // transport for peers whose PeerSpec doesn't pick one
+  thrift::PeerTransport peerTransport{thrift::PeerTransport::ZMQ};
+  // hashes generated at ingress and ordering of values of same version and
+  // originator
+  thrift::HashVersion hashVersion{thrift::HashVersion::V1};
+  // run each area on an event base and thread of its own
+  bool enableAreaThreads{false};
+  // directory to save snapshots of areas to and restore them from on start.
+  // Disabled if empty
+  std::string snapshotDir;
+  // keys starting with any of these markers, e.g. Constants::kAdjDbMarker,
+  // are flooded right away, bypassing flood batching and the rate limiter
+  std::vector<std::string> priorityFloodKeyMarkers;
+  // budgets of keys, bytes and updates enforced in each area
+  KvStoreBudgets budgets;
 };
 
 // structure for common params across all instances of KvStoreDb
-struct KvStoreParams {
+struct KvStoreParams : public KvStoreOptions {
   // the name of this node (unique in domain)
   std::string nodeId;
 
   // Queue for publishing KvStore updates to other modules within a process
-  messaging::ReplicateQueue<thrift::Publication>& kvStoreUpdatesQueue;
+  messaging::ReplicateQueue<KvStorePublication>& kvStoreUpdatesQueue;
 
   // socket for remote & local commands
   fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER> globalCmdSock;
@@ -114,11 +182,12 @@ struct KvStoreParams {
   bool enableFloodOptimization{false};
   bool isFloodRoot{false};
   bool useFloodOptimization{false};
-  std::shared_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient{nullptr};
+  // values shared by stores of all areas, set if there are several areas
+  std::shared_ptr<KvStoreValuePool> valuePool;
 
   KvStoreParams(
       std::string nodeid,
-      messaging::ReplicateQueue<thrift::Publication>& kvStoreUpdatesQueue,
+      messaging::ReplicateQueue<KvStorePublication>& kvStoreUpdatesQueue,
       fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER> globalCmdSock,
       // ZMQ high water mark
       int zmqhwm,
@@ -133,8 +202,10 @@ struct KvStoreParams {
       std::chrono::milliseconds ttldecr,
       bool enablefloodOptimization,
       bool isfloodRoot,
-      bool usefloodOptimization)
-      : nodeId(nodeid),
+      bool usefloodOptimization,
+      KvStoreOptions options)
+      : KvStoreOptions(std::move(options)),
+        nodeId(nodeid),
         kvStoreUpdatesQueue(kvStoreUpdatesQueue),
         globalCmdSock(std::move(globalCmdSock)),
         zmqHwm(zmqhwm),
@@ -162,7 +233,12 @@ class KvStoreDb : public DualNode {
       fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_CLIENT> peersyncSock,
       bool isFloodRoot,
       const std::string& nodeId,
-      std::unordered_map<std::string, thrift::PeerSpec> peers);
+      std::unordered_map<std::string, thrift::PeerSpec> peers,
+      std::shared_ptr<KvStoreThriftClients> thriftClients,
+      std::shared_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient);
+
+  // saves a last snapshot if enabled
+  ~KvStoreDb() override;
 
   folly::Expected<fbzmq::Message, fbzmq::Error> processRequestMsgHelper(
       thrift::KvStoreRequest& thriftReq);
@@ -177,6 +253,16 @@ class KvStoreDb : public DualNode {
   // if prefix is the empty sting, the full KV store is dumped
   thrift::Publication dumpAllWithFilters(KvStoreFilters const& kvFilters) const;
 
+  // same as dumpAllWithFilters(), ttls updated, as a view sharing values
+  KvStoreView dumpViewWithFilters(KvStoreFilters const& kvFilters) const;
+
+  // dump a page of at most maxKeys entries matching the filters, in key order
+  // and after startAfterKey. thriftPub.lastKey is set if more entries follow
+  thrift::Publication dumpPageWithFilters(
+      KvStoreFilters const& kvFilters,
+      std::string const& startAfterKey,
+      size_t maxKeys) const;
+
   // dump the hashes of my KV store whose keys match the given prefix
   // if prefix is the empty sting, the full hash store is dumped
   thrift::Publication dumpHashWithFilters(
@@ -187,19 +273,58 @@ class KvStoreDb : public DualNode {
       std::unordered_map<std::string, thrift::Value> const& myKeyVal,
       std::unordered_map<std::string, thrift::Value> const& reqKeyVal) const;
 
+  // dump the entries of my KV store in all buckets whose hash differs from
+  // given bucket hashes. thriftPub.syncBuckets lists these buckets
+  thrift::Publication dumpBucketDifference(
+      KvStoreFilters const& kvFilters,
+      std::vector<int64_t> const& reqBucketHashes) const;
+
+  // dump the entries of my KV store of all originators whose hash differs
+  // from given originator hashes, or which the requester has no keys of.
+  // thriftPub.syncOriginators lists these originators
+  thrift::Publication dumpOriginatorDifference(
+      KvStoreFilters const& kvFilters,
+      std::map<std::string, int64_t> const& reqOriginatorHashes) const;
+
   // Merge received publication with local store and publish out the delta.
   // If senderId is set, will build <key:value> map from kvStore_ and
   // rcvdPublication.tobeUpdatedKeys and send back to senderId to update it
+  // Values get moved out of rcvdPublication into the delta
   // @return: Number of KV updates applied
   size_t mergePublication(
-      thrift::Publication const& rcvdPublication,
+      thrift::Publication&& rcvdPublication,
       std::optional<std::string> senderId = std::nullopt);
 
   // update Time to expire filed in Publication
   // removeAboutToExpire: knob to remove keys which are about to expire
   // and hence do not want to include them. Constants::kTtlThreshold
   void updatePublicationTtl(
-      thrift::Publication& thriftPub, bool removeAboutToExpire = false);
+      thrift::Publication& thriftPub, bool removeAboutToExpire = false) const;
+
+  // time to expire of key as it is to be published, std::nullopt if it is to
+  // be left out. ttl is returned as is if key is not counting down
+  std::optional<int64_t> getPublicationTtl(
+      std::string const& key,
+      int64_t version,
+      std::string const& originatorId,
+      int64_t ttlVersion,
+      int64_t ttl,
+      std::chrono::steady_clock::time_point timeNow,
+      bool removeAboutToExpire) const;
+
+  // compress values for a peer which can decompress them
+  // @return: Number of bytes saved
+  size_t compressKeyVals(
+      std::unordered_map<std::string, thrift::Value>& keyVals) const;
+
+  // decompress values received from a peer, dropping the ones which fail to
+  void decompressKeyVals(
+      std::unordered_map<std::string, thrift::Value>& keyVals) const;
+
+  // drop key-values of a key set which were merged recently, before they get
+  // decompressed and hashed. Copies of a flood arrive from many peers
+  // @return: Number of key-values dropped
+  size_t dropRecentKeyVals(thrift::KeySetParams& params);
 
   // add new peers to sync with
   void addPeers(std::unordered_map<std::string, thrift::PeerSpec> const& peers);
@@ -225,6 +350,13 @@ class KvStoreDb : public DualNode {
   // Kv store parameters
   KvStoreParams& kvParams_;
 
+  // OpenrCtrl clients of peers using THRIFT transport, shared by all areas
+  // running in the same thread
+  const std::shared_ptr<KvStoreThriftClients> thriftClients_;
+
+  // client to interact with monitor, one per thread
+  const std::shared_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
+
   //
   // Private methods
   //
@@ -279,12 +411,45 @@ class KvStoreDb : public DualNode {
   // request full-sync (KEY_DUMP) with peersToSyncWith_
   void requestFullSyncFromPeers();
 
-  // add new query entries into ttlCountdownQueue from publication
-  // and Reschedule ttl expiry timer if needed
-  void updateTtlCountdownQueue(const thrift::Publication& publication);
+  // full-sync with peer sent at syncSentTime completed, or if none, it failed
+  // or peer went away. Stop flooding to the old spt-parents it replaced
+  void releaseSptParentSync(
+      std::string const& peerName,
+      std::optional<std::chrono::steady_clock::time_point> syncSentTime);
+
+  // duration of the last full-sync with peer, 0 if there was none yet
+  std::chrono::milliseconds getLastSyncDuration(
+      std::string const& peerName) const;
+
+  // (re)schedule ttl count down of keys in publication and reschedule ttl
+  // expiry timer if needed
+  void updateTtlCountdown(const thrift::Publication& publication);
+
+  // purge expired keys and reschedule ttl expiry timer for the next ones
+  void cleanupTtlCountdown();
+
+  // file in kvParams_.snapshotDir the area's snapshot is kept in
+  std::string getSnapshotPath() const;
 
-  // periodically count down and purge expired keys from CountdownQueue
-  void cleanupTtlCountdownQueue();
+  // merge key-values of the snapshot of the area and publish them, before
+  // syncing with peers. Full-sync then only exchanges what changed since
+  void loadSnapshot();
+
+  // write key-values of the area with their remaining TTLs to the snapshot
+  void saveSnapshot();
+
+  // call fn on every entry matching kvFilters. Looks up literal key prefixes
+  // in the key index instead of matching every key of the store
+  void forEachWithFilters(
+      KvStoreFilters const& kvFilters,
+      folly::FunctionRef<void(std::string const&, KvStoreValue const&)> fn)
+      const;
+
+  // fill keyVals of a flooded KEY_SET, TTL refreshes of stored values go into
+  // params.ttlUpdates
+  void setFloodKeyVals(
+      std::unordered_map<std::string, thrift::Value> const& keyVals,
+      thrift::KeySetParams& params) const;
 
   // Function to flood publication to neighbors
   // publication => data element to flood
@@ -295,15 +460,60 @@ class KvStoreDb : public DualNode {
       bool rateLimit = true,
       bool setFloodRoot = true);
 
+  // flood publication to neighbors and local subscribers as it is
+  void doFloodPublication(thrift::Publication&& publication, bool setFloodRoot);
+
+  bool isPriorityFloodKey(std::string const& key) const;
+
+  // move keys of priority flood classes out of publication into a
+  // publication of their own, if there are any
+  std::optional<thrift::Publication> takePriorityKeys(
+      thrift::Publication& publication) const;
+
   // perform last step as a 3-way full-sync request
   // full-sync initiator sends back key-val to senderId (where we made
   // full-sync request to) who need to update those keys
   void finalizeFullSync(
       const std::vector<std::string>& keys, const std::string& senderId);
 
+  // keys of given buckets which are better in my KV store than in keyVals
+  // or missing there, those the peer needs to update after a bucket sync
+  std::vector<std::string> getBetterKeysInBuckets(
+      std::vector<int32_t> const& buckets,
+      std::unordered_map<std::string, thrift::Value> const& keyVals) const;
+
+  // same as above for keys of given originators, after an originator sync
+  std::vector<std::string> getBetterKeysOfOriginators(
+      std::vector<std::string> const& originators,
+      std::unordered_map<std::string, thrift::Value> const& keyVals) const;
+
   // process received KV_DUMP from one of our neighbor
   void processSyncResponse() noexcept;
 
+  // process full-sync response, or failure, of a peer using THRIFT transport
+  void processThriftSyncResponse(
+      std::string const& peerCmdSocketId,
+      folly::Try<thrift::Publication>&& maybeSyncPub);
+
+  // merge full-sync response of peer with requestId (socket-id), whichever
+  // transport it came over
+  void processSyncPublication(
+      thrift::Publication& syncPub, std::string const& requestId);
+
+  // merge next slice of the oldest pending full-sync response, completing it
+  // once it's all merged
+  void mergeSyncSlice();
+
+  // account for a full-sync response of requestId merged in full
+  void completeSyncPublication(
+      std::string const& requestId,
+      size_t numKeyVals,
+      size_t numMissingKeys,
+      size_t kvUpdateCnt);
+
+  // whether to talk to a peer over THRIFT transport instead of ZMQ
+  bool useThriftTransport(thrift::PeerSpec const& peerSpec) const;
+
   // randomly request sync from one connected neighbor
   void requestSync();
 
@@ -318,16 +528,37 @@ class KvStoreDb : public DualNode {
   // Submit events to monitor
   void logKvEvent(const std::string& event, const std::string& key);
 
-  // buffer publications blocked by the rate limiter
+  // buffer publications blocked by the rate limiter or held for batching
   void bufferPublication(thrift::Publication&& publication);
 
-  // flood pending update blocked by rate limiter
+  // flood pending update blocked by rate limiter or held for batching.
+  // Publications are bounded to kvParams_.floodBatchBytes of key-values
   void floodBufferedUpdates(void);
 
+  // flood batched updates once the rate limiter allows
+  void floodBatchedUpdates();
+
+  // queue keys of a key set flooded to a peer whose socket is full, or which
+  // has keys queued already. The peer gets full-synced instead once the
+  // queue exceeds kvParams_.peerSendQueueBytes
+  void queueKeysToPeer(
+      std::string const& peerName,
+      std::string const& peerCmdSocketId,
+      thrift::KeySetParams const& params);
+
+  // send queued keys with their current values, as far as sockets of peers
+  // take them, and retry the rest with backoff
+  void drainPeerSendQueues();
+
   // Send message via socket
   folly::Expected<size_t, fbzmq::Error> sendMessageToPeer(
       const std::string& peerSocketId, const thrift::KvStoreRequest& request);
 
+  // Send serialized message via socket. The message data is shared, so the
+  // same message can be sent to many peers without copying it
+  folly::Expected<size_t, fbzmq::Error> sendMessageToPeer(
+      const std::string& peerSocketId, const fbzmq::Message& msg);
+
   //
   // Private variables
   //
@@ -355,28 +586,91 @@ class KvStoreDb : public DualNode {
   std::unordered_map<std::string, ExponentialBackoff<std::chrono::milliseconds>>
       peersToSyncWith_{};
 
+  // new spt-parents whose full-sync didn't complete yet, mapped to the old
+  // spt-parents they replaced. These still get flooded to until then, so that
+  // no update gets lost while moving to the new flooding tree. A failed
+  // full-sync ends it as well, rather than flooding to old parents for as
+  // long as retries take. Their syncs go ahead of other ones
+  struct PendingSptParentSync {
+    std::unordered_set<std::string> heldParents;
+    // only full-syncs sent after becoming parent count
+    std::chrono::steady_clock::time_point since;
+  };
+  std::unordered_map<std::string, PendingSptParentSync> pendingSptParentSyncs_;
+
   // Callback timer to get full KEY_DUMP from peersToSyncWith_
   std::unique_ptr<folly::AsyncTimeout> fullSyncTimer_;
 
+  // full-sync response merged in slices, keyVals holds what is left to merge
+  struct PendingSyncMerge {
+    thrift::Publication syncPub;
+    std::string requestId;
+    size_t numKeyVals{0};
+    size_t kvUpdateCnt{0};
+  };
+  std::deque<PendingSyncMerge> pendingSyncMerges_;
+
+  // merges next slice of pendingSyncMerges_ in a later event loop iteration
+  std::unique_ptr<folly::AsyncTimeout> syncMergeTimer_;
+
   // the serializer/deserializer helper we'll be using
   apache::thrift::CompactSerializer serializer_;
 
   // store keys mapped to (version, originatoId, value)
-  std::unordered_map<std::string, thrift::Value> kvStore_;
+  KvStoreMap kvStore_;
+
+  // admission of merged values, if any budget is set
+  std::unique_ptr<KvStoreAdmission> admission_;
+
+  // TTL count down of keys with finite TTL, one entry per key
+  TtlCountdownWheel ttlCountdownWheel_;
 
-  // TTL count down queue
-  TtlCountdownQueue ttlCountdownQueue_;
+  // bumped on every change of kvStore_, tells pages of a paged dump taken
+  // at different states apart
+  int64_t generation_{0};
+
+  // digests of (key, version, originatorId, ttlVersion, hash) of key-values
+  // merged recently, forgotten when they expire
+  folly::EvictingCacheMap<uint64_t, bool> recentKeyVals_{
+      Constants::kRecentKeyValsCacheSize};
 
   // TTL count down timer
   std::unique_ptr<folly::AsyncTimeout> ttlCountdownTimer_;
 
-  // Map of latest peer sync up request send to each peer
+  // timer for saving snapshots periodically, if enabled
+  std::unique_ptr<folly::AsyncTimeout> snapshotTimer_;
+
+  // time ttlCountdownTimer_ is scheduled for
+  std::chrono::steady_clock::time_point ttlCountdownTimerExpiry_;
+
+  // full-sync request sent to a peer and not responded to yet
+  struct PendingFullSync {
+    std::string peerName;
+    std::chrono::steady_clock::time_point sentTime;
+  };
+
+  // Map of latest peer sync up request send to each peer, by socket-id
   // this is used to measure full-dump sync time between this node and each of
-  // its peers
-  std::unordered_map<
-      std::string,
-      std::chrono::time_point<std::chrono::steady_clock>>
-      latestSentPeerSync_;
+  // its peers, and to bound the number of full-syncs in progress
+  std::unordered_map<std::string, PendingFullSync> latestSentPeerSync_;
+
+  // socket-ids of peers which can decompress values compressed with
+  // kvParams_.valueCompression, as advertised in their full-sync response
+  std::unordered_set<std::string> compressionPeers_;
+
+  // THRIFT transport of peers using it, by socket-id. Full-syncs and floods
+  // to these peers go over it instead of peerSyncSock_
+  std::unordered_map<std::string, std::unique_ptr<KvStoreThriftPeer>>
+      thriftPeers_;
+
+  // how long the last full-sync took, by peer name. Peers that respond
+  // quickly get synced with first
+  std::unordered_map<std::string, std::chrono::milliseconds>
+      peerSyncDurations_;
+
+  // set once the first full-sync response got merged. Until then only a
+  // single full-sync is in progress
+  bool initialSyncCompleted_{false};
 
   // Kvstore rate limiter
   std::unique_ptr<folly::BasicTokenBucket<>> floodLimiter_{nullptr};
@@ -384,6 +678,30 @@ class KvStoreDb : public DualNode {
   // timer to send pending kvstore publication
   std::unique_ptr<folly::AsyncTimeout> pendingPublicationTimer_{nullptr};
 
+  // timer to flood batched publications, if batching is enabled
+  std::unique_ptr<folly::AsyncTimeout> floodBatchTimer_{nullptr};
+
+  // keys flooded to a peer over ZMQ transport while its socket was full,
+  // waiting to be sent with the values current by then. Later updates of a
+  // key replace earlier ones instead of queuing behind them
+  struct PeerSendQueue {
+    explicit PeerSendQueue(std::string const& peerName) : peerName(peerName) {}
+
+    std::string peerName;
+    std::unordered_set<std::string> keys;
+    // estimated size of key-values of keys, as they were queued
+    size_t bytes{0};
+    ExponentialBackoff<std::chrono::milliseconds> backoff{
+        Constants::kPeerSendQueueInitialBackoff,
+        Constants::kPeerSendQueueMaxBackoff};
+  };
+
+  // send queues of peers, by socket-id
+  std::unordered_map<std::string, PeerSendQueue> peerSendQueues_;
+
+  // timer to drain peerSendQueues_
+  std::unique_ptr<folly::AsyncTimeout> peerSendQueueTimer_{nullptr};
+
   // timer for requesting full-sync
   std::unique_ptr<folly::AsyncTimeout> requestSyncTimer_{nullptr};
 
@@ -393,6 +711,13 @@ class KvStoreDb : public DualNode {
       unordered_map<std::optional<std::string>, std::unordered_set<std::string>>
           publicationBuffer_{};
 
+  // estimated size of key-values in publicationBuffer_, the same key may be
+  // accounted for more than once
+  size_t publicationBufferBytes_{0};
+
+  // number of keys in publicationBuffer_, by key class of kvStore_
+  std::vector<size_t> publicationBufferKeys_;
+
   // max parallel syncs allowed. It's initialized with '2' and doubles
   // up to a max value of kMaxFullSyncPendingCountThresholdfor each full sync
   // response received
@@ -417,7 +742,7 @@ class KvStore final : public OpenrEventBase {
       // the name of this node (unique in domain)
       std::string nodeId,
       // Queue for publishing kvstore updates
-      messaging::ReplicateQueue<thrift::Publication>& kvStoreUpdatesQueue,
+      messaging::ReplicateQueue<KvStorePublication>& kvStoreUpdatesQueue,
       // Queue for receiving peer updates
       messaging::RQueue<thrift::PeerUpdateRequest> peerUpdateQueue,
       // the url to receive command from peer instances
@@ -444,16 +769,51 @@ class KvStore final : public OpenrEventBase {
       bool isFloodRoot = false,
       bool useFloodOptimization = false,
       const std::unordered_set<std::string>& areas = {
-          openr::thrift::KvStore_constants::kDefaultArea()});
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      KvStoreOptions options = {});
+
+  // starts the threads of areas before running the KvStore event base
+  void run() override;
+
+  // stops and joins the threads of areas as well
+  void stop() override;
 
   // process the key-values publication, and attempt to
   // merge it in existing map (first argument)
   // Return a publication made out of the updated values
+  // Value updates have to pass admission, if any. Update rates are enforced
+  // only if rateLimited, full-sync responses are not rate limited
+  static std::unordered_map<std::string, thrift::Value> mergeKeyValues(
+      KvStoreMap& kvStore,
+      std::unordered_map<std::string, thrift::Value> const& update,
+      std::optional<KvStoreFilters> const& filters = std::nullopt,
+      KvStoreAdmission* admission = nullptr,
+      bool rateLimited = true);
+
+  // same as above, moving the announced values out of update instead of
+  // copying them
+  static std::unordered_map<std::string, thrift::Value> mergeKeyValues(
+      KvStoreMap& kvStore,
+      std::unordered_map<std::string, thrift::Value>&& update,
+      std::optional<KvStoreFilters> const& filters = std::nullopt,
+      KvStoreAdmission* admission = nullptr,
+      bool rateLimited = true);
+
+  // same as above for a store held as thrift map. Only the entries of keys
+  // in update get converted, so a merge costs the size of the update
   static std::unordered_map<std::string, thrift::Value> mergeKeyValues(
       std::unordered_map<std::string, thrift::Value>& kvStore,
       std::unordered_map<std::string, thrift::Value> const& update,
       std::optional<KvStoreFilters> const& filters = std::nullopt);
 
+  // apply compact TTL refreshes to matching entries of kvStore. Never looks
+  // at values, a refresh only applies to the entry of same version and hash
+  // Return the applied refreshes as key-values without value
+  static std::unordered_map<std::string, thrift::Value> mergeTtlUpdates(
+      KvStoreMap& kvStore,
+      std::unordered_map<std::string, thrift::TtlUpdate> const& ttlUpdates,
+      std::optional<KvStoreFilters> const& filters = std::nullopt);
+
   // compare two thrift::Values to figure out which value is better to
   // use, it will compare following attributes in order
   // <version>, <orginatorId>, <value>, <ttl-version>
@@ -462,7 +822,11 @@ class KvStore final : public OpenrEventBase {
   //        0 if equal,
   //       -2 if unknown
   // unknown can happen if value is missing (only hash is provided)
-  static int compareValues(const thrift::Value& v1, const thrift::Value& v2);
+  // With HashVersion::V2 values get compared by size and hash before bytes
+  static int compareValues(
+      const thrift::Value& v1,
+      const thrift::Value& v2,
+      thrift::HashVersion hashVersion = thrift::HashVersion::V1);
 
   // Public APIs
   folly::SemiFuture<std::unique_ptr<thrift::AreasConfig>> getAreasConfig();
@@ -471,6 +835,14 @@ class KvStore final : public OpenrEventBase {
       thrift::KeyGetParams keyGetParams,
       std::string area = openr::thrift::KvStore_constants::kDefaultArea());
 
+#if FOLLY_HAS_COROUTINES
+  // coroutine flavor of getKvStoreKeyVals, the awaiting coroutine is resumed
+  // on its own executor without a promise in between
+  folly::coro::Task<std::unique_ptr<thrift::Publication>> co_getKvStoreKeyVals(
+      thrift::KeyGetParams keyGetParams,
+      std::string area = openr::thrift::KvStore_constants::kDefaultArea());
+#endif
+
   folly::SemiFuture<folly::Unit> setKvStoreKeyVals(
       thrift::KeySetParams keySetParams,
       std::string area = openr::thrift::KvStore_constants::kDefaultArea());
@@ -479,6 +851,13 @@ class KvStore final : public OpenrEventBase {
       thrift::KeyDumpParams keyDumpParams,
       std::string area = openr::thrift::KvStore_constants::kDefaultArea());
 
+  // view of keys matching prefix and originator IDs of keyDumpParams, the
+  // other params are not supported. Only the view is taken on the KvStore
+  // event base, the publication is materialized by the consumer
+  folly::SemiFuture<std::shared_ptr<const KvStoreView>> dumpKvStoreKeysView(
+      thrift::KeyDumpParams keyDumpParams,
+      std::string area = openr::thrift::KvStore_constants::kDefaultArea());
+
   folly::SemiFuture<std::unique_ptr<thrift::Publication>> dumpKvStoreHashes(
       thrift::KeyDumpParams keyDumpParams,
       std::string area = openr::thrift::KvStore_constants::kDefaultArea());
@@ -506,7 +885,13 @@ class KvStore final : public OpenrEventBase {
       std::string area = openr::thrift::KvStore_constants::kDefaultArea());
 
   // API to get reader for kvStoreUpdatesQueue
-  messaging::RQueue<thrift::Publication> getKvStoreUpdatesReader();
+  messaging::RQueue<KvStorePublication> getKvStoreUpdatesReader();
+
+  // same as above for key-values and expired keys starting with one of
+  // keyPrefixes only. Publications are filtered when pushed, the reader
+  // doesn't receive those without any such key at all
+  messaging::RQueue<KvStorePublication> getKvStoreUpdatesReader(
+      std::vector<std::string> keyPrefixes);
 
  private:
   // disable copying
@@ -534,6 +919,23 @@ class KvStore final : public OpenrEventBase {
 
   void updateGlobalCounters();
 
+  // sum up counters of all areas, set them and schedule the next update
+  void submitGlobalCounters(
+      std::vector<std::unordered_map<std::string, int64_t>> const& counters);
+
+  // run callback in the thread of area, the KvStore thread unless areas run
+  // in threads of their own
+  void runInAreaEventBaseThread(
+      std::string const& area, folly::EventBase::Func callback);
+
+  // event base running area, see runInAreaEventBaseThread
+  OpenrEventBase* getAreaEventBase(std::string const& area);
+
+  // get keys of area, in its event base thread. Throws OpenrError for unknown
+  // area
+  std::unique_ptr<thrift::Publication> getKeyValsInAreaThread(
+      thrift::KeyGetParams const& keyGetParams, std::string const& area);
+
   //
   // Private variables
   //
@@ -561,6 +963,15 @@ class KvStore final : public OpenrEventBase {
   // kvstore parameters common to all kvstoreDB
   KvStoreParams kvParams_;
 
+  // OpenrCtrl clients of THRIFT transport peers, for areas running in the
+  // KvStore thread
+  std::shared_ptr<KvStoreThriftClients> thriftClients_;
+
+  // event bases and threads of areas with enableAreaThreads, by area.
+  // Declared before kvStoreDb_ to outlive it
+  std::unordered_map<std::string, std::unique_ptr<OpenrEventBase>> areaEvbs_;
+  std::vector<std::thread> areaThreads_;
+
   // map of area IDs and instance of KvStoreDb
   std::unordered_map<std::string /* area ID */, KvStoreDb> kvStoreDb_{};
 
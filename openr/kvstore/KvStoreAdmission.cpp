@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "KvStoreAdmission.h"
+
+#include <algorithm>
+
+#include <fb303/ServiceData.h>
+#include <folly/Format.h>
+#include <folly/GLog.h>
+#include <glog/logging.h>
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+namespace {
+
+// update buckets kept for originators without keys, before dropping them
+const size_t kMinIdleUpdateBuckets{1024};
+
+} // namespace
+
+KvStoreAdmission::KvStoreAdmission(KvStoreBudgets budgets)
+    : budgets_(std::move(budgets)) {}
+
+bool
+KvStoreAdmission::isExempt(std::string const& key) const {
+  for (auto const& marker : budgets_.exemptKeyMarkers) {
+    if (key.compare(0, marker.size(), marker) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+KvStoreAdmission::reject(
+    char const* reason, std::string const& key, thrift::Value const& value) {
+  fb303::fbData->addStatValue(
+      folly::sformat("kvstore.admission.rejected_keys.{}", reason),
+      1,
+      fb303::COUNT);
+  FB_LOG_EVERY_MS(WARNING, 1000)
+      << "Rejecting key " << key << " of " << value.originatorId
+      << ", over budget: " << reason;
+}
+
+bool
+KvStoreAdmission::admit(
+    KvStoreMap const& store,
+    std::string const& key,
+    thrift::Value const& value,
+    bool rateLimited) {
+  if (isExempt(key)) {
+    return true;
+  }
+
+  auto const* oldValue = store.find(key);
+  const size_t newBytes = KvStoreMap::getEntryBytes(key, value);
+  const size_t oldBytes =
+      oldValue ? KvStoreMap::getEntryBytes(key, *oldValue) : 0;
+
+  // area budgets, replacing a value with a smaller one is always fine
+  if (budgets_.maxKeys and not oldValue and store.size() >= budgets_.maxKeys) {
+    reject("area_keys", key, value);
+    return false;
+  }
+  if (budgets_.maxBytes and newBytes > oldBytes and
+      store.getBytes() - oldBytes + newBytes > budgets_.maxBytes) {
+    reject("area_bytes", key, value);
+    return false;
+  }
+
+  // originator budgets, a key taken over from another originator counts
+  // for the new one in full
+  const bool sameOriginator =
+      oldValue and store.getOriginatorId(*oldValue) == value.originatorId;
+  const auto [numKeys, numBytes] = store.getOriginatorUsage(value.originatorId);
+  if (budgets_.maxKeysPerOriginator and not sameOriginator and
+      numKeys >= budgets_.maxKeysPerOriginator) {
+    reject("originator_keys", key, value);
+    return false;
+  }
+  const size_t replacedBytes = sameOriginator ? oldBytes : 0;
+  if (budgets_.maxBytesPerOriginator and newBytes > replacedBytes and
+      numBytes - replacedBytes + newBytes > budgets_.maxBytesPerOriginator) {
+    reject("originator_bytes", key, value);
+    return false;
+  }
+
+  if (rateLimited and budgets_.maxUpdatesPerOriginatorPerSec > 0) {
+    if (updateBuckets_.size() >
+        2 * store.getNumOriginatorIds() + kMinIdleUpdateBuckets) {
+      for (auto it = updateBuckets_.begin(); it != updateBuckets_.end();) {
+        if (store.getOriginatorUsage(it->first).first == 0) {
+          it = updateBuckets_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    const auto rate = budgets_.maxUpdatesPerOriginatorPerSec;
+    const auto burst = std::max(budgets_.maxUpdateBurstPerOriginator, rate);
+    if (not updateBuckets_[value.originatorId].consume(1, rate, burst)) {
+      reject("originator_rate", key, value);
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace openr
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/TokenBucket.h>
+
+#include <openr/if/gen-cpp2/KvStore_types.h>
+#include <openr/kvstore/KvStoreMap.h>
+
+namespace openr {
+
+/**
+ * Budgets of a KvStore area protecting it from originators injecting more
+ * keys or updates than it can hold and flood. Limits of 0 are disabled.
+ */
+struct KvStoreBudgets {
+  // keys and bytes of keys and values of the area
+  size_t maxKeys{0};
+  size_t maxBytes{0};
+  // keys and bytes of keys and values of each originator
+  size_t maxKeysPerOriginator{0};
+  size_t maxBytesPerOriginator{0};
+  // value updates per second of each originator, and their burst
+  double maxUpdatesPerOriginatorPerSec{0};
+  double maxUpdateBurstPerOriginator{0};
+  // keys starting with any of these markers, e.g. Constants::kAdjDbMarker,
+  // are always admitted and don't consume update tokens
+  std::vector<std::string> exemptKeyMarkers;
+
+  bool
+  enabled() const {
+    return maxKeys or maxBytes or maxKeysPerOriginator or
+        maxBytesPerOriginator or maxUpdatesPerOriginatorPerSec > 0;
+  }
+};
+
+/**
+ * Admission of value updates into the KvStoreMap of an area, enforcing
+ * KvStoreBudgets. TTL refreshes are always admitted, they don't grow the
+ * store. Rejections are counted as kvstore.admission.rejected_keys.<reason>
+ * with reasons area_keys, area_bytes, originator_keys, originator_bytes and
+ * originator_rate.
+ */
+class KvStoreAdmission {
+ public:
+  explicit KvStoreAdmission(KvStoreBudgets budgets);
+
+  // whether value of key may replace the entry of key in store, if any.
+  // Without rateLimited, e.g. for full-sync responses carrying all keys of a
+  // peer at once, update rates are not enforced and no tokens get consumed
+  bool admit(
+      KvStoreMap const& store,
+      std::string const& key,
+      thrift::Value const& value,
+      bool rateLimited = true);
+
+  KvStoreBudgets const&
+  getBudgets() const {
+    return budgets_;
+  }
+
+ private:
+  bool isExempt(std::string const& key) const;
+
+  void reject(
+      char const* reason, std::string const& key, thrift::Value const& value);
+
+  const KvStoreBudgets budgets_;
+
+  // update tokens of originators. Originators without keys left get dropped
+  // once there are many more buckets than originators in the store
+  std::unordered_map<std::string, folly::DynamicTokenBucket> updateBuckets_;
+};
+
+} // namespace openr
@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "KvStoreCapture.h"
+
+#include <fcntl.h>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/lang/Bits.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+KvStoreCaptureWriter::KvStoreCaptureWriter(std::string const& path)
+    : file_(path, O_WRONLY | O_CREAT | O_TRUNC) {}
+
+void
+KvStoreCaptureWriter::write(
+    thrift::Publication const& publication, int64_t timestampMs) {
+  thrift::CapturedPublication record;
+  record.timestamp_ms = timestampMs;
+  record.publication = publication;
+  const auto data = fbzmq::util::writeThriftObjStr(record, serializer_);
+  const uint32_t length =
+      folly::Endian::big(static_cast<uint32_t>(data.size()));
+  if (folly::writeFull(file_.fd(), &length, sizeof(length)) < 0 or
+      folly::writeFull(file_.fd(), data.data(), data.size()) < 0) {
+    folly::throwSystemError("Failed to write KvStore capture");
+  }
+}
+
+KvStoreCaptureReader::KvStoreCaptureReader(std::string const& path)
+    : file_(path, O_RDONLY) {}
+
+std::optional<thrift::CapturedPublication>
+KvStoreCaptureReader::read() {
+  uint32_t length{0};
+  const auto lengthBytes = folly::readFull(file_.fd(), &length, sizeof(length));
+  if (lengthBytes < 0) {
+    folly::throwSystemError("Failed to read KvStore capture");
+  }
+  if (lengthBytes == 0) {
+    return std::nullopt;
+  }
+
+  std::string data(
+      lengthBytes == sizeof(length) ? folly::Endian::big(length) : 0, '\0');
+  const auto dataBytes = folly::readFull(file_.fd(), &data[0], data.size());
+  if (dataBytes < 0) {
+    folly::throwSystemError("Failed to read KvStore capture");
+  }
+  if (lengthBytes != sizeof(length) or
+      static_cast<size_t>(dataBytes) != data.size()) {
+    // writer got stopped in the middle of a record
+    LOG(WARNING) << "KvStore capture ends with a partial record, ignoring it";
+    return std::nullopt;
+  }
+  return fbzmq::util::readThriftObjStr<thrift::CapturedPublication>(
+      data, serializer_);
+}
+
+} // namespace openr
@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include <folly/File.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/if/gen-cpp2/KvStore_types.h>
+
+namespace openr {
+
+/**
+ * Captures of KvStore publications, as recorded by the KvStore snooper and
+ * fed back by the KvStore replay tool. A capture is a sequence of records,
+ * each a thrift::CapturedPublication in compact protocol preceded by its
+ * length as 32 bit integer in network byte order. Records get appended one
+ * at a time, a capture cut short is readable up to its last full record.
+ */
+class KvStoreCaptureWriter {
+ public:
+  // creates or truncates the capture at path, throws std::system_error if
+  // that fails
+  explicit KvStoreCaptureWriter(std::string const& path);
+
+  // append a record of publication, received at timestampMs
+  void write(thrift::Publication const& publication, int64_t timestampMs);
+
+ private:
+  folly::File file_;
+  apache::thrift::CompactSerializer serializer_;
+};
+
+class KvStoreCaptureReader {
+ public:
+  // throws std::system_error if path can not be opened
+  explicit KvStoreCaptureReader(std::string const& path);
+
+  // next record, std::nullopt at the end of the capture. Throws if a record
+  // can't be parsed
+  std::optional<thrift::CapturedPublication> read();
+
+ private:
+  folly::File file_;
+  apache::thrift::CompactSerializer serializer_;
+};
+
+} // namespace openr
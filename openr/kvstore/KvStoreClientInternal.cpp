@@ -7,31 +7,57 @@
 
 #include "KvStoreClientInternal.h"
 
+#include <algorithm>
+
 #include <openr/common/OpenrClient.h>
 #include <openr/common/Util.h>
 
+#include <folly/Random.h>
 #include <folly/SharedMutex.h>
 #include <folly/String.h>
 
 namespace openr {
 
+namespace {
+
+// start of the tick of time, ticks are aligned to the clock
+std::chrono::steady_clock::time_point
+roundUpToTick(std::chrono::steady_clock::time_point time) {
+  const auto tick = std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(Constants::kTtlRefreshTick);
+  const auto sinceEpoch = time.time_since_epoch();
+  return std::chrono::steady_clock::time_point(
+      (sinceEpoch + tick - std::chrono::steady_clock::duration(1)) / tick *
+      tick);
+}
+
+} // namespace
+
 KvStoreClientInternal::KvStoreClientInternal(
     OpenrEventBase* eventBase,
     std::string const& nodeId,
     KvStore* kvStore,
-    std::optional<std::chrono::milliseconds> checkPersistKeyPeriod)
+    std::optional<std::chrono::milliseconds> checkPersistKeyPeriod,
+    std::chrono::milliseconds setKeysBatchWindow,
+    std::vector<std::string> updatesKeyPrefixes,
+    size_t ttlRefreshesPerTick)
     : nodeId_(nodeId),
       eventBase_(eventBase),
       kvStore_(kvStore),
-      checkPersistKeyPeriod_(checkPersistKeyPeriod) {
+      checkPersistKeyPeriod_(checkPersistKeyPeriod),
+      setKeysBatchWindow_(setKeysBatchWindow),
+      ttlRefreshesPerTick_(ttlRefreshesPerTick) {
   // sanity check
   CHECK_NE(eventBase_, static_cast<void*>(nullptr));
   CHECK(!nodeId.empty());
   CHECK(kvStore_);
 
   // Fiber to process thrift::Publication from KvStore
+  auto reader = updatesKeyPrefixes.empty()
+      ? kvStore_->getKvStoreUpdatesReader()
+      : kvStore_->getKvStoreUpdatesReader(std::move(updatesKeyPrefixes));
   taskFuture_ = eventBase_->addFiberTaskFuture([
-    q = std::move(kvStore_->getKvStoreUpdatesReader()),
+    q = std::move(reader),
     this
   ]() mutable noexcept {
     LOG(INFO) << "Starting KvStore updates processing fiber";
@@ -42,7 +68,7 @@ KvStoreClientInternal::KvStoreClientInternal(
         LOG(INFO) << "Terminating KvStore updates processing fiber";
         break;
       }
-      processPublication(maybePublication.value());
+      processPublication(*maybePublication.value());
     }
   });
 
@@ -59,6 +85,7 @@ KvStoreClientInternal::~KvStoreClientInternal() {
     advertiseKeyValsTimer_.reset();
     ttlTimer_.reset();
     checkPersistKeyTimer_.reset();
+    batchTimer_.reset();
   });
 
   // wait for fiber to be closed before destroy KvStoreClientInternal
@@ -90,6 +117,10 @@ KvStoreClientInternal::initTimers() {
   ttlTimer_ = folly::AsyncTimeout::make(
       *eventBase_->getEvb(), [this]() noexcept { advertiseTtlUpdates(); });
 
+  // Create timer to send batched key-vals
+  batchTimer_ = folly::AsyncTimeout::make(
+      *eventBase_->getEvb(), [this]() noexcept { flushBatchedKeyVals(); });
+
   // Create check persistKey timer
   if (checkPersistKeyPeriod_.has_value()) {
     checkPersistKeyTimer_ = folly::AsyncTimeout::make(
@@ -100,57 +131,39 @@ KvStoreClientInternal::initTimers() {
 
 void
 KvStoreClientInternal::checkPersistKeyInStore() {
-  std::chrono::milliseconds timeout{checkPersistKeyPeriod_.value()};
-
   // go through persisted keys map for each area
+  bool hasKeysToAdvertise{false};
   for (const auto& persistKeyValsEntry : persistedKeyVals_) {
     const auto& area = persistKeyValsEntry.first;
     auto& persistedKeyVals = persistKeyValsEntry.second;
-
-    if (persistedKeyVals.empty()) {
-      continue;
-    }
-
-    // Prepare KEY_GET params
-    thrift::KeyGetParams params;
-    thrift::Publication pub;
-    for (auto const& key : persistedKeyVals) {
-      params.keys.emplace_back(key.first);
-    }
-
-    // Get KvStore response
-    try {
-      pub = *(kvStore_->getKvStoreKeyVals(params, area).get());
-    } catch (const std::exception& ex) {
-      LOG(ERROR) << "Failed to get keyvals from kvstore. Exception: "
-                 << ex.what();
-      // retry in 1 sec
-      timeout = 1000ms;
-      checkPersistKeyTimer_->scheduleTimeout(1000ms);
-      continue;
-    }
-
-    // Find expired keys from latest KvStore
-    std::unordered_map<std::string, thrift::Value> keyVals;
-    for (auto const& key : persistedKeyVals) {
-      auto rxkey = pub.keyVals.find(key.first);
-      if (rxkey == pub.keyVals.end()) {
-        keyVals.emplace(key.first, persistedKeyVals.at(key.first));
-      }
-    }
-
-    // Advertise to KvStore
-    if (not keyVals.empty()) {
-      const auto ret = setKeysHelper(std::move(keyVals), area);
-      if (!ret.has_value()) {
-        LOG(ERROR) << "Error sending SET_KEY request to KvStore.";
+    auto& storedKeyHashes = storedKeyHashes_[area];
+    auto& keysToAdvertise = keysToAdvertise_[area];
+
+    // Find keys KvStore doesn't have our value of, as far as publications
+    // tell, e.g. expired ones
+    for (auto const& kv : persistedKeyVals) {
+      auto const& key = kv.first;
+      auto const& thriftValue = kv.second;
+      auto it = storedKeyHashes.find(key);
+      if (it != storedKeyHashes.end() and
+          it->second ==
+              generateHash(
+                  thriftValue.version,
+                  thriftValue.originatorId,
+                  thriftValue.value)) {
+        continue;
       }
+      VLOG(1) << "Persisted key " << key << " of area " << area
+              << " is missing or outdated in KvStore, re-advertising";
+      keysToAdvertise.insert(key);
+      hasKeysToAdvertise = true;
     }
-    processPublication(pub);
   }
 
-  timeout = std::min(timeout, checkPersistKeyPeriod_.value());
-  checkPersistKeyTimer_->scheduleTimeout(timeout);
+  if (hasKeysToAdvertise) {
+    advertisePendingKeys();
+  }
+  checkPersistKeyTimer_->scheduleTimeout(checkPersistKeyPeriod_.value());
 }
 
 bool
@@ -163,7 +176,7 @@ KvStoreClientInternal::persistKey(
           << " area:" << area;
 
   auto& persistedKeyVals = persistedKeyVals_[area];
-  const auto& keyTtlBackoffs = keyTtlBackoffs_[area];
+  const auto& keyTtlRefreshes = keyTtlRefreshes_[area];
   auto& keysToAdvertise = keysToAdvertise_[area];
   // Look it up in the existing
   auto keyIt = persistedKeyVals.find(key);
@@ -187,6 +200,9 @@ KvStoreClientInternal::persistKey(
       thriftValue = maybeValue.value();
       // TTL update pub is never saved in kvstore
       DCHECK(thriftValue.value);
+      // if it's our value already KvStore won't publish it again
+      storedKeyHashes_[area][key] = generateHash(
+          thriftValue.version, thriftValue.originatorId, thriftValue.value);
     }
   } else {
     thriftValue = keyIt->second;
@@ -194,9 +210,9 @@ KvStoreClientInternal::persistKey(
       // this is a no op, return early and change no state
       return false;
     }
-    auto ttlIt = keyTtlBackoffs.find(key);
-    if (ttlIt != keyTtlBackoffs.end()) {
-      thriftValue.ttlVersion = ttlIt->second.first.ttlVersion;
+    auto ttlIt = keyTtlRefreshes.find(key);
+    if (ttlIt != keyTtlRefreshes.end()) {
+      thriftValue.ttlVersion = ttlIt->second.value.ttlVersion;
     }
   }
 
@@ -337,10 +353,10 @@ KvStoreClientInternal::scheduleTtlUpdates(
     std::string const& area /* thrift::KvStore_constants::kDefaultArea() */) {
   // infinite TTL does not need update
 
-  auto& keyTtlBackoffs = keyTtlBackoffs_[area];
+  auto& keyTtlRefreshes = keyTtlRefreshes_[area];
   if (ttl == Constants::kTtlInfinity) {
     // in case ttl is finite before
-    keyTtlBackoffs.erase(key);
+    keyTtlRefreshes.erase(key);
     return;
   }
 
@@ -355,21 +371,49 @@ KvStoreClientInternal::scheduleTtlUpdates(
   ttlThriftValue.value.reset();
   CHECK(not ttlThriftValue.value.has_value());
 
-  // renew before Ttl expires about every ttl/3, i.e., try twice
-  // use ExponentialBackoff to track remaining time
-  keyTtlBackoffs[key] = std::make_pair(
-      ttlThriftValue,
-      ExponentialBackoff<std::chrono::milliseconds>(
-          std::chrono::milliseconds(ttl / 4),
-          std::chrono::milliseconds(ttl / 4 + 1)));
+  auto& refresh = keyTtlRefreshes[key];
+  refresh.value = std::move(ttlThriftValue);
 
-  // Delay first ttl advertisement by (ttl / 4). We have just advertised key or
-  // update and would like to avoid sending unncessary immediate ttl update
-  if (not advertiseImmediately) {
-    keyTtlBackoffs.at(key).second.reportError();
+  // Delay first ttl advertisement by about (ttl / 4). We have just advertised
+  // key or update and would like to avoid sending unncessary immediate ttl
+  // update
+  if (advertiseImmediately) {
+    refresh.refreshTime = std::chrono::steady_clock::now();
+    refresh.deadline = refresh.refreshTime;
+    advertiseTtlUpdates();
+    return;
   }
+  scheduleNextTtlRefresh(refresh);
+  scheduleTtlTimer(refresh.refreshTime);
+}
 
-  advertiseTtlUpdates();
+void
+KvStoreClientInternal::scheduleNextTtlRefresh(TtlRefresh& refresh) {
+  // renew before Ttl expires about every ttl/4, i.e., try three times. The
+  // jitter lets keys set together drift apart
+  const auto period = std::chrono::milliseconds(refresh.value.ttl / 4);
+  const auto now = std::chrono::steady_clock::now();
+  refresh.refreshTime = roundUpToTick(
+      now +
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          period *
+          (1 - Constants::kTtlRefreshJitter * folly::Random::randDouble01())));
+  // deferred refreshes leave a refresh before the key expires
+  refresh.deadline = now + 2 * period;
+}
+
+void
+KvStoreClientInternal::scheduleTtlTimer(
+    std::chrono::steady_clock::time_point refreshTime) {
+  if (ttlTimer_->isScheduled() and ttlTimerTime_ <= refreshTime) {
+    return;
+  }
+  ttlTimerTime_ = refreshTime;
+  // not to fire before the refresh is due
+  const auto timeout = std::chrono::ceil<std::chrono::milliseconds>(
+      refreshTime - std::chrono::steady_clock::now());
+  VLOG(2) << "Scheduling ttl timer after " << timeout.count() << "ms.";
+  ttlTimer_->scheduleTimeout(std::max(timeout, std::chrono::milliseconds(0)));
 }
 
 void
@@ -380,8 +424,9 @@ KvStoreClientInternal::unsetKey(
           << " area " << area;
 
   persistedKeyVals_[area].erase(key);
+  storedKeyHashes_[area].erase(key);
   backoffs_.erase(key);
-  keyTtlBackoffs_[area].erase(key);
+  keyTtlRefreshes_[area].erase(key);
   keysToAdvertise_[area].erase(key);
 }
 
@@ -517,8 +562,16 @@ void
 KvStoreClientInternal::processExpiredKeys(
     thrift::Publication const& publication) {
   auto const& expiredKeys = publication.expiredKeys;
+  std::string area{thrift::KvStore_constants::kDefaultArea()};
+  if (publication.area.has_value()) {
+    area = publication.area.value();
+  }
+  auto& storedKeyHashes = storedKeyHashes_[area];
 
   for (auto const& key : expiredKeys) {
+    // persisted ones get re-advertised by checkPersistKeyInStore()
+    storedKeyHashes.erase(key);
+
     /* callback registered by the thread */
     if (kvCallback_) {
       kvCallback_(key, std::nullopt);
@@ -542,16 +595,17 @@ KvStoreClientInternal::processPublication(
   }
 
   auto& persistedKeyVals = persistedKeyVals_[area];
-  auto& keyTtlBackoffs = keyTtlBackoffs_[area];
+  auto& keyTtlRefreshes = keyTtlRefreshes_[area];
   auto& keysToAdvertise = keysToAdvertise_[area];
+  auto& storedKeyHashes = storedKeyHashes_[area];
 
-  for (auto const& kv : publication.keyVals) {
-    auto const& key = kv.first;
-    auto const& rcvdValue = kv.second;
-
+  // Processing of a key-value of the publication, for callbacks and persisted
+  // or set keys
+  auto processKeyVal = [&](std::string const& key,
+                           thrift::Value const& rcvdValue) {
     if (not rcvdValue.value) {
       // ignore TTL update
-      continue;
+      return;
     }
 
     if (kvCallback_) {
@@ -562,16 +616,16 @@ KvStoreClientInternal::processPublication(
     auto it = persistedKeyVals.find(key);
     auto cb = keyCallbacks_.find(key);
     // set key w/ finite TTL
-    auto sk = keyTtlBackoffs.find(key);
+    auto sk = keyTtlRefreshes.find(key);
 
     // key set but not persisted
-    if (sk != keyTtlBackoffs.end() and it == persistedKeyVals.end()) {
-      auto& setValue = sk->second.first;
+    if (sk != keyTtlRefreshes.end() and it == persistedKeyVals.end()) {
+      auto& setValue = sk->second.value;
       if (rcvdValue.version > setValue.version or
           (rcvdValue.version == setValue.version and
            rcvdValue.originatorId > setValue.originatorId)) {
         // key lost, cancel TTL update
-        keyTtlBackoffs.erase(sk);
+        keyTtlRefreshes.erase(sk);
       } else if (
           rcvdValue.version == setValue.version and
           rcvdValue.originatorId == setValue.originatorId and
@@ -579,8 +633,8 @@ KvStoreClientInternal::processPublication(
         // If version, value and originatorId is same then we should look up
         // ttlVersion and update local value if rcvd ttlVersion is higher
         // NOTE: We don't need to advertise the value back
-        if (sk != keyTtlBackoffs.end() and
-            sk->second.first.ttlVersion < rcvdValue.ttlVersion) {
+        if (sk != keyTtlRefreshes.end() and
+            sk->second.value.ttlVersion < rcvdValue.ttlVersion) {
           VLOG(1) << "Bumping TTL version for (key, version, originatorId) "
                   << folly::sformat(
                          "({}, {}, {})",
@@ -606,13 +660,17 @@ KvStoreClientInternal::processPublication(
         keyPrefixFilterCallback_(key, rcvdValue);
       }
       // Skip rest of the processing. We are not interested.
-      continue;
+      return;
     }
 
+    // Value KvStore has now, checked against ours by checkPersistKeyInStore()
+    storedKeyHashes[key] = generateHash(
+        rcvdValue.version, rcvdValue.originatorId, rcvdValue.value);
+
     // Ignore if received version is strictly old
     auto& currentValue = it->second;
     if (currentValue.version > rcvdValue.version) {
-      continue;
+      return;
     }
 
     // Update if our version is old
@@ -644,8 +702,8 @@ KvStoreClientInternal::processPublication(
     }
 
     // copy ttlVersion from ttl backoff map
-    if (sk != keyTtlBackoffs.end()) {
-      currentValue.ttlVersion = sk->second.first.ttlVersion;
+    if (sk != keyTtlRefreshes.end()) {
+      currentValue.ttlVersion = sk->second.value.ttlVersion;
     }
 
     // update local ttlVersion if received higher ttlVersion.
@@ -653,8 +711,8 @@ KvStoreClientInternal::processPublication(
     // update to latest ttlVersion works fine
     if (currentValue.ttlVersion < rcvdValue.ttlVersion) {
       currentValue.ttlVersion = rcvdValue.ttlVersion;
-      if (sk != keyTtlBackoffs.end()) {
-        sk->second.first.ttlVersion = rcvdValue.ttlVersion;
+      if (sk != keyTtlRefreshes.end()) {
+        sk->second.value.ttlVersion = rcvdValue.ttlVersion;
       }
     }
 
@@ -665,7 +723,43 @@ KvStoreClientInternal::processPublication(
     if (valueChange) {
       keysToAdvertise.insert(key);
     }
-  } // for
+  };
+
+  // Without callbacks for every key the client only cares about keys it
+  // subscribed to, persisted or set. Look those up if there are fewer of them
+  // than key-values in the publication, rather than walking all key-values.
+  const size_t numKeysOfInterest =
+      keyCallbacks_.size() + persistedKeyVals.size() + keyTtlRefreshes.size();
+  if (not kvCallback_ and not keyPrefixFilterCallback_ and
+      numKeysOfInterest < publication.keyVals.size()) {
+    std::vector<std::pair<const std::string, thrift::Value> const*> keyVals;
+    keyVals.reserve(numKeysOfInterest);
+    auto addKeyVal = [&](std::string const& key) {
+      auto it = publication.keyVals.find(key);
+      if (it != publication.keyVals.end()) {
+        keyVals.emplace_back(&*it);
+      }
+    };
+    for (auto const& kv : keyCallbacks_) {
+      addKeyVal(kv.first);
+    }
+    for (auto const& kv : persistedKeyVals) {
+      addKeyVal(kv.first);
+    }
+    for (auto const& kv : keyTtlRefreshes) {
+      addKeyVal(kv.first);
+    }
+    // keys can be of interest for more than one reason, process them once
+    std::sort(keyVals.begin(), keyVals.end());
+    keyVals.erase(std::unique(keyVals.begin(), keyVals.end()), keyVals.end());
+    for (auto const* kv : keyVals) {
+      processKeyVal(kv->first, kv->second);
+    }
+  } else {
+    for (auto const& kv : publication.keyVals) {
+      processKeyVal(kv.first, kv.second);
+    }
+  }
 
   advertisePendingKeys();
 
@@ -724,14 +818,10 @@ KvStoreClientInternal::advertisePendingKeys() {
       keys.push_back(key);
     }
 
-    // Advertise to KvStore
-    const auto ret = setKeysHelper(std::move(keyVals), area);
-    if (ret.has_value()) {
-      for (auto const& key : keys) {
-        keysToAdvertise.erase(key);
-      }
-    } else {
-      LOG(ERROR) << "Error sending SET_KEY request to KvStore.";
+    // Advertise to KvStore with the next batch
+    batchKeyVals(std::move(keyVals), area);
+    for (auto const& key : keys) {
+      keysToAdvertise.erase(key);
     }
   }
 
@@ -743,30 +833,41 @@ KvStoreClientInternal::advertisePendingKeys() {
 void
 KvStoreClientInternal::advertiseTtlUpdates() {
   // Build set of keys to advertise ttl updates
-  auto timeout = Constants::kMaxTtlUpdateInterval;
+  const auto now = std::chrono::steady_clock::now();
+  auto nextRefreshTime = now + Constants::kMaxTtlUpdateInterval;
+  size_t budget = ttlRefreshesPerTick_;
 
   // advertise TTL updates for each area
-  for (auto& keyTtlBackoffsEntry : keyTtlBackoffs_) {
-    auto& keyTtlBackoffs = keyTtlBackoffsEntry.second;
-    auto& persistedKeyVals = persistedKeyVals_[keyTtlBackoffsEntry.first];
-    auto& area = keyTtlBackoffsEntry.first;
+  for (auto& keyTtlRefreshesEntry : keyTtlRefreshes_) {
+    auto& keyTtlRefreshes = keyTtlRefreshesEntry.second;
+    auto& persistedKeyVals = persistedKeyVals_[keyTtlRefreshesEntry.first];
+    auto& area = keyTtlRefreshesEntry.first;
 
     std::unordered_map<std::string, thrift::Value> keyVals;
 
-    for (auto& kv : keyTtlBackoffs) {
+    for (auto& kv : keyTtlRefreshes) {
       const auto& key = kv.first;
-      auto& backoff = kv.second.second;
-      if (not backoff.canTryNow()) {
+      auto& refresh = kv.second;
+      if (refresh.refreshTime > now) {
         VLOG(2) << "Skipping key: " << key << ", area: " << area;
-        timeout = std::min(timeout, backoff.getTimeRemainingUntilRetry());
+        nextRefreshTime = std::min(nextRefreshTime, refresh.refreshTime);
         continue;
       }
 
-      // Apply backoff
-      backoff.reportError();
-      timeout = std::min(timeout, backoff.getTimeRemainingUntilRetry());
+      // over budget of the tick, defer to the next tick unless the key is
+      // about to expire
+      if (budget == 0 and refresh.deadline > now) {
+        refresh.refreshTime = roundUpToTick(now + Constants::kTtlRefreshTick);
+        nextRefreshTime = std::min(nextRefreshTime, refresh.refreshTime);
+        continue;
+      }
+      if (budget > 0) {
+        --budget;
+      }
+      scheduleNextTtlRefresh(refresh);
+      nextRefreshTime = std::min(nextRefreshTime, refresh.refreshTime);
 
-      auto& thriftValue = kv.second.first;
+      auto& thriftValue = refresh.value;
       const auto it = persistedKeyVals.find(key);
       if (it != persistedKeyVals.end()) {
         // we may have got a newer vesion for persisted key
@@ -792,18 +893,80 @@ KvStoreClientInternal::advertiseTtlUpdates() {
       keyVals.emplace(key, thriftValue);
     }
 
-    // Advertise to KvStore
-    if (not keyVals.empty()) {
-      const auto ret = setKeysHelper(std::move(keyVals), area);
-      if (!ret.has_value()) {
-        LOG(ERROR) << "Error sending SET_KEY request to KvStore.";
+    // Advertise to KvStore with the next batch
+    batchKeyVals(std::move(keyVals), area);
+  }
+
+  // Schedule next-timeout for the earliest refresh
+  ttlTimer_->cancelTimeout();
+  scheduleTtlTimer(nextRefreshTime);
+}
+
+void
+KvStoreClientInternal::batchKeyVals(
+    std::unordered_map<std::string, thrift::Value>&& keyVals,
+    std::string const& area) {
+  if (keyVals.empty()) {
+    return;
+  }
+
+  auto& batchedKeyVals = batchedKeyVals_[area];
+  for (auto& kv : keyVals) {
+    auto it = batchedKeyVals.find(kv.first);
+    if (it == batchedKeyVals.end()) {
+      batchedKeyVals.emplace(kv.first, std::move(kv.second));
+    } else if (kv.second.value.has_value() or not it->second.value) {
+      it->second = std::move(kv.second);
+    }
+  }
+
+  // first key-vals of the batch start the batch window
+  if (not batchTimer_->isScheduled()) {
+    batchTimer_->scheduleTimeout(setKeysBatchWindow_);
+  }
+}
+
+void
+KvStoreClientInternal::flushBatchedKeyVals() {
+  auto batchedKeyVals = std::move(batchedKeyVals_);
+  batchedKeyVals_.clear();
+
+  bool hasKeysToAdvertise{false};
+  for (auto& areaKeyVals : batchedKeyVals) {
+    auto const& area = areaKeyVals.first;
+    auto& keyVals = areaKeyVals.second;
+    if (keyVals.empty()) {
+      continue;
+    }
+    VLOG(2) << "Sending batch of " << keyVals.size()
+            << " key-vals to KvStore, area: " << area;
+
+    std::vector<std::string> keys;
+    for (auto const& kv : keyVals) {
+      if (kv.second.value.has_value()) {
+        keys.emplace_back(kv.first);
+      }
+    }
+    const auto ret = setKeysHelper(std::move(keyVals), area);
+    if (ret.has_value()) {
+      continue;
+    }
+    LOG(ERROR) << "Error sending SET_KEY request to KvStore.";
+
+    // retry the persisted ones, TTL updates get retried by their backoff
+    auto const& persistedKeyVals = persistedKeyVals_[area];
+    auto& keysToAdvertise = keysToAdvertise_[area];
+    for (auto const& key : keys) {
+      if (persistedKeyVals.count(key)) {
+        keysToAdvertise.insert(key);
+        hasKeysToAdvertise = true;
       }
     }
   }
 
-  // Schedule next-timeout for processing/clearing backoffs
-  VLOG(2) << "Scheduling ttl timer after " << timeout.count() << "ms.";
-  ttlTimer_->scheduleTimeout(timeout);
+  if (hasKeysToAdvertise) {
+    advertiseKeyValsTimer_->scheduleTimeout(Constants::kInitialBackoff);
+  }
 }
 
 std::optional<folly::Unit>
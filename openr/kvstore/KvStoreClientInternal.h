@@ -46,12 +46,28 @@ class KvStoreClientInternal {
   /**
    * Creates and initializes all necessary sockets for communicating with
    * KvStore.
+   *
+   * Keys advertised by persistKey and TTL updates are batched for
+   * setKeysBatchWindow, by default till the next event loop iteration, and
+   * sent to KvStore with one request per area.
+   *
+   * If updatesKeyPrefixes are given, the client only receives KvStore
+   * updates of keys starting with one of them. Every key the client
+   * persists, sets or subscribes to must then start with one of them.
+   *
+   * TTL updates of a key are jittered, and sent on ticks of
+   * Constants::kTtlRefreshTick, all refreshes of a tick in one batch. At most
+   * ttlRefreshesPerTick are sent per tick, others are deferred unless that
+   * leaves them a single refresh before they expire.
    */
   KvStoreClientInternal(
       OpenrEventBase* eventBase,
       std::string const& nodeId,
       KvStore* kvStore,
-      std::optional<std::chrono::milliseconds> checkPersistKeyPeriod = 60000ms);
+      std::optional<std::chrono::milliseconds> checkPersistKeyPeriod = 60000ms,
+      std::chrono::milliseconds setKeysBatchWindow = 0ms,
+      std::vector<std::string> updatesKeyPrefixes = {},
+      size_t ttlRefreshesPerTick = Constants::kTtlRefreshesPerTick);
 
   ~KvStoreClientInternal();
 
@@ -156,6 +172,16 @@ class KvStoreClientInternal {
   }
 
  private:
+  // TTL refresh of a key
+  struct TtlRefresh {
+    // value to refresh the TTL with, without value
+    thrift::Value value;
+    // next refresh, and the latest it may be deferred to by the budget of a
+    // tick
+    std::chrono::steady_clock::time_point refreshTime;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
   /**
    * Process timeout is called when timeout expires.
    */
@@ -196,6 +222,21 @@ class KvStoreClientInternal {
       std::unordered_map<std::string, thrift::Value> keyVals,
       std::string const& area = thrift::KvStore_constants::kDefaultArea());
 
+  /**
+   * Add key-vals to the batch sent to KvStore once the batch window is over.
+   * Values replace TTL updates of the same key, TTL updates are dropped for
+   * keys with a value in the batch, its TTL is refreshed with the value.
+   */
+  void batchKeyVals(
+      std::unordered_map<std::string, thrift::Value>&& keyVals,
+      std::string const& area);
+
+  /**
+   * Send batched key-vals to KvStore, one request per area. Persisted keys
+   * of failed requests get re-advertised with their backoff.
+   */
+  void flushBatchedKeyVals();
+
   /**
    * Helper function to advertise the pending keys considering the exponential
    * backoff with one more than the latest version to KvStore. It also
@@ -215,10 +256,27 @@ class KvStoreClientInternal {
       std::string const& area = thrift::KvStore_constants::kDefaultArea());
 
   /**
-   * Helper function to advertise TTL update
+   * Helper function to advertise TTL updates of keys whose refresh is due,
+   * within the budget of a tick
    */
   void advertiseTtlUpdates();
 
+  /**
+   * Schedule the next TTL refresh of key after the one just sent, with the
+   * latest time it may be deferred to
+   */
+  void scheduleNextTtlRefresh(TtlRefresh& refresh);
+
+  /**
+   * Fire ttlTimer_ on the tick of refreshTime, unless it fires earlier
+   */
+  void scheduleTtlTimer(std::chrono::steady_clock::time_point refreshTime);
+
+  /**
+   * Re-advertise persisted keys whose latest value seen in publications of
+   * KvStore isn't ours, e.g. because they expired. Only compares against
+   * storedKeyHashes_, KvStore isn't queried.
+   */
   void checkPersistKeyInStore();
 
   /*
@@ -246,6 +304,12 @@ class KvStoreClientInternal {
   // check persiste key timer event
   std::unique_ptr<folly::AsyncTimeout> checkPersistKeyTimer_;
 
+  // time to batch key-vals for before sending them to KvStore
+  const std::chrono::milliseconds setKeysBatchWindow_{0};
+
+  // TTL refreshes sent per tick at most, unless due to expire
+  const size_t ttlRefreshesPerTick_{0};
+
   //
   // Mutable state
   //
@@ -256,6 +320,14 @@ class KvStoreClientInternal {
       std::unordered_map<std::string /* key */, thrift::Value>>
       persistedKeyVals_;
 
+  // Hash of version, originator and value of persisted keys as last seen in
+  // publications of KvStore, by area. Keys missing got expired or haven't been
+  // reflected back by KvStore yet
+  std::unordered_map<
+      std::string /* area */,
+      std::unordered_map<std::string /* key */, int64_t /* hash */>>
+      storedKeyHashes_;
+
   // Subscribed keys to their callback functions
   std::unordered_map<std::string, KeyCallback> keyCallbacks_;
 
@@ -271,15 +343,11 @@ class KvStoreClientInternal {
       ExponentialBackoff<std::chrono::milliseconds>>
       backoffs_;
 
-  // backoff associated with each key for freshing TTL
+  // TTL refreshes of keys with finite TTL
   std::unordered_map<
       std::string /* area */,
-      std::unordered_map<
-          std::string /* key */,
-          std::pair<
-              thrift::Value /* value */,
-              ExponentialBackoff<std::chrono::milliseconds>>>>
-      keyTtlBackoffs_;
+      std::unordered_map<std::string /* key */, TtlRefresh>>
+      keyTtlRefreshes_;
 
   // Set of local keys to be re-advertised.
   std::unordered_map<
@@ -290,8 +358,17 @@ class KvStoreClientInternal {
   // Timer to advertised pending key-vals
   std::unique_ptr<folly::AsyncTimeout> advertiseKeyValsTimer_;
 
-  // Timer to advertise ttl updates for key-vals
+  // Timer to advertise ttl updates for key-vals, and when it fires
   std::unique_ptr<folly::AsyncTimeout> ttlTimer_;
+  std::chrono::steady_clock::time_point ttlTimerTime_;
+  // Key-vals to be sent to KvStore with the next batch, by area
+  std::unordered_map<
+      std::string /* area */,
+      std::unordered_map<std::string /* key */, thrift::Value>>
+      batchedKeyVals_;
+
+  // Timer to send batched key-vals once batch window is over
+  std::unique_ptr<folly::AsyncTimeout> batchTimer_;
 
   // prefix key filter to apply for key updates
   KvStoreFilters keyPrefixFilter_{{}, {}};
@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "KvStoreCompression.h"
+
+#include <memory>
+#include <optional>
+
+#include <folly/ExceptionString.h>
+#include <folly/compression/Compression.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+std::optional<folly::io::CodecType>
+toCodecType(thrift::CompressionType compression) {
+  switch (compression) {
+  case thrift::CompressionType::ZSTD:
+    return folly::io::CodecType::ZSTD;
+  case thrift::CompressionType::LZ4:
+    // carries the uncompressed length, no need to send it along
+    return folly::io::CodecType::LZ4_VARINT_SIZE;
+  default:
+    return std::nullopt;
+  }
+}
+
+std::unique_ptr<folly::io::Codec>
+getCodec(thrift::CompressionType compression) {
+  const auto codecType = toCodecType(compression);
+  if (not codecType.has_value() or not folly::io::hasCodec(*codecType)) {
+    return nullptr;
+  }
+  return folly::io::getCodec(*codecType);
+}
+
+} // namespace
+
+std::vector<thrift::CompressionType>
+getSupportedCompression() {
+  std::vector<thrift::CompressionType> supported;
+  for (auto compression :
+       {thrift::CompressionType::ZSTD, thrift::CompressionType::LZ4}) {
+    const auto codecType = toCodecType(compression);
+    if (folly::io::hasCodec(*codecType)) {
+      supported.emplace_back(compression);
+    }
+  }
+  return supported;
+}
+
+size_t
+compressValues(
+    std::unordered_map<std::string, thrift::Value>& keyVals,
+    thrift::CompressionType compression,
+    size_t minBytes) {
+  auto codec = getCodec(compression);
+  if (not codec) {
+    return 0;
+  }
+
+  size_t bytesSaved = 0;
+  for (auto& kv : keyVals) {
+    auto& value = kv.second;
+    if (not value.value.has_value() or value.compression.has_value() or
+        value.value->size() < minBytes) {
+      continue;
+    }
+    auto compressed = codec->compress(*value.value);
+    if (compressed.size() >= value.value->size()) {
+      continue;
+    }
+    bytesSaved += value.value->size() - compressed.size();
+    value.value = std::move(compressed);
+    value.compression = compression;
+  }
+  return bytesSaved;
+}
+
+size_t
+decompressValues(std::unordered_map<std::string, thrift::Value>& keyVals) {
+  std::unordered_map<thrift::CompressionType, std::unique_ptr<folly::io::Codec>>
+      codecs;
+  size_t numFailures = 0;
+  for (auto it = keyVals.begin(); it != keyVals.end();) {
+    auto& value = it->second;
+    if (not value.compression.has_value()) {
+      ++it;
+      continue;
+    }
+
+    const auto compression = value.compression.value();
+    value.compression.reset();
+    if (compression == thrift::CompressionType::NONE) {
+      ++it;
+      continue;
+    }
+
+    auto codecIt = codecs.find(compression);
+    if (codecIt == codecs.end()) {
+      codecIt = codecs.emplace(compression, getCodec(compression)).first;
+    }
+    auto const& codec = codecIt->second;
+    if (codec and value.value.has_value()) {
+      try {
+        value.value = codec->uncompress(*value.value);
+        ++it;
+        continue;
+      } catch (std::exception const& e) {
+        LOG(ERROR) << "Failed to decompress value of key " << it->first << ": "
+                   << folly::exceptionStr(e);
+      }
+    } else {
+      LOG(ERROR) << "Can not decompress value of key " << it->first;
+    }
+    ++numFailures;
+    it = keyVals.erase(it);
+  }
+  return numFailures;
+}
+
+} // namespace openr
@@ -0,0 +1,39 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <openr/if/gen-cpp2/KvStore_types.h>
+
+namespace openr {
+
+/**
+ * Compression of KvStore values on the wire between peers. Values are only
+ * ever compressed in messages to peers which advertised they can decompress
+ * them, KvStore stores, hashes and publishes values uncompressed.
+ */
+
+// codecs available to compress and decompress values with
+std::vector<thrift::CompressionType> getSupportedCompression();
+
+// compress values of at least minBytes with given codec, when that makes them
+// smaller. Returns the number of bytes saved
+size_t compressValues(
+    std::unordered_map<std::string, thrift::Value>& keyVals,
+    thrift::CompressionType compression,
+    size_t minBytes);
+
+// decompress compressed values in place. Values which fail to decompress get
+// removed, returns their number
+size_t decompressValues(
+    std::unordered_map<std::string, thrift::Value>& keyVals);
+
+} // namespace openr
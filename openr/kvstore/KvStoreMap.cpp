@@ -0,0 +1,478 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "KvStoreMap.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <folly/Range.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <folly/lang/Bits.h>
+#include <glog/logging.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/Util.h>
+
+namespace openr {
+
+OriginatorIdTable::Id
+OriginatorIdTable::acquire(std::string const& originatorId, size_t bytes) {
+  auto it = ids_.find(originatorId);
+  if (it == ids_.end()) {
+    Id id;
+    if (freeIds_.empty()) {
+      id = entries_.size();
+      entries_.emplace_back();
+    } else {
+      id = freeIds_.back();
+      freeIds_.pop_back();
+    }
+    entries_[id].originatorId = originatorId;
+    it = ids_.emplace(originatorId, id).first;
+  }
+  auto& entry = entries_[it->second];
+  ++entry.refCount;
+  entry.bytes += bytes;
+  return it->second;
+}
+
+void
+OriginatorIdTable::release(Id id, size_t bytes) {
+  auto& entry = entries_.at(id);
+  CHECK_GT(entry.refCount, 0) << "Originator ID released too often";
+  CHECK_GE(entry.bytes, bytes) << "Originator ID released too many bytes";
+  entry.bytes -= bytes;
+  if (--entry.refCount) {
+    return;
+  }
+  entry.bytes = 0;
+  entry.hash = 0;
+  ids_.erase(entry.originatorId);
+  entry.originatorId.clear();
+  entry.originatorId.shrink_to_fit();
+  freeIds_.emplace_back(id);
+}
+
+std::pair<size_t, size_t>
+OriginatorIdTable::getUsage(std::string const& originatorId) const {
+  auto it = ids_.find(originatorId);
+  if (it == ids_.end()) {
+    return {0, 0};
+  }
+  auto const& entry = entries_[it->second];
+  return {entry.refCount, entry.bytes};
+}
+
+std::unordered_map<std::string, int64_t>
+OriginatorIdTable::getHashes() const {
+  std::unordered_map<std::string, int64_t> hashes;
+  hashes.reserve(ids_.size());
+  for (auto const& kv : ids_) {
+    hashes.emplace(kv.first, entries_[kv.second].hash);
+  }
+  return hashes;
+}
+
+KvStoreValuePool::KvStoreValuePool() : state_(std::make_shared<State>()) {}
+
+std::shared_ptr<const std::string>
+KvStoreValuePool::get(std::string const& value) {
+  const auto hash = std::hash<std::string>{}(value);
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  auto range = state_->values.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    auto pooled = it->second.lock();
+    if (pooled and *pooled == value) {
+      return pooled;
+    }
+  }
+
+  // the last entry to drop the value takes it out of the pool. It may have
+  // been taken over by a new instance already, only expired ones go
+  std::shared_ptr<const std::string> pooled(
+      new std::string(value),
+      [state = std::weak_ptr<State>(state_), hash](std::string const* value) {
+        if (auto locked = state.lock()) {
+          std::lock_guard<std::mutex> lock(locked->mutex);
+          auto range = locked->values.equal_range(hash);
+          for (auto it = range.first; it != range.second;) {
+            it = it->second.expired() ? locked->values.erase(it) : ++it;
+          }
+          locked->bytes -= value->size();
+        }
+        delete value;
+      });
+  state_->values.emplace(hash, pooled);
+  state_->bytes += value.size();
+  return pooled;
+}
+
+std::pair<size_t, size_t>
+KvStoreValuePool::getUsage() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return {state_->values.size(), state_->bytes};
+}
+
+KvStoreMap::KvStoreMap(
+    thrift::HashVersion hashVersion,
+    std::shared_ptr<KvStoreValuePool> valuePool)
+    : hashVersion_(hashVersion),
+      valuePool_(std::move(valuePool)),
+      bucketHeads_(Constants::kKvStoreSyncBuckets, kNoSlot),
+      bucketHashes_(Constants::kKvStoreSyncBuckets, 0) {
+  static_assert(
+      Constants::kKvStoreSyncBuckets <= std::numeric_limits<uint16_t>::max(),
+      "sync buckets must fit KvStoreValue::bucket");
+}
+
+KvStoreMap::KvStoreMap(
+    std::unordered_map<std::string, thrift::Value> const& keyVals,
+    thrift::HashVersion hashVersion)
+    : KvStoreMap(hashVersion) {
+  ids_.reserve(keyVals.size());
+  for (auto const& kv : keyVals) {
+    set(kv.first, kv.second);
+  }
+}
+
+KvStoreValue const*
+KvStoreMap::find(std::string const& key) const {
+  auto it = ids_.find(key);
+  return it == ids_.end() ? nullptr : &getSlot(it->second).entry->second;
+}
+
+KvStoreValue*
+KvStoreMap::find(std::string const& key) {
+  auto it = ids_.find(key);
+  return it == ids_.end() ? nullptr : &getSlot(it->second).entry->second;
+}
+
+KvStoreValue&
+KvStoreMap::set(std::string const& key, thrift::Value const& value) {
+  // take the new reference first, the originator may not change
+  const auto bytes = getEntryBytes(key, value);
+  const auto originatorId = originatorIds_.acquire(value.originatorId, bytes);
+  auto it = ids_.find(key);
+  KvStoreValue* entryPtr{nullptr};
+  if (it == ids_.end()) {
+    const auto id = allocateSlot();
+    auto& slotEntry = getSlot(id).entry.emplace(key, KvStoreValue{});
+    ids_.emplace(slotEntry.first, id);
+    entryPtr = &slotEntry.second;
+    entryPtr->bucket = getBucket(key);
+    entryPtr->keyClass = getKeyClass(key);
+    keyClassUsage_[entryPtr->keyClass].first++;
+    linkToBucket(id);
+    addedIds_.emplace_back(id);
+    maybeUpdateKeyIndex();
+  } else {
+    entryPtr = &getSlot(it->second).entry->second;
+    const auto oldBytes = getEntryBytes(key, *entryPtr);
+    const auto oldHash = getBucketHash(key, entryPtr->hash);
+    originatorIds_.toggleHash(entryPtr->originatorId, oldHash);
+    originatorIds_.release(entryPtr->originatorId, oldBytes);
+    bytes_ -= oldBytes;
+    keyClassUsage_[entryPtr->keyClass].second -= oldBytes;
+    bucketHashes_[entryPtr->bucket] ^= oldHash;
+  }
+  bytes_ += bytes;
+  keyClassUsage_[entryPtr->keyClass].second += bytes;
+
+  auto& entry = *entryPtr;
+  entry.version = value.version;
+  entry.ttl = value.ttl;
+  entry.ttlVersion = value.ttlVersion;
+  entry.originatorId = originatorId;
+  entry.hasValue = value.value.has_value();
+  if (entry.hasValue) {
+    entry.value = valuePool_
+        ? valuePool_->get(value.value.value())
+        : std::make_shared<const std::string>(value.value.value());
+  } else {
+    entry.value.reset();
+  }
+  entry.hash = value.hash.has_value()
+      ? value.hash.value()
+      : generateHash(
+            value.version, value.originatorId, value.value, hashVersion_);
+  const auto entryHash = getBucketHash(key, entry.hash);
+  bucketHashes_[entry.bucket] ^= entryHash;
+  originatorIds_.toggleHash(originatorId, entryHash);
+  return entry;
+}
+
+bool
+KvStoreMap::erase(std::string const& key) {
+  auto it = ids_.find(key);
+  if (it == ids_.end()) {
+    return false;
+  }
+  const auto id = it->second;
+  auto& slot = getSlot(id);
+  auto const& entry = slot.entry->second;
+  const auto bytes = getEntryBytes(key, entry);
+  const auto entryHash = getBucketHash(key, entry.hash);
+  originatorIds_.toggleHash(entry.originatorId, entryHash);
+  originatorIds_.release(entry.originatorId, bytes);
+  bytes_ -= bytes;
+  auto& keyClassUsage = keyClassUsage_[entry.keyClass];
+  keyClassUsage.first--;
+  keyClassUsage.second -= bytes;
+  bucketHashes_[entry.bucket] ^= entryHash;
+  unlinkFromBucket(id);
+  // the key of the slot backs the view in ids_, drop the latter first
+  ids_.erase(it);
+  slot.entry.reset();
+  erasedIds_.emplace_back(id);
+  maybeUpdateKeyIndex();
+  return true;
+}
+
+KvStoreMap::SlotId
+KvStoreMap::allocateSlot() {
+  if (not freeSlots_.empty()) {
+    const auto id = freeSlots_.back();
+    freeSlots_.pop_back();
+    return id;
+  }
+  CHECK_LT(numSlots_, kNoSlot) << "out of KvStoreMap slots";
+  if (numSlots_ % kSlotsPerChunk == 0) {
+    chunks_.emplace_back(std::make_unique<Slot[]>(kSlotsPerChunk));
+  }
+  return numSlots_++;
+}
+
+void
+KvStoreMap::linkToBucket(SlotId id) {
+  auto& slot = getSlot(id);
+  auto& head = bucketHeads_[slot.entry->second.bucket];
+  slot.prevInBucket = kNoSlot;
+  slot.nextInBucket = head;
+  if (head != kNoSlot) {
+    getSlot(head).prevInBucket = id;
+  }
+  head = id;
+}
+
+void
+KvStoreMap::unlinkFromBucket(SlotId id) {
+  auto& slot = getSlot(id);
+  if (slot.prevInBucket != kNoSlot) {
+    getSlot(slot.prevInBucket).nextInBucket = slot.nextInBucket;
+  } else {
+    bucketHeads_[slot.entry->second.bucket] = slot.nextInBucket;
+  }
+  if (slot.nextInBucket != kNoSlot) {
+    getSlot(slot.nextInBucket).prevInBucket = slot.prevInBucket;
+  }
+  slot.prevInBucket = kNoSlot;
+  slot.nextInBucket = kNoSlot;
+}
+
+void
+KvStoreMap::updateKeyIndex() const {
+  if (addedIds_.empty() and erasedIds_.empty()) {
+    return;
+  }
+  auto isFree = [this](SlotId id) { return not getSlot(id).entry; };
+  auto keyLess = [this](SlotId lhs, SlotId rhs) {
+    return getSlot(lhs).entry->first < getSlot(rhs).entry->first;
+  };
+  sortedIds_.erase(
+      std::remove_if(sortedIds_.begin(), sortedIds_.end(), isFree),
+      sortedIds_.end());
+  addedIds_.erase(
+      std::remove_if(addedIds_.begin(), addedIds_.end(), isFree),
+      addedIds_.end());
+  std::sort(addedIds_.begin(), addedIds_.end(), keyLess);
+  const auto numSorted = sortedIds_.size();
+  sortedIds_.insert(sortedIds_.end(), addedIds_.begin(), addedIds_.end());
+  std::inplace_merge(
+      sortedIds_.begin(),
+      sortedIds_.begin() + numSorted,
+      sortedIds_.end(),
+      keyLess);
+  addedIds_.clear();
+
+  // nothing refers to erased slots any more
+  freeSlots_.insert(freeSlots_.end(), erasedIds_.begin(), erasedIds_.end());
+  erasedIds_.clear();
+}
+
+void
+KvStoreMap::maybeUpdateKeyIndex() {
+  // merging is linear in the store size, amortized over as many changes
+  const auto backlog = addedIds_.size() + erasedIds_.size();
+  if (backlog >= std::max(kMinKeyIndexBacklog, sortedIds_.size() / 2)) {
+    updateKeyIndex();
+  }
+}
+
+void
+KvStoreMap::setKeyClasses(std::vector<std::string> markers) {
+  CHECK_LT(markers.size(), std::numeric_limits<uint8_t>::max())
+      << "too many key classes";
+  keyClassNames_.clear();
+  for (auto const& marker : markers) {
+    auto name = folly::StringPiece(marker);
+    name.removeSuffix(':');
+    keyClassNames_.emplace_back(name.str());
+  }
+  keyClassNames_.emplace_back("other");
+  keyClassMarkers_ = std::move(markers);
+
+  keyClassUsage_.assign(keyClassNames_.size(), {0, 0});
+  for (auto const& kv : ids_) {
+    auto& entry = getSlot(kv.second).entry->second;
+    auto const& key = getSlot(kv.second).entry->first;
+    entry.keyClass = getKeyClass(key);
+    auto& keyClassUsage = keyClassUsage_[entry.keyClass];
+    keyClassUsage.first++;
+    keyClassUsage.second += getEntryBytes(key, entry);
+  }
+}
+
+uint8_t
+KvStoreMap::getKeyClass(std::string const& key) const {
+  for (size_t i = 0; i < keyClassMarkers_.size(); ++i) {
+    auto const& marker = keyClassMarkers_[i];
+    if (key.compare(0, marker.size(), marker) == 0) {
+      return i;
+    }
+  }
+  return keyClassMarkers_.size();
+}
+
+void
+KvStoreMap::forEachWithPrefix(
+    std::string const& prefix,
+    folly::FunctionRef<void(std::string const&, KvStoreValue const&)> fn)
+    const {
+  updateKeyIndex();
+  auto it = std::lower_bound(
+      sortedIds_.begin(),
+      sortedIds_.end(),
+      prefix,
+      [this](SlotId id, std::string const& key) {
+        return getSlot(id).entry->first < key;
+      });
+  for (; it != sortedIds_.end(); ++it) {
+    auto const& entry = *getSlot(*it).entry;
+    if (entry.first.compare(0, prefix.size(), prefix) != 0) {
+      break;
+    }
+    fn(entry.first, entry.second);
+  }
+}
+
+bool
+KvStoreMap::forEachWithPrefixAfter(
+    std::string const& prefix,
+    std::string const& startAfterKey,
+    folly::FunctionRef<bool(std::string const&, KvStoreValue const&)> fn)
+    const {
+  updateKeyIndex();
+  auto it = startAfterKey < prefix
+      ? std::lower_bound(
+            sortedIds_.begin(),
+            sortedIds_.end(),
+            prefix,
+            [this](SlotId id, std::string const& key) {
+              return getSlot(id).entry->first < key;
+            })
+      : std::upper_bound(
+            sortedIds_.begin(),
+            sortedIds_.end(),
+            startAfterKey,
+            [this](std::string const& key, SlotId id) {
+              return key < getSlot(id).entry->first;
+            });
+  for (; it != sortedIds_.end(); ++it) {
+    auto const& entry = *getSlot(*it).entry;
+    if (entry.first.compare(0, prefix.size(), prefix) != 0) {
+      break;
+    }
+    if (not fn(entry.first, entry.second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+KvStoreMap::forEachInBucket(
+    uint16_t bucket,
+    folly::FunctionRef<void(std::string const&, KvStoreValue const&)> fn)
+    const {
+  for (auto id = bucketHeads_.at(bucket); id != kNoSlot;
+       id = getSlot(id).nextInBucket) {
+    auto const& entry = *getSlot(id).entry;
+    fn(entry.first, entry.second);
+  }
+}
+
+thrift::Value
+KvStoreMap::toThriftValue(KvStoreValue const& value) const {
+  auto thriftValue = toThriftHash(value);
+  if (value.hasValue) {
+    thriftValue.value = *value.value;
+  }
+  return thriftValue;
+}
+
+thrift::Value
+KvStoreMap::toThriftHash(KvStoreValue const& value) const {
+  thrift::Value thriftValue;
+  thriftValue.version = value.version;
+  thriftValue.originatorId = getOriginatorId(value);
+  thriftValue.ttl = value.ttl;
+  thriftValue.ttlVersion = value.ttlVersion;
+  thriftValue.hash = value.hash;
+  return thriftValue;
+}
+
+std::unordered_map<std::string, thrift::Value>
+KvStoreMap::toThriftMap() const {
+  std::unordered_map<std::string, thrift::Value> keyVals;
+  keyVals.reserve(size());
+  for (auto const& kv : *this) {
+    keyVals.emplace(kv.first, toThriftValue(kv.second));
+  }
+  return keyVals;
+}
+
+// static
+uint16_t
+KvStoreMap::getBucket(std::string const& key) {
+  // buckets get compared across nodes, the hash must not depend on the
+  // platform or library version, hence the fixed SpookyHashV2 and seed
+  const uint64_t hash = folly::hash::SpookyHashV2::Hash64(
+      key.data(), key.size(), Constants::kKvStoreSyncBucketSeed);
+  return hash % Constants::kKvStoreSyncBuckets;
+}
+
+// static
+int64_t
+KvStoreMap::getBucketHash(std::string const& key, int64_t hash) {
+  // buckets are hashed by XOR of their entries, thus independent of the
+  // order keys got added in. Fixed across nodes like getBucket(), with the
+  // integers fed in little endian
+  const uint64_t keySize = folly::Endian::little<uint64_t>(key.size());
+  const int64_t valueHash = folly::Endian::little(hash);
+  uint64_t hash1 = Constants::kKvStoreSyncBucketSeed;
+  uint64_t hash2 = Constants::kKvStoreSyncBucketSeed;
+  folly::hash::SpookyHashV2 spooky;
+  spooky.Init(hash1, hash2);
+  spooky.Update(&keySize, sizeof(keySize));
+  spooky.Update(key.data(), key.size());
+  spooky.Update(&valueHash, sizeof(valueHash));
+  spooky.Final(&hash1, &hash2);
+  return static_cast<int64_t>(hash1);
+}
+
+} // namespace openr
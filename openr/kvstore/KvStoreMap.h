@@ -0,0 +1,455 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Function.h>
+#include <folly/container/F14Map.h>
+
+#include <openr/if/gen-cpp2/KvStore_types.h>
+
+namespace openr {
+
+/**
+ * Interned originator IDs. In large areas there are orders of magnitude
+ * more keys than originators, so entries refer to their originator by a
+ * small id instead of carrying a copy of its name. IDs are ref counted and
+ * reused once no entry refers to them any more.
+ */
+class OriginatorIdTable {
+ public:
+  using Id = uint32_t;
+
+  // id of originatorId, taking a reference for an entry of given bytes
+  Id acquire(std::string const& originatorId, size_t bytes = 0);
+
+  // drop a reference taken by acquire()
+  void release(Id id, size_t bytes = 0);
+
+  std::string const&
+  get(Id id) const {
+    return entries_[id].originatorId;
+  }
+
+  // number of references to originatorId and bytes of their entries, zero
+  // if it isn't referenced
+  std::pair<size_t, size_t> getUsage(std::string const& originatorId) const;
+
+  // add or remove the hash of an entry to or from the originator's hash.
+  // Hashes are combined by XOR, toggling the same hash twice does nothing
+  void
+  toggleHash(Id id, int64_t hash) {
+    entries_.at(id).hash ^= hash;
+  }
+
+  // hash of the entries of every referenced originator ID
+  std::unordered_map<std::string, int64_t> getHashes() const;
+
+  // number of originator IDs referenced
+  size_t
+  size() const {
+    return ids_.size();
+  }
+
+ private:
+  struct Entry {
+    std::string originatorId;
+    uint32_t refCount{0};
+    size_t bytes{0};
+    int64_t hash{0};
+  };
+
+  std::vector<Entry> entries_;
+  std::vector<Id> freeIds_;
+  folly::F14FastMap<std::string, Id> ids_;
+};
+
+/**
+ * Values shared by the stores of all areas of a KvStore. Keys like node level
+ * prefixes get advertised into several areas, their values are held once
+ * however many areas store them. Values are ref counted by the entries
+ * holding them and leave the pool along with the last one.
+ *
+ * Thread safe, areas may run on threads of their own.
+ */
+class KvStoreValuePool {
+ public:
+  KvStoreValuePool();
+
+  // shared instance of value, added to the pool unless it holds one already
+  std::shared_ptr<const std::string> get(std::string const& value);
+
+  // number of distinct values and their bytes
+  std::pair<size_t, size_t> getUsage() const;
+
+ private:
+  struct State {
+    mutable std::mutex mutex;
+    // values by hash of their content
+    std::unordered_multimap<size_t, std::weak_ptr<const std::string>> values;
+    size_t bytes{0};
+  };
+
+  // values remove themselves, for as long as the pool still exists
+  std::shared_ptr<State> state_;
+};
+
+/**
+ * Compact form of thrift::Value as stored by KvStoreMap. Stored values always
+ * have a hash, presence of the value itself is kept in a flag rather than an
+ * optional wrapper. The value is immutable and ref counted, so that views of
+ * the store can share it with the store rather than copy it.
+ */
+struct KvStoreValue {
+  int64_t version{0};
+  int64_t ttl{0};
+  int64_t ttlVersion{0};
+  int64_t hash{0};
+  OriginatorIdTable::Id originatorId{0};
+  // sync bucket of the key
+  uint16_t bucket{0};
+  // class of the key, see KvStoreMap::setKeyClasses()
+  uint8_t keyClass{0};
+  bool hasValue{false};
+  // nullptr if hasValue is false
+  std::shared_ptr<const std::string> value;
+
+  // value, empty if there is none
+  std::string const&
+  getValue() const {
+    static const std::string kEmptyValue;
+    return value ? *value : kEmptyValue;
+  }
+};
+
+/**
+ * Key-value store of a KvStore area. Entries live in slots allocated in
+ * chunks, which never move, and are found through a flat hash map of views
+ * of their keys. Keys are stored once, originator IDs are interned and values
+ * compact. Values are converted to thrift::Value only when they leave the
+ * store.
+ *
+ * Keys are hashed into a fixed number of buckets, and the map maintains a
+ * hash of every bucket over its (key, hash) pairs, and likewise of every
+ * originator. Two stores holding the same values have the same bucket and
+ * originator hashes, which lets full-sync narrow down the keys to exchange
+ * without comparing every one of them. The entries of every bucket are
+ * linked into a list, so differing buckets are dumped without a walk over
+ * the whole store.
+ *
+ * A sorted index of slot ids serves lookups by key prefix, so filtered dumps
+ * take time in the number of matching keys rather than the store size. Keys
+ * added or erased since the last lookup get merged into it lazily.
+ *
+ * Keys are also classified by the marker they start with, e.g. adjacency or
+ * prefix keys, and the number and bytes of the entries of every class are
+ * maintained along with the entries, so counters never walk the store.
+ */
+class KvStoreMap {
+ public:
+  using value_type = std::pair<const std::string, KvStoreValue>;
+
+  // handle of an entry, valid for as long as the entry exists
+  using SlotId = uint32_t;
+
+  // iterates entries in slot order
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = KvStoreMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type const*;
+    using reference = value_type const&;
+
+    reference
+    operator*() const {
+      return *map_->getSlot(id_).entry;
+    }
+
+    pointer
+    operator->() const {
+      return &**this;
+    }
+
+    const_iterator&
+    operator++() {
+      ++id_;
+      skipFreeSlots();
+      return *this;
+    }
+
+    const_iterator
+    operator++(int) {
+      auto it = *this;
+      ++*this;
+      return it;
+    }
+
+    bool
+    operator==(const_iterator const& other) const {
+      return id_ == other.id_;
+    }
+
+    bool
+    operator!=(const_iterator const& other) const {
+      return id_ != other.id_;
+    }
+
+   private:
+    friend class KvStoreMap;
+
+    const_iterator(KvStoreMap const* map, SlotId id) : map_(map), id_(id) {
+      skipFreeSlots();
+    }
+
+    void
+    skipFreeSlots() {
+      while (id_ < map_->numSlots_ and not map_->getSlot(id_).entry) {
+        ++id_;
+      }
+    }
+
+    KvStoreMap const* map_{nullptr};
+    SlotId id_{0};
+  };
+
+  // hashVersion is what hashes of values set without one get generated with.
+  // Values get shared through valuePool, if any
+  explicit KvStoreMap(
+      thrift::HashVersion hashVersion = thrift::HashVersion::V1,
+      std::shared_ptr<KvStoreValuePool> valuePool = nullptr);
+
+  // store of the given key-values
+  explicit KvStoreMap(
+      std::unordered_map<std::string, thrift::Value> const& keyVals,
+      thrift::HashVersion hashVersion = thrift::HashVersion::V1);
+
+  // keys are views of the slots, which a move keeps in place
+  KvStoreMap(KvStoreMap const&) = delete;
+  KvStoreMap& operator=(KvStoreMap const&) = delete;
+  KvStoreMap(KvStoreMap&&) = default;
+
+  thrift::HashVersion
+  getHashVersion() const {
+    return hashVersion_;
+  }
+
+  size_t
+  size() const {
+    return ids_.size();
+  }
+
+  bool
+  empty() const {
+    return ids_.empty();
+  }
+
+  const_iterator
+  begin() const {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator
+  end() const {
+    return const_iterator(this, numSlots_);
+  }
+
+  // entry of key, nullptr if there is none
+  KvStoreValue const* find(std::string const& key) const;
+  KvStoreValue* find(std::string const& key);
+
+  // set key to value, replacing an existing entry. Generates the hash if the
+  // value does not carry one
+  KvStoreValue& set(std::string const& key, thrift::Value const& value);
+
+  // returns false if there was no such key
+  bool erase(std::string const& key);
+
+  // call fn on every entry whose key starts with prefix, in key order
+  void forEachWithPrefix(
+      std::string const& prefix,
+      folly::FunctionRef<void(std::string const&, KvStoreValue const&)> fn)
+      const;
+
+  // same as above for keys sorting after startAfterKey only, until fn
+  // returns false. Returns false if fn stopped it
+  bool forEachWithPrefixAfter(
+      std::string const& prefix,
+      std::string const& startAfterKey,
+      folly::FunctionRef<bool(std::string const&, KvStoreValue const&)> fn)
+      const;
+
+  // call fn on every entry of sync bucket, in no particular order
+  void forEachInBucket(
+      uint16_t bucket,
+      folly::FunctionRef<void(std::string const&, KvStoreValue const&)> fn)
+      const;
+
+  std::string const&
+  getOriginatorId(KvStoreValue const& value) const {
+    return originatorIds_.get(value.originatorId);
+  }
+
+  size_t
+  getNumOriginatorIds() const {
+    return originatorIds_.size();
+  }
+
+  // bytes of keys and values of all entries
+  size_t
+  getBytes() const {
+    return bytes_;
+  }
+
+  // number of entries of originatorId and bytes of their keys and values
+  std::pair<size_t, size_t>
+  getOriginatorUsage(std::string const& originatorId) const {
+    return originatorIds_.getUsage(originatorId);
+  }
+
+  // bytes an entry of key and value accounts for
+  static size_t
+  getEntryBytes(std::string const& key, thrift::Value const& value) {
+    return key.size() + (value.value.has_value() ? value.value->size() : 0);
+  }
+
+  static size_t
+  getEntryBytes(std::string const& key, KvStoreValue const& value) {
+    return key.size() + value.getValue().size();
+  }
+
+  // classify keys by the first of markers they start with, keys starting
+  // with none of them fall into the last class, "other". Classes are named
+  // after their marker without trailing ':'. Existing entries get
+  // reclassified
+  void setKeyClasses(std::vector<std::string> markers);
+
+  // class of key, index into getKeyClassNames()
+  uint8_t getKeyClass(std::string const& key) const;
+
+  std::vector<std::string> const&
+  getKeyClassNames() const {
+    return keyClassNames_;
+  }
+
+  // number of entries and bytes of their keys and values, by key class
+  std::vector<std::pair<size_t, size_t>> const&
+  getKeyClassUsage() const {
+    return keyClassUsage_;
+  }
+
+  // full thrift::Value of an entry
+  thrift::Value toThriftValue(KvStoreValue const& value) const;
+
+  // thrift::Value of an entry without the value itself, as used for hash
+  // dumps
+  thrift::Value toThriftHash(KvStoreValue const& value) const;
+
+  // all entries as thrift map
+  std::unordered_map<std::string, thrift::Value> toThriftMap() const;
+
+  // sync bucket a key falls into
+  static uint16_t getBucket(std::string const& key);
+
+  // hash of every sync bucket, Constants::kKvStoreSyncBuckets of them
+  std::vector<int64_t> const&
+  getBucketHashes() const {
+    return bucketHashes_;
+  }
+
+  // hash of the entries of every originator, over the same (key, hash)
+  // pairs as bucket hashes. Two stores holding the same values of an
+  // originator have the same hash for it
+  std::unordered_map<std::string, int64_t>
+  getOriginatorHashes() const {
+    return originatorIds_.getHashes();
+  }
+
+ private:
+  static constexpr SlotId kNoSlot{std::numeric_limits<SlotId>::max()};
+  static constexpr size_t kSlotsPerChunk{256};
+  // changes to the key index merged at once at least, see updateKeyIndex()
+  static constexpr size_t kMinKeyIndexBacklog{64};
+
+  struct Slot {
+    // empty if the slot is free
+    std::optional<value_type> entry;
+    // neighbours in the list of entries of the same sync bucket
+    SlotId prevInBucket{kNoSlot};
+    SlotId nextInBucket{kNoSlot};
+  };
+
+  Slot&
+  getSlot(SlotId id) {
+    return chunks_[id / kSlotsPerChunk][id % kSlotsPerChunk];
+  }
+
+  Slot const&
+  getSlot(SlotId id) const {
+    return chunks_[id / kSlotsPerChunk][id % kSlotsPerChunk];
+  }
+
+  // free slot to hold a new entry
+  SlotId allocateSlot();
+
+  void linkToBucket(SlotId id);
+  void unlinkFromBucket(SlotId id);
+
+  // merge keys added and erased since the last call into sortedIds_. Slots
+  // of erased entries get reused only then, as sortedIds_ may still refer
+  // to them
+  void updateKeyIndex() const;
+
+  // same as above if enough changes piled up, which bounds the memory of
+  // stores never looked up by prefix
+  void maybeUpdateKeyIndex();
+
+  // contribution of an entry to the hash of its bucket
+  static int64_t getBucketHash(std::string const& key, int64_t hash);
+
+  const thrift::HashVersion hashVersion_{thrift::HashVersion::V1};
+  const std::shared_ptr<KvStoreValuePool> valuePool_;
+
+  // slots in chunks of kSlotsPerChunk, the first numSlots_ of them handed
+  // out. Chunks are kept once allocated, free slots get reused
+  std::vector<std::unique_ptr<Slot[]>> chunks_;
+  SlotId numSlots_{0};
+  // slot of every key, keys are views of the keys of the slots
+  folly::F14FastMap<std::string_view, SlotId> ids_;
+  // first slot of every sync bucket
+  std::vector<SlotId> bucketHeads_;
+
+  // key index, updated lazily by lookups through const methods. Slot ids of
+  // entries in key order, of those added since and of those erased since
+  mutable std::vector<SlotId> sortedIds_;
+  mutable std::vector<SlotId> addedIds_;
+  mutable std::vector<SlotId> erasedIds_;
+  // slots free for reuse
+  mutable std::vector<SlotId> freeSlots_;
+
+  OriginatorIdTable originatorIds_;
+  std::vector<int64_t> bucketHashes_;
+  size_t bytes_{0};
+  // markers of key classes and their names, the latter one longer for
+  // keys matching no marker
+  std::vector<std::string> keyClassMarkers_;
+  std::vector<std::string> keyClassNames_{"other"};
+  std::vector<std::pair<size_t, size_t>> keyClassUsage_{{0, 0}};
+};
+
+} // namespace openr
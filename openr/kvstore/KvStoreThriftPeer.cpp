@@ -0,0 +1,228 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "KvStoreThriftPeer.h"
+
+#include <fb303/ServiceData.h>
+#include <folly/ExceptionString.h>
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <glog/logging.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/OpenrClient.h>
+
+namespace openr {
+
+namespace {
+
+// merge key set into an earlier one waiting to be sent. Both come out of the
+// same KvStore one after the other, so later values are always better
+void
+mergeKeySet(thrift::KeySetParams& params, thrift::KeySetParams&& later) {
+  for (auto& kv : later.keyVals) {
+    auto& value = kv.second;
+    auto it = params.keyVals.find(kv.first);
+    if (not value.value.has_value() and it != params.keyVals.end() and
+        it->second.version == value.version and
+        it->second.originatorId == value.originatorId) {
+      // TTL refresh of a value still waiting
+      it->second.ttl = value.ttl;
+      it->second.ttlVersion = value.ttlVersion;
+      continue;
+    }
+    if (value.value.has_value() and params.ttlUpdates.has_value()) {
+      params.ttlUpdates->erase(kv.first);
+    }
+    params.keyVals[kv.first] = std::move(value);
+  }
+
+  if (not later.ttlUpdates.has_value()) {
+    return;
+  }
+  for (auto& kv : later.ttlUpdates.value()) {
+    auto const& ttlUpdate = kv.second;
+    auto it = params.keyVals.find(kv.first);
+    if (it != params.keyVals.end() and
+        it->second.version == ttlUpdate.version) {
+      it->second.ttl = ttlUpdate.ttl;
+      it->second.ttlVersion = ttlUpdate.ttlVersion;
+      continue;
+    }
+    if (not params.ttlUpdates.has_value()) {
+      params.ttlUpdates = std::unordered_map<std::string, thrift::TtlUpdate>{};
+    }
+    params.ttlUpdates.value()[kv.first] = ttlUpdate;
+  }
+}
+
+} // namespace
+
+std::shared_ptr<thrift::OpenrCtrlCppAsyncClient>
+KvStoreThriftClients::get(
+    folly::EventBase& evb, std::string const& addr, int32_t port) {
+  const auto id = folly::sformat("[{}]:{}", addr, port);
+  auto& weakClient = clients_[id];
+  if (auto client = weakClient.lock()) {
+    return client;
+  }
+
+  std::shared_ptr<thrift::OpenrCtrlCppAsyncClient> client =
+      getOpenrCtrlPlainTextClient(
+          evb,
+          folly::IPAddress(addr),
+          port,
+          Constants::kServiceConnTimeout,
+          Constants::kServiceProcTimeout,
+          folly::AsyncSocket::anyAddress(),
+          maybeIpTos_);
+  weakClient = client;
+  return client;
+}
+
+void
+KvStoreThriftClients::reset(
+    std::string const& addr,
+    int32_t port,
+    thrift::OpenrCtrlCppAsyncClient const* client) {
+  auto it = clients_.find(folly::sformat("[{}]:{}", addr, port));
+  if (it == clients_.end()) {
+    return;
+  }
+  // another peer may have reconnected already
+  auto current = it->second.lock();
+  if (not current or current.get() == client) {
+    clients_.erase(it);
+  }
+}
+
+KvStoreThriftPeer::KvStoreThriftPeer(
+    folly::EventBase* evb,
+    KvStoreThriftClients& clients,
+    std::string area,
+    std::string addr,
+    int32_t port,
+    size_t maxPendingRequests)
+    : evb_(evb),
+      clients_(clients),
+      area_(std::move(area)),
+      addr_(std::move(addr)),
+      port_(port),
+      maxPendingRequests_(maxPendingRequests) {
+  CHECK(evb_);
+  CHECK_GT(maxPendingRequests_, 0);
+}
+
+void
+KvStoreThriftPeer::sendKeySet(thrift::KeySetParams params) {
+  params.solicitResponse = false;
+  if (not waitingKeySets_.empty()) {
+    auto& last = waitingKeySets_.back();
+    if (last.nodeIds == params.nodeIds and
+        last.floodRootId == params.floodRootId) {
+      fb303::fbData->addStatValue(
+          "kvstore.thrift.merged_key_sets", 1, fb303::COUNT);
+      mergeKeySet(last, std::move(params));
+      return;
+    }
+  }
+  waitingKeySets_.emplace_back(std::move(params));
+  sendWaitingKeySets();
+}
+
+bool
+KvStoreThriftPeer::requestFullSync(
+    thrift::KeyDumpParams params, SyncCallback callback) {
+  auto* client = getClient();
+  if (not client) {
+    return false;
+  }
+
+  ++numPendingRequests_;
+  client->semifuture_getKvStoreKeyValsFilteredArea(params, area_)
+      .via(evb_)
+      .thenTry([this,
+                client,
+                alive = std::weak_ptr<bool>(alive_),
+                callback = std::move(callback)](
+                   folly::Try<thrift::Publication>&& pub) mutable {
+        if (not alive.lock()) {
+          return;
+        }
+        --numPendingRequests_;
+        if (pub.hasException()) {
+          onRequestFailure(pub.exception(), client);
+        }
+        callback(std::move(pub));
+        sendWaitingKeySets();
+      });
+  return true;
+}
+
+void
+KvStoreThriftPeer::sendWaitingKeySets() {
+  while (not waitingKeySets_.empty() and
+         numPendingRequests_ < maxPendingRequests_) {
+    auto* client = getClient();
+    if (not client) {
+      // dropped, same as ZMQ floods failing to send. Full-sync repairs it
+      fb303::fbData->addStatValue(
+          "kvstore.thrift.failed_key_sets", waitingKeySets_.size(), fb303::SUM);
+      waitingKeySets_.clear();
+      return;
+    }
+
+    auto params = std::move(waitingKeySets_.front());
+    waitingKeySets_.pop_front();
+    ++numPendingRequests_;
+    fb303::fbData->addStatValue(
+        "kvstore.thrift.sent_key_sets", 1, fb303::COUNT);
+    client->semifuture_setKvStoreKeyVals(params, area_)
+        .via(evb_)
+        .thenTry([this, client, alive = std::weak_ptr<bool>(alive_)](
+                     folly::Try<folly::Unit>&& result) {
+          if (not alive.lock()) {
+            return;
+          }
+          --numPendingRequests_;
+          if (result.hasException()) {
+            fb303::fbData->addStatValue(
+                "kvstore.thrift.failed_key_sets", 1, fb303::SUM);
+            onRequestFailure(result.exception(), client);
+          }
+          sendWaitingKeySets();
+        });
+  }
+}
+
+thrift::OpenrCtrlCppAsyncClient*
+KvStoreThriftPeer::getClient() {
+  if (not client_) {
+    try {
+      client_ = clients_.get(*evb_, addr_, port_);
+    } catch (std::exception const& e) {
+      LOG(ERROR) << "Failed to connect to KvStore of peer at [" << addr_
+                 << "]:" << port_ << ". " << folly::exceptionStr(e);
+    }
+  }
+  return client_.get();
+}
+
+void
+KvStoreThriftPeer::onRequestFailure(
+    folly::exception_wrapper const& ew,
+    thrift::OpenrCtrlCppAsyncClient const* client) {
+  LOG(ERROR) << "Request to KvStore of peer at [" << addr_ << "]:" << port_
+             << " failed. " << ew.what();
+  // other requests of the same client fail as well, reconnect only once
+  clients_.reset(addr_, port_, client);
+  if (client_.get() == client) {
+    client_.reset();
+  }
+}
+
+} // namespace openr
@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include <folly/Function.h>
+#include <folly/Try.h>
+#include <folly/io/async/EventBase.h>
+
+#include <openr/if/gen-cpp2/KvStore_types.h>
+#include <openr/if/gen-cpp2/OpenrCtrlCppAsyncClient.h>
+
+namespace openr {
+
+/**
+ * OpenrCtrl clients of peers, shared by the KvStoreDb of all areas running in
+ * the same thread. Their requests to the same peer are multiplexed over a
+ * single connection. Not thread-safe, all use must be from that thread.
+ */
+class KvStoreThriftClients {
+ public:
+  explicit KvStoreThriftClients(std::optional<int> maybeIpTos = std::nullopt)
+      : maybeIpTos_(maybeIpTos) {}
+
+  // client connected to addr and port, connects if there is none yet.
+  // Throws if the connection can not be set up
+  std::shared_ptr<thrift::OpenrCtrlCppAsyncClient> get(
+      folly::EventBase& evb, std::string const& addr, int32_t port);
+
+  // forget client after it failed, the next get() connects again
+  void reset(
+      std::string const& addr,
+      int32_t port,
+      thrift::OpenrCtrlCppAsyncClient const* client);
+
+ private:
+  const std::optional<int> maybeIpTos_;
+
+  // by addr and port, owned by the peers using them
+  std::unordered_map<
+      std::string,
+      std::weak_ptr<thrift::OpenrCtrlCppAsyncClient>>
+      clients_;
+};
+
+/**
+ * Thrift transport to the KvStore of a peer in one area, an alternative to
+ * the ZMQ ROUTER sockets. Requests go to the OpenrCtrl server of the peer and
+ * are pipelined over a persistent connection.
+ *
+ * Flow control: at most maxPendingRequests are in flight. Key sets beyond
+ * that wait, and waiting ones taking the same flooding path get merged, so
+ * a slow peer receives fewer and larger updates instead of an ever growing
+ * backlog.
+ */
+class KvStoreThriftPeer {
+ public:
+  using SyncCallback = folly::Function<void(folly::Try<thrift::Publication>)>;
+
+  KvStoreThriftPeer(
+      folly::EventBase* evb,
+      KvStoreThriftClients& clients,
+      std::string area,
+      std::string addr,
+      int32_t port,
+      size_t maxPendingRequests);
+
+  // send key-values to the peer
+  void sendKeySet(thrift::KeySetParams params);
+
+  // request full-sync from the peer. Callback gets the response or error,
+  // unless the peer gets destroyed first. False if the peer can not be
+  // connected to
+  bool requestFullSync(thrift::KeyDumpParams params, SyncCallback callback);
+
+  size_t
+  getNumPendingRequests() const {
+    return numPendingRequests_;
+  }
+
+  size_t
+  getNumWaitingKeySets() const {
+    return waitingKeySets_.size();
+  }
+
+ private:
+  // disable copying
+  KvStoreThriftPeer(KvStoreThriftPeer const&) = delete;
+  KvStoreThriftPeer& operator=(KvStoreThriftPeer const&) = delete;
+
+  // send waiting key sets while below maxPendingRequests_
+  void sendWaitingKeySets();
+
+  // client to send the next request with, nullptr if connecting failed
+  thrift::OpenrCtrlCppAsyncClient* getClient();
+
+  // drop the client after a request sent with it failed
+  void onRequestFailure(
+      folly::exception_wrapper const& ew,
+      thrift::OpenrCtrlCppAsyncClient const* client);
+
+  folly::EventBase* const evb_{nullptr};
+  KvStoreThriftClients& clients_;
+  const std::string area_;
+  const std::string addr_;
+  const int32_t port_{0};
+  const size_t maxPendingRequests_{0};
+
+  std::shared_ptr<thrift::OpenrCtrlCppAsyncClient> client_;
+
+  // requests sent and not completed yet
+  size_t numPendingRequests_{0};
+
+  // key sets waiting for requests in flight to complete
+  std::deque<thrift::KeySetParams> waitingKeySets_;
+
+  // expires with the peer, callbacks of requests outliving it are skipped
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
+};
+
+} // namespace openr
@@ -80,7 +80,7 @@ dumpAllWithThriftClientFromMultiple(
     const std::string& area /* thrift::KvStore_constants::kDefaultArea() */) {
   folly::EventBase evb;
   std::vector<folly::SemiFuture<thrift::Publication>> calls;
-  std::unordered_map<std::string, thrift::Value> merged;
+  KvStoreMap merged;
   std::vector<fbzmq::SocketUrl> unreachedUrls;
 
   thrift::KeyDumpParams params;
@@ -161,7 +161,7 @@ dumpAllWithThriftClientFromMultiple(
 
   LOG(INFO) << "Took: " << elapsedTime << "ms to retrieve KvStore snapshot";
 
-  return std::make_pair(merged, unreachedUrls);
+  return std::make_pair(merged.toThriftMap(), unreachedUrls);
 }
 
 } // namespace openr
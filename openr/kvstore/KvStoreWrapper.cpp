@@ -34,7 +34,9 @@ KvStoreWrapper::KvStoreWrapper(
     bool isFloodRoot,
     const std::unordered_set<std::string>& areas,
     std::optional<messaging::RQueue<thrift::PeerUpdateRequest>>
-        peerUpdatesQueue)
+        peerUpdatesQueue,
+    KvStoreOptions options,
+    int zmqHwm)
     : nodeId(nodeId),
       globalCmdUrl(folly::sformat("inproc://{}-kvstore-global-cmd", nodeId)),
       monitorSubmitUrl(folly::sformat("inproc://{}-monitor-submit", nodeId)),
@@ -55,13 +57,14 @@ KvStoreWrapper::KvStoreWrapper(
       monitorSubmitInterval,
       peers,
       std::move(filters),
-      Constants::kHighWaterMark,
+      zmqHwm,
       kvStoreRate,
       ttlDecr,
       enableFloodOptimization,
       isFloodRoot,
       useFloodOptimization,
-      areas);
+      areas,
+      std::move(options));
 }
 
 void
@@ -197,8 +200,7 @@ KvStoreWrapper::recvPublication() {
   if (maybePublication.hasError()) {
     throw std::runtime_error(std::string("recvPublication failed"));
   }
-  auto pub = maybePublication.value();
-  return pub;
+  return *maybePublication.value();
 }
 
 thrift::SptInfos
@@ -43,7 +43,9 @@ class KvStoreWrapper {
       const std::unordered_set<std::string>& areas =
           {openr::thrift::KvStore_constants::kDefaultArea()},
       std::optional<messaging::RQueue<thrift::PeerUpdateRequest>>
-          peerUpdatesQueue = std::nullopt);
+          peerUpdatesQueue = std::nullopt,
+      KvStoreOptions options = {},
+      int zmqHwm = Constants::kHighWaterMark);
 
   ~KvStoreWrapper() {
     stop();
@@ -62,7 +64,7 @@ class KvStoreWrapper {
   /**
    * Get reader for KvStore updates queue
    */
-  messaging::RQueue<thrift::Publication>
+  messaging::RQueue<KvStorePublication>
   getReader() {
     return kvStoreUpdatesQueue_.getReader();
   }
@@ -192,8 +194,8 @@ class KvStoreWrapper {
   apache::thrift::CompactSerializer serializer_;
 
   // Queue for streaming KvStore updates
-  messaging::ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue_;
-  messaging::RQueue<thrift::Publication> kvStoreUpdatesQueueReader_{
+  messaging::ReplicateQueue<KvStorePublication> kvStoreUpdatesQueue_;
+  messaging::RQueue<KvStorePublication> kvStoreUpdatesQueueReader_{
       kvStoreUpdatesQueue_.getReader()};
 
   // Queue for streaming peer updates from LM
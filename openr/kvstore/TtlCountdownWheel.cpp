@@ -0,0 +1,225 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TtlCountdownWheel.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+constexpr size_t TtlCountdownWheel::kSlotBits;
+constexpr size_t TtlCountdownWheel::kSlots;
+constexpr size_t TtlCountdownWheel::kLevels;
+constexpr TtlCountdownWheel::Index TtlCountdownWheel::kNoNode;
+
+TtlCountdownWheel::TtlCountdownWheel(Clock::time_point start)
+    : start_(start) {
+  slots_.fill(kNoNode);
+}
+
+void
+TtlCountdownWheel::schedule(TtlCountdownQueueEntry entry) {
+  Index index;
+  auto it = keys_.find(entry.key);
+  if (it != keys_.end()) {
+    index = it->second;
+    unlink(index);
+  } else {
+    if (freeNodes_.empty()) {
+      CHECK_LT(nodes_.size(), kNoNode) << "Too many TTL countdown entries";
+      index = nodes_.size();
+      nodes_.emplace_back();
+    } else {
+      index = freeNodes_.back();
+      freeNodes_.pop_back();
+    }
+    keys_.emplace(entry.key, index);
+  }
+
+  auto& node = nodes_[index];
+  node.tick = toTick(entry.expiryTime);
+  node.entry = std::move(entry);
+  link(index);
+}
+
+bool
+TtlCountdownWheel::cancel(std::string const& key) {
+  auto it = keys_.find(key);
+  if (it == keys_.end()) {
+    return false;
+  }
+  const auto index = it->second;
+  keys_.erase(it);
+  unlink(index);
+  nodes_[index].entry = TtlCountdownQueueEntry{};
+  freeNodes_.emplace_back(index);
+  return true;
+}
+
+TtlCountdownQueueEntry const*
+TtlCountdownWheel::find(std::string const& key) const {
+  auto it = keys_.find(key);
+  return it == keys_.end() ? nullptr : &nodes_[it->second].entry;
+}
+
+std::vector<TtlCountdownQueueEntry>
+TtlCountdownWheel::expire(Clock::time_point now) {
+  std::vector<TtlCountdownQueueEntry> expired;
+  const int64_t nowTick =
+      std::chrono::floor<std::chrono::milliseconds>(now - start_).count();
+
+  while (currentTick_ <= nowTick) {
+    if (keys_.empty()) {
+      currentTick_ = nowTick + 1;
+      break;
+    }
+
+    // the wheel turns into the next slot of every level whose slot boundary
+    // is reached, higher levels move their nodes down first
+    size_t turning = 0;
+    while (turning + 1 < kLevels and
+           currentTick_ % (int64_t{1} << (kSlotBits * (turning + 1))) == 0) {
+      ++turning;
+    }
+    for (size_t level = turning; level > 0; --level) {
+      cascade(level);
+    }
+
+    // expire all nodes of the current level 0 slot
+    auto& head = slots_[currentTick_ & (kSlots - 1)];
+    while (head != kNoNode) {
+      const auto index = head;
+      auto& node = nodes_[index];
+      unlink(index);
+      keys_.erase(node.entry.key);
+      expired.emplace_back(std::move(node.entry));
+      node.entry = TtlCountdownQueueEntry{};
+      freeNodes_.emplace_back(index);
+    }
+    ++currentTick_;
+
+    // skip ahead to the next turn of the lowest non-empty level, slots up to
+    // there are known to be empty
+    if (levelSizes_[0] == 0) {
+      size_t level = 1;
+      while (level < kLevels and levelSizes_[level] == 0) {
+        ++level;
+      }
+      if (level < kLevels) {
+        const auto bits = kSlotBits * level;
+        const int64_t nextTurn =
+            ((currentTick_ + (int64_t{1} << bits) - 1) >> bits) << bits;
+        currentTick_ = std::min(nextTurn, nowTick + 1);
+      }
+    }
+  }
+  return expired;
+}
+
+std::optional<TtlCountdownWheel::Clock::time_point>
+TtlCountdownWheel::getNextExpiry() const {
+  std::optional<int64_t> nextTick;
+  for (size_t level = 0; level < kLevels; ++level) {
+    auto tick = getNextTick(level);
+    if (tick.has_value() and (not nextTick or *tick < *nextTick)) {
+      nextTick = tick;
+    }
+  }
+  if (not nextTick.has_value()) {
+    return std::nullopt;
+  }
+  return start_ + std::chrono::milliseconds(*nextTick);
+}
+
+int64_t
+TtlCountdownWheel::toTick(Clock::time_point time) const {
+  if (time <= start_) {
+    return 0;
+  }
+  return std::chrono::ceil<std::chrono::milliseconds>(time - start_).count();
+}
+
+void
+TtlCountdownWheel::link(Index index) {
+  auto& node = nodes_[index];
+  // overdue nodes go into the next slot to process, thus expire with the
+  // next tick
+  const int64_t tick = std::max(node.tick, currentTick_);
+
+  // lowest level whose current turn covers tick. Nodes beyond the range of
+  // the top level wrap around and get linked again once reached
+  size_t level = 0;
+  while (level + 1 < kLevels and
+         (tick >> (kSlotBits * (level + 1))) !=
+             (currentTick_ >> (kSlotBits * (level + 1)))) {
+    ++level;
+  }
+
+  node.slot = level * kSlots + ((tick >> (kSlotBits * level)) & (kSlots - 1));
+  node.prev = kNoNode;
+  node.next = slots_[node.slot];
+  if (node.next != kNoNode) {
+    nodes_[node.next].prev = index;
+  }
+  slots_[node.slot] = index;
+  ++levelSizes_[level];
+}
+
+void
+TtlCountdownWheel::unlink(Index index) {
+  auto& node = nodes_[index];
+  if (node.prev != kNoNode) {
+    nodes_[node.prev].next = node.next;
+  } else {
+    slots_[node.slot] = node.next;
+  }
+  if (node.next != kNoNode) {
+    nodes_[node.next].prev = node.prev;
+  }
+  node.prev = kNoNode;
+  node.next = kNoNode;
+  --levelSizes_[node.slot / kSlots];
+}
+
+void
+TtlCountdownWheel::cascade(size_t level) {
+  const auto slot = level * kSlots +
+      ((currentTick_ >> (kSlotBits * level)) & (kSlots - 1));
+  auto index = slots_[slot];
+  slots_[slot] = kNoNode;
+  while (index != kNoNode) {
+    const auto next = nodes_[index].next;
+    --levelSizes_[level];
+    link(index);
+    index = next;
+  }
+}
+
+std::optional<int64_t>
+TtlCountdownWheel::getNextTick(size_t level) const {
+  if (levelSizes_[level] == 0) {
+    return std::nullopt;
+  }
+
+  // slots of level in units of their span, from the first one not processed
+  // yet to the end of the current turn of the level above
+  const auto bits = kSlotBits * level;
+  const int64_t first = (currentTick_ + (int64_t{1} << bits) - 1) >> bits;
+  const int64_t last = ((currentTick_ >> (bits + kSlotBits)) + 1) << kSlotBits;
+  for (int64_t n = first; n < last; ++n) {
+    if (slots_[level * kSlots + (n & (kSlots - 1))] != kNoNode) {
+      return n << bits;
+    }
+  }
+
+  // only wrapped around nodes of the top level remain
+  return first << bits;
+}
+
+} // namespace openr
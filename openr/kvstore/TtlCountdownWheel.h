@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <folly/container/F14Map.h>
+
+namespace openr {
+
+struct TtlCountdownQueueEntry {
+  std::chrono::steady_clock::time_point expiryTime;
+  std::string key;
+  int64_t version{0};
+  int64_t ttlVersion{0};
+  std::string originatorId;
+};
+
+/**
+ * TTL countdown of KvStore keys as hierarchical timing wheel with millisecond
+ * ticks. Every key has at most one entry, scheduling a key again moves its
+ * entry in O(1) instead of adding another one, so memory is bound by the
+ * number of keys with finite TTL. Entries are kept in a node pool which is
+ * reused once keys expire, hence steady state refreshes do not allocate.
+ *
+ * Each level has kSlots slots, a slot of level L spanning kSlots^L ticks.
+ * Entries move down a level whenever the wheel turns into their slot and
+ * expire from the slots of level 0.
+ */
+class TtlCountdownWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit TtlCountdownWheel(Clock::time_point start = Clock::now());
+
+  // schedule expiry of entry.key, replacing its previous entry
+  void schedule(TtlCountdownQueueEntry entry);
+
+  // returns false if key has no entry
+  bool cancel(std::string const& key);
+
+  // entry of key, nullptr if there is none
+  TtlCountdownQueueEntry const* find(std::string const& key) const;
+
+  // remove and return entries which expired at or before now, earliest
+  // slot first
+  std::vector<TtlCountdownQueueEntry> expire(Clock::time_point now);
+
+  // time at which expire() needs to be called next, std::nullopt if there
+  // are no entries. May be earlier than the next expiry when entries still
+  // have to move down the wheel
+  std::optional<Clock::time_point> getNextExpiry() const;
+
+  size_t
+  size() const {
+    return keys_.size();
+  }
+
+  bool
+  empty() const {
+    return keys_.empty();
+  }
+
+ private:
+  using Index = uint32_t;
+
+  static constexpr size_t kSlotBits{8};
+  static constexpr size_t kSlots{1 << kSlotBits};
+  static constexpr size_t kLevels{4};
+  static constexpr Index kNoNode{std::numeric_limits<Index>::max()};
+
+  struct Node {
+    TtlCountdownQueueEntry entry;
+    int64_t tick{0};
+    // slot the node is linked into, index into slots_
+    uint32_t slot{0};
+    Index prev{kNoNode};
+    Index next{kNoNode};
+  };
+
+  // first tick at or after time
+  int64_t toTick(Clock::time_point time) const;
+
+  // link node into the slot of its tick
+  void link(Index index);
+
+  void unlink(Index index);
+
+  // move all nodes of the current slot of level down the wheel
+  void cascade(size_t level);
+
+  // tick at which the first non-empty slot of level gets processed,
+  // std::nullopt if level is empty
+  std::optional<int64_t> getNextTick(size_t level) const;
+
+  const Clock::time_point start_;
+
+  // next tick to process, every earlier one has been expired
+  int64_t currentTick_{0};
+
+  std::vector<Node> nodes_;
+  std::vector<Index> freeNodes_;
+
+  // head node of every slot, kSlots per level
+  std::array<Index, kLevels * kSlots> slots_;
+  std::array<size_t, kLevels> levelSizes_{};
+
+  folly::F14FastMap<std::string, Index> keys_;
+};
+
+} // namespace openr
@@ -18,6 +18,7 @@
 #include <openr/if/gen-cpp2/KvStore_types.h>
 #include <openr/kvstore/KvStore.h>
 #include <openr/kvstore/KvStoreWrapper.h>
+#include <openr/tests/BenchmarkUtils.h>
 
 namespace {
 
@@ -46,6 +47,28 @@ genRandomStr(const int len) {
   }
   return s;
 }
+
+/**
+ * Value of given version with a random value and its hash
+ */
+openr::thrift::Value
+genValue(int64_t version, int64_t ttl = openr::Constants::kTtlInfinity) {
+  return openr::createThriftValue(
+      version, "kvStore", genRandomStr(kSizeOfValue), ttl);
+}
+
+/**
+ * Report the rate numKeys keys got processed at in elapsed time
+ */
+void
+setKeysPerSec(
+    folly::UserCounters& counters,
+    uint64_t numKeys,
+    std::chrono::steady_clock::duration elapsed) {
+  const auto us =
+      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  counters["keys_per_sec"] = us > 0 ? numKeys * 1000000 / us : 0;
+}
 } // namespace
 
 namespace openr {
@@ -110,12 +133,14 @@ class KvStoreTestFixture {
  * 2. Randomly choose a newValue for each key
  * 3. Insert (key, newValue)s into update
  * 4. Merge update with kvStore
+ * Adds the time of the merge to elapsed
  */
 void
 updateKvStore(
     const uint32_t numOfUpdateKeys,
     uint64_t& version,
-    std::unordered_map<std::string, thrift::Value>& kvStore) {
+    KvStoreMap& kvStore,
+    std::chrono::steady_clock::duration& elapsed) {
   auto suspender = folly::BenchmarkSuspender();
   std::unordered_map<std::string, thrift::Value> update;
   // Randomly choose the start index of the keys to be updated
@@ -124,9 +149,9 @@ updateKvStore(
       ? kvStore.size() - numOfUpdateKeys
       : offsetIdx;
 
-  for (uint32_t idx = offsetIdx; idx < offsetIdx + numOfUpdateKeys; idx++) {
-    auto kvIt = kvStore.begin();
-    std::advance(kvIt, idx);
+  auto kvIt = kvStore.begin();
+  std::advance(kvIt, offsetIdx);
+  for (uint32_t idx = 0; idx < numOfUpdateKeys; idx++, kvIt++) {
     auto key = kvIt->first;
     auto newValue = genRandomStr(kSizeOfValue);
     thrift::Value thriftValue(
@@ -147,7 +172,9 @@ updateKvStore(
   suspender.dismiss(); // Start measuring benchmark time
 
   // Merge update with kvStore
+  const auto start = std::chrono::steady_clock::now();
   KvStore::mergeKeyValues(kvStore, update);
+  elapsed += std::chrono::steady_clock::now() - start;
 }
 
 /**
@@ -190,6 +217,18 @@ floodingUpdate(
   CHECK_EQ(numOfUpdateKeys, pub.keyVals.size());
 }
 
+/**
+ * Store of numOfKeys random keys with random values of version 1
+ */
+KvStoreMap
+createKvStoreMap(uint32_t numOfKeys, int64_t ttl = 3600) {
+  KvStoreMap kvStore;
+  for (uint32_t idx = 0; idx < numOfKeys; idx++) {
+    kvStore.set(genRandomStr(kSizeOfKey), genValue(1, ttl));
+  }
+  return kvStore;
+}
+
 /**
  * Benchmark for mergeKeyValues():
  * 1. Generate (key, value) pairs, and put them into kvStore
@@ -197,37 +236,110 @@ floodingUpdate(
  */
 static void
 BM_KvStoreMergeKeyValues(
-    uint32_t iters, uint32_t numOfKeysInStore, size_t numOfUpdateKeys) {
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfKeysInStore,
+    size_t numOfUpdateKeys) {
   CHECK_LE(numOfUpdateKeys, numOfKeysInStore);
   auto suspender = folly::BenchmarkSuspender();
-  std::unordered_map<std::string, thrift::Value> kvStore;
+  auto kvStore = createKvStoreMap(numOfKeysInStore);
 
-  // Insert (key, value)s into kvStore
-  uint64_t version = 1;
-  for (uint32_t idx = 0; idx < numOfKeysInStore; idx++) {
-    auto key = genRandomStr(kSizeOfKey);
-    auto value = genRandomStr(kSizeOfValue);
-    thrift::Value thriftValue(
-        apache::thrift::FRAGILE,
-        version, /* version */
-        "kvStore", /* node id */
-        value,
-        3600, /* ttl */
-        0 /* ttl version */,
-        0 /* hash */);
+  // Version starts with 2 since keys aleady in kvStore have a version of 1
+  uint64_t version = 2;
+  std::chrono::steady_clock::duration elapsed{0};
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    updateKvStore(numOfUpdateKeys, version, kvStore, elapsed);
+  }
+  suspender.rehire(); // Stop measuring time again
+  setKeysPerSec(counters, numOfUpdateKeys * iters, elapsed);
+}
 
-    kvStore.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(key),
-        std::forward_as_tuple(thriftValue));
+/**
+ * Benchmark for a storm of TTL refreshes, every key of the store gets one:
+ * - as key-values without value going through mergeKeyValues(), or
+ * - as compact TTL updates going through mergeTtlUpdates()
+ */
+static void
+BM_KvStoreTtlRefresh(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfKeysInStore,
+    bool compact) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStore = createKvStoreMap(numOfKeysInStore);
+
+  std::chrono::steady_clock::duration elapsed{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    std::unordered_map<std::string, thrift::Value> refreshes;
+    std::unordered_map<std::string, thrift::TtlUpdate> ttlUpdates;
+    for (auto const& kv : kvStore) {
+      if (compact) {
+        thrift::TtlUpdate ttlUpdate;
+        ttlUpdate.version = kv.second.version;
+        ttlUpdate.ttlVersion = kv.second.ttlVersion + 1;
+        ttlUpdate.ttl = 3600;
+        ttlUpdate.hash = kv.second.hash;
+        ttlUpdates.emplace(kv.first, std::move(ttlUpdate));
+      } else {
+        refreshes.emplace(
+            kv.first,
+            createThriftValue(
+                kv.second.version,
+                kvStore.getOriginatorId(kv.second),
+                std::nullopt,
+                3600,
+                kv.second.ttlVersion + 1));
+      }
+    }
+
+    suspender.dismiss(); // Start measuring benchmark time
+    const auto start = std::chrono::steady_clock::now();
+    const auto updates = compact
+        ? KvStore::mergeTtlUpdates(kvStore, ttlUpdates)
+        : KvStore::mergeKeyValues(kvStore, refreshes);
+    elapsed += std::chrono::steady_clock::now() - start;
+    suspender.rehire(); // Stop measuring time again
+    CHECK_EQ(numOfKeysInStore, updates.size());
   }
+  setKeysPerSec(counters, numOfKeysInStore * iters, elapsed);
+}
 
-  // Version starts with 2 since keys aleady in kvStore have a version of 1
-  version++;
-  suspender.dismiss(); // Start measuring benchmark time
+/**
+ * Memory of the stores of numOfAreas areas holding the same numOfKeys
+ * key-values each, as with a node in several areas. Reports bytes per key
+ * and per area, which include the key and value themselves
+ */
+static void
+BM_KvStoreMemory(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfAreas,
+    uint32_t numOfKeys) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::unordered_map<std::string, thrift::Value> keyVals;
+  for (uint32_t idx = 0; idx < numOfKeys; idx++) {
+    keyVals.emplace(genRandomStr(kSizeOfKey), genValue(1, 3600));
+  }
+
+  int64_t bytes{0};
   for (uint32_t i = 0; i < iters; i++) {
-    updateKvStore(numOfUpdateKeys, version, kvStore);
+    const auto bytesBefore = getNumLiveHeapBytes();
+    suspender.dismiss();
+    std::vector<KvStoreMap> stores(numOfAreas);
+    for (auto& store : stores) {
+      for (auto const& kv : keyVals) {
+        store.set(kv.first, kv.second);
+      }
+    }
+    suspender.rehire();
+    bytes = getNumLiveHeapBytes() - bytesBefore;
   }
+  const auto numOfEntries = std::max<uint64_t>(1, numOfAreas * numOfKeys);
+  counters["bytes_per_key"] = bytes / numOfEntries;
+  counters["overhead_bytes_per_key"] =
+      bytes / numOfEntries - kSizeOfKey - kSizeOfValue;
+  counters["total_kb"] = bytes / 1024;
 }
 
 /**
@@ -301,15 +413,178 @@ BM_KvStoreFloodingUpdate(uint32_t iters, size_t numOfUpdateKeys) {
   }
 }
 
+/**
+ * Benchmark for the responder side of a full-sync:
+ * 1. Start kvStore with numOfKeysInStore keys
+ * 2. Request the difference to hashes of a peer, of which numOfDiffKeys are
+ *    for older versions, as KvStore does on full-sync
+ */
+static void
+BM_KvStoreFullSync(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfKeysInStore,
+    uint32_t numOfDiffKeys) {
+  CHECK_LE(numOfDiffKeys, numOfKeysInStore);
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  auto kvStore = kvStoreTestFixture->createKvStore("kvStore", {});
+  kvStore->run();
+
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (uint32_t idx = 0; idx < numOfKeysInStore; idx++) {
+    keyVals.emplace_back(genRandomStr(kSizeOfKey), genValue(2));
+  }
+  kvStore->setKeys(keyVals);
+  kvStore->recvPublication();
+
+  // hashes as the peer has them
+  thrift::KeyVals keyValHashes;
+  for (auto& kv : keyVals) {
+    auto& value = kv.second;
+    if (keyValHashes.size() < numOfDiffKeys) {
+      value.version = 1;
+      value.hash =
+          generateHash(value.version, value.originatorId, value.value);
+    }
+    value.value.reset();
+    keyValHashes.emplace(kv.first, value);
+  }
+  keyVals.clear();
+
+  std::chrono::steady_clock::duration elapsed{0};
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto diff = kvStore->syncKeyVals(keyValHashes);
+    elapsed += std::chrono::steady_clock::now() - start;
+    CHECK_EQ(numOfDiffKeys, diff.size());
+  }
+  suspender.rehire(); // Stop measuring time again
+  setKeysPerSec(counters, numOfKeysInStore * iters, elapsed);
+}
+
+/**
+ * Benchmark for flooding to many peers:
+ * 1. Start kvStore and numOfPeers peers of it
+ * 2. Set keys into kvStore, wait until they appear in all peers
+ */
+static void
+BM_KvStoreFloodFanout(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfPeers,
+    uint32_t numOfUpdateKeys) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  auto kvStore = kvStoreTestFixture->createKvStore("kvStore", {});
+  kvStore->run();
+  std::vector<KvStoreWrapper*> peers;
+  for (uint32_t i = 0; i < numOfPeers; i++) {
+    auto peer =
+        kvStoreTestFixture->createKvStore(folly::sformat("peer{}", i), {});
+    peer->run();
+    CHECK(kvStore->addPeer(peer->nodeId, peer->getPeerSpec()));
+    peers.emplace_back(peer);
+  }
+
+  std::vector<std::string> keys;
+  for (uint32_t idx = 0; idx < numOfUpdateKeys; idx++) {
+    keys.emplace_back(genRandomStr(kSizeOfKey));
+  }
+
+  std::chrono::steady_clock::duration elapsed{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    std::vector<std::pair<std::string, thrift::Value>> keyVals;
+    for (auto const& key : keys) {
+      keyVals.emplace_back(key, genValue(i + 1));
+    }
+
+    suspender.dismiss(); // Start measuring benchmark time
+    const auto start = std::chrono::steady_clock::now();
+    kvStore->setKeys(keyVals);
+    for (auto peer : peers) {
+      // updates may arrive split up, wait for all of them
+      std::unordered_set<std::string> received;
+      while (received.size() < numOfUpdateKeys) {
+        for (auto const& kv : peer->recvPublication().keyVals) {
+          if (kv.second.version == static_cast<int64_t>(i + 1)) {
+            received.emplace(kv.first);
+          }
+        }
+      }
+    }
+    elapsed += std::chrono::steady_clock::now() - start;
+    suspender.rehire(); // Stop measuring time again
+    kvStore->recvPublication();
+  }
+  // every key reaching every peer counts
+  setKeysPerSec(counters, numOfUpdateKeys * numOfPeers * iters, elapsed);
+}
+
 // The first integer parameter is number of keyVals already in store
 // The second integer parameter is the number of keyVals for update
-BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10_10, 10, 10);
-BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 100_10, 100, 10);
-BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 1000_10, 1000, 10);
-BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_10, 10000, 10);
-BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_100, 10000, 100);
-BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_1000, 10000, 1000);
-BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_10000, 10000, 10000);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 10_10, 10, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 100_10, 100, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 1000_10, 1000, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 10000_10, 10000, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 10000_100, 10000, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 10000_1000, 10000, 1000);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 10000_10000, 10000, 10000);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 100000_1000, 100000, 1000);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 1000000_1000, 1000000, 1000);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMergeKeyValues, counters, 1000000_100000, 1000000, 100000);
+
+// The parameter is number of keyVals in store, each one gets refreshed
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreTtlRefresh, counters, 10000, 10000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreTtlRefresh, counters, 100000, 100000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreTtlRefresh, counters, 1000000, 1000000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreTtlRefresh, counters, 10000_compact, 10000, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreTtlRefresh, counters, 100000_compact, 100000, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreTtlRefresh, counters, 1000000_compact, 1000000, true);
+
+// The first integer parameter is number of keyVals in store
+// The second integer parameter is the number of keys the peer has older
+BENCHMARK_COUNTERS_NAME_PARAM(BM_KvStoreFullSync, counters, 10000_0, 10000, 0);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFullSync, counters, 10000_100, 10000, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFullSync, counters, 100000_0, 100000, 0);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFullSync, counters, 100000_1000, 100000, 1000);
+
+// The first integer parameter is number of peers
+// The second integer parameter is the number of keyVals for update
+BENCHMARK_COUNTERS_NAME_PARAM(BM_KvStoreFloodFanout, counters, 1_100, 1, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_KvStoreFloodFanout, counters, 4_100, 4, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodFanout, counters, 16_100, 16, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodFanout, counters, 16_1000, 16, 1000);
+
+// The first integer parameter is number of areas
+// The second integer parameter is the number of keyVals in each area
+BENCHMARK_COUNTERS_NAME_PARAM(BM_KvStoreMemory, counters, 1_10000, 1, 10000);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMemory, counters, 1_100000, 1, 100000);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreMemory, counters, 4_100000, 4, 100000);
 
 // The parameter is number of keyVals already in store
 BENCHMARK_PARAM(BM_KvStoreDumpAll, 10);
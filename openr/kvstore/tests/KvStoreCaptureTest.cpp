@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Util.h>
+#include <openr/kvstore/KvStoreCapture.h>
+
+using namespace openr;
+
+namespace {
+
+thrift::Publication
+createPublication(std::string const& key, std::string const& value) {
+  thrift::Publication publication;
+  publication.keyVals.emplace(key, createThriftValue(1, "node1", value));
+  publication.expiredKeys.emplace_back("expired-" + key);
+  return publication;
+}
+
+} // namespace
+
+TEST(KvStoreCaptureTest, WriteRead) {
+  folly::test::TemporaryFile file;
+  const auto pub1 = createPublication("key1", "value1");
+  const auto pub2 = createPublication("key2", std::string(10000, 'a'));
+  {
+    KvStoreCaptureWriter writer(file.path().string());
+    writer.write(pub1, 100);
+    writer.write(pub2, 200);
+  }
+
+  KvStoreCaptureReader reader(file.path().string());
+  auto record = reader.read();
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ(100, record->timestamp_ms);
+  EXPECT_EQ(pub1, record->publication);
+  record = reader.read();
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ(200, record->timestamp_ms);
+  EXPECT_EQ(pub2, record->publication);
+  EXPECT_FALSE(reader.read().has_value());
+}
+
+TEST(KvStoreCaptureTest, PartialRecord) {
+  folly::test::TemporaryFile file;
+  {
+    KvStoreCaptureWriter writer(file.path().string());
+    writer.write(createPublication("key1", "value1"), 100);
+    writer.write(createPublication("key2", "value2"), 200);
+  }
+
+  // cut the last record short
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(file.path().c_str(), contents));
+  contents.resize(contents.size() - 3);
+  ASSERT_TRUE(folly::writeFile(contents, file.path().c_str()));
+
+  KvStoreCaptureReader reader(file.path().string());
+  auto record = reader.read();
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ(100, record->timestamp_ms);
+  EXPECT_FALSE(reader.read().has_value());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -696,6 +696,114 @@ TEST(KvStoreClientInternal, PersistKeyTest) {
   evbThread.join();
 }
 
+/**
+ * Keys persisted in the same event loop iteration are sent to KvStore in one
+ * request, and hence come out of KvStore in a single publication
+ */
+TEST(KvStoreClientInternal, PersistKeyBatchTest) {
+  fbzmq::Context context;
+  const std::string nodeId{"test_store"};
+  const size_t kNumKeys{16};
+
+  auto store = std::make_shared<KvStoreWrapper>(
+      context,
+      nodeId,
+      std::chrono::seconds(60) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  store->run();
+
+  OpenrEventBase evb;
+  auto client = std::make_shared<KvStoreClientInternal>(
+      &evb, nodeId, store->getKvStore(), std::nullopt);
+
+  evb.scheduleTimeout(std::chrono::milliseconds(0), [&]() noexcept {
+    for (size_t i = 0; i < kNumKeys; ++i) {
+      client->persistKey(
+          folly::sformat("test_key{}", i), "test_value", 60000ms);
+    }
+  });
+
+  std::thread evbThread([&]() { evb.run(); });
+  evb.waitUntilRunning();
+
+  auto pub = store->recvPublication();
+  EXPECT_EQ(kNumKeys, pub.keyVals.size());
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    EXPECT_EQ(1, pub.keyVals.count(folly::sformat("test_key{}", i)));
+  }
+
+  // Stop store
+  store->closeQueue();
+  client.reset();
+  store->stop();
+  store.reset();
+
+  evb.stop();
+  evb.waitUntilStopped();
+  evbThread.join();
+}
+
+/**
+ * Keys persisted together with a budget of one TTL refresh per tick. Excess
+ * refreshes get deferred, none long enough for its key to expire.
+ */
+TEST(KvStoreClientInternal, TtlRefreshBudgetTest) {
+  fbzmq::Context context;
+  const std::string nodeId{"test_store"};
+  const size_t kNumKeys{32};
+
+  auto store = std::make_shared<KvStoreWrapper>(
+      context,
+      nodeId,
+      std::chrono::seconds(60) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  store->run();
+
+  OpenrEventBase evb;
+  auto client = std::make_shared<KvStoreClientInternal>(
+      &evb,
+      nodeId,
+      store->getKvStore(),
+      std::nullopt,
+      0ms,
+      std::vector<std::string>{},
+      1 /* ttl refreshes per tick */);
+
+  evb.scheduleTimeout(std::chrono::milliseconds(0), [&]() noexcept {
+    for (size_t i = 0; i < kNumKeys; ++i) {
+      client->persistKey(folly::sformat("test_key{}", i), "test_value", kTtl);
+    }
+  });
+
+  folly::Baton waitBaton;
+  evb.scheduleTimeout(kTtl * 3, [&]() noexcept {
+    for (size_t i = 0; i < kNumKeys; ++i) {
+      auto maybeVal = store->getKey(folly::sformat("test_key{}", i));
+      EXPECT_TRUE(maybeVal.has_value());
+      if (maybeVal.has_value()) {
+        EXPECT_LT(1, maybeVal->ttlVersion);
+      }
+    }
+    waitBaton.post();
+  });
+
+  std::thread evbThread([&]() { evb.run(); });
+  evb.waitUntilRunning();
+  waitBaton.wait();
+
+  // Stop store
+  store->closeQueue();
+  client.reset();
+  store->stop();
+  store.reset();
+
+  evb.stop();
+  evb.waitUntilStopped();
+  evbThread.join();
+}
+
 /**
  * Test ttl change with persist key while keeping value and version same
  * - Set key with ttl 1s
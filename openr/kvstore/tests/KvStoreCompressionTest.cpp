@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Random.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Util.h>
+#include <openr/kvstore/KvStoreCompression.h>
+
+using namespace openr;
+
+namespace {
+
+std::unordered_map<std::string, thrift::Value>
+getKeyVals() {
+  return {
+      {"small", createThriftValue(1, "node1", std::string(100, 'a'))},
+      {"large", createThriftValue(1, "node1", std::string(10000, 'b'))},
+      {"ttl", createThriftValue(1, "node1", std::nullopt, 100, 1)},
+  };
+}
+
+} // namespace
+
+TEST(KvStoreCompressionTest, CompressDecompress) {
+  for (auto compression : getSupportedCompression()) {
+    const auto keyVals = getKeyVals();
+    auto compressed = keyVals;
+    EXPECT_LT(0, compressValues(compressed, compression, 4096));
+    EXPECT_FALSE(compressed.at("small").compression.has_value());
+    EXPECT_FALSE(compressed.at("ttl").compression.has_value());
+    ASSERT_TRUE(compressed.at("large").compression.has_value());
+    EXPECT_EQ(compression, compressed.at("large").compression.value());
+    EXPECT_GT(10000, compressed.at("large").value->size());
+
+    // compressed only once
+    EXPECT_EQ(0, compressValues(compressed, compression, 4096));
+
+    EXPECT_EQ(0, decompressValues(compressed));
+    EXPECT_EQ(keyVals, compressed);
+  }
+}
+
+TEST(KvStoreCompressionTest, Incompressible) {
+  std::string random;
+  for (int i = 0; i < 10000; ++i) {
+    random.push_back(static_cast<char>(folly::Random::rand32()));
+  }
+  std::unordered_map<std::string, thrift::Value> keyVals = {
+      {"random", createThriftValue(1, "node1", random)},
+  };
+  for (auto compression : getSupportedCompression()) {
+    auto compressed = keyVals;
+    EXPECT_EQ(0, compressValues(compressed, compression, 0));
+    EXPECT_EQ(keyVals, compressed);
+  }
+
+  // no codec for NONE
+  EXPECT_EQ(0, compressValues(keyVals, thrift::CompressionType::NONE, 0));
+  EXPECT_FALSE(keyVals.at("random").compression.has_value());
+}
+
+TEST(KvStoreCompressionTest, DecompressFailure) {
+  for (auto compression : getSupportedCompression()) {
+    auto keyVals = getKeyVals();
+    keyVals.at("large").compression = compression;
+    EXPECT_EQ(1, decompressValues(keyVals));
+    EXPECT_EQ(0, keyVals.count("large"));
+    EXPECT_EQ(2, keyVals.size());
+  }
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,608 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <unordered_set>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Util.h>
+#include <openr/kvstore/KvStore.h>
+#include <openr/kvstore/KvStoreMap.h>
+
+using namespace openr;
+
+TEST(OriginatorIdTableTest, AcquireRelease) {
+  OriginatorIdTable table;
+  const auto id1 = table.acquire("node1");
+  const auto id2 = table.acquire("node2");
+  EXPECT_NE(id1, id2);
+  EXPECT_EQ(id1, table.acquire("node1"));
+  EXPECT_EQ("node1", table.get(id1));
+  EXPECT_EQ("node2", table.get(id2));
+  EXPECT_EQ(2, table.size());
+
+  // node1 is still referenced once
+  table.release(id1);
+  EXPECT_EQ(2, table.size());
+  EXPECT_EQ("node1", table.get(id1));
+
+  table.release(id1);
+  EXPECT_EQ(1, table.size());
+
+  // freed ids get reused
+  EXPECT_EQ(id1, table.acquire("node3"));
+  EXPECT_EQ("node3", table.get(id1));
+  EXPECT_EQ(2, table.size());
+}
+
+TEST(KvStoreMapTest, SetFindErase) {
+  KvStoreMap store;
+  EXPECT_TRUE(store.empty());
+  EXPECT_EQ(nullptr, store.find("key1"));
+
+  store.set("key1", createThriftValue(1, "node1", std::string("value1")));
+  store.set("key2", createThriftValue(1, "node1", std::string("value2")));
+  store.set("key3", createThriftValue(3, "node2", std::string("value3")));
+  EXPECT_EQ(3, store.size());
+  EXPECT_EQ(2, store.getNumOriginatorIds());
+
+  auto const* value = store.find("key3");
+  ASSERT_NE(nullptr, value);
+  EXPECT_EQ(3, value->version);
+  EXPECT_EQ("node2", store.getOriginatorId(*value));
+  EXPECT_TRUE(value->hasValue);
+  EXPECT_EQ("value3", value->getValue());
+
+  // replacing the only key of node2 drops its originator ID
+  store.set("key3", createThriftValue(4, "node1", std::string("value4")));
+  EXPECT_EQ(3, store.size());
+  EXPECT_EQ(1, store.getNumOriginatorIds());
+  EXPECT_EQ("node1", store.getOriginatorId(*store.find("key3")));
+
+  EXPECT_TRUE(store.erase("key1"));
+  EXPECT_FALSE(store.erase("key1"));
+  EXPECT_EQ(2, store.size());
+  EXPECT_EQ(1, store.getNumOriginatorIds());
+
+  EXPECT_TRUE(store.erase("key2"));
+  EXPECT_TRUE(store.erase("key3"));
+  EXPECT_TRUE(store.empty());
+  EXPECT_EQ(0, store.getNumOriginatorIds());
+}
+
+TEST(KvStoreMapTest, ValuePool) {
+  auto pool = std::make_shared<KvStoreValuePool>();
+  KvStoreMap area1(thrift::HashVersion::V1, pool);
+  KvStoreMap area2(thrift::HashVersion::V1, pool);
+
+  // same value in both areas is held once
+  area1.set("key1", createThriftValue(1, "node1", std::string("value1")));
+  area2.set("key1", createThriftValue(1, "node1", std::string("value1")));
+  area2.set("key2", createThriftValue(1, "node1", std::string("value2")));
+  EXPECT_EQ(area1.find("key1")->value, area2.find("key1")->value);
+  EXPECT_EQ((std::make_pair<size_t, size_t>(2, 12)), pool->getUsage());
+
+  // values leave the pool with the last entry holding them
+  area1.erase("key1");
+  EXPECT_EQ((std::make_pair<size_t, size_t>(2, 12)), pool->getUsage());
+  area2.set("key1", createThriftValue(2, "node1", std::string("value3")));
+  EXPECT_EQ((std::make_pair<size_t, size_t>(2, 12)), pool->getUsage());
+  EXPECT_EQ("value3", area2.find("key1")->getValue());
+  area2.erase("key2");
+  EXPECT_EQ((std::make_pair<size_t, size_t>(1, 6)), pool->getUsage());
+}
+
+TEST(KvStoreMapTest, Hash) {
+  KvStoreMap store;
+
+  // hash is generated if missing
+  auto const& value =
+      store.set("key1", createThriftValue(1, "node1", std::string("value1")));
+  EXPECT_EQ(generateHash(1, "node1", std::string("value1")), value.hash);
+
+  // and kept otherwise
+  auto const& hashedValue = store.set(
+      "key2",
+      createThriftValue(
+          1, "node1", std::string("value2"), Constants::kTtlInfinity, 0, 42));
+  EXPECT_EQ(42, hashedValue.hash);
+}
+
+TEST(KvStoreMapTest, ThriftConversion) {
+  std::unordered_map<std::string, thrift::Value> keyVals = {
+      {"key1", createThriftValue(1, "node1", std::string("value1"), 100, 2)},
+      {"key2", createThriftValue(2, "node2", std::string("value2"))},
+  };
+  for (auto& kv : keyVals) {
+    auto& value = kv.second;
+    value.hash = generateHash(value.version, value.originatorId, value.value);
+  }
+
+  KvStoreMap store(keyVals);
+  EXPECT_EQ(2, store.size());
+  EXPECT_EQ(keyVals, store.toThriftMap());
+  EXPECT_EQ(keyVals.at("key1"), store.toThriftValue(*store.find("key1")));
+
+  // hash dump carries everything but the value
+  auto hash = store.toThriftHash(*store.find("key1"));
+  EXPECT_FALSE(hash.value.has_value());
+  EXPECT_EQ(1, hash.version);
+  EXPECT_EQ("node1", hash.originatorId);
+  EXPECT_EQ(100, hash.ttl);
+  EXPECT_EQ(2, hash.ttlVersion);
+  EXPECT_EQ(keyVals.at("key1").hash, hash.hash);
+}
+
+TEST(KvStoreMapTest, BucketHashes) {
+  const std::vector<int64_t> emptyHashes(Constants::kKvStoreSyncBuckets, 0);
+  KvStoreMap storeA;
+  KvStoreMap storeB;
+  EXPECT_EQ(emptyHashes, storeA.getBucketHashes());
+
+  // same content in any order gives the same bucket hashes
+  for (int i = 0; i < 100; ++i) {
+    storeA.set(
+        folly::sformat("key{}", i),
+        createThriftValue(1, "node1", std::string("value")));
+    storeB.set(
+        folly::sformat("key{}", 99 - i),
+        createThriftValue(1, "node1", std::string("value")));
+  }
+  EXPECT_NE(emptyHashes, storeA.getBucketHashes());
+  EXPECT_EQ(storeA.getBucketHashes(), storeB.getBucketHashes());
+
+  // a different value changes exactly the bucket of its key
+  auto const bucketHashes = storeB.getBucketHashes();
+  storeB.set("key7", createThriftValue(2, "node1", std::string("value")));
+  const auto bucket = KvStoreMap::getBucket("key7");
+  EXPECT_EQ(bucket, storeB.find("key7")->bucket);
+  for (size_t i = 0; i < bucketHashes.size(); ++i) {
+    if (i == bucket) {
+      EXPECT_NE(bucketHashes[i], storeB.getBucketHashes()[i]);
+    } else {
+      EXPECT_EQ(bucketHashes[i], storeB.getBucketHashes()[i]);
+    }
+  }
+
+  // ttl changes don't count
+  storeB.set("key7", createThriftValue(1, "node1", std::string("value"), 1));
+  EXPECT_EQ(storeA.getBucketHashes(), storeB.getBucketHashes());
+
+  // removing all keys gets back to empty buckets
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(storeB.erase(folly::sformat("key{}", i)));
+  }
+  EXPECT_EQ(emptyHashes, storeB.getBucketHashes());
+}
+
+TEST(KvStoreMapTest, ForEachInBucket) {
+  KvStoreMap store;
+  for (int i = 0; i < 3000; ++i) {
+    store.set(
+        folly::sformat("key{}", i),
+        createThriftValue(1, "node1", std::string("value")));
+  }
+  for (int i = 0; i < 3000; i += 3) {
+    EXPECT_TRUE(store.erase(folly::sformat("key{}", i)));
+  }
+
+  // every key shows up once, in its own bucket
+  std::unordered_set<std::string> keys;
+  for (size_t bucket = 0; bucket < Constants::kKvStoreSyncBuckets; ++bucket) {
+    store.forEachInBucket(
+        bucket, [&](std::string const& key, KvStoreValue const& value) {
+          EXPECT_EQ(bucket, KvStoreMap::getBucket(key));
+          EXPECT_EQ(bucket, value.bucket);
+          EXPECT_TRUE(keys.emplace(key).second);
+        });
+  }
+  EXPECT_EQ(2000, keys.size());
+  EXPECT_EQ(0, keys.count("key0"));
+  EXPECT_EQ(1, keys.count("key1"));
+}
+
+TEST(KvStoreMapTest, OriginatorHashes) {
+  KvStoreMap storeA;
+  KvStoreMap storeB;
+  EXPECT_TRUE(storeA.getOriginatorHashes().empty());
+
+  // same content in any order gives the same originator hashes
+  for (int i = 0; i < 10; ++i) {
+    const auto originatorA = folly::sformat("node{}", i % 2);
+    const auto originatorB = folly::sformat("node{}", (9 - i) % 2);
+    storeA.set(
+        folly::sformat("key{}", i),
+        createThriftValue(1, originatorA, std::string("value")));
+    storeB.set(
+        folly::sformat("key{}", 9 - i),
+        createThriftValue(1, originatorB, std::string("value")));
+  }
+  EXPECT_EQ(2, storeA.getOriginatorHashes().size());
+  EXPECT_EQ(storeA.getOriginatorHashes(), storeB.getOriginatorHashes());
+
+  // a different value changes the hash of its originator only
+  auto const hashes = storeB.getOriginatorHashes();
+  storeB.set("key2", createThriftValue(2, "node0", std::string("value")));
+  EXPECT_NE(hashes.at("node0"), storeB.getOriginatorHashes().at("node0"));
+  EXPECT_EQ(hashes.at("node1"), storeB.getOriginatorHashes().at("node1"));
+
+  // a key taken over by another originator changes both
+  storeB.set("key2", createThriftValue(3, "node1", std::string("value")));
+  EXPECT_NE(hashes.at("node0"), storeB.getOriginatorHashes().at("node0"));
+  EXPECT_NE(hashes.at("node1"), storeB.getOriginatorHashes().at("node1"));
+
+  // ttl changes don't count
+  storeB.set("key2", createThriftValue(1, "node0", std::string("value"), 1));
+  EXPECT_EQ(storeA.getOriginatorHashes(), storeB.getOriginatorHashes());
+
+  // originators without keys have no hash
+  for (int i = 0; i < 10; i += 2) {
+    EXPECT_TRUE(storeB.erase(folly::sformat("key{}", i)));
+  }
+  EXPECT_EQ(1, storeB.getOriginatorHashes().size());
+  EXPECT_EQ(hashes.at("node1"), storeB.getOriginatorHashes().at("node1"));
+}
+
+TEST(KvStoreMapTest, ForEachWithPrefix) {
+  KvStoreMap store;
+  for (auto const& key : {"adj:node1", "adj:node2", "prefix:node1", "adj"}) {
+    store.set(key, createThriftValue(1, "node1", std::string("value")));
+  }
+
+  auto getKeys = [&store](std::string const& prefix) {
+    std::vector<std::string> keys;
+    store.forEachWithPrefix(
+        prefix, [&keys](std::string const& key, KvStoreValue const& value) {
+          EXPECT_EQ("value", *value.value);
+          keys.emplace_back(key);
+        });
+    return keys;
+  };
+  EXPECT_EQ(
+      (std::vector<std::string>{"adj:node1", "adj:node2"}), getKeys("adj:"));
+  EXPECT_EQ(
+      (std::vector<std::string>{"adj", "adj:node1", "adj:node2"}),
+      getKeys("adj"));
+  EXPECT_EQ(4, getKeys("").size());
+  EXPECT_TRUE(getKeys("adj:node3").empty());
+  EXPECT_TRUE(getKeys("z").empty());
+
+  // index follows the erased keys
+  EXPECT_TRUE(store.erase("adj:node1"));
+  EXPECT_EQ(std::vector<std::string>{"adj:node2"}, getKeys("adj:"));
+}
+
+TEST(KvStoreMapTest, ForEachWithPrefixAfterGrowth) {
+  // the index refers to the entries, which must stay valid as the map grows
+  // and gets moved
+  KvStoreMap store;
+  for (int i = 0; i < 1000; ++i) {
+    store.set(
+        folly::sformat("key{:04d}", i),
+        createThriftValue(1, "node1", folly::sformat("value{}", i)));
+  }
+  auto moved = std::move(store);
+  EXPECT_TRUE(moved.erase("key0000"));
+
+  std::vector<std::string> keys;
+  moved.forEachWithPrefix(
+      "key00", [&keys](std::string const& key, KvStoreValue const& value) {
+        const auto i = std::stoi(key.substr(3));
+        EXPECT_EQ(folly::sformat("value{}", i), *value.value);
+        keys.emplace_back(key);
+      });
+  ASSERT_EQ(99, keys.size());
+  EXPECT_EQ("key0001", keys.front());
+  EXPECT_EQ("key0099", keys.back());
+}
+
+TEST(KvStoreMapTest, SlotReuse) {
+  // slots of erased keys get reused by new ones, the index and iteration
+  // must see the new keys only
+  KvStoreMap store;
+  for (int i = 0; i < 500; ++i) {
+    store.set(
+        folly::sformat("old{:03d}", i),
+        createThriftValue(1, "node1", std::string("value")));
+  }
+  store.forEachWithPrefix("", [](std::string const&, KvStoreValue const&) {});
+  for (int i = 0; i < 500; ++i) {
+    EXPECT_TRUE(store.erase(folly::sformat("old{:03d}", i)));
+    store.set(
+        folly::sformat("new{:03d}", i),
+        createThriftValue(1, "node2", std::string("value")));
+  }
+  EXPECT_EQ(500, store.size());
+  EXPECT_EQ(nullptr, store.find("old000"));
+  ASSERT_NE(nullptr, store.find("new000"));
+  EXPECT_EQ("node2", store.getOriginatorId(*store.find("new000")));
+
+  size_t numIterated{0};
+  for (auto const& kv : store) {
+    EXPECT_EQ(0, kv.first.compare(0, 3, "new"));
+    ++numIterated;
+  }
+  EXPECT_EQ(500, numIterated);
+
+  std::vector<std::string> keys;
+  store.forEachWithPrefix(
+      "", [&keys](std::string const& key, KvStoreValue const&) {
+        keys.emplace_back(key);
+      });
+  ASSERT_EQ(500, keys.size());
+  EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+  EXPECT_EQ("new000", keys.front());
+  EXPECT_EQ("new499", keys.back());
+}
+
+TEST(KvStoreMapTest, ForEachWithPrefixAfter) {
+  KvStoreMap store;
+  for (auto const& key : {"adj:node1", "adj:node2", "adj:node3", "prefix"}) {
+    store.set(key, createThriftValue(1, "node1", std::string("value")));
+  }
+
+  auto getKeys = [&store](
+                     std::string const& prefix,
+                     std::string const& startAfterKey,
+                     size_t maxKeys) {
+    std::vector<std::string> keys;
+    auto addKey = [&](std::string const& key, KvStoreValue const&) {
+      if (keys.size() == maxKeys) {
+        return false;
+      }
+      keys.emplace_back(key);
+      return true;
+    };
+    bool complete = store.forEachWithPrefixAfter(prefix, startAfterKey, addKey);
+    return std::make_pair(keys, complete);
+  };
+  auto keys = getKeys("adj:", "", 2);
+  EXPECT_EQ((std::vector<std::string>{"adj:node1", "adj:node2"}), keys.first);
+  EXPECT_FALSE(keys.second);
+  keys = getKeys("adj:", "adj:node2", 2);
+  EXPECT_EQ(std::vector<std::string>{"adj:node3"}, keys.first);
+  EXPECT_TRUE(keys.second);
+
+  // start after a key which isn't there, or outside of the prefix
+  EXPECT_EQ(2, getKeys("adj:", "adj:node1a", 10).first.size());
+  EXPECT_EQ(3, getKeys("adj:", "a", 10).first.size());
+  EXPECT_TRUE(getKeys("adj:", "b", 10).first.empty());
+  EXPECT_EQ(
+      std::vector<std::string>{"prefix"}, getKeys("", "adj:node3", 10).first);
+}
+
+TEST(KvStoreFiltersTest, LiteralKeyPrefixes) {
+  EXPECT_EQ(
+      (std::vector<std::string>{"adj:", "prefix:"}),
+      KvStoreFilters({"adj:", "prefix:"}, {}).getLiteralKeyPrefixes());
+
+  // regular expressions and originator IDs need matching every key
+  EXPECT_FALSE(KvStoreFilters({"adj:.*1"}, {}).getLiteralKeyPrefixes());
+  EXPECT_FALSE(KvStoreFilters({"adj:"}, {"node1"}).getLiteralKeyPrefixes());
+  EXPECT_FALSE(KvStoreFilters({}, {}).getLiteralKeyPrefixes());
+}
+
+TEST(KvStoreMapTest, MergeKeyValues) {
+  KvStoreMap store;
+  KvStore::mergeKeyValues(
+      store, {{"key1", createThriftValue(1, "node1", std::string("value1"))}});
+  ASSERT_NE(nullptr, store.find("key1"));
+
+  // ttl update of the stored value
+  auto update = createThriftValue(1, "node1", std::nullopt, 100, 1);
+  auto updates = KvStore::mergeKeyValues(store, {{"key1", update}});
+  EXPECT_EQ(1, updates.size());
+  auto const* value = store.find("key1");
+  EXPECT_EQ(100, value->ttl);
+  EXPECT_EQ(1, value->ttlVersion);
+  EXPECT_EQ("value1", value->getValue());
+
+  // higher originator wins on same version
+  updates = KvStore::mergeKeyValues(
+      store, {{"key1", createThriftValue(1, "node2", std::string("value2"))}});
+  EXPECT_EQ(1, updates.size());
+  EXPECT_EQ("node2", store.getOriginatorId(*store.find("key1")));
+  EXPECT_EQ(1, store.getNumOriginatorIds());
+
+  // older version gets ignored
+  updates = KvStore::mergeKeyValues(
+      store, {{"key1", createThriftValue(0, "node3", std::string("value3"))}});
+  EXPECT_TRUE(updates.empty());
+  EXPECT_EQ("value2", store.find("key1")->getValue());
+}
+
+TEST(KvStoreMapTest, MergeKeyValuesMoved) {
+  KvStoreMap store;
+  store.set("key1", createThriftValue(2, "node1", std::string("value1")));
+
+  std::unordered_map<std::string, thrift::Value> keyVals{
+      {"key1", createThriftValue(1, "node1", std::string("old"))},
+      {"key2", createThriftValue(1, "node1", std::string("value2"))}};
+  auto updates = KvStore::mergeKeyValues(store, std::move(keyVals));
+
+  // only the update gets announced, its value is the one stored
+  ASSERT_EQ(1, updates.size());
+  EXPECT_EQ("value2", updates.at("key2").value.value());
+  EXPECT_EQ("value2", store.find("key2")->getValue());
+  EXPECT_EQ("value1", store.find("key1")->getValue());
+}
+
+TEST(KvStoreMapTest, OriginatorUsage) {
+  KvStoreMap store;
+  store.set("key1", createThriftValue(1, "node1", std::string("value1")));
+  store.set("key2", createThriftValue(1, "node1", std::string("v2")));
+  EXPECT_EQ(
+      (std::pair<size_t, size_t>(2, 16)), store.getOriginatorUsage("node1"));
+  EXPECT_EQ(16, store.getBytes());
+
+  // key taken over by another originator
+  store.set("key2", createThriftValue(2, "node2", std::string("value2")));
+  EXPECT_EQ(
+      (std::pair<size_t, size_t>(1, 10)), store.getOriginatorUsage("node1"));
+  EXPECT_EQ(
+      (std::pair<size_t, size_t>(1, 10)), store.getOriginatorUsage("node2"));
+  EXPECT_EQ(20, store.getBytes());
+
+  store.erase("key1");
+  EXPECT_EQ(
+      (std::pair<size_t, size_t>(0, 0)), store.getOriginatorUsage("node1"));
+  EXPECT_EQ(10, store.getBytes());
+}
+
+TEST(KvStoreMapTest, KeyClassUsage) {
+  using Usage = std::vector<std::pair<size_t, size_t>>;
+  KvStoreMap store;
+  EXPECT_EQ(std::vector<std::string>{"other"}, store.getKeyClassNames());
+
+  store.set("adj:node1", createThriftValue(1, "node1", std::string("v1")));
+  store.set("key1", createThriftValue(1, "node1", std::string("value1")));
+
+  // existing entries get reclassified
+  store.setKeyClasses({"adj:", "prefix:"});
+  EXPECT_EQ(
+      std::vector<std::string>({"adj", "prefix", "other"}),
+      store.getKeyClassNames());
+  EXPECT_EQ(0, store.getKeyClass("adj:node2"));
+  EXPECT_EQ(1, store.getKeyClass("prefix:node1"));
+  EXPECT_EQ(2, store.getKeyClass("key2"));
+  EXPECT_EQ(Usage({{1, 11}, {0, 0}, {1, 10}}), store.getKeyClassUsage());
+
+  store.set("prefix:node1", createThriftValue(1, "node1", std::string("v1")));
+  store.set("adj:node1", createThriftValue(2, "node1", std::string("v22")));
+  EXPECT_EQ(Usage({{1, 12}, {1, 14}, {1, 10}}), store.getKeyClassUsage());
+
+  store.erase("key1");
+  store.erase("adj:node1");
+  EXPECT_EQ(Usage({{0, 0}, {1, 14}, {0, 0}}), store.getKeyClassUsage());
+}
+
+TEST(KvStoreMapTest, MergeKeyValuesAdmission) {
+  KvStoreBudgets budgets;
+  budgets.maxKeys = 3;
+  budgets.maxKeysPerOriginator = 2;
+  budgets.maxBytesPerOriginator = 30;
+  budgets.exemptKeyMarkers = {Constants::kAdjDbMarker.str()};
+  KvStoreAdmission admission(budgets);
+  KvStoreMap store;
+  // number of merged key-values
+  auto merge = [&](std::string const& key, thrift::Value const& value) {
+    return KvStore::mergeKeyValues(
+               store, {{key, value}}, std::nullopt, &admission)
+        .size();
+  };
+  auto value = [](int64_t version, std::string const& node, size_t size) {
+    return createThriftValue(version, node, std::string(size, 'v'));
+  };
+
+  EXPECT_EQ(1, merge("key1", value(1, "node1", 6)));
+  EXPECT_EQ(1, merge("key2", value(1, "node1", 6)));
+  // over keys of node1
+  EXPECT_EQ(0, merge("key3", value(1, "node1", 6)));
+  // updates of existing keys pass, unless they grow node1 over its bytes
+  EXPECT_EQ(1, merge("key1", value(2, "node1", 7)));
+  EXPECT_EQ(0, merge("key2", value(2, "node1", 30)));
+  // ttl refreshes always pass
+  EXPECT_EQ(
+      1, merge("key2", createThriftValue(1, "node1", std::nullopt, 100, 1)));
+
+  // over keys of the area, exempt keys still get in
+  EXPECT_EQ(1, merge("key3", value(1, "node2", 6)));
+  EXPECT_EQ(0, merge("key4", value(1, "node2", 6)));
+  EXPECT_EQ(1, merge("adj:node1", value(1, "node1", 100)));
+  EXPECT_EQ(4, store.size());
+}
+
+TEST(KvStoreMapTest, MergeKeyValuesUpdateRate) {
+  KvStoreBudgets budgets;
+  budgets.maxUpdatesPerOriginatorPerSec = 0.001;
+  budgets.maxUpdateBurstPerOriginator = 2;
+  KvStoreAdmission admission(budgets);
+  KvStoreMap store;
+  for (int version = 1; version <= 3; ++version) {
+    KvStore::mergeKeyValues(
+        store,
+        {{"key1", createThriftValue(version, "node1", std::string("value"))}},
+        std::nullopt,
+        &admission);
+  }
+  // third update is over the burst
+  EXPECT_EQ(2, store.find("key1")->version);
+
+  // full-sync merges are not rate limited
+  KvStore::mergeKeyValues(
+      store,
+      {{"key1", createThriftValue(3, "node1", std::string("value"))},
+       {"key2", createThriftValue(1, "node1", std::string("value"))},
+       {"key3", createThriftValue(1, "node1", std::string("value"))}},
+      std::nullopt,
+      &admission,
+      false /* rateLimited */);
+  EXPECT_EQ(3, store.find("key1")->version);
+  EXPECT_EQ(3, store.size());
+
+  // other originators have tokens of their own
+  KvStore::mergeKeyValues(
+      store,
+      {{"key1", createThriftValue(4, "node2", std::string("value"))}},
+      std::nullopt,
+      &admission);
+  EXPECT_EQ(4, store.find("key1")->version);
+}
+
+TEST(KvStoreMapTest, MergeTtlUpdates) {
+  KvStoreMap store;
+  auto const& value = store.set(
+      "key1", createThriftValue(2, "node1", std::string("value1"), 100, 1));
+
+  thrift::TtlUpdate ttlUpdate;
+  ttlUpdate.version = 2;
+  ttlUpdate.ttlVersion = 2;
+  ttlUpdate.ttl = 200;
+  ttlUpdate.hash = value.hash;
+
+  // matching version and hash
+  auto updates = KvStore::mergeTtlUpdates(store, {{"key1", ttlUpdate}});
+  ASSERT_EQ(1, updates.size());
+  auto const& update = updates.at("key1");
+  EXPECT_FALSE(update.value.has_value());
+  EXPECT_EQ(2, update.version);
+  EXPECT_EQ("node1", update.originatorId);
+  EXPECT_EQ(200, update.ttl);
+  EXPECT_EQ(2, update.ttlVersion);
+  EXPECT_EQ(200, store.find("key1")->ttl);
+  EXPECT_EQ("value1", store.find("key1")->getValue());
+
+  // same ttlVersion again
+  EXPECT_TRUE(KvStore::mergeTtlUpdates(store, {{"key1", ttlUpdate}}).empty());
+
+  // refresh of another value or version
+  ttlUpdate.ttlVersion = 3;
+  ttlUpdate.hash = value.hash + 1;
+  EXPECT_TRUE(KvStore::mergeTtlUpdates(store, {{"key1", ttlUpdate}}).empty());
+  ttlUpdate.hash = value.hash;
+  ttlUpdate.version = 1;
+  EXPECT_TRUE(KvStore::mergeTtlUpdates(store, {{"key1", ttlUpdate}}).empty());
+
+  // unknown key
+  EXPECT_TRUE(KvStore::mergeTtlUpdates(store, {{"key2", ttlUpdate}}).empty());
+  EXPECT_EQ(2, store.find("key1")->ttlVersion);
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -6,7 +6,9 @@
  */
 
 #include <sodium.h>
+#include <algorithm>
 #include <cstdlib>
+#include <set>
 #include <thread>
 #include <tuple>
 #include <unordered_set>
@@ -16,7 +18,10 @@
 #include <folly/Format.h>
 #include <folly/Memory.h>
 #include <folly/Random.h>
+#include <folly/ScopeGuard.h>
+#include <folly/experimental/TestUtil.h>
 #include <folly/gen/Base.h>
+#include <folly/synchronization/Baton.h>
 #include <gtest/gtest.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
@@ -67,7 +72,7 @@ genRandomStr(const int len) {
 /**
  * Fixture for abstracting out common functionality for unittests.
  */
-class KvStoreTestFixture : public ::testing::TestWithParam<bool> {
+class KvStoreTestFixture : public ::testing::Test {
  public:
   void
   SetUp() override {
@@ -98,7 +103,8 @@ class KvStoreTestFixture : public ::testing::TestWithParam<bool> {
       bool isFloodRoot = false,
       std::chrono::seconds dbSyncInterval = kDbSyncInterval,
       std::unordered_set<std::string> areas = {
-          openr::thrift::KvStore_constants::kDefaultArea()}) {
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      KvStoreOptions options = {}) {
     auto ptr = std::make_unique<KvStoreWrapper>(
         context,
         nodeId,
@@ -110,7 +116,9 @@ class KvStoreTestFixture : public ::testing::TestWithParam<bool> {
         ttlDecr,
         enableFloodOptimization,
         isFloodRoot,
-        areas);
+        areas,
+        std::nullopt /* peerUpdatesQueue */,
+        std::move(options));
     stores_.emplace_back(std::move(ptr));
     return stores_.back().get();
   }
@@ -131,7 +139,8 @@ class KvStoreTestFixture : public ::testing::TestWithParam<bool> {
   std::vector<std::unique_ptr<KvStoreWrapper>> stores_{};
 };
 
-class KvStoreTestTtlFixture : public KvStoreTestFixture {
+class KvStoreTestTtlFixture : public KvStoreTestFixture,
+                              public ::testing::WithParamInterface<bool> {
  public:
   /**
    * Helper function to perform basic KvStore synchronization tests. We generate
@@ -320,6 +329,37 @@ class KvStoreTestTtlFixture : public KvStoreTestFixture {
 INSTANTIATE_TEST_CASE_P(
     KvStoreTestInstance, KvStoreTestTtlFixture, ::testing::Bool());
 
+// hashes full-sync goes by
+enum class SyncMode { KEYS, BUCKETS, ORIGINATORS };
+
+class KvStoreFullSyncFixture : public KvStoreTestFixture,
+                               public ::testing::WithParamInterface<SyncMode> {
+ public:
+  KvStoreWrapper*
+  createKvStore(std::string nodeId) {
+    KvStoreOptions options;
+    options.enableBucketSync = GetParam() == SyncMode::BUCKETS;
+    options.enableOriginatorSync = GetParam() == SyncMode::ORIGINATORS;
+    return KvStoreTestFixture::createKvStore(
+        nodeId,
+        {} /* peers */,
+        std::nullopt /* filters */,
+        std::nullopt /* kvStoreRate */,
+        Constants::kTtlDecrement,
+        false /* enableFloodOptimization */,
+        false /* isFloodRoot */,
+        kDbSyncInterval,
+        {openr::thrift::KvStore_constants::kDefaultArea()},
+        std::move(options));
+  }
+};
+
+INSTANTIATE_TEST_CASE_P(
+    KvStoreFullSyncInstance,
+    KvStoreFullSyncFixture,
+    ::testing::Values(
+        SyncMode::KEYS, SyncMode::BUCKETS, SyncMode::ORIGINATORS));
+
 } // namespace
 
 //
@@ -551,6 +591,120 @@ TEST(KvStore, compareValuesTest) {
   }
 }
 
+//
+// Test hashes and ordering of values with HashVersion::V2
+//
+TEST(KvStore, hashVersionV2Test) {
+  const auto v2 = thrift::HashVersion::V2;
+  auto createValue = [&](std::string const& value) {
+    return createThriftValue(
+        1,
+        "node1",
+        value,
+        Constants::kTtlInfinity,
+        0,
+        generateHash(1, "node1", value, v2));
+  };
+
+  // hashes differ from V1 and cover all fields
+  EXPECT_NE(
+      generateHash(1, "node1", std::string("value"), v2),
+      generateHash(1, "node1", std::string("value")));
+  EXPECT_NE(
+      generateHash(1, "node1", std::string("value"), v2),
+      generateHash(1, "node", std::string("1value"), v2));
+  EXPECT_NE(
+      generateHash(1, "node1", std::string("value"), v2),
+      generateHash(2, "node1", std::string("value"), v2));
+
+  // longer value wins, byte-wise lower or not
+  const auto shortValue = createValue("b");
+  const auto longValue = createValue("aa");
+  EXPECT_EQ(1, KvStore::compareValues(longValue, shortValue, v2));
+  EXPECT_EQ(-1, KvStore::compareValues(shortValue, longValue, v2));
+  EXPECT_GT(0, KvStore::compareValues(longValue, shortValue));
+
+  // same size goes by hash, with or without hash in the value
+  const auto value1 = createValue("value1");
+  auto value2 = createValue("value2");
+  const int rc = value1.hash.value() > value2.hash.value() ? 1 : -1;
+  EXPECT_EQ(rc, KvStore::compareValues(value1, value2, v2));
+  value2.hash.reset();
+  EXPECT_EQ(rc, KvStore::compareValues(value1, value2, v2));
+  EXPECT_EQ(0, KvStore::compareValues(value1, value1, v2));
+
+  // mergeKeyValues breaks ties the same way
+  KvStoreMap store(v2);
+  KvStore::mergeKeyValues(store, {{"key", shortValue}});
+  EXPECT_EQ(1, KvStore::mergeKeyValues(store, {{"key", longValue}}).size());
+  EXPECT_TRUE(KvStore::mergeKeyValues(store, {{"key", shortValue}}).empty());
+  EXPECT_EQ("aa", store.find("key")->getValue());
+
+  // hashes of values without one get generated with the store's version
+  auto noHash = createThriftValue(1, "node1", std::string("value"));
+  noHash.hash.reset();
+  store.set("key2", noHash);
+  EXPECT_EQ(
+      generateHash(1, "node1", std::string("value"), v2),
+      store.find("key2")->hash);
+}
+
+/**
+ * Key-values saved to the snapshot when KvStore stops are restored and
+ * published on the next start, minus the ones expired meanwhile
+ */
+TEST(KvStore, SnapshotRestore) {
+  fbzmq::Context context;
+  folly::test::TemporaryDirectory snapshotDir;
+  KvStoreOptions options;
+  options.snapshotDir = snapshotDir.path().string();
+  auto createStore = [&]() {
+    return std::make_unique<KvStoreWrapper>(
+        context,
+        "node1",
+        std::chrono::seconds(60) /* db sync interval */,
+        std::chrono::seconds(600) /* counter submit interval */,
+        std::unordered_map<std::string, thrift::PeerSpec>{},
+        std::nullopt /* filters */,
+        std::nullopt /* kvStoreRate */,
+        Constants::kTtlDecrement,
+        false /* enableFloodOptimization */,
+        false /* isFloodRoot */,
+        std::unordered_set<std::string>{
+            openr::thrift::KvStore_constants::kDefaultArea()},
+        std::nullopt /* peerUpdatesQueue */,
+        options);
+  };
+
+  const auto value1 = createThriftValue(1, "node2", std::string("value1"));
+  const auto value2 =
+      createThriftValue(1, "node2", std::string("value2"), 60000);
+  const auto value3 = createThriftValue(1, "node2", std::string("value3"), 600);
+  {
+    auto store = createStore();
+    store->run();
+    EXPECT_TRUE(store->setKey("key1", value1));
+    EXPECT_TRUE(store->setKey("key2", value2));
+    EXPECT_TRUE(store->setKey("key3", value3));
+    store->stop();
+  }
+
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  auto store = createStore();
+  store->run();
+  auto pub = store->recvPublication();
+  EXPECT_EQ(2, pub.keyVals.size());
+  ASSERT_TRUE(store->getKey("key1").has_value());
+  EXPECT_EQ(value1.value, store->getKey("key1")->value);
+  EXPECT_EQ(Constants::kTtlInfinity, store->getKey("key1")->ttl);
+  ASSERT_TRUE(store->getKey("key2").has_value());
+  EXPECT_EQ(value2.value, store->getKey("key2")->value);
+  EXPECT_GE(60000 - 500, store->getKey("key2")->ttl);
+  EXPECT_FALSE(store->getKey("key3").has_value());
+}
+
 //
 // Test counter reporting
 //
@@ -582,6 +736,8 @@ TEST(KvStore, MonitorReport) {
   ASSERT_EQ(1, counters.count("kvstore.num_keys"));
   ASSERT_EQ(1, counters.count("kvstore.num_peers"));
   ASSERT_EQ(1, counters.count("kvstore.pending_full_sync"));
+  ASSERT_EQ(1, counters.count("kvstore.full_sync_in_progress"));
+  ASSERT_EQ(1, counters.count("kvstore.full_sync_timeouts.count"));
   ASSERT_EQ(1, counters.count("kvstore.cmd_peer_dump.count"));
   ASSERT_EQ(1, counters.count("kvstore.cmd_peer_add.count"));
   ASSERT_EQ(1, counters.count("kvstore.cmd_per_del.count"));
@@ -603,6 +759,8 @@ TEST(KvStore, MonitorReport) {
   EXPECT_EQ(0, counters.at("kvstore.num_keys"));
   EXPECT_EQ(0, counters.at("kvstore.num_peers"));
   EXPECT_EQ(0, counters.at("kvstore.pending_full_sync"));
+  EXPECT_EQ(0, counters.at("kvstore.full_sync_in_progress"));
+  EXPECT_EQ(0, counters.at("kvstore.full_sync_timeouts.count"));
   EXPECT_EQ(0, counters.at("kvstore.cmd_peer_dump.count"));
   EXPECT_EQ(0, counters.at("kvstore.cmd_peer_add.count"));
   EXPECT_EQ(0, counters.at("kvstore.cmd_per_del.count"));
@@ -642,6 +800,39 @@ TEST(KvStore, MonitorReport) {
   LOG(INFO) << "KvStore thread finished";
 }
 
+/**
+ * All readers of the KvStore updates queue get the very same publication
+ * instead of a copy each.
+ */
+TEST(KvStore, SharedPublication) {
+  fbzmq::Context context;
+  KvStoreWrapper kvStore(
+      context,
+      "test",
+      std::chrono::seconds(1) /* Db Sync Interval */,
+      std::chrono::seconds(100) /* Monitor Submit Interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  auto reader1 = kvStore.getReader();
+  auto reader2 = kvStore.getReader();
+  kvStore.run();
+
+  const auto value = createThriftValue(1, "node1", std::string("value1"));
+  EXPECT_TRUE(kvStore.setKey("key1", value));
+
+  auto maybePub1 = reader1.get();
+  auto maybePub2 = reader2.get();
+  ASSERT_FALSE(maybePub1.hasError());
+  ASSERT_FALSE(maybePub2.hasError());
+  EXPECT_EQ(maybePub1.value().get(), maybePub2.value().get());
+
+  auto const& pub = *maybePub1.value();
+  ASSERT_EQ(1, pub.keyVals.size());
+  EXPECT_EQ(value.value, pub.keyVals.at("key1").value);
+  EXPECT_EQ(pub, kvStore.recvPublication());
+
+  kvStore.stop();
+}
+
 /**
  * Test following with single KvStore.
  * - TTL propagation is carried out correctly
@@ -912,6 +1103,53 @@ TEST(KvStore, TtlVerification) {
   kvStore.stop();
 }
 
+/**
+ * Keys expiring within the TTL expiry slack of each other are expired
+ * together and reported in a single publication
+ */
+TEST(KvStore, TtlExpirySlack) {
+  fbzmq::Context context;
+  KvStoreOptions options;
+  options.ttlExpirySlack = std::chrono::milliseconds(500);
+  KvStoreWrapper kvStore(
+      context,
+      "test",
+      std::chrono::seconds(1) /* Db Sync Interval */,
+      std::chrono::seconds(100) /* Monitor Submit Interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{},
+      std::nullopt /* filters */,
+      std::nullopt /* kvStoreRate */,
+      Constants::kTtlDecrement,
+      false /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      {thrift::KvStore_constants::kDefaultArea()},
+      std::nullopt /* peerUpdatesQueue */,
+      std::move(options));
+  kvStore.run();
+
+  // below kTtlThreshold, hence never advertised but expired
+  const auto startTime = std::chrono::steady_clock::now();
+  EXPECT_TRUE(
+      kvStore.setKey("key1", createThriftValue(1, "node1", "value1", 100)));
+  EXPECT_TRUE(
+      kvStore.setKey("key2", createThriftValue(1, "node1", "value2", 300)));
+
+  auto publication = kvStore.recvPublication();
+  EXPECT_EQ(0, publication.keyVals.size());
+  ASSERT_EQ(2, publication.expiredKeys.size());
+  std::sort(publication.expiredKeys.begin(), publication.expiredKeys.end());
+  EXPECT_EQ("key1", publication.expiredKeys.at(0));
+  EXPECT_EQ("key2", publication.expiredKeys.at(1));
+
+  // key1 expired no earlier than its TTL plus slack
+  EXPECT_LE(
+      std::chrono::milliseconds(600),
+      std::chrono::steady_clock::now() - startTime);
+  EXPECT_EQ(0, kvStore.dumpAll().size());
+
+  kvStore.stop();
+}
+
 TEST_F(KvStoreTestFixture, LeafNode) {
   const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
 
@@ -1769,6 +2007,193 @@ TEST_F(KvStoreTestFixture, DualTest) {
   validateAllRootsUpCase();
 }
 
+/**
+ * Switch of spt-parent: the old parent keeps being flooded to until the full
+ * sync with the new one completes. It's dropped once the sync completes,
+ * fails, or the old parent goes away.
+ *
+ *      r0
+ *    / |  \
+ *   a--x--b
+ *    \   /
+ *      n
+ */
+TEST_F(KvStoreTestFixture, DualSptParentSwitch) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto createStore = [&](std::string const& nodeId, bool isRoot) {
+    return createKvStore(
+        nodeId,
+        emptyPeers,
+        std::nullopt,
+        std::nullopt,
+        Constants::kTtlDecrement,
+        true /* enableFloodOptimization */,
+        isRoot);
+  };
+  auto r0 = createStore("r0", true);
+  auto x = createStore("x", false);
+  auto n = createStore("n", false);
+  std::unordered_map<std::string, KvStoreWrapper*> parents{
+      {"a", createStore("a", false)}, {"b", createStore("b", false)}};
+  for (auto store : {r0, x, n, parents.at("a"), parents.at("b")}) {
+    store->run();
+  }
+
+  auto connect = [](KvStoreWrapper* lhs, KvStoreWrapper* rhs) {
+    EXPECT_TRUE(lhs->addPeer(rhs->nodeId, rhs->getPeerSpec()));
+    EXPECT_TRUE(rhs->addPeer(lhs->nodeId, lhs->getPeerSpec()));
+  };
+  auto disconnect = [](KvStoreWrapper* lhs, KvStoreWrapper* rhs) {
+    EXPECT_TRUE(lhs->delPeer(rhs->nodeId));
+    EXPECT_TRUE(rhs->delPeer(lhs->nodeId));
+  };
+  connect(r0, x);
+  for (auto const& kv : parents) {
+    connect(r0, kv.second);
+    connect(x, kv.second);
+    connect(n, kv.second);
+  }
+
+  auto getParent = [](KvStoreWrapper* store) {
+    auto const sptInfos = store->getFloodTopo();
+    auto it = sptInfos.infos.find("r0");
+    if (it == sptInfos.infos.end() or not it->second.parent.has_value()) {
+      return std::string{};
+    }
+    return *it->second.parent;
+  };
+  auto waitFor = [](std::function<bool()> cond,
+                    std::chrono::seconds timeout,
+                    std::string const& what) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (not cond()) {
+      ASSERT_LT(std::chrono::steady_clock::now(), deadline) << what;
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+  auto floodPeersAre = [&](std::set<std::string> const& expected) {
+    auto const floodPeers = n->getFloodTopo().floodPeers;
+    return std::set<std::string>(floodPeers.begin(), floodPeers.end()) ==
+        expected;
+  };
+
+  // the event loop of a blocked store doesn't answer full-syncs
+  std::shared_ptr<folly::Baton<>> unblock;
+  auto block = [&unblock](KvStoreWrapper* store) {
+    unblock = std::make_shared<folly::Baton<>>();
+    folly::Baton<> blocked;
+    store->getKvStore()->runInEventBaseThread(
+        [&blocked, gate = unblock]() {
+          blocked.post();
+          gate->wait();
+        });
+    blocked.wait();
+  };
+  auto release = [&unblock]() {
+    unblock->post();
+    unblock.reset();
+  };
+  SCOPE_EXIT {
+    if (unblock) {
+      release();
+    }
+  };
+
+  waitFor(
+      [&]() { return parents.count(getParent(n)) != 0; },
+      std::chrono::seconds(10),
+      "n has no spt-parent");
+  const std::string first = getParent(n);
+  const std::string second = first == "a" ? "b" : "a";
+  waitFor(
+      [&]() { return floodPeersAre({first}); },
+      std::chrono::seconds(10),
+      "initial sync with spt-parent not done");
+
+  //
+  // 1) move n over to second by cutting first off r0, first goes via x
+  //
+  block(parents.at(second));
+  disconnect(r0, parents.at(first));
+  waitFor(
+      [&]() { return getParent(n) == second; },
+      std::chrono::seconds(10),
+      "n did not move to new spt-parent");
+  EXPECT_TRUE(floodPeersAre({first, second}));
+
+  // updates still reach the old parent directly, the new one doesn't
+  // forward anything while blocked
+  EXPECT_TRUE(n->setKey(
+      "switch-key-1", createThriftValue(1, "n", std::string("value1"))));
+  waitFor(
+      [&]() { return parents.at(first)->getKey("switch-key-1").has_value(); },
+      std::chrono::seconds(10),
+      "update not flooded to old spt-parent");
+  EXPECT_TRUE(floodPeersAre({first, second}));
+
+  // full-sync with the new parent completes
+  release();
+  waitFor(
+      [&]() { return floodPeersAre({second}); },
+      std::chrono::seconds(10),
+      "old spt-parent not dropped after full-sync");
+
+  //
+  // 2) move n back to first while its full-sync can't complete
+  //
+  connect(r0, parents.at(first));
+  waitFor(
+      [&]() {
+        return parents.at(first)->getFloodTopo().infos.at("r0").cost == 1;
+      },
+      std::chrono::seconds(10),
+      "spt-parent did not get back to r0");
+  // let n learn about it
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  block(parents.at(first));
+  disconnect(r0, parents.at(second));
+  waitFor(
+      [&]() { return getParent(n) == first; },
+      std::chrono::seconds(10),
+      "n did not move back to spt-parent");
+  EXPECT_TRUE(floodPeersAre({first, second}));
+
+  // the full-sync times out and second is dropped, first still blocked
+  waitFor(
+      [&]() { return floodPeersAre({first}); },
+      Constants::kStoreFullSyncResponseTimeout + std::chrono::seconds(5),
+      "old spt-parent not dropped after failed full-sync");
+  release();
+
+  //
+  // 3) move n to second again, then take the old parent away
+  //
+  connect(r0, parents.at(second));
+  waitFor(
+      [&]() {
+        return parents.at(second)->getFloodTopo().infos.at("r0").cost == 1;
+      },
+      std::chrono::seconds(10),
+      "spt-parent did not get back to r0");
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  block(parents.at(second));
+  disconnect(r0, parents.at(first));
+  waitFor(
+      [&]() { return getParent(n) == second; },
+      std::chrono::seconds(10),
+      "n did not move to new spt-parent");
+  EXPECT_TRUE(floodPeersAre({first, second}));
+
+  disconnect(n, parents.at(first));
+  waitFor(
+      [&]() { return floodPeersAre({second}); },
+      std::chrono::seconds(10),
+      "old spt-parent not dropped after it went away");
+}
+
 /**
  * Perform KvStore synchronization test on full mesh.
  */
@@ -2260,6 +2685,58 @@ TEST_F(KvStoreTestFixture, DumpPrefix) {
   EXPECT_EQ(expectedKeyVals, myStore->dumpAll(std::move(kvFilters)));
 }
 
+/**
+ * Paged dumps return all matching key-values in key order, a page at a time
+ */
+TEST_F(KvStoreTestFixture, DumpPaged) {
+  auto store = createKvStore("store0", {});
+  store->run();
+  for (int i = 0; i < 5; ++i) {
+    const auto value = createThriftValue(1, "store0", std::string("value"));
+    EXPECT_TRUE(store->setKey(folly::sformat("adj:{}", i), value));
+    EXPECT_TRUE(store->setKey(folly::sformat("prefix:{}", i), value));
+  }
+
+  auto dumpPage = [&](std::string const& prefix,
+                      std::optional<std::string> startAfterKey) {
+    thrift::KeyDumpParams params;
+    params.prefix = prefix;
+    params.maxKeys = 2;
+    fromStdOptional(params.startAfterKey, startAfterKey);
+    return *store->getKvStore()->dumpKvStoreKeys(std::move(params)).get();
+  };
+
+  for (auto const& prefix : {"adj:", ""}) {
+    std::vector<std::string> keys;
+    std::optional<std::string> startAfterKey;
+    int numPages = 0;
+    while (true) {
+      auto pub = dumpPage(prefix, startAfterKey);
+      ++numPages;
+      EXPECT_GE(2, pub.keyVals.size());
+      for (auto const& kv : pub.keyVals) {
+        keys.emplace_back(kv.first);
+      }
+      if (not pub.lastKey.has_value()) {
+        break;
+      }
+      startAfterKey = pub.lastKey.value();
+    }
+    const size_t numKeys = std::string(prefix).empty() ? 10 : 5;
+    EXPECT_EQ(numKeys, keys.size());
+    EXPECT_EQ((numKeys + 1) / 2, numPages);
+    std::sort(keys.begin(), keys.end());
+    EXPECT_EQ(keys.end(), std::unique(keys.begin(), keys.end()));
+  }
+
+  // any update changes the generation
+  const auto generation = dumpPage("", std::nullopt).generation;
+  ASSERT_TRUE(generation.has_value());
+  EXPECT_TRUE(store->setKey(
+      "adj:0", createThriftValue(2, "store0", std::string("value"))));
+  EXPECT_NE(generation, dumpPage("", std::nullopt).generation);
+}
+
 /**
  * Start single testable store, and set key values.
  * Try to request for KEY_DUMP with a few keyValHashes.
@@ -2455,6 +2932,121 @@ TEST_F(KvStoreTestFixture, TtlDecrementValue) {
   }
 }
 
+/**
+ * TTL refreshes flooded as compact TTL updates get applied by peers the same
+ * way as full TTL updates
+ */
+TEST_F(KvStoreTestFixture, CompactTtlUpdates) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  KvStoreOptions options;
+  options.enableCompactTtlUpdates = true;
+  auto createStore = [&](std::string const& nodeId) {
+    return createKvStore(
+        nodeId,
+        emptyPeers,
+        std::nullopt /* filters */,
+        std::nullopt /* kvStoreRate */,
+        Constants::kTtlDecrement,
+        false /* enableFloodOptimization */,
+        false /* isFloodRoot */,
+        kDbSyncInterval,
+        {thrift::KvStore_constants::kDefaultArea()},
+        options);
+  };
+  auto store0 = createStore("store0");
+  auto store1 = createStore("store1");
+  store0->run();
+  store1->run();
+
+  store0->addPeer(store1->nodeId, store1->getPeerSpec());
+  store1->addPeer(store0->nodeId, store0->getPeerSpec());
+
+  const auto value = createThriftValue(1, "utest", std::string("value"), 6000);
+  EXPECT_TRUE(store1->setKey("key1", value));
+  auto pub = store0->recvPublication();
+  ASSERT_EQ(1, pub.keyVals.count("key1"));
+  EXPECT_EQ(value.value, pub.keyVals.at("key1").value);
+
+  // refresh TTL in store1, it reaches store0 as compact TTL update
+  const auto counterName = "kvstore.received_ttl_updates.sum";
+  const auto oldCount = fb303::fbData->getCounters()[counterName];
+  EXPECT_TRUE(store1->setKey(
+      "key1", createThriftValue(1, "utest", std::nullopt, 6000, 1)));
+  pub = store0->recvPublication();
+  ASSERT_EQ(1, pub.keyVals.count("key1"));
+  auto const& ttlUpdate = pub.keyVals.at("key1");
+  EXPECT_FALSE(ttlUpdate.value.has_value());
+  EXPECT_EQ(1, ttlUpdate.version);
+  EXPECT_EQ("utest", ttlUpdate.originatorId);
+  EXPECT_EQ(1, ttlUpdate.ttlVersion);
+  EXPECT_LT(oldCount, fb303::fbData->getCounters()[counterName]);
+
+  auto getRes0 = store0->getKey("key1");
+  ASSERT_TRUE(getRes0.has_value());
+  EXPECT_EQ(1, getRes0->ttlVersion);
+  EXPECT_EQ(value.value, getRes0->value);
+}
+
+TEST_F(KvStoreTestFixture, ValueCompression) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  KvStoreOptions options;
+  options.valueCompression = thrift::CompressionType::ZSTD;
+  options.valueCompressionMinBytes = 100;
+  auto createStore = [&](std::string const& nodeId) {
+    return createKvStore(
+        nodeId,
+        emptyPeers,
+        std::nullopt /* filters */,
+        std::nullopt /* kvStoreRate */,
+        Constants::kTtlDecrement,
+        false /* enableFloodOptimization */,
+        false /* isFloodRoot */,
+        kDbSyncInterval,
+        {thrift::KvStore_constants::kDefaultArea()},
+        options);
+  };
+  auto store0 = createStore("store0");
+  auto store1 = createStore("store1");
+  store0->run();
+  store1->run();
+
+  // large value reaches store0 compressed with the full-sync response
+  const auto counterName = "kvstore.compressed_bytes_saved.sum";
+  const auto oldBytesSaved = fb303::fbData->getCounters()[counterName];
+  const auto value1 =
+      createThriftValue(1, "utest", std::string(10000, 'a'), 60000);
+  EXPECT_TRUE(store1->setKey("key1", value1));
+
+  store0->addPeer(store1->nodeId, store1->getPeerSpec());
+  store1->addPeer(store0->nodeId, store0->getPeerSpec());
+
+  auto pub = store0->recvPublication();
+  ASSERT_EQ(1, pub.keyVals.count("key1"));
+  EXPECT_EQ(value1.value, pub.keyVals.at("key1").value);
+  EXPECT_FALSE(pub.keyVals.at("key1").compression.has_value());
+  EXPECT_LT(oldBytesSaved, fb303::fbData->getCounters()[counterName]);
+
+  // and with floods, stored uncompressed with the same hash
+  const auto value2 =
+      createThriftValue(1, "utest", std::string(10000, 'b'), 60000);
+  EXPECT_TRUE(store1->setKey("key2", value2));
+  pub = store0->recvPublication();
+  ASSERT_EQ(1, pub.keyVals.count("key2"));
+  EXPECT_EQ(value2.value, pub.keyVals.at("key2").value);
+
+  for (auto const& key : {"key1", "key2"}) {
+    auto getRes0 = store0->getKey(key);
+    auto getRes1 = store1->getKey(key);
+    ASSERT_TRUE(getRes0.has_value());
+    ASSERT_TRUE(getRes1.has_value());
+    EXPECT_EQ(getRes1->value, getRes0->value);
+    EXPECT_EQ(getRes1->hash, getRes0->hash);
+    EXPECT_FALSE(getRes0->compression.has_value());
+  }
+  EXPECT_EQ(
+      0, fb303::fbData->getCounters()["kvstore.decompression_failures.count"]);
+}
+
 /**
  * Test kvstore-consistency with rate-limiter enabled
  * linear topology, intentionlly increate db-sync interval from 1s -> 60s so
@@ -2745,10 +3337,9 @@ TEST_F(KvStoreTestFixture, RateLimiter) {
  * we expect both storeA and storeB have:
  *           (k0, 5, a), (k1, 1, a), (k2, 9, a), (k3, 9, b), (k4, 6, b)
  */
-TEST_F(KvStoreTestFixture, FullSync) {
-  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
-  auto storeA = createKvStore("storeA", emptyPeers);
-  auto storeB = createKvStore("storeB", emptyPeers);
+TEST_P(KvStoreFullSyncFixture, FullSync) {
+  auto storeA = createKvStore("storeA");
+  auto storeB = createKvStore("storeB");
   storeA->run();
   storeB->run();
 
@@ -2828,6 +3419,286 @@ TEST_F(KvStoreTestFixture, FullSync) {
   EXPECT_EQ(v4->value.value(), "b");
 }
 
+/**
+ * Full-sync with many peers at once. The first full-sync is done on its own,
+ * the following ones in parallel. In the end all keys are synced and there
+ * is a sync duration for every peer
+ */
+TEST_F(KvStoreTestFixture, FullSyncManyPeers) {
+  const int kNumPeers = 8;
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store = createKvStore("store", emptyPeers);
+  store->run();
+
+  std::vector<KvStoreWrapper*> peerStores;
+  for (int i = 0; i < kNumPeers; ++i) {
+    auto peerStore = createKvStore(getNodeId("peer", i), emptyPeers);
+    peerStore->run();
+    thrift::Value val = createThriftValue(
+        1 /* version */, peerStore->nodeId, std::string("value"), 30000);
+    EXPECT_TRUE(peerStore->setKey(getNodeId("key", i), val));
+    peerStores.emplace_back(peerStore);
+  }
+
+  for (auto peerStore : peerStores) {
+    EXPECT_TRUE(store->addPeer(peerStore->nodeId, peerStore->getPeerSpec()));
+  }
+
+  // wait for full-syncs with all peers and the counters to be updated
+  auto syncDurationCounter = [](std::string const& peerName) {
+    return folly::sformat(
+        "kvstore.full_sync_duration_ms.{}.{}",
+        thrift::KvStore_constants::kDefaultArea(),
+        peerName);
+  };
+  auto allSynced = [&]() {
+    auto counters = fb303::fbData->getCounters();
+    for (auto peerStore : peerStores) {
+      if (not counters.count(syncDurationCounter(peerStore->nodeId))) {
+        return false;
+      }
+    }
+    return counters.at("kvstore.pending_full_sync") == 0 and
+        counters.at("kvstore.full_sync_in_progress") == 0;
+  };
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (not allSynced()) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+        << "full-syncs with peers didn't complete";
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  for (int i = 0; i < kNumPeers; ++i) {
+    auto val = store->getKey(getNodeId("key", i));
+    ASSERT_TRUE(val.has_value());
+    EXPECT_EQ(getNodeId("peer", i), val->originatorId);
+  }
+}
+
+/**
+ * Full-sync response bigger than a merge slice gets merged in slices, the
+ * peer still gets the keys it misses once all of them are merged
+ */
+TEST_F(KvStoreTestFixture, SlicedSyncMerge) {
+  const size_t kNumKeys = Constants::kKvStoreSyncMergeSliceKeys * 5 / 2;
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store0 = createKvStore("store0", emptyPeers);
+  auto store1 = createKvStore("store1", emptyPeers);
+  store0->run();
+  store1->run();
+
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    keyVals.emplace_back(
+        getNodeId("key", i),
+        createThriftValue(1, "store1", std::string("value"), 300000));
+  }
+  EXPECT_TRUE(store1->setKeys(keyVals));
+  EXPECT_TRUE(store0->setKey(
+      "store0-key",
+      createThriftValue(1, "store0", std::string("value"), 300000)));
+
+  EXPECT_TRUE(store0->addPeer(store1->nodeId, store1->getPeerSpec()));
+
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(3000));
+  EXPECT_EQ(kNumKeys + 1, store0->dumpAll().size());
+  EXPECT_TRUE(store1->getKey("store0-key").has_value());
+}
+
+/**
+ * Flood batching. store0 holds updates for a while and floods them in
+ * batches bounded in size. A burst of key updates must reach store1 in far
+ * fewer publications than keys
+ */
+TEST_F(KvStoreTestFixture, FloodBatching) {
+  const int kNumKeys = 1000;
+  const std::string value(100, 'v');
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  KvStoreOptions options;
+  options.floodBatchDelay = std::chrono::milliseconds(200);
+  options.floodBatchBytes = kNumKeys * value.size() / 4;
+  auto store0 = createKvStore(
+      "store0",
+      emptyPeers,
+      std::nullopt /* filters */,
+      std::nullopt /* kvStoreRate */,
+      Constants::kTtlDecrement,
+      false /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      kDbSyncInterval,
+      {openr::thrift::KvStore_constants::kDefaultArea()},
+      std::move(options));
+  auto store1 = createKvStore("store1", emptyPeers);
+  store0->run();
+  store1->run();
+  store0->addPeer(store1->nodeId, store1->getPeerSpec());
+
+  // wait for full-sync to complete before flooding
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  fb303::fbData->resetAllData();
+
+  for (int i = 0; i < kNumKeys; ++i) {
+    thrift::Value val =
+        createThriftValue(1 /* version */, "store0", value, 300000 /* ttl */);
+    EXPECT_TRUE(store0->setKey(getNodeId("key", i), val));
+  }
+
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  EXPECT_EQ(kNumKeys, store1->dumpAll().size());
+
+  // batches get split at a quarter of all key-values
+  const auto sentPublications =
+      fb303::fbData->getCounters()["kvstore.sent_publications.count"];
+  EXPECT_GE(sentPublications, 4);
+  EXPECT_LT(sentPublications, kNumKeys / 10);
+}
+
+/**
+ * Floods to a peer whose socket is full get queued. With a high water mark of
+ * one message and a publication per key, flooding a burst of keys fills the
+ * socket. Queued keys reach the peer once it drains, a queue outgrowing its
+ * bound gets the peer full-synced instead
+ */
+TEST(KvStore, PeerSendQueue) {
+  const int kNumKeys = 200;
+  const std::string value(1000, 'v');
+  fbzmq::Context context;
+  for (const size_t queueBytes :
+       {Constants::kPeerSendQueueMaxBytes, size_t{1}}) {
+    const bool overflows = queueBytes == 1;
+    KvStoreOptions options;
+    options.floodBatchDelay = std::chrono::milliseconds(1000);
+    options.floodBatchBytes = value.size();
+    options.peerSendQueueBytes = queueBytes;
+    auto createStore = [&](std::string const& nodeId) {
+      auto store = std::make_unique<KvStoreWrapper>(
+          context,
+          nodeId,
+          std::chrono::seconds(60) /* db sync interval */,
+          std::chrono::seconds(1) /* counter submit interval */,
+          std::unordered_map<std::string, thrift::PeerSpec>{},
+          std::nullopt /* filters */,
+          std::nullopt /* kvStoreRate */,
+          Constants::kTtlDecrement,
+          false /* enableFloodOptimization */,
+          false /* isFloodRoot */,
+          std::unordered_set<std::string>{
+              thrift::KvStore_constants::kDefaultArea()},
+          std::nullopt /* peerUpdatesQueue */,
+          options,
+          1 /* zmqHwm */);
+      store->run();
+      return store;
+    };
+    auto store0 = createStore(overflows ? "overflow0" : "drain0");
+    auto store1 = createStore(overflows ? "overflow1" : "drain1");
+
+    // wait for the initial full-sync with store1
+    auto marker = createThriftValue(1, store1->nodeId, std::string("marker"));
+    EXPECT_TRUE(store1->setKey("marker", marker));
+    EXPECT_TRUE(store0->addPeer(store1->nodeId, store1->getPeerSpec()));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (not store0->getKey("marker").has_value()) {
+      ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+          << "full-sync with " << store1->nodeId << " didn't complete";
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    fb303::fbData->resetAllData();
+
+    std::vector<std::pair<std::string, thrift::Value>> keyVals;
+    for (int i = 0; i < kNumKeys; ++i) {
+      keyVals.emplace_back(
+          folly::sformat("key{}", i),
+          createThriftValue(1, store0->nodeId, value, 300000));
+    }
+    EXPECT_TRUE(store0->setKeys(keyVals));
+
+    // every key reaches store1 with its value, queued or full-synced
+    auto allKeysSynced = [&]() {
+      const auto keys = store1->dumpAll();
+      for (auto const& [key, val] : keyVals) {
+        auto it = keys.find(key);
+        if (it == keys.end() or it->second.value != val.value) {
+          return false;
+        }
+      }
+      return true;
+    };
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (not allKeysSynced()) {
+      ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+          << "keys didn't reach " << store1->nodeId;
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    auto counters = fb303::fbData->getCounters();
+    EXPECT_LT(0, counters["kvstore.peer_send_queue.queued_keys.sum"]);
+    if (overflows) {
+      EXPECT_LT(0, counters["kvstore.peer_send_queue.overflows.count"]);
+    } else {
+      EXPECT_EQ(0, counters["kvstore.peer_send_queue.overflows.count"]);
+      EXPECT_LT(0, counters["kvstore.peer_send_queue.sent_keys.sum"]);
+    }
+  }
+}
+
+/**
+ * Keys of priority classes are flooded right away while other keys wait for
+ * their batch
+ */
+TEST_F(KvStoreTestFixture, PriorityFlooding) {
+  const int kNumKeys = 100;
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  KvStoreOptions options;
+  options.floodBatchDelay = std::chrono::milliseconds(2000);
+  options.priorityFloodKeyMarkers = {Constants::kAdjDbMarker.str()};
+  auto store0 = createKvStore(
+      "store0",
+      emptyPeers,
+      std::nullopt /* filters */,
+      std::nullopt /* kvStoreRate */,
+      Constants::kTtlDecrement,
+      false /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      kDbSyncInterval,
+      {openr::thrift::KvStore_constants::kDefaultArea()},
+      std::move(options));
+  auto store1 = createKvStore("store1", emptyPeers);
+  store0->run();
+  store1->run();
+  store0->addPeer(store1->nodeId, store1->getPeerSpec());
+
+  // wait for full-sync to complete before flooding
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  thrift::Value val =
+      createThriftValue(1 /* version */, "store0", "value", 300000 /* ttl */);
+  for (int i = 0; i < kNumKeys; ++i) {
+    EXPECT_TRUE(store0->setKey(getNodeId("prefix:", i), val));
+  }
+  const auto adjKey = Constants::kAdjDbMarker.str() + "store0";
+  EXPECT_TRUE(store0->setKey(adjKey, val));
+
+  // adjacency key doesn't wait for the batch of prefix keys
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  auto keyVals = store1->dumpAll();
+  EXPECT_EQ(1, keyVals.size());
+  EXPECT_EQ(1, keyVals.count(adjKey));
+
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  EXPECT_EQ(kNumKeys + 1, store1->dumpAll().size());
+}
+
 /* Kvstore tests related to area */
 
 /* Verify flooding is containted within an area. Add a key in one area and
@@ -3013,6 +3884,110 @@ TEST_F(KvStoreTestFixture, KeySyncMultipleArea) {
   evb.loop();
 }
 
+/**
+ * Two stores with two areas each, every area running in a thread of its own.
+ * Keys set in an area reach the peer in that area only
+ */
+TEST_F(KvStoreTestFixture, AreaThreads) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  const std::string podArea{"pod-area"};
+  const std::string planeArea{"plane-area"};
+  KvStoreOptions options;
+  options.enableAreaThreads = true;
+
+  std::vector<KvStoreWrapper*> stores;
+  for (auto const& nodeId : {"storeA", "storeB"}) {
+    stores.emplace_back(createKvStore(
+        nodeId,
+        emptyPeers,
+        std::nullopt /* filters */,
+        std::nullopt /* kvStoreRate */,
+        Constants::kTtlDecrement,
+        false /* enableFloodOptimization */,
+        false /* isFloodRoot */,
+        kDbSyncInterval,
+        {podArea, planeArea},
+        options));
+    stores.back()->run();
+  }
+  auto storeA = stores.at(0);
+  auto storeB = stores.at(1);
+
+  // key set before peering reaches storeB with the full-sync
+  const auto podVal = createThriftValue(1, "storeA", std::string("pod"));
+  EXPECT_TRUE(storeA->setKey("pod-key", podVal, std::nullopt, podArea));
+  for (auto const& area : {podArea, planeArea}) {
+    EXPECT_TRUE(storeA->addPeer("storeB", storeB->getPeerSpec(), area));
+    EXPECT_TRUE(storeB->addPeer("storeA", storeA->getPeerSpec(), area));
+    EXPECT_EQ(1, storeB->getPeers(area).count("storeA"));
+  }
+
+  // key set afterwards reaches storeB as flood
+  const auto planeVal = createThriftValue(1, "storeA", std::string("plane"));
+  EXPECT_TRUE(storeA->setKey("plane-key", planeVal, std::nullopt, planeArea));
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (not storeB->getKey("pod-key", podArea).has_value() or
+         not storeB->getKey("plane-key", planeArea).has_value()) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline)
+        << "keys of both areas didn't reach storeB";
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(podVal.value, storeB->getKey("pod-key", podArea)->value);
+  EXPECT_EQ(planeVal.value, storeB->getKey("plane-key", planeArea)->value);
+  EXPECT_EQ(1, storeB->dumpAll(std::nullopt, podArea).size());
+  EXPECT_EQ(1, storeB->dumpAll(std::nullopt, planeArea).size());
+
+  // unknown areas are still rejected
+  EXPECT_FALSE(storeB->getKey("pod-key").has_value());
+  EXPECT_FALSE(storeB->setKey("key", podVal));
+}
+
+/**
+ * Key-values merged recently are dropped when set again, unless their hash
+ * differs or they expired meanwhile
+ */
+TEST_F(KvStoreTestFixture, DropRecentKeyVals) {
+  auto store = createKvStore("store0", {});
+  store->run();
+  fb303::fbData->resetAllData();
+  auto getNumDropped = []() {
+    return fb303::fbData->getCounters()["kvstore.dropped_recent_key_vals.sum"];
+  };
+
+  const auto value1 = createThriftValue(1, "node1", std::string("value1"));
+  EXPECT_TRUE(store->setKey("key1", value1));
+  EXPECT_EQ(0, getNumDropped());
+  EXPECT_TRUE(store->setKey("key1", value1));
+  EXPECT_EQ(1, getNumDropped());
+
+  // same version and originator, but another value
+  const auto value2 = createThriftValue(1, "node1", std::string("value2"));
+  EXPECT_TRUE(store->setKey("key1", value2));
+  EXPECT_EQ(1, getNumDropped());
+  EXPECT_EQ(value2.value, store->getKey("key1")->value);
+
+  // TTL refresh of the value
+  auto refresh = createThriftValue(1, "node1", std::nullopt, 60000, 1);
+  refresh.hash.reset();
+  EXPECT_TRUE(store->setKey("key1", refresh));
+  EXPECT_TRUE(store->setKey("key1", refresh));
+  EXPECT_EQ(2, getNumDropped());
+  EXPECT_EQ(1, store->getKey("key1")->ttlVersion);
+
+  // set again after expiry brings the key back
+  const auto value3 = createThriftValue(1, "node1", std::string("value3"), 100);
+  EXPECT_TRUE(store->setKey("key2", value3));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_FALSE(store->getKey("key2").has_value());
+  EXPECT_TRUE(store->setKey("key2", value3));
+  EXPECT_EQ(2, getNumDropped());
+  EXPECT_TRUE(store->getKey("key2").has_value());
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fb303/ServiceData.h>
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Util.h>
+#include <openr/kvstore/KvStoreWrapper.h>
+#include <openr/tests/OpenrThriftServerWrapper.h>
+
+using namespace openr;
+
+namespace {
+
+// large enough so that floods and full-sync never time out in tests
+const std::chrono::milliseconds kTtl{60000};
+
+} // namespace
+
+/**
+ * Two KvStores peering over THRIFT transport, each with the OpenrCtrl thrift
+ * server the other one talks to
+ */
+class KvStoreThriftPeerTestFixture : public ::testing::Test {
+ public:
+  void
+  SetUp() override {
+    for (auto const& nodeId : {"store0", "store1"}) {
+      auto store = std::make_shared<KvStoreWrapper>(
+          context_,
+          nodeId,
+          std::chrono::seconds(60) /* db sync interval */,
+          std::chrono::seconds(600) /* counter submit interval */,
+          std::unordered_map<std::string, thrift::PeerSpec>{});
+      store->run();
+
+      auto thriftServer = std::make_shared<OpenrThriftServerWrapper>(
+          nodeId,
+          nullptr /* decision */,
+          nullptr /* fib */,
+          store->getKvStore() /* kvStore */,
+          nullptr /* linkMonitor */,
+          nullptr /* configStore */,
+          nullptr /* prefixManager */,
+          MonitorSubmitUrl{"inproc://monitor_submit"},
+          context_);
+      thriftServer->run();
+
+      stores_.emplace_back(std::move(store));
+      thriftServers_.emplace_back(std::move(thriftServer));
+    }
+  }
+
+  void
+  TearDown() override {
+    for (auto& thriftServer : thriftServers_) {
+      thriftServer->stop();
+    }
+    thriftServers_.clear();
+    for (auto& store : stores_) {
+      store->stop();
+    }
+    stores_.clear();
+  }
+
+  // peer spec of store i over THRIFT transport
+  thrift::PeerSpec
+  getThriftPeerSpec(size_t i) const {
+    auto peerSpec = stores_.at(i)->getPeerSpec();
+    peerSpec.transport = thrift::PeerTransport::THRIFT;
+    peerSpec.ctrlAddr = "::1";
+    peerSpec.ctrlPort = thriftServers_.at(i)->getOpenrCtrlThriftPort();
+    return peerSpec;
+  }
+
+  fbzmq::Context context_;
+  std::vector<std::shared_ptr<KvStoreWrapper>> stores_;
+  std::vector<std::shared_ptr<OpenrThriftServerWrapper>> thriftServers_;
+};
+
+TEST_F(KvStoreThriftPeerTestFixture, FullSyncAndFlood) {
+  auto& store0 = stores_.at(0);
+  auto& store1 = stores_.at(1);
+
+  // key set before peering reaches store0 with the full-sync
+  const auto value1 =
+      createThriftValue(1, "store1", std::string("value1"), kTtl.count());
+  EXPECT_TRUE(store1->setKey("key1", value1));
+
+  const auto counterName = "kvstore.thrift.sent_key_sets.count";
+  const auto oldCount = fb303::fbData->getCounters()[counterName];
+  EXPECT_TRUE(store0->addPeer(store1->nodeId, getThriftPeerSpec(1)));
+  EXPECT_TRUE(store1->addPeer(store0->nodeId, getThriftPeerSpec(0)));
+
+  auto pub = store0->recvPublication();
+  ASSERT_EQ(1, pub.keyVals.count("key1"));
+  EXPECT_EQ(value1.value, pub.keyVals.at("key1").value);
+
+  // key set afterwards reaches store1 as flood
+  const auto value2 =
+      createThriftValue(1, "store0", std::string("value2"), kTtl.count());
+  EXPECT_TRUE(store0->setKey("key2", value2));
+  while (true) {
+    pub = store1->recvPublication();
+    if (pub.keyVals.count("key2")) {
+      break;
+    }
+  }
+  EXPECT_EQ(value2.value, pub.keyVals.at("key2").value);
+  EXPECT_LT(oldCount, fb303::fbData->getCounters()[counterName]);
+
+  for (auto const& key : {"key1", "key2"}) {
+    auto getRes0 = store0->getKey(key);
+    auto getRes1 = store1->getKey(key);
+    ASSERT_TRUE(getRes0.has_value());
+    ASSERT_TRUE(getRes1.has_value());
+    EXPECT_EQ(getRes0->value, getRes1->value);
+    EXPECT_EQ(getRes0->hash, getRes1->hash);
+  }
+}
+
+TEST_F(KvStoreThriftPeerTestFixture, ZmqFallback) {
+  auto& store0 = stores_.at(0);
+  auto& store1 = stores_.at(1);
+
+  const auto value =
+      createThriftValue(1, "store1", std::string("value"), kTtl.count());
+  EXPECT_TRUE(store1->setKey("key1", value));
+
+  // no thrift server address, store0 full-syncs with store1 over ZMQ still
+  auto peerSpec = getThriftPeerSpec(1);
+  peerSpec.ctrlAddr.clear();
+  EXPECT_TRUE(store0->addPeer(store1->nodeId, peerSpec));
+
+  auto pub = store0->recvPublication();
+  ASSERT_EQ(1, pub.keyVals.count("key1"));
+  EXPECT_EQ(value.value, pub.keyVals.at("key1").value);
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
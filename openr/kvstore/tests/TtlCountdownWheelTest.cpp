@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <map>
+#include <random>
+#include <set>
+
+#include <folly/Format.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/kvstore/TtlCountdownWheel.h>
+
+using namespace openr;
+using namespace std::chrono;
+
+namespace {
+
+const auto kStart = steady_clock::now();
+
+TtlCountdownQueueEntry
+createEntry(std::string const& key, milliseconds ttl, int64_t version = 1) {
+  TtlCountdownQueueEntry entry;
+  entry.expiryTime = kStart + ttl;
+  entry.key = key;
+  entry.version = version;
+  entry.originatorId = "node1";
+  return entry;
+}
+
+std::vector<std::string>
+getKeys(std::vector<TtlCountdownQueueEntry> const& entries) {
+  std::vector<std::string> keys;
+  for (auto const& entry : entries) {
+    keys.emplace_back(entry.key);
+  }
+  return keys;
+}
+
+} // namespace
+
+TEST(TtlCountdownWheelTest, ScheduleExpire) {
+  TtlCountdownWheel wheel(kStart);
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(wheel.getNextExpiry().has_value());
+
+  wheel.schedule(createEntry("key1", milliseconds(10)));
+  wheel.schedule(createEntry("key2", milliseconds(5)));
+  wheel.schedule(createEntry("key3", milliseconds(300)));
+  EXPECT_EQ(3, wheel.size());
+  EXPECT_EQ(kStart + milliseconds(5), wheel.getNextExpiry());
+
+  EXPECT_TRUE(wheel.expire(kStart + milliseconds(4)).empty());
+  EXPECT_EQ(
+      std::vector<std::string>({"key2", "key1"}),
+      getKeys(wheel.expire(kStart + milliseconds(10))));
+  EXPECT_EQ(1, wheel.size());
+  EXPECT_EQ(nullptr, wheel.find("key1"));
+
+  // key3 is a level up, the wheel needs to turn there first
+  auto nextExpiry = wheel.getNextExpiry();
+  ASSERT_TRUE(nextExpiry.has_value());
+  EXPECT_LE(*nextExpiry, kStart + milliseconds(300));
+  EXPECT_TRUE(wheel.expire(kStart + milliseconds(299)).empty());
+  EXPECT_EQ(kStart + milliseconds(300), wheel.getNextExpiry());
+  EXPECT_EQ(
+      std::vector<std::string>({"key3"}),
+      getKeys(wheel.expire(kStart + milliseconds(300))));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(wheel.getNextExpiry().has_value());
+}
+
+TEST(TtlCountdownWheelTest, Reschedule) {
+  TtlCountdownWheel wheel(kStart);
+  wheel.schedule(createEntry("key1", milliseconds(100)));
+  wheel.schedule(createEntry("key2", milliseconds(100)));
+
+  // rescheduling replaces the entry of a key
+  wheel.schedule(createEntry("key1", seconds(100), 2));
+  EXPECT_EQ(2, wheel.size());
+  ASSERT_NE(nullptr, wheel.find("key1"));
+  EXPECT_EQ(2, wheel.find("key1")->version);
+
+  EXPECT_EQ(
+      std::vector<std::string>({"key2"}),
+      getKeys(wheel.expire(kStart + seconds(1))));
+
+  EXPECT_TRUE(wheel.cancel("key1"));
+  EXPECT_FALSE(wheel.cancel("key1"));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_TRUE(wheel.expire(kStart + seconds(200)).empty());
+
+  // entries in the past expire with the next tick
+  wheel.schedule(createEntry("key3", milliseconds(0)));
+  EXPECT_EQ(
+      kStart + seconds(200) + milliseconds(1), wheel.getNextExpiry());
+  EXPECT_EQ(
+      std::vector<std::string>({"key3"}),
+      getKeys(wheel.expire(kStart + seconds(200) + milliseconds(1))));
+}
+
+TEST(TtlCountdownWheelTest, LongTtl) {
+  TtlCountdownWheel wheel(kStart);
+  // beyond the range of the top level
+  const auto ttl = hours(24 * 100);
+  wheel.schedule(createEntry("key1", ttl));
+  EXPECT_TRUE(wheel.expire(kStart + ttl - milliseconds(1)).empty());
+  EXPECT_EQ(1, getKeys(wheel.expire(kStart + ttl)).size());
+}
+
+/**
+ * Compare against expiring sorted entries, with random TTLs spread over all
+ * levels and refreshes in between.
+ */
+TEST(TtlCountdownWheelTest, Random) {
+  std::mt19937_64 gen(1);
+  std::uniform_int_distribution<int64_t> ttlDist(0, 1 << 26);
+  std::uniform_int_distribution<int64_t> stepDist(0, 1 << 20);
+
+  TtlCountdownWheel wheel(kStart);
+  std::map<std::string, int64_t> expiries;
+  int64_t now = 0;
+  for (int round = 0; round < 200; ++round) {
+    for (int i = 0; i < 50; ++i) {
+      const auto key = folly::sformat("key{}", gen() % 1000);
+      const auto expiry = now + ttlDist(gen) / (1 + gen() % 4096);
+      auto entry = createEntry(key, milliseconds(expiry));
+      wheel.schedule(std::move(entry));
+      expiries[key] = expiry;
+    }
+    EXPECT_EQ(expiries.size(), wheel.size());
+
+    // next expiry never lies beyond the earliest entry
+    int64_t earliest = std::numeric_limits<int64_t>::max();
+    for (auto const& kv : expiries) {
+      earliest = std::min(earliest, kv.second);
+    }
+    auto nextExpiry = wheel.getNextExpiry();
+    ASSERT_TRUE(nextExpiry.has_value());
+    EXPECT_LE(*nextExpiry, kStart + milliseconds(std::max(earliest, now)));
+
+    now += stepDist(gen);
+    std::set<std::string> expected;
+    for (auto it = expiries.begin(); it != expiries.end();) {
+      if (it->second <= now) {
+        expected.emplace(it->first);
+        it = expiries.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    auto keys = getKeys(wheel.expire(kStart + milliseconds(now)));
+    EXPECT_EQ(expected, std::set<std::string>(keys.begin(), keys.end()));
+    EXPECT_EQ(expiries.size(), wheel.size());
+  }
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,232 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <folly/Singleton.h>
+#include <folly/init/Init.h>
+#include <thrift/lib/cpp2/server/ThriftServer.h>
+#include <thrift/lib/cpp2/util/ScopedServerThread.h>
+
+#include <openr/decision/Decision.h>
+#include <openr/fib/Fib.h>
+#include <openr/fib/tests/MockNetlinkFibHandler.h>
+#include <openr/kvstore/KvStoreCapture.h>
+#include <openr/kvstore/KvStoreWrapper.h>
+#include <openr/messaging/ReplicateQueue.h>
+
+/**
+ * Replay of a capture recorded by openr_kvstore_snooper --capture_file.
+ * Publications are fed to a KvStore, with Decision computing routes from it
+ * and Fib programming them into a mock FibService. Reports how long the
+ * pipeline took to converge, and CPU time spent, on captured traffic.
+ *
+ * Keys are set with the TTLs they were captured with. Expired keys of the
+ * capture aren't removed explicitly, they expire in the replay KvStore once
+ * their TTL runs out.
+ */
+
+DEFINE_string(capture_file, "", "Capture to replay");
+DEFINE_string(
+    node_name,
+    "",
+    "Node to compute routes of, usually the one the capture was taken on");
+DEFINE_string(
+    area,
+    openr::thrift::KvStore_constants::kDefaultArea(),
+    "KvStore area to replay the capture into");
+DEFINE_double(
+    speed,
+    1.0,
+    "Replay speed relative to the capture, 0 replays as fast as possible");
+DEFINE_int32(
+    settle_ms,
+    2000,
+    "Replay is converged once no routes got updated for this long");
+DEFINE_bool(enable_v4, true, "Compute IPv4 routes");
+DEFINE_bool(enable_lfa, false, "Compute LFA paths");
+DEFINE_int32(decision_debounce_min_ms, 10, "Decision debounce min duration");
+DEFINE_int32(decision_debounce_max_ms, 250, "Decision debounce max duration");
+
+namespace {
+
+std::chrono::microseconds
+getCpuTime() {
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+      std::chrono::microseconds(
+          usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  CHECK(not FLAGS_capture_file.empty()) << "--capture_file is required";
+  CHECK(not FLAGS_node_name.empty()) << "--node_name is required";
+  CHECK_GE(FLAGS_speed, 0);
+
+  using namespace openr;
+  using Clock = std::chrono::steady_clock;
+
+  folly::SingletonVault::singleton()->registrationComplete();
+  fbzmq::Context context;
+  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue;
+  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> staticRoutesQueue;
+  messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue;
+
+  // mock FibService for Fib to program
+  auto mockFibHandler = std::make_shared<MockNetlinkFibHandler>();
+  auto fibServer = std::make_shared<apache::thrift::ThriftServer>();
+  fibServer->setNumIOWorkerThreads(1);
+  fibServer->setNumAcceptThreads(1);
+  fibServer->setPort(0);
+  fibServer->setInterface(mockFibHandler);
+  apache::thrift::util::ScopedServerThread fibServerThread(fibServer);
+
+  // KvStore to replay into, with Decision and Fib behind it
+  auto kvStore = std::make_unique<KvStoreWrapper>(
+      context,
+      "kvstore-replay",
+      std::chrono::seconds(60) /* dbSyncInterval */,
+      std::chrono::seconds(600) /* monitorSubmitInterval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{},
+      std::nullopt /* filters */,
+      std::nullopt /* kvStoreRate */,
+      Constants::kTtlDecrement,
+      false /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      std::unordered_set<std::string>{FLAGS_area});
+  kvStore->run();
+
+  auto decision = std::make_unique<Decision>(
+      FLAGS_node_name,
+      FLAGS_enable_v4,
+      FLAGS_enable_lfa,
+      false /* enableOrderedFib */,
+      false /* bgpDryRun */,
+      false /* bgpUseIgpMetric */,
+      AdjacencyDbMarker{Constants::kAdjDbMarker.toString()},
+      PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+      std::chrono::milliseconds(FLAGS_decision_debounce_min_ms),
+      std::chrono::milliseconds(FLAGS_decision_debounce_max_ms),
+      std::nullopt /* gracefulRestartDuration */,
+      kvStore->getReader(),
+      staticRoutesQueue.getReader(),
+      routeUpdatesQueue,
+      context);
+  std::thread decisionThread([&decision]() { decision->run(); });
+  decision->waitUntilRunning();
+
+  auto fib = std::make_unique<Fib>(
+      FLAGS_node_name,
+      fibServerThread.getAddress()->getPort(),
+      false /* dryrun */,
+      false /* enableSegmentRouting */,
+      false /* enableOrderedFib */,
+      std::chrono::seconds(0) /* coldStartDuration */,
+      false /* waitOnDecision */,
+      routeUpdatesQueue.getReader(),
+      interfaceUpdatesQueue.getReader(),
+      MonitorSubmitUrl{"inproc://kvstore-replay-monitor"},
+      nullptr /* kvStore */,
+      context);
+  std::thread fibThread([&fib]() { fib->run(); });
+  fib->waitUntilRunning();
+
+  // route updates as seen by Fib, for convergence
+  std::atomic<int64_t> numRouteDeltas{0};
+  std::atomic<int64_t> lastRouteDeltaUs{0};
+  const auto startTime = Clock::now();
+  std::thread routeReaderThread(
+      [reader = routeUpdatesQueue.getReader(),
+       &numRouteDeltas,
+       &lastRouteDeltaUs,
+       startTime]() mutable {
+        while (reader.get().hasValue()) {
+          ++numRouteDeltas;
+          lastRouteDeltaUs =
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  Clock::now() - startTime)
+                  .count();
+        }
+      });
+
+  // feed the capture, paced by its timestamps
+  KvStoreCaptureReader reader(FLAGS_capture_file);
+  const auto startCpuTime = getCpuTime();
+  std::optional<int64_t> firstTimestampMs;
+  size_t numRecords{0};
+  size_t numKeyVals{0};
+  while (auto record = reader.read()) {
+    if (not firstTimestampMs.has_value()) {
+      firstTimestampMs = record->timestamp_ms;
+    }
+    if (FLAGS_speed > 0) {
+      const auto offset = std::chrono::milliseconds(
+          record->timestamp_ms - firstTimestampMs.value());
+      std::this_thread::sleep_until(
+          startTime +
+          std::chrono::duration_cast<Clock::duration>(offset / FLAGS_speed));
+    }
+    ++numRecords;
+    auto& keyVals = record->publication.keyVals;
+    numKeyVals += keyVals.size();
+    if (not keyVals.empty()) {
+      std::vector<std::pair<std::string, thrift::Value>> keyValList(
+          std::make_move_iterator(keyVals.begin()),
+          std::make_move_iterator(keyVals.end()));
+      kvStore->setKeys(keyValList, std::nullopt /* nodeIds */, FLAGS_area);
+    }
+  }
+  const auto replayDuration = Clock::now() - startTime;
+
+  // converged once routes stop changing
+  const auto settle = std::chrono::milliseconds(FLAGS_settle_ms);
+  while (Clock::now() - startTime -
+             std::chrono::microseconds(lastRouteDeltaUs.load()) <
+         settle) {
+    std::this_thread::sleep_for(settle / 10);
+  }
+  const auto cpuTime = getCpuTime() - startCpuTime;
+
+  std::cout << "Records replayed: " << numRecords << std::endl
+            << "Key-values replayed: " << numKeyVals << std::endl
+            << "Replay duration: "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                   replayDuration)
+                   .count()
+            << "ms" << std::endl
+            << "Convergence: " << lastRouteDeltaUs.load() / 1000 << "ms"
+            << std::endl
+            << "Route updates: " << numRouteDeltas.load() << std::endl
+            << "Routes added: " << mockFibHandler->getAddRoutesCount()
+            << std::endl
+            << "Routes deleted: " << mockFibHandler->getDelRoutesCount()
+            << std::endl
+            << "CPU time: " << cpuTime.count() / 1000 << "ms" << std::endl;
+
+  // tear down in reverse order of the pipeline
+  routeUpdatesQueue.close();
+  staticRoutesQueue.close();
+  interfaceUpdatesQueue.close();
+  kvStore->closeQueue();
+  fib->stop();
+  fibThread.join();
+  decision->stop();
+  decisionThread.join();
+  routeReaderThread.join();
+  kvStore->stop();
+  return 0;
+}
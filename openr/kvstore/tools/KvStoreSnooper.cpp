@@ -11,11 +11,17 @@
 
 #include <openr/common/OpenrClient.h>
 #include <openr/kvstore/KvStore.h>
+#include <openr/kvstore/KvStoreCapture.h>
 
 DEFINE_string(host, "::1", "Host to connect to");
 DEFINE_int32(port, openr::Constants::kOpenrCtrlPort, "OpenrCtrl server port");
 DEFINE_int32(connect_timeout_ms, 1000, "Connect timeout for client");
 DEFINE_int32(processing_timeout_ms, 5000, "Processing timeout for client");
+DEFINE_string(
+    capture_file,
+    "",
+    "Record the initial dump and all publications to this file, for replay "
+    "by openr_kvstore_replay");
 
 int
 main(int argc, char** argv) {
@@ -41,19 +47,34 @@ main(int argc, char** argv) {
             << " entries in initial dump.";
   LOG(INFO) << "";
 
+  // initial dump is the first record of a capture
+  std::unique_ptr<openr::KvStoreCaptureWriter> captureWriter;
+  if (not FLAGS_capture_file.empty()) {
+    captureWriter =
+        std::make_unique<openr::KvStoreCaptureWriter>(FLAGS_capture_file);
+    openr::thrift::Publication initialPub;
+    initialPub.keyVals = globalKeyVals;
+    captureWriter->write(initialPub, openr::getUnixTimeStampMs());
+    LOG(INFO) << "Capturing publications to " << FLAGS_capture_file;
+  }
+
   auto subscription =
       std::move(response.stream)
           .subscribeExTry(
               folly::Executor::getKeepAliveToken(&evb),
-              [&globalKeyVals](
+              [&globalKeyVals, &captureWriter](
                   folly::Try<openr::thrift::Publication>&& maybePub) mutable {
                 if (maybePub.hasException()) {
                   LOG(ERROR) << maybePub.exception().what();
                   return;
                 }
                 auto& pub = maybePub.value();
+                if (captureWriter) {
+                  captureWriter->write(pub, openr::getUnixTimeStampMs());
+                }
                 // Print expired key-vals
                 for (const auto& key : pub.expiredKeys) {
+                  globalKeyVals.erase(key);
                   std::cout << "Expired Key: " << key << std::endl;
                   std::cout << "" << std::endl;
                 }
@@ -46,6 +46,7 @@ InterfaceEntry::updateAttrs(int ifIndex, bool isUp, uint64_t weight) {
   }
 
   if (isUpdated) {
+    isDirty_ = true;
     updateCallback_();
   }
 
@@ -71,6 +72,17 @@ InterfaceEntry::getBackoffDuration() const {
   return backoff_.getTimeRemainingUntilRetry();
 }
 
+bool
+InterfaceEntry::isDirty() {
+  return isDirty_ or isActive() != wasActive_;
+}
+
+void
+InterfaceEntry::clearDirty() {
+  isDirty_ = false;
+  wasActive_ = isActive();
+}
+
 bool
 InterfaceEntry::updateAddr(folly::CIDRNetwork const& ipNetwork, bool isValid) {
   bool isUpdated = false;
@@ -81,6 +93,7 @@ InterfaceEntry::updateAddr(folly::CIDRNetwork const& ipNetwork, bool isValid) {
   }
 
   if (isUpdated) {
+    isDirty_ = true;
     VLOG(1) << (isValid ? "Adding " : "Deleting ")
             << folly::sformat("{}/{}", ipNetwork.first.str(), ipNetwork.second)
             << " on interface " << ifName_
@@ -50,6 +50,13 @@ class InterfaceEntry final {
   // Get backoff time
   std::chrono::milliseconds getBackoffDuration() const;
 
+  // Changed since it was last advertised, see clearDirty(). Active state
+  // changes on its own as well, once backoff is over
+  bool isDirty();
+
+  // Mark interface as advertised with its current state
+  void clearDirty();
+
   // Used to check for updates if doing a re-sync
   bool
   operator==(const InterfaceEntry& interfaceEntry) {
@@ -118,6 +125,12 @@ class InterfaceEntry final {
   uint64_t weight_{1};
   std::unordered_set<folly::CIDRNetwork> networks_;
 
+  // attributes or addresses changed since clearDirty()
+  bool isDirty_{true};
+
+  // active state as of clearDirty()
+  bool wasActive_{false};
+
   // Backoff variables
   ExponentialBackoff<std::chrono::milliseconds> backoff_;
 
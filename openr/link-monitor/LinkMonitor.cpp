@@ -7,7 +7,11 @@
 
 #include "LinkMonitor.h"
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
+#include <thread>
+#include <utility>
 
 #include <fb303/ServiceData.h>
 #include <fbzmq/service/if/gen-cpp2/Monitor_types.h>
@@ -15,14 +19,17 @@
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/MapUtil.h>
 #include <folly/Memory.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
 #include <folly/gen/Base.h>
 #include <folly/system/ThreadName.h>
+#include <thrift/lib/cpp/TApplicationException.h>
 #include <thrift/lib/cpp/protocol/TProtocolTypes.h>
 #include <thrift/lib/cpp/transport/THeader.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/LsdbEncoding.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/LinkMonitor_types.h>
@@ -88,7 +95,7 @@ LinkMonitor::LinkMonitor(
     AdjacencyDbMarker adjacencyDbMarker,
     messaging::ReplicateQueue<thrift::InterfaceDatabase>& intfUpdatesQueue,
     messaging::ReplicateQueue<thrift::PeerUpdateRequest>& peerUpdatesQueue,
-    messaging::RQueue<thrift::SparkNeighborEvent> neighborUpdatesQueue,
+    messaging::RQueue<thrift::SparkNeighborEvents> neighborUpdatesQueue,
     MonitorSubmitUrl const& monitorSubmitUrl,
     PersistentStore* configStore,
     bool assumeDrained,
@@ -98,7 +105,11 @@ LinkMonitor::LinkMonitor(
     std::chrono::milliseconds flapInitialBackoff,
     std::chrono::milliseconds flapMaxBackoff,
     std::chrono::milliseconds ttlKeyInKvStore,
-    const std::unordered_set<std::string>& areas)
+    const std::unordered_set<std::string>& areas,
+    bool perAdjacencyKeys,
+    std::optional<MetricDampenerConfig> rttMetricDampening,
+    bool compactLsdbEncoding,
+    std::optional<messaging::RQueue<PlatformEvents>> platformEventsQueue)
     : nodeId_(nodeId),
       platformThriftPort_(platformThriftPort),
       includeRegexList_(std::move(includeRegexList)),
@@ -112,7 +123,11 @@ LinkMonitor::LinkMonitor(
       forwardingTypeMpls_(forwardingTypeMpls),
       forwardingAlgoKsp2Ed_(forwardingAlgoKsp2Ed),
       adjacencyDbMarker_(adjacencyDbMarker),
+      perAdjacencyKeys_(perAdjacencyKeys),
+      rttMetricDampening_(std::move(rttMetricDampening)),
+      compactLsdbEncoding_(compactLsdbEncoding),
       platformPubUrl_(platformPubUrl),
+      inProcessPlatformEvents_(platformEventsQueue.has_value()),
       flapInitialBackoff_(flapInitialBackoff),
       flapMaxBackoff_(flapMaxBackoff),
       ttlKeyInKvStore_(ttlKeyInKvStore),
@@ -132,10 +147,10 @@ LinkMonitor::LinkMonitor(
   // Create throttled adjacency advertiser
   advertiseAdjacenciesThrottled_ = std::make_unique<fbzmq::ZmqThrottle>(
       getEvb(), Constants::kLinkThrottleTimeout, [this]() noexcept {
-        // will advertise to all areas but will not trigger a adj key update
-        // if nothing changed. For peers no action is taken if nothing changed
+        // For peers no action is taken if nothing changed. Adjacencies are
+        // advertised to the areas they changed in only
         advertiseKvStorePeers();
-        advertiseAdjacencies();
+        advertiseAdjacencies(folly::copy(dirtyAdjacencyAreas_));
       });
 
   // Create throttled interfaces and addresses advertiser
@@ -146,6 +161,8 @@ LinkMonitor::LinkMonitor(
   // Create timer. Timer is used for immediate or delayed executions.
   advertiseIfaceAddrTimer_ = fbzmq::ZmqTimeout::make(
       getEvb(), [this]() noexcept { advertiseIfaceAddr(); });
+  metricReuseTimer_ = fbzmq::ZmqTimeout::make(
+      getEvb(), [this]() noexcept { reuseRttMetrics(); });
 
   LOG(INFO) << "Loading link-monitor state";
   zmqMonitorClient_ =
@@ -170,6 +187,13 @@ LinkMonitor::LinkMonitor(
   kvStoreClient_ = std::make_unique<KvStoreClientInternal>(
       this, nodeId_, kvStore, std::nullopt /* persist key timer */);
 
+  if (areas_.size() > 1) {
+    adjDbExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        std::min<size_t>(
+            areas_.size(), std::max(1u, std::thread::hardware_concurrency())),
+        std::make_shared<folly::NamedThreadFactory>("LinkMonitorAdjDb"));
+  }
+
   if (enableSegmentRouting) {
     // create range allocator to get unique node labels
     for (const auto& area : areas_) {
@@ -223,16 +247,49 @@ LinkMonitor::LinkMonitor(
   // Add fiber to process the neighbor events
   addFiberTask([q = std::move(neighborUpdatesQueue), this]() mutable noexcept {
     while (true) {
-      auto maybeEvent = q.get();
+      auto maybeEvents = q.get();
       VLOG(1) << "Received neighbor update";
-      if (maybeEvent.hasError()) {
+      if (maybeEvents.hasError()) {
         LOG(INFO) << "Terminating neighbor update processing fiber";
         break;
       }
-      processNeighborEvent(std::move(maybeEvent).value());
+      // coalesce with batches queued up meanwhile, e.g. during a burst
+      auto events = std::move(maybeEvents).value();
+      while (q.size()) {
+        auto moreEvents = q.get();
+        if (moreEvents.hasError()) {
+          break;
+        }
+        std::move(
+            moreEvents->begin(), moreEvents->end(), std::back_inserter(events));
+      }
+      processNeighborEvents(std::move(events));
     }
   });
 
+  // Add fiber to process link/addr events of an in-process publisher
+  if (platformEventsQueue.has_value()) {
+    addFiberTask(
+        [q = std::move(platformEventsQueue).value(), this]() mutable noexcept {
+          while (true) {
+            auto maybeEvents = q.get();
+            if (maybeEvents.hasError()) {
+              LOG(INFO) << "Terminating platform events processing fiber";
+              break;
+            }
+            VLOG(3) << "Received " << maybeEvents->links.size()
+                    << " Link Events and " << maybeEvents->addresses.size()
+                    << " Address Events from Platform....";
+            for (const auto& linkEvt : maybeEvents->links) {
+              processLinkEvent(linkEvt);
+            }
+            for (const auto& addrEvt : maybeEvents->addresses) {
+              processAddrEvent(addrEvt);
+            }
+          }
+        });
+  }
+
   // Initialize ZMQ sockets
   prepare();
 
@@ -250,7 +307,38 @@ LinkMonitor::prepare() noexcept {
   // Prepare all sockets
   //
 
-  // Subscribe to link/addr events published by NetlinkAgent
+  // Subscribe to link/addr events published by NetlinkAgent, unless they come
+  // from within the process
+  if (not inProcessPlatformEvents_) {
+    subscribePlatformEvents();
+  }
+
+  // Schedule periodic timer for InterfaceDb re-sync from Netlink Platform
+  interfaceDbSyncTimer_ = fbzmq::ZmqTimeout::make(getEvb(), [this]() noexcept {
+    auto success = syncInterfaces();
+    if (success) {
+      VLOG(2) << "InterfaceDb Sync is successful";
+      expBackoff_.reportSuccess();
+      interfaceDbSyncTimer_->scheduleTimeout(
+          Constants::kPlatformSyncInterval, true /* isPeriodic */);
+    } else {
+      fb303::fbData->addStatValue(
+          "link_monitor.thrift.failure.getAllLinks", 1, fb303::SUM);
+      // Apply exponential backoff and schedule next run
+      expBackoff_.reportError();
+      interfaceDbSyncTimer_->scheduleTimeout(
+          expBackoff_.getTimeRemainingUntilRetry());
+      LOG(ERROR) << "InterfaceDb Sync failed, apply exponential "
+                 << "backoff and retry in "
+                 << expBackoff_.getTimeRemainingUntilRetry().count() << " ms";
+    }
+  });
+  // schedule immediate with small timeout
+  interfaceDbSyncTimer_->scheduleTimeout(std::chrono::milliseconds(100));
+}
+
+void
+LinkMonitor::subscribePlatformEvents() noexcept {
   VLOG(2) << "Connect to PlatformPublisher to subscribe NetlinkEvent on "
           << platformPubUrl_;
   const auto linkEventType =
@@ -269,6 +357,18 @@ LinkMonitor::prepare() noexcept {
     LOG(FATAL) << "Error setting ZMQ_SUBSCRIBE to " << addrEventType << " "
                << nlAddrSubOpt.error();
   }
+  // coalesced link/addr events
+  for (const auto eventType :
+       {thrift::PlatformEventType::LINK_EVENTS,
+        thrift::PlatformEventType::ADDRESS_EVENTS}) {
+    const auto batchEventType = static_cast<uint16_t>(eventType);
+    auto nlBatchSubOpt = nlEventSub_.setSockOpt(
+        ZMQ_SUBSCRIBE, &batchEventType, sizeof(uint16_t));
+    if (nlBatchSubOpt.hasError()) {
+      LOG(FATAL) << "Error setting ZMQ_SUBSCRIBE to " << batchEventType << " "
+                 << nlBatchSubOpt.error();
+    }
+  }
   const auto nlSub = nlEventSub_.connect(fbzmq::SocketUrl{platformPubUrl_});
   if (nlSub.hasError()) {
     LOG(FATAL) << "Error connecting to URL '" << platformPubUrl_ << "' "
@@ -303,20 +403,8 @@ LinkMonitor::prepare() noexcept {
         case thrift::PlatformEventType::LINK_EVENT: {
           VLOG(3) << "Received Link Event from Platform....";
           try {
-            const auto linkEvt =
-                fbzmq::util::readThriftObjStr<thrift::LinkEntry>(
-                    eventMsg.value().eventData, serializer_);
-            auto interfaceEntry = getOrCreateInterfaceEntry(linkEvt.ifName);
-            if (interfaceEntry) {
-              const bool wasUp = interfaceEntry->isUp();
-              interfaceEntry->updateAttrs(
-                  linkEvt.ifIndex, linkEvt.isUp, linkEvt.weight);
-              logLinkEvent(
-                  interfaceEntry->getIfName(),
-                  wasUp,
-                  interfaceEntry->isUp(),
-                  interfaceEntry->getBackoffDuration());
-            }
+            processLinkEvent(fbzmq::util::readThriftObjStr<thrift::LinkEntry>(
+                eventMsg.value().eventData, serializer_));
           } catch (std::exception const& e) {
             LOG(ERROR) << "Error parsing linkEvt. Reason: "
                        << folly::exceptionStr(e);
@@ -326,17 +414,42 @@ LinkMonitor::prepare() noexcept {
         case thrift::PlatformEventType::ADDRESS_EVENT: {
           VLOG(3) << "Received Address Event from Platform....";
           try {
-            const auto addrEvt =
-                fbzmq::util::readThriftObjStr<thrift::AddrEntry>(
+            processAddrEvent(fbzmq::util::readThriftObjStr<thrift::AddrEntry>(
+                eventMsg.value().eventData, serializer_));
+          } catch (std::exception const& e) {
+            LOG(ERROR) << "Error parsing addrEvt. Reason: "
+                       << folly::exceptionStr(e);
+          }
+        } break;
+
+        case thrift::PlatformEventType::LINK_EVENTS: {
+          try {
+            const auto linkEvts =
+                fbzmq::util::readThriftObjStr<thrift::LinkEntries>(
                     eventMsg.value().eventData, serializer_);
-            auto interfaceEntry = getOrCreateInterfaceEntry(addrEvt.ifName);
-            if (interfaceEntry) {
-              interfaceEntry->updateAddr(
-                  toIPNetwork(addrEvt.ipPrefix, false /* no masking */),
-                  addrEvt.isValid);
+            VLOG(3) << "Received " << linkEvts.entries.size()
+                    << " Link Events from Platform....";
+            for (const auto& linkEvt : linkEvts.entries) {
+              processLinkEvent(linkEvt);
             }
           } catch (std::exception const& e) {
-            LOG(ERROR) << "Error parsing addrEvt. Reason: "
+            LOG(ERROR) << "Error parsing linkEvts. Reason: "
+                       << folly::exceptionStr(e);
+          }
+        } break;
+
+        case thrift::PlatformEventType::ADDRESS_EVENTS: {
+          try {
+            const auto addrEvts =
+                fbzmq::util::readThriftObjStr<thrift::AddrEntries>(
+                    eventMsg.value().eventData, serializer_);
+            VLOG(3) << "Received " << addrEvts.entries.size()
+                    << " Address Events from Platform....";
+            for (const auto& addrEvt : addrEvts.entries) {
+              processAddrEvent(addrEvt);
+            }
+          } catch (std::exception const& e) {
+            LOG(ERROR) << "Error parsing addrEvts. Reason: "
                        << folly::exceptionStr(e);
           }
         } break;
@@ -346,36 +459,14 @@ LinkMonitor::prepare() noexcept {
                      << ", eventType: " << static_cast<uint16_t>(eventType);
         }
       });
-
-  // Schedule periodic timer for InterfaceDb re-sync from Netlink Platform
-  interfaceDbSyncTimer_ = fbzmq::ZmqTimeout::make(getEvb(), [this]() noexcept {
-    auto success = syncInterfaces();
-    if (success) {
-      VLOG(2) << "InterfaceDb Sync is successful";
-      expBackoff_.reportSuccess();
-      interfaceDbSyncTimer_->scheduleTimeout(
-          Constants::kPlatformSyncInterval, true /* isPeriodic */);
-    } else {
-      fb303::fbData->addStatValue(
-          "link_monitor.thrift.failure.getAllLinks", 1, fb303::SUM);
-      // Apply exponential backoff and schedule next run
-      expBackoff_.reportError();
-      interfaceDbSyncTimer_->scheduleTimeout(
-          expBackoff_.getTimeRemainingUntilRetry());
-      LOG(ERROR) << "InterfaceDb Sync failed, apply exponential "
-                 << "backoff and retry in "
-                 << expBackoff_.getTimeRemainingUntilRetry().count() << " ms";
-    }
-  });
-  // schedule immediate with small timeout
-  interfaceDbSyncTimer_->scheduleTimeout(std::chrono::milliseconds(100));
 }
 
 void
 LinkMonitor::neighborUpEvent(
     const thrift::BinaryAddress& neighborAddrV4,
     const thrift::BinaryAddress& neighborAddrV6,
-    const thrift::SparkNeighborEvent& event) {
+    const thrift::SparkNeighborEvent& event,
+    NeighborAdvertisements& advertisements) {
   const std::string& ifName = event.ifName;
   const std::string& remoteNodeName = event.neighbor.nodeName;
   const std::string& remoteIfName = event.neighbor.ifName;
@@ -415,12 +506,14 @@ LinkMonitor::neighborUpEvent(
   fb303::fbData->addStatValue("link_monitor.neighbor_up", 1, fb303::SUM);
 
   std::string repUrl;
+  std::string ctrlAddr;
   if (!mockMode_) {
     repUrl = folly::sformat(
         "tcp://[{}%{}]:{}",
         toString(neighborAddrV6),
         ifName,
         neighborKvStoreCmdPort);
+    ctrlAddr = folly::sformat("{}%{}", toString(neighborAddrV6), ifName);
   } else {
     // use inproc address
     repUrl = folly::sformat("inproc://{}-kvstore-cmd-global", remoteNodeName);
@@ -433,21 +526,33 @@ LinkMonitor::neighborUpEvent(
   thrift::PeerSpec peerSpec;
   peerSpec.cmdUrl = repUrl;
   peerSpec.supportFloodOptimization = event.supportFloodOptimization;
-  adjacencies_[adjId] =
+  // KvStore may talk to the peer over its thrift server instead
+  if (not ctrlAddr.empty()) {
+    peerSpec.ctrlAddr = ctrlAddr;
+    peerSpec.ctrlPort = event.neighbor.openrCtrlThriftPort;
+  }
+  auto& adjValue = adjacencies_[adjId] =
       AdjacencyValue(peerSpec, std::move(newAdj), false, area);
+  if (useRttMetric_ and rttMetricDampening_) {
+    adjValue.metricDampener.emplace(
+        *rttMetricDampening_, rttMetric, std::chrono::steady_clock::now());
+    adjValue.measuredRttUs = event.rttUs;
+  }
 
   // Advertise KvStore peers immediately
-  advertiseKvStorePeers(area, {{remoteNodeName, peerSpec}});
+  advertisements.peers[area][remoteNodeName] = peerSpec;
 
   // Advertise new adjancies in a throttled fashion
-  advertiseAdjacenciesThrottled_->operator()();
+  dirtyAdjacencyAreas_.emplace(area);
+  advertisements.throttleAdjacencies = true;
 }
 
 void
 LinkMonitor::neighborDownEvent(
     const std::string& remoteNodeName,
     const std::string& ifName,
-    const std::string& area) {
+    const std::string& area,
+    NeighborAdvertisements& advertisements) {
   const auto adjId = std::make_pair(remoteNodeName, ifName);
 
   SYSLOG(INFO) << "Neighbor " << remoteNodeName << " is down on interface "
@@ -460,15 +565,16 @@ LinkMonitor::neighborDownEvent(
     adjacencies_.erase(adjValueIt);
   }
   // advertise both peers and adjacencies
-  advertiseKvStorePeers(area);
-  advertiseAdjacencies(area);
+  advertisements.peers[area].erase(remoteNodeName);
+  advertisements.adjacencyAreas.emplace(area);
 }
 
 void
 LinkMonitor::neighborRestartingEvent(
     const std::string& remoteNodeName,
     const std::string& ifName,
-    const std::string& area) {
+    const std::string& area,
+    NeighborAdvertisements& advertisements) {
   const auto adjId = std::make_pair(remoteNodeName, ifName);
   SYSLOG(INFO) << "Neighbor " << remoteNodeName
                << " is restarting on interface " << ifName;
@@ -478,7 +584,7 @@ LinkMonitor::neighborRestartingEvent(
   if (adjValueIt != adjacencies_.end()) {
     adjValueIt->second.isRestarting = true;
   }
-  advertiseKvStorePeers(area);
+  advertisements.peers[area].erase(remoteNodeName);
 }
 
 std::unordered_map<std::string, thrift::PeerSpec>
@@ -593,14 +699,8 @@ LinkMonitor::advertiseKvStorePeers(
   }
 }
 
-void
-LinkMonitor::advertiseAdjacencies(const std::string& area) {
-  if (std::chrono::steady_clock::now() < adjHoldUntilTimePoint_) {
-    // Too early for advertising my own adjacencies. Let timeout advertise it
-    // and skip here.
-    return;
-  }
-
+thrift::AdjacencyDatabase
+LinkMonitor::buildAdjacencyDatabase(const std::string& area) {
   auto adjDb = thrift::AdjacencyDatabase();
   adjDb.thisNodeName = nodeId_;
   adjDb.isOverloaded = state_.isOverloaded;
@@ -640,20 +740,69 @@ LinkMonitor::advertiseAdjacencies(const std::string& area) {
   } else {
     DCHECK(!adjDb.perfEvents.has_value());
   }
+  return adjDb;
+}
+
+void
+LinkMonitor::advertiseAdjacencies(
+    const std::unordered_set<std::string>& areas) {
+  if (std::chrono::steady_clock::now() < adjHoldUntilTimePoint_) {
+    // Too early for advertising my own adjacencies. Let timeout advertise it
+    // and skip here.
+    return;
+  }
+  if (areas.empty()) {
+    return;
+  }
+
+  // databases are built here, only their serialization runs on adjDbExecutor_
+  std::vector<std::pair<std::string, thrift::AdjacencyDatabase>> adjDbs;
+  for (const auto& area : areas) {
+    auto adjDb = buildAdjacencyDatabase(area);
+    LOG(INFO) << "Updating adjacency database in KvStore with "
+              << adjDb.adjacencies.size() << " entries in area: " << area;
+    if (perAdjacencyKeys_) {
+      advertisePerAdjacencyKeys(area, adjDb);
+    }
+    adjDbs.emplace_back(area, std::move(adjDb));
+  }
+
+  std::vector<std::string> adjDbStrs;
+  if (adjDbExecutor_ and adjDbs.size() > 1) {
+    std::vector<folly::Future<std::string>> futures;
+    for (const auto& areaAdjDb : adjDbs) {
+      futures.emplace_back(
+          folly::via(adjDbExecutor_.get(), [this, &areaAdjDb]() {
+            return writeLsdbValue(
+                areaAdjDb.second, serializer_, compactLsdbEncoding_);
+          }));
+    }
+    for (auto& adjDbStr : folly::collectAll(futures).get()) {
+      adjDbStrs.emplace_back(std::move(adjDbStr).value());
+    }
+  } else {
+    for (const auto& areaAdjDb : adjDbs) {
+      adjDbStrs.emplace_back(writeLsdbValue(
+          areaAdjDb.second, serializer_, compactLsdbEncoding_));
+    }
+  }
 
-  LOG(INFO) << "Updating adjacency database in KvStore with "
-            << adjDb.adjacencies.size() << " entries in area: " << area;
   const auto keyName = adjacencyDbMarker_ + nodeId_;
-  std::string adjDbStr = fbzmq::util::writeThriftObjStr(adjDb, serializer_);
-  kvStoreClient_->persistKey(keyName, adjDbStr, ttlKeyInKvStore_, area);
+  for (size_t i = 0; i < adjDbs.size(); ++i) {
+    const auto& area = adjDbs[i].first;
+    kvStoreClient_->persistKey(
+        keyName, std::move(adjDbStrs[i]), ttlKeyInKvStore_, area);
+    dirtyAdjacencyAreas_.erase(area);
+  }
   fb303::fbData->addStatValue(
-      "link_monitor.advertise_adjacencies", 1, fb303::SUM);
+      "link_monitor.advertise_adjacencies", adjDbs.size(), fb303::SUM);
 
   // Config is most likely to have changed. Update it in `ConfigStore`
   configStore_->storeThriftObj(kConfigKey, state_); // not awaiting on result
 
-  // Cancel throttle timeout if scheduled
-  if (advertiseAdjacenciesThrottled_->isActive()) {
+  // Cancel throttle timeout if scheduled and nothing left for it
+  if (dirtyAdjacencyAreas_.empty() and
+      advertiseAdjacenciesThrottled_->isActive()) {
     advertiseAdjacenciesThrottled_->cancel();
   }
 
@@ -665,13 +814,119 @@ LinkMonitor::advertiseAdjacencies(const std::string& area) {
         "link_monitor.metric." + adj.otherNodeName, adj.metric);
   }
 }
+
+void
+LinkMonitor::advertiseAdjacenciesThrottled(const std::string& area) {
+  dirtyAdjacencyAreas_.emplace(area);
+  advertiseAdjacenciesThrottled_->operator()();
+}
+
+void
+LinkMonitor::advertiseInterfaceAdjacenciesThrottled(const std::string& ifName) {
+  for (const auto& adjKv : adjacencies_) {
+    if (adjKv.first.second == ifName) {
+      advertiseAdjacenciesThrottled(adjKv.second.area);
+    }
+  }
+}
+
+void
+LinkMonitor::advertisePerAdjacencyKeys(
+    const std::string& area, thrift::AdjacencyDatabase& adjDb) {
+  // node attributes stay with the adjacency db key, hence a change of them
+  // does not flood all adjacencies again
+  thrift::AdjacencyDatabase perAdjDb;
+  perAdjDb.thisNodeName = nodeId_;
+  perAdjDb.area = area;
+
+  auto& advertisedKeys = perAdjacencyKeysAdvertised_[area];
+  std::unordered_set<std::string> keys;
+  for (auto& adj : adjDb.adjacencies) {
+    auto key = createPerAdjacencyKey(
+        adjacencyDbMarker_, nodeId_, adj.ifName, adj.otherNodeName);
+    perAdjDb.adjacencies = {std::move(adj)};
+    // no-op unless the adjacency changed
+    kvStoreClient_->persistKey(
+        key,
+        writeLsdbValue(perAdjDb, serializer_, compactLsdbEncoding_),
+        ttlKeyInKvStore_,
+        area);
+    advertisedKeys.erase(key);
+    keys.emplace(std::move(key));
+  }
+  adjDb.adjacencies.clear();
+
+  // one last value without adjacency signifies withdraw, then the key
+  // should ttl out
+  perAdjDb.adjacencies.clear();
+  const auto withdrawnValue =
+      writeLsdbValue(perAdjDb, serializer_, compactLsdbEncoding_);
+  for (auto const& key : advertisedKeys) {
+    LOG(INFO) << "Withdrawing key: " << key << " from KvStore area: " << area;
+    kvStoreClient_->clearKey(key, withdrawnValue, ttlKeyInKvStore_, area);
+  }
+  advertisedKeys = std::move(keys);
+}
+
 void
 LinkMonitor::advertiseAdjacencies() {
-  // advertise to all areas. Once area configuration per link is implemented
-  // then adjacencies can be advertised to a specific area
-  for (const auto& area : areas_) {
-    // Update KvStore
-    advertiseAdjacencies(area);
+  // node wide state, e.g. overload bit or node label, changed
+  advertiseAdjacencies(areas_);
+}
+
+bool
+LinkMonitor::updateRttMetric(AdjacencyValue& adjValue, int32_t rttUs) {
+  auto& adj = adjValue.adjacency;
+  auto metric = getRttMetric(rttUs);
+  if (adjValue.metricDampener) {
+    const auto now = std::chrono::steady_clock::now();
+    adjValue.measuredRttUs = rttUs;
+    auto dampenedMetric = adjValue.metricDampener->update(metric, now);
+    if (not dampenedMetric) {
+      if (adjValue.metricDampener->isSuppressed()) {
+        VLOG(1) << "Suppressed metric change of adjacency to "
+                << adj.otherNodeName << " on " << adj.ifName << " to "
+                << metric;
+        fb303::fbData->addStatValue(
+            "link_monitor.rtt_metric_change.suppressed", 1, fb303::SUM);
+        if (not metricReuseTimer_->isScheduled()) {
+          metricReuseTimer_->scheduleTimeout(
+              adjValue.metricDampener->getReuseDelay(now));
+        }
+      }
+      return false;
+    }
+    metric = *dampenedMetric;
+  }
+  adj.metric = metric;
+  adj.rtt = rttUs;
+  return true;
+}
+
+void
+LinkMonitor::reuseRttMetrics() {
+  const auto now = std::chrono::steady_clock::now();
+  std::optional<std::chrono::milliseconds> nextReuseDelay;
+  for (auto& kv : adjacencies_) {
+    auto& adjValue = kv.second;
+    if (not adjValue.metricDampener) {
+      continue;
+    }
+    if (auto metric = adjValue.metricDampener->reuse(now)) {
+      VLOG(1) << "Advertising metric " << *metric << " of adjacency to "
+              << kv.first.first << " on " << kv.first.second
+              << " held back by dampening";
+      adjValue.adjacency.metric = *metric;
+      adjValue.adjacency.rtt = adjValue.measuredRttUs;
+      advertiseAdjacenciesThrottled(adjValue.area);
+    }
+    if (adjValue.metricDampener->isSuppressed()) {
+      const auto delay = adjValue.metricDampener->getReuseDelay(now);
+      nextReuseDelay = std::min(delay, nextReuseDelay.value_or(delay));
+    }
+  }
+  if (nextReuseDelay) {
+    metricReuseTimer_->scheduleTimeout(*nextReuseDelay);
   }
 }
 
@@ -700,12 +955,21 @@ void
 LinkMonitor::advertiseInterfaces() {
   fb303::fbData->addStatValue("link_monitor.advertise_links", 1, fb303::SUM);
 
-  // Create interface database
+  // Create interface database. All interfaces after a (re)sync from the
+  // platform, else only those changed since the last one
   thrift::InterfaceDatabase ifDb;
   ifDb.thisNodeName = nodeId_;
+  ifDb.isDelta = not std::exchange(advertiseFullInterfaceDb_, false);
   for (auto& kv : interfaces_) {
     auto& ifName = kv.first;
     auto& interface = kv.second;
+    // addresses to redistribute may have changed as well
+    if (interface.isDirty()) {
+      dirtyRedistInterfaces_.emplace(ifName);
+    }
+    if (ifDb.isDelta and not interface.isDirty()) {
+      continue;
+    }
     // Perform regex match
     if (not checkIncludeExcludeRegex(
             ifName, includeRegexList_, excludeRegexList_)) {
@@ -714,13 +978,47 @@ LinkMonitor::advertiseInterfaces() {
     // Get interface info and override active status
     auto interfaceInfo = interface.getInterfaceInfo();
     interfaceInfo.isUp = interface.isActive();
+    interface.clearDirty();
     ifDb.interfaces.emplace(ifName, std::move(interfaceInfo));
   }
+  if (ifDb.isDelta and ifDb.interfaces.empty()) {
+    return;
+  }
 
   // publish new interface database to other modules (Fib & Spark)
   interfaceUpdatesQueue_.push(std::move(ifDb));
 }
 
+thrift::PrefixEntry
+LinkMonitor::createRedistPrefixEntry(thrift::PrefixEntry prefixEntry) {
+  prefixEntry.type = thrift::PrefixType::LOOPBACK;
+  prefixEntry.forwardingType = forwardingTypeMpls_
+      ? thrift::PrefixForwardingType::SR_MPLS
+      : thrift::PrefixForwardingType::IP;
+  prefixEntry.forwardingAlgorithm = forwardingAlgoKsp2Ed_
+      ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
+      : thrift::PrefixForwardingAlgorithm::SP_ECMP;
+  return prefixEntry;
+}
+
+std::vector<thrift::PrefixEntry>
+LinkMonitor::getRedistPrefixes(InterfaceEntry& interface) {
+  // Ignore in-active interfaces
+  if (not interface.isActive()) {
+    return {};
+  }
+  // Perform regex match
+  if (not matchRegexSet(interface.getIfName(), redistRegexList_)) {
+    return {};
+  }
+  // All prefixes of this interface
+  auto prefixes = interface.getGlobalUnicastNetworks(enableV4_);
+  for (auto& prefix : prefixes) {
+    prefix = createRedistPrefixEntry(std::move(prefix));
+  }
+  return prefixes;
+}
+
 void
 LinkMonitor::advertiseRedistAddrs() {
   if (std::chrono::steady_clock::now() < adjHoldUntilTimePoint_) {
@@ -729,55 +1027,100 @@ LinkMonitor::advertiseRedistAddrs() {
     return;
   }
 
-  std::vector<thrift::PrefixEntry> prefixes;
+  // First time, sync all of them. This withdraws what PrefixManager still
+  // has of an earlier run
+  if (not redistPrefixesSynced_) {
+    redistPrefixesSynced_ = true;
+    dirtyRedistInterfaces_.clear();
+
+    std::vector<thrift::PrefixEntry> prefixes;
+
+    // Add static prefixes
+    for (auto const& prefix : staticPrefixes_) {
+      auto prefixEntry = openr::thrift::PrefixEntry();
+      prefixEntry.prefix = prefix;
+      prefixEntry.data = "";
+      prefixEntry.ephemeral.reset();
+      prefixes.emplace_back(createRedistPrefixEntry(std::move(prefixEntry)));
+      ++redistPrefixRefs_[prefix];
+    }
 
-  // Add static prefixes
-  for (auto const& prefix : staticPrefixes_) {
-    auto prefixEntry = openr::thrift::PrefixEntry();
-    prefixEntry.prefix = prefix;
-    prefixEntry.type = thrift::PrefixType::LOOPBACK;
-    prefixEntry.data = "";
-    prefixEntry.forwardingType = forwardingTypeMpls_
-        ? thrift::PrefixForwardingType::SR_MPLS
-        : thrift::PrefixForwardingType::IP;
-    prefixEntry.forwardingAlgorithm = forwardingAlgoKsp2Ed_
-        ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
-        : thrift::PrefixForwardingAlgorithm::SP_ECMP;
-    prefixEntry.ephemeral.reset();
-    prefixes.push_back(prefixEntry);
+    // Add redistribute addresses
+    for (auto& kv : interfaces_) {
+      for (auto& prefix : getRedistPrefixes(kv.second)) {
+        if (redistPrefixes_[kv.first].emplace(prefix.prefix).second) {
+          ++redistPrefixRefs_[prefix.prefix];
+        }
+        prefixes.emplace_back(std::move(prefix));
+      }
+    }
+    if (!prefixes.size()) {
+      LOG(INFO) << "Overwrite loopback address with empty address";
+    }
+    // Advertise via prefix manager client
+    thrift::PrefixUpdateRequest request;
+    request.cmd = thrift::PrefixUpdateCommand::SYNC_PREFIXES_BY_TYPE;
+    request.type = openr::thrift::PrefixType::LOOPBACK;
+    request.prefixes = std::move(prefixes);
+    prefixUpdatesQueue_.push(std::move(request));
+    return;
   }
 
-  // Add redistribute addresses
-  for (auto& kv : interfaces_) {
-    auto& interface = kv.second;
-    // Ignore in-active interfaces
-    if (not interface.isActive()) {
-      continue;
+  // Then only prefixes of changed interfaces. A prefix is withdrawn once no
+  // interface has it any longer
+  std::vector<thrift::PrefixEntry> toAdd;
+  std::vector<thrift::PrefixEntry> toWithdraw;
+  for (auto const& ifName : dirtyRedistInterfaces_) {
+    auto it = interfaces_.find(ifName);
+    auto newPrefixes = it != interfaces_.end()
+        ? getRedistPrefixes(it->second)
+        : std::vector<thrift::PrefixEntry>{};
+    auto& advertised = redistPrefixes_[ifName];
+
+    std::unordered_set<thrift::IpPrefix> newSet;
+    for (auto& prefix : newPrefixes) {
+      newSet.emplace(prefix.prefix);
+      if (advertised.emplace(prefix.prefix).second and
+          ++redistPrefixRefs_[prefix.prefix] == 1) {
+        toAdd.emplace_back(std::move(prefix));
+      }
     }
-    // Perform regex match
-    if (not matchRegexSet(interface.getIfName(), redistRegexList_)) {
-      continue;
+    for (auto prefixIt = advertised.begin(); prefixIt != advertised.end();) {
+      if (newSet.count(*prefixIt)) {
+        ++prefixIt;
+        continue;
+      }
+      auto refIt = redistPrefixRefs_.find(*prefixIt);
+      if (--refIt->second == 0) {
+        redistPrefixRefs_.erase(refIt);
+        thrift::PrefixEntry prefixEntry;
+        prefixEntry.prefix = *prefixIt;
+        toWithdraw.emplace_back(
+            createRedistPrefixEntry(std::move(prefixEntry)));
+      }
+      prefixIt = advertised.erase(prefixIt);
     }
-    // Add all prefixes of this interface
-    for (auto& prefix : interface.getGlobalUnicastNetworks(enableV4_)) {
-      prefix.forwardingType = forwardingTypeMpls_
-          ? thrift::PrefixForwardingType::SR_MPLS
-          : thrift::PrefixForwardingType::IP;
-      prefix.forwardingAlgorithm = forwardingAlgoKsp2Ed_
-          ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
-          : thrift::PrefixForwardingAlgorithm::SP_ECMP;
-      prefixes.emplace_back(std::move(prefix));
+    if (advertised.empty()) {
+      redistPrefixes_.erase(ifName);
     }
   }
-  if (!prefixes.size()) {
-    LOG(INFO) << "Overwrite loopback address with empty address";
+  dirtyRedistInterfaces_.clear();
+
+  if (not toWithdraw.empty()) {
+    VLOG(1) << "Withdrawing " << toWithdraw.size()
+            << " redistributed prefixes";
+    thrift::PrefixUpdateRequest request;
+    request.cmd = thrift::PrefixUpdateCommand::WITHDRAW_PREFIXES;
+    request.prefixes = std::move(toWithdraw);
+    prefixUpdatesQueue_.push(std::move(request));
+  }
+  if (not toAdd.empty()) {
+    VLOG(1) << "Advertising " << toAdd.size() << " redistributed prefixes";
+    thrift::PrefixUpdateRequest request;
+    request.cmd = thrift::PrefixUpdateCommand::ADD_PREFIXES;
+    request.prefixes = std::move(toAdd);
+    prefixUpdatesQueue_.push(std::move(request));
   }
-  // Advertise via prefix manager client
-  thrift::PrefixUpdateRequest request;
-  request.cmd = thrift::PrefixUpdateCommand::SYNC_PREFIXES_BY_TYPE;
-  request.type = openr::thrift::PrefixType::LOOPBACK;
-  request.prefixes = std::move(prefixes);
-  prefixUpdatesQueue_.push(std::move(request));
 }
 
 std::chrono::milliseconds
@@ -867,15 +1210,45 @@ bool
 LinkMonitor::syncInterfaces() {
   VLOG(1) << "Syncing Interface DB from Netlink Platform";
 
+  // netlink events and link deltas keep interfaces up to date, only now and
+  // then everything is fetched and advertised again
+  const auto now = std::chrono::steady_clock::now();
+  if (now - lastFullInterfaceSync_ >= Constants::kPlatformFullSyncInterval) {
+    lastFullInterfaceSync_ = now;
+    linkDbSeqNum_ = 0;
+    advertiseFullInterfaceDb_ = true;
+  }
+
   //
   // Retrieve latest link snapshot from SystemService
   //
   std::vector<thrift::Link> links;
   try {
     createNetlinkSystemHandlerClient();
-    client_->sync_getAllLinks(links);
+    if (not getLinksSinceUnsupported_) {
+      try {
+        thrift::LinkDelta linkDelta;
+        client_->sync_getLinksSince(linkDelta, linkDbSeqNum_);
+        VLOG(2) << "Received " << linkDelta.links.size() << " links changed "
+                << "since " << linkDbSeqNum_
+                << (linkDelta.isFullSync ? " (full sync)" : "");
+        linkDbSeqNum_ = linkDelta.seqNum;
+        links = std::move(linkDelta.links);
+      } catch (const apache::thrift::TApplicationException& e) {
+        // platform without the API, fall back to whole link snapshots
+        LOG(WARNING) << "getLinksSince unsupported by SystemService: "
+                     << folly::exceptionStr(e);
+        getLinksSinceUnsupported_ = true;
+      }
+    }
+    if (getLinksSinceUnsupported_) {
+      client_->sync_getAllLinks(links);
+    }
   } catch (const std::exception& e) {
     client_.reset();
+    // missed changes can't be told apart from applied ones any more
+    linkDbSeqNum_ = 0;
+    advertiseFullInterfaceDb_ = true;
     LOG(ERROR) << "Failed to sync LinkDb from NetlinkSystemHandler. Error: "
                << folly::exceptionStr(e);
     return false;
@@ -921,11 +1294,58 @@ LinkMonitor::syncInterfaces() {
     }
   }
 
+  // full interface database is due even if no link changed
+  if (advertiseFullInterfaceDb_) {
+    (*advertiseIfaceAddrThrottled_)();
+  }
+
   return true;
 }
 
 void
-LinkMonitor::processNeighborEvent(thrift::SparkNeighborEvent&& event) {
+LinkMonitor::processLinkEvent(const thrift::LinkEntry& linkEvt) {
+  auto interfaceEntry = getOrCreateInterfaceEntry(linkEvt.ifName);
+  if (interfaceEntry) {
+    const bool wasUp = interfaceEntry->isUp();
+    interfaceEntry->updateAttrs(linkEvt.ifIndex, linkEvt.isUp, linkEvt.weight);
+    logLinkEvent(
+        interfaceEntry->getIfName(),
+        wasUp,
+        interfaceEntry->isUp(),
+        interfaceEntry->getBackoffDuration());
+  }
+}
+
+void
+LinkMonitor::processAddrEvent(const thrift::AddrEntry& addrEvt) {
+  auto interfaceEntry = getOrCreateInterfaceEntry(addrEvt.ifName);
+  if (interfaceEntry) {
+    interfaceEntry->updateAddr(
+        toIPNetwork(addrEvt.ipPrefix, false /* no masking */),
+        addrEvt.isValid);
+  }
+}
+
+void
+LinkMonitor::processNeighborEvents(thrift::SparkNeighborEvents&& events) {
+  NeighborAdvertisements advertisements;
+  for (auto& event : events) {
+    processNeighborEvent(std::move(event), advertisements);
+  }
+
+  for (auto const& kv : advertisements.peers) {
+    advertiseKvStorePeers(kv.first, kv.second);
+  }
+  advertiseAdjacencies(advertisements.adjacencyAreas);
+  if (advertisements.throttleAdjacencies) {
+    advertiseAdjacenciesThrottled_->operator()();
+  }
+}
+
+void
+LinkMonitor::processNeighborEvent(
+    thrift::SparkNeighborEvent&& event,
+    NeighborAdvertisements& advertisements) {
   auto neighborAddrV4 = event.neighbor.transportAddressV4;
   auto neighborAddrV6 = event.neighbor.transportAddressV6;
 
@@ -938,25 +1358,27 @@ LinkMonitor::processNeighborEvent(thrift::SparkNeighborEvent&& event) {
   switch (event.eventType) {
   case thrift::SparkNeighborEventType::NEIGHBOR_UP: {
     logNeighborEvent(event);
-    neighborUpEvent(neighborAddrV4, neighborAddrV6, event);
+    neighborUpEvent(neighborAddrV4, neighborAddrV6, event, advertisements);
     break;
   }
 
   case thrift::SparkNeighborEventType::NEIGHBOR_RESTARTING: {
     logNeighborEvent(event);
-    neighborRestartingEvent(event.neighbor.nodeName, event.ifName, event.area);
+    neighborRestartingEvent(
+        event.neighbor.nodeName, event.ifName, event.area, advertisements);
     break;
   }
 
   case thrift::SparkNeighborEventType::NEIGHBOR_RESTARTED: {
     logNeighborEvent(event);
-    neighborUpEvent(neighborAddrV4, neighborAddrV6, event);
+    neighborUpEvent(neighborAddrV4, neighborAddrV6, event, advertisements);
     break;
   }
 
   case thrift::SparkNeighborEventType::NEIGHBOR_DOWN: {
     logNeighborEvent(event);
-    neighborDownEvent(event.neighbor.nodeName, event.ifName, event.area);
+    neighborDownEvent(
+        event.neighbor.nodeName, event.ifName, event.area, advertisements);
     break;
   }
 
@@ -971,11 +1393,9 @@ LinkMonitor::processNeighborEvent(thrift::SparkNeighborEvent&& event) {
     VLOG(1) << "Metric value changed for neighbor " << event.neighbor.nodeName
             << " to " << newRttMetric;
     auto it = adjacencies_.find({event.neighbor.nodeName, event.ifName});
-    if (it != adjacencies_.end()) {
-      auto& adj = it->second.adjacency;
-      adj.metric = newRttMetric;
-      adj.rtt = event.rttUs;
-      advertiseAdjacenciesThrottled_->operator()();
+    if (it != adjacencies_.end() and updateRttMetric(it->second, event.rttUs)) {
+      dirtyAdjacencyAreas_.emplace(it->second.area);
+      advertisements.throttleAdjacencies = true;
     }
     break;
   }
@@ -1047,7 +1467,9 @@ LinkMonitor::setInterfaceOverload(
           SYSLOG(INFO) << "Unsetting overload bit for interface "
                        << interfaceName;
         }
-        advertiseAdjacenciesThrottled_->operator()();
+        // persisted here, interfaces without adjacencies advertise nothing
+        configStore_->storeThriftObj(kConfigKey, state_); // not awaiting
+        advertiseInterfaceAdjacenciesThrottled(interfaceName);
         p.setValue();
       });
   return sf;
@@ -1098,7 +1520,9 @@ LinkMonitor::setLinkMetric(
           SYSLOG(INFO) << "Removing metric override for interface "
                        << interfaceName;
         }
-        advertiseAdjacenciesThrottled_->operator()();
+        // persisted here, interfaces without adjacencies advertise nothing
+        configStore_->storeThriftObj(kConfigKey, state_); // not awaiting
+        advertiseInterfaceAdjacenciesThrottled(interfaceName);
         p.setValue();
       });
   return sf;
@@ -1157,7 +1581,8 @@ LinkMonitor::setAdjacencyMetric(
       SYSLOG(INFO) << "Removing metric override for adjacency: [" << adjNodeName
                    << ":" << interfaceName << "]";
     }
-    advertiseAdjacenciesThrottled_->operator()();
+    advertiseAdjacenciesThrottled(
+        adjacencies_.at(std::make_pair(adjNodeName, interfaceName)).area);
     p.setValue();
   });
   return sf;
@@ -1242,6 +1667,16 @@ LinkMonitor::getLinkMonitorAdjacencies() {
       adj.metric =
           folly::get_default(state_.adjMetricOverrides, adjKey, adj.metric);
 
+      if (const auto& dampener = adjKv.second.metricDampener) {
+        const auto now = std::chrono::steady_clock::now();
+        thrift::AdjacencyMetricDampening dampening;
+        dampening.measuredMetric = dampener->getMeasuredMetric();
+        dampening.penalty = dampener->getPenalty(now);
+        dampening.isSuppressed = dampener->isSuppressed();
+        dampening.reuseDelayMs = dampener->getReuseDelay(now).count();
+        adj.metricDampening = std::move(dampening);
+      }
+
       adjDb.adjacencies.emplace_back(std::move(adj));
     }
     p.setValue(std::make_unique<thrift::AdjacencyDatabase>(std::move(adjDb)));
@@ -20,6 +20,7 @@
 #include <folly/CppAttributes.h>
 #include <folly/IPAddress.h>
 #include <folly/Optional.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/AsyncTimeout.h>
@@ -40,6 +41,7 @@
 #include <openr/if/gen-cpp2/SystemService.h>
 #include <openr/kvstore/KvStoreClientInternal.h>
 #include <openr/link-monitor/InterfaceEntry.h>
+#include <openr/link-monitor/MetricDampener.h>
 #include <openr/messaging/ReplicateQueue.h>
 #include <openr/platform/PlatformPublisher.h>
 #include <openr/spark/Spark.h>
@@ -54,6 +56,10 @@ struct AdjacencyValue {
   thrift::Adjacency adjacency;
   bool isRestarting{false};
   std::string area{};
+  // RTT based metric changes of adjacency, if dampened
+  std::optional<MetricDampener> metricDampener{};
+  // latest RTT measured, adjacency has the one advertised
+  int32_t measuredRttUs{0};
   AdjacencyValue() {}
   AdjacencyValue(
       thrift::PeerSpec spec,
@@ -111,7 +117,7 @@ class LinkMonitor final : public OpenrEventBase {
       // Queue for spark and kv-store
       messaging::ReplicateQueue<thrift::InterfaceDatabase>& intfUpdatesQueue,
       messaging::ReplicateQueue<thrift::PeerUpdateRequest>& peerUpdatesQueue,
-      messaging::RQueue<thrift::SparkNeighborEvent> neighborUpdatesQueue,
+      messaging::RQueue<thrift::SparkNeighborEvents> neighborUpdatesQueue,
       // URL for monitoring
       MonitorSubmitUrl const& monitorSubmitUrl,
       PersistentStore* configStore,
@@ -129,7 +135,18 @@ class LinkMonitor final : public OpenrEventBase {
       // ttl for a key in the keyvalue store
       std::chrono::milliseconds ttlKeyInKvStore,
       const std::unordered_set<std::string>& areas = {
-          openr::thrift::KvStore_constants::kDefaultArea()});
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      // advertise each adjacency in a key of its own, so that a change of
+      // one floods just that key. The adjacency db key keeps the rest
+      bool perAdjacencyKeys = false,
+      // dampen changes of RTT based metrics if set
+      std::optional<MetricDampenerConfig> rttMetricDampening = std::nullopt,
+      // advertise adjacency databases in the compact encoding
+      bool compactLsdbEncoding = false,
+      // link/addr events of a PlatformPublisher in the same process, read
+      // instead of subscribing to platformPubUrl
+      std::optional<messaging::RQueue<PlatformEvents>> platformEventsQueue =
+          std::nullopt);
 
   ~LinkMonitor() override = default;
 
@@ -191,30 +208,57 @@ class LinkMonitor final : public OpenrEventBase {
   // Initializes ZMQ sockets
   void prepare() noexcept;
 
+  // subscribe to link/addr events of the PlatformPublisher at platformPubUrl_
+  void subscribePlatformEvents() noexcept;
+
   //
   // The following are used to process Spark neighbor up/down
   // events
   //
 
+  // Advertisements due after a batch of neighbor events. They are made once
+  // per area after the whole batch got applied to adjacencies_.
+  struct NeighborAdvertisements {
+    // areas whose KvStore peers may have changed, with the peers just UP
+    std::unordered_map<
+        std::string /* area */,
+        std::unordered_map<std::string, thrift::PeerSpec>>
+        peers;
+
+    // areas whose adjacencies are advertised right away, i.e. lost ones
+    std::unordered_set<std::string> adjacencyAreas;
+
+    // adjacencies gained or changed, their areas are in dirtyAdjacencyAreas_
+    // and advertised in a throttled fashion
+    bool throttleAdjacencies{false};
+  };
+
   void neighborUpEvent(
       const thrift::BinaryAddress& neighborAddrV4,
       const thrift::BinaryAddress& neighborAddrV6,
-      const thrift::SparkNeighborEvent& event);
+      const thrift::SparkNeighborEvent& event,
+      NeighborAdvertisements& advertisements);
 
   void neighborRestartingEvent(
       const std::string& remoteNodeName,
       const std::string& ifName,
-      const std::string& area);
+      const std::string& area,
+      NeighborAdvertisements& advertisements);
 
   void neighborDownEvent(
       const std::string& remoteNodeName,
       const std::string& ifName,
-      const std::string& area);
+      const std::string& area,
+      NeighborAdvertisements& advertisements);
 
   // Used for initial interface discovery and periodic sync with system handler
   // return true if sync is successful
   bool syncInterfaces();
 
+  // apply link/addr event of PlatformPublisher to its interface entry
+  void processLinkEvent(const thrift::LinkEntry& linkEvt);
+  void processAddrEvent(const thrift::AddrEntry& addrEvt);
+
   // derive current peer-spec info from current adjacencies_
   // calculate delta and announce them to KvStore (peer add/remove) if any
   //
@@ -231,18 +275,49 @@ class LinkMonitor final : public OpenrEventBase {
   void advertiseKvStorePeers(
       const std::unordered_map<std::string, thrift::PeerSpec>& upPeers = {});
 
-  // Advertise my adjacencies_ to the KvStore to a specific area
-  void advertiseAdjacencies(const std::string& area);
+  // Advertise my adjacencies_ to the KvStore to the given areas. Adjacency
+  // databases of several areas get serialized in parallel
+  void advertiseAdjacencies(const std::unordered_set<std::string>& areas);
+
+  // Advertise adjacencies of areas in dirtyAdjacencyAreas_ in a throttled
+  // fashion. For an interface, areas of its adjacencies are dirty
+  void advertiseAdjacenciesThrottled(const std::string& area);
+  void advertiseInterfaceAdjacenciesThrottled(const std::string& ifName);
+
+  // adjacency database of area as of adjacencies_ and state_
+  thrift::AdjacencyDatabase buildAdjacencyDatabase(const std::string& area);
+
+  // move adjacencies of adjDb into per adjacency keys of its area, and
+  // withdraw the keys of adjacencies gone since the last call
+  void advertisePerAdjacencyKeys(
+      const std::string& area, thrift::AdjacencyDatabase& adjDb);
 
   // Advertise my adjacencies_ to the KvStore to all areas
   void advertiseAdjacencies();
 
+  // apply RTT based metric change to adjacency, unless it gets dampened.
+  // Returns true if the adjacency changed
+  bool updateRttMetric(AdjacencyValue& adjValue, int32_t rttUs);
+
+  // advertise metrics held back by dampening whose suppression is over, and
+  // schedule metricReuseTimer_ for the next one
+  void reuseRttMetrics();
+
   // Advertise interfaces and addresses to Spark/Fib and PrefixManager
-  // respectively
+  // respectively. Redistributed addresses are synced as a whole the first
+  // time, afterwards only those of interfaces changed since are added or
+  // withdrawn
   void advertiseIfaceAddr();
   void advertiseInterfaces();
   void advertiseRedistAddrs();
 
+  // prefix to advertise for a static or redistributed address
+  thrift::PrefixEntry createRedistPrefixEntry(thrift::PrefixEntry prefixEntry);
+
+  // prefixes redistributed for interface, none unless it is active and
+  // matches redistRegexList_
+  std::vector<thrift::PrefixEntry> getRedistPrefixes(InterfaceEntry& interface);
+
   // get next try time, which should be the minimum remaining time among
   // all unstable (getTimeRemainingUntilRetry() > 0) interfaces.
   // return 0 if no more unstable interface
@@ -258,7 +333,12 @@ class LinkMonitor final : public OpenrEventBase {
   // specified port.
   void createNetlinkSystemHandlerClient();
 
-  void processNeighborEvent(thrift::SparkNeighborEvent&& event);
+  // apply a batch of neighbor events, then advertise the result once
+  void processNeighborEvents(thrift::SparkNeighborEvents&& events);
+
+  void processNeighborEvent(
+      thrift::SparkNeighborEvent&& event,
+      NeighborAdvertisements& advertisements);
 
   // submit events to monitor
   void logNeighborEvent(thrift::SparkNeighborEvent const& event);
@@ -306,8 +386,24 @@ class LinkMonitor final : public OpenrEventBase {
   const bool forwardingAlgoKsp2Ed_{false};
   // used to match the adjacency database keys
   const std::string adjacencyDbMarker_;
+
+  // advertise per adjacency keys, see advertisePerAdjacencyKeys()
+  const bool perAdjacencyKeys_{false};
+
+  // per adjacency keys currently advertised, by area
+  std::unordered_map<std::string, std::unordered_set<std::string>>
+      perAdjacencyKeysAdvertised_;
+
+  // dampening of RTT based metric changes, if enabled
+  const std::optional<MetricDampenerConfig> rttMetricDampening_;
+
+  // advertise adjacency databases in the compact encoding, see LsdbEncoding.h
+  const bool compactLsdbEncoding_{false};
+
   // URL to receive netlink events from PlatformPublisher
   const std::string platformPubUrl_;
+  // link/addr events are read from an in-process queue instead
+  const bool inProcessPlatformEvents_{false};
   // Backoff timers
   const std::chrono::milliseconds flapInitialBackoff_;
   const std::chrono::milliseconds flapMaxBackoff_;
@@ -367,6 +463,29 @@ class LinkMonitor final : public OpenrEventBase {
   std::unique_ptr<fbzmq::ZmqThrottle> advertiseAdjacenciesThrottled_;
   std::unique_ptr<fbzmq::ZmqThrottle> advertiseIfaceAddrThrottled_;
 
+  // areas whose adjacencies changed since they were last advertised
+  std::unordered_set<std::string> dirtyAdjacencyAreas_;
+
+  // static and redistributed prefixes advertised to PrefixManager, with the
+  // number of interfaces and static prefixes having each of them
+  std::unordered_map<thrift::IpPrefix, size_t> redistPrefixRefs_;
+
+  // redistributed prefixes advertised, by interface
+  std::unordered_map<std::string, std::unordered_set<thrift::IpPrefix>>
+      redistPrefixes_;
+
+  // interfaces changed since their prefixes were last redistributed
+  std::unordered_set<std::string> dirtyRedistInterfaces_;
+
+  // redistributed prefixes were synced as a whole with PrefixManager
+  bool redistPrefixesSynced_{false};
+
+  // Timer for advertising dampened RTT metrics once suppression is over
+  std::unique_ptr<fbzmq::ZmqTimeout> metricReuseTimer_;
+
+  // serializes adjacency databases of areas, only with several areas
+  std::unique_ptr<folly::CPUThreadPoolExecutor> adjDbExecutor_;
+
   // Timer for processing interfaces which are in backoff states
   std::unique_ptr<fbzmq::ZmqTimeout> advertiseIfaceAddrTimer_;
 
@@ -374,6 +493,20 @@ class LinkMonitor final : public OpenrEventBase {
   std::unique_ptr<fbzmq::ZmqTimeout> interfaceDbSyncTimer_;
   ExponentialBackoff<std::chrono::milliseconds> expBackoff_;
 
+  // sequence number of the interface DB of SystemService as of the last sync,
+  // 0 to get all links next time
+  int64_t linkDbSeqNum_{0};
+
+  // SystemService has no getLinksSince, sync with getAllLinks instead
+  bool getLinksSinceUnsupported_{false};
+
+  // advertise all interfaces next time instead of those changed only
+  bool advertiseFullInterfaceDb_{true};
+
+  // last time linkDbSeqNum_ got reset for a full sync
+  std::chrono::steady_clock::time_point lastFullInterfaceSync_{
+      std::chrono::steady_clock::now()};
+
   // Thrift client connection to switch SystemService, which we actually use to
   // manipulate routes.
   folly::EventBase evb_;
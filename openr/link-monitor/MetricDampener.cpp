@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MetricDampener.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+MetricDampener::MetricDampener(
+    const MetricDampenerConfig& config,
+    int32_t metric,
+    std::chrono::steady_clock::time_point now)
+    : config_(config),
+      advertisedMetric_(metric),
+      measuredMetric_(metric),
+      penaltyTime_(now) {
+  CHECK_GT(config_.halfLife.count(), 0);
+  CHECK_LE(config_.reuseThreshold, config_.suppressThreshold);
+}
+
+std::optional<int32_t>
+MetricDampener::update(
+    int32_t metric, std::chrono::steady_clock::time_point now) {
+  measuredMetric_ = metric;
+  if (not isSignificant(metric)) {
+    return std::nullopt;
+  }
+
+  penalty_ = getPenalty(now) + config_.penaltyPerChange;
+  penaltyTime_ = now;
+  if (penalty_ >= config_.suppressThreshold) {
+    isSuppressed_ = true;
+  } else if (isSuppressed_ and penalty_ < config_.reuseThreshold) {
+    isSuppressed_ = false;
+  }
+  if (isSuppressed_) {
+    return std::nullopt;
+  }
+
+  advertisedMetric_ = metric;
+  return metric;
+}
+
+std::optional<int32_t>
+MetricDampener::reuse(std::chrono::steady_clock::time_point now) {
+  if (not isSuppressed_ or getPenalty(now) >= config_.reuseThreshold) {
+    return std::nullopt;
+  }
+
+  isSuppressed_ = false;
+  if (not isSignificant(measuredMetric_)) {
+    return std::nullopt;
+  }
+  advertisedMetric_ = measuredMetric_;
+  return measuredMetric_;
+}
+
+std::chrono::milliseconds
+MetricDampener::getReuseDelay(std::chrono::steady_clock::time_point now) const {
+  const auto penalty = getPenalty(now);
+  if (not isSuppressed_ or penalty < config_.reuseThreshold) {
+    return std::chrono::milliseconds(0);
+  }
+  // round up, penalty is below the threshold after the delay
+  const auto halfLives = std::log2(penalty / config_.reuseThreshold);
+  return std::chrono::milliseconds(
+      static_cast<int64_t>(std::ceil(halfLives * config_.halfLife.count())) +
+      1);
+}
+
+double
+MetricDampener::getPenalty(std::chrono::steady_clock::time_point now) const {
+  const std::chrono::duration<double, std::milli> elapsed = now - penaltyTime_;
+  if (elapsed.count() <= 0) {
+    return penalty_;
+  }
+  return penalty_ * std::exp2(-elapsed.count() / config_.halfLife.count());
+}
+
+bool
+MetricDampener::isSignificant(int32_t metric) const {
+  const auto change = std::abs(
+      static_cast<int64_t>(metric) - static_cast<int64_t>(advertisedMetric_));
+  return change != 0 and
+      change >= config_.minRelativeChange * std::abs(advertisedMetric_);
+}
+
+} // namespace openr
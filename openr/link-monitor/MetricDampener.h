@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace openr {
+
+struct MetricDampenerConfig {
+  // penalty added by each advertised or suppressed metric change
+  double penaltyPerChange{1000};
+
+  // changes are suppressed once penalty reaches it ...
+  double suppressThreshold{2000};
+
+  // ... until it decays below this one
+  double reuseThreshold{750};
+
+  // time for the penalty to decay by half
+  std::chrono::milliseconds halfLife{std::chrono::seconds(60)};
+
+  // changes smaller than this fraction of the advertised metric are ignored,
+  // they neither get advertised nor penalized
+  double minRelativeChange{0.1};
+};
+
+/**
+ * Dampens changes of a measured metric, e.g. RTT based metric of an
+ * adjacency, before they are advertised. Each significant change adds to a
+ * penalty which decays exponentially over time. Changes are held back while
+ * the penalty is above the suppress threshold, until it decays below the
+ * reuse threshold, then the last measured metric gets advertised. Similar to
+ * route flap dampening of BGP.
+ *
+ * Time is passed in by the caller, no timers are run.
+ */
+class MetricDampener final {
+ public:
+  MetricDampener(
+      const MetricDampenerConfig& config,
+      int32_t metric,
+      std::chrono::steady_clock::time_point now);
+
+  // new measured metric, returns the metric to advertise if it is due
+  std::optional<int32_t> update(
+      int32_t metric, std::chrono::steady_clock::time_point now);
+
+  // end suppression once penalty decayed enough, returns the metric held back
+  // if it is due now
+  std::optional<int32_t> reuse(std::chrono::steady_clock::time_point now);
+
+  // time until suppression can end, 0 if it is not suppressed
+  std::chrono::milliseconds getReuseDelay(
+      std::chrono::steady_clock::time_point now) const;
+
+  double getPenalty(std::chrono::steady_clock::time_point now) const;
+
+  bool
+  isSuppressed() const {
+    return isSuppressed_;
+  }
+
+  int32_t
+  getAdvertisedMetric() const {
+    return advertisedMetric_;
+  }
+
+  int32_t
+  getMeasuredMetric() const {
+    return measuredMetric_;
+  }
+
+ private:
+  // metric differs enough from the advertised one to be advertised
+  bool isSignificant(int32_t metric) const;
+
+  MetricDampenerConfig config_;
+
+  int32_t advertisedMetric_{0};
+  int32_t measuredMetric_{0};
+
+  // penalty as of penaltyTime_
+  double penalty_{0};
+  std::chrono::steady_clock::time_point penaltyTime_;
+
+  bool isSuppressed_{false};
+};
+
+} // namespace openr
@@ -232,6 +232,56 @@ TEST(InterfaceEntry, BackoffTest) {
   timeout->cancelTimeout();
 }
 
+/**
+ * Test change tracking of InterfaceEntry for incremental advertisements
+ */
+TEST(InterfaceEntry, DirtyTest) {
+  OpenrEventBase evl;
+  fbzmq::ZmqThrottle throttle(
+      evl.getEvb(), std::chrono::milliseconds(1), []() {});
+  auto timeout = fbzmq::ZmqTimeout::make(evl.getEvb(), []() {});
+  InterfaceEntry interface(
+      "iface1",
+      std::chrono::milliseconds(8),
+      std::chrono::milliseconds(64),
+      throttle,
+      *timeout);
+  const auto addr = folly::IPAddress::createNetwork("fe80::1/64", -1, false);
+
+  // 1. New interface is yet to be advertised
+  EXPECT_TRUE(interface.isDirty());
+  interface.clearDirty();
+  EXPECT_FALSE(interface.isDirty());
+
+  // 2. Attribute and address changes, but not repeated ones
+  EXPECT_TRUE(interface.updateAttrs(1, true, 1));
+  EXPECT_TRUE(interface.isDirty());
+  interface.clearDirty();
+  EXPECT_FALSE(interface.updateAttrs(1, true, 1));
+  EXPECT_FALSE(interface.isDirty());
+  EXPECT_TRUE(interface.updateAddr(addr, true));
+  EXPECT_TRUE(interface.isDirty());
+  interface.clearDirty();
+  EXPECT_FALSE(interface.updateAddr(addr, true));
+  EXPECT_FALSE(interface.isDirty());
+
+  // 3. Flap, interface stays inactive during backoff
+  EXPECT_TRUE(interface.updateAttrs(1, false, 1));
+  EXPECT_TRUE(interface.updateAttrs(1, true, 1));
+  EXPECT_FALSE(interface.isActive());
+  interface.clearDirty();
+  EXPECT_FALSE(interface.isDirty());
+
+  // 4. Becoming active once backoff is over is a change too
+  /* sleep override */
+  std::this_thread::sleep_for(interface.getBackoffDuration());
+  EXPECT_TRUE(interface.isDirty());
+  interface.clearDirty();
+  EXPECT_FALSE(interface.isDirty());
+  throttle.cancel();
+  timeout->cancelTimeout();
+}
+
 } // namespace openr
 
 int
@@ -263,6 +263,7 @@ class LinkMonitorTestFixture : public ::testing::Test {
     peerUpdatesQueue.close();
     neighborUpdatesQueue.close();
     prefixUpdatesQueue.close();
+    platformEventsQueue.close();
     kvStoreWrapper->closeQueue();
 
     LOG(INFO) << "Stopping the LinkMonitor thread";
@@ -328,7 +329,8 @@ class LinkMonitorTestFixture : public ::testing::Test {
       std::chrono::milliseconds flapMaxBackoff,
       bool enableSegmentRouting = true,
       std::unordered_set<std::string> areas = {
-          openr::thrift::KvStore_constants::kDefaultArea()}) {
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      bool inProcessPlatformEvents = false) {
     linkMonitor = std::make_unique<LinkMonitor>(
         context,
         "node-1",
@@ -358,7 +360,13 @@ class LinkMonitorTestFixture : public ::testing::Test {
         flapInitalBackoff,
         flapMaxBackoff,
         Constants::kKvStoreDbTtl,
-        areas);
+        areas,
+        false /* per adjacency keys */,
+        std::nullopt /* rtt metric dampening */,
+        false /* compact lsdb encoding */,
+        inProcessPlatformEvents
+            ? std::make_optional(platformEventsQueue.getReader())
+            : std::nullopt);
 
     linkMonitorThread = std::make_unique<std::thread>([this]() {
       folly::setThreadName("LinkMonitor");
@@ -374,7 +382,13 @@ class LinkMonitorTestFixture : public ::testing::Test {
   recvAndReplyIfUpdate() {
     auto ifDb = interfaceUpdatesReader.get();
     ASSERT_TRUE(ifDb.hasValue());
-    sparkIfDb = std::move(ifDb.value().interfaces);
+    // apply deltas like Spark does, keeping the full interface state
+    if (not ifDb->isDelta) {
+      sparkIfDb.clear();
+    }
+    for (auto& kv : ifDb->interfaces) {
+      sparkIfDb[kv.first] = std::move(kv.second);
+    }
     LOG(INFO) << "----------- Interface Updates ----------";
     for (const auto& kv : sparkIfDb) {
       LOG(INFO) << "  Name=" << kv.first << ", Status=" << kv.second.isUp
@@ -547,8 +561,9 @@ class LinkMonitorTestFixture : public ::testing::Test {
 
   messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue;
   messaging::ReplicateQueue<thrift::PeerUpdateRequest> peerUpdatesQueue;
-  messaging::ReplicateQueue<thrift::SparkNeighborEvent> neighborUpdatesQueue;
+  messaging::ReplicateQueue<thrift::SparkNeighborEvents> neighborUpdatesQueue;
   messaging::ReplicateQueue<thrift::PrefixUpdateRequest> prefixUpdatesQueue;
+  messaging::ReplicateQueue<PlatformEvents> platformEventsQueue;
   messaging::RQueue<thrift::InterfaceDatabase> interfaceUpdatesReader{
       interfaceUpdatesQueue.getReader()};
 
@@ -726,7 +741,8 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
     LOG(INFO) << "Testing neighbor UP event!";
     checkNextAdjPub("adj:node-1");
   }
@@ -834,7 +850,8 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
     LOG(INFO) << "Testing neighbor down event!";
     checkNextAdjPub("adj:node-1");
   }
@@ -852,7 +869,7 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
   // Create new neighborUpdatesQueue/peerUpdatesQueue.
   // Previous one is closed
   neighborUpdatesQueue =
-      messaging::ReplicateQueue<thrift::SparkNeighborEvent>();
+      messaging::ReplicateQueue<thrift::SparkNeighborEvents>();
   peerUpdatesQueue = messaging::ReplicateQueue<thrift::PeerUpdateRequest>();
 
   // Recreate KvStore as previous kvStoreUpdatesQueue is closed
@@ -882,7 +899,8 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
     LOG(INFO) << "Testing neighbor up event!";
     checkNextAdjPub("adj:node-1");
   }
@@ -899,7 +917,8 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
         cp,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
     LOG(INFO) << "Testing neighbor down event witgh empty address!";
     checkNextAdjPub("adj:node-1");
   }
@@ -956,6 +975,86 @@ TEST_F(LinkMonitorTestFixture, NodeLabelRemoval) {
   }
 }
 
+// Overrides of an interface without adjacencies advertise nothing, they
+// must get persisted all the same
+TEST_F(LinkMonitorTestFixture, InterfaceOverridesWithoutAdjacency) {
+  SetUp({openr::thrift::KvStore_constants::kDefaultArea()});
+  const std::string linkX = kTestVethNamePrefix + "X";
+  const std::string linkY = kTestVethNamePrefix + "Y";
+
+  auto waitForInterfaces = [this, &linkX, &linkY]() {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (true) {
+      auto links = linkMonitor->getInterfaces().get();
+      if (links->interfaceDetails.count(linkX) and
+          links->interfaceDetails.count(linkY)) {
+        return links;
+      }
+      EXPECT_LT(std::chrono::steady_clock::now(), deadline)
+          << "LinkMonitor didn't learn the interfaces";
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return links;
+      }
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+
+  mockNlHandler->sendLinkEvent(linkX, kTestVethIfIndex[0], true /* is up */);
+  recvAndReplyIfUpdate();
+  mockNlHandler->sendLinkEvent(linkY, kTestVethIfIndex[1], true /* is up */);
+  recvAndReplyIfUpdate();
+  waitForInterfaces();
+
+  linkMonitor->setInterfaceOverload(linkX, true).get();
+  linkMonitor->setLinkMetric(linkY, 123).get();
+
+  {
+    auto state =
+        configStore->loadThriftObj<thrift::LinkMonitorState>(kConfigKey).get();
+    ASSERT_TRUE(state.hasValue());
+    EXPECT_EQ(1, state->overloadedLinks.count(linkX));
+    EXPECT_EQ(123, state->linkMetricOverrides.at(linkY));
+  }
+
+  // stop linkMonitor
+  LOG(INFO) << "Mock restarting link monitor!";
+  neighborUpdatesQueue.close();
+  kvStoreWrapper->closeQueue();
+  linkMonitor->stop();
+  linkMonitorThread->join();
+  linkMonitor.reset();
+
+  // Create new neighbor update queue. Previous one is closed
+  neighborUpdatesQueue.open();
+  kvStoreWrapper->openQueue();
+
+  // mock "restarting" link monitor with existing config store
+  std::string regexErr;
+  auto includeRegexList =
+      std::make_unique<re2::RE2::Set>(regexOpts, re2::RE2::ANCHOR_BOTH);
+  includeRegexList->Add(kTestVethNamePrefix + ".*", &regexErr);
+  includeRegexList->Compile();
+  std::unique_ptr<re2::RE2::Set> excludeRegexList;
+  std::unique_ptr<re2::RE2::Set> redistRegexList;
+  createLinkMonitor(
+      std::move(includeRegexList),
+      std::move(excludeRegexList),
+      std::move(redistRegexList),
+      std::chrono::milliseconds(1),
+      std::chrono::milliseconds(8));
+
+  // the overrides are back, links come from the initial sync
+  auto links = waitForInterfaces();
+  ASSERT_EQ(1, links->interfaceDetails.count(linkX));
+  ASSERT_EQ(1, links->interfaceDetails.count(linkY));
+  EXPECT_TRUE(links->interfaceDetails.at(linkX).isOverloaded);
+  EXPECT_FALSE(links->interfaceDetails.at(linkY).isOverloaded);
+  ASSERT_TRUE(links->interfaceDetails.at(linkY).metricOverride.has_value());
+  EXPECT_EQ(123, links->interfaceDetails.at(linkY).metricOverride.value());
+}
+
 // Test throttling
 TEST_F(LinkMonitorTestFixture, Throttle) {
   SetUp({openr::thrift::KvStore_constants::kDefaultArea()});
@@ -976,7 +1075,8 @@ TEST_F(LinkMonitorTestFixture, Throttle) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
 
   // before throttled function kicks in
@@ -989,7 +1089,8 @@ TEST_F(LinkMonitorTestFixture, Throttle) {
         nb3,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
 
   // neighbor 3 down immediately
@@ -1000,10 +1101,77 @@ TEST_F(LinkMonitorTestFixture, Throttle) {
         nb3,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
+  }
+
+  checkNextAdjPub("adj:node-1");
+}
+
+// events of a batch are applied together, in order, and advertised once
+TEST_F(LinkMonitorTestFixture, NeighborEventBatch) {
+  SetUp({openr::thrift::KvStore_constants::kDefaultArea()});
+  {
+    InSequence dummy;
+
+    {
+      auto adjDb = createAdjDatabase("node-1", {adj_2_1}, kNodeLabel);
+      expectedAdjDbs.push(std::move(adjDb));
+    }
+  }
+
+  // two neighbors up, one of them down again within the same batch
+  {
+    thrift::SparkNeighborEvents events;
+    events.emplace_back(createNeighborEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_UP,
+        "iface_2_1",
+        nb2,
+        100 /* rtt-us */,
+        1 /* label */));
+    events.emplace_back(createNeighborEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_UP,
+        "iface_3_1",
+        nb3,
+        100 /* rtt-us */,
+        1 /* label */));
+    events.emplace_back(createNeighborEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_DOWN,
+        "iface_3_1",
+        nb3,
+        100 /* rtt-us */,
+        1 /* label */));
+    neighborUpdatesQueue.push(std::move(events));
   }
 
   checkNextAdjPub("adj:node-1");
+  // wait for this peer change to propogate
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  checkPeerDump(adj_2_1.otherNodeName, peerSpec_2_1);
+  EXPECT_EQ(0, kvStoreWrapper->getPeers().count(adj_3_1.otherNodeName));
+
+  // neighbor restarting and back within the same batch keeps its peer
+  {
+    thrift::SparkNeighborEvents events;
+    events.emplace_back(createNeighborEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_RESTARTING,
+        "iface_2_1",
+        nb2,
+        100 /* rtt-us */,
+        1 /* label */));
+    events.emplace_back(createNeighborEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_RESTARTED,
+        "iface_2_1",
+        nb2,
+        100 /* rtt-us */,
+        1 /* label */));
+    neighborUpdatesQueue.push(std::move(events));
+  }
+
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  checkPeerDump(adj_2_1.otherNodeName, peerSpec_2_1);
 }
 
 // parallel adjacencies between two nodes via different interfaces
@@ -1041,7 +1209,8 @@ TEST_F(LinkMonitorTestFixture, ParallelAdj) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
 
   checkNextAdjPub("adj:node-1");
@@ -1058,7 +1227,8 @@ TEST_F(LinkMonitorTestFixture, ParallelAdj) {
         nb2,
         100 /* rtt-us */,
         2 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
 
   checkNextAdjPub("adj:node-1");
@@ -1075,7 +1245,8 @@ TEST_F(LinkMonitorTestFixture, ParallelAdj) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
 
   checkNextAdjPub("adj:node-1");
@@ -1098,7 +1269,8 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
 
   // wait for this peer change to propogate
@@ -1114,7 +1286,8 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
 
   // wait for this peer change to propogate
@@ -1130,7 +1303,8 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -1146,7 +1320,8 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
         nb2,
         100 /* rtt-us */,
         2 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
 
   // wait for this peer change to propogate
@@ -1162,7 +1337,8 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -1177,7 +1353,8 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -1192,7 +1369,8 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -1207,7 +1385,8 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -1503,6 +1682,62 @@ TEST_F(LinkMonitorTestFixture, verifyLinkEventSubscription) {
   });
 }
 
+/**
+ * Link and address events of a PlatformPublisher in the same process come in
+ * batches through a queue, instead of the zmq subscription
+ */
+TEST_F(LinkMonitorTestFixture, InProcessPlatformEvents) {
+  SetUp({openr::thrift::KvStore_constants::kDefaultArea()});
+  const std::string linkX = kTestVethNamePrefix + "X";
+  const std::string linkY = kTestVethNamePrefix + "Y";
+
+  // restart link monitor reading events from the queue
+  neighborUpdatesQueue.close();
+  linkMonitor->stop();
+  linkMonitorThread->join();
+  linkMonitor.reset();
+  neighborUpdatesQueue =
+      messaging::ReplicateQueue<thrift::SparkNeighborEvents>();
+
+  std::string regexErr;
+  auto includeRegexList =
+      std::make_unique<re2::RE2::Set>(regexOpts, re2::RE2::ANCHOR_BOTH);
+  includeRegexList->Add(kTestVethNamePrefix + ".*", &regexErr);
+  includeRegexList->Compile();
+  createLinkMonitor(
+      std::move(includeRegexList),
+      nullptr,
+      nullptr,
+      std::chrono::milliseconds(1),
+      std::chrono::milliseconds(8),
+      true,
+      {openr::thrift::KvStore_constants::kDefaultArea()},
+      true /* in-process platform events */);
+
+  // one batch, links before addresses
+  PlatformEvents events;
+  events.links.emplace_back(
+      thrift::LinkEntry(FRAGILE, linkX, kTestVethIfIndex[0], true, 1));
+  events.links.emplace_back(
+      thrift::LinkEntry(FRAGILE, linkY, kTestVethIfIndex[1], true, 1));
+  events.addresses.emplace_back(
+      thrift::AddrEntry(FRAGILE, linkX, toIpPrefix("10.0.0.1/31"), true));
+  events.addresses.emplace_back(
+      thrift::AddrEntry(FRAGILE, linkY, toIpPrefix("10.0.0.2/31"), true));
+  platformEventsQueue.push(std::move(events));
+
+  // updates may be throttled into one
+  while (true) {
+    recvAndReplyIfUpdate();
+    auto res = collateIfUpdates(sparkIfDb);
+    if (res.size() == 2 and res.at(linkX).isUpCount and
+        res.at(linkY).isUpCount and res.at(linkX).v4AddrsMaxCount and
+        res.at(linkY).v4AddrsMaxCount) {
+      break;
+    }
+  }
+}
+
 TEST_F(LinkMonitorTestFixture, verifyAddrEventSubscription) {
   SetUp({openr::thrift::KvStore_constants::kDefaultArea()});
   const std::string linkX = kTestVethNamePrefix + "X";
@@ -1875,6 +2110,46 @@ TEST_F(LinkMonitorTestFixture, StaticLoopbackPrefixAdvertisement) {
   }
 }
 
+/**
+ * Redistributed addresses are added and withdrawn one by one. A prefix that
+ * is also static stays advertised when the address goes away
+ */
+TEST_F(LinkMonitorTestFixture, RedistPrefixWithdrawKeepsStaticPrefix) {
+  SetUp({openr::thrift::KvStore_constants::kDefaultArea()});
+  std::unordered_set<thrift::IpPrefix> prefixes;
+  while (prefixes.size() != 2) {
+    prefixes = getNextPrefixDb("prefix:node-1");
+  }
+
+  // address within a static prefix, and one of its own
+  mockNlHandler->sendLinkEvent("loopback", 101, true);
+  mockNlHandler->sendAddrEvent("loopback", "fc00:face:b00c::1/64", true);
+  mockNlHandler->sendAddrEvent("loopback", "2803:cafe:babe::1/128", true);
+  recvAndReplyIfUpdate();
+
+  prefixes.clear();
+  while (prefixes.size() != 3) {
+    LOG(INFO) << "Testing address advertisements";
+    prefixes = getNextPrefixDb("prefix:node-1");
+  }
+  EXPECT_EQ(1, prefixes.count(staticPrefix1));
+  EXPECT_EQ(1, prefixes.count(staticPrefix2));
+  EXPECT_EQ(1, prefixes.count(toIpPrefix("2803:cafe:babe::1/128")));
+
+  // only the address of its own is withdrawn
+  mockNlHandler->sendAddrEvent("loopback", "fc00:face:b00c::1/64", false);
+  mockNlHandler->sendAddrEvent("loopback", "2803:cafe:babe::1/128", false);
+  recvAndReplyIfUpdate();
+
+  prefixes.clear();
+  while (prefixes.size() != 2) {
+    LOG(INFO) << "Testing address withdraws";
+    prefixes = getNextPrefixDb("prefix:node-1");
+  }
+  EXPECT_EQ(1, prefixes.count(staticPrefix1));
+  EXPECT_EQ(1, prefixes.count(staticPrefix2));
+}
+
 TEST(LinkMonitor, getPeersFromAdjacencies) {
   std::unordered_map<AdjacencyKey, AdjacencyValue> adjacencies;
   std::unordered_map<std::string, thrift::PeerSpec> peers;
@@ -1978,7 +2253,8 @@ TEST_F(LinkMonitorTestFixture, AreaTest) {
           nb2,
           100 /* rtt-us */,
           1 /* label */);
-      neighborUpdatesQueue.push(std::move(neighborEvent));
+      neighborUpdatesQueue.push(
+          thrift::SparkNeighborEvents{std::move(neighborEvent)});
       LOG(INFO) << "Testing neighbor UP event in default area!";
 
       checkNextAdjPub(
@@ -1999,7 +2275,8 @@ TEST_F(LinkMonitorTestFixture, AreaTest) {
           100 /* rtt-us */,
           1 /* label */,
           "plane");
-      neighborUpdatesQueue.push(std::move(neighborEvent));
+      neighborUpdatesQueue.push(
+          thrift::SparkNeighborEvents{std::move(neighborEvent)});
       LOG(INFO) << "Testing neighbor UP event in plane area!";
 
       checkNextAdjPub("adj:node-1", "plane");
@@ -2015,7 +2292,8 @@ TEST_F(LinkMonitorTestFixture, AreaTest) {
         nb2,
         100 /* rtt-us */,
         1 /* label */);
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
     LOG(INFO) << "Testing neighbor UP event!";
     checkNextAdjPub(
         "adj:node-1", openr::thrift::KvStore_constants::kDefaultArea());
@@ -2032,7 +2310,8 @@ TEST_F(LinkMonitorTestFixture, AreaTest) {
         100 /* rtt-us */,
         1 /* label */,
         "plane");
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
     LOG(INFO) << "Testing neighbor UP event!";
     checkNextAdjPub("adj:node-1", "plane");
     checkPeerDump(adj_3_1.otherNodeName, peerSpec_3_1, "plane");
@@ -2048,7 +2327,8 @@ TEST_F(LinkMonitorTestFixture, AreaTest) {
         100 /* rtt-us */,
         1 /* label */,
         "plane");
-    neighborUpdatesQueue.push(std::move(neighborEvent));
+    neighborUpdatesQueue.push(
+        thrift::SparkNeighborEvents{std::move(neighborEvent)});
     LOG(INFO) << "Testing neighbor down event!";
     checkNextAdjPub("adj:node-1", "plane");
   }
@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/link-monitor/MetricDampener.h>
+
+namespace openr {
+
+namespace {
+
+const auto kStart = std::chrono::steady_clock::time_point();
+
+MetricDampenerConfig
+getConfig() {
+  MetricDampenerConfig config;
+  config.penaltyPerChange = 1000;
+  config.suppressThreshold = 2000;
+  config.reuseThreshold = 750;
+  config.halfLife = std::chrono::seconds(10);
+  config.minRelativeChange = 0.1;
+  return config;
+}
+
+} // namespace
+
+/**
+ * Changes smaller than the minimum relative change are neither advertised
+ * nor penalized
+ */
+TEST(MetricDampener, MinRelativeChange) {
+  MetricDampener dampener(getConfig(), 100, kStart);
+
+  EXPECT_FALSE(dampener.update(100, kStart).has_value());
+  EXPECT_FALSE(dampener.update(109, kStart).has_value());
+  EXPECT_FALSE(dampener.update(91, kStart).has_value());
+  EXPECT_EQ(91, dampener.getMeasuredMetric());
+  EXPECT_EQ(100, dampener.getAdvertisedMetric());
+  EXPECT_EQ(0, dampener.getPenalty(kStart));
+
+  EXPECT_EQ(110, dampener.update(110, kStart));
+  EXPECT_EQ(110, dampener.getAdvertisedMetric());
+  EXPECT_EQ(1000, dampener.getPenalty(kStart));
+  EXPECT_FALSE(dampener.isSuppressed());
+}
+
+/**
+ * Penalty halves every half-life
+ */
+TEST(MetricDampener, PenaltyDecay) {
+  MetricDampener dampener(getConfig(), 100, kStart);
+  EXPECT_EQ(200, dampener.update(200, kStart));
+  EXPECT_DOUBLE_EQ(1000, dampener.getPenalty(kStart));
+  EXPECT_DOUBLE_EQ(
+      500, dampener.getPenalty(kStart + std::chrono::seconds(10)));
+  EXPECT_DOUBLE_EQ(
+      250, dampener.getPenalty(kStart + std::chrono::seconds(20)));
+
+  // penalty of a change adds to the decayed one
+  const auto t1 = kStart + std::chrono::seconds(10);
+  EXPECT_EQ(100, dampener.update(100, t1));
+  EXPECT_DOUBLE_EQ(1500, dampener.getPenalty(t1));
+  EXPECT_FALSE(dampener.isSuppressed());
+}
+
+/**
+ * Flapping metric gets suppressed and the last measured one advertised once
+ * the penalty decayed below the reuse threshold
+ */
+TEST(MetricDampener, Suppression) {
+  MetricDampener dampener(getConfig(), 100, kStart);
+  EXPECT_EQ(200, dampener.update(200, kStart));
+  EXPECT_FALSE(dampener.update(100, kStart).has_value());
+  EXPECT_TRUE(dampener.isSuppressed());
+  EXPECT_FALSE(dampener.update(300, kStart).has_value());
+  EXPECT_EQ(200, dampener.getAdvertisedMetric());
+  EXPECT_EQ(300, dampener.getMeasuredMetric());
+  EXPECT_DOUBLE_EQ(3000, dampener.getPenalty(kStart));
+
+  // 3000 -> 750 takes two half-lives
+  const auto reuseDelay = dampener.getReuseDelay(kStart);
+  EXPECT_LE(std::chrono::seconds(20), reuseDelay);
+  EXPECT_GE(std::chrono::milliseconds(20002), reuseDelay);
+  EXPECT_FALSE(dampener.reuse(kStart + std::chrono::seconds(19)).has_value());
+  EXPECT_TRUE(dampener.isSuppressed());
+
+  const auto t1 = kStart + reuseDelay;
+  EXPECT_EQ(300, dampener.reuse(t1));
+  EXPECT_FALSE(dampener.isSuppressed());
+  EXPECT_EQ(300, dampener.getAdvertisedMetric());
+  EXPECT_EQ(std::chrono::milliseconds(0), dampener.getReuseDelay(t1));
+  EXPECT_FALSE(dampener.reuse(t1).has_value());
+}
+
+/**
+ * Metric back at the advertised one while suppressed, nothing to advertise
+ * once suppression is over
+ */
+TEST(MetricDampener, SuppressionWithoutChange) {
+  MetricDampener dampener(getConfig(), 100, kStart);
+  EXPECT_EQ(200, dampener.update(200, kStart));
+  EXPECT_FALSE(dampener.update(100, kStart).has_value());
+  EXPECT_FALSE(dampener.update(200, kStart).has_value());
+  EXPECT_TRUE(dampener.isSuppressed());
+
+  const auto t1 = kStart + std::chrono::seconds(60);
+  EXPECT_FALSE(dampener.reuse(t1).has_value());
+  EXPECT_FALSE(dampener.isSuppressed());
+  EXPECT_EQ(200, dampener.getAdvertisedMetric());
+}
+
+} // namespace openr
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  folly::init(&argc, &argv);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -53,6 +53,14 @@ MockNetlinkSystemHandler::getAllLinks(std::vector<thrift::Link>& linkDb) {
   }
 }
 
+void
+MockNetlinkSystemHandler::getLinksSince(
+    thrift::LinkDelta& linkDelta, int64_t /* seqNum */) {
+  linkDelta.seqNum = linkDbSeqNum_;
+  linkDelta.isFullSync = true;
+  getAllLinks(linkDelta.links);
+}
+
 void
 MockNetlinkSystemHandler::getAllNeighbors(
     std::vector<thrift::NeighborEntry>& neighborDb) {
@@ -85,6 +93,7 @@ MockNetlinkSystemHandler::sendLinkEvent(
       linkDb_[ifName].ifIndex = ifIndex;
     }
   }
+  ++linkDbSeqNum_;
 
   // Pass message thru zmq to subscribers
   platformPublisher_->publishLinkEvent(thrift::LinkEntry(
@@ -104,6 +113,7 @@ MockNetlinkSystemHandler::sendAddrEvent(
       linkDb_[ifName].networks.erase(ipNetwork);
     }
   }
+  ++linkDbSeqNum_;
 
   platformPublisher_->publishAddrEvent(thrift::AddrEntry(
       FRAGILE,
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <syslog.h>
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
@@ -43,6 +44,9 @@ class MockNetlinkSystemHandler final : public thrift::SystemServiceSvIf {
 
   void getAllLinks(std::vector<thrift::Link>& linkDb) override;
 
+  // always a full sync
+  void getLinksSince(thrift::LinkDelta& linkDelta, int64_t seqNum) override;
+
   void getAllNeighbors(std::vector<thrift::NeighborEntry>& neighDb) override;
 
   void sendLinkEvent(
@@ -62,6 +66,9 @@ class MockNetlinkSystemHandler final : public thrift::SystemServiceSvIf {
 
   // Interface/link name => link attributes mapping
   folly::Synchronized<fbnl::NlLinks> linkDb_{};
+
+  // bumped on each change of linkDb_
+  std::atomic<int64_t> linkDbSeqNum_{0};
 };
 
 } // namespace openr
@@ -7,9 +7,62 @@
 
 #pragma once
 
+#include <algorithm>
+
+#include <folly/lang/Bits.h>
+
 namespace openr {
 namespace messaging {
 
+namespace detail {
+
+inline void
+updateMax(std::atomic<uint64_t>& maxVal, uint64_t val) {
+  auto curVal = maxVal.load(std::memory_order_relaxed);
+  while (curVal < val and
+         not maxVal.compare_exchange_weak(
+             curVal, val, std::memory_order_relaxed)) {
+  }
+}
+
+inline uint64_t
+exchangeZero(std::atomic<uint64_t>& val) {
+  return val.exchange(0, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+inline void
+QueueStats::merge(QueueStats const& other) {
+  size = std::max(size, other.size);
+  maxSize = std::max(maxSize, other.maxSize);
+  numWrites += other.numWrites;
+  numReads += other.numReads;
+  numDropped += other.numDropped;
+  numMerged += other.numMerged;
+  sumLatencyUs += other.sumLatencyUs;
+  maxLatencyUs = std::max(maxLatencyUs, other.maxLatencyUs);
+  for (size_t i = 0; i < kNumLatencyBuckets; ++i) {
+    latencyBuckets[i] += other.latencyBuckets[i];
+  }
+}
+
+inline uint64_t
+QueueStats::getLatencyPercentileUs(double percentile) const {
+  if (numReads == 0) {
+    return 0;
+  }
+  const double target = numReads * percentile / 100;
+  uint64_t count{0};
+  for (size_t i = 0; i < kNumLatencyBuckets - 1; ++i) {
+    count += latencyBuckets[i];
+    if (count >= target) {
+      return i ? (1ULL << i) : 0;
+    }
+  }
+  return maxLatencyUs;
+}
+
 template <typename ValueType>
 RQueue<ValueType>::RQueue(std::shared_ptr<RWQueue<ValueType>> queue)
     : queue_(std::move(queue)) {
@@ -22,6 +75,12 @@ RQueue<ValueType>::get() {
   return queue_->get();
 }
 
+template <typename ValueType>
+folly::Expected<std::vector<ValueType>, QueueError>
+RQueue<ValueType>::getBatch(size_t maxItems) {
+  return queue_->getBatch(maxItems);
+}
+
 #if FOLLY_HAS_COROUTINES
 template <typename ValueType>
 folly::coro::Task<folly::Expected<ValueType, QueueError>>
@@ -29,6 +88,13 @@ RQueue<ValueType>::getCoro() {
   auto val = co_await queue_->getCoro();
   co_return val;
 }
+
+template <typename ValueType>
+folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+RQueue<ValueType>::getBatchCoro(size_t maxItems) {
+  auto batch = co_await queue_->getBatchCoro(maxItems);
+  co_return batch;
+}
 #endif
 
 template <typename ValueType>
@@ -40,6 +106,21 @@ RQueue<ValueType>::size() {
 template <typename ValueType>
 RWQueue<ValueType>::RWQueue() {}
 
+template <typename ValueType>
+RWQueue<ValueType>::RWQueue(size_t ringCapacity) {
+  if (ringCapacity) {
+    ring_ = std::make_unique<folly::MPMCQueue<QueuedValue>>(ringCapacity);
+  }
+}
+
+template <typename ValueType>
+RWQueue<ValueType>::RWQueue(QueueCapacity<ValueType> capacity)
+    : capacity_(std::move(capacity)) {
+  assert(
+      capacity_.policy != QueueFullPolicy::MERGE or
+      capacity_.merge != nullptr);
+}
+
 template <typename ValueType>
 RWQueue<ValueType>::~RWQueue() {
   close();
@@ -49,7 +130,33 @@ template <typename ValueType>
 template <typename ValueTypeT>
 bool
 RWQueue<ValueType>::push(ValueTypeT&& val) {
-  std::lock_guard<std::mutex> l(lock_);
+  if (ring_) {
+    if (closed_ or
+        not ring_->write(QueuedValue{std::forward<ValueTypeT>(val),
+                                     std::chrono::steady_clock::now()})) {
+      return false;
+    }
+    recordWrite(std::max<ssize_t>(0, ring_->sizeGuess()));
+    // Pairs with the one of reader going to wait, either we see the reader
+    // or the reader sees our data
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (numRingReads_.load()) {
+      wakeRingReader();
+    }
+    return true;
+  }
+
+  std::unique_lock<std::mutex> l(lock_);
+
+  // Wait for room if queue is full and writers are to be blocked
+  while (not closed_ and pendingReads_.empty() and isFull() and
+         capacity_.policy == QueueFullPolicy::BLOCK) {
+    folly::fibers::Baton baton;
+    pendingWrites_.emplace_back(baton);
+    l.unlock();
+    baton.wait();
+    l.lock();
+  }
 
   // If queue is closed, don't enqueue
   if (closed_) {
@@ -62,9 +169,24 @@ RWQueue<ValueType>::push(ValueTypeT&& val) {
     pendingRead.data = std::forward<ValueTypeT>(val);
     pendingRead.baton.post();
     pendingReads_.pop_front();
+    recordWrite(0);
+    recordRead(std::chrono::steady_clock::now());
+  } else if (isFull() and capacity_.policy == QueueFullPolicy::MERGE) {
+    // Merge into latest data, keeping its enqueue time
+    capacity_.merge(
+        queue_.back().value, ValueType(std::forward<ValueTypeT>(val)));
+    numMerged_.fetch_add(1, std::memory_order_relaxed);
+    recordWrite(queue_.size());
   } else {
+    if (isFull()) {
+      assert(capacity_.policy == QueueFullPolicy::DROP_OLDEST);
+      queue_.pop_front();
+      numDropped_.fetch_add(1, std::memory_order_relaxed);
+    }
     // Add data into the queue
-    queue_.emplace_back(std::forward<ValueTypeT>(val));
+    queue_.emplace_back(QueuedValue{std::forward<ValueTypeT>(val),
+                                    std::chrono::steady_clock::now()});
+    recordWrite(queue_.size());
   }
 
   return true;
@@ -73,6 +195,20 @@ RWQueue<ValueType>::push(ValueTypeT&& val) {
 template <typename ValueType>
 folly::Expected<ValueType, QueueError>
 RWQueue<ValueType>::get() {
+  if (ring_) {
+    while (true) {
+      PendingRead pendingRead;
+      if (not getRingImpl(pendingRead)) {
+        return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
+      }
+      if (pendingRead.data) {
+        return std::move(pendingRead.data).value();
+      }
+      // Woken up, data may have been taken by another reader meanwhile
+      pendingRead.baton.wait();
+    }
+  }
+
   PendingRead pendingRead;
 
   // Queue is closed
@@ -95,10 +231,51 @@ RWQueue<ValueType>::get() {
   return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
 }
 
+template <typename ValueType>
+folly::Expected<std::vector<ValueType>, QueueError>
+RWQueue<ValueType>::getBatch(size_t maxItems) {
+  assert(maxItems > 0);
+  auto first = get();
+  if (first.hasError()) {
+    return folly::makeUnexpected(first.error());
+  }
+  std::vector<ValueType> batch;
+  batch.emplace_back(std::move(first).value());
+  drainImpl(batch, maxItems);
+  return batch;
+}
+
 #if FOLLY_HAS_COROUTINES
+template <typename ValueType>
+folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+RWQueue<ValueType>::getBatchCoro(size_t maxItems) {
+  assert(maxItems > 0);
+  auto first = co_await getCoro();
+  if (first.hasError()) {
+    co_return folly::makeUnexpected(first.error());
+  }
+  std::vector<ValueType> batch;
+  batch.emplace_back(std::move(first).value());
+  drainImpl(batch, maxItems);
+  co_return batch;
+}
+
 template <typename ValueType>
 folly::coro::Task<folly::Expected<ValueType, QueueError>>
 RWQueue<ValueType>::getCoro() {
+  if (ring_) {
+    while (true) {
+      PendingRead pendingRead;
+      if (not getRingImpl(pendingRead)) {
+        co_return folly::makeUnexpected(QueueError::QUEUE_CLOSED);
+      }
+      if (pendingRead.data) {
+        co_return std::move(pendingRead.data).value();
+      }
+      co_await pendingRead.baton;
+    }
+  }
+
   PendingRead pendingRead;
 
   // Queue is closed
@@ -132,8 +309,9 @@ RWQueue<ValueType>::getAnyImpl(PendingRead& pendingRead) {
 
   // Perform immediate read if data is available
   if (queue_.size()) {
-    pendingRead.data = std::move(queue_.front());
-    queue_.pop_front();
+    recordRead(queue_.front().enqueueTime);
+    pendingRead.data = std::move(queue_.front().value);
+    popFront();
     return true;
   }
 
@@ -142,6 +320,91 @@ RWQueue<ValueType>::getAnyImpl(PendingRead& pendingRead) {
   return true;
 }
 
+template <typename ValueType>
+void
+RWQueue<ValueType>::drainImpl(std::vector<ValueType>& batch, size_t maxItems) {
+  if (ring_) {
+    QueuedValue val;
+    while (batch.size() < maxItems and ring_->read(val)) {
+      recordRead(val.enqueueTime);
+      batch.emplace_back(std::move(val.value));
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> l(lock_);
+  while (batch.size() < maxItems and queue_.size()) {
+    recordRead(queue_.front().enqueueTime);
+    batch.emplace_back(std::move(queue_.front().value));
+    popFront();
+  }
+}
+
+template <typename ValueType>
+bool
+RWQueue<ValueType>::getRingImpl(PendingRead& pendingRead) {
+  if (closed_) {
+    return false;
+  }
+
+  // Perform immediate read if data is available
+  QueuedValue val;
+  if (ring_->read(val)) {
+    recordRead(val.enqueueTime);
+    pendingRead.data = std::move(val.value);
+    return true;
+  }
+
+  std::lock_guard<std::mutex> l(lock_);
+  if (closed_) {
+    return false;
+  }
+
+  // Announce read request before checking for data once more, writers check
+  // for readers after writing their data
+  pendingReads_.emplace_back(pendingRead);
+  numRingReads_.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring_->read(val)) {
+    // We are the last one enqueued, nobody could have woken us up
+    pendingReads_.pop_back();
+    numRingReads_.fetch_sub(1);
+    recordRead(val.enqueueTime);
+    pendingRead.data = std::move(val.value);
+  }
+  return true;
+}
+
+template <typename ValueType>
+void
+RWQueue<ValueType>::wakeRingReader() {
+  std::lock_guard<std::mutex> l(lock_);
+  if (pendingReads_.empty()) {
+    return;
+  }
+  auto& pendingRead = pendingReads_.front().get();
+  pendingReads_.pop_front();
+  numRingReads_.fetch_sub(1);
+  pendingRead.baton.post();
+}
+
+template <typename ValueType>
+bool
+RWQueue<ValueType>::isFull() const {
+  return capacity_.maxSize and queue_.size() >= capacity_.maxSize;
+}
+
+template <typename ValueType>
+void
+RWQueue<ValueType>::popFront() {
+  queue_.pop_front();
+  if (pendingWrites_.size()) {
+    auto& baton = pendingWrites_.front().get();
+    pendingWrites_.pop_front();
+    baton.post();
+  }
+}
+
 template <typename ValueType>
 void
 RWQueue<ValueType>::close() {
@@ -150,14 +413,26 @@ RWQueue<ValueType>::close() {
   if (not closed_) {
     closed_ = true;
     // Either one of these must be zero
-    assert(pendingReads_.size() == 0 || queue_.size() == 0);
+    assert(ring_ || pendingReads_.size() == 0 || queue_.size() == 0);
     // Set empy value to all pending reads
     while (pendingReads_.size()) {
       auto& pendingRead = pendingReads_.front().get();
       pendingRead.baton.post();
       pendingReads_.pop_front();
     }
+    numRingReads_ = 0;
+    // Blocked writes fail
+    while (pendingWrites_.size()) {
+      auto& baton = pendingWrites_.front().get();
+      pendingWrites_.pop_front();
+      baton.post();
+    }
     queue_.clear();
+    if (ring_) {
+      QueuedValue val;
+      while (ring_->read(val)) {
+      }
+    }
   }
 }
 
@@ -171,6 +446,10 @@ RWQueue<ValueType>::isClosed() {
 template <typename ValueType>
 size_t
 RWQueue<ValueType>::size() {
+  if (ring_) {
+    // May be off while push/get are in flight
+    return std::max<ssize_t>(0, ring_->sizeGuess());
+  }
   std::lock_guard<std::mutex> l(lock_);
   return queue_.size();
 }
@@ -182,5 +461,49 @@ RWQueue<ValueType>::numPendingReads() {
   return pendingReads_.size();
 }
 
+template <typename ValueType>
+QueueStats
+RWQueue<ValueType>::getStats() {
+  QueueStats stats;
+  stats.size = size();
+  // high-watermark of next interval starts at current size
+  stats.maxSize = std::max<uint64_t>(
+      stats.size, maxSize_.exchange(stats.size, std::memory_order_relaxed));
+  stats.numWrites = detail::exchangeZero(numWrites_);
+  stats.numReads = detail::exchangeZero(numReads_);
+  stats.numDropped = detail::exchangeZero(numDropped_);
+  stats.numMerged = detail::exchangeZero(numMerged_);
+  stats.sumLatencyUs = detail::exchangeZero(sumLatencyUs_);
+  stats.maxLatencyUs = detail::exchangeZero(maxLatencyUs_);
+  for (size_t i = 0; i < QueueStats::kNumLatencyBuckets; ++i) {
+    stats.latencyBuckets[i] = detail::exchangeZero(latencyBuckets_[i]);
+  }
+  return stats;
+}
+
+template <typename ValueType>
+void
+RWQueue<ValueType>::recordWrite(size_t size) {
+  numWrites_.fetch_add(1, std::memory_order_relaxed);
+  detail::updateMax(maxSize_, size);
+}
+
+template <typename ValueType>
+void
+RWQueue<ValueType>::recordRead(
+    std::chrono::steady_clock::time_point enqueueTime) {
+  const uint64_t latencyUs = std::max<int64_t>(
+      0,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - enqueueTime)
+          .count());
+  numReads_.fetch_add(1, std::memory_order_relaxed);
+  sumLatencyUs_.fetch_add(latencyUs, std::memory_order_relaxed);
+  detail::updateMax(maxLatencyUs_, latencyUs);
+  const size_t bucket = std::min<size_t>(
+      folly::findLastSet(latencyUs), QueueStats::kNumLatencyBuckets - 1);
+  latencyBuckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
 } // namespace messaging
 } // namespace openr
@@ -8,12 +8,18 @@
 #pragma once
 
 #include <any>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 #include <folly/Expected.h>
+#include <folly/MPMCQueue.h>
 #include <folly/fibers/Baton.h>
 #if FOLLY_HAS_COROUTINES
 #include <folly/experimental/coro/Task.h>
@@ -26,6 +32,65 @@ enum class QueueError {
   QUEUE_CLOSED,
 };
 
+/**
+ * What push does when a bounded queue is full
+ */
+enum class QueueFullPolicy {
+  // wait until a reader makes room, or the queue gets closed
+  BLOCK,
+  // drop the oldest pending element
+  DROP_OLDEST,
+  // merge the new element into the latest pending one
+  MERGE,
+};
+
+/**
+ * Capacity limit of a queue. Pending reads are always served right away, the
+ * policy only applies once `maxSize` elements are pending.
+ */
+template <typename ValueType>
+struct QueueCapacity {
+  // 0 for unbounded queue
+  size_t maxSize{0};
+
+  QueueFullPolicy policy{QueueFullPolicy::BLOCK};
+
+  // Required for MERGE policy, merges newer value into the queued one
+  std::function<void(ValueType& queued, ValueType&& newer)> merge{nullptr};
+};
+
+/**
+ * Stats of a queue since they were last retrieved, except size which is the
+ * current one.
+ */
+struct QueueStats {
+  // Reads are bucketed by enqueue to dequeue latency, bucket `i > 0` counts
+  // latencies in [2^(i-1), 2^i) microseconds, last one everything above
+  static constexpr size_t kNumLatencyBuckets{25};
+
+  // number of pending elements, and high-watermark of it
+  size_t size{0};
+  size_t maxSize{0};
+
+  uint64_t numWrites{0};
+  uint64_t numReads{0};
+
+  // writes dropping/merged into a pending element of a full queue
+  uint64_t numDropped{0};
+  uint64_t numMerged{0};
+
+  uint64_t sumLatencyUs{0};
+  uint64_t maxLatencyUs{0};
+  std::array<uint64_t, kNumLatencyBuckets> latencyBuckets{};
+
+  // Add up stats of another queue, e.g. of another reader stream. Size is
+  // the deepest one
+  void merge(QueueStats const& other);
+
+  // Upper bound of latency bucket holding given percentile of reads
+  uint64_t getLatencyPercentileUs(double percentile) const;
+};
+
 template <typename ValueType>
 class RWQueue;
 
@@ -44,11 +109,19 @@ class RQueue {
    */
   folly::Expected<ValueType, QueueError> get();
 
+  /**
+   * Blocking read of all available data up to `maxItems`, at least one
+   */
+  folly::Expected<std::vector<ValueType>, QueueError> getBatch(
+      size_t maxItems);
+
 #if FOLLY_HAS_COROUTINES
   /**
    * Read methods for co-routines
    */
   folly::coro::Task<folly::Expected<ValueType, QueueError>> getCoro();
+  folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+  getBatchCoro(size_t maxItems);
 #endif
 
   // Utility function to retrieve size of pending data in underlying queue
@@ -69,16 +142,30 @@ class RQueue {
  *
  * After closing queue, all subsequent push are ignored and return false. All
  * subsequent reads return QUEUE_CLOSED error
+ *
+ * Optionally data can be kept in a bounded lock-free ring buffer instead. Push
+ * and get of available data don't take the lock then, and only readers
+ * waiting for data get woken up, i.e. readers which keep up with writers
+ * don't cost any wakeup. Push fails when the ring buffer is full, so it must
+ * be sized for the largest burst. ValueType must be default constructible.
  */
 template <typename ValueType>
 class RWQueue {
  public:
   RWQueue();
+
+  // Use bounded ring buffer of given capacity, 0 for unbounded queue
+  explicit RWQueue(size_t ringCapacity);
+
+  // Use queue with capacity limit and policy when full
+  explicit RWQueue(QueueCapacity<ValueType> capacity);
+
   ~RWQueue();
 
   /**
-   * Non blocking push. Any typed value can be pushed!
-   * Return true/false!!
+   * Non blocking push, unless queue is full with BLOCK policy. Any typed value
+   * can be pushed!
+   * Return true/false!! False also if ring buffer is full
    */
   template <typename ValueTypeT>
   bool push(ValueTypeT&& val);
@@ -89,11 +176,21 @@ class RWQueue {
    */
   folly::Expected<ValueType, QueueError> get();
 
+  /**
+   * Blocking read of all available data up to `maxItems`. Waits like `get`
+   * for the first element only, the rest is taken in one go without
+   * suspending again.
+   */
+  folly::Expected<std::vector<ValueType>, QueueError> getBatch(
+      size_t maxItems);
+
 #if FOLLY_HAS_COROUTINES
   /**
    * Read methods for co-routines
    */
   folly::coro::Task<folly::Expected<ValueType, QueueError>> getCoro();
+  folly::coro::Task<folly::Expected<std::vector<ValueType>, QueueError>>
+  getBatchCoro(size_t maxItems);
 #endif
 
   /**
@@ -112,28 +209,88 @@ class RWQueue {
    */
   size_t numPendingReads();
 
+  /**
+   * Return stats since last call and reset them. Elements are timestamped on
+   * push to measure latency until they are read.
+   */
+  QueueStats getStats();
+
  private:
   struct PendingRead {
     folly::fibers::Baton baton;
     std::optional<ValueType> data;
   };
 
+  struct QueuedValue {
+    ValueType value;
+    std::chrono::steady_clock::time_point enqueueTime;
+  };
+
+  // Update stats on push/read of an element
+  void recordWrite(size_t size);
+  void recordRead(std::chrono::steady_clock::time_point enqueueTime);
+
   /**
    * Implementation for push
    */
   bool getAnyImpl(PendingRead& pendingRead);
 
+  /**
+   * Move available data into batch until it has `maxItems`, without waiting
+   */
+  void drainImpl(std::vector<ValueType>& batch, size_t maxItems);
+
+  /**
+   * Implementation for get from ring buffer. Either reads data immediately or
+   * enqueues read request, to be woken up once there might be data
+   */
+  bool getRingImpl(PendingRead& pendingRead);
+
+  // Wake up one of the readers waiting for data in ring buffer
+  void wakeRingReader();
+
+  // Whether capacity limit is reached, must be called with lock held
+  bool isFull() const;
+
+  // Pop front of queue and wake up a writer waiting for room, must be called
+  // with lock held
+  void popFront();
+
   // Lock to protect below private variables
   std::mutex lock_;
 
-  // State of queue
-  bool closed_{false};
+  // State of queue. Read without lock for ring buffer
+  std::atomic<bool> closed_{false};
+
+  // Ring buffer holding data instead of the queue below if set
+  std::unique_ptr<folly::MPMCQueue<QueuedValue>> ring_{nullptr};
+
+  // Number of readers waiting for data in ring buffer, lets writers skip the
+  // lock when there are none
+  std::atomic<size_t> numRingReads_{0};
 
   // Pending reads - readers are actively waiting for data
   std::deque<std::reference_wrapper<PendingRead>> pendingReads_;
 
   // Pending data
-  std::deque<ValueType> queue_;
+  std::deque<QueuedValue> queue_;
+
+  // Capacity limit of above queue
+  QueueCapacity<ValueType> capacity_;
+
+  // Pending writes - writers waiting for room in a full queue
+  std::deque<std::reference_wrapper<folly::fibers::Baton>> pendingWrites_;
+
+  // Stats since last getStats, updated without lock for ring buffer
+  std::atomic<uint64_t> maxSize_{0};
+  std::atomic<uint64_t> numWrites_{0};
+  std::atomic<uint64_t> numReads_{0};
+  std::atomic<uint64_t> numDropped_{0};
+  std::atomic<uint64_t> numMerged_{0};
+  std::atomic<uint64_t> sumLatencyUs_{0};
+  std::atomic<uint64_t> maxLatencyUs_{0};
+  std::array<std::atomic<uint64_t>, QueueStats::kNumLatencyBuckets>
+      latencyBuckets_{};
 };
 
 } // namespace messaging
@@ -11,7 +11,14 @@ namespace openr {
 namespace messaging {
 
 template <typename ValueType>
-ReplicateQueue<ValueType>::ReplicateQueue() {}
+ReplicateQueue<ValueType>::ReplicateQueue(
+    std::string name, size_t ringCapacity)
+    : name_(std::move(name)), ringCapacity_(ringCapacity) {}
+
+template <typename ValueType>
+ReplicateQueue<ValueType>::ReplicateQueue(
+    std::string name, QueueCapacity<ValueType> capacity)
+    : name_(std::move(name)), capacity_(std::move(capacity)) {}
 
 template <typename ValueType>
 ReplicateQueue<ValueType>::~ReplicateQueue() {
@@ -23,6 +30,7 @@ template <typename ValueTypeT>
 bool
 ReplicateQueue<ValueType>::push(ValueTypeT&& value) {
   std::vector<std::shared_ptr<RWQueue<ValueType>>> readers;
+  std::vector<Reader> filteredReaders;
 
   // Copy reader information - and cleans up stale reader
   {
@@ -30,17 +38,29 @@ ReplicateQueue<ValueType>::push(ValueTypeT&& value) {
     if (closed_) {
       return false;
     }
+    ++numWrites_;
     for (auto it = lockedReaders->begin(); it != lockedReaders->end();) {
-      if (it->use_count() == 1) {
-        (*it)->close(); // Close before erasing
+      if (it->queue.use_count() == 1) {
+        it->queue->close(); // Close before erasing
         it = lockedReaders->erase(it);
+      } else if (it->filter) {
+        filteredReaders.emplace_back(*it); // NOTE: intentionally copying
+        ++it;
       } else {
-        readers.emplace_back(*it); // NOTE: intentionally copying shared_ptr
+        readers.emplace_back(it->queue); // NOTE: intentionally copying
         ++it;
       }
     }
   }
 
+  // Filtered readers first, value may get moved to the last reader below
+  for (auto const& reader : filteredReaders) {
+    auto filtered = (*reader.filter)(value);
+    if (filtered.has_value()) {
+      reader.queue->push(std::move(filtered).value());
+    }
+  }
+
   // Replicate messages
   if (readers.size()) {
     for (int i = 0; i < readers.size() - 1; i++) {
@@ -53,6 +73,15 @@ ReplicateQueue<ValueType>::push(ValueTypeT&& value) {
   return true;
 }
 
+template <typename ValueType>
+std::shared_ptr<RWQueue<ValueType>>
+ReplicateQueue<ValueType>::createQueue() const {
+  if (ringCapacity_) {
+    return std::make_shared<RWQueue<ValueType>>(ringCapacity_);
+  }
+  return std::make_shared<RWQueue<ValueType>>(capacity_);
+}
+
 /**
  * Get new reader stream of this queue. Stream will get closed automatically
  * when reader is destructed.
@@ -64,8 +93,20 @@ ReplicateQueue<ValueType>::getReader() {
   if (closed_) {
     throw std::runtime_error("queue is closed");
   }
-  lockedReaders->emplace_back(std::make_shared<RWQueue<ValueType>>());
-  return RQueue<ValueType>(lockedReaders->back());
+  lockedReaders->emplace_back(Reader{createQueue(), nullptr});
+  return RQueue<ValueType>(lockedReaders->back().queue);
+}
+
+template <typename ValueType>
+RQueue<ValueType>
+ReplicateQueue<ValueType>::getReader(Filter filter) {
+  auto lockedReaders = readers_.wlock();
+  if (closed_) {
+    throw std::runtime_error("queue is closed");
+  }
+  lockedReaders->emplace_back(Reader{
+      createQueue(), std::make_shared<const Filter>(std::move(filter))});
+  return RQueue<ValueType>(lockedReaders->back().queue);
 }
 
 template <typename ValueType>
@@ -73,8 +114,8 @@ size_t
 ReplicateQueue<ValueType>::getNumReaders() {
   auto lockedReaders = readers_.wlock();
   for (auto it = lockedReaders->begin(); it != lockedReaders->end();) {
-    if (it->use_count() == 1) {
-      (*it)->close(); // Close before erasing
+    if (it->queue.use_count() == 1) {
+      it->queue->close(); // Close before erasing
       it = lockedReaders->erase(it);
     } else {
       ++it;
@@ -83,16 +124,80 @@ ReplicateQueue<ValueType>::getNumReaders() {
   return lockedReaders->size();
 }
 
+template <typename ValueType>
+QueueStats
+ReplicateQueue<ValueType>::getStats() {
+  QueueStats stats;
+  auto lockedReaders = readers_.wlock();
+  for (auto const& reader : *lockedReaders) {
+    stats.merge(reader.queue->getStats());
+  }
+  stats.numWrites = numWrites_;
+  numWrites_ = 0;
+  return stats;
+}
+
 template <typename ValueType>
 void
 ReplicateQueue<ValueType>::close() {
   auto lockedReaders = readers_.wlock();
   closed_ = true;
-  for (auto& queue : *lockedReaders) {
-    queue->close();
+  for (auto& reader : *lockedReaders) {
+    reader.queue->close();
   }
   lockedReaders->clear();
 }
 
+template <typename ValueType>
+SharedReplicateQueue<ValueType>::SharedReplicateQueue(
+    std::string name, size_t ringCapacity)
+    : queue_(std::move(name), ringCapacity) {}
+
+template <typename ValueType>
+template <typename ValueTypeT>
+bool
+SharedReplicateQueue<ValueType>::push(ValueTypeT&& value) {
+  // NOTE: instance is created mutable, makes moving out in takeValue legal
+  SharedValue sharedValue =
+      std::make_shared<ValueType>(std::forward<ValueTypeT>(value));
+  return queue_.push(std::move(sharedValue));
+}
+
+template <typename ValueType>
+RQueue<typename SharedReplicateQueue<ValueType>::SharedValue>
+SharedReplicateQueue<ValueType>::getReader() {
+  return queue_.getReader();
+}
+
+template <typename ValueType>
+size_t
+SharedReplicateQueue<ValueType>::getNumReaders() {
+  return queue_.getNumReaders();
+}
+
+template <typename ValueType>
+QueueStats
+SharedReplicateQueue<ValueType>::getStats() {
+  return queue_.getStats();
+}
+
+template <typename ValueType>
+void
+SharedReplicateQueue<ValueType>::close() {
+  queue_.close();
+}
+
+template <typename ValueType>
+ValueType
+SharedReplicateQueue<ValueType>::takeValue(SharedValue&& value) {
+  assert(value);
+  auto sharedValue = std::move(value);
+  // No one else can get hold of the instance once we are the only owner
+  if (sharedValue.use_count() == 1) {
+    return std::move(const_cast<ValueType&>(*sharedValue));
+  }
+  return ValueType(*sharedValue);
+}
+
 } // namespace messaging
 } // namespace openr
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <optional>
+
+#include <folly/Function.h>
+
 #include <openr/messaging/Queue.h>
 
 namespace openr {
@@ -18,11 +22,26 @@ namespace messaging {
  * reader exists then all the messages are silently dropped.
  *
  * Pushed object must be copy constructible.
+ *
+ * name: name of the queue, used for exporting its stats
+ * ringCapacity: if non zero, streams of readers are bounded lock-free ring
+ * buffers of this capacity, see RWQueue
+ * capacity: capacity limit and policy of each reader stream. With BLOCK
+ * policy writer waits for the slowest reader.
  */
 template <typename ValueType>
 class ReplicateQueue {
  public:
-  ReplicateQueue();
+  /**
+   * Filter of a reader, run by the writer on every pushed value. Returns the
+   * value or the part of it the reader is interested in, std::nullopt if the
+   * reader shouldn't get it at all. May run on several writers concurrently.
+   */
+  using Filter =
+      folly::Function<std::optional<ValueType>(ValueType const&) const>;
+
+  explicit ReplicateQueue(std::string name = "", size_t ringCapacity = 0);
+  ReplicateQueue(std::string name, QueueCapacity<ValueType> capacity);
 
   ~ReplicateQueue();
 
@@ -51,11 +70,30 @@ class ReplicateQueue {
    */
   RQueue<ValueType> getReader();
 
+  /**
+   * Get new reader stream of this queue which only receives what filter
+   * returns. Values are filtered at push time, readers pay neither for the
+   * copy nor for the wake-up of values they aren't interested in.
+   */
+  RQueue<ValueType> getReader(Filter filter);
+
   /**
    * Number of replicated streams/readers
    */
   size_t getNumReaders();
 
+  const std::string&
+  getName() const {
+    return name_;
+  }
+
+  /**
+   * Stats of all reader streams since last call, see RWQueue::getStats. Size
+   * is the one of the deepest stream, i.e. of the slowest reader, and writes
+   * are the ones to this queue.
+   */
+  QueueStats getStats();
+
   /**
    * Open the underlying queue. ONLY used for UT purpose.
    */
@@ -70,8 +108,76 @@ class ReplicateQueue {
   void close();
 
  private:
-  folly::Synchronized<std::list<std::shared_ptr<RWQueue<ValueType>>>> readers_;
+  struct Reader {
+    std::shared_ptr<RWQueue<ValueType>> queue;
+    // nullptr if reader gets every value
+    std::shared_ptr<const Filter> filter;
+  };
+
+  // stream for a new reader
+  std::shared_ptr<RWQueue<ValueType>> createQueue() const;
+
+  folly::Synchronized<std::list<Reader>> readers_;
   bool closed_{false}; // Protected by above Synchronized lock
+  uint64_t numWrites_{0}; // Protected by above Synchronized lock
+  std::string name_;
+  size_t ringCapacity_{0};
+  QueueCapacity<ValueType> capacity_;
+};
+
+/**
+ * Variant of ReplicateQueue for large values. Pushed value is stored once in
+ * an immutable shared instance and readers get pointers to it, instead of a
+ * copy per reader.
+ *
+ * Reader which still needs a mutable value can take it with `takeValue`. It
+ * is moved out if no other reader holds the same instance anymore, copied
+ * otherwise.
+ */
+template <typename ValueType>
+class SharedReplicateQueue {
+ public:
+  using SharedValue = std::shared_ptr<const ValueType>;
+
+  explicit SharedReplicateQueue(
+      std::string name = "", size_t ringCapacity = 0);
+
+  /**
+   * Push any value into the queue. Value is moved (or copied if lvalue) into
+   * one shared instance for all readers.
+   */
+  template <typename ValueTypeT>
+  bool push(ValueTypeT&& value);
+
+  /**
+   * Get new reader stream of this queue, see ReplicateQueue::getReader
+   */
+  RQueue<SharedValue> getReader();
+
+  size_t getNumReaders();
+
+  const std::string&
+  getName() const {
+    return queue_.getName();
+  }
+
+  QueueStats getStats();
+
+  void
+  open() {
+    queue_.open();
+  }
+
+  void close();
+
+  /**
+   * Take value out of shared instance. Moves it out if we are the only one
+   * holding it, copies otherwise.
+   */
+  static ValueType takeValue(SharedValue&& value);
+
+ private:
+  ReplicateQueue<SharedValue> queue_;
 };
 
 } // namespace messaging
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+
+#include <openr/messaging/Queue.h>
+
+namespace openr::messaging {
+
+/**
+ * Throughput of RWQueue with unbounded queue or bounded ring buffer
+ * 1. Create queue, ring buffer large enough to never be full
+ * 2. Start readers and writers on native threads
+ * 3. Writers push `iters` messages in total, readers get them till the last
+ *    one and close the queue
+ * Time is reported per message.
+ */
+static void
+BM_QueueThroughput(
+    uint32_t iters,
+    bool useRing,
+    size_t numWriters,
+    size_t numReaders) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto q = std::make_unique<RWQueue<size_t>>(useRing ? iters : 0);
+  const size_t countPerWriter = iters / numWriters;
+  const size_t total = countPerWriter * numWriters;
+  std::atomic<size_t> totalReads{0};
+  std::vector<std::thread> threads;
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (size_t i = 0; i < numReaders; ++i) {
+    threads.emplace_back([&]() {
+      while (q->get().hasValue()) {
+        if (++totalReads == total) {
+          q->close();
+        }
+      }
+    });
+  }
+  for (size_t i = 0; i < numWriters; ++i) {
+    threads.emplace_back([&, i]() {
+      for (size_t j = 0; j < countPerWriter; ++j) {
+        q->push(i * countPerWriter + j);
+      }
+    });
+  }
+  if (total == 0) {
+    q->close();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  suspender.rehire(); // Stop measuring time again
+}
+
+// The parameters are ring buffer or not, number of writers and readers
+BENCHMARK_NAMED_PARAM(BM_QueueThroughput, deque_1_1, false, 1, 1);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_QueueThroughput, ring_1_1, true, 1, 1);
+BENCHMARK_NAMED_PARAM(BM_QueueThroughput, deque_4_4, false, 4, 4);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_QueueThroughput, ring_4_4, true, 4, 4);
+BENCHMARK_NAMED_PARAM(BM_QueueThroughput, deque_16_16, false, 16, 16);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_QueueThroughput, ring_16_16, true, 16, 16);
+
+} // namespace openr::messaging
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -5,6 +5,9 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <folly/executors/ManualExecutor.h>
@@ -289,6 +292,226 @@ TEST(RWQueueTest, CoroTest) {
 }
 #endif
 
+TEST(RWQueueTest, RingSizeAndReaders) {
+  RWQueue<int> q(4);
+
+  q.push(1);
+  q.push(2);
+  EXPECT_EQ(2, q.size());
+  EXPECT_EQ(1, q.get().value());
+  EXPECT_EQ(2, q.get().value());
+  EXPECT_EQ(0, q.size());
+
+  // Push fails when ring is full
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(q.push(i));
+  }
+  EXPECT_FALSE(q.push(4));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(i, q.get().value());
+  }
+
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+  manager.addTask([&q]() mutable { EXPECT_EQ(1, q.get().value()); });
+  manager.addTask([&q]() mutable { EXPECT_EQ(2, q.get().value()); });
+
+  evb.loopOnce();
+  EXPECT_EQ(0, q.size());
+  EXPECT_EQ(2, q.numPendingReads());
+
+  q.push(1);
+  q.push(2);
+  evb.loopOnce();
+  EXPECT_EQ(0, q.size());
+  EXPECT_EQ(0, q.numPendingReads());
+}
+
+TEST(RWQueueTest, RingClosed) {
+  RWQueue<int> q(4);
+
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+  manager.addTask([&q]() mutable {
+    auto x = q.get(); // Perform read
+    EXPECT_TRUE(x.hasError());
+    EXPECT_EQ(x.error(), QueueError::QUEUE_CLOSED);
+  });
+
+  evb.loopOnce(); // Fiber should get stuck at the read
+  EXPECT_EQ(1, q.numPendingReads());
+
+  q.close();
+  evb.loopOnce();
+  EXPECT_TRUE(q.isClosed());
+  EXPECT_EQ(0, q.numPendingReads());
+  EXPECT_FALSE(q.push(1));
+  EXPECT_EQ(0, q.size());
+  EXPECT_EQ(q.get().error(), QueueError::QUEUE_CLOSED);
+}
+
+TEST(RWQueueTest, RingMultiThreadTest) {
+  const size_t kNumReaders{16};
+  const size_t kNumWriters{16};
+  const size_t kCountPerWriter{8192};
+  RWQueue<size_t> q(kNumWriters * kCountPerWriter);
+
+  std::atomic<size_t> totalReads{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumReaders; ++i) {
+    threads.emplace_back([&q, &totalReads]() {
+      while (q.get().hasValue()) {
+        if (++totalReads == kNumWriters * kCountPerWriter) {
+          q.close();
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kNumWriters; ++i) {
+    threads.emplace_back([&q, i]() {
+      for (int j = 0; j < kCountPerWriter; ++j) {
+        EXPECT_TRUE(q.push(i * kCountPerWriter + j));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(kNumWriters * kCountPerWriter, totalReads);
+}
+
+TEST(RWQueueTest, GetBatch) {
+  // Unbounded queue and ring buffer
+  for (const size_t ringCapacity : {0, 16}) {
+    RWQueue<int> q(ringCapacity);
+    for (int i = 0; i < 5; ++i) {
+      q.push(i);
+    }
+    EXPECT_EQ(std::vector<int>({0, 1, 2}), q.getBatch(3).value());
+    EXPECT_EQ(std::vector<int>({3, 4}), q.getBatch(10).value());
+    EXPECT_EQ(0, q.size());
+
+    // Batch read waits for first element only
+    folly::EventBase evb;
+    auto& manager = folly::fibers::getFiberManager(evb);
+    manager.addTask([&q]() mutable {
+      EXPECT_EQ(std::vector<int>({5}), q.getBatch(10).value());
+    });
+    evb.loopOnce();
+    EXPECT_EQ(1, q.numPendingReads());
+    q.push(5);
+    evb.loopOnce();
+    EXPECT_EQ(0, q.numPendingReads());
+
+#if FOLLY_HAS_COROUTINES
+    auto coroRead = [](RWQueue<int>& q) -> folly::coro::Task<void> {
+      auto batch = co_await q.getBatchCoro(2);
+      EXPECT_EQ(std::vector<int>({6, 7}), batch.value());
+    };
+    q.push(6);
+    q.push(7);
+    q.push(8);
+    folly::ManualExecutor executor;
+    coroRead(q).scheduleOn(&executor).start();
+    executor.drain();
+    EXPECT_EQ(1, q.size());
+#endif
+
+    q.close();
+    EXPECT_EQ(QueueError::QUEUE_CLOSED, q.getBatch(10).error());
+  }
+}
+
+TEST(RWQueueTest, Stats) {
+  // Unbounded queue and ring buffer
+  for (const size_t ringCapacity : {0, 16}) {
+    RWQueue<int> q(ringCapacity);
+    q.push(1);
+    q.push(2);
+    q.push(3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_EQ(1, q.get().value());
+
+    auto stats = q.getStats();
+    EXPECT_EQ(2, stats.size);
+    EXPECT_EQ(3, stats.maxSize);
+    EXPECT_EQ(3, stats.numWrites);
+    EXPECT_EQ(1, stats.numReads);
+    EXPECT_LE(2000, stats.maxLatencyUs);
+    EXPECT_EQ(stats.maxLatencyUs, stats.sumLatencyUs);
+    EXPECT_LE(stats.maxLatencyUs, stats.getLatencyPercentileUs(50));
+
+    // Stats are reset, high-watermark starts at current size
+    EXPECT_EQ(std::vector<int>({2, 3}), q.getBatch(10).value());
+    stats = q.getStats();
+    EXPECT_EQ(0, stats.size);
+    EXPECT_EQ(2, stats.maxSize);
+    EXPECT_EQ(0, stats.numWrites);
+    EXPECT_EQ(2, stats.numReads);
+
+    stats = q.getStats();
+    EXPECT_EQ(0, stats.maxSize);
+    EXPECT_EQ(0, stats.numReads);
+    EXPECT_EQ(0, stats.getLatencyPercentileUs(99));
+  }
+}
+
+TEST(RWQueueTest, BoundedDropOldest) {
+  RWQueue<int> q(QueueCapacity<int>{2, QueueFullPolicy::DROP_OLDEST});
+  EXPECT_TRUE(q.push(1));
+  EXPECT_TRUE(q.push(2));
+  EXPECT_TRUE(q.push(3));
+  EXPECT_EQ(2, q.size());
+  EXPECT_EQ(std::vector<int>({2, 3}), q.getBatch(10).value());
+  EXPECT_EQ(1, q.getStats().numDropped);
+}
+
+TEST(RWQueueTest, BoundedMerge) {
+  RWQueue<std::vector<int>> q(QueueCapacity<std::vector<int>>{
+      2,
+      QueueFullPolicy::MERGE,
+      [](std::vector<int>& queued, std::vector<int>&& newer) {
+        queued.insert(queued.end(), newer.begin(), newer.end());
+      }});
+  q.push(std::vector<int>{1});
+  q.push(std::vector<int>{2});
+  q.push(std::vector<int>{3});
+  q.push(std::vector<int>{4});
+  EXPECT_EQ(2, q.size());
+  EXPECT_EQ(std::vector<int>({1}), q.get().value());
+  EXPECT_EQ(std::vector<int>({2, 3, 4}), q.get().value());
+  EXPECT_EQ(2, q.getStats().numMerged);
+}
+
+TEST(RWQueueTest, BoundedBlock) {
+  RWQueue<int> q(QueueCapacity<int>{1, QueueFullPolicy::BLOCK});
+  folly::EventBase evb;
+  auto& manager = folly::fibers::getFiberManager(evb);
+
+  // Second push waits for the first element to be read
+  bool pushed{false};
+  manager.addTask([&q, &pushed]() mutable {
+    EXPECT_TRUE(q.push(1));
+    EXPECT_TRUE(q.push(2));
+    pushed = true;
+    // Blocked push fails once queue is closed
+    EXPECT_FALSE(q.push(3));
+  });
+  evb.loopOnce();
+  EXPECT_FALSE(pushed);
+  EXPECT_EQ(1, q.size());
+
+  EXPECT_EQ(1, q.get().value());
+  evb.loopOnce();
+  EXPECT_TRUE(pushed);
+  EXPECT_EQ(1, q.size());
+
+  q.close();
+  evb.loopOnce();
+  EXPECT_EQ(0, q.size());
+}
+
 TEST(RQueueTest, ReadTest) {
   auto rwq = std::make_shared<RWQueue<int>>();
   RQueue<int> rq(rwq);
@@ -84,3 +84,88 @@ TEST(ReplicateQueueTest, OpenQueueTest) {
 
   q.close();
 }
+
+TEST(ReplicateQueueTest, Stats) {
+  ReplicateQueue<int> q("test");
+  EXPECT_EQ("test", q.getName());
+  auto r1 = q.getReader();
+  auto r2 = q.getReader();
+
+  q.push(1);
+  q.push(2);
+  EXPECT_EQ(1, r1.get().value());
+
+  // Depth of slowest reader
+  auto stats = q.getStats();
+  EXPECT_EQ(2, stats.size);
+  EXPECT_EQ(2, stats.numWrites);
+  EXPECT_EQ(1, stats.numReads);
+
+  stats = q.getStats();
+  EXPECT_EQ(0, stats.numWrites);
+  q.close();
+}
+
+TEST(ReplicateQueueTest, FilteredReader) {
+  ReplicateQueue<std::vector<int>> q;
+  auto all = q.getReader();
+  // even numbers only, nothing if there are none
+  auto even = q.getReader(
+      [](std::vector<int> const& value) -> std::optional<std::vector<int>> {
+        std::vector<int> evenValue;
+        for (auto i : value) {
+          if (i % 2 == 0) {
+            evenValue.emplace_back(i);
+          }
+        }
+        if (evenValue.empty()) {
+          return std::nullopt;
+        }
+        return evenValue;
+      });
+  EXPECT_EQ(2, q.getNumReaders());
+
+  q.push(std::vector<int>{1, 2, 3, 4});
+  q.push(std::vector<int>{1, 3});
+  q.push(std::vector<int>{6});
+
+  EXPECT_EQ(3, all.size());
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4}), all.get().value());
+  EXPECT_EQ(std::vector<int>({1, 3}), all.get().value());
+  EXPECT_EQ(std::vector<int>({6}), all.get().value());
+
+  EXPECT_EQ(2, even.size());
+  EXPECT_EQ(std::vector<int>({2, 4}), even.get().value());
+  EXPECT_EQ(std::vector<int>({6}), even.get().value());
+
+  q.close();
+  EXPECT_TRUE(even.get().hasError());
+}
+
+TEST(SharedReplicateQueueTest, Test) {
+  using Queue = SharedReplicateQueue<std::vector<int>>;
+  Queue q;
+  auto r1 = q.getReader();
+  auto r2 = q.getReader();
+  EXPECT_EQ(2, q.getNumReaders());
+
+  const std::vector<int> value{1, 2, 3};
+  EXPECT_TRUE(q.push(value));
+
+  // Readers share one instance
+  auto v1 = r1.get().value();
+  auto v2 = r2.get().value();
+  EXPECT_EQ(v1.get(), v2.get());
+  EXPECT_EQ(value, *v1);
+
+  // Copied while shared, moved out once we are the only owner
+  const auto* data = v2->data();
+  EXPECT_EQ(value, Queue::takeValue(std::move(v1)));
+  auto taken = Queue::takeValue(std::move(v2));
+  EXPECT_EQ(value, taken);
+  EXPECT_EQ(data, taken.data());
+
+  q.close();
+  EXPECT_EQ(0, q.getNumReaders());
+  EXPECT_TRUE(r1.get().hasError());
+}
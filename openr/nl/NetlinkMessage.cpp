@@ -5,16 +5,73 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <mutex>
+#include <vector>
+
 #include <openr/nl/NetlinkMessage.h>
 
 namespace openr::fbnl {
 
+namespace {
+
+// max number of free buffers kept for reuse
+constexpr size_t kMaxPooledBuffers{1024};
+
+/**
+ * Buffers of kMaxNlPayloadSize to build messages in. Messages are built in the
+ * threads of the callers and released in the netlink event loop, hence the
+ * lock.
+ */
+class BufferPool {
+ public:
+  // zeroed buffer of kMaxNlPayloadSize
+  std::unique_ptr<char[]>
+  get() {
+    std::unique_ptr<char[]> buffer;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (not buffers_.empty()) {
+        buffer = std::move(buffers_.back());
+        buffers_.pop_back();
+      }
+    }
+    if (not buffer) {
+      return std::make_unique<char[]>(kMaxNlPayloadSize);
+    }
+    memset(buffer.get(), 0, kMaxNlPayloadSize);
+    return buffer;
+  }
+
+  void
+  put(std::unique_ptr<char[]> buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buffers_.size() < kMaxPooledBuffers) {
+      buffers_.emplace_back(std::move(buffer));
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<char[]>> buffers_;
+};
+
+BufferPool&
+getBufferPool() {
+  // never destroyed, messages may outlive static destruction
+  static auto* pool = new BufferPool();
+  return *pool;
+}
+
+} // namespace
+
 NetlinkMessage::NetlinkMessage()
-    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())),
+    : buffer_(getBufferPool().get()),
+      msghdr(reinterpret_cast<struct nlmsghdr*>(buffer_.get())),
       promise_(std::make_unique<folly::Promise<int>>()) {}
 
 NetlinkMessage::NetlinkMessage(int type)
-    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())),
+    : buffer_(getBufferPool().get()),
+      msghdr(reinterpret_cast<struct nlmsghdr*>(buffer_.get())),
       promise_(std::make_unique<folly::Promise<int>>()) {
   // initialize netlink header
   msghdr->nlmsg_len = NLMSG_LENGTH(0);
@@ -26,17 +83,44 @@ NetlinkMessage::getMessagePtr() {
   return msghdr;
 }
 
+const struct nlmsghdr*
+NetlinkMessage::getMessagePtr() const {
+  return msghdr;
+}
+
 uint32_t
 NetlinkMessage::getDataLength() const {
   return msghdr->nlmsg_len;
 }
 
+NetlinkMessage::~NetlinkMessage() {
+  if (bufferSize_ == kMaxNlPayloadSize) {
+    getBufferPool().put(std::move(buffer_));
+  }
+}
+
+void
+NetlinkMessage::shrinkToFit() {
+  const uint32_t size = NLMSG_ALIGN(msghdr->nlmsg_len);
+  if (size >= bufferSize_) {
+    return;
+  }
+  auto buffer = std::make_unique<char[]>(size);
+  memcpy(buffer.get(), buffer_.get(), size);
+  if (bufferSize_ == kMaxNlPayloadSize) {
+    getBufferPool().put(std::move(buffer_));
+  }
+  buffer_ = std::move(buffer);
+  bufferSize_ = size;
+  msghdr = reinterpret_cast<struct nlmsghdr*>(buffer_.get());
+}
+
 struct rtattr*
 NetlinkMessage::addSubAttributes(
     struct rtattr* rta, int type, const void* data, uint32_t len) const {
   uint32_t subRtaLen = RTA_LENGTH(len);
 
-  if (RTA_ALIGN(rta->rta_len) + RTA_ALIGN(subRtaLen) > kMaxNlPayloadSize) {
+  if (RTA_ALIGN(rta->rta_len) + RTA_ALIGN(subRtaLen) > bufferSize_) {
     LOG(ERROR) << "No buffer for adding attr: " << type << " length: " << len;
     return nullptr;
   }
@@ -66,7 +150,7 @@ NetlinkMessage::addAttributes(
   uint32_t rtaLen = (RTA_LENGTH(len));
   uint32_t nlmsgAlen = NLMSG_ALIGN((msghdr)->nlmsg_len);
 
-  if (nlmsgAlen + RTA_ALIGN(rtaLen) > kMaxNlPayloadSize) {
+  if (nlmsgAlen + RTA_ALIGN(rtaLen) > bufferSize_) {
     LOG(ERROR) << "Space not available to add attribute type " << type;
     return ENOBUFS;
   }
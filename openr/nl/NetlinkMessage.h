@@ -30,19 +30,26 @@ class NetlinkMessage {
  public:
   NetlinkMessage();
 
-  virtual ~NetlinkMessage() = default;
+  virtual ~NetlinkMessage();
 
   // construct message with type
   NetlinkMessage(int type);
 
   // get pointer to NLMSG Header
   struct nlmsghdr* getMessagePtr();
+  const struct nlmsghdr* getMessagePtr() const;
 
   // get current length
   uint32_t getDataLength() const;
 
-  // Buffer to create message
-  std::array<char, kMaxNlPayloadSize> msg = {};
+  /**
+   * Move the message into a buffer of its length and hand the buffer it got
+   * built in back to the pool, so that queued messages only take the memory
+   * they need. Attributes can't be added afterwards and pointers into the
+   * message held by derived classes are no longer valid, only the header and
+   * the status remain accessible.
+   */
+  void shrinkToFit();
 
   // set status value (in promise)
   void setReturnStatus(int status);
@@ -68,7 +75,9 @@ class NetlinkMessage {
     GET_ALL_ROUTES,
     GET_ROUTE,
     ADD_ROUTE,
-    DEL_ROUTE
+    DEL_ROUTE,
+    ADD_NEXTHOP,
+    DEL_NEXTHOP
   } messageType_;
 
   // get Message Type
@@ -98,8 +107,13 @@ class NetlinkMessage {
   NetlinkMessage(NetlinkMessage const&) = delete;
   NetlinkMessage& operator=(NetlinkMessage const&) = delete;
 
+  // Buffer to create message, of kMaxNlPayloadSize from a pool of recycled
+  // buffers until shrinkToFit()
+  std::unique_ptr<char[]> buffer_;
+  uint32_t bufferSize_{kMaxNlPayloadSize};
+
   // pointer to the netlink message header
-  struct nlmsghdr* const msghdr{nullptr};
+  struct nlmsghdr* msghdr{nullptr};
 
   // Promise to relay the status code received from kernel
   std::unique_ptr<folly::Promise<int>> promise_{nullptr};
@@ -5,9 +5,13 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <climits>
 #include <thread>
 
 #include <fb303/ServiceData.h>
+#include <folly/lang/Bits.h>
+#include <folly/synchronization/Baton.h>
 
 #include <openr/common/Util.h>
 #include <openr/nl/NetlinkProtocolSocket.h>
@@ -16,32 +20,85 @@ namespace fb303 = facebook::fb303;
 
 namespace openr::fbnl {
 
-NetlinkProtocolSocket::NetlinkProtocolSocket(fbzmq::ZmqEventLoop* evl)
-    : evl_(evl) {
-  nlMessageTimer_ = fbzmq::ZmqTimeout::make(evl_, [this]() noexcept {
-    DCHECK(false) << "This shouldn't occur usually. Adding DCHECK to get "
-                  << "attention in UTs";
-
-    fb303::fbData->addStatValue(
-        "netlink.message_timeouts", nlSeqNumMap_.size(), fb303::SUM);
-
-    LOG(ERROR) << "Timed-out receiving ack for " << nlSeqNumMap_.size()
-               << " message(s).";
-    for (auto const& kv : nlSeqNumMap_) {
-      LOG(ERROR) << "  Pending seq=" << kv.first << ", message-type="
-                 << static_cast<int>(kv.second->getMessageType())
-                 << ", bytes-sent=" << kv.second->getDataLength();
+NetlinkProtocolSocket::NetlinkProtocolSocket(
+    fbzmq::ZmqEventLoop* evl, size_t minIovMsg, size_t maxIovMsg)
+    : evl_(evl),
+      minIovMsg_(std::max<size_t>(1, minIovMsg)),
+      maxIovMsg_(std::max(minIovMsg_, maxIovMsg)),
+      iovWindow_(std::clamp(kInitialIovMsg, minIovMsg_, maxIovMsg_)) {
+  fb303::fbData->setCounter("netlink.iov_window", iovWindow_);
+  pendingRequests_.resize(
+      folly::nextPowTwo(kNlPendingSlotsPerIovMsg * maxIovMsg_));
+  pendingMask_ = pendingRequests_.size() - 1;
+  nlMessageTimer_ =
+      fbzmq::ZmqTimeout::make(evl_, [this]() noexcept { processAckTimeout(); });
+}
+
+void
+NetlinkProtocolSocket::processAckTimeout() {
+  // acks of a batch that failed processing, resume sending
+  if (numPendingRequests_ == 0) {
+    sendNetlinkMessage();
+    return;
+  }
+
+  // each request times out kNlRequestAckTimeout after its own last progress,
+  // other requests getting acked meanwhile don't keep it pending
+  const auto now = std::chrono::steady_clock::now();
+  auto nextDeadline = std::chrono::steady_clock::time_point::max();
+  size_t numTimedOut{0};
+  for (const auto& request : pendingRequests_) {
+    if (not request.msg) {
+      continue;
+    }
+    const auto deadline = request.lastProgress + kNlRequestAckTimeout;
+    if (deadline <= now) {
+      ++numTimedOut;
+    } else {
+      nextDeadline = std::min(nextDeadline, deadline);
     }
+  }
+  if (numTimedOut == 0) {
+    nlMessageTimer_->scheduleTimeout(std::max(
+        std::chrono::milliseconds(1),
+        std::chrono::ceil<std::chrono::milliseconds>(nextDeadline - now)));
+    return;
+  }
 
+  fb303::fbData->addStatValue(
+      "netlink.message_timeouts", numTimedOut, fb303::SUM);
+  LOG(ERROR) << "Timed-out receiving ack for " << numTimedOut
+             << " message(s).";
+
+  // acks of the others in flight are lost with a re-created socket, clear
+  // them too. A socket given to init(fd) is kept along with their requests
+  const bool clearAll = not externalSock_;
+  for (auto& request : pendingRequests_) {
+    if (not request.msg or
+        (not clearAll and request.lastProgress + kNlRequestAckTimeout > now)) {
+      continue;
+    }
+    LOG(ERROR) << "  Pending seq=" << request.seq << ", message-type="
+               << static_cast<int>(request.msg->getMessageType())
+               << ", bytes-sent=" << request.msg->getDataLength();
+    request.msg.reset(); // Clear timed out request
+    --numPendingRequests_;
+  }
+  shrinkWindow("ack timeout");
+  if (not externalSock_) {
     LOG(INFO) << "Closing netlink socket and recreate it";
-    nlSeqNumMap_.clear(); // Clear all timed out requests
     evl_->removeSocketFd(nlSock_);
     close(nlSock_);
     init();
+  }
 
-    LOG(INFO) << "Resume sending bufferred netlink messages";
-    sendNetlinkMessage();
-  });
+  LOG(INFO) << "Resume sending bufferred netlink messages";
+  if (numPendingRequests_) {
+    nlMessageTimer_->scheduleTimeout(std::max(
+        std::chrono::milliseconds(1),
+        std::chrono::ceil<std::chrono::milliseconds>(nextDeadline - now)));
+  }
+  sendNetlinkMessage();
 }
 
 void
@@ -59,6 +116,24 @@ NetlinkProtocolSocket::init() {
   if (setsockopt(nlSock_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
     LOG(FATAL) << "Netlink socket set recv buffer failed.";
   };
+  size = kNetlinkSockSendBuf;
+  // send buffer must take kMaxNlSendBytes at once
+  if (setsockopt(nlSock_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) < 0) {
+    LOG(FATAL) << "Netlink socket set send buffer failed.";
+  };
+  // have the kernel filter route dumps, since linux 4.20
+  int enable = 1;
+  if (setsockopt(
+          nlSock_,
+          SOL_NETLINK,
+          NETLINK_GET_STRICT_CHK,
+          &enable,
+          sizeof(enable)) < 0) {
+    LOG(WARNING) << "Netlink socket strict checking unavailable, route dumps "
+                 << "get filtered in user space: " << folly::errnoStr(errno);
+  } else {
+    strictCheck_ = true;
+  }
 
   // set the source address
   struct sockaddr_nl saddr;
@@ -76,6 +151,21 @@ NetlinkProtocolSocket::init() {
     LOG(FATAL) << "Failed to bind netlink socket: " << folly::errnoStr(errno);
   };
 
+  addSocketToEventLoop();
+}
+
+void
+NetlinkProtocolSocket::init(int fd) {
+  pid_ = static_cast<int>(
+      std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  nlSock_ = fd;
+  externalSock_ = true;
+  VLOG(1) << "Using netlink peer socket. fd=" << nlSock_;
+  addSocketToEventLoop();
+}
+
+void
+NetlinkProtocolSocket::addSocketToEventLoop() {
   evl_->addSocketFd(nlSock_, ZMQ_POLLIN, [this](int) noexcept {
     try {
       recvNetlinkMessage();
@@ -104,105 +194,214 @@ NetlinkProtocolSocket::setNeighborEventCB(
   neighborEventCB_ = neighborEventCB;
 }
 
+NetlinkProtocolSocket::PendingRequest*
+NetlinkProtocolSocket::findRequest(uint32_t seq) {
+  // notifications bear sequence number 0, no request does
+  if (seq == 0) {
+    return nullptr;
+  }
+  auto& request = pendingRequests_[seq & pendingMask_];
+  if (not request.msg or request.seq != seq) {
+    return nullptr;
+  }
+  return &request;
+}
+
+void
+NetlinkProtocolSocket::scheduleAckTimeout() {
+  if (not nlMessageTimer_->isScheduled()) {
+    nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
+  }
+}
+
 void
 NetlinkProtocolSocket::processAck(uint32_t ack, int status) {
-  auto it = nlSeqNumMap_.find(ack);
-  if (it != nlSeqNumMap_.end()) {
+  auto request = findRequest(ack);
+  if (request) {
     VLOG(2) << "Setting return value for seq=" << ack << " with ret=" << status;
     // Set return status on promise
-    it->second->setReturnStatus(status);
-    nlSeqNumMap_.erase(it);
+    request->msg->setReturnStatus(status);
+    request->msg.reset();
+    --numPendingRequests_;
+    acksReceived_ = true;
+    if (std::abs(status) == ENOBUFS) {
+      shrinkWindow("ENOBUFS ack");
+    } else {
+      onWindowAcked();
+    }
   } else {
     LOG(ERROR) << "No future associated with seq=" << ack;
   }
+}
 
+void
+NetlinkProtocolSocket::processAcks() {
   // Cancel timer if there are no more expected responses
-  if (nlSeqNumMap_.empty()) {
+  if (numPendingRequests_ == 0) {
     nlMessageTimer_->cancelTimeout();
-  } else {
-    // Extend timer and wait for next ack
-    nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
   }
 
   // We've successfully completed at-least one message. Send more messages
   // if any pending. Here we add optimization to wait for some more acks and
-  // send pending message in batch of atleast `kMinIovMsg`
-  if (nlSeqNumMap_.empty() or (kMaxIovMsg - nlSeqNumMap_.size() > kMinIovMsg)) {
+  // send pending messages in batches of at least half the window
+  if (numPendingRequests_ == 0 or
+      (numPendingRequests_ < iovWindow_ and
+       iovWindow_ - numPendingRequests_ >= iovWindow_ / 2)) {
     sendNetlinkMessage();
   }
 }
 
+void
+NetlinkProtocolSocket::onWindowAcked() {
+  if (not windowStart_) {
+    return;
+  }
+  if (++windowAcks_ < iovWindow_ and numPendingRequests_ > 0) {
+    return;
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - *windowStart_;
+  if (windowAcks_ >= iovWindow_ and windowLimited_ and
+      elapsed < kNlFastAckTime and iovWindow_ < maxIovMsg_) {
+    iovWindow_ = std::min(maxIovMsg_, iovWindow_ + kIovMsgStep);
+    VLOG(1) << "Growing netlink message window to " << iovWindow_;
+    fb303::fbData->setCounter("netlink.iov_window", iovWindow_);
+  }
+  // next round starts with the messages in flight, if any
+  windowAcks_ = 0;
+  windowLimited_ = false;
+  if (numPendingRequests_ == 0) {
+    windowStart_.reset();
+  } else {
+    windowStart_ = std::chrono::steady_clock::now();
+  }
+}
+
+void
+NetlinkProtocolSocket::shrinkWindow(const char* reason) {
+  fb303::fbData->addStatValue("netlink.iov_window_shrinks", 1, fb303::SUM);
+  iovWindow_ = std::max(minIovMsg_, iovWindow_ / 2);
+  LOG(WARNING) << "Shrinking netlink message window to " << iovWindow_
+               << " on " << reason;
+  fb303::fbData->setCounter("netlink.iov_window", iovWindow_);
+  // round restarts, the acks so far do not count for the smaller window
+  windowAcks_ = 0;
+  windowLimited_ = false;
+  if (numPendingRequests_ == 0) {
+    windowStart_.reset();
+  } else {
+    windowStart_ = std::chrono::steady_clock::now();
+  }
+}
+
 void
 NetlinkProtocolSocket::sendNetlinkMessage() {
   CHECK(evl_->isInEventLoop());
-  struct sockaddr_nl nladdr = {
-      .nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = 0};
-  CHECK_LE(nlSeqNumMap_.size(), kMaxIovMsg)
-      << "We must have capacity to send at-least one message!";
-  uint32_t count{0};
-  const uint32_t iovSize =
-      std::min(msgQueue_.size(), kMaxIovMsg - nlSeqNumMap_.size());
-
-  if (!iovSize) {
+  // the window may have shrunk below the messages in flight
+  if (numPendingRequests_ >= iovWindow_) {
+    windowLimited_ = windowLimited_ or not msgQueue_.empty();
     return;
   }
+  size_t numMsgs =
+      std::min(msgQueue_.size(), iovWindow_ - numPendingRequests_);
 
-  auto iov = std::make_unique<struct iovec[]>(iovSize);
+  if (!numMsgs) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (numPendingRequests_ == 0 and not windowStart_) {
+    windowStart_ = now;
+  }
 
-  while (count < iovSize && !msgQueue_.empty()) {
-    auto m = std::move(msgQueue_.front());
-    msgQueue_.pop();
+  size_t count{0};
+  while (count < numMsgs) {
+    // pack messages into the send buffer, each NLMSG_ALIGN'ed as the kernel
+    // expects them, up to kMaxNlSendBytes
+    sendBuffer_.clear();
+    uint32_t batchSize{0};
+    while (count < numMsgs) {
+      auto& m = msgQueue_.front();
+      const size_t offset = NLMSG_ALIGN(sendBuffer_.size());
+      if (batchSize and offset + m->getDataLength() > kMaxNlSendBytes) {
+        break;
+      }
+      // sequence numbers wrapped around the ring onto a request still in
+      // flight, e.g. a long dump, wait for its ack
+      auto& request = pendingRequests_[nextNlSeqNum_ & pendingMask_];
+      if (request.msg) {
+        VLOG(2) << "Waiting for ack of seq=" << request.seq;
+        numMsgs = count;
+        break;
+      }
+
+      // fill sequence number and PID
+      struct nlmsghdr* nlmsg_hdr = m->getMessagePtr();
+      nlmsg_hdr->nlmsg_pid = pid_;
+      nlmsg_hdr->nlmsg_seq = nextNlSeqNum_++;
+      if (nextNlSeqNum_ == 0) {
+        // wrap around - we start from 1
+        nextNlSeqNum_ = 1;
+      }
 
-    struct nlmsghdr* nlmsg_hdr = m->getMessagePtr();
-    iov[count].iov_base = reinterpret_cast<void*>(m->getMessagePtr());
-    iov[count].iov_len = m->getDataLength();
+      // check if one request per message
+      if ((nlmsg_hdr->nlmsg_flags & NLM_F_MULTI) != 0) {
+        LOG(ERROR) << "Error: multipart netlink message not supported";
+      }
 
-    // fill sequence number and PID
-    nlmsg_hdr->nlmsg_pid = pid_;
-    nlmsg_hdr->nlmsg_seq = nextNlSeqNum_++;
-    if (nextNlSeqNum_ == 0) {
-      // wrap around - we start from 1
-      nextNlSeqNum_ = 1;
+      // padding gets zeroed by resize
+      sendBuffer_.resize(offset + m->getDataLength());
+      memcpy(sendBuffer_.data() + offset, nlmsg_hdr, m->getDataLength());
+
+      // Add request to the slot of its seq number
+      request.seq = nlmsg_hdr->nlmsg_seq;
+      request.msg = std::move(m);
+      request.lastProgress = now;
+      ++numPendingRequests_;
+      msgQueue_.pop();
+      batchSize++;
+      count++;
     }
 
-    // check if one request per message
-    if ((nlmsg_hdr->nlmsg_flags & NLM_F_MULTI) != 0) {
-      LOG(ERROR) << "Error: multipart netlink message not supported";
+    if (batchSize == 0) {
+      break;
     }
 
-    // Add seq number -> netlink request mapping
-    auto res = nlSeqNumMap_.insert({nlmsg_hdr->nlmsg_seq, std::move(m)});
-    CHECK(res.second) << "Entry exists for " << nlmsg_hdr->nlmsg_seq;
-    count++;
+    struct iovec iov = {
+        .iov_base = sendBuffer_.data(), .iov_len = sendBuffer_.size()};
+    auto outMsg = std::make_unique<struct msghdr>();
+    // no address, an unconnected netlink socket sends to the kernel
+    outMsg->msg_iov = &iov;
+    outMsg->msg_iovlen = 1;
+
+    VLOG(2) << "Sending " << batchSize << " netlink messages, "
+            << sendBuffer_.size() << " bytes";
+    auto status = sendmsg(nlSock_, outMsg.get(), 0);
+    // TODO: If message send fails, then process ack for the failed
+    // messages
+
+    if (status < 0) {
+      const int error = errno;
+      LOG(ERROR) << "Error sending on NL socket " << folly::errnoStr(error)
+                 << " Number of messages:" << batchSize;
+      fb303::fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+      if (error == ENOBUFS) {
+        shrinkWindow("ENOBUFS on send");
+      }
+      break;
+    }
   }
-
-  auto outMsg = std::make_unique<struct msghdr>();
-  outMsg->msg_name = &nladdr;
-  outMsg->msg_namelen = sizeof(nladdr);
-  outMsg->msg_iov = &iov[0];
-  outMsg->msg_iovlen = count;
-
-  VLOG(2) << "Sending " << outMsg->msg_iovlen << " netlink messages";
-  auto status = sendmsg(nlSock_, outMsg.get(), 0);
-  // TODO: If message send fails, then process ack for the failed
-  // messages
-
-  if (status < 0) {
-    LOG(ERROR) << "Error sending on NL socket "
-               << folly::errnoStr(std::abs(status))
-               << " Number of messages:" << outMsg->msg_iovlen;
-    fb303::fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+  windowLimited_ = windowLimited_ or not msgQueue_.empty();
+  if (count == 0) {
+    return;
   }
 
   // Schedule timer to wait for acks and send next set of messages
-  nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
+  scheduleAckTimeout();
 }
 
 void
-NetlinkProtocolSocket::processMessage(
-    const std::array<char, kMaxNlPayloadSize>& rxMsg, uint32_t bytesRead) {
+NetlinkProtocolSocket::processMessage(const char* rxMsg, uint32_t bytesRead) {
   // first netlink message header
-  struct nlmsghdr* nlh = (struct nlmsghdr*)rxMsg.data();
+  const struct nlmsghdr* nlh = reinterpret_cast<const struct nlmsghdr*>(rxMsg);
   do {
     if (!NLMSG_OK(nlh, bytesRead)) {
       break;
@@ -213,26 +412,37 @@ NetlinkProtocolSocket::processMessage(
     switch (nlh->nlmsg_type) {
     case RTM_NEWROUTE:
     case RTM_DELROUTE: {
-      // next RTM message to be processed
-      auto rtmMessage = std::make_unique<NetlinkRouteMessage>();
-      auto route = rtmMessage->parseMessage(nlh);
-      if (nlSeqNumMap_.count(nlh->nlmsg_seq) > 0) {
-        // Extend message timer as we received a valid ack
-        nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
+      // route events are not handled, only parse routes of our dumps
+      auto request = findRequest(nlh->nlmsg_seq);
+      if (request) {
+        // Extend timeout of the request as we received a part of its reply
+        request->lastProgress = recvTime_;
         // Synchronous event - do not generate route events
-        routeCache_.emplace_back(route);
+        if (request->msg->getMessageType() ==
+            NetlinkMessage::MessageType::GET_ALL_ROUTES) {
+          static_cast<const NetlinkRouteMessage&>(*request->msg)
+              .processRoute(nlh);
+        }
+      }
+    } break;
+
+    case RTM_NEWNEXTHOP:
+    case RTM_DELNEXTHOP: {
+      // we don't subscribe to nexthop events nor keep a cache of them
+      if (auto request = findRequest(nlh->nlmsg_seq)) {
+        // Extend timeout of the request as we received a part of its reply
+        request->lastProgress = recvTime_;
       }
     } break;
 
     case RTM_DELLINK:
     case RTM_NEWLINK: {
       // process link information received from netlink
-      auto linkMessage = std::make_unique<NetlinkLinkMessage>();
-      fbnl::Link link = linkMessage->parseMessage(nlh);
+      fbnl::Link link = NetlinkLinkMessage::parseMessage(nlh);
 
-      if (nlSeqNumMap_.count(nlh->nlmsg_seq) > 0) {
-        // Extend message timer as we received a valid ack
-        nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
+      if (auto request = findRequest(nlh->nlmsg_seq)) {
+        // Extend timeout of the request as we received a part of its reply
+        request->lastProgress = recvTime_;
         // Synchronous event - do not generate link events
         linkCache_.emplace_back(link);
       } else {
@@ -247,26 +457,23 @@ NetlinkProtocolSocket::processMessage(
     case RTM_DELADDR:
     case RTM_NEWADDR: {
       // process interface address information received from netlink
-      auto addrMessage = std::make_unique<NetlinkAddrMessage>();
-      fbnl::IfAddress addr = addrMessage->parseMessage(nlh);
+      fbnl::IfAddress addr = NetlinkAddrMessage::parseMessage(nlh);
 
       if (!addr.getPrefix().has_value()) {
         break;
       }
-      if (nlSeqNumMap_.count(nlh->nlmsg_seq) > 0) {
-        // Extend message timer as we received a valid ack
-        nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
+      if (auto const request = findRequest(nlh->nlmsg_seq)) {
+        // Extend timeout of the request as we received a part of its reply
+        request->lastProgress = recvTime_;
         // Response to a corresponding request
-        auto& request = nlSeqNumMap_.at(nlh->nlmsg_seq);
-        if (request->getMessageType() ==
+        auto const& msg = request->msg;
+        if (msg->getMessageType() ==
             NetlinkMessage::MessageType::GET_ALL_ADDRS) {
           // Message in response to get addresses, store in address cache
           addressCache_.emplace_back(addr);
         } else if (
-            request->getMessageType() ==
-                NetlinkMessage::MessageType::ADD_ADDR ||
-            request->getMessageType() ==
-                NetlinkMessage::MessageType::DEL_ADDR) {
+            msg->getMessageType() == NetlinkMessage::MessageType::ADD_ADDR ||
+            msg->getMessageType() == NetlinkMessage::MessageType::DEL_ADDR) {
           // Response to a add/del request - generate addr event for handler.
           // This occurs when we add/del IPv4 addresses generates address event
           // with the same sequence as the original request.
@@ -288,12 +495,11 @@ NetlinkProtocolSocket::processMessage(
     case RTM_DELNEIGH:
     case RTM_NEWNEIGH: {
       // process neighbor information received from netlink
-      auto neighMessage = std::make_unique<NetlinkNeighborMessage>();
-      fbnl::Neighbor neighbor = neighMessage->parseMessage(nlh);
+      fbnl::Neighbor neighbor = NetlinkNeighborMessage::parseMessage(nlh);
 
-      if (nlSeqNumMap_.count(nlh->nlmsg_seq) > 0) {
-        // Extend message timer as we received a valid ack
-        nlMessageTimer_->scheduleTimeout(kNlRequestAckTimeout);
+      if (auto request = findRequest(nlh->nlmsg_seq)) {
+        // Extend timeout of the request as we received a part of its reply
+        request->lastProgress = recvTime_;
         // Synchronous event - do not generate neighbor events
         neighborCache_.emplace_back(neighbor);
       } else {
@@ -307,7 +513,7 @@ NetlinkProtocolSocket::processMessage(
 
     case NLMSG_ERROR: {
       const struct nlmsgerr* const ack =
-          reinterpret_cast<struct nlmsgerr*>(NLMSG_DATA(nlh));
+          reinterpret_cast<const struct nlmsgerr*>(NLMSG_DATA(nlh));
       if (ack->msg.nlmsg_pid != pid_) {
         LOG(ERROR) << "received netlink message with wrong PID, received: "
                    << ack->msg.nlmsg_pid << " expected: " << pid_;
@@ -339,21 +545,55 @@ NetlinkProtocolSocket::processMessage(
 
 void
 NetlinkProtocolSocket::recvNetlinkMessage() {
-  // messages buffer
-  std::array<char, kMaxNlPayloadSize> recvMsg = {};
+  if (not recvBuffer_) {
+    recvBuffer_ =
+        std::make_unique<char[]>(kNlRecvBatchSize * kNlRecvBufferSize);
+  }
+  std::array<struct iovec, kNlRecvBatchSize> iovs;
+  std::array<struct mmsghdr, kNlRecvBatchSize> msgs = {};
+  for (uint32_t i = 0; i < kNlRecvBatchSize; ++i) {
+    iovs[i].iov_base = recvBuffer_.get() + i * kNlRecvBufferSize;
+    iovs[i].iov_len = kNlRecvBufferSize;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
 
-  int32_t bytesRead = ::recv(nlSock_, recvMsg.data(), kMaxNlPayloadSize, 0);
-  VLOG(4) << "Message received with size: " << bytesRead;
+  // at least one datagram is there, take what else is without blocking
+  int numMsgs =
+      ::recvmmsg(nlSock_, msgs.data(), kNlRecvBatchSize, MSG_DONTWAIT, nullptr);
+  VLOG(4) << "Datagrams received: " << numMsgs;
 
-  if (bytesRead < 0) {
-    if (errno == EINTR || errno == EAGAIN) {
+  if (numMsgs < 0) {
+    const int error = errno;
+    if (error == EINTR || error == EAGAIN) {
       return;
     }
-    LOG(INFO) << "Error in netlink socket receive: " << bytesRead
-              << " err: " << folly::errnoStr(std::abs(errno));
+    LOG(INFO) << "Error in netlink socket receive: " << numMsgs
+              << " err: " << folly::errnoStr(error);
+    if (error == ENOBUFS) {
+      // receive buffer overflowed, acks of in-flight messages may be lost
+      shrinkWindow("ENOBUFS on receive");
+    }
     return;
   }
-  processMessage(recvMsg, static_cast<uint32_t>(bytesRead));
+  // requests get their progress stamped once per batch
+  recvTime_ = std::chrono::steady_clock::now();
+  for (int i = 0; i < numMsgs; ++i) {
+    if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+      LOG(ERROR) << "Truncated netlink datagram of " << msgs[i].msg_len
+                 << " bytes";
+      fb303::fbData->addStatValue("netlink.errors", 1, fb303::SUM);
+    }
+    processMessage(
+        static_cast<const char*>(iovs[i].iov_base),
+        std::min(msgs[i].msg_len, kNlRecvBufferSize));
+  }
+
+  // resolve acks of the batch at once
+  if (acksReceived_) {
+    acksReceived_ = false;
+    processAcks();
+  }
 }
 
 NetlinkProtocolSocket::~NetlinkProtocolSocket() {
@@ -364,6 +604,10 @@ NetlinkProtocolSocket::~NetlinkProtocolSocket() {
 void
 NetlinkProtocolSocket::addNetlinkMessage(
     std::vector<std::unique_ptr<NetlinkMessage>> nlmsgs) {
+  // messages are complete, queue them in buffers of their size
+  for (auto& nlmsg : nlmsgs) {
+    nlmsg->shrinkToFit();
+  }
   evl_->runImmediatelyOrInEventLoop(
       [this, nlmsgs = std::move(nlmsgs)]() mutable {
         for (auto& nlmsg : nlmsgs) {
@@ -508,6 +752,69 @@ NetlinkProtocolSocket::deleteLabelRoute(const openr::fbnl::Route& route) {
       futures, std::unordered_set<int>{EEXIST, ESRCH, EINVAL});
 }
 
+folly::SemiFuture<std::vector<int>>
+NetlinkProtocolSocket::addLabelRoutes(
+    const std::vector<openr::fbnl::Route>& routes) {
+  return programLabelRoutes(routes, true);
+}
+
+folly::SemiFuture<std::vector<int>>
+NetlinkProtocolSocket::deleteLabelRoutes(
+    const std::vector<openr::fbnl::Route>& routes) {
+  return programLabelRoutes(routes, false);
+}
+
+folly::SemiFuture<std::vector<int>>
+NetlinkProtocolSocket::programLabelRoutes(
+    const std::vector<openr::fbnl::Route>& routes, bool isAdd) {
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  std::vector<folly::Future<int>> futures;
+  msg.reserve(routes.size());
+  futures.reserve(routes.size());
+
+  for (const auto& route : routes) {
+    auto rtmMsg = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
+    const int status = isAdd ? rtmMsg->addLabelRoute(route)
+                             : rtmMsg->deleteLabelRoute(route);
+    if (status != 0) {
+      // fails this label only, the rest of the batch still goes out
+      LOG(ERROR) << "Error encoding label route " << route.str();
+      futures.emplace_back(folly::makeFuture(status));
+      continue;
+    }
+    futures.emplace_back(rtmMsg->getFuture());
+    msg.emplace_back(std::move(rtmMsg));
+  }
+  if (msg.size()) {
+    addNetlinkMessage(std::move(msg));
+  }
+
+  // Ignore EEXIST, ESRCH, EINVAL errors in delete operation, as
+  // deleteLabelRoute does
+  return collectStatuses(
+      std::move(futures),
+      isAdd ? std::unordered_set<int>{EEXIST}
+            : std::unordered_set<int>{EEXIST, ESRCH, EINVAL});
+}
+
+folly::SemiFuture<std::vector<int>>
+NetlinkProtocolSocket::collectStatuses(
+    std::vector<folly::Future<int>> futures,
+    std::unordered_set<int> ignoredErrors) {
+  return folly::collectAll(std::move(futures))
+      .deferValue([ignoredErrors = std::move(ignoredErrors)](
+                      std::vector<folly::Try<int>> results) {
+        std::vector<int> statuses;
+        statuses.reserve(results.size());
+        for (const auto& result : results) {
+          // requests dropped on ack timeout are left without a value
+          const int status = result.hasValue() ? std::abs(*result) : ETIME;
+          statuses.emplace_back(ignoredErrors.count(status) ? 0 : status);
+        }
+        return statuses;
+      });
+}
+
 int
 NetlinkProtocolSocket::deleteRoutes(
     const std::vector<openr::fbnl::Route>& routes) {
@@ -541,6 +848,66 @@ NetlinkProtocolSocket::deleteRoutes(
       kNlRequestTimeout);
 }
 
+int
+NetlinkProtocolSocket::addNextHop(
+    uint32_t id, const openr::fbnl::NextHop& nextHop, uint8_t protocolId) {
+  auto nhMsg = std::make_unique<openr::fbnl::NetlinkNextHopMessage>();
+  std::vector<folly::Future<int>> futures;
+  futures.emplace_back(nhMsg->getFuture());
+  nhMsg->setMessageType(NetlinkMessage::MessageType::ADD_NEXTHOP);
+  int status{0};
+  if ((status = nhMsg->addNextHop(id, nextHop, protocolId)) != 0) {
+    LOG(ERROR) << "Error adding nexthop " << id << ": " << nextHop.str();
+    return status;
+  }
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  msg.emplace_back(std::move(nhMsg));
+  addNetlinkMessage(std::move(msg));
+  return getReturnStatus(futures, std::unordered_set<int>{});
+}
+
+int
+NetlinkProtocolSocket::addNextHopGroup(
+    uint32_t id, const std::vector<uint32_t>& nextHopIds, uint8_t protocolId) {
+  auto nhMsg = std::make_unique<openr::fbnl::NetlinkNextHopMessage>();
+  std::vector<folly::Future<int>> futures;
+  futures.emplace_back(nhMsg->getFuture());
+  nhMsg->setMessageType(NetlinkMessage::MessageType::ADD_NEXTHOP);
+  int status{0};
+  if ((status = nhMsg->addNextHopGroup(id, nextHopIds, protocolId)) != 0) {
+    LOG(ERROR) << "Error adding nexthop group " << id;
+    return status;
+  }
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  msg.emplace_back(std::move(nhMsg));
+  addNetlinkMessage(std::move(msg));
+  return getReturnStatus(futures, std::unordered_set<int>{});
+}
+
+int
+NetlinkProtocolSocket::deleteNextHops(const std::vector<uint32_t>& ids) {
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  std::vector<folly::Future<int>> futures;
+
+  for (auto const id : ids) {
+    auto nhMsg = std::make_unique<openr::fbnl::NetlinkNextHopMessage>();
+    nhMsg->setMessageType(NetlinkMessage::MessageType::DEL_NEXTHOP);
+    int status{0};
+    if ((status = nhMsg->deleteNextHop(id)) != 0) {
+      LOG(ERROR) << "Error deleting nexthop " << id;
+      return status;
+    }
+    futures.emplace_back(nhMsg->getFuture());
+    msg.emplace_back(std::move(nhMsg));
+  }
+  if (msg.size()) {
+    addNetlinkMessage(std::move(msg));
+  }
+  // Ignore ENOENT, nexthop is already gone
+  return getReturnStatus(
+      futures, std::unordered_set<int>{ENOENT}, kNlRequestTimeout);
+}
+
 int
 NetlinkProtocolSocket::addIfAddress(const openr::fbnl::IfAddress& ifAddr) {
   auto addrMsg = std::make_unique<openr::fbnl::NetlinkAddrMessage>();
@@ -582,6 +949,53 @@ NetlinkProtocolSocket::deleteIfAddress(const openr::fbnl::IfAddress& ifAddr) {
   return getReturnStatus(futures, std::unordered_set<int>{EADDRNOTAVAIL});
 }
 
+folly::SemiFuture<std::vector<int>>
+NetlinkProtocolSocket::addIfAddresses(
+    const std::vector<openr::fbnl::IfAddress>& ifAddrs) {
+  return programIfAddresses(ifAddrs, true);
+}
+
+folly::SemiFuture<std::vector<int>>
+NetlinkProtocolSocket::deleteIfAddresses(
+    const std::vector<openr::fbnl::IfAddress>& ifAddrs) {
+  return programIfAddresses(ifAddrs, false);
+}
+
+folly::SemiFuture<std::vector<int>>
+NetlinkProtocolSocket::programIfAddresses(
+    const std::vector<openr::fbnl::IfAddress>& ifAddrs, bool isAdd) {
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  std::vector<folly::Future<int>> futures;
+  msg.reserve(ifAddrs.size());
+  futures.reserve(ifAddrs.size());
+
+  for (const auto& ifAddr : ifAddrs) {
+    auto addrMsg = std::make_unique<openr::fbnl::NetlinkAddrMessage>();
+    addrMsg->setMessageType(
+        isAdd ? NetlinkMessage::MessageType::ADD_ADDR
+              : NetlinkMessage::MessageType::DEL_ADDR);
+    const int status = addrMsg->addOrDeleteIfAddress(
+        ifAddr, isAdd ? RTM_NEWADDR : RTM_DELADDR);
+    if (status != 0) {
+      // fails this address only, the rest of the batch still goes out
+      LOG(ERROR) << "Error encoding interface address " << ifAddr.str();
+      futures.emplace_back(folly::makeFuture(status));
+      continue;
+    }
+    futures.emplace_back(addrMsg->getFuture());
+    msg.emplace_back(std::move(addrMsg));
+  }
+  if (msg.size()) {
+    addNetlinkMessage(std::move(msg));
+  }
+
+  // Ignore EEXIST on add and EADDRNOTAVAIL on delete, as addIfAddress and
+  // deleteIfAddress do
+  return collectStatuses(
+      std::move(futures),
+      std::unordered_set<int>{isAdd ? EEXIST : EADDRNOTAVAIL});
+}
+
 std::vector<fbnl::Link>
 NetlinkProtocolSocket::getAllLinks() {
   LOG_FN_EXECUTION_TIME;
@@ -638,18 +1052,64 @@ NetlinkProtocolSocket::getAllNeighbors() {
 
 std::vector<fbnl::Route>
 NetlinkProtocolSocket::getAllRoutes() {
+  std::vector<fbnl::Route> routes;
+  getRoutes(RouteFilter{}, [&routes](fbnl::Route&& route) {
+    routes.emplace_back(std::move(route));
+  });
+  return routes;
+}
+
+int
+NetlinkProtocolSocket::getRoutes(
+    const RouteFilter& filter, std::function<void(fbnl::Route&&)> routeCb) {
   LOG_FN_EXECUTION_TIME;
-  routeCache_.clear();
-  auto routeMsg = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
+  auto cb = std::make_shared<NetlinkRouteMessage::RouteCallback>(
+      std::move(routeCb));
+
+  // MPLS has no tables and rejects dumps of a table. Without a family a dump
+  // of a table is one per family then, MPLS routes are of the main table
+  std::vector<RouteFilter> filters{filter};
+  if (strictCheck_ and filter.routeTable and not filter.family) {
+    filters.clear();
+    for (const uint8_t family : {AF_INET, AF_INET6, AF_MPLS}) {
+      auto familyFilter = filter;
+      familyFilter.family = family;
+      filters.emplace_back(std::move(familyFilter));
+    }
+  }
+
   std::vector<folly::Future<int>> futures;
-  futures.emplace_back(routeMsg->getFuture());
-  fbnl::RouteBuilder builder; // to create empty route
-  routeMsg->init(RTM_GETROUTE, 0, builder.build());
   std::vector<std::unique_ptr<NetlinkMessage>> msg;
-  msg.emplace_back(std::move(routeMsg));
+  for (const auto& dumpFilter : filters) {
+    auto routeMsg = std::make_unique<openr::fbnl::NetlinkRouteMessage>();
+    futures.emplace_back(routeMsg->getFuture());
+    fbnl::RouteBuilder builder; // to create empty route
+    routeMsg->init(RTM_GETROUTE, 0, builder.build());
+    routeMsg->setMessageType(NetlinkMessage::MessageType::GET_ALL_ROUTES);
+    if (strictCheck_) {
+      auto kernelFilter = dumpFilter;
+      if (dumpFilter.family == AF_MPLS) {
+        kernelFilter.routeTable = std::nullopt;
+      }
+      routeMsg->setDumpFilter(kernelFilter);
+    }
+    // filtered in user space as well, for kernels dumping more than asked
+    routeMsg->setRouteCallback(dumpFilter, cb);
+    msg.emplace_back(std::move(routeMsg));
+  }
   addNetlinkMessage(std::move(msg));
-  getReturnStatus(futures, std::unordered_set<int>{}, kNlRequestTimeout);
-  return std::move(routeCache_);
+  const int status =
+      getReturnStatus(futures, std::unordered_set<int>{}, kNlRequestTimeout);
+  if (status == ETIME) {
+    // rest of the dump may still come, it must not reach routeCb any more
+    folly::Baton<> baton;
+    evl_->runImmediatelyOrInEventLoop([&cb, &baton]() {
+      *cb = nullptr;
+      baton.post();
+    });
+    baton.wait();
+  }
+  return status;
 }
 
 } // namespace openr::fbnl
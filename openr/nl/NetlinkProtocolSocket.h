@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <chrono>
+#include <optional>
 #include <vector>
 
 #include <fbzmq/async/ZmqEventLoop.h>
@@ -23,10 +25,27 @@ namespace openr::fbnl {
 // Receive socket buffer for netlink socket
 constexpr uint32_t kNetlinkSockRecvBuf{1 * 1024 * 1024};
 
-// Maximum number of in-flight messages. `kMinIovMsg` indicates the soft
-// requirement for sending bufferred messages.
-constexpr size_t kMaxIovMsg{500};
-constexpr size_t kMinIovMsg{200};
+// Send socket buffer for netlink socket. Queued messages are packed into one
+// buffer of at most `kMaxNlSendBytes` per sendmsg, the kernel rejects sends
+// beyond the send buffer with EMSGSIZE.
+constexpr uint32_t kNetlinkSockSendBuf{256 * 1024};
+constexpr uint32_t kMaxNlSendBytes{64 * 1024};
+
+// Received datagrams per recvmmsg and the buffer for each. Kernel dumps fill
+// datagrams up to the largest receive buffer seen, capped at 32KB.
+constexpr uint32_t kNlRecvBatchSize{16};
+constexpr uint32_t kNlRecvBufferSize{32 * 1024};
+
+// Bounds of the window of in-flight messages, by default. The window starts
+// at `kInitialIovMsg` and grows by `kIovMsgStep` each time a full window got
+// acked within `kNlFastAckTime`, while messages were waiting for it. It is
+// halved on ENOBUFS, e.g. acks dropped as the receive buffer overflowed, and
+// on ack timeouts.
+constexpr size_t kMinIovMsg{50};
+constexpr size_t kMaxIovMsg{2000};
+constexpr size_t kInitialIovMsg{500};
+constexpr size_t kIovMsgStep{100};
+constexpr std::chrono::milliseconds kNlFastAckTime{20};
 
 // Timeout for an ack from kernel for netlink messages we sent. The response for
 // big request (e.g. adding 5k routes or getting 10k routes) is sent back in
@@ -34,6 +53,11 @@ constexpr size_t kMinIovMsg{200};
 // assume kernel is not responsive.
 constexpr std::chrono::milliseconds kNlRequestAckTimeout{1000};
 
+// Slots of the ring of in-flight requests per message of the largest window.
+// A request stays in its slot until acked, messages wait while the slot of
+// the next sequence number is taken.
+constexpr size_t kNlPendingSlotsPerIovMsg{4};
+
 // Timeout for an overall netlink request e.g. addRoute, delRoute
 constexpr std::chrono::milliseconds kNlRequestTimeout{30000};
 
@@ -47,12 +71,20 @@ constexpr std::chrono::milliseconds kNlRequestTimeout{30000};
  */
 class NetlinkProtocolSocket {
  public:
-  explicit NetlinkProtocolSocket(fbzmq::ZmqEventLoop* evl);
+  explicit NetlinkProtocolSocket(
+      fbzmq::ZmqEventLoop* evl,
+      size_t minIovMsg = kMinIovMsg,
+      size_t maxIovMsg = kMaxIovMsg);
 
   // TODO: This should be private and auto initialized (either lazy or static)
   // create socket and add to eventloop
   void init();
 
+  // use fd instead of a netlink socket, e.g. one end of a socketpair with a
+  // fake kernel at the other in benchmarks. Takes ownership of fd, which is
+  // not recreated on ack timeouts.
+  void init(int fd);
+
   ~NetlinkProtocolSocket();
 
   // Set netlinkSocket Link event callback
@@ -77,18 +109,60 @@ class NetlinkProtocolSocket {
   // synchronous delete label route
   int deleteLabelRoute(const openr::fbnl::Route& route);
 
+  /**
+   * Asynchronous add or replace of label routes, sent as one batch along with
+   * whatever else is queued. The future holds one status per route, in order,
+   * once all are acked: 0 on success else the error of that label. Needs the
+   * event loop running on another thread to complete.
+   */
+  folly::SemiFuture<std::vector<int>> addLabelRoutes(
+      const std::vector<openr::fbnl::Route>& routes);
+
+  // asynchronous delete of label routes, statuses as with addLabelRoutes
+  folly::SemiFuture<std::vector<int>> deleteLabelRoutes(
+      const std::vector<openr::fbnl::Route>& routes);
+
   // synchronous add given list of IP or label routes and their nexthop paths
   int addRoutes(const std::vector<openr::fbnl::Route>& routes);
 
   // synchronous delete a list of given IP or label routes
   int deleteRoutes(const std::vector<openr::fbnl::Route>& routes);
 
+  // synchronous add or replace kernel nexthop object id
+  int addNextHop(
+      uint32_t id, const openr::fbnl::NextHop& nextHop, uint8_t protocolId);
+
+  // synchronous add or replace kernel nexthop group id of nexthop objects.
+  // Routes using the group move to its new nexthops.
+  int addNextHopGroup(
+      uint32_t id,
+      const std::vector<uint32_t>& nextHopIds,
+      uint8_t protocolId);
+
+  // synchronous delete kernel nexthop objects or groups, routes still using
+  // them get deleted by the kernel
+  int deleteNextHops(const std::vector<uint32_t>& ids);
+
   // synchronous add interface address
   int addIfAddress(const openr::fbnl::IfAddress& ifAddr);
 
   // synchronous delete interface address
   int deleteIfAddress(const openr::fbnl::IfAddress& ifAddr);
 
+  /**
+   * Asynchronous add of interface addresses, sent as one batch. The future
+   * holds one status per address, in order, once all are acked: 0 on success
+   * or if the address is present already, else the error of that address.
+   * Needs the event loop running on another thread to complete.
+   */
+  folly::SemiFuture<std::vector<int>> addIfAddresses(
+      const std::vector<openr::fbnl::IfAddress>& ifAddrs);
+
+  // asynchronous delete of interface addresses, statuses as with
+  // addIfAddresses. Addresses not assigned count as deleted
+  folly::SemiFuture<std::vector<int>> deleteIfAddresses(
+      const std::vector<openr::fbnl::IfAddress>& ifAddrs);
+
   // get netlink request statuses
   int getReturnStatus(
       std::vector<folly::Future<int>>& futures,
@@ -107,30 +181,84 @@ class NetlinkProtocolSocket {
   // get all routes from kernel using Netlink
   std::vector<fbnl::Route> getAllRoutes();
 
+  /**
+   * Dump routes from kernel and hand the ones matching filter to routeCb as
+   * the dump is received, without holding the whole table. routeCb is invoked
+   * in the netlink event loop while the call blocks, never after it returned.
+   * Kernels with strict checking of netlink requests only dump the matching
+   * routes, with others routes get filtered as they are received.
+   * @returns 0 once the dump is complete else relevant system error code
+   */
+  int getRoutes(
+      const RouteFilter& filter,
+      std::function<void(fbnl::Route&&)> routeCb);
+
  private:
   NetlinkProtocolSocket(NetlinkProtocolSocket const&) = delete;
   NetlinkProtocolSocket& operator=(NetlinkProtocolSocket const&) = delete;
 
+  // queue label route add or delete messages, see addLabelRoutes
+  folly::SemiFuture<std::vector<int>> programLabelRoutes(
+      const std::vector<openr::fbnl::Route>& routes, bool isAdd);
+
+  // queue interface address add or delete messages, see addIfAddresses
+  folly::SemiFuture<std::vector<int>> programIfAddresses(
+      const std::vector<openr::fbnl::IfAddress>& ifAddrs, bool isAdd);
+
+  // statuses of batched requests, dropping the ignored errors
+  static folly::SemiFuture<std::vector<int>> collectStatuses(
+      std::vector<folly::Future<int>> futures,
+      std::unordered_set<int> ignoredErrors);
+
   // Buffer netlink message to the queue_. Invoke sendNetlinkMessage if there
   // are no messages in flight
   void addNetlinkMessage(std::vector<std::unique_ptr<NetlinkMessage>> nlmsg);
 
+  // receive and process messages of nlSock_ in the event loop
+  void addSocketToEventLoop();
+
   // Send a message batch to netlink socket from queue_
   void sendNetlinkMessage();
 
-  // Receive messages from netlink socket. Invoke `processMessage` for every
-  // message received.
+  // Receive up to kNlRecvBatchSize datagrams from netlink socket with one
+  // recvmmsg. Invoke `processMessage` for every datagram received.
   void recvNetlinkMessage();
 
-  // Process received netlink message. Set return values for pending requests
-  // or send notifications.
-  void processMessage(
-      const std::array<char, kMaxNlPayloadSize>& rxMsg, uint32_t bytesRead);
+  // Process received netlink messages in place. Set return values for pending
+  // requests or send notifications. Messages nobody waits for are not parsed.
+  void processMessage(const char* rxMsg, uint32_t bytesRead);
 
-  // Process ack message. Set return status on pending requests in nlSeqNumMap_
-  // Resume sending messages from queue_ if any pending
+  // Process ack message. Set return status on the pending request of the ack
   void processAck(uint32_t ack, int status);
 
+  // Once per received batch with acks. Cancel the timer if no request is in
+  // flight anymore, and resume sending messages from queue_ if any pending
+  void processAcks();
+
+  // Request in flight with its sequence number and the last time it was sent
+  // or a part of its reply was received
+  struct PendingRequest {
+    uint32_t seq{0};
+    std::shared_ptr<NetlinkMessage> msg;
+    std::chrono::steady_clock::time_point lastProgress;
+  };
+
+  // In-flight request of a sequence number, nullptr if there is none
+  PendingRequest* findRequest(uint32_t seq);
+
+  // Time out requests without progress for kNlRequestAckTimeout, else move
+  // the timer out to the earliest deadline of the requests in flight
+  void processAckTimeout();
+
+  // Schedule the ack timer unless it is already
+  void scheduleAckTimeout();
+
+  // Grow the window once a full one got acked fast while messages waited
+  void onWindowAcked();
+
+  // Halve the window on overflow of kernel or socket buffers, or timeouts
+  void shrinkWindow(const char* reason);
+
   // Event base for serializing read/write requests to netlink socket. Also
   // ensure thread safety of private member variables.
   fbzmq::ZmqEventLoop* evl_{nullptr};
@@ -170,21 +298,53 @@ class NetlinkProtocolSocket {
   // for in-flight messages is received, subsequent messages are sent.
   std::queue<std::unique_ptr<NetlinkMessage>> msgQueue_;
 
-  // Sequence number to NetlinkMesage request mapping. Each in-flight message
-  // sent to kernel, is assigned a unique sequence-number and stored in this
-  // map. On receipt of ack from kernel (either success or error) we clear the
-  // corresponding entry from this map.
-  std::unordered_map<uint32_t, std::shared_ptr<NetlinkMessage>> nlSeqNumMap_;
+  // Ring of in-flight requests, indexed by sequence number modulo its size.
+  // Each message sent to kernel is assigned a unique sequence-number and
+  // stored in its slot. On receipt of ack from kernel (either success or
+  // error) we clear the slot. Sized to a power of two, kNlPendingSlotsPerIovMsg
+  // times the largest window, in the constructor.
+  std::vector<PendingRequest> pendingRequests_;
+  size_t pendingMask_{0};
+  size_t numPendingRequests_{0};
+
+  // Receive time of the batch being processed, and whether it acked requests
+  std::chrono::steady_clock::time_point recvTime_;
+  bool acksReceived_{false};
+
+  // Messages sent with one sendmsg, packed back to back. Reused across sends.
+  std::vector<char> sendBuffer_;
+
+  // nlSock_ was given to init(fd)
+  bool externalSock_{false};
+
+  // kernel checks requests strictly, and filters route dumps as requested
+  bool strictCheck_{false};
+
+  // kNlRecvBatchSize buffers of kNlRecvBufferSize, reused across receives
+  std::unique_ptr<char[]> recvBuffer_;
+
+  // Window of in-flight messages, adapts within [minIovMsg_, maxIovMsg_]
+  const size_t minIovMsg_{kMinIovMsg};
+  const size_t maxIovMsg_{kMaxIovMsg};
+  size_t iovWindow_{kInitialIovMsg};
+
+  // Round of acks for the current window, started with the first message
+  // sent while none was in flight
+  std::optional<std::chrono::steady_clock::time_point> windowStart_;
+  size_t windowAcks_{0};
+  // messages waited for the window during the round
+  bool windowLimited_{false};
 
   // Timer to help keep track of timeout of messages sent to kernel. It also
   // ensures the aliveness of the netlink socket-fd. Timer is
-  // - Started when a new message is sent
-  // - Reset whenever we receive update about one of the pending ack
-  // - Cleared when there is no pending ack in nlSeqNumMap_
-  // When timer fires, it is an indication that we didn't receive the ack for
-  // one of the entry in nlSeqNoMap, for at-least past kNlRequestAckTimeout
-  // time. Netlink socket is re-initiaited on timeout for any of our pending
-  // message, and `nlSeqNumMap_` is cleared.
+  // - Started when a new message is sent while it is not scheduled
+  // - Cleared when there is no pending request in pendingRequests_
+  // Progress does not reschedule the timer, it is recorded per request and
+  // the timer is moved out to the earliest deadline when it fires. A request
+  // without progress for kNlRequestAckTimeout times out, even while others
+  // are acked. Netlink socket is re-initiaited on timeout for any of our
+  // pending message, and `pendingRequests_` is cleared. With a socket given
+  // to init(fd) only the timed out requests are cleared.
   std::unique_ptr<fbzmq::ZmqTimeout> nlMessageTimer_{nullptr};
 
   /**
@@ -200,14 +360,14 @@ class NetlinkProtocolSocket {
    *  Kernel sends L4, L5 in message R1-part-2. Add L4, L5 to cache.
    *  Return [L4, L5, L1, L2, L3, L4, L5] to R2 (NOTE: duplicated entries)
    *
-   * We maintain a temporary cache of Link, Address, Neighbor and Routes from
-   * the kernel, which are solely used for the getAll... methods. These caches
-   * are cleared when we invoke a new getAllLinks/Addresses/Neighbors/Routes
+   * We maintain a temporary cache of Link, Address and Neighbor from the
+   * kernel, which are solely used for the getAll... methods. These caches
+   * are cleared when we invoke a new getAllLinks/Addresses/Neighbors. Routes
+   * go to the callback of their dump request instead, see getRoutes.
    */
   std::vector<fbnl::Link> linkCache_{};
   std::vector<fbnl::IfAddress> addressCache_{};
   std::vector<fbnl::Neighbor> neighborCache_{};
-  std::vector<fbnl::Route> routeCache_{};
 };
 
 } // namespace openr::fbnl
@@ -224,7 +224,7 @@ NetlinkRouteMessage::addLabelNexthop(
   // MPLS_IP_TUNNEL_DST sub attribute
   std::array<struct mpls_label, kMaxLabels> mplsLabel;
   size_t i = 0;
-  auto labels = path.getPushLabels();
+  const auto& labels = path.getPushLabels();
   if (!labels.has_value()) {
     LOG(ERROR) << "Labels not provided for PUSH action";
     return EINVAL;
@@ -364,7 +364,7 @@ NetlinkRouteMessage::showMultiPathAttribues(
 
 folly::Expected<folly::IPAddress, folly::IPAddressFormatError>
 NetlinkRouteMessage::parseIp(
-    const struct rtattr* ipAttr, unsigned char family) const {
+    const struct rtattr* ipAttr, unsigned char family) {
   if (family == AF_INET) {
     struct in_addr* addr4 = reinterpret_cast<in_addr*> RTA_DATA(ipAttr);
     return folly::IPAddressV4::fromLong(addr4->s_addr);
@@ -378,7 +378,7 @@ NetlinkRouteMessage::parseIp(
 }
 
 std::optional<std::vector<int32_t>>
-NetlinkRouteMessage::parseMplsLabels(const struct rtattr* routeAttr) const {
+NetlinkRouteMessage::parseMplsLabels(const struct rtattr* routeAttr) {
   const struct rtattr* mplsAttr =
       reinterpret_cast<struct rtattr*> RTA_DATA(routeAttr);
   int mplsAttrLen = RTA_PAYLOAD(routeAttr);
@@ -407,7 +407,7 @@ void
 NetlinkRouteMessage::parseNextHopAttribute(
     const struct rtattr* routeAttr,
     unsigned char family,
-    fbnl::NextHopBuilder& nhBuilder) const {
+    fbnl::NextHopBuilder& nhBuilder) {
   switch (routeAttr->rta_type) {
   case RTA_GATEWAY: {
     // Gateway address
@@ -463,7 +463,7 @@ NetlinkRouteMessage::parseNextHopAttribute(
 
 void
 NetlinkRouteMessage::setMplsAction(
-    fbnl::NextHopBuilder& nhBuilder, unsigned char family) const {
+    fbnl::NextHopBuilder& nhBuilder, unsigned char family) {
   // Inferring MPLS action from nexthop fields
   if (nhBuilder.getPushLabels() != std::nullopt) {
     nhBuilder.setLabelAction(thrift::MplsActionCode::PUSH);
@@ -482,7 +482,7 @@ NetlinkRouteMessage::setMplsAction(
 }
 
 fbnl::Route
-NetlinkRouteMessage::parseMessage(const struct nlmsghdr* nlmsg) const {
+NetlinkRouteMessage::parseMessage(const struct nlmsghdr* nlmsg) {
   fbnl::RouteBuilder routeBuilder;
   // For single next hop in the route
   fbnl::NextHopBuilder nhBuilder;
@@ -528,6 +528,12 @@ NetlinkRouteMessage::parseMessage(const struct nlmsghdr* nlmsg) const {
       routeBuilder.setPriority(*(reinterpret_cast<int*> RTA_DATA(routeAttr)));
     } break;
 
+    case RTA_NH_ID: {
+      // route uses a kernel nexthop object
+      routeBuilder.setNextHopId(
+          *(reinterpret_cast<uint32_t*> RTA_DATA(routeAttr)));
+    } break;
+
     // Nexthop attributes
     case RTA_GATEWAY:
     case RTA_OIF:
@@ -567,9 +573,44 @@ NetlinkRouteMessage::parseMessage(const struct nlmsghdr* nlmsg) const {
   return route;
 }
 
+void
+NetlinkRouteMessage::setRouteCallback(
+    const RouteFilter& filter, std::shared_ptr<RouteCallback> routeCb) {
+  routeFilter_ = filter;
+  routeCb_ = std::move(routeCb);
+}
+
+void
+NetlinkRouteMessage::setDumpFilter(const RouteFilter& filter) {
+  // strict checking rejects dumps with any other field of the header set,
+  // zero dumps any
+  rtmsg_->rtm_family = filter.family.value_or(AF_UNSPEC);
+  rtmsg_->rtm_table = filter.routeTable.value_or(RT_TABLE_UNSPEC);
+  rtmsg_->rtm_protocol = filter.protocolId.value_or(RTPROT_UNSPEC);
+  rtmsg_->rtm_scope = RT_SCOPE_UNIVERSE;
+  rtmsg_->rtm_type = RTN_UNSPEC;
+  rtmsg_->rtm_flags = 0;
+}
+
+void
+NetlinkRouteMessage::processRoute(const struct nlmsghdr* nlmsg) const {
+  if (not routeCb_ or not *routeCb_) {
+    return;
+  }
+  const struct rtmsg* const routeEntry =
+      reinterpret_cast<const struct rtmsg*>(NLMSG_DATA(nlmsg));
+  auto const& filter = routeFilter_;
+  if ((filter.protocolId and *filter.protocolId != routeEntry->rtm_protocol) or
+      (filter.routeTable and *filter.routeTable != routeEntry->rtm_table) or
+      (filter.family and *filter.family != routeEntry->rtm_family)) {
+    return;
+  }
+  (*routeCb_)(parseMessage(nlmsg));
+}
+
 std::vector<fbnl::NextHop>
 NetlinkRouteMessage::parseNextHops(
-    const struct rtattr* routeAttrMP, unsigned char family) const {
+    const struct rtattr* routeAttrMP, unsigned char family) {
   std::vector<fbnl::NextHop> nextHops;
   struct rtnexthop* nh =
       reinterpret_cast<struct rtnexthop*> RTA_DATA(routeAttrMP);
@@ -638,6 +679,16 @@ NetlinkRouteMessage::addRoute(const openr::fbnl::Route& route) {
     }
   }
 
+  // nexthops of the kernel nexthop object are used instead
+  if (route.getNextHopId().has_value()) {
+    const uint32_t nextHopId = route.getNextHopId().value();
+    return addAttributes(
+        RTA_NH_ID,
+        reinterpret_cast<const char*>(&nextHopId),
+        sizeof(nextHopId),
+        msghdr_);
+  }
+
   return addNextHops(route);
 }
 
@@ -712,6 +763,109 @@ NetlinkRouteMessage::deleteLabelRoute(const openr::fbnl::Route& route) {
       msghdr_);
 }
 
+NetlinkNextHopMessage::NetlinkNextHopMessage() {
+  // get pointer to NLMSG header
+  msghdr_ = getMessagePtr();
+}
+
+void
+NetlinkNextHopMessage::init(int type, uint8_t family, uint8_t protocolId) {
+  // initialize netlink header
+  msghdr_->nlmsg_len = NLMSG_LENGTH(sizeof(struct nhmsg));
+  msghdr_->nlmsg_type = type;
+  msghdr_->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+  if (type == RTM_NEWNEXTHOP) {
+    msghdr_->nlmsg_flags |= NLM_F_CREATE | NLM_F_REPLACE;
+  }
+
+  // initialize the nexthop message header
+  auto nlmsgAlen = NLMSG_ALIGN(sizeof(struct nlmsghdr));
+  nhmsg_ = reinterpret_cast<struct nhmsg*>((char*)msghdr_ + nlmsgAlen);
+  nhmsg_->nh_family = family;
+  nhmsg_->nh_scope = 0;
+  nhmsg_->nh_protocol = protocolId;
+  nhmsg_->nh_flags = 0;
+}
+
+int
+NetlinkNextHopMessage::addNextHop(
+    uint32_t id, const openr::fbnl::NextHop& nextHop, uint8_t protocolId) {
+  VLOG(1) << "Adding nexthop " << id << ": " << nextHop.str();
+
+  auto const via = nextHop.getGateway();
+  if (!via.has_value() || !nextHop.getIfIndex().has_value()) {
+    LOG(ERROR) << "Nexthop object needs a gateway and an interface";
+    return EINVAL;
+  }
+  if (nextHop.getLabelAction().has_value()) {
+    LOG(ERROR) << "MPLS actions are not supported in nexthop objects";
+    return EINVAL;
+  }
+
+  init(RTM_NEWNEXTHOP, via.value().family(), protocolId);
+
+  int status{0};
+  if ((status = addAttributes(
+           NHA_ID, reinterpret_cast<const char*>(&id), sizeof(id), msghdr_))) {
+    return status;
+  }
+  const uint32_t oif = nextHop.getIfIndex().value();
+  if ((status = addAttributes(
+           NHA_OIF,
+           reinterpret_cast<const char*>(&oif),
+           sizeof(oif),
+           msghdr_))) {
+    return status;
+  }
+  return addAttributes(
+      NHA_GATEWAY,
+      reinterpret_cast<const char*>(via.value().bytes()),
+      via.value().byteCount(),
+      msghdr_);
+}
+
+int
+NetlinkNextHopMessage::addNextHopGroup(
+    uint32_t id, const std::vector<uint32_t>& nextHopIds, uint8_t protocolId) {
+  VLOG(1) << "Adding nexthop group " << id << " of " << nextHopIds.size()
+          << " nexthops";
+
+  if (nextHopIds.empty()) {
+    LOG(ERROR) << "Nexthop group needs at least one nexthop";
+    return EINVAL;
+  }
+
+  // groups have no family of their own
+  init(RTM_NEWNEXTHOP, AF_UNSPEC, protocolId);
+
+  int status{0};
+  if ((status = addAttributes(
+           NHA_ID, reinterpret_cast<const char*>(&id), sizeof(id), msghdr_))) {
+    return status;
+  }
+
+  // weight is encoded as weight - 1, all members get weight 1
+  std::vector<struct nexthop_grp> members(nextHopIds.size());
+  for (size_t i = 0; i < nextHopIds.size(); ++i) {
+    members[i].id = nextHopIds[i];
+    members[i].weight = 0;
+  }
+  return addAttributes(
+      NHA_GROUP,
+      reinterpret_cast<const char*>(members.data()),
+      members.size() * sizeof(struct nexthop_grp),
+      msghdr_);
+}
+
+int
+NetlinkNextHopMessage::deleteNextHop(uint32_t id) {
+  VLOG(1) << "Deleting nexthop " << id;
+
+  init(RTM_DELNEXTHOP, AF_UNSPEC, 0);
+  return addAttributes(
+      NHA_ID, reinterpret_cast<const char*>(&id), sizeof(id), msghdr_);
+}
+
 NetlinkLinkMessage::NetlinkLinkMessage() {
   // get pointer to NLMSG header
   msghdr_ = getMessagePtr();
@@ -742,7 +896,7 @@ NetlinkLinkMessage::init(int type, uint32_t linkFlags) {
 }
 
 fbnl::Link
-NetlinkLinkMessage::parseMessage(const struct nlmsghdr* nlmsg) const {
+NetlinkLinkMessage::parseMessage(const struct nlmsghdr* nlmsg) {
   fbnl::LinkBuilder builder;
   const struct ifinfomsg* const linkEntry =
       reinterpret_cast<struct ifinfomsg*>(NLMSG_DATA(nlmsg));
@@ -839,7 +993,7 @@ NetlinkAddrMessage::addOrDeleteIfAddress(
 }
 
 fbnl::IfAddress
-NetlinkAddrMessage::parseMessage(const struct nlmsghdr* nlmsg) const {
+NetlinkAddrMessage::parseMessage(const struct nlmsghdr* nlmsg) {
   fbnl::IfAddressBuilder builder;
   const struct ifaddrmsg* const addrEntry =
       reinterpret_cast<struct ifaddrmsg*>(NLMSG_DATA(nlmsg));
@@ -910,7 +1064,7 @@ NetlinkNeighborMessage::init(int type, uint32_t neighFlags) {
 }
 
 fbnl::Neighbor
-NetlinkNeighborMessage::parseMessage(const struct nlmsghdr* nlmsg) const {
+NetlinkNeighborMessage::parseMessage(const struct nlmsghdr* nlmsg) {
   fbnl::NeighborBuilder builder;
   const struct ndmsg* const neighEntry =
       reinterpret_cast<struct ndmsg*>(NLMSG_DATA(nlmsg));
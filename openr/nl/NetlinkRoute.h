@@ -7,8 +7,13 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <optional>
+
 #include <linux/lwtunnel.h>
 #include <linux/mpls.h>
+#include <linux/nexthop.h>
 #include <linux/rtnetlink.h>
 #include <net/if_arp.h>
 #include <netinet/ether.h>
@@ -28,6 +33,10 @@
 #define MPLS_IPTUNNEL_DST 1
 #endif
 
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK 12
+#endif
+
 namespace openr::fbnl {
 
 constexpr uint16_t kMaxLabels{16};
@@ -36,8 +45,17 @@ constexpr uint32_t kLabelShift{12};
 constexpr uint32_t kLabelMask{0xFFFFF000};
 constexpr uint32_t kLabelSizeBits{20};
 
+// Routes to take from a route dump, std::nullopt matches any
+struct RouteFilter {
+  std::optional<uint8_t> protocolId;
+  std::optional<uint8_t> routeTable;
+  std::optional<uint8_t> family;
+};
+
 class NetlinkRouteMessage final : public NetlinkMessage {
  public:
+  using RouteCallback = std::function<void(fbnl::Route&&)>;
+
   NetlinkRouteMessage();
 
   // initiallize route message with default params
@@ -45,11 +63,12 @@ class NetlinkRouteMessage final : public NetlinkMessage {
 
   friend std::ostream&
   operator<<(std::ostream& out, NetlinkRouteMessage const& msg) {
-    out << "\nMessage type:     " << msg.msghdr_->nlmsg_type
-        << "\nMessage length:   " << msg.msghdr_->nlmsg_len
-        << "\nMessage flags:    " << std::hex << msg.msghdr_->nlmsg_flags
-        << "\nMessage sequence: " << msg.msghdr_->nlmsg_seq
-        << "\nMessage pid:      " << msg.msghdr_->nlmsg_pid << std::endl;
+    auto const* msghdr = msg.getMessagePtr();
+    out << "\nMessage type:     " << msghdr->nlmsg_type
+        << "\nMessage length:   " << msghdr->nlmsg_len
+        << "\nMessage flags:    " << std::hex << msghdr->nlmsg_flags
+        << "\nMessage sequence: " << msghdr->nlmsg_seq
+        << "\nMessage pid:      " << msghdr->nlmsg_pid << std::endl;
     return out;
   }
 
@@ -68,8 +87,23 @@ class NetlinkRouteMessage final : public NetlinkMessage {
   // encode MPLS label, returns in network order
   uint32_t encodeLabel(uint32_t label, bool bos) const;
 
-  // process netlink route message
-  fbnl::Route parseMessage(const struct nlmsghdr* nlmsg) const;
+  // process netlink route message, doesn't need an instance
+  static fbnl::Route parseMessage(const struct nlmsghdr* nlmsg);
+
+  // hand routes of this dump request which match filter to routeCb, as they
+  // are received. routeCb is shared so that it can be reset once the caller
+  // stops waiting for the dump.
+  void setRouteCallback(
+      const RouteFilter& filter, std::shared_ptr<RouteCallback> routeCb);
+
+  // have the kernel filter this dump request on the family, table and
+  // protocol of filter. Kernels only do so on sockets with strict checking,
+  // others ignore them and dump all routes
+  void setDumpFilter(const RouteFilter& filter);
+
+  // parse a route of the dump and pass it to the route callback, routes not
+  // matching the filter are dropped before they get parsed
+  void processRoute(const struct nlmsghdr* nlmsg) const;
 
  private:
   // print ancillary data
@@ -82,30 +116,34 @@ class NetlinkRouteMessage final : public NetlinkMessage {
   void showMultiPathAttribues(const struct rtattr* const rta) const;
 
   // parse IP address
-  folly::Expected<folly::IPAddress, folly::IPAddressFormatError> parseIp(
-      const struct rtattr* ipAttr, unsigned char family) const;
+  static folly::Expected<folly::IPAddress, folly::IPAddressFormatError>
+  parseIp(const struct rtattr* ipAttr, unsigned char family);
 
   // process netlink next hops
-  std::vector<fbnl::NextHop> parseNextHops(
-      const struct rtattr* routeAttrMultipath, unsigned char family) const;
+  static std::vector<fbnl::NextHop> parseNextHops(
+      const struct rtattr* routeAttrMultipath, unsigned char family);
 
   // parse NextHop Attributes
-  void parseNextHopAttribute(
+  static void parseNextHopAttribute(
       const struct rtattr* routeAttr,
       unsigned char family,
-      fbnl::NextHopBuilder& nhBuilder) const;
+      fbnl::NextHopBuilder& nhBuilder);
 
   // parse MPLS labels
-  std::optional<std::vector<int32_t>> parseMplsLabels(
-      const struct rtattr* routeAttr) const;
+  static std::optional<std::vector<int32_t>> parseMplsLabels(
+      const struct rtattr* routeAttr);
 
   // set mpls action based on nexthop fields
-  void setMplsAction(
-      fbnl::NextHopBuilder& nhBuilder, unsigned char family) const;
+  static void setMplsAction(
+      fbnl::NextHopBuilder& nhBuilder, unsigned char family);
 
   // pointer to route message header
   struct rtmsg* rtmsg_{nullptr};
 
+  // routes of a dump request
+  RouteFilter routeFilter_;
+  std::shared_ptr<RouteCallback> routeCb_;
+
   // add set of nexthops
   int addNextHops(const openr::fbnl::Route& route);
 
@@ -154,6 +192,41 @@ class NetlinkRouteMessage final : public NetlinkMessage {
   } __attribute__((__packed__));
 };
 
+/**
+ * Kernel nexthop objects (RTM_NEWNEXTHOP), shared by the routes referring to
+ * them with RTA_NH_ID instead of carrying their own nexthops. A nexthop object
+ * is a single gateway on an interface, a group is a set of nexthop objects.
+ * Replacing a group moves all routes using it at once.
+ */
+class NetlinkNextHopMessage final : public NetlinkMessage {
+ public:
+  NetlinkNextHopMessage();
+
+  // add or replace nexthop object id, MPLS actions are not supported
+  int addNextHop(
+      uint32_t id, const openr::fbnl::NextHop& nextHop, uint8_t protocolId);
+
+  // add or replace group id of the nexthop objects nextHopIds, all of the
+  // same weight
+  int addNextHopGroup(
+      uint32_t id,
+      const std::vector<uint32_t>& nextHopIds,
+      uint8_t protocolId);
+
+  // delete nexthop object or group id, the kernel deletes routes using it
+  int deleteNextHop(uint32_t id);
+
+ private:
+  // initiallize nexthop message header
+  void init(int type, uint8_t family, uint8_t protocolId);
+
+  // pointer to nexthop message header
+  struct nhmsg* nhmsg_{nullptr};
+
+  // pointer to the netlink message header
+  struct nlmsghdr* msghdr_{nullptr};
+};
+
 class NetlinkLinkMessage final : public NetlinkMessage {
  public:
   NetlinkLinkMessage();
@@ -162,7 +235,7 @@ class NetlinkLinkMessage final : public NetlinkMessage {
   void init(int type, uint32_t flags);
 
   // parse Netlink Link message
-  fbnl::Link parseMessage(const struct nlmsghdr* nlh) const;
+  static fbnl::Link parseMessage(const struct nlmsghdr* nlh);
 
  private:
   // pointer to link message header
@@ -180,7 +253,7 @@ class NetlinkAddrMessage final : public NetlinkMessage {
   void init(int type);
 
   // parse Netlink Address message
-  fbnl::IfAddress parseMessage(const struct nlmsghdr* nlh) const;
+  static fbnl::IfAddress parseMessage(const struct nlmsghdr* nlh);
 
   // create netlink message to add/delete interface address
   // type - RTM_NEWADDR or RTM_DELADDR
@@ -203,7 +276,7 @@ class NetlinkNeighborMessage final : public NetlinkMessage {
   void init(int type, uint32_t flags);
 
   // parse Netlink Neighbor message
-  fbnl::Neighbor parseMessage(const struct nlmsghdr* nlh) const;
+  static fbnl::Neighbor parseMessage(const struct nlmsghdr* nlh);
 
  private:
   // pointer to neighbor message header
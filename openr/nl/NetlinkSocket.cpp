@@ -6,10 +6,44 @@
  */
 
 #include <openr/nl/NetlinkSocket.h>
+
+#include <folly/system/ThreadName.h>
+
 #include <openr/if/gen-cpp2/Platform_constants.h>
 
 namespace openr::fbnl {
 
+namespace {
+
+// admin distance of the protocol, if the user did not specify priority
+void
+setDefaultPriority(Route& route) {
+  if (route.getPriority()) {
+    return;
+  }
+  const auto routePair =
+      openr::thrift::Platform_constants::protocolIdtoPriority().find(
+          route.getProtocolId());
+  if (routePair ==
+      openr::thrift::Platform_constants::protocolIdtoPriority().end()) {
+    route.setPriority(
+        openr::thrift::Platform_constants::kUnknowProtAdminDistance());
+  } else {
+    route.setPriority(routePair->second);
+  }
+}
+
+// attributes we program, kernel dumps fill in flags, table and others
+bool
+isSameProgrammedRoute(const Route& kernelRoute, const Route& route) {
+  return kernelRoute.getType() == route.getType() and
+      kernelRoute.getPriority() == route.getPriority() and
+      kernelRoute.getNextHopId() == route.getNextHopId() and
+      kernelRoute.getNextHops() == route.getNextHops();
+}
+
+} // namespace
+
 NetlinkSocket::NetlinkSocket(
     fbzmq::ZmqEventLoop* evl,
     EventsHandler* handler,
@@ -56,9 +90,20 @@ NetlinkSocket::NetlinkSocket(
   // need to reload routes from kernel to avoid re-adding existing route
   // type of exception in NetlinkSocket
   updateRouteCache();
+
+  // route programming gets its own thread, so that link, address and
+  // neighbor events never wait behind big route updates
+  routeThread_ = std::thread([this]() {
+    folly::setThreadName("NetlinkRouteEvl");
+    routeEvl_.run();
+  });
+  routeEvl_.waitUntilRunning();
 }
 
 NetlinkSocket::~NetlinkSocket() {
+  routeEvl_.stop();
+  routeEvl_.waitUntilStopped();
+  routeThread_.join();
   nlSock_.reset();
 }
 
@@ -88,6 +133,17 @@ void
 NetlinkSocket::doHandleLinkEvent(Link link, bool runHandler) noexcept {
   const auto linkName = link.getLinkName();
   auto& linkAttr = links_[linkName];
+  if (linkAttr.seqNum == 0 or linkAttr.isUp != link.isUp() or
+      linkAttr.ifIndex != link.getIfIndex()) {
+    linkAttr.seqNum = ++linksSeqNum_;
+  }
+  if (linkAttr.ifIndex != link.getIfIndex()) {
+    auto it = ifIndexToName_.find(linkAttr.ifIndex);
+    if (it != ifIndexToName_.end() and it->second == linkName) {
+      ifIndexToName_.erase(it);
+    }
+  }
+  ifIndexToName_[link.getIfIndex()] = linkName;
   linkAttr.isUp = link.isUp();
   linkAttr.ifIndex = link.getIfIndex();
   if (link.isLoopback()) {
@@ -104,26 +160,31 @@ NetlinkSocket::doHandleLinkEvent(Link link, bool runHandler) noexcept {
 
 void
 NetlinkSocket::removeNeighborCacheEntries(const std::string& ifName) {
-  for (auto it = neighbors_.begin(); it != neighbors_.end();) {
-    if (std::get<0>(it->first) == ifName) {
-      it = neighbors_.erase(it);
-    } else {
-      ++it;
-    }
+  auto it = neighbors_.find(ifName);
+  if (it == neighbors_.end()) {
+    return;
+  }
+  NeighborUpdate neighborUpdate;
+  for (const auto& kv : it->second) {
+    neighborUpdate.delNeighbor(kv.first.str());
   }
+  neighbors_.erase(it);
+  notifyNeighborListener(neighborUpdate);
 }
 
 void
 NetlinkSocket::doHandleAddrEvent(IfAddress ifAddr, bool runHandler) noexcept {
   std::string ifName = getIfName(ifAddr.getIfIndex()).get();
   if (ifAddr.isValid()) {
-    if (links_[ifName].networks.count(ifAddr.getPrefix().value()) == 0) {
-      links_[ifName].networks.insert(ifAddr.getPrefix().value());
+    auto& linkAttr = links_[ifName];
+    if (linkAttr.networks.insert(ifAddr.getPrefix().value()).second) {
+      linkAttr.seqNum = ++linksSeqNum_;
     }
   } else if (!ifAddr.isValid()) {
     auto it = links_.find(ifName);
-    if (it != links_.end()) {
-      it->second.networks.erase(ifAddr.getPrefix().value());
+    if (it != links_.end() and
+        it->second.networks.erase(ifAddr.getPrefix().value())) {
+      it->second.seqNum = ++linksSeqNum_;
     }
   }
 
@@ -137,25 +198,9 @@ void
 NetlinkSocket::doHandleNeighborEvent(
     Neighbor neighbor, bool runHandler) noexcept {
   std::string ifName = getIfName(neighbor.getIfIndex()).get();
-  auto key = std::make_pair(ifName, neighbor.getDestination());
-  neighbors_.erase(key);
-
   NeighborUpdate neighborUpdate;
-  if (neighbor.isReachable()) {
-    neighbors_.emplace(std::make_pair(key, neighbor));
-    neighborUpdate.addNeighbor(neighbor.getDestination().str());
-  } else {
-    neighborUpdate.delNeighbor(neighbor.getDestination().str());
-  }
-
-  if (neighborListener_) {
-    std::lock_guard<std::mutex> g(neighborListenerMutex_);
-    try {
-      neighborListener_(neighborUpdate);
-    } catch (std::exception const& ex) {
-      LOG(ERROR) << "neighbor call failed: " << ex.what();
-    }
-  }
+  doUpdateNeighborCache(ifName, neighbor, neighborUpdate);
+  notifyNeighborListener(neighborUpdate);
 
   if (handler_ && runHandler && eventFlags_[NEIGH_EVENT]) {
     NeighborBuilder nhBuilder;
@@ -164,6 +209,44 @@ NetlinkSocket::doHandleNeighborEvent(
   }
 }
 
+void
+NetlinkSocket::doUpdateNeighborCache(
+    const std::string& ifName,
+    const Neighbor& neighbor,
+    NeighborUpdate& neighborUpdate) {
+  const auto& destination = neighbor.getDestination();
+  if (neighbor.isReachable()) {
+    neighbors_[ifName].insert_or_assign(destination, neighbor);
+    neighborUpdate.addNeighbor(destination.str());
+    return;
+  }
+
+  auto it = neighbors_.find(ifName);
+  if (it == neighbors_.end() or it->second.erase(destination) == 0) {
+    return;
+  }
+  if (it->second.empty()) {
+    neighbors_.erase(it);
+  }
+  neighborUpdate.delNeighbor(destination.str());
+}
+
+void
+NetlinkSocket::notifyNeighborListener(const NeighborUpdate& neighborUpdate) {
+  if (neighborUpdate.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> g(neighborListenerMutex_);
+  if (not neighborListener_) {
+    return;
+  }
+  try {
+    neighborListener_(neighborUpdate);
+  } catch (std::exception const& ex) {
+    LOG(ERROR) << "neighbor call failed: " << ex.what();
+  }
+}
+
 void
 NetlinkSocket::doUpdateRouteCache(Route route, bool updateUnicastRoute) {
   // Skip cached route entries and any routes not in the main table
@@ -197,10 +280,10 @@ NetlinkSocket::addRoute(Route route) {
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop([this,
-                                     p = std::move(promise),
-                                     dest = std::move(prefix),
-                                     r = std::move(route)]() mutable {
+  routeEvl_.runImmediatelyOrInEventLoop([this,
+                                         p = std::move(promise),
+                                         dest = std::move(prefix),
+                                         r = std::move(route)]() mutable {
     try {
       uint8_t type = r.getType();
       switch (type) {
@@ -232,10 +315,10 @@ NetlinkSocket::addMplsRoute(Route mplsRoute) {
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop([this,
-                                     p = std::move(promise),
-                                     dest = std::move(prefix),
-                                     r = std::move(mplsRoute)]() mutable {
+  routeEvl_.runImmediatelyOrInEventLoop([this,
+                                         p = std::move(promise),
+                                         dest = std::move(prefix),
+                                         r = std::move(mplsRoute)]() mutable {
     try {
       uint8_t type = r.getType();
       switch (type) {
@@ -264,10 +347,10 @@ NetlinkSocket::delMplsRoute(Route mplsRoute) {
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop([this,
-                                     p = std::move(promise),
-                                     r = std::move(mplsRoute),
-                                     dest = std::move(prefix)]() mutable {
+  routeEvl_.runImmediatelyOrInEventLoop([this,
+                                         p = std::move(promise),
+                                         r = std::move(mplsRoute),
+                                         dest = std::move(prefix)]() mutable {
     try {
       uint8_t type = r.getType();
       switch (type) {
@@ -289,35 +372,83 @@ NetlinkSocket::delMplsRoute(Route mplsRoute) {
   return future;
 }
 
+folly::Future<folly::Unit>
+NetlinkSocket::addNextHop(uint8_t protocolId, uint32_t id, NextHop nextHop) {
+  VLOG(3) << "NetlinkSocket add nexthop " << id;
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  routeEvl_.runImmediatelyOrInEventLoop([this,
+                                         p = std::move(promise),
+                                         protocolId,
+                                         id,
+                                         nh = std::move(nextHop)]() mutable {
+    int err = static_cast<int>(nlSock_->addNextHop(id, nh, protocolId));
+    if (0 != err) {
+      p.setException(fbnl::NlException(folly::sformat(
+          "Could not add nexthop {}\n{}\nError: {}", id, nh.str(), err)));
+      return;
+    }
+    p.setValue();
+  });
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkSocket::addNextHopGroup(
+    uint8_t protocolId, uint32_t id, std::vector<uint32_t> nextHopIds) {
+  VLOG(3) << "NetlinkSocket add nexthop group " << id;
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  routeEvl_.runImmediatelyOrInEventLoop(
+      [this,
+       p = std::move(promise),
+       protocolId,
+       id,
+       ids = std::move(nextHopIds)]() mutable {
+        int err =
+            static_cast<int>(nlSock_->addNextHopGroup(id, ids, protocolId));
+        if (0 != err) {
+          p.setException(fbnl::NlException(folly::sformat(
+              "Could not add nexthop group {} Error: {}", id, err)));
+          return;
+        }
+        p.setValue();
+      });
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkSocket::delNextHops(std::vector<uint32_t> ids) {
+  VLOG(3) << "NetlinkSocket deleting " << ids.size() << " nexthops";
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  routeEvl_.runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise), ids = std::move(ids)]() mutable {
+        int err = static_cast<int>(nlSock_->deleteNextHops(ids));
+        if (0 != err) {
+          p.setException(fbnl::NlException(
+              folly::sformat("Failed to delete nexthops Error: {}", err)));
+          return;
+        }
+        p.setValue();
+      });
+  return future;
+}
+
 folly::Future<folly::Unit>
 NetlinkSocket::syncMplsRoutes(uint8_t protocolId, NlMplsRoutes newMplsRouteDb) {
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop([this,
-                                     p = std::move(promise),
-                                     syncDb = std::move(newMplsRouteDb),
-                                     protocolId]() mutable {
+  routeEvl_.runImmediatelyOrInEventLoop([this,
+                                         p = std::move(promise),
+                                         syncDb = std::move(newMplsRouteDb),
+                                         protocolId]() mutable {
     try {
-      LOG(INFO) << "Syncing " << syncDb.size() << " mpls routes";
-      auto& mplsRoutes = mplsRoutesCache_[protocolId];
-      std::unordered_set<int32_t> toDelete;
-      // collect label routes to delete
-      for (auto const& kv : mplsRoutes) {
-        if (syncDb.find(kv.first) == syncDb.end()) {
-          toDelete.insert(kv.first);
-        }
-      }
-      // delete
-      LOG(INFO) << "Sync: Deleting " << toDelete.size() << " mpls routes";
-      for (auto label : toDelete) {
-        auto mplsRouteEntry = mplsRoutes.at(label);
-        doDeleteMplsRoute(mplsRouteEntry);
-      }
-      // Go over MPLS routes in new routeDb, update/add
-      for (auto& kv : syncDb) {
-        doAddUpdateMplsRoute(kv.second);
-      }
+      doSyncMplsRoutes(protocolId, std::move(syncDb));
       p.setValue();
       LOG(INFO) << "Sync done.";
     } catch (std::exception const& ex) {
@@ -336,7 +467,7 @@ NetlinkSocket::getCachedMplsRoutes(uint8_t protocolId) const {
   folly::Promise<NlMplsRoutes> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop(
+  routeEvl_.runImmediatelyOrInEventLoop(
       [this, p = std::move(promise), protocolId]() mutable {
         auto iter = mplsRoutesCache_.find(protocolId);
         if (iter != mplsRoutesCache_.end()) {
@@ -355,13 +486,14 @@ NetlinkSocket::getMplsRouteCount() const {
   folly::Promise<int64_t> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop([this, p = std::move(promise)]() mutable {
-    int64_t count = 0;
-    for (const auto& routes : mplsRoutesCache_) {
-      count += routes.second.size();
-    }
-    p.setValue(count);
-  });
+  routeEvl_.runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise)]() mutable {
+        int64_t count = 0;
+        for (const auto& routes : mplsRoutesCache_) {
+          count += routes.second.size();
+        }
+        p.setValue(count);
+      });
   return future;
 }
 
@@ -374,19 +506,7 @@ NetlinkSocket::doAddUpdateUnicastRoute(Route route) {
   // Create new set of nexthops to be programmed. Existing + New ones
   auto& unicastRoutes = unicastRoutesCache_[route.getProtocolId()];
   auto iter = unicastRoutes.find(dest);
-  // if user did not speicify priority
-  if (!route.getPriority()) {
-    const auto routePair =
-        openr::thrift::Platform_constants::protocolIdtoPriority().find(
-            route.getProtocolId());
-    if (routePair ==
-        openr::thrift::Platform_constants::protocolIdtoPriority().end()) {
-      route.setPriority(
-          openr::thrift::Platform_constants::kUnknowProtAdminDistance());
-    } else {
-      route.setPriority(routePair->second);
-    }
-  }
+  setDefaultPriority(route);
   // Same route
   if (iter != unicastRoutes.end() && iter->second == route) {
     return;
@@ -434,10 +554,10 @@ NetlinkSocket::delRoute(Route route) {
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop([this,
-                                     p = std::move(promise),
-                                     r = std::move(route),
-                                     dest = std::move(prefix)]() mutable {
+  routeEvl_.runImmediatelyOrInEventLoop([this,
+                                         p = std::move(promise),
+                                         r = std::move(route),
+                                         dest = std::move(prefix)]() mutable {
     try {
       uint8_t type = r.getType();
       switch (type) {
@@ -520,6 +640,68 @@ NetlinkSocket::doAddUpdateMplsRoute(Route mplsRoute) {
       static_cast<int32_t>(label.value()), std::move(mplsRoute)));
 }
 
+void
+NetlinkSocket::doSyncMplsRoutes(uint8_t protocolId, NlMplsRoutes syncDb) {
+  LOG(INFO) << "Syncing " << syncDb.size() << " mpls routes";
+  auto& mplsRoutes = mplsRoutesCache_[protocolId];
+
+  // collect label routes to delete, and new or changed ones to add
+  std::vector<int32_t> deleteLabels;
+  std::vector<Route> toDelete;
+  for (auto const& kv : mplsRoutes) {
+    if (syncDb.find(kv.first) == syncDb.end()) {
+      deleteLabels.emplace_back(kv.first);
+      toDelete.emplace_back(kv.second);
+    }
+  }
+  std::vector<int32_t> addLabels;
+  std::vector<Route> toAdd;
+  for (auto& kv : syncDb) {
+    auto it = mplsRoutes.find(kv.first);
+    if (it == mplsRoutes.end() or not(it->second == kv.second)) {
+      addLabels.emplace_back(kv.first);
+      toAdd.emplace_back(std::move(kv.second));
+    }
+  }
+
+  // both batches are queued right away, deletes ahead of adds
+  LOG(INFO) << "Sync: Deleting " << toDelete.size() << " and adding "
+            << toAdd.size() << " mpls routes";
+  auto deleteFuture = nlSock_->deleteLabelRoutes(toDelete);
+  auto addFuture = nlSock_->addLabelRoutes(toAdd);
+  const auto deleteStatuses = std::move(deleteFuture).get(kNlRequestTimeout);
+  const auto addStatuses = std::move(addFuture).get(kNlRequestTimeout);
+
+  // cache follows the kernel label by label, failed ones get reported
+  std::vector<std::string> failures;
+  for (size_t i = 0; i < toDelete.size(); ++i) {
+    const auto label = deleteLabels[i];
+    if (deleteStatuses[i] != 0) {
+      failures.emplace_back(
+          folly::sformat("delete {}: {}", label, deleteStatuses[i]));
+      continue;
+    }
+    mplsRoutes.erase(label);
+  }
+  for (size_t i = 0; i < toAdd.size(); ++i) {
+    const auto label = addLabels[i];
+    if (addStatuses[i] != 0) {
+      failures.emplace_back(
+          folly::sformat("add {}: {}", label, addStatuses[i]));
+      // replaced in place or not, the old entry is no longer known
+      mplsRoutes.erase(label);
+      continue;
+    }
+    mplsRoutes.insert_or_assign(label, std::move(toAdd[i]));
+  }
+  if (not failures.empty()) {
+    throw fbnl::NlException(folly::sformat(
+        "Failed to sync {} mpls routes, errors by label: {}",
+        failures.size(),
+        folly::join(", ", failures)));
+  }
+}
+
 void
 NetlinkSocket::doDeleteUnicastRoute(Route route) {
   checkUnicastRoute(route);
@@ -552,10 +734,10 @@ NetlinkSocket::syncUnicastRoutes(
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop([this,
-                                     p = std::move(promise),
-                                     syncDb = std::move(newRouteDb),
-                                     protocolId]() mutable {
+  routeEvl_.runImmediatelyOrInEventLoop([this,
+                                         p = std::move(promise),
+                                         syncDb = std::move(newRouteDb),
+                                         protocolId]() mutable {
     try {
       LOG(INFO) << "Syncing " << syncDb.size() << " routes for protocol "
                 << static_cast<int>(protocolId);
@@ -600,6 +782,135 @@ NetlinkSocket::doSyncUnicastRoutes(uint8_t protocolId, NlUnicastRoutes syncDb) {
   }
 }
 
+folly::Future<int64_t>
+NetlinkSocket::syncUnicastRoutesWithKernel(
+    uint8_t protocolId, NlUnicastRoutes newRouteDb) {
+  folly::Promise<int64_t> promise;
+  auto future = promise.getFuture();
+
+  routeEvl_.runImmediatelyOrInEventLoop([this,
+                                         p = std::move(promise),
+                                         syncDb = std::move(newRouteDb),
+                                         protocolId]() mutable {
+    try {
+      LOG(INFO) << "Syncing " << syncDb.size() << " routes for protocol "
+                << static_cast<int>(protocolId) << " with kernel routes";
+      auto numChanged =
+          doSyncUnicastRoutesWithKernel(protocolId, std::move(syncDb));
+      p.setValue(numChanged);
+      LOG(INFO) << "Sync done, " << numChanged << " routes changed.";
+    } catch (std::exception const& ex) {
+      LOG(ERROR) << "Error syncing unicast routeDb with kernel: "
+                 << folly::exceptionStr(ex);
+      // programmed in part, the cache follows the kernel
+      auto& unicastRoutes = unicastRoutesCache_[protocolId];
+      unicastRoutes.clear();
+      for (auto& route : getKernelUnicastRoutes(protocolId)) {
+        auto prefix = route.getDestination();
+        unicastRoutes.emplace(std::move(prefix), std::move(route));
+      }
+      p.setException(ex);
+    }
+  });
+  return future;
+}
+
+std::vector<Route>
+NetlinkSocket::getKernelUnicastRoutes(uint8_t protocolId) {
+  std::vector<Route> routes;
+  RouteFilter filter;
+  filter.protocolId = protocolId;
+  filter.routeTable = RT_TABLE_MAIN;
+  nlSock_->getRoutes(filter, [&routes](Route&& route) {
+    // same routes as the cache keeps, see doUpdateRouteCache
+    const int flags = route.getFlags().value_or(0);
+    const auto& prefix = route.getDestination();
+    if (route.getFamily() == AF_MPLS or flags & RTM_F_CLONED or
+        prefix.first.isMulticast() or route.getScope() == RT_SCOPE_LINK or
+        not route.isValid()) {
+      return;
+    }
+    routes.emplace_back(std::move(route));
+  });
+  return routes;
+}
+
+int64_t
+NetlinkSocket::doSyncUnicastRoutesWithKernel(
+    uint8_t protocolId, NlUnicastRoutes syncDb) {
+  auto kernelRoutes = getKernelUnicastRoutes(protocolId);
+  std::vector<Route*> routes;
+  routes.reserve(syncDb.size());
+  for (auto& kv : syncDb) {
+    checkUnicastRoute(kv.second);
+    setDefaultPriority(kv.second);
+    routes.emplace_back(&kv.second);
+  }
+
+  // merge both tables sorted by prefix
+  auto byPrefix = [](const Route& lhs, const Route& rhs) {
+    return lhs.getDestination() < rhs.getDestination();
+  };
+  std::sort(kernelRoutes.begin(), kernelRoutes.end(), byPrefix);
+  std::sort(routes.begin(), routes.end(), [&byPrefix](auto lhs, auto rhs) {
+    return byPrefix(*lhs, *rhs);
+  });
+
+  std::vector<Route> toDelete;
+  std::vector<Route> toAdd;
+  // a replaced V6 route is deleted and added, yet a single change
+  int64_t numChanged = 0;
+  auto kernelIt = kernelRoutes.begin();
+  auto it = routes.begin();
+  while (kernelIt != kernelRoutes.end() or it != routes.end()) {
+    if (it == routes.end() or
+        (kernelIt != kernelRoutes.end() and byPrefix(*kernelIt, **it))) {
+      toDelete.emplace_back(std::move(*kernelIt++));
+      ++numChanged;
+      continue;
+    }
+    if (kernelIt == kernelRoutes.end() or byPrefix(**it, *kernelIt)) {
+      toAdd.emplace_back(**it++);
+      ++numChanged;
+      continue;
+    }
+    if (not isSameProgrammedRoute(*kernelIt, **it)) {
+      // V6 routes with other properties get added next to the old one, see
+      // doAddUpdateUnicastRoute, others get replaced
+      if ((*it)->getDestination().first.isV6()) {
+        toDelete.emplace_back(std::move(*kernelIt));
+      }
+      toAdd.emplace_back(**it);
+      ++numChanged;
+    }
+    ++kernelIt;
+    // duplicates of the prefix left by others, e.g. with another priority
+    while (kernelIt != kernelRoutes.end() and
+           not byPrefix(**it, *kernelIt)) {
+      toDelete.emplace_back(std::move(*kernelIt++));
+      ++numChanged;
+    }
+    ++it;
+  }
+
+  LOG(INFO) << "Sync: number of routes to delete: " << toDelete.size()
+            << ", to add or update: " << toAdd.size() << " of "
+            << syncDb.size();
+  int err = toDelete.empty() ? 0 : nlSock_->deleteRoutes(toDelete);
+  if (err != 0) {
+    throw fbnl::NlException(
+        folly::sformat("Failed to delete routes. Error: {}", err));
+  }
+  err = toAdd.empty() ? 0 : nlSock_->addRoutes(toAdd);
+  if (err != 0) {
+    throw fbnl::NlException(
+        folly::sformat("Failed to add routes. Error: {}", err));
+  }
+
+  unicastRoutesCache_[protocolId] = std::move(syncDb);
+  return numChanged;
+}
+
 folly::Future<NlUnicastRoutes>
 NetlinkSocket::getCachedUnicastRoutes(uint8_t protocolId) const {
   VLOG(3) << "NetlinkSocket getCachedUnicastRoutes by protocol "
@@ -607,7 +918,7 @@ NetlinkSocket::getCachedUnicastRoutes(uint8_t protocolId) const {
   folly::Promise<NlUnicastRoutes> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop(
+  routeEvl_.runImmediatelyOrInEventLoop(
       [this, p = std::move(promise), protocolId]() mutable {
         auto iter = unicastRoutesCache_.find(protocolId);
         if (iter != unicastRoutesCache_.end()) {
@@ -626,13 +937,14 @@ NetlinkSocket::getRouteCount() const {
   folly::Promise<int64_t> promise;
   auto future = promise.getFuture();
 
-  evl_->runImmediatelyOrInEventLoop([this, p = std::move(promise)]() mutable {
-    int64_t count = 0;
-    for (const auto& routes : unicastRoutesCache_) {
-      count += routes.second.size();
-    }
-    p.setValue(count);
-  });
+  routeEvl_.runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise)]() mutable {
+        int64_t count = 0;
+        for (const auto& routes : unicastRoutesCache_) {
+          count += routes.second.size();
+        }
+        p.setValue(count);
+      });
   return future;
 }
 
@@ -669,15 +981,8 @@ NetlinkSocket::getIfName(int ifIndex) const {
   auto future = promise.getFuture();
   evl_->runImmediatelyOrInEventLoop(
       [this, p = std::move(promise), ifIndex]() mutable {
-        std::string ifName{""};
-
-        for (const auto& linkEntry : links_) {
-          if (linkEntry.second.ifIndex == ifIndex) {
-            ifName = linkEntry.first;
-          }
-        }
-
-        p.setValue(ifName);
+        auto it = ifIndexToName_.find(ifIndex);
+        p.setValue(it != ifIndexToName_.end() ? it->second : "");
       });
   return future;
 }
@@ -724,6 +1029,73 @@ NetlinkSocket::delIfAddress(IfAddress ifAddress) {
   return future;
 }
 
+folly::Future<folly::Unit>
+NetlinkSocket::addIfAddresses(std::vector<IfAddress> ifAddrs) {
+  LOG(INFO) << "NetlinkSocket add " << ifAddrs.size() << " IfAddresses...";
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+  evl_->runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise), addrs = std::move(ifAddrs)]() mutable {
+        try {
+          doProgramIfAddresses(addrs, true);
+          p.setValue();
+        } catch (const std::exception& ex) {
+          p.setException(ex);
+        }
+      });
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkSocket::delIfAddresses(std::vector<IfAddress> ifAddrs) {
+  LOG(INFO) << "NetlinkSocket delete " << ifAddrs.size() << " IfAddresses...";
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+  for (const auto& addr : ifAddrs) {
+    if (!addr.getPrefix().has_value()) {
+      promise.setException(fbnl::NlException("Prefix must be set"));
+      return future;
+    }
+  }
+  evl_->runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise), addrs = std::move(ifAddrs)]() mutable {
+        try {
+          doProgramIfAddresses(addrs, false);
+          p.setValue();
+        } catch (const std::exception& ex) {
+          p.setException(ex);
+        }
+      });
+  return future;
+}
+
+void
+NetlinkSocket::doProgramIfAddresses(
+    const std::vector<IfAddress>& addrs, bool isAdd) {
+  if (addrs.empty()) {
+    return;
+  }
+  auto statuses = (isAdd ? nlSock_->addIfAddresses(addrs)
+                         : nlSock_->deleteIfAddresses(addrs))
+                      .get(kNlRequestTimeout);
+  std::vector<std::string> failures;
+  for (size_t i = 0; i < addrs.size(); ++i) {
+    if (statuses[i] != 0) {
+      failures.emplace_back(
+          folly::sformat("{}: {}", addrs[i].str(), statuses[i]));
+    }
+  }
+  if (not failures.empty()) {
+    throw fbnl::NlException(folly::sformat(
+        "Failed to {} {} addresses, errors by address: {}",
+        isAdd ? "add" : "delete",
+        failures.size(),
+        folly::join(", ", failures)));
+  }
+}
+
 folly::Future<folly::Unit>
 NetlinkSocket::syncIfAddress(
     int ifIndex, std::vector<IfAddress> addresses, int family, int scope) {
@@ -819,19 +1191,31 @@ NetlinkSocket::doSyncIfAddress(
       newPrefixes.end(),
       std::inserter(toDeletePrefixes, toDeletePrefixes.begin()));
 
-  // Do add first, because in Linux deleting the only IP will cause if down.
-  // Add new address, existed addresses will be ignored
+  // only addresses not assigned yet need to be added
+  std::vector<IfAddress> toAdd;
   for (auto& addr : addrs) {
-    addIfAddress(addr);
+    if (not std::binary_search(
+            oldPrefixes.begin(),
+            oldPrefixes.end(),
+            addr.getPrefix().value(),
+            cmp)) {
+      toAdd.emplace_back(std::move(addr));
+    }
   }
 
-  // Delete deprecated addresses
+  std::vector<IfAddress> toDelete;
   fbnl::IfAddressBuilder builder;
   for (const auto& toDel : toDeletePrefixes) {
-    auto delAddr =
-        builder.setIfIndex(ifIndex).setPrefix(toDel).setScope(scope).build();
-    delIfAddress(delAddr);
+    toDelete.emplace_back(
+        builder.setIfIndex(ifIndex).setPrefix(toDel).setScope(scope).build());
+    builder.reset();
   }
+
+  // Do add first, because in Linux deleting the only IP will cause if down.
+  VLOG(2) << "Sync: Adding " << toAdd.size() << " and deleting "
+          << toDelete.size() << " addresses of ifIndex " << ifIndex;
+  doProgramIfAddresses(toAdd, true);
+  doProgramIfAddresses(toDelete, false);
 }
 
 folly::Future<NlLinks>
@@ -841,14 +1225,8 @@ NetlinkSocket::getAllLinks() {
   auto future = promise.getFuture();
   evl_->runImmediatelyOrInEventLoop([this, p = std::move(promise)]() mutable {
     try {
-      auto links = nlSock_->getAllLinks();
-      for (auto& link : links) {
-        doHandleLinkEvent(link, false);
-      }
-      auto addresses = nlSock_->getAllIfAddresses();
-      for (auto& address : addresses) {
-        doHandleAddrEvent(address, false);
-      }
+      updateLinkCache();
+      updateAddrCache();
       p.setValue(links_);
     } catch (const std::exception& ex) {
       p.setException(ex);
@@ -857,6 +1235,53 @@ NetlinkSocket::getAllLinks() {
   return future;
 }
 
+void
+NetlinkSocket::updateLinkCache() {
+  for (auto& link : nlSock_->getAllLinks()) {
+    doHandleLinkEvent(link, false);
+  }
+}
+
+void
+NetlinkSocket::updateAddrCache() {
+  for (auto& address : nlSock_->getAllIfAddresses()) {
+    doHandleAddrEvent(address, false);
+  }
+}
+
+folly::Future<NlLinksDelta>
+NetlinkSocket::getLinksSince(int64_t seqNum) {
+  VLOG(3) << "NetlinkSocket get links since " << seqNum;
+  folly::Promise<NlLinksDelta> promise;
+  auto future = promise.getFuture();
+  evl_->runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise), seqNum]() mutable {
+        NlLinksDelta delta;
+        // not handed out by this instance, e.g. from before a restart
+        delta.isFullSync =
+            seqNum < initialLinksSeqNum_ or seqNum > linksSeqNum_;
+        if (delta.isFullSync) {
+          // events lost to overflows of the event socket only show up in a
+          // dump
+          try {
+            updateLinkCache();
+            updateAddrCache();
+          } catch (const std::exception& ex) {
+            p.setException(ex);
+            return;
+          }
+        }
+        delta.seqNum = linksSeqNum_;
+        for (const auto& kv : links_) {
+          if (delta.isFullSync or kv.second.seqNum > seqNum) {
+            delta.links.emplace(kv);
+          }
+        }
+        p.setValue(std::move(delta));
+      });
+  return future;
+}
+
 folly::Future<NlNeighbors>
 NetlinkSocket::getAllReachableNeighbors() {
   VLOG(3) << "NetlinkSocket get neighbors...";
@@ -866,12 +1291,21 @@ NetlinkSocket::getAllReachableNeighbors() {
     try {
       getAllLinks().get();
 
-      auto neighbors = nlSock_->getAllNeighbors();
-      for (auto& neighbor : neighbors) {
-        doHandleNeighborEvent(neighbor, false);
+      // listener learns of the whole dump in one update
+      NeighborUpdate neighborUpdate;
+      for (const auto& neighbor : nlSock_->getAllNeighbors()) {
+        doUpdateNeighborCache(
+            getIfName(neighbor.getIfIndex()).get(), neighbor, neighborUpdate);
       }
+      notifyNeighborListener(neighborUpdate);
 
-      p.setValue(neighbors_);
+      NlNeighbors neighbors;
+      for (const auto& [ifName, ifNeighbors] : neighbors_) {
+        for (const auto& [destination, neighbor] : ifNeighbors) {
+          neighbors.emplace(std::make_pair(ifName, destination), neighbor);
+        }
+      }
+      p.setValue(std::move(neighbors));
     } catch (const std::exception& ex) {
       p.setException(ex);
     }
@@ -881,10 +1315,10 @@ NetlinkSocket::getAllReachableNeighbors() {
 
 void
 NetlinkSocket::updateRouteCache() {
-  auto routes = nlSock_->getAllRoutes();
-  for (auto& route : routes) {
-    doHandleRouteEvent(route, false, true);
-  }
+  // routes go into the cache as the dump comes, while this thread waits
+  nlSock_->getRoutes(RouteFilter{}, [this](Route&& route) {
+    doHandleRouteEvent(std::move(route), false, true);
+  });
 }
 
 std::vector<fbnl::Route>
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <chrono>
+#include <thread>
+
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <folly/ConcurrentBitSet.h>
 #include <folly/IPAddress.h>
@@ -127,6 +130,10 @@ class NetlinkSocket {
     getRemovedNeighbor() {
       return removed_;
     }
+    bool
+    empty() const {
+      return added_.empty() and removed_.empty();
+    }
 
    private:
     std::vector<std::string> added_;
@@ -201,6 +208,29 @@ class NetlinkSocket {
    */
   virtual folly::Future<folly::Unit> delMplsRoute(Route route);
 
+  /**
+   * Add or replace kernel nexthop object of a single nexthop, with a gateway
+   * and an interface. Routes refer to nexthop objects with setNextHopId().
+   * @throws fbnl::NlException
+   */
+  virtual folly::Future<folly::Unit> addNextHop(
+      uint8_t protocolId, uint32_t id, NextHop nextHop);
+
+  /**
+   * Add or replace kernel nexthop group of nexthop objects. Routes using the
+   * group move to its new nexthops without being reprogrammed.
+   * @throws fbnl::NlException
+   */
+  virtual folly::Future<folly::Unit> addNextHopGroup(
+      uint8_t protocolId, uint32_t id, std::vector<uint32_t> nextHopIds);
+
+  /**
+   * Delete kernel nexthop objects or groups. Groups must be deleted before
+   * their nexthop objects and the kernel deletes routes still using them.
+   * @throws fbnl::NlException
+   */
+  virtual folly::Future<folly::Unit> delNextHops(std::vector<uint32_t> ids);
+
   /**
    * Sync route table in kernel with given route table
    * Delete routes that not in the 'newRouteDb' but in kernel
@@ -212,6 +242,17 @@ class NetlinkSocket {
   virtual folly::Future<folly::Unit> syncUnicastRoutes(
       uint8_t protocolId, NlUnicastRoutes newRouteDb);
 
+  /**
+   * Sync like syncUnicastRoutes, against the routes of protocolId dumped from
+   * the kernel instead of the cache, which may have drifted. The diff is
+   * computed in a single merge of both tables sorted by prefix and applied
+   * with batched netlink requests. Duplicate routes of a prefix get deleted.
+   * @return number of routes added, replaced or deleted
+   * @throws fbnl::NlException
+   */
+  virtual folly::Future<int64_t> syncUnicastRoutesWithKernel(
+      uint8_t protocolId, NlUnicastRoutes newRouteDb);
+
   /**
    * Sync MPLS label routes. Delete label routes not in 'MplsRouteDb' and
    * add the routes not present in kernel
@@ -260,11 +301,23 @@ class NetlinkSocket {
    */
   virtual folly::Future<folly::Unit> delIfAddress(fbnl::IfAddress ifAddr);
 
+  /**
+   * Add, respectively delete, interface addresses as one batch of netlink
+   * requests. Addresses present already, respectively not assigned, are left
+   * as they are
+   * @throws fbnl::NlException naming each address that failed once the
+   * others are done
+   */
+  virtual folly::Future<folly::Unit> addIfAddresses(
+      std::vector<fbnl::IfAddress> ifAddrs);
+  virtual folly::Future<folly::Unit> delIfAddresses(
+      std::vector<fbnl::IfAddress> ifAddrs);
+
   /**
    * Sync addrs on the specific iface, the iface in addrs should be the same,
    * otherwiese the method will throw fbnl::NlException.
-   * There are two steps to sync address
-   * 1. Add 'addrs' to the iface
+   * There are two steps to sync address, each a single batch
+   * 1. Add 'addrs' missing on the iface
    * 2. Delete addresses according to ifIndex, family, scope
    * 'family' and 'scope' are used to give more specific sync conditions
    * If not set, they are not considered when deleting addresses.
@@ -311,6 +364,16 @@ class NetlinkSocket {
    */
   virtual folly::Future<NlLinks> getAllLinks();
 
+  /**
+   * Get links changed after seqNum from the link cache, as kept up to date by
+   * link and address events, without a kernel dump. All links if seqNum was
+   * not handed out by this instance, e.g. 0. These full syncs refresh the
+   * cache from a kernel dump first, so they pick up events lost to socket
+   * overflows
+   * @throws fbnl::NlException
+   */
+  virtual folly::Future<NlLinksDelta> getLinksSince(int64_t seqNum);
+
   /**
    * Get all the neighbor entries
    * This can be used to obtain link addresses of nextHops
@@ -356,6 +419,16 @@ class NetlinkSocket {
 
   void doHandleNeighborEvent(Neighbor neighbor, bool runHandler) noexcept;
 
+  // update neighbor cache, recording the change in neighborUpdate. Removal
+  // of a neighbor that isn't cached is no change.
+  void doUpdateNeighborCache(
+      const std::string& ifName,
+      const Neighbor& neighbor,
+      NeighborUpdate& neighborUpdate);
+
+  // notify neighbor listener of non-empty update
+  void notifyNeighborListener(const NeighborUpdate& neighborUpdate);
+
   void doUpdateRouteCache(Route route, bool updateUnicastRoute = false);
 
   void doAddUpdateUnicastRoute(Route route);
@@ -368,16 +441,33 @@ class NetlinkSocket {
 
   void doSyncUnicastRoutes(uint8_t protocolId, NlUnicastRoutes syncDb);
 
+  // programs the difference in two batches, throws NlException naming each
+  // label that failed once the others are done
+  void doSyncMplsRoutes(uint8_t protocolId, NlMplsRoutes syncDb);
+
+  int64_t doSyncUnicastRoutesWithKernel(
+      uint8_t protocolId, NlUnicastRoutes syncDb);
+
+  // unicast routes of protocolId in the kernel, those the cache would keep
+  std::vector<Route> getKernelUnicastRoutes(uint8_t protocolId);
+
   void checkUnicastRoute(const Route& route);
 
   void doSyncIfAddress(
       int ifIndex, std::vector<fbnl::IfAddress> addrs, int family, int scope);
 
+  // program addresses as one batch, see addIfAddresses
+  void doProgramIfAddresses(
+      const std::vector<fbnl::IfAddress>& addrs, bool isAdd);
+
   void doGetIfAddrs(
       int ifIndex, int family, int scope, std::vector<fbnl::IfAddress>& addrs);
 
+  // drop neighbors of interface and notify listener of them in one update
   void removeNeighborCacheEntries(const std::string& ifName);
 
+  // bring links_ and their addresses up to date with a kernel dump, firing
+  // events of any changes
   void updateLinkCache();
 
   void updateAddrCache();
@@ -387,8 +477,13 @@ class NetlinkSocket {
   void updateRouteCache();
 
  private:
+  // links, addresses, neighbors and their events
   fbzmq::ZmqEventLoop* evl_{nullptr};
 
+  // route and nexthop programming, owns the route caches
+  mutable fbzmq::ZmqEventLoop routeEvl_;
+  std::thread routeThread_;
+
   /**
    * Local cache. We do not use this to enforce any checks
    * for incoming requests. Merely an optimization for get cached routes
@@ -406,11 +501,24 @@ class NetlinkSocket {
 
   /**
    * We keep an internal cache of Neighbor and Link entries
-   * These are used in the getAllLinks/getAllReachableNeighbors methods
+   * These are used in the getAllLinks/getAllReachableNeighbors methods.
+   * Neighbors are indexed by link name so that link down drops them without
+   * scanning the neighbors of other links.
    */
-  NlNeighbors neighbors_{};
+  std::unordered_map<std::string, NlIfNeighbors> neighbors_{};
   NlLinks links_{};
 
+  // link name by ifIndex, so that events resolve their link without a scan
+  std::unordered_map<int, std::string> ifIndexToName_{};
+
+  // sequence numbers of changes to links_ start at the creation time in
+  // microseconds, above the ones handed out before a restart
+  const int64_t initialLinksSeqNum_{
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count()};
+  int64_t linksSeqNum_{initialLinksSeqNum_};
+
   // Indicating to run which event type's handler
   folly::ConcurrentBitSet<MAX_EVENT_TYPE> eventFlags_;
 
@@ -7,6 +7,7 @@
 
 #include <set>
 
+#include <folly/hash/Hash.h>
 #include <glog/logging.h>
 
 #include <openr/nl/NetlinkTypes.h>
@@ -23,10 +24,15 @@ isNeighborReachable(int state) {
 }
 
 Route
-RouteBuilder::build() const {
+RouteBuilder::build() const& {
   return Route(*this);
 }
 
+Route
+RouteBuilder::build() && {
+  return Route(std::move(*this));
+}
+
 Route
 RouteBuilder::buildMulticastRoute() const {
   if (!routeIfIndex_.has_value() || routeIfIndex_.value() == 0 ||
@@ -217,11 +223,28 @@ RouteBuilder::addNextHop(const NextHop& nextHop) {
   return *this;
 }
 
+RouteBuilder&
+RouteBuilder::addNextHop(NextHop&& nextHop) {
+  nextHops_.emplace(std::move(nextHop));
+  return *this;
+}
+
 const NextHopSet&
 RouteBuilder::getNextHops() const {
   return nextHops_;
 }
 
+RouteBuilder&
+RouteBuilder::setNextHopId(uint32_t nextHopId) {
+  nextHopId_ = nextHopId;
+  return *this;
+}
+
+std::optional<uint32_t>
+RouteBuilder::getNextHopId() const {
+  return nextHopId_;
+}
+
 uint8_t
 RouteBuilder::getFamily() const {
   return family_;
@@ -251,6 +274,7 @@ RouteBuilder::reset() {
   mtu_.reset();
   advMss_.reset();
   nextHops_.clear();
+  nextHopId_.reset();
   routeIfName_.reset();
 }
 
@@ -269,7 +293,26 @@ Route::Route(const RouteBuilder& builder)
       nextHops_(builder.getNextHops()),
       dst_(builder.getDestination()),
       routeIfName_(builder.getRouteIfName()),
-      mplsLabel_(builder.getMplsLabel()) {}
+      mplsLabel_(builder.getMplsLabel()),
+      nextHopId_(builder.getNextHopId()) {}
+
+Route::Route(RouteBuilder&& builder)
+    : type_(builder.type_),
+      routeTable_(builder.routeTable_),
+      protocolId_(builder.protocolId_),
+      scope_(builder.scope_),
+      family_(builder.family_),
+      isValid_(builder.isValid_),
+      flags_(builder.flags_),
+      priority_(builder.priority_),
+      tos_(builder.tos_),
+      mtu_(builder.mtu_),
+      advMss_(builder.advMss_),
+      nextHops_(std::move(builder.nextHops_)),
+      dst_(builder.dst_),
+      routeIfName_(std::move(builder.routeIfName_)),
+      mplsLabel_(builder.mplsLabel_),
+      nextHopId_(builder.nextHopId_) {}
 
 Route::~Route() {}
 
@@ -297,6 +340,7 @@ Route::operator=(Route&& other) noexcept {
   routeIfName_ = std::move(other.routeIfName_);
   family_ = std::move(other.family_);
   mplsLabel_ = std::move(other.mplsLabel_);
+  nextHopId_ = std::move(other.nextHopId_);
   return *this;
 }
 
@@ -324,6 +368,7 @@ Route::operator=(const Route& other) {
   routeIfName_ = other.routeIfName_;
   family_ = other.family_;
   mplsLabel_ = other.mplsLabel_;
+  nextHopId_ = other.nextHopId_;
   return *this;
 }
 
@@ -333,6 +378,7 @@ operator==(const Route& lhs, const Route& rhs) {
       (lhs.getDestination() == rhs.getDestination() &&
        lhs.getMplsLabel() == rhs.getMplsLabel() &&
        lhs.getNextHops().size() == rhs.getNextHops().size() &&
+       lhs.getNextHopId() == rhs.getNextHopId() &&
        lhs.getType() == rhs.getType() &&
        lhs.getRouteTable() == rhs.getRouteTable() &&
        lhs.getProtocolId() == rhs.getProtocolId() &&
@@ -422,6 +468,11 @@ Route::getNextHops() const {
   return nextHops_;
 }
 
+std::optional<uint32_t>
+Route::getNextHopId() const {
+  return nextHopId_;
+}
+
 std::optional<std::string>
 Route::getRouteIfName() const {
   return routeIfName_;
@@ -468,6 +519,9 @@ Route::str() const {
   if (advMss_) {
     result += folly::sformat(", advmss {}", advMss_.value());
   }
+  if (nextHopId_) {
+    result += folly::sformat(", nhid {}", nextHopId_.value());
+  }
   for (auto const& nextHop : nextHops_) {
     result += "\n  " + nextHop.str();
   }
@@ -482,10 +536,15 @@ Route::setPriority(uint32_t priority) {
 /*=================================NextHop====================================*/
 
 NextHop
-NextHopBuilder::build() const {
+NextHopBuilder::build() const& {
   return NextHop(*this);
 }
 
+NextHop
+NextHopBuilder::build() && {
+  return NextHop(std::move(*this));
+}
+
 void
 NextHopBuilder::reset() {
   ifIndex_.reset();
@@ -533,6 +592,12 @@ NextHopBuilder::setPushLabels(const std::vector<int32_t>& pushLabels) {
   return *this;
 }
 
+NextHopBuilder&
+NextHopBuilder::setPushLabels(std::vector<int32_t>&& pushLabels) {
+  pushLabels_ = std::move(pushLabels);
+  return *this;
+}
+
 std::optional<int>
 NextHopBuilder::getIfIndex() const {
   return ifIndex_;
@@ -558,7 +623,7 @@ NextHopBuilder::getSwapLabel() const {
   return swapLabel_;
 }
 
-std::optional<std::vector<int32_t>>
+const std::optional<std::vector<int32_t>>&
 NextHopBuilder::getPushLabels() const {
   return pushLabels_;
 }
@@ -580,6 +645,15 @@ NextHop::NextHop(const NextHopBuilder& builder)
       pushLabels_(builder.getPushLabels()),
       family_(builder.getFamily()) {}
 
+NextHop::NextHop(NextHopBuilder&& builder)
+    : ifIndex_(builder.ifIndex_),
+      gateway_(builder.gateway_),
+      weight_(builder.weight_),
+      labelAction_(builder.labelAction_),
+      swapLabel_(builder.swapLabel_),
+      pushLabels_(std::move(builder.pushLabels_)),
+      family_(builder.getFamily()) {}
+
 bool
 operator==(const NextHop& lhs, const NextHop& rhs) {
   return lhs.getIfIndex() == rhs.getIfIndex() &&
@@ -593,15 +667,12 @@ operator==(const NextHop& lhs, const NextHop& rhs) {
 
 size_t
 NextHopHash::operator()(const NextHop& nh) const {
-  size_t res = 0;
-  if (nh.getIfIndex().has_value()) {
-    res += std::hash<std::string>()(std::to_string(nh.getIfIndex().value()));
-  }
-  if (nh.getGateway().has_value()) {
-    res += std::hash<std::string>()(nh.getGateway().value().str());
-  }
-  res += std::hash<std::string>()(std::to_string(nh.getWeight()));
-  return res;
+  // hash the fields as they are, formatting them allocates on every insert
+  // and lookup of the nexthop sets
+  return folly::hash::hash_combine(
+      nh.getIfIndex().value_or(0),
+      nh.getGateway().has_value() ? nh.getGateway()->hash() : 0,
+      nh.getWeight());
 }
 
 std::optional<int>
@@ -629,7 +700,7 @@ NextHop::getSwapLabel() const {
   return swapLabel_;
 }
 
-std::optional<std::vector<int32_t>>
+const std::optional<std::vector<int32_t>>&
 NextHop::getPushLabels() const {
   return pushLabels_;
 }
@@ -50,7 +50,11 @@ class NextHopBuilder final {
   NextHopBuilder() {}
   ~NextHopBuilder() {}
 
-  NextHop build() const;
+  NextHop build() const&;
+
+  // build moving the fields out, e.g. std::move(builder).build(), builder
+  // needs reset() before reuse
+  NextHop build() &&;
 
   void reset();
 
@@ -66,6 +70,8 @@ class NextHopBuilder final {
 
   NextHopBuilder& setPushLabels(const std::vector<int32_t>& pushLabels);
 
+  NextHopBuilder& setPushLabels(std::vector<int32_t>&& pushLabels);
+
   std::optional<int> getIfIndex() const;
 
   std::optional<folly::IPAddress> getGateway() const;
@@ -76,11 +82,13 @@ class NextHopBuilder final {
 
   std::optional<uint32_t> getSwapLabel() const;
 
-  std::optional<std::vector<int32_t>> getPushLabels() const;
+  const std::optional<std::vector<int32_t>>& getPushLabels() const;
 
   uint8_t getFamily() const;
 
  private:
+  friend class NextHop;
+
   std::optional<int> ifIndex_;
   std::optional<folly::IPAddress> gateway_;
   uint8_t weight_{0}; // default weight is 0
@@ -95,6 +103,8 @@ class NextHop final {
  public:
   explicit NextHop(const NextHopBuilder& builder);
 
+  explicit NextHop(NextHopBuilder&& builder);
+
   std::optional<int> getIfIndex() const;
 
   std::optional<folly::IPAddress> getGateway() const;
@@ -107,7 +117,7 @@ class NextHop final {
 
   std::optional<uint32_t> getSwapLabel() const;
 
-  std::optional<std::vector<int32_t>> getPushLabels() const;
+  const std::optional<std::vector<int32_t>>& getPushLabels() const;
 
   uint8_t getFamily() const;
 
@@ -169,7 +179,10 @@ class RouteBuilder {
    * ProtocolId, Destination, Nexthop
    * @throw fbnl::NlException on failed
    */
-  Route build() const;
+  Route build() const&;
+
+  // build moving nexthops and names out, builder needs reset() before reuse
+  Route build() &&;
 
   /**
    * Build multicast route
@@ -241,6 +254,14 @@ class RouteBuilder {
 
   RouteBuilder& addNextHop(const NextHop& nextHop);
 
+  RouteBuilder& addNextHop(NextHop&& nextHop);
+
+  // Kernel nexthop object or group of the route (RTA_NH_ID), replaces its
+  // nexthops when programming it
+  RouteBuilder& setNextHopId(uint32_t nextHopId);
+
+  std::optional<uint32_t> getNextHopId() const;
+
   RouteBuilder& setRouteIfName(const std::string& ifName);
 
   std::optional<std::string> getRouteIfName() const;
@@ -257,6 +278,8 @@ class RouteBuilder {
   void reset();
 
  private:
+  friend class Route;
+
   uint8_t type_{RTN_UNICAST};
   uint8_t routeTable_{RT_TABLE_MAIN};
   uint8_t protocolId_{DEFAULT_PROTOCOL_ID};
@@ -273,11 +296,13 @@ class RouteBuilder {
   std::optional<int> routeIfIndex_; // for multicast or link route
   std::optional<std::string> routeIfName_; // for multicast or linkroute
   std::optional<uint32_t> mplsLabel_;
+  std::optional<uint32_t> nextHopId_;
 };
 
 class Route final {
  public:
   explicit Route(const RouteBuilder& builder);
+  explicit Route(RouteBuilder&& builder);
   ~Route();
 
   // Copy+Move constructor and assignment operator
@@ -312,6 +337,8 @@ class Route final {
 
   const NextHopSet& getNextHops() const;
 
+  std::optional<uint32_t> getNextHopId() const;
+
   bool isValid() const;
 
   std::optional<std::string> getRouteIfName() const;
@@ -336,6 +363,7 @@ class Route final {
   folly::CIDRNetwork dst_;
   std::optional<std::string> routeIfName_;
   std::optional<uint32_t> mplsLabel_;
+  std::optional<uint32_t> nextHopId_;
 };
 
 bool operator==(const Route& lhs, const Route& rhs);
@@ -576,6 +604,8 @@ struct LinkAttribute final {
   bool isUp{false};
   int ifIndex{0};
   std::unordered_set<folly::CIDRNetwork> networks;
+  // of the link cache as of the last change of this link
+  int64_t seqNum{0};
 };
 
 // Route => prefix and its possible nextHops
@@ -615,7 +645,18 @@ using NlLinkRoutesDb = std::unordered_map<uint8_t, NlLinkRoutes>;
 using NlNeighbors =
     std::unordered_map<std::pair<std::string, folly::IPAddress>, Neighbor>;
 
+// reachable neighbors of one link keyed by destination IP
+using NlIfNeighbors = std::unordered_map<folly::IPAddress, Neighbor>;
+
 // keyed by link name
 using NlLinks = std::unordered_map<std::string, LinkAttribute>;
 
+// links changed after a sequence number of the link cache
+struct NlLinksDelta final {
+  int64_t seqNum{0};
+  // links holds all links rather than changed ones
+  bool isFullSync{false};
+  NlLinks links;
+};
+
 } // namespace openr::fbnl
@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openr/nl/NetlinkProtocolSocket.h>
+
+namespace openr::fbnl {
+
+/**
+ * Peer of NetlinkProtocolSocket at the other end of a socketpair. It acks
+ * every request right away, the way the kernel acks a successful one, without
+ * programming anything. Acks of a request datagram are packed into datagrams
+ * of at most kNlRecvBufferSize. Requests of dropSeqs never get acked, as if
+ * they got stuck in the kernel.
+ */
+class FakeNetlinkKernel {
+ public:
+  explicit FakeNetlinkKernel(
+      int fd, std::unordered_set<uint32_t> dropSeqs = {})
+      : fd_(fd), dropSeqs_(std::move(dropSeqs)), thread_([this]() { run(); }) {}
+
+  ~FakeNetlinkKernel() {
+    ::shutdown(fd_, SHUT_RDWR);
+    thread_.join();
+    ::close(fd_);
+  }
+
+ private:
+  void
+  run() {
+    std::vector<char> request(kMaxNlSendBytes);
+    std::vector<char> reply(kNlRecvBufferSize);
+    constexpr size_t kAckLen = NLMSG_SPACE(sizeof(struct nlmsgerr));
+    while (true) {
+      const auto len = ::recv(fd_, request.data(), request.size(), 0);
+      if (len <= 0) {
+        return;
+      }
+      uint32_t remaining = len;
+      size_t replyLen{0};
+      for (auto* nlh = reinterpret_cast<struct nlmsghdr*>(request.data());
+           NLMSG_OK(nlh, remaining);
+           nlh = NLMSG_NEXT(nlh, remaining)) {
+        if (dropSeqs_.count(nlh->nlmsg_seq)) {
+          continue;
+        }
+        if (replyLen + kAckLen > reply.size()) {
+          ::send(fd_, reply.data(), replyLen, 0);
+          replyLen = 0;
+        }
+        auto* ackHdr = reinterpret_cast<struct nlmsghdr*>(&reply[replyLen]);
+        ackHdr->nlmsg_len = NLMSG_LENGTH(sizeof(struct nlmsgerr));
+        ackHdr->nlmsg_type = NLMSG_ERROR;
+        ackHdr->nlmsg_flags = 0;
+        ackHdr->nlmsg_seq = nlh->nlmsg_seq;
+        ackHdr->nlmsg_pid = nlh->nlmsg_pid;
+        auto* ack = reinterpret_cast<struct nlmsgerr*>(NLMSG_DATA(ackHdr));
+        ack->error = 0;
+        ack->msg = *nlh;
+        replyLen += kAckLen;
+      }
+      if (replyLen) {
+        ::send(fd_, reply.data(), replyLen, 0);
+      }
+    }
+  }
+
+  const int fd_{-1};
+  // sequence numbers of requests not to ack
+  const std::unordered_set<uint32_t> dropSeqs_;
+  std::thread thread_;
+};
+
+} // namespace openr::fbnl
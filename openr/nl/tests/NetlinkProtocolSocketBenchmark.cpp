@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include <fbzmq/async/ZmqEventLoop.h>
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <folly/init/Init.h>
+
+#include <openr/nl/NetlinkProtocolSocket.h>
+#include <openr/nl/tests/FakeNetlinkKernel.h>
+#include <openr/tests/BenchmarkUtils.h>
+
+namespace {
+
+const uint8_t kRouteProtoId{99};
+const int kIfIndex{1};
+const folly::IPAddress kGateway("fe80::1");
+const uint32_t kFirstLabel{16};
+
+} // namespace
+
+namespace openr::fbnl {
+
+std::vector<Route>
+buildUnicastRoutes(unsigned numRoutes) {
+  std::vector<Route> routes;
+  routes.reserve(numRoutes);
+  for (unsigned i = 0; i < numRoutes; ++i) {
+    NextHopBuilder nhBuilder;
+    nhBuilder.setGateway(kGateway).setIfIndex(kIfIndex);
+    RouteBuilder rtBuilder;
+    rtBuilder.setProtocolId(kRouteProtoId)
+        .setDestination(folly::IPAddress::createNetwork(
+            folly::sformat("fc00:{:x}:{:x}::/64", i >> 16, i & 0xffff)))
+        .addNextHop(nhBuilder.build());
+    routes.emplace_back(rtBuilder.build());
+  }
+  return routes;
+}
+
+std::vector<Route>
+buildMplsRoutes(unsigned numRoutes) {
+  std::vector<Route> routes;
+  routes.reserve(numRoutes);
+  for (unsigned i = 0; i < numRoutes; ++i) {
+    NextHopBuilder nhBuilder;
+    nhBuilder.setGateway(kGateway)
+        .setIfIndex(kIfIndex)
+        .setLabelAction(thrift::MplsActionCode::SWAP)
+        .setSwapLabel(kFirstLabel + i);
+    RouteBuilder rtBuilder;
+    rtBuilder.setProtocolId(kRouteProtoId)
+        .setMplsLabel(kFirstLabel + i)
+        .addNextHop(nhBuilder.build());
+    routes.emplace_back(rtBuilder.build());
+  }
+  return routes;
+}
+
+/**
+ * Benchmark of the netlink route programming path without a kernel
+ * 1. Connect a NetlinkProtocolSocket to a FakeNetlinkKernel
+ * 2. Generate unicast or MPLS routes
+ * 3. Add routes, i.e. encode, send in batches and process the acks
+ * Allocations of all threads while adding routes are reported per route.
+ */
+static void
+BM_AddRoutes(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    unsigned numRoutes,
+    bool isMpls) {
+  auto suspender = folly::BenchmarkSuspender();
+  int fds[2];
+  CHECK_EQ(0, ::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, fds));
+  FakeNetlinkKernel kernel(fds[1]);
+
+  fbzmq::ZmqEventLoop evl;
+  NetlinkProtocolSocket nlSock(&evl);
+  std::thread evlThread([&]() {
+    nlSock.init(fds[0]);
+    evl.run();
+  });
+  evl.waitUntilRunning();
+
+  const auto routes =
+      isMpls ? buildMplsRoutes(numRoutes) : buildUnicastRoutes(numRoutes);
+  uint64_t allocs{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    const auto allocsBefore = getNumHeapAllocs();
+    suspender.dismiss(); // Start measuring benchmark time
+    CHECK_EQ(0, nlSock.addRoutes(routes));
+    suspender.rehire(); // Stop measuring time again
+    allocs += getNumHeapAllocs() - allocsBefore;
+  }
+  counters["allocs_per_route"] = allocs / (iters * numRoutes);
+
+  evl.stop();
+  evl.waitUntilStopped();
+  evlThread.join();
+}
+
+// The parameters are the number of routes and whether they are MPLS routes
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_AddRoutes, counters, unicast_10000, 10000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_AddRoutes, counters, unicast_100000, 100000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_AddRoutes, counters, unicast_1000000, 1000000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_AddRoutes, counters, unicast_2000000, 2000000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_AddRoutes, counters, mpls_10000, 10000, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_AddRoutes, counters, mpls_100000, 100000, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_AddRoutes, counters, mpls_1000000, 1000000, true);
+
+} // namespace openr::fbnl
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -5,6 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -27,6 +29,7 @@
 
 #include <openr/if/gen-cpp2/Network_types.h>
 #include <openr/nl/NetlinkProtocolSocket.h>
+#include <openr/nl/tests/FakeNetlinkKernel.h>
 
 extern "C" {
 #include <linux/rtnetlink.h>
@@ -512,6 +515,32 @@ TEST_F(NlMessageFixture, EncodeLabel) {
   }
 }
 
+TEST_F(NlMessageFixture, ShrinkToFit) {
+  std::vector<openr::fbnl::NextHop> paths;
+  paths.push_back(buildNextHop(
+      folly::none, folly::none, folly::none, ipAddrY1V6, ifIndexZ));
+  auto route = buildRoute(kRouteProtoId, ipPrefix1, folly::none, paths);
+
+  NetlinkRouteMessage rt{};
+  ASSERT_EQ(0, rt.addRoute(route));
+  const auto len = rt.getDataLength();
+  std::vector<char> before(len);
+  memcpy(before.data(), rt.getMessagePtr(), len);
+
+  // same message in a buffer of its length
+  rt.shrinkToFit();
+  EXPECT_EQ(len, rt.getDataLength());
+  EXPECT_EQ(0, memcmp(before.data(), rt.getMessagePtr(), len));
+
+  // recycled build buffers come back zeroed
+  NetlinkRouteMessage other{};
+  auto const* data = reinterpret_cast<const char*>(other.getMessagePtr());
+  EXPECT_TRUE(std::all_of(
+      data, data + openr::fbnl::kMaxNlPayloadSize, [](char c) {
+        return c == 0;
+      }));
+}
+
 TEST_F(NlMessageFixture, IpRouteSingleNextHop) {
   // Add IPv6 route with one next hop and no labels
   // outoing IF is vethTestY
@@ -545,6 +574,44 @@ TEST_F(NlMessageFixture, IpRouteSingleNextHop) {
   EXPECT_FALSE(checkRouteInKernelRoutes(kernelRoutes, route));
 }
 
+TEST_F(NlMessageFixture, GetRoutesFiltered) {
+  std::vector<openr::fbnl::NextHop> paths;
+  paths.push_back(buildNextHop(
+      folly::none, folly::none, folly::none, ipAddrY1V6, ifIndexZ));
+  auto route = buildRoute(kRouteProtoId, ipPrefix1, folly::none, paths);
+  EXPECT_EQ(0, nlSock->addRoute(route));
+
+  // routes of our protocol only, handed over while the dump is received
+  std::vector<fbnl::Route> kernelRoutes;
+  openr::fbnl::RouteFilter filter;
+  filter.protocolId = kRouteProtoId;
+  auto routeCb = [&kernelRoutes](fbnl::Route&& kernelRoute) {
+    kernelRoutes.emplace_back(std::move(kernelRoute));
+  };
+  EXPECT_EQ(0, nlSock->getRoutes(filter, routeCb));
+  EXPECT_TRUE(checkRouteInKernelRoutes(kernelRoutes, route));
+  for (auto const& kernelRoute : kernelRoutes) {
+    EXPECT_EQ(kRouteProtoId, kernelRoute.getProtocolId());
+  }
+
+  // of the main table as well, dumped per family
+  kernelRoutes.clear();
+  filter.routeTable = RT_TABLE_MAIN;
+  EXPECT_EQ(0, nlSock->getRoutes(filter, routeCb));
+  EXPECT_TRUE(checkRouteInKernelRoutes(kernelRoutes, route));
+  for (auto const& kernelRoute : kernelRoutes) {
+    EXPECT_EQ(kRouteProtoId, kernelRoute.getProtocolId());
+  }
+
+  // no route matches
+  kernelRoutes.clear();
+  filter.family = AF_INET;
+  EXPECT_EQ(0, nlSock->getRoutes(filter, routeCb));
+  EXPECT_FALSE(checkRouteInKernelRoutes(kernelRoutes, route));
+
+  EXPECT_EQ(0, nlSock->deleteRoute(route));
+}
+
 TEST_F(NlMessageFixture, IpRouteMultipleNextHops) {
   // Add IPv6 route with 4 next hops and no labels
   // outoing IF is vethTestY
@@ -587,6 +654,71 @@ TEST_F(NlMessageFixture, IpRouteMultipleNextHops) {
   EXPECT_FALSE(checkRouteInKernelRoutes(kernelRoutes, route));
 }
 
+TEST_F(NlMessageFixture, IpRouteNextHopGroup) {
+  // Add IPv6 route using a nexthop group of two nexthop objects
+  // outoing IF is vethTestY
+
+  const uint32_t nhId1{1001}, nhId2{1002}, groupId{1003};
+  EXPECT_EQ(
+      0,
+      nlSock->addNextHop(
+          nhId1,
+          buildNextHop(
+              folly::none, folly::none, folly::none, ipAddrY1V6, ifIndexY),
+          kRouteProtoId));
+  EXPECT_EQ(
+      0,
+      nlSock->addNextHop(
+          nhId2,
+          buildNextHop(
+              folly::none, folly::none, folly::none, ipAddrY2V6, ifIndexY),
+          kRouteProtoId));
+  EXPECT_EQ(
+      0, nlSock->addNextHopGroup(groupId, {nhId1, nhId2}, kRouteProtoId));
+
+  // nexthop objects can't carry labels
+  EXPECT_NE(
+      0,
+      nlSock->addNextHop(
+          1004,
+          buildNextHop(
+              outLabel1,
+              folly::none,
+              thrift::MplsActionCode::PUSH,
+              ipAddrY3V6,
+              ifIndexY),
+          kRouteProtoId));
+
+  fbnl::RouteBuilder rtBuilder;
+  auto route = rtBuilder.setDestination(ipPrefix1)
+                   .setProtocolId(kRouteProtoId)
+                   .setPriority(kAqRouteProtoIdPriority)
+                   .setNextHopId(groupId)
+                   .setFlags(0)
+                   .setValid(true)
+                   .build();
+  EXPECT_EQ(0, nlSock->addRoute(route));
+
+  // group gets replaced, the route moves along with it
+  EXPECT_EQ(0, nlSock->addNextHopGroup(groupId, {nhId1}, kRouteProtoId));
+
+  auto kernelRoutes = nlSock->getAllRoutes();
+  bool found{false};
+  for (auto const& kernelRoute : kernelRoutes) {
+    if (kernelRoute.getFamily() != AF_MPLS and
+        kernelRoute.getDestination() == ipPrefix1) {
+      found = true;
+      EXPECT_EQ(groupId, kernelRoute.getNextHopId());
+    }
+  }
+  EXPECT_TRUE(found);
+
+  EXPECT_EQ(0, nlSock->deleteRoute(route));
+  // groups before their nexthop objects
+  EXPECT_EQ(0, nlSock->deleteNextHops({groupId, nhId1, nhId2}));
+  EXPECT_EQ(0, getErrorCount());
+}
+
 TEST_F(NlMessageFixture, IPv4RouteSingleNextHop) {
   // Add IPv4 route with one next hop and no labels
   // outoing IF is vethTestY
@@ -1326,6 +1458,91 @@ TEST_F(NlMessageFixture, MultipleLabelRoutes) {
   EXPECT_EQ(findRoutesInKernelRoutes(kernelRoutes, labelRoutes), 0);
 }
 
+TEST_F(NlMessageFixture, LabelRoutesPerLabelStatus) {
+  // Add label routes as one batch, one of them through an invalid outgoing
+  // I/F. Only that label fails, the others get programmed.
+  std::vector<openr::fbnl::NextHop> paths;
+  paths.push_back(buildNextHop(
+      folly::none,
+      swapLabel,
+      thrift::MplsActionCode::SWAP,
+      ipAddrY1V6,
+      ifIndexZ));
+  std::vector<openr::fbnl::NextHop> invalidPaths;
+  uint32_t invalidIfindex = 1000;
+  invalidPaths.push_back(buildNextHop(
+      folly::none,
+      swapLabel,
+      thrift::MplsActionCode::SWAP,
+      ipAddrY1V6,
+      invalidIfindex));
+  std::vector<openr::fbnl::Route> labelRoutes;
+  labelRoutes.push_back(buildRoute(kRouteProtoId, folly::none, 700, paths));
+  labelRoutes.push_back(
+      buildRoute(kRouteProtoId, folly::none, 701, invalidPaths));
+  labelRoutes.push_back(buildRoute(kRouteProtoId, folly::none, 702, paths));
+
+  auto statuses =
+      nlSock->addLabelRoutes(labelRoutes).get(fbnl::kNlRequestTimeout);
+  EXPECT_EQ((std::vector<int>{0, ENODEV, 0}), statuses);
+  auto kernelRoutes = nlSock->getAllRoutes();
+  EXPECT_EQ(findRoutesInKernelRoutes(kernelRoutes, labelRoutes), 2);
+
+  // deleting a label route not in kernel is no error
+  statuses =
+      nlSock->deleteLabelRoutes(labelRoutes).get(fbnl::kNlRequestTimeout);
+  EXPECT_EQ((std::vector<int>{0, 0, 0}), statuses);
+  kernelRoutes = nlSock->getAllRoutes();
+  EXPECT_EQ(findRoutesInKernelRoutes(kernelRoutes, labelRoutes), 0);
+}
+
+TEST_F(NlMessageFixture, IfAddressesPerAddressStatus) {
+  // Add addresses as one batch, one of them on an invalid I/F and one
+  // without address. Only those fail, the others get assigned.
+  auto buildIfAddress = [](std::string const& addr, uint32_t ifIndex) {
+    openr::fbnl::IfAddressBuilder builder;
+    return builder.setPrefix(folly::IPAddress::createNetwork(addr))
+        .setIfIndex(ifIndex)
+        .setScope(RT_SCOPE_UNIVERSE)
+        .setValid(true)
+        .build();
+  };
+  uint32_t invalidIfindex = 1000;
+  openr::fbnl::IfAddressBuilder builder;
+  const auto noAddr =
+      builder.setFamily(AF_INET6).setIfIndex(ifIndexX).setValid(true).build();
+  const std::vector<fbnl::IfAddress> validAddrs{
+      buildIfAddress("face:d00d::1/128", ifIndexX),
+      buildIfAddress("10.0.0.1/32", ifIndexX)};
+  const std::vector<fbnl::IfAddress> ifAddrs{
+      validAddrs.at(0),
+      buildIfAddress("face:d00d::2/128", invalidIfindex),
+      noAddr,
+      validAddrs.at(1)};
+
+  auto statuses = nlSock->addIfAddresses(ifAddrs).get(fbnl::kNlRequestTimeout);
+  EXPECT_EQ((std::vector<int>{0, ENODEV, EDESTADDRREQ, 0}), statuses);
+  auto kernelAddresses = nlSock->getAllIfAddresses();
+  EXPECT_EQ(2, findAddressesInKernelAddresses(kernelAddresses, validAddrs));
+
+  // adding addresses already assigned is no error
+  statuses = nlSock->addIfAddresses(validAddrs).get(fbnl::kNlRequestTimeout);
+  EXPECT_EQ((std::vector<int>{0, 0}), statuses);
+
+  // delete with one failing, the others still get deleted
+  statuses =
+      nlSock->deleteIfAddresses({validAddrs.at(0), noAddr, validAddrs.at(1)})
+          .get(fbnl::kNlRequestTimeout);
+  EXPECT_EQ((std::vector<int>{0, EDESTADDRREQ, 0}), statuses);
+  kernelAddresses = nlSock->getAllIfAddresses();
+  EXPECT_EQ(0, findAddressesInKernelAddresses(kernelAddresses, validAddrs));
+
+  // deleting addresses not assigned is no error
+  statuses =
+      nlSock->deleteIfAddresses(validAddrs).get(fbnl::kNlRequestTimeout);
+  EXPECT_EQ((std::vector<int>{0, 0}), statuses);
+}
+
 // Add and remove 250 IPv4 and IPv6 addresses (total 500)
 TEST_F(NlMessageFixture, AddrScaleTest) {
   const int addrCount{250};
@@ -1534,6 +1751,113 @@ TEST_F(NlMessageFixture, GetAllNeighborsV4) {
   EXPECT_EQ(testNeighbors, 0);
 }
 
+/**
+ * NetlinkProtocolSocket connected to a FakeNetlinkKernel, which acks all
+ * requests but the ones of given sequence numbers. Needs no privileges.
+ */
+class FakeKernelFixture : public ::testing::Test {
+ public:
+  void
+  TearDown() override {
+    if (nlSock) {
+      evl.stop();
+      eventThread.join();
+      nlSock.reset();
+    }
+    kernel.reset();
+  }
+
+  void
+  start(
+      std::unordered_set<uint32_t> dropSeqs,
+      size_t minIovMsg = fbnl::kMinIovMsg,
+      size_t maxIovMsg = fbnl::kMaxIovMsg) {
+    int fds[2];
+    ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, fds));
+    kernel = std::make_unique<fbnl::FakeNetlinkKernel>(
+        fds[1], std::move(dropSeqs));
+    nlSock =
+        std::make_unique<NetlinkProtocolSocket>(&evl, minIovMsg, maxIovMsg);
+    eventThread = std::thread([this, fd = fds[0]]() {
+      nlSock->init(fd);
+      evl.run();
+    });
+    evl.waitUntilRunning();
+  }
+
+  static std::vector<openr::fbnl::Route>
+  buildLabelRoutes(uint32_t firstLabel, uint32_t count) {
+    std::vector<openr::fbnl::Route> routes;
+    for (uint32_t label = firstLabel; label < firstLabel + count; ++label) {
+      fbnl::NextHopBuilder nhBuilder;
+      nhBuilder.setGateway(ipAddrY1V6)
+          .setIfIndex(1)
+          .setLabelAction(thrift::MplsActionCode::SWAP)
+          .setSwapLabel(label);
+      fbnl::RouteBuilder rtBuilder;
+      rtBuilder.setProtocolId(kRouteProtoId)
+          .setMplsLabel(label)
+          .addNextHop(nhBuilder.build());
+      routes.emplace_back(rtBuilder.build());
+    }
+    return routes;
+  }
+
+  fbzmq::ZmqEventLoop evl;
+  std::thread eventThread;
+  std::unique_ptr<fbnl::FakeNetlinkKernel> kernel;
+  std::unique_ptr<NetlinkProtocolSocket> nlSock;
+};
+
+// A request that never gets acked times out after kNlRequestAckTimeout, even
+// while other requests keep getting acked
+TEST_F(FakeKernelFixture, AckTimeoutOfStuckRequest) {
+  // first request bears sequence number 1
+  start({1});
+  auto stuck = nlSock->addLabelRoutes(buildLabelRoutes(16, 1));
+
+  std::atomic<bool> stop{false};
+  std::thread progress([&]() {
+    uint32_t label = 17;
+    while (not stop) {
+      EXPECT_EQ(
+          std::vector<int>{0},
+          nlSock->addLabelRoutes(buildLabelRoutes(label++, 1))
+              .get(fbnl::kNlRequestTimeout));
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  });
+
+  std::vector<int> statuses;
+  EXPECT_NO_THROW(
+      statuses = std::move(stuck).get(3 * fbnl::kNlRequestAckTimeout));
+  stop = true;
+  progress.join();
+  EXPECT_EQ(std::vector<int>{ETIME}, statuses);
+}
+
+// Sequence numbers wrap around the ring of in-flight requests onto the slot
+// of a request still in flight. Sending waits for the slot to get freed, and
+// acks of the new sequence number don't resolve the old request.
+TEST_F(FakeKernelFixture, SequenceWrapOntoPendingRequest) {
+  // window of 2 messages, ring of 8 slots. Sequence number 9 gets the slot
+  // of the stuck request 1
+  start({1}, 2, 2);
+  auto stuck = nlSock->addLabelRoutes(buildLabelRoutes(16, 1));
+
+  const auto startTime = std::chrono::steady_clock::now();
+  EXPECT_EQ(
+      std::vector<int>(10, 0),
+      nlSock->addLabelRoutes(buildLabelRoutes(17, 10))
+          .get(fbnl::kNlRequestTimeout));
+  // messages after the wrap waited for the timeout of the stuck request
+  EXPECT_GE(
+      std::chrono::steady_clock::now() - startTime,
+      fbnl::kNlRequestAckTimeout);
+  EXPECT_EQ(std::vector<int>{ETIME}, std::move(stuck).get());
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
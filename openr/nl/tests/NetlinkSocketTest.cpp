@@ -641,6 +641,97 @@ class NetlinkSocketFixture : public testing::Test {
     routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
     EXPECT_EQ(0, routes.size());
   }
+
+  void
+  doSyncRouteWithKernelTest(bool isV4) {
+    folly::CIDRNetwork prefix1 = isV4
+        ? std::make_pair(folly::IPAddress("192.168.0.11"), 32)
+        : std::make_pair(folly::IPAddress("fc00:cafe:3::"), 64);
+    folly::CIDRNetwork prefix2 = isV4
+        ? std::make_pair(folly::IPAddress("192.168.0.12"), 32)
+        : std::make_pair(folly::IPAddress("fc00:cafe:4::"), 64);
+    folly::CIDRNetwork prefix3 = isV4
+        ? std::make_pair(folly::IPAddress("192.168.0.13"), 32)
+        : std::make_pair(folly::IPAddress("fc00:cafe:5::"), 64);
+    std::vector<folly::IPAddress> nexthops1;
+    std::vector<folly::IPAddress> nexthops2;
+    if (isV4) {
+      nexthops1.emplace_back(folly::IPAddress("169.254.0.1"));
+      nexthops1.emplace_back(folly::IPAddress("169.254.0.2"));
+      nexthops2.emplace_back(folly::IPAddress("169.254.0.3"));
+    } else {
+      nexthops1.emplace_back(folly::IPAddress("fe80::1"));
+      nexthops1.emplace_back(folly::IPAddress("fe80::2"));
+      nexthops2.emplace_back(folly::IPAddress("fe80::3"));
+    }
+    int ifIndex = netlinkSocket->getIfIndex(kVethNameY).get();
+    auto getRouteDb = [&](std::vector<folly::CIDRNetwork> const& prefixes,
+                          std::vector<folly::IPAddress> const& nexthops) {
+      NlUnicastRoutes routeDb;
+      for (auto const& prefix : prefixes) {
+        routeDb.emplace(
+            prefix, buildRoute(ifIndex, kAqRouteProtoId, nexthops, prefix));
+      }
+      return routeDb;
+    };
+    auto getKernelRoutes = [&]() {
+      std::map<folly::CIDRNetwork, size_t> numNextHops;
+      for (const auto& r : netlinkSocket->getAllRoutes()) {
+        if (r.getProtocolId() == kAqRouteProtoId) {
+          numNextHops[r.getDestination()] = r.getNextHops().size();
+        }
+      }
+      return numNextHops;
+    };
+
+    // added behind the back of the cache, e.g. by a previous run
+    netlinkSocket
+        ->addRoute(buildRoute(ifIndex, kAqRouteProtoId, nexthops1, prefix3))
+        .get();
+
+    EXPECT_EQ(
+        3,
+        netlinkSocket
+            ->syncUnicastRoutesWithKernel(
+                kAqRouteProtoId, getRouteDb({prefix1, prefix2}, nexthops1))
+            .get());
+    EXPECT_EQ(
+        (std::map<folly::CIDRNetwork, size_t>{{prefix1, 2}, {prefix2, 2}}),
+        getKernelRoutes());
+    EXPECT_EQ(
+        2, netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get().size());
+
+    // unchanged routes are left alone
+    EXPECT_EQ(
+        0,
+        netlinkSocket
+            ->syncUnicastRoutesWithKernel(
+                kAqRouteProtoId, getRouteDb({prefix1, prefix2}, nexthops1))
+            .get());
+
+    // Change nexthops of both, remove one of them
+    EXPECT_EQ(
+        2,
+        netlinkSocket
+            ->syncUnicastRoutesWithKernel(
+                kAqRouteProtoId, getRouteDb({prefix1}, nexthops2))
+            .get());
+    EXPECT_EQ(
+        (std::map<folly::CIDRNetwork, size_t>{{prefix1, 1}}),
+        getKernelRoutes());
+    auto routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
+    ASSERT_EQ(1, routes.count(prefix1));
+    EXPECT_TRUE(CompareNextHops(nexthops2, routes.at(prefix1)));
+
+    EXPECT_EQ(
+        1,
+        netlinkSocket
+            ->syncUnicastRoutesWithKernel(kAqRouteProtoId, NlUnicastRoutes{})
+            .get());
+    EXPECT_TRUE(getKernelRoutes().empty());
+    EXPECT_EQ(
+        0, netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get().size());
+  }
 };
 
 TEST_F(NetlinkSocketFixture, EmptyRouteTest) {
@@ -857,6 +948,15 @@ TEST_F(NetlinkSocketFixture, SyncRouteTestV4) {
   doSyncRouteTest(true);
 }
 
+// Sync against routes dumped from the kernel, which the cache may miss
+TEST_F(NetlinkSocketFixture, SyncRouteWithKernelTest) {
+  doSyncRouteWithKernelTest(false);
+}
+
+TEST_F(NetlinkSocketFixture, SyncRouteWithKernelTestV4) {
+  doSyncRouteWithKernelTest(true);
+}
+
 // - Add a unicast route with 2 paths (nextHops)
 // - verify it is added
 // - Add another unicast route with 2 paths (nextHops)
@@ -1714,6 +1814,38 @@ TEST_F(NetlinkSocketFixture, AddDelIfAddressBaseTest) {
   EXPECT_FALSE(found);
 }
 
+TEST_F(NetlinkSocketFixture, GetLinksSinceTest) {
+  // sequence number not handed out, all links
+  auto delta = netlinkSocket->getLinksSince(0).get();
+  EXPECT_TRUE(delta.isFullSync);
+  EXPECT_EQ(1, delta.links.count(kVethNameX));
+  EXPECT_EQ(1, delta.links.count(kVethNameY));
+  const auto seqNum = delta.seqNum;
+
+  // link of the new address changed
+  folly::CIDRNetwork prefixV6{folly::IPAddress("fc00:cafe:3::3"), 128};
+  int ifIndex = netlinkSocket->getIfIndex(kVethNameX).get();
+  IfAddressBuilder builder;
+  netlinkSocket
+      ->addIfAddress(builder.setPrefix(prefixV6).setIfIndex(ifIndex).build())
+      .get();
+  // catch up on the address without waiting for its event
+  netlinkSocket->getAllLinks().get();
+  delta = netlinkSocket->getLinksSince(seqNum).get();
+  EXPECT_FALSE(delta.isFullSync);
+  EXPECT_LT(seqNum, delta.seqNum);
+  ASSERT_EQ(1, delta.links.count(kVethNameX));
+  EXPECT_EQ(1, delta.links.at(kVethNameX).networks.count(prefixV6));
+
+  // sequence number ahead of the cache, e.g. of another instance
+  EXPECT_TRUE(netlinkSocket->getLinksSince(delta.seqNum + 1).get().isFullSync);
+
+  builder.reset();
+  netlinkSocket
+      ->delIfAddress(builder.setPrefix(prefixV6).setIfIndex(ifIndex).build())
+      .get();
+}
+
 TEST_F(NetlinkSocketFixture, AddDelDuplicatedIfAddressTest) {
   folly::CIDRNetwork prefix{folly::IPAddress("fc00:cafe:3::3"), 128};
   IfAddressBuilder builder;
@@ -199,6 +199,38 @@ TEST(NetlinkTypes, NextHopBuilderReset) {
   EXPECT_FALSE(nhBuilder.getPushLabels().has_value());
 }
 
+TEST(NetlinkTypes, BuildFromMovedBuilder) {
+  folly::CIDRNetwork dst{folly::IPAddress("fc00:cafe:3::3"), 128};
+  NextHopBuilder nhBuilder;
+  nhBuilder.setIfIndex(kIfIndex)
+      .setGateway(folly::IPAddress("face:cafe:3::3"))
+      .setLabelAction(thrift::MplsActionCode::PUSH)
+      .setPushLabels({30, 40});
+  const auto nh1 = nhBuilder.build();
+  const auto nh2 = std::move(nhBuilder).build();
+  EXPECT_EQ(nh1, nh2);
+  EXPECT_EQ(std::vector<int32_t>({30, 40}), nh2.getPushLabels().value());
+
+  RouteBuilder builder;
+  builder.setDestination(dst)
+      .setProtocolId(kProtocolId)
+      .setRouteIfName("eth0")
+      .setValid(true)
+      .addNextHop(nh1);
+  const auto route1 = builder.build();
+  auto nh3 = nh2;
+  const auto route2 = std::move(builder.addNextHop(std::move(nh3))).build();
+  EXPECT_TRUE(route1 == route2);
+  EXPECT_EQ(1, route2.getNextHops().size());
+  EXPECT_EQ("eth0", route2.getRouteIfName().value());
+  EXPECT_TRUE(route2.isValid());
+
+  // moved out builder is reusable after reset
+  builder.reset();
+  EXPECT_TRUE(builder.getNextHops().empty());
+  EXPECT_FALSE(builder.getRouteIfName().has_value());
+}
+
 TEST(NetlinkTypes, RouteMoveTest) {
   folly::CIDRNetwork dst{folly::IPAddress("fc00:cafe:3::3"), 128};
   folly::IPAddress gateway("face:cafe:3::3");
@@ -346,6 +378,14 @@ TEST(NetlinkTypes, RouteOptionalParamTest) {
   EXPECT_EQ(3, route.getNextHops().size());
   EXPECT_EQ(dst, route.getDestination());
   EXPECT_EQ(RTN_UNICAST, route.getType());
+  EXPECT_FALSE(route.getNextHopId().has_value());
+
+  // route using a kernel nexthop object
+  auto nhIdRoute = rtbuilder.setNextHopId(7).build();
+  EXPECT_EQ(7, nhIdRoute.getNextHopId());
+  EXPECT_FALSE(route == nhIdRoute);
+  rtbuilder.reset();
+  EXPECT_FALSE(rtbuilder.getNextHopId().has_value());
 }
 
 TEST(NetlinkTypes, IfAddressMoveTest) {
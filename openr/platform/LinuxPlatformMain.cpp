@@ -30,6 +30,20 @@ DEFINE_bool(
     enable_netlink_fib_handler,
     true,
     "If set, netlink fib handler will be started for route programming.");
+DEFINE_bool(
+    enable_netlink_nexthop_objects,
+    false,
+    "Back next-hop groups of the netlink fib handler with kernel nexthop "
+    "objects. Requires Linux 5.3 or newer");
+DEFINE_int32(
+    netlink_min_iov_msg,
+    50,
+    "Smallest window of netlink messages in flight to the kernel. The window "
+    "grows while acks come back fast and shrinks on ENOBUFS or timeouts");
+DEFINE_int32(
+    netlink_max_iov_msg,
+    2000,
+    "Largest window of netlink messages in flight to the kernel");
 DEFINE_bool(
     enable_netlink_system_handler,
     true,
@@ -56,7 +70,9 @@ main(int argc, char** argv) {
   auto nlProtocolSocketEventLoop = std::make_unique<fbzmq::ZmqEventLoop>();
   std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlProtocolSocket;
   nlProtocolSocket = std::make_unique<openr::fbnl::NetlinkProtocolSocket>(
-      nlProtocolSocketEventLoop.get());
+      nlProtocolSocketEventLoop.get(),
+      FLAGS_netlink_min_iov_msg,
+      FLAGS_netlink_max_iov_msg);
   allThreads.emplace_back(
       std::thread([&nlProtocolSocket, &nlProtocolSocketEventLoop]() {
         LOG(INFO) << "Starting NetlinkProtolSocketEvl thread...";
@@ -67,11 +83,15 @@ main(int argc, char** argv) {
       }));
   nlProtocolSocketEventLoop->waitUntilRunning();
 
-  // Create event publisher to handle event subscription
+  auto nlEventLoop = std::make_unique<fbzmq::ZmqEventLoop>();
+
+  // Create event publisher to handle event subscription, coalescing events in
+  // the event loop of NetlinkSocket
   auto eventPublisher = std::make_unique<openr::PlatformPublisher>(
-      context, openr::PlatformPublisherUrl{FLAGS_platform_pub_url});
+      context,
+      openr::PlatformPublisherUrl{FLAGS_platform_pub_url},
+      nlEventLoop.get());
 
-  auto nlEventLoop = std::make_unique<fbzmq::ZmqEventLoop>();
   auto nlSocket = std::make_shared<openr::fbnl::NetlinkSocket>(
       nlEventLoop.get(), eventPublisher.get(), std::move(nlProtocolSocket));
 
@@ -111,7 +131,8 @@ main(int argc, char** argv) {
   if (FLAGS_enable_netlink_fib_handler) {
     // start FibService thread
     auto fibHandler =
-        std::make_shared<NetlinkFibHandler>(&mainEventLoop, nlSocket);
+        std::make_shared<NetlinkFibHandler>(
+            &mainEventLoop, nlSocket, FLAGS_enable_netlink_nexthop_objects);
 
     auto fibThriftThread = std::thread([fibHandler, &linuxFibAgentServer]() {
       folly::setThreadName("FibService");
@@ -34,6 +34,22 @@ const std::chrono::seconds kSyncStaticRouteTimeout{30};
 const uint8_t kMinRouteProtocolId = 17;
 const uint8_t kMaxRouteProtocolId = 253;
 
+// fail promise of batch route update with the routes that failed, if any
+void
+setFibUpdateResult(
+    folly::Promise<folly::Unit>& promise,
+    thrift::PlatformFibUpdateError&& fibError) {
+  if (fibError.failedPrefixes.empty() and fibError.failedMplsLabels.empty()) {
+    promise.setValue();
+    return;
+  }
+  const auto numFailed =
+      fibError.failedPrefixes.size() + fibError.failedMplsLabels.size();
+  LOG(ERROR) << "Failed to program " << numFailed
+             << " routes, last error: " << fibError.message;
+  promise.setException(std::move(fibError));
+}
+
 std::string
 getClientName(const int16_t clientId) {
   auto it = thrift::_FibClient_VALUES_TO_NAMES.find(
@@ -47,12 +63,14 @@ getClientName(const int16_t clientId) {
 
 NetlinkFibHandler::NetlinkFibHandler(
     fbzmq::ZmqEventLoop* zmqEventLoop,
-    std::shared_ptr<fbnl::NetlinkSocket> netlinkSocket)
+    std::shared_ptr<fbnl::NetlinkSocket> netlinkSocket,
+    bool enableNextHopObjects)
     : netlinkSocket_(netlinkSocket),
       startTime_(std::chrono::duration_cast<std::chrono::seconds>(
                      std::chrono::system_clock::now().time_since_epoch())
                      .count()),
-      evl_{zmqEventLoop} {
+      evl_{zmqEventLoop},
+      enableNextHopObjects_(enableNextHopObjects) {
   CHECK_NOTNULL(zmqEventLoop);
   netlinkSocket_->registerNeighborListener(
       [this](const fbnl::NetlinkSocket::NeighborUpdate& neighborUpdate) {
@@ -126,7 +144,11 @@ NetlinkFibHandler::toThriftUnicastRoutes(const fbnl::NlUnicastRoutes& routeDb) {
   for (auto const& kv : routeDb) {
     thrift::UnicastRoute route;
     route.dest = toIpPrefix(kv.first);
-    route.nextHops = buildNextHops(kv.second.getNextHops());
+    auto const nextHopId = kv.second.getNextHopId();
+    auto it = nextHopId.has_value() ? groupObjects_.find(nextHopId.value())
+                                    : groupObjects_.end();
+    route.nextHops = buildNextHops(
+        it != groupObjects_.end() ? it->second : kv.second.getNextHops());
     routes.emplace_back(std::move(route));
   }
   return routes;
@@ -193,18 +215,27 @@ NetlinkFibHandler::future_addUnicastRoutes(
                                      clientId,
                                      promise = std::move(promise),
                                      routes = std::move(routes)]() mutable {
+    // program all routes and report the ones that failed, if any
+    thrift::PlatformFibUpdateError fibError;
+    auto* sync = getChunkedSync(clientId, std::nullopt);
     for (auto& route : *routes) {
+      const auto prefix = toIPNetwork(route.dest);
       auto ptr = std::make_unique<thrift::UnicastRoute>(std::move(route));
       try {
         // This is going to be synchronous call as we are invoking from
         // within event loop
         future_addUnicastRoute(clientId, std::move(ptr)).get();
       } catch (std::exception const& e) {
-        promise.setException(e);
-        return;
+        fibError.failedPrefixes.emplace_back(toIpPrefix(prefix));
+        fibError.message = e.what();
+        continue;
+      }
+      if (sync) {
+        sync->prefixes.emplace(prefix);
       }
+      leaveNextHopGroup(clientId, prefix);
     }
-    promise.setValue();
+    setFibUpdateResult(promise, std::move(fibError));
   });
 
   return future;
@@ -222,16 +253,22 @@ NetlinkFibHandler::future_deleteUnicastRoutes(
                                      clientId,
                                      promise = std::move(promise),
                                      prefixes = std::move(prefixes)]() mutable {
+    thrift::PlatformFibUpdateError fibError;
+    auto* sync = getChunkedSync(clientId, std::nullopt);
     for (auto& prefix : *prefixes) {
-      auto ptr = std::make_unique<thrift::IpPrefix>(std::move(prefix));
+      if (sync) {
+        sync->prefixes.erase(toIPNetwork(prefix));
+      }
+      leaveNextHopGroup(clientId, toIPNetwork(prefix));
+      auto ptr = std::make_unique<thrift::IpPrefix>(prefix);
       try {
         future_deleteUnicastRoute(clientId, std::move(ptr)).get();
       } catch (std::exception const& e) {
-        promise.setException(e);
-        return;
+        fibError.failedPrefixes.emplace_back(std::move(prefix));
+        fibError.message = e.what();
       }
     }
-    promise.setValue();
+    setFibUpdateResult(promise, std::move(fibError));
   });
 
   return future;
@@ -279,18 +316,25 @@ NetlinkFibHandler::future_addMplsRoutes(
                                      clientId,
                                      promise = std::move(promise),
                                      routes = std::move(routes)]() mutable {
+    thrift::PlatformFibUpdateError fibError;
+    auto* sync = getChunkedSync(clientId, std::nullopt);
     for (auto& route : *routes) {
+      const auto topLabel = route.topLabel;
       auto ptr = std::make_unique<thrift::MplsRoute>(std::move(route));
       try {
         // This is going to be synchronous call as we are invoking from
         // within event loop
         future_addMplsRoute(clientId, std::move(ptr)).get();
       } catch (std::exception const& e) {
-        promise.setException(e);
-        return;
+        fibError.failedMplsLabels.emplace_back(topLabel);
+        fibError.message = e.what();
+        continue;
+      }
+      if (sync) {
+        sync->labels.emplace(topLabel);
       }
     }
-    promise.setValue();
+    setFibUpdateResult(promise, std::move(fibError));
   });
 
   return future;
@@ -309,15 +353,20 @@ NetlinkFibHandler::future_deleteMplsRoutes(
        clientId,
        promise = std::move(promise),
        topLabels = std::move(topLabels)]() mutable {
+        thrift::PlatformFibUpdateError fibError;
+        auto* sync = getChunkedSync(clientId, std::nullopt);
         for (auto& label : *topLabels) {
+          if (sync) {
+            sync->labels.erase(label);
+          }
           try {
             future_deleteMplsRoute(clientId, label).get();
           } catch (std::exception const& e) {
-            promise.setException(e);
-            return;
+            fibError.failedMplsLabels.emplace_back(label);
+            fibError.message = e.what();
           }
         }
-        promise.setValue();
+        setFibUpdateResult(promise, std::move(fibError));
       });
 
   return future;
@@ -337,6 +386,10 @@ NetlinkFibHandler::future_syncFib(
     return future;
   }
 
+  // routes are programmed without groups from now on
+  evl_->runImmediatelyOrInEventLoop(
+      [this, clientId]() { dropNextHopGroups(clientId); });
+
   // Build new routeDb
   fbnl::NlUnicastRoutes newRoutes;
   for (auto const& route : *routes) {
@@ -344,8 +397,16 @@ NetlinkFibHandler::future_syncFib(
         toIPNetwork(route.dest), buildRoute(route, protocol.value()));
   }
 
-  return netlinkSocket_->syncUnicastRoutes(
-      protocol.value(), std::move(newRoutes));
+  // diff against the kernel, the cache misses routes changed by others
+  return netlinkSocket_
+      ->syncUnicastRoutesWithKernel(protocol.value(), std::move(newRoutes))
+      .thenValue([this, clientId](int64_t numChanged) {
+        LOG(INFO) << "Synced FIB, " << numChanged << " routes changed. Client: "
+                  << getClientName(clientId);
+        // no route uses the kernel groups of the client any longer
+        evl_->runImmediatelyOrInEventLoop(
+            [this, clientId]() { deleteStaleGroupObjects(clientId); });
+      });
 }
 
 folly::Future<folly::Unit>
@@ -372,11 +433,451 @@ NetlinkFibHandler::future_syncMplsFib(
       protocol.value(), std::move(newMplsRoutes));
 }
 
+folly::Future<folly::Unit>
+NetlinkFibHandler::future_beginSyncFib(
+    int16_t clientId, int64_t syncId, bool syncMpls) {
+  LOG(INFO) << "Beginning chunked FIB sync " << syncId
+            << ". Client: " << getClientName(clientId);
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+  auto protocol = getProtocol(promise, clientId);
+  if (protocol.hasError()) {
+    return future;
+  }
+
+  evl_->runImmediatelyOrInEventLoop([this,
+                                     clientId,
+                                     syncId,
+                                     syncMpls,
+                                     promise = std::move(promise)]() mutable {
+    // routes are programmed without groups from now on
+    dropNextHopGroups(clientId);
+    // replaces the sync in progress, if any
+    auto& sync = chunkedSyncs_[clientId];
+    sync = ChunkedSync();
+    sync.syncId = syncId;
+    sync.syncMpls = syncMpls;
+    promise.setValue();
+  });
+
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkFibHandler::future_syncFibChunk(
+    int16_t clientId,
+    int64_t syncId,
+    std::unique_ptr<std::vector<thrift::UnicastRoute>> routes,
+    std::unique_ptr<std::vector<thrift::MplsRoute>> mplsRoutes) {
+  VLOG(1) << "Syncing chunk of " << routes->size() << " unicast and "
+          << mplsRoutes->size() << " MPLS routes. Client: "
+          << getClientName(clientId);
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+  auto protocol = getProtocol(promise, clientId);
+  if (protocol.hasError()) {
+    return future;
+  }
+
+  evl_->runImmediatelyOrInEventLoop([this,
+                                     clientId,
+                                     syncId,
+                                     protocol = protocol.value(),
+                                     promise = std::move(promise),
+                                     routes = std::move(routes),
+                                     mplsRoutes =
+                                         std::move(mplsRoutes)]() mutable {
+    auto* sync = getChunkedSync(clientId, syncId);
+    if (not sync) {
+      promise.setException(fbnl::NlException(
+          folly::sformat("No FIB sync {} in progress", syncId)));
+      return;
+    }
+    try {
+      // This is going to be synchronous call as we are invoking from
+      // within event loop
+      for (auto const& route : *routes) {
+        const auto prefix = toIPNetwork(route.dest);
+        netlinkSocket_->addRoute(buildRoute(route, protocol)).get();
+        sync->prefixes.emplace(prefix);
+        leaveNextHopGroup(clientId, prefix);
+      }
+      for (auto const& route : *mplsRoutes) {
+        netlinkSocket_->addMplsRoute(buildMplsRoute(route, protocol)).get();
+        sync->labels.emplace(route.topLabel);
+      }
+    } catch (std::exception const& e) {
+      promise.setException(e);
+      return;
+    }
+    promise.setValue();
+  });
+
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkFibHandler::future_commitSyncFib(int16_t clientId, int64_t syncId) {
+  LOG(INFO) << "Committing chunked FIB sync " << syncId
+            << ". Client: " << getClientName(clientId);
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+  auto protocol = getProtocol(promise, clientId);
+  if (protocol.hasError()) {
+    return future;
+  }
+
+  evl_->runImmediatelyOrInEventLoop([this,
+                                     clientId,
+                                     syncId,
+                                     protocol = protocol.value(),
+                                     promise = std::move(promise)]() mutable {
+    auto* sync = getChunkedSync(clientId, syncId);
+    if (not sync) {
+      promise.setException(fbnl::NlException(
+          folly::sformat("No FIB sync {} in progress", syncId)));
+      return;
+    }
+    try {
+      // delete routes the sync did not program
+      auto routes = netlinkSocket_->getCachedUnicastRoutes(protocol).get();
+      for (auto const& kv : routes) {
+        if (not sync->prefixes.count(kv.first)) {
+          auto prefix =
+              std::make_unique<thrift::IpPrefix>(toIpPrefix(kv.first));
+          future_deleteUnicastRoute(clientId, std::move(prefix)).get();
+        }
+      }
+      if (sync->syncMpls) {
+        auto mplsRoutes = netlinkSocket_->getCachedMplsRoutes(protocol).get();
+        for (auto const& kv : mplsRoutes) {
+          if (not sync->labels.count(kv.first)) {
+            future_deleteMplsRoute(clientId, kv.first).get();
+          }
+        }
+      }
+    } catch (std::exception const& e) {
+      chunkedSyncs_.erase(clientId);
+      promise.setException(e);
+      return;
+    }
+    chunkedSyncs_.erase(clientId);
+    // routes not synced are gone, no route uses stale kernel groups any longer
+    deleteStaleGroupObjects(clientId);
+    promise.setValue();
+  });
+
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkFibHandler::future_updateGroupedUnicastRoutes(
+    int16_t clientId, std::unique_ptr<thrift::GroupedRouteUpdate> update) {
+  LOG(INFO) << "Updating " << update->nextHopGroupsToUpdate.size()
+            << " next-hop groups and routes of client: "
+            << getClientName(clientId);
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+  auto protocol = getProtocol(promise, clientId);
+  if (protocol.hasError()) {
+    return future;
+  }
+
+  evl_->runImmediatelyOrInEventLoop([this,
+                                     clientId,
+                                     protocol = protocol.value(),
+                                     promise = std::move(promise),
+                                     update = std::move(update)]() mutable {
+    auto& groups = nextHopGroups_[clientId];
+    auto* sync = getChunkedSync(clientId, std::nullopt);
+    try {
+      // This is going to be synchronous call as we are invoking from
+      // within event loop
+      for (auto& group : update->nextHopGroupsToUpdate) {
+        auto& nextHops = groups.nextHops[group.id];
+        nextHops = std::move(group.nextHops);
+
+        std::optional<uint32_t> oldObjectId;
+        auto objectIt = groups.objectIds.find(group.id);
+        if (objectIt != groups.objectIds.end()) {
+          oldObjectId = objectIt->second;
+        }
+        auto objectNextHops = getGroupObjectNextHops(nextHops);
+        if (objectNextHops.has_value() and oldObjectId.has_value()) {
+          // routes of the group move along with its kernel group
+          setGroupObject(
+              protocol, *oldObjectId, std::move(objectNextHops.value()));
+          continue;
+        }
+
+        groups.objectIds.erase(group.id);
+        if (objectNextHops.has_value()) {
+          const auto objectId = getNextObjectId();
+          setGroupObject(
+              protocol, objectId, std::move(objectNextHops.value()));
+          groups.objectIds[group.id] = objectId;
+        }
+        for (auto const& prefix : groups.prefixes[group.id]) {
+          addGroupedRoute(clientId, protocol, prefix, group.id);
+        }
+        if (oldObjectId.has_value()) {
+          deleteGroupObject(*oldObjectId);
+        }
+      }
+
+      for (auto const& route : update->unicastRoutesToUpdate) {
+        const auto id = route.nextHopGroupId;
+        if (not groups.nextHops.count(id)) {
+          throw fbnl::NlException(
+              folly::sformat("Unknown next-hop group {}", id));
+        }
+        const auto prefix = toIPNetwork(route.dest);
+        addGroupedRoute(clientId, protocol, prefix, id);
+        leaveNextHopGroup(clientId, prefix);
+        groups.groupIds[prefix] = id;
+        groups.prefixes[id].emplace(prefix);
+        if (sync) {
+          sync->prefixes.emplace(prefix);
+        }
+      }
+
+      for (auto const& prefix : update->unicastRoutesToDelete) {
+        leaveNextHopGroup(clientId, toIPNetwork(prefix));
+        if (sync) {
+          sync->prefixes.erase(toIPNetwork(prefix));
+        }
+        future_deleteUnicastRoute(
+            clientId, std::make_unique<thrift::IpPrefix>(prefix))
+            .get();
+      }
+
+      for (auto const id : update->nextHopGroupsToDelete) {
+        auto it = groups.prefixes.find(id);
+        if (it != groups.prefixes.end() and not it->second.empty()) {
+          throw fbnl::NlException(
+              folly::sformat("Next-hop group {} is still in use", id));
+        }
+        groups.prefixes.erase(id);
+        groups.nextHops.erase(id);
+        auto objectIt = groups.objectIds.find(id);
+        if (objectIt != groups.objectIds.end()) {
+          deleteGroupObject(objectIt->second);
+          groups.objectIds.erase(objectIt);
+        }
+      }
+    } catch (std::exception const& e) {
+      promise.setException(e);
+      return;
+    }
+    promise.setValue();
+  });
+
+  return future;
+}
+
+void
+NetlinkFibHandler::leaveNextHopGroup(
+    int16_t clientId, const folly::CIDRNetwork& prefix) {
+  auto groupsIt = nextHopGroups_.find(clientId);
+  if (groupsIt == nextHopGroups_.end()) {
+    return;
+  }
+  auto& groups = groupsIt->second;
+  auto it = groups.groupIds.find(prefix);
+  if (it != groups.groupIds.end()) {
+    groups.prefixes[it->second].erase(prefix);
+    groups.groupIds.erase(it);
+  }
+}
+
+void
+NetlinkFibHandler::addGroupedRoute(
+    int16_t clientId,
+    uint8_t protocol,
+    const folly::CIDRNetwork& prefix,
+    int64_t groupId) {
+  auto const& groups = nextHopGroups_.at(clientId);
+  auto it = groups.objectIds.find(groupId);
+  if (it == groups.objectIds.end()) {
+    future_addUnicastRoute(
+        clientId,
+        std::make_unique<thrift::UnicastRoute>(createUnicastRoute(
+            toIpPrefix(prefix), groups.nextHops.at(groupId))))
+        .get();
+    return;
+  }
+
+  fbnl::RouteBuilder rtBuilder;
+  rtBuilder.setDestination(prefix)
+      .setProtocolId(protocol)
+      .setNextHopId(it->second)
+      .setFlags(0)
+      .setValid(true);
+  netlinkSocket_->addRoute(rtBuilder.build()).get();
+}
+
+std::optional<fbnl::NextHopSet>
+NetlinkFibHandler::getGroupObjectNextHops(
+    const std::vector<thrift::NextHopThrift>& nextHops) const {
+  if (not enableNextHopObjects_ or nextHops.empty()) {
+    return std::nullopt;
+  }
+  fbnl::RouteBuilder rtBuilder;
+  buildNextHop(rtBuilder, nextHops);
+  for (auto const& nextHop : rtBuilder.getNextHops()) {
+    // labels would need encap in nexthop objects
+    if (nextHop.getLabelAction().has_value() or
+        not nextHop.getIfIndex().has_value()) {
+      return std::nullopt;
+    }
+  }
+  return rtBuilder.getNextHops();
+}
+
+void
+NetlinkFibHandler::setGroupObject(
+    uint8_t protocol, uint32_t objectId, fbnl::NextHopSet nextHops) {
+  std::vector<uint32_t> ids;
+  fbnl::NextHopSet acquired;
+  try {
+    for (auto const& nextHop : nextHops) {
+      ids.emplace_back(acquireNextHopObject(protocol, nextHop));
+      acquired.emplace(nextHop);
+    }
+    netlinkSocket_->addNextHopGroup(protocol, objectId, std::move(ids)).get();
+  } catch (std::exception const&) {
+    releaseNextHopObjects(acquired);
+    throw;
+  }
+
+  // old next-hops of the group are no longer used by it
+  auto& groupNextHops = groupObjects_[objectId];
+  releaseNextHopObjects(groupNextHops);
+  groupNextHops = std::move(nextHops);
+}
+
+void
+NetlinkFibHandler::deleteGroupObject(uint32_t objectId) {
+  auto it = groupObjects_.find(objectId);
+  if (it == groupObjects_.end()) {
+    return;
+  }
+  try {
+    netlinkSocket_->delNextHops({objectId}).get();
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to delete nexthop group " << objectId << ": "
+               << folly::exceptionStr(e);
+  }
+  releaseNextHopObjects(it->second);
+  groupObjects_.erase(it);
+}
+
+void
+NetlinkFibHandler::deleteStaleGroupObjects(int16_t clientId) {
+  auto it = staleGroupObjects_.find(clientId);
+  if (it == staleGroupObjects_.end()) {
+    return;
+  }
+  for (auto const objectId : it->second) {
+    deleteGroupObject(objectId);
+  }
+  staleGroupObjects_.erase(it);
+}
+
+void
+NetlinkFibHandler::dropNextHopGroups(int16_t clientId) {
+  auto it = nextHopGroups_.find(clientId);
+  if (it == nextHopGroups_.end()) {
+    return;
+  }
+  auto& staleObjects = staleGroupObjects_[clientId];
+  for (auto const& kv : it->second.objectIds) {
+    staleObjects.emplace_back(kv.second);
+  }
+  nextHopGroups_.erase(it);
+}
+
+uint32_t
+NetlinkFibHandler::acquireNextHopObject(
+    uint8_t protocol, const fbnl::NextHop& nextHop) {
+  auto it = nextHopObjects_.find(nextHop);
+  if (it == nextHopObjects_.end()) {
+    const auto id = getNextObjectId();
+    netlinkSocket_->addNextHop(protocol, id, nextHop).get();
+    it = nextHopObjects_.emplace(nextHop, NextHopObject{id, 0}).first;
+  }
+  ++it->second.refCount;
+  return it->second.id;
+}
+
+void
+NetlinkFibHandler::releaseNextHopObjects(const fbnl::NextHopSet& nextHops) {
+  std::vector<uint32_t> unusedIds;
+  for (auto const& nextHop : nextHops) {
+    auto it = nextHopObjects_.find(nextHop);
+    if (it == nextHopObjects_.end() or --it->second.refCount > 0) {
+      continue;
+    }
+    unusedIds.emplace_back(it->second.id);
+    nextHopObjects_.erase(it);
+  }
+  if (unusedIds.empty()) {
+    return;
+  }
+  try {
+    netlinkSocket_->delNextHops(std::move(unusedIds)).get();
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to delete unused nexthop objects: "
+               << folly::exceptionStr(e);
+  }
+}
+
+uint32_t
+NetlinkFibHandler::getNextObjectId() {
+  const auto id = nextObjectId_++;
+  if (nextObjectId_ == 0) {
+    // wrap around - we start from 1
+    nextObjectId_ = 1;
+  }
+  return id;
+}
+
+NetlinkFibHandler::ChunkedSync*
+NetlinkFibHandler::getChunkedSync(
+    int16_t clientId, std::optional<int64_t> syncId) {
+  auto it = chunkedSyncs_.find(clientId);
+  if (it == chunkedSyncs_.end() or
+      (syncId.has_value() and it->second.syncId != *syncId)) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
 int64_t
 NetlinkFibHandler::aliveSince() {
   return startTime_;
 }
 
+folly::Future<int64_t>
+NetlinkFibHandler::future_longPollAliveSince(
+    int64_t aliveSince, int32_t timeoutMs) {
+  if (aliveSince != startTime_) {
+    return folly::makeFuture<int64_t>(startTime_);
+  }
+  auto promise = std::make_shared<folly::Promise<int64_t>>();
+  auto future = promise->getFuture();
+  evl_->runImmediatelyOrInEventLoop([this, promise, timeoutMs]() {
+    evl_->scheduleTimeout(
+        std::chrono::milliseconds(std::max(timeoutMs, 0)),
+        [this, promise]() noexcept { promise->setValue(startTime_); });
+  });
+  return future;
+}
+
 facebook::fb303::cpp2::fb303_status
 NetlinkFibHandler::getStatus() {
   VLOG(3) << "Received getStatus";
@@ -444,7 +945,7 @@ NetlinkFibHandler::buildMplsAction(
   if (!nhop.mplsAction.has_value()) {
     return;
   }
-  auto mplsAction = nhop.mplsAction.value();
+  const auto& mplsAction = nhop.mplsAction.value();
   nhBuilder.setLabelAction(mplsAction.action);
   if (mplsAction.action == thrift::MplsActionCode::SWAP) {
     if (!mplsAction.swapLabel.has_value()) {
@@ -480,7 +981,8 @@ NetlinkFibHandler::buildNextHop(
     }
     nhBuilder.setGateway(toIPAddress(nh.address));
     buildMplsAction(nhBuilder, nh);
-    rtBuilder.addNextHop(nhBuilder.setWeight(0).build());
+    nhBuilder.setWeight(0);
+    rtBuilder.addNextHop(std::move(nhBuilder).build());
     nhBuilder.reset();
   }
 }
@@ -494,10 +996,11 @@ NetlinkFibHandler::buildRoute(
   // treat empty nexthop as null route
   if (route.nextHops.empty()) {
     rtBuilder.setType(RTN_BLACKHOLE);
-    return rtBuilder.build();
+    return std::move(rtBuilder).build();
   }
   buildNextHop(rtBuilder, route.nextHops);
-  return rtBuilder.setFlags(0).setValid(true).build();
+  rtBuilder.setFlags(0).setValid(true);
+  return std::move(rtBuilder).build();
 }
 
 fbnl::Route
@@ -512,7 +1015,8 @@ NetlinkFibHandler::buildMplsRoute(
     rtBuilder.setType(RTN_BLACKHOLE);
   }
   buildNextHop(rtBuilder, mplsRoute.nextHops);
-  return rtBuilder.setFlags(0).setValid(true).build();
+  rtBuilder.setFlags(0).setValid(true);
+  return std::move(rtBuilder).build();
 }
 
 void
@@ -10,7 +10,10 @@
 #include <chrono>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <fbzmq/async/ZmqTimeout.h>
@@ -36,7 +39,8 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
  public:
   explicit NetlinkFibHandler(
       fbzmq::ZmqEventLoop* zmqEventLoop,
-      std::shared_ptr<fbnl::NetlinkSocket> netlinkSocket);
+      std::shared_ptr<fbnl::NetlinkSocket> netlinkSocket,
+      bool enableNextHopObjects = false);
   ~NetlinkFibHandler() override;
 
   folly::Future<folly::Unit> future_addUnicastRoute(
@@ -75,6 +79,22 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
       int16_t clientId,
       std::unique_ptr<std::vector<thrift::MplsRoute>> routes) override;
 
+  folly::Future<folly::Unit> future_beginSyncFib(
+      int16_t clientId, int64_t syncId, bool syncMpls) override;
+
+  folly::Future<folly::Unit> future_syncFibChunk(
+      int16_t clientId,
+      int64_t syncId,
+      std::unique_ptr<std::vector<thrift::UnicastRoute>> routes,
+      std::unique_ptr<std::vector<thrift::MplsRoute>> mplsRoutes) override;
+
+  folly::Future<folly::Unit> future_commitSyncFib(
+      int16_t clientId, int64_t syncId) override;
+
+  folly::Future<folly::Unit> future_updateGroupedUnicastRoutes(
+      int16_t clientId,
+      std::unique_ptr<thrift::GroupedRouteUpdate> update) override;
+
   void sendNeighborDownInfo(
       std::unique_ptr<std::vector<std::string>> neighborIp) override;
 
@@ -83,6 +103,10 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
 
   int64_t aliveSince() override;
 
+  // aliveSince never changes while the agent runs, replies after timeoutMs
+  folly::Future<int64_t> future_longPollAliveSince(
+      int64_t aliveSince, int32_t timeoutMs) override;
+
   facebook::fb303::cpp2::fb303_status getStatus() override;
 
   openr::thrift::SwitchRunState getSwitchRunState() override;
@@ -127,6 +151,7 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
   folly::Expected<int16_t, bool> getProtocol(
       folly::Promise<A>& promise, int16_t clientId);
 
+  // routes using kernel nexthop groups get the nexthops of their group
   std::vector<thrift::UnicastRoute> toThriftUnicastRoutes(
       const fbnl::NlUnicastRoutes& routeDb);
 
@@ -157,6 +182,98 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
 
   // ZMQ Eventloop pointer
   fbzmq::ZmqEventLoop* evl_{nullptr};
+
+  // Chunked sync in progress of a client
+  struct ChunkedSync {
+    int64_t syncId{0};
+    bool syncMpls{false};
+    // programmed by the sync or added since it began, kept on commit
+    std::unordered_set<folly::CIDRNetwork> prefixes;
+    std::unordered_set<int32_t> labels;
+  };
+
+  // sync of client with syncId, nullptr if it is not in progress
+  ChunkedSync* getChunkedSync(int16_t clientId, std::optional<int64_t> syncId);
+
+  // by client, only accessed from evl_
+  std::unordered_map<int16_t, ChunkedSync> chunkedSyncs_;
+
+  // Next-hop groups of a client, and the unicast routes using them
+  struct NextHopGroups {
+    std::unordered_map<int64_t, std::vector<thrift::NextHopThrift>> nextHops;
+    std::unordered_map<int64_t, std::unordered_set<folly::CIDRNetwork>>
+        prefixes;
+    std::unordered_map<folly::CIDRNetwork, int64_t> groupIds;
+    // kernel nexthop group backing a group, if it has one
+    std::unordered_map<int64_t, uint32_t> objectIds;
+  };
+
+  // take prefix out of its next-hop group, if it has one
+  void leaveNextHopGroup(int16_t clientId, const folly::CIDRNetwork& prefix);
+
+  // program route of prefix with the next-hops of group groupId, or its
+  // kernel nexthop group if it has one
+  void addGroupedRoute(
+      int16_t clientId,
+      uint8_t protocol,
+      const folly::CIDRNetwork& prefix,
+      int64_t groupId);
+
+  // next-hops for a kernel nexthop group, std::nullopt if nexthop objects
+  // are disabled or don't support some of them
+  std::optional<fbnl::NextHopSet> getGroupObjectNextHops(
+      const std::vector<thrift::NextHopThrift>& nextHops) const;
+
+  // create or replace kernel nexthop group objectId
+  void setGroupObject(
+      uint8_t protocol, uint32_t objectId, fbnl::NextHopSet nextHops);
+
+  // delete kernel nexthop group objectId, once no route uses it any longer
+  void deleteGroupObject(uint32_t objectId);
+
+  // delete group objects of client left over from before its last full sync
+  void deleteStaleGroupObjects(int16_t clientId);
+
+  // groups of client are dropped, their kernel groups become stale
+  void dropNextHopGroups(int16_t clientId);
+
+  // nexthop object of nextHop, created on first use
+  uint32_t acquireNextHopObject(uint8_t protocol, const fbnl::NextHop& nextHop);
+
+  // nexthop objects get deleted once no group uses them any longer
+  void releaseNextHopObjects(const fbnl::NextHopSet& nextHops);
+
+  uint32_t getNextObjectId();
+
+  // by client, only accessed from evl_
+  std::unordered_map<int16_t, NextHopGroups> nextHopGroups_;
+
+  // Back next-hop groups with kernel nexthop groups, updating a group then
+  // moves its routes without reprogramming them. Otherwise groups are expanded
+  // into routes with their own next-hops.
+  const bool enableNextHopObjects_{false};
+
+  // Kernel nexthop object of a single next-hop, shared by kernel groups
+  struct NextHopObject {
+    uint32_t id{0};
+    // number of kernel groups using it
+    size_t refCount{0};
+  };
+
+  // below only accessed from evl_
+
+  std::unordered_map<fbnl::NextHop, NextHopObject, fbnl::NextHopHash>
+      nextHopObjects_;
+
+  // next-hops of kernel nexthop groups, by id
+  std::unordered_map<uint32_t, fbnl::NextHopSet> groupObjects_;
+
+  // kernel groups of clients no longer backing a group, routes may use them
+  // until the full sync of the client is done
+  std::unordered_map<int16_t, std::vector<uint32_t>> staleGroupObjects_;
+
+  // ids of nexthop objects and groups alike, 0 is not a valid id
+  uint32_t nextObjectId_{1};
 };
 
 } // namespace openr
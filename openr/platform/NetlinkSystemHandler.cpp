@@ -56,21 +56,51 @@ NetlinkSystemHandler::future_getAllLinks() {
 
 std::unique_ptr<std::vector<thrift::Link>>
 NetlinkSystemHandler::doGetAllLinks() {
-  auto linkDb = std::make_unique<std::vector<thrift::Link>>();
   auto links = netlinkSocket_->getAllLinks().get();
+  return std::make_unique<std::vector<thrift::Link>>(toThriftLinks(links));
+}
+
+folly::Future<std::unique_ptr<thrift::LinkDelta>>
+NetlinkSystemHandler::future_getLinksSince(int64_t seqNum) {
+  VLOG(3) << "Query links changed since " << seqNum;
 
-  linkDb->clear();
+  folly::Promise<std::unique_ptr<thrift::LinkDelta>> promise;
+  auto future = promise.getFuture();
+  mainEventLoop_->runInEventLoop(
+      [this, p = std::move(promise), seqNum]() mutable {
+        try {
+          p.setValue(doGetLinksSince(seqNum));
+        } catch (const std::exception& ex) {
+          p.setException(ex);
+        }
+      });
+  return future;
+}
 
-  for (const auto kv : links) {
+std::unique_ptr<thrift::LinkDelta>
+NetlinkSystemHandler::doGetLinksSince(int64_t seqNum) {
+  auto delta = netlinkSocket_->getLinksSince(seqNum).get();
+  auto linkDelta = std::make_unique<thrift::LinkDelta>();
+  linkDelta->seqNum = delta.seqNum;
+  linkDelta->isFullSync = delta.isFullSync;
+  linkDelta->links = toThriftLinks(delta.links);
+  return linkDelta;
+}
+
+std::vector<thrift::Link>
+NetlinkSystemHandler::toThriftLinks(const fbnl::NlLinks& links) {
+  std::vector<thrift::Link> linkDb;
+  linkDb.reserve(links.size());
+  for (const auto& kv : links) {
     thrift::Link linkEntry;
     linkEntry.ifName = kv.first;
     linkEntry.ifIndex = kv.second.ifIndex;
     linkEntry.isUp = kv.second.isUp;
-    for (const auto network : kv.second.networks) {
+    for (const auto& network : kv.second.networks) {
       linkEntry.networks.push_back(thrift::IpPrefix(
           FRAGILE, toBinaryAddress(network.first), network.second));
     }
-    linkDb->push_back(linkEntry);
+    linkDb.emplace_back(std::move(linkEntry));
   }
   return linkDb;
 }
@@ -123,10 +153,7 @@ NetlinkSystemHandler::future_addIfaceAddresses(
                                   addresses = std::move(addrs),
                                   ifName = std::move(iface)]() mutable {
     try {
-      for (const auto& addr : *addresses) {
-        const auto& prefix = toIPNetwork(addr);
-        doAddIfaceAddr(*ifName, prefix);
-      }
+      doProgramIfaceAddrs(*ifName, *addresses, true /* add */);
       p.setValue();
     } catch (const std::exception& ex) {
       p.setException(ex);
@@ -136,12 +163,23 @@ NetlinkSystemHandler::future_addIfaceAddresses(
 }
 
 void
-NetlinkSystemHandler::doAddIfaceAddr(
-    const std::string& ifName, const folly::CIDRNetwork& prefix) {
+NetlinkSystemHandler::doProgramIfaceAddrs(
+    const std::string& ifName,
+    const std::vector<::openr::thrift::IpPrefix>& addrs,
+    bool isAdd) {
   int ifIndex = netlinkSocket_->getIfIndex(ifName).get();
+  std::vector<fbnl::IfAddress> ifAddrs;
   fbnl::IfAddressBuilder builder;
-  auto addr = builder.setPrefix(prefix).setIfIndex(ifIndex).build();
-  netlinkSocket_->addIfAddress(std::move(addr)).get();
+  for (const auto& addr : addrs) {
+    ifAddrs.emplace_back(
+        builder.setPrefix(toIPNetwork(addr)).setIfIndex(ifIndex).build());
+    builder.reset();
+  }
+  if (isAdd) {
+    netlinkSocket_->addIfAddresses(std::move(ifAddrs)).get();
+  } else {
+    netlinkSocket_->delIfAddresses(std::move(ifAddrs)).get();
+  }
 }
 
 folly::Future<folly::Unit>
@@ -156,10 +194,7 @@ NetlinkSystemHandler::future_removeIfaceAddresses(
                                   addresses = std::move(addrs),
                                   ifName = std::move(iface)]() mutable {
     try {
-      for (const auto& addr : *addresses) {
-        const auto& prefix = toIPNetwork(addr);
-        doRemoveIfaceAddr(*ifName, prefix);
-      }
+      doProgramIfaceAddrs(*ifName, *addresses, false /* delete */);
       p.setValue();
     } catch (const std::exception& ex) {
       p.setException(ex);
@@ -204,15 +239,6 @@ NetlinkSystemHandler::doGetIfaceAddrs(
   return addrs;
 }
 
-void
-NetlinkSystemHandler::doRemoveIfaceAddr(
-    const std::string& ifName, const folly::CIDRNetwork& prefix) {
-  int ifIndex = netlinkSocket_->getIfIndex(ifName).get();
-  fbnl::IfAddressBuilder builder;
-  builder.setPrefix(prefix).setIfIndex(ifIndex);
-  netlinkSocket_->delIfAddress(builder.build()).get();
-}
-
 folly::Future<folly::Unit>
 NetlinkSystemHandler::future_syncIfaceAddresses(
     std::unique_ptr<std::string> iface,
@@ -48,6 +48,9 @@ class NetlinkSystemHandler final : public thrift::SystemServiceSvIf {
   folly::Future<std::unique_ptr<std::vector<thrift::Link>>> future_getAllLinks()
       override;
 
+  folly::Future<std::unique_ptr<thrift::LinkDelta>> future_getLinksSince(
+      int64_t seqNum) override;
+
   folly::Future<std::unique_ptr<std::vector<thrift::NeighborEntry>>>
   future_getAllNeighbors() override;
 
@@ -74,11 +77,11 @@ class NetlinkSystemHandler final : public thrift::SystemServiceSvIf {
  private:
   void initNetlinkSystemHandler();
 
-  void doAddIfaceAddr(
-      const std::string& ifName, const folly::CIDRNetwork& prefix);
-
-  void doRemoveIfaceAddr(
-      const std::string& ifName, const folly::CIDRNetwork& prefix);
+  // add or remove addrs of ifName as one batch
+  void doProgramIfaceAddrs(
+      const std::string& ifName,
+      const std::vector<::openr::thrift::IpPrefix>& addrs,
+      bool isAdd);
 
   void doSyncIfaceAddrs(
       const std::string& ifName,
@@ -91,6 +94,11 @@ class NetlinkSystemHandler final : public thrift::SystemServiceSvIf {
 
   std::unique_ptr<std::vector<openr::thrift::Link>> doGetAllLinks();
 
+  std::unique_ptr<openr::thrift::LinkDelta> doGetLinksSince(int64_t seqNum);
+
+  static std::vector<openr::thrift::Link> toThriftLinks(
+      const fbnl::NlLinks& links);
+
   std::unique_ptr<std::vector<openr::thrift::NeighborEntry>>
   doGetAllNeighbors();
 
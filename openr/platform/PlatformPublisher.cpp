@@ -25,8 +25,11 @@ using apache::thrift::FRAGILE;
 namespace openr {
 
 PlatformPublisher::PlatformPublisher(
-    fbzmq::Context& context, const PlatformPublisherUrl& platformPubUrl)
-    : platformPubUrl_(platformPubUrl) {
+    fbzmq::Context& context,
+    const PlatformPublisherUrl& platformPubUrl,
+    fbzmq::ZmqEventLoop* evl,
+    messaging::ReplicateQueue<PlatformEvents>* eventsQueue)
+    : evl_(evl), eventsQueue_(eventsQueue), platformPubUrl_(platformPubUrl) {
   // Initialize ZMQ sockets
   platformPubSock_ = fbzmq::Socket<ZMQ_PUB, fbzmq::ZMQ_SERVER>(
       context, folly::none, folly::none, fbzmq::NonblockingFlag{true});
@@ -41,6 +44,9 @@ PlatformPublisher::PlatformPublisher(
 
 void
 PlatformPublisher::publishLinkEvent(const thrift::LinkEntry& link) {
+  if (pushEvents(PlatformEvents{{link}, {}})) {
+    return;
+  }
   // advertise change of link, prompting subscriber modules to
   // take immediate action
   thrift::PlatformEvent msg;
@@ -51,6 +57,9 @@ PlatformPublisher::publishLinkEvent(const thrift::LinkEntry& link) {
 
 void
 PlatformPublisher::publishAddrEvent(const thrift::AddrEntry& address) {
+  if (pushEvents(PlatformEvents{{}, {address}})) {
+    return;
+  }
   // advertise change of address, prompting subscriber modules to
   // take immediate action
   thrift::PlatformEvent msg;
@@ -69,6 +78,39 @@ PlatformPublisher::publishNeighborEvent(const thrift::NeighborEntry& neighbor) {
   publishPlatformEvent(msg);
 }
 
+void
+PlatformPublisher::publishLinkEvents(const thrift::LinkEntries& links) {
+  if (pushEvents(PlatformEvents{links.entries, {}})) {
+    return;
+  }
+  thrift::PlatformEvent msg;
+  msg.eventType = thrift::PlatformEventType::LINK_EVENTS;
+  msg.eventData = fbzmq::util::writeThriftObjStr(links, serializer_);
+  publishPlatformEvent(msg);
+}
+
+void
+PlatformPublisher::publishAddrEvents(const thrift::AddrEntries& addresses) {
+  if (pushEvents(PlatformEvents{{}, addresses.entries})) {
+    return;
+  }
+  thrift::PlatformEvent msg;
+  msg.eventType = thrift::PlatformEventType::ADDRESS_EVENTS;
+  msg.eventData = fbzmq::util::writeThriftObjStr(addresses, serializer_);
+  publishPlatformEvent(msg);
+}
+
+bool
+PlatformPublisher::pushEvents(PlatformEvents&& events) {
+  if (not eventsQueue_) {
+    return false;
+  }
+  VLOG(3) << "Pushing " << events.links.size() << " link and "
+          << events.addresses.size() << " address events";
+  eventsQueue_->push(std::move(events));
+  return true;
+}
+
 void
 PlatformPublisher::publishPlatformEvent(const thrift::PlatformEvent& msg) {
   VLOG(3) << "Publishing PlatformEvent...";
@@ -90,12 +132,28 @@ void
 PlatformPublisher::linkEventFunc(
     const std::string& ifName, const openr::fbnl::Link& linkEntry) noexcept {
   VLOG(4) << "Handling Link Event in NetlinkSystemHandler...";
-  publishLinkEvent(thrift::LinkEntry(
+  thrift::LinkEntry link(
       FRAGILE,
       ifName,
       linkEntry.getIfIndex(),
       linkEntry.isUp(),
-      Constants::kDefaultAdjWeight));
+      Constants::kDefaultAdjWeight);
+  if (not evl_) {
+    publishLinkEvent(link);
+    return;
+  }
+  auto const it = pendingLinkIndex_.find(ifName);
+  if (it != pendingLinkIndex_.end() and
+      pendingLinks_[it->second].isUp == link.isUp) {
+    pendingLinks_[it->second] = std::move(link);
+  } else {
+    pendingLinkIndex_[ifName] = pendingLinks_.size();
+    pendingLinks_.emplace_back(std::move(link));
+  }
+  if (not flushScheduled_) {
+    flushScheduled_ = true;
+    evl_->runInEventLoop([this]() { flushEvents(); });
+  }
 }
 
 void
@@ -104,13 +162,23 @@ PlatformPublisher::addrEventFunc(
     const openr::fbnl::IfAddress& addrEntry) noexcept {
   VLOG(4) << "Handling Address Event in NetlinkSystemHandler...";
   thrift::IpPrefix prefix{};
-  publishAddrEvent(thrift::AddrEntry(
+  thrift::AddrEntry address(
       FRAGILE,
       ifName,
       addrEntry.getPrefix().has_value()
           ? toIpPrefix(addrEntry.getPrefix().value())
           : prefix,
-      addrEntry.isValid()));
+      addrEntry.isValid());
+  if (not evl_) {
+    publishAddrEvent(address);
+    return;
+  }
+  auto key = std::make_pair(ifName, address.ipPrefix);
+  pendingAddrs_.insert_or_assign(std::move(key), std::move(address));
+  if (not flushScheduled_) {
+    flushScheduled_ = true;
+    evl_->runInEventLoop([this]() { flushEvents(); });
+  }
 }
 
 void
@@ -128,6 +196,44 @@ PlatformPublisher::neighborEventFunc(
       neighborEntry.isReachable()));
 }
 
+void
+PlatformPublisher::flushEvents() {
+  flushScheduled_ = false;
+  // one batch for both, in-process subscribers process it at once
+  if (eventsQueue_) {
+    PlatformEvents events;
+    events.links = std::move(pendingLinks_);
+    pendingLinks_.clear();
+    pendingLinkIndex_.clear();
+    events.addresses.reserve(pendingAddrs_.size());
+    for (auto& kv : pendingAddrs_) {
+      events.addresses.emplace_back(std::move(kv.second));
+    }
+    pendingAddrs_.clear();
+    pushEvents(std::move(events));
+    return;
+  }
+  // links first, subscribers learn of new interfaces before their addresses
+  if (not pendingLinks_.empty()) {
+    thrift::LinkEntries links;
+    links.entries = std::move(pendingLinks_);
+    pendingLinks_.clear();
+    pendingLinkIndex_.clear();
+    VLOG(2) << "Publishing " << links.entries.size() << " link events";
+    publishLinkEvents(links);
+  }
+  if (not pendingAddrs_.empty()) {
+    thrift::AddrEntries addresses;
+    addresses.entries.reserve(pendingAddrs_.size());
+    for (auto& kv : pendingAddrs_) {
+      addresses.entries.emplace_back(std::move(kv.second));
+    }
+    pendingAddrs_.clear();
+    VLOG(2) << "Publishing " << addresses.entries.size() << " address events";
+    publishAddrEvents(addresses);
+  }
+}
+
 void
 PlatformPublisher::stop() {
   platformPubSock_.close();
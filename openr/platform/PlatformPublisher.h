@@ -12,23 +12,51 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/hash/Hash.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/NetworkUtil.h>
 #include <openr/common/Types.h>
 #include <openr/if/gen-cpp2/Platform_types.h>
+#include <openr/messaging/ReplicateQueue.h>
 #include <openr/nl/NetlinkSocket.h>
 #include <openr/nl/NetlinkTypes.h>
 
 namespace openr {
 
+/**
+ * Link and address events delivered in-process by PlatformPublisher. Events
+ * coalesced together come in one batch, links before addresses.
+ */
+struct PlatformEvents {
+  std::vector<thrift::LinkEntry> links;
+  std::vector<thrift::AddrEntry> addresses;
+};
+
 /**
  * This is a utility class to publish link/addr/neighbor events through ZMQ
  * message passing mechanism. Event will be sent over Zmq PUB socket which
  * OpenR modules can subscribe through SUB socket. The subscriber modules is
  * LinkMonitor from Open/R side.
+ *
+ * With an event loop given, link and address events of NetlinkSocket are
+ * coalesced until the event loop is done with the ones already queued, then
+ * published as one LINK_EVENTS and one ADDRESS_EVENTS message holding the
+ * latest entry per address. Links keep an entry per up/down transition, in
+ * order, so that flaps are not hidden from subscribers. It must be the event
+ * loop of the NetlinkSocket. Without one each event gets published on its
+ * own.
+ *
+ * With an events queue, link and address events are pushed to it as
+ * PlatformEvents instead, without serializing them, for subscribers in the
+ * same process. The PUB socket is kept for neighbor events and out-of-process
+ * subscribers.
  */
 class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
  public:
@@ -37,7 +65,9 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
       // Immutable state initializers
       //
       fbzmq::Context& context,
-      const PlatformPublisherUrl& platformPubUrl);
+      const PlatformPublisherUrl& platformPubUrl,
+      fbzmq::ZmqEventLoop* evl = nullptr,
+      messaging::ReplicateQueue<PlatformEvents>* eventsQueue = nullptr);
 
   ~PlatformPublisher() = default;
 
@@ -53,6 +83,10 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
 
   void publishNeighborEvent(const thrift::NeighborEntry& neighbor);
 
+  void publishLinkEvents(const thrift::LinkEntries& links);
+
+  void publishAddrEvents(const thrift::AddrEntries& addresses);
+
   void stop();
 
  private:
@@ -69,6 +103,32 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
       const std::string& ifName,
       const openr::fbnl::Neighbor& neighborEntry) noexcept override;
 
+  // publish coalesced events, run in evl_ once it is done with queued events
+  void flushEvents();
+
+  // push events to eventsQueue_, returns false if there is none
+  bool pushEvents(PlatformEvents&& events);
+
+  // Event loop of NetlinkSocket, to coalesce events in if set
+  fbzmq::ZmqEventLoop* const evl_{nullptr};
+
+  // in-process subscribers of link and address events, if set
+  messaging::ReplicateQueue<PlatformEvents>* const eventsQueue_{nullptr};
+
+  // coalesced link events in order. Up/down transitions are all kept, for
+  // subscribers to see flaps, repeated states of an interface are merged
+  std::vector<thrift::LinkEntry> pendingLinks_;
+  // index of the latest entry of each interface in pendingLinks_
+  std::unordered_map<std::string, size_t> pendingLinkIndex_;
+  // latest coalesced events by (interface, address)
+  std::unordered_map<
+      std::pair<std::string, thrift::IpPrefix>,
+      thrift::AddrEntry>
+      pendingAddrs_;
+
+  // flushEvents() is queued in evl_
+  bool flushScheduled_{false};
+
   // Publish link events to, e.g., LinkMonitor and Squire
   const std::string platformPubUrl_;
 
@@ -52,7 +52,8 @@ const int16_t kFibId{static_cast<int16_t>(thrift::FibClient::OPENR)};
 // which the Benchmark test can use to add routes (via interface)
 class NetlinkFibWrapper {
  public:
-  NetlinkFibWrapper() {
+  // bounds of the window of netlink messages in flight
+  NetlinkFibWrapper(size_t minIovMsg, size_t maxIovMsg) {
     // cleanup old interfaces in any
     auto cmd = "ip link del {} 2>/dev/null"_shellify(kVethNameX.c_str());
     folly::Subprocess proc(std::move(cmd));
@@ -74,8 +75,8 @@ class NetlinkFibWrapper {
 
     // Create NetlinkProtocolSocket
     std::unique_ptr<openr::fbnl::NetlinkProtocolSocket> nlProtocolSocket;
-    nlProtocolSocket =
-        std::make_unique<openr::fbnl::NetlinkProtocolSocket>(&evl2);
+    nlProtocolSocket = std::make_unique<openr::fbnl::NetlinkProtocolSocket>(
+        &evl2, minIovMsg, maxIovMsg);
     nlProtocolSocketThread = std::thread([&]() {
       nlProtocolSocket->init();
       evl2.run();
@@ -128,12 +129,6 @@ class NetlinkFibWrapper {
   std::shared_ptr<NetlinkFibHandler> fibHandler;
   PrefixGenerator prefixGenerator;
 
-  struct rtnl_link* link_{nullptr};
-  struct nl_sock* socket_{nullptr};
-  struct nl_cache* linkCache_{nullptr};
-  struct nl_cache* addrCache_{nullptr};
-  struct nl_cache* routeCache_{nullptr};
-
  private:
   void
   addAddress(const std::string& ifName, const std::string& address) {
@@ -157,18 +152,20 @@ class NetlinkFibWrapper {
  * 2. Generate random IpV6s and routes
  * 3. Add routes through netlink
  * 4. Wait until the completion of routes update
+ * Time is reported per route, so that iters/s is the number of routes
+ * programmed per second.
  */
-static void
-BM_NetlinkFibHandler(uint32_t iters, size_t numOfPrefixes) {
+static unsigned
+BM_NetlinkFibHandler(
+    unsigned iters, size_t numOfPrefixes, size_t minIovMsg, size_t maxIovMsg) {
   auto suspender = folly::BenchmarkSuspender();
-  auto netlinkFibWrapper = std::make_unique<NetlinkFibWrapper>();
+  auto netlinkFibWrapper =
+      std::make_unique<NetlinkFibWrapper>(minIovMsg, maxIovMsg);
 
   // Randomly generate IPV6 prefixes
   auto prefixes = netlinkFibWrapper->prefixGenerator.ipv6PrefixGenerator(
       numOfPrefixes, kBitMaskLen);
 
-  suspender.dismiss(); // Start measuring benchmark time
-
   for (uint32_t i = 0; i < iters; i++) {
     auto routes = std::make_unique<std::vector<thrift::UnicastRoute>>();
     routes->reserve(prefixes.size());
@@ -181,19 +178,31 @@ BM_NetlinkFibHandler(uint32_t iters, size_t numOfPrefixes) {
               kNumOfNexthops, kVethNameY)));
     }
 
-    suspender.rehire(); // Stop measuring time again
+    suspender.dismiss(); // Start measuring benchmark time
     // Add new routes through netlink
     netlinkFibWrapper->fibHandler
         ->future_addUnicastRoutes(kFibId, std::move(routes))
         .wait();
+    suspender.rehire(); // Stop measuring time again
   }
+  return iters * numOfPrefixes;
 }
 
-// The parameter is the number of prefixes
-BENCHMARK_PARAM(BM_NetlinkFibHandler, 10);
-BENCHMARK_PARAM(BM_NetlinkFibHandler, 100);
-BENCHMARK_PARAM(BM_NetlinkFibHandler, 1000);
-BENCHMARK_PARAM(BM_NetlinkFibHandler, 10000);
+// The parameters are the number of prefixes and the bounds of the netlink
+// message window, fixed at 500 messages or adaptive
+BENCHMARK_NAMED_PARAM_MULTI(BM_NetlinkFibHandler, 10_fixed, 10, 500, 500);
+BENCHMARK_NAMED_PARAM_MULTI(BM_NetlinkFibHandler, 100_fixed, 100, 500, 500);
+BENCHMARK_NAMED_PARAM_MULTI(BM_NetlinkFibHandler, 1000_fixed, 1000, 500, 500);
+BENCHMARK_NAMED_PARAM_MULTI(
+    BM_NetlinkFibHandler, 10000_fixed, 10000, 500, 500);
+BENCHMARK_NAMED_PARAM_MULTI(
+    BM_NetlinkFibHandler, 10_adaptive, 10, kMinIovMsg, kMaxIovMsg);
+BENCHMARK_NAMED_PARAM_MULTI(
+    BM_NetlinkFibHandler, 100_adaptive, 100, kMinIovMsg, kMaxIovMsg);
+BENCHMARK_NAMED_PARAM_MULTI(
+    BM_NetlinkFibHandler, 1000_adaptive, 1000, kMinIovMsg, kMaxIovMsg);
+BENCHMARK_NAMED_PARAM_MULTI(
+    BM_NetlinkFibHandler, 10000_adaptive, 10000, kMinIovMsg, kMaxIovMsg);
 
 } // namespace openr
 
@@ -7,11 +7,15 @@
 
 #include "PrefixManager.h"
 
+#include <stdexcept>
+
 #include <fb303/ServiceData.h>
 #include <folly/futures/Future.h>
+#include <folly/hash/Hash.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/LsdbEncoding.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/kvstore/KvStore.h>
 
@@ -20,7 +24,8 @@ namespace fb303 = facebook::fb303;
 namespace openr {
 
 namespace {
-// key for the persist config on disk
+// key for the persist config on disk, records of prefix types are suffixed
+// with the type name. Single record of all prefixes is the legacy format.
 const std::string kConfigKey{"prefix-manager-config"};
 // various error messages
 const std::string kErrorNoChanges{"No changes in prefixes to be advertised"};
@@ -33,6 +38,23 @@ getPrefixTypeName(thrift::PrefixType const& type) {
   return apache::thrift::TEnumTraits<thrift::PrefixType>::findName(type);
 }
 
+std::string
+getConfigKey(thrift::PrefixType const& type) {
+  return folly::sformat("{}:{}", kConfigKey, getPrefixTypeName(type));
+}
+
+// true if prefix is more specific than and within network
+bool
+isMoreSpecific(
+    const thrift::IpPrefix& prefix, const folly::CIDRNetwork& network) {
+  if (prefix.prefixLength <= network.second) {
+    return false;
+  }
+  const auto address = toIPAddress(prefix.prefixAddress);
+  return address.family() == network.first.family() and
+      address.inSubnet(network.first, network.second);
+}
+
 } // namespace
 
 PrefixManager::PrefixManager(
@@ -45,36 +67,89 @@ PrefixManager::PrefixManager(
     bool enablePerfMeasurement,
     const std::chrono::seconds prefixHoldTime,
     const std::chrono::milliseconds ttlKeyInKvStore,
-    const std::unordered_set<std::string>& areas)
+    const std::unordered_set<std::string>& areas,
+    const std::chrono::milliseconds persistDebounce,
+    const std::chrono::milliseconds persistMaxDelay,
+    bool compactLsdbEncoding,
+    const AreaSummaries& areaSummaries,
+    std::optional<messaging::RQueue<KvStorePublication>> kvStoreUpdatesQueue,
+    size_t prefixesPerBucket)
     : nodeId_(nodeId),
       configStore_{configStore},
       kvStore_(kvStore),
+      persistDebounce_(persistDebounce),
+      persistMaxDelay_(persistMaxDelay),
       prefixDbMarker_{prefixDbMarker},
+      compactLsdbEncoding_{compactLsdbEncoding},
       perPrefixKeys_{perPrefixKeys},
+      prefixesPerBucket_{perPrefixKeys ? 0 : prefixesPerBucket},
       enablePerfMeasurement_{enablePerfMeasurement},
       ttlKeyInKvStore_(ttlKeyInKvStore),
       areas_{areas} {
   CHECK(configStore_);
   CHECK(kvStore_);
+  CHECK_LE(persistDebounce_.count(), persistMaxDelay_.count());
+
+  // summaries are only originated at the border of areas
+  for (const auto& [area, prefixes] : areaSummaries) {
+    for (const auto& prefix : prefixes) {
+      if (areas_.size() < 2 or not areas_.count(area)) {
+        LOG(WARNING) << "Ignoring summary " << toString(prefix) << " of area "
+                     << area << ", not at the border of the area";
+        continue;
+      }
+      LOG(INFO) << "Summarizing prefixes of area " << area << " as "
+                << toString(prefix);
+      summaries_.emplace_back(Summary{area, prefix, toIPNetwork(prefix)});
+    }
+  }
+  remoteContributors_.resize(summaries_.size());
 
   // Create KvStore client
   kvStoreClient_ =
       std::make_unique<KvStoreClientInternal>(this, nodeId_, kvStore_);
 
   // pick up prefixes from disk
-  auto maybePrefixDb =
-      configStore_->loadThriftObj<thrift::PrefixDatabase>(kConfigKey).get();
-  if (maybePrefixDb.hasValue()) {
+  auto loadPrefixEntry = [this](const thrift::PrefixEntry& entry) {
+    LOG(INFO) << "  > " << toString(entry.prefix) << ", type "
+              << getPrefixTypeName(entry.type);
+    prefixMap_[entry.type][entry.prefix] = entry;
+    changedPrefixes_.emplace(entry.prefix);
+    addPerfEvent(
+        addingEvents_[entry.type][entry.prefix], nodeId_, "LOADED_FROM_DISK");
+  };
+  for (const auto& kv : thrift::_PrefixType_VALUES_TO_NAMES) {
+    const auto type = static_cast<thrift::PrefixType>(kv.first);
+    auto maybePrefixDb = configStore_
+                             ->loadThriftObj<thrift::PrefixDatabase>(
+                                 getConfigKey(type))
+                             .get();
+    if (maybePrefixDb.hasError()) {
+      continue;
+    }
     LOG(INFO) << "Successfully loaded " << maybePrefixDb->prefixEntries.size()
-              << " prefixes from disk";
-    diskState_ = std::move(maybePrefixDb.value());
-    for (const auto& entry : diskState_.prefixEntries) {
-      LOG(INFO) << "  > " << toString(entry.prefix) << ", type "
-                << getPrefixTypeName(entry.type);
-      prefixMap_[entry.type][entry.prefix] = entry;
-      addPerfEvent(
-          addingEvents_[entry.type][entry.prefix], nodeId_, "LOADED_FROM_DISK");
+              << " prefixes of type " << kv.second << " from disk";
+    for (const auto& entry : maybePrefixDb->prefixEntries) {
+      loadPrefixEntry(entry);
+    }
+    diskState_[type] = std::move(maybePrefixDb.value());
+  }
+  // migrate legacy record to per type ones, they are written once the event
+  // loop starts. Types already having a record of their own are skipped.
+  auto maybeLegacyPrefixDb =
+      configStore_->loadThriftObj<thrift::PrefixDatabase>(kConfigKey).get();
+  if (maybeLegacyPrefixDb.hasValue()) {
+    LOG(INFO) << "Successfully loaded "
+              << maybeLegacyPrefixDb->prefixEntries.size()
+              << " prefixes from legacy record on disk";
+    for (const auto& entry : maybeLegacyPrefixDb->prefixEntries) {
+      if (diskState_.count(entry.type)) {
+        continue;
+      }
+      loadPrefixEntry(entry);
+      dirtyPersistTypes_.emplace(entry.type);
     }
+    eraseLegacyConfig_ = true;
   }
   // Create throttled update state
   outputStateThrottled_ = std::make_unique<fbzmq::ZmqThrottle>(
@@ -82,6 +157,13 @@ PrefixManager::PrefixManager(
         outputState();
       });
 
+  // Create timer to persist prefix db
+  persistPrefixDbTimer_ = fbzmq::ZmqTimeout::make(
+      getEvb(), [this]() noexcept { persistPrefixDb(); });
+  if (eraseLegacyConfig_) {
+    persistPrefixDbTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+  }
+
   // Schedule fiber to read prefix updates messages
   addFiberTask([q = std::move(prefixUpdatesQueue), this]() mutable noexcept {
     while (true) {
@@ -116,6 +198,21 @@ PrefixManager::PrefixManager(
     }
   });
 
+  // Schedule fiber to learn contributors of summaries from other nodes
+  if (not summaries_.empty() and kvStoreUpdatesQueue.has_value()) {
+    addFiberTask([q = std::move(kvStoreUpdatesQueue.value()),
+                  this]() mutable noexcept {
+      while (true) {
+        auto maybePublication = q.get(); // perform read
+        if (maybePublication.hasError()) {
+          LOG(INFO) << "Terminating kvstore publication processing fiber";
+          break;
+        }
+        processPublication(*maybePublication.value());
+      }
+    });
+  }
+
   // register kvstore publication callback
   std::vector<std::string> keyPrefixList;
   keyPrefixList.emplace_back(folly::sformat(
@@ -128,9 +225,12 @@ PrefixManager::PrefixManager(
           const std::string& key, std::optional<thrift::Value> value) noexcept {
         // we're not currently persisting this key, it may be that we no longer
         // want it advertised
+        if (advertisedKeys_.count(key)) {
+          return;
+        }
         if (value.has_value() and value.value().value.has_value()) {
           const auto prefixDb =
-              fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
+              readLsdbValue<thrift::PrefixDatabase>(
                   value.value().value.value(), serializer_);
           if (not prefixDb.deletePrefix && nodeId_ == prefixDb.thisNodeName) {
             LOG(INFO) << "keysToClear_.emplace(" << key << ")";
@@ -166,10 +266,15 @@ PrefixManager::~PrefixManager() {
   // - If EventBase is stopped or it is within the evb thread, run immediately;
   // - Otherwise, will wait the EventBase to run;
   getEvb()->runImmediatelyOrRunInEventBaseThreadAndWait([this]() {
+    // flush pending changes of prefix db to disk
+    if (persistPrefixDbTimer_->isScheduled()) {
+      persistPrefixDb();
+    }
     // destory timers
     LOG(INFO) << "Destroyed timers inside PrefixManager";
     initialOutputStateTimer_.reset();
     outputStateThrottled_.reset();
+    persistPrefixDbTimer_.reset();
   });
   kvStoreClient_.reset();
 }
@@ -182,22 +287,88 @@ PrefixManager::outputState() {
   updateKvStore();
 }
 
+void
+PrefixManager::schedulePersistPrefixDb() {
+  if (persistDebounce_.count() == 0) {
+    persistPrefixDb();
+    return;
+  }
+
+  // push the write out by debounce on every change, bounded by the max delay
+  // since the first change not persisted yet
+  const auto now = std::chrono::steady_clock::now();
+  if (not persistPrefixDbTimer_->isScheduled()) {
+    persistDeadline_ = now + persistMaxDelay_;
+  }
+  const auto timeout = std::max(
+      std::chrono::milliseconds(0),
+      std::min(
+          persistDebounce_,
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              persistDeadline_ - now)));
+  persistPrefixDbTimer_->scheduleTimeout(timeout);
+}
+
 void
 PrefixManager::persistPrefixDb() {
-  // prefixDb persistent entries have changed,
-  // save the newest persistent entries to disk.
-  thrift::PrefixDatabase persistentPrefixDb;
-  persistentPrefixDb.thisNodeName = nodeId_;
-  for (const auto& kv : prefixMap_) {
-    for (const auto& kv2 : kv.second) {
-      if (not kv2.second.ephemeral.value_or(false)) {
-        persistentPrefixDb.prefixEntries.emplace_back(kv2.second);
+  // prefixDb persistent entries of dirty types have changed,
+  // save the newest persistent entries of those types to disk.
+  // Writes are not waited for unless persisting inline.
+  const bool waitForStore = persistDebounce_.count() == 0;
+  if (persistPrefixDbTimer_->isScheduled()) {
+    persistPrefixDbTimer_->cancelTimeout();
+  }
+
+  size_t numWrites{0};
+  for (const auto& type : dirtyPersistTypes_) {
+    thrift::PrefixDatabase persistentPrefixDb;
+    persistentPrefixDb.thisNodeName = nodeId_;
+    auto const search = prefixMap_.find(type);
+    if (search != prefixMap_.end()) {
+      for (const auto& kv : search->second) {
+        if (not kv.second.ephemeral.value_or(false)) {
+          persistentPrefixDb.prefixEntries.emplace_back(kv.second);
+        }
       }
     }
+
+    auto diskIt = diskState_.find(type);
+    if (persistentPrefixDb.prefixEntries.empty()) {
+      if (diskIt == diskState_.end()) {
+        continue;
+      }
+      diskState_.erase(diskIt);
+      auto sf = configStore_->erase(getConfigKey(type));
+      if (waitForStore) {
+        std::move(sf).get();
+      }
+    } else {
+      if (diskIt != diskState_.end() and diskIt->second == persistentPrefixDb) {
+        continue;
+      }
+      auto sf =
+          configStore_->storeThriftObj(getConfigKey(type), persistentPrefixDb);
+      diskState_[type] = std::move(persistentPrefixDb);
+      if (waitForStore) {
+        std::move(sf).get();
+      }
+    }
+    ++numWrites;
+  }
+  dirtyPersistTypes_.clear();
+
+  if (eraseLegacyConfig_) {
+    eraseLegacyConfig_ = false;
+    auto sf = configStore_->erase(kConfigKey);
+    if (waitForStore) {
+      std::move(sf).get();
+    }
   }
-  if (diskState_ != persistentPrefixDb) {
-    configStore_->storeThriftObj(kConfigKey, persistentPrefixDb).get();
-    diskState_ = std::move(persistentPrefixDb);
+
+  if (numWrites) {
+    VLOG(1) << "Persisted prefixes of " << numWrites << " types";
+    fb303::fbData->addStatValue(
+        "prefix_manager.persisted_prefix_types", numWrites, fb303::SUM);
   }
 }
 
@@ -215,10 +386,10 @@ PrefixManager::advertisePrefix(thrift::PrefixEntry& prefixEntry) {
           folly::IPAddress::createNetwork(toString(prefixEntry.prefix)),
           thrift::KvStore_constants::kDefaultArea())
           .getPrefixKey();
-  for (const auto& area : areas_) {
+  for (const auto& area : getAdvertiseAreas(prefixEntry.prefix)) {
     bool const changed = kvStoreClient_->persistKey(
         prefixKey,
-        fbzmq::util::writeThriftObjStr(std::move(prefixDb), serializer_),
+        writeLsdbValue(prefixDb, serializer_, compactLsdbEncoding_),
         ttlKeyInKvStore_,
         area);
     LOG_IF(INFO, changed) << "Advertising key: " << prefixKey
@@ -227,47 +398,91 @@ PrefixManager::advertisePrefix(thrift::PrefixEntry& prefixEntry) {
   return prefixKey;
 }
 
+void
+PrefixManager::updateBestTypes() {
+  for (auto const& prefix : changedPrefixes_) {
+    // lowest prefix type is preferred, the others are covered by it
+    std::optional<thrift::PrefixType> bestType;
+    for (auto const& kv : prefixMap_) {
+      if (not kv.second.count(prefix)) {
+        continue;
+      }
+      if (bestType.has_value()) {
+        maybeAddEvent(
+            addingEvents_[kv.first][prefix], "COVERED_BY_HIGHER_TYPE");
+        continue;
+      }
+      maybeAddEvent(
+          addingEvents_[kv.first][prefix], "UPDATE_KVSTORE_THROTTLED");
+      bestType = kv.first;
+    }
+    if (bestType.has_value()) {
+      bestTypes_[prefix] = *bestType;
+    } else {
+      bestTypes_.erase(prefix);
+    }
+  }
+}
+
+void
+PrefixManager::updateKvStorePrefixKey(const thrift::IpPrefix& prefix) {
+  auto const it = bestTypes_.find(prefix);
+  if (it != bestTypes_.end()) {
+    auto const key = advertisePrefix(prefixMap_.at(it->second).at(prefix));
+    advertisedKeys_.emplace(key);
+    keysToClear_.erase(key);
+    return;
+  }
+  auto key = PrefixKey(
+                 nodeId_,
+                 folly::IPAddress::createNetwork(toString(prefix)),
+                 thrift::KvStore_constants::kDefaultArea())
+                 .getPrefixKey();
+  if (advertisedKeys_.erase(key)) {
+    keysToClear_.emplace(std::move(key));
+  }
+}
+
 void
 PrefixManager::updateKvStore() {
-  std::vector<std::pair<std::string, std::string>> keyVals;
-  std::unordered_set<std::string> nowAdvertisingKeys;
-  std::unordered_set<thrift::IpPrefix> nowAdvertisingPrefixes;
+  const auto activeSummaries = getActiveSummaries();
+  const bool summariesChanged = activeSummaries != advertisedSummaries_;
+  updateBestTypes();
   if (perPrefixKeys_) {
-    for (auto& kv : prefixMap_) {
-      for (auto& kv2 : kv.second) {
-        if (not nowAdvertisingPrefixes.count(kv2.first)) {
-          maybeAddEvent(
-              addingEvents_[kv.first][kv2.first], "UPDATE_KVSTORE_THROTTLED");
-          auto const key = advertisePrefix(kv2.second);
-          nowAdvertisingKeys.emplace(key);
-          nowAdvertisingPrefixes.emplace(kv2.first);
-          keysToClear_.erase(key);
-        } else {
-          maybeAddEvent(
-              addingEvents_[kv.first][kv2.first], "COVERED_BY_HIGHER_TYPE");
-        }
-      }
+    // keys of unchanged prefixes are already up to date
+    for (auto const& prefix : changedPrefixes_) {
+      updateKvStorePrefixKey(prefix);
     }
-  } else {
+    if (summariesChanged) {
+      updateKvStoreSummaryKeys(activeSummaries);
+    }
+  } else if (prefixesPerBucket_) {
+    // summaries of other areas are in keys of their own, as with per prefix
+    // keys, the specifics stay in the buckets
+    updateKvStorePrefixBuckets();
+    if (summariesChanged) {
+      updateKvStoreSummaryKeys(activeSummaries);
+    }
+  } else if (
+      not changedPrefixes_.empty() or summariesChanged or
+      not advertisedKeys_.count(folly::sformat(
+          "{}{}", static_cast<std::string>(prefixDbMarker_), nodeId_))) {
     thrift::PrefixDatabase prefixDb;
     prefixDb.thisNodeName = nodeId_;
+    prefixDb.prefixEntries.reserve(bestTypes_.size());
     thrift::PerfEvents* mostRecentEvents = nullptr;
-    for (auto& kv : prefixMap_) {
-      for (auto& kv2 : kv.second) {
-        if (not nowAdvertisingPrefixes.count(kv2.first)) {
-          maybeAddEvent(
-              addingEvents_[kv.first][kv2.first], "UPDATE_KVSTORE_THROTTLED");
-          if (nullptr == mostRecentEvents or
-              addingEvents_[kv.first][kv2.first].events.back().unixTs >
-                  mostRecentEvents->events.back().unixTs) {
-            mostRecentEvents = &addingEvents_[kv.first][kv2.first];
-          }
-          prefixDb.prefixEntries.emplace_back(kv2.second);
-          nowAdvertisingPrefixes.emplace(kv2.first);
-        } else {
-          maybeAddEvent(
-              addingEvents_[kv.first][kv2.first], "COVERED_BY_HIGHER_TYPE");
-        }
+    for (auto const& kv : bestTypes_) {
+      prefixDb.prefixEntries.emplace_back(
+          prefixMap_.at(kv.second).at(kv.first));
+      if (not enablePerfMeasurement_) {
+        continue;
+      }
+      auto& events = addingEvents_[kv.second][kv.first];
+      if (not events.events.empty() and
+          (nullptr == mostRecentEvents or
+           events.events.back().unixTs >
+               mostRecentEvents->events.back().unixTs)) {
+        mostRecentEvents = &events;
       }
     }
     if (enablePerfMeasurement_ and nullptr != mostRecentEvents) {
@@ -276,18 +491,42 @@ PrefixManager::updateKvStore() {
     const auto prefixDbKey = folly::sformat(
         "{}{}", static_cast<std::string>(prefixDbMarker_), nodeId_);
     for (const auto& area : areas_) {
+      // specifics of summaries stay in the area of the summary, while active
+      // summaries of the other areas are added
+      thrift::PrefixDatabase summarizedPrefixDb;
+      if (not summaries_.empty()) {
+        summarizedPrefixDb.thisNodeName = nodeId_;
+        summarizedPrefixDb.perfEvents = prefixDb.perfEvents;
+        for (const auto& entry : prefixDb.prefixEntries) {
+          const auto summary = findSummary(entry.prefix);
+          if (not summary.has_value() or summaries_.at(*summary).area == area) {
+            summarizedPrefixDb.prefixEntries.emplace_back(entry);
+          }
+        }
+        for (const auto i : activeSummaries) {
+          if (summaries_.at(i).area != area) {
+            summarizedPrefixDb.prefixEntries.emplace_back(createPrefixEntry(
+                summaries_.at(i).prefix, thrift::PrefixType::SUMMARY));
+          }
+        }
+      }
+      const auto& areaPrefixDb =
+          summaries_.empty() ? prefixDb : summarizedPrefixDb;
       bool const changed = kvStoreClient_->persistKey(
           prefixDbKey,
-          fbzmq::util::writeThriftObjStr(std::move(prefixDb), serializer_),
+          writeLsdbValue(areaPrefixDb, serializer_, compactLsdbEncoding_),
           ttlKeyInKvStore_,
           area);
       LOG_IF(INFO, changed)
-          << "Updating all " << prefixDb.prefixEntries.size()
+          << "Updating all " << areaPrefixDb.prefixEntries.size()
           << " prefixes in KvStore " << prefixDbKey << " area: " << area;
     }
-    nowAdvertisingKeys.emplace(prefixDbKey);
+    advertisedKeys_.emplace(prefixDbKey);
     keysToClear_.erase(prefixDbKey);
   }
+  changedPrefixes_.clear();
+  advertisedSummaries_ = activeSummaries;
+
   thrift::PrefixDatabase deletedPrefixDb;
   deletedPrefixDb.thisNodeName = nodeId_;
   deletedPrefixDb.deletePrefix = true;
@@ -309,15 +548,13 @@ PrefixManager::updateKvStore() {
       // then the key should ttl out
       kvStoreClient_->clearKey(
           key,
-          fbzmq::util::writeThriftObjStr(
-              std::move(deletedPrefixDb), serializer_),
+          writeLsdbValue(deletedPrefixDb, serializer_, compactLsdbEncoding_),
           ttlKeyInKvStore_,
           area);
     }
   }
 
-  // anything we don't advertise next time, we need to clear
-  keysToClear_ = std::move(nowAdvertisingKeys);
+  keysToClear_.clear();
 
   // Update flat counters
   size_t num_prefixes = 0;
@@ -328,6 +565,271 @@ PrefixManager::updateKvStore() {
     num_prefixes += kv.second.size();
   }
   fb303::fbData->setCounter("prefix_manager.num_prefixes", num_prefixes);
+  fb303::fbData->setCounter(
+      "prefix_manager.num_active_summaries", advertisedSummaries_.size());
+}
+
+size_t
+PrefixManager::getPrefixBucket(
+    const thrift::IpPrefix& prefix, size_t numBuckets) {
+  // mixed, low bits of hashes of addresses are alike
+  return folly::hash::twang_mix64(std::hash<thrift::IpPrefix>()(prefix)) &
+      (numBuckets - 1);
+}
+
+void
+PrefixManager::updateKvStorePrefixBuckets() {
+  const auto numPrefixes = bestTypes_.size();
+  size_t numBuckets = std::max<size_t>(buckets_.size(), 1);
+  while (numBuckets < Constants::kPrefixMgrMaxPrefixBuckets and
+         numPrefixes > numBuckets * prefixesPerBucket_) {
+    numBuckets *= 2;
+  }
+  while (numBuckets > 1 and
+         numPrefixes * 4 < numBuckets * prefixesPerBucket_) {
+    numBuckets /= 2;
+  }
+
+  std::set<size_t> dirtyBuckets;
+  if (numBuckets != buckets_.size()) {
+    LOG(INFO) << "Advertising " << numPrefixes << " prefixes in " << numBuckets
+              << " bucket keys, previously " << buckets_.size();
+    for (size_t i = numBuckets; i < buckets_.size(); ++i) {
+      auto key = createPrefixBucketKey(
+          static_cast<std::string>(prefixDbMarker_), nodeId_, i);
+      if (advertisedKeys_.erase(key)) {
+        keysToClear_.emplace(std::move(key));
+      }
+    }
+    buckets_.assign(numBuckets, {});
+    for (auto const& kv : bestTypes_) {
+      buckets_.at(getPrefixBucket(kv.first, numBuckets)).emplace(kv.first);
+    }
+    for (size_t i = 0; i < numBuckets; ++i) {
+      dirtyBuckets.emplace(i);
+    }
+  } else {
+    for (auto const& prefix : changedPrefixes_) {
+      const auto bucket = getPrefixBucket(prefix, numBuckets);
+      if (bestTypes_.count(prefix)) {
+        buckets_.at(bucket).emplace(prefix);
+      } else {
+        buckets_.at(bucket).erase(prefix);
+      }
+      dirtyBuckets.emplace(bucket);
+    }
+  }
+
+  for (const auto bucket : dirtyBuckets) {
+    thrift::PrefixDatabase prefixDb;
+    prefixDb.thisNodeName = nodeId_;
+    prefixDb.prefixEntries.reserve(buckets_.at(bucket).size());
+    thrift::PerfEvents* mostRecentEvents = nullptr;
+    for (auto const& prefix : buckets_.at(bucket)) {
+      const auto type = bestTypes_.at(prefix);
+      prefixDb.prefixEntries.emplace_back(prefixMap_.at(type).at(prefix));
+      if (not enablePerfMeasurement_) {
+        continue;
+      }
+      auto& events = addingEvents_[type][prefix];
+      if (not events.events.empty() and
+          (nullptr == mostRecentEvents or
+           events.events.back().unixTs >
+               mostRecentEvents->events.back().unixTs)) {
+        mostRecentEvents = &events;
+      }
+    }
+    if (enablePerfMeasurement_ and nullptr != mostRecentEvents) {
+      prefixDb.perfEvents = *mostRecentEvents;
+    }
+    const auto key = createPrefixBucketKey(
+        static_cast<std::string>(prefixDbMarker_), nodeId_, bucket);
+    for (const auto& area : areas_) {
+      // specifics of summaries stay in the area of the summary
+      thrift::PrefixDatabase areaPrefixDb;
+      areaPrefixDb.thisNodeName = nodeId_;
+      areaPrefixDb.perfEvents = prefixDb.perfEvents;
+      for (const auto& entry : prefixDb.prefixEntries) {
+        const auto summary = findSummary(entry.prefix);
+        if (not summary.has_value() or summaries_.at(*summary).area == area) {
+          areaPrefixDb.prefixEntries.emplace_back(entry);
+        }
+      }
+      bool const changed = kvStoreClient_->persistKey(
+          key,
+          writeLsdbValue(areaPrefixDb, serializer_, compactLsdbEncoding_),
+          ttlKeyInKvStore_,
+          area);
+      LOG_IF(INFO, changed)
+          << "Updating " << areaPrefixDb.prefixEntries.size()
+          << " prefixes in KvStore " << key << " area: " << area;
+    }
+    advertisedKeys_.emplace(key);
+    keysToClear_.erase(key);
+  }
+}
+
+void
+PrefixManager::updateKvStoreSummaryKeys(
+    const std::set<size_t>& activeSummaries) {
+  for (size_t i = 0; i < summaries_.size(); ++i) {
+    const bool isActive = activeSummaries.count(i);
+    if (isActive == static_cast<bool>(advertisedSummaries_.count(i))) {
+      continue;
+    }
+    const auto& summary = summaries_.at(i);
+    const auto key = PrefixKey(
+                         nodeId_,
+                         summary.network,
+                         thrift::KvStore_constants::kDefaultArea())
+                         .getPrefixKey();
+    thrift::PrefixDatabase prefixDb;
+    prefixDb.thisNodeName = nodeId_;
+    prefixDb.prefixEntries.emplace_back(
+        createPrefixEntry(summary.prefix, thrift::PrefixType::SUMMARY));
+    prefixDb.deletePrefix = not isActive;
+    const auto value =
+        writeLsdbValue(prefixDb, serializer_, compactLsdbEncoding_);
+    for (const auto& area : areas_) {
+      if (area == summary.area) {
+        continue;
+      }
+      if (isActive) {
+        LOG(INFO) << "Advertising summary key: " << key
+                  << " to KvStore area: " << area;
+        kvStoreClient_->persistKey(key, value, ttlKeyInKvStore_, area);
+      } else {
+        LOG(INFO) << "Withdrawing summary key: " << key
+                  << " from KvStore area: " << area;
+        kvStoreClient_->clearKey(key, value, ttlKeyInKvStore_, area);
+      }
+    }
+    if (isActive) {
+      advertisedKeys_.emplace(key);
+      keysToClear_.erase(key);
+    } else {
+      advertisedKeys_.erase(key);
+    }
+  }
+}
+
+std::optional<size_t>
+PrefixManager::findSummary(const thrift::IpPrefix& prefix) const {
+  for (size_t i = 0; i < summaries_.size(); ++i) {
+    if (isMoreSpecific(prefix, summaries_[i].network)) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+std::vector<std::string>
+PrefixManager::getAdvertiseAreas(const thrift::IpPrefix& prefix) const {
+  const auto summary = findSummary(prefix);
+  if (summary.has_value()) {
+    return {summaries_.at(*summary).area};
+  }
+  return {areas_.begin(), areas_.end()};
+}
+
+std::set<size_t>
+PrefixManager::getActiveSummaries() const {
+  std::set<size_t> activeSummaries;
+  if (summaries_.empty()) {
+    return activeSummaries;
+  }
+  for (size_t i = 0; i < summaries_.size(); ++i) {
+    if (not remoteContributors_.at(i).empty()) {
+      activeSummaries.emplace(i);
+    }
+  }
+  std::unordered_set<thrift::IpPrefix> ownPrefixes;
+  for (const auto& kv : prefixMap_) {
+    if (kv.first == thrift::PrefixType::SUMMARY) {
+      continue;
+    }
+    for (const auto& kv2 : kv.second) {
+      ownPrefixes.emplace(kv2.first);
+      const auto summary = findSummary(kv2.first);
+      if (summary.has_value()) {
+        activeSummaries.emplace(*summary);
+      }
+    }
+  }
+  // summaries originated by this node as prefixes of their own are not
+  // advertised twice
+  for (size_t i = 0; i < summaries_.size(); ++i) {
+    if (ownPrefixes.count(summaries_[i].prefix)) {
+      activeSummaries.erase(i);
+    }
+  }
+  return activeSummaries;
+}
+
+void
+PrefixManager::processPublication(thrift::Publication const& publication) {
+  std::string area{thrift::KvStore_constants::kDefaultArea()};
+  if (publication.area.has_value()) {
+    area = publication.area.value();
+  }
+  bool changed{false};
+  auto updateContributors = [&](size_t i, std::string const& key, size_t n) {
+    auto& contributors = remoteContributors_.at(i);
+    const bool wasActive = not contributors.empty();
+    if (n) {
+      contributors[key] = n;
+    } else {
+      contributors.erase(key);
+    }
+    const bool isActive = not contributors.empty();
+    changed |= wasActive != isActive;
+  };
+
+  for (const auto& [key, value] : publication.keyVals) {
+    if (key.find(static_cast<std::string>(prefixDbMarker_)) != 0 or
+        not value.value.has_value()) {
+      continue;
+    }
+    thrift::PrefixDatabase prefixDb;
+    try {
+      prefixDb = readLsdbValue<thrift::PrefixDatabase>(
+          value.value.value(), serializer_);
+    } catch (std::exception const& e) {
+      LOG(ERROR) << "Failed to read prefix db of key " << key << ": "
+                 << folly::exceptionStr(e);
+      continue;
+    }
+    if (prefixDb.thisNodeName == nodeId_) {
+      continue;
+    }
+    for (size_t i = 0; i < summaries_.size(); ++i) {
+      if (summaries_[i].area != area) {
+        continue;
+      }
+      // summaries of other border nodes don't contribute
+      size_t numContributors{0};
+      if (not prefixDb.deletePrefix) {
+        for (const auto& entry : prefixDb.prefixEntries) {
+          if (entry.type != thrift::PrefixType::SUMMARY and
+              isMoreSpecific(entry.prefix, summaries_[i].network)) {
+            ++numContributors;
+          }
+        }
+      }
+      updateContributors(i, key, numContributors);
+    }
+  }
+  for (const auto& key : publication.expiredKeys) {
+    for (size_t i = 0; i < summaries_.size(); ++i) {
+      if (summaries_[i].area == area) {
+        updateContributors(i, key, 0);
+      }
+    }
+  }
+
+  if (changed) {
+    outputStateThrottled_->operator()();
+  }
 }
 
 folly::SemiFuture<bool>
@@ -380,6 +882,65 @@ PrefixManager::syncPrefixesByType(
   return sf;
 }
 
+folly::SemiFuture<folly::Unit>
+PrefixManager::beginSyncPrefixesByType(thrift::PrefixType prefixType) {
+  folly::Promise<folly::Unit> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([this, p = std::move(p), prefixType]() mutable noexcept {
+    LOG(INFO) << "Beginning sync of prefixes of type: "
+              << getPrefixTypeName(prefixType);
+    prefixSyncs_[prefixType] = PrefixSync();
+    p.setValue();
+  });
+  return sf;
+}
+
+folly::SemiFuture<bool>
+PrefixManager::addSyncPrefixesByType(
+    thrift::PrefixType prefixType, std::vector<thrift::PrefixEntry> prefixes) {
+  folly::Promise<bool> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([
+    this,
+    p = std::move(p),
+    prefixType,
+    prefixes = std::move(prefixes)
+  ]() mutable noexcept {
+    if (not prefixSyncs_.count(prefixType)) {
+      p.setException(std::invalid_argument(
+          "No sync in progress of type " + getPrefixTypeName(prefixType)));
+      return;
+    }
+    for (auto const& entry : prefixes) {
+      if (entry.type != prefixType) {
+        p.setException(std::invalid_argument(folly::sformat(
+            "Prefix {} of type {} in sync of type {}",
+            toString(entry.prefix),
+            getPrefixTypeName(entry.type),
+            getPrefixTypeName(prefixType))));
+        return;
+      }
+    }
+    p.setValue(addSyncPrefixes(prefixType, std::move(prefixes)));
+  });
+  return sf;
+}
+
+folly::SemiFuture<bool>
+PrefixManager::commitSyncPrefixesByType(thrift::PrefixType prefixType) {
+  folly::Promise<bool> p;
+  auto sf = p.getSemiFuture();
+  runInEventBaseThread([this, p = std::move(p), prefixType]() mutable noexcept {
+    if (not prefixSyncs_.count(prefixType)) {
+      p.setException(std::invalid_argument(
+          "No sync in progress of type " + getPrefixTypeName(prefixType)));
+      return;
+    }
+    p.setValue(commitSyncPrefixes(prefixType));
+  });
+  return sf;
+}
+
 folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
 PrefixManager::getPrefixes() {
   folly::Promise<std::unique_ptr<std::vector<thrift::PrefixEntry>>> p;
@@ -429,6 +990,8 @@ PrefixManager::addOrUpdatePrefixes(
     auto it = prefixes.find(prefixEntry.prefix);
     if (it == prefixes.end() or it->second != prefixEntry) {
       prefixes[prefixEntry.prefix] = prefixEntry;
+      changedPrefixes_.emplace(prefixEntry.prefix);
+      dirtyPersistTypes_.emplace(prefixEntry.type);
       addPerfEvent(
           addingEvents_[prefixEntry.type][prefixEntry.prefix],
           nodeId_,
@@ -439,7 +1002,7 @@ PrefixManager::addOrUpdatePrefixes(
     }
   }
   if (updated) {
-    persistPrefixDb();
+    schedulePersistPrefixDb();
     outputStateThrottled_->operator()();
   }
   return updated;
@@ -460,6 +1023,8 @@ PrefixManager::removePrefixes(
   for (const auto& prefix : prefixes) {
     prefixMap_.at(prefix.type).erase(prefix.prefix);
     addingEvents_.at(prefix.type).erase(prefix.prefix);
+    changedPrefixes_.emplace(prefix.prefix);
+    dirtyPersistTypes_.emplace(prefix.type);
     SYSLOG(INFO) << "Withdrawing prefix: " << toString(prefix.prefix)
                  << ", client: " << getPrefixTypeName(prefix.type);
     if (prefixMap_[prefix.type].empty()) {
@@ -470,7 +1035,7 @@ PrefixManager::removePrefixes(
     }
   }
   if (!prefixes.empty()) {
-    persistPrefixDb();
+    schedulePersistPrefixDb();
     outputStateThrottled_->operator()();
   }
   return !prefixes.empty();
@@ -501,16 +1066,98 @@ PrefixManager::syncPrefixes(
   return updated;
 }
 
+bool
+PrefixManager::addSyncPrefixes(
+    thrift::PrefixType type, std::vector<thrift::PrefixEntry>&& prefixEntries) {
+  auto& sync = prefixSyncs_.at(type);
+  auto& prefixes = prefixMap_[type];
+  size_t numUpdated{0};
+  for (auto& prefixEntry : prefixEntries) {
+    sync.prefixes.emplace(prefixEntry.prefix);
+    auto it = prefixes.find(prefixEntry.prefix);
+    if (it != prefixes.end() and it->second == prefixEntry) {
+      continue;
+    }
+    addPerfEvent(
+        addingEvents_[type][prefixEntry.prefix],
+        nodeId_,
+        it == prefixes.end() ? "ADD_PREFIX" : "UPDATE_PREFIX");
+    changedPrefixes_.emplace(prefixEntry.prefix);
+    VLOG(2) << "Advertising prefix: " << toString(prefixEntry.prefix)
+            << ", client: " << getPrefixTypeName(type);
+    auto prefix = prefixEntry.prefix;
+    prefixes[std::move(prefix)] = std::move(prefixEntry);
+    ++numUpdated;
+  }
+  if (prefixes.empty()) {
+    prefixMap_.erase(type);
+  }
+
+  LOG(INFO) << "Synced " << prefixEntries.size() << " prefixes of type: "
+            << getPrefixTypeName(type) << ", " << numUpdated << " updated";
+  if (numUpdated) {
+    sync.updated = true;
+    dirtyPersistTypes_.emplace(type);
+    outputStateThrottled_->operator()();
+  }
+  return numUpdated != 0;
+}
+
+bool
+PrefixManager::commitSyncPrefixes(thrift::PrefixType type) {
+  auto sync = std::move(prefixSyncs_.at(type));
+  prefixSyncs_.erase(type);
+
+  size_t numRemoved{0};
+  auto search = prefixMap_.find(type);
+  if (search != prefixMap_.end()) {
+    auto& prefixes = search->second;
+    for (auto it = prefixes.begin(); it != prefixes.end();) {
+      if (sync.prefixes.count(it->first)) {
+        ++it;
+        continue;
+      }
+      VLOG(2) << "Withdrawing prefix: " << toString(it->first)
+              << ", client: " << getPrefixTypeName(type);
+      changedPrefixes_.emplace(it->first);
+      addingEvents_[type].erase(it->first);
+      it = prefixes.erase(it);
+      ++numRemoved;
+    }
+    if (prefixes.empty()) {
+      prefixMap_.erase(search);
+    }
+    if (addingEvents_[type].empty()) {
+      addingEvents_.erase(type);
+    }
+  }
+
+  LOG(INFO) << "Committed sync of " << sync.prefixes.size()
+            << " prefixes of type: " << getPrefixTypeName(type) << ", "
+            << numRemoved << " withdrawn";
+  if (not sync.updated and numRemoved == 0) {
+    return false;
+  }
+  dirtyPersistTypes_.emplace(type);
+  schedulePersistPrefixDb();
+  outputStateThrottled_->operator()();
+  return true;
+}
+
 bool
 PrefixManager::removePrefixesByType(thrift::PrefixType type) {
   bool changed = false;
   auto const search = prefixMap_.find(type);
   if (search != prefixMap_.end()) {
     changed = true;
+    for (auto const& kv : search->second) {
+      changedPrefixes_.emplace(kv.first);
+    }
     prefixMap_.erase(search);
+    dirtyPersistTypes_.emplace(type);
   }
   if (changed) {
-    persistPrefixDb();
+    schedulePersistPrefixDb();
     outputStateThrottled_->operator()();
   }
   return changed;
@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <optional>
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqThrottle.h>
@@ -17,6 +20,7 @@
 #include <folly/Optional.h>
 #include <folly/futures/Future.h>
 
+#include <openr/common/Constants.h>
 #include <openr/common/OpenrEventBase.h>
 #include <openr/common/Util.h>
 #include <openr/config-store/PersistentStore.h>
@@ -28,6 +32,11 @@
 
 namespace openr {
 
+// summary ranges of the prefixes of each area
+using AreaSummaries = std::unordered_map<
+    std::string /* area */,
+    std::vector<thrift::IpPrefix>>;
+
 class PrefixManager final : public OpenrEventBase {
  public:
   PrefixManager(
@@ -42,7 +51,26 @@ class PrefixManager final : public OpenrEventBase {
       const std::chrono::seconds prefixHoldTime,
       const std::chrono::milliseconds ttlKeyInKvStore,
       const std::unordered_set<std::string>& area = {
-          openr::thrift::KvStore_constants::kDefaultArea()});
+          openr::thrift::KvStore_constants::kDefaultArea()},
+      // debounce and max delay of persisting prefix db changes. Debounce zero
+      // is used during testing to persist inline and wait for the store
+      const std::chrono::milliseconds persistDebounce =
+          Constants::kPrefixMgrPersistDebounce,
+      const std::chrono::milliseconds persistMaxDelay =
+          Constants::kPrefixMgrPersistMaxDelay,
+      // advertise prefix databases in the compact encoding
+      bool compactLsdbEncoding = false,
+      // summary ranges of areas, advertised by this node at the border of
+      // an area into its other areas, see summaries_
+      const AreaSummaries& areaSummaries = {},
+      // publications of KvStore, to learn the contributors of summaries
+      // originated by other nodes of an area
+      std::optional<messaging::RQueue<KvStorePublication>>
+          kvStoreUpdatesQueue = std::nullopt,
+      // advertise prefixes in hash buckets of about this many prefixes each,
+      // one key per bucket, instead of the single prefix db key. Zero
+      // disables, per prefix keys take precedence
+      size_t prefixesPerBucket = 0);
 
   ~PrefixManager();
 
@@ -71,6 +99,23 @@ class PrefixManager final : public OpenrEventBase {
   folly::SemiFuture<bool> syncPrefixesByType(
       thrift::PrefixType prefixType, std::vector<thrift::PrefixEntry> prefixes);
 
+  /*
+   * Sync prefixes by type in chunks, for large sets of prefixes. Chunks are
+   * applied as they arrive, prefixes of type left out of all chunks get
+   * withdrawn on commit. The prefix db is persisted once on commit.
+   *
+   * Beginning a sync of a type drops any sync of it still in progress. Adding
+   * or committing without sync in progress fails with std::invalid_argument
+   */
+  folly::SemiFuture<folly::Unit> beginSyncPrefixesByType(
+      thrift::PrefixType prefixType);
+
+  folly::SemiFuture<bool> addSyncPrefixesByType(
+      thrift::PrefixType prefixType, std::vector<thrift::PrefixEntry> prefixes);
+
+  folly::SemiFuture<bool> commitSyncPrefixesByType(
+      thrift::PrefixType prefixType);
+
   folly::SemiFuture<std::unique_ptr<std::vector<thrift::PrefixEntry>>>
   getPrefixes();
 
@@ -79,15 +124,35 @@ class PrefixManager final : public OpenrEventBase {
 
  private:
   void outputState();
-  // Update persistent store with non-ephemeral prefix entries
+  // Schedule persisting non-ephemeral entries of dirtyPersistTypes_,
+  // debounced by persistDebounce_ up to persistMaxDelay_
+  void schedulePersistPrefixDb();
+  // Update persistent store with non-ephemeral entries of dirtyPersistTypes_,
+  // one record per prefix type
   void persistPrefixDb();
 
-  // Update kvstore with both ephemeral and non-ephemeral prefixes
+  // Update kvstore with both ephemeral and non-ephemeral prefixes. With per
+  // prefix keys only those of changedPrefixes_ are advertised or withdrawn
   void updateKvStore();
 
+  // advertise the preferred entry of prefix in its key, or withdraw the key
+  // if there is none
+  void updateKvStorePrefixKey(const thrift::IpPrefix& prefix);
+
+  // update bestTypes_ for changedPrefixes_, the other prefixes keep theirs
+  void updateBestTypes();
+
   // update all IP keys in KvStore
   void updateKvStorePrefixKeys();
 
+  // size buckets_ for the number of advertised prefixes, and advertise the
+  // keys of buckets with changedPrefixes_, or all of them once resized
+  void updateKvStorePrefixBuckets();
+
+  // bucket of prefix out of numBuckets, a power of two
+  static size_t getPrefixBucket(
+      const thrift::IpPrefix& prefix, size_t numBuckets);
+
   // helpers to modify prefix db, returns true if the db is modified
   bool addOrUpdatePrefixes(const std::vector<thrift::PrefixEntry>& prefixes);
   bool removePrefixes(const std::vector<thrift::PrefixEntry>& prefixes);
@@ -97,9 +162,33 @@ class PrefixManager final : public OpenrEventBase {
       thrift::PrefixType type,
       const std::vector<thrift::PrefixEntry>& prefixes);
 
+  // add or update a chunk of prefixes of an ongoing sync, without persisting
+  bool addSyncPrefixes(
+      thrift::PrefixType type, std::vector<thrift::PrefixEntry>&& prefixes);
+  // remove prefixes of type not synced since begin, and persist
+  bool commitSyncPrefixes(thrift::PrefixType type);
+
   // add prefix entry in kvstore, return per prefix key name
   std::string advertisePrefix(thrift::PrefixEntry& prefixEntry);
 
+  // track the contributors of summaries among the prefixes of other nodes
+  void processPublication(thrift::Publication const& publication);
+
+  // index of the summary of an area covering prefix, if any
+  std::optional<size_t> findSummary(const thrift::IpPrefix& prefix) const;
+
+  // areas to advertise prefix into, specifics of summaries are kept in the
+  // area of their summary
+  std::vector<std::string> getAdvertiseAreas(
+      const thrift::IpPrefix& prefix) const;
+
+  // summaries having contributors, by index
+  std::set<size_t> getActiveSummaries() const;
+
+  // advertise keys of newly active summaries and withdraw those of inactive
+  // ones, in the areas of the summaries other than their own
+  void updateKvStoreSummaryKeys(const std::set<size_t>& activeSummaries);
+
   // add event named updateEvent to perfEvents if it has value and the last
   // element is not already updateEvent
   void maybeAddEvent(
@@ -114,14 +203,38 @@ class PrefixManager final : public OpenrEventBase {
   // module ptr to interact with KvStore
   KvStore* kvStore_{nullptr};
 
-  // keep track of prefixDB on disk
-  thrift::PrefixDatabase diskState_;
+  // keep track of prefixDB on disk, per prefix type
+  std::unordered_map<thrift::PrefixType, thrift::PrefixDatabase> diskState_;
+
+  // prefix types whose entries changed since the last persistPrefixDb()
+  std::unordered_set<thrift::PrefixType> dirtyPersistTypes_;
+
+  // prefix db was loaded from the legacy single record, erase it once the
+  // per type records are persisted
+  bool eraseLegacyConfig_{false};
+
+  const std::chrono::milliseconds persistDebounce_;
+  const std::chrono::milliseconds persistMaxDelay_;
+
+  // timer to persist prefix db, and the latest time it is allowed to fire
+  std::unique_ptr<fbzmq::ZmqTimeout> persistPrefixDbTimer_;
+  std::chrono::steady_clock::time_point persistDeadline_;
 
   const PrefixDbMarker prefixDbMarker_;
 
+  // advertise prefix databases in the compact encoding, see LsdbEncoding.h
+  const bool compactLsdbEncoding_{false};
+
   // create IP keys
   bool perPrefixKeys_{false};
 
+  // prefixes per bucket key, zero to not bucket prefixes
+  const size_t prefixesPerBucket_{0};
+
+  // advertised prefixes of each bucket key. Buckets are doubled once full
+  // and halved once a quarter full, to not flap around a boundary
+  std::vector<std::unordered_set<thrift::IpPrefix>> buckets_;
+
   // enable convergence performance measurement for Adjacencies update
   const bool enablePerfMeasurement_{false};
 
@@ -153,6 +266,25 @@ class PrefixManager final : public OpenrEventBase {
   // anything we no longer wish to advertise
   std::unordered_set<std::string> keysToClear_;
 
+  // keys currently advertised to KvStore
+  std::unordered_set<std::string> advertisedKeys_;
+
+  // prefixes whose entries changed since the last updateKvStore()
+  std::unordered_set<thrift::IpPrefix> changedPrefixes_;
+
+  // preferred, i.e. lowest, type of each prefix in prefixMap_, whose entry
+  // gets advertised. Only changed prefixes are looked up again
+  std::unordered_map<thrift::IpPrefix, thrift::PrefixType> bestTypes_;
+
+  // chunked syncs in progress, see beginSyncPrefixesByType()
+  struct PrefixSync {
+    // prefixes synced so far
+    std::unordered_set<thrift::IpPrefix> prefixes;
+    // prefix db changed by the sync
+    bool updated{false};
+  };
+  std::unordered_map<thrift::PrefixType, PrefixSync> prefixSyncs_;
+
   // perfEvents related to a given prefisEntry
   std::unordered_map<
       thrift::PrefixType,
@@ -161,6 +293,27 @@ class PrefixManager final : public OpenrEventBase {
 
   // area Id
   const std::unordered_set<std::string> areas_{};
+
+  // Summaries of areas of this node, if it is at the border of several areas.
+  // A summary is active and advertised into the other areas of this node
+  // while any more specific prefix of its area contributes to it, i.e. is
+  // advertised by this or any other node into the area. Specifics of this
+  // node covered by a summary are advertised into the area of the summary
+  // only.
+  struct Summary {
+    std::string area;
+    thrift::IpPrefix prefix;
+    folly::CIDRNetwork network;
+  };
+  std::vector<Summary> summaries_;
+
+  // contributors of summaries advertised by other nodes, by index of the
+  // summary and key of their prefix db
+  std::vector<std::unordered_map<std::string /* key */, size_t>>
+      remoteContributors_;
+
+  // summaries currently advertised, by index
+  std::set<size_t> advertisedSummaries_;
 }; // PrefixManager
 
 } // namespace openr
@@ -5,6 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <set>
+
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Format.h>
 #include <glog/logging.h>
@@ -75,6 +77,10 @@ const auto persistentPrefixEntry10 = createPrefixEntry(
     thrift::PrefixForwardingType::IP,
     thrift::PrefixForwardingAlgorithm::SP_ECMP,
     false);
+std::string
+getConfigKey(const std::string& typeName) {
+  return folly::sformat("prefix-manager-config:{}", typeName);
+}
 } // namespace
 
 class PrefixManagerTestFixture : public testing::TestWithParam<bool> {
@@ -119,7 +125,10 @@ class PrefixManagerTestFixture : public testing::TestWithParam<bool> {
         perPrefixKeys_ /* per prefix keys */,
         true /* prefix-mananger perf measurement */,
         std::chrono::seconds{0},
-        Constants::kKvStoreDbTtl);
+        Constants::kKvStoreDbTtl,
+        {thrift::KvStore_constants::kDefaultArea()},
+        std::chrono::milliseconds(0) /* persist inline */,
+        std::chrono::milliseconds(0));
 
     prefixManagerThread = std::make_unique<std::thread>([this]() {
       LOG(INFO) << "PrefixManager thread starting";
@@ -148,6 +157,9 @@ class PrefixManagerTestFixture : public testing::TestWithParam<bool> {
 
     // Erase data from config store
     configStore->erase("prefix-manager-config").get();
+    for (const auto& kv : thrift::_PrefixType_VALUES_TO_NAMES) {
+      configStore->erase(getConfigKey(kv.second)).get();
+    }
 
     // stop config store
     configStore->stop();
@@ -653,6 +665,86 @@ TEST_P(PrefixManagerTestFixture, PrefixKeyUpdates) {
   waitBaton.wait();
 }
 
+/**
+ * Test that the key of a prefix advertised by several types follows the
+ * preferred entry, as entries of the prefix change
+ */
+TEST_P(PrefixManagerTestFixture, PrefixKeyCoveredTypes) {
+  // test only if 'create ip prefixes' is enabled
+  if (!perPrefixKeys_) {
+    return;
+  }
+
+  folly::Baton waitBaton;
+  int waitDuration{0};
+
+  const auto bgpPrefixEntry1 =
+      createPrefixEntry(addr1, thrift::PrefixType::BGP);
+  const auto prefixKeyStr =
+      PrefixKey(
+          "node-1",
+          folly::IPAddress::createNetwork(toString(addr1)),
+          thrift::KvStore_constants::kDefaultArea())
+          .getPrefixKey();
+
+  kvStoreClient = std::make_unique<KvStoreClientInternal>(
+      &evl, "node-1", kvStoreWrapper->getKvStore());
+
+  auto getPrefixDb = [&]() {
+    auto maybeValue = kvStoreClient->getKey(prefixKeyStr);
+    EXPECT_TRUE(maybeValue.has_value());
+    return fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
+        maybeValue.value().value.value(), serializer);
+  };
+
+  evl.scheduleTimeout(
+      std::chrono::milliseconds(waitDuration += 0), [&]() noexcept {
+        prefixManager->advertisePrefixes({prefixEntry1, bgpPrefixEntry1})
+            .get();
+      });
+
+  // DEFAULT type is preferred over BGP
+  evl.scheduleTimeout(
+      std::chrono::milliseconds(
+          waitDuration += 2 * Constants::kPrefixMgrKvThrottleTimeout.count()),
+      [&]() noexcept {
+        auto db = getPrefixDb();
+        ASSERT_EQ(1, db.prefixEntries.size());
+        EXPECT_EQ(prefixEntry1, db.prefixEntries.at(0));
+        prefixManager->withdrawPrefixes({prefixEntry1}).get();
+      });
+
+  // BGP entry takes over
+  evl.scheduleTimeout(
+      std::chrono::milliseconds(
+          waitDuration += 2 * Constants::kPrefixMgrKvThrottleTimeout.count()),
+      [&]() noexcept {
+        auto db = getPrefixDb();
+        EXPECT_FALSE(db.deletePrefix);
+        ASSERT_EQ(1, db.prefixEntries.size());
+        EXPECT_EQ(bgpPrefixEntry1, db.prefixEntries.at(0));
+        prefixManager->withdrawPrefixesByType(thrift::PrefixType::BGP).get();
+      });
+
+  // no entry left, key is withdrawn
+  evl.scheduleTimeout(
+      std::chrono::milliseconds(
+          waitDuration += 2 * Constants::kPrefixMgrKvThrottleTimeout.count()),
+      [&]() noexcept {
+        EXPECT_TRUE(getPrefixDb().deletePrefix);
+
+        // Synchronization primitive
+        waitBaton.post();
+      });
+
+  // Start the event loop and wait until it is finished execution.
+  evlThread = std::thread([&]() { evl.run(); });
+  evl.waitUntilRunning();
+
+  // Synchronization primitive
+  waitBaton.wait();
+}
+
 /**
  * Test prefix key subscription callback from Kvstore client.
  * The test verifies the callback takes the action that reflects the current
@@ -1064,6 +1156,248 @@ TEST(PrefixManagerTest, HoldTimeout) {
   configStoreThread.join();
 }
 
+/**
+ * Border node of areas a1 and a2 with a summary of a1. Specifics of the node
+ * within the summary stay in a1, and the summary is advertised into a2 while
+ * there are contributors of this or other nodes.
+ */
+TEST(PrefixManagerTest, AreaSummaries) {
+  fbzmq::Context context;
+  messaging::ReplicateQueue<thrift::PrefixUpdateRequest> prefixUpdatesQueue;
+  CompactSerializer serializer;
+  const std::unordered_set<std::string> areas{"a1", "a2"};
+  const auto summary = toIpPrefix("10.1.0.0/16");
+  const auto specific = createPrefixEntry(toIpPrefix("10.1.1.1/32"));
+  const auto other = createPrefixEntry(toIpPrefix("10.2.0.1/32"));
+
+  auto configStore = std::make_unique<PersistentStore>(
+      "1",
+      folly::sformat(
+          "/tmp/pm_ut_config_store.bin.{}",
+          std::hash<std::thread::id>{}(std::this_thread::get_id())),
+      context,
+      true);
+  std::thread configStoreThread([&]() noexcept { configStore->run(); });
+  configStore->waitUntilRunning();
+
+  auto kvStoreWrapper = std::make_unique<KvStoreWrapper>(
+      context,
+      "test_store1",
+      std::chrono::seconds(1) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{},
+      std::nullopt,
+      std::nullopt,
+      Constants::kTtlDecrement,
+      false,
+      false,
+      areas);
+  kvStoreWrapper->run();
+
+  auto prefixManager = std::make_unique<PrefixManager>(
+      "node-1",
+      prefixUpdatesQueue.getReader(),
+      configStore.get(),
+      kvStoreWrapper->getKvStore(),
+      PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+      false /* create IP prefix keys */,
+      false /* prefix-mananger perf measurement */,
+      std::chrono::seconds{0},
+      Constants::kKvStoreDbTtl,
+      areas,
+      std::chrono::milliseconds(0) /* persist inline */,
+      std::chrono::milliseconds(0),
+      false /* compact lsdb encoding */,
+      AreaSummaries{{"a1", {summary}}},
+      kvStoreWrapper->getReader());
+  std::thread prefixManagerThread([&]() { prefixManager->run(); });
+  prefixManager->waitUntilRunning();
+
+  // prefixes advertised by node-1 into area, eventually
+  auto expectPrefixes = [&](std::string const& area,
+                            std::set<thrift::IpPrefix> const& expected) {
+    std::set<thrift::IpPrefix> prefixes;
+    for (int i = 0; i < 100; ++i) {
+      prefixes.clear();
+      auto value = kvStoreWrapper->getKey("prefix:node-1", area);
+      if (value.has_value() and value->value.has_value()) {
+        const auto prefixDb =
+            fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
+                value->value.value(), serializer);
+        for (auto const& entry : prefixDb.prefixEntries) {
+          prefixes.emplace(entry.prefix);
+        }
+      }
+      if (prefixes == expected) {
+        return;
+      }
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    EXPECT_EQ(expected, prefixes) << "area " << area;
+  };
+
+  // specific of this node contributes
+  EXPECT_TRUE(prefixManager->advertisePrefixes({specific, other}).get());
+  expectPrefixes("a1", {specific.prefix, other.prefix});
+  expectPrefixes("a2", {summary, other.prefix});
+
+  // no contributors left
+  EXPECT_TRUE(prefixManager->withdrawPrefixes({specific}).get());
+  expectPrefixes("a1", {other.prefix});
+  expectPrefixes("a2", {other.prefix});
+
+  // specific of another node of a1 contributes, not one of a2
+  thrift::PrefixDatabase prefixDb;
+  prefixDb.thisNodeName = "node-2";
+  prefixDb.prefixEntries = {createPrefixEntry(toIpPrefix("10.1.2.0/24"))};
+  kvStoreWrapper->setKey(
+      "prefix:node-2",
+      createThriftValue(
+          1, "node-2", fbzmq::util::writeThriftObjStr(prefixDb, serializer)),
+      std::nullopt,
+      "a2");
+  expectPrefixes("a2", {other.prefix});
+  kvStoreWrapper->setKey(
+      "prefix:node-2",
+      createThriftValue(
+          1, "node-2", fbzmq::util::writeThriftObjStr(prefixDb, serializer)),
+      std::nullopt,
+      "a1");
+  expectPrefixes("a2", {summary, other.prefix});
+
+  // and is withdrawn
+  prefixDb.deletePrefix = true;
+  kvStoreWrapper->setKey(
+      "prefix:node-2",
+      createThriftValue(
+          2, "node-2", fbzmq::util::writeThriftObjStr(prefixDb, serializer)),
+      std::nullopt,
+      "a1");
+  expectPrefixes("a2", {other.prefix});
+
+  // Stop the test
+  prefixUpdatesQueue.close();
+  kvStoreWrapper->closeQueue();
+  prefixManager->stop();
+  prefixManagerThread.join();
+  kvStoreWrapper->stop();
+  configStore->stop();
+  configStoreThread.join();
+}
+
+/**
+ * Prefixes advertised in bucket keys of two prefixes. Buckets are doubled
+ * once full and halved once a quarter full, keys of dropped buckets are
+ * withdrawn.
+ */
+TEST(PrefixManagerTest, PrefixBuckets) {
+  fbzmq::Context context;
+  messaging::ReplicateQueue<thrift::PrefixUpdateRequest> prefixUpdatesQueue;
+  CompactSerializer serializer;
+  const auto prefix1 = createPrefixEntry(toIpPrefix("10.0.0.1/32"));
+  const auto prefix2 = createPrefixEntry(toIpPrefix("10.0.0.2/32"));
+  const auto prefix3 = createPrefixEntry(toIpPrefix("10.0.0.3/32"));
+
+  auto configStore = std::make_unique<PersistentStore>(
+      "1",
+      folly::sformat(
+          "/tmp/pm_ut_config_store.bin.{}",
+          std::hash<std::thread::id>{}(std::this_thread::get_id())),
+      context,
+      true);
+  std::thread configStoreThread([&]() noexcept { configStore->run(); });
+  configStore->waitUntilRunning();
+
+  auto kvStoreWrapper = std::make_unique<KvStoreWrapper>(
+      context,
+      "test_store1",
+      std::chrono::seconds(1) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  kvStoreWrapper->run();
+
+  auto prefixManager = std::make_unique<PrefixManager>(
+      "node-1",
+      prefixUpdatesQueue.getReader(),
+      configStore.get(),
+      kvStoreWrapper->getKvStore(),
+      PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+      false /* create IP prefix keys */,
+      false /* prefix-mananger perf measurement */,
+      std::chrono::seconds{0},
+      Constants::kKvStoreDbTtl,
+      {thrift::KvStore_constants::kDefaultArea()},
+      std::chrono::milliseconds(0) /* persist inline */,
+      std::chrono::milliseconds(0),
+      false /* compact lsdb encoding */,
+      AreaSummaries{},
+      std::nullopt,
+      2 /* prefixes per bucket */);
+  std::thread prefixManagerThread([&]() { prefixManager->run(); });
+  prefixManager->waitUntilRunning();
+
+  // prefixes advertised by node-1 in numBuckets bucket keys, eventually
+  auto expectBuckets = [&](size_t numBuckets,
+                           std::set<thrift::IpPrefix> const& expected) {
+    std::set<thrift::IpPrefix> prefixes;
+    size_t buckets{0};
+    for (int i = 0; i < 100; ++i) {
+      prefixes.clear();
+      buckets = 0;
+      for (size_t bucket = 0; bucket < 4; ++bucket) {
+        auto value = kvStoreWrapper->getKey(
+            createPrefixBucketKey("prefix:", "node-1", bucket));
+        if (not value.has_value() or not value->value.has_value()) {
+          continue;
+        }
+        const auto prefixDb =
+            fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
+                value->value.value(), serializer);
+        if (prefixDb.deletePrefix) {
+          continue;
+        }
+        ++buckets;
+        for (auto const& entry : prefixDb.prefixEntries) {
+          prefixes.emplace(entry.prefix);
+        }
+      }
+      if (buckets == numBuckets and prefixes == expected) {
+        return;
+      }
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    EXPECT_EQ(numBuckets, buckets);
+    EXPECT_EQ(expected, prefixes);
+  };
+
+  EXPECT_TRUE(prefixManager->advertisePrefixes({prefix1, prefix2}).get());
+  expectBuckets(1, {prefix1.prefix, prefix2.prefix});
+  EXPECT_FALSE(kvStoreWrapper->getKey("prefix:node-1").has_value());
+
+  // third prefix doubles buckets
+  EXPECT_TRUE(prefixManager->advertisePrefixes({prefix3}).get());
+  expectBuckets(2, {prefix1.prefix, prefix2.prefix, prefix3.prefix});
+
+  // half full buckets are kept
+  EXPECT_TRUE(prefixManager->withdrawPrefixes({prefix1, prefix2}).get());
+  expectBuckets(2, {prefix3.prefix});
+
+  // empty, halved
+  EXPECT_TRUE(prefixManager->withdrawPrefixes({prefix3}).get());
+  expectBuckets(1, {});
+
+  // Stop the test
+  prefixUpdatesQueue.close();
+  kvStoreWrapper->closeQueue();
+  prefixManager->stop();
+  prefixManagerThread.join();
+  kvStoreWrapper->stop();
+  configStore->stop();
+  configStoreThread.join();
+}
+
 // Verify that persist store is updated only when
 // non-ephemeral types are effected
 TEST_P(PrefixManagerTestFixture, CheckPersistStoreUpdate) {
@@ -1071,39 +1405,101 @@ TEST_P(PrefixManagerTestFixture, CheckPersistStoreUpdate) {
   // Verify that any action on persistent entries leads to update of store
   prefixManager->advertisePrefixes({prefixEntry1, prefixEntry2, prefixEntry3})
       .get();
-  // 3 prefixes leads to 1 write
-  ASSERT_EQ(1, configStore->getNumOfDbWritesToDisk());
+  // 3 prefixes of 2 types leads to 1 write per type
+  ASSERT_EQ(2, configStore->getNumOfDbWritesToDisk());
 
+  // only record of the type changed is written
   prefixManager->withdrawPrefixes({prefixEntry1}).get();
-  ASSERT_EQ(2, configStore->getNumOfDbWritesToDisk());
+  ASSERT_EQ(3, configStore->getNumOfDbWritesToDisk());
 
   prefixManager
       ->syncPrefixesByType(
           thrift::PrefixType::PREFIX_ALLOCATOR, {prefixEntry2, prefixEntry4})
       .get();
-  ASSERT_EQ(3, configStore->getNumOfDbWritesToDisk());
+  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
 
+  // record of type is erased
   prefixManager->withdrawPrefixesByType(thrift::PrefixType::PREFIX_ALLOCATOR)
       .get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  ASSERT_EQ(5, configStore->getNumOfDbWritesToDisk());
+  EXPECT_FALSE(configStore->load(getConfigKey("PREFIX_ALLOCATOR"))
+                   .get()
+                   .has_value());
 
   // Verify that any actions on ephemeral entries does not lead to update of
   // store
   prefixManager
       ->advertisePrefixes({ephemeralPrefixEntry9, ephemeralPrefixEntry10})
       .get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  ASSERT_EQ(5, configStore->getNumOfDbWritesToDisk());
 
   prefixManager->withdrawPrefixes({ephemeralPrefixEntry9}).get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  ASSERT_EQ(5, configStore->getNumOfDbWritesToDisk());
 
   prefixManager
       ->syncPrefixesByType(thrift::PrefixType::BGP, {ephemeralPrefixEntry10})
       .get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  ASSERT_EQ(5, configStore->getNumOfDbWritesToDisk());
 
   prefixManager->withdrawPrefixesByType(thrift::PrefixType::BGP).get();
-  ASSERT_EQ(4, configStore->getNumOfDbWritesToDisk());
+  ASSERT_EQ(5, configStore->getNumOfDbWritesToDisk());
+}
+
+// Verify chunked sync of prefixes by type, persisted once on commit
+TEST_P(PrefixManagerTestFixture, ChunkedSyncPrefixesByType) {
+  const auto type = thrift::PrefixType::PREFIX_ALLOCATOR;
+  EXPECT_TRUE(
+      prefixManager->advertisePrefixes({prefixEntry1, prefixEntry2}).get());
+  ASSERT_EQ(2, configStore->getNumOfDbWritesToDisk());
+
+  // no sync in progress
+  EXPECT_THROW(
+      prefixManager->addSyncPrefixesByType(type, {prefixEntry4}).get(),
+      std::invalid_argument);
+  EXPECT_THROW(
+      prefixManager->commitSyncPrefixesByType(type).get(),
+      std::invalid_argument);
+
+  prefixManager->beginSyncPrefixesByType(type).get();
+  // type of prefixes must match
+  EXPECT_THROW(
+      prefixManager->addSyncPrefixesByType(type, {prefixEntry3}).get(),
+      std::invalid_argument);
+
+  // chunks are applied right away, persisted on commit only
+  EXPECT_TRUE(prefixManager->addSyncPrefixesByType(type, {prefixEntry4}).get());
+  EXPECT_FALSE(
+      prefixManager->addSyncPrefixesByType(type, {prefixEntry4}).get());
+  EXPECT_TRUE(prefixManager->addSyncPrefixesByType(type, {prefixEntry6}).get());
+  EXPECT_EQ(4, prefixManager->getPrefixes().get()->size());
+  EXPECT_EQ(2, configStore->getNumOfDbWritesToDisk());
+
+  // prefixEntry2 left out of sync, withdrawn on commit
+  EXPECT_TRUE(prefixManager->commitSyncPrefixesByType(type).get());
+  EXPECT_EQ(3, configStore->getNumOfDbWritesToDisk());
+  auto prefixes = prefixManager->getPrefixesByType(type).get();
+  ASSERT_EQ(2, prefixes->size());
+  EXPECT_THAT(
+      *prefixes, testing::UnorderedElementsAre(prefixEntry4, prefixEntry6));
+  EXPECT_EQ(
+      1,
+      prefixManager->getPrefixesByType(thrift::PrefixType::DEFAULT)
+          .get()
+          ->size());
+
+  // sync without changes
+  prefixManager->beginSyncPrefixesByType(type).get();
+  EXPECT_FALSE(
+      prefixManager->addSyncPrefixesByType(type, {prefixEntry4, prefixEntry6})
+          .get());
+  EXPECT_FALSE(prefixManager->commitSyncPrefixesByType(type).get());
+  EXPECT_EQ(3, configStore->getNumOfDbWritesToDisk());
+
+  // empty sync withdraws all prefixes of type
+  prefixManager->beginSyncPrefixesByType(type).get();
+  EXPECT_TRUE(prefixManager->commitSyncPrefixesByType(type).get());
+  EXPECT_EQ(0, prefixManager->getPrefixesByType(type).get()->size());
+  EXPECT_EQ(4, configStore->getNumOfDbWritesToDisk());
 }
 
 // Verify that persist store is update properly when both persistent
@@ -1155,6 +1551,122 @@ TEST_P(PrefixManagerTestFixture, CheckEphemeralAndPersistentUpdate) {
   ASSERT_EQ(7, configStore->getNumOfDbWritesToDisk());
 }
 
+// Verify that persisting is debounced, bounded by max delay, and pending
+// changes are flushed on destruction
+TEST_P(PrefixManagerTestFixture, PersistDebounce) {
+  const std::chrono::milliseconds debounce{200};
+  const std::chrono::milliseconds maxDelay{1000};
+  auto prefixManager2 = std::make_unique<PrefixManager>(
+      "node-2",
+      prefixUpdatesQueue.getReader(),
+      configStore.get(),
+      kvStoreWrapper->getKvStore(),
+      PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+      perPrefixKeys_ /* create IP prefix keys */,
+      false /* prefix-mananger perf measurement */,
+      std::chrono::seconds(0),
+      Constants::kKvStoreDbTtl,
+      {thrift::KvStore_constants::kDefaultArea()},
+      debounce,
+      maxDelay);
+
+  auto prefixManagerThread2 = std::make_unique<std::thread>([&]() {
+    LOG(INFO) << "PrefixManager thread starting";
+    prefixManager2->run();
+    LOG(INFO) << "PrefixManager thread finishing";
+  });
+  prefixManager2->waitUntilRunning();
+
+  // changes in quick succession lead to one write per type
+  prefixManager2->advertisePrefixes({prefixEntry1}).get();
+  prefixManager2->advertisePrefixes({prefixEntry3}).get();
+  prefixManager2->advertisePrefixes({prefixEntry2}).get();
+  EXPECT_EQ(0, configStore->getNumOfDbWritesToDisk());
+  std::this_thread::sleep_for(2 * debounce);
+  EXPECT_EQ(2, configStore->getNumOfDbWritesToDisk());
+
+  // changes keep coming faster than debounce, persisted after max delay
+  const int numChanges{15};
+  for (int i = 0; i < numChanges; ++i) {
+    prefixManager2
+        ->advertisePrefixes({createPrefixEntry(
+            toIpPrefix(folly::sformat("ffff:10:5:{}::/64", i)),
+            thrift::PrefixType::PREFIX_ALLOCATOR)})
+        .get();
+    std::this_thread::sleep_for(debounce / 2);
+  }
+  EXPECT_LE(3, configStore->getNumOfDbWritesToDisk());
+  EXPECT_GE(4, configStore->getNumOfDbWritesToDisk());
+
+  // pending change is persisted on destruction
+  prefixManager2->withdrawPrefixes({prefixEntry1}).get();
+  prefixUpdatesQueue.close();
+  kvStoreWrapper->closeQueue();
+  prefixManager2->stop();
+  prefixManagerThread2->join();
+  prefixManager2.reset();
+
+  auto maybePrefixDb = configStore
+                           ->loadThriftObj<thrift::PrefixDatabase>(
+                               getConfigKey("DEFAULT"))
+                           .get();
+  ASSERT_TRUE(maybePrefixDb.hasValue());
+  EXPECT_THAT(
+      maybePrefixDb->prefixEntries, testing::ElementsAre(prefixEntry3));
+}
+
+// Verify that prefixes of legacy single record are loaded and migrated to
+// per type records
+TEST_P(PrefixManagerTestFixture, LegacyConfigMigration) {
+  thrift::PrefixDatabase legacyPrefixDb;
+  legacyPrefixDb.thisNodeName = "node-2";
+  legacyPrefixDb.prefixEntries = {prefixEntry1, prefixEntry2};
+  configStore->storeThriftObj("prefix-manager-config", legacyPrefixDb).get();
+
+  auto prefixManager2 = std::make_unique<PrefixManager>(
+      "node-2",
+      prefixUpdatesQueue.getReader(),
+      configStore.get(),
+      kvStoreWrapper->getKvStore(),
+      PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+      perPrefixKeys_ /* create IP prefix keys */,
+      false /* prefix-mananger perf measurement */,
+      std::chrono::seconds(0),
+      Constants::kKvStoreDbTtl,
+      {thrift::KvStore_constants::kDefaultArea()},
+      std::chrono::milliseconds(0) /* persist inline */,
+      std::chrono::milliseconds(0));
+
+  auto prefixManagerThread2 = std::make_unique<std::thread>([&]() {
+    LOG(INFO) << "PrefixManager thread starting";
+    prefixManager2->run();
+    LOG(INFO) << "PrefixManager thread finishing";
+  });
+  prefixManager2->waitUntilRunning();
+  EXPECT_THAT(
+      *prefixManager2->getPrefixes().get(),
+      testing::UnorderedElementsAre(prefixEntry1, prefixEntry2));
+
+  // cleanup, migration is flushed on destruction if not done yet
+  prefixUpdatesQueue.close();
+  kvStoreWrapper->closeQueue();
+  prefixManager2->stop();
+  prefixManagerThread2->join();
+  prefixManager2.reset();
+
+  EXPECT_FALSE(configStore->load("prefix-manager-config").get().has_value());
+  for (const auto& entry : {prefixEntry1, prefixEntry2}) {
+    auto maybePrefixDb =
+        configStore
+            ->loadThriftObj<thrift::PrefixDatabase>(getConfigKey(
+                apache::thrift::TEnumTraits<thrift::PrefixType>::findName(
+                    entry.type)))
+            .get();
+    ASSERT_TRUE(maybePrefixDb.hasValue());
+    EXPECT_THAT(maybePrefixDb->prefixEntries, testing::ElementsAre(entry));
+  }
+}
+
 TEST_P(PrefixManagerTestFixture, PrefixUpdatesQueue) {
   // Helper function to receive expected number of updates from KvStore
   auto recvPublication = [this](int num) {
@@ -32,6 +32,7 @@ class DecisionCli(object):
         # for TG backward compatibility. Deprecated.
         self.decision.add_command(DecisionRoutesComputedCli().routes, name="routes")
         self.decision.add_command(DecisionValidateCli().validate)
+        self.decision.add_command(DecisionTraceCli().trace)
 
     @click.group()
     @click.pass_context
@@ -199,3 +200,18 @@ class DecisionValidateCli(object):
 
         return_code = decision.DecisionValidateCmd(cli_opts).run(json, area)
         sys.exit(return_code)
+
+
+class DecisionTraceCli(object):
+    @click.command()
+    @click.option(
+        "--chrome-trace",
+        default="",
+        help="Write spans to the given file in Chrome trace event format, "
+        "viewable in chrome://tracing or Perfetto",
+    )
+    @click.pass_obj
+    def trace(cli_opts, chrome_trace):  # noqa: B902
+        """ dump latest timed spans of Decision route computation """
+
+        decision.DecisionTraceCmd(cli_opts).run(chrome_trace)
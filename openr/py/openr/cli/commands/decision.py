@@ -9,6 +9,7 @@
 
 
 import ipaddress
+import json
 import sys
 from collections import defaultdict
 from typing import Any, Callable, Dict, List, Tuple
@@ -613,3 +614,75 @@ class DecisionValidateCmd(OpenrCtrlCmd):
             print("{} table for {} and {} match".format(db_type, *db_sources))
 
         return return_code
+
+
+class DecisionTraceCmd(OpenrCtrlCmd):
+    def _run(self, client: OpenrCtrl.Client, chrome_trace: str = "") -> None:
+        trace_spans = client.getDecisionTraceSpans()
+        if chrome_trace:
+            self.write_chrome_trace(trace_spans, chrome_trace)
+            print(
+                "Wrote {} spans to {}".format(len(trace_spans.spans), chrome_trace)
+            )
+            return
+
+        rows = []
+        for span in trace_spans.spans:
+            rows.append(
+                [
+                    span.seqNum,
+                    span.startTimeUs,
+                    "{:.3f}".format(span.durationNs / 1e6),
+                    span.threadId,
+                    span.name,
+                    span.detail,
+                    span.arg,
+                ]
+            )
+        column_labels = [
+            "Seq",
+            "Start (us)",
+            "Duration (ms)",
+            "Thread",
+            "Span",
+            "Detail",
+            "Arg",
+        ]
+        print(
+            printing.render_horizontal_table(
+                rows,
+                column_labels,
+                caption="{} spans, {} dropped".format(
+                    len(trace_spans.spans), trace_spans.droppedSpans
+                ),
+            )
+        )
+
+    def write_chrome_trace(self, trace_spans, file_name: str) -> None:
+        """ write spans as complete events of the Chrome trace event format,
+            viewable in chrome://tracing or Perfetto
+        """
+
+        events = [
+            {
+                "name": "process_name",
+                "ph": "M",
+                "pid": 0,
+                "args": {"name": "openr-decision@{}".format(self.host)},
+            }
+        ]
+        for span in trace_spans.spans:
+            events.append(
+                {
+                    "name": span.name,
+                    "cat": "decision",
+                    "ph": "X",
+                    "ts": span.startTimeUs,
+                    "dur": span.durationNs / 1e3,
+                    "pid": 0,
+                    "tid": span.threadId,
+                    "args": {"detail": span.detail, "arg": span.arg},
+                }
+            )
+        with open(file_name, "w") as f:
+            json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, f)
@@ -228,8 +228,33 @@ class KvKeysCmd(KvStoreCmdBase):
         keyDumpParams = self.buildKvStoreKeyDumpParams(
             prefix, [originator] if originator else None
         )
-        resp = client.getKvStoreKeyValsFiltered(keyDumpParams)
-        self.print_kvstore_keys({None: resp}, ttl, json)
+        self.print_kvstore_key_pages(client, keyDumpParams, {None}, ttl, json)
+
+    def print_kvstore_key_pages(
+        self,
+        client: OpenrCtrl.Client,
+        keyDumpParams: kv_store_types.KeyDumpParams,
+        areas: Set[str],
+        ttl: bool,
+        json: bool,
+    ) -> None:
+        """
+        dump keys of areas page by page. tables get printed as pages arrive,
+        json output needs all of them first
+        """
+
+        area_kv = {}
+        for area in areas:
+            for page in utils.iter_kvstore_pages(client, keyDumpParams, area):
+                if not json:
+                    self.print_kvstore_keys({area: page}, ttl, json)
+                elif area in area_kv:
+                    area_kv[area].keyVals.update(page.keyVals)
+                else:
+                    area_kv[area] = page
+
+        if json:
+            self.print_kvstore_keys(area_kv, ttl, json)
 
     def print_kvstore_keys(
         self, resp: Dict[str, kv_store_types.Publication], ttl: bool, json: bool
@@ -307,13 +332,7 @@ class KeysCmd(KvKeysCmd):
         keyDumpParams = self.buildKvStoreKeyDumpParams(
             prefix, [originator] if originator else None
         )
-
-        area_kv = {}
-        for area in self.areas:
-            resp = client.getKvStoreKeyValsFilteredArea(keyDumpParams, area)
-            area_kv[area] = resp
-
-        self.print_kvstore_keys(area_kv, ttl, json)
+        self.print_kvstore_key_pages(client, keyDumpParams, self.areas, ttl, json)
 
 
 class KvKeyValsCmd(KvStoreCmdBase):
@@ -19,7 +19,7 @@ from builtins import chr, input, map
 from collections import defaultdict
 from functools import partial
 from itertools import product
-from typing import Any, Dict, List, Optional, Set, Tuple, Union
+from typing import Any, Dict, Iterator, List, Optional, Set, Tuple, Union
 
 import bunch
 import click
@@ -1159,17 +1159,43 @@ def sprint_prefixes_db_delta(
     return strs
 
 
+def iter_kvstore_pages(
+    client: OpenrCtrl.Client,
+    keyDumpParams: kv_store_types.KeyDumpParams,
+    area: str = None,
+) -> Iterator[kv_store_types.Publication]:
+    """
+    dump the key-vals matching keyDumpParams page by page, yielding every page
+    as it arrives. older nodes return everything in the first one
+    """
+
+    keyDumpParams = copy.copy(keyDumpParams)
+    keyDumpParams.maxKeys = Consts.KVSTORE_DUMP_PAGE_SIZE
+    while True:
+        if area is None:
+            page = client.getKvStoreKeyValsFiltered(keyDumpParams)
+        else:
+            page = client.getKvStoreKeyValsFilteredArea(keyDumpParams, area)
+        yield page
+        if page.lastKey is None:
+            return
+        keyDumpParams.startAfterKey = page.lastKey
+
+
 def dump_node_kvs(
     cli_opts: bunch.Bunch, host: str, area: str = None
 ) -> kv_store_types.Publication:
+    """ dump all key-vals of a node, merged into a single publication """
+
     pub = None
 
     with get_openr_ctrl_client(host, cli_opts) as client:
         keyDumpParams = kv_store_types.KeyDumpParams(Consts.ALL_DB_MARKER)
-        if area is None:
-            pub = client.getKvStoreKeyValsFiltered(keyDumpParams)
-        else:
-            pub = client.getKvStoreKeyValsFilteredArea(keyDumpParams, area)
+        for page in iter_kvstore_pages(client, keyDumpParams, area):
+            if pub is None:
+                pub = page
+            else:
+                pub.keyVals.update(page.keyVals)
 
     return pub
 
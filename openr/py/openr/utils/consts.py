@@ -22,6 +22,9 @@ class Consts(object):
     PREFIX_DB_MARKER = "prefix:"
     ALL_DB_MARKER = ""
 
+    # key-values per page when dumping a whole KvStore
+    KVSTORE_DUMP_PAGE_SIZE = 10000
+
     SEED_PREFIX_ALLOC_PARAM_KEY = "e2e-network-prefix"
     STATIC_PREFIX_ALLOC_PARAM_KEY = "e2e-network-allocations"
 
@@ -48,13 +48,17 @@ PER_PREFIX_KEYS=false
 DECISION_DEBOUNCE_MAX_MS=250
 DECISION_DEBOUNCE_MIN_MS=10
 DECISION_GRACEFUL_RESTART_WINDOW_S=-1
+DECISION_SPF_THREADS=0
+DECISION_TRACE_SPANS=16384
 DOMAIN=openr
 DRYRUN=false
 ENABLE_BGP_ROUTE_PROGRAMMING=true
 BGP_USE_IGP_METRIC=false
+ENABLE_FIB_NEXTHOP_GROUPS=false
 ENABLE_FIB_SERVICE_WAITING=true
 ENABLE_LFA=false
 ENABLE_NETLINK_FIB_HANDLER=true
+ENABLE_NETLINK_NEXTHOP_OBJECTS=false
 ENABLE_NETLINK_SYSTEM_HANDLER=true
 ENABLE_ORDERED_FIB_PROGRAMMING=false
 ENABLE_PERF_MEASUREMENT=true
@@ -66,15 +70,27 @@ ENABLE_SEGMENT_ROUTING=false
 ENABLE_V4=false
 ENABLE_WATCHDOG=true
 FIB_HANDLER_PORT=60100
+FIB_SYNC_CHUNK_SIZE=0
 IFACE_REGEX_EXCLUDE=""
 IFACE_REGEX_INCLUDE=""
 IP_TOS=192
 KEY_PREFIX_FILTERS=""
+KVSTORE_ENABLE_AREA_THREADS=false
+KVSTORE_ENABLE_BUCKET_SYNC=false
+KVSTORE_ENABLE_COMPACT_TTL_UPDATES=false
+KVSTORE_FLOOD_BATCH_BYTES=1048576
+KVSTORE_FLOOD_BATCH_MS=0
 KVSTORE_FLOOD_MSG_BURST_SIZE=0
 KVSTORE_FLOOD_MSG_PER_SEC=0
+KVSTORE_HASH_VERSION=V1
 KVSTORE_KEY_TTL_MS=300000
+KVSTORE_PEER_SEND_QUEUE_BYTES=16777216
+KVSTORE_PEER_TRANSPORT=ZMQ
+KVSTORE_SNAPSHOT_DIR=""
 KVSTORE_SYNC_INTERVAL_S=60
 KVSTORE_TTL_DECREMENT_MS=1
+KVSTORE_VALUE_COMPRESSION=NONE
+KVSTORE_VALUE_COMPRESSION_MIN_BYTES=4096
 KVSTORE_ZMQ_HWM=65536
 LINK_FLAP_INITIAL_BACKOFF_MS=1000
 LINK_FLAP_MAX_BACKOFF_MS=60000
@@ -83,6 +99,8 @@ LOG_FILE=""
 LOOPBACK_IFACE="lo"
 MEMORY_LIMIT_MB=800
 MIN_LOG_LEVEL=0
+NETLINK_MAX_IOV_MSG=2000
+NETLINK_MIN_IOV_MSG=50
 OVERRIDE_LOOPBACK_ADDR=false
 PREFIXES=""
 PREFIX_FWD_TYPE_MPLS=0
@@ -94,6 +112,7 @@ SET_LOOPBACK_ADDR=false
 SPARK_FASTINIT_KEEPALIVE_TIME_MS=100
 SPARK_HOLD_TIME_S=30
 SPARK_KEEPALIVE_TIME_S=3
+SPARK_NUM_WORKERS=1
 SPARK2_HELLO_TIME_S=20
 SPARK2_HELLO_FASTINIT_TIME_MS=500
 SPARK2_HANDSHAKE_TIME_MS=500
@@ -172,13 +191,17 @@ ARGS="\
   --decision_debounce_max_ms=${DECISION_DEBOUNCE_MAX_MS} \
   --decision_debounce_min_ms=${DECISION_DEBOUNCE_MIN_MS} \
   --decision_graceful_restart_window_s=${DECISION_GRACEFUL_RESTART_WINDOW_S} \
+  --decision_spf_threads=${DECISION_SPF_THREADS} \
+  --decision_trace_spans=${DECISION_TRACE_SPANS} \
   --domain=${DOMAIN} \
   --dryrun=${DRYRUN} \
   --enable_bgp_route_programming=${ENABLE_BGP_ROUTE_PROGRAMMING} \
   --enable_flood_optimization=${ENABLE_FLOOD_OPTIMIZATION} \
+  --enable_fib_nexthop_groups=${ENABLE_FIB_NEXTHOP_GROUPS} \
   --enable_fib_service_waiting=${ENABLE_FIB_SERVICE_WAITING} \
   --enable_lfa=${ENABLE_LFA} \
   --enable_netlink_fib_handler=${ENABLE_NETLINK_FIB_HANDLER} \
+  --enable_netlink_nexthop_objects=${ENABLE_NETLINK_NEXTHOP_OBJECTS} \
   --enable_netlink_system_handler=${ENABLE_NETLINK_SYSTEM_HANDLER} \
   --enable_ordered_fib_programming=${ENABLE_ORDERED_FIB_PROGRAMMING} \
   --enable_perf_measurement=${ENABLE_PERF_MEASUREMENT} \
@@ -191,16 +214,28 @@ ARGS="\
   --enable_v4=${ENABLE_V4} \
   --enable_watchdog=${ENABLE_WATCHDOG} \
   --fib_handler_port=${FIB_HANDLER_PORT} \
+  --fib_sync_chunk_size=${FIB_SYNC_CHUNK_SIZE} \
   --iface_regex_exclude=${IFACE_REGEX_EXCLUDE} \
   --iface_regex_include=${IFACE_REGEX_INCLUDE} \
   --ip_tos=${IP_TOS} \
   --is_flood_root=${IS_FLOOD_ROOT} \
   --key_prefix_filters=${KEY_PREFIX_FILTERS} \
+  --kvstore_enable_area_threads=${KVSTORE_ENABLE_AREA_THREADS} \
+  --kvstore_enable_bucket_sync=${KVSTORE_ENABLE_BUCKET_SYNC} \
+  --kvstore_enable_compact_ttl_updates=${KVSTORE_ENABLE_COMPACT_TTL_UPDATES} \
+  --kvstore_flood_batch_bytes=${KVSTORE_FLOOD_BATCH_BYTES} \
+  --kvstore_flood_batch_ms=${KVSTORE_FLOOD_BATCH_MS} \
   --kvstore_flood_msg_burst_size=${KVSTORE_FLOOD_MSG_BURST_SIZE} \
   --kvstore_flood_msg_per_sec=${KVSTORE_FLOOD_MSG_PER_SEC} \
+  --kvstore_hash_version=${KVSTORE_HASH_VERSION} \
   --kvstore_key_ttl_ms=${KVSTORE_KEY_TTL_MS} \
+  --kvstore_peer_send_queue_bytes=${KVSTORE_PEER_SEND_QUEUE_BYTES} \
+  --kvstore_peer_transport=${KVSTORE_PEER_TRANSPORT} \
+  --kvstore_snapshot_dir=${KVSTORE_SNAPSHOT_DIR} \
   --kvstore_sync_interval_s=${KVSTORE_SYNC_INTERVAL_S} \
   --kvstore_ttl_decrement_ms=${KVSTORE_TTL_DECREMENT_MS} \
+  --kvstore_value_compression=${KVSTORE_VALUE_COMPRESSION} \
+  --kvstore_value_compression_min_bytes=${KVSTORE_VALUE_COMPRESSION_MIN_BYTES} \
   --kvstore_zmq_hwm=${KVSTORE_ZMQ_HWM} \
   --link_flap_initial_backoff_ms=${LINK_FLAP_INITIAL_BACKOFF_MS} \
   --link_flap_max_backoff_ms=${LINK_FLAP_MAX_BACKOFF_MS} \
@@ -208,6 +243,8 @@ ARGS="\
   --loopback_iface=${LOOPBACK_IFACE} \
   --memory_limit_mb=${MEMORY_LIMIT_MB} \
   --minloglevel=${MIN_LOG_LEVEL} \
+  --netlink_max_iov_msg=${NETLINK_MAX_IOV_MSG} \
+  --netlink_min_iov_msg=${NETLINK_MIN_IOV_MSG} \
   --node_name=${NODE_NAME} \
   --override_loopback_addr=${OVERRIDE_LOOPBACK_ADDR} \
   --per_prefix_keys=${PER_PREFIX_KEYS} \
@@ -221,6 +258,7 @@ ARGS="\
   --spark_fastinit_keepalive_time_ms=${SPARK_FASTINIT_KEEPALIVE_TIME_MS} \
   --spark_hold_time_s=${SPARK_HOLD_TIME_S} \
   --spark_keepalive_time_s=${SPARK_KEEPALIVE_TIME_S} \
+  --spark_num_workers=${SPARK_NUM_WORKERS} \
   --spark2_handshake_time_ms=${SPARK2_HANDSHAKE_TIME_MS} \
   --spark2_heartbeat_hold_time_s=${SPARK2_HEARTBEAT_HOLD_TIME_S} \
   --spark2_heartbeat_time_s=${SPARK2_HEARTBEAT_TIME_S} \
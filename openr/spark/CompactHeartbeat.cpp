@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CompactHeartbeat.h"
+
+#include <cstring>
+#include <limits>
+
+#include <folly/Bits.h>
+#include <glog/logging.h>
+
+namespace openr {
+namespace compact_heartbeat {
+
+bool
+isCompactHeartbeat(folly::ByteRange packet) {
+  return not packet.empty() and packet[0] == kMagic;
+}
+
+void
+write(folly::StringPiece nodeName, int64_t seqNum, std::string& packet) {
+  CHECK_LE(nodeName.size(), std::numeric_limits<uint16_t>::max());
+  const uint16_t nameLen = folly::Endian::big<uint16_t>(nodeName.size());
+  const uint64_t seqNumBE =
+      folly::Endian::big<uint64_t>(static_cast<uint64_t>(seqNum));
+
+  packet.resize(kHeaderLen + nodeName.size());
+  auto* data = &packet[0];
+  data[0] = static_cast<char>(kMagic);
+  data[1] = static_cast<char>(kVersion);
+  std::memcpy(data + 2, &nameLen, sizeof(nameLen));
+  std::memcpy(data + 4, &seqNumBE, sizeof(seqNumBE));
+  std::memcpy(data + kHeaderLen, nodeName.data(), nodeName.size());
+}
+
+std::optional<Heartbeat>
+parse(folly::ByteRange packet) {
+  if (packet.size() < kHeaderLen or packet[0] != kMagic or
+      packet[1] != kVersion) {
+    return std::nullopt;
+  }
+  uint16_t nameLen;
+  uint64_t seqNum;
+  std::memcpy(&nameLen, packet.data() + 2, sizeof(nameLen));
+  std::memcpy(&seqNum, packet.data() + 4, sizeof(seqNum));
+  nameLen = folly::Endian::big(nameLen);
+  if (packet.size() != kHeaderLen + nameLen or nameLen == 0) {
+    return std::nullopt;
+  }
+
+  Heartbeat heartbeat;
+  heartbeat.nodeName = folly::StringPiece(
+      reinterpret_cast<const char*>(packet.data() + kHeaderLen), nameLen);
+  heartbeat.seqNum = static_cast<int64_t>(folly::Endian::big(seqNum));
+  return heartbeat;
+}
+
+} // namespace compact_heartbeat
+} // namespace openr
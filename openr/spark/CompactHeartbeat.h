@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <folly/Range.h>
+
+namespace openr {
+
+/**
+ * Compact wire format of Spark2 heartbeat msgs, in place of a thrift
+ * SparkHelloPacket. A fixed header, all fields in network byte order,
+ * followed by the node name:
+ *
+ *   0      1         2              4                 12
+ *   +------+---------+--------------+-----------------+-----------+
+ *   | 0xff | version | nodeName len |     seqNum      | nodeName  |
+ *   +------+---------+--------------+-----------------+-----------+
+ *
+ * Compact protocol starts a thrift struct with a field header whose low
+ * nibble is a type in [1, 12], or with 0 for an empty one. 0xff never starts
+ * a SparkHelloPacket, so both formats share the socket.
+ *
+ * Only to be sent to neighbors advertising the version in their handshake.
+ */
+namespace compact_heartbeat {
+
+constexpr uint8_t kMagic{0xff};
+
+// version of the format this code reads and writes
+constexpr uint8_t kVersion{1};
+
+constexpr size_t kHeaderLen{12};
+
+struct Heartbeat {
+  // points into the parsed buffer
+  folly::StringPiece nodeName;
+  int64_t seqNum{0};
+};
+
+// if packet is in this format, of any version
+bool isCompactHeartbeat(folly::ByteRange packet);
+
+// Write heartbeat into packet, replacing its content. Doesn't allocate if
+// packet has the capacity already.
+void write(folly::StringPiece nodeName, int64_t seqNum, std::string& packet);
+
+// std::nullopt if packet is malformed or of another version. Doesn't
+// allocate.
+std::optional<Heartbeat> parse(folly::ByteRange packet);
+
+} // namespace compact_heartbeat
+} // namespace openr
@@ -7,8 +7,12 @@
 
 #include "IoProvider.h"
 
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <net/if.h>
 
+#include <optional>
+
 #include <glog/logging.h>
 
 #include <folly/Format.h>
@@ -70,12 +74,23 @@ IoProvider::sendmsg(int sockfd, const struct msghdr* msg, int flags) {
   return ::sendmsg(sockfd, msg, flags);
 }
 
-std::tuple<
-    ssize_t /* size */,
-    int /* ifIndex */,
-    folly::SocketAddress /* srcAddr */,
-    int /* hopLimit */,
-    std::chrono::microseconds /* kernel timestamp */>
+int
+IoProvider::recvmmsg(
+    int sockfd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    struct timespec* timeout) {
+  return ::recvmmsg(sockfd, msgvec, vlen, flags, timeout);
+}
+
+int
+IoProvider::sendmmsg(
+    int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  return ::sendmmsg(sockfd, msgvec, vlen, flags);
+}
+
+IoProvider::RecvResult
 IoProvider::recvMessage(
     int fd, unsigned char* buf, int len, openr::IoProvider* ioProvider) {
   // the control message buffer
@@ -130,6 +145,127 @@ IoProvider::recvMessage(
     throw std::runtime_error("Message truncated");
   }
 
+  return parseMessage(msg, bytesRead);
+}
+
+void
+IoProvider::RecvBuffers::resize(int len, unsigned int maxMessages) {
+  len_ = len;
+  buf_.resize(maxMessages * len);
+  ctrlBufs_.resize(maxMessages);
+  addrStorages_.resize(maxMessages);
+  entries_.resize(maxMessages);
+  msgs_.resize(maxMessages);
+  results_.reserve(maxMessages);
+
+  // the buffers don't move from here on, point the headers to them once
+  for (unsigned int i = 0; i < maxMessages; ++i) {
+    entries_[i].iov_base = data(i);
+    entries_[i].iov_len = len;
+  }
+}
+
+std::vector<IoProvider::RecvResult> const&
+IoProvider::recvMessages(int fd, RecvBuffers& bufs, IoProvider* ioProvider) {
+  auto& msgs = bufs.msgs_;
+  bufs.results_.clear();
+
+  // the kernel updates the headers, reset them, and zero the control and
+  // address buffers as in recvMessage
+  for (size_t i = 0; i < msgs.size(); ++i) {
+    auto& msg = msgs[i].msg_hdr;
+    ::memset(&msgs[i], 0, sizeof(msgs[i]));
+    ::memset(&bufs.ctrlBufs_[i], 0, sizeof(bufs.ctrlBufs_[i]));
+    ::memset(&bufs.addrStorages_[i], 0, sizeof(bufs.addrStorages_[i]));
+    msg.msg_iov = &bufs.entries_[i];
+    msg.msg_iovlen = 1;
+    msg.msg_control = bufs.ctrlBufs_[i].ctrlBuf;
+    msg.msg_controllen = sizeof(bufs.ctrlBufs_[i].ctrlBuf);
+    msg.msg_name = &bufs.addrStorages_[i];
+    msg.msg_namelen = sizeof(sockaddr_storage);
+  }
+
+  int numMsgs = ioProvider->recvmmsg(
+      fd, msgs.data(), msgs.size(), MSG_DONTWAIT, nullptr);
+  if (numMsgs < 0) {
+    if (errno == EAGAIN or errno == EWOULDBLOCK) {
+      return bufs.results_;
+    }
+    throw std::runtime_error(folly::sformat(
+        "Failed reading messages on fd {}: {}", fd, folly::errnoStr(errno)));
+  }
+
+  for (int i = 0; i < numMsgs; ++i) {
+    auto& msg = msgs[i].msg_hdr;
+    if (msg.msg_flags & MSG_TRUNC) {
+      bufs.results_.emplace_back(
+          -1, -1, folly::SocketAddress(), 0, std::chrono::microseconds(0));
+      continue;
+    }
+    bufs.results_.emplace_back(parseMessage(msg, msgs[i].msg_len));
+  }
+  return bufs.results_;
+}
+
+std::vector<IoProvider::TxTimestamp>
+IoProvider::recvTxTimestamps(int fd, IoProvider* ioProvider) {
+  std::vector<TxTimestamp> timestamps;
+  while (true) {
+    union {
+      char ctrlBuf[CMSG_SPACE(sizeof(struct scm_timestamping)) +
+                   CMSG_SPACE(sizeof(struct sock_extended_err) +
+                              sizeof(struct sockaddr_in6))];
+      struct cmsghdr align;
+    } u;
+    ::memset(&u.ctrlBuf[0], 0, sizeof(u.ctrlBuf));
+
+    // no data is looped back with SOF_TIMESTAMPING_OPT_TSONLY
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    msg.msg_control = u.ctrlBuf;
+    msg.msg_controllen = sizeof(u.ctrlBuf);
+
+    if (ioProvider->recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno == EAGAIN or errno == EWOULDBLOCK) {
+        break;
+      }
+      throw std::runtime_error(folly::sformat(
+          "Failed reading error queue on fd {}: {}",
+          fd,
+          folly::errnoStr(errno)));
+    }
+
+    std::optional<std::chrono::microseconds> ts;
+    std::optional<uint32_t> key;
+    for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET and
+          cmsg->cmsg_type == SCM_TIMESTAMPING) {
+        // software timestamp comes first, hardware ones are not requested
+        struct scm_timestamping tss;
+        memcpy(reinterpret_cast<void*>(&tss), CMSG_DATA(cmsg), sizeof(tss));
+        ts = std::chrono::microseconds(
+            static_cast<int64_t>(tss.ts[0].tv_sec) * 1000000 +
+            tss.ts[0].tv_nsec / 1000);
+      } else if (
+          cmsg->cmsg_level == SOL_IPV6 and cmsg->cmsg_type == IPV6_RECVERR) {
+        struct sock_extended_err err;
+        memcpy(reinterpret_cast<void*>(&err), CMSG_DATA(cmsg), sizeof(err));
+        if (err.ee_errno == ENOMSG and
+            err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+          key = err.ee_data;
+        }
+      }
+    }
+    if (ts and key) {
+      timestamps.emplace_back(*key, *ts);
+    }
+  }
+  return timestamps;
+}
+
+IoProvider::RecvResult
+IoProvider::parseMessage(struct msghdr& msg, ssize_t bytesRead) {
   // grab the inIndex we received this packet on and the hopLimit
   // those are available since we requested them via socket options
   struct cmsghdr* cmsg{nullptr};
@@ -180,7 +316,7 @@ IoProvider::recvMessage(
   // build the source socket address from recvmsg data
   folly::SocketAddress srcAddr{};
   // this will throw if sender address was not filled in
-  srcAddr.setFromSockaddr(reinterpret_cast<struct sockaddr*>(&addrStorage));
+  srcAddr.setFromSockaddr(reinterpret_cast<struct sockaddr*>(msg.msg_name));
 
   DCHECK(ifIndex != -1) << "ifIndex is not found";
   DCHECK(hopLimit) << "hopLimit is not found";
@@ -13,6 +13,9 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <chrono>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include <folly/IPAddress.h>
 #include <folly/SocketAddress.h>
@@ -59,22 +62,94 @@ class IoProvider {
 
   virtual ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags);
 
+  virtual int recvmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags,
+      struct timespec* timeout);
+
+  virtual int sendmmsg(
+      int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags);
+
   virtual int setsockopt(
       int sockfd, int level, int optname, const void* optval, socklen_t optlen);
 
   // Utility functions that operate on sockets
 
-  /*
-   * Receive a message on fd, and return its size, interface index,
-   * and the source address
-   */
-  static std::tuple<
+  using RecvResult = std::tuple<
       ssize_t /* size */,
       int /* ifIndex */,
       folly::SocketAddress /* srcAddr */,
       int /* hopLimit */,
-      std::chrono::microseconds /* kernel timestamp */>
-  recvMessage(int fd, unsigned char* buf, int len, IoProvider* ioProvider);
+      std::chrono::microseconds /* kernel timestamp */>;
+
+  /*
+   * Receive a message on fd, and return its size, interface index,
+   * and the source address
+   */
+  static RecvResult recvMessage(
+      int fd, unsigned char* buf, int len, IoProvider* ioProvider);
+
+  /*
+   * Buffers to receive a batch of messages into with recvMessages. Sized once
+   * with resize() and reused across reads, so that reads don't allocate.
+   */
+  class RecvBuffers {
+   public:
+    RecvBuffers() = default;
+
+    RecvBuffers(RecvBuffers const&) = delete;
+    RecvBuffers& operator=(RecvBuffers const&) = delete;
+
+    // room for up to maxMessages messages of up to len bytes each
+    void resize(int len, unsigned int maxMessages);
+
+    // data of message i of the last read
+    unsigned char*
+    data(size_t i) {
+      return &buf_[i * len_];
+    }
+
+   private:
+    friend class IoProvider;
+
+    // the control message buffer of one message, as in recvMessage
+    union CtrlBuf {
+      char ctrlBuf[CMSG_SPACE(1024)];
+      struct cmsghdr align;
+    };
+
+    int len_{0};
+    std::vector<unsigned char> buf_;
+    std::vector<CtrlBuf> ctrlBufs_;
+    std::vector<sockaddr_storage> addrStorages_;
+    std::vector<struct iovec> entries_;
+    std::vector<struct mmsghdr> msgs_;
+    std::vector<RecvResult> results_;
+  };
+
+  /*
+   * Receive as many pending messages on fd as fit in bufs with a single
+   * recvmmsg. Returns the results in order, empty if no message was pending.
+   * They, and the data of the messages, are valid until the next read into
+   * bufs. Truncated messages are reported with size -1.
+   */
+  static std::vector<RecvResult> const& recvMessages(
+      int fd, RecvBuffers& bufs, IoProvider* ioProvider);
+
+  using TxTimestamp = std::pair<
+      uint32_t /* key, see SOF_TIMESTAMPING_OPT_ID */,
+      std::chrono::microseconds /* kernel timestamp */>;
+
+  /*
+   * Receive the timestamps of sent messages that the kernel queued on the
+   * error queue of fd, if tx timestamping with SOF_TIMESTAMPING_OPT_ID and
+   * SOF_TIMESTAMPING_OPT_TSONLY is enabled on it. Returns them in order, empty
+   * if none was pending.
+   */
+  static std::vector<TxTimestamp> recvTxTimestamps(
+      int fd, IoProvider* ioProvider);
 
   /*
    * Send message on fd via given interface to the address provided
@@ -89,6 +164,10 @@ class IoProvider {
       IoProvider* ioProvider);
 
  private:
+  // size, interface index, source address, hop limit and timestamp of a
+  // message received into msg
+  static RecvResult parseMessage(struct msghdr& msg, ssize_t bytesRead);
+
   IoProvider(IoProvider const&) = delete;
   IoProvider& operator=(IoProvider const&) = delete;
 };
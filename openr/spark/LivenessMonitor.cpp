@@ -0,0 +1,278 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "LivenessMonitor.h"
+
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <fb303/ServiceData.h>
+#include <folly/String.h>
+#include <glog/logging.h>
+
+#include "CompactHeartbeat.h"
+
+namespace fb303 = facebook::fb303;
+
+namespace openr {
+
+namespace {
+
+// heartbeats are single hop, see GTSM
+const int kLivenessHopLimit = 255;
+
+// heartbeats are a compact heartbeat header and a node name
+const int kMaxHeartbeatLen = 512;
+
+// batch of heartbeats read at once
+const unsigned int kMaxHeartbeatsPerRead = 64;
+
+// tick of the hold timers
+const std::chrono::milliseconds kHoldTimerTick{5};
+
+} // namespace
+
+LivenessMonitor::LivenessMonitor(
+    std::string const& myNodeName,
+    LivenessConfig const& config,
+    std::optional<int> maybeIpTos,
+    std::shared_ptr<IoProvider> ioProvider,
+    DownCallback downCallback)
+    : myNodeName_(myNodeName),
+      config_(config),
+      ioProvider_(std::move(ioProvider)),
+      downCallback_(std::move(downCallback)) {
+  CHECK(config_.txInterval > std::chrono::milliseconds(0))
+      << "Liveness tx interval can't be 0";
+  CHECK(config_.holdTime >= 3 * config_.txInterval)
+      << "Liveness tx interval must be less than hold time";
+  CHECK(ioProvider_) << "Got null IoProvider";
+  CHECK(downCallback_);
+
+  recvBufs_.resize(kMaxHeartbeatLen, kMaxHeartbeatsPerRead);
+  packet_.reserve(compact_heartbeat::kHeaderLen + myNodeName_.size());
+  holdTimers_ = folly::HHWheelTimer::newTimer(getEvb(), kHoldTimerTick);
+  prepareSocket(maybeIpTos);
+
+  txTimer_ = WheelTimeout::make(
+      holdTimers_.get(), [this]() noexcept { sendHeartbeats(); });
+  txTimer_->scheduleTimeout(config_.txInterval, true /* isPeriodic */);
+}
+
+LivenessMonitor::~LivenessMonitor() {
+  removeSocketFd(fd_);
+  ::close(fd_);
+}
+
+void
+LivenessMonitor::prepareSocket(std::optional<int> maybeIpTos) {
+  fd_ = ioProvider_->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+  if (fd_ < 0) {
+    LOG(FATAL) << "Failed creating liveness UDP socket. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  if (ioProvider_->fcntl(fd_, F_SETFL, O_NONBLOCK) != 0) {
+    LOG(FATAL) << "Failed making the liveness socket non-blocking. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  const int enabled = 1;
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_V6ONLY, &enabled, sizeof(enabled)) != 0) {
+    LOG(FATAL) << "Failed making the liveness socket v6 only. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  // input iface index, to tell sessions to the same neighbor apart
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_RECVPKTINFO, &enabled, sizeof(enabled)) !=
+      0) {
+    LOG(FATAL) << "Failed enabling PKTINFO option. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_RECVHOPLIMIT, &enabled, sizeof(enabled)) !=
+      0) {
+    LOG(FATAL) << "Failed enabling TTL receive on liveness socket. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  const int hopLimit = kLivenessHopLimit;
+  if (ioProvider_->setsockopt(
+          fd_, IPPROTO_IPV6, IPV6_UNICAST_HOPS, &hopLimit, sizeof(hopLimit)) !=
+      0) {
+    LOG(FATAL) << "Failed setting TTL on liveness socket. Error: "
+               << folly::errnoStr(errno);
+  }
+
+  if (maybeIpTos) {
+    const int ipTos = *maybeIpTos;
+    if (ioProvider_->setsockopt(
+            fd_, IPPROTO_IPV6, IPV6_TCLASS, &ipTos, sizeof(ipTos)) != 0) {
+      LOG(FATAL) << "Failed setting ip-tos value on liveness socket. Error: "
+                 << folly::errnoStr(errno);
+    }
+  }
+
+  const folly::SocketAddress bindAddr(folly::IPAddress("::"), config_.port);
+  sockaddr_storage addrStorage;
+  bindAddr.getAddress(&addrStorage);
+  if (ioProvider_->bind(
+          fd_,
+          reinterpret_cast<sockaddr*>(&addrStorage),
+          bindAddr.getActualSize()) != 0) {
+    LOG(FATAL) << "Failed binding the liveness socket to port "
+               << config_.port << ". Error: " << folly::errnoStr(errno);
+  }
+
+  addSocketFd(fd_, ZMQ_POLLIN, [this](int) noexcept {
+    try {
+      processHeartbeats();
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "Liveness: error receiving heartbeats "
+                 << folly::exceptionStr(err);
+    }
+  });
+}
+
+uint64_t
+LivenessMonitor::addSession(
+    int ifIndex,
+    folly::IPAddressV6 const& localAddr,
+    std::string const& neighborName,
+    folly::SocketAddress const& neighborAddr,
+    std::chrono::milliseconds holdTime) {
+  const auto sessionId = nextSessionId_++;
+  runInEventBaseThread([this,
+                        sessionId,
+                        ifIndex,
+                        localAddr,
+                        neighborName,
+                        neighborAddr,
+                        holdTime]() noexcept {
+    auto key = std::make_pair(ifIndex, neighborName);
+    auto it = sessionIds_.find(key);
+    if (it != sessionIds_.end()) {
+      eraseSession(it->second);
+    }
+
+    auto& session = sessions_[sessionId];
+    session.ifIndex = ifIndex;
+    session.localAddr = localAddr;
+    session.neighborName = neighborName;
+    session.neighborAddr = neighborAddr;
+    session.holdTime = holdTime;
+    session.holdTimer = WheelTimeout::make(
+        holdTimers_.get(),
+        [this, sessionId]() noexcept { processHoldTimeout(sessionId); });
+    session.holdTimer->scheduleTimeout(session.holdTime);
+    sessionIds_.emplace(std::move(key), sessionId);
+  });
+  return sessionId;
+}
+
+void
+LivenessMonitor::removeSession(uint64_t sessionId) {
+  runInEventBaseThread([this, sessionId]() noexcept {
+    eraseSession(sessionId);
+  });
+}
+
+size_t
+LivenessMonitor::getNumSessions() {
+  size_t numSessions{0};
+  getEvb()->runInEventBaseThreadAndWait(
+      [this, &numSessions]() { numSessions = sessions_.size(); });
+  return numSessions;
+}
+
+void
+LivenessMonitor::eraseSession(uint64_t sessionId) {
+  auto it = sessions_.find(sessionId);
+  if (it == sessions_.end()) {
+    return;
+  }
+  sessionIds_.erase(
+      std::make_pair(it->second.ifIndex, it->second.neighborName));
+  sessions_.erase(it);
+}
+
+void
+LivenessMonitor::sendHeartbeats() {
+  compact_heartbeat::write(
+      myNodeName_, static_cast<int64_t>(seqNum_++), packet_);
+  for (auto const& kv : sessions_) {
+    auto const& session = kv.second;
+    const auto bytesSent = IoProvider::sendMessage(
+        fd_,
+        session.ifIndex,
+        session.localAddr,
+        session.neighborAddr,
+        packet_,
+        ioProvider_.get());
+    if (bytesSent < 0 or static_cast<size_t>(bytesSent) != packet_.size()) {
+      VLOG(1) << "Sending liveness heartbeat to "
+              << session.neighborAddr.describe() << " failed due to error "
+              << folly::errnoStr(errno);
+    }
+  }
+  fb303::fbData->addStatValue(
+      "spark.liveness.heartbeats_sent", sessions_.size(), fb303::SUM);
+}
+
+void
+LivenessMonitor::processHeartbeats() {
+  auto const& recvResults =
+      IoProvider::recvMessages(fd_, recvBufs_, ioProvider_.get());
+  for (size_t i = 0; i < recvResults.size(); ++i) {
+    const auto bytesRead = std::get<0>(recvResults[i]);
+    const auto ifIndex = std::get<1>(recvResults[i]);
+    const auto hopLimit = std::get<3>(recvResults[i]);
+    if (bytesRead < 0 or hopLimit < kLivenessHopLimit) {
+      fb303::fbData->addStatValue(
+          "spark.liveness.invalid_heartbeat", 1, fb303::SUM);
+      continue;
+    }
+
+    const auto heartbeat = compact_heartbeat::parse(
+        folly::ByteRange(recvBufs_.data(i), bytesRead));
+    if (not heartbeat.has_value()) {
+      fb303::fbData->addStatValue(
+          "spark.liveness.invalid_heartbeat", 1, fb303::SUM);
+      continue;
+    }
+
+    // keeps its capacity, so this doesn't allocate past the first heartbeats
+    rxKey_.first = ifIndex;
+    rxKey_.second.assign(
+        heartbeat->nodeName.data(), heartbeat->nodeName.size());
+    auto it = sessionIds_.find(rxKey_);
+    if (it == sessionIds_.end()) {
+      VLOG(3) << "Liveness heartbeat of unknown neighbor " << rxKey_.second
+              << " on ifIndex " << ifIndex;
+      continue;
+    }
+    auto& session = sessions_.at(it->second);
+    session.holdTimer->scheduleTimeout(session.holdTime);
+  }
+}
+
+void
+LivenessMonitor::processHoldTimeout(uint64_t sessionId) {
+  auto const& session = sessions_.at(sessionId);
+  LOG(INFO) << "Liveness hold timer expired for: " << session.neighborName
+            << " on ifIndex " << session.ifIndex;
+  fb303::fbData->addStatValue("spark.liveness.session_down", 1, fb303::SUM);
+
+  // the session is gone before its owner hears about it
+  eraseSession(sessionId);
+  downCallback_(sessionId);
+}
+
+} // namespace openr
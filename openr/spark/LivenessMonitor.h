@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/IPAddressV6.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/async/HHWheelTimer.h>
+
+#include <openr/common/OpenrEventBase.h>
+#include <openr/common/WheelTimeout.h>
+#include <openr/spark/IoProvider.h>
+
+namespace openr {
+
+struct LivenessConfig {
+  // UDP port to receive liveness heartbeats on
+  uint16_t port{0};
+
+  // interval of heartbeats sent to each neighbor
+  std::chrono::milliseconds txInterval{0};
+
+  // my hold time, neighbors use the larger one of theirs and mine
+  std::chrono::milliseconds holdTime{0};
+
+  // SCHED_FIFO priority of the monitor thread, 0 keeps the default policy
+  int threadPriority{0};
+};
+
+/**
+ * Liveness of established Spark2 adjacencies, off the Spark event loop. In
+ * the spirit of single-hop BFD: a stall of Spark can't cause false positives,
+ * so hold times can go well below a second.
+ *
+ * Runs in a thread of its own with a UDP socket of its own. Each session
+ * sends unicast heartbeats in the compact format (see CompactHeartbeat.h) to
+ * the liveness port of its neighbor every txInterval and expects the same from
+ * it within holdTime. Heartbeats are sent with hop limit 255 and only taken
+ * with it, so they come from on link. When a session expires, it is removed
+ * and reported to downCallback, from the monitor thread.
+ *
+ * Spark keeps discovering and negotiating adjacencies, it adds a session once
+ * one is established and removes it when it goes away.
+ */
+class LivenessMonitor final : public OpenrEventBase {
+ public:
+  using DownCallback = std::function<void(uint64_t sessionId)>;
+
+  LivenessMonitor(
+      std::string const& myNodeName,
+      LivenessConfig const& config,
+      std::optional<int> maybeIpTos,
+      std::shared_ptr<IoProvider> ioProvider,
+      DownCallback downCallback);
+
+  ~LivenessMonitor() override;
+
+  /**
+   * Start monitoring neighborName on ifIndex, returns the id of the session.
+   * Thread-safe. A session to the same neighbor on the same interface gets
+   * replaced.
+   */
+  uint64_t addSession(
+      int ifIndex,
+      folly::IPAddressV6 const& localAddr,
+      std::string const& neighborName,
+      folly::SocketAddress const& neighborAddr,
+      std::chrono::milliseconds holdTime);
+
+  // stop monitoring, without reporting. Thread-safe, unknown ids are ignored
+  void removeSession(uint64_t sessionId);
+
+  // Thread-safe, mainly for testing
+  size_t getNumSessions();
+
+ private:
+  struct Session {
+    int ifIndex{0};
+    folly::IPAddressV6 localAddr;
+    std::string neighborName;
+    folly::SocketAddress neighborAddr;
+    std::chrono::milliseconds holdTime{0};
+    std::unique_ptr<WheelTimeout> holdTimer;
+  };
+
+  void prepareSocket(std::optional<int> maybeIpTos);
+
+  // one heartbeat to each session
+  void sendHeartbeats();
+
+  void processHeartbeats();
+
+  void processHoldTimeout(uint64_t sessionId);
+
+  void eraseSession(uint64_t sessionId);
+
+  const std::string myNodeName_;
+
+  const LivenessConfig config_;
+
+  std::shared_ptr<IoProvider> ioProvider_;
+
+  const DownCallback downCallback_;
+
+  int fd_{-1};
+
+  std::atomic<uint64_t> nextSessionId_{1};
+
+  // wheel of the hold timers, must outlive the sessions below
+  folly::HHWheelTimer::UniquePtr holdTimers_;
+
+  std::unique_ptr<WheelTimeout> txTimer_;
+
+  std::unordered_map<uint64_t, Session> sessions_;
+
+  // session of each (ifIndex, neighbor name)
+  std::map<std::pair<int, std::string>, uint64_t> sessionIds_;
+
+  // key of the heartbeat being processed, reused across packets
+  std::pair<int, std::string> rxKey_;
+
+  IoProvider::RecvBuffers recvBufs_;
+
+  // heartbeat being sent, reused across sends
+  std::string packet_;
+
+  uint64_t seqNum_{0};
+};
+
+} // namespace openr
@@ -13,7 +13,10 @@
 #include <sodium.h>
 
 #include <fcntl.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
 #include <algorithm>
+#include <array>
 #include <functional>
 #include <vector>
 
@@ -27,16 +30,18 @@
 #include <folly/ScopeGuard.h>
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
+#include <folly/Varint.h>
 #include <folly/fibers/FiberManagerMap.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/Promise.h>
-#include <folly/gen/Base.h>
+#include <folly/system/ThreadName.h>
 #include <openr/if/gen-cpp2/KvStore_constants.h>
 
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
 
+#include "CompactHeartbeat.h"
 #include "IoProvider.h"
 
 namespace fb303 = facebook::fb303;
@@ -48,6 +53,29 @@ namespace {
 //
 const int kMinIpv6Mtu = 1280;
 
+//
+// Tick of the wheel driving all per-neighbor timers, i.e. their precision
+//
+const std::chrono::milliseconds kNeighborTimerTick{10};
+
+//
+// Max number of hello packets whose tx timestamps are kept, hellos get echoed
+// by neighbors within one hello interval
+//
+const size_t kMaxTxTimestamps = 4096;
+
+//
+// Max time between the user space and kernel timestamps of a sent packet,
+// larger ones are taken as a mismatch of the two
+//
+const std::chrono::microseconds kMaxTxTimestampDelay{10000};
+
+//
+// Max number of hello packets received with a single recvmmsg per wakeup of
+// the multicast socket, the rest gets read on the next one
+//
+const unsigned int kMaxHelloPacketsPerRead = 64;
+
 //
 // The acceptable hop limit, assuming we send packets with this TTL
 //
@@ -71,6 +99,9 @@ const int64_t kAbsThreshold = 500;
 // number of restarting packets to send out per interface before I'm going down
 const int kNumRestartingPktSent = 3;
 
+// min number of heartbeats per hold time of adaptive heartbeats
+const int kMinHeartbeatsPerHoldTime = 3;
+
 //
 // Function to get current timestamp in microseconds using steady clock
 // NOTE: we use non-monotonic clock since kernel time-stamps do not support
@@ -221,7 +252,7 @@ Spark::Neighbor::Neighbor(
     thrift::SparkNeighbor const& info,
     uint32_t label,
     uint64_t seqNum,
-    std::unique_ptr<fbzmq::ZmqTimeout> holdTimer,
+    std::unique_ptr<WheelTimeout> holdTimer,
     const std::chrono::milliseconds& samplingPeriod,
     std::function<void(const int64_t&)> rttChangeCb,
     std::string areaId)
@@ -286,7 +317,8 @@ Spark::Spark(
     std::optional<int> maybeIpTos,
     bool enableV4,
     messaging::RQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue,
-    messaging::ReplicateQueue<thrift::SparkNeighborEvent>& neighborUpdatesQueue,
+    messaging::ReplicateQueue<thrift::SparkNeighborEvents>&
+        neighborUpdatesQueue,
     KvStoreCmdPort kvStoreCmdPort,
     OpenrCtrlThriftPort openrCtrlThriftPort,
     std::pair<uint32_t, uint32_t> version,
@@ -295,7 +327,10 @@ Spark::Spark(
     bool enableFloodOptimization,
     bool enableSpark2,
     bool increaseHelloInterval,
-    std::optional<std::unordered_set<std::string>> areas)
+    std::optional<std::unordered_set<std::string>> areas,
+    SparkWorkerInfo workerInfo,
+    std::optional<LivenessConfig> livenessConfig,
+    std::optional<AdaptiveHeartbeatConfig> adaptiveHeartbeatConfig)
     : myDomainName_(myDomainName),
       myNodeName_(myNodeName),
       udpMcastPort_(udpMcastPort),
@@ -309,6 +344,8 @@ Spark::Spark(
       myNegotiateHoldTime_(myNegotiateHoldTime),
       myHeartbeatHoldTime_(myHeartbeatHoldTime),
       enableV4_(enableV4),
+      txKeyToSentTime_(kMaxTxTimestamps),
+      kernelSentTimes_(kMaxTxTimestamps),
       neighborUpdatesQueue_(neighborUpdatesQueue),
       kKvStoreCmdPort_(kvStoreCmdPort),
       kOpenrCtrlThriftPort_(openrCtrlThriftPort),
@@ -316,6 +353,14 @@ Spark::Spark(
       enableFloodOptimization_(enableFloodOptimization),
       enableSpark2_(enableSpark2),
       increaseHelloInterval_(increaseHelloInterval),
+      allocatedLabels_(
+          workerInfo.allocatedLabels
+              ? std::move(workerInfo.allocatedLabels)
+              : std::make_shared<folly::Synchronized<std::set<int32_t>>>()),
+      workerId_(workerInfo.workerId),
+      numWorkers_(workerInfo.numWorkers),
+      livenessConfig_(std::move(livenessConfig)),
+      adaptiveHeartbeatConfig_(std::move(adaptiveHeartbeatConfig)),
       ioProvider_(std::move(ioProvider)),
       areas_(std::move(areas)) {
   CHECK(myHoldTime_ >= 3 * myKeepAliveTime)
@@ -327,6 +372,11 @@ Spark::Spark(
   CHECK(fastInitKeepAliveTime <= myKeepAliveTime)
       << "fast-init-keep-alive-time must not be bigger than keep-alive-time";
   CHECK(ioProvider_) << "Got null IoProvider";
+  CHECK_LT(workerId_, numWorkers_) << "Invalid Spark worker id";
+
+  recvBufs_.resize(kMinIpv6Mtu, kMaxHelloPacketsPerRead);
+  neighborTimers_ = folly::HHWheelTimer::newTimer(getEvb(), kNeighborTimerTick);
+  buildHeartbeatTemplate();
 
   // Initialize list of BucketedTimeSeries
   const std::chrono::seconds sec{1};
@@ -354,6 +404,32 @@ Spark::Spark(
   // Initialize UDP socket for neighbor discovery
   prepare(maybeIpTos);
 
+  // liveness is for Spark2 adjacencies only
+  if (enableSpark2_ and livenessConfig_.has_value()) {
+    liveness_ = std::make_unique<LivenessMonitor>(
+        myNodeName_,
+        *livenessConfig_,
+        maybeIpTos,
+        ioProvider_,
+        [this](uint64_t sessionId) {
+          runInEventBaseThread(
+              [this, sessionId]() { processLivenessTimeout(sessionId); });
+        });
+    livenessThread_ = std::thread([this]() {
+      folly::setThreadName("SparkLiveness");
+      if (livenessConfig_->threadPriority > 0) {
+        struct sched_param param;
+        param.sched_priority = livenessConfig_->threadPriority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+          LOG(WARNING) << "Failed raising priority of liveness monitor to "
+                       << param.sched_priority << ". Keeping the default.";
+        }
+      }
+      liveness_->run();
+    });
+    liveness_->waitUntilRunning();
+  }
+
   // Initialize some stat keys
   fb303::fbData->addStatExportType(
       "spark.invalid_keepalive.different_domain", fb303::SUM);
@@ -408,9 +484,23 @@ Spark::stop() {
 
   LOG(INFO)
       << "I have sent all restarting packets to my neighbors, ready to go down";
+  stopLivenessMonitor();
   OpenrEventBase::stop();
 }
 
+Spark::~Spark() {
+  stopLivenessMonitor();
+}
+
+void
+Spark::stopLivenessMonitor() {
+  if (livenessThread_.joinable()) {
+    liveness_->stop();
+    liveness_->waitUntilStopped();
+    livenessThread_.join();
+  }
+}
+
 void
 Spark::prepare(std::optional<int> maybeIpTos) noexcept {
   int fd = ioProvider_->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
@@ -514,6 +604,27 @@ Spark::prepare(std::optional<int> maybeIpTos) noexcept {
                << folly::errnoStr(errno);
   }
 
+  // steer packets of my interfaces to my socket, all sockets of the workers
+  // get a copy of every packet otherwise
+  if (numWorkers_ > 1) {
+    std::array<struct sock_filter, 5> filter{{
+        // A = ifIndex of the packet
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_IFINDEX),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, numWorkers_),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, workerId_, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0xffffffff), // accept
+        BPF_STMT(BPF_RET | BPF_K, 0), // drop
+    }};
+    struct sock_fprog prog;
+    prog.len = filter.size();
+    prog.filter = filter.data();
+    if (ioProvider_->setsockopt(
+            fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) != 0) {
+      LOG(FATAL) << "Failed attaching Spark worker filter. Error: "
+                 << folly::errnoStr(errno);
+    }
+  }
+
   // enable timestamping for this socket
   const int enabled = 1;
   if (ioProvider_->setsockopt(
@@ -523,14 +634,29 @@ Spark::prepare(std::optional<int> maybeIpTos) noexcept {
                << folly::errnoStr(errno);
   }
 
+  // and timestamping of sent packets, looped back on the error queue without
+  // their data, keyed by a count of the packets sent
+  const int txTsFlags = SOF_TIMESTAMPING_TX_SOFTWARE |
+      SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+      SOF_TIMESTAMPING_OPT_TSONLY;
+  if (ioProvider_->setsockopt(
+          fd, SOL_SOCKET, SO_TIMESTAMPING, &txTsFlags, sizeof(txTsFlags)) !=
+      0) {
+    LOG(ERROR) << "Failed to enable kernel tx timestamping. Measured RTTs "
+               << "include the time hellos take to get out. Error: "
+               << folly::errnoStr(errno);
+  } else {
+    txTimestampsEnabled_ = true;
+  }
+
   LOG(INFO) << "Spark thread attaching socket/events callbacks...";
 
   // Listen for incoming messages on multicast FD
   addSocketFd(mcastFd_, ZMQ_POLLIN, [this](int) noexcept {
     try {
-      processHelloPacket();
+      processHelloPackets();
     } catch (std::exception const& err) {
-      LOG(ERROR) << "Spark: error processing hello packet "
+      LOG(ERROR) << "Spark: error receiving hello packets "
                  << folly::exceptionStr(err);
     }
   });
@@ -615,8 +741,8 @@ Spark::validateHelloPacket(
 
   // first time we hear from this guy, add to tracking list
   if (it == ifNeighbors.end()) {
-    auto holdTimer = fbzmq::ZmqTimeout::make(
-        getEvb(), [this, ifName, neighborName]() noexcept {
+    auto holdTimer = WheelTimeout::make(
+        neighborTimers_.get(), [this, ifName, neighborName]() noexcept {
           processNeighborHoldTimeout(ifName, neighborName);
         });
 
@@ -711,7 +837,7 @@ Spark::processNeighborRttChange(
       neighbor.label,
       false /* supportFloodOptimization: doesn't matter in RTT event*/,
       neighbor.area);
-  neighborUpdatesQueue_.push(std::move(event));
+  queueNeighborEvent(std::move(event));
 }
 
 void
@@ -728,7 +854,7 @@ Spark::processNeighborHoldTimeout(
 
   // remove from tracked neighbor at the end
   SCOPE_EXIT {
-    allocatedLabels_.erase(neighbor.label);
+    allocatedLabels_->wlock()->erase(neighbor.label);
     ifNeighbors.erase(neighborName);
   };
 
@@ -746,17 +872,16 @@ Spark::processNeighborHoldTimeout(
         neighbor.label,
         false /* supportFloodOptimization: doesn't matter in GR-expired event*/,
         neighbor.area);
-    neighborUpdatesQueue_.push(std::move(event));
+    queueNeighborEvent(std::move(event));
   } else {
     VLOG(2) << "Neighbor went down, but was not adjacent, not reporting";
   }
 }
 
 bool
-Spark::shouldProcessHelloPacket(
-    std::string const& ifName, folly::IPAddress const& addr) {
-  size_t index = std::hash<std::tuple<std::string, folly::IPAddress>>{}(
-                     std::make_tuple(ifName, addr)) %
+Spark::shouldProcessHelloPacket(int ifIndex, folly::IPAddress const& addr) {
+  size_t index = std::hash<std::tuple<int, folly::IPAddress>>{}(
+                     std::make_tuple(ifIndex, addr)) %
       Constants::kNumTimeSeries;
 
   // check our timeseries to see if we want to process anymore right now
@@ -771,20 +896,20 @@ Spark::shouldProcessHelloPacket(
 }
 
 bool
-Spark::parsePacket(
-    thrift::SparkHelloPacket& pkt,
-    std::string& ifName,
+Spark::checkPacket(
+    const IoProvider::RecvResult& recvResult,
+    InterfaceContext*& ifContext,
     std::chrono::microseconds& recvTime) {
-  // the read buffer
-  uint8_t buf[kMinIpv6Mtu];
-
   ssize_t bytesRead;
   int ifIndex;
   folly::SocketAddress clientAddr;
   int hopLimit;
 
-  std::tie(bytesRead, ifIndex, clientAddr, hopLimit, recvTime) =
-      IoProvider::recvMessage(mcastFd_, buf, kMinIpv6Mtu, ioProvider_.get());
+  std::tie(bytesRead, ifIndex, clientAddr, hopLimit, recvTime) = recvResult;
+  if (bytesRead < 0) {
+    LOG(ERROR) << "Dropping truncated message on fd " << mcastFd_;
+    return false;
+  }
 
   if (hopLimit < kSparkHopLimit) {
     LOG(ERROR) << "Rejecting packet from " << clientAddr.getAddressStr()
@@ -792,15 +917,14 @@ Spark::parsePacket(
     return false;
   }
 
-  auto res = findInterfaceFromIfindex(ifIndex);
-  if (!res.has_value()) {
+  ifContext = findInterfaceFromIfindex(ifIndex);
+  if (not ifContext) {
     LOG(ERROR) << "Received packet from " << clientAddr.getAddressStr()
                << " on unknown interface with index " << ifIndex
                << ". Ignoring the packet.";
     return false;
   }
-
-  ifName = res.value();
+  auto const& ifName = ifContext->ifName;
 
   VLOG(4) << "Received message on " << ifName << " ifindex " << ifIndex
           << " from " << clientAddr.getAddressStr();
@@ -812,7 +936,7 @@ Spark::parsePacket(
   fb303::fbData->addStatValue(
       "spark.hello_packet_recv_size", bytesRead, fb303::SUM);
 
-  if (!shouldProcessHelloPacket(ifName, clientAddr.getIPAddress())) {
+  if (!shouldProcessHelloPacket(ifIndex, clientAddr.getIPAddress())) {
     LOG(ERROR) << "Spark: dropping hello packet due to rate limiting on iface: "
                << ifName << " from addr: " << clientAddr.getAddressStr();
     fb303::fbData->addStatValue("spark.hello_packet_dropped", 1, fb303::SUM);
@@ -821,22 +945,21 @@ Spark::parsePacket(
 
   fb303::fbData->addStatValue("spark.hello_packet_processed", 1, fb303::SUM);
 
-  if (bytesRead >= 0) {
-    VLOG(4) << "Read a total of " << bytesRead << " bytes from fd " << mcastFd_;
+  VLOG(4) << "Read a total of " << bytesRead << " bytes from fd " << mcastFd_;
 
-    if (static_cast<size_t>(bytesRead) > kMinIpv6Mtu) {
-      LOG(ERROR) << "Message from " << clientAddr.getAddressStr()
-                 << " has been truncated";
-      return false;
-    }
-  } else {
-    LOG(ERROR) << "Failed reading from fd " << mcastFd_ << " error "
-               << folly::errnoStr(errno);
+  if (static_cast<size_t>(bytesRead) > kMinIpv6Mtu) {
+    LOG(ERROR) << "Message from " << clientAddr.getAddressStr()
+               << " has been truncated";
     return false;
   }
+  return true;
+}
 
+bool
+Spark::parsePacket(folly::ByteRange packet, thrift::SparkHelloPacket& pkt) {
   // Copy buffer into string object and parse it into helloPacket.
-  std::string readBuf(reinterpret_cast<const char*>(&buf[0]), bytesRead);
+  std::string readBuf(
+      reinterpret_cast<const char*>(packet.data()), packet.size());
   try {
     pkt =
         util::readThriftObjStr<thrift::SparkHelloPacket>(readBuf, serializer_);
@@ -1039,6 +1162,11 @@ Spark::sendHandshakeMsg(std::string const& ifName, bool isAdjEstablished) {
   handshakeMsg.area = openr::thrift::KvStore_constants::kDefaultArea();
   handshakeMsg.openrCtrlThriftPort = kOpenrCtrlThriftPort_;
   handshakeMsg.kvStoreCmdPort = kKvStoreCmdPort_;
+  handshakeMsg.compactHeartbeatVersion = compact_heartbeat::kVersion;
+  if (liveness_) {
+    handshakeMsg.livenessPort = livenessConfig_->port;
+    handshakeMsg.livenessHoldTime = livenessConfig_->holdTime.count();
+  }
 
   thrift::SparkHelloPacket pkt;
   pkt.handshakeMsg = handshakeMsg;
@@ -1046,16 +1174,14 @@ Spark::sendHandshakeMsg(std::string const& ifName, bool isAdjEstablished) {
   auto packet = util::writeThriftObjStr(pkt, serializer_);
 
   // send the pkt
-  folly::SocketAddress dstAddr(
-      folly::IPAddress(Constants::kSparkMcastAddr.toString()), udpMcastPort_);
+  auto const& dstAddr = mcastDstAddr_;
 
   if (kMinIpv6Mtu < packet.size()) {
     LOG(ERROR) << "Handshake packet is too big, can't send it out.";
     return;
   }
 
-  auto bytesSent = IoProvider::sendMessage(
-      mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
+  auto bytesSent = sendPacket(ifIndex, v6Addr.asV6(), packet);
 
   if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
     VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
@@ -1069,6 +1195,39 @@ Spark::sendHandshakeMsg(std::string const& ifName, bool isAdjEstablished) {
   fb303::fbData->addStatValue("spark.handshake.packets_sent", 1, fb303::SUM);
 }
 
+void
+Spark::buildHeartbeatTemplate() {
+  mcastDstAddr_ = folly::SocketAddress(
+      folly::IPAddress(Constants::kSparkMcastAddr.toString()), udpMcastPort_);
+
+  // heartbeat msgs differ in seqNum only. compact protocol writes it as a
+  // zigzag varint, one byte for both 0 and 1 and the only byte these two
+  // packets differ in. everything around it is kept.
+  std::string packets[2];
+  for (int64_t seqNum : {0, 1}) {
+    thrift::SparkHeartbeatMsg heartbeatMsg;
+    heartbeatMsg.nodeName = myNodeName_;
+    heartbeatMsg.seqNum = seqNum;
+
+    thrift::SparkHelloPacket pkt;
+    pkt.heartbeatMsg = heartbeatMsg;
+    packets[seqNum] = util::writeThriftObjStr(pkt, serializer_);
+  }
+  CHECK_EQ(packets[0].size(), packets[1].size());
+  const size_t offset = std::distance(
+      packets[0].begin(),
+      std::mismatch(packets[0].begin(), packets[0].end(), packets[1].begin())
+          .first);
+  CHECK_LT(offset, packets[0].size());
+
+  heartbeatPrefix_ = packets[0].substr(0, offset);
+  heartbeatSuffix_ = packets[0].substr(offset + 1);
+  heartbeatPacket_.reserve(std::max(
+      heartbeatPrefix_.size() + folly::kMaxVarintLength64 +
+          heartbeatSuffix_.size(),
+      compact_heartbeat::kHeaderLen + myNodeName_.size()));
+}
+
 void
 Spark::sendHeartbeatMsg(std::string const& ifName) {
   SCOPE_EXIT {
@@ -1094,27 +1253,31 @@ Spark::sendHeartbeatMsg(std::string const& ifName) {
   const auto ifIndex = interfaceEntry.ifIndex;
   const auto v6Addr = interfaceEntry.v6LinkLocalNetwork.first;
 
-  // build heartbeat msg
-  thrift::SparkHeartbeatMsg heartbeatMsg;
-  heartbeatMsg.nodeName = myNodeName_;
-  heartbeatMsg.seqNum = mySeqNum_;
-
-  thrift::SparkHelloPacket pkt;
-  pkt.heartbeatMsg = heartbeatMsg;
-
-  auto packet = util::writeThriftObjStr(pkt, serializer_);
+  // the buffer keeps its capacity, so neither format allocates
+  auto& packet = heartbeatPacket_;
+  const bool isCompact = canSendCompactHeartbeat(ifName);
+  if (isCompact) {
+    compact_heartbeat::write(
+        myNodeName_, static_cast<int64_t>(mySeqNum_), packet);
+  } else {
+    // patch my seqNum into the pre-serialized heartbeat msg
+    uint8_t seqNumBuf[folly::kMaxVarintLength64];
+    const auto seqNumLen = folly::encodeVarint(
+        folly::encodeZigZag(static_cast<int64_t>(mySeqNum_)), seqNumBuf);
+    packet.assign(heartbeatPrefix_);
+    packet.append(reinterpret_cast<const char*>(seqNumBuf), seqNumLen);
+    packet.append(heartbeatSuffix_);
+  }
 
   // send the pkt
-  folly::SocketAddress dstAddr(
-      folly::IPAddress(Constants::kSparkMcastAddr.toString()), udpMcastPort_);
+  auto const& dstAddr = mcastDstAddr_;
 
   if (kMinIpv6Mtu < packet.size()) {
-    LOG(ERROR) << "Handshake packet is too big, can't send it out.";
+    LOG(ERROR) << "Heartbeat packet is too big, can't send it out.";
     return;
   }
 
-  auto bytesSent = IoProvider::sendMessage(
-      mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
+  auto bytesSent = sendPacket(ifIndex, v6Addr.asV6(), packet);
 
   if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
     VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
@@ -1126,6 +1289,73 @@ Spark::sendHeartbeatMsg(std::string const& ifName) {
   fb303::fbData->addStatValue(
       "spark.heartbeat.bytes_sent", packet.size(), fb303::SUM);
   fb303::fbData->addStatValue("spark.heartbeat.packets_sent", 1, fb303::SUM);
+  if (isCompact) {
+    fb303::fbData->addStatValue(
+        "spark.heartbeat.compact_packets_sent", 1, fb303::SUM);
+  }
+}
+
+std::chrono::milliseconds
+Spark::updateHeartbeatInterval(std::string const& ifName) {
+  auto& state = ifNameToHeartbeatState_.at(ifName);
+
+  // heartbeats must keep up with the hold time negotiated with each neighbor,
+  // at least mine as neighbors hold adjacencies for the larger one
+  auto maxInterval = std::chrono::milliseconds::max();
+  auto activeIt = ifNameToActiveNeighbors_.find(ifName);
+  if (activeIt != ifNameToActiveNeighbors_.end()) {
+    auto const& ifNeighbors = spark2Neighbors_.at(ifName);
+    for (auto const& neighborName : activeIt->second) {
+      auto it = ifNeighbors.find(neighborName);
+      if (it != ifNeighbors.end()) {
+        maxInterval = std::min(maxInterval, it->second.heartbeatHoldTime);
+      }
+    }
+  }
+  if (maxInterval == std::chrono::milliseconds::max()) {
+    maxInterval = myHeartbeatHoldTime_;
+  }
+  maxInterval =
+      std::max(maxInterval / kMinHeartbeatsPerHoldTime, myHeartbeatTime_);
+
+  auto interval = myHeartbeatTime_;
+  const auto now = std::chrono::steady_clock::now();
+  if (now - state.lastAdjChange >= adaptiveHeartbeatConfig_->stableTime) {
+    interval = std::min(2 * state.interval, maxInterval);
+  }
+
+  // stretch intervals of all interfaces alike to stay within budget
+  const auto maxPerSec = adaptiveHeartbeatConfig_->maxHeartbeatsPerSec;
+  if (maxPerSec) {
+    const std::chrono::milliseconds minInterval(
+        1000 * ifNameToActiveNeighbors_.size() / maxPerSec);
+    if (interval < minInterval) {
+      interval = std::min(minInterval, maxInterval);
+      if (interval < minInterval) {
+        fb303::fbData->addStatValue(
+            "spark.heartbeat.over_budget", 1, fb303::SUM);
+      }
+    }
+  }
+
+  state.interval = interval;
+  fb303::fbData->addStatValue(
+      "spark.heartbeat.interval_ms", interval.count(), fb303::AVG);
+  return interval;
+}
+
+void
+Spark::resetHeartbeatInterval(std::string const& ifName) {
+  auto it = ifNameToHeartbeatState_.find(ifName);
+  if (it == ifNameToHeartbeatState_.end()) {
+    return;
+  }
+  auto& state = it->second;
+  state.lastAdjChange = std::chrono::steady_clock::now();
+  if (state.interval > myHeartbeatTime_) {
+    state.interval = myHeartbeatTime_;
+    ifNameToHeartbeatTimers_.at(ifName)->scheduleTimeout(myHeartbeatTime_);
+  }
 }
 
 void
@@ -1177,6 +1407,33 @@ Spark::getSparkNeighState(
   return std::move(future).get();
 }
 
+std::optional<SparkHeartbeatTimes>
+Spark::getSparkNeighHeartbeatTimes(
+    std::string const& ifName, std::string const& neighborName) {
+  folly::Promise<std::optional<SparkHeartbeatTimes>> promise;
+  auto future = promise.getFuture();
+
+  runInEventBaseThread(
+      [this, promise = std::move(promise), &ifName, &neighborName]() mutable {
+        auto activeIt = ifNameToActiveNeighbors_.find(ifName);
+        if (activeIt == ifNameToActiveNeighbors_.end() or
+            activeIt->second.count(neighborName) == 0) {
+          promise.setValue(std::nullopt);
+          return;
+        }
+        SparkHeartbeatTimes times;
+        times.sendInterval = myHeartbeatTime_;
+        auto stateIt = ifNameToHeartbeatState_.find(ifName);
+        if (stateIt != ifNameToHeartbeatState_.end()) {
+          times.sendInterval = stateIt->second.interval;
+        }
+        times.holdTime =
+            spark2Neighbors_.at(ifName).at(neighborName).heartbeatHoldTime;
+        promise.setValue(times);
+      });
+  return std::move(future).get();
+}
+
 void
 Spark::neighborUpWrapper(
     Spark2Neighbor& neighbor,
@@ -1189,14 +1446,17 @@ Spark::neighborUpWrapper(
   neighbor.negotiateHoldTimer.reset();
 
   // create heartbeat hold timer when promote to "ESTABLISHED"
-  neighbor.heartbeatHoldTimer = fbzmq::ZmqTimeout::make(
-      getEvb(), [this, ifName, neighborName]() noexcept {
+  neighbor.heartbeatHoldTimer = WheelTimeout::make(
+      neighborTimers_.get(), [this, ifName, neighborName]() noexcept {
         processHeartbeatTimeout(ifName, neighborName);
       });
   neighbor.heartbeatHoldTimer->scheduleTimeout(neighbor.heartbeatHoldTime);
 
   // add neighborName to collection
   ifNameToActiveNeighbors_[ifName].emplace(neighborName);
+  resetHeartbeatInterval(ifName);
+
+  startLivenessSession(neighbor, ifName, neighborName);
 
   // TODO: This is purely for backward compatibility.
   // Remove this after fully on Spark2.
@@ -1239,6 +1499,8 @@ Spark::neighborDownWrapper(
     Spark2Neighbor const& neighbor,
     std::string const& ifName,
     std::string const& neighborName) {
+  stopLivenessSession(neighbor.livenessSessionId);
+
   // notify LinkMonitor about neighbor DOWN state
   notifySparkNeighborEvent(
       thrift::SparkNeighborEventType::NEIGHBOR_DOWN,
@@ -1259,6 +1521,7 @@ Spark::neighborDownWrapper(
   if (ifNameToActiveNeighbors_.at(ifName).empty()) {
     ifNameToActiveNeighbors_.erase(ifName);
   }
+  resetHeartbeatInterval(ifName);
 }
 
 void
@@ -1278,7 +1541,26 @@ Spark::notifySparkNeighborEvent(
   event.label = label;
   event.supportFloodOptimization = supportFloodOptimization;
   event.area = area;
-  neighborUpdatesQueue_.push(std::move(event));
+  queueNeighborEvent(std::move(event));
+}
+
+void
+Spark::queueNeighborEvent(thrift::SparkNeighborEvent&& event) {
+  if (not neighborEventsFlush_.isLoopCallbackScheduled()) {
+    getEvb()->runInLoop(&neighborEventsFlush_);
+  }
+  pendingNeighborEvents_.emplace_back(std::move(event));
+}
+
+void
+Spark::flushNeighborEvents() {
+  if (pendingNeighborEvents_.empty()) {
+    return;
+  }
+  fb303::fbData->addStatValue(
+      "spark.neighbor_events", pendingNeighborEvents_.size(), fb303::SUM);
+  neighborUpdatesQueue_.push(std::move(pendingNeighborEvents_));
+  pendingNeighborEvents_.clear();
 }
 
 void
@@ -1290,7 +1572,8 @@ Spark::processHeartbeatTimeout(
 
   // remove from tracked neighbor at the end
   SCOPE_EXIT {
-    allocatedLabels_.erase(neighbor.label);
+    allocatedLabels_->wlock()->erase(neighbor.label);
+    resetHeartbeatNeighbor(ifName);
     ifNeighbors.erase(neighborName);
   };
 
@@ -1342,7 +1625,8 @@ Spark::processGRTimeout(
 
   // remove from tracked neighbor at the end
   SCOPE_EXIT {
-    allocatedLabels_.erase(neighbor.label);
+    allocatedLabels_->wlock()->erase(neighbor.label);
+    resetHeartbeatNeighbor(ifName);
     ifNeighbors.erase(neighborName);
   };
 
@@ -1377,8 +1661,8 @@ Spark::processGRMsg(
       neighbor.area);
 
   // start graceful-restart timer
-  neighbor.gracefulRestartHoldTimer = fbzmq::ZmqTimeout::make(
-      getEvb(), [this, ifName, neighborName]() noexcept {
+  neighbor.gracefulRestartHoldTimer = WheelTimeout::make(
+      neighborTimers_.get(), [this, ifName, neighborName]() noexcept {
         // change the state back to IDLE
         processGRTimeout(ifName, neighborName);
       });
@@ -1392,6 +1676,66 @@ Spark::processGRMsg(
 
   // neihbor is restarting, shutdown heartbeat hold timer
   neighbor.heartbeatHoldTimer.reset();
+  resetHeartbeatInterval(ifName);
+  stopLivenessSession(neighbor.livenessSessionId);
+  neighbor.livenessSessionId = 0;
+}
+
+void
+Spark::startLivenessSession(
+    Spark2Neighbor& neighbor,
+    std::string const& ifName,
+    std::string const& neighborName) {
+  if (not liveness_ or neighbor.livenessPort <= 0 or
+      neighbor.transportAddressV6.addr.empty()) {
+    return;
+  }
+
+  auto const& interfaceEntry = interfaceDb_.at(ifName);
+  const folly::SocketAddress neighborAddr(
+      toIPAddress(neighbor.transportAddressV6),
+      static_cast<uint16_t>(neighbor.livenessPort));
+  neighbor.livenessSessionId = liveness_->addSession(
+      interfaceEntry.ifIndex,
+      interfaceEntry.v6LinkLocalNetwork.first.asV6(),
+      neighborName,
+      neighborAddr,
+      std::max(neighbor.livenessHoldTime, livenessConfig_->holdTime));
+  livenessSessions_.emplace(
+      neighbor.livenessSessionId, std::make_pair(ifName, neighborName));
+}
+
+void
+Spark::stopLivenessSession(uint64_t sessionId) {
+  if (livenessSessions_.erase(sessionId)) {
+    liveness_->removeSession(sessionId);
+  }
+}
+
+void
+Spark::processLivenessTimeout(uint64_t sessionId) {
+  auto it = livenessSessions_.find(sessionId);
+  if (it == livenessSessions_.end()) {
+    return; // stopped meanwhile
+  }
+  const auto ifName = it->second.first;
+  const auto neighborName = it->second.second;
+  livenessSessions_.erase(it);
+
+  auto& ifNeighbors = spark2Neighbors_.at(ifName);
+  auto neighborIt = ifNeighbors.find(neighborName);
+  if (neighborIt == ifNeighbors.end() or
+      neighborIt->second.livenessSessionId != sessionId or
+      neighborIt->second.state != SparkNeighState::ESTABLISHED) {
+    return;
+  }
+
+  LOG(INFO) << "Liveness monitor lost neighbor: " << neighborName
+            << " on interface " << ifName;
+  fb303::fbData->addStatValue(
+      "spark.liveness.neighbor_down", 1, fb303::SUM);
+  neighborIt->second.livenessSessionId = 0;
+  processHeartbeatTimeout(ifName, neighborName);
 }
 
 void
@@ -1489,7 +1833,7 @@ Spark::processHelloMsg(
         // recvTime of neighbor helloPkt
         myRecvTimeInUs,
         // sentTime of my helloPkt recorded by neighbor
-        std::chrono::microseconds(ts.lastNbrMsgSentTsInUs),
+        getMySentTime(std::chrono::microseconds(ts.lastNbrMsgSentTsInUs)),
         // recvTime of my helloPkt recorded by neighbor
         std::chrono::microseconds(ts.lastMyMsgRcvdTsInUs),
         // sentTime of neighbor helloPkt
@@ -1537,8 +1881,8 @@ Spark::processHelloMsg(
                 << myRemoteSeqNum << "), my Seq#: (" << mySeqNum_ << ").";
       } else {
         // Starts timer to periodically send hankshake msg
-        neighbor.negotiateTimer =
-            fbzmq::ZmqTimeout::make(getEvb(), [this, ifName]() noexcept {
+        neighbor.negotiateTimer = WheelTimeout::make(
+            neighborTimers_.get(), [this, ifName]() noexcept {
               // periodically send out handshake msg
               sendHandshakeMsg(ifName, false);
             });
@@ -1546,8 +1890,8 @@ Spark::processHelloMsg(
         neighbor.negotiateTimer->scheduleTimeout(myHandshakeTime_, isPeriodic);
 
         // Starts negotiate hold-timer
-        neighbor.negotiateHoldTimer = fbzmq::ZmqTimeout::make(
-            getEvb(), [this, ifName, neighborName]() noexcept {
+        neighbor.negotiateHoldTimer = WheelTimeout::make(
+            neighborTimers_.get(), [this, ifName, neighborName]() noexcept {
               // prevent to stucking in NEGOTIATE forever
               processNegotiateTimeout(ifName, neighborName);
             });
@@ -1587,7 +1931,8 @@ Spark::processHelloMsg(
       neighborDownWrapper(neighbor, ifName, neighborName);
 
       // remove from tracked neighbor at the end
-      allocatedLabels_.erase(neighbor.label);
+      allocatedLabels_->wlock()->erase(neighbor.label);
+      resetHeartbeatNeighbor(ifName);
       ifNeighbors.erase(neighborName);
     }
   } else if (neighbor.state == SparkNeighState::RESTART) {
@@ -1619,8 +1964,8 @@ Spark::processHelloMsg(
             neighbor.area);
 
         // start heartbeat timer again to make sure neighbor is alive
-        neighbor.heartbeatHoldTimer = fbzmq::ZmqTimeout::make(
-            getEvb(), [this, ifName, neighborName]() noexcept {
+        neighbor.heartbeatHoldTimer = WheelTimeout::make(
+            neighborTimers_.get(), [this, ifName, neighborName]() noexcept {
               processHeartbeatTimeout(ifName, neighborName);
             });
         neighbor.heartbeatHoldTimer->scheduleTimeout(
@@ -1688,6 +2033,11 @@ Spark::processHandshakeMsg(
   neighbor.openrCtrlThriftPort = handshakeMsg.openrCtrlThriftPort;
   neighbor.transportAddressV4 = handshakeMsg.transportAddressV4;
   neighbor.transportAddressV6 = handshakeMsg.transportAddressV6;
+  neighbor.compactHeartbeatVersion =
+      handshakeMsg.compactHeartbeatVersion.value_or(0);
+  neighbor.livenessPort = handshakeMsg.livenessPort.value_or(0);
+  neighbor.livenessHoldTime =
+      std::chrono::milliseconds(handshakeMsg.livenessHoldTime.value_or(0));
 
   // recevied spark neighbors' area will be matched with configured interface's
   // area once interface based area identifier is implemented
@@ -1730,21 +2080,26 @@ Spark::processHandshakeMsg(
 
 void
 Spark::processHeartbeatMsg(
-    thrift::SparkHeartbeatMsg const& heartbeatMsg, std::string const& ifName) {
-  auto const& neighborName = heartbeatMsg.nodeName;
-  auto& ifNeighbors = spark2Neighbors_.at(ifName);
-  auto neighborIt = ifNeighbors.find(neighborName);
+    std::string const& neighborName, InterfaceContext& ifContext) {
+  // heartbeats on an interface mostly come from the same neighbor
+  if (not ifContext.heartbeatNeighbor or
+      ifContext.heartbeatNeighborName != neighborName) {
+    auto& ifNeighbors = spark2Neighbors_.at(ifContext.ifName);
+    auto neighborIt = ifNeighbors.find(neighborName);
 
-  // under GR case, when node restarts, it will needs several helloMsg to
-  // establish neighborship. During this time, heartbeatMsg from peer
-  // will NOT be processed.
-  if (neighborIt == ifNeighbors.end()) {
-    VLOG(3) << "I am NOT aware of neighbor: (" << neighborName
-            << "). Ignore it.";
-    return;
+    // under GR case, when node restarts, it will needs several helloMsg to
+    // establish neighborship. During this time, heartbeatMsg from peer
+    // will NOT be processed.
+    if (neighborIt == ifNeighbors.end()) {
+      VLOG(3) << "I am NOT aware of neighbor: (" << neighborName
+              << "). Ignore it.";
+      return;
+    }
+    ifContext.heartbeatNeighborName = neighborName;
+    ifContext.heartbeatNeighbor = &neighborIt->second;
   }
 
-  auto& neighbor = neighborIt->second;
+  auto& neighbor = *ifContext.heartbeatNeighbor;
 
   // In case receiving heartbeat msg when it is NOT in established state,
   // Just ignore it.
@@ -1760,13 +2115,138 @@ Spark::processHeartbeatMsg(
 }
 
 void
-Spark::processHelloPacket() {
-  // Step 1: receive and parse pkt
-  thrift::SparkHelloPacket helloPacket;
-  std::string ifName;
+Spark::processCompactHeartbeat(
+    folly::ByteRange packet, InterfaceContext& ifContext) {
+  const auto heartbeat = compact_heartbeat::parse(packet);
+  if (not heartbeat.has_value()) {
+    LOG(ERROR) << "Failed parsing compact heartbeat of version "
+               << (packet.size() > 1 ? static_cast<int>(packet[1]) : -1)
+               << " on " << ifContext.ifName;
+    fb303::fbData->addStatValue(
+        "spark.invalid_heartbeat.compact", 1, fb303::SUM);
+    return;
+  }
+
+  // keeps its capacity, so this doesn't allocate past the first heartbeats
+  compactHeartbeatNodeName_.assign(
+      heartbeat->nodeName.data(), heartbeat->nodeName.size());
+  processHeartbeatMsg(compactHeartbeatNodeName_, ifContext);
+}
+
+bool
+Spark::canSendCompactHeartbeat(std::string const& ifName) const {
+  auto const& ifNeighbors = spark2Neighbors_.at(ifName);
+  for (auto const& neighborName : ifNameToActiveNeighbors_.at(ifName)) {
+    auto it = ifNeighbors.find(neighborName);
+    if (it == ifNeighbors.end() or
+        it->second.compactHeartbeatVersion < compact_heartbeat::kVersion) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+Spark::processHelloPackets() {
+  // tx timestamps of my hellos are in before the replies to them
+  if (txTimestampsEnabled_) {
+    processTxTimestamps();
+  }
+
+  auto const& recvResults =
+      IoProvider::recvMessages(mcastFd_, recvBufs_, ioProvider_.get());
+  VLOG(4) << "Received " << recvResults.size() << " packets on fd "
+          << mcastFd_;
+  for (size_t i = 0; i < recvResults.size(); ++i) {
+    // a bad packet must not cost the rest of the batch
+    try {
+      processHelloPacket(recvResults[i], recvBufs_.data(i));
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "Spark: error processing hello packet "
+                 << folly::exceptionStr(err);
+    }
+  }
+}
+
+void
+Spark::processTxTimestamps() {
+  std::vector<IoProvider::TxTimestamp> txTimestamps;
+  try {
+    txTimestamps = IoProvider::recvTxTimestamps(mcastFd_, ioProvider_.get());
+  } catch (std::exception const& err) {
+    LOG(ERROR) << "Spark: error receiving tx timestamps "
+               << folly::exceptionStr(err);
+    return;
+  }
+
+  for (auto const& txTimestamp : txTimestamps) {
+    auto it = txKeyToSentTime_.findWithoutPromotion(txTimestamp.first);
+    if (it == txKeyToSentTime_.end()) {
+      continue; // not a hello packet
+    }
+    const auto sentTs = it->second;
+    const auto kernelSentTs = txTimestamp.second;
+    txKeyToSentTime_.erase(txTimestamp.first);
+
+    // the kernel stamps packets after user space did, unless our count of
+    // keys went out of sync with the kernel one
+    if (kernelSentTs < sentTs or kernelSentTs - sentTs > kMaxTxTimestampDelay) {
+      VLOG(2) << "Ignoring tx timestamp " << kernelSentTs.count()
+              << " of hello packet sent at " << sentTs.count();
+      continue;
+    }
+    kernelSentTimes_.set(sentTs.count(), kernelSentTs);
+  }
+}
+
+std::chrono::microseconds
+Spark::getMySentTime(std::chrono::microseconds sentTs) {
+  auto it = kernelSentTimes_.findWithoutPromotion(sentTs.count());
+  return it == kernelSentTimes_.end() ? sentTs : it->second;
+}
+
+ssize_t
+Spark::sendPacket(
+    int ifIndex,
+    folly::IPAddressV6 const& srcAddr,
+    std::string const& packet,
+    std::chrono::microseconds sentTs) {
+  const auto bytesSent = IoProvider::sendMessage(
+      mcastFd_, ifIndex, srcAddr, mcastDstAddr_, packet, ioProvider_.get());
+  if (txTimestampsEnabled_ and bytesSent >= 0) {
+    // the kernel keys tx timestamps with a count of the packets sent
+    const auto key = nextTxKey_++;
+    if (sentTs.count()) {
+      txKeyToSentTime_.set(key, sentTs);
+    }
+  }
+  return bytesSent;
+}
+
+void
+Spark::processHelloPacket(
+    const IoProvider::RecvResult& recvResult, const uint8_t* buf) {
+  // Step 1: parse pkt
+  InterfaceContext* ifContext{nullptr};
   std::chrono::microseconds myRecvTime;
 
-  if (!parsePacket(helloPacket, ifName, myRecvTime)) {
+  if (!checkPacket(recvResult, ifContext, myRecvTime)) {
+    return;
+  }
+  auto const& ifName = ifContext->ifName;
+
+  // compact heartbeats skip thrift altogether. Nodes without Spark2 on the
+  // same link get them too, they have no use for them
+  const folly::ByteRange packet(buf, std::get<0>(recvResult));
+  if (compact_heartbeat::isCompactHeartbeat(packet)) {
+    if (enableSpark2_) {
+      processCompactHeartbeat(packet, *ifContext);
+    }
+    return;
+  }
+
+  thrift::SparkHelloPacket helloPacket;
+  if (!parsePacket(packet, helloPacket)) {
     return;
   }
 
@@ -1776,7 +2256,7 @@ Spark::processHelloPacket() {
       processHelloMsg(helloPacket.helloMsg.value(), ifName, myRecvTime);
       return;
     } else if (helloPacket.heartbeatMsg.has_value()) {
-      processHeartbeatMsg(helloPacket.heartbeatMsg.value(), ifName);
+      processHeartbeatMsg(helloPacket.heartbeatMsg->nodeName, *ifContext);
       return;
     } else if (helloPacket.handshakeMsg.has_value()) {
       processHandshakeMsg(helloPacket.handshakeMsg.value(), ifName);
@@ -1829,7 +2309,7 @@ Spark::processHelloPacket() {
         neighbor.label,
         false /* supportDual: doesn't matter in DOWN event*/,
         neighbor.area);
-    neighborUpdatesQueue_.push(std::move(event));
+    queueNeighborEvent(std::move(event));
     return;
   }
 
@@ -1837,7 +2317,8 @@ Spark::processHelloPacket() {
   auto it = helloPacket.payload.neighborInfos.find(myNodeName_);
   if (it != helloPacket.payload.neighborInfos.end()) {
     auto& tstamps = it->second;
-    auto mySentTime = std::chrono::microseconds(tstamps.lastNbrMsgSentTsInUs);
+    auto mySentTime =
+        getMySentTime(std::chrono::microseconds(tstamps.lastNbrMsgSentTsInUs));
     auto nbrRecvTime = std::chrono::microseconds(tstamps.lastMyMsgRcvdTsInUs);
     updateNeighborRtt(
         // recvTime of neighbor helloPkt
@@ -1906,7 +2387,7 @@ Spark::processHelloPacket() {
         supportFloodOptimization,
         neighbor.area);
     neighbor.numRecvRestarting = 0; // reset counter when neighbor comes up
-    neighborUpdatesQueue_.push(std::move(event));
+    queueNeighborEvent(std::move(event));
     return;
   }
 
@@ -1948,7 +2429,7 @@ Spark::processHelloPacket() {
         neighbor.label,
         supportFloodOptimization,
         neighbor.area);
-    neighborUpdatesQueue_.push(std::move(event));
+    queueNeighborEvent(std::move(event));
     neighbor.numRecvRestarting = 0; // reset counter when neighbor comes up
     neighbor.isAdjacent = true;
 
@@ -1975,7 +2456,7 @@ Spark::processHelloPacket() {
         neighbor.label,
         false /* supportFloodOptimization: doesn't matter in DOWN event*/,
         neighbor.area);
-    neighborUpdatesQueue_.push(std::move(event));
+    queueNeighborEvent(std::move(event));
     neighbor.isAdjacent = false;
     neighbor.holdTimer->cancelTimeout(); // Stop hold-timer
     return;
@@ -2010,6 +2491,7 @@ Spark::sendHelloPacket(
   const auto v4Addr = interfaceEntry.v4Network.first;
   const auto v6Addr = interfaceEntry.v6LinkLocalNetwork.first;
   thrift::OpenrVersion openrVer(kVersion_.version);
+  const auto sentTs = getCurrentTimeInUs();
 
   // build the hello packet from payload and empty signature
   thrift::SparkHelloPacket helloPacket;
@@ -2025,7 +2507,7 @@ Spark::sendHelloPacket(
     helloMsg.version = openrVer;
     helloMsg.solicitResponse = inFastInitState;
     helloMsg.restarting = restarting;
-    helloMsg.sentTsInUs = getCurrentTimeInUs().count();
+    helloMsg.sentTsInUs = sentTs.count();
 
     // bake neighborInfo into helloMsg
     for (const auto& kv : spark2Neighbors_.at(ifName)) {
@@ -2059,7 +2541,7 @@ Spark::sendHelloPacket(
       myself,
       mySeqNum_,
       std::map<std::string, thrift::ReflectedNeighborInfo>{},
-      getCurrentTimeInUs().count(),
+      sentTs.count(),
       inFastInitState,
       enableFloodOptimization_,
       restarting,
@@ -2085,16 +2567,14 @@ Spark::sendHelloPacket(
   auto packet = util::writeThriftObjStr(helloPacket, serializer_);
 
   // send the payload
-  folly::SocketAddress dstAddr(
-      folly::IPAddress(Constants::kSparkMcastAddr.toString()), udpMcastPort_);
+  auto const& dstAddr = mcastDstAddr_;
 
   if (kMinIpv6Mtu < packet.size()) {
     LOG(ERROR) << "Hello packet is too big, cannot sent!";
     return;
   }
 
-  auto bytesSent = IoProvider::sendMessage(
-      mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
+  auto bytesSent = sendPacket(ifIndex, v6Addr.asV6(), packet, sentTs);
 
   if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
     VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
@@ -2130,6 +2610,10 @@ Spark::processInterfaceUpdates(thrift::InterfaceDatabase&& ifDb) {
     const auto& ifIndex = kv.second.ifIndex;
     const auto& networks = kv.second.networks;
 
+    if (!isUp) {
+      continue;
+    }
+
     // Sort networks and use the lowest one (other node will do similar)
     std::set<folly::CIDRNetwork> v4Networks;
     std::set<folly::CIDRNetwork> v6LinkLocalNetworks;
@@ -2142,7 +2626,8 @@ Spark::processInterfaceUpdates(thrift::InterfaceDatabase&& ifDb) {
       }
     }
 
-    if (!isUp) {
+    if (ifIndex % numWorkers_ != workerId_) {
+      VLOG(3) << "Skipping " << ifName << ", tracked by another Spark worker";
       continue;
     }
     if (v6LinkLocalNetworks.empty()) {
@@ -2167,36 +2652,35 @@ Spark::processInterfaceUpdates(thrift::InterfaceDatabase&& ifDb) {
         ifName, Interface(ifIndex, v4Network, v6LinkLocalNetwork));
   }
 
-  auto newIfaces = folly::gen::from(newInterfaceDb) | folly::gen::get<0>() |
-      folly::gen::as<std::set<std::string>>();
-
-  auto existingIfaces = folly::gen::from(interfaceDb_) | folly::gen::get<0>() |
-      folly::gen::as<std::set<std::string>>();
-
+  //
+  // Compute interfaces to add, delete and update. A delta only touches the
+  // interfaces it lists, all others stay as they are, so work is proportional
+  // to the size of the delta rather than of interfaceDb_.
+  //
   std::set<std::string> toAdd;
   std::set<std::string> toDel;
   std::set<std::string> toUpdate;
 
-  std::set_difference(
-      newIfaces.begin(),
-      newIfaces.end(),
-      existingIfaces.begin(),
-      existingIfaces.end(),
-      std::inserter(toAdd, toAdd.begin()));
-
-  std::set_difference(
-      existingIfaces.begin(),
-      existingIfaces.end(),
-      newIfaces.begin(),
-      newIfaces.end(),
-      std::inserter(toDel, toDel.begin()));
-
-  std::set_intersection(
-      newIfaces.begin(),
-      newIfaces.end(),
-      existingIfaces.begin(),
-      existingIfaces.end(),
-      std::inserter(toUpdate, toUpdate.begin()));
+  for (const auto& kv : newInterfaceDb) {
+    if (interfaceDb_.count(kv.first)) {
+      toUpdate.emplace(kv.first);
+    } else {
+      toAdd.emplace(kv.first);
+    }
+  }
+  if (ifDb.isDelta) {
+    for (const auto& kv : ifDb.interfaces) {
+      if (interfaceDb_.count(kv.first) and not newInterfaceDb.count(kv.first)) {
+        toDel.emplace(kv.first);
+      }
+    }
+  } else {
+    for (const auto& kv : interfaceDb_) {
+      if (not newInterfaceDb.count(kv.first)) {
+        toDel.emplace(kv.first);
+      }
+    }
+  }
 
   // remove the interfaces no longer in newdb
   deleteInterfaceFromDb(toDel);
@@ -2221,7 +2705,7 @@ Spark::deleteInterfaceFromDb(const std::set<std::string>& toDel) {
       for (const auto& kv : spark2Neighbors_.at(ifName)) {
         auto& neighborName = kv.first;
         auto& neighbor = kv.second;
-        allocatedLabels_.erase(neighbor.label);
+        allocatedLabels_->wlock()->erase(neighbor.label);
         LOG(INFO) << "Neighbor " << neighborName << " removed due to iface "
                   << ifName << " down";
 
@@ -2239,13 +2723,15 @@ Spark::deleteInterfaceFromDb(const std::set<std::string>& toDel) {
       }
       spark2Neighbors_.erase(ifName);
       ifNameToHeartbeatTimers_.erase(ifName);
+      ifNameToHeartbeatState_.erase(ifName);
+      resetHeartbeatNeighbor(ifName);
     }
 
     for (const auto& kv : neighbors_.at(ifName)) {
       auto& neighborName = kv.first;
       auto& neighbor = kv.second;
 
-      allocatedLabels_.erase(neighbor.label);
+      allocatedLabels_->wlock()->erase(neighbor.label);
       if (!neighbor.isAdjacent) {
         continue;
       }
@@ -2260,7 +2746,7 @@ Spark::deleteInterfaceFromDb(const std::set<std::string>& toDel) {
           neighbor.label,
           false /* supportFloodOptimization: doesn't matter in DOWN event*/,
           neighbor.area);
-      neighborUpdatesQueue_.push(std::move(event));
+      queueNeighborEvent(std::move(event));
     }
 
     // unsubscribe the socket from mcast group on this interface
@@ -2277,6 +2763,7 @@ Spark::deleteInterfaceFromDb(const std::set<std::string>& toDel) {
     // cleanup for this interface
     neighbors_.erase(ifName);
     ifNameToHelloTimers_.erase(ifName);
+    ifIndexToContext_.erase(interfaceDb_.at(ifName).ifIndex);
     interfaceDb_.erase(ifName);
   }
 }
@@ -2307,6 +2794,7 @@ Spark::addInterfaceToDb(
     {
       auto result = interfaceDb_.emplace(ifName, newInterface);
       CHECK(result.second);
+      ifIndexToContext_[ifIndex].ifName = ifName;
     }
 
     {
@@ -2323,10 +2811,21 @@ Spark::addInterfaceToDb(
       CHECK(result.second);
 
       // heartbeatTimers will start as soon as intf is in UP state
-      auto heartbeatTimer = fbzmq::ZmqTimeout::make(
-          getEvb(), [this, ifName]() noexcept { sendHeartbeatMsg(ifName); });
-
-      const bool isPeriodic = true; /* flag indicating periodic pkt sent-out*/
+      // adaptive ones get rescheduled after each heartbeat
+      auto heartbeatTimer =
+          fbzmq::ZmqTimeout::make(getEvb(), [this, ifName]() noexcept {
+            sendHeartbeatMsg(ifName);
+            if (adaptiveHeartbeatConfig_) {
+              ifNameToHeartbeatTimers_.at(ifName)->scheduleTimeout(
+                  updateHeartbeatInterval(ifName));
+            }
+          });
+
+      /* flag indicating periodic pkt sent-out*/
+      const bool isPeriodic = not adaptiveHeartbeatConfig_.has_value();
+      if (adaptiveHeartbeatConfig_) {
+        ifNameToHeartbeatState_[ifName].interval = myHeartbeatTime_;
+      }
       ifNameToHeartbeatTimers_.emplace(ifName, std::move(heartbeatTimer));
       ifNameToHeartbeatTimers_.at(ifName)->scheduleTimeout(
           myHeartbeatTime_, isPeriodic);
@@ -2430,6 +2929,8 @@ Spark::updateInterfaceInDb(
         throw std::runtime_error(folly::sformat(
             "Failed joining multicast group: {}", folly::errnoStr(errno)));
       }
+      ifIndexToContext_.erase(interface.ifIndex);
+      ifIndexToContext_[newInterface.ifIndex].ifName = ifName;
     }
     LOG(INFO) << "Updating iface " << ifName << " in spark tracking from "
               << "(ifindex " << interface.ifIndex << ", addrs "
@@ -2443,29 +2944,34 @@ Spark::updateInterfaceInDb(
   }
 }
 
-std::optional<std::string>
+Spark::InterfaceContext*
 Spark::findInterfaceFromIfindex(int ifIndex) {
-  for (const auto& kv : interfaceDb_) {
-    if (kv.second.ifIndex == ifIndex) {
-      return kv.first;
-    }
+  auto it = ifIndexToContext_.find(ifIndex);
+  return it == ifIndexToContext_.end() ? nullptr : &it->second;
+}
+
+void
+Spark::resetHeartbeatNeighbor(std::string const& ifName) {
+  auto it = ifIndexToContext_.find(interfaceDb_.at(ifName).ifIndex);
+  if (it != ifIndexToContext_.end()) {
+    it->second.heartbeatNeighbor = nullptr;
   }
-  return std::nullopt;
 }
 
 int32_t
 Spark::getNewLabelForIface(const std::string& ifName) {
   // interface must exists. We try to first assign label based on ifIndex if
   // not already taken.
+  auto allocatedLabels = allocatedLabels_->wlock();
   int32_t label =
       Constants::kSrLocalRange.first + interfaceDb_.at(ifName).ifIndex;
-  if (allocatedLabels_.insert(label).second) { // new value inserted
+  if (allocatedLabels->insert(label).second) { // new value inserted
     return label;
   }
 
   // Label already exists let's try to find out a new one from the back
   label = Constants::kSrLocalRange.second; // last possible one
-  while (!allocatedLabels_.insert(label).second) { // value already exists
+  while (!allocatedLabels->insert(label).second) { // value already exists
     label--;
   }
 
@@ -2510,15 +3016,22 @@ Spark::updateGlobalCounters() {
           "spark.seq_num." + neighbor.nodeName, neighbor.seqNum);
     }
   }
+
+  // each worker reports its own totals
+  const std::string prefix = numWorkers_ > 1
+      ? folly::sformat("spark.worker{}.", workerId_)
+      : std::string("spark.");
   fb303::fbData->setCounter(
-      "spark.num_tracked_interfaces",
+      prefix + "num_tracked_interfaces",
       neighbors_.size() ? neighbors_.size() : spark2Neighbors_.size());
   fb303::fbData->setCounter(
-      "spark.num_tracked_neighbors", trackedNeighborCount);
+      prefix + "num_tracked_neighbors", trackedNeighborCount);
+  fb303::fbData->setCounter(
+      prefix + "num_adjacent_neighbors", adjacentNeighborCount);
+  fb303::fbData->setCounter(prefix + "my_seq_num", mySeqNum_);
   fb303::fbData->setCounter(
-      "spark.num_adjacent_neighbors", adjacentNeighborCount);
-  fb303::fbData->setCounter("spark.my_seq_num", mySeqNum_);
-  fb303::fbData->setCounter("spark.pending_timers", getEvb()->timer().count());
+      prefix + "pending_timers",
+      getEvb()->timer().count() + neighborTimers_->count());
 }
 
 folly::Expected<std::string, folly::Unit>
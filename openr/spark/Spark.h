@@ -9,12 +9,17 @@
 
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <set>
+#include <thread>
 
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Range.h>
 #include <folly/SocketAddress.h>
+#include <folly/Synchronized.h>
 #include <folly/container/EvictingCacheMap.h>
 #include <folly/fibers/FiberManager.h>
 #include <folly/io/async/AsyncTimeout.h>
@@ -25,11 +30,13 @@
 #include <openr/common/StepDetector.h>
 #include <openr/common/Types.h>
 #include <openr/common/Util.h>
+#include <openr/common/WheelTimeout.h>
 #include <openr/if/gen-cpp2/KvStore_constants.h>
 #include <openr/if/gen-cpp2/LinkMonitor_types.h>
 #include <openr/if/gen-cpp2/Spark_types.h>
 #include <openr/messaging/ReplicateQueue.h>
 #include <openr/spark/IoProvider.h>
+#include <openr/spark/LivenessMonitor.h>
 
 namespace openr {
 
@@ -66,6 +73,47 @@ enum class SparkNeighEvent {
   UNEXPECTED_EVENT = 8,
 };
 
+//
+// Interfaces of a node can be spread over several Spark workers, each with an
+// event base and multicast socket of its own. A worker only tracks interfaces
+// with ifIndex % numWorkers == workerId, a socket filter steers their packets
+// to its socket. All workers feed the same neighbor updates queue, events of
+// an interface keep their order as a single worker owns it.
+//
+struct SparkWorkerInfo {
+  uint32_t workerId{0};
+  uint32_t numWorkers{1};
+
+  // adjacency labels are unique per node, so all workers must share them.
+  // created by Spark if not given.
+  std::shared_ptr<folly::Synchronized<std::set<int32_t>>> allocatedLabels{
+      nullptr};
+};
+
+//
+// Adaptive interval of Spark2 heartbeats. An interface heartbeats at the
+// configured heartbeat time while its adjacencies recently changed, and then
+// backs off, doubling the interval with each heartbeat up to a third of the
+// hold time negotiated with its neighbors. Intervals also get stretched,
+// within the same bound, to keep a worker within its heartbeat budget.
+//
+struct AdaptiveHeartbeatConfig {
+  // interfaces without adjacency changes for this long back off
+  std::chrono::milliseconds stableTime{0};
+
+  // heartbeats per second over all interfaces of a worker, 0 for no limit
+  uint32_t maxHeartbeatsPerSec{0};
+};
+
+// heartbeat times of a Spark2 adjacency
+struct SparkHeartbeatTimes {
+  // current interval of my heartbeats on the interface of the adjacency
+  std::chrono::milliseconds sendInterval{0};
+
+  // hold time negotiated with the neighbor
+  std::chrono::milliseconds holdTime{0};
+};
+
 //
 // Spark is responsible of telling our peer of our existence
 // and also tracking the neighbor liveness. It publishes the
@@ -94,7 +142,7 @@ class Spark final : public OpenrEventBase {
       std::optional<int> ipTos,
       bool enableV4,
       messaging::RQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue,
-      messaging::ReplicateQueue<thrift::SparkNeighborEvent>& nbrUpdatesQueue,
+      messaging::ReplicateQueue<thrift::SparkNeighborEvents>& nbrUpdatesQueue,
       KvStoreCmdPort kvStoreCmdPort,
       OpenrCtrlThriftPort openrCtrlThriftPort,
       std::pair<uint32_t, uint32_t> version,
@@ -103,14 +151,23 @@ class Spark final : public OpenrEventBase {
       bool enableFloodOptimization = false,
       bool enableSpark2 = false,
       bool increaseHelloInterval = false,
-      std::optional<std::unordered_set<std::string>> areas = std::nullopt);
+      std::optional<std::unordered_set<std::string>> areas = std::nullopt,
+      SparkWorkerInfo workerInfo = SparkWorkerInfo{},
+      std::optional<LivenessConfig> livenessConfig = std::nullopt,
+      std::optional<AdaptiveHeartbeatConfig> adaptiveHeartbeatConfig =
+          std::nullopt);
 
-  ~Spark() override = default;
+  ~Spark() override;
 
   // get the current state of neighborNode, used for unit-testing
   std::optional<SparkNeighState> getSparkNeighState(
       std::string const& ifName, std::string const& neighborName);
 
+  // get the heartbeat times of adjacency with neighborNode, std::nullopt if
+  // it isn't established
+  std::optional<SparkHeartbeatTimes> getSparkNeighHeartbeatTimes(
+      std::string const& ifName, std::string const& neighborName);
+
   // override eventloop stop()
   void stop() override;
 
@@ -175,13 +232,33 @@ class Spark final : public OpenrEventBase {
   void processNeighborHoldTimeout(
       std::string const& ifName, std::string const& neighborName);
 
-  // Determine if we should process the next packte from this ifName, addr pair
-  bool shouldProcessHelloPacket(
-      std::string const& ifName, folly::IPAddress const& addr);
+  // Determine if we should process the next packte from this ifIndex, addr
+  // pair
+  bool shouldProcessHelloPacket(int ifIndex, folly::IPAddress const& addr);
+
+  // receive pending hello packets, a batch per wakeup, and process them
+  void processHelloPackets();
+
+  // match kernel tx timestamps, queued on the error queue of mcastFd_, with
+  // the hello packets they were taken for
+  void processTxTimestamps();
+
+  // kernel tx timestamp of my hello packet stamped with sentTs in user space
+  // if known, sentTs otherwise
+  std::chrono::microseconds getMySentTime(std::chrono::microseconds sentTs);
 
-  // process hello packet from a neighbor. we want to see if
-  // the neighbor could be added as adjacent peer.
-  void processHelloPacket();
+  // send packet out of ifIndex to the multicast group. sentTs is the user
+  // space timestamp of a hello packet, to match its tx timestamp with.
+  ssize_t sendPacket(
+      int ifIndex,
+      folly::IPAddressV6 const& srcAddr,
+      std::string const& packet,
+      std::chrono::microseconds sentTs = std::chrono::microseconds(0));
+
+  // process hello packet from a neighbor, received into buf. we want to see
+  // if the neighbor could be added as adjacent peer.
+  void processHelloPacket(
+      const IoProvider::RecvResult& recvResult, const uint8_t* buf);
 
   // originate my hello packet on given interface
   void sendHelloPacket(
@@ -206,8 +283,15 @@ class Spark final : public OpenrEventBase {
       const std::set<std::string>& toUpdate,
       const std::unordered_map<std::string, Interface>& newInterfaceDb);
 
-  // find an interface name in the interfaceDb given an ifIndex
-  std::optional<std::string> findInterfaceFromIfindex(int ifIndex);
+  // tracked interface of an ifIndex, see ifIndexToContext_
+  struct InterfaceContext;
+
+  // find an interface in the interfaceDb given an ifIndex, nullptr if none
+  InterfaceContext* findInterfaceFromIfindex(int ifIndex);
+
+  // forget the Spark2 neighbor cached for heartbeats on ifName, called when
+  // a Spark2 neighbor of the interface goes away
+  void resetHeartbeatNeighbor(std::string const& ifName);
 
   // Utility function to generate a new label for neighbor on given interface.
   // If there is only one neighbor per interface then labels are expected to be
@@ -222,12 +306,17 @@ class Spark final : public OpenrEventBase {
       std::optional<std::unordered_set<std::string>> areas,
       const std::string& nodeName);
 
-  // function to receive and parse received pkt
-  bool parsePacket(
-      thrift::SparkHelloPacket& pkt /* packet( type will be renamed later) */,
-      std::string& ifName /* interface */,
+  // function to check pkt received, before parsing it
+  bool checkPacket(
+      const IoProvider::RecvResult& recvResult,
+      InterfaceContext*& ifContext /* interface */,
       std::chrono::microseconds& recvTime /* kernel timestamp when recved */);
 
+  // function to parse pkt received
+  bool parsePacket(
+      folly::ByteRange packet,
+      thrift::SparkHelloPacket& pkt /* packet( type will be renamed later) */);
+
   // function to validate v4Address with its subnet
   PacketValidationResult validateV4AddressSubnet(
       std::string const& ifName, thrift::BinaryAddress neighV4Addr);
@@ -290,16 +379,16 @@ class Spark final : public OpenrEventBase {
     SparkNeighState state;
 
     // timer to periodically send out handshake pkt
-    std::unique_ptr<fbzmq::ZmqTimeout> negotiateTimer{nullptr};
+    std::unique_ptr<WheelTimeout> negotiateTimer{nullptr};
 
     // negotiate stage hold-timer
-    std::unique_ptr<fbzmq::ZmqTimeout> negotiateHoldTimer{nullptr};
+    std::unique_ptr<WheelTimeout> negotiateHoldTimer{nullptr};
 
     // heartbeat hold-timer
-    std::unique_ptr<fbzmq::ZmqTimeout> heartbeatHoldTimer{nullptr};
+    std::unique_ptr<WheelTimeout> heartbeatHoldTimer{nullptr};
 
     // graceful restart hold-timer
-    std::unique_ptr<fbzmq::ZmqTimeout> gracefulRestartHoldTimer{nullptr};
+    std::unique_ptr<WheelTimeout> gracefulRestartHoldTimer{nullptr};
 
     // KvStore related port. Info passed to LinkMonitor for neighborEvent
     int32_t kvStoreCmdPort{0};
@@ -329,13 +418,37 @@ class Spark final : public OpenrEventBase {
 
     // area on which adjacency is formed
     std::string area{};
+
+    // version of the compact heartbeat format read by neighbor, 0 if none
+    int32_t compactHeartbeatVersion{0};
+
+    // liveness monitor of neighbor, port 0 if it has none
+    int32_t livenessPort{0};
+    std::chrono::milliseconds livenessHoldTime{0};
+
+    // session of my liveness monitor, 0 if none
+    uint64_t livenessSessionId{0};
   };
 
+  // wheel of the per-neighbor timers, must outlive the neighbors below
+  folly::HHWheelTimer::UniquePtr neighborTimers_;
+
   std::unordered_map<
       std::string /* ifName */,
       std::unordered_map<std::string /* neighborName */, Spark2Neighbor>>
       spark2Neighbors_{};
 
+  // tracked interface as looked up by the ifIndex of received packets, so
+  // that steady state heartbeats get processed without lookups by name
+  struct InterfaceContext {
+    std::string ifName;
+    // Spark2 neighbor of the last heartbeat on the interface, if any. Reset
+    // whenever a Spark2 neighbor of the interface goes away
+    std::string heartbeatNeighborName;
+    Spark2Neighbor* heartbeatNeighbor{nullptr};
+  };
+  std::unordered_map<int /* ifIndex */, InterfaceContext> ifIndexToContext_;
+
   // util function to log Spark neighbor state transition
   void logStateTransition(
       std::string const& neighborName,
@@ -370,6 +483,11 @@ class Spark final : public OpenrEventBase {
       const std::string& area =
           openr::thrift::KvStore_constants::kDefaultArea());
 
+  // Neighbor events are published in batches, one per event loop iteration.
+  // E.g. all neighbors of an interface going down make a single batch.
+  void queueNeighborEvent(thrift::SparkNeighborEvent&& event);
+  void flushNeighborEvents();
+
   // callback function for rtt change
   void processRttChange(
       std::string const& ifName,
@@ -379,9 +497,20 @@ class Spark final : public OpenrEventBase {
   // utility call to send handshake msg
   void sendHandshakeMsg(std::string const& ifName, bool isAdjEstablished);
 
+  // pre-serialize the heartbeat msg, the same on all interfaces but for the
+  // seqNum patched in by sendHeartbeatMsg
+  void buildHeartbeatTemplate();
+
   // utility call to send heartbeat msg
   void sendHeartbeatMsg(std::string const& ifName);
 
+  // interval until the next heartbeat on ifName, see AdaptiveHeartbeatConfig
+  std::chrono::milliseconds updateHeartbeatInterval(std::string const& ifName);
+
+  // heartbeat at the configured heartbeat time again after an adjacency on
+  // ifName changed
+  void resetHeartbeatInterval(std::string const& ifName);
+
   // wrapper function to process GR msg
   void processGRMsg(
       std::string const& neighborName,
@@ -396,7 +525,28 @@ class Spark final : public OpenrEventBase {
 
   // process heartbeatMsg in Spark2 context
   void processHeartbeatMsg(
-      thrift::SparkHeartbeatMsg const& heartbeatMsg, std::string const& ifName);
+      std::string const& neighborName, InterfaceContext& ifContext);
+
+  // process heartbeat in compact format, see CompactHeartbeat.h
+  void processCompactHeartbeat(
+      folly::ByteRange packet, InterfaceContext& ifContext);
+
+  // if all active neighbors on ifName read compact heartbeats
+  bool canSendCompactHeartbeat(std::string const& ifName) const;
+
+  // hand liveness of an established neighbor to my liveness monitor, if both
+  // of us have one
+  void startLivenessSession(
+      Spark2Neighbor& neighbor,
+      std::string const& ifName,
+      std::string const& neighborName);
+
+  void stopLivenessSession(uint64_t sessionId);
+
+  // liveness monitor lost the neighbor of sessionId
+  void processLivenessTimeout(uint64_t sessionId);
+
+  void stopLivenessMonitor();
 
   // process handshakeMsg to update spark2Neighbors_ db
   void processHandshakeMsg(
@@ -475,12 +625,47 @@ class Spark final : public OpenrEventBase {
   // the multicast socket we use
   int mcastFd_{-1};
 
+  // tx timestamps of mcastFd_ are on, see processTxTimestamps
+  bool txTimestampsEnabled_{false};
+
+  // key of the tx timestamp of the next packet sent
+  uint32_t nextTxKey_{0};
+
+  // user space timestamps of hello packets by key, until the kernel tx
+  // timestamp for the key is in
+  folly::EvictingCacheMap<uint32_t, std::chrono::microseconds>
+      txKeyToSentTime_;
+
+  // kernel tx timestamps of hello packets by their user space timestamp
+  folly::EvictingCacheMap<int64_t, std::chrono::microseconds> kernelSentTimes_;
+
+  // buffers of the hello packets received in one batch
+  IoProvider::RecvBuffers recvBufs_;
+
   // state transition matrix for Finite-State-Machine
   static const std::vector<std::vector<std::optional<SparkNeighState>>>
       stateMap_;
 
   // Queue to publish neighbor events
-  messaging::ReplicateQueue<thrift::SparkNeighborEvent>& neighborUpdatesQueue_;
+  messaging::ReplicateQueue<thrift::SparkNeighborEvents>& neighborUpdatesQueue_;
+
+  // events of the current event loop iteration, not published yet
+  thrift::SparkNeighborEvents pendingNeighborEvents_;
+
+  // publishes pendingNeighborEvents_ at the end of the loop iteration
+  class NeighborEventsFlush : public folly::EventBase::LoopCallback {
+   public:
+    explicit NeighborEventsFlush(Spark& spark) : spark_(spark) {}
+
+    void
+    runLoopCallback() noexcept override {
+      spark_.flushNeighborEvents();
+    }
+
+   private:
+    Spark& spark_;
+  };
+  NeighborEventsFlush neighborEventsFlush_{*this};
 
   // this is used to inform peers about my kvstore tcp ports
   const uint16_t kKvStoreCmdPort_{0};
@@ -513,14 +698,42 @@ class Spark final : public OpenrEventBase {
       std::unique_ptr<fbzmq::ZmqTimeout>>
       ifNameToHeartbeatTimers_;
 
+  // adaptive heartbeat state of each interface
+  struct HeartbeatState {
+    // current interval between heartbeats
+    std::chrono::milliseconds interval{0};
+
+    // last time an adjacency on the interface went up or down
+    std::chrono::steady_clock::time_point lastAdjChange;
+  };
+  std::unordered_map<std::string /* ifName */, HeartbeatState>
+      ifNameToHeartbeatState_;
+
   // number of active neighbors for each interface
   std::unordered_map<
       std::string /* ifName */,
       std::unordered_set<std::string> /* neighbors */>
       ifNameToActiveNeighbors_;
 
-  // Ordered set to keep track of allocated labels
-  std::set<int32_t> allocatedLabels_;
+  // Ordered set to keep track of allocated labels, shared by all workers
+  std::shared_ptr<folly::Synchronized<std::set<int32_t>>> allocatedLabels_;
+
+  // interfaces of this worker, see SparkWorkerInfo
+  const uint32_t workerId_{0};
+  const uint32_t numWorkers_{1};
+
+  // optional liveness monitor of established neighbors, in a thread of its
+  // own. runs as long as Spark does
+  const std::optional<LivenessConfig> livenessConfig_;
+
+  // adaptive heartbeat interval, heartbeats are periodic if not set
+  const std::optional<AdaptiveHeartbeatConfig> adaptiveHeartbeatConfig_;
+  std::unique_ptr<LivenessMonitor> liveness_;
+  std::thread livenessThread_;
+
+  // (ifName, neighborName) of each liveness session
+  std::unordered_map<uint64_t, std::pair<std::string, std::string>>
+      livenessSessions_;
 
   //
   // Neighbor state tracking
@@ -532,7 +745,7 @@ class Spark final : public OpenrEventBase {
         thrift::SparkNeighbor const& info,
         uint32_t label,
         uint64_t seqNum,
-        std::unique_ptr<fbzmq::ZmqTimeout> holdTimer,
+        std::unique_ptr<WheelTimeout> holdTimer,
         const std::chrono::milliseconds& samplingPeriod,
         std::function<void(const int64_t&)> rttChangeCb,
         std::string area = openr::thrift::KvStore_constants::kDefaultArea());
@@ -541,7 +754,7 @@ class Spark final : public OpenrEventBase {
     thrift::SparkNeighbor info;
 
     // Hold timer. If expired will declare the neighbor as stopped.
-    const std::unique_ptr<fbzmq::ZmqTimeout> holdTimer{nullptr};
+    const std::unique_ptr<WheelTimeout> holdTimer{nullptr};
 
     // SR Label to reach Neighbor over this specific adjacency. Generated
     // using ifIndex to this neighbor. Only local within the node.
@@ -583,6 +796,19 @@ class Spark final : public OpenrEventBase {
   // to serdeser messages over ZMQ sockets
   apache::thrift::CompactSerializer serializer_;
 
+  // multicast destination of all packets sent
+  folly::SocketAddress mcastDstAddr_;
+
+  // serialized heartbeat msg before and after its seqNum
+  std::string heartbeatPrefix_;
+  std::string heartbeatSuffix_;
+
+  // heartbeat msg being sent, reused across sends
+  std::string heartbeatPacket_;
+
+  // node name of compact heartbeat being processed, reused across packets
+  std::string compactHeartbeatNodeName_;
+
   // The IO primitives provider; this is used for mocking
   // the IO during unit-tests. This could be shared with other
   // instances, hence the shared_ptr
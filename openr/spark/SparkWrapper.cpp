@@ -7,6 +7,11 @@
 
 #include "SparkWrapper.h"
 
+#include <pthread.h>
+#include <time.h>
+
+#include <iterator>
+
 using namespace fbzmq;
 
 namespace openr {
@@ -24,7 +29,9 @@ SparkWrapper::SparkWrapper(
     std::optional<std::unordered_set<std::string>> areas,
     bool enableSpark2,
     bool increaseHelloInterval,
-    SparkTimeConfig timeConfig)
+    SparkTimeConfig timeConfig,
+    std::optional<AdaptiveHeartbeatConfig> adaptiveHeartbeatConfig,
+    SparkWorkerInfo workerInfo)
     : myNodeName_(myNodeName) {
   spark_ = std::make_shared<Spark>(
       myDomainName,
@@ -51,7 +58,10 @@ SparkWrapper::SparkWrapper(
       true,
       enableSpark2,
       increaseHelloInterval,
-      areas);
+      areas,
+      std::move(workerInfo),
+      std::nullopt /* livenessConfig */,
+      std::move(adaptiveHeartbeatConfig));
 
   // start spark
   run();
@@ -104,11 +114,51 @@ SparkWrapper::updateInterfaceDb(
   return true;
 }
 
+bool
+SparkWrapper::updateInterfaceDelta(
+    const std::vector<SparkInterfaceEntry>& upInterfaces,
+    const std::vector<std::string>& downInterfaces) {
+  thrift::InterfaceDatabase ifDb(
+      apache::thrift::FRAGILE, myNodeName_, {}, thrift::PerfEvents());
+  ifDb.perfEvents.reset();
+  ifDb.isDelta = true;
+
+  for (const auto& interface : upInterfaces) {
+    ifDb.interfaces.emplace(
+        interface.ifName,
+        thrift::InterfaceInfo(
+            apache::thrift::FRAGILE,
+            true,
+            interface.ifIndex,
+            // TO BE DEPRECATED SOON
+            {toBinaryAddress(interface.v4Network.first)},
+            {toBinaryAddress(interface.v4Network.first)},
+            {toIpPrefix(interface.v4Network),
+             toIpPrefix(interface.v6LinkLocalNetwork)}));
+  }
+  for (const auto& ifName : downInterfaces) {
+    thrift::InterfaceInfo info;
+    info.isUp = false;
+    ifDb.interfaces.emplace(ifName, std::move(info));
+  }
+
+  interfaceUpdatesQueue_.push(std::move(ifDb));
+  return true;
+}
+
 folly::Expected<thrift::SparkNeighborEvent, Error>
 SparkWrapper::recvNeighborEvent(
     std::optional<std::chrono::milliseconds> timeout) {
   auto startTime = std::chrono::steady_clock::now();
-  while (not neighborUpdatesReader_.size()) {
+  while (pendingNeighborEvents_.empty()) {
+    if (neighborUpdatesReader_.size()) {
+      auto events = neighborUpdatesReader_.get().value();
+      std::move(
+          events.begin(),
+          events.end(),
+          std::back_inserter(pendingNeighborEvents_));
+      continue;
+    }
     // Break if timeout occurs
     auto now = std::chrono::steady_clock::now();
     if (timeout.has_value() && now - startTime > timeout.value()) {
@@ -118,7 +168,9 @@ SparkWrapper::recvNeighborEvent(
     std::this_thread::yield();
   }
 
-  return neighborUpdatesReader_.get().value();
+  auto event = std::move(pendingNeighborEvents_.front());
+  pendingNeighborEvents_.pop_front();
+  return event;
 }
 
 std::optional<thrift::SparkNeighborEvent>
@@ -155,10 +207,25 @@ SparkWrapper::getTransportAddrs(const thrift::SparkNeighborEvent& event) {
           toIPAddress(event.neighbor.transportAddressV6)};
 }
 
+std::chrono::nanoseconds
+SparkWrapper::getCpuTime() const {
+  clockid_t clockId;
+  CHECK_EQ(0, pthread_getcpuclockid(thread_->native_handle(), &clockId));
+  struct timespec ts;
+  CHECK_EQ(0, clock_gettime(clockId, &ts));
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
 std::optional<SparkNeighState>
 SparkWrapper::getSparkNeighState(
     std::string const& ifName, std::string const& neighborName) {
   return spark_->getSparkNeighState(ifName, neighborName);
 }
 
+std::optional<SparkHeartbeatTimes>
+SparkWrapper::getSparkNeighHeartbeatTimes(
+    std::string const& ifName, std::string const& neighborName) {
+  return spark_->getSparkNeighHeartbeatTimes(ifName, neighborName);
+}
+
 } // namespace openr
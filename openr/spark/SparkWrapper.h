@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <deque>
+
 #include <openr/common/Constants.h>
 #include <openr/messaging/ReplicateQueue.h>
 #include <openr/spark/Spark.h>
@@ -69,7 +71,10 @@ class SparkWrapper {
       std::optional<std::unordered_set<std::string>> areas,
       bool enableSpark2,
       bool increaseHelloInterval,
-      SparkTimeConfig timeConfig);
+      SparkTimeConfig timeConfig,
+      std::optional<AdaptiveHeartbeatConfig> adaptiveHeartbeatConfig =
+          std::nullopt,
+      SparkWorkerInfo workerInfo = SparkWorkerInfo{});
 
   ~SparkWrapper();
 
@@ -84,6 +89,12 @@ class SparkWrapper {
   bool updateInterfaceDb(
       const std::vector<SparkInterfaceEntry>& interfaceEntries);
 
+  // update tracking of listed interfaces only, others stay as they are
+  // return true upon success and false otherwise
+  bool updateInterfaceDelta(
+      const std::vector<SparkInterfaceEntry>& upInterfaces,
+      const std::vector<std::string>& downInterfaces);
+
   // receive spark neighbor event
   folly::Expected<thrift::SparkNeighborEvent, fbzmq::Error> recvNeighborEvent(
       std::optional<std::chrono::milliseconds> timeout = std::nullopt);
@@ -98,9 +109,16 @@ class SparkWrapper {
   std::optional<SparkNeighState> getSparkNeighState(
       std::string const& ifName, std::string const& neighborName);
 
+  // utility call to check heartbeat times of neighbor
+  std::optional<SparkHeartbeatTimes> getSparkNeighHeartbeatTimes(
+      std::string const& ifName, std::string const& neighborName);
+
   static std::pair<folly::IPAddress, folly::IPAddress> getTransportAddrs(
       const thrift::SparkNeighborEvent& event);
 
+  // cpu time consumed so far by the thread running Spark
+  std::chrono::nanoseconds getCpuTime() const;
+
   //
   // Private statex
   //
@@ -108,10 +126,13 @@ class SparkWrapper {
  private:
   std::string myNodeName_{""};
 
-  messaging::ReplicateQueue<thrift::SparkNeighborEvent> neighborUpdatesQueue_;
-  messaging::RQueue<thrift::SparkNeighborEvent> neighborUpdatesReader_{
+  messaging::ReplicateQueue<thrift::SparkNeighborEvents> neighborUpdatesQueue_;
+  messaging::RQueue<thrift::SparkNeighborEvents> neighborUpdatesReader_{
       neighborUpdatesQueue_.getReader()};
 
+  // rest of the last batch read by recvNeighborEvent()
+  std::deque<thrift::SparkNeighborEvent> pendingNeighborEvents_;
+
   // Queue to send interface updates to spark
   messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue_;
 
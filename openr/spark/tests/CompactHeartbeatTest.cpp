@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Util.h>
+#include <openr/if/gen-cpp2/Spark_types.h>
+#include <openr/spark/CompactHeartbeat.h>
+
+using namespace openr;
+
+namespace {
+
+folly::ByteRange
+toRange(const std::string& packet) {
+  return folly::ByteRange(folly::StringPiece(packet));
+}
+
+} // namespace
+
+TEST(CompactHeartbeatTest, WriteAndParse) {
+  std::string packet;
+  compact_heartbeat::write("node-1", 0x0102030405060708, packet);
+  EXPECT_EQ(compact_heartbeat::kHeaderLen + 6, packet.size());
+  EXPECT_TRUE(compact_heartbeat::isCompactHeartbeat(toRange(packet)));
+
+  auto heartbeat = compact_heartbeat::parse(toRange(packet));
+  ASSERT_TRUE(heartbeat.has_value());
+  EXPECT_EQ("node-1", heartbeat->nodeName);
+  EXPECT_EQ(0x0102030405060708, heartbeat->seqNum);
+
+  // rewrite in place, shorter name
+  const auto* data = packet.data();
+  compact_heartbeat::write("n", 2, packet);
+  EXPECT_EQ(data, packet.data());
+  heartbeat = compact_heartbeat::parse(toRange(packet));
+  ASSERT_TRUE(heartbeat.has_value());
+  EXPECT_EQ("n", heartbeat->nodeName);
+  EXPECT_EQ(2, heartbeat->seqNum);
+}
+
+TEST(CompactHeartbeatTest, Malformed) {
+  std::string packet;
+  compact_heartbeat::write("node-1", 1, packet);
+
+  // truncated
+  EXPECT_FALSE(compact_heartbeat::parse(
+                   toRange(packet.substr(0, compact_heartbeat::kHeaderLen)))
+                   .has_value());
+  EXPECT_FALSE(
+      compact_heartbeat::parse(toRange(packet.substr(0, 3))).has_value());
+
+  // trailing bytes
+  EXPECT_FALSE(compact_heartbeat::parse(toRange(packet + "x")).has_value());
+
+  // unknown version, still told apart from thrift
+  auto otherVersion = packet;
+  otherVersion[1] = compact_heartbeat::kVersion + 1;
+  EXPECT_TRUE(compact_heartbeat::isCompactHeartbeat(toRange(otherVersion)));
+  EXPECT_FALSE(compact_heartbeat::parse(toRange(otherVersion)).has_value());
+
+  EXPECT_FALSE(compact_heartbeat::isCompactHeartbeat(toRange("")));
+}
+
+TEST(CompactHeartbeatTest, NotThrift) {
+  apache::thrift::CompactSerializer serializer;
+  thrift::SparkHeartbeatMsg heartbeatMsg;
+  heartbeatMsg.nodeName = "node-1";
+  heartbeatMsg.seqNum = 1;
+
+  thrift::SparkHelloPacket heartbeatPkt;
+  heartbeatPkt.heartbeatMsg = heartbeatMsg;
+  EXPECT_FALSE(compact_heartbeat::isCompactHeartbeat(
+      toRange(util::writeThriftObjStr(heartbeatPkt, serializer))));
+  const auto emptyPkt =
+      util::writeThriftObjStr(thrift::SparkHelloPacket(), serializer);
+  EXPECT_FALSE(compact_heartbeat::isCompactHeartbeat(toRange(emptyPkt)));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <net/if.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <folly/synchronization/Baton.h>
+#include <folly/SocketAddress.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/spark/IoProvider.h>
+#include <openr/spark/LivenessMonitor.h>
+
+using namespace openr;
+
+namespace {
+
+const std::chrono::milliseconds kTxInterval{20};
+const std::chrono::milliseconds kHoldTime{100};
+const folly::IPAddressV6 kLocalAddr("::1");
+
+// LivenessMonitor on real sockets over loopback, running in its own thread
+class TestMonitor {
+ public:
+  TestMonitor(std::string const& nodeName, uint16_t port)
+      : monitor_(
+            nodeName,
+            LivenessConfig{port, kTxInterval, kHoldTime, 0},
+            std::nullopt,
+            std::make_shared<IoProvider>(),
+            [this](uint64_t sessionId) {
+              downSessionId_ = sessionId;
+              downTime_ = std::chrono::steady_clock::now();
+              down_.post();
+            }),
+        thread_([this]() { monitor_.run(); }) {
+    monitor_.waitUntilRunning();
+  }
+
+  ~TestMonitor() {
+    monitor_.stop();
+    monitor_.waitUntilStopped();
+    thread_.join();
+  }
+
+  LivenessMonitor monitor_;
+  folly::Baton<> down_;
+  uint64_t downSessionId_{0};
+  std::chrono::steady_clock::time_point downTime_;
+
+ private:
+  std::thread thread_;
+};
+
+} // namespace
+
+TEST(LivenessMonitorTest, SessionUpAndDown) {
+  const int ifIndex = if_nametoindex("lo");
+  ASSERT_NE(0, ifIndex);
+
+  TestMonitor monitor1("node-1", 46661);
+  TestMonitor monitor2("node-2", 46662);
+
+  const auto session1 = monitor1.monitor_.addSession(
+      ifIndex,
+      kLocalAddr,
+      "node-2",
+      folly::SocketAddress("::1", 46662),
+      kHoldTime);
+  const auto session2 = monitor2.monitor_.addSession(
+      ifIndex,
+      kLocalAddr,
+      "node-1",
+      folly::SocketAddress("::1", 46661),
+      kHoldTime);
+  EXPECT_EQ(1, monitor1.monitor_.getNumSessions());
+  EXPECT_EQ(1, monitor2.monitor_.getNumSessions());
+
+  // heartbeats keep both sessions up past several hold times
+  EXPECT_FALSE(monitor1.down_.try_wait_for(kHoldTime * 5));
+  EXPECT_FALSE(monitor2.down_.try_wait_for(kHoldTime));
+
+  // node-2 stops sending, node-1 reports session1 down after its hold time
+  const auto removeTime = std::chrono::steady_clock::now();
+  monitor2.monitor_.removeSession(session2);
+  ASSERT_TRUE(monitor1.down_.try_wait_for(kHoldTime * 5));
+  EXPECT_EQ(session1, monitor1.downSessionId_);
+  EXPECT_GE(monitor1.downTime_ - removeTime, kHoldTime - kTxInterval);
+  EXPECT_EQ(0, monitor1.monitor_.getNumSessions());
+  EXPECT_EQ(0, monitor2.monitor_.getNumSessions());
+  EXPECT_FALSE(monitor2.down_.ready());
+}
+
+TEST(LivenessMonitorTest, ReplaceSession) {
+  const int ifIndex = if_nametoindex("lo");
+  ASSERT_NE(0, ifIndex);
+
+  TestMonitor monitor("node-1", 46663);
+  const folly::SocketAddress neighborAddr("::1", 46664);
+  const auto session1 = monitor.monitor_.addSession(
+      ifIndex, kLocalAddr, "node-2", neighborAddr, kHoldTime);
+  const auto session2 = monitor.monitor_.addSession(
+      ifIndex, kLocalAddr, "node-2", neighborAddr, kHoldTime);
+  EXPECT_NE(session1, session2);
+  EXPECT_EQ(1, monitor.monitor_.getNumSessions());
+
+  // no heartbeats from node-2, only the new session goes down
+  ASSERT_TRUE(monitor.down_.try_wait_for(kHoldTime * 5));
+  EXPECT_EQ(session2, monitor.downSessionId_);
+  EXPECT_EQ(0, monitor.monitor_.getNumSessions());
+
+  // unknown ids are ignored
+  monitor.monitor_.removeSession(session1);
+  EXPECT_EQ(0, monitor.monitor_.getNumSessions());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
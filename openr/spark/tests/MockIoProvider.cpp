@@ -7,6 +7,8 @@
 
 #include "MockIoProvider.h"
 
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <unistd.h>
 #include <cerrno>
 #include <chrono>
@@ -14,6 +16,7 @@
 #include <glog/logging.h>
 
 #include <folly/Exception.h>
+#include <folly/MapUtil.h>
 #include <folly/ScopeGuard.h>
 #include <folly/SocketAddress.h>
 
@@ -70,10 +73,60 @@ MockIoProvider::bind(
   return 0;
 }
 
+void
+MockIoProvider::setTxDelay(
+    std::string const& ifName,
+    std::chrono::milliseconds txDelay,
+    bool reportTxTimestamps) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  txDelays_[ifName] = TxDelay{txDelay, reportTxTimestamps};
+}
+
 ssize_t
-MockIoProvider::recvmsg(int sockFd, struct msghdr* msg, int /* flags */) {
+MockIoProvider::recvmsg(int sockFd, struct msghdr* msg, int flags) {
   std::lock_guard<std::mutex> lock(mutex_);
 
+  // the error queue only holds tx timestamps, looped back without data as
+  // with SOF_TIMESTAMPING_OPT_TSONLY
+  if (flags & MSG_ERRQUEUE) {
+    auto it = txTimestamps_.find(sockFd);
+    if (it == txTimestamps_.end() or it->second.empty()) {
+      errno = EAGAIN;
+      return -1;
+    }
+    const auto txTimestamp = it->second.front();
+    it->second.pop_front();
+
+    const size_t controlLen = CMSG_SPACE(sizeof(struct scm_timestamping)) +
+        CMSG_SPACE(sizeof(struct sock_extended_err));
+    CHECK(msg->msg_controllen >= controlLen);
+    msg->msg_controllen = controlLen;
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg);
+    CHECK(cmsg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_TIMESTAMPING;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct scm_timestamping));
+    struct scm_timestamping tss;
+    ::memset(&tss, 0, sizeof(tss));
+    tss.ts[0].tv_sec = txTimestamp.second.count() / 1000000;
+    tss.ts[0].tv_nsec = txTimestamp.second.count() % 1000000 * 1000;
+    memcpy(CMSG_DATA(cmsg), reinterpret_cast<const void*>(&tss), sizeof(tss));
+
+    cmsg = CMSG_NXTHDR(msg, cmsg);
+    CHECK(cmsg);
+    cmsg->cmsg_level = SOL_IPV6;
+    cmsg->cmsg_type = IPV6_RECVERR;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct sock_extended_err));
+    struct sock_extended_err err;
+    ::memset(&err, 0, sizeof(err));
+    err.ee_errno = ENOMSG;
+    err.ee_origin = SO_EE_ORIGIN_TIMESTAMPING;
+    err.ee_data = txTimestamp.first;
+    memcpy(CMSG_DATA(cmsg), reinterpret_cast<const void*>(&err), sizeof(err));
+    return 0;
+  }
+
   SCOPE_FAIL {
     LOG(ERROR) << "MockIoProvider::recvmsg failed";
   };
@@ -199,6 +252,7 @@ MockIoProvider::sendmsg(int sockFd, const struct msghdr* msg, int /* flags */) {
   CHECK(srcIfIndex != -1);
 
   auto srcIfName = ifIndexToIfName_.at(srcIfIndex);
+  const auto txDelay = folly::get_default(txDelays_, srcIfName, TxDelay{});
 
   VLOG(4) << "MockIoProvider::sendmsg sending message from iface " << srcIfName;
 
@@ -242,25 +296,91 @@ MockIoProvider::sendmsg(int sockFd, const struct msghdr* msg, int /* flags */) {
         dstIfIndex,
         srcAddr,
         std::move(packet),
-        std::chrono::milliseconds(latency));
+        std::chrono::milliseconds(latency) + txDelay.delay);
 
     sent = true;
   }
 
+  if (not sent) {
+    return -1;
+  }
+
+  // a sent packet takes the next key of the socket, reported or not
+  auto keyIt = nextTxKeys_.find(sockFd);
+  if (keyIt != nextTxKeys_.end()) {
+    const auto key = keyIt->second++;
+    if (txDelay.reportTxTimestamps) {
+      txTimestamps_[sockFd].emplace_back(
+          key,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::system_clock::now().time_since_epoch() +
+              txDelay.delay));
+    }
+  }
+
   // return the length of single vector sent
-  if (sent) {
-    return msg->msg_iov->iov_len;
+  return msg->msg_iov->iov_len;
+}
+
+int
+MockIoProvider::recvmmsg(
+    int sockFd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    struct timespec* /* timeout */) {
+  VLOG(4) << "MockIoProvider::recvmmsg called";
+
+  // the first message goes as with recvmsg, the rest only once due so that
+  // latencies still hold
+  unsigned int numMsgs = 0;
+  while (numMsgs < vlen and (numMsgs == 0 or hasActiveMessage(sockFd))) {
+    const auto bytesRead = recvmsg(sockFd, &msgvec[numMsgs].msg_hdr, flags);
+    if (bytesRead < 0) {
+      break;
+    }
+    msgvec[numMsgs].msg_len = bytesRead;
+    ++numMsgs;
+  }
+  if (numMsgs == 0) {
+    errno = EAGAIN;
+    return -1;
   }
-  return -1;
+  return numMsgs;
+}
+
+int
+MockIoProvider::sendmmsg(
+    int sockFd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  VLOG(4) << "MockIoProvider::sendmmsg called";
+
+  unsigned int numMsgs = 0;
+  for (; numMsgs < vlen; ++numMsgs) {
+    const auto bytesSent = sendmsg(sockFd, &msgvec[numMsgs].msg_hdr, flags);
+    if (bytesSent < 0) {
+      break;
+    }
+    msgvec[numMsgs].msg_len = bytesSent;
+  }
+  return numMsgs ? numMsgs : -1;
+}
+
+bool
+MockIoProvider::hasActiveMessage(int sockFd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = mailboxes_.find(sockFd);
+  return it != mailboxes_.end() and it->second.size() and
+      it->second.front().isActive();
 }
 
 //
-// Simply accept all setsockopts, and build fd to ifName mapping
+// Simply accept all setsockopts, build fd to ifName mapping and note the fds
+// stamping their sent packets
 //
 int
 MockIoProvider::setsockopt(
     int sockFd,
-    int /* level */,
+    int level,
     int optname,
     const void* optval,
     socklen_t /* optlen */) {
@@ -284,6 +404,12 @@ MockIoProvider::setsockopt(
     fdToIfName_[sockFd] = ifName;
   }
 
+  // count the packets sent from here on to key their tx timestamps
+  if (level == SOL_SOCKET and optname == SO_TIMESTAMPING and
+      (*static_cast<const int*>(optval) & SOF_TIMESTAMPING_OPT_ID)) {
+    nextTxKeys_.emplace(sockFd, 0);
+  }
+
   return 0;
 }
 
@@ -83,6 +83,14 @@ class MockIoProvider final : public IoProvider {
   // packet sent off of x will be delivered to y, z
   void setConnectedPairs(ConnectedIfPairs connectedIfPairs);
 
+  // delay packets sent off of an interface by txDelay, as the queue of a busy
+  // interface would. if reportTxTimestamps, sockets that enabled tx
+  // timestamping get the time each packet left at on their error queue.
+  void setTxDelay(
+      std::string const& ifName,
+      std::chrono::milliseconds txDelay,
+      bool reportTxTimestamps);
+
   //
   // The usual IO jazz
   //
@@ -98,6 +106,21 @@ class MockIoProvider final : public IoProvider {
 
   ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags) override;
 
+  // as many recvmsg as there are messages due, at least one
+  int recvmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags,
+      struct timespec* timeout) override;
+
+  // sendmsg of each message
+  int sendmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags) override;
+
   int setsockopt(
       int sockfd,
       int level,
@@ -111,6 +134,9 @@ class MockIoProvider final : public IoProvider {
   void addIfNameIfIndex(const IfNameAndifIndex& entries);
 
  private:
+  // the next message of fd is due for delivery
+  bool hasActiveMessage(int sockFd);
+
   // Boolean to keep track of running-state of MockIoProvider
   std::atomic<bool> isRunning_{false};
 
@@ -119,6 +145,20 @@ class MockIoProvider final : public IoProvider {
 
   ConnectedIfPairs connectedIfPairs_{};
 
+  struct TxDelay {
+    std::chrono::milliseconds delay{0};
+    bool reportTxTimestamps{false};
+  };
+
+  std::map<std::string /* ifName */, TxDelay> txDelays_{};
+
+  // fds with SOF_TIMESTAMPING_OPT_ID tx timestamping enabled, with the key of
+  // their next sent packet
+  std::map<int /* fd */, uint32_t> nextTxKeys_{};
+
+  // the tx timestamps pending on the error queue per fd
+  std::map<int /* fd */, std::list<TxTimestamp>> txTimestamps_{};
+
   // Map of send/recv fds. All fds used below belong to recv-fd which is being
   // polled by Spark (or returned to spark).
   std::map<int /* recv-fd */, int /* send-fd */> pipeFds_;
@@ -1617,6 +1617,69 @@ TEST(MockIoProviderTestSetup, PartialMeshOfNodesTest) {
   mockIoProviderThread.join();
 }
 
+//
+// Messages due get received in batches of at most the given size
+//
+// 2-node topology: 1 -> 2
+//
+TEST(MockIoProviderTestSetup, RecvMessagesTest) {
+  folly::IPAddressV6 ipAddr1V6("fe80::1");
+  folly::IPAddressV6 ipAddr2V6("fe80::2");
+
+  std::string ifName1("iface1");
+  std::string ifName2("iface2");
+
+  int ifIndex1 = 1;
+  int ifIndex2 = 2;
+
+  auto mockIoProvider = std::make_shared<MockIoProvider>();
+  mockIoProvider->addIfNameIfIndex({{ifName1, ifIndex1}, {ifName2, ifIndex2}});
+  mockIoProvider->setConnectedPairs({{ifName1, {{ifName2, 0}}}});
+
+  int fd1 = createSocketAndJoinGroup(
+      mockIoProvider, ifIndex1, folly::IPAddress(kDiscardMulticastAddr));
+  int fd2 = createSocketAndJoinGroup(
+      mockIoProvider, ifIndex2, folly::IPAddress(kDiscardMulticastAddr));
+
+  const std::vector<std::string> packets{"packet #1", "packet #2", "packet #3"};
+  for (const auto& packet : packets) {
+    EXPECT_EQ(
+        packet.size(),
+        IoProvider::sendMessage(
+            fd1,
+            ifIndex1,
+            ipAddr1V6,
+            folly::SocketAddress(ipAddr2V6, kMockedUdpPort),
+            packet,
+            mockIoProvider.get()));
+  }
+  // let all of them become due
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  IoProvider::RecvBuffers recvBufs;
+  recvBufs.resize(kMinIpv6PktSize, 2);
+  auto results = IoProvider::recvMessages(fd2, recvBufs, mockIoProvider.get());
+  ASSERT_EQ(2, results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(packets[i].size(), std::get<0>(results[i]));
+    EXPECT_EQ(ifIndex2, std::get<1>(results[i]));
+    EXPECT_EQ(ipAddr1V6, std::get<2>(results[i]).getIPAddress());
+    EXPECT_EQ(
+        packets[i],
+        std::string(
+            reinterpret_cast<const char*>(recvBufs.data(i)),
+            packets[i].size()));
+  }
+
+  results = IoProvider::recvMessages(fd2, recvBufs, mockIoProvider.get());
+  ASSERT_EQ(1, results.size());
+  EXPECT_EQ(packets[2].size(), std::get<0>(results[0]));
+
+  // nothing pending
+  EXPECT_TRUE(
+      IoProvider::recvMessages(fd2, recvBufs, mockIoProvider.get()).empty());
+}
+
 int
 main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
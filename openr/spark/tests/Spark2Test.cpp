@@ -10,6 +10,7 @@
 #include <mutex>
 #include <thread>
 
+#include <fb303/ServiceData.h>
 #include <folly/MapUtil.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
@@ -36,9 +37,13 @@ using apache::thrift::CompactSerializer;
 namespace {
 const std::string iface1{"iface1"};
 const std::string iface2{"iface2"};
+const std::string iface3{"iface3"};
+const std::string iface4{"iface4"};
 
 const int ifIndex1{1};
 const int ifIndex2{2};
+const int ifIndex3{3};
+const int ifIndex4{4};
 
 const folly::CIDRNetwork ip1V4 =
     folly::IPAddress::createNetwork("192.168.0.1", 24, false /* apply mask */);
@@ -130,9 +135,17 @@ class Spark2Fixture : public testing::Test {
         std::nullopt, // no area support yet
         enableSpark2,
         increaseHelloInterval,
-        timeConfig);
+        timeConfig,
+        adaptiveHeartbeatConfig,
+        workerInfo);
   }
 
+  // heartbeat interval of sparks created, fixed if not set
+  std::optional<AdaptiveHeartbeatConfig> adaptiveHeartbeatConfig;
+
+  // worker of its node each spark created is, the only one if not set
+  SparkWorkerInfo workerInfo;
+
   fbzmq::Context context;
   std::shared_ptr<MockIoProvider> mockIoProvider{nullptr};
   std::unique_ptr<std::thread> mockIoProviderThread{nullptr};
@@ -237,6 +250,84 @@ TEST_F(SimpleSpark2Fixture, RttTest) {
   }
 }
 
+//
+// hellos of node-1 wait 8ms in the queue of iface1 before they leave. the
+// kernel tx timestamps of node-1 take this delay out of its RTT to node-2.
+// node-2 only knows when it handed its hellos to the kernel, so its RTT still
+// includes the delay.
+//
+TEST_F(SimpleSpark2Fixture, TxTimestampRttTest) {
+  SCOPE_EXIT {
+    LOG(INFO) << "Spark2Fixture TxTimestampRttTest finished";
+  };
+
+  // create Spark2 instances and establish connections
+  createAndConnectSpark2Nodes();
+
+  LOG(INFO) << "Change rtt between nodes to 50ms, delay hellos of node-1";
+
+  mockIoProvider->setTxDelay(
+      iface1, std::chrono::milliseconds(8), true /* reportTxTimestamps */);
+  ConnectedIfPairs connectedPairs = {
+      {iface1, {{iface2, 25}}},
+      {iface2, {{iface1, 25}}},
+  };
+  mockIoProvider->setConnectedPairs(connectedPairs);
+
+  {
+    auto event = node1->waitForEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_RTT_CHANGE);
+    ASSERT_TRUE(event.has_value());
+    EXPECT_GE(event->rttUs, (50 - 4) * 1000);
+    EXPECT_LE(event->rttUs, (50 + 4) * 1000);
+    LOG(INFO) << "node-1 reported new RTT to node-2 to be "
+              << event->rttUs / 1000.0 << "ms";
+  }
+
+  {
+    auto event = node2->waitForEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_RTT_CHANGE);
+    ASSERT_TRUE(event.has_value());
+    EXPECT_GE(event->rttUs, (58 - 4) * 1000);
+    EXPECT_LE(event->rttUs, (58 + 4) * 1000);
+    LOG(INFO) << "node-2 reported new RTT to node-1 to be "
+              << event->rttUs / 1000.0 << "ms";
+  }
+}
+
+//
+// as above, but no tx timestamp of node-1 arrives. node-1 falls back to the
+// user space timestamps of its hellos, and its RTT includes the delay too.
+//
+TEST_F(SimpleSpark2Fixture, TxTimestampFallbackRttTest) {
+  SCOPE_EXIT {
+    LOG(INFO) << "Spark2Fixture TxTimestampFallbackRttTest finished";
+  };
+
+  // create Spark2 instances and establish connections
+  createAndConnectSpark2Nodes();
+
+  LOG(INFO) << "Change rtt between nodes to 50ms, delay hellos of node-1";
+
+  mockIoProvider->setTxDelay(
+      iface1, std::chrono::milliseconds(8), false /* reportTxTimestamps */);
+  ConnectedIfPairs connectedPairs = {
+      {iface1, {{iface2, 25}}},
+      {iface2, {{iface1, 25}}},
+  };
+  mockIoProvider->setConnectedPairs(connectedPairs);
+
+  {
+    auto event = node1->waitForEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_RTT_CHANGE);
+    ASSERT_TRUE(event.has_value());
+    EXPECT_GE(event->rttUs, (58 - 4) * 1000);
+    EXPECT_LE(event->rttUs, (58 + 4) * 1000);
+    LOG(INFO) << "node-1 reported new RTT to node-2 to be "
+              << event->rttUs / 1000.0 << "ms";
+  }
+}
+
 TEST_F(SimpleSpark2Fixture, UnidirectionTest) {
   SCOPE_EXIT {
     LOG(INFO) << "Spark2Fxiture UnidirectionTest finished";
@@ -405,6 +496,71 @@ TEST_F(SimpleSpark2Fixture, HeartbeatTimerExpireTest) {
   }
 }
 
+//
+// Both nodes advertise compact heartbeats in their handshake, so they send
+// nothing else once adjacent. These keep the adjacency up past hold time.
+//
+TEST_F(SimpleSpark2Fixture, CompactHeartbeatTest) {
+  SCOPE_EXIT {
+    LOG(INFO) << "Spark2Fixture CompactHeartbeatTest finished";
+  };
+
+  // create Spark2 instances and establish connections
+  createAndConnectSpark2Nodes();
+
+  const auto startTime = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - startTime <
+         3 * kHeartbeatHoldTime) {
+    auto event = node1->recvNeighborEvent(kHeartbeatHoldTime);
+    if (event.hasValue()) {
+      EXPECT_NE(
+          thrift::SparkNeighborEventType::NEIGHBOR_DOWN, event->eventType);
+    }
+  }
+
+  auto counters = facebook::fb303::fbData->getCounters();
+  EXPECT_LT(0, counters["spark.heartbeat.compact_packets_sent.sum"]);
+  EXPECT_EQ(0, counters["spark.invalid_heartbeat.compact.sum"]);
+}
+
+//
+// Adjacencies that don't change back off their heartbeats up to a third of
+// the negotiated hold time, and stay up
+//
+TEST_F(SimpleSpark2Fixture, AdaptiveHeartbeatTest) {
+  SCOPE_EXIT {
+    LOG(INFO) << "Spark2Fixture AdaptiveHeartbeatTest finished";
+  };
+
+  adaptiveHeartbeatConfig = AdaptiveHeartbeatConfig{kHeartbeatTime, 0};
+
+  // create Spark2 instances and establish connections
+  createAndConnectSpark2Nodes();
+  {
+    auto times = node1->getSparkNeighHeartbeatTimes(iface1, "node-2");
+    ASSERT_TRUE(times.has_value());
+    EXPECT_EQ(kHeartbeatHoldTime, times->holdTime);
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - startTime <
+         3 * kHeartbeatHoldTime) {
+    auto event = node1->recvNeighborEvent(kHeartbeatHoldTime);
+    if (event.hasValue()) {
+      EXPECT_NE(
+          thrift::SparkNeighborEventType::NEIGHBOR_DOWN, event->eventType);
+    }
+  }
+
+  {
+    auto times = node1->getSparkNeighHeartbeatTimes(iface1, "node-2");
+    ASSERT_TRUE(times.has_value());
+    EXPECT_EQ(kHeartbeatHoldTime / 3, times->sendInterval);
+  }
+  EXPECT_FALSE(
+      node1->getSparkNeighHeartbeatTimes(iface1, "node-3").has_value());
+}
+
 TEST_F(SimpleSpark2Fixture, InterfaceRemovalTest) {
   SCOPE_EXIT {
     LOG(INFO) << "Spark2Fixture InterfaceRemovalTest finished";
@@ -526,6 +682,112 @@ TEST_F(Spark2Fixture, IgnoreUnidirectionalPeer) {
   }
 }
 
+//
+// node-1 runs two Spark workers, node-2 a single one. node-1 worker 0 must
+// only track the interface with an even ifIndex, and worker 1 the one with
+// an odd ifIndex.
+//
+// [node-1 worker-1] iface1 <---> iface3 [node-2]
+// [node-1 worker-0] iface2 <---> iface4 [node-2]
+//
+TEST_F(Spark2Fixture, WorkerInterfacesTest) {
+  SCOPE_EXIT {
+    LOG(INFO) << "Spark2Fixture WorkerInterfacesTest finished";
+  };
+
+  mockIoProvider->addIfNameIfIndex({{iface1, ifIndex1},
+                                    {iface2, ifIndex2},
+                                    {iface3, ifIndex3},
+                                    {iface4, ifIndex4}});
+  ConnectedIfPairs connectedPairs = {
+      {iface1, {{iface3, 10}}},
+      {iface3, {{iface1, 10}}},
+      {iface2, {{iface4, 10}}},
+      {iface4, {{iface2, 10}}},
+  };
+  mockIoProvider->setConnectedPairs(connectedPairs);
+
+  // both workers of node-1 are fed all of its interfaces, as in Main
+  const std::vector<SparkInterfaceEntry> node1Interfaces{
+      {iface1, ifIndex1, ip1V4, ip1V6}, {iface2, ifIndex2, ip1V4, ip1V6}};
+  workerInfo.numWorkers = 2;
+  workerInfo.allocatedLabels =
+      std::make_shared<folly::Synchronized<std::set<int32_t>>>();
+  workerInfo.workerId = 0;
+  auto node1Worker0 = createSpark(kDomainName, "node-1", 1);
+  workerInfo.workerId = 1;
+  auto node1Worker1 = createSpark(kDomainName, "node-1", 1);
+  EXPECT_TRUE(node1Worker0->updateInterfaceDb(node1Interfaces));
+  EXPECT_TRUE(node1Worker1->updateInterfaceDb(node1Interfaces));
+
+  workerInfo = SparkWorkerInfo{};
+  auto node2 = createSpark(kDomainName, "node-2", 2);
+  EXPECT_TRUE(node2->updateInterfaceDb(
+      {{iface3, ifIndex3, ip2V4, ip2V6}, {iface4, ifIndex4, ip2V4, ip2V6}}));
+
+  // each worker of node-1 forms the adjacency of its own interface
+  int32_t worker0Label{0};
+  {
+    auto event =
+        node1Worker0->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_UP);
+    ASSERT_TRUE(event.has_value());
+    EXPECT_EQ(iface2, event->ifName);
+    EXPECT_EQ("node-2", event->neighbor.nodeName);
+    worker0Label = event->label;
+    LOG(INFO) << "node-1 worker-0 reported adjacency to node-2 on " << iface2;
+  }
+  {
+    auto event =
+        node1Worker1->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_UP);
+    ASSERT_TRUE(event.has_value());
+    EXPECT_EQ(iface1, event->ifName);
+    EXPECT_EQ("node-2", event->neighbor.nodeName);
+    // labels are unique across the workers of a node
+    EXPECT_NE(worker0Label, event->label);
+    LOG(INFO) << "node-1 worker-1 reported adjacency to node-2 on " << iface1;
+  }
+
+  // node-2 sees node-1 on both of its interfaces
+  {
+    std::set<std::string> ifNames;
+    for (int i = 0; i < 2; ++i) {
+      auto event =
+          node2->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_UP);
+      ASSERT_TRUE(event.has_value());
+      EXPECT_EQ("node-1", event->neighbor.nodeName);
+      ifNames.emplace(event->ifName);
+    }
+    EXPECT_EQ(std::set<std::string>({iface3, iface4}), ifNames);
+    LOG(INFO) << "node-2 reported adjacencies to node-1 on both interfaces";
+  }
+
+  // and neither worker tracks the interface of the other one
+  EXPECT_FALSE(node1Worker0->getSparkNeighState(iface1, "node-2").has_value());
+  EXPECT_FALSE(node1Worker1->getSparkNeighState(iface2, "node-2").has_value());
+  EXPECT_EQ(
+      SparkNeighState::ESTABLISHED,
+      node1Worker0->getSparkNeighState(iface2, "node-2"));
+  EXPECT_EQ(
+      SparkNeighState::ESTABLISHED,
+      node1Worker1->getSparkNeighState(iface1, "node-2"));
+
+  // nor reports events of it later on
+  while (true) {
+    auto event = node1Worker0->recvNeighborEvent(kHeartbeatHoldTime);
+    if (event.hasError()) {
+      break;
+    }
+    EXPECT_EQ(iface2, event->ifName);
+  }
+  while (true) {
+    auto event = node1Worker1->recvNeighborEvent(kHeartbeatHoldTime);
+    if (event.hasError()) {
+      break;
+    }
+    EXPECT_EQ(iface1, event->ifName);
+  }
+}
+
 TEST_F(Spark2Fixture, BackwardCompatibilityTest) {
   SCOPE_EXIT {
     LOG(INFO) << "Spark2Fixture BackwardCompatibilityTest finished";
@@ -0,0 +1,484 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <folly/SocketAddress.h>
+#include <folly/init/Init.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/spark/IoProvider.h>
+#include <openr/spark/SparkWrapper.h>
+#include <openr/spark/tests/MockIoProvider.h>
+#include <openr/tests/BenchmarkUtils.h>
+
+namespace {
+
+const std::string kDomainName{"terragraph"};
+const std::string kDutName{"dut"};
+
+// neighbors sharing an interface of the spark under test, few enough for
+// its hellos listing all of them to fit into a packet
+const size_t kNeighborsPerIface{10};
+
+// ifIndex of neighbor interfaces, apart from those of the spark under test
+const int kNbrIfIndexOffset{100000};
+
+const std::chrono::milliseconds kDutHoldTime{6000};
+const std::chrono::milliseconds kDutKeepAliveTime{2000};
+const std::chrono::milliseconds kDutFastInitKeepAliveTime{500};
+
+// neighbors send a hello per round. Few enough hellos for the buckets of
+// Spark rate limiting to stay below Constants::kMaxAllowedPps
+const std::chrono::milliseconds kRoundInterval{1000};
+const std::chrono::milliseconds kNbrHoldTime{3000};
+
+const std::chrono::seconds kEventTimeout{30};
+
+std::chrono::microseconds
+getCurrentTimeInUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+}
+
+} // namespace
+
+namespace openr {
+
+/**
+ * A Spark (the DUT) with numNeighbors Spark1 neighbors emulated on top of
+ * MockIoProvider, kNeighborsPerIface of them behind each of its interfaces.
+ * Neighbors don't run a Spark, their hellos are crafted to list the DUT as
+ * heard from and get sent from a single socket. Hellos of the DUT are not
+ * delivered anywhere.
+ *
+ * One more neighbor on an interface of its own, the marker, tells when the
+ * DUT went through all hellos sent before: its repeated sequence number makes
+ * the DUT report it as restarted, after all hellos ahead of it in the queue.
+ */
+class SparkScaleSetup {
+ public:
+  explicit SparkScaleSetup(size_t numNeighbors)
+      : numNeighbors_(numNeighbors),
+        mockIoProvider_(std::make_shared<MockIoProvider>()),
+        mockIoProviderThread_([this]() { mockIoProvider_->start(); }) {
+    mockIoProvider_->waitUntilRunning();
+
+    const size_t numIfaces =
+        (numNeighbors + kNeighborsPerIface - 1) / kNeighborsPerIface + 1;
+    IfNameAndifIndex ifIndices;
+    ConnectedIfPairs connectedPairs;
+    std::vector<SparkInterfaceEntry> dutIfaces;
+    for (size_t i = 0; i < numIfaces; ++i) {
+      const auto dutIfName = folly::sformat("dut-if-{}", i);
+      const auto nbrIfName = folly::sformat("nbr-if-{}", i);
+      const int ifIndex = i + 1;
+      ifIndices.emplace_back(dutIfName, ifIndex);
+      ifIndices.emplace_back(nbrIfName, kNbrIfIndexOffset + ifIndex);
+      connectedPairs[nbrIfName] = {{dutIfName, 0}};
+      dutIfaces.emplace_back(SparkInterfaceEntry{
+          dutIfName,
+          ifIndex,
+          folly::IPAddress::createNetwork("192.168.0.1/24"),
+          folly::IPAddress::createNetwork("fe80::1/128")});
+    }
+    mockIoProvider_->addIfNameIfIndex(ifIndices);
+    mockIoProvider_->setConnectedPairs(connectedPairs);
+
+    // the last one is the marker, on the last interface
+    for (size_t i = 0; i <= numNeighbors; ++i) {
+      const size_t iface =
+          i < numNeighbors ? i / kNeighborsPerIface : numIfaces - 1;
+      FakeNeighbor neighbor;
+      neighbor.nodeName = folly::sformat("nbr-{}", i);
+      neighbor.ifName = folly::sformat("nbr-if-{}", iface);
+      neighbor.ifIndex = kNbrIfIndexOffset + iface + 1;
+      neighbor.v6Addr = folly::IPAddressV6(folly::sformat("fe80::{:x}", i + 1));
+      neighborIndices_.emplace(neighbor.nodeName, i);
+      neighbors_.emplace_back(std::move(neighbor));
+    }
+    fakeFd_ = mockIoProvider_->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+
+    dut_ = std::make_unique<SparkWrapper>(
+        kDomainName,
+        kDutName,
+        kDutHoldTime,
+        kDutKeepAliveTime,
+        kDutFastInitKeepAliveTime,
+        false /* enableV4 */,
+        std::make_pair(
+            Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
+        zmqContext_,
+        mockIoProvider_,
+        std::nullopt /* areas */,
+        false /* enableSpark2 */,
+        false /* increaseHelloInterval */,
+        SparkTimeConfig());
+    CHECK(dut_->updateInterfaceDb(dutIfaces));
+
+    // neighbors only get adjacent once the DUT sent a hello
+    std::this_thread::sleep_for(2 * kDutFastInitKeepAliveTime);
+  }
+
+  ~SparkScaleSetup() {
+    dut_.reset();
+    mockIoProvider_->stop();
+    mockIoProviderThread_.join();
+  }
+
+  SparkWrapper&
+  getDut() {
+    return *dut_;
+  }
+
+  // hello of each neighbor but the marker and skipped one
+  std::vector<std::pair<size_t, std::string>>
+  buildRound(std::optional<size_t> skipped = std::nullopt) {
+    std::vector<std::pair<size_t, std::string>> packets;
+    packets.reserve(numNeighbors_);
+    for (size_t i = 0; i < numNeighbors_; ++i) {
+      if (i != skipped) {
+        packets.emplace_back(i, buildHello(i));
+      }
+    }
+    return packets;
+  }
+
+  void
+  sendRound(const std::vector<std::pair<size_t, std::string>>& packets) {
+    for (auto const& kv : packets) {
+      sendHello(kv.first, kv.second);
+    }
+  }
+
+  // the DUT processed all hellos sent so far
+  void
+  sync() {
+    sendHello(numNeighbors_, buildHello(numNeighbors_));
+    sendHello(numNeighbors_, buildHello(numNeighbors_, false));
+    waitForEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_RESTARTED,
+        neighbors_.at(numNeighbors_).nodeName);
+  }
+
+  // Send a hello of all neighbors in a burst, marker included, and wait for
+  // all of them to come up. Returns the time from sending the hello of each
+  // to reading its NEIGHBOR_UP.
+  std::vector<std::chrono::microseconds>
+  bringUp() {
+    std::vector<std::pair<size_t, std::string>> packets;
+    for (size_t i = 0; i <= numNeighbors_; ++i) {
+      packets.emplace_back(i, buildHello(i));
+    }
+    std::vector<std::chrono::steady_clock::time_point> sentTimes;
+    for (auto const& kv : packets) {
+      sentTimes.emplace_back(std::chrono::steady_clock::now());
+      sendHello(kv.first, kv.second);
+    }
+
+    std::vector<std::chrono::microseconds> latencies;
+    while (latencies.size() < packets.size()) {
+      auto event = readEvent(kEventTimeout);
+      if (event.eventType == thrift::SparkNeighborEventType::NEIGHBOR_UP) {
+        const auto i = neighborIndices_.at(event.neighbor.nodeName);
+        latencies.emplace_back(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - sentTimes.at(i)));
+      }
+    }
+    return latencies;
+  }
+
+  // bring a lost neighbor back
+  void
+  bringUp(size_t i) {
+    sendHello(i, buildHello(i));
+    waitForEvent(
+        thrift::SparkNeighborEventType::NEIGHBOR_UP, neighbors_.at(i).nodeName);
+  }
+
+  // Read events until deadline or a NEIGHBOR_DOWN. Returns time of reading
+  // the NEIGHBOR_DOWN of neighbor i if that was read.
+  std::optional<std::chrono::steady_clock::time_point>
+  pollEvents(std::chrono::steady_clock::time_point deadline, size_t i) {
+    auto now = std::chrono::steady_clock::now();
+    while (now < deadline) {
+      auto maybeEvent =
+          dut_->recvNeighborEvent(std::chrono::duration_cast<
+                                  std::chrono::milliseconds>(deadline - now));
+      now = std::chrono::steady_clock::now();
+      if (maybeEvent.hasError()) {
+        break;
+      }
+      if (maybeEvent->eventType ==
+          thrift::SparkNeighborEventType::NEIGHBOR_DOWN) {
+        if (maybeEvent->neighbor.nodeName == neighbors_.at(i).nodeName) {
+          return now;
+        }
+        ++numOtherNeighborsDown_;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // neighbors lost while they kept sending hellos
+  size_t
+  getNumOtherNeighborsDown() const {
+    return numOtherNeighborsDown_;
+  }
+
+ private:
+  struct FakeNeighbor {
+    std::string nodeName;
+    std::string ifName;
+    int ifIndex{0};
+    folly::IPAddressV6 v6Addr;
+    int64_t seqNum{0};
+  };
+
+  // hello of neighbor i with the next sequence number, or the last again
+  std::string
+  buildHello(size_t i, bool nextSeqNum = true) {
+    auto& neighbor = neighbors_.at(i);
+    if (nextSeqNum) {
+      ++neighbor.seqNum;
+    }
+
+    // a plausible RTT, as if we replied to a hello of the DUT right away
+    const auto now = getCurrentTimeInUs();
+    thrift::ReflectedNeighborInfo dutInfo;
+    dutInfo.seqNum = 0;
+    dutInfo.lastNbrMsgSentTsInUs = now.count() - 1000;
+    dutInfo.lastMyMsgRcvdTsInUs = now.count() - 800;
+
+    thrift::SparkHelloPacket helloPacket;
+    helloPacket.payload = createSparkPayload(
+        Constants::kOpenrVersion,
+        createSparkNeighbor(
+            kDomainName,
+            neighbor.nodeName,
+            kNbrHoldTime.count(),
+            toBinaryAddress(folly::IPAddress("192.168.0.2")),
+            toBinaryAddress(neighbor.v6Addr),
+            10002 /* kvStoreCmdPort */,
+            neighbor.ifName),
+        neighbor.seqNum,
+        {{kDutName, dutInfo}},
+        now.count(),
+        false /* solicitResponse */,
+        false /* supportFloodOptimization */,
+        false /* restarting */,
+        std::nullopt /* areas */);
+    helloPacket.signature = "";
+    return util::writeThriftObjStr(helloPacket, serializer_);
+  }
+
+  void
+  sendHello(size_t i, const std::string& packet) {
+    auto const& neighbor = neighbors_.at(i);
+    CHECK_EQ(
+        static_cast<ssize_t>(packet.size()),
+        IoProvider::sendMessage(
+            fakeFd_,
+            neighbor.ifIndex,
+            neighbor.v6Addr,
+            dstAddr_,
+            packet,
+            mockIoProvider_.get()));
+  }
+
+  thrift::SparkNeighborEvent
+  readEvent(std::chrono::milliseconds timeout) {
+    auto maybeEvent = dut_->recvNeighborEvent(timeout);
+    CHECK(maybeEvent.hasValue()) << "Timed out waiting for spark event";
+    if (maybeEvent->eventType ==
+        thrift::SparkNeighborEventType::NEIGHBOR_DOWN) {
+      ++numOtherNeighborsDown_;
+    }
+    return std::move(maybeEvent).value();
+  }
+
+  void
+  waitForEvent(
+      thrift::SparkNeighborEventType eventType, const std::string& nodeName) {
+    while (true) {
+      auto event = readEvent(kEventTimeout);
+      if (event.eventType == eventType and
+          event.neighbor.nodeName == nodeName) {
+        return;
+      }
+    }
+  }
+
+  const size_t numNeighbors_{0};
+
+  fbzmq::Context zmqContext_;
+
+  std::shared_ptr<MockIoProvider> mockIoProvider_;
+
+  std::thread mockIoProviderThread_;
+
+  std::unique_ptr<SparkWrapper> dut_;
+
+  // neighbors, the marker last
+  std::vector<FakeNeighbor> neighbors_;
+
+  std::unordered_map<std::string, size_t> neighborIndices_;
+
+  // socket all neighbors send from
+  int fakeFd_{-1};
+
+  const folly::SocketAddress dstAddr_{
+      folly::IPAddress(Constants::kSparkMcastAddr.toString()), 6666};
+
+  size_t numOtherNeighborsDown_{0};
+
+  apache::thrift::CompactSerializer serializer_;
+};
+
+/**
+ * Benchmark of hello processing with all neighbors adjacent
+ * 1. Bring up numNeighbors neighbors
+ * 2. Each iteration, all neighbors send a hello
+ * 3. Measure until the DUT processed them all
+ * CPU time of the Spark thread is reported per hello, including everything
+ * else it did meanwhile, e.g. sending its own hellos.
+ */
+static void
+BM_ProcessHellos(
+    folly::UserCounters& counters, uint32_t iters, size_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+  SparkScaleSetup setup(numNeighbors);
+  setup.bringUp();
+
+  std::chrono::nanoseconds cpuTime{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    std::this_thread::sleep_for(kRoundInterval);
+    const auto packets = setup.buildRound();
+    const auto cpuTimeBefore = setup.getDut().getCpuTime();
+    suspender.dismiss(); // Start measuring benchmark time
+    setup.sendRound(packets);
+    setup.sync();
+    suspender.rehire(); // Stop measuring time again
+    cpuTime += setup.getDut().getCpuTime() - cpuTimeBefore;
+  }
+  counters["cpu_ns_per_hello"] = cpuTime.count() / (iters * numNeighbors);
+  counters["neighbors_down"] = setup.getNumOtherNeighborsDown();
+}
+
+/**
+ * Benchmark of neighbor discovery, i.e. latency of events to LinkMonitor
+ * 1. Start the DUT without neighbors
+ * 2. All numNeighbors neighbors send a hello in a burst
+ * 3. Measure until all of them are reported up
+ * Latencies from sending the hello of a neighbor to reading its NEIGHBOR_UP
+ * out of the event queue are reported.
+ */
+static void
+BM_NeighborUp(
+    folly::UserCounters& counters, uint32_t iters, size_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::chrono::microseconds totalLatency{0};
+  std::chrono::microseconds maxLatency{0};
+  size_t numLatencies{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    SparkScaleSetup setup(numNeighbors);
+    suspender.dismiss(); // Start measuring benchmark time
+    const auto latencies = setup.bringUp();
+    suspender.rehire(); // Stop measuring time again
+    for (auto const& latency : latencies) {
+      totalLatency += latency;
+      maxLatency = std::max(maxLatency, latency);
+    }
+    numLatencies += latencies.size();
+  }
+  counters["up_latency_avg_us"] = totalLatency.count() / numLatencies;
+  counters["up_latency_max_us"] = maxLatency.count();
+}
+
+/**
+ * Benchmark of neighbor loss detection under load
+ * 1. Bring up numNeighbors neighbors
+ * 2. Each iteration, one of them stops sending hellos, all others keep
+ *    sending a hello per round
+ * 3. Measure until it is reported down
+ * Delays of reporting it beyond the hold time are reported.
+ */
+static void
+BM_DetectNeighborLoss(
+    folly::UserCounters& counters, uint32_t iters, size_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+  SparkScaleSetup setup(numNeighbors);
+  setup.bringUp();
+
+  std::chrono::microseconds totalDelay{0};
+  std::chrono::microseconds maxDelay{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    const size_t lost = i % numNeighbors;
+    std::this_thread::sleep_for(kRoundInterval);
+    const auto lastHelloTime = std::chrono::steady_clock::now();
+    setup.sendRound(setup.buildRound());
+    setup.sync();
+
+    suspender.dismiss(); // Start measuring benchmark time
+    auto nextRound = lastHelloTime + kRoundInterval;
+    std::optional<std::chrono::steady_clock::time_point> downTime;
+    while (true) {
+      downTime = setup.pollEvents(nextRound, lost);
+      if (downTime) {
+        break;
+      }
+      setup.sendRound(setup.buildRound(lost));
+      setup.sync();
+      nextRound += kRoundInterval;
+    }
+    suspender.rehire(); // Stop measuring time again
+
+    const auto delay = std::chrono::duration_cast<std::chrono::microseconds>(
+        *downTime - lastHelloTime - kNbrHoldTime);
+    totalDelay += delay;
+    maxDelay = std::max(maxDelay, delay);
+    setup.bringUp(lost);
+  }
+  counters["detect_delay_avg_us"] = totalDelay.count() / iters;
+  counters["detect_delay_max_us"] = maxDelay.count();
+  counters["neighbors_down"] = setup.getNumOtherNeighborsDown();
+}
+
+// The parameter is the number of neighbors
+BENCHMARK_COUNTERS_NAME_PARAM(BM_ProcessHellos, counters, 100, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_ProcessHellos, counters, 1000, 1000);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_ProcessHellos, counters, 5000, 5000);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_NeighborUp, counters, 100, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_NeighborUp, counters, 1000, 1000);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_NeighborUp, counters, 5000, 5000);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DetectNeighborLoss, counters, 100, 100);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DetectNeighborLoss, counters, 1000, 1000);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_DetectNeighborLoss, counters, 5000, 5000);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -608,6 +608,50 @@ TEST_F(SparkFixture, IfaceRemovalTest) {
   }
 }
 
+//
+// Interfaces left out of a delta stay tracked, only listed ones change
+//
+TEST_F(SparkFixture, IfaceDeltaTest) {
+  mockIoProvider->addIfNameIfIndex(
+      {{iface1, ifIndex1}, {iface2, ifIndex2}, {iface3, ifIndex3}});
+  ConnectedIfPairs connectedPairs = {
+      {iface1, {{iface2, 100}}},
+      {iface2, {{iface1, 100}}},
+  };
+  mockIoProvider->setConnectedPairs(connectedPairs);
+
+  auto spark1 = createSpark(kDomainName, "node-1", 1);
+  auto spark2 = createSpark(kDomainName, "node-2", 2);
+
+  EXPECT_TRUE(spark1->updateInterfaceDb({{iface1, ifIndex1, ip1V4, ip1V6}}));
+  EXPECT_TRUE(spark2->updateInterfaceDb({{iface2, ifIndex2, ip2V4, ip2V6}}));
+  {
+    auto event =
+        spark1->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_UP);
+    ASSERT_TRUE(event.has_value());
+  }
+  {
+    auto event =
+        spark2->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_UP);
+    ASSERT_TRUE(event.has_value());
+  }
+
+  // add and remove an unrelated interface, neighbor on iface1 stays up
+  EXPECT_TRUE(
+      spark1->updateInterfaceDelta({{iface3, ifIndex3, ip3V4, ip3V6}}, {}));
+  EXPECT_TRUE(spark1->updateInterfaceDelta({}, {iface3}));
+  EXPECT_TRUE(spark1->recvNeighborEvent(kHoldTime * 3).hasError());
+
+  // remove iface1 by delta, neighbor goes down
+  EXPECT_TRUE(spark1->updateInterfaceDelta({}, {iface1}));
+  {
+    auto event =
+        spark1->waitForEvent(thrift::SparkNeighborEventType::NEIGHBOR_DOWN);
+    ASSERT_TRUE(event.has_value());
+    EXPECT_EQ(iface1, event->ifName);
+  }
+}
+
 //
 // Start two sparks on same network, then add third one. Next, shutdown
 // the third one, make sure the two others detect it. Also make sure that
@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <malloc.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <openr/tests/BenchmarkUtils.h>
+
+namespace {
+std::atomic<uint64_t> numAllocs{0};
+std::atomic<int64_t> numLiveBytes{0};
+} // namespace
+
+void*
+operator new(std::size_t size) {
+  numAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    numLiveBytes.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void*
+operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void
+operator delete(void* ptr) noexcept {
+  numLiveBytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+  std::free(ptr);
+}
+
+void
+operator delete[](void* ptr) noexcept {
+  operator delete(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t /* size */) noexcept {
+  operator delete(ptr);
+}
+
+void
+operator delete[](void* ptr, std::size_t /* size */) noexcept {
+  operator delete(ptr);
+}
+
+namespace openr {
+
+uint64_t
+getNumHeapAllocs() {
+  return numAllocs.load(std::memory_order_relaxed);
+}
+
+int64_t
+getNumLiveHeapBytes() {
+  return numLiveBytes.load(std::memory_order_relaxed);
+}
+
+} // namespace openr
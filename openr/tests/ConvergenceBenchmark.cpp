@@ -0,0 +1,337 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/Singleton.h>
+#include <folly/init/Init.h>
+#include <thrift/lib/cpp2/server/ThriftServer.h>
+#include <thrift/lib/cpp2/util/ScopedServerThread.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/Util.h>
+#include <openr/decision/Decision.h>
+#include <openr/fib/Fib.h>
+#include <openr/fib/tests/MockNetlinkFibHandler.h>
+#include <openr/kvstore/KvStoreWrapper.h>
+#include <openr/messaging/ReplicateQueue.h>
+#include <openr/tests/BenchmarkUtils.h>
+
+namespace openr {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// node routes get computed for, corner of the grid
+const std::string kMyNodeName{"0"};
+
+// latency of one link event through each stage of the pipeline
+struct StageLatency {
+  // setting the key until KvStore publishes it
+  std::chrono::microseconds kvStore{0};
+  // KvStore publication until Decision sends the route delta
+  std::chrono::microseconds decision{0};
+  // route delta until the platform got the routes programmed
+  std::chrono::microseconds fib{0};
+
+  std::chrono::microseconds
+  total() const {
+    return kvStore + decision + fib;
+  }
+};
+
+std::string
+getIfName(int nodeId, int otherId) {
+  return folly::sformat("if_{}_{}", nodeId, otherId);
+}
+
+// adjacencies of node at (row, col) of an n by n grid, the one towards
+// node 1 has given metric
+std::vector<thrift::Adjacency>
+createGridAdjacencies(int row, int col, int n, int32_t metricToNode1) {
+  std::vector<thrift::Adjacency> adjs;
+  const int nodeId = row * n + col;
+  const std::vector<std::pair<int, int>> neighbors = {
+      {row, col + 1}, {row, col - 1}, {row + 1, col}, {row - 1, col}};
+  for (auto const& neighbor : neighbors) {
+    if (neighbor.first < 0 or neighbor.first >= n or neighbor.second < 0 or
+        neighbor.second >= n) {
+      continue;
+    }
+    const int otherId = neighbor.first * n + neighbor.second;
+    adjs.emplace_back(createThriftAdjacency(
+        folly::sformat("{}", otherId),
+        getIfName(nodeId, otherId),
+        folly::sformat("fe80::{:x}", otherId + 1),
+        folly::sformat(
+            "10.{}.{}.{}",
+            otherId >> 16,
+            (otherId >> 8) & 0xff,
+            otherId & 0xff),
+        otherId == 1 ? metricToNode1 : 1,
+        100001 + otherId /* adjacency-label */,
+        false /* overload-bit */,
+        100 /* rtt */,
+        10000 /* timestamp */,
+        1 /* weight */,
+        getIfName(otherId, nodeId)));
+  }
+  return adjs;
+}
+
+std::chrono::microseconds
+getPercentile(std::vector<std::chrono::microseconds> latencies, double p) {
+  if (latencies.empty()) {
+    return std::chrono::microseconds(0);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  const auto index = std::min(
+      latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+  return latencies[index];
+}
+
+} // namespace
+
+/**
+ * KvStore, Decision and Fib wired through the messaging queues they use in
+ * Open/R, with Fib programming a mock FibService. Link events get injected
+ * into KvStore as adjacency updates of kMyNodeName, the routes they change
+ * come out at the mock.
+ */
+class PipelineWrapper {
+ public:
+  PipelineWrapper() {
+    folly::SingletonVault::singleton()->registrationComplete();
+
+    mockFibHandler = std::make_shared<MockNetlinkFibHandler>();
+    fibServer = std::make_shared<apache::thrift::ThriftServer>();
+    fibServer->setNumIOWorkerThreads(1);
+    fibServer->setNumAcceptThreads(1);
+    fibServer->setPort(0);
+    fibServer->setInterface(mockFibHandler);
+    fibServerThread.start(fibServer);
+
+    kvStore = std::make_unique<KvStoreWrapper>(
+        context,
+        "kvstore-" + kMyNodeName,
+        std::chrono::seconds(60) /* dbSyncInterval */,
+        std::chrono::seconds(600) /* monitorSubmitInterval */,
+        std::unordered_map<std::string, thrift::PeerSpec>{});
+    kvStore->run();
+
+    // default debounce of Open/R, it is part of the latency
+    decision = std::make_unique<Decision>(
+        kMyNodeName,
+        true /* enableV4 */,
+        false /* computeLfaPaths */,
+        false /* enableOrderedFib */,
+        false /* bgpDryRun */,
+        false /* bgpUseIgpMetric */,
+        AdjacencyDbMarker{Constants::kAdjDbMarker.toString()},
+        PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+        std::chrono::milliseconds(10),
+        std::chrono::milliseconds(250),
+        std::nullopt /* gracefulRestartDuration */,
+        kvStore->getReader(),
+        staticRoutesQueue.getReader(),
+        routeUpdatesQueue,
+        context);
+    decisionThread = std::thread([this]() { decision->run(); });
+    decision->waitUntilRunning();
+
+    fib = std::make_unique<Fib>(
+        kMyNodeName,
+        fibServerThread.getAddress()->getPort(),
+        false /* dryrun */,
+        false /* enableSegmentRouting */,
+        false /* enableOrderedFib */,
+        std::chrono::seconds(0) /* coldStartDuration */,
+        false /* waitOnDecision */,
+        routeUpdatesQueue.getReader(),
+        interfaceUpdatesQueue.getReader(),
+        MonitorSubmitUrl{"inproc://convergence-benchmark-monitor"},
+        nullptr /* kvStore */,
+        context);
+    fibThread = std::thread([this]() { fib->run(); });
+    fib->waitUntilRunning();
+    mockFibHandler->waitForSyncFib();
+  }
+
+  ~PipelineWrapper() {
+    routeUpdatesQueue.close();
+    staticRoutesQueue.close();
+    interfaceUpdatesQueue.close();
+    kvStore->closeQueue();
+    fib->stop();
+    fibThread.join();
+    decision->stop();
+    decisionThread.join();
+    kvStore->stop();
+  }
+
+  // advertise an n by n grid, once its routes are programmed
+  void
+  createGrid(int n) {
+    gridSize_ = n;
+    std::vector<std::pair<std::string, thrift::Value>> keyVals;
+    for (int row = 0; row < n; ++row) {
+      for (int col = 0; col < n; ++col) {
+        const auto nodeName = folly::sformat("{}", row * n + col);
+        keyVals.emplace_back(
+            Constants::kAdjDbMarker.toString() + nodeName,
+            createAdjValue(nodeName, 1, createGridAdjacencies(row, col, n, 1)));
+        keyVals.emplace_back(
+            Constants::kPrefixDbMarker.toString() + nodeName,
+            createPrefixValue(nodeName, row * n + col));
+      }
+    }
+    kvStore->setKeys(keyVals);
+    mockFibHandler->waitForUpdateUnicastRoutes();
+
+    // stages get observed from here on
+    kvStoreReader.emplace(kvStore->getReader());
+    routeReader.emplace(routeUpdatesQueue.getReader());
+  }
+
+  // toggle the metric of the link of kMyNodeName towards node 1, which
+  // moves routes on or off it. Returns once the mock has them programmed
+  StageLatency
+  flapLink() {
+    ++adjVersion_;
+    const auto key = Constants::kAdjDbMarker.toString() + kMyNodeName;
+    const auto adjs = createGridAdjacencies(
+        0, 0, gridSize_, adjVersion_ % 2 ? 1 : gridSize_ * 2);
+
+    StageLatency latency;
+    const auto startTime = Clock::now();
+    kvStore->setKey(key, createAdjValue(kMyNodeName, adjVersion_, adjs));
+    while (true) {
+      auto pub = kvStoreReader->get().value();
+      if (pub->keyVals.count(key)) {
+        break;
+      }
+    }
+    const auto kvStoreTime = Clock::now();
+    routeReader->get().value();
+    const auto decisionTime = Clock::now();
+    mockFibHandler->waitForUpdateUnicastRoutes();
+    const auto fibTime = Clock::now();
+
+    latency.kvStore = std::chrono::duration_cast<std::chrono::microseconds>(
+        kvStoreTime - startTime);
+    latency.decision = std::chrono::duration_cast<std::chrono::microseconds>(
+        decisionTime - kvStoreTime);
+    latency.fib = std::chrono::duration_cast<std::chrono::microseconds>(
+        fibTime - decisionTime);
+    return latency;
+  }
+
+ private:
+  thrift::Value
+  createAdjValue(
+      std::string const& nodeName,
+      int64_t version,
+      std::vector<thrift::Adjacency> const& adjs) {
+    return createThriftValue(
+        version,
+        nodeName,
+        fbzmq::util::writeThriftObjStr(
+            createAdjDb(nodeName, adjs, 0), serializer));
+  }
+
+  thrift::Value
+  createPrefixValue(std::string const& nodeName, int nodeId) {
+    const auto prefix = toIpPrefix(folly::sformat(
+        "fc00:{:x}:{:x}::/64", nodeId >> 16, nodeId & 0xffff));
+    return createThriftValue(
+        1,
+        nodeName,
+        fbzmq::util::writeThriftObjStr(
+            createPrefixDb(nodeName, {createPrefixEntry(prefix)}),
+            serializer));
+  }
+
+  apache::thrift::CompactSerializer serializer;
+  fbzmq::Context context;
+  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue;
+  messaging::ReplicateQueue<thrift::RouteDatabaseDelta> staticRoutesQueue;
+  messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue;
+
+  std::shared_ptr<MockNetlinkFibHandler> mockFibHandler;
+  std::shared_ptr<apache::thrift::ThriftServer> fibServer;
+  apache::thrift::util::ScopedServerThread fibServerThread;
+
+  std::unique_ptr<KvStoreWrapper> kvStore;
+  std::unique_ptr<Decision> decision;
+  std::thread decisionThread;
+  std::unique_ptr<Fib> fib;
+  std::thread fibThread;
+
+  // readers observing the output of KvStore and Decision
+  std::optional<messaging::RQueue<KvStorePublication>> kvStoreReader;
+  std::optional<messaging::RQueue<thrift::RouteDatabaseDelta>> routeReader;
+
+  int gridSize_{0};
+  int64_t adjVersion_{1};
+};
+
+/**
+ * Latency of link events, from the adjacency update reaching KvStore until
+ * routes are programmed, on an n by n grid. Reports percentiles of the
+ * whole pipeline and of each stage, and link events per second.
+ */
+static void
+BM_ConvergenceGridLinkFlap(
+    folly::UserCounters& counters, uint32_t iters, int n) {
+  auto suspender = folly::BenchmarkSuspender();
+  PipelineWrapper pipeline;
+  pipeline.createGrid(n);
+
+  std::vector<std::chrono::microseconds> total;
+  std::vector<std::chrono::microseconds> kvStore;
+  std::vector<std::chrono::microseconds> decision;
+  std::vector<std::chrono::microseconds> fib;
+  const auto runs = std::max<uint32_t>(iters, 1);
+  const auto startTime = Clock::now();
+  suspender.dismiss();
+  for (uint32_t i = 0; i < runs; ++i) {
+    const auto latency = pipeline.flapLink();
+    total.emplace_back(latency.total());
+    kvStore.emplace_back(latency.kvStore);
+    decision.emplace_back(latency.decision);
+    fib.emplace_back(latency.fib);
+  }
+  suspender.rehire();
+  const auto duration = Clock::now() - startTime;
+
+  counters["p50_us"] = getPercentile(total, 0.5).count();
+  counters["p99_us"] = getPercentile(total, 0.99).count();
+  counters["kvstore_p50_us"] = getPercentile(kvStore, 0.5).count();
+  counters["decision_p50_us"] = getPercentile(decision, 0.5).count();
+  counters["fib_p50_us"] = getPercentile(fib, 0.5).count();
+  counters["events_per_sec"] = runs /
+      std::max(std::chrono::duration<double>(duration).count(), 1e-6);
+}
+
+// The integer parameter is the side of the grid, i.e. n for n * n nodes
+BENCHMARK_COUNTERS_PARAM(BM_ConvergenceGridLinkFlap, counters, 10);
+BENCHMARK_COUNTERS_PARAM(BM_ConvergenceGridLinkFlap, counters, 30);
+BENCHMARK_COUNTERS_PARAM(BM_ConvergenceGridLinkFlap, counters, 100);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
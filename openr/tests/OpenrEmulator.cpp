@@ -0,0 +1,258 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MockSystemHandler.h"
+
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <folly/init/Init.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+#include <thrift/lib/cpp2/server/ThriftServer.h>
+#include <thrift/lib/cpp2/util/ScopedServerThread.h>
+
+#include <openr/spark/tests/MockIoProvider.h>
+#include <openr/tests/OpenrWrapper.h>
+
+/**
+ * In-process emulation of an Open/R network. Every node is a full stack as
+ * built by OpenrWrapper (KvStore, Spark, LinkMonitor, PrefixManager,
+ * PrefixAllocator, Decision and Fib in dry-run mode) in a single process.
+ * Spark of all nodes talks over one MockIoProvider, which connects the
+ * interfaces of the emulated links, and KvStores peer over inproc sockets of
+ * a shared zmq context.
+ *
+ * Reports how long the network takes to come up, i.e. until every node has
+ * a route to the prefix allocated by every other node, and optionally how
+ * long it takes to reconverge after one node gets isolated.
+ *
+ * Each node runs a dozen module threads, size the emulation (and ulimits)
+ * accordingly.
+ */
+
+DEFINE_int32(num_nodes, 16, "Number of nodes to emulate");
+DEFINE_string(topology, "grid", "Topology of the nodes, one of grid or ring");
+DEFINE_int32(link_latency_ms, 1, "Latency of the emulated links");
+DEFINE_bool(enable_v4, false, "Enable v4 on the emulated nodes");
+DEFINE_int32(spark_hold_time_ms, 3000, "Spark hold time");
+DEFINE_int32(spark_keepalive_time_ms, 500, "Spark keep-alive time");
+DEFINE_int32(spark_fastinit_keepalive_time_ms, 100, "Spark fast-init time");
+DEFINE_int32(converge_timeout_s, 600, "Give up waiting for convergence");
+DEFINE_int32(poll_interval_ms, 1000, "Interval of checking route databases");
+DEFINE_bool(
+    isolate_node,
+    true,
+    "Once converged, isolate the last node and measure reconvergence");
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// room for 64k nodes, the OpenrWrapper default only has 4 prefixes
+const auto kSeedPrefix = std::make_pair(
+    folly::IPAddress::createNetwork("fc00:cafe::/48"), uint8_t{64});
+
+std::string
+getIfName(int nodeId, int otherId) {
+  return folly::sformat("if_{}_{}", nodeId, otherId);
+}
+
+// links of the topology, each one once
+std::vector<std::pair<int, int>>
+createLinks(const std::string& topology, int numNodes) {
+  std::vector<std::pair<int, int>> links;
+  if (topology == "ring") {
+    for (int i = 0; i < numNodes; ++i) {
+      const int other = (i + 1) % numNodes;
+      if (other != i and not(numNodes == 2 and i == 1)) {
+        links.emplace_back(i, other);
+      }
+    }
+  } else if (topology == "grid") {
+    const int side = std::ceil(std::sqrt(numNodes));
+    for (int i = 0; i < numNodes; ++i) {
+      if ((i % side) + 1 < side and i + 1 < numNodes) {
+        links.emplace_back(i, i + 1);
+      }
+      if (i + side < numNodes) {
+        links.emplace_back(i, i + side);
+      }
+    }
+  } else {
+    LOG(FATAL) << "Unknown topology " << topology;
+  }
+  return links;
+}
+
+folly::CIDRNetwork
+getV4Network(int nodeId) {
+  return {folly::IPAddress(folly::sformat(
+              "10.{}.{}.{}",
+              nodeId >> 16,
+              (nodeId >> 8) & 0xff,
+              nodeId & 0xff)),
+          32};
+}
+
+folly::CIDRNetwork
+getV6Network(int nodeId) {
+  return {folly::IPAddress(folly::sformat("fe80::{:x}", nodeId + 1)), 128};
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  CHECK_GT(FLAGS_num_nodes, 1);
+
+  using namespace openr;
+  using OpenrNode = OpenrWrapper<apache::thrift::CompactSerializer>;
+
+  fbzmq::Context context;
+
+  // all Spark packets go through the mock IoProvider
+  auto mockIoProvider = std::make_shared<MockIoProvider>();
+  std::thread mockIoProviderThread([&mockIoProvider]() {
+    mockIoProvider->start();
+  });
+  mockIoProvider->waitUntilRunning();
+
+  // system service PrefixAllocator talks to
+  auto systemHandler = std::make_shared<MockSystemHandler>();
+  auto systemServer = std::make_shared<apache::thrift::ThriftServer>();
+  systemServer->setNumIOWorkerThreads(1);
+  systemServer->setNumAcceptThreads(1);
+  systemServer->setPort(0);
+  systemServer->setInterface(systemHandler);
+  apache::thrift::util::ScopedServerThread systemServerThread(systemServer);
+  const auto systemPort = systemServerThread.getAddress()->getPort();
+
+  // interfaces of every node, connected as per topology
+  const auto links = createLinks(FLAGS_topology, FLAGS_num_nodes);
+  std::vector<std::vector<SparkInterfaceEntry>> interfaces(FLAGS_num_nodes);
+  std::vector<std::pair<std::string, int>> ifNameIfIndex;
+  ConnectedIfPairs connectedPairs;
+  const auto addInterface = [&](int nodeId, int otherId) {
+    const auto ifName = getIfName(nodeId, otherId);
+    const int ifIndex = ifNameIfIndex.size() + 1;
+    ifNameIfIndex.emplace_back(ifName, ifIndex);
+    interfaces.at(nodeId).push_back(
+        {ifName, ifIndex, getV4Network(nodeId), getV6Network(nodeId)});
+    connectedPairs[ifName].emplace_back(
+        getIfName(otherId, nodeId), FLAGS_link_latency_ms);
+  };
+  for (auto const& [a, b] : links) {
+    addInterface(a, b);
+    addInterface(b, a);
+  }
+  mockIoProvider->addIfNameIfIndex(ifNameIfIndex);
+  mockIoProvider->setConnectedPairs(connectedPairs);
+
+  LOG(INFO) << "Starting " << FLAGS_num_nodes << " nodes with "
+            << links.size() << " links";
+  std::vector<std::unique_ptr<OpenrNode>> nodes;
+  for (int i = 0; i < FLAGS_num_nodes; ++i) {
+    nodes.emplace_back(std::make_unique<OpenrNode>(
+        context,
+        folly::sformat("{}", i),
+        FLAGS_enable_v4,
+        std::chrono::seconds(60) /* kvStoreDbSyncInterval */,
+        std::chrono::seconds(60) /* kvStoreMonitorSubmitInterval */,
+        std::chrono::milliseconds(FLAGS_spark_hold_time_ms),
+        std::chrono::milliseconds(FLAGS_spark_keepalive_time_ms),
+        std::chrono::milliseconds(FLAGS_spark_fastinit_keepalive_time_ms),
+        std::chrono::seconds(1) /* linkMonitorAdjHoldTime */,
+        std::chrono::milliseconds(1) /* linkFlapInitialBackoff */,
+        std::chrono::milliseconds(8) /* linkFlapMaxBackoff */,
+        std::chrono::seconds(1) /* fibColdStartDuration */,
+        mockIoProvider,
+        systemPort,
+        openr::memLimitMB,
+        false /* per_prefix_keys */,
+        kSeedPrefix));
+    nodes.back()->run();
+  }
+
+  // wait until the nodes with given ids have the given number of routes
+  const auto waitForRoutes = [&](const std::vector<int>& nodeIds,
+                                 size_t numRoutes) {
+    const auto startTime = Clock::now();
+    const auto timeout = std::chrono::seconds(FLAGS_converge_timeout_s);
+    while (Clock::now() - startTime < timeout) {
+      size_t numConverged{0};
+      for (auto nodeId : nodeIds) {
+        const auto routeDb = nodes.at(nodeId)->fibDumpRouteDatabase();
+        if (routeDb.unicastRoutes.size() == numRoutes) {
+          ++numConverged;
+        }
+      }
+      LOG(INFO) << numConverged << " of " << nodeIds.size()
+                << " nodes converged";
+      if (numConverged == nodeIds.size()) {
+        return true;
+      }
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(FLAGS_poll_interval_ms));
+    }
+    return false;
+  };
+  const auto toMs = [](Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration)
+        .count();
+  };
+
+  // bring up the network
+  std::vector<int> allNodeIds;
+  for (int i = 0; i < FLAGS_num_nodes; ++i) {
+    allNodeIds.emplace_back(i);
+  }
+  const auto startTime = Clock::now();
+  for (int i = 0; i < FLAGS_num_nodes; ++i) {
+    nodes.at(i)->sparkUpdateInterfaceDb(interfaces.at(i));
+  }
+  const bool converged = waitForRoutes(allNodeIds, FLAGS_num_nodes - 1);
+  std::cout << "Nodes: " << FLAGS_num_nodes << std::endl
+            << "Links: " << links.size() << std::endl
+            << "Convergence: "
+            << (converged
+                    ? folly::sformat("{}ms", toMs(Clock::now() - startTime))
+                    : std::string("timed out"))
+            << std::endl;
+
+  // cut all links of the last node, the others must drop its prefix
+  if (converged and FLAGS_isolate_node) {
+    const auto isolatedId = FLAGS_num_nodes - 1;
+    ConnectedIfPairs remainingPairs;
+    for (auto const& [a, b] : links) {
+      if (a != isolatedId and b != isolatedId) {
+        remainingPairs[getIfName(a, b)] = connectedPairs.at(getIfName(a, b));
+        remainingPairs[getIfName(b, a)] = connectedPairs.at(getIfName(b, a));
+      }
+    }
+    allNodeIds.pop_back();
+    const auto isolateTime = Clock::now();
+    mockIoProvider->setConnectedPairs(remainingPairs);
+    const bool reconverged = waitForRoutes(allNodeIds, FLAGS_num_nodes - 2);
+    std::cout << "Reconvergence after isolating node " << isolatedId << ": "
+              << (reconverged
+                      ? folly::sformat("{}ms", toMs(Clock::now() - isolateTime))
+                      : std::string("timed out"))
+              << std::endl;
+  }
+
+  // OpenrWrapper stops its modules on destruction
+  nodes.clear();
+  mockIoProvider->stop();
+  mockIoProviderThread.join();
+  systemServerThread.stop();
+  return 0;
+}
@@ -18,10 +18,13 @@ OpenrThriftServerWrapper::OpenrThriftServerWrapper(
     PersistentStore* configStore,
     PrefixManager* prefixManager,
     MonitorSubmitUrl const& monitorSubmitUrl,
-    fbzmq::Context& context)
+    fbzmq::Context& context,
+    std::optional<messaging::RQueue<thrift::RouteDatabaseDelta>>
+        fibUpdatesReader)
     : nodeName_(nodeName),
       monitorSubmitUrl_(monitorSubmitUrl),
       context_(context),
+      fibUpdatesReader_(std::move(fibUpdatesReader)),
       decision_(decision),
       fib_(fib),
       kvStore_(kvStore),
@@ -50,7 +53,9 @@ OpenrThriftServerWrapper::run() {
         configStore_,
         prefixManager_,
         monitorSubmitUrl_,
-        context_);
+        context_,
+        std::chrono::milliseconds(0),
+        std::move(fibUpdatesReader_));
   });
 
   // setup openrCtrlThrift server for client to connect to
@@ -24,6 +24,8 @@ class OpenrThriftServerWrapper {
   std::string const nodeName_;
   MonitorSubmitUrl const monitorSubmitUrl_;
   fbzmq::Context& context_;
+  std::optional<messaging::RQueue<thrift::RouteDatabaseDelta>>
+      fibUpdatesReader_;
 
  public:
   OpenrThriftServerWrapper(
@@ -35,7 +37,9 @@ class OpenrThriftServerWrapper {
       PersistentStore* configStore,
       PrefixManager* prefixManager,
       MonitorSubmitUrl const& monitorSubmitUrl,
-      fbzmq::Context& context);
+      fbzmq::Context& context,
+      std::optional<messaging::RQueue<thrift::RouteDatabaseDelta>>
+          fibUpdatesReader = std::nullopt);
 
   // start Open/R thrift server
   void run();
@@ -30,7 +30,8 @@ OpenrWrapper<Serializer>::OpenrWrapper(
     std::shared_ptr<IoProvider> ioProvider,
     int32_t systemPort,
     uint32_t memLimit,
-    bool per_prefix_keys)
+    bool per_prefix_keys,
+    std::optional<std::pair<folly::CIDRNetwork, uint8_t>> seedPrefix)
     : context_(context),
       nodeId_(nodeId),
       ioProvider_(std::move(ioProvider)),
@@ -243,16 +244,18 @@ OpenrWrapper<Serializer>::OpenrWrapper(
   //
   // create PrefixAllocator
   //
-  const auto seedPrefix =
-      folly::IPAddress::createNetwork("fc00:cafe:babe::/62");
-  const uint8_t allocPrefixLen = 64;
+  // default seed has room for 4 nodes only, large topologies pass their own
+  if (not seedPrefix.has_value()) {
+    seedPrefix = std::make_pair(
+        folly::IPAddress::createNetwork("fc00:cafe:babe::/62"), 64);
+  }
   prefixAllocator_ = std::make_unique<PrefixAllocator>(
       nodeId_,
       kvStore_.get(),
       prefixUpdatesQueue_,
       MonitorSubmitUrl{monitorSubmitUrl_},
       AllocPrefixMarker{"allocprefix:"}, // alloc_prefix_marker
-      std::make_pair(seedPrefix, allocPrefixLen),
+      seedPrefix.value(),
       false /* set loopback addr */,
       false /* override global address */,
       "" /* loopback interface name */,
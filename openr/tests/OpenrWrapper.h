@@ -52,7 +52,9 @@ class OpenrWrapper {
       std::shared_ptr<IoProvider> ioProvider,
       int32_t systemPort,
       uint32_t memLimit = openr::memLimitMB,
-      bool per_prefix_keys = false);
+      bool per_prefix_keys = false,
+      std::optional<std::pair<folly::CIDRNetwork, uint8_t>> seedPrefix =
+          std::nullopt);
 
   ~OpenrWrapper() {
     stop();
@@ -157,9 +159,9 @@ class OpenrWrapper {
   messaging::ReplicateQueue<thrift::RouteDatabaseDelta> routeUpdatesQueue_;
   messaging::ReplicateQueue<thrift::InterfaceDatabase> interfaceUpdatesQueue_;
   messaging::ReplicateQueue<thrift::PeerUpdateRequest> peerUpdatesQueue_;
-  messaging::ReplicateQueue<thrift::SparkNeighborEvent> neighborUpdatesQueue_;
+  messaging::ReplicateQueue<thrift::SparkNeighborEvents> neighborUpdatesQueue_;
   messaging::ReplicateQueue<thrift::PrefixUpdateRequest> prefixUpdatesQueue_;
-  messaging::ReplicateQueue<thrift::Publication> kvStoreUpdatesQueue_;
+  messaging::ReplicateQueue<KvStorePublication> kvStoreUpdatesQueue_;
   messaging::ReplicateQueue<thrift::RouteDatabaseDelta> staticRoutesQueue_;
 
   // socket to publish platform events
@@ -7,19 +7,68 @@
 
 #include "Watchdog.h"
 
+#include <dirent.h>
+#include <unistd.h>
+#include <optional>
+#include <vector>
+
+#include <fb303/ServiceData.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+
 #include <openr/common/Constants.h>
+#include <openr/common/MemoryAccounting.h>
 #include <openr/common/Util.h>
 
+namespace fb303 = facebook::fb303;
+
 namespace openr {
 
+namespace {
+
+// Name and CPU ticks (utime + stime) of a thread from its
+// /proc/self/task/<tid>/stat, none if it is gone
+std::optional<std::pair<std::string, uint64_t>>
+readThreadStat(const std::string& tid) {
+  std::string stat;
+  if (not folly::readFile(
+          folly::sformat("/proc/self/task/{}/stat", tid).c_str(), stat)) {
+    return std::nullopt;
+  }
+  // name is in parentheses and may contain anything
+  const auto nameStart = stat.find('(');
+  const auto nameEnd = stat.rfind(')');
+  if (nameStart == std::string::npos or nameEnd == std::string::npos or
+      nameEnd < nameStart) {
+    return std::nullopt;
+  }
+  std::vector<folly::StringPiece> fields;
+  folly::split(' ', folly::StringPiece(stat).subpiece(nameEnd + 2), fields);
+  // fields start with state (3rd), utime and stime are 14th and 15th
+  if (fields.size() < 13) {
+    return std::nullopt;
+  }
+  try {
+    return std::make_pair(
+        stat.substr(nameStart + 1, nameEnd - nameStart - 1),
+        folly::to<uint64_t>(fields[11]) + folly::to<uint64_t>(fields[12]));
+  } catch (std::exception const&) {
+    return std::nullopt;
+  }
+}
+
+} // namespace
+
 Watchdog::Watchdog(
     std::string const& myNodeName,
     std::chrono::seconds healthCheckInterval,
     std::chrono::seconds healthCheckThreshold,
-    uint32_t criticalMemoryMB)
+    uint32_t criticalMemoryMB,
+    std::chrono::milliseconds slowCallbackThreshold)
     : myNodeName_(myNodeName),
       healthCheckInterval_(healthCheckInterval),
       healthCheckThreshold_(healthCheckThreshold),
+      slowCallbackThreshold_(slowCallbackThreshold),
       previousStatus_(true),
       criticalMemoryMB_(criticalMemoryMB) {
   // Schedule periodic timer for checking thread health
@@ -30,6 +79,12 @@ Watchdog::Watchdog(
     watchdogTimer_->scheduleTimeout(healthCheckInterval_);
   });
   watchdogTimer_->scheduleTimeout(healthCheckInterval_);
+
+  probeTimer_ = folly::AsyncTimeout::make(*getEvb(), [this]() noexcept {
+    probeEvbs();
+    probeTimer_->scheduleTimeout(Constants::kEvbLagProbeInterval);
+  });
+  probeTimer_->scheduleTimeout(Constants::kEvbLagProbeInterval);
 }
 
 void
@@ -38,9 +93,93 @@ Watchdog::addEvb(OpenrEventBase* evb, const std::string& name) {
   getEvb()->runInEventBaseThreadAndWait([this, evb, name]() {
     CHECK_EQ(monitorEvbs_.count(evb), 0);
     monitorEvbs_.emplace(evb, name);
+
+    const auto lagKey = "watchdog.evb_lag_ms." + name;
+    fb303::fbData->addHistogram(lagKey, 10, 0, 1000);
+    fb303::fbData->exportHistogramPercentile(lagKey, 50, 95, 99);
+
+    auto& stats = evbStats_[evb];
+    stats.detector =
+        std::make_unique<SlowCallbackDetector>(name, slowCallbackThreshold_);
+    stats.probePending = std::make_shared<std::atomic<bool>>(false);
+    evb->getEvb()->runInEventBaseThread(
+        [evb, detector = stats.detector.get()]() {
+          evb->setExecutionObservers(
+              detector->getHandlerObserver(), detector->getFiberObserver());
+        });
   });
 }
 
+void
+Watchdog::probeEvbs() {
+  for (auto const& kv : monitorEvbs_) {
+    auto const& probePending = evbStats_.at(kv.first).probePending;
+    if (probePending->exchange(true)) {
+      // stuck or very slow, it gets accounted once the probe ran
+      continue;
+    }
+    kv.first->getEvb()->runInEventBaseThread(
+        [lagKey = "watchdog.evb_lag_ms." + kv.second,
+         probePending,
+         sentTime = std::chrono::steady_clock::now()]() {
+          const auto lag =
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - sentTime);
+          fb303::fbData->addHistogramValue(lagKey, lag.count());
+          probePending->store(false);
+        });
+  }
+}
+
+void
+Watchdog::updateThreadCpuCounters() {
+  const auto now = std::chrono::steady_clock::now();
+  const auto elapsedS =
+      std::chrono::duration_cast<std::chrono::duration<double>>(
+          now - threadCpuTime_)
+          .count();
+  const bool hasPrevious = not threadCpuTicks_.empty();
+  static const long kTicksPerSecond = sysconf(_SC_CLK_TCK);
+
+  auto dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    LOG(ERROR) << "Failed to open /proc/self/task: " << folly::errnoStr(errno);
+    return;
+  }
+  std::unordered_map<std::string, uint64_t> ticks;
+  std::unordered_map<std::string, uint64_t> ticksByName;
+  while (auto entry = readdir(dir)) {
+    const std::string tid(entry->d_name);
+    if (tid == "." or tid == "..") {
+      continue;
+    }
+    auto stat = readThreadStat(tid);
+    if (not stat.has_value()) {
+      continue;
+    }
+    ticks.emplace(tid, stat->second);
+    // new threads account from their start
+    auto prevIt = threadCpuTicks_.find(tid);
+    const uint64_t prevTicks =
+        prevIt != threadCpuTicks_.end() ? prevIt->second : 0;
+    ticksByName[stat->first] +=
+        stat->second - std::min(prevTicks, stat->second);
+  }
+  closedir(dir);
+
+  threadCpuTicks_ = std::move(ticks);
+  threadCpuTime_ = now;
+  if (not hasPrevious or elapsedS <= 0 or kTicksPerSecond <= 0) {
+    return;
+  }
+  for (auto const& kv : ticksByName) {
+    fb303::fbData->setCounter(
+        "watchdog.thread_cpu_pct." + kv.first,
+        static_cast<int64_t>(
+            100 * kv.second / (elapsedS * kTicksPerSecond)));
+  }
+}
+
 bool
 Watchdog::memoryLimitExceeded() {
   bool result;
@@ -51,6 +190,11 @@ Watchdog::memoryLimitExceeded() {
 
 void
 Watchdog::monitorMemory() {
+  for (auto const& kv : MemoryAccounting::getAllocatedBytes()) {
+    fb303::fbData->setCounter(
+        "watchdog.memory." + kv.first + ".allocated_bytes", kv.second);
+  }
+
   auto memInUse_ = systemMetrics_.getRSSMemBytes();
   if (not memInUse_.has_value()) {
     return;
@@ -84,6 +228,15 @@ void
 Watchdog::updateCounters() {
   VLOG(2) << "Checking thread aliveness counters...";
 
+  for (auto const& kv : evbStats_) {
+    fb303::fbData->setCounter(
+        "watchdog.evb_max_callback_ms." + monitorEvbs_.at(kv.first),
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            kv.second.detector->getAndResetMax())
+            .count());
+  }
+  updateThreadCpuCounters();
+
   auto const& now = std::chrono::duration_cast<std::chrono::seconds>(
       std::chrono::system_clock::now().time_since_epoch());
   std::vector<std::string> stuckThreads;
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -17,16 +19,31 @@
 
 #include <openr/common/Constants.h>
 #include <openr/common/OpenrEventBase.h>
+#include <openr/common/SlowCallbackDetector.h>
 
 namespace openr {
 
+/**
+ * Watchdog of Open/R threads. Crashes the process if an event base doesn't
+ * make progress or memory stays above its limit. Reports per event base:
+ * - watchdog.evb_lag_ms.<name>: histogram of time probe callbacks wait to run
+ * - watchdog.evb_max_callback_ms.<name>: longest handler or fiber task run
+ *   since last check
+ * - evb.slow_callbacks.<name>: callbacks longer than slowCallbackThreshold,
+ *   see SlowCallbackDetector
+ * and CPU usage of each thread by its name, in percent of one core since the
+ * last check: watchdog.thread_cpu_pct.<name>. With memory accounting, bytes
+ * allocated per module: watchdog.memory.<module>.allocated_bytes
+ */
 class Watchdog final : public OpenrEventBase {
  public:
   Watchdog(
       std::string const& myNodeName,
       std::chrono::seconds healthCheckInterval,
       std::chrono::seconds healthCheckThreshold,
-      uint32_t critialMemoryMB);
+      uint32_t critialMemoryMB,
+      std::chrono::milliseconds slowCallbackThreshold =
+          std::chrono::milliseconds(100));
 
   // non-copyable
   Watchdog(Watchdog const&) = delete;
@@ -42,6 +59,12 @@ class Watchdog final : public OpenrEventBase {
   // monitor memory usage
   void monitorMemory();
 
+  // queue lag probe on each event base, unless one is still pending
+  void probeEvbs();
+
+  // CPU usage per thread name since last call
+  void updateThreadCpuCounters();
+
   void fireCrash(const std::string& msg);
 
   const std::string myNodeName_;
@@ -52,12 +75,31 @@ class Watchdog final : public OpenrEventBase {
   // mapping of thread name to eventloop pointer
   std::unordered_map<OpenrEventBase*, std::string> monitorEvbs_;
 
+  struct EvbStats {
+    // sets execution observers of the event base, which must not outlive
+    // the watchdog
+    std::unique_ptr<SlowCallbackDetector> detector;
+    // lag probe is queued and didn't run yet
+    std::shared_ptr<std::atomic<bool>> probePending;
+  };
+  std::unordered_map<OpenrEventBase*, EvbStats> evbStats_;
+
+  // Timer to probe event base lag
+  std::unique_ptr<folly::AsyncTimeout> probeTimer_{nullptr};
+
+  // CPU ticks of each thread, by tid, at the last check
+  std::unordered_map<std::string, uint64_t> threadCpuTicks_;
+  std::chrono::steady_clock::time_point threadCpuTime_;
+
   // thread healthcheck interval
   const std::chrono::seconds healthCheckInterval_;
 
   // thread healthcheck threshold
   const std::chrono::seconds healthCheckThreshold_;
 
+  // callbacks of event bases taking longer get recorded
+  const std::chrono::milliseconds slowCallbackThreshold_;
+
   // boolean to indicate previous failure
   bool previousStatus_{true};
 